@@ -128,6 +128,20 @@ namespace MongoDB.Libmongocrypt.Test
             }
         }
 
+#if NETCOREAPP3_0
+        [Fact]
+        public void DecryptQuerySpan()
+        {
+            var buffer = BsonUtil.ToBytes(ReadJsonTestFile("encrypted-command-reply.json"));
+            using (var cryptClient = CryptClientFactory.Create(CreateOptions()))
+            using (var context = cryptClient.StartDecryptionContext(new ReadOnlySpan<byte>(buffer)))
+            {
+                var (_, bsonCommand) = ProcessContextToCompletion(context);
+                bsonCommand.Should().Equal(ReadJsonTestFile("command-reply.json"));
+            }
+        }
+#endif
+
         [Fact]
         public void DecryptQueryStepwise()
         {
@@ -95,6 +95,24 @@ namespace MongoDB.Libmongocrypt
             }
         }
 
+#if NETSTANDARD2_1
+        /// <summary>
+        /// Gets a view of the data without copying it into managed memory.
+        /// The span is only valid until the owner of the data (this binary or its context) is disposed.
+        /// </summary>
+        public unsafe ReadOnlySpan<byte> AsReadOnlySpan()
+        {
+            if (Length > 0)
+            {
+                return new ReadOnlySpan<byte>((void*)Data, (int)Length);
+            }
+            else
+            {
+                return ReadOnlySpan<byte>.Empty;
+            }
+        }
+#endif
+
         /// <summary>
         /// Write bytes into Data.
         /// </summary>
@@ -102,6 +102,33 @@ namespace MongoDB.Libmongocrypt
             return new CryptContext(handle);
         }
 
+#if NETSTANDARD2_1
+        /// <summary>
+        /// Starts the encryption context, pinning the command rather than copying it.
+        /// </summary>
+        /// <param name="db">The database of the collection.</param>
+        /// <param name="command">The command.</param>
+        /// <returns>A encryption context.</returns>
+        public CryptContext StartEncryptionContext(string db, ReadOnlySpan<byte> command)
+        {
+            ContextSafeHandle handle = Library.mongocrypt_ctx_new(_handle);
+
+            IntPtr stringPointer = (IntPtr)Marshal.StringToHGlobalAnsi(db);
+
+            try
+            {
+                // Let mongocrypt run strlen
+                PinnedBinary.RunAsPinnedBinary(handle, command, _status, (h, pb) => Library.mongocrypt_ctx_encrypt_init(h, stringPointer, -1, pb));
+            }
+            finally
+            {
+                Marshal.FreeHGlobal(stringPointer);
+            }
+
+            return new CryptContext(handle);
+        }
+#endif
+
         /// <summary>
         /// Starts an explicit encryption context.
         /// </summary>
@@ -183,6 +210,22 @@ namespace MongoDB.Libmongocrypt
             return new CryptContext(handle);
         }
 
+#if NETSTANDARD2_1
+        /// <summary>
+        /// Starts the decryption context, pinning the document rather than copying it.
+        /// </summary>
+        /// <param name="buffer">The bson document to decrypt.</param>
+        /// <returns>A decryption context</returns>
+        public CryptContext StartDecryptionContext(ReadOnlySpan<byte> buffer)
+        {
+            ContextSafeHandle handle = Library.mongocrypt_ctx_new(_handle);
+
+            PinnedBinary.RunAsPinnedBinary(handle, buffer, _status, (h, pb) => Library.mongocrypt_ctx_decrypt_init(h, pb));
+
+            return new CryptContext(handle);
+        }
+#endif
+
         /// <summary>
         /// Starts an explicit decryption context.
         /// </summary>
@@ -136,6 +136,17 @@ namespace MongoDB.Libmongocrypt
             }
         }
 
+#if NETSTANDARD2_1
+        /// <summary>
+        /// Feeds the result from running a remote operation back to the libmongocrypt, pinning it rather than copying it.
+        /// </summary>
+        /// <param name="buffer">The buffer.</param>
+        public void Feed(ReadOnlySpan<byte> buffer)
+        {
+            PinnedBinary.RunAsPinnedBinary(_handle, buffer, _status, (h, pb) => Library.mongocrypt_ctx_mongo_feed(h, pb));
+        }
+#endif
+
         /// <summary>
         /// Signal the feeding is done.
         /// </summary>
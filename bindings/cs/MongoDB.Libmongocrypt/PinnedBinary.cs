@@ -39,6 +39,23 @@ namespace MongoDB.Libmongocrypt
                 }
             }
         }
+
+#if NETSTANDARD2_1
+        internal static void RunAsPinnedBinary<THandle>(THandle handle, ReadOnlySpan<byte> bytes, Status status, Func<THandle, BinarySafeHandle, bool> handleFunc) where THandle : CheckableSafeHandle
+        {
+            unsafe
+            {
+                fixed (byte* map = bytes)
+                {
+                    var ptr = (IntPtr)map;
+                    using (var pinned = new PinnedBinary(ptr, (uint)bytes.Length))
+                    {
+                        handle.Check(status, handleFunc(handle, pinned.Handle));
+                    }
+                }
+            }
+        }
+#endif
         #endregion
 
         internal PinnedBinary(IntPtr ptr, uint len)
@@ -19,17 +19,27 @@ package com.mongodb.crypt.capi;
 
 import com.mongodb.crypt.capi.CAPI.mongocrypt_binary_t;
 
+import java.nio.ByteBuffer;
+
 import static com.mongodb.crypt.capi.CAPI.mongocrypt_binary_destroy;
 
 // Wrap JNA memory and a mongocrypt_binary_t that references that memory, in order to ensure that the JNA Memory is not GC'd before the
-// mongocrypt_binary_t is destroyed
+// mongocrypt_binary_t is destroyed. A direct ByteBuffer may be referenced instead, in which case the caller owns its memory.
 class BinaryHolder implements AutoCloseable {
 
     private final DisposableMemory memory;
+    private final ByteBuffer directBuffer;
     private final mongocrypt_binary_t binary;
 
     BinaryHolder(final DisposableMemory memory, final mongocrypt_binary_t binary) {
         this.memory = memory;
+        this.directBuffer = null;
+        this.binary = binary;
+    }
+
+    BinaryHolder(final ByteBuffer directBuffer, final mongocrypt_binary_t binary) {
+        this.memory = null;
+        this.directBuffer = directBuffer;
         this.binary = binary;
     }
 
@@ -40,6 +50,8 @@ class BinaryHolder implements AutoCloseable {
     @Override
     public void close() {
         mongocrypt_binary_destroy(binary);
-        memory.dispose();
+        if (memory != null) {
+            memory.dispose();
+        }
     }
 }
@@ -136,6 +136,16 @@ public class CAPI {
     public static native cstring
     mongocrypt_version(Pointer len);
 
+    /**
+     * Returns true if libmongocrypt was built with native crypto support.
+     *
+     * <p>If libmongocrypt was not built with native crypto support, setting crypto hooks is required.</p>
+     *
+     * @return true if libmongocrypt was built with native crypto support.
+     * @since 1.10
+     */
+    public static native boolean
+    mongocrypt_is_crypto_available();
 
     /**
      * Create a new non-owning view of a buffer (data + length).
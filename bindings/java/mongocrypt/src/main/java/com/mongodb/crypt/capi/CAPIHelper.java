@@ -18,6 +18,7 @@
 package com.mongodb.crypt.capi;
 
 import com.mongodb.crypt.capi.CAPI.mongocrypt_binary_t;
+import com.sun.jna.Native;
 import com.sun.jna.Pointer;
 import org.bson.BsonBinaryWriter;
 import org.bson.BsonDocument;
@@ -60,6 +61,14 @@ final class CAPIHelper {
     }
 
     static BinaryHolder toBinary(final ByteBuffer buffer) {
+        if (buffer.isDirect()) {
+            // Off-heap memory can be passed to libmongocrypt as is, which only reads it for the duration of the call
+            int length = buffer.remaining();
+            Pointer pointer = Native.getDirectBufferPointer(buffer).share(buffer.position());
+            buffer.position(buffer.limit());
+            return new BinaryHolder(buffer, mongocrypt_binary_new_from_data(pointer, length));
+        }
+
         byte[] message = new byte[buffer.remaining()];
         buffer.get(message, 0, buffer.remaining());
 
@@ -75,6 +84,10 @@ final class CAPIHelper {
         return pointer.getByteBuffer(0, length);
     }
 
+    static ByteBuffer toReadOnlyByteBuffer(final mongocrypt_binary_t binary) {
+        return toByteBuffer(binary).asReadOnlyBuffer();
+    }
+
     static byte[] toByteArray(final mongocrypt_binary_t binary) {
         ByteBuffer byteBuffer = toByteBuffer(binary);
         byte[] byteArray = new byte[byteBuffer.remaining()];
@@ -21,6 +21,7 @@ package com.mongodb.crypt.capi;
 import org.bson.BsonDocument;
 
 import java.io.Closeable;
+import java.nio.ByteBuffer;
 
 /**
  * A context for encryption/decryption operations.
@@ -44,6 +45,15 @@ public interface MongoCrypt extends Closeable {
      */
     MongoCryptContext createDecryptionContext(BsonDocument document);
 
+    /**
+     * Create a context to use for decryption, without copying the document when the buffer is direct.
+     *
+     * @param document the BSON encoded document to decrypt, from its position to its limit
+     * @return the context
+     * @since 1.10
+     */
+    MongoCryptContext createDecryptionContext(ByteBuffer document);
+
     /**
      * Create a context to use for creating a data key
      * @param kmsProvider the KMS provider
@@ -21,6 +21,7 @@ import org.bson.BsonDocument;
 import org.bson.RawBsonDocument;
 
 import java.io.Closeable;
+import java.nio.ByteBuffer;
 
 /**
  * An interface representing the lifecycle of an encryption or decryption request.  It's modelled as a state machine.
@@ -102,6 +103,14 @@ public interface MongoCryptContext extends Closeable {
      */
     void addMongoOperationResult(BsonDocument document);
 
+    /**
+     * Add a result of the operation without copying it when the buffer is direct.
+     *
+     * @param document a BSON encoded result of the operation, from its position to its limit
+     * @since 1.10
+     */
+    void addMongoOperationResult(ByteBuffer document);
+
     /**
      * Signal completion of the operation
      */
@@ -132,6 +141,16 @@ public interface MongoCryptContext extends Closeable {
      */
     RawBsonDocument finish();
 
+    /**
+     * Finish the context without copying the result onto the Java heap.
+     *
+     * <p>The returned buffer is a read-only view of memory owned by this context. It is only valid until the context is closed.</p>
+     *
+     * @return a direct buffer containing the BSON encoded encrypted or decrypted document
+     * @since 1.10
+     */
+    ByteBuffer finishAsByteBuffer();
+
     @Override
     void close();
 }
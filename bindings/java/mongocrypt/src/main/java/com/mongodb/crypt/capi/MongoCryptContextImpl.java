@@ -23,6 +23,8 @@ import com.mongodb.crypt.capi.CAPI.mongocrypt_kms_ctx_t;
 import org.bson.BsonDocument;
 import org.bson.RawBsonDocument;
 
+import java.nio.ByteBuffer;
+
 import static com.mongodb.crypt.capi.CAPI.mongocrypt_binary_destroy;
 import static com.mongodb.crypt.capi.CAPI.mongocrypt_binary_new;
 import static com.mongodb.crypt.capi.CAPI.mongocrypt_ctx_destroy;
@@ -40,6 +42,7 @@ import static com.mongodb.crypt.capi.CAPI.mongocrypt_status_new;
 import static com.mongodb.crypt.capi.CAPI.mongocrypt_status_t;
 import static com.mongodb.crypt.capi.CAPIHelper.toBinary;
 import static com.mongodb.crypt.capi.CAPIHelper.toDocument;
+import static com.mongodb.crypt.capi.CAPIHelper.toReadOnlyByteBuffer;
 import static org.bson.assertions.Assertions.isTrue;
 import static org.bson.assertions.Assertions.notNull;
 
@@ -86,6 +89,18 @@ class MongoCryptContextImpl implements MongoCryptContext {
         }
     }
 
+    @Override
+    public void addMongoOperationResult(final ByteBuffer document) {
+        isTrue("open", !closed);
+
+        try (BinaryHolder binaryHolder = toBinary(document)) {
+            boolean success = mongocrypt_ctx_mongo_feed(wrapped, binaryHolder.getBinary());
+            if (!success) {
+                throwExceptionFromStatus();
+            }
+        }
+    }
+
     @Override
     public void completeMongoOperation() {
         isTrue("open", !closed);
@@ -144,6 +159,23 @@ class MongoCryptContextImpl implements MongoCryptContext {
         }
     }
 
+    @Override
+    public ByteBuffer finishAsByteBuffer() {
+        isTrue("open", !closed);
+
+        mongocrypt_binary_t binary = mongocrypt_binary_new();
+
+        try {
+            boolean success = mongocrypt_ctx_finalize(wrapped, binary);
+            if (!success) {
+                throwExceptionFromStatus();
+            }
+            return toReadOnlyByteBuffer(binary);
+        } finally {
+            mongocrypt_binary_destroy(binary);
+        }
+    }
+
     @Override
     public void close() {
         mongocrypt_ctx_destroy(wrapped);
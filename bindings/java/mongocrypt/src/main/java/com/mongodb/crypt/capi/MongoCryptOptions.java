@@ -38,6 +38,7 @@ public class MongoCryptOptions {
     private final BsonDocument extraOptions;
     private final boolean bypassQueryAnalysis;
     private final List<String> searchPaths;
+    private final boolean nativeCryptoEnabled;
 
 
     /**
@@ -134,6 +135,17 @@ public class MongoCryptOptions {
         return searchPaths;
     }
 
+    /**
+     * Gets whether libmongocrypt's native crypto is used in place of the Java crypto callbacks when available.
+     * Defaults to false.
+     *
+     * @return whether native crypto is used when available
+     * @since 1.10
+     */
+    public boolean isNativeCryptoEnabled() {
+        return nativeCryptoEnabled;
+    }
+
     /**
      * The builder for the options
      */
@@ -147,6 +159,7 @@ public class MongoCryptOptions {
         private boolean bypassQueryAnalysis;
         private BsonDocument extraOptions = new BsonDocument();
         private List<String> searchPaths = emptyList();
+        private boolean nativeCryptoEnabled;
 
         private Builder() {
         }
@@ -257,6 +270,24 @@ public class MongoCryptOptions {
             return this;
         }
 
+        /**
+         * Sets whether libmongocrypt's native crypto is used in place of the Java crypto callbacks when available.
+         * Defaults to false.
+         *
+         * <p>With native crypto, AES, HMAC, SHA-256 and random bytes are computed by libmongocrypt without calling
+         * back into the JVM through JNA for each operation. It is only available if libmongocrypt was built with
+         * native crypto support; otherwise the Java callbacks are used. RSA signing for GCP always uses the Java
+         * callback.</p>
+         *
+         * @param nativeCryptoEnabled whether native crypto is used when available
+         * @return this
+         * @since 1.10
+         */
+        public Builder nativeCryptoEnabled(final boolean nativeCryptoEnabled) {
+            this.nativeCryptoEnabled = nativeCryptoEnabled;
+            return this;
+        }
+
         /**
          * Build the options.
          *
@@ -280,5 +311,6 @@ public class MongoCryptOptions {
         this.bypassQueryAnalysis = builder.bypassQueryAnalysis;
         this.extraOptions = builder.extraOptions;
         this.searchPaths = builder.searchPaths;
+        this.nativeCryptoEnabled = builder.nativeCryptoEnabled;
     }
 }
@@ -23,6 +23,7 @@ import org.bson.BsonBinarySubType;
 import org.bson.BsonDocument;
 import org.bson.BsonString;
 import org.bson.RawBsonDocument;
+import org.bson.codecs.BsonDocumentCodec;
 import org.junit.jupiter.api.Disabled;
 import org.junit.jupiter.api.Test;
 
@@ -44,6 +45,7 @@ import static org.junit.jupiter.api.Assertions.assertEquals;
 import static org.junit.jupiter.api.Assertions.assertIterableEquals;
 import static org.junit.jupiter.api.Assertions.assertNotNull;
 import static org.junit.jupiter.api.Assertions.assertNull;
+import static org.junit.jupiter.api.Assertions.assertTrue;
 
 
 @SuppressWarnings("SameParameterValue")
@@ -107,6 +109,64 @@ public class MongoCryptTest {
         mongoCrypt.close();
     }
 
+    @Test
+    public void testDecryptDirectByteBuffer() {
+        MongoCrypt mongoCrypt = createMongoCrypt();
+        assertNotNull(mongoCrypt);
+
+        MongoCryptContext decryptor = mongoCrypt.createDecryptionContext(
+                toDirectByteBuffer(getResourceAsDocument("encrypted-command-reply.json")));
+
+        assertEquals(State.NEED_MONGO_KEYS, decryptor.getState());
+
+        BsonDocument keyFilter = decryptor.getMongoOperation();
+        assertEquals(getResourceAsDocument("key-filter.json"), keyFilter);
+        decryptor.addMongoOperationResult(toDirectByteBuffer(getResourceAsDocument("key-document.json")));
+        decryptor.completeMongoOperation();
+
+        MongoKeyDecryptor keyDecryptor = decryptor.nextKeyDecryptor();
+        keyDecryptor.feed(getHttpResourceAsByteBuffer("kms-reply.txt"));
+        assertNull(decryptor.nextKeyDecryptor());
+        decryptor.completeKeyDecryptors();
+
+        assertEquals(State.READY, decryptor.getState());
+
+        ByteBuffer decrypted = decryptor.finishAsByteBuffer();
+        assertEquals(State.DONE, decryptor.getState());
+        assertTrue(decrypted.isDirect());
+        assertTrue(decrypted.isReadOnly());
+
+        byte[] bytes = new byte[decrypted.remaining()];
+        decrypted.get(bytes);
+        assertEquals(getResourceAsDocument("command-reply.json"), new RawBsonDocument(bytes));
+
+        decryptor.close();
+
+        mongoCrypt.close();
+    }
+
+    @Test
+    public void testDecryptWithNativeCrypto() {
+        MongoCrypt mongoCrypt = createMongoCrypt(true);
+        assertNotNull(mongoCrypt);
+
+        MongoCryptContext decryptor = mongoCrypt.createDecryptionContext(getResourceAsDocument("encrypted-command-reply.json"));
+
+        assertEquals(State.NEED_MONGO_KEYS, decryptor.getState());
+
+        testKeyDecryptor(decryptor);
+
+        assertEquals(State.READY, decryptor.getState());
+
+        RawBsonDocument decryptedDocument = decryptor.finish();
+        assertEquals(State.DONE, decryptor.getState());
+        assertEquals(getResourceAsDocument("command-reply.json"), decryptedDocument);
+
+        decryptor.close();
+
+        mongoCrypt.close();
+    }
+
     @Test
     public void testEmptyAwsCredentials() throws URISyntaxException, IOException {
         MongoCrypt mongoCrypt = MongoCrypts.create(MongoCryptOptions
@@ -299,6 +359,10 @@ public class MongoCryptTest {
     }
 
     private MongoCrypt createMongoCrypt() {
+        return createMongoCrypt(false);
+    }
+
+    private MongoCrypt createMongoCrypt(final boolean nativeCryptoEnabled) {
         return MongoCrypts.create(MongoCryptOptions
                 .builder()
                 .awsKmsProviderOptions(MongoAwsKmsProviderOptions.builder()
@@ -308,6 +372,7 @@ public class MongoCryptTest {
                 .localKmsProviderOptions(MongoLocalKmsProviderOptions.builder()
                         .localMasterKey(ByteBuffer.wrap(new byte[96]))
                         .build())
+                .nativeCryptoEnabled(nativeCryptoEnabled)
                 .build());
     }
 
@@ -315,6 +380,14 @@ public class MongoCryptTest {
         return BsonDocument.parse(getFileAsString(fileName, System.getProperty("line.separator")));
     }
 
+    private static ByteBuffer toDirectByteBuffer(final BsonDocument document) {
+        ByteBuffer heapBuffer = new RawBsonDocument(document, new BsonDocumentCodec()).getByteBuffer().asNIO();
+        ByteBuffer directBuffer = ByteBuffer.allocateDirect(heapBuffer.remaining());
+        directBuffer.put(heapBuffer);
+        directBuffer.flip();
+        return directBuffer;
+    }
+
     private static ByteBuffer getHttpResourceAsByteBuffer(final String fileName) {
         return ByteBuffer.wrap(getFileAsString(fileName, "\r\n").getBytes(StandardCharsets.UTF_8));
     }
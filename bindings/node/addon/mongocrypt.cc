@@ -470,6 +470,7 @@ MongoCrypt::MongoCrypt(const CallbackInfo& info)
 
     if (options.Has("logger")) {
         SetCallback("logger", options["logger"]);
+        _has_js_callbacks = true;
         if (!mongocrypt_setopt_log_handler(_mongo_crypt.get(), MongoCrypt::logHandler, this)) {
             throw TypeError::New(Env(), errorStringFromStatus(_mongo_crypt.get()));
         }
@@ -491,6 +492,7 @@ MongoCrypt::MongoCrypt(const CallbackInfo& info)
         if (!setupCryptoHooks()) {
             throw Error::New(Env(), "unable to configure crypto hooks");
         }
+        _has_js_callbacks = true;
     }
 
     if (options.Has("cryptSharedLibSearchPaths")) {
@@ -559,7 +561,7 @@ Value MongoCrypt::MakeEncryptionContext(const CallbackInfo& info) {
         throw TypeError::New(Env(), errorStringFromStatus(context.get()));
     }
 
-    return MongoCryptContext::NewInstance(Env(), std::move(context));
+    return MongoCryptContext::NewInstance(Env(), this, std::move(context));
 }
 
 Value MongoCrypt::MakeExplicitEncryptionContext(const CallbackInfo& info) {
@@ -643,7 +645,7 @@ Value MongoCrypt::MakeExplicitEncryptionContext(const CallbackInfo& info) {
         throw TypeError::New(Env(), errorStringFromStatus(context.get()));
     }
 
-    return MongoCryptContext::NewInstance(Env(), std::move(context));
+    return MongoCryptContext::NewInstance(Env(), this, std::move(context));
 }
 
 Value MongoCrypt::MakeDecryptionContext(const CallbackInfo& info) {
@@ -657,7 +659,7 @@ Value MongoCrypt::MakeDecryptionContext(const CallbackInfo& info) {
         throw TypeError::New(Env(), errorStringFromStatus(context.get()));
     }
 
-    return MongoCryptContext::NewInstance(Env(), std::move(context));
+    return MongoCryptContext::NewInstance(Env(), this, std::move(context));
 }
 
 Value MongoCrypt::MakeExplicitDecryptionContext(const CallbackInfo& info) {
@@ -671,7 +673,7 @@ Value MongoCrypt::MakeExplicitDecryptionContext(const CallbackInfo& info) {
         throw TypeError::New(Env(), errorStringFromStatus(context.get()));
     }
 
-    return MongoCryptContext::NewInstance(Env(), std::move(context));
+    return MongoCryptContext::NewInstance(Env(), this, std::move(context));
 }
 
 Value MongoCrypt::MakeDataKeyContext(const CallbackInfo& info) {
@@ -722,7 +724,7 @@ Value MongoCrypt::MakeDataKeyContext(const CallbackInfo& info) {
         throw TypeError::New(Env(), errorStringFromStatus(context.get()));
     }
 
-    return MongoCryptContext::NewInstance(Env(), std::move(context));
+    return MongoCryptContext::NewInstance(Env(), this, std::move(context));
 }
 
 Value MongoCrypt::MakeRewrapManyDataKeyContext(const CallbackInfo& info) {
@@ -746,7 +748,7 @@ Value MongoCrypt::MakeRewrapManyDataKeyContext(const CallbackInfo& info) {
         throw TypeError::New(Env(), errorStringFromStatus(context.get()));
     }
 
-    return MongoCryptContext::NewInstance(Env(), std::move(context));
+    return MongoCryptContext::NewInstance(Env(), this, std::move(context));
 }
 
 // Store callbacks as nested properties on the MongoCrypt binding object
@@ -788,16 +790,23 @@ Function MongoCryptContext::Init(Napi::Env env) {
          InstanceMethod("provideKMSProviders", &MongoCryptContext::ProvideKMSProviders),
          InstanceMethod("finishKMSRequests", &MongoCryptContext::FinishKMSRequests),
          InstanceMethod("finalize", &MongoCryptContext::FinalizeContext),
+         InstanceMethod("finalizeAsync", &MongoCryptContext::FinalizeContextAsync),
          InstanceAccessor("status", &MongoCryptContext::Status, nullptr),
          InstanceAccessor("state", &MongoCryptContext::State, nullptr)});
 }
 
 Object MongoCryptContext::NewInstance(
-    Napi::Env env, std::unique_ptr<mongocrypt_ctx_t, MongoCryptContextDeleter> context) {
+    Napi::Env env,
+    MongoCrypt* mongo_crypt,
+    std::unique_ptr<mongocrypt_ctx_t, MongoCryptContextDeleter> context) {
     InstanceData* instance_data = env.GetInstanceData<InstanceData>();
     Object obj = instance_data->MongoCryptContextCtor.Value().New({});
     MongoCryptContext* instance = MongoCryptContext::Unwrap(obj);
     instance->_context = std::move(context);
+    instance->_has_js_callbacks = mongo_crypt->_has_js_callbacks;
+    // The context uses the `mongocrypt_t` of its parent, possibly from
+    // a worker thread. Keep the parent alive for as long as the context.
+    obj.Set("__mongoCrypt", mongo_crypt->Value());
     return obj;
 }
 
@@ -860,11 +869,70 @@ void MongoCryptContext::FinishKMSRequests(const CallbackInfo& info) {
 }
 
 Value MongoCryptContext::FinalizeContext(const CallbackInfo& info) {
+    if (_finalizing) {
+        throw Error::New(Env(), "finalizeAsync() is already in progress");
+    }
+
     std::unique_ptr<mongocrypt_binary_t, MongoCryptBinaryDeleter> output(mongocrypt_binary_new());
     mongocrypt_ctx_finalize(_context.get(), output.get());
     return BufferFromBinary(Env(), output.get());
 }
 
+// Runs `mongocrypt_ctx_finalize` on the libuv thread pool. Encrypting or
+// decrypting many values is CPU-bound and would otherwise block the event loop.
+class FinalizeContextWorker : public AsyncWorker {
+   public:
+    FinalizeContextWorker(Napi::Env env, MongoCryptContext* context)
+        : AsyncWorker(env, "mongocrypt:finalize"),
+          _deferred(Promise::Deferred::New(env)),
+          _context_ref(Persistent(context->Value())),
+          _context(context),
+          _output(mongocrypt_binary_new()) {}
+
+    Promise GetPromise() {
+        return _deferred.Promise();
+    }
+
+   protected:
+    void Execute() override {
+        // Errors are reported through the context status, as with `finalize()`.
+        mongocrypt_ctx_finalize(_context->_context.get(), _output.get());
+    }
+
+    void OnOK() override {
+        _context->_finalizing = false;
+        _deferred.Resolve(BufferFromBinary(Env(), _output.get()));
+    }
+
+    void OnError(const Error& error) override {
+        _context->_finalizing = false;
+        _deferred.Reject(error.Value());
+    }
+
+   private:
+    Promise::Deferred _deferred;
+    ObjectReference _context_ref;
+    MongoCryptContext* _context;
+    std::unique_ptr<mongocrypt_binary_t, MongoCryptBinaryDeleter> _output;
+};
+
+Value MongoCryptContext::FinalizeContextAsync(const CallbackInfo& info) {
+    if (_has_js_callbacks) {
+        // Crypto callbacks and the logger must run on the main thread.
+        throw Error::New(Env(),
+                         "finalizeAsync() requires native crypto and cannot be used when "
+                         "cryptoCallbacks or a logger are set");
+    }
+    if (_finalizing) {
+        throw Error::New(Env(), "finalizeAsync() is already in progress");
+    }
+
+    FinalizeContextWorker* worker = new FinalizeContextWorker(Env(), this);
+    _finalizing = true;
+    worker->Queue();
+    return worker->GetPromise();
+}
+
 Function MongoCryptKMSRequest::Init(Napi::Env env) {
     return DefineClass(
         env,
@@ -54,6 +54,7 @@ class MongoCrypt : public Napi::ObjectWrap<MongoCrypt> {
 
    private:
     friend class Napi::ObjectWrap<MongoCrypt>;
+    friend class MongoCryptContext;
     Napi::Function GetCallback(const char* name);
     void SetCallback(const char* name, Napi::Value fn);
 
@@ -66,13 +67,20 @@ class MongoCrypt : public Napi::ObjectWrap<MongoCrypt> {
                            void* ctx);
 
     std::unique_ptr<mongocrypt_t, MongoCryptDeleter> _mongo_crypt;
+    // Set when a logger or crypto callbacks are registered. libmongocrypt may
+    // then call back into JavaScript, which is only safe on the main thread.
+    bool _has_js_callbacks = false;
 };
 
+class FinalizeContextWorker;
+
 class MongoCryptContext : public Napi::ObjectWrap<MongoCryptContext> {
    public:
     static Napi::Function Init(Napi::Env env);
     static Napi::Object NewInstance(
-        Napi::Env env, std::unique_ptr<mongocrypt_ctx_t, MongoCryptContextDeleter> context);
+        Napi::Env env,
+        MongoCrypt* mongo_crypt,
+        std::unique_ptr<mongocrypt_ctx_t, MongoCryptContextDeleter> context);
 
    private:
     Napi::Value NextMongoOperation(const Napi::CallbackInfo& info);
@@ -82,14 +90,18 @@ class MongoCryptContext : public Napi::ObjectWrap<MongoCryptContext> {
     void ProvideKMSProviders(const Napi::CallbackInfo& info);
     void FinishKMSRequests(const Napi::CallbackInfo& info);
     Napi::Value FinalizeContext(const Napi::CallbackInfo& info);
+    Napi::Value FinalizeContextAsync(const Napi::CallbackInfo& info);
 
     Napi::Value Status(const Napi::CallbackInfo& info);
     Napi::Value State(const Napi::CallbackInfo& info);
 
    private:
     friend class Napi::ObjectWrap<MongoCryptContext>;
+    friend class FinalizeContextWorker;
     explicit MongoCryptContext(const Napi::CallbackInfo& info);
     std::unique_ptr<mongocrypt_ctx_t, MongoCryptContextDeleter> _context;
+    bool _has_js_callbacks = false;
+    bool _finalizing = false;
 };
 
 class MongoCryptKMSRequest : public Napi::ObjectWrap<MongoCryptKMSRequest> {
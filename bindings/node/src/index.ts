@@ -25,6 +25,14 @@ export interface MongoCryptContext {
   provideKMSProviders(providers: Uint8Array): void;
   finishKMSRequests(): void;
   finalize(): Buffer;
+  /**
+   * Finalizes the context on the libuv thread pool instead of the main thread.
+   *
+   * Only available when libmongocrypt uses native crypto, i.e. when neither
+   * `cryptoCallbacks` nor a `logger` were provided. The context must not be
+   * used until the returned promise settles.
+   */
+  finalizeAsync(): Promise<Buffer>;
 
   readonly status: MongoCryptStatus;
   readonly state: number;
@@ -1,6 +1,6 @@
 import { expect } from 'chai';
 import { MongoCrypt, MongoCryptContextCtor } from '../src';
-import { serialize, Binary, Long } from 'bson';
+import { serialize, deserialize, Binary, Long } from 'bson';
 import * as crypto from 'crypto';
 
 // the `randomHook` is necessary for some tests, so we copy it in here.
@@ -408,7 +408,8 @@ describe('MongoCryptContext', () => {
     'nextKMSRequest',
     'provideKMSProviders',
     'finishKMSRequests',
-    'finalize'
+    'finalize',
+    'finalizeAsync'
   ]) {
     it(`it has a method .${method}()`, () => {
       expect(context).to.have.property(method).that.is.a('function');
@@ -428,4 +429,35 @@ describe('MongoCryptContext', () => {
       ).not.to.throw();
     });
   });
+
+  describe('finalizeAsync', () => {
+    it('resolves with the finalized document', async () => {
+      const document = { a: 1 };
+      const context = new MongoCrypt({
+        kmsProviders: serialize({ aws: {} })
+      }).makeDecryptionContext(serialize(document));
+
+      const result = await context.finalizeAsync();
+      expect(deserialize(result)).to.deep.equal(document);
+    });
+
+    it('throws when crypto callbacks are set', () => {
+      const context = new MongoCrypt({
+        kmsProviders: serialize({ aws: {} }),
+        cryptoCallbacks: {
+          aes256CbcEncryptHook: () => {},
+          aes256CbcDecryptHook: () => {},
+          aes256CtrEncryptHook: () => {},
+          aes256CtrDecryptHook: () => {},
+          randomHook,
+          hmacSha512Hook: () => {},
+          hmacSha256Hook: () => {},
+          sha256Hook: () => {},
+          signRsaSha256Hook: () => {}
+        }
+      }).makeDecryptionContext(serialize({}));
+
+      expect(() => context.finalizeAsync()).to.throw(/requires native crypto/);
+    });
+  });
 });
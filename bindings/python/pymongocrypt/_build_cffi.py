@@ -0,0 +1,128 @@
+# Copyright 2024-present MongoDB, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Build pymongocrypt._cffi_mongocrypt, an optional API-mode cffi binding.
+
+binding.py loads libmongocrypt in cffi's ABI mode, which dispatches every call
+through libffi. The compiled binding calls libmongocrypt directly, and adds C
+helpers that do the bookkeeping of a state machine step in one call. binding.py
+uses it when it can be imported and PYMONGOCRYPT_LIB is not set, and falls back
+to ABI mode otherwise.
+
+Build it in place against an installed libmongocrypt with::
+
+    PYMONGOCRYPT_INCLUDE_DIR=/path/to/include PYMONGOCRYPT_LIB_DIR=/path/to/lib \\
+        python pymongocrypt/_build_cffi.py
+
+or set PYMONGOCRYPT_BUILD_CFFI=1 when building a wheel. The extension finds a
+libmongocrypt bundled next to it, like the ABI-mode binding does.
+"""
+
+import ast
+import os
+import sys
+from pathlib import Path
+
+import cffi
+
+# Helpers compiled into the extension.
+_HELPERS_CDEF = """
+bool pymongocrypt_ctx_mongo_feed_done(mongocrypt_ctx_t *ctx,
+                                      uint8_t **docs,
+                                      uint32_t *lens,
+                                      uint32_t count);
+uint32_t pymongocrypt_ctx_next_kms_ctxs(mongocrypt_ctx_t *ctx,
+                                        mongocrypt_kms_ctx_t **out,
+                                        uint32_t max);
+"""
+
+_HELPERS_SOURCE = """
+#include <mongocrypt/mongocrypt.h>
+
+/* Feeds each of the @count BSON documents to @ctx, then completes the mongo
+ * operation. Returns false with an error status set on @ctx on failure. */
+static bool pymongocrypt_ctx_mongo_feed_done(mongocrypt_ctx_t *ctx,
+                                             uint8_t **docs,
+                                             uint32_t *lens,
+                                             uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        mongocrypt_binary_t *bin = mongocrypt_binary_new_from_data(docs[i], lens[i]);
+        bool ok = mongocrypt_ctx_mongo_feed(ctx, bin);
+        mongocrypt_binary_destroy(bin);
+        if (!ok) {
+            return false;
+        }
+    }
+    return mongocrypt_ctx_mongo_done(ctx);
+}
+
+/* Sets @out to up to @max of the pending KMS contexts of @ctx. Returns how
+ * many were set. Fewer than @max means there are no more. */
+static uint32_t pymongocrypt_ctx_next_kms_ctxs(mongocrypt_ctx_t *ctx,
+                                               mongocrypt_kms_ctx_t **out,
+                                               uint32_t max) {
+    uint32_t count = 0;
+    while (count < max) {
+        mongocrypt_kms_ctx_t *kms = mongocrypt_ctx_next_kms_ctx(ctx);
+        if (!kms) {
+            break;
+        }
+        out[count++] = kms;
+    }
+    return count;
+}
+"""
+
+
+def _binding_cdef():
+    """Returns binding._CDEF without importing binding.py, which would load
+    libmongocrypt."""
+    tree = ast.parse((Path(__file__).parent / "binding.py").read_text())
+    for node in tree.body:
+        if (
+            isinstance(node, ast.Assign)
+            and isinstance(node.targets[0], ast.Name)
+            and node.targets[0].id == "_CDEF"
+        ):
+            return ast.literal_eval(node.value)
+    raise RuntimeError("_CDEF not found in binding.py")
+
+
+def _env_dirs(name):
+    value = os.environ.get(name)
+    return value.split(os.pathsep) if value else []
+
+
+# Find a libmongocrypt bundled in the package directory first.
+if sys.platform == "darwin":
+    _extra_link_args = ["-Wl,-rpath,@loader_path"]
+elif sys.platform == "win32":
+    _extra_link_args = []
+else:
+    _extra_link_args = ["-Wl,-rpath,$ORIGIN"]
+
+ffibuilder = cffi.FFI()
+ffibuilder.cdef(_binding_cdef() + _HELPERS_CDEF)
+ffibuilder.set_source(
+    "pymongocrypt._cffi_mongocrypt",
+    _HELPERS_SOURCE,
+    libraries=["mongocrypt"],
+    include_dirs=_env_dirs("PYMONGOCRYPT_INCLUDE_DIR"),
+    library_dirs=_env_dirs("PYMONGOCRYPT_LIB_DIR"),
+    extra_link_args=_extra_link_args,
+)
+
+if __name__ == "__main__":
+    os.chdir(Path(__file__).parent.parent)
+    ffibuilder.compile(verbose=True)
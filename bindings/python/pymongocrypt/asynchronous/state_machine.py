@@ -18,6 +18,7 @@ from pymongocrypt.asynchronous.credentials import _ask_for_kms_credentials
 from pymongocrypt.binding import lib
 from pymongocrypt.compat import ABC
 from pymongocrypt.errors import MongoCryptError
+from pymongocrypt.kms import async_run_kms_requests
 
 
 class AsyncMongoCryptCallback(ABC):
@@ -27,6 +28,9 @@ class AsyncMongoCryptCallback(ABC):
     async def kms_request(self, kms_context):
         """Complete a KMS request.
 
+        The requests of one operation run concurrently, and the synchronous
+        state machine sends them from multiple threads.
+
         :Parameters:
           - `kms_context`: A :class:`MongoCryptKmsContext`.
 
@@ -124,23 +128,18 @@ async def run_state_machine(ctx, callback):
         if state == lib.MONGOCRYPT_CTX_NEED_MONGO_COLLINFO:
             list_colls_filter = ctx.mongo_operation()
             coll_info = await callback.collection_info(ctx.database, list_colls_filter)
-            if coll_info:
-                ctx.add_mongo_operation_result(coll_info)
-            ctx.complete_mongo_operation()
+            ctx.finish_mongo_operation([coll_info] if coll_info else [])
         elif state == lib.MONGOCRYPT_CTX_NEED_MONGO_MARKINGS:
             mongocryptd_cmd = ctx.mongo_operation()
             result = await callback.mark_command(ctx.database, mongocryptd_cmd)
-            ctx.add_mongo_operation_result(result)
-            ctx.complete_mongo_operation()
+            ctx.finish_mongo_operation([result])
         elif state == lib.MONGOCRYPT_CTX_NEED_MONGO_KEYS:
             key_filter = ctx.mongo_operation()
-            for key in await callback.fetch_keys(key_filter):
-                ctx.add_mongo_operation_result(key)
-            ctx.complete_mongo_operation()
+            ctx.finish_mongo_operation(await callback.fetch_keys(key_filter))
         elif state == lib.MONGOCRYPT_CTX_NEED_KMS:
-            for kms_ctx in ctx.kms_contexts():
-                with kms_ctx:
-                    await callback.kms_request(kms_ctx)
+            # libmongocrypt allows KMS contexts to be fed independently, so
+            # send all pending KMS requests at once.
+            await async_run_kms_requests(callback, list(ctx.kms_contexts()))
             ctx.complete_kms()
         elif state == lib.MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS:
             creds = await _ask_for_kms_credentials(ctx.kms_providers)
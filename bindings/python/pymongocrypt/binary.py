@@ -64,6 +64,18 @@ class _MongoCryptBinary:
             return b""
         return ffi.unpack(ffi.cast("char*", data), self.bin.len)
 
+    def to_memoryview(self):
+        """Returns a read-only memoryview over this mongocrypt_binary_t.
+
+        The data is not copied. The view is only valid while the memory the
+        mongocrypt_binary_t points to is, e.g. until the context that filled
+        it is closed.
+        """
+        data = self.bin.data
+        if data == ffi.NULL:
+            return memoryview(b"")
+        return memoryview(ffi.buffer(data, self.bin.len)).toreadonly()
+
 
 class MongoCryptBinaryOut(_MongoCryptBinary):
     __slots__ = ()
@@ -77,11 +89,17 @@ class MongoCryptBinaryIn(_MongoCryptBinary):
     __slots__ = ("cref",)
 
     def __init__(self, data):
-        """Creates a mongocrypt_binary_t from binary data."""
+        """Creates a mongocrypt_binary_t from binary data.
+
+        `data` may be any C-contiguous object supporting the buffer protocol,
+        such as bytes, bytearray or memoryview. It is not copied.
+        """
         # mongocrypt_binary_t does not own the data it is passed so we need to
-        # create a separate reference to keep the data alive.
+        # create a separate reference to keep the data alive. The reference
+        # also pins mutable buffers, like bytearray, until it is released.
         self.cref = ffi.from_buffer("uint8_t[]", data)
-        super().__init__(lib.mongocrypt_binary_new_from_data(self.cref, len(data)))
+        # len(data) counts items, not bytes, for memoryviews of other formats.
+        super().__init__(lib.mongocrypt_binary_new_from_data(self.cref, len(self.cref)))
 
     def _close(self):
         """Cleanup resources."""
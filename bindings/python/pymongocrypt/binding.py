@@ -27,11 +27,8 @@ def _parse_version(version):
     return Version(version)
 
 
-ffi = cffi.FFI()
-
 # Generated with strip_header.py
-ffi.cdef(
-    """/*
+_CDEF = """/*
  * Copyright 2019-present MongoDB, Inc.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
@@ -1393,7 +1390,9 @@ bool mongocrypt_ctx_setopt_algorithm_range(mongocrypt_ctx_t *ctx, mongocrypt_bin
 
 /// String constants for setopt_query_type
 """
-)
+
+ffi = cffi.FFI()
+ffi.cdef(_CDEF)
 
 
 def _to_string(cdata):
@@ -1433,8 +1432,20 @@ class _Library:
 
 
 _PYMONGOCRYPT_LIB = os.environ.get("PYMONGOCRYPT_LIB")
+_compiled = None
+if not _PYMONGOCRYPT_LIB:
+    try:
+        # The optional API-mode binding built by _build_cffi.py. Its calls skip
+        # the libffi dispatch of ABI mode.
+        from pymongocrypt import _cffi_mongocrypt as _compiled
+    except ImportError:
+        # Not built, or its libmongocrypt could not be loaded.
+        pass
+
 try:
-    if _PYMONGOCRYPT_LIB:
+    if _compiled is not None:
+        ffi, lib = _compiled.ffi, _compiled.lib
+    elif _PYMONGOCRYPT_LIB:
         lib = ffi.dlopen(_PYMONGOCRYPT_LIB)
     else:
         try:
@@ -1453,3 +1464,7 @@ else:
             f"Expected libmongocrypt version %s or greater, found {_MIN_LIBMONGOCRYPT_VERSION, libmongocrypt_version()}"
         )
         lib = _Library(exc)
+
+# True if lib is the compiled binding, which also has the pymongocrypt_*
+# helpers declared in _build_cffi.py.
+_COMPILED = _compiled is not None and not isinstance(lib, _Library)
@@ -0,0 +1,88 @@
+# Copyright 2024-present MongoDB, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Send the KMS requests of a context concurrently.
+
+libmongocrypt allows each MongoCryptKmsContext to be fed independently, so a
+context needing several keys does not have to wait for one KMS round trip
+per key. These helpers are shared by the synchronous and asynchronous state
+machines, which are generated from one another by synchro.py.
+"""
+
+import asyncio
+from concurrent.futures import ThreadPoolExecutor
+
+# The maximum number of KMS requests one state machine sends at once.
+MAX_CONCURRENT_KMS_REQUESTS = 16
+
+
+def run_kms_requests(callback, kms_contexts):
+    """Complete each MongoCryptKmsContext with callback.kms_request.
+
+    Requests are sent from a thread pool of up to MAX_CONCURRENT_KMS_REQUESTS
+    threads. Every request finishes before this returns. The first error
+    raised by a request is then re-raised.
+
+    :Parameters:
+      - `callback`: A :class:`MongoCryptCallback`.
+      - `kms_contexts`: A list of :class:`MongoCryptKmsContext`.
+    """
+
+    def kms_request(kms_ctx):
+        with kms_ctx:
+            callback.kms_request(kms_ctx)
+
+    if len(kms_contexts) <= 1:
+        for kms_ctx in kms_contexts:
+            kms_request(kms_ctx)
+        return
+
+    max_workers = min(len(kms_contexts), MAX_CONCURRENT_KMS_REQUESTS)
+    with ThreadPoolExecutor(max_workers=max_workers) as executor:
+        futures = [executor.submit(kms_request, kms_ctx) for kms_ctx in kms_contexts]
+    for future in futures:
+        future.result()
+
+
+async def async_run_kms_requests(callback, kms_contexts):
+    """Complete each MongoCryptKmsContext with callback.kms_request.
+
+    Requests are awaited together, at most MAX_CONCURRENT_KMS_REQUESTS at a
+    time. Every request finishes before this returns. The first error raised
+    by a request is then re-raised.
+
+    :Parameters:
+      - `callback`: An :class:`AsyncMongoCryptCallback`.
+      - `kms_contexts`: A list of :class:`MongoCryptKmsContext`.
+    """
+    semaphore = asyncio.Semaphore(MAX_CONCURRENT_KMS_REQUESTS)
+
+    async def kms_request(kms_ctx):
+        async with semaphore:
+            with kms_ctx:
+                await callback.kms_request(kms_ctx)
+
+    if len(kms_contexts) <= 1:
+        for kms_ctx in kms_contexts:
+            await kms_request(kms_ctx)
+        return
+
+    # Wait for every request, even after an error, so none is still feeding
+    # a KMS context when the caller destroys the mongocrypt_ctx_t.
+    results = await asyncio.gather(
+        *[kms_request(kms_ctx) for kms_ctx in kms_contexts], return_exceptions=True
+    )
+    for result in results:
+        if isinstance(result, BaseException):
+            raise result
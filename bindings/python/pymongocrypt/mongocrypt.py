@@ -19,7 +19,7 @@ from packaging.version import Version
 
 from pymongocrypt.asynchronous.state_machine import AsyncMongoCryptCallback
 from pymongocrypt.binary import MongoCryptBinaryIn, MongoCryptBinaryOut
-from pymongocrypt.binding import _to_string, ffi, lib
+from pymongocrypt.binding import _COMPILED, _to_string, ffi, lib
 from pymongocrypt.compat import str_to_bytes
 from pymongocrypt.crypto import (
     aes_256_cbc_decrypt,
@@ -36,6 +36,9 @@ from pymongocrypt.errors import MongoCryptError
 from pymongocrypt.options import MongoCryptOptions
 from pymongocrypt.synchronous.state_machine import MongoCryptCallback
 
+# The number of KMS contexts fetched per call with the compiled binding.
+_KMS_CONTEXT_BATCH = 32
+
 
 class MongoCrypt:
     def __init__(self, options, callback):
@@ -360,6 +363,33 @@ class MongoCryptContext:
         if not lib.mongocrypt_ctx_mongo_done(self.__ctx):
             self._raise_from_status()
 
+    def finish_mongo_operation(self, documents):
+        """Adds each of the mongo operation's results, then completes it.
+
+        With the compiled binding, this is one call into libmongocrypt.
+
+        :Parameters:
+          - `documents`: An iterable of raw BSON documents.
+        """
+        if not _COMPILED:
+            for document in documents:
+                self.add_mongo_operation_result(document)
+            self.complete_mongo_operation()
+            return
+
+        # Keep the buffers alive until libmongocrypt has copied them.
+        buffers = [ffi.from_buffer("uint8_t[]", document) for document in documents]
+        docs = ffi.new("uint8_t *[]", buffers)
+        lens = ffi.new("uint32_t[]", [len(buf) for buf in buffers])
+        try:
+            if not lib.pymongocrypt_ctx_mongo_feed_done(
+                self.__ctx, docs, lens, len(buffers)
+            ):
+                self._raise_from_status()
+        finally:
+            for buf in buffers:
+                ffi.release(buf)
+
     def provide_kms_providers(self, providers):
         """Provide a map of KMS providers."""
         with MongoCryptBinaryIn(providers) as binary:
@@ -368,6 +398,17 @@ class MongoCryptContext:
 
     def kms_contexts(self):
         """Yields the MongoCryptKmsContexts."""
+        if _COMPILED:
+            # Fetch the KMS contexts in batches with one call each.
+            kms_ctxs = ffi.new("mongocrypt_kms_ctx_t *[]", _KMS_CONTEXT_BATCH)
+            while True:
+                count = lib.pymongocrypt_ctx_next_kms_ctxs(
+                    self.__ctx, kms_ctxs, _KMS_CONTEXT_BATCH
+                )
+                for i in range(count):
+                    yield MongoCryptKmsContext(kms_ctxs[i])
+                if count < _KMS_CONTEXT_BATCH:
+                    return
         ctx = lib.mongocrypt_ctx_next_kms_ctx(self.__ctx)
         while ctx != ffi.NULL:
             yield MongoCryptKmsContext(ctx)
@@ -381,10 +422,25 @@ class MongoCryptContext:
     def finish(self):
         """Returns the finished mongo operation as bson bytes."""
         with MongoCryptBinaryOut() as binary:
+            # cffi releases the GIL for the call, so with native crypto other
+            # threads keep running while libmongocrypt decrypts or encrypts.
             if not lib.mongocrypt_ctx_finalize(self.__ctx, binary.bin):
                 self._raise_from_status()
             return binary.to_bytes()
 
+    def finish_view(self):
+        """Returns the finished mongo operation as a memoryview of bson.
+
+        Unlike :meth:`finish`, the result is not copied out of libmongocrypt.
+        The memoryview is read-only and is only valid until this context is
+        closed, so it must not be used after that.
+        """
+        with MongoCryptBinaryOut() as binary:
+            if not lib.mongocrypt_ctx_finalize(self.__ctx, binary.bin):
+                self._raise_from_status()
+            # The mongocrypt_binary_t points to data owned by the context.
+            return binary.to_memoryview()
+
 
 class EncryptionContext(MongoCryptContext):
     __slots__ = ("database",)
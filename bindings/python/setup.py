@@ -1,3 +1,4 @@
+import os
 import sys
 
 from setuptools import setup
@@ -39,8 +40,15 @@ def parse_reqs_file(fname):
 
 extras_require = dict(test=parse_reqs_file("test-requirements.txt"))
 
+# Set PYMONGOCRYPT_BUILD_CFFI=1 to also build the optional compiled binding.
+# See pymongocrypt/_build_cffi.py.
+setup_kwargs = {}
+if os.environ.get("PYMONGOCRYPT_BUILD_CFFI") == "1":
+    setup_kwargs["cffi_modules"] = ["pymongocrypt/_build_cffi.py:ffibuilder"]
+
 setup(
     cmdclass=cmdclass,
     install_requires=parse_reqs_file("requirements.txt"),
     extras_require=extras_require,
+    **setup_kwargs,
 )
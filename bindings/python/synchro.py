@@ -25,6 +25,7 @@ replacements = {
     "AsyncClient": "Client",
     "AsyncMongoCrypt": "MongoCrypt",
     "aclose": "close",
+    "async_run_kms_requests": "run_kms_requests",
 }
 
 _base = "pymongocrypt"
@@ -15,6 +15,7 @@
 """Benchmark pymongocrypt performance."""
 from __future__ import annotations
 
+import datetime
 import os
 import sys
 import time
@@ -28,7 +29,7 @@ except ImportError:
     import json  # type: ignore[no-redef]
 
 import bson
-from bson import json_util
+from bson import Int64, json_util
 
 sys.path[0:0] = [""]
 
@@ -77,79 +78,58 @@ def tearDownModule():
         print(output)
 
 
-class TestBulkDecryption(unittest.TestCase):
+def percentile(results, percentile):
+    sorted_results = sorted(results)
+    percentile_index = int(len(sorted_results) * percentile / 100) - 1
+    return sorted_results[percentile_index]
+
+
+class PerfTestCase(unittest.TestCase):
     def setUp(self):
-        opts = MongoCryptOptions({"local": {"key": LOCAL_MASTER_KEY}})
-        callback = MockCallback(key_docs=[bson_data("keyDocument.json")])
-        self.mongocrypt = MongoCrypt(opts, callback)
-        self.encrypter = ExplicitEncrypter(callback, opts)
+        self.opts = MongoCryptOptions({"local": {"key": LOCAL_MASTER_KEY}})
+        self.callback = MockCallback(key_docs=[bson_data("keyDocument.json")])
+        self.key_id = json_data("keyDocument.json")["_id"]
+        self.mongocrypt = MongoCrypt(self.opts, self.callback)
+        self.encrypter = ExplicitEncrypter(self.callback, self.opts)
         self.addCleanup(self.mongocrypt.close)
         self.addCleanup(self.encrypter.close)
 
-    def do_task(self, encrypted, duration=MAX_TIME):
+    def run_for(self, task, duration=MAX_TIME):
+        """Calls task until duration seconds passed. Returns the number of calls."""
         start = time.monotonic()
         ops = 0
         while time.monotonic() - start < duration:
-            with self.mongocrypt.decryption_context(encrypted) as ctx:
-                if ctx.state == lib.MONGOCRYPT_CTX_NEED_MONGO_KEYS:
-                    # Key is requested on the first operation, then expected to be cached for one minute.
-                    ctx.add_mongo_operation_result(bson_data("keyDocument.json"))
-                    ctx.complete_mongo_operation()
-                self.assertEqual(ctx.state, lib.MONGOCRYPT_CTX_READY)
-                decrypted = ctx.finish()
+            task()
             ops += 1
-        # Assert that decryption actually occurred.
+        # Assert that the task actually ran.
         self.assertGreater(ops, 0)
-        doc = bson.decode(decrypted)
-        for val in doc.values():
-            self.assertIsInstance(val, str)
         return ops
 
-    def percentile(self, percentile):
-        sorted_results = sorted(self.results)
-        percentile_index = int(len(sorted_results) * percentile / 100) - 1
-        return sorted_results[percentile_index]
-
-    def runTest(self):
-        doc = {}
-        key_id = json_data("keyDocument.json")["_id"]
-        for i in range(NUM_FIELDS):
-            val = f"value {i:04}"
-            val_encrypted = bson.decode(
-                self.encrypter.encrypt(
-                    bson.encode({"v": val}),
-                    "AEAD_AES_256_CBC_HMAC_SHA_512-Deterministic",
-                    key_id=key_id,
-                )
-            )["v"]
-            doc[f"key{i:04}"] = val_encrypted
-        encrypted = bson.encode(doc)
+    def benchmark(self, name, task, thread_counts=(1,), args=None):
+        """Records the median calls of task per second for each thread count."""
         # Warm up benchmark and discard the result.
-        self.do_task(encrypted, duration=2)
+        self.run_for(task, duration=2)
 
-        for n_threads in [1, 2, 8, 64]:
+        for n_threads in thread_counts:
             with ThreadPoolExecutor(max_workers=n_threads) as executor:
-                self.results = []
+                results = []
                 for _ in range(NUM_ITERATIONS):
                     start = time.monotonic()
                     thread_results = list(
-                        executor.map(self.do_task, [encrypted] * n_threads)
+                        executor.map(lambda _: self.run_for(task), range(n_threads))
                     )
                     interval = time.monotonic() - start
-                    self.results.append(sum(thread_results) / interval)
-            median = self.percentile(50)
+                    results.append(sum(thread_results) / interval)
+            median = percentile(results, 50)
+            result_args = dict(args or {}, threads=n_threads)
             print(
-                f"Finished {self.__class__.__name__}, threads={n_threads}, median ops_per_second={median:.2f}"
+                f"Finished {name}, {result_args}, median ops_per_second={median:.2f}"
             )
-            # Remove "Test" so that TestBulkDecryption is reported as "BulkDecryption".
-            name = self.__class__.__name__[4:]
             result_data.append(
                 {
                     "info": {
                         "test_name": name,
-                        "args": {
-                            "threads": n_threads,
-                        },
+                        "args": result_args,
                     },
                     "metrics": [
                         {"name": "ops_per_second", "type": "MEDIAN", "value": median},
@@ -157,6 +137,138 @@ class TestBulkDecryption(unittest.TestCase):
                 }
             )
 
+    def decrypt(self, mongocrypt, encrypted):
+        with mongocrypt.decryption_context(encrypted) as ctx:
+            if ctx.state == lib.MONGOCRYPT_CTX_NEED_MONGO_KEYS:
+                # Key is requested on the first operation, then expected to be cached for one minute.
+                ctx.add_mongo_operation_result(bson_data("keyDocument.json"))
+                ctx.complete_mongo_operation()
+            self.assertEqual(ctx.state, lib.MONGOCRYPT_CTX_READY)
+            return ctx.finish()
+
+
+class TestBulkDecryption(PerfTestCase):
+    def runTest(self):
+        doc = {}
+        for i in range(NUM_FIELDS):
+            val = f"value {i:04}"
+            val_encrypted = bson.decode(
+                self.encrypter.encrypt(
+                    bson.encode({"v": val}),
+                    "AEAD_AES_256_CBC_HMAC_SHA_512-Deterministic",
+                    key_id=self.key_id,
+                )
+            )["v"]
+            doc[f"key{i:04}"] = val_encrypted
+        encrypted = bson.encode(doc)
+
+        def task():
+            decrypted = self.decrypt(self.mongocrypt, encrypted)
+            # Assert that decryption actually occurred.
+            for val in bson.decode(decrypted).values():
+                self.assertIsInstance(val, str)
+
+        self.benchmark("BulkDecryption", task, thread_counts=[1, 2, 8, 64])
+
+
+class TestKeyCache(PerfTestCase):
+    def runTest(self):
+        encrypted = self.encrypter.encrypt(
+            bson.encode({"v": "value"}),
+            "AEAD_AES_256_CBC_HMAC_SHA_512-Deterministic",
+            key_id=self.key_id,
+        )
+
+        def cold():
+            # A new MongoCrypt starts with an empty key cache.
+            mongocrypt = MongoCrypt(self.opts, self.callback)
+            try:
+                self.decrypt(mongocrypt, encrypted)
+            finally:
+                mongocrypt.close()
+
+        self.benchmark("DecryptKeyCacheCold", cold)
+        self.benchmark(
+            "DecryptKeyCacheWarm", lambda: self.decrypt(self.mongocrypt, encrypted)
+        )
+
+
+class TestExplicitEncryption(PerfTestCase):
+    def runTest(self):
+        value = bson.encode({"v": "value"})
+        self.benchmark(
+            "EncryptIndexedInsert",
+            lambda: self.encrypter.encrypt(
+                value, "Indexed", key_id=self.key_id, contention_factor=0
+            ),
+            thread_counts=[1, 8],
+        )
+
+        values = [bson.encode({"v": f"value {i:04}"}) for i in range(NUM_FIELDS)]
+
+        def encrypt_many():
+            for value in values:
+                self.encrypter.encrypt(
+                    value,
+                    "AEAD_AES_256_CBC_HMAC_SHA_512-Deterministic",
+                    key_id=self.key_id,
+                )
+
+        self.benchmark("EncryptMany", encrypt_many, args={"values": NUM_FIELDS})
+
+
+# Range options and values of each benchmarked type, as (min, max, value, precision).
+RANGE_TYPES = {
+    "int32": (0, 200, 123, None),
+    "int64": (Int64(0), Int64(200), Int64(123), None),
+    "double": (0.0, 200.0, 123.456, 2),
+    "date": (
+        datetime.datetime(2000, 1, 1),
+        datetime.datetime(2030, 1, 1),
+        datetime.datetime(2024, 6, 1),
+        None,
+    ),
+}
+
+
+class TestRangeEncryption(PerfTestCase):
+    def runTest(self):
+        for type_name, (lo, hi, value, precision) in RANGE_TYPES.items():
+            range_opts = {"min": lo, "max": hi, "sparsity": Int64(1)}
+            if precision is not None:
+                range_opts["precision"] = precision
+            range_opts = bson.encode(range_opts)
+
+            insert_value = bson.encode({"v": value})
+            self.benchmark(
+                "RangeInsert",
+                lambda: self.encrypter.encrypt(
+                    insert_value,
+                    "Range",
+                    key_id=self.key_id,
+                    contention_factor=0,
+                    range_opts=range_opts,
+                ),
+                args={"type": type_name},
+            )
+
+            find_value = bson.encode(
+                {"v": {"$and": [{"v": {"$gte": lo}}, {"v": {"$lte": value}}]}}
+            )
+            self.benchmark(
+                "RangeFind",
+                lambda: self.encrypter.encrypt(
+                    find_value,
+                    "Range",
+                    key_id=self.key_id,
+                    query_type="range",
+                    contention_factor=0,
+                    range_opts=range_opts,
+                    is_expression=True,
+                ),
+                args={"type": type_name},
+            )
+
 
 if __name__ == "__main__":
     print(
@@ -21,7 +21,7 @@ sys.path[0:0] = [""]
 from test import unittest
 
 import pymongocrypt
-from pymongocrypt.binding import _parse_version, ffi, lib
+from pymongocrypt.binding import _COMPILED, _parse_version, ffi, lib
 
 
 class TestBinding(unittest.TestCase):
@@ -51,6 +51,14 @@ class TestBinding(unittest.TestCase):
         self.assertNotEqual(data, ffi.NULL)
         lib.mongocrypt_status_destroy(data)
 
+    @unittest.skipUnless(_COMPILED, "requires the compiled binding")
+    def test_compiled_helpers(self):
+        kms_ctxs = ffi.new("mongocrypt_kms_ctx_t *[]", 1)
+        self.assertEqual(lib.pymongocrypt_ctx_next_kms_ctxs(ffi.NULL, kms_ctxs, 1), 0)
+        self.assertFalse(
+            lib.pymongocrypt_ctx_mongo_feed_done(ffi.NULL, ffi.NULL, ffi.NULL, 0)
+        )
+
     def test_parse_version(self):
         # Dev versions, betas, RCs should be less than stable releases.
         for v in ("1.1.0-beta1", "1.1.0-b2", "1.1.0-rc1", "1.1.0-beta1", "1.1.0-pre1"):
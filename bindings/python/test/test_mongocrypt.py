@@ -14,10 +14,13 @@
 
 """Test the mongocrypt module."""
 
+import asyncio
 import base64
 import copy
 import os
 import sys
+import threading
+from concurrent.futures import ThreadPoolExecutor
 
 import bson
 import httpx
@@ -46,6 +49,7 @@ from pymongocrypt.asynchronous.state_machine import AsyncMongoCryptCallback
 from pymongocrypt.binding import lib
 from pymongocrypt.compat import PY3, unicode_type
 from pymongocrypt.errors import MongoCryptError
+from pymongocrypt.kms import async_run_kms_requests, run_kms_requests
 from pymongocrypt.mongocrypt import MongoCrypt
 from pymongocrypt.synchronous.auto_encrypter import AutoEncrypter
 from pymongocrypt.synchronous.explicit_encrypter import ExplicitEncrypter
@@ -80,6 +84,13 @@ class TestMongoCryptBinary(unittest.TestCase):
             self.assertEqual(binary.to_bytes(), b"1\x0023")
         self.assertIsNone(binary.bin)
 
+        # Other buffer protocol objects are counted in bytes.
+        with MongoCryptBinaryIn(bytearray(b"1\x0023")) as binary:
+            self.assertEqual(binary.to_bytes(), b"1\x0023")
+            self.assertEqual(binary.to_memoryview(), b"1\x0023")
+        with MongoCryptBinaryIn(memoryview(b"\x01\x00\x00\x00").cast("i")) as binary:
+            self.assertEqual(binary.to_bytes(), b"\x01\x00\x00\x00")
+
     def test_mongocrypt_binary_out(self):
         with MongoCryptBinaryOut() as binary:
             self.assertIsNotNone(binary.bin)
@@ -369,6 +380,20 @@ class TestMongoCrypt(unittest.TestCase):
             self.assertEqual(encrypted, bson_data("command-reply.json"))
             self.assertEqual(ctx.state, lib.MONGOCRYPT_CTX_DONE)
 
+    def test_decrypt_finish_view(self):
+        mc = self.create_mongocrypt()
+        self.addCleanup(mc.close)
+        reply = memoryview(bytearray(bson_data("encrypted-command-reply.json")))
+        with mc.decryption_context(reply) as ctx:
+            self._test_kms_context(ctx)
+            self.assertEqual(ctx.state, lib.MONGOCRYPT_CTX_READY)
+
+            decrypted = ctx.finish_view()
+            self.assertIsInstance(decrypted, memoryview)
+            self.assertTrue(decrypted.readonly)
+            self.assertEqual(decrypted, bson_data("command-reply.json"))
+            self.assertEqual(ctx.state, lib.MONGOCRYPT_CTX_DONE)
+
     def test_encrypt_encrypted_fields_map(self):
         encrypted_fields_map = bson_data(
             "compact/success/encrypted-field-config-map.json"
@@ -572,6 +597,23 @@ class TestMongoCryptCallback(unittest.TestCase):
         self.assertEqual(bson.decode(decrypted, OPTS), json_data("command-reply.json"))
         self.assertEqual(decrypted, bson_data("command-reply.json"))
 
+    def test_decrypt_concurrent(self):
+        encrypter = AutoEncrypter(
+            MockCallback(
+                list_colls_result=bson_data("collection-info.json"),
+                mongocryptd_reply=bson_data("mongocryptd-reply.json"),
+                key_docs=[bson_data("key-document.json")],
+                kms_reply=http_data("kms-reply.txt"),
+            ),
+            self.mongo_crypt_opts(),
+        )
+        self.addCleanup(encrypter.close)
+        encrypted = bson_data("encrypted-command-reply.json")
+        with ThreadPoolExecutor(max_workers=8) as executor:
+            results = list(executor.map(encrypter.decrypt, [encrypted] * 64))
+        for decrypted in results:
+            self.assertEqual(decrypted, bson_data("command-reply.json"))
+
     def test_need_kms_aws_credentials(self):
         kms_providers = {"aws": {}}
         opts = MongoCryptOptions(kms_providers)
@@ -1002,6 +1044,82 @@ if sys.version_info >= (3, 8, 0):  # noqa: UP036
             self.assertEqual(encrypted_val, expected)
 
 
+class MockKmsContext:
+    def __init__(self):
+        self.closed = False
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc_val, exc_tb):
+        self.closed = True
+
+
+class TestKmsRequests(unittest.TestCase):
+    def test_run_kms_requests_concurrently(self):
+        kms_contexts = [MockKmsContext() for _ in range(4)]
+        # Only passes if every request is in flight at once.
+        barrier = threading.Barrier(len(kms_contexts), timeout=10)
+
+        class Callback:
+            def kms_request(self, kms_context):
+                barrier.wait()
+
+        run_kms_requests(Callback(), kms_contexts)
+        self.assertTrue(all(kms_ctx.closed for kms_ctx in kms_contexts))
+
+    def test_run_kms_requests_error(self):
+        kms_contexts = [MockKmsContext() for _ in range(4)]
+        completed = []
+
+        class Callback:
+            def kms_request(self, kms_context):
+                if kms_context is kms_contexts[0]:
+                    raise MongoCryptError("kms error")
+                completed.append(kms_context)
+
+        with self.assertRaisesRegex(MongoCryptError, "kms error"):
+            run_kms_requests(Callback(), kms_contexts)
+        # The other requests still finish.
+        self.assertEqual(len(completed), 3)
+        self.assertTrue(all(kms_ctx.closed for kms_ctx in kms_contexts))
+
+
+class TestAsyncKmsRequests(unittest.IsolatedAsyncioTestCase):
+    async def test_async_run_kms_requests_concurrently(self):
+        kms_contexts = [MockKmsContext() for _ in range(4)]
+        all_started = asyncio.Event()
+        started = []
+
+        class Callback:
+            async def kms_request(self, kms_context):
+                started.append(kms_context)
+                if len(started) == len(kms_contexts):
+                    all_started.set()
+                # Only passes if every request is in flight at once.
+                await asyncio.wait_for(all_started.wait(), timeout=10)
+
+        await async_run_kms_requests(Callback(), kms_contexts)
+        self.assertTrue(all(kms_ctx.closed for kms_ctx in kms_contexts))
+
+    async def test_async_run_kms_requests_error(self):
+        kms_contexts = [MockKmsContext() for _ in range(4)]
+        completed = []
+
+        class Callback:
+            async def kms_request(self, kms_context):
+                if kms_context is kms_contexts[0]:
+                    raise MongoCryptError("kms error")
+                await asyncio.sleep(0)
+                completed.append(kms_context)
+
+        with self.assertRaisesRegex(MongoCryptError, "kms error"):
+            await async_run_kms_requests(Callback(), kms_contexts)
+        # The other requests still finish.
+        self.assertEqual(len(completed), 3)
+        self.assertTrue(all(kms_ctx.closed for kms_ctx in kms_contexts))
+
+
 class TestNeedKMSAzureCredentials(unittest.TestCase):
     maxDiff = None
 
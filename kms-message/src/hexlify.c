@@ -16,10 +16,11 @@
 
 #include "kms_message_private.h"
 #include <stdint.h>
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+static const char hex_digits[] = "0123456789abcdef";
+
 char *
 hexlify (const uint8_t *buf, size_t len)
 {
@@ -29,8 +30,10 @@ hexlify (const uint8_t *buf, size_t len)
    char *p = hex_chars;
    size_t i;
 
+   /* Avoid sprintf, which is called for every byte of every signature. */
    for (i = 0; i < len; i++) {
-      p += sprintf (p, "%02x", buf[i]);
+      *p++ = hex_digits[buf[i] >> 4];
+      *p++ = hex_digits[buf[i] & 0x0f];
    }
 
    *p = '\0';
@@ -101,7 +101,6 @@ _wrap_unwrap_common (const char *wrap_unwrap,
                      const kms_request_opt_t *opt)
 {
    char *path_and_query = NULL;
-   char *payload = NULL;
    char *bearer_token_value = NULL;
    char *value_base64url = NULL;
    kms_request_t *req;
@@ -133,10 +132,6 @@ _wrap_unwrap_common (const char *wrap_unwrap,
       goto done;
    }
 
-   str = kms_request_str_new ();
-   kms_request_str_appendf (
-      str, "{\"alg\": \"RSA-OAEP-256\", \"value\": \"%s\"}", value_base64url);
-   payload = kms_request_str_detach (str);
    str = kms_request_str_new ();
    kms_request_str_appendf (str, "Bearer %s", access_token);
    bearer_token_value = kms_request_str_detach (str);
@@ -155,13 +150,18 @@ _wrap_unwrap_common (const char *wrap_unwrap,
       goto done;
    }
 
-   if (!kms_request_append_payload (req, payload, strlen (payload))) {
-      goto done;
-   }
+   /* Serialize the payload directly into the request. */
+   kms_request_str_reserve (
+      req->payload,
+      strlen (value_base64url) +
+         sizeof ("{\"alg\": \"RSA-OAEP-256\", \"value\": \"\"}"));
+   kms_request_str_append_chars (
+      req->payload, "{\"alg\": \"RSA-OAEP-256\", \"value\": \"", -1);
+   kms_request_str_append_chars (req->payload, value_base64url, -1);
+   kms_request_str_append_chars (req->payload, "\"}", -1);
 
 done:
    kms_request_free_string (path_and_query);
-   kms_request_free_string (payload);
    kms_request_free_string (bearer_token_value);
    kms_request_free_string (value_base64url);
    return req;
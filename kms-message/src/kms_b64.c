@@ -126,28 +126,23 @@ kms_message_b64_ntop (uint8_t const *src,
    uint8_t output[4];
    size_t i;
 
+   /* Check the target size once, including the \0, rather than for each
+    * quantum. */
+   if ((srclength / 3 + (srclength % 3 != 0)) * 4 >= targsize) {
+      return -1;
+   }
+
    while (2 < srclength) {
-      input[0] = *src++;
-      input[1] = *src++;
-      input[2] = *src++;
-      srclength -= 3;
+      const uint32_t quantum =
+         ((uint32_t) src[0] << 16) | ((uint32_t) src[1] << 8) | src[2];
 
-      output[0] = input[0] >> 2;
-      output[1] = (uint8_t) (((input[0] & 0x03) << 4) + (input[1] >> 4));
-      output[2] = (uint8_t) (((input[1] & 0x0f) << 2) + (input[2] >> 6));
-      output[3] = input[2] & 0x3f;
-      KMS_ASSERT (output[0] < 64);
-      KMS_ASSERT (output[1] < 64);
-      KMS_ASSERT (output[2] < 64);
-      KMS_ASSERT (output[3] < 64);
+      src += 3;
+      srclength -= 3;
 
-      if (datalength + 4 > targsize) {
-         return -1;
-      }
-      target[datalength++] = Base64[output[0]];
-      target[datalength++] = Base64[output[1]];
-      target[datalength++] = Base64[output[2]];
-      target[datalength++] = Base64[output[3]];
+      target[datalength++] = Base64[(quantum >> 18) & 0x3f];
+      target[datalength++] = Base64[(quantum >> 12) & 0x3f];
+      target[datalength++] = Base64[(quantum >> 6) & 0x3f];
+      target[datalength++] = Base64[quantum & 0x3f];
    }
 
    /* Now we worry about padding. */
@@ -165,9 +160,6 @@ kms_message_b64_ntop (uint8_t const *src,
       KMS_ASSERT (output[1] < 64);
       KMS_ASSERT (output[2] < 64);
 
-      if (datalength + 4 > targsize) {
-         return -1;
-      }
       target[datalength++] = Base64[output[0]];
       target[datalength++] = Base64[output[1]];
 
@@ -179,9 +171,6 @@ kms_message_b64_ntop (uint8_t const *src,
       target[datalength++] = Pad64;
    }
 
-   if (datalength >= targsize) {
-      return -1;
-   }
    target[datalength] = '\0'; /* Returned value doesn't count \0. */
    return (int) datalength;
 }
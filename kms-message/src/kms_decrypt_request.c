@@ -28,8 +28,8 @@ kms_decrypt_request_new (const uint8_t *ciphertext_blob,
 {
    kms_request_t *request;
    size_t b64_len;
-   char *b64 = NULL;
-   kms_request_str_t *payload = NULL;
+   int b64_written;
+   kms_request_str_t *payload;
 
    request = kms_request_new ("POST", "/", opt);
    if (kms_request_get_error (request)) {
@@ -45,28 +45,27 @@ kms_decrypt_request_new (const uint8_t *ciphertext_blob,
 
    b64_len = (len / 3 + 1) * 4 + 1;
 
-   if (!(b64 = malloc (b64_len))) {
+   /* Serialize the payload in place, with the ciphertext base64-encoded
+    * straight into the pre-sized payload. */
+   payload = request->payload;
+   if (!kms_request_str_reserve (
+          payload, sizeof ("{\"CiphertextBlob\": \"\"}") - 1 + b64_len)) {
       KMS_ERROR (request,
                  "Could not allocate %d bytes for base64-encoding payload",
                  (int) b64_len);
       goto done;
    }
 
-   if (kms_message_b64_ntop (ciphertext_blob, len, b64, b64_len) == -1) {
+   kms_request_str_append_chars (payload, "{\"CiphertextBlob\": \"", -1);
+   b64_written = kms_message_b64_ntop (
+      ciphertext_blob, len, payload->str + payload->len, b64_len);
+   if (b64_written == -1) {
       KMS_ERROR (request, "Could not base64-encode ciphertext blob");
       goto done;
    }
-
-   payload = kms_request_str_new ();
-   kms_request_str_appendf (payload, "{\"CiphertextBlob\": \"%s\"}", b64);
-   if (!kms_request_append_payload (request, payload->str, payload->len)) {
-      KMS_ERROR (request, "Could not append payload");
-      goto done;
-   }
+   payload->len += (size_t) b64_written;
+   kms_request_str_append_chars (payload, "\"}", -1);
 
 done:
-   free (b64);
-   kms_request_str_destroy (payload);
-
    return request;
 }
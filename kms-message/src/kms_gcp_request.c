@@ -19,24 +19,73 @@
 #include "kms_message/kms_b64.h"
 #include "kms_message_private.h"
 #include "kms_request_opt_private.h"
+#include "kms_port.h"
+
+#include <string.h>
 
 /* Set a default expiration of 5 minutes for JSON Web Tokens (GCP allows up to
  * one hour) */
 #define JWT_EXPIRATION_SECS 5 * 60
 #define SIGNATURE_LEN 256
+/* Sign a new JWT once a cached one has less than a minute left. */
+#define JWT_REUSE_MARGIN_SECS 60
 
-kms_request_t *
-kms_gcp_request_oauth_new (const char *host,
-                           const char *email,
-                           const char *audience,
-                           const char *scope,
-                           const char *private_key_data,
-                           size_t private_key_len,
-                           const kms_request_opt_t *opt)
+/* The JWT assertion signed last on this thread. It is reused for the same
+ * service account, audience, scope, host, and private key until shortly before
+ * it expires. The inputs are only kept as a hash. */
+typedef struct {
+   bool valid;
+   unsigned char inputs_hash[32];
+   time_t issued_at;
+   time_t expires_at;
+   char assertion[2048];
+} kms_jwt_assertion_cache_t;
+
+static KMS_THREAD_LOCAL kms_jwt_assertion_cache_t jwt_assertion_cache;
+
+static bool
+hash_jwt_inputs (kms_request_t *req,
+                 const char *host,
+                 const char *email,
+                 const char *audience,
+                 const char *scope,
+                 const char *private_key_data,
+                 size_t private_key_len,
+                 unsigned char *hash_out)
+{
+   kms_request_str_t *str;
+   bool ok;
+
+   /* Prefix each field with its length so distinct inputs cannot collide. */
+   str = kms_request_str_new ();
+   kms_request_str_appendf (str,
+                            "%lu:%s%lu:%s%lu:%s%lu:%s%lu:",
+                            (unsigned long) strlen (host),
+                            host,
+                            (unsigned long) strlen (email),
+                            email,
+                            (unsigned long) strlen (audience),
+                            audience,
+                            (unsigned long) strlen (scope),
+                            scope,
+                            (unsigned long) private_key_len);
+   kms_request_str_append_chars (
+      str, private_key_data, (ssize_t) private_key_len);
+   ok = req->crypto.sha256 (req->crypto.ctx, str->str, str->len, hash_out);
+   kms_request_str_destroy (str);
+   return ok;
+}
+
+static char *
+new_jwt_assertion (kms_request_t *req,
+                   const char *email,
+                   const char *audience,
+                   const char *scope,
+                   const char *private_key_data,
+                   size_t private_key_len,
+                   time_t issued_at)
 {
-   kms_request_t *req = NULL;
    kms_request_str_t *str = NULL;
-   time_t issued_at;
    /* base64 encoding of {"alg":"RS256","typ":"JWT"} */
    const char *jwt_header_b64url = "eyJhbGciOiJSUzI1NiIsInR5cCI6IkpXVCJ9";
    char *jwt_claims_b64url = NULL;
@@ -44,21 +93,9 @@ kms_gcp_request_oauth_new (const char *host,
    uint8_t *jwt_signature = NULL;
    char *jwt_signature_b64url = NULL;
    char *jwt_assertion_b64url = NULL;
-   char *payload = NULL;
-
-   req = kms_request_new ("POST", "/token", opt);
-   if (opt->provider != KMS_REQUEST_PROVIDER_GCP) {
-      KMS_ERROR (req, "Expected KMS request with provider type: GCP");
-      goto done;
-   }
-
-   if (kms_request_get_error (req)) {
-      goto done;
-   }
 
    /* Produce the signed JWT <base64url header>.<base64url claims>.<base64url
     * signature> */
-   issued_at = time (NULL);
    str = kms_request_str_new ();
    kms_request_str_appendf (str,
                             "{\"iss\": \"%s\", \"aud\": \"%s\", \"scope\": "
@@ -81,12 +118,6 @@ kms_gcp_request_oauth_new (const char *host,
    jwt_header_and_claims_b64url = kms_request_str_detach (str);
 
    /* Produce the signature of <base64url header>.<base64url claims> */
-   req->crypto.sign_rsaes_pkcs1_v1_5 = kms_sign_rsaes_pkcs1_v1_5;
-   if (opt->crypto.sign_rsaes_pkcs1_v1_5) {
-      req->crypto.sign_rsaes_pkcs1_v1_5 = opt->crypto.sign_rsaes_pkcs1_v1_5;
-      req->crypto.sign_ctx = opt->crypto.sign_ctx;
-   }
-
    jwt_signature = calloc (1, SIGNATURE_LEN);
    if (!req->crypto.sign_rsaes_pkcs1_v1_5 (
           req->crypto.sign_ctx,
@@ -113,6 +144,89 @@ kms_gcp_request_oauth_new (const char *host,
                             jwt_signature_b64url);
    jwt_assertion_b64url = kms_request_str_detach (str);
 
+done:
+   free (jwt_signature);
+   free (jwt_signature_b64url);
+   free (jwt_claims_b64url);
+   free (jwt_header_and_claims_b64url);
+   return jwt_assertion_b64url;
+}
+
+kms_request_t *
+kms_gcp_request_oauth_new (const char *host,
+                           const char *email,
+                           const char *audience,
+                           const char *scope,
+                           const char *private_key_data,
+                           size_t private_key_len,
+                           const kms_request_opt_t *opt)
+{
+   kms_request_t *req = NULL;
+   kms_request_str_t *str = NULL;
+   time_t now;
+   unsigned char inputs_hash[32];
+   kms_jwt_assertion_cache_t *cache = &jwt_assertion_cache;
+   char *jwt_assertion_b64url = NULL;
+   char *payload = NULL;
+   size_t assertion_len;
+
+   req = kms_request_new ("POST", "/token", opt);
+   if (opt->provider != KMS_REQUEST_PROVIDER_GCP) {
+      KMS_ERROR (req, "Expected KMS request with provider type: GCP");
+      goto done;
+   }
+
+   if (kms_request_get_error (req)) {
+      goto done;
+   }
+
+   req->crypto.sign_rsaes_pkcs1_v1_5 = kms_sign_rsaes_pkcs1_v1_5;
+   if (opt->crypto.sign_rsaes_pkcs1_v1_5) {
+      req->crypto.sign_rsaes_pkcs1_v1_5 = opt->crypto.sign_rsaes_pkcs1_v1_5;
+      req->crypto.sign_ctx = opt->crypto.sign_ctx;
+   }
+
+   if (!hash_jwt_inputs (req,
+                         host,
+                         email,
+                         audience,
+                         scope,
+                         private_key_data,
+                         private_key_len,
+                         inputs_hash)) {
+      KMS_ERROR (req, "Failed to hash GCP oauth request inputs");
+      goto done;
+   }
+
+   /* Signing is an RSA private key operation. Reuse the last assertion until
+    * it nears expiry. */
+   now = time (NULL);
+   if (cache->valid &&
+       0 == memcmp (cache->inputs_hash, inputs_hash, sizeof inputs_hash) &&
+       now >= cache->issued_at &&
+       now + JWT_REUSE_MARGIN_SECS < cache->expires_at) {
+      jwt_assertion_b64url = strdup (cache->assertion);
+   } else {
+      jwt_assertion_b64url = new_jwt_assertion (req,
+                                                email,
+                                                audience,
+                                                scope,
+                                                private_key_data,
+                                                private_key_len,
+                                                now);
+      if (!jwt_assertion_b64url) {
+         goto done;
+      }
+      assertion_len = strlen (jwt_assertion_b64url);
+      cache->valid = assertion_len < sizeof cache->assertion;
+      if (cache->valid) {
+         memcpy (cache->inputs_hash, inputs_hash, sizeof inputs_hash);
+         cache->issued_at = now;
+         cache->expires_at = now + JWT_EXPIRATION_SECS;
+         memcpy (cache->assertion, jwt_assertion_b64url, assertion_len + 1);
+      }
+   }
+
    str =
       kms_request_str_new_from_chars ("grant_type=urn%3Aietf%3Aparams%3Aoauth%"
                                       "3Agrant-type%3Ajwt-bearer&assertion=",
@@ -136,10 +250,6 @@ kms_gcp_request_oauth_new (const char *host,
    }
 
 done:
-   free (jwt_signature);
-   free (jwt_signature_b64url);
-   free (jwt_claims_b64url);
-   free (jwt_header_and_claims_b64url);
    free (jwt_assertion_b64url);
    free (payload);
    return req;
@@ -159,7 +269,6 @@ _encrypt_decrypt_common (const char *encrypt_decrypt,
                          const kms_request_opt_t *opt)
 {
    char *path_and_query = NULL;
-   char *payload = NULL;
    char *bearer_token_value = NULL;
    char *value_base64 = NULL;
    kms_request_t *req;
@@ -198,14 +307,6 @@ _encrypt_decrypt_common (const char *encrypt_decrypt,
       goto done;
    }
 
-   str = kms_request_str_new ();
-   if (0 == strcmp ("encrypt", encrypt_decrypt)) {
-      kms_request_str_appendf (str, "{\"plaintext\": \"%s\"}", value_base64);
-   } else {
-      kms_request_str_appendf (str, "{\"ciphertext\": \"%s\"}", value_base64);
-   }
-
-   payload = kms_request_str_detach (str);
    str = kms_request_str_new ();
    kms_request_str_appendf (str, "Bearer %s", access_token);
    bearer_token_value = kms_request_str_detach (str);
@@ -224,13 +325,20 @@ _encrypt_decrypt_common (const char *encrypt_decrypt,
       goto done;
    }
 
-   if (!kms_request_append_payload (req, payload, strlen (payload))) {
-      goto done;
-   }
+   /* Serialize the payload directly into the request. */
+   kms_request_str_reserve (req->payload,
+                            strlen (value_base64) +
+                               sizeof ("{\"ciphertext\": \"\"}"));
+   kms_request_str_append_chars (req->payload,
+                                 0 == strcmp ("encrypt", encrypt_decrypt)
+                                    ? "{\"plaintext\": \""
+                                    : "{\"ciphertext\": \"",
+                                 -1);
+   kms_request_str_append_chars (req->payload, value_base64, -1);
+   kms_request_str_append_chars (req->payload, "\"}", -1);
 
 done:
    kms_request_free_string (path_and_query);
-   kms_request_free_string (payload);
    kms_request_free_string (bearer_token_value);
    kms_request_free_string (value_base64);
    return req;
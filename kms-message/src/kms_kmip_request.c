@@ -200,9 +200,17 @@ kms_kmip_request_activate_new (void *reserved, const char *unique_identifer)
 
 kms_request_t *
 kms_kmip_request_get_new (void *reserved, const char *unique_identifer)
+{
+   return kms_kmip_request_get_batch_new (reserved, &unique_identifer, 1);
+}
+
+kms_request_t *
+kms_kmip_request_get_batch_new (void *reserved,
+                                const char *const *unique_identifiers,
+                                size_t count)
 {
    /*
-   Create a KMIP Get request of this form:
+   Create a KMIP Get request with one BatchItem per unique identifier:
    <RequestMessage tag="0x420078" type="Structure">
     <RequestHeader tag="0x420077" type="Structure">
      <ProtocolVersion tag="0x420069" type="Structure">
@@ -222,10 +230,19 @@ kms_kmip_request_get_new (void *reserved, const char *unique_identifer)
 
    kmip_writer_t *writer;
    kms_request_t *req;
+   size_t i;
 
    req = calloc (1, sizeof (kms_request_t));
    req->provider = KMS_REQUEST_PROVIDER_KMIP;
 
+   if (count == 0 || count > KMS_KMIP_REQUEST_MAX_BATCH_COUNT) {
+      KMS_ERROR (req,
+                 "expected between 1 and %d unique identifiers, got %zu",
+                 KMS_KMIP_REQUEST_MAX_BATCH_COUNT,
+                 count);
+      return req;
+   }
+
    writer = kmip_writer_new ();
    kmip_writer_begin_struct (writer, KMIP_TAG_RequestMessage);
 
@@ -234,20 +251,21 @@ kms_kmip_request_get_new (void *reserved, const char *unique_identifer)
    kmip_writer_write_integer (writer, KMIP_TAG_ProtocolVersionMajor, 1);
    kmip_writer_write_integer (writer, KMIP_TAG_ProtocolVersionMinor, 0);
    kmip_writer_close_struct (writer); /* KMIP_TAG_ProtocolVersion */
-   kmip_writer_write_integer (writer, KMIP_TAG_BatchCount, 1);
+   kmip_writer_write_integer (writer, KMIP_TAG_BatchCount, (int32_t) count);
    kmip_writer_close_struct (writer); /* KMIP_TAG_RequestHeader */
 
-   kmip_writer_begin_struct (writer, KMIP_TAG_BatchItem);
-   /* 0x0A == Get */
-   kmip_writer_write_enumeration (writer, KMIP_TAG_Operation, 0x0A);
-   kmip_writer_begin_struct (writer, KMIP_TAG_RequestPayload);
-   kmip_writer_write_string (writer,
-                             KMIP_TAG_UniqueIdentifier,
-                             unique_identifer,
-                             strlen (unique_identifer));
-   /* 0x01 = Raw */
-   kmip_writer_close_struct (writer); /* KMIP_TAG_RequestPayload */
-   kmip_writer_close_struct (writer); /* KMIP_TAG_BatchItem */
+   for (i = 0; i < count; i++) {
+      kmip_writer_begin_struct (writer, KMIP_TAG_BatchItem);
+      /* 0x0A == Get */
+      kmip_writer_write_enumeration (writer, KMIP_TAG_Operation, 0x0A);
+      kmip_writer_begin_struct (writer, KMIP_TAG_RequestPayload);
+      kmip_writer_write_string (writer,
+                                KMIP_TAG_UniqueIdentifier,
+                                unique_identifiers[i],
+                                strlen (unique_identifiers[i]));
+      kmip_writer_close_struct (writer); /* KMIP_TAG_RequestPayload */
+      kmip_writer_close_struct (writer); /* KMIP_TAG_BatchItem */
+   }
    kmip_writer_close_struct (writer); /* KMIP_TAG_RequestMessage */
 
    /* Copy the KMIP writer buffer to a KMIP request. */
@@ -42,7 +42,7 @@ value="ResultReasonItemNotFound"/>
 </ResponseMessage>
 */
 static bool
-kms_kmip_response_ok (kms_response_t *res)
+kms_kmip_response_item_ok (kms_response_t *res, size_t index)
 {
    kmip_reader_t *reader = NULL;
    size_t pos;
@@ -62,7 +62,7 @@ kms_kmip_response_ok (kms_response_t *res)
       goto fail;
    }
 
-   if (!kmip_reader_find_and_recurse (reader, KMIP_TAG_BatchItem)) {
+   if (!kmip_reader_find_nth_and_recurse (reader, KMIP_TAG_BatchItem, index)) {
       KMS_ERROR (res,
                  "unable to find tag: %s",
                  kmip_tag_to_string (KMIP_TAG_BatchItem));
@@ -113,6 +113,7 @@ kms_kmip_response_ok (kms_response_t *res)
    }
 
    if (result_status != KMIP_RESULT_STATUS_OperationSuccess) {
+      res->kmip.result_reason = result_reason;
       KMS_ERROR (res,
                  "KMIP response error. Result Status (%" PRIu32
                  "): %s. Result Reason (%" PRIu32 "): %s. Result Message: %.*s",
@@ -131,6 +132,55 @@ fail:
    return ok;
 }
 
+static bool
+kms_kmip_response_ok (kms_response_t *res)
+{
+   return kms_kmip_response_item_ok (res, 0);
+}
+
+size_t
+kms_kmip_response_get_batch_count (kms_response_t *res)
+{
+   kmip_reader_t *reader = NULL;
+   size_t pos;
+   size_t len;
+   size_t count = 0;
+
+   if (!check_and_require_kmip (res)) {
+      return 0;
+   }
+
+   reader = kmip_reader_new (res->kmip.data, res->kmip.len);
+   if (!kmip_reader_find_and_recurse (reader, KMIP_TAG_ResponseMessage)) {
+      KMS_ERROR (res,
+                 "unable to find tag: %s",
+                 kmip_tag_to_string (KMIP_TAG_ResponseMessage));
+      goto fail;
+   }
+
+   while (kmip_reader_find_nth (reader,
+                                KMIP_TAG_BatchItem,
+                                KMIP_ITEM_TYPE_Structure,
+                                count,
+                                &pos,
+                                &len)) {
+      count++;
+   }
+
+fail:
+   kmip_reader_destroy (reader);
+   return count;
+}
+
+uint32_t
+kms_kmip_response_get_result_reason (kms_response_t *res)
+{
+   if (res->provider != KMS_REQUEST_PROVIDER_KMIP) {
+      return 0;
+   }
+   return res->kmip.result_reason;
+}
+
 /*
 Example of a successful response to a Register request:
 <ResponseMessage tag="0x42007b" type="Structure">
@@ -404,6 +454,14 @@ Example of a successful response to a Get request:
 */
 uint8_t *
 kms_kmip_response_get_secretdata (kms_response_t *res, size_t *secretdatalen)
+{
+   return kms_kmip_response_get_secretdata_at (res, 0, secretdatalen);
+}
+
+uint8_t *
+kms_kmip_response_get_secretdata_at (kms_response_t *res,
+                                     size_t index,
+                                     size_t *secretdatalen)
 {
    kmip_reader_t *reader = NULL;
    size_t pos;
@@ -415,7 +473,7 @@ kms_kmip_response_get_secretdata (kms_response_t *res, size_t *secretdatalen)
       goto fail;
    }
 
-   if (!kms_kmip_response_ok (res)) {
+   if (!kms_kmip_response_item_ok (res, index)) {
       goto fail;
    }
 
@@ -428,7 +486,7 @@ kms_kmip_response_get_secretdata (kms_response_t *res, size_t *secretdatalen)
       goto fail;
    }
 
-   if (!kmip_reader_find_and_recurse (reader, KMIP_TAG_BatchItem)) {
+   if (!kmip_reader_find_nth_and_recurse (reader, KMIP_TAG_BatchItem, index)) {
       KMS_ERROR (res,
                  "unable to find tag: %s",
                  kmip_tag_to_string (KMIP_TAG_BatchItem));
@@ -51,6 +51,18 @@ kms_kmip_request_activate_new (void *reserved, const char *unique_identifier);
 KMS_MSG_EXPORT (kms_request_t *)
 kms_kmip_request_get_new (void *reserved, const char *unique_identifier);
 
+#define KMS_KMIP_REQUEST_MAX_BATCH_COUNT 64
+
+/* kms_kmip_request_get_batch_new creates a KMIP Get request with one BatchItem
+ * for each of the @count unique identifiers. The BatchItems in the response
+ * are in the same order.
+ * - count must be between 1 and KMS_KMIP_REQUEST_MAX_BATCH_COUNT.
+ * - Callers must check for an error by calling kms_request_get_error. */
+KMS_MSG_EXPORT (kms_request_t *)
+kms_kmip_request_get_batch_new (void *reserved,
+                                const char *const *unique_identifiers,
+                                size_t count);
+
 KMS_MSG_EXPORT (kms_request_t *)
 kms_kmip_request_create_new (void *reserved);
 
@@ -37,6 +37,27 @@ kms_kmip_response_get_unique_identifier (kms_response_t *res);
 KMS_MSG_EXPORT (uint8_t *)
 kms_kmip_response_get_secretdata (kms_response_t *res, size_t *secretdatalen);
 
+/* kms_kmip_response_get_batch_count returns the number of BatchItems in a
+ * ResponseMessage.
+ * - Returns 0 on error and sets an error on kms_response_t. */
+KMS_MSG_EXPORT (size_t)
+kms_kmip_response_get_batch_count (kms_response_t *res);
+
+/* kms_kmip_response_get_secretdata_at returns the KeyMaterial in the
+ * BatchItem at @index in a ResponseMessage.
+ * - Caller must free returned data.
+ * - Returns NULL on error and sets an error on kms_response_t. */
+KMS_MSG_EXPORT (uint8_t *)
+kms_kmip_response_get_secretdata_at (kms_response_t *res,
+                                     size_t index,
+                                     size_t *secretdatalen);
+
+/* kms_kmip_response_get_result_reason returns the Result Reason of the last
+ * BatchItem that was read and did not succeed.
+ * - Returns 0 if no failed BatchItem was read or it had no Result Reason. */
+KMS_MSG_EXPORT (uint32_t)
+kms_kmip_response_get_result_reason (kms_response_t *res);
+
 KMS_MSG_EXPORT (uint8_t *)
 kms_kmip_response_get_data (kms_response_t *res, size_t *datalen);
 
@@ -51,6 +51,10 @@ struct _kms_request_t {
    kms_request_str_t *payload;
    kms_kv_list_t *query_params;
    kms_kv_list_t *header_fields;
+   /* header_fields sorted by name, and without Connection. Built on first
+    * use and dropped when a header field changes. */
+   kms_kv_list_t *sorted_header_fields;
+   kms_kv_list_t *canonical_header_fields;
    /* turn off for tests only, not in public kms_request_opt_t API */
    bool auto_content_length;
    _kms_crypto_t crypto;
@@ -69,13 +73,17 @@ struct _kms_request_t {
    struct {
       uint8_t *data;
       uint32_t len;
+      /* The Result Reason of the last failed BatchItem, or 0. */
+      uint32_t result_reason;
    } kmip;
 };
 
 struct _kms_response_t {
    int status;
-   kms_kv_list_t *headers;
-   kms_request_str_t *body;
+   /* The raw HTTP response. body points into it. */
+   kms_request_str_t *raw;
+   const char *body;
+   size_t body_len;
 
    /* TODO (MONGOCRYPT-347): make a union for each KMS provider type. */
    char error[512];
@@ -84,6 +92,8 @@ struct _kms_response_t {
    struct {
       uint8_t *data;
       uint32_t len;
+      /* The Result Reason of the last failed BatchItem, or 0. */
+      uint32_t result_reason;
    } kmip;
 };
 
@@ -103,6 +113,10 @@ struct _kms_response_parser_t {
    kms_request_str_t *raw_response;
    int content_length;
    int start; /* start of the current thing getting parsed. */
+   /* The body is parsed in place: a chunked body is joined at the offset
+    * body_start of raw_response. */
+   int body_start;
+   int body_len;
 
    /* Support two types of HTTP 1.1 responses.
     * - "Content-Length: x" header is present, indicating the body length.
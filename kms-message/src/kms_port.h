@@ -31,4 +31,10 @@ kms_strndup (const char *src, size_t len);
 #define kms_strcasecmp strcasecmp
 #endif
 
+#if defined(_MSC_VER)
+#define KMS_THREAD_LOCAL __declspec(thread)
+#else
+#define KMS_THREAD_LOCAL __thread
+#endif
+
 #endif /* KMS_PORT_H */
@@ -64,6 +64,16 @@ check_and_prohibit_kmip (kms_request_t *req)
    return true;
 }
 
+/* header_fields_changed drops the sorted copies of the header fields. */
+static void
+header_fields_changed (kms_request_t *request)
+{
+   kms_kv_list_destroy (request->sorted_header_fields);
+   request->sorted_header_fields = NULL;
+   kms_kv_list_destroy (request->canonical_header_fields);
+   request->canonical_header_fields = NULL;
+}
+
 kms_request_t *
 kms_request_new (const char *method,
                  const char *path_and_query,
@@ -150,6 +160,8 @@ kms_request_destroy (kms_request_t *request)
    kms_request_str_destroy (request->date);
    kms_kv_list_destroy (request->query_params);
    kms_kv_list_destroy (request->header_fields);
+   kms_kv_list_destroy (request->sorted_header_fields);
+   kms_kv_list_destroy (request->canonical_header_fields);
    kms_request_str_destroy (request->to_string);
    free (request->kmip.data);
    free (request);
@@ -199,6 +211,7 @@ kms_request_set_date (kms_request_t *request, const struct tm *tm)
    kms_request_str_set_chars (request->date, buf, sizeof "YYYYmmDD" - 1);
    kms_request_str_set_chars (request->datetime, buf, sizeof AMZ_DT_FORMAT - 1);
    kms_kv_list_del (request->header_fields, "X-Amz-Date");
+   header_fields_changed (request);
    if (!kms_request_add_header_field (request, "X-Amz-Date", buf)) {
       return false;
    }
@@ -266,6 +279,7 @@ kms_request_add_header_field (kms_request_t *request,
    kms_kv_list_add (request->header_fields, k, v);
    kms_request_str_destroy (k);
    kms_request_str_destroy (v);
+   header_fields_changed (request);
 
    return true;
 }
@@ -293,6 +307,7 @@ kms_request_append_header_field_value (kms_request_t *request,
    v = request->header_fields->kvs[request->header_fields->len - 1].value;
    KMS_ASSERT (len <= SSIZE_MAX);
    kms_request_str_append_chars (v, value, (ssize_t) len);
+   header_fields_changed (request);
 
    return true;
 }
@@ -360,10 +375,10 @@ append_canonical_query (kms_request_t *request, kms_request_str_t *str)
 
 /* "lst" is a sorted list of headers */
 static void
-append_canonical_headers (kms_kv_list_t *lst, kms_request_str_t *str)
+append_canonical_headers (const kms_kv_list_t *lst, kms_request_str_t *str)
 {
    size_t i;
-   kms_kv_t *kv;
+   const kms_kv_t *kv;
    const kms_request_str_t *previous_key = NULL;
 
    /* aws docs: "To create the canonical headers list, convert all header names
@@ -394,11 +409,11 @@ append_canonical_headers (kms_kv_list_t *lst, kms_request_str_t *str)
 }
 
 static void
-append_signed_headers (kms_kv_list_t *lst, kms_request_str_t *str)
+append_signed_headers (const kms_kv_list_t *lst, kms_request_str_t *str)
 {
    size_t i;
 
-   kms_kv_t *kv;
+   const kms_kv_t *kv;
    const kms_request_str_t *previous_key = NULL;
 
    for (i = 0; i < lst->len; i++) {
@@ -468,6 +483,7 @@ finalize (kms_request_t *request)
       kms_request_str_destroy (v);
    }
 
+   header_fields_changed (request);
    return true;
 }
 
@@ -484,16 +500,48 @@ cmp_header_field_names (const void *a, const void *b)
                           ((kms_kv_t *) b)->key->str);
 }
 
-static kms_kv_list_t *
-canonical_headers (const kms_request_t *request)
+/* sorted_headers returns the header fields sorted by name. The list is owned
+ * by request, and sorted once until a header field changes. */
+static const kms_kv_list_t *
+sorted_headers (kms_request_t *request)
 {
-   kms_kv_list_t *lst;
-
    KMS_ASSERT (request->finalized);
-   lst = kms_kv_list_dup (request->header_fields);
-   kms_kv_list_sort (lst, cmp_header_field_names);
-   kms_kv_list_del (lst, "Connection");
-   return lst;
+   if (!request->sorted_header_fields) {
+      request->sorted_header_fields = kms_kv_list_dup (request->header_fields);
+      kms_kv_list_sort (request->sorted_header_fields, cmp_header_field_names);
+   }
+   return request->sorted_header_fields;
+}
+
+/* canonical_headers returns the sorted header fields to sign. The list is
+ * owned by request. */
+static const kms_kv_list_t *
+canonical_headers (kms_request_t *request)
+{
+   if (!request->canonical_header_fields) {
+      request->canonical_header_fields =
+         kms_kv_list_dup (sorted_headers (request));
+      kms_kv_list_del (request->canonical_header_fields, "Connection");
+   }
+   return request->canonical_header_fields;
+}
+
+/* serialized_len_hint returns the length of the request line, header fields,
+ * and body, to size the serialized request with one allocation. */
+static size_t
+serialized_len_hint (kms_request_t *request, const kms_kv_list_t *lst)
+{
+   size_t len;
+   size_t i;
+
+   /* "<method> <path>?<query> HTTP/1.1\r\n" and the final "\r\n". */
+   len = request->method->len + request->path->len + request->query->len +
+         sizeof (" ? HTTP/1.1\r\n\r\n");
+   for (i = 0; i < lst->len; i++) {
+      /* "<key>:<value>\r\n" */
+      len += lst->kvs[i].key->len + lst->kvs[i].value->len + 3;
+   }
+   return len + request->payload->len;
 }
 
 char *
@@ -501,7 +549,7 @@ kms_request_get_canonical (kms_request_t *request)
 {
    kms_request_str_t *canonical;
    kms_request_str_t *normalized;
-   kms_kv_list_t *lst;
+   const kms_kv_list_t *lst;
 
    if (request->failed) {
       return NULL;
@@ -528,7 +576,6 @@ kms_request_get_canonical (kms_request_t *request)
    append_canonical_headers (lst, canonical);
    kms_request_str_append_newline (canonical);
    append_signed_headers (lst, canonical);
-   kms_kv_list_destroy (lst);
    kms_request_str_append_newline (canonical);
    if (!kms_request_str_append_hashed (
           &request->crypto, canonical, request->payload)) {
@@ -637,6 +684,36 @@ kms_request_hmac_again (_kms_crypto_t *crypto,
       crypto->ctx, (const char *) in, 32, data->str, data->len, out);
 }
 
+/* The signing key derived for the last request signed on this thread. The
+ * secret key is only kept as a hash. */
+typedef struct {
+   bool valid;
+   unsigned char secret_hash[32];
+   char date[sizeof "YYYYmmDD"];
+   char region[64];
+   char service[32];
+   unsigned char key[32];
+} kms_signing_key_cache_t;
+
+static KMS_THREAD_LOCAL kms_signing_key_cache_t signing_key_cache;
+
+static bool
+copy_cache_field (char *dst, size_t dst_size, const kms_request_str_t *src)
+{
+   if (src->len >= dst_size) {
+      return false;
+   }
+   memcpy (dst, src->str, src->len);
+   dst[src->len] = '\0';
+   return true;
+}
+
+static bool
+cache_field_eq (const char *field, const kms_request_str_t *str)
+{
+   return strlen (field) == str->len && 0 == memcmp (field, str->str, str->len);
+}
+
 bool
 kms_request_get_signing_key (kms_request_t *request, unsigned char *key)
 {
@@ -646,6 +723,8 @@ kms_request_get_signing_key (kms_request_t *request, unsigned char *key)
    unsigned char k_date[32];
    unsigned char k_region[32];
    unsigned char k_service[32];
+   unsigned char secret_hash[32];
+   kms_signing_key_cache_t *cache = &signing_key_cache;
 
    if (request->failed) {
       return false;
@@ -667,6 +746,25 @@ kms_request_get_signing_key (kms_request_t *request, unsigned char *key)
    aws4_plus_secret = kms_request_str_new_from_chars ("AWS4", -1);
    kms_request_str_append (aws4_plus_secret, request->secret_key);
 
+   /* The signing key only depends on the secret, date, region, and service.
+    * Reuse it while those do not change. */
+   if (!request->crypto.sha256 (request->crypto.ctx,
+                                aws4_plus_secret->str,
+                                aws4_plus_secret->len,
+                                secret_hash)) {
+      goto done;
+   }
+
+   if (cache->valid &&
+       0 == memcmp (cache->secret_hash, secret_hash, sizeof secret_hash) &&
+       cache_field_eq (cache->date, request->date) &&
+       cache_field_eq (cache->region, request->region) &&
+       cache_field_eq (cache->service, request->service)) {
+      memcpy (key, cache->key, sizeof cache->key);
+      success = true;
+      goto done;
+   }
+
    aws4_request = kms_request_str_new_from_chars ("aws4_request", -1);
 
    if (!(kms_request_hmac (
@@ -680,6 +778,14 @@ kms_request_get_signing_key (kms_request_t *request, unsigned char *key)
       goto done;
    }
 
+   cache->valid =
+      copy_cache_field (cache->date, sizeof cache->date, request->date) &&
+      copy_cache_field (cache->region, sizeof cache->region, request->region) &&
+      copy_cache_field (
+         cache->service, sizeof cache->service, request->service);
+   memcpy (cache->secret_hash, secret_hash, sizeof secret_hash);
+   memcpy (cache->key, key, sizeof cache->key);
+
    success = true;
 done:
    kms_request_str_destroy (aws4_plus_secret);
@@ -692,7 +798,6 @@ char *
 kms_request_get_signature (kms_request_t *request)
 {
    bool success = false;
-   kms_kv_list_t *lst = NULL;
    kms_request_str_t *sig = NULL;
    kms_request_str_t *sts = NULL;
    unsigned char signing_key[32];
@@ -721,8 +826,7 @@ kms_request_get_signature (kms_request_t *request)
    kms_request_str_append_char (sig, '/');
    kms_request_str_append (sig, request->service);
    kms_request_str_append_chars (sig, "/aws4_request, SignedHeaders=", -1);
-   lst = canonical_headers (request);
-   append_signed_headers (lst, sig);
+   append_signed_headers (canonical_headers (request), sig);
    kms_request_str_append_chars (sig, ", Signature=", -1);
    if (!(kms_request_get_signing_key (request, signing_key) &&
          kms_request_hmac_again (
@@ -733,7 +837,6 @@ kms_request_get_signature (kms_request_t *request)
    kms_request_str_append_hex (sig, signature, sizeof (signature));
    success = true;
 done:
-   kms_kv_list_destroy (lst);
    kms_request_str_destroy (sts);
 
    if (!success) {
@@ -767,6 +870,11 @@ kms_request_validate (kms_request_t *request)
    }
 }
 
+/* Length of an Authorization header without the access key ID, like
+ * "Authorization: AWS4-HMAC-SHA256 Credential=<key>/20150830/us-east-1/kms/
+ * aws4_request, SignedHeaders=content-type;host;x-amz-date, Signature=<64>" */
+#define AUTHORIZATION_LEN_HINT 256
+
 /* append_http_endofline appends an HTTP end-of-line marker: "\r\n". */
 static void
 append_http_endofline (kms_request_str_t *str)
@@ -778,7 +886,7 @@ char *
 kms_request_get_signed (kms_request_t *request)
 {
    bool success = false;
-   kms_kv_list_t *lst = NULL;
+   const kms_kv_list_t *lst;
    char *signature = NULL;
    kms_request_str_t *sreq = NULL;
    size_t i;
@@ -796,7 +904,13 @@ kms_request_get_signed (kms_request_t *request)
       return NULL;
    }
 
+   lst = sorted_headers (request);
    sreq = kms_request_str_new ();
+   /* Reserve for the Authorization header too. */
+   kms_request_str_reserve (sreq,
+                            serialized_len_hint (request, lst) +
+                               AUTHORIZATION_LEN_HINT +
+                               request->access_key_id->len);
    /* like "POST / HTTP/1.1" */
    kms_request_str_append (sreq, request->method);
    kms_request_str_append_char (sreq, ' ');
@@ -810,8 +924,6 @@ kms_request_get_signed (kms_request_t *request)
    append_http_endofline (sreq);
 
    /* headers */
-   lst = kms_kv_list_dup (request->header_fields);
-   kms_kv_list_sort (lst, cmp_header_field_names);
    for (i = 0; i < lst->len; i++) {
       kms_request_str_append (sreq, lst->kvs[i].key);
       kms_request_str_append_char (sreq, ':');
@@ -839,7 +951,6 @@ kms_request_get_signed (kms_request_t *request)
    success = true;
 done:
    free (signature);
-   kms_kv_list_destroy (lst);
 
    if (!success) {
       kms_request_str_destroy (sreq);
@@ -852,7 +963,7 @@ done:
 char *
 kms_request_to_string (kms_request_t *request)
 {
-   kms_kv_list_t *lst = NULL;
+   const kms_kv_list_t *lst;
    kms_request_str_t *sreq = NULL;
    size_t i;
 
@@ -868,7 +979,9 @@ kms_request_to_string (kms_request_t *request)
       return kms_request_str_detach (kms_request_str_dup (request->to_string));
    }
 
+   lst = sorted_headers (request);
    sreq = kms_request_str_new ();
+   kms_request_str_reserve (sreq, serialized_len_hint (request, lst));
    /* like "POST / HTTP/1.1" */
    kms_request_str_append (sreq, request->method);
    kms_request_str_append_char (sreq, ' ');
@@ -882,8 +995,6 @@ kms_request_to_string (kms_request_t *request)
    append_http_endofline (sreq);
 
    /* headers */
-   lst = kms_kv_list_dup (request->header_fields);
-   kms_kv_list_sort (lst, cmp_header_field_names);
    for (i = 0; i < lst->len; i++) {
       kms_request_str_append (sreq, lst->kvs[i].key);
       kms_request_str_append_char (sreq, ':');
@@ -898,7 +1009,6 @@ kms_request_to_string (kms_request_t *request)
       kms_request_str_append (sreq, request->payload);
    }
 
-   kms_kv_list_destroy (lst);
    request->to_string = kms_request_str_dup (sreq);
    return kms_request_str_detach (sreq);
 }
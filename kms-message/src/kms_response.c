@@ -27,8 +27,7 @@ kms_response_destroy (kms_response_t *response)
    }
 
    free (response->kmip.data);
-   kms_kv_list_destroy (response->headers);
-   kms_request_str_destroy (response->body);
+   kms_request_str_destroy (response->raw);
    free (response);
 }
 
@@ -36,9 +35,9 @@ const char *
 kms_response_get_body (kms_response_t *response, size_t *len)
 {
    if (len) {
-      *len = response->body->len;
+      *len = response->body_len;
    }
-   return response->body->str;
+   return response->body;
 }
 
 int
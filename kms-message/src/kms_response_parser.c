@@ -29,9 +29,10 @@ _parser_init (kms_response_parser_t *parser)
    parser->content_length = -1;
    parser->response = calloc (1, sizeof (kms_response_t));
    KMS_ASSERT (parser->response);
-   parser->response->headers = kms_kv_list_new ();
    parser->state = PARSING_STATUS_LINE;
    parser->start = 0;
+   parser->body_start = 0;
+   parser->body_len = 0;
    parser->failed = false;
    parser->chunk_size = 0;
    parser->transfer_encoding_chunked = false;
@@ -107,17 +108,26 @@ _parse_int (const char *str, int *result)
 static bool
 _parse_int_from_view (const char *str, int start, int end, int *result)
 {
+   /* Large enough for any int32_t with sign. */
+   char num_str[16];
+
    KMS_ASSERT (end >= start);
-   char *num_str = malloc ((size_t) (end - start + 1));
-   KMS_ASSERT (num_str);
+   if ((size_t) (end - start) >= sizeof (num_str)) {
+      return false;
+   }
+   memcpy (num_str, str + start, (size_t) (end - start));
+   num_str[end - start] = '\0';
+   return _parse_int (num_str, result);
+}
 
-   bool ret;
+/* returns true if the substring [start, end) of str equals literal. */
+static bool
+_view_equals (const char *str, int start, int end, const char *literal)
+{
+   size_t len = strlen (literal);
 
-   strncpy (num_str, str + start, (size_t) (end - start));
-   num_str[end - start] = '\0';
-   ret = _parse_int (num_str, result);
-   free (num_str);
-   return ret;
+   return (size_t) (end - start) == len &&
+          0 == memcmp (str + start, literal, len);
 }
 
 static bool
@@ -179,14 +189,18 @@ _parse_line (kms_response_parser_t *parser, int end)
        * See https://tools.ietf.org/html/rfc822#section-3.1
        */
       int j;
-      kms_request_str_t *key;
-      kms_request_str_t *val;
+      int key_end;
 
       if (i == end) {
          /* empty line, this signals the start of the body. */
          if (parser->transfer_encoding_chunked) {
             return PARSING_CHUNK_LENGTH;
          }
+         if (parser->content_length > 0) {
+            /* Reserve the body now so appending it does not reallocate. */
+            kms_request_str_reserve (parser->raw_response,
+                                     (size_t) parser->content_length);
+         }
          return PARSING_BODY;
       }
 
@@ -200,7 +214,9 @@ _parse_line (kms_response_parser_t *parser, int end)
          return PARSING_DONE;
       }
 
-      key = kms_request_str_new_from_chars (raw + i, j - i);
+      /* The header is parsed in place. Only the headers that affect parsing
+       * are interpreted, the others are skipped. */
+      key_end = j;
 
       i = j + 1;
       /* remove leading and trailing whitespace from the value. */
@@ -210,43 +226,29 @@ _parse_line (kms_response_parser_t *parser, int end)
       }
       i = j;
 
-      /* find the end of the header by backtracking. */
       for (j = end; j > i; j--) {
-         if (!_is_lwsp (raw[j]))
+         if (!_is_lwsp (raw[j - 1]))
             break;
       }
 
-      if (i == j) {
-         val = kms_request_str_new ();
-      } else {
-         val = kms_request_str_new_from_chars (raw + i, j - i);
-      }
-
-      kms_kv_list_add (response->headers, key, val);
-
       /* if we have *not* read the Content-Length yet, check. */
       if (parser->content_length == -1 &&
-          strcmp (key->str, "Content-Length") == 0) {
-         if (!_parse_int (val->str, &parser->content_length)) {
+          _view_equals (raw, parser->start, key_end, "Content-Length")) {
+         if (!_parse_int_from_view (raw, i, j, &parser->content_length)) {
             KMS_ERROR (parser, "Could not parse Content-Length header.");
-            kms_request_str_destroy (key);
-            kms_request_str_destroy (val);
             return PARSING_DONE;
          }
       }
 
-      if (0 == strcmp (key->str, "Transfer-Encoding")) {
-         if (0 == strcmp (val->str, "chunked")) {
+      if (_view_equals (raw, parser->start, key_end, "Transfer-Encoding")) {
+         if (_view_equals (raw, i, j, "chunked")) {
             parser->transfer_encoding_chunked = true;
          } else {
-            KMS_ERROR (parser, "Unsupported Transfer-Encoding: %s", val->str);
-            kms_request_str_destroy (key);
-            kms_request_str_destroy (val);
+            KMS_ERROR (
+               parser, "Unsupported Transfer-Encoding: %.*s", j - i, raw + i);
             return PARSING_DONE;
          }
       }
-      kms_request_str_destroy (key);
-      kms_request_str_destroy (val);
       return PARSING_HEADER;
    } else if (parser->state == PARSING_CHUNK_LENGTH) {
       int result = 0;
@@ -268,6 +270,8 @@ kms_response_parser_feed (kms_response_parser_t *parser,
 {
    kms_request_str_t *raw = parser->raw_response;
    int curr, body_read, chunk_read;
+   const char *lf;
+   kms_response_parser_state_t prev_state;
 
    if (parser->kmip) {
       return kms_kmip_response_parser_feed (parser->kmip, buf, len);
@@ -281,16 +285,26 @@ kms_response_parser_feed (kms_response_parser_t *parser,
       case PARSING_STATUS_LINE:
       case PARSING_HEADER:
       case PARSING_CHUNK_LENGTH:
-         /* find the next \r\n. */
-         if (curr && strncmp (raw->str + (curr - 1), "\r\n", 2) == 0) {
+         /* find the next \r\n. The \r may have been fed in an earlier call. */
+         lf = memchr (raw->str + curr, '\n', raw->len - (size_t) curr);
+         if (!lf) {
+            curr = (int) raw->len;
+            break;
+         }
+         curr = (int) (lf - raw->str);
+         if (curr > parser->start && raw->str[curr - 1] == '\r') {
+            prev_state = parser->state;
             parser->state = _parse_line (parser, curr - 1);
             parser->start = curr + 1;
+            if (prev_state == PARSING_HEADER &&
+                parser->state != PARSING_HEADER) {
+               parser->body_start = parser->start;
+            }
          }
          curr++;
 
          if (parser->state == PARSING_BODY && parser->content_length <= 0) {
             /* Ok, no Content-Length header, or explicitly 0, so empty body */
-            parser->response->body = kms_request_str_new ();
             parser->state = PARSING_DONE;
          }
          break;
@@ -305,8 +319,7 @@ kms_response_parser_feed (kms_response_parser_t *parser,
 
          /* check if we have the entire body. */
          if (body_read == parser->content_length) {
-            parser->response->body = kms_request_str_new_from_chars (
-               raw->str + parser->start, parser->content_length);
+            parser->body_len = parser->content_length;
             parser->state = PARSING_DONE;
          }
 
@@ -316,12 +329,12 @@ kms_response_parser_feed (kms_response_parser_t *parser,
          chunk_read = (int) raw->len - parser->start;
          /* check if we've read the full chunk and the trailing \r\n */
          if (chunk_read >= parser->chunk_size + 2) {
-            if (!parser->response->body) {
-               parser->response->body = kms_request_str_new ();
-            }
-            kms_request_str_append_chars (parser->response->body,
-                                          raw->str + parser->start,
-                                          parser->chunk_size);
+            /* Join the chunk to the body in place. The body only ever grows
+             * into bytes that were already parsed. */
+            memmove (raw->str + parser->body_start + parser->body_len,
+                     raw->str + parser->start,
+                     (size_t) parser->chunk_size);
+            parser->body_len += parser->chunk_size;
             curr = parser->start + parser->chunk_size + 2;
             parser->start = curr;
             if (parser->chunk_size == 0) {
@@ -359,6 +372,14 @@ kms_response_parser_get_response (kms_response_parser_t *parser)
    }
 
    response = parser->response;
+   if (parser->state == PARSING_DONE && !parser->failed) {
+      /* Hand the raw response to the response, which views the body in it. */
+      response->raw = parser->raw_response;
+      parser->raw_response = NULL;
+      response->raw->str[parser->body_start + parser->body_len] = '\0';
+      response->body = response->raw->str + parser->body_start;
+      response->body_len = (size_t) parser->body_len;
+   }
 
    parser->response = NULL;
    /* reset the parser. */
@@ -0,0 +1,484 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * bench_kms_request measures the client side of each KMS exchange: building
+ * and signing AWS requests, building Azure, GCP, and KMIP requests, and parsing
+ * HTTP and KMIP responses.
+ *
+ * The GCP OAuth request is signed with a hook that does no RSA, so it measures
+ * building the JWT assertion, not the signature.
+ *
+ * Run from the kms-message directory, optionally passing a substring to select
+ * cases by name:
+ *
+ *   ./cmake-build/bench_kms_request [filter]
+ */
+
+#include "kms_message/kms_message.h"
+#include "kms_message/kms_azure_request.h"
+#include "kms_message/kms_gcp_request.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+/* Minimum time to measure each case, in nanoseconds. */
+#define BENCH_MIN_NSEC (100 * 1000 * 1000)
+
+#define CHECK(_expr)                                                 \
+   do {                                                              \
+      if (!(_expr)) {                                                \
+         fprintf (stderr,                                            \
+                  "%s:%d check failed: %s\n",                        \
+                  __FILE__,                                          \
+                  __LINE__,                                          \
+                  #_expr);                                           \
+         abort ();                                                   \
+      }                                                              \
+   } while (0)
+
+#define CHECK_REQUEST(_req)                                          \
+   do {                                                              \
+      CHECK (_req);                                                  \
+      if (kms_request_get_error (_req)) {                            \
+         fprintf (                                                   \
+            stderr, "request error: %s\n", kms_request_get_error (_req)); \
+         abort ();                                                   \
+      }                                                              \
+   } while (0)
+
+static int64_t
+now_nsec (void)
+{
+#ifdef _WIN32
+   LARGE_INTEGER freq, count;
+
+   QueryPerformanceFrequency (&freq);
+   QueryPerformanceCounter (&count);
+   return (int64_t) ((double) count.QuadPart * 1e9 / (double) freq.QuadPart);
+#else
+   struct timespec ts;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts);
+   return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+typedef void (*bench_fn) (void *arg);
+
+static const char *filter;
+
+static void
+run (const char *name, bench_fn fn, void *arg)
+{
+   int64_t iters;
+
+   if (filter && !strstr (name, filter)) {
+      return;
+   }
+
+   /* Warm up. */
+   fn (arg);
+
+   for (iters = 1;; iters *= 2) {
+      int64_t i;
+      const int64_t start = now_nsec ();
+      int64_t elapsed;
+
+      for (i = 0; i < iters; i++) {
+         fn (arg);
+      }
+      elapsed = now_nsec () - start;
+      if (elapsed >= BENCH_MIN_NSEC) {
+         printf ("%-40s %12.0f ns/op\n",
+                 name,
+                 (double) elapsed / (double) iters);
+         fflush (stdout);
+         return;
+      }
+   }
+}
+
+static const uint8_t ciphertext_blob[] = {
+   0x01, 0x02, 0x02, 0x00, 0x78, 0xf4, 0x2a, 0x5b, 0x9c, 0x1e, 0x2f, 0x47,
+   0x6c, 0x0e, 0x20, 0x61, 0x3e, 0x8e, 0x4c, 0x9d, 0x26, 0x84, 0x19, 0x11,
+   0x8e, 0x69, 0x2a, 0xd6, 0x55, 0x3a, 0xfd, 0x82, 0x60, 0x33, 0xfa, 0x2f,
+   0x1a, 0x01, 0x69, 0x65, 0x07, 0x11, 0x21, 0x1c, 0xfd, 0x9d, 0x6c, 0x30,
+   0x4b, 0xcb, 0x7f, 0x8b, 0x88, 0x1f, 0x62, 0x10, 0x00, 0x00, 0x00, 0x7e,
+   0x30, 0x7c, 0x06, 0x09, 0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x07,
+   0x06, 0xa0, 0x6f, 0x30, 0x6d, 0x02, 0x01, 0x00, 0x30, 0x68, 0x06, 0x09,
+   0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x07, 0x01, 0x30, 0x1e, 0x06};
+
+/* A KMIP Get response with 96 bytes of SecretData. */
+static const uint8_t kmip_get_response[] = {
+   0x42, 0x00, 0x7b, 0x01, 0x00, 0x00, 0x01, 0x40, 0x42, 0x00, 0x7a, 0x01, 0x00,
+   0x00, 0x00, 0x48, 0x42, 0x00, 0x69, 0x01, 0x00, 0x00, 0x00, 0x20, 0x42, 0x00,
+   0x6a, 0x02, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+   0x00, 0x42, 0x00, 0x6b, 0x02, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x04,
+   0x00, 0x00, 0x00, 0x00, 0x42, 0x00, 0x92, 0x09, 0x00, 0x00, 0x00, 0x08, 0x00,
+   0x00, 0x00, 0x00, 0x61, 0x65, 0x97, 0x15, 0x42, 0x00, 0x0d, 0x02, 0x00, 0x00,
+   0x00, 0x04, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x42, 0x00, 0x0f,
+   0x01, 0x00, 0x00, 0x00, 0xe8, 0x42, 0x00, 0x5c, 0x05, 0x00, 0x00, 0x00, 0x04,
+   0x00, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x00, 0x42, 0x00, 0x7f, 0x05, 0x00,
+   0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x42, 0x00,
+   0x7c, 0x01, 0x00, 0x00, 0x00, 0xc0, 0x42, 0x00, 0x57, 0x05, 0x00, 0x00, 0x00,
+   0x04, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x42, 0x00, 0x94, 0x07,
+   0x00, 0x00, 0x00, 0x02, 0x33, 0x39, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x42,
+   0x00, 0x85, 0x01, 0x00, 0x00, 0x00, 0x98, 0x42, 0x00, 0x86, 0x05, 0x00, 0x00,
+   0x00, 0x04, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x42, 0x00, 0x40,
+   0x01, 0x00, 0x00, 0x00, 0x80, 0x42, 0x00, 0x42, 0x05, 0x00, 0x00, 0x00, 0x04,
+   0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x42, 0x00, 0x45, 0x01, 0x00,
+   0x00, 0x00, 0x68, 0x42, 0x00, 0x43, 0x08, 0x00, 0x00, 0x00, 0x60, 0xff, 0xa8,
+   0xcc, 0x79, 0xe8, 0xc3, 0x76, 0x3b, 0x01, 0x21, 0xfc, 0xd0, 0x6b, 0xb3, 0x48,
+   0x8c, 0x8b, 0xf4, 0x2c, 0x07, 0x74, 0x60, 0x46, 0x40, 0x27, 0x9b, 0x16, 0xb2,
+   0x64, 0x19, 0x40, 0x30, 0xee, 0xb0, 0x83, 0x96, 0x24, 0x1d, 0xef, 0xcc, 0x4d,
+   0x32, 0xd1, 0x6e, 0xa8, 0x31, 0xad, 0x77, 0x71, 0x38, 0xf0, 0x8e, 0x2f, 0x98,
+   0x56, 0x64, 0xc0, 0x04, 0xc2, 0x48, 0x5d, 0x6f, 0x49, 0x91, 0xeb, 0x3d, 0x9e,
+   0xc3, 0x28, 0x02, 0x53, 0x78, 0x36, 0xa9, 0x06, 0x6b, 0x4e, 0x10, 0xae, 0xb5,
+   0x6a, 0x5c, 0xcf, 0x6a, 0xa4, 0x69, 0x01, 0xe6, 0x25, 0xe3, 0x40, 0x0c, 0x78,
+   0x11, 0xd2, 0xec};
+
+static kms_request_t *
+new_aws_decrypt_request (void)
+{
+   kms_request_t *req;
+   struct tm tm = {0};
+
+   req = kms_decrypt_request_new (
+      ciphertext_blob, sizeof (ciphertext_blob), NULL);
+   CHECK_REQUEST (req);
+
+   /* 20150830T123600Z */
+   tm.tm_year = 115;
+   tm.tm_mon = 7;
+   tm.tm_mday = 30;
+   tm.tm_hour = 12;
+   tm.tm_min = 36;
+   CHECK (kms_request_set_date (req, &tm));
+   CHECK (kms_request_set_region (req, "us-east-1"));
+   CHECK (kms_request_set_service (req, "kms"));
+   CHECK (kms_request_set_access_key_id (req, "AKIDEXAMPLE"));
+   CHECK (kms_request_set_secret_key (
+      req, "wJalrXUtnFEMI/K7MDENG+bPxRfiCYEXAMPLEKEY"));
+   return req;
+}
+
+static void
+bench_aws_decrypt_request_new (void *arg)
+{
+   (void) arg;
+   kms_request_destroy (new_aws_decrypt_request ());
+}
+
+static void
+bench_aws_get_signed (void *arg)
+{
+   kms_request_t *req = new_aws_decrypt_request ();
+   char *signed_req;
+
+   (void) arg;
+   signed_req = kms_request_get_signed (req);
+   CHECK_REQUEST (req);
+   CHECK (signed_req);
+   kms_request_free_string (signed_req);
+   kms_request_destroy (req);
+}
+
+typedef struct {
+   uint8_t *data;
+   uint32_t len;
+   bool kmip;
+} response_case_t;
+
+static void
+bench_response_parse (void *arg)
+{
+   response_case_t *rc = arg;
+   kms_response_parser_t *parser;
+   kms_response_t *res;
+   uint32_t offset = 0;
+   int want;
+
+   parser = rc->kmip ? kms_kmip_response_parser_new (NULL)
+                     : kms_response_parser_new ();
+   while ((want = kms_response_parser_wants_bytes (parser, 1024)) > 0) {
+      /* The HTTP parser may want more than remains while reading headers. */
+      uint32_t len = rc->len - offset;
+
+      if ((uint32_t) want < len) {
+         len = (uint32_t) want;
+      }
+
+      CHECK (len > 0);
+      CHECK (kms_response_parser_feed (parser, rc->data + offset, len));
+      offset += len;
+   }
+   res = kms_response_parser_get_response (parser);
+   CHECK (res);
+   if (rc->kmip) {
+      size_t secretdata_len;
+      uint8_t *secretdata =
+         kms_kmip_response_get_secretdata (res, &secretdata_len);
+
+      CHECK (secretdata);
+      free (secretdata);
+   }
+   kms_response_destroy (res);
+   kms_response_parser_destroy (parser);
+}
+
+static void
+bench_kmip_get_request_new (void *arg)
+{
+   kms_request_t *req;
+   size_t len;
+
+   (void) arg;
+   req = kms_kmip_request_get_new (NULL, "7FJYvnV6XkaUCWuY96bCSc6AuhvkPpqI");
+   CHECK_REQUEST (req);
+   CHECK (kms_request_to_bytes (req, &len));
+   kms_request_destroy (req);
+}
+
+static void
+bench_kmip_decrypt_request_new (void *arg)
+{
+   kms_request_t *req;
+   size_t len;
+
+   (void) arg;
+   req = kms_kmip_request_decrypt_new (NULL,
+                                       "7FJYvnV6XkaUCWuY96bCSc6AuhvkPpqI",
+                                       ciphertext_blob,
+                                       sizeof (ciphertext_blob),
+                                       ciphertext_blob,
+                                       16);
+   CHECK_REQUEST (req);
+   CHECK (kms_request_to_bytes (req, &len));
+   kms_request_destroy (req);
+}
+
+static void
+finish_request (kms_request_t *req, kms_request_opt_t *opt)
+{
+   char *str;
+
+   CHECK_REQUEST (req);
+   str = kms_request_to_string (req);
+   CHECK_REQUEST (req);
+   CHECK (str);
+   kms_request_free_string (str);
+   kms_request_destroy (req);
+   kms_request_opt_destroy (opt);
+}
+
+static kms_request_opt_t *
+new_opt (kms_request_provider_t provider)
+{
+   kms_request_opt_t *opt = kms_request_opt_new ();
+
+   CHECK (kms_request_opt_set_provider (opt, provider));
+   return opt;
+}
+
+static void
+bench_azure_oauth_new (void *arg)
+{
+   kms_request_opt_t *opt = new_opt (KMS_REQUEST_PROVIDER_AZURE);
+
+   (void) arg;
+   finish_request (
+      kms_azure_request_oauth_new ("login.microsoftonline.com",
+                                   "https%3A%2F%2Fvault.azure.net%2F.default",
+                                   "example-tenant-id",
+                                   "example-client-id",
+                                   "example-client-secret",
+                                   opt),
+      opt);
+}
+
+static void
+bench_azure_wrapkey_new (void *arg)
+{
+   kms_request_opt_t *opt = new_opt (KMS_REQUEST_PROVIDER_AZURE);
+
+   (void) arg;
+   finish_request (kms_azure_request_wrapkey_new ("example-host",
+                                                  "example-access-token",
+                                                  "example-key-name",
+                                                  "example-key-version",
+                                                  ciphertext_blob,
+                                                  96,
+                                                  opt),
+                   opt);
+}
+
+static void
+bench_azure_unwrapkey_new (void *arg)
+{
+   kms_request_opt_t *opt = new_opt (KMS_REQUEST_PROVIDER_AZURE);
+
+   (void) arg;
+   finish_request (kms_azure_request_unwrapkey_new ("example-host",
+                                                    "example-access-token",
+                                                    "example-key-name",
+                                                    "example-key-version",
+                                                    ciphertext_blob,
+                                                    sizeof (ciphertext_blob),
+                                                    opt),
+                   opt);
+}
+
+static bool
+sign_rsaes_noop (void *sign_ctx,
+                 const char *private_key,
+                 size_t private_key_len,
+                 const char *input,
+                 size_t input_len,
+                 unsigned char *signature_out)
+{
+   (void) sign_ctx;
+   (void) private_key;
+   (void) private_key_len;
+   (void) input;
+   (void) input_len;
+   memset (signature_out, 0xAB, 256);
+   return true;
+}
+
+static void
+bench_gcp_oauth_new (void *arg)
+{
+   kms_request_opt_t *opt = new_opt (KMS_REQUEST_PROVIDER_GCP);
+
+   (void) arg;
+   kms_request_opt_set_crypto_hook_sign_rsaes_pkcs1_v1_5 (
+      opt, sign_rsaes_noop, NULL);
+   finish_request (
+      kms_gcp_request_oauth_new ("oauth2.googleapis.com",
+                                 "test@example.com",
+                                 "https://oauth2.googleapis.com/token",
+                                 "https://www.googleapis.com/auth/cloudkms",
+                                 "private-key",
+                                 sizeof "private-key" - 1,
+                                 opt),
+      opt);
+}
+
+static void
+bench_gcp_encrypt_new (void *arg)
+{
+   kms_request_opt_t *opt = new_opt (KMS_REQUEST_PROVIDER_GCP);
+
+   (void) arg;
+   finish_request (kms_gcp_request_encrypt_new ("cloudkms.googleapis.com",
+                                                "example-access-token",
+                                                "example-project",
+                                                "global",
+                                                "example-key-ring",
+                                                "example-key",
+                                                NULL,
+                                                ciphertext_blob,
+                                                96,
+                                                opt),
+                   opt);
+}
+
+static void
+bench_gcp_decrypt_new (void *arg)
+{
+   kms_request_opt_t *opt = new_opt (KMS_REQUEST_PROVIDER_GCP);
+
+   (void) arg;
+   finish_request (kms_gcp_request_decrypt_new ("cloudkms.googleapis.com",
+                                                "example-access-token",
+                                                "example-project",
+                                                "global",
+                                                "example-key-ring",
+                                                "example-key",
+                                                ciphertext_blob,
+                                                sizeof (ciphertext_blob),
+                                                opt),
+                   opt);
+}
+
+static uint8_t *
+read_file (const char *path, uint32_t *len)
+{
+   FILE *f = fopen (path, "rb");
+   uint8_t *data;
+   long size;
+
+   if (!f) {
+      fprintf (stderr,
+               "could not open %s (run from the kms-message directory)\n",
+               path);
+      abort ();
+   }
+   CHECK (0 == fseek (f, 0, SEEK_END));
+   size = ftell (f);
+   CHECK (size > 0);
+   CHECK (0 == fseek (f, 0, SEEK_SET));
+   data = malloc ((size_t) size);
+   CHECK (data);
+   CHECK (fread (data, 1, (size_t) size, f) == (size_t) size);
+   fclose (f);
+   *len = (uint32_t) size;
+   return data;
+}
+
+int
+main (int argc, char **argv)
+{
+   response_case_t http = {0}, chunked = {0}, kmip = {0};
+
+   if (argc > 2) {
+      fprintf (stderr, "usage: %s [filter]\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+   filter = argc == 2 ? argv[1] : NULL;
+
+   http.data = read_file ("test/example-response.bin", &http.len);
+   chunked.data =
+      read_file ("test/example-multi-chunked-response.bin", &chunked.len);
+   kmip.data = (uint8_t *) kmip_get_response;
+   kmip.len = sizeof (kmip_get_response);
+   kmip.kmip = true;
+
+   run ("aws/decrypt_request_new", bench_aws_decrypt_request_new, NULL);
+   run ("aws/get_signed", bench_aws_get_signed, NULL);
+   run ("http/response_parse", bench_response_parse, &http);
+   run ("http/response_parse_chunked", bench_response_parse, &chunked);
+   run ("kmip/get_request_new", bench_kmip_get_request_new, NULL);
+   run ("kmip/decrypt_request_new", bench_kmip_decrypt_request_new, NULL);
+   run ("kmip/response_parse", bench_response_parse, &kmip);
+   run ("azure/oauth_new", bench_azure_oauth_new, NULL);
+   run ("azure/wrapkey_new", bench_azure_wrapkey_new, NULL);
+   run ("azure/unwrapkey_new", bench_azure_unwrapkey_new, NULL);
+   run ("gcp/oauth_new", bench_gcp_oauth_new, NULL);
+   run ("gcp/encrypt_new", bench_gcp_encrypt_new, NULL);
+   run ("gcp/decrypt_new", bench_gcp_decrypt_new, NULL);
+
+   free (chunked.data);
+   free (http.data);
+   return EXIT_SUCCESS;
+}
@@ -1,6 +1,7 @@
 #include "test_kms_assert.h"
 
 #include "kms_message/kms_kmip_request.h"
+#include "kms_kmip_reader_writer_private.h"
 
 /*
 <RequestMessage tag="0x420078" type="Structure">
@@ -167,6 +168,62 @@ kms_kmip_request_get_test (void)
    kms_request_destroy (req);
 }
 
+void
+kms_kmip_request_get_batch_test (void)
+{
+   kms_request_t *req;
+   const uint8_t *bytes;
+   size_t len;
+   static const char *const uids[] = {"1", "22"};
+   kmip_reader_t *reader;
+   size_t pos;
+   size_t item_len;
+   int32_t batch_count;
+   uint8_t *uid;
+
+   req = kms_kmip_request_get_batch_new (NULL, uids, 2);
+   ASSERT_REQUEST_OK (req);
+   bytes = kms_request_to_bytes (req, &len);
+   ASSERT (bytes != NULL);
+
+   reader = kmip_reader_new ((uint8_t *) bytes, len);
+   ASSERT (kmip_reader_find_and_recurse (reader, KMIP_TAG_RequestMessage));
+   ASSERT (kmip_reader_find_and_recurse (reader, KMIP_TAG_RequestHeader));
+   ASSERT (kmip_reader_find (reader,
+                             KMIP_TAG_BatchCount,
+                             KMIP_ITEM_TYPE_Integer,
+                             &pos,
+                             &item_len));
+   ASSERT (kmip_reader_read_integer (reader, &batch_count));
+   ASSERT_CMPINT (batch_count, ==, 2);
+   kmip_reader_destroy (reader);
+
+   /* The second BatchItem requests the second unique identifier. */
+   reader = kmip_reader_new ((uint8_t *) bytes, len);
+   ASSERT (kmip_reader_find_and_recurse (reader, KMIP_TAG_RequestMessage));
+   ASSERT (kmip_reader_find_nth_and_recurse (reader, KMIP_TAG_BatchItem, 1));
+   ASSERT (!kmip_reader_find_nth (reader,
+                                  KMIP_TAG_BatchItem,
+                                  KMIP_ITEM_TYPE_Structure,
+                                  2,
+                                  &pos,
+                                  &item_len));
+   ASSERT (kmip_reader_find_and_recurse (reader, KMIP_TAG_RequestPayload));
+   ASSERT (kmip_reader_find (reader,
+                             KMIP_TAG_UniqueIdentifier,
+                             KMIP_ITEM_TYPE_TextString,
+                             &pos,
+                             &item_len));
+   ASSERT (kmip_reader_read_string (reader, &uid, item_len));
+   ASSERT_CMPSTR_WITH_LEN ("22", 2, (const char *) uid, item_len);
+   kmip_reader_destroy (reader);
+   kms_request_destroy (req);
+
+   req = kms_kmip_request_get_batch_new (NULL, uids, 0);
+   ASSERT_REQUEST_ERROR (req, "expected between 1 and");
+   kms_request_destroy (req);
+}
+
 
 /*
 <RequestMessage tag="0x420078" type="Structure">
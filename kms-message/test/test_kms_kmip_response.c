@@ -19,6 +19,7 @@
 
 #include "kms_message/kms_kmip_response.h"
 #include "kms_message_private.h"
+#include "kms_kmip_reader_writer_private.h"
 
 
 /*
@@ -208,7 +209,63 @@ kms_kmip_response_get_secretdata_notfound_test (void)
    res.kmip.data = (uint8_t *) ERROR_GET_RESPOSE_NOTFOUND;
    res.kmip.len = sizeof (ERROR_GET_RESPOSE_NOTFOUND);
 
+   ASSERT (0 == kms_kmip_response_get_result_reason (&res));
    secretdata = kms_kmip_response_get_secretdata (&res, &secretdata_len);
    ASSERT_RESPONSE_ERROR (&res, "ResultReasonItemNotFound");
    ASSERT (NULL == secretdata);
+   /* ResultReasonItemNotFound is 1. */
+   ASSERT (1 == kms_kmip_response_get_result_reason (&res));
+}
+
+void
+kms_kmip_response_get_secretdata_batch_test (void)
+{
+   kmip_writer_t *writer;
+   kms_response_t res = {0};
+   const uint8_t *buf;
+   size_t buflen;
+   uint8_t *secretdata;
+   size_t secretdata_len;
+
+   /* Write a response with a successful Get and a failed Get. */
+   writer = kmip_writer_new ();
+   kmip_writer_begin_struct (writer, KMIP_TAG_ResponseMessage);
+   kmip_writer_begin_struct (writer, KMIP_TAG_ResponseHeader);
+   kmip_writer_write_integer (writer, KMIP_TAG_BatchCount, 2);
+   kmip_writer_close_struct (writer); /* KMIP_TAG_ResponseHeader */
+   kmip_writer_begin_struct (writer, KMIP_TAG_BatchItem);
+   kmip_writer_write_enumeration (writer, KMIP_TAG_Operation, 0x0A);
+   kmip_writer_write_enumeration (writer, KMIP_TAG_ResultStatus, 0);
+   kmip_writer_begin_struct (writer, KMIP_TAG_ResponsePayload);
+   kmip_writer_begin_struct (writer, KMIP_TAG_SecretData);
+   kmip_writer_begin_struct (writer, KMIP_TAG_KeyBlock);
+   kmip_writer_begin_struct (writer, KMIP_TAG_KeyValue);
+   kmip_writer_write_bytes (writer, KMIP_TAG_KeyMaterial, "abc", 3);
+   kmip_writer_close_struct (writer); /* KMIP_TAG_KeyValue */
+   kmip_writer_close_struct (writer); /* KMIP_TAG_KeyBlock */
+   kmip_writer_close_struct (writer); /* KMIP_TAG_SecretData */
+   kmip_writer_close_struct (writer); /* KMIP_TAG_ResponsePayload */
+   kmip_writer_close_struct (writer); /* KMIP_TAG_BatchItem */
+   kmip_writer_begin_struct (writer, KMIP_TAG_BatchItem);
+   kmip_writer_write_enumeration (writer, KMIP_TAG_Operation, 0x0A);
+   kmip_writer_write_enumeration (writer, KMIP_TAG_ResultStatus, 1);
+   kmip_writer_write_enumeration (writer, KMIP_TAG_ResultReason, 1);
+   kmip_writer_close_struct (writer); /* KMIP_TAG_BatchItem */
+   kmip_writer_close_struct (writer); /* KMIP_TAG_ResponseMessage */
+   buf = kmip_writer_get_buffer (writer, &buflen);
+
+   res.provider = KMS_REQUEST_PROVIDER_KMIP;
+   res.kmip.data = (uint8_t *) buf;
+   res.kmip.len = (uint32_t) buflen;
+
+   ASSERT_CMPINT ((int) kms_kmip_response_get_batch_count (&res), ==, 2);
+   secretdata = kms_kmip_response_get_secretdata_at (&res, 0, &secretdata_len);
+   ASSERT_RESPONSE_OK (&res);
+   ASSERT_CMPBYTES ((const uint8_t *) "abc", 3, secretdata, secretdata_len);
+   free (secretdata);
+
+   secretdata = kms_kmip_response_get_secretdata_at (&res, 1, &secretdata_len);
+   ASSERT_RESPONSE_ERROR (&res, "Item Not Found");
+   ASSERT (NULL == secretdata);
+   kmip_writer_destroy (writer);
 }
@@ -33,6 +33,7 @@
 #include <sys/stat.h>
 #include <time.h>
 #include "kms_message/kms_azure_request.h"
+#include "kms_message/kms_gcp_request.h"
 #include "kms_message/kms_b64.h"
 #include "hexlify.h"
 #include "kms_request_str.h"
@@ -708,6 +709,47 @@ b64_test (void)
    r = kms_message_b64_pton (encoded, data, 5); /* +1 for terminator */
    KMS_ASSERT (r == 4);
    KMS_ASSERT (0 == memcmp (expected, data, 4));
+
+   /* No room for the terminator. */
+   r = kms_message_b64_ntop (expected, 4, encoded, 8);
+   KMS_ASSERT (r == -1);
+}
+
+void
+b64_lengths_test (void)
+{
+   const char *expected[] = {
+      "", "AA==", "AAE=", "AAEC", "AAECAw==", "AAECAwQ=", "AAECAwQF"};
+   uint8_t raw[6] = {0, 1, 2, 3, 4, 5};
+   char encoded[9];
+   uint8_t decoded[7];
+   size_t len;
+   int r;
+
+   for (len = 0; len <= sizeof (raw); len++) {
+      r = kms_message_b64_ntop (raw, len, encoded, sizeof (encoded));
+      KMS_ASSERT (r == (int) strlen (expected[len]));
+      ASSERT_CMPSTR (encoded, expected[len]);
+      r = kms_message_b64_ntop (raw, len, encoded, strlen (expected[len]));
+      KMS_ASSERT (r == -1);
+      r = kms_message_b64_pton (expected[len], decoded, sizeof (decoded));
+      KMS_ASSERT (r == (int) len);
+      KMS_ASSERT (0 == memcmp (raw, decoded, len));
+   }
+}
+
+void
+hexlify_test (void)
+{
+   char *hex;
+
+   hex = hexlify ((const uint8_t *) "\x00\x01\x7f\x80\xab\xff", 6);
+   ASSERT_CMPSTR (hex, "00017f80abff");
+   free (hex);
+
+   hex = hexlify ((const uint8_t *) "", 0);
+   ASSERT_CMPSTR (hex, "");
+   free (hex);
 }
 
 void
@@ -759,7 +801,7 @@ kms_response_parser_test (void)
    ASSERT (0 == kms_response_parser_wants_bytes (parser, 123));
    response = kms_response_parser_get_response (parser);
    ASSERT (response->status == 200)
-   ASSERT_CMPSTR (response->body->str, "This is a test.");
+   ASSERT_CMPSTR (kms_response_get_body (response, NULL), "This is a test.");
 
    kms_response_destroy (response);
    kms_response_parser_destroy (parser);
@@ -871,6 +913,26 @@ kms_response_parser_test (void)
    ASSERT (strstr (kms_response_parser_error (parser),
                    "Unexpected: exceeded content length"));
    kms_response_parser_destroy (parser);
+
+   /* A line may end in a later feed, and header values may have trailing
+    * whitespace. */
+   parser = kms_response_parser_new ();
+   ASSERT (
+      kms_response_parser_feed (parser, (uint8_t *) "HTTP/1.1 200 OK\r", 16));
+   ASSERT (kms_response_parser_feed (parser, (uint8_t *) "\n", 1));
+   ASSERT (kms_response_parser_status (parser) == 200);
+   ASSERT (kms_response_parser_feed (
+      parser, (uint8_t *) "Content-Length: 4 \r\n\r", 21));
+   ASSERT (kms_response_parser_feed (parser, (uint8_t *) "\nabcd", 5));
+   ASSERT (0 == kms_response_parser_wants_bytes (parser, 123));
+   response = kms_response_parser_get_response (parser);
+   {
+      size_t body_len;
+      ASSERT_CMPSTR (kms_response_get_body (response, &body_len), "abcd");
+      ASSERT (body_len == 4);
+   }
+   kms_response_destroy (response);
+   kms_response_parser_destroy (parser);
 }
 
 typedef struct {
@@ -912,7 +974,8 @@ parser_testcase_run (parser_testcase_t *testcase)
 
    ASSERT (0 == kms_response_parser_wants_bytes (parser, 123));
    response = kms_response_parser_get_response (parser);
-   ASSERT_CMPSTR (testcase->expected_body, response->body->str);
+   ASSERT_CMPSTR (testcase->expected_body,
+                  kms_response_get_body (response, NULL));
    ASSERT (response->status == testcase->expected_status);
 
    kms_response_parser_destroy (parser);
@@ -1194,6 +1257,168 @@ test_request_newlines (void)
    }
 }
 
+static bool
+count_sha256_hmac (void *ctx,
+                   const char *key_input,
+                   size_t key_len,
+                   const char *input,
+                   size_t len,
+                   unsigned char *hash_out)
+{
+   (*(int *) ctx)++;
+   return kms_sha256_hmac (NULL, key_input, key_len, input, len, hash_out);
+}
+
+static bool
+wrap_sha256 (void *ctx,
+             const char *input,
+             size_t len,
+             unsigned char *hash_out)
+{
+   return kms_sha256 (NULL, input, len, hash_out);
+}
+
+static kms_request_t *
+new_signing_key_request (int *hmac_calls, const char *region)
+{
+   kms_request_opt_t *opt;
+   kms_request_t *req;
+
+   opt = kms_request_opt_new ();
+   kms_request_opt_set_crypto_hooks (
+      opt, wrap_sha256, count_sha256_hmac, hmac_calls);
+   req = kms_request_new ("POST", "/", opt);
+   set_test_date (req);
+   ASSERT (kms_request_set_region (req, region));
+   ASSERT (kms_request_set_service (req, "kms"));
+   ASSERT (kms_request_set_secret_key (req, "example-secret-key"));
+   kms_request_opt_destroy (opt);
+   return req;
+}
+
+/* Test that the derived signing key is reused for the same secret key, date,
+ * region, and service. */
+static void
+test_signing_key_cache (void)
+{
+   kms_request_t *req;
+   int hmac_calls = 0;
+   unsigned char first[32];
+   unsigned char key[32];
+
+   req = new_signing_key_request (&hmac_calls, "signing-key-cache-region");
+   ASSERT (kms_request_get_signing_key (req, first));
+   ASSERT_CMPINT (hmac_calls, ==, 4);
+   kms_request_destroy (req);
+
+   req = new_signing_key_request (&hmac_calls, "signing-key-cache-region");
+   ASSERT (kms_request_get_signing_key (req, key));
+   ASSERT_CMPINT (hmac_calls, ==, 4);
+   ASSERT (0 == memcmp (first, key, sizeof key));
+   kms_request_destroy (req);
+
+   /* A different region derives a new key. */
+   req = new_signing_key_request (&hmac_calls, "signing-key-cache-other");
+   ASSERT (kms_request_get_signing_key (req, key));
+   ASSERT_CMPINT (hmac_calls, ==, 8);
+   ASSERT (0 != memcmp (first, key, sizeof key));
+   kms_request_destroy (req);
+}
+
+/* Test that the cached canonical headers pick up headers added after a
+ * canonical request was built. */
+static void
+test_canonical_headers_cache (void)
+{
+   kms_request_t *request;
+   char *canonical;
+
+   request = kms_request_new ("GET", "/", NULL);
+   set_test_date (request);
+   ASSERT (kms_request_add_header_field (request, "Host", "example.com"));
+
+   canonical = kms_request_get_canonical (request);
+   ASSERT_REQUEST_OK (request);
+   ASSERT (!strstr (canonical, "x-added"));
+   free (canonical);
+
+   ASSERT (kms_request_add_header_field (request, "X-Added", "value"));
+   canonical = kms_request_get_canonical (request);
+   ASSERT_REQUEST_OK (request);
+   ASSERT (strstr (canonical, "x-added:value\n"));
+   ASSERT (strstr (canonical, "host;x-added;x-amz-date"));
+   free (canonical);
+
+   kms_request_destroy (request);
+}
+
+static bool
+count_sign_rsaes (void *sign_ctx,
+                  const char *private_key,
+                  size_t private_key_len,
+                  const char *input,
+                  size_t input_len,
+                  unsigned char *signature_out)
+{
+   (void) private_key;
+   (void) private_key_len;
+   (void) input;
+   (void) input_len;
+   ++*(int *) sign_ctx;
+   memset (signature_out, 0xAB, 256);
+   return true;
+}
+
+static char *
+new_gcp_oauth_payload (int *sign_calls, const char *scope)
+{
+   kms_request_opt_t *opt;
+   kms_request_t *req;
+   char *payload;
+
+   opt = kms_request_opt_new ();
+   ASSERT (kms_request_opt_set_provider (opt, KMS_REQUEST_PROVIDER_GCP));
+   kms_request_opt_set_crypto_hook_sign_rsaes_pkcs1_v1_5 (
+      opt, count_sign_rsaes, sign_calls);
+   req = kms_gcp_request_oauth_new ("oauth2.googleapis.com",
+                                    "test@example.com",
+                                    "https://oauth2.googleapis.com/token",
+                                    scope,
+                                    "private-key",
+                                    sizeof "private-key" - 1,
+                                    opt);
+   ASSERT_REQUEST_OK (req);
+   payload = kms_request_to_string (req);
+   kms_request_destroy (req);
+   kms_request_opt_destroy (opt);
+   return payload;
+}
+
+/* Test that a signed JWT assertion is reused for the same service account,
+ * audience, scope, host, and private key. */
+static void
+test_gcp_jwt_assertion_cache (void)
+{
+   int sign_calls = 0;
+   char *first;
+   char *payload;
+
+   first = new_gcp_oauth_payload (&sign_calls, "jwt-cache-scope");
+   ASSERT_CMPINT (sign_calls, ==, 1);
+
+   payload = new_gcp_oauth_payload (&sign_calls, "jwt-cache-scope");
+   ASSERT_CMPINT (sign_calls, ==, 1);
+   ASSERT_CMPSTR (first, payload);
+   free (payload);
+
+   /* A different scope signs a new assertion. */
+   payload = new_gcp_oauth_payload (&sign_calls, "jwt-cache-other");
+   ASSERT_CMPINT (sign_calls, ==, 2);
+   ASSERT (0 != strcmp (first, payload));
+   free (payload);
+   free (first);
+}
+
 #define RUN_TEST(_func)                                          \
    do {                                                          \
       if (!selector || 0 == kms_strcasecmp (#_func, selector)) { \
@@ -1213,11 +1438,13 @@ extern void kms_kmip_reader_find_and_read_bytes_test (void);
 extern void kms_kmip_request_register_secretdata_test (void);
 extern void kms_kmip_request_register_secretdata_invalid_test (void);
 extern void kms_kmip_request_get_test (void);
+extern void kms_kmip_request_get_batch_test (void);
 extern void kms_kmip_request_activate_test (void);
 extern void kms_kmip_response_parser_test (void);
 extern void kms_kmip_response_get_unique_identifier_test (void);
 extern void kms_kmip_response_get_secretdata_test (void);
 extern void kms_kmip_response_get_secretdata_notfound_test (void);
+extern void kms_kmip_response_get_secretdata_batch_test (void);
 extern void kms_kmip_response_parser_reuse_test (void);
 extern void kms_kmip_response_parser_excess_test (void);
 extern void kms_kmip_response_parser_notenough_test (void);
@@ -1257,6 +1484,8 @@ main (int argc, char *argv[])
    RUN_TEST (encrypt_request_test);
    RUN_TEST (kv_list_del_test);
    RUN_TEST (b64_test);
+   RUN_TEST (b64_lengths_test);
+   RUN_TEST (hexlify_test);
    RUN_TEST (b64_b64url_test);
 
    ran_tests |= all_aws_sig_v4_tests (aws_test_suite_dir, selector);
@@ -1277,16 +1506,21 @@ main (int argc, char *argv[])
    RUN_TEST (kms_kmip_request_register_secretdata_test);
    RUN_TEST (kms_kmip_request_register_secretdata_invalid_test);
    RUN_TEST (kms_kmip_request_get_test);
+   RUN_TEST (kms_kmip_request_get_batch_test);
    RUN_TEST (kms_kmip_request_activate_test);
    RUN_TEST (kms_request_kmip_prohibited_test);
    RUN_TEST (kms_kmip_response_parser_test);
    RUN_TEST (kms_kmip_response_get_unique_identifier_test);
    RUN_TEST (kms_kmip_response_get_secretdata_test);
    RUN_TEST (kms_kmip_response_get_secretdata_notfound_test);
+   RUN_TEST (kms_kmip_response_get_secretdata_batch_test);
    RUN_TEST (kms_kmip_response_parser_reuse_test);
    RUN_TEST (kms_kmip_response_parser_excess_test);
    RUN_TEST (kms_kmip_response_parser_notenough_test);
    RUN_TEST (test_request_newlines);
+   RUN_TEST (test_signing_key_cache);
+   RUN_TEST (test_canonical_headers_cache);
+   RUN_TEST (test_gcp_jwt_assertion_cache);
    RUN_TEST (test_kms_util);
 
 
@@ -15,6 +15,7 @@
  */
 
 #include "../mongocrypt-crypto-private.h"
+#include "../mongocrypt-mutex-private.h"
 #include "../mongocrypt-private.h"
 #include <stdint.h>
 
@@ -26,19 +27,106 @@ static BCRYPT_ALG_HANDLE _algo_sha512_hmac = 0;
 static BCRYPT_ALG_HANDLE _algo_sha256_hmac = 0;
 static BCRYPT_ALG_HANDLE _algo_aes256_cbc = 0;
 static BCRYPT_ALG_HANDLE _algo_aes256_ecb = 0;
-static DWORD _aes256_key_blob_length;
 static DWORD _aes256_block_length;
 
 static BCRYPT_ALG_HANDLE _random;
 
 #define STATUS_SUCCESS 0
 
+/* Maximum number of idle objects kept in each pool. */
+#define CNG_POOL_MAX 64
+/* Keys longer than this are not pooled. */
+#define CNG_POOL_KEY_MAX 64
+
+typedef struct {
+    /* A BCRYPT_KEY_HANDLE or BCRYPT_HASH_HANDLE. */
+    BCRYPT_HANDLE handle;
+    /* The algorithm and key @handle was created with. */
+    BCRYPT_ALG_HANDLE algorithm;
+    uint8_t key[CNG_POOL_KEY_MAX];
+    uint32_t key_len;
+} _cng_pool_entry_t;
+
+/* A pool of idle key or hash objects. Importing a key or creating an HMAC hash
+ * object costs more than encrypting or hashing a small value. The same keys
+ * are used repeatedly (e.g. the halves of a data key), so objects are pooled
+ * by algorithm and key and used by one operation at a time. */
+typedef struct {
+    mongocrypt_mutex_t mutex;
+    _cng_pool_entry_t entries[CNG_POOL_MAX];
+    size_t len;
+} _cng_pool_t;
+
+static _cng_pool_t _key_pool;
+static _cng_pool_t _hash_pool;
+
+/* Returns an idle object of @pool created with @algorithm and @key, or NULL. */
+static BCRYPT_HANDLE _cng_pool_pop(_cng_pool_t *pool, BCRYPT_ALG_HANDLE algorithm, const _mongocrypt_buffer_t *key) {
+    BCRYPT_HANDLE handle = NULL;
+
+    BSON_ASSERT_PARAM(pool);
+    BSON_ASSERT_PARAM(key);
+
+    if (key->len > CNG_POOL_KEY_MAX) {
+        return NULL;
+    }
+
+    _mongocrypt_mutex_lock(&pool->mutex);
+    for (size_t i = pool->len; i > 0; i--) {
+        _cng_pool_entry_t *entry = &pool->entries[i - 1];
+
+        if (entry->algorithm == algorithm && entry->key_len == key->len
+            && 0 == memcmp(entry->key, key->data, key->len)) {
+            handle = entry->handle;
+            *entry = pool->entries[pool->len - 1];
+            SecureZeroMemory(&pool->entries[pool->len - 1], sizeof(_cng_pool_entry_t));
+            pool->len--;
+            break;
+        }
+    }
+    _mongocrypt_mutex_unlock(&pool->mutex);
+    return handle;
+}
+
+/* Returns @handle, created with @algorithm and @key, to @pool. Returns false if
+ * it is not pooled and must be destroyed by the caller. */
+static bool
+_cng_pool_push(_cng_pool_t *pool, BCRYPT_ALG_HANDLE algorithm, const _mongocrypt_buffer_t *key, BCRYPT_HANDLE handle) {
+    bool pushed = false;
+
+    BSON_ASSERT_PARAM(pool);
+    BSON_ASSERT_PARAM(key);
+
+    if (key->len > CNG_POOL_KEY_MAX) {
+        return false;
+    }
+
+    _mongocrypt_mutex_lock(&pool->mutex);
+    if (pool->len < CNG_POOL_MAX) {
+        _cng_pool_entry_t *entry = &pool->entries[pool->len++];
+
+        entry->handle = handle;
+        entry->algorithm = algorithm;
+        memcpy(entry->key, key->data, key->len);
+        entry->key_len = key->len;
+        pushed = true;
+    }
+    _mongocrypt_mutex_unlock(&pool->mutex);
+    return pushed;
+}
+
 bool _native_crypto_initialized = false;
 
 void _native_crypto_init(void) {
     DWORD cbOutput;
     NTSTATUS nt_status;
 
+    /* Note, there is no mechanism for libmongocrypt to destroy the pooled
+     * objects. If we ever add such a mechanism, call BCryptDestroyKey and
+     * BCryptDestroyHash. */
+    _mongocrypt_mutex_init(&_key_pool.mutex);
+    _mongocrypt_mutex_init(&_hash_pool.mutex);
+
     /* Note, there is no mechanism for libmongocrypt to close these providers,
      * If we ever add such a mechanism, call BCryptCloseAlgorithmProvider.
      */
@@ -86,17 +174,6 @@ void _native_crypto_init(void) {
         return;
     }
 
-    cbOutput = sizeof(_aes256_key_blob_length);
-    nt_status = BCryptGetProperty(_algo_aes256_cbc,
-                                  BCRYPT_OBJECT_LENGTH,
-                                  (PUCHAR)(&_aes256_key_blob_length),
-                                  cbOutput,
-                                  &cbOutput,
-                                  0);
-    if (nt_status != STATUS_SUCCESS) {
-        return;
-    }
-
     cbOutput = sizeof(_aes256_block_length);
     nt_status = BCryptGetProperty(_algo_aes256_cbc,
                                   BCRYPT_BLOCK_LENGTH,
@@ -116,44 +193,32 @@ void _native_crypto_init(void) {
     _native_crypto_initialized = true;
 }
 
-typedef struct {
-    unsigned char *key_object;
-    uint32_t key_object_length;
-
-    BCRYPT_KEY_HANDLE key_handle;
-
-    unsigned char *iv;
-    uint32_t iv_len;
-} cng_encrypt_state;
-
-static void _crypto_state_destroy(cng_encrypt_state *state);
-
-static cng_encrypt_state *
-_crypto_state_init(const _mongocrypt_buffer_t *key, const _mongocrypt_buffer_t *iv, mongocrypt_status_t *status) {
-    cng_encrypt_state *state;
+/* _key_acquire sets @out to a key for @algorithm imported from @key, reusing
+ * a pooled key if there is one. Returns false and sets @status on error. */
+static bool _key_acquire(BCRYPT_ALG_HANDLE algorithm,
+                         const _mongocrypt_buffer_t *key,
+                         BCRYPT_KEY_HANDLE *out,
+                         mongocrypt_status_t *status) {
     uint32_t keyBlobLength;
     unsigned char *keyBlob;
     BCRYPT_KEY_DATA_BLOB_HEADER blobHeader;
     NTSTATUS nt_status;
 
     BSON_ASSERT_PARAM(key);
-    BSON_ASSERT_PARAM(iv);
-
-    keyBlob = NULL;
-
-    state = bson_malloc0(sizeof(*state));
-    BSON_ASSERT(state);
-
-    state->key_handle = INVALID_HANDLE_VALUE;
+    BSON_ASSERT_PARAM(out);
 
-    /* Initialize key storage buffer */
-    state->key_object = bson_malloc0(_aes256_key_blob_length);
-    BSON_ASSERT(state->key_object);
+    *out = _cng_pool_pop(&_key_pool, algorithm, key);
+    if (*out) {
+        return true;
+    }
 
-    state->key_object_length = _aes256_key_blob_length;
+    if (UINT32_MAX - key->len < sizeof(BCRYPT_KEY_DATA_BLOB_HEADER)) {
+        *out = INVALID_HANDLE_VALUE;
+        CLIENT_ERR("key is too long");
+        return false;
+    }
 
     /* Allocate temporary buffer for key import */
-    BSON_ASSERT(sizeof(BCRYPT_KEY_DATA_BLOB_HEADER) + key->len <= UINT32_MAX);
     keyBlobLength = sizeof(BCRYPT_KEY_DATA_BLOB_HEADER) + key->len;
     keyBlob = bson_malloc0(keyBlobLength);
     BSON_ASSERT(keyBlob);
@@ -166,21 +231,53 @@ _crypto_state_init(const _mongocrypt_buffer_t *key, const _mongocrypt_buffer_t *
 
     memcpy(keyBlob + sizeof(BCRYPT_KEY_DATA_BLOB_HEADER), key->data, key->len);
 
-    nt_status = BCryptImportKey(_algo_aes256_cbc,
-                                NULL,
-                                BCRYPT_KEY_DATA_BLOB,
-                                &(state->key_handle),
-                                state->key_object,
-                                state->key_object_length,
-                                keyBlob,
-                                keyBlobLength,
-                                0);
+    /* The key object is allocated by CNG and freed by BCryptDestroyKey. */
+    nt_status = BCryptImportKey(algorithm, NULL, BCRYPT_KEY_DATA_BLOB, out, NULL, 0, keyBlob, keyBlobLength, 0);
+    SecureZeroMemory(keyBlob, keyBlobLength);
+    bson_free(keyBlob);
     if (nt_status != STATUS_SUCCESS) {
+        *out = INVALID_HANDLE_VALUE;
         CLIENT_ERR("Import Key Failed: 0x%x", (int)nt_status);
-        goto fail;
+        return false;
     }
+    return true;
+}
 
-    bson_free(keyBlob);
+/* _key_release returns @handle, imported from @key for @algorithm, to the key
+ * pool. Keys hold no state between operations, so they can always be reused. */
+static void _key_release(BCRYPT_ALG_HANDLE algorithm, const _mongocrypt_buffer_t *key, BCRYPT_KEY_HANDLE handle) {
+    if (handle == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    if (!_cng_pool_push(&_key_pool, algorithm, key, handle)) {
+        BCryptDestroyKey(handle);
+    }
+}
+
+typedef struct {
+    const _mongocrypt_buffer_t *key;
+    BCRYPT_KEY_HANDLE key_handle;
+
+    unsigned char *iv;
+    uint32_t iv_len;
+} cng_encrypt_state;
+
+static void _crypto_state_destroy(cng_encrypt_state *state);
+
+static cng_encrypt_state *
+_crypto_state_init(const _mongocrypt_buffer_t *key, const _mongocrypt_buffer_t *iv, mongocrypt_status_t *status) {
+    cng_encrypt_state *state;
+
+    BSON_ASSERT_PARAM(key);
+    BSON_ASSERT_PARAM(iv);
+
+    state = bson_malloc0(sizeof(*state));
+    BSON_ASSERT(state);
+
+    state->key = key;
+    if (!_key_acquire(_algo_aes256_cbc, key, &state->key_handle, status)) {
+        goto fail;
+    }
 
     state->iv = bson_malloc0(iv->len);
     BSON_ASSERT(state->iv);
@@ -191,19 +288,13 @@ _crypto_state_init(const _mongocrypt_buffer_t *key, const _mongocrypt_buffer_t *
     return state;
 fail:
     _crypto_state_destroy(state);
-    bson_free(keyBlob);
 
     return NULL;
 }
 
 static void _crypto_state_destroy(cng_encrypt_state *state) {
     if (state) {
-        /* Free the key handle before the key_object that contains it */
-        if (state->key_handle != INVALID_HANDLE_VALUE) {
-            BCryptDestroyKey(state->key_handle);
-        }
-
-        bson_free(state->key_object);
+        _key_release(_algo_aes256_cbc, state->key, state->key_handle);
         bson_free(state->iv);
         bson_free(state);
     }
@@ -277,8 +368,8 @@ done:
     return ret;
 }
 
-/* _hmac_with_algorithm computes an HMAC of @in with the algorithm specified by
- * @hAlgorithm.
+/* _hmac_with_algorithm computes an HMAC of the concatenation of the @in_count
+ * buffers in @in with the algorithm specified by @hAlgorithm.
  * @key is the input key.
  * @out is the output. @out must be allocated by the caller with
  * the expected length @expect_out_len for the output.
@@ -286,10 +377,12 @@ done:
 static bool _hmac_with_algorithm(BCRYPT_ALG_HANDLE hAlgorithm,
                                  const _mongocrypt_buffer_t *key,
                                  const _mongocrypt_buffer_t *in,
+                                 uint32_t in_count,
                                  _mongocrypt_buffer_t *out,
                                  uint32_t expect_out_len,
                                  mongocrypt_status_t *status) {
     bool ret = false;
+    bool reusable = true;
     BCRYPT_HASH_HANDLE hHash;
     NTSTATUS nt_status;
 
@@ -302,17 +395,33 @@ static bool _hmac_with_algorithm(BCRYPT_ALG_HANDLE hAlgorithm,
         return false;
     }
 
-    nt_status = BCryptCreateHash(hAlgorithm, &hHash, NULL, 0, (PUCHAR)key->data, (ULONG)key->len, 0);
-    if (nt_status != STATUS_SUCCESS) {
-        CLIENT_ERR("error initializing hmac: 0x%x", (int)nt_status);
-        /* Only call BCryptDestroyHash if BCryptCreateHash succeeded. */
-        return false;
+    hHash = _cng_pool_pop(&_hash_pool, hAlgorithm, key);
+    if (!hHash) {
+        nt_status = BCryptCreateHash(hAlgorithm,
+                                     &hHash,
+                                     NULL,
+                                     0,
+                                     (PUCHAR)key->data,
+                                     (ULONG)key->len,
+                                     BCRYPT_HASH_REUSABLE_FLAG);
+        if (nt_status != STATUS_SUCCESS) {
+            /* Reusable hash objects need Windows 8+. */
+            reusable = false;
+            nt_status = BCryptCreateHash(hAlgorithm, &hHash, NULL, 0, (PUCHAR)key->data, (ULONG)key->len, 0);
+        }
+        if (nt_status != STATUS_SUCCESS) {
+            CLIENT_ERR("error initializing hmac: 0x%x", (int)nt_status);
+            /* Only call BCryptDestroyHash if BCryptCreateHash succeeded. */
+            return false;
+        }
     }
 
-    nt_status = BCryptHashData(hHash, (PUCHAR)in->data, (ULONG)in->len, 0);
-    if (nt_status != STATUS_SUCCESS) {
-        CLIENT_ERR("error hashing data: 0x%x", (int)nt_status);
-        goto done;
+    for (uint32_t i = 0; i < in_count; i++) {
+        nt_status = BCryptHashData(hHash, (PUCHAR)in[i].data, (ULONG)in[i].len, 0);
+        if (nt_status != STATUS_SUCCESS) {
+            CLIENT_ERR("error hashing data: 0x%x", (int)nt_status);
+            goto done;
+        }
     }
 
     nt_status = BCryptFinishHash(hHash, out->data, out->len, 0);
@@ -323,7 +432,11 @@ static bool _hmac_with_algorithm(BCRYPT_ALG_HANDLE hAlgorithm,
 
     ret = true;
 done:
-    (void)BCryptDestroyHash(hHash);
+    /* BCryptFinishHash resets a reusable hash object to the state after the
+     * key was set. */
+    if (!ret || !reusable || !_cng_pool_push(&_hash_pool, hAlgorithm, key, hHash)) {
+        (void)BCryptDestroyHash(hHash);
+    }
     return ret;
 }
 
@@ -331,7 +444,15 @@ bool _native_crypto_hmac_sha_512(const _mongocrypt_buffer_t *key,
                                  const _mongocrypt_buffer_t *in,
                                  _mongocrypt_buffer_t *out,
                                  mongocrypt_status_t *status) {
-    return _hmac_with_algorithm(_algo_sha512_hmac, key, in, out, MONGOCRYPT_HMAC_SHA512_LEN, status);
+    return _hmac_with_algorithm(_algo_sha512_hmac, key, in, 1, out, MONGOCRYPT_HMAC_SHA512_LEN, status);
+}
+
+bool _native_crypto_hmac_sha_512_parts(const _mongocrypt_buffer_t *key,
+                                       const _mongocrypt_buffer_t *in,
+                                       uint32_t in_count,
+                                       _mongocrypt_buffer_t *out,
+                                       mongocrypt_status_t *status) {
+    return _hmac_with_algorithm(_algo_sha512_hmac, key, in, in_count, out, MONGOCRYPT_HMAC_SHA512_LEN, status);
 }
 
 bool _native_crypto_random(_mongocrypt_buffer_t *out, uint32_t count, mongocrypt_status_t *status) {
@@ -347,6 +468,7 @@ bool _native_crypto_random(_mongocrypt_buffer_t *out, uint32_t count, mongocrypt
 }
 
 typedef struct {
+    const _mongocrypt_buffer_t *key;
     BCRYPT_KEY_HANDLE key_handle;
 
     unsigned char *input_block;
@@ -417,24 +539,14 @@ static cng_ctr_encrypt_state *_cng_ctr_crypto_state_init(const _mongocrypt_buffe
                                                          const _mongocrypt_buffer_t *iv,
                                                          mongocrypt_status_t *status) {
     cng_ctr_encrypt_state *state;
-    uint32_t keyBlobLength;
-    unsigned char *keyBlob;
-    BCRYPT_KEY_DATA_BLOB_HEADER blobHeader;
-    NTSTATUS nt_status;
 
     BSON_ASSERT_PARAM(key);
     BSON_ASSERT_PARAM(iv);
 
-    keyBlob = NULL;
-
     state = bson_malloc0(sizeof(*state));
     BSON_ASSERT(state);
 
-    if (UINT32_MAX - key->len < sizeof(BCRYPT_KEY_DATA_BLOB_HEADER)) {
-        CLIENT_ERR("key is too long");
-        goto fail;
-    }
-
+    state->key = key;
     state->key_handle = INVALID_HANDLE_VALUE;
 
     /* Initialize input storage buffer */
@@ -450,35 +562,10 @@ static cng_ctr_encrypt_state *_cng_ctr_crypto_state_init(const _mongocrypt_buffe
     state->output_block_len = _aes256_block_length;
     state->output_block_ptr = 0;
 
-    /* Allocate temporary buffer for key import */
-    keyBlobLength = sizeof(BCRYPT_KEY_DATA_BLOB_HEADER) + key->len;
-    keyBlob = bson_malloc0(keyBlobLength);
-    BSON_ASSERT(keyBlob);
-
-    blobHeader.dwMagic = BCRYPT_KEY_DATA_BLOB_MAGIC;
-    blobHeader.dwVersion = BCRYPT_KEY_DATA_BLOB_VERSION1;
-    blobHeader.cbKeyData = key->len;
-
-    memcpy(keyBlob, &blobHeader, sizeof(BCRYPT_KEY_DATA_BLOB_HEADER));
-
-    memcpy(keyBlob + sizeof(BCRYPT_KEY_DATA_BLOB_HEADER), key->data, key->len);
-
-    nt_status = BCryptImportKey(_algo_aes256_ecb,
-                                NULL,
-                                BCRYPT_KEY_DATA_BLOB,
-                                &(state->key_handle),
-                                NULL,
-                                0,
-                                keyBlob,
-                                keyBlobLength,
-                                0);
-    if (nt_status != STATUS_SUCCESS) {
-        CLIENT_ERR("Import Key Failed: 0x%x", (int)nt_status);
+    if (!_key_acquire(_algo_aes256_ecb, key, &state->key_handle, status)) {
         goto fail;
     }
 
-    bson_free(keyBlob);
-
     if (!_cng_ctr_crypto_generate(state, status)) {
         goto fail;
     }
@@ -486,16 +573,13 @@ static cng_ctr_encrypt_state *_cng_ctr_crypto_state_init(const _mongocrypt_buffe
     return state;
 fail:
     _cng_ctr_crypto_state_destroy(state);
-    bson_free(keyBlob);
 
     return NULL;
 }
 
 static void _cng_ctr_crypto_state_destroy(cng_ctr_encrypt_state *state) {
     if (state) {
-        if (state->key_handle != INVALID_HANDLE_VALUE) {
-            BCryptDestroyKey(state->key_handle);
-        }
+        _key_release(_algo_aes256_ecb, state->key, state->key_handle);
 
         bson_free(state->input_block);
         bson_free(state->output_block);
@@ -579,7 +663,15 @@ bool _native_crypto_hmac_sha_256(const _mongocrypt_buffer_t *key,
                                  const _mongocrypt_buffer_t *in,
                                  _mongocrypt_buffer_t *out,
                                  mongocrypt_status_t *status) {
-    return _hmac_with_algorithm(_algo_sha256_hmac, key, in, out, MONGOCRYPT_HMAC_SHA256_LEN, status);
+    return _hmac_with_algorithm(_algo_sha256_hmac, key, in, 1, out, MONGOCRYPT_HMAC_SHA256_LEN, status);
+}
+
+bool _native_crypto_hmac_sha_256_parts(const _mongocrypt_buffer_t *key,
+                                       const _mongocrypt_buffer_t *in,
+                                       uint32_t in_count,
+                                       _mongocrypt_buffer_t *out,
+                                       mongocrypt_status_t *status) {
+    return _hmac_with_algorithm(_algo_sha256_hmac, key, in, in_count, out, MONGOCRYPT_HMAC_SHA256_LEN, status);
 }
 
 #endif /* MONGOCRYPT_ENABLE_CRYPTO_CNG */
@@ -15,6 +15,7 @@
  */
 
 #include "../mongocrypt-crypto-private.h"
+#include "../mongocrypt-mutex-private.h"
 #include "../mongocrypt-private.h"
 
 #ifdef MONGOCRYPT_ENABLE_CRYPTO_COMMON_CRYPTO
@@ -42,12 +43,128 @@ static const char *CCCryptorStatus_to_string(CCCryptorStatus status) {
     }
 }
 
+/* Maximum number of idle cryptors kept in the pool. */
+#define CRYPTOR_POOL_MAX 64
+
+typedef struct {
+    CCCryptorRef cryptor;
+    /* The operation, mode, and key @cryptor was created with. */
+    CCOperation op;
+    CCMode mode;
+    uint8_t key[kCCKeySizeAES256];
+} _cryptor_pool_entry_t;
+
+/* A pool of idle cryptors. Creating a cryptor expands the key, which costs
+ * more than encrypting a small value. The same keys are used repeatedly, so a
+ * cryptor created with the same key is reset with the new IV and reused. */
+static struct {
+    mongocrypt_mutex_t mutex;
+    _cryptor_pool_entry_t entries[CRYPTOR_POOL_MAX];
+    size_t len;
+} _cryptor_pool;
+
 bool _native_crypto_initialized = false;
 
 void _native_crypto_init(void) {
+    /* Note, there is no mechanism for libmongocrypt to release the pooled
+     * cryptors. If we ever add such a mechanism, call CCCryptorRelease. */
+    _mongocrypt_mutex_init(&_cryptor_pool.mutex);
     _native_crypto_initialized = true;
 }
 
+void _native_crypto_atfork_child(void) {
+    _mongocrypt_mutex_init(&_cryptor_pool.mutex);
+}
+
+/* Returns an idle cryptor created with @op, @mode, and @key, or NULL. */
+static CCCryptorRef _cryptor_pool_pop(CCOperation op, CCMode mode, const _mongocrypt_buffer_t *key) {
+    CCCryptorRef cryptor = NULL;
+
+    BSON_ASSERT_PARAM(key);
+
+    _mongocrypt_mutex_lock(&_cryptor_pool.mutex);
+    for (size_t i = _cryptor_pool.len; i > 0; i--) {
+        _cryptor_pool_entry_t *entry = &_cryptor_pool.entries[i - 1];
+
+        if (entry->op == op && entry->mode == mode && 0 == memcmp(entry->key, key->data, kCCKeySizeAES256)) {
+            cryptor = entry->cryptor;
+            *entry = _cryptor_pool.entries[_cryptor_pool.len - 1];
+            memset(&_cryptor_pool.entries[_cryptor_pool.len - 1], 0, sizeof(_cryptor_pool_entry_t));
+            _cryptor_pool.len--;
+            break;
+        }
+    }
+    _mongocrypt_mutex_unlock(&_cryptor_pool.mutex);
+    return cryptor;
+}
+
+/* Returns @cryptor, created with @op, @mode, and @key, to the pool. Returns
+ * false if the pool is full and @cryptor must be released by the caller. */
+static bool _cryptor_pool_push(CCCryptorRef cryptor, CCOperation op, CCMode mode, const _mongocrypt_buffer_t *key) {
+    bool pushed = false;
+
+    BSON_ASSERT_PARAM(cryptor);
+    BSON_ASSERT_PARAM(key);
+
+    _mongocrypt_mutex_lock(&_cryptor_pool.mutex);
+    if (_cryptor_pool.len < CRYPTOR_POOL_MAX) {
+        _cryptor_pool_entry_t *entry = &_cryptor_pool.entries[_cryptor_pool.len++];
+
+        entry->cryptor = cryptor;
+        entry->op = op;
+        entry->mode = mode;
+        memcpy(entry->key, key->data, kCCKeySizeAES256);
+        pushed = true;
+    }
+    _mongocrypt_mutex_unlock(&_cryptor_pool.mutex);
+    return pushed;
+}
+
+/* _cryptor_acquire sets @out to a cryptor for @op and @mode with the key and
+ * IV of @args, reusing a pooled cryptor with the same key if there is one. */
+static CCCryptorStatus _cryptor_acquire(CCOperation op, CCMode mode, aes_256_args_t args, CCCryptorRef *out) {
+    CCCryptorRef cryptor;
+
+    BSON_ASSERT(args.iv);
+    BSON_ASSERT(args.key);
+    BSON_ASSERT_PARAM(out);
+
+    cryptor = _cryptor_pool_pop(op, mode, args.key);
+    if (cryptor) {
+        /* Resetting sets the IV and keeps the expanded key. CTR mode cryptors
+         * can only be created on macOS 10.15+, which also resets them. */
+        if (CCCryptorReset(cryptor, args.iv->data) == kCCSuccess) {
+            *out = cryptor;
+            return kCCSuccess;
+        }
+        CCCryptorRelease(cryptor);
+    }
+
+    return CCCryptorCreateWithMode(op,
+                                   mode,
+                                   kCCAlgorithmAES,
+                                   0 /* defaults to CBC w/ no padding */,
+                                   args.iv->data,
+                                   args.key->data,
+                                   kCCKeySizeAES256,
+                                   NULL,
+                                   0,
+                                   0,
+                                   0,
+                                   out);
+}
+
+/* _cryptor_release returns @cryptor to the pool if the operation succeeded,
+ * and otherwise releases it. */
+static void _cryptor_release(CCCryptorRef cryptor, CCOperation op, CCMode mode, aes_256_args_t args, bool ok) {
+    if (!cryptor) {
+        return;
+    }
+    if (!ok || !_cryptor_pool_push(cryptor, op, mode, args.key)) {
+        CCCryptorRelease(cryptor);
+    }
+}
+
 static bool _native_crypto_aes_256_cbc_encrypt_with_mode(aes_256_args_t args, CCMode mode) {
     BSON_ASSERT(args.iv);
     BSON_ASSERT(args.key);
@@ -60,18 +177,7 @@ static bool _native_crypto_aes_256_cbc_encrypt_with_mode(aes_256_args_t args, CC
     size_t intermediate_bytes_written;
     mongocrypt_status_t *status = args.status;
 
-    cc_status = CCCryptorCreateWithMode(kCCEncrypt,
-                                        mode,
-                                        kCCAlgorithmAES,
-                                        0 /* defaults to CBC w/ no padding */,
-                                        args.iv->data,
-                                        args.key->data,
-                                        kCCKeySizeAES256,
-                                        NULL,
-                                        0,
-                                        0,
-                                        0,
-                                        &ctx);
+    cc_status = _cryptor_acquire(kCCEncrypt, mode, args, &ctx);
 
     if (cc_status != kCCSuccess) {
         if (cc_status == kCCUnimplemented && mode == kCCModeCTR) {
@@ -111,7 +217,7 @@ static bool _native_crypto_aes_256_cbc_encrypt_with_mode(aes_256_args_t args, CC
 
     ret = true;
 done:
-    CCCryptorRelease(ctx);
+    _cryptor_release(ctx, kCCEncrypt, mode, args, ret);
     return ret;
 }
 
@@ -137,18 +243,7 @@ static bool _native_crypto_aes_256_cbc_decrypt_with_mode(aes_256_args_t args, CC
     size_t intermediate_bytes_written;
     mongocrypt_status_t *status = args.status;
 
-    cc_status = CCCryptorCreateWithMode(kCCDecrypt,
-                                        mode,
-                                        kCCAlgorithmAES,
-                                        0 /* defaults to CBC w/ no padding */,
-                                        args.iv->data,
-                                        args.key->data,
-                                        kCCKeySizeAES256,
-                                        NULL,
-                                        0,
-                                        0,
-                                        0,
-                                        &ctx);
+    cc_status = _cryptor_acquire(kCCDecrypt, mode, args, &ctx);
 
     if (cc_status != kCCSuccess) {
         if (cc_status == kCCUnimplemented && mode == kCCModeCTR) {
@@ -187,7 +282,7 @@ static bool _native_crypto_aes_256_cbc_decrypt_with_mode(aes_256_args_t args, CC
 
     ret = true;
 done:
-    CCCryptorRelease(ctx);
+    _cryptor_release(ctx, kCCDecrypt, mode, args, ret);
     return ret;
 }
 
@@ -199,8 +294,8 @@ bool _native_crypto_aes_256_ctr_decrypt(aes_256_args_t args) {
     return _native_crypto_aes_256_cbc_decrypt_with_mode(args, kCCModeCTR);
 }
 
-/* _hmac_with_algorithm computes an HMAC of @in with the algorithm specified by
- * @algorithm.
+/* _hmac_with_algorithm computes an HMAC of the concatenation of the @in_count
+ * buffers in @in with the algorithm specified by @algorithm.
  * @key is the input key.
  * @out is the output. @out must be allocated by the caller with
  * the expected length @expect_out_len for the output.
@@ -208,6 +303,7 @@ bool _native_crypto_aes_256_ctr_decrypt(aes_256_args_t args) {
 static bool _hmac_with_algorithm(CCHmacAlgorithm algorithm,
                                  const _mongocrypt_buffer_t *key,
                                  const _mongocrypt_buffer_t *in,
+                                 uint32_t in_count,
                                  _mongocrypt_buffer_t *out,
                                  uint32_t expect_out_len,
                                  mongocrypt_status_t *status) {
@@ -227,7 +323,9 @@ static bool _hmac_with_algorithm(CCHmacAlgorithm algorithm,
 
     /* The ->len members are uint32_t and these functions take size_t */
     CCHmacInit(ctx, algorithm, key->data, key->len);
-    CCHmacUpdate(ctx, in->data, in->len);
+    for (uint32_t i = 0; i < in_count; i++) {
+        CCHmacUpdate(ctx, in[i].data, in[i].len);
+    }
     CCHmacFinal(ctx, out->data);
     bson_free(ctx);
     return true;
@@ -237,7 +335,15 @@ bool _native_crypto_hmac_sha_512(const _mongocrypt_buffer_t *key,
                                  const _mongocrypt_buffer_t *in,
                                  _mongocrypt_buffer_t *out,
                                  mongocrypt_status_t *status) {
-    return _hmac_with_algorithm(kCCHmacAlgSHA512, key, in, out, MONGOCRYPT_HMAC_SHA512_LEN, status);
+    return _hmac_with_algorithm(kCCHmacAlgSHA512, key, in, 1, out, MONGOCRYPT_HMAC_SHA512_LEN, status);
+}
+
+bool _native_crypto_hmac_sha_512_parts(const _mongocrypt_buffer_t *key,
+                                       const _mongocrypt_buffer_t *in,
+                                       uint32_t in_count,
+                                       _mongocrypt_buffer_t *out,
+                                       mongocrypt_status_t *status) {
+    return _hmac_with_algorithm(kCCHmacAlgSHA512, key, in, in_count, out, MONGOCRYPT_HMAC_SHA512_LEN, status);
 }
 
 bool _native_crypto_random(_mongocrypt_buffer_t *out, uint32_t count, mongocrypt_status_t *status) {
@@ -255,7 +361,15 @@ bool _native_crypto_hmac_sha_256(const _mongocrypt_buffer_t *key,
                                  const _mongocrypt_buffer_t *in,
                                  _mongocrypt_buffer_t *out,
                                  mongocrypt_status_t *status) {
-    return _hmac_with_algorithm(kCCHmacAlgSHA256, key, in, out, MONGOCRYPT_HMAC_SHA256_LEN, status);
+    return _hmac_with_algorithm(kCCHmacAlgSHA256, key, in, 1, out, MONGOCRYPT_HMAC_SHA256_LEN, status);
+}
+
+bool _native_crypto_hmac_sha_256_parts(const _mongocrypt_buffer_t *key,
+                                       const _mongocrypt_buffer_t *in,
+                                       uint32_t in_count,
+                                       _mongocrypt_buffer_t *out,
+                                       mongocrypt_status_t *status) {
+    return _hmac_with_algorithm(kCCHmacAlgSHA256, key, in, in_count, out, MONGOCRYPT_HMAC_SHA256_LEN, status);
 }
 
 #endif /* MONGOCRYPT_ENABLE_CRYPTO_COMMON_CRYPTO */
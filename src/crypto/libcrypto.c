@@ -21,6 +21,7 @@
 
 #include "../mongocrypt-crypto-private.h"
 #include "../mongocrypt-log-private.h"
+#include "../mongocrypt-mutex-private.h"
 #include "../mongocrypt-private.h"
 
 #ifdef MONGOCRYPT_ENABLE_CRYPTO_LIBCRYPTO
@@ -33,7 +34,13 @@
 #include <openssl/hmac.h>
 #include <openssl/rand.h>
 
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L && !defined(LIBRESSL_VERSION_NUMBER)
+#include <openssl/core_names.h>
+#define MONGOCRYPT_OPENSSL_HAS_EVP_MAC
+#endif
+
 #if OPENSSL_VERSION_NUMBER < 0x10100000L || (defined(LIBRESSL_VERSION_NUMBER) && LIBRESSL_VERSION_NUMBER < 0x20700000L)
+#define MONGOCRYPT_OPENSSL_OLD
 
 static HMAC_CTX *HMAC_CTX_new(void) {
     return bson_malloc0(sizeof(HMAC_CTX));
@@ -43,14 +50,214 @@ static void HMAC_CTX_free(HMAC_CTX *ctx) {
     HMAC_CTX_cleanup(ctx);
     bson_free(ctx);
 }
+
+#define EVP_CIPHER_CTX_reset(ctx) EVP_CIPHER_CTX_cleanup(ctx)
+#endif
+
+/* Maximum number of idle contexts kept in each pool. */
+#define CTX_POOL_MAX 64
+
+/* A pool of idle OpenSSL contexts. Creating and freeing a context for every
+ * operation costs more than the operation itself for small inputs, so contexts
+ * are reset and reused. */
+typedef struct {
+    mongocrypt_mutex_t mutex;
+    void *ctxs[CTX_POOL_MAX];
+    size_t len;
+} _ctx_pool_t;
+
+/* Returns an idle context, or NULL if @pool is empty. */
+static void *_ctx_pool_pop(_ctx_pool_t *pool) {
+    void *ctx = NULL;
+
+    BSON_ASSERT_PARAM(pool);
+
+    _mongocrypt_mutex_lock(&pool->mutex);
+    if (pool->len > 0) {
+        ctx = pool->ctxs[--pool->len];
+    }
+    _mongocrypt_mutex_unlock(&pool->mutex);
+    return ctx;
+}
+
+/* Returns @ctx to @pool. Returns false if @pool is full and @ctx must be freed
+ * by the caller. */
+static bool _ctx_pool_push(_ctx_pool_t *pool, void *ctx) {
+    bool pushed = false;
+
+    BSON_ASSERT_PARAM(pool);
+    BSON_ASSERT_PARAM(ctx);
+
+    _mongocrypt_mutex_lock(&pool->mutex);
+    if (pool->len < CTX_POOL_MAX) {
+        pool->ctxs[pool->len++] = ctx;
+        pushed = true;
+    }
+    _mongocrypt_mutex_unlock(&pool->mutex);
+    return pushed;
+}
+
+static _ctx_pool_t _cipher_ctx_pool;
+
+static EVP_CIPHER_CTX *_cipher_ctx_acquire(void) {
+    EVP_CIPHER_CTX *ctx = _ctx_pool_pop(&_cipher_ctx_pool);
+
+    if (!ctx) {
+        ctx = EVP_CIPHER_CTX_new();
+    }
+    return ctx;
+}
+
+static void _cipher_ctx_release(EVP_CIPHER_CTX *ctx) {
+    if (!ctx) {
+        return;
+    }
+    /* Resetting clears the key schedule. */
+    if (!EVP_CIPHER_CTX_reset(ctx) || !_ctx_pool_push(&_cipher_ctx_pool, ctx)) {
+        EVP_CIPHER_CTX_free(ctx);
+    }
+}
+
+/* Cipher handles are looked up once. With OpenSSL 3, the implicit fetch done by
+ * EVP_aes_256_cbc() and friends on each use takes a global lock. */
+static const EVP_CIPHER *_aes_256_cbc = NULL;
+static const EVP_CIPHER *_aes_256_ecb = NULL;
+static const EVP_CIPHER *_aes_256_ctr = NULL;
+
+#if defined(MONGOCRYPT_OPENSSL_HAS_EVP_MAC)
+static EVP_MAC *_hmac = NULL;
+#endif
+
+#if !defined(MONGOCRYPT_OPENSSL_OLD)
+/* Keys longer than this are not remembered by the HMAC pools. */
+#define HMAC_POOL_KEY_MAX 64
+
+typedef struct {
+    void *ctx;
+    /* The key @ctx was last initialized with. */
+    uint8_t key[HMAC_POOL_KEY_MAX];
+    uint32_t key_len;
+} _hmac_pool_entry_t;
+
+/* A pool of idle HMAC contexts that remembers the key of each context. The
+ * same keys are used repeatedly (e.g. the MAC half of a data key). Reusing a
+ * context with the same key reuses the hashed inner and outer pads computed
+ * when the key was set, instead of hashing them again. */
+typedef struct _hmac_pool_t {
+    mongocrypt_mutex_t mutex;
+    _hmac_pool_entry_t entries[CTX_POOL_MAX];
+    size_t len;
+} _hmac_pool_t;
+
+/* Returns an idle context, or NULL if @pool is empty. Prefers a context that
+ * was last initialized with @key. Sets @same_key to whether it was. */
+static void *_hmac_pool_pop(_hmac_pool_t *pool, const _mongocrypt_buffer_t *key, bool *same_key) {
+    void *ctx = NULL;
+    size_t i;
+
+    BSON_ASSERT_PARAM(pool);
+    BSON_ASSERT_PARAM(key);
+    BSON_ASSERT_PARAM(same_key);
+
+    *same_key = false;
+    _mongocrypt_mutex_lock(&pool->mutex);
+    if (pool->len > 0) {
+        /* Default to the most recently returned context. */
+        i = pool->len - 1;
+        if (key->len > 0 && key->len <= HMAC_POOL_KEY_MAX) {
+            size_t j;
+
+            for (j = pool->len; j > 0; j--) {
+                _hmac_pool_entry_t *entry = &pool->entries[j - 1];
+
+                if (entry->key_len == key->len && 0 == memcmp(entry->key, key->data, key->len)) {
+                    i = j - 1;
+                    *same_key = true;
+                    break;
+                }
+            }
+        }
+        ctx = pool->entries[i].ctx;
+        pool->entries[i] = pool->entries[pool->len - 1];
+        memset(&pool->entries[pool->len - 1], 0, sizeof(_hmac_pool_entry_t));
+        pool->len--;
+    }
+    _mongocrypt_mutex_unlock(&pool->mutex);
+    return ctx;
+}
+
+/* Returns @ctx, last initialized with @key, to @pool. Returns false if @pool
+ * is full and @ctx must be freed by the caller. */
+static bool _hmac_pool_push(_hmac_pool_t *pool, void *ctx, const _mongocrypt_buffer_t *key) {
+    bool pushed = false;
+
+    BSON_ASSERT_PARAM(pool);
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(key);
+
+    _mongocrypt_mutex_lock(&pool->mutex);
+    if (pool->len < CTX_POOL_MAX) {
+        _hmac_pool_entry_t *entry = &pool->entries[pool->len++];
+
+        entry->ctx = ctx;
+        entry->key_len = 0;
+        if (key->len <= HMAC_POOL_KEY_MAX) {
+            memcpy(entry->key, key->data, key->len);
+            entry->key_len = key->len;
+        }
+        pushed = true;
+    }
+    _mongocrypt_mutex_unlock(&pool->mutex);
+    return pushed;
+}
+
+/* HMAC contexts are pooled per hash, so the hash is only set up once. */
+static _hmac_pool_t _hmac_sha256_ctx_pool;
+static _hmac_pool_t _hmac_sha512_ctx_pool;
+#else
+/* HMAC contexts are not pooled. */
+typedef struct _hmac_pool_t _hmac_pool_t;
 #endif
 
 bool _native_crypto_initialized = false;
 
 void _native_crypto_init(void) {
+    _mongocrypt_mutex_init(&_cipher_ctx_pool.mutex);
+#if !defined(MONGOCRYPT_OPENSSL_OLD)
+    _mongocrypt_mutex_init(&_hmac_sha256_ctx_pool.mutex);
+    _mongocrypt_mutex_init(&_hmac_sha512_ctx_pool.mutex);
+#endif
+
+#if defined(MONGOCRYPT_OPENSSL_HAS_EVP_MAC)
+    /* Note, there is no mechanism for libmongocrypt to free these or the pooled
+     * contexts. If we ever add such a mechanism, call EVP_CIPHER_free and
+     * EVP_MAC_free. */
+    _aes_256_cbc = EVP_CIPHER_fetch(NULL /* library context */, "AES-256-CBC", NULL /* properties */);
+    _aes_256_ecb = EVP_CIPHER_fetch(NULL /* library context */, "AES-256-ECB", NULL /* properties */);
+    _aes_256_ctr = EVP_CIPHER_fetch(NULL /* library context */, "AES-256-CTR", NULL /* properties */);
+    _hmac = EVP_MAC_fetch(NULL /* library context */, OSSL_MAC_NAME_HMAC, NULL /* properties */);
+    if (!_aes_256_cbc || !_aes_256_ecb || !_aes_256_ctr || !_hmac) {
+        return;
+    }
+#else
+    _aes_256_cbc = EVP_aes_256_cbc();
+    _aes_256_ecb = EVP_aes_256_ecb();
+    _aes_256_ctr = EVP_aes_256_ctr();
+#endif
     _native_crypto_initialized = true;
 }
 
+#ifndef _WIN32
+void _native_crypto_atfork_child(void) {
+    /* Pooled contexts hold no per-process state, so they are kept. */
+    _mongocrypt_mutex_init(&_cipher_ctx_pool.mutex);
+#if !defined(MONGOCRYPT_OPENSSL_OLD)
+    _mongocrypt_mutex_init(&_hmac_sha256_ctx_pool.mutex);
+    _mongocrypt_mutex_init(&_hmac_sha512_ctx_pool.mutex);
+#endif
+}
+#endif
+
 /* _encrypt_with_cipher encrypts @in with the OpenSSL cipher specified by
  * @cipher.
  * @key is the input key. @iv is the input IV.
@@ -64,7 +271,7 @@ static bool _encrypt_with_cipher(const EVP_CIPHER *cipher, aes_256_args_t args)
     int intermediate_bytes_written = 0;
     mongocrypt_status_t *status = args.status;
 
-    ctx = EVP_CIPHER_CTX_new();
+    ctx = _cipher_ctx_acquire();
 
     BSON_ASSERT(args.key);
     BSON_ASSERT(args.in);
@@ -103,7 +310,7 @@ static bool _encrypt_with_cipher(const EVP_CIPHER *cipher, aes_256_args_t args)
 
     ret = true;
 done:
-    EVP_CIPHER_CTX_free(ctx);
+    _cipher_ctx_release(ctx);
     return ret;
 }
 
@@ -120,7 +327,7 @@ static bool _decrypt_with_cipher(const EVP_CIPHER *cipher, aes_256_args_t args)
     int intermediate_bytes_written = 0;
     mongocrypt_status_t *status = args.status;
 
-    ctx = EVP_CIPHER_CTX_new();
+    ctx = _cipher_ctx_acquire();
     BSON_ASSERT(ctx);
 
     BSON_ASSERT_PARAM(cipher);
@@ -161,64 +368,141 @@ static bool _decrypt_with_cipher(const EVP_CIPHER *cipher, aes_256_args_t args)
 
     ret = true;
 done:
-    EVP_CIPHER_CTX_free(ctx);
+    _cipher_ctx_release(ctx);
     return ret;
 }
 
 bool _native_crypto_aes_256_cbc_encrypt(aes_256_args_t args) {
-    return _encrypt_with_cipher(EVP_aes_256_cbc(), args);
+    return _encrypt_with_cipher(_aes_256_cbc, args);
 }
 
 bool _native_crypto_aes_256_cbc_decrypt(aes_256_args_t args) {
-    return _decrypt_with_cipher(EVP_aes_256_cbc(), args);
+    return _decrypt_with_cipher(_aes_256_cbc, args);
 }
 
 bool _native_crypto_aes_256_ecb_encrypt(aes_256_args_t args) {
-    return _encrypt_with_cipher(EVP_aes_256_ecb(), args);
+    return _encrypt_with_cipher(_aes_256_ecb, args);
 }
 
-/* _hmac_with_hash computes an HMAC of @in with the OpenSSL hash specified by
- * @hash.
+#if defined(MONGOCRYPT_OPENSSL_HAS_EVP_MAC)
+/* _hmac_with_hash computes an HMAC of the concatenation of the @in_count
+ * buffers in @in with the hash named by @digest, using a context from @pool.
  * @key is the input key.
  * @out is the output. @out must be allocated by the caller with
  * the exact length for the output. E.g. for HMAC 256, @out->len must be 32.
  * Returns false and sets @status on error. @status is required. */
-static bool _hmac_with_hash(const EVP_MD *hash,
+static bool _hmac_with_hash(_hmac_pool_t *pool,
+                            const char *digest,
                             const _mongocrypt_buffer_t *key,
                             const _mongocrypt_buffer_t *in,
+                            uint32_t in_count,
                             _mongocrypt_buffer_t *out,
                             mongocrypt_status_t *status) {
-    BSON_ASSERT_PARAM(hash);
+    EVP_MAC_CTX *ctx;
+    size_t out_len = 0;
+    bool same_key;
+    bool ret = false;
+
+    BSON_ASSERT_PARAM(pool);
+    BSON_ASSERT_PARAM(digest);
     BSON_ASSERT_PARAM(key);
     BSON_ASSERT_PARAM(in);
     BSON_ASSERT_PARAM(out);
-    BSON_ASSERT(key->len <= INT_MAX);
 
-#if OPENSSL_VERSION_NUMBER >= 0x10100000L
-    if (!HMAC(hash, key->data, (int)key->len, in->data, in->len, out->data, NULL /* unused out len */)) {
+    ctx = _hmac_pool_pop(pool, key, &same_key);
+    if (!ctx) {
+        OSSL_PARAM params[] = {OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, (char *)digest, 0),
+                               OSSL_PARAM_construct_end()};
+
+        ctx = EVP_MAC_CTX_new(_hmac);
+        if (!ctx || !EVP_MAC_CTX_set_params(ctx, params)) {
+            CLIENT_ERR("error initializing HMAC: %s", ERR_error_string(ERR_get_error(), NULL));
+            EVP_MAC_CTX_free(ctx);
+            return false;
+        }
+    }
+
+    /* Initializing with a key replaces the state of any previous use.
+     * Initializing without a key restarts from the pads of the current key. */
+    if (!EVP_MAC_init(ctx, same_key ? NULL : key->data, same_key ? 0 : key->len, NULL /* params */)) {
         CLIENT_ERR("error initializing HMAC: %s", ERR_error_string(ERR_get_error(), NULL));
-        return false;
+        goto done;
     }
-    return true;
+
+    for (uint32_t i = 0; i < in_count; i++) {
+        if (!EVP_MAC_update(ctx, in[i].data, in[i].len)) {
+            CLIENT_ERR("error updating HMAC: %s", ERR_error_string(ERR_get_error(), NULL));
+            goto done;
+        }
+    }
+
+    if (!EVP_MAC_final(ctx, out->data, &out_len, out->len)) {
+        CLIENT_ERR("error finalizing: %s", ERR_error_string(ERR_get_error(), NULL));
+        goto done;
+    }
+
+    if (out_len != out->len) {
+        CLIENT_ERR("out does not contain %zu bytes", out_len);
+        goto done;
+    }
+
+    ret = true;
+done:
+    if (!ret || !_hmac_pool_push(pool, ctx, key)) {
+        EVP_MAC_CTX_free(ctx);
+    }
+    return ret;
+}
 #else
-    HMAC_CTX *ctx;
+/* _hmac_with_hash computes an HMAC of the concatenation of the @in_count
+ * buffers in @in with the OpenSSL hash specified by @hash. If @pool is not
+ * NULL, the HMAC context is taken from @pool.
+ * @key is the input key.
+ * @out is the output. @out must be allocated by the caller with
+ * the exact length for the output. E.g. for HMAC 256, @out->len must be 32.
+ * Returns false and sets @status on error. @status is required. */
+static bool _hmac_with_hash(_hmac_pool_t *pool,
+                            const EVP_MD *hash,
+                            const _mongocrypt_buffer_t *key,
+                            const _mongocrypt_buffer_t *in,
+                            uint32_t in_count,
+                            _mongocrypt_buffer_t *out,
+                            mongocrypt_status_t *status) {
+    HMAC_CTX *ctx = NULL;
+    bool same_key = false;
     bool ret = false;
 
-    ctx = HMAC_CTX_new();
+    BSON_ASSERT_PARAM(hash);
+    BSON_ASSERT_PARAM(key);
+    BSON_ASSERT_PARAM(in);
+    BSON_ASSERT_PARAM(out);
+    BSON_ASSERT(key->len <= INT_MAX);
+
+#if !defined(MONGOCRYPT_OPENSSL_OLD)
+    if (pool) {
+        ctx = _hmac_pool_pop(pool, key, &same_key);
+    }
+#endif
+    if (!ctx) {
+        ctx = HMAC_CTX_new();
+    }
 
     if (out->len != (uint32_t)EVP_MD_size(hash)) {
         CLIENT_ERR("out does not contain %d bytes", EVP_MD_size(hash));
         goto done;
     }
 
-    if (!HMAC_Init_ex(ctx, key->data, (int)key->len, hash, NULL /* engine */)) {
+    /* Initializing without a key restarts from the pads of the current key. */
+    if (!HMAC_Init_ex(ctx, same_key ? NULL : key->data, same_key ? 0 : (int)key->len, hash, NULL /* engine */)) {
         CLIENT_ERR("error initializing HMAC: %s", ERR_error_string(ERR_get_error(), NULL));
         goto done;
     }
 
-    if (!HMAC_Update(ctx, in->data, in->len)) {
-        CLIENT_ERR("error updating HMAC: %s", ERR_error_string(ERR_get_error(), NULL));
-        goto done;
+    for (uint32_t i = 0; i < in_count; i++) {
+        if (!HMAC_Update(ctx, in[i].data, in[i].len)) {
+            CLIENT_ERR("error updating HMAC: %s", ERR_error_string(ERR_get_error(), NULL));
+            goto done;
+        }
     }
 
     if (!HMAC_Final(ctx, out->data, NULL /* unused out len */)) {
@@ -228,16 +512,35 @@ static bool _hmac_with_hash(const EVP_MD *hash,
 
     ret = true;
 done:
+#if !defined(MONGOCRYPT_OPENSSL_OLD)
+    if (ret && pool && _hmac_pool_push(pool, ctx, key)) {
+        return ret;
+    }
+#endif
     HMAC_CTX_free(ctx);
     return ret;
-#endif
 }
+#endif
 
 bool _native_crypto_hmac_sha_512(const _mongocrypt_buffer_t *key,
                                  const _mongocrypt_buffer_t *in,
                                  _mongocrypt_buffer_t *out,
                                  mongocrypt_status_t *status) {
-    return _hmac_with_hash(EVP_sha512(), key, in, out, status);
+    return _native_crypto_hmac_sha_512_parts(key, in, 1, out, status);
+}
+
+bool _native_crypto_hmac_sha_512_parts(const _mongocrypt_buffer_t *key,
+                                       const _mongocrypt_buffer_t *in,
+                                       uint32_t in_count,
+                                       _mongocrypt_buffer_t *out,
+                                       mongocrypt_status_t *status) {
+#if defined(MONGOCRYPT_OPENSSL_HAS_EVP_MAC)
+    return _hmac_with_hash(&_hmac_sha512_ctx_pool, OSSL_DIGEST_NAME_SHA2_512, key, in, in_count, out, status);
+#elif !defined(MONGOCRYPT_OPENSSL_OLD)
+    return _hmac_with_hash(&_hmac_sha512_ctx_pool, EVP_sha512(), key, in, in_count, out, status);
+#else
+    return _hmac_with_hash(NULL, EVP_sha512(), key, in, in_count, out, status);
+#endif
 }
 
 bool _native_crypto_random(_mongocrypt_buffer_t *out, uint32_t count, mongocrypt_status_t *status) {
@@ -259,18 +562,32 @@ bool _native_crypto_random(_mongocrypt_buffer_t *out, uint32_t count, mongocrypt
 }
 
 bool _native_crypto_aes_256_ctr_encrypt(aes_256_args_t args) {
-    return _encrypt_with_cipher(EVP_aes_256_ctr(), args);
+    return _encrypt_with_cipher(_aes_256_ctr, args);
 }
 
 bool _native_crypto_aes_256_ctr_decrypt(aes_256_args_t args) {
-    return _decrypt_with_cipher(EVP_aes_256_ctr(), args);
+    return _decrypt_with_cipher(_aes_256_ctr, args);
 }
 
 bool _native_crypto_hmac_sha_256(const _mongocrypt_buffer_t *key,
                                  const _mongocrypt_buffer_t *in,
                                  _mongocrypt_buffer_t *out,
                                  mongocrypt_status_t *status) {
-    return _hmac_with_hash(EVP_sha256(), key, in, out, status);
+    return _native_crypto_hmac_sha_256_parts(key, in, 1, out, status);
+}
+
+bool _native_crypto_hmac_sha_256_parts(const _mongocrypt_buffer_t *key,
+                                       const _mongocrypt_buffer_t *in,
+                                       uint32_t in_count,
+                                       _mongocrypt_buffer_t *out,
+                                       mongocrypt_status_t *status) {
+#if defined(MONGOCRYPT_OPENSSL_HAS_EVP_MAC)
+    return _hmac_with_hash(&_hmac_sha256_ctx_pool, OSSL_DIGEST_NAME_SHA2_256, key, in, in_count, out, status);
+#elif !defined(MONGOCRYPT_OPENSSL_OLD)
+    return _hmac_with_hash(&_hmac_sha256_ctx_pool, EVP_sha256(), key, in, in_count, out, status);
+#else
+    return _hmac_with_hash(NULL, EVP_sha256(), key, in, in_count, out, status);
+#endif
 }
 
 #endif /* MONGOCRYPT_ENABLE_CRYPTO_LIBCRYPTO */
@@ -27,6 +27,10 @@ void _native_crypto_init(void) {
     _native_crypto_initialized = true;
 }
 
+#ifndef _WIN32
+void _native_crypto_atfork_child(void) {}
+#endif
+
 bool _native_crypto_aes_256_cbc_encrypt(aes_256_args_t args) {
     mongocrypt_status_t *status = args.status;
     CLIENT_ERR("hook not set for aes_256_cbc_encrypt");
@@ -72,4 +76,22 @@ bool _native_crypto_hmac_sha_256(const _mongocrypt_buffer_t *key,
     return false;
 }
 
-#endif /* MONGOCRYPT_ENABLE_CRYPTO */
\ No newline at end of file
+bool _native_crypto_hmac_sha_512_parts(const _mongocrypt_buffer_t *key,
+                                       const _mongocrypt_buffer_t *in,
+                                       uint32_t in_count,
+                                       _mongocrypt_buffer_t *out,
+                                       mongocrypt_status_t *status) {
+    CLIENT_ERR("hook not set for hmac_sha_512");
+    return false;
+}
+
+bool _native_crypto_hmac_sha_256_parts(const _mongocrypt_buffer_t *key,
+                                       const _mongocrypt_buffer_t *in,
+                                       uint32_t in_count,
+                                       _mongocrypt_buffer_t *out,
+                                       mongocrypt_status_t *status) {
+    CLIENT_ERR("hook not set for _native_crypto_hmac_sha_256");
+    return false;
+}
+
+#endif /* MONGOCRYPT_ENABLE_CRYPTO */
@@ -8,21 +8,28 @@ extern "C" {
 #include "./mongocrypt-dll-private.h"
 }
 
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <mongo_crypt-v1.h>
 
 namespace {
 void print_usage() {
     std::cout << "Usage:\n"
-              << "  csfle-markup <csfle-dll-path> [doc-namespace]\n"
+              << "  csfle-markup [--repeat <N> [--threads <T>]] <csfle-dll-path> [doc-namespace]\n"
               << "\n"
               << "Write a JSON document to stdin, and the resulting marked-up\n"
               << "document will be written to stdout.\n\n"
+              << "With --repeat, the document is instead analyzed N times on each\n"
+              << "of T threads (default 1), and the throughput and analysis\n"
+              << "latencies are written to stdout.\n\n"
               << "Hint: Pipe through \"jq .\" for prettier output.\n";
 }
 
@@ -89,7 +96,14 @@ void print_field_info(bson_t *bson, std::string path) {
 }
 
 int do_main(int argc, const char *const *argv) {
-    if (argc < 2 || argc > 3) {
+    long repeat = 0;
+    long nthreads = 1;
+    while (argc > 2 && (argv[1] == std::string("--repeat") || argv[1] == std::string("--threads"))) {
+        (argv[1] == std::string("--repeat") ? repeat : nthreads) = std::strtol(argv[2], nullptr, 10);
+        argc -= 2;
+        argv += 2;
+    }
+    if (argc < 2 || argc > 3 || repeat < 0 || nthreads < 1) {
         print_usage();
         return 2;
     }
@@ -100,10 +114,10 @@ int do_main(int argc, const char *const *argv) {
     const auto csfle_path = argv[1];
     const auto doc_ns = argc > 2 ? argv[2] : "";
 
-    mcr_dll csfle = mcr_dll_open(argv[1]);
+    mcr_dll csfle = mcr_dll_open(csfle_path);
     auto close_csfle = DEFER({ mcr_dll_close(csfle); });
     if (csfle.error_string.data) {
-        std::cerr << "Failed to open [" << argv[1] << "] as a dynamic library: " << csfle.error_string.data << '\n';
+        std::cerr << "Failed to open [" << csfle_path << "] as a dynamic library: " << csfle.error_string.data << '\n';
         return 3;
     }
 
@@ -161,6 +175,74 @@ int do_main(int argc, const char *const *argv) {
     }
     auto del_lib = DEFER({ mongo_crypt_v1_lib_destroy(lib, nullptr); });
 
+    if (repeat > 0) {
+        // A query analyzer must not be used concurrently, so each thread creates its own.
+        using clock = std::chrono::steady_clock;
+        std::vector<std::vector<std::int64_t>> latencies(static_cast<std::size_t>(nthreads));
+        std::vector<std::thread> threads;
+        const auto start = clock::now();
+        for (auto &thread_latencies : latencies) {
+            threads.emplace_back([&] {
+                auto thread_status = mongo_crypt_v1_status_create();
+                auto del_thread_status = DEFER({ mongo_crypt_v1_status_destroy(thread_status); });
+                auto thread_qa = mongo_crypt_v1_query_analyzer_create(lib, thread_status);
+                if (!thread_qa) {
+                    fprintf(stderr,
+                            "Failed to create a query analyzer for csfle: %s\n",
+                            mongo_crypt_v1_status_get_explanation(thread_status));
+                    std::abort();
+                }
+                auto del_thread_qa = DEFER({ mongo_crypt_v1_query_analyzer_destroy(thread_qa); });
+                for (long i = 0; i < repeat; ++i) {
+                    const auto op_start = clock::now();
+                    uint32_t len = input->len;
+                    uint8_t *marked = mongo_crypt_v1_analyze_query(thread_qa,
+                                                                   bson_get_data(input),
+                                                                   doc_ns,
+                                                                   static_cast<std::uint32_t>(strlen(doc_ns)),
+                                                                   &len,
+                                                                   thread_status);
+                    if (!marked) {
+                        fprintf(stderr,
+                                "Failed to analyze the given query: %s\n",
+                                mongo_crypt_v1_status_get_explanation(thread_status));
+                        std::abort();
+                    }
+                    mongo_crypt_v1_bson_free(marked);
+                    thread_latencies.push_back(
+                        std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - op_start).count());
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        const double elapsed_usec =
+            static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start).count());
+
+        std::vector<std::int64_t> all;
+        for (const auto &thread_latencies : latencies) {
+            all.insert(all.end(), thread_latencies.begin(), thread_latencies.end());
+        }
+        std::sort(all.begin(), all.end());
+        std::int64_t total_usec = 0;
+        for (auto usec : all) {
+            total_usec += usec;
+        }
+        const auto percentile = [&](std::size_t p) { return all[(all.size() - 1) * p / 100]; };
+        printf("%zu analyses on %ld threads in %.3f s: %.1f ops/s\n",
+               all.size(),
+               nthreads,
+               elapsed_usec / 1e6,
+               static_cast<double>(all.size()) * 1e6 / elapsed_usec);
+        printf("query analysis: mean %.1f us, p50 %lld us, p90 %lld us, p99 %lld us\n",
+               static_cast<double>(total_usec) / static_cast<double>(all.size()),
+               static_cast<long long>(percentile(50)),
+               static_cast<long long>(percentile(90)),
+               static_cast<long long>(percentile(99)));
+        return 0;
+    }
+
     auto qa = mongo_crypt_v1_query_analyzer_create(lib, status);
     if (!qa) {
         fprintf(stderr,
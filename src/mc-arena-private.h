@@ -0,0 +1,53 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MC_ARENA_PRIVATE_H
+#define MC_ARENA_PRIVATE_H
+
+#include "mongocrypt.h"
+
+#include <bson/bson.h>
+
+typedef struct _mc_arena_chunk_t mc_arena_chunk_t;
+
+/* mc_arena_t is a bump allocator for allocations that share a lifetime. Memory
+ * is carved from chunks and only freed, all at once, by mc_arena_cleanup. A
+ * zeroed mc_arena_t is an empty arena. */
+typedef struct {
+    mc_arena_chunk_t *chunks; /* The head has free space. */
+    /* Chunks are allocated with malloc_fn and freed with free_fn. NULL uses
+     * bson_malloc. */
+    mongocrypt_malloc_fn_t malloc_fn;
+    mongocrypt_free_fn_t free_fn;
+    void *allocator_ctx;
+} mc_arena_t;
+
+void mc_arena_init(mc_arena_t *arena);
+
+/* mc_arena_set_allocator sets the allocator of chunks. It must be called
+ * before the first allocation. */
+void mc_arena_set_allocator(mc_arena_t *arena,
+                            mongocrypt_malloc_fn_t malloc_fn,
+                            mongocrypt_free_fn_t free_fn,
+                            void *allocator_ctx);
+
+/* mc_arena_malloc0 returns @size zeroed bytes aligned like bson_malloc. They are
+ * valid until mc_arena_cleanup and must not be passed to bson_free. */
+void *mc_arena_malloc0(mc_arena_t *arena, size_t size);
+
+void mc_arena_cleanup(mc_arena_t *arena);
+
+#endif /* MC_ARENA_PRIVATE_H */
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mc-arena-private.h"
+
+/* Allocations are rounded up to MC_ARENA_ALIGN bytes. */
+#define MC_ARENA_ALIGN 16u
+#define MC_ARENA_CHUNK_SIZE 4096u
+
+/* A chunk is followed by its data, MC_ARENA_HEADER_SIZE bytes from its start. */
+struct _mc_arena_chunk_t {
+    mc_arena_chunk_t *next;
+    size_t used;
+    size_t len;
+};
+
+#define MC_ARENA_HEADER_SIZE ((sizeof(mc_arena_chunk_t) + MC_ARENA_ALIGN - 1u) & ~(size_t)(MC_ARENA_ALIGN - 1u))
+#define MC_ARENA_DATA(chunk) ((uint8_t *)(chunk) + MC_ARENA_HEADER_SIZE)
+
+void mc_arena_init(mc_arena_t *arena) {
+    BSON_ASSERT_PARAM(arena);
+
+    memset(arena, 0, sizeof(*arena));
+}
+
+void mc_arena_set_allocator(mc_arena_t *arena,
+                            mongocrypt_malloc_fn_t malloc_fn,
+                            mongocrypt_free_fn_t free_fn,
+                            void *allocator_ctx) {
+    BSON_ASSERT_PARAM(arena);
+    BSON_ASSERT(!arena->chunks);
+    BSON_ASSERT(!malloc_fn == !free_fn);
+
+    arena->malloc_fn = malloc_fn;
+    arena->free_fn = free_fn;
+    arena->allocator_ctx = allocator_ctx;
+}
+
+static mc_arena_chunk_t *_chunk_new(mc_arena_t *arena, size_t len) {
+    mc_arena_chunk_t *chunk;
+    size_t size;
+
+    BSON_ASSERT(len <= SIZE_MAX - MC_ARENA_HEADER_SIZE);
+    size = MC_ARENA_HEADER_SIZE + len;
+    if (arena->malloc_fn) {
+        chunk = arena->malloc_fn(size, arena->allocator_ctx);
+        BSON_ASSERT(chunk);
+        memset(chunk, 0, size);
+    } else {
+        chunk = bson_malloc0(size);
+        BSON_ASSERT(chunk);
+    }
+    chunk->len = len;
+    return chunk;
+}
+
+void *mc_arena_malloc0(mc_arena_t *arena, size_t size) {
+    mc_arena_chunk_t *chunk;
+    void *ret;
+
+    BSON_ASSERT_PARAM(arena);
+    BSON_ASSERT(size <= SIZE_MAX - MC_ARENA_ALIGN);
+
+    size = (size + MC_ARENA_ALIGN - 1u) & ~(size_t)(MC_ARENA_ALIGN - 1u);
+    chunk = arena->chunks;
+    if (size > MC_ARENA_CHUNK_SIZE / 4u) {
+        /* Large allocations get a chunk of their own, behind the head so the
+         * free space of the head is kept. */
+        mc_arena_chunk_t *large = _chunk_new(arena, size);
+
+        large->used = size;
+        if (chunk) {
+            large->next = chunk->next;
+            chunk->next = large;
+        } else {
+            arena->chunks = large;
+        }
+        return MC_ARENA_DATA(large);
+    }
+
+    if (!chunk || chunk->len - chunk->used < size) {
+        chunk = _chunk_new(arena, MC_ARENA_CHUNK_SIZE);
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+    }
+
+    /* Chunks are zeroed when allocated and bytes are never reused. */
+    ret = MC_ARENA_DATA(chunk) + chunk->used;
+    chunk->used += size;
+    return ret;
+}
+
+void mc_arena_cleanup(mc_arena_t *arena) {
+    mc_arena_chunk_t *chunk;
+
+    if (!arena) {
+        return;
+    }
+
+    chunk = arena->chunks;
+    while (chunk) {
+        mc_arena_chunk_t *next = chunk->next;
+
+        if (arena->free_fn) {
+            arena->free_fn(chunk, MC_ARENA_HEADER_SIZE + chunk->len, arena->allocator_ctx);
+        } else {
+            bson_free(chunk);
+        }
+        chunk = next;
+    }
+    arena->chunks = NULL;
+}
@@ -29,13 +29,38 @@ struct _mc_array_t {
     size_t element_size;
     size_t allocated;
     void *data;
+    /* inline_data is the storage of an mc_small_array_t, or NULL. data points
+     * to it until the elements outgrow its inline_allocated bytes. */
+    void *inline_data;
+    size_t inline_allocated;
 };
 
+/* MC_SMALL_ARRAY_INLINE_BYTES is the inline capacity of an mc_small_array_t.
+ * It matches the initial allocation of an mc_array_t, so both grow alike. */
+#define MC_SMALL_ARRAY_INLINE_BYTES 128
+
+/* mc_small_array_t is an mc_array_t with inline storage for its first
+ * MC_SMALL_ARRAY_INLINE_BYTES bytes of elements, so short arrays, e.g. of
+ * edges, need no allocation. Use it through the mc_array_t API on its 'array'
+ * member. An initialized mc_small_array_t must not be copied by assignment,
+ * since its data may point into itself. */
+typedef struct {
+    mc_array_t array;
+    union {
+        uint8_t bytes[MC_SMALL_ARRAY_INLINE_BYTES];
+        /* Align the storage for any element type. */
+        void *align_ptr;
+        uint64_t align_u64;
+        double align_double;
+    } storage;
+} mc_small_array_t;
+
 #define _mc_array_append_val(a, v) _mc_array_append_vals(a, &v, 1)
 #define _mc_array_index(a, t, i) (((t *)(a)->data)[i])
 #define _mc_array_clear(a) (a)->len = 0
 
 void _mc_array_init(mc_array_t *array, size_t element_size);
+void _mc_small_array_init(mc_small_array_t *small, size_t element_size);
 void _mc_array_copy(mc_array_t *dst, const mc_array_t *src);
 void _mc_array_append_vals(mc_array_t *array, const void *data, uint32_t n_elements);
 void _mc_array_destroy(mc_array_t *array);
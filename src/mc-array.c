@@ -27,6 +27,20 @@ void _mc_array_init(mc_array_t *array, size_t element_size) {
     array->element_size = element_size;
     array->allocated = 128;
     array->data = (void *)bson_malloc0(array->allocated);
+    array->inline_data = NULL;
+    array->inline_allocated = 0;
+}
+
+void _mc_small_array_init(mc_small_array_t *small, size_t element_size) {
+    BSON_ASSERT_PARAM(small);
+    BSON_ASSERT(element_size);
+
+    small->array.len = 0;
+    small->array.element_size = element_size;
+    small->array.allocated = sizeof(small->storage.bytes);
+    small->array.data = small->storage.bytes;
+    small->array.inline_data = small->storage.bytes;
+    small->array.inline_allocated = sizeof(small->storage.bytes);
 }
 
 /*
@@ -53,13 +67,20 @@ void _mc_array_copy(mc_array_t *dst, const mc_array_t *src) {
 
     dst->len = src->len;
     dst->element_size = src->element_size;
+    if (dst->inline_data && src->len * src->element_size <= dst->inline_allocated) {
+        /* The elements fit in the inline storage of dst. */
+        dst->allocated = dst->inline_allocated;
+        dst->data = dst->inline_data;
+        memcpy(dst->data, src->data, src->len * src->element_size);
+        return;
+    }
     dst->allocated = src->allocated;
     dst->data = (void *)bson_malloc(dst->allocated);
     memcpy(dst->data, src->data, dst->allocated);
 }
 
 void _mc_array_destroy(mc_array_t *array) {
-    if (array && array->data) {
+    if (array && array->data && array->data != array->inline_data) {
         bson_free(array->data);
     }
 }
@@ -79,7 +100,14 @@ void _mc_array_append_vals(mc_array_t *array, const void *data, uint32_t n_eleme
     BSON_ASSERT(len <= SIZE_MAX - off);
     if ((off + len) > array->allocated) {
         next_size = bson_next_power_of_two(off + len);
-        array->data = (void *)bson_realloc(array->data, next_size);
+        if (array->data == array->inline_data) {
+            /* Move out of the inline storage. */
+            void *data = bson_malloc(next_size);
+            memcpy(data, array->data, off);
+            array->data = data;
+        } else {
+            array->data = (void *)bson_realloc(array->data, next_size);
+        }
         array->allocated = next_size;
     }
 
@@ -96,18 +96,25 @@ static const mc_dec128 MC_DEC128_ZERO = MC_DEC128_C(0);
 static const mc_dec128 MC_DEC128_ONE = MC_DEC128_C(1);
 static const mc_dec128 MC_DEC128_MINUSONE = MC_DEC128_C(-1);
 
+// The high word of 9999999999999999999999999999999999E6111: The greatest
+// biased exponent (12287) and the high 49 bits of the coefficient 10^34-1.
+#define _mcDec128LargestHigh (_mcDec128Combination(12287 << 2) | 0x0001ed09bead87c0ull)
+#define _mcDec128LargestCoeffLow 0x378d8e63ffffffffull
+
 /// The greatest-magnitude finite negative value representable in a Decimal128
-#define MC_DEC128_LARGEST_NEGATIVE mc_dec128_from_string("-9999999999999999999999999999999999E6111")
+#define MC_DEC128_LARGEST_NEGATIVE                                                                                     \
+    MLIB_INIT(mc_dec128) _mcDec128ConstFromParts(_mcDec128LargestCoeffLow, _mcDec128LargestHigh | 1ull << 63)
 /// The least-magnitude non-zero negative value representable in a Decimal128
-#define MC_DEC128_SMALLEST_NEGATIVE mc_dec128_from_string("-1E-6176")
+#define MC_DEC128_SMALLEST_NEGATIVE MLIB_INIT(mc_dec128) _mcDec128ConstFromParts(1, 1ull << 63)
 /// The greatest-magnitude finite positive value representable in a Decimal128
-#define MC_DEC128_LARGEST_POSITIVE mc_dec128_from_string("9999999999999999999999999999999999E6111")
+#define MC_DEC128_LARGEST_POSITIVE                                                                                     \
+    MLIB_INIT(mc_dec128) _mcDec128ConstFromParts(_mcDec128LargestCoeffLow, _mcDec128LargestHigh)
 /// The least-magnitude non-zero positive value representable in a Decimal128
-#define MC_DEC128_SMALLEST_POSITIVE mc_dec128_from_string("1E-6176")
+#define MC_DEC128_SMALLEST_POSITIVE MLIB_INIT(mc_dec128) _mcDec128ConstFromParts(1, 0)
 /// The normalized zero of Decimal128
 #define MC_DEC128_NORMALIZED_ZERO MC_DEC128_C(0)
 /// A zero of Decimal128 with the least exponent
-#define MC_DEC128_NEGATIVE_EXPONENT_ZERO mc_dec128_from_string("0E-6176")
+#define MC_DEC128_NEGATIVE_EXPONENT_ZERO MLIB_INIT(mc_dec128) _mcDec128ConstFromParts(0, 0)
 #define _mcDec128InfCombo _mcDec128Combination(1 << 15 | 1 << 14 | 1 << 13 | 1 << 12)
 #define _mcDec128QuietNaNCombo _mcDec128Combination(1 << 15 | 1 << 14 | 1 << 13 | 1 << 12 | 1 << 11)
 
@@ -37,11 +37,24 @@ typedef struct _mc_EncryptedField_t {
     struct _mc_EncryptedField_t *next;
 } mc_EncryptedField_t;
 
+/* mc_EncryptedFieldPath_t is a node of the trie of field paths. Each node is
+ * one dotted component of a path. @field is set if the path to the node is an
+ * encrypted field. */
+typedef struct _mc_EncryptedFieldPath_t {
+    char *name;
+    const mc_EncryptedField_t *field;
+    struct _mc_EncryptedFieldPath_t *children;
+    struct _mc_EncryptedFieldPath_t *next;
+} mc_EncryptedFieldPath_t;
+
 /* See
  * https://github.com/mongodb/mongo/blob/591f49a64e96cea68bf3501320de31c51c31f412/src/mongo/crypto/encryption_fields.idl#L48-L112
  * for the server IDL definition of EncryptedFieldConfig. */
 typedef struct {
     mc_EncryptedField_t *fields;
+    /* paths is the root of the trie of the paths of @fields. The root has no
+     * name. */
+    mc_EncryptedFieldPath_t paths;
 } mc_EncryptedFieldConfig_t;
 
 /* mc_EncryptedFieldConfig_parse parses a subset of the fields from @efc_bson
@@ -52,4 +65,14 @@ bool mc_EncryptedFieldConfig_parse(mc_EncryptedFieldConfig_t *efc, const bson_t
 
 void mc_EncryptedFieldConfig_cleanup(mc_EncryptedFieldConfig_t *efc);
 
+/* mc_EncryptedFieldPath_child returns the child of @node with the path
+ * component @name of length @name_len, or NULL. A document can be walked by
+ * starting at efc->paths and only descending into the known children. */
+const mc_EncryptedFieldPath_t *
+mc_EncryptedFieldPath_child(const mc_EncryptedFieldPath_t *node, const char *name, size_t name_len);
+
+/* mc_EncryptedFieldConfig_find returns the encrypted field with the dotted
+ * path @path, or NULL. */
+const mc_EncryptedField_t *mc_EncryptedFieldConfig_find(const mc_EncryptedFieldConfig_t *efc, const char *path);
+
 #endif /* MC_EFC_PRIVATE_H */
@@ -70,6 +70,81 @@ _parse_supported_query_types(bson_iter_t *iter, supported_query_type_flags *out,
     return true;
 }
 
+const mc_EncryptedFieldPath_t *
+mc_EncryptedFieldPath_child(const mc_EncryptedFieldPath_t *node, const char *name, size_t name_len) {
+    BSON_ASSERT_PARAM(node);
+    BSON_ASSERT_PARAM(name);
+
+    for (const mc_EncryptedFieldPath_t *child = node->children; child != NULL; child = child->next) {
+        if (0 == strncmp(child->name, name, name_len) && child->name[name_len] == '\0') {
+            return child;
+        }
+    }
+    return NULL;
+}
+
+/* _add_path adds the path of @ef to the trie at efc->paths. */
+static void _add_path(mc_EncryptedFieldConfig_t *efc, const mc_EncryptedField_t *ef) {
+    mc_EncryptedFieldPath_t *node = &efc->paths;
+    const char *component = ef->path;
+
+    BSON_ASSERT_PARAM(efc);
+    BSON_ASSERT_PARAM(ef);
+
+    for (;;) {
+        const char *dot = strchr(component, '.');
+        const size_t len = dot ? (size_t)(dot - component) : strlen(component);
+        mc_EncryptedFieldPath_t *child = (mc_EncryptedFieldPath_t *)mc_EncryptedFieldPath_child(node, component, len);
+
+        if (!child) {
+            child = bson_malloc0(sizeof(mc_EncryptedFieldPath_t));
+            child->name = bson_strndup(component, len);
+            child->next = node->children;
+            node->children = child;
+        }
+        node = child;
+        if (!dot) {
+            break;
+        }
+        component = dot + 1;
+    }
+    node->field = ef;
+}
+
+static void _paths_cleanup(mc_EncryptedFieldPath_t *node) {
+    mc_EncryptedFieldPath_t *child = node->children;
+
+    while (child != NULL) {
+        mc_EncryptedFieldPath_t *child_next = child->next;
+        _paths_cleanup(child);
+        bson_free(child->name);
+        bson_free(child);
+        child = child_next;
+    }
+}
+
+const mc_EncryptedField_t *mc_EncryptedFieldConfig_find(const mc_EncryptedFieldConfig_t *efc, const char *path) {
+    const mc_EncryptedFieldPath_t *node;
+
+    BSON_ASSERT_PARAM(efc);
+    BSON_ASSERT_PARAM(path);
+
+    node = &efc->paths;
+    for (;;) {
+        const char *dot = strchr(path, '.');
+        const size_t len = dot ? (size_t)(dot - path) : strlen(path);
+
+        node = mc_EncryptedFieldPath_child(node, path, len);
+        if (!node) {
+            return NULL;
+        }
+        if (!dot) {
+            return node->field;
+        }
+        path = dot + 1;
+    }
+}
+
 /* _parse_field parses and prepends one field document to efc->fields. */
 static bool _parse_field(mc_EncryptedFieldConfig_t *efc, bson_t *field, mongocrypt_status_t *status) {
     supported_query_type_flags query_types = SUPPORTS_NO_QUERIES;
@@ -140,6 +215,7 @@ static bool _parse_field(mc_EncryptedFieldConfig_t *efc, bson_t *field, mongocry
     ef->next = efc->fields;
     ef->supported_queries = query_types;
     efc->fields = ef;
+    _add_path(efc, ef);
 
     return true;
 }
@@ -189,4 +265,5 @@ void mc_EncryptedFieldConfig_cleanup(mc_EncryptedFieldConfig_t *efc) {
         bson_free(ptr);
         ptr = ptr_next;
     }
+    _paths_cleanup(&efc->paths);
 }
@@ -133,6 +133,8 @@ typedef struct {
 
 void mc_FLE2EncryptionPlaceholder_init(mc_FLE2EncryptionPlaceholder_t *placeholder);
 
+/* mc_FLE2EncryptionPlaceholder_parse parses a placeholder. @in must already be
+ * validated, as _mongocrypt_marking_parse_unowned does. */
 bool mc_FLE2EncryptionPlaceholder_parse(mc_FLE2EncryptionPlaceholder_t *out,
                                         const bson_t *in,
                                         mongocrypt_status_t *status);
@@ -62,7 +62,7 @@ bool mc_FLE2EncryptionPlaceholder_parse(mc_FLE2EncryptionPlaceholder_t *out,
     BSON_ASSERT_PARAM(in);
 
     mc_FLE2EncryptionPlaceholder_init(out);
-    if (!bson_validate(in, BSON_VALIDATE_NONE, NULL) || !bson_iter_init(&iter, in)) {
+    if (!bson_iter_init(&iter, in)) {
         CLIENT_ERR_PREFIXED("invalid BSON");
         return false;
     }
@@ -100,6 +100,12 @@ bool mc_FLE2InsertUpdatePayloadV2_parse(mc_FLE2InsertUpdatePayloadV2_t *out,
                                         const _mongocrypt_buffer_t *in,
                                         mongocrypt_status_t *status);
 
+/* Like mc_FLE2InsertUpdatePayloadV2_parse, but skips validating the BSON of
+ * @in. Only use for a payload that was already parsed with validation. */
+bool mc_FLE2InsertUpdatePayloadV2_parse_unchecked(mc_FLE2InsertUpdatePayloadV2_t *out,
+                                                  const _mongocrypt_buffer_t *in,
+                                                  mongocrypt_status_t *status);
+
 /* mc_FLE2InsertUpdatePayloadV2_decrypt decrypts ciphertext.
  * Returns NULL and sets @status on error. It is an error to call before
  * mc_FLE2InsertUpdatePayloadV2_parse. */
@@ -97,9 +97,10 @@ void mc_FLE2InsertUpdatePayloadV2_cleanup(mc_FLE2InsertUpdatePayloadV2_t *payloa
         goto fail;                                                                                                     \
     }
 
-bool mc_FLE2InsertUpdatePayloadV2_parse(mc_FLE2InsertUpdatePayloadV2_t *out,
-                                        const _mongocrypt_buffer_t *in,
-                                        mongocrypt_status_t *status) {
+static bool _parse(mc_FLE2InsertUpdatePayloadV2_t *out,
+                   const _mongocrypt_buffer_t *in,
+                   bool validate,
+                   mongocrypt_status_t *status) {
     bson_iter_t iter;
     bool has_d = false, has_s = false, has_p = false;
     bool has_u = false, has_t = false, has_v = false;
@@ -119,7 +120,7 @@ bool mc_FLE2InsertUpdatePayloadV2_parse(mc_FLE2InsertUpdatePayloadV2_t *out,
         return false;
     }
 
-    if (!bson_validate(&in_bson, BSON_VALIDATE_NONE, NULL) || !bson_iter_init(&iter, &in_bson)) {
+    if ((validate && !bson_validate(&in_bson, BSON_VALIDATE_NONE, NULL)) || !bson_iter_init(&iter, &in_bson)) {
         CLIENT_ERR("invalid BSON");
         return false;
     }
@@ -187,6 +188,18 @@ fail:
     return false;
 }
 
+bool mc_FLE2InsertUpdatePayloadV2_parse(mc_FLE2InsertUpdatePayloadV2_t *out,
+                                        const _mongocrypt_buffer_t *in,
+                                        mongocrypt_status_t *status) {
+    return _parse(out, in, true /* validate */, status);
+}
+
+bool mc_FLE2InsertUpdatePayloadV2_parse_unchecked(mc_FLE2InsertUpdatePayloadV2_t *out,
+                                                  const _mongocrypt_buffer_t *in,
+                                                  mongocrypt_status_t *status) {
+    return _parse(out, in, false /* validate */, status);
+}
+
 #define IUPS_APPEND_BINDATA(dst, name, subtype, value)                                                                 \
     if (!_mongocrypt_buffer_append(&(value), dst, name, -1)) {                                                         \
         return false;                                                                                                  \
@@ -47,6 +47,13 @@ bool mc_FLE2IndexedEncryptedValueV2_parse(mc_FLE2IndexedEncryptedValueV2_t *iev,
                                           const _mongocrypt_buffer_t *buf,
                                           mongocrypt_status_t *status);
 
+/* mc_FLE2IndexedEncryptedValueV2_parse_borrowed parses like
+ * mc_FLE2IndexedEncryptedValueV2_parse, but S_KeyId and ServerEncryptedValue
+ * are views into @buf rather than copies. @buf must outlive @iev. */
+bool mc_FLE2IndexedEncryptedValueV2_parse_borrowed(mc_FLE2IndexedEncryptedValueV2_t *iev,
+                                                   const _mongocrypt_buffer_t *buf,
+                                                   mongocrypt_status_t *status);
+
 bson_type_t mc_FLE2IndexedEncryptedValueV2_get_bson_value_type(const mc_FLE2IndexedEncryptedValueV2_t *iev,
                                                                mongocrypt_status_t *status);
 
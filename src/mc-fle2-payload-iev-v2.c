@@ -59,6 +59,10 @@ struct _mc_FLE2IndexedEncryptedValueV2_t {
 #define kMetadataLen 96U                // encCount(32) + tag(32) + encZeros(32)
 #define kMinServerEncryptedValueLen 17U // IV(16) + EncryptCTR(1byte)
 #define kMinSEVAndMetadataLen (kMinServerEncryptedValueLen + kMetadataLen)
+// fle_blob_subtype(1) + S_KeyId(16) + original_bson_type(1)
+#define kEqualityHeaderLen 18U
+// Equality header + edge_count(1)
+#define kRangeHeaderLen 19U
 
 #define CHECK_AND_RETURN(x)                                                                                            \
     if (!(x)) {                                                                                                        \
@@ -69,9 +73,20 @@ mc_FLE2IndexedEncryptedValueV2_t *mc_FLE2IndexedEncryptedValueV2_new(void) {
     return bson_malloc0(sizeof(mc_FLE2IndexedEncryptedValueV2_t));
 }
 
-bool mc_FLE2IndexedEncryptedValueV2_parse(mc_FLE2IndexedEncryptedValueV2_t *iev,
-                                          const _mongocrypt_buffer_t *buf,
-                                          mongocrypt_status_t *status) {
+static bool _mc_FLE2IndexedEqualityEncryptedValueV2_parse(mc_FLE2IndexedEncryptedValueV2_t *iev,
+                                                          const _mongocrypt_buffer_t *buf,
+                                                          bool borrowed,
+                                                          mongocrypt_status_t *status);
+
+static bool _mc_FLE2IndexedRangeEncryptedValueV2_parse(mc_FLE2IndexedEncryptedValueV2_t *iev,
+                                                       const _mongocrypt_buffer_t *buf,
+                                                       bool borrowed,
+                                                       mongocrypt_status_t *status);
+
+static bool _mc_FLE2IndexedEncryptedValueV2_parse(mc_FLE2IndexedEncryptedValueV2_t *iev,
+                                                  const _mongocrypt_buffer_t *buf,
+                                                  bool borrowed,
+                                                  mongocrypt_status_t *status) {
     BSON_ASSERT_PARAM(iev);
     BSON_ASSERT_PARAM(buf);
 
@@ -81,9 +96,9 @@ bool mc_FLE2IndexedEncryptedValueV2_parse(mc_FLE2IndexedEncryptedValueV2_t *iev,
     }
 
     if (buf->data[0] == MC_SUBTYPE_FLE2IndexedEqualityEncryptedValueV2) {
-        return mc_FLE2IndexedEqualityEncryptedValueV2_parse(iev, buf, status);
+        return _mc_FLE2IndexedEqualityEncryptedValueV2_parse(iev, buf, borrowed, status);
     } else if (buf->data[0] == MC_SUBTYPE_FLE2IndexedRangeEncryptedValueV2) {
-        return mc_FLE2IndexedRangeEncryptedValueV2_parse(iev, buf, status);
+        return _mc_FLE2IndexedRangeEncryptedValueV2_parse(iev, buf, borrowed, status);
     } else {
         CLIENT_ERR("mc_FLE2IndexedEncryptedValueV2_parse expected "
                    "fle_blob_subtype %d or %d got: %" PRIu8,
@@ -94,6 +109,18 @@ bool mc_FLE2IndexedEncryptedValueV2_parse(mc_FLE2IndexedEncryptedValueV2_t *iev,
     }
 }
 
+bool mc_FLE2IndexedEncryptedValueV2_parse(mc_FLE2IndexedEncryptedValueV2_t *iev,
+                                          const _mongocrypt_buffer_t *buf,
+                                          mongocrypt_status_t *status) {
+    return _mc_FLE2IndexedEncryptedValueV2_parse(iev, buf, false, status);
+}
+
+bool mc_FLE2IndexedEncryptedValueV2_parse_borrowed(mc_FLE2IndexedEncryptedValueV2_t *iev,
+                                                   const _mongocrypt_buffer_t *buf,
+                                                   mongocrypt_status_t *status) {
+    return _mc_FLE2IndexedEncryptedValueV2_parse(iev, buf, true, status);
+}
+
 bson_type_t mc_FLE2IndexedEncryptedValueV2_get_bson_value_type(const mc_FLE2IndexedEncryptedValueV2_t *iev,
                                                                mongocrypt_status_t *status) {
     BSON_ASSERT_PARAM(iev);
@@ -328,9 +355,10 @@ void mc_FLE2IndexedEncryptedValueV2_destroy(mc_FLE2IndexedEncryptedValueV2_t *ie
 // -----------------------------------------------------------------------
 // Equality
 
-bool mc_FLE2IndexedEqualityEncryptedValueV2_parse(mc_FLE2IndexedEncryptedValueV2_t *iev,
-                                                  const _mongocrypt_buffer_t *buf,
-                                                  mongocrypt_status_t *status) {
+static bool _mc_FLE2IndexedEqualityEncryptedValueV2_parse(mc_FLE2IndexedEncryptedValueV2_t *iev,
+                                                          const _mongocrypt_buffer_t *buf,
+                                                          bool borrowed,
+                                                          mongocrypt_status_t *status) {
     BSON_ASSERT_PARAM(iev);
     BSON_ASSERT_PARAM(buf);
 
@@ -343,7 +371,10 @@ bool mc_FLE2IndexedEqualityEncryptedValueV2_parse(mc_FLE2IndexedEncryptedValueV2
     mc_reader_t reader;
     mc_reader_init_from_buffer(&reader, buf, __FUNCTION__);
 
-    CHECK_AND_RETURN(mc_reader_read_u8(&reader, &iev->fle_blob_subtype, status));
+    /* Check the length of the fixed-size header once. */
+    CHECK_AND_RETURN(mc_reader_require(&reader, kEqualityHeaderLen, status));
+
+    iev->fle_blob_subtype = mc_reader_read_u8_unchecked(&reader);
 
     if (iev->fle_blob_subtype != MC_SUBTYPE_FLE2IndexedEqualityEncryptedValueV2) {
         CLIENT_ERR("mc_FLE2IndexedEqualityEncryptedValueV2_parse expected "
@@ -354,10 +385,11 @@ bool mc_FLE2IndexedEqualityEncryptedValueV2_parse(mc_FLE2IndexedEncryptedValueV2
     }
 
     /* Read S_KeyId. */
-    CHECK_AND_RETURN(mc_reader_read_uuid_buffer(&reader, &iev->S_KeyId, status));
+    mc_reader_read_buffer_unchecked(&reader, &iev->S_KeyId, UUID_LEN, borrowed);
+    iev->S_KeyId.subtype = BSON_SUBTYPE_UUID;
 
     /* Read original_bson_type. */
-    CHECK_AND_RETURN(mc_reader_read_u8(&reader, &iev->bson_value_type, status));
+    iev->bson_value_type = mc_reader_read_u8_unchecked(&reader);
 
     /* Read ServerEncryptedValue. */
     const uint64_t SEV_and_metadata_len = mc_reader_get_remaining_length(&reader);
@@ -368,7 +400,7 @@ bool mc_FLE2IndexedEqualityEncryptedValueV2_parse(mc_FLE2IndexedEncryptedValueV2
         return false;
     }
     const uint64_t SEV_len = SEV_and_metadata_len - kMetadataLen;
-    CHECK_AND_RETURN(mc_reader_read_buffer(&reader, &iev->ServerEncryptedValue, SEV_len, status));
+    mc_reader_read_buffer_unchecked(&reader, &iev->ServerEncryptedValue, (uint32_t)SEV_len, borrowed);
 
     // Ignore Metadata block.
     BSON_ASSERT(mc_reader_get_remaining_length(&reader) == kMetadataLen);
@@ -377,12 +409,19 @@ bool mc_FLE2IndexedEqualityEncryptedValueV2_parse(mc_FLE2IndexedEncryptedValueV2
     return true;
 }
 
+bool mc_FLE2IndexedEqualityEncryptedValueV2_parse(mc_FLE2IndexedEncryptedValueV2_t *iev,
+                                                  const _mongocrypt_buffer_t *buf,
+                                                  mongocrypt_status_t *status) {
+    return _mc_FLE2IndexedEqualityEncryptedValueV2_parse(iev, buf, false, status);
+}
+
 // -----------------------------------------------------------------------
 // Range
 
-bool mc_FLE2IndexedRangeEncryptedValueV2_parse(mc_FLE2IndexedEncryptedValueV2_t *iev,
-                                               const _mongocrypt_buffer_t *buf,
-                                               mongocrypt_status_t *status) {
+static bool _mc_FLE2IndexedRangeEncryptedValueV2_parse(mc_FLE2IndexedEncryptedValueV2_t *iev,
+                                                       const _mongocrypt_buffer_t *buf,
+                                                       bool borrowed,
+                                                       mongocrypt_status_t *status) {
     BSON_ASSERT_PARAM(iev);
     BSON_ASSERT_PARAM(buf);
 
@@ -395,7 +434,10 @@ bool mc_FLE2IndexedRangeEncryptedValueV2_parse(mc_FLE2IndexedEncryptedValueV2_t
     mc_reader_t reader;
     mc_reader_init_from_buffer(&reader, buf, __FUNCTION__);
 
-    CHECK_AND_RETURN(mc_reader_read_u8(&reader, &iev->fle_blob_subtype, status));
+    /* Check the length of the fixed-size header once. */
+    CHECK_AND_RETURN(mc_reader_require(&reader, kRangeHeaderLen, status));
+
+    iev->fle_blob_subtype = mc_reader_read_u8_unchecked(&reader);
 
     if (iev->fle_blob_subtype != MC_SUBTYPE_FLE2IndexedRangeEncryptedValueV2) {
         CLIENT_ERR("mc_FLE2IndexedRangeEncryptedValueV2_parse expected "
@@ -406,13 +448,14 @@ bool mc_FLE2IndexedRangeEncryptedValueV2_parse(mc_FLE2IndexedEncryptedValueV2_t
     }
 
     /* Read S_KeyId. */
-    CHECK_AND_RETURN(mc_reader_read_uuid_buffer(&reader, &iev->S_KeyId, status));
+    mc_reader_read_buffer_unchecked(&reader, &iev->S_KeyId, UUID_LEN, borrowed);
+    iev->S_KeyId.subtype = BSON_SUBTYPE_UUID;
 
     /* Read original_bson_type. */
-    CHECK_AND_RETURN(mc_reader_read_u8(&reader, &iev->bson_value_type, status));
+    iev->bson_value_type = mc_reader_read_u8_unchecked(&reader);
 
     /* Read edge_count */
-    CHECK_AND_RETURN(mc_reader_read_u8(&reader, &iev->edge_count, status));
+    iev->edge_count = mc_reader_read_u8_unchecked(&reader);
     // Maximum edge_count(255) times kMetadataLen(96) fits easily without
     // overflow.
     const uint64_t edges_len = iev->edge_count * kMetadataLen;
@@ -427,11 +470,18 @@ bool mc_FLE2IndexedRangeEncryptedValueV2_parse(mc_FLE2IndexedEncryptedValueV2_t
         return false;
     }
     const uint64_t SEV_len = SEV_and_edges_len - edges_len;
-    CHECK_AND_RETURN(mc_reader_read_buffer(&reader, &iev->ServerEncryptedValue, SEV_len, status));
+    mc_reader_read_buffer_unchecked(&reader, &iev->ServerEncryptedValue, (uint32_t)SEV_len, borrowed);
 
-    // Ignore Metadata block.
+    // Ignore Metadata blocks. They are not read or validated, so the cost of
+    // parsing does not depend on edge_count.
     BSON_ASSERT(mc_reader_get_remaining_length(&reader) == edges_len);
 
     iev->type = kTypeRange;
     return true;
 }
+
+bool mc_FLE2IndexedRangeEncryptedValueV2_parse(mc_FLE2IndexedEncryptedValueV2_t *iev,
+                                               const _mongocrypt_buffer_t *buf,
+                                               mongocrypt_status_t *status) {
+    return _mc_FLE2IndexedRangeEncryptedValueV2_parse(iev, buf, false, status);
+}
@@ -170,9 +170,10 @@ static bool mc_fle2IndexedEncryptedValue_encrypt(_mongocrypt_crypto_t *crypto,
     bool ok = false;
     _mongocrypt_buffer_t in;
     _mongocrypt_buffer_t iv;
+    uint8_t iv_storage[MONGOCRYPT_BUFFER_SMALL_LEN];
 
     _mongocrypt_buffer_init(&in);
-    _mongocrypt_buffer_init_size(&iv, MONGOCRYPT_IV_LEN);
+    _mongocrypt_buffer_init_size_small(&iv, MONGOCRYPT_IV_LEN, iv_storage);
 
     uint32_t expected_buf_size = 0;
     CHECK_AND_GOTO(safe_uint32_t_sum(ClientEncryptedValue->len,
@@ -190,22 +191,22 @@ static bool mc_fle2IndexedEncryptedValue_encrypt(_mongocrypt_crypto_t *crypto,
 
     _mongocrypt_buffer_resize(out, ciphertext_len);
 
+    if (index_tokens->edc.len != PRF_LEN || index_tokens->esc.len != PRF_LEN || index_tokens->ecc.len != PRF_LEN) {
+        CLIENT_ERR("expected index tokens of length %d", PRF_LEN);
+        goto cleanup;
+    }
+
+    /* @in is sized for the whole layout, so the writes are unchecked. */
     mc_writer_t writer;
     mc_writer_init_from_buffer(&writer, &in, __FUNCTION__);
 
-    uint64_t length;
-    length = ClientEncryptedValue->len;
-    CHECK_AND_GOTO(mc_writer_write_u64(&writer, length, status));
-
-    CHECK_AND_GOTO(mc_writer_write_buffer(&writer, ClientEncryptedValue, ClientEncryptedValue->len, status));
-
-    CHECK_AND_GOTO(mc_writer_write_u64(&writer, index_tokens->counter, status));
-
-    CHECK_AND_GOTO(mc_writer_write_prfblock_buffer(&writer, &index_tokens->edc, status));
-
-    CHECK_AND_GOTO(mc_writer_write_prfblock_buffer(&writer, &index_tokens->esc, status));
-
-    CHECK_AND_GOTO(mc_writer_write_prfblock_buffer(&writer, &index_tokens->ecc, status));
+    mc_writer_write_u64_unchecked(&writer, ClientEncryptedValue->len);
+    mc_writer_write_bytes_unchecked(&writer, ClientEncryptedValue->data, ClientEncryptedValue->len);
+    mc_writer_write_u64_unchecked(&writer, index_tokens->counter);
+    mc_writer_write_bytes_unchecked(&writer, index_tokens->edc.data, PRF_LEN);
+    mc_writer_write_bytes_unchecked(&writer, index_tokens->esc.data, PRF_LEN);
+    mc_writer_write_bytes_unchecked(&writer, index_tokens->ecc.data, PRF_LEN);
+    BSON_ASSERT(writer.pos == in.len);
 
     const _mongocrypt_buffer_t *token_buf = mc_ServerDataEncryptionLevel1Token_get(token);
 
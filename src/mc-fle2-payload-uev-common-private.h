@@ -28,9 +28,12 @@
  * Callers are expected to call _mongocrypt_buffer_init() on the
  * @key_uuid and @ciphertext output buffers prior to this call, and
  * call _mongocrypt_buffer_cleanup() afterwards.
+ * If @borrowed is true, @key_uuid and @ciphertext are views into @buf
+ * rather than copies, and @buf must outlive them.
  * Returns false and sets @status on error.
  */
 bool _mc_FLE2UnindexedEncryptedValueCommon_parse(const _mongocrypt_buffer_t *buf,
+                                                 bool borrowed,
                                                  uint8_t *fle_blob_subtype,
                                                  uint8_t *original_bson_type,
                                                  _mongocrypt_buffer_t *key_uuid,
@@ -24,6 +24,7 @@
     }
 
 bool _mc_FLE2UnindexedEncryptedValueCommon_parse(const _mongocrypt_buffer_t *buf,
+                                                 bool borrowed,
                                                  uint8_t *fle_blob_subtype,
                                                  uint8_t *original_bson_type,
                                                  _mongocrypt_buffer_t *key_uuid,
@@ -38,18 +39,23 @@ bool _mc_FLE2UnindexedEncryptedValueCommon_parse(const _mongocrypt_buffer_t *buf
     mc_reader_t reader;
     mc_reader_init_from_buffer(&reader, buf, __FUNCTION__);
 
+    /* Check the length of fle_blob_subtype(1), key_uuid(16) and
+     * original_bson_type(1) once. */
+    CHECK_AND_RETURN(mc_reader_require(&reader, 1 + UUID_LEN + 1, status));
+
     /* Read fle_blob_subtype. */
-    CHECK_AND_RETURN(mc_reader_read_u8(&reader, fle_blob_subtype, status));
+    *fle_blob_subtype = mc_reader_read_u8_unchecked(&reader);
 
     /* Read key_uuid. */
-    CHECK_AND_RETURN(mc_reader_read_buffer(&reader, key_uuid, 16, status));
+    mc_reader_read_buffer_unchecked(&reader, key_uuid, UUID_LEN, borrowed);
     key_uuid->subtype = BSON_SUBTYPE_UUID;
 
     /* Read original_bson_type. */
-    CHECK_AND_RETURN(mc_reader_read_u8(&reader, original_bson_type, status));
+    *original_bson_type = mc_reader_read_u8_unchecked(&reader);
 
     /* Read ciphertext. */
-    CHECK_AND_RETURN(mc_reader_read_buffer(&reader, ciphertext, mc_reader_get_remaining_length(&reader), status));
+    const uint64_t ciphertext_len = mc_reader_get_remaining_length(&reader);
+    mc_reader_read_buffer_unchecked(&reader, ciphertext, (uint32_t)ciphertext_len, borrowed);
 
     return true;
 }
@@ -78,6 +84,7 @@ const _mongocrypt_buffer_t *_mc_FLE2UnindexedEncryptedValueCommon_decrypt(_mongo
     /* Serialize associated data: fle_blob_subtype || key_uuid ||
      * original_bson_type */
     _mongocrypt_buffer_t AD;
+    uint8_t AD_storage[MONGOCRYPT_BUFFER_SMALL_LEN];
     _mongocrypt_buffer_init(&AD);
     if (key_uuid->len > UINT32_MAX - 2) {
         CLIENT_ERR("mc_FLE2UnindexedEncryptedValueCommon_decrypt expected "
@@ -86,7 +93,7 @@ const _mongocrypt_buffer_t *_mc_FLE2UnindexedEncryptedValueCommon_decrypt(_mongo
                    key_uuid->len);
         return NULL;
     }
-    _mongocrypt_buffer_resize(&AD, 1 + key_uuid->len + 1);
+    _mongocrypt_buffer_init_size_small(&AD, 1 + key_uuid->len + 1, AD_storage);
 
     AD.data[0] = (uint8_t)fle_blob_subtype;
     memcpy(AD.data + 1, key_uuid->data, key_uuid->len);
@@ -124,6 +131,8 @@ bool _mc_FLE2UnindexedEncryptedValueCommon_encrypt(_mongocrypt_crypto_t *crypto,
                                                    mongocrypt_status_t *status) {
     _mongocrypt_buffer_t iv = {0};
     _mongocrypt_buffer_t AD = {0};
+    uint8_t iv_storage[MONGOCRYPT_BUFFER_SMALL_LEN];
+    uint8_t AD_storage[MONGOCRYPT_BUFFER_SMALL_LEN];
     bool res = false;
 
     BSON_ASSERT_PARAM(crypto);
@@ -139,7 +148,7 @@ bool _mc_FLE2UnindexedEncryptedValueCommon_encrypt(_mongocrypt_crypto_t *crypto,
         (MC_SUBTYPE_FLE2UnindexedEncryptedValue == fle_blob_subtype) ? _mcFLE2AEADAlgorithm()
                                                                      : _mcFLE2v2AEADAlgorithm();
 
-    _mongocrypt_buffer_resize(&iv, MONGOCRYPT_IV_LEN);
+    _mongocrypt_buffer_init_size_small(&iv, MONGOCRYPT_IV_LEN, iv_storage);
     if (!_mongocrypt_random(crypto, &iv, MONGOCRYPT_IV_LEN, status)) {
         goto fail;
     }
@@ -154,7 +163,7 @@ bool _mc_FLE2UnindexedEncryptedValueCommon_encrypt(_mongocrypt_crypto_t *crypto,
                        key_uuid->len);
             goto fail;
         }
-        _mongocrypt_buffer_resize(&AD, 1 + key_uuid->len + 1);
+        _mongocrypt_buffer_init_size_small(&AD, 1 + key_uuid->len + 1, AD_storage);
         AD.data[0] = (uint8_t)fle_blob_subtype;
         memcpy(AD.data + 1, key_uuid->data, key_uuid->len);
         AD.data[1 + key_uuid->len] = (uint8_t)original_bson_type;
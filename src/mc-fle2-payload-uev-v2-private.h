@@ -49,6 +49,13 @@ bool mc_FLE2UnindexedEncryptedValueV2_parse(mc_FLE2UnindexedEncryptedValueV2_t *
                                             const _mongocrypt_buffer_t *buf,
                                             mongocrypt_status_t *status);
 
+/* mc_FLE2UnindexedEncryptedValueV2_parse_borrowed parses like
+ * mc_FLE2UnindexedEncryptedValueV2_parse, but key_uuid and ciphertext are
+ * views into @buf rather than copies. @buf must outlive @uev. */
+bool mc_FLE2UnindexedEncryptedValueV2_parse_borrowed(mc_FLE2UnindexedEncryptedValueV2_t *uev,
+                                                     const _mongocrypt_buffer_t *buf,
+                                                     mongocrypt_status_t *status);
+
 /* mc_FLE2UnindexedEncryptedValueV2_get_original_bson_type returns
  * original_bson_type. Returns 0 and sets @status on error.
  * It is an error to call before mc_FLE2UnindexedEncryptedValueV2_parse. */
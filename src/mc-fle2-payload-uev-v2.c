@@ -31,9 +31,10 @@ mc_FLE2UnindexedEncryptedValueV2_t *mc_FLE2UnindexedEncryptedValueV2_new(void) {
     return uev;
 }
 
-bool mc_FLE2UnindexedEncryptedValueV2_parse(mc_FLE2UnindexedEncryptedValueV2_t *uev,
-                                            const _mongocrypt_buffer_t *buf,
-                                            mongocrypt_status_t *status) {
+static bool _mc_FLE2UnindexedEncryptedValueV2_parse(mc_FLE2UnindexedEncryptedValueV2_t *uev,
+                                                    const _mongocrypt_buffer_t *buf,
+                                                    bool borrowed,
+                                                    mongocrypt_status_t *status) {
     BSON_ASSERT_PARAM(uev);
     BSON_ASSERT_PARAM(buf);
 
@@ -45,6 +46,7 @@ bool mc_FLE2UnindexedEncryptedValueV2_parse(mc_FLE2UnindexedEncryptedValueV2_t *
     uint8_t fle_blob_subtype;
 
     if (!_mc_FLE2UnindexedEncryptedValueCommon_parse(buf,
+                                                     borrowed,
                                                      &fle_blob_subtype,
                                                      &uev->original_bson_type,
                                                      &uev->key_uuid,
@@ -65,6 +67,18 @@ bool mc_FLE2UnindexedEncryptedValueV2_parse(mc_FLE2UnindexedEncryptedValueV2_t *
     return true;
 }
 
+bool mc_FLE2UnindexedEncryptedValueV2_parse(mc_FLE2UnindexedEncryptedValueV2_t *uev,
+                                            const _mongocrypt_buffer_t *buf,
+                                            mongocrypt_status_t *status) {
+    return _mc_FLE2UnindexedEncryptedValueV2_parse(uev, buf, false, status);
+}
+
+bool mc_FLE2UnindexedEncryptedValueV2_parse_borrowed(mc_FLE2UnindexedEncryptedValueV2_t *uev,
+                                                     const _mongocrypt_buffer_t *buf,
+                                                     mongocrypt_status_t *status) {
+    return _mc_FLE2UnindexedEncryptedValueV2_parse(uev, buf, true, status);
+}
+
 bson_type_t mc_FLE2UnindexedEncryptedValueV2_get_original_bson_type(const mc_FLE2UnindexedEncryptedValueV2_t *uev,
                                                                     mongocrypt_status_t *status) {
     BSON_ASSERT_PARAM(uev);
@@ -45,6 +45,7 @@ bool mc_FLE2UnindexedEncryptedValue_parse(mc_FLE2UnindexedEncryptedValue_t *uev,
     uint8_t fle_blob_subtype;
 
     if (!_mc_FLE2UnindexedEncryptedValueCommon_parse(buf,
+                                                     false,
                                                      &fle_blob_subtype,
                                                      &uev->original_bson_type,
                                                      &uev->key_uuid,
@@ -59,6 +59,33 @@ bool mc_FLE2RangeFindDriverSpec_to_placeholders(mc_FLE2RangeFindDriverSpec_t *sp
                                                 bson_t *out,
                                                 mongocrypt_status_t *status);
 
+// mc_RangeFindIndexBounds_t holds the index min and max of a range index for
+// the BSON type of the last bounds it was used with. It lets many
+// FLE2RangeFindDriverSpecs on one field share that setup.
+typedef struct {
+    bool set;
+    bson_type_t type;
+    bson_t doc;
+} mc_RangeFindIndexBounds_t;
+
+void mc_RangeFindIndexBounds_init(mc_RangeFindIndexBounds_t *bounds);
+
+void mc_RangeFindIndexBounds_cleanup(mc_RangeFindIndexBounds_t *bounds);
+
+// mc_FLE2RangeFindDriverSpec_to_placeholders_with_bounds is like
+// mc_FLE2RangeFindDriverSpec_to_placeholders, but reuses the index min and max
+// in `bounds` if they are set for the type of the bounds of `spec`, and
+// otherwise replaces them.
+bool mc_FLE2RangeFindDriverSpec_to_placeholders_with_bounds(mc_FLE2RangeFindDriverSpec_t *spec,
+                                                            const mc_RangeOpts_t *range_opts,
+                                                            int64_t maxContentionFactor,
+                                                            const _mongocrypt_buffer_t *user_key_id,
+                                                            const _mongocrypt_buffer_t *index_key_id,
+                                                            int32_t payloadId,
+                                                            mc_RangeFindIndexBounds_t *bounds,
+                                                            bson_t *out,
+                                                            mongocrypt_status_t *status);
+
 typedef struct {
     // isStub is true when edgesInfo is not appended.
     bool isStub;
@@ -18,10 +18,10 @@
 
 #include "mc-check-conversions-private.h"
 #include "mc-fle-blob-subtype-private.h" // MC_SUBTYPE_FLE2EncryptionPlaceholder
+#include "mongocrypt-atomic-private.h"
 #include "mongocrypt-private.h"          // CLIENT_ERR
 
-#include "mlib/thread.h" // mlib_once_flag
-#include <math.h>        // INFINITY
+#include <math.h> // INFINITY
 
 static mc_FLE2RangeOperator_t get_operator_type(const char *key) {
     BSON_ASSERT_PARAM(key);
@@ -405,6 +405,21 @@ fail:
     return ok;
 }
 
+void mc_RangeFindIndexBounds_init(mc_RangeFindIndexBounds_t *bounds) {
+    BSON_ASSERT_PARAM(bounds);
+
+    bounds->set = false;
+    bounds->type = BSON_TYPE_EOD;
+    bson_init(&bounds->doc);
+}
+
+void mc_RangeFindIndexBounds_cleanup(mc_RangeFindIndexBounds_t *bounds) {
+    if (!bounds) {
+        return;
+    }
+    bson_destroy(&bounds->doc);
+}
+
 bool mc_FLE2RangeFindDriverSpec_to_placeholders(mc_FLE2RangeFindDriverSpec_t *spec,
                                                 const mc_RangeOpts_t *range_opts,
                                                 int64_t maxContentionFactor,
@@ -413,17 +428,43 @@ bool mc_FLE2RangeFindDriverSpec_to_placeholders(mc_FLE2RangeFindDriverSpec_t *sp
                                                 int32_t payloadId,
                                                 bson_t *out,
                                                 mongocrypt_status_t *status) {
+    mc_RangeFindIndexBounds_t bounds;
+    bool ok;
+
+    mc_RangeFindIndexBounds_init(&bounds);
+    ok = mc_FLE2RangeFindDriverSpec_to_placeholders_with_bounds(spec,
+                                                                range_opts,
+                                                                maxContentionFactor,
+                                                                user_key_id,
+                                                                index_key_id,
+                                                                payloadId,
+                                                                &bounds,
+                                                                out,
+                                                                status);
+    mc_RangeFindIndexBounds_cleanup(&bounds);
+    return ok;
+}
+
+bool mc_FLE2RangeFindDriverSpec_to_placeholders_with_bounds(mc_FLE2RangeFindDriverSpec_t *spec,
+                                                            const mc_RangeOpts_t *range_opts,
+                                                            int64_t maxContentionFactor,
+                                                            const _mongocrypt_buffer_t *user_key_id,
+                                                            const _mongocrypt_buffer_t *index_key_id,
+                                                            int32_t payloadId,
+                                                            mc_RangeFindIndexBounds_t *bounds,
+                                                            bson_t *out,
+                                                            mongocrypt_status_t *status) {
     BSON_ASSERT_PARAM(spec);
     BSON_ASSERT_PARAM(range_opts);
     BSON_ASSERT_PARAM(user_key_id);
     BSON_ASSERT_PARAM(index_key_id);
+    BSON_ASSERT_PARAM(bounds);
     BSON_ASSERT_PARAM(out);
     BSON_ASSERT(status || true);
 
     _mongocrypt_buffer_t p1 = {0}, p2 = {0};
     bson_t infDoc = BSON_INITIALIZER;
     bson_iter_t negInf, posInf;
-    bson_t minMaxDoc = BSON_INITIALIZER;
     bson_iter_t indexMin, indexMax;
     bool ok = false;
 
@@ -438,7 +479,8 @@ bool mc_FLE2RangeFindDriverSpec_to_placeholders(mc_FLE2RangeFindDriverSpec_t *sp
     TRY(bson_iter_init_find(&posInf, &infDoc, "p"));
     TRY(bson_iter_init_find(&negInf, &infDoc, "n"));
 
-    // Apply default index min/max values.
+    // Apply default index min/max values. They only depend on the type of the
+    // bounds, so they are reused from `bounds` when the type matches.
     {
         bson_type_t index_type;
         if (spec->lower.set) {
@@ -449,15 +491,21 @@ bool mc_FLE2RangeFindDriverSpec_to_placeholders(mc_FLE2RangeFindDriverSpec_t *sp
             CLIENT_ERR("expected lower or upper bound to be set");
             goto fail;
         }
-        if (!mc_RangeOpts_appendMin(range_opts, index_type, "indexMin", &minMaxDoc, status)) {
-            goto fail;
-        }
-        if (!mc_RangeOpts_appendMax(range_opts, index_type, "indexMax", &minMaxDoc, status)) {
-            goto fail;
+        if (!bounds->set || bounds->type != index_type) {
+            bson_reinit(&bounds->doc);
+            bounds->set = false;
+            if (!mc_RangeOpts_appendMin(range_opts, index_type, "indexMin", &bounds->doc, status)) {
+                goto fail;
+            }
+            if (!mc_RangeOpts_appendMax(range_opts, index_type, "indexMax", &bounds->doc, status)) {
+                goto fail;
+            }
+            bounds->type = index_type;
+            bounds->set = true;
         }
 
-        TRY(bson_iter_init_find(&indexMin, &minMaxDoc, "indexMin"));
-        TRY(bson_iter_init_find(&indexMax, &minMaxDoc, "indexMax"));
+        TRY(bson_iter_init_find(&indexMin, &bounds->doc, "indexMin"));
+        TRY(bson_iter_init_find(&indexMax, &bounds->doc, "indexMax"));
     }
 
     mc_makeRangeFindPlaceholder_args_t args = {.isStub = false,
@@ -568,33 +616,19 @@ bool mc_FLE2RangeFindDriverSpec_to_placeholders(mc_FLE2RangeFindDriverSpec_t *sp
 fail:
     _mongocrypt_buffer_cleanup(&p2);
     _mongocrypt_buffer_cleanup(&p1);
-    bson_destroy(&minMaxDoc);
     bson_destroy(&infDoc);
     return ok;
 }
 
-static mlib_once_flag payloadId_init_flag = MLIB_ONCE_INITIALIZER;
-static mongocrypt_mutex_t payloadId_mutex;
-static int32_t payloadId = 0;
-
-static void payloadId_init_mutex(void) {
-    _mongocrypt_mutex_init(&payloadId_mutex);
-}
+/* payloadId is only accessed atomically. It wraps around, and only its low 31
+ * bits are used, so IDs count from 0 to INT32_MAX and then restart at 0. */
+static volatile int32_t payloadId = 0;
 
 void mc_reset_payloadId_for_testing(void) {
-    mlib_call_once(&payloadId_init_flag, payloadId_init_mutex);
-    MONGOCRYPT_WITH_MUTEX(payloadId_mutex) {
-        payloadId = 0;
-    }
+    _mongocrypt_atomic_int32_exchange(&payloadId, 0);
 }
 
 // mc_getNextPayloadId is thread safe.
 int32_t mc_getNextPayloadId(void) {
-    mlib_call_once(&payloadId_init_flag, payloadId_init_mutex);
-    int32_t ret;
-    MONGOCRYPT_WITH_MUTEX(payloadId_mutex) {
-        ret = payloadId;
-        payloadId = payloadId < INT32_MAX ? payloadId + 1 : 0;
-    }
-    return ret;
+    return _mongocrypt_atomic_int32_fetch_add(&payloadId, 1) & INT32_MAX;
 }
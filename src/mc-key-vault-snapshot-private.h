@@ -0,0 +1,40 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MC_KEY_VAULT_SNAPSHOT_PRIVATE_H
+#define MC_KEY_VAULT_SNAPSHOT_PRIVATE_H
+
+#include "mongocrypt-buffer-private.h"
+#include "mongocrypt-key-private.h"
+#include "mongocrypt-status-private.h"
+
+// `mc_key_vault_snapshot_t` indexes the key documents of an offline copy of the key vault collection by `_id` and by
+// each keyAltName, so lookups do not depend on the number of keys.
+typedef struct _mc_key_vault_snapshot_t mc_key_vault_snapshot_t;
+
+// `mc_key_vault_snapshot_new` indexes `docs`, a sequence of BSON key documents as written by mongodump. The entries
+// view `docs`, which must outlive the returned snapshot. Returns NULL on error.
+mc_key_vault_snapshot_t *mc_key_vault_snapshot_new(const _mongocrypt_buffer_t *docs, mongocrypt_status_t *status);
+
+void mc_key_vault_snapshot_destroy(mc_key_vault_snapshot_t *kvs);
+
+// `mc_key_vault_snapshot_find` returns the key document with the `_id` `id`, or, if `id` is empty, a key document
+// with the keyAltName `alt_name`. Returns NULL if there is none.
+const _mongocrypt_buffer_t *mc_key_vault_snapshot_find(const mc_key_vault_snapshot_t *kvs,
+                                                       const _mongocrypt_buffer_t *id,
+                                                       _mongocrypt_key_alt_name_t *alt_name);
+
+#endif // MC_KEY_VAULT_SNAPSHOT_PRIVATE_H
@@ -0,0 +1,207 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mc-key-vault-snapshot-private.h"
+#include "mongocrypt-private.h"
+#include "mongocrypt-util-private.h"
+
+typedef struct {
+    _mongocrypt_buffer_t doc; // Views the key document in the snapshot.
+    _mongocrypt_buffer_t id;
+    _mongocrypt_key_alt_name_t *alt_names;
+} mc_key_vault_snapshot_entry_t;
+
+// A key document is indexed by one node for its `_id` and one for each keyAltName.
+typedef struct _mc_key_vault_snapshot_node_t {
+    uint32_t hash;
+    const mc_key_vault_snapshot_entry_t *entry;
+    struct _mc_key_vault_snapshot_node_t *next;
+} mc_key_vault_snapshot_node_t;
+
+struct _mc_key_vault_snapshot_t {
+    mc_key_vault_snapshot_entry_t *entries;
+    size_t num_entries;
+    // `buckets` has `num_buckets` chains of nodes. `num_buckets` is a power of two.
+    mc_key_vault_snapshot_node_t **buckets;
+    size_t num_buckets;
+};
+
+static uint32_t _hash_alt_name(_mongocrypt_key_alt_name_t *alt_name) {
+    const char *str = _mongocrypt_key_alt_name_get_string(alt_name);
+
+    return mc_hash_bytes(str, strlen(str));
+}
+
+static const mc_key_vault_snapshot_entry_t *
+_find(const mc_key_vault_snapshot_t *kvs, const _mongocrypt_buffer_t *id, _mongocrypt_key_alt_name_t *alt_name) {
+    const mc_key_vault_snapshot_node_t *node;
+    const bool by_id = id && !_mongocrypt_buffer_empty(id);
+    uint32_t hash;
+
+    hash = by_id ? mc_hash_bytes(id->data, id->len) : _hash_alt_name(alt_name);
+    for (node = kvs->buckets[hash & (kvs->num_buckets - 1)]; node != NULL; node = node->next) {
+        if (node->hash != hash) {
+            continue;
+        }
+        if (by_id) {
+            if (0 == _mongocrypt_buffer_cmp(&node->entry->id, id)) {
+                return node->entry;
+            }
+        } else if (_mongocrypt_key_alt_name_intersects(node->entry->alt_names, alt_name)) {
+            return node->entry;
+        }
+    }
+    return NULL;
+}
+
+static void _put(mc_key_vault_snapshot_t *kvs, uint32_t hash, const mc_key_vault_snapshot_entry_t *entry) {
+    mc_key_vault_snapshot_node_t *node;
+    size_t bucket;
+
+    node = bson_malloc0(sizeof(*node));
+    BSON_ASSERT(node);
+    node->hash = hash;
+    node->entry = entry;
+    bucket = hash & (kvs->num_buckets - 1);
+    node->next = kvs->buckets[bucket];
+    kvs->buckets[bucket] = node;
+}
+
+// `_next_doc` views the document at `*offset` of `docs` in `out` and advances `*offset` past it.
+static bool _next_doc(const _mongocrypt_buffer_t *docs, uint32_t *offset, bson_t *out) {
+    uint32_t doc_len;
+
+    if (docs->len - *offset < sizeof(doc_len)) {
+        return false;
+    }
+    memcpy(&doc_len, docs->data + *offset, sizeof(doc_len));
+    doc_len = BSON_UINT32_FROM_LE(doc_len);
+    if (doc_len > docs->len - *offset || !bson_init_static(out, docs->data + *offset, doc_len)) {
+        return false;
+    }
+    *offset += doc_len;
+    return true;
+}
+
+mc_key_vault_snapshot_t *mc_key_vault_snapshot_new(const _mongocrypt_buffer_t *docs, mongocrypt_status_t *status) {
+    mc_key_vault_snapshot_t *kvs;
+    uint32_t offset = 0;
+    size_t count = 0;
+    bson_t doc_bson;
+
+    BSON_ASSERT_PARAM(docs);
+
+    while (offset < docs->len) {
+        if (!_next_doc(docs, &offset, &doc_bson)) {
+            CLIENT_ERR("invalid key vault snapshot: malformed BSON at offset %" PRIu32, offset);
+            return NULL;
+        }
+        count++;
+    }
+
+    kvs = bson_malloc0(sizeof(*kvs));
+    BSON_ASSERT(kvs);
+    kvs->entries = bson_malloc0((count > 0 ? count : 1u) * sizeof(*kvs->entries));
+    BSON_ASSERT(kvs->entries);
+    kvs->num_buckets = 1;
+    while (kvs->num_buckets < count) {
+        kvs->num_buckets *= 2;
+    }
+    kvs->buckets = bson_malloc0(kvs->num_buckets * sizeof(*kvs->buckets));
+    BSON_ASSERT(kvs->buckets);
+
+    offset = 0;
+    while (offset < docs->len) {
+        mc_key_vault_snapshot_entry_t *entry;
+        _mongocrypt_key_doc_t *key_doc;
+        _mongocrypt_key_alt_name_t *alt_name;
+
+        BSON_ASSERT(_next_doc(docs, &offset, &doc_bson));
+        key_doc = _mongocrypt_key_new();
+        if (!_mongocrypt_key_parse_owned(&doc_bson, key_doc, status)) {
+            _mongocrypt_key_destroy(key_doc);
+            mc_key_vault_snapshot_destroy(kvs);
+            return NULL;
+        }
+
+        /* Lookups find the first of duplicate keys. */
+        if (_find(kvs, &key_doc->id, NULL)) {
+            _mongocrypt_key_destroy(key_doc);
+            continue;
+        }
+
+        entry = &kvs->entries[kvs->num_entries++];
+        _mongocrypt_buffer_from_bson(&entry->doc, &doc_bson);
+        _mongocrypt_buffer_copy_to(&key_doc->id, &entry->id);
+        entry->alt_names = _mongocrypt_key_alt_name_copy_all(key_doc->key_alt_names);
+        _mongocrypt_key_destroy(key_doc);
+
+        _put(kvs, mc_hash_bytes(entry->id.data, entry->id.len), entry);
+        for (alt_name = entry->alt_names; alt_name != NULL; alt_name = alt_name->next) {
+            _mongocrypt_key_alt_name_t *next = alt_name->next;
+            bool found;
+
+            /* Compare only this name. */
+            alt_name->next = NULL;
+            found = NULL != _find(kvs, NULL, alt_name);
+            alt_name->next = next;
+            if (!found) {
+                _put(kvs, _hash_alt_name(alt_name), entry);
+            }
+        }
+    }
+
+    return kvs;
+}
+
+void mc_key_vault_snapshot_destroy(mc_key_vault_snapshot_t *kvs) {
+    if (!kvs) {
+        return;
+    }
+
+    for (size_t i = 0; i < kvs->num_buckets; i++) {
+        mc_key_vault_snapshot_node_t *node = kvs->buckets[i];
+
+        while (node) {
+            mc_key_vault_snapshot_node_t *next = node->next;
+
+            bson_free(node);
+            node = next;
+        }
+    }
+    for (size_t i = 0; i < kvs->num_entries; i++) {
+        _mongocrypt_buffer_cleanup(&kvs->entries[i].id);
+        _mongocrypt_key_alt_name_destroy_all(kvs->entries[i].alt_names);
+    }
+    bson_free(kvs->buckets);
+    bson_free(kvs->entries);
+    bson_free(kvs);
+}
+
+const _mongocrypt_buffer_t *mc_key_vault_snapshot_find(const mc_key_vault_snapshot_t *kvs,
+                                                       const _mongocrypt_buffer_t *id,
+                                                       _mongocrypt_key_alt_name_t *alt_name) {
+    const mc_key_vault_snapshot_entry_t *entry;
+
+    BSON_ASSERT_PARAM(id);
+
+    if (!kvs || (_mongocrypt_buffer_empty(id) && !alt_name)) {
+        return NULL;
+    }
+
+    entry = _find(kvs, id, alt_name);
+    return entry ? &entry->doc : NULL;
+}
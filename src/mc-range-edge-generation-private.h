@@ -19,6 +19,7 @@
 
 #include "mc-dec128.h"
 #include "mc-optional-private.h"
+#include "mc-range-encoding-private.h"
 #include "mongocrypt-status-private.h"
 #include <mlib/int128.h>
 #include <stddef.h> // size_t
@@ -40,6 +41,20 @@ void mc_edges_destroy(mc_edges_t *edges);
 // mc_edges_is_leaf returns whether the given edge is the leaf node of the edge set.
 bool mc_edges_is_leaf(const mc_edges_t *edges, const char *edge);
 
+// mc_edges_iter_t visits the edges of an mc_edges_t in the order of mc_edges_get.
+typedef struct {
+    const mc_edges_t *edges;
+    size_t index;
+} mc_edges_iter_t;
+
+// mc_edges_iter_init initializes `it` to the first edge of `edges`.
+void mc_edges_iter_init(mc_edges_iter_t *it, const mc_edges_t *edges);
+
+// mc_edges_iter_next advances `it` and returns false after the last edge. On
+// success `edge` points at the NUL-terminated edge owned by the edges, `len` is
+// its length, and `is_leaf` is whether it is the leaf. No string is scanned.
+bool mc_edges_iter_next(mc_edges_iter_t *it, const char **edge, size_t *len, bool *is_leaf);
+
 typedef struct {
     int32_t value;
     mc_optional_int32_t min;
@@ -71,6 +86,7 @@ typedef struct {
     mc_optional_double_t max;
     mc_optional_uint32_t precision;
     uint32_t trimFactor;
+    const mc_DoubleScale_t *scale; /* may be NULL. See mc_getTypeInfoDouble_args_t. */
 } mc_getEdgesDouble_args_t;
 
 // mc_getEdgesDouble implements the Edge Generation algorithm described in
@@ -23,9 +23,13 @@
 
 struct _mc_edges_t {
     size_t sparsity;
-    /* edges is an array of `char*` edge strings. */
-    mc_array_t edges;
-    char *leaf;
+    /* offsets is an array of `size_t` offsets of each edge string in `strs`. */
+    mc_small_array_t offsets;
+    /* strs holds all NUL-terminated edge strings in one allocation. Every edge
+     * other than "root" is a prefix of the leaf. */
+    char *strs;
+    size_t strs_len;
+    size_t leaf_offset;
 };
 
 static mc_edges_t *mc_edges_new(const char *leaf, size_t sparsity, uint32_t trimFactor, mongocrypt_status_t *status) {
@@ -44,55 +48,71 @@ static mc_edges_t *mc_edges_new(const char *leaf, size_t sparsity, uint32_t trim
         return NULL;
     }
 
+    // Start loop at max(trimFactor, 1). The full leaf is unconditionally appended before the loop.
+    const size_t startLevel = trimFactor > 0 ? trimFactor : 1;
+    const char root[] = "root";
+
+    // Size the string storage up front so all edges share one allocation.
+    size_t strs_len = leaf_len + 1u;
+    if (trimFactor == 0) {
+        strs_len += sizeof(root);
+    }
+    for (size_t i = startLevel; i < leaf_len; i++) {
+        if (i % sparsity == 0) {
+            strs_len += i + 1u;
+        }
+    }
+
     mc_edges_t *edges = bson_malloc0(sizeof(mc_edges_t));
     edges->sparsity = sparsity;
-    _mc_array_init(&edges->edges, sizeof(char *));
-    edges->leaf = bson_strdup(leaf);
+    _mc_small_array_init(&edges->offsets, sizeof(size_t));
+    edges->strs = bson_malloc(strs_len);
+    edges->strs_len = strs_len;
 
+    size_t offset = 0;
     if (trimFactor == 0) {
-        char *root = bson_strdup("root");
-        _mc_array_append_val(&edges->edges, root);
+        memcpy(edges->strs, root, sizeof(root));
+        _mc_array_append_val(&edges->offsets.array, offset);
+        offset += sizeof(root);
     }
 
-    char *leaf_copy = bson_strdup(leaf);
-    _mc_array_append_val(&edges->edges, leaf_copy);
+    memcpy(edges->strs + offset, leaf, leaf_len + 1u);
+    edges->leaf_offset = offset;
+    _mc_array_append_val(&edges->offsets.array, offset);
+    offset += leaf_len + 1u;
 
-    // Start loop at max(trimFactor, 1). The full leaf is unconditionally appended after loop.
-    size_t startLevel = trimFactor > 0 ? trimFactor : 1;
     for (size_t i = startLevel; i < leaf_len; i++) {
         if (i % sparsity == 0) {
-            char *edge = bson_malloc(i + 1);
-            bson_strncpy(edge, leaf, i + 1);
-            _mc_array_append_val(&edges->edges, edge);
+            memcpy(edges->strs + offset, leaf, i);
+            edges->strs[offset + i] = '\0';
+            _mc_array_append_val(&edges->offsets.array, offset);
+            offset += i + 1u;
         }
     }
+    BSON_ASSERT(offset == strs_len);
 
     return edges;
 }
 
 const char *mc_edges_get(mc_edges_t *edges, size_t index) {
     BSON_ASSERT_PARAM(edges);
-    if (edges->edges.len == 0 || index > edges->edges.len - 1u) {
+    if (edges->offsets.array.len == 0 || index > edges->offsets.array.len - 1u) {
         return NULL;
     }
-    return _mc_array_index(&edges->edges, char *, index);
+    return edges->strs + _mc_array_index(&edges->offsets.array, size_t, index);
 }
 
 size_t mc_edges_len(mc_edges_t *edges) {
     BSON_ASSERT_PARAM(edges);
-    return edges->edges.len;
+    return edges->offsets.array.len;
 }
 
 void mc_edges_destroy(mc_edges_t *edges) {
     if (NULL == edges) {
         return;
     }
-    for (size_t i = 0; i < edges->edges.len; i++) {
-        char *val = _mc_array_index(&edges->edges, char *, i);
-        bson_free(val);
-    }
-    _mc_array_destroy(&edges->edges);
-    bson_free(edges->leaf);
+    _mc_array_destroy(&edges->offsets.array);
+    bson_free(edges->strs);
     bson_free(edges);
 }
 
@@ -100,45 +120,93 @@ bool mc_edges_is_leaf(const mc_edges_t *edges, const char *edge) {
     BSON_ASSERT_PARAM(edges);
     BSON_ASSERT_PARAM(edge);
 
-    return strcmp(edge, edges->leaf) == 0;
+    const char *leaf = edges->strs + edges->leaf_offset;
+    // The leaf returned by mc_edges_get is recognized without comparing strings.
+    if (edge == leaf) {
+        return true;
+    }
+    return strcmp(edge, leaf) == 0;
+}
+
+void mc_edges_iter_init(mc_edges_iter_t *it, const mc_edges_t *edges) {
+    BSON_ASSERT_PARAM(it);
+    BSON_ASSERT_PARAM(edges);
+
+    it->edges = edges;
+    it->index = 0;
+}
+
+bool mc_edges_iter_next(mc_edges_iter_t *it, const char **edge, size_t *len, bool *is_leaf) {
+    BSON_ASSERT_PARAM(it);
+    BSON_ASSERT_PARAM(edge);
+    BSON_ASSERT_PARAM(len);
+    BSON_ASSERT_PARAM(is_leaf);
+
+    const mc_edges_t *edges = it->edges;
+    if (it->index >= edges->offsets.array.len) {
+        return false;
+    }
+
+    const size_t offset = _mc_array_index(&edges->offsets.array, size_t, it->index);
+    // Edges are stored back to back, so the next offset (or the end of the
+    // storage) is one past this edge's NUL.
+    const size_t end = it->index + 1u < edges->offsets.array.len
+                         ? _mc_array_index(&edges->offsets.array, size_t, it->index + 1u)
+                         : edges->strs_len;
+    *edge = edges->strs + offset;
+    *len = end - offset - 1u;
+    *is_leaf = offset == edges->leaf_offset;
+    it->index++;
+    return true;
+}
+
+// Each nibble of the input is written as four characters at once.
+static const char _nibble_bits[16][4] = {
+    {'0', '0', '0', '0'},
+    {'0', '0', '0', '1'},
+    {'0', '0', '1', '0'},
+    {'0', '0', '1', '1'},
+    {'0', '1', '0', '0'},
+    {'0', '1', '0', '1'},
+    {'0', '1', '1', '0'},
+    {'0', '1', '1', '1'},
+    {'1', '0', '0', '0'},
+    {'1', '0', '0', '1'},
+    {'1', '0', '1', '0'},
+    {'1', '0', '1', '1'},
+    {'1', '1', '0', '0'},
+    {'1', '1', '0', '1'},
+    {'1', '1', '1', '0'},
+    {'1', '1', '1', '1'},
+};
+
+// Writes the `nbits` low bits of `in` to `out`, most significant first.
+// `nbits` must be a multiple of 4.
+static void _write_bits(char *out, uint64_t in, int nbits) {
+    for (int shift = nbits - 4; shift >= 0; shift -= 4) {
+        memcpy(out, _nibble_bits[(in >> shift) & 0xF], 4);
+        out += 4;
+    }
 }
 
 mc_bitstring mc_convert_to_bitstring_u64(uint64_t in) {
     mc_bitstring ret = {{0}};
-    char *out = ret.str;
-    uint64_t bit = UINT64_C(1) << 63;
-    int loops = 0; // used to determine a bit shift
-    while (bit > 0) {
-        *out++ = (char)('0' + ((bit & in) >> (63 - loops)));
-        bit >>= 1;
-        loops++;
-    }
+    _write_bits(ret.str, in, 64);
     return ret;
 }
 
 mc_bitstring mc_convert_to_bitstring_u32(uint32_t in) {
     mc_bitstring ret = {{0}};
-    char *out = ret.str;
-    uint32_t bit = UINT32_C(1) << 31;
-    while (bit > 0) {
-        if (bit & in) {
-            *out++ = '1';
-        } else {
-            *out++ = '0';
-        }
-        bit >>= 1;
-    }
+    _write_bits(ret.str, in, 32);
     return ret;
 }
 
 mc_bitstring mc_convert_to_bitstring_u128(mlib_int128 i) {
     const uint64_t lo = mlib_int128_to_u64(i);
     const uint64_t hi = mlib_int128_to_u64(mlib_int128_rshift(i, 64));
-    mc_bitstring his = mc_convert_to_bitstring_u64(hi);
-    mc_bitstring los = mc_convert_to_bitstring_u64(lo);
     mc_bitstring ret = {{0}};
-    const size_t off = mlib_strnmcopy(ret.str, sizeof ret.str, his.str, sizeof his.str);
-    mlib_strnmcopy(ret.str + off, (sizeof ret.str) - off, los.str, sizeof los.str);
+    _write_bits(ret.str, hi, 64);
+    _write_bits(ret.str + 64, lo, 64);
     return ret;
 }
 
@@ -187,7 +255,8 @@ mc_edges_t *mc_getEdgesDouble(mc_getEdgesDouble_args_t args, mongocrypt_status_t
     if (!mc_getTypeInfoDouble((mc_getTypeInfoDouble_args_t){.value = args.value,
                                                             .min = args.min,
                                                             .max = args.max,
-                                                            .precision = args.precision},
+                                                            .precision = args.precision,
+                                                            .scale = args.scale},
                               &got,
                               status)) {
         return NULL;
@@ -79,11 +79,37 @@ typedef struct {
     uint64_t max;
 } mc_OSTType_Double;
 
+/* Subnormal representations can support up to 5x10^-324 as a number. */
+#define MC_MAX_DOUBLE_PRECISION 324
+
+/* mc_DoubleScale_t is what encoding a double with min, max, and precision set
+ * derives from only those three, so values of one field need not repeat it. */
+typedef struct {
+    double min;
+    double scale; /* 10^precision. */
+    /* False if the scaled range does not fit 64 bits, in which case doubles
+     * are encoded as if precision was unset. */
+    bool use_precision_mode;
+    uint64_t max_value; /* the encoded maximum, if use_precision_mode. */
+} mc_DoubleScale_t;
+
+/* mc_DoubleScale_init computes the scale of doubles in [min, max] with
+ * precision @precision. Returns false and sets `status` if min is not less than
+ * max or precision exceeds MC_MAX_DOUBLE_PRECISION. */
+bool mc_DoubleScale_init(mc_DoubleScale_t *out,
+                         double min,
+                         double max,
+                         uint32_t precision,
+                         mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
 typedef struct {
     double value;
     mc_optional_double_t min;
     mc_optional_double_t max;
     mc_optional_uint32_t precision;
+    /* May be NULL. Otherwise the scale of `min`, `max`, and `precision`, which
+     * must be set. */
+    const mc_DoubleScale_t *scale;
 } mc_getTypeInfoDouble_args_t;
 
 /* mc_getTypeInfoDouble encodes the double `args.value` into an OSTType_Double
@@ -19,6 +19,8 @@
 #include "mongocrypt-private.h"
 #include "mongocrypt-util-private.h" // mc_isinf
 
+#include <mlib/thread.h>
+
 #include <math.h> // pow
 
 /* mc-range-encoding.c assumes integers are encoded with two's complement for
@@ -161,7 +163,77 @@ bool mc_getTypeInfo64(mc_getTypeInfo64_args_t args, mc_OSTType_Int64 *out, mongo
     return true;
 }
 
-#define exp10Double(x) pow(10, x)
+/* Powers of ten by precision, computed once with pow so values match what
+ * computing them each time gives. */
+static double _exp10_table[MC_MAX_DOUBLE_PRECISION + 1];
+static mlib_once_flag _exp10_table_once = MLIB_ONCE_INITIALIZER;
+
+static void _exp10_table_init(void) {
+    for (uint32_t i = 0; i <= MC_MAX_DOUBLE_PRECISION; i++) {
+        _exp10_table[i] = pow(10, i);
+    }
+}
+
+static double exp10Double(uint32_t precision) {
+    BSON_ASSERT(precision <= MC_MAX_DOUBLE_PRECISION);
+    BSON_ASSERT(mlib_call_once(&_exp10_table_once, _exp10_table_init));
+    return _exp10_table[precision];
+}
+
+bool mc_DoubleScale_init(mc_DoubleScale_t *out,
+                         double min,
+                         double max,
+                         uint32_t precision,
+                         mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(out);
+
+    *out = (mc_DoubleScale_t){.min = min};
+
+    if (min >= max) {
+        CLIENT_ERR("The minimum value must be less than the maximum value, got "
+                   "min: %g, max: %g",
+                   min,
+                   max);
+        return false;
+    }
+
+    if (precision > MC_MAX_DOUBLE_PRECISION) {
+        CLIENT_ERR("Precision must be between 0 and 324 inclusive, got: %" PRIu32, precision);
+        return false;
+    }
+
+    // When we use precision mode, we try to represent as a double value that
+    // fits in [-2^63, 2^63] (i.e. is a valid int64)
+    //
+    // This check determines if we can represent the precision truncated value as
+    // a 64-bit integer I.e. Is ((ub - lb) * 10^precision) < 64 bits.
+    //
+    out->scale = exp10Double(precision);
+    double range = max - min;
+
+    // We can overflow if max = max double and min = min double so make sure
+    // we have finite number after we do subtraction
+    // Ignore conversion warnings to fix error with glibc.
+    if (mc_isfinite(range)) {
+        // This creates a range which is wider then we permit by our min/max
+        // bounds check with the +1 but it is as the algorithm is written in
+        // WRITING-11907.
+        double rangeAndPrecision = (range + 1) * out->scale;
+
+        if (mc_isfinite(rangeAndPrecision)) {
+            double bits_range_double = log2(rangeAndPrecision);
+            uint32_t bits_range = (uint32_t)ceil(bits_range_double);
+
+            if (bits_range < 64) {
+                out->use_precision_mode = true;
+                // Adjust maximum value to be the max bit range. This will be used by
+                // getEdges/minCover to trim bits.
+                out->max_value = (UINT64_C(1) << bits_range) - 1;
+            }
+        }
+    }
+    return true;
+}
 
 bool mc_getTypeInfoDouble(mc_getTypeInfoDouble_args_t args, mc_OSTType_Double *out, mongocrypt_status_t *status) {
     if (args.min.set != args.max.set || args.min.set != args.precision.set) {
@@ -201,60 +273,31 @@ bool mc_getTypeInfoDouble(mc_getTypeInfoDouble_args_t args, mc_OSTType_Double *o
         args.value = 0.0;
     }
 
-    // When we use precision mode, we try to represent as a double value that
-    // fits in [-2^63, 2^63] (i.e. is a valid int64)
-    //
-    // This check determines if we can represent the precision truncated value as
-    // a 64-bit integer I.e. Is ((ub - lb) * 10^precision) < 64 bits.
-    //
-    bool use_precision_mode = false;
-    uint32_t bits_range;
     if (args.precision.set) {
-        // Subnormal representations can support up to 5x10^-324 as a number
-        if (args.precision.value > 324) {
-            CLIENT_ERR("Precision must be between 0 and 324 inclusive, got: %" PRIu32, args.precision.value);
-            return false;
-        }
+        mc_DoubleScale_t computed;
+        const mc_DoubleScale_t *scale = args.scale;
 
-        double range = args.max.value - args.min.value;
-
-        // We can overflow if max = max double and min = min double so make sure
-        // we have finite number after we do subtraction
-        // Ignore conversion warnings to fix error with glibc.
-        if (mc_isfinite(range)) {
-            // This creates a range which is wider then we permit by our min/max
-            // bounds check with the +1 but it is as the algorithm is written in
-            // WRITING-11907.
-            double rangeAndPrecision = (range + 1) * exp10Double(args.precision.value);
-
-            if (mc_isfinite(rangeAndPrecision)) {
-                double bits_range_double = log2(rangeAndPrecision);
-                bits_range = (uint32_t)ceil(bits_range_double);
-
-                if (bits_range < 64) {
-                    use_precision_mode = true;
-                }
+        if (!scale) {
+            if (!mc_DoubleScale_init(&computed, args.min.value, args.max.value, args.precision.value, status)) {
+                return false;
             }
+            scale = &computed;
         }
-    }
-
-    if (use_precision_mode) {
-        // Take a number of xxxx.ppppp and truncate it xxxx.ppp if precision = 3.
-        // We do not change the digits before the decimal place.
-        double v_prime = trunc(args.value * exp10Double(args.precision.value)) / exp10Double(args.precision.value);
-        int64_t v_prime2 = (int64_t)((v_prime - args.min.value) * exp10Double(args.precision.value));
 
-        BSON_ASSERT(v_prime2 < INT64_MAX && v_prime2 >= 0);
+        if (scale->use_precision_mode) {
+            // Take a number of xxxx.ppppp and truncate it xxxx.ppp if precision = 3.
+            // We do not change the digits before the decimal place.
+            double v_prime = trunc(args.value * scale->scale) / scale->scale;
+            int64_t v_prime2 = (int64_t)((v_prime - scale->min) * scale->scale);
 
-        uint64_t ret = (uint64_t)v_prime2;
+            BSON_ASSERT(v_prime2 < INT64_MAX && v_prime2 >= 0);
 
-        // Adjust maximum value to be the max bit range. This will be used by
-        // getEdges/minCover to trim bits.
-        uint64_t max_value = (UINT64_C(1) << bits_range) - 1;
-        BSON_ASSERT(ret <= max_value);
+            uint64_t ret = (uint64_t)v_prime2;
+            BSON_ASSERT(ret <= scale->max_value);
 
-        *out = (mc_OSTType_Double){ret, 0, max_value};
-        return true;
+            *out = (mc_OSTType_Double){ret, 0, scale->max_value};
+            return true;
+        }
     }
 
     // Translate double to uint64 by modifying the bit representation and copying
@@ -324,6 +367,48 @@ static mlib_int128 dec128_to_int128(mc_dec128 dec) {
     return ret;
 }
 
+// 10^34 - 1: The largest coefficient of a Decimal128
+static const mlib_int128 dec128_cmax = MLIB_INT128_FROM_PARTS(0x378d8e63ffffffffull, 0x0001ed09bead87c0ull);
+// 10^33 - 1: The largest integer with fewer than 34 decimal digits
+static const mlib_int128 dec128_cmax_div_ten = MLIB_INT128_FROM_PARTS(0x38c15b09ffffffffull, 0x0000314dc6448d93ull);
+
+/**
+ * @brief Compute trunc(dec × 10^precision) from the coefficient and exponent
+ * of `dec`, without Decimal128 arithmetic.
+ *
+ * @param exact If true, fail rather than truncate any non-zero digits.
+ * @param out Receives the result as a two's complement signed integer.
+ * @return false if the result may have 34 or more digits; otherwise true.
+ */
+static bool dec128_scaled_to_int128(mc_dec128 dec, uint32_t precision, bool exact, mlib_int128 *out) {
+    const mlib_int128 coeff = mc_dec128_coeff(dec);
+    if (mlib_int128_ucmp(coeff, dec128_cmax) > 0) {
+        // Non-canonical coefficient. Let the Decimal128 library handle it.
+        return false;
+    }
+
+    const int64_t shift = (int64_t)mc_dec128_get_biased_exp(dec) - MC_DEC128_EXPONENT_BIAS + (int64_t)precision;
+    mlib_int128 mag;
+    if (mlib_int128_eq(coeff, MLIB_INT128(0))) {
+        mag = coeff;
+    } else if (shift >= 0) {
+        if (shift > 33 || mlib_int128_ucmp(coeff, mlib_int128_pow10((uint8_t)(33 - shift))) >= 0) {
+            return false;
+        }
+        mag = mlib_int128_mul(coeff, mlib_int128_pow10((uint8_t)shift));
+    } else if (exact) {
+        return false;
+    } else if (shift < -34) {
+        // Every digit of the coefficient is truncated
+        mag = MLIB_INT128(0);
+    } else {
+        mag = mlib_int128_div(coeff, mlib_int128_pow10((uint8_t)-shift));
+    }
+
+    *out = mc_dec128_is_negative(dec) ? mlib_int128_negate(mag) : mag;
+    return true;
+}
+
 bool mc_getTypeInfoDecimal128(mc_getTypeInfoDecimal128_args_t args,
                               mc_OSTType_Decimal128 *out,
                               mongocrypt_status_t *status) {
@@ -430,6 +515,26 @@ bool mc_getTypeInfoDecimal128(mc_getTypeInfoDecimal128_args_t args,
 
     if (use_precision_mode) {
         BSON_ASSERT(args.precision.set);
+
+        // Resulting OST maximum
+        mlib_int128 ost_max = mlib_int128_sub(mlib_int128_pow2(bits_range), i128_one);
+
+        // If min×10^precision is an integer, and it and trunc(value×10^precision)
+        // both have fewer than 34 digits, every Decimal128 operation below is
+        // exact and the result is simply their difference. Compute it in the
+        // integer domain.
+        mlib_int128 value_scaled_int, min_scaled_int;
+        if (args.precision.value <= MC_DEC128_EXPONENT_BIAS
+            && dec128_scaled_to_int128(args.value, args.precision.value, false, &value_scaled_int)
+            && dec128_scaled_to_int128(args.min.value, args.precision.value, true, &min_scaled_int)) {
+            *out = (mc_OSTType_Decimal128){
+                .value = mlib_int128_sub(value_scaled_int, min_scaled_int),
+                .min = i128_zero,
+                .max = ost_max,
+            };
+            return true;
+        }
+
         // Example value: 31.4159
         // Example Precision = 2
 
@@ -458,9 +563,6 @@ bool mc_getTypeInfoDecimal128(mc_getTypeInfoDecimal128_args_t args,
 
         BSON_ASSERT(mc_dec128_less(mc_dec128_log2(v_prime2), MC_DEC128(128)));
 
-        // Resulting OST maximum
-        mlib_int128 ost_max = mlib_int128_sub(mlib_int128_pow2(bits_range), i128_one);
-
         // Now we need to get the Decimal128 out as a 128-bit integer
         // But Decimal128 does not support conversion to Int128.
         //
@@ -515,8 +617,8 @@ bool mc_getTypeInfoDecimal128(mc_getTypeInfoDecimal128_args_t args,
     const bool isNegative = mc_dec128_is_negative(args.value);
 
     // cMax = 10^34 - 1 (The largest integer representable in Decimal128)
-    const mlib_int128 cMax = mlib_int128_sub(mlib_int128_pow10(34), MLIB_INT128_CAST(1));
-    const mlib_int128 cMax_div_ten = mlib_int128_div(cMax, i128_ten);
+    const mlib_int128 cMax = dec128_cmax;
+    const mlib_int128 cMax_div_ten = dec128_cmax_div_ten;
 
     // The biased exponent from the decimal number. The paper refers to the
     // expression (e - e_min), which is the value of the biased exponent.
@@ -164,25 +164,29 @@ static inline bool DECORATE_NAME(MinCoverGenerator_isLevelStored)(DECORATE_NAME(
     return 0 == maskedBits || (level >= mcg->_trimFactor && 0 == (level % mcg->_sparsity));
 }
 
-char *
-DECORATE_NAME(MinCoverGenerator_toString)(DECORATE_NAME(MinCoverGenerator) * mcg, UINT_T start, size_t maskedBits) {
+// MinCoverGenerator_append appends the string form of the edge to `c`.
+static inline void DECORATE_NAME(MinCoverGenerator_append)(DECORATE_NAME(MinCoverGenerator) * mcg,
+                                                           mc_mincover_t *c,
+                                                           UINT_T start,
+                                                           size_t maskedBits) {
     BSON_ASSERT_PARAM(mcg);
+    BSON_ASSERT_PARAM(c);
     BSON_ASSERT(maskedBits <= mcg->_maxlen);
     BSON_ASSERT(maskedBits <= (size_t)BITS);
     BSON_ASSERT(maskedBits >= 0);
 
     if (maskedBits == mcg->_maxlen) {
-        return bson_strdup("root");
+        mc_mincover_append(c, "root", strlen("root"));
+        return;
     }
 
     UINT_T shifted = UINT_LSHIFT(start, -(int)maskedBits);
     mc_bitstring valueBin = DECORATE_NAME(mc_convert_to_bitstring)(shifted);
-    char *ret = bson_strndup(valueBin.str + ((size_t)BITS - mcg->_maxlen + maskedBits), mcg->_maxlen + maskedBits);
-    return ret;
+    mc_mincover_append(c, valueBin.str + ((size_t)BITS - mcg->_maxlen + maskedBits), mcg->_maxlen - maskedBits);
 }
 
 static inline void DECORATE_NAME(MinCoverGenerator_minCoverRec)(DECORATE_NAME(MinCoverGenerator) * mcg,
-                                                                mc_array_t *c,
+                                                                mc_mincover_t *c,
                                                                 UINT_T blockStart,
                                                                 size_t maskedBits) {
     BSON_ASSERT_PARAM(mcg);
@@ -195,8 +199,7 @@ static inline void DECORATE_NAME(MinCoverGenerator_minCoverRec)(DECORATE_NAME(Mi
 
     if (UINT_COMPARE(blockStart, mcg->_rangeMin) >= 0 && UINT_COMPARE(blockEnd, mcg->_rangeMax) <= 0
         && DECORATE_NAME(MinCoverGenerator_isLevelStored)(mcg, maskedBits)) {
-        char *edge = DECORATE_NAME(MinCoverGenerator_toString)(mcg, blockStart, maskedBits);
-        _mc_array_append_val(c, edge);
+        DECORATE_NAME(MinCoverGenerator_append)(mcg, c, blockStart, maskedBits);
         return;
     }
 
@@ -212,7 +215,7 @@ static inline mc_mincover_t *DECORATE_NAME(MinCoverGenerator_minCover)(DECORATE_
     BSON_ASSERT_PARAM(mcg);
     mc_mincover_t *mc = mc_mincover_new();
     DECORATE_NAME(MinCoverGenerator_minCoverRec)
-    (mcg, &mc->mincover, ZERO, mcg->_maxlen);
+    (mcg, mc, ZERO, mcg->_maxlen);
     return mc;
 }
 
@@ -19,6 +19,7 @@
 
 #include "mc-dec128.h"
 #include "mc-optional-private.h"
+#include "mc-range-encoding-private.h"
 #include "mongocrypt-status-private.h"
 #include <stddef.h> // size_t
 #include <stdint.h>
@@ -36,6 +37,9 @@ size_t mc_mincover_len(mc_mincover_t *mincover);
 // mc_mincover_destroys frees `mincover`.
 void mc_mincover_destroy(mc_mincover_t *mincover);
 
+// mc_mincover_copy returns a new copy of `mincover`.
+mc_mincover_t *mc_mincover_copy(const mc_mincover_t *mincover);
+
 typedef struct {
     int32_t lowerBound;
     bool includeLowerBound;
@@ -78,6 +82,7 @@ typedef struct {
     mc_optional_double_t max;
     mc_optional_uint32_t precision;
     uint32_t trimFactor;
+    const mc_DoubleScale_t *scale; /* may be NULL. See mc_getTypeInfoDouble_args_t. */
 } mc_getMincoverDouble_args_t;
 
 // mc_getMincoverDouble implements the Mincover Generation algorithm described
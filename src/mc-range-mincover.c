@@ -25,41 +25,65 @@
 #include "mongocrypt-private.h"
 
 struct _mc_mincover_t {
-    /* mincover is an array of `char*` edge strings. */
-    mc_array_t mincover;
+    /* offsets is an array of `size_t` offsets of each edge string in `strs`. */
+    mc_small_array_t offsets;
+    /* strs is an array of `char` holding all NUL-terminated edge strings. */
+    mc_small_array_t strs;
 };
 
 static mc_mincover_t *mc_mincover_new(void) {
     mc_mincover_t *mincover = bson_malloc0(sizeof(mc_mincover_t));
-    _mc_array_init(&mincover->mincover, sizeof(char *));
+    _mc_small_array_init(&mincover->offsets, sizeof(size_t));
+    _mc_small_array_init(&mincover->strs, sizeof(char));
     return mincover;
 }
 
+// mc_mincover_append appends the first `len` characters of `str` as an edge.
+static void mc_mincover_append(mc_mincover_t *mincover, const char *str, size_t len) {
+    BSON_ASSERT_PARAM(mincover);
+    BSON_ASSERT_PARAM(str);
+    BSON_ASSERT(len < UINT32_MAX);
+
+    const char nul = '\0';
+    const size_t offset = mincover->strs.array.len;
+    _mc_array_append_vals(&mincover->strs.array, str, (uint32_t)len);
+    _mc_array_append_val(&mincover->strs.array, nul);
+    _mc_array_append_val(&mincover->offsets.array, offset);
+}
+
 const char *mc_mincover_get(mc_mincover_t *mincover, size_t index) {
     BSON_ASSERT_PARAM(mincover);
-    if (mincover->mincover.len == 0 || index > mincover->mincover.len - 1u) {
+    if (mincover->offsets.array.len == 0 || index > mincover->offsets.array.len - 1u) {
         return NULL;
     }
-    return _mc_array_index(&mincover->mincover, char *, index);
+    return &_mc_array_index(&mincover->strs.array,
+                            char,
+                            _mc_array_index(&mincover->offsets.array, size_t, index));
 }
 
 size_t mc_mincover_len(mc_mincover_t *mincover) {
     BSON_ASSERT_PARAM(mincover);
-    return mincover->mincover.len;
+    return mincover->offsets.array.len;
 }
 
 void mc_mincover_destroy(mc_mincover_t *mincover) {
     if (NULL == mincover) {
         return;
     }
-    for (size_t i = 0; i < mincover->mincover.len; i++) {
-        char *val = _mc_array_index(&mincover->mincover, char *, i);
-        bson_free(val);
-    }
-    _mc_array_destroy(&mincover->mincover);
+    _mc_array_destroy(&mincover->offsets.array);
+    _mc_array_destroy(&mincover->strs.array);
     bson_free(mincover);
 }
 
+mc_mincover_t *mc_mincover_copy(const mc_mincover_t *mincover) {
+    BSON_ASSERT_PARAM(mincover);
+
+    mc_mincover_t *copy = mc_mincover_new();
+    _mc_array_copy(&copy->offsets.array, &mincover->offsets.array);
+    _mc_array_copy(&copy->strs.array, &mincover->strs.array);
+    return copy;
+}
+
 #define UINT_T uint32_t
 #define UINT_C UINT32_C
 #define UINT_FMT_S PRIu32
@@ -197,11 +221,23 @@ mc_mincover_t *mc_getMincoverDouble(mc_getMincoverDouble_args_t args, mongocrypt
     BSON_ASSERT_PARAM(status);
     CHECK_BOUNDS(args, "g", IDENTITY, LESSTHAN);
 
+    // Both bounds share the scale of the field. Invalid options are left for
+    // mc_getTypeInfoDouble to report in its usual order.
+    mc_DoubleScale_t scale;
+    if (args.precision.set && !args.scale && args.min.set && args.max.set && args.min.value < args.max.value
+        && args.precision.value <= MC_MAX_DOUBLE_PRECISION) {
+        if (!mc_DoubleScale_init(&scale, args.min.value, args.max.value, args.precision.value, status)) {
+            return NULL;
+        }
+        args.scale = &scale;
+    }
+
     mc_OSTType_Double a, b;
     if (!mc_getTypeInfoDouble((mc_getTypeInfoDouble_args_t){.value = args.lowerBound,
                                                             .min = args.min,
                                                             .max = args.max,
-                                                            .precision = args.precision},
+                                                            .precision = args.precision,
+                                                            .scale = args.scale},
                               &a,
                               status)) {
         return NULL;
@@ -209,7 +245,8 @@ mc_mincover_t *mc_getMincoverDouble(mc_getMincoverDouble_args_t args, mongocrypt
     if (!mc_getTypeInfoDouble((mc_getTypeInfoDouble_args_t){.value = args.upperBound,
                                                             .min = args.min,
                                                             .max = args.max,
-                                                            .precision = args.precision},
+                                                            .precision = args.precision,
+                                                            .scale = args.scale},
                               &b,
                               status)) {
         return NULL;
@@ -38,6 +38,10 @@ typedef struct {
     int64_t sparsity;
     mc_optional_uint32_t precision;
     mc_optional_uint32_t trimFactor;
+
+    // domainBits is the result of mc_getNumberOfBits for the type of min. It is
+    // precomputed by mc_RangeOpts_parse if trimFactor, min, and max are set.
+    mc_optional_uint32_t domainBits;
 } mc_RangeOpts_t;
 
 /* mc_RangeOpts_parse parses a BSON document into mc_RangeOpts_t.
@@ -101,6 +105,17 @@ bool mc_RangeOpts_appendTrimFactor(const mc_RangeOpts_t *ro,
                                    bson_t *out,
                                    mongocrypt_status_t *status);
 
+/* mc_getNumberOfBits returns the number of bits required to represent any
+ * value in the domain of `valueType` bounded by `ro->min` and `ro->max`. */
+bool mc_getNumberOfBits(const mc_RangeOpts_t *ro,
+                        bson_type_t valueType,
+                        uint32_t *bitsOut,
+                        mongocrypt_status_t *status);
+
+/* mc_RangeOpts_copy copies the parsed options `src` into `dst`. `dst` must be
+ * cleaned up with mc_RangeOpts_cleanup. */
+void mc_RangeOpts_copy(mc_RangeOpts_t *dst, const mc_RangeOpts_t *src);
+
 void mc_RangeOpts_cleanup(mc_RangeOpts_t *ro);
 
 #endif // MC_RANGEOPTS_PRIVATE_H
@@ -197,12 +197,37 @@ bool mc_RangeOpts_parse(mc_RangeOpts_t *ro, const bson_t *in, bool use_range_v2,
             return false;
         }
         // At this point, we do not know the type of the field if min and max are unspecified. Wait to
-        // validate the value of trimFactor.
+        // validate the value of trimFactor. If they are specified, precompute the number of bits of the
+        // domain to validate it with. Errors are reported when trimFactor is validated.
+        if (ro->min.set && ro->max.set) {
+            mongocrypt_status_t *ignored = mongocrypt_status_new();
+            uint32_t nbits;
+            if (mc_getNumberOfBits(ro, bson_iter_type(&ro->min.value), &nbits, ignored)) {
+                ro->domainBits = OPT_U32(nbits);
+            }
+            mongocrypt_status_destroy(ignored);
+        }
     }
 
     return true;
 }
 
+void mc_RangeOpts_copy(mc_RangeOpts_t *dst, const mc_RangeOpts_t *src) {
+    BSON_ASSERT_PARAM(dst);
+    BSON_ASSERT_PARAM(src);
+
+    *dst = *src;
+    dst->bson = bson_copy(src->bson);
+
+    // Point min and max into the copy. Fields are unique, as checked by mc_RangeOpts_parse.
+    if (src->min.set) {
+        BSON_ASSERT(bson_iter_init_find(&dst->min.value, dst->bson, "min"));
+    }
+    if (src->max.set) {
+        BSON_ASSERT(bson_iter_init_find(&dst->max.value, dst->bson, "max"));
+    }
+}
+
 #undef ERROR_PREFIX
 #define ERROR_PREFIX "Error making FLE2RangeInsertSpec"
 
@@ -382,6 +407,11 @@ bool mc_getNumberOfBits(const mc_RangeOpts_t *ro,
     BSON_ASSERT_PARAM(ro);
     BSON_ASSERT_PARAM(bitsOut);
 
+    if (ro->domainBits.set && ro->min.set && bson_iter_type(&ro->min.value) == valueType) {
+        *bitsOut = ro->domainBits.value;
+        return true;
+    }
+
     // For each type, we use getTypeInfo to get the total number of values in the domain (-1)
     // which tells us how many bits are needed to represent the whole domain.
     // note - can't use a switch statement because of -Werror=switch-enum
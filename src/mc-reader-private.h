@@ -20,6 +20,7 @@
 #include "mongocrypt-buffer-private.h"
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 /**
  * A non-owning forward-only cursor api to read a buffer.
@@ -92,4 +93,20 @@ bool mc_reader_read_prfblock_buffer(mc_reader_t *reader, _mongocrypt_buffer_t *b
 
 bool mc_reader_read_buffer_to_end(mc_reader_t *reader, _mongocrypt_buffer_t *buf, mongocrypt_status_t *status);
 
+/* mc_reader_require checks that at least @length bytes remain. Returns false
+ * and sets @status otherwise, as the checked reads do. */
+bool mc_reader_require(const mc_reader_t *reader, uint64_t length, mongocrypt_status_t *status);
+
+/* Unchecked reads for fixed-layout data. The caller must first check that
+ * enough bytes remain, with mc_reader_require or
+ * mc_reader_get_remaining_length. */
+static inline uint8_t mc_reader_read_u8_unchecked(mc_reader_t *reader) {
+    return reader->ptr[reader->pos++];
+}
+
+/* mc_reader_read_buffer_unchecked sets @buf to the next @length bytes. They are
+ * copied, or @buf is a non-owning view of them if @borrowed, which is only
+ * valid as long as the reader's input. */
+void mc_reader_read_buffer_unchecked(mc_reader_t *reader, _mongocrypt_buffer_t *buf, uint32_t length, bool borrowed);
+
 #endif /* MONGOCRYPT_READER_PRIVATE_H */
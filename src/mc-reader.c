@@ -80,6 +80,14 @@ uint64_t mc_reader_get_consumed_length(const mc_reader_t *reader) {
     return reader->pos;
 }
 
+bool mc_reader_require(const mc_reader_t *reader, uint64_t length, mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(reader);
+
+    CHECK_REMAINING_BUFFER_AND_RET(length);
+
+    return true;
+}
+
 bool mc_reader_read_u8(mc_reader_t *reader, uint8_t *value, mongocrypt_status_t *status) {
     BSON_ASSERT_PARAM(reader);
     BSON_ASSERT_PARAM(value);
@@ -180,3 +188,18 @@ bool mc_reader_read_buffer_to_end(mc_reader_t *reader, _mongocrypt_buffer_t *buf
     uint64_t length = reader->len - reader->pos;
     return mc_reader_read_buffer(reader, buf, length, status);
 }
+
+void mc_reader_read_buffer_unchecked(mc_reader_t *reader, _mongocrypt_buffer_t *buf, uint32_t length, bool borrowed) {
+    BSON_ASSERT_PARAM(reader);
+    BSON_ASSERT_PARAM(buf);
+
+    _mongocrypt_buffer_init(buf);
+    if (borrowed) {
+        buf->data = (uint8_t *)(reader->ptr + reader->pos);
+        buf->len = length;
+    } else if (length > 0) {
+        _mongocrypt_buffer_resize(buf, length);
+        memcpy(buf->data, reader->ptr + reader->pos, length);
+    }
+    reader->pos += length;
+}
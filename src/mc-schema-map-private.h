@@ -0,0 +1,53 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MC_SCHEMA_MAP_PRIVATE_H
+#define MC_SCHEMA_MAP_PRIVATE_H
+
+#include "mc-efc-private.h"
+#include "mongocrypt-buffer-private.h"
+#include "mongocrypt-status-private.h"
+
+// `mc_schema_map_entry_t` is the entry of one namespace in a schema map or an encrypted field config map.
+typedef struct {
+    // `doc` views the document of the namespace in the map. It is empty if the value is not a document.
+    _mongocrypt_buffer_t doc;
+    // `efc` is parsed from `doc` for an encrypted field config map.
+    mc_EncryptedFieldConfig_t efc;
+    // `error` is set if `efc` failed to parse. It is reported when a context targets the namespace.
+    mongocrypt_status_t *error;
+} mc_schema_map_entry_t;
+
+// `mc_mapof_ns_to_schema_t` maps a namespace to its entry in a schema map or an encrypted field config map. It is
+// compiled once from the map, so lookups do not depend on the size of the map. It is immutable and reference counted,
+// so a context can keep using it after the map of the `mongocrypt_t` is replaced.
+typedef struct _mc_mapof_ns_to_schema_t mc_mapof_ns_to_schema_t;
+
+// `mc_mapof_ns_to_schema_new` compiles a copy of the map `map`. If `parse_efc` is true, each entry is parsed as an
+// encrypted field config. Returns NULL on error.
+mc_mapof_ns_to_schema_t *
+mc_mapof_ns_to_schema_new(const _mongocrypt_buffer_t *map, bool parse_efc, mongocrypt_status_t *status);
+
+// `mc_mapof_ns_to_schema_ref` takes a reference to `n2s`, which may be NULL. Returns `n2s`.
+mc_mapof_ns_to_schema_t *mc_mapof_ns_to_schema_ref(mc_mapof_ns_to_schema_t *n2s);
+
+// `mc_mapof_ns_to_schema_destroy` releases a reference to `n2s`, and frees it with the last one.
+void mc_mapof_ns_to_schema_destroy(mc_mapof_ns_to_schema_t *n2s);
+
+// `mc_mapof_ns_to_schema_get` returns the entry of `ns`, or NULL.
+const mc_schema_map_entry_t *mc_mapof_ns_to_schema_get(const mc_mapof_ns_to_schema_t *n2s, const char *ns);
+
+#endif // MC_SCHEMA_MAP_PRIVATE_H
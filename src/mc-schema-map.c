@@ -0,0 +1,167 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mc-schema-map-private.h"
+#include "mongocrypt-atomic-private.h"
+#include "mongocrypt-private.h"
+#include "mongocrypt-util-private.h"
+
+typedef struct _mc_schema_map_node_t {
+    const char *ns; // Views the key in the map.
+    uint32_t hash;
+    mc_schema_map_entry_t entry;
+    struct _mc_schema_map_node_t *next;
+} mc_schema_map_node_t;
+
+struct _mc_mapof_ns_to_schema_t {
+    volatile int32_t refcount;
+    // `map` is the copy of the map viewed by the nodes.
+    _mongocrypt_buffer_t map;
+    // `buckets` has `num_buckets` chains of nodes. `num_buckets` is a power of two.
+    mc_schema_map_node_t **buckets;
+    size_t num_buckets;
+};
+
+static const mc_schema_map_node_t *_find(const mc_mapof_ns_to_schema_t *n2s, const char *ns, uint32_t hash) {
+    const mc_schema_map_node_t *node;
+
+    for (node = n2s->buckets[hash & (n2s->num_buckets - 1)]; node != NULL; node = node->next) {
+        if (node->hash == hash && 0 == strcmp(node->ns, ns)) {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+mc_mapof_ns_to_schema_t *
+mc_mapof_ns_to_schema_new(const _mongocrypt_buffer_t *map, bool parse_efc, mongocrypt_status_t *status) {
+    mc_mapof_ns_to_schema_t *n2s;
+    bson_t map_bson;
+    bson_iter_t iter;
+    uint32_t count;
+
+    BSON_ASSERT_PARAM(map);
+
+    n2s = bson_malloc0(sizeof(*n2s));
+    BSON_ASSERT(n2s);
+    n2s->refcount = 1;
+    _mongocrypt_buffer_copy_to(map, &n2s->map);
+    if (!_mongocrypt_buffer_to_bson(&n2s->map, &map_bson) || !bson_iter_init(&iter, &map_bson)) {
+        CLIENT_ERR("invalid bson");
+        _mongocrypt_buffer_cleanup(&n2s->map);
+        bson_free(n2s);
+        return NULL;
+    }
+
+    count = bson_count_keys(&map_bson);
+    n2s->num_buckets = 1;
+    while (n2s->num_buckets < count) {
+        n2s->num_buckets *= 2;
+    }
+    n2s->buckets = bson_malloc0(n2s->num_buckets * sizeof(*n2s->buckets));
+    BSON_ASSERT(n2s->buckets);
+
+    while (bson_iter_next(&iter)) {
+        const char *ns = bson_iter_key(&iter);
+        uint32_t hash = mc_hash_bytes(ns, strlen(ns));
+        mc_schema_map_node_t *node;
+        size_t bucket;
+
+        /* Lookups previously found the first of duplicate namespaces. */
+        if (_find(n2s, ns, hash)) {
+            continue;
+        }
+
+        node = bson_malloc0(sizeof(*node));
+        BSON_ASSERT(node);
+        node->ns = ns;
+        node->hash = hash;
+        bucket = hash & (n2s->num_buckets - 1);
+        node->next = n2s->buckets[bucket];
+        n2s->buckets[bucket] = node;
+
+        if (!BSON_ITER_HOLDS_DOCUMENT(&iter) || !_mongocrypt_buffer_from_document_iter(&node->entry.doc, &iter)) {
+            /* Not an error unless a context targets the namespace. */
+            continue;
+        }
+
+        if (parse_efc) {
+            bson_t efc_bson;
+
+            if (!_mongocrypt_buffer_to_bson(&node->entry.doc, &efc_bson)) {
+                CLIENT_ERR("unable to create BSON from encrypted_field_config");
+                mc_mapof_ns_to_schema_destroy(n2s);
+                return NULL;
+            }
+            node->entry.error = mongocrypt_status_new();
+            if (mc_EncryptedFieldConfig_parse(&node->entry.efc, &efc_bson, node->entry.error)) {
+                mongocrypt_status_destroy(node->entry.error);
+                node->entry.error = NULL;
+            }
+        }
+    }
+
+    return n2s;
+}
+
+mc_mapof_ns_to_schema_t *mc_mapof_ns_to_schema_ref(mc_mapof_ns_to_schema_t *n2s) {
+    if (n2s) {
+        int32_t prev = _mongocrypt_atomic_int32_fetch_add(&n2s->refcount, 1);
+        BSON_ASSERT(prev > 0);
+    }
+    return n2s;
+}
+
+void mc_mapof_ns_to_schema_destroy(mc_mapof_ns_to_schema_t *n2s) {
+    if (!n2s) {
+        return;
+    }
+
+    int32_t prev = _mongocrypt_atomic_int32_fetch_add(&n2s->refcount, -1);
+    BSON_ASSERT(prev > 0);
+    if (prev > 1) {
+        return;
+    }
+
+    for (size_t i = 0; i < n2s->num_buckets; i++) {
+        mc_schema_map_node_t *node = n2s->buckets[i];
+
+        while (node) {
+            mc_schema_map_node_t *next = node->next;
+
+            mc_EncryptedFieldConfig_cleanup(&node->entry.efc);
+            mongocrypt_status_destroy(node->entry.error);
+            bson_free(node);
+            node = next;
+        }
+    }
+    bson_free(n2s->buckets);
+    _mongocrypt_buffer_cleanup(&n2s->map);
+    bson_free(n2s);
+}
+
+const mc_schema_map_entry_t *mc_mapof_ns_to_schema_get(const mc_mapof_ns_to_schema_t *n2s, const char *ns) {
+    const mc_schema_map_node_t *node;
+
+    BSON_ASSERT_PARAM(ns);
+
+    if (!n2s) {
+        return NULL;
+    }
+
+    node = _find(n2s, ns, mc_hash_bytes(ns, strlen(ns)));
+    return node ? &node->entry : NULL;
+}
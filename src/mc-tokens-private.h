@@ -80,19 +80,36 @@
 /// remaining arguments. Each constructor will also have the implicit first
 /// argument '_mongocrypt_crypto_t* crypto' and a final argument
 /// 'mongocrypt_status_t* status'
+///
+/// Tokens may live in caller storage: '_init' and '_derive' write into a
+/// caller-provided token and allocate nothing, so such tokens need no cleanup.
+/// A token's data may point into the token itself, so tokens must not be copied
+/// by assignment. Use '_init' to copy a token's value.
 #define DECL_TOKEN_TYPE(Name, ...) DECL_TOKEN_TYPE_1(Name, BSON_CONCAT(Name, _t), __VA_ARGS__)
 
 #define DECL_TOKEN_TYPE_1(Prefix, T, ...)                                                                              \
-    /* Opaque typedef the struct */                                                                                    \
-    typedef struct T T;                                                                                                \
+    /* The token struct. 'data' refers to 'storage' unless built by _new_from_buffer */                                \
+    typedef struct T {                                                                                                 \
+        _mongocrypt_buffer_t data;                                                                                     \
+        uint8_t storage[MONGOCRYPT_HMAC_SHA256_LEN];                                                                   \
+    } T;                                                                                                               \
     /* Data-getter */                                                                                                  \
     extern const _mongocrypt_buffer_t *BSON_CONCAT(Prefix, _get)(const T *t);                                          \
     /* Destructor */                                                                                                   \
     extern void BSON_CONCAT(Prefix, _destroy)(T * t);                                                                  \
     /* Constructor for server to create tokens from raw buffer */                                                      \
     extern T *BSON_CONCAT(Prefix, _new_from_buffer)(_mongocrypt_buffer_t * buf);                                       \
+    /* Copy constructor */                                                                                             \
+    extern T *BSON_CONCAT(Prefix, _copy)(const T *t);                                                                  \
     /* Constructor. Parameter list given as variadic args */                                                           \
-    extern T *BSON_CONCAT(Prefix, _new)(_mongocrypt_crypto_t * crypto, __VA_ARGS__, mongocrypt_status_t * status)
+    extern T *BSON_CONCAT(Prefix, _new)(_mongocrypt_crypto_t * crypto, __VA_ARGS__, mongocrypt_status_t * status);     \
+    /* Initializer. Copies the raw token value in buf into caller storage */                                           \
+    extern void BSON_CONCAT(Prefix, _init)(T * t, const _mongocrypt_buffer_t *buf);                                    \
+    /* Initializer. Derives the token into caller storage. Parameter list given as variadic args */                    \
+    extern bool BSON_CONCAT(Prefix, _derive)(T * t,                                                                    \
+                                             _mongocrypt_crypto_t * crypto,                                            \
+                                             __VA_ARGS__,                                                              \
+                                             mongocrypt_status_t * status)
 
 DECL_TOKEN_TYPE(mc_CollectionsLevel1Token, const _mongocrypt_buffer_t *);
 DECL_TOKEN_TYPE(mc_ServerTokenDerivationLevel1Token, const _mongocrypt_buffer_t *);
@@ -134,6 +151,15 @@ DECL_TOKEN_TYPE(mc_ServerZerosEncryptionToken, const mc_ServerDerivedFromDataTok
 
 DECL_TOKEN_TYPE(mc_AnchorPaddingTokenRoot, const mc_ESCToken_t *ESCToken);
 
+/* mc_AnchorPaddingTokenRoot_derive_batch derives the AnchorPaddingTokenRoot of
+ * each of the @count ESCTokens in @ESCTokens into @out, with one
+ * _mongocrypt_hmac_sha_256_batch call. */
+bool mc_AnchorPaddingTokenRoot_derive_batch(mc_AnchorPaddingTokenRoot_t *out,
+                                            _mongocrypt_crypto_t *crypto,
+                                            const mc_ESCToken_t *const *ESCTokens,
+                                            uint32_t count,
+                                            mongocrypt_status_t *status);
+
 #undef DECL_TOKEN_TYPE
 #undef DECL_TOKEN_TYPE_1
 
@@ -16,18 +16,28 @@
 
 #include "mc-tokens-private.h"
 #include "mongocrypt-buffer-private.h"
+#include "mongocrypt-endian-private.h"
+#include "mongocrypt-secure-arena-private.h"
 
 /// Define a token type of the given name, with constructor parameters given as
-/// the remaining arguments. This macro usage should be followed by the
-/// constructor body, with the implicit first argument '_mongocrypt_crypto_t*
-/// crypto' and final argument 'mongocrypt_status_t* status'
-#define DEF_TOKEN_TYPE(Name, ...) DEF_TOKEN_TYPE_1(Name, BSON_CONCAT(Name, _t), __VA_ARGS__)
-
-#define DEF_TOKEN_TYPE_1(Prefix, T, ...)                                                                               \
-    /* Define the struct for the token */                                                                              \
-    struct T {                                                                                                         \
-        _mongocrypt_buffer_t data;                                                                                     \
-    };                                                                                                                 \
+/// the remaining arguments. 'Args' is the parenthesized list of the parameter
+/// names. This macro usage should be followed by the body of '_derive', with the
+/// implicit first arguments 'T* t' and '_mongocrypt_crypto_t* crypto' and final
+/// argument 'mongocrypt_status_t* status'. '_new' allocates a token and derives
+/// into it.
+#define DEF_TOKEN_TYPE(Name, Args, ...) DEF_TOKEN_TYPE_1(Name, BSON_CONCAT(Name, _t), Args, __VA_ARGS__)
+
+#define TOKEN_ARG_NAMES(...) __VA_ARGS__
+
+// Point the token's data at its own storage.
+#define TOKEN_STORAGE_INIT(t)                                                                                          \
+    do {                                                                                                               \
+        _mongocrypt_buffer_init(&(t)->data);                                                                           \
+        (t)->data.data = (t)->storage;                                                                                 \
+        (t)->data.len = MONGOCRYPT_HMAC_SHA256_LEN;                                                                    \
+    } while (0)
+
+#define DEF_TOKEN_TYPE_1(Prefix, T, Args, ...)                                                                         \
     /* Data-getter */                                                                                                  \
     const _mongocrypt_buffer_t *BSON_CONCAT(Prefix, _get)(const T *self) { return &self->data; }                       \
     /* Destructor */                                                                                                   \
@@ -36,144 +46,206 @@
             return;                                                                                                    \
         }                                                                                                              \
         _mongocrypt_buffer_cleanup(&self->data);                                                                       \
-        bson_free(self);                                                                                               \
+        _mongocrypt_secure_free(self, sizeof(T));                                                                      \
+    }                                                                                                                  \
+    /* Initializer. From raw buffer, into caller storage */                                                            \
+    void BSON_CONCAT(Prefix, _init)(T * self, const _mongocrypt_buffer_t *buf) {                                       \
+        BSON_ASSERT_PARAM(self);                                                                                       \
+        BSON_ASSERT_PARAM(buf);                                                                                        \
+        BSON_ASSERT(buf->len == MONGOCRYPT_HMAC_SHA256_LEN);                                                           \
+        TOKEN_STORAGE_INIT(self);                                                                                      \
+        memcpy(self->storage, buf->data, MONGOCRYPT_HMAC_SHA256_LEN);                                                  \
     }                                                                                                                  \
     /* Constructor. From raw buffer */                                                                                 \
     T *BSON_CONCAT(Prefix, _new_from_buffer)(_mongocrypt_buffer_t * buf) {                                             \
         BSON_ASSERT(buf->len == MONGOCRYPT_HMAC_SHA256_LEN);                                                           \
-        T *t = bson_malloc(sizeof(T));                                                                                 \
+        T *t = _mongocrypt_secure_malloc(sizeof(T));                                                                   \
         _mongocrypt_buffer_set_to(buf, &t->data);                                                                      \
         return t;                                                                                                      \
     }                                                                                                                  \
+    /* Constructor. Copy of another token */                                                                           \
+    T *BSON_CONCAT(Prefix, _copy)(const T *self) {                                                                     \
+        BSON_ASSERT_PARAM(self);                                                                                       \
+        T *t = _mongocrypt_secure_malloc(sizeof(T));                                                                   \
+        BSON_CONCAT(Prefix, _init)(t, &self->data);                                                                    \
+        return t;                                                                                                      \
+    }                                                                                                                  \
     /* Constructor. Parameter list given as variadic args. */                                                          \
-    T *BSON_CONCAT(Prefix, _new)(_mongocrypt_crypto_t * crypto, __VA_ARGS__, mongocrypt_status_t * status)
-
-#define IMPL_TOKEN_NEW_1(Name, Key, Arg, Clean)                                                                        \
-    {                                                                                                                  \
-        BSON_CONCAT(Name, _t) *t = bson_malloc(sizeof(BSON_CONCAT(Name, _t)));                                         \
-        _mongocrypt_buffer_init(&t->data);                                                                             \
-        _mongocrypt_buffer_resize(&t->data, MONGOCRYPT_HMAC_SHA256_LEN);                                               \
-                                                                                                                       \
-        if (!_mongocrypt_hmac_sha_256(crypto, Key, Arg, &t->data, status)) {                                           \
-            BSON_CONCAT(Name, _destroy)(t);                                                                            \
-            Clean;                                                                                                     \
+    T *BSON_CONCAT(Prefix, _new)(_mongocrypt_crypto_t * crypto, __VA_ARGS__, mongocrypt_status_t * status) {           \
+        T *t = _mongocrypt_secure_malloc(sizeof(T));                                                                   \
+        if (!BSON_CONCAT(Prefix, _derive)(t, crypto, TOKEN_ARG_NAMES Args, status)) {                                  \
+            _mongocrypt_secure_free(t, sizeof(T));                                                                     \
             return NULL;                                                                                               \
         }                                                                                                              \
-        Clean;                                                                                                         \
         return t;                                                                                                      \
+    }                                                                                                                  \
+    /* Initializer. Derives into caller storage. Parameter list given as variadic args. */                             \
+    bool BSON_CONCAT(Prefix, _derive)(T * t, _mongocrypt_crypto_t * crypto, __VA_ARGS__, mongocrypt_status_t * status)
+
+#define IMPL_TOKEN_DERIVE_1(Key, Arg, Clean)                                                                           \
+    {                                                                                                                  \
+        TOKEN_STORAGE_INIT(t);                                                                                         \
+        bool ok = _mongocrypt_hmac_sha_256(crypto, Key, Arg, &t->data, status);                                        \
+        Clean;                                                                                                         \
+        return ok;                                                                                                     \
     }
 
 // Define the implementation of a token where Arg is a _mongocrypt_buffer_t.
-#define IMPL_TOKEN_NEW(Name, Key, Arg) IMPL_TOKEN_NEW_1(Name, Key, Arg, (void)0)
+#define IMPL_TOKEN_DERIVE(Key, Arg) IMPL_TOKEN_DERIVE_1(Key, Arg, (void)0)
 
-// Define the implementation of a token where Arg is a uint64_t.
-#define IMPL_TOKEN_NEW_CONST(Name, Key, Arg)                                                                           \
+// Define the implementation of a token where Arg is a uint64_t. The argument is hashed from the stack.
+#define IMPL_TOKEN_DERIVE_CONST(Key, Arg)                                                                              \
     {                                                                                                                  \
+        uint64_t arg_le = MONGOCRYPT_UINT64_TO_LE(Arg);                                                                \
         _mongocrypt_buffer_t to_hash;                                                                                  \
-        _mongocrypt_buffer_copy_from_uint64_le(&to_hash, Arg);                                                         \
-        IMPL_TOKEN_NEW_1(Name, Key, &to_hash, _mongocrypt_buffer_cleanup(&to_hash))                                    \
+        _mongocrypt_buffer_init(&to_hash);                                                                             \
+        to_hash.data = (uint8_t *)&arg_le;                                                                             \
+        to_hash.len = sizeof(arg_le);                                                                                  \
+        IMPL_TOKEN_DERIVE_1(Key, &to_hash, (void)0)                                                                    \
     }
 
-DEF_TOKEN_TYPE(mc_CollectionsLevel1Token, const _mongocrypt_buffer_t *RootKey)
-IMPL_TOKEN_NEW_CONST(mc_CollectionsLevel1Token, RootKey, 1)
+DEF_TOKEN_TYPE(mc_CollectionsLevel1Token, (RootKey), const _mongocrypt_buffer_t *RootKey)
+IMPL_TOKEN_DERIVE_CONST(RootKey, 1)
 
-DEF_TOKEN_TYPE(mc_EDCToken, const mc_CollectionsLevel1Token_t *CollectionsLevel1Token)
-IMPL_TOKEN_NEW_CONST(mc_EDCToken, mc_CollectionsLevel1Token_get(CollectionsLevel1Token), 1)
+DEF_TOKEN_TYPE(mc_EDCToken, (CollectionsLevel1Token), const mc_CollectionsLevel1Token_t *CollectionsLevel1Token)
+IMPL_TOKEN_DERIVE_CONST(mc_CollectionsLevel1Token_get(CollectionsLevel1Token), 1)
 
-DEF_TOKEN_TYPE(mc_ESCToken, const mc_CollectionsLevel1Token_t *CollectionsLevel1Token)
-IMPL_TOKEN_NEW_CONST(mc_ESCToken, mc_CollectionsLevel1Token_get(CollectionsLevel1Token), 2)
+DEF_TOKEN_TYPE(mc_ESCToken, (CollectionsLevel1Token), const mc_CollectionsLevel1Token_t *CollectionsLevel1Token)
+IMPL_TOKEN_DERIVE_CONST(mc_CollectionsLevel1Token_get(CollectionsLevel1Token), 2)
 
-DEF_TOKEN_TYPE(mc_ECCToken, const mc_CollectionsLevel1Token_t *CollectionsLevel1Token)
-IMPL_TOKEN_NEW_CONST(mc_ECCToken, mc_CollectionsLevel1Token_get(CollectionsLevel1Token), 3)
+DEF_TOKEN_TYPE(mc_ECCToken, (CollectionsLevel1Token), const mc_CollectionsLevel1Token_t *CollectionsLevel1Token)
+IMPL_TOKEN_DERIVE_CONST(mc_CollectionsLevel1Token_get(CollectionsLevel1Token), 3)
 
-DEF_TOKEN_TYPE(mc_ECOCToken, const mc_CollectionsLevel1Token_t *CollectionsLevel1Token)
-IMPL_TOKEN_NEW_CONST(mc_ECOCToken, mc_CollectionsLevel1Token_get(CollectionsLevel1Token), 4)
+DEF_TOKEN_TYPE(mc_ECOCToken, (CollectionsLevel1Token), const mc_CollectionsLevel1Token_t *CollectionsLevel1Token)
+IMPL_TOKEN_DERIVE_CONST(mc_CollectionsLevel1Token_get(CollectionsLevel1Token), 4)
 
-DEF_TOKEN_TYPE(mc_EDCDerivedFromDataToken, const mc_EDCToken_t *EDCToken, const _mongocrypt_buffer_t *v)
-IMPL_TOKEN_NEW(mc_EDCDerivedFromDataToken, mc_EDCToken_get(EDCToken), v)
+DEF_TOKEN_TYPE(mc_EDCDerivedFromDataToken, (EDCToken, v), const mc_EDCToken_t *EDCToken, const _mongocrypt_buffer_t *v)
+IMPL_TOKEN_DERIVE(mc_EDCToken_get(EDCToken), v)
 
-DEF_TOKEN_TYPE(mc_ESCDerivedFromDataToken, const mc_ESCToken_t *ESCToken, const _mongocrypt_buffer_t *v)
-IMPL_TOKEN_NEW(mc_ESCDerivedFromDataToken, mc_ESCToken_get(ESCToken), v)
+DEF_TOKEN_TYPE(mc_ESCDerivedFromDataToken, (ESCToken, v), const mc_ESCToken_t *ESCToken, const _mongocrypt_buffer_t *v)
+IMPL_TOKEN_DERIVE(mc_ESCToken_get(ESCToken), v)
 
-DEF_TOKEN_TYPE(mc_ECCDerivedFromDataToken, const mc_ECCToken_t *ECCToken, const _mongocrypt_buffer_t *v)
-IMPL_TOKEN_NEW(mc_ECCDerivedFromDataToken, mc_ECCToken_get(ECCToken), v)
+DEF_TOKEN_TYPE(mc_ECCDerivedFromDataToken, (ECCToken, v), const mc_ECCToken_t *ECCToken, const _mongocrypt_buffer_t *v)
+IMPL_TOKEN_DERIVE(mc_ECCToken_get(ECCToken), v)
 
 DEF_TOKEN_TYPE(mc_EDCTwiceDerivedToken,
+               (EDCDerivedFromDataTokenAndContentionFactor),
                const mc_EDCDerivedFromDataTokenAndContentionFactor_t *EDCDerivedFromDataTokenAndContentionFactor)
-IMPL_TOKEN_NEW_CONST(mc_EDCTwiceDerivedToken,
-                     mc_EDCDerivedFromDataTokenAndContentionFactor_get(EDCDerivedFromDataTokenAndContentionFactor),
-                     1)
+IMPL_TOKEN_DERIVE_CONST(mc_EDCDerivedFromDataTokenAndContentionFactor_get(EDCDerivedFromDataTokenAndContentionFactor),
+                        1)
 
 DEF_TOKEN_TYPE(mc_ESCTwiceDerivedTagToken,
+               (ESCDerivedFromDataTokenAndContentionFactor),
                const mc_ESCDerivedFromDataTokenAndContentionFactor_t *ESCDerivedFromDataTokenAndContentionFactor)
-IMPL_TOKEN_NEW_CONST(mc_ESCTwiceDerivedTagToken,
-                     mc_ESCDerivedFromDataTokenAndContentionFactor_get(ESCDerivedFromDataTokenAndContentionFactor),
-                     1)
+IMPL_TOKEN_DERIVE_CONST(mc_ESCDerivedFromDataTokenAndContentionFactor_get(ESCDerivedFromDataTokenAndContentionFactor),
+                        1)
 DEF_TOKEN_TYPE(mc_ESCTwiceDerivedValueToken,
+               (ESCDerivedFromDataTokenAndContentionFactor),
                const mc_ESCDerivedFromDataTokenAndContentionFactor_t *ESCDerivedFromDataTokenAndContentionFactor)
-IMPL_TOKEN_NEW_CONST(mc_ESCTwiceDerivedValueToken,
-                     mc_ESCDerivedFromDataTokenAndContentionFactor_get(ESCDerivedFromDataTokenAndContentionFactor),
-                     2)
+IMPL_TOKEN_DERIVE_CONST(mc_ESCDerivedFromDataTokenAndContentionFactor_get(ESCDerivedFromDataTokenAndContentionFactor),
+                        2)
 
-DEF_TOKEN_TYPE(mc_ServerDataEncryptionLevel1Token, const _mongocrypt_buffer_t *RootKey)
-IMPL_TOKEN_NEW_CONST(mc_ServerDataEncryptionLevel1Token, RootKey, 3)
+DEF_TOKEN_TYPE(mc_ServerDataEncryptionLevel1Token, (RootKey), const _mongocrypt_buffer_t *RootKey)
+IMPL_TOKEN_DERIVE_CONST(RootKey, 3)
 
 DEF_TOKEN_TYPE(mc_EDCDerivedFromDataTokenAndContentionFactor,
+               (EDCDerivedFromDataToken, u),
                const mc_EDCDerivedFromDataToken_t *EDCDerivedFromDataToken,
                uint64_t u)
-IMPL_TOKEN_NEW_CONST(mc_EDCDerivedFromDataTokenAndContentionFactor,
-                     mc_EDCDerivedFromDataToken_get(EDCDerivedFromDataToken),
-                     u)
+IMPL_TOKEN_DERIVE_CONST(mc_EDCDerivedFromDataToken_get(EDCDerivedFromDataToken), u)
 
 DEF_TOKEN_TYPE(mc_ESCDerivedFromDataTokenAndContentionFactor,
+               (ESCDerivedFromDataToken, u),
                const mc_ESCDerivedFromDataToken_t *ESCDerivedFromDataToken,
                uint64_t u)
-IMPL_TOKEN_NEW_CONST(mc_ESCDerivedFromDataTokenAndContentionFactor,
-                     mc_ESCDerivedFromDataToken_get(ESCDerivedFromDataToken),
-                     u)
+IMPL_TOKEN_DERIVE_CONST(mc_ESCDerivedFromDataToken_get(ESCDerivedFromDataToken), u)
 
 DEF_TOKEN_TYPE(mc_ECCDerivedFromDataTokenAndContentionFactor,
+               (ECCDerivedFromDataToken, u),
                const mc_ECCDerivedFromDataToken_t *ECCDerivedFromDataToken,
                uint64_t u)
-IMPL_TOKEN_NEW_CONST(mc_ECCDerivedFromDataTokenAndContentionFactor,
-                     mc_ECCDerivedFromDataToken_get(ECCDerivedFromDataToken),
-                     u)
+IMPL_TOKEN_DERIVE_CONST(mc_ECCDerivedFromDataToken_get(ECCDerivedFromDataToken), u)
 
 /* FLE2v2 */
 
-DEF_TOKEN_TYPE(mc_ServerTokenDerivationLevel1Token, const _mongocrypt_buffer_t *RootKey)
-IMPL_TOKEN_NEW_CONST(mc_ServerTokenDerivationLevel1Token, RootKey, 2)
+DEF_TOKEN_TYPE(mc_ServerTokenDerivationLevel1Token, (RootKey), const _mongocrypt_buffer_t *RootKey)
+IMPL_TOKEN_DERIVE_CONST(RootKey, 2)
 
 DEF_TOKEN_TYPE(mc_ServerDerivedFromDataToken,
+               (ServerTokenDerivationToken, v),
                const mc_ServerTokenDerivationLevel1Token_t *ServerTokenDerivationToken,
                const _mongocrypt_buffer_t *v)
-IMPL_TOKEN_NEW(mc_ServerDerivedFromDataToken, mc_ServerTokenDerivationLevel1Token_get(ServerTokenDerivationToken), v)
+IMPL_TOKEN_DERIVE(mc_ServerTokenDerivationLevel1Token_get(ServerTokenDerivationToken), v)
 
 DEF_TOKEN_TYPE(mc_ServerCountAndContentionFactorEncryptionToken,
+               (serverDerivedFromDataToken),
                const mc_ServerDerivedFromDataToken_t *serverDerivedFromDataToken)
-IMPL_TOKEN_NEW_CONST(mc_ServerCountAndContentionFactorEncryptionToken,
-                     mc_ServerDerivedFromDataToken_get(serverDerivedFromDataToken),
-                     1)
+IMPL_TOKEN_DERIVE_CONST(mc_ServerDerivedFromDataToken_get(serverDerivedFromDataToken), 1)
 
-DEF_TOKEN_TYPE(mc_ServerZerosEncryptionToken, const mc_ServerDerivedFromDataToken_t *serverDerivedFromDataToken)
-IMPL_TOKEN_NEW_CONST(mc_ServerZerosEncryptionToken, mc_ServerDerivedFromDataToken_get(serverDerivedFromDataToken), 2)
+DEF_TOKEN_TYPE(mc_ServerZerosEncryptionToken,
+               (serverDerivedFromDataToken),
+               const mc_ServerDerivedFromDataToken_t *serverDerivedFromDataToken)
+IMPL_TOKEN_DERIVE_CONST(mc_ServerDerivedFromDataToken_get(serverDerivedFromDataToken), 2)
 
 // d = 17 bytes of 0, AnchorPaddingTokenRoot = HMAC(ESCToken, d)
 #define ANCHOR_PADDING_TOKEN_D_LENGTH 17
 const uint8_t mc_AnchorPaddingTokenDValue[ANCHOR_PADDING_TOKEN_D_LENGTH] =
     {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
 
-DEF_TOKEN_TYPE(mc_AnchorPaddingTokenRoot, const mc_ESCToken_t *ESCToken) {
+DEF_TOKEN_TYPE(mc_AnchorPaddingTokenRoot, (ESCToken), const mc_ESCToken_t *ESCToken) {
     _mongocrypt_buffer_t to_hash;
     if (!_mongocrypt_buffer_copy_from_data_and_size(&to_hash,
                                                     mc_AnchorPaddingTokenDValue,
                                                     ANCHOR_PADDING_TOKEN_D_LENGTH)) {
-        return NULL;
+        return false;
     }
-    IMPL_TOKEN_NEW_1(mc_AnchorPaddingTokenRoot,
-                     mc_ESCToken_get(ESCToken),
-                     &to_hash,
-                     _mongocrypt_buffer_cleanup(&to_hash))
+    IMPL_TOKEN_DERIVE_1(mc_ESCToken_get(ESCToken), &to_hash, _mongocrypt_buffer_cleanup(&to_hash))
+}
+
+bool mc_AnchorPaddingTokenRoot_derive_batch(mc_AnchorPaddingTokenRoot_t *out,
+                                            _mongocrypt_crypto_t *crypto,
+                                            const mc_ESCToken_t *const *ESCTokens,
+                                            uint32_t count,
+                                            mongocrypt_status_t *status) {
+    _mongocrypt_buffer_t to_hash;
+    const _mongocrypt_buffer_t **keys;
+    const _mongocrypt_buffer_t **ins;
+    _mongocrypt_buffer_t *hashes;
+    bool ok;
+
+    BSON_ASSERT_PARAM(out);
+    BSON_ASSERT_PARAM(crypto);
+    BSON_ASSERT_PARAM(ESCTokens);
+
+    if (count == 0) {
+        return true;
+    }
+
+    // Every input is the same d, so it is viewed rather than copied per token.
+    _mongocrypt_buffer_init(&to_hash);
+    to_hash.data = (uint8_t *)mc_AnchorPaddingTokenDValue;
+    to_hash.len = ANCHOR_PADDING_TOKEN_D_LENGTH;
+
+    keys = bson_malloc(sizeof(*keys) * count);
+    ins = bson_malloc(sizeof(*ins) * count);
+    hashes = bson_malloc0(sizeof(*hashes) * count);
+    for (uint32_t i = 0; i < count; i++) {
+        keys[i] = mc_ESCToken_get(ESCTokens[i]);
+        ins[i] = &to_hash;
+    }
+
+    ok = _mongocrypt_hmac_sha_256_batch(crypto, keys, ins, hashes, count, status);
+    for (uint32_t i = 0; i < count; i++) {
+        if (ok) {
+            mc_AnchorPaddingTokenRoot_init(&out[i], &hashes[i]);
+        }
+        _mongocrypt_buffer_cleanup(&hashes[i]);
+    }
+
+    bson_free(hashes);
+    bson_free(ins);
+    bson_free(keys);
+    return ok;
 }
 
 #undef ANCHOR_PADDING_TOKEN_D_LENGTH
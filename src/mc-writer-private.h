@@ -20,6 +20,7 @@
 #include "mongocrypt-buffer-private.h"
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 /**
  * A non-owning forward-only cursor api to write to a buffer.
@@ -63,4 +64,21 @@ bool mc_writer_write_uuid_buffer(mc_writer_t *writer, const _mongocrypt_buffer_t
 
 bool mc_writer_write_prfblock_buffer(mc_writer_t *writer, const _mongocrypt_buffer_t *buf, mongocrypt_status_t *status);
 
+/* Unchecked writes for fixed-layout data. The caller must first check that
+ * the writer has room, e.g. by sizing the buffer for the whole layout. */
+static inline void mc_writer_write_u8_unchecked(mc_writer_t *writer, uint8_t value) {
+    writer->ptr[writer->pos++] = value;
+}
+
+static inline void mc_writer_write_u64_unchecked(mc_writer_t *writer, uint64_t value) {
+    const uint64_t temp = BSON_UINT64_TO_LE(value);
+    memcpy(writer->ptr + writer->pos, &temp, sizeof(uint64_t));
+    writer->pos += sizeof(uint64_t);
+}
+
+static inline void mc_writer_write_bytes_unchecked(mc_writer_t *writer, const uint8_t *data, uint32_t length) {
+    memcpy(writer->ptr + writer->pos, data, length);
+    writer->pos += length;
+}
+
 #endif /* MONGOCRYPT_READER_PRIVATE_H */
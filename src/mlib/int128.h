@@ -59,6 +59,32 @@ typedef union {
 /// Maximum value of int128, when treated as an unsigned integer
 #define MLIB_INT128_UMAX MLIB_INT128_FROM_PARTS(UINT64_MAX, UINT64_MAX)
 
+/**
+ * @brief Whether arithmetic is done with the compiler's native 128-bit integer
+ *
+ * GCC and Clang provide `__uint128_t` on 64-bit targets, where the arithmetic
+ * below compiles to a few native instructions instead of operating on 64-bit
+ * (or, for multiplication and division, 32-bit) digits. Define
+ * MLIB_INT128_NO_NATIVE to always use the portable implementation.
+ */
+#if defined(__SIZEOF_INT128__) && !defined(MLIB_INT128_NO_NATIVE)
+#define MLIB_INT128_HAVE_NATIVE 1
+#else
+#define MLIB_INT128_HAVE_NATIVE 0
+#endif
+
+#if MLIB_INT128_HAVE_NATIVE
+// Conversions go through the parts rather than the union so that they remain
+// valid in constant expressions.
+static mlib_constexpr_fn __uint128_t _mlibInt128ToNative(mlib_int128 v) {
+    return ((__uint128_t)v.r.hi << 64) | v.r.lo;
+}
+
+static mlib_constexpr_fn mlib_int128 _mlibInt128FromNative(__uint128_t n) {
+    return MLIB_INIT(mlib_int128) MLIB_INT128_FROM_PARTS((uint64_t)n, (uint64_t)(n >> 64));
+}
+#endif
+
 /**
  * @brief Compare two 128-bit integers as unsigned integers
  *
@@ -116,11 +142,15 @@ static mlib_constexpr_fn bool mlib_int128_eq(mlib_int128 left, mlib_int128 right
  * @return mlib_int128 The sum of the two addends. Overflow will wrap.
  */
 static mlib_constexpr_fn mlib_int128 mlib_int128_add(mlib_int128 left, mlib_int128 right) {
+#if MLIB_INT128_HAVE_NATIVE
+    return _mlibInt128FromNative(_mlibInt128ToNative(left) + _mlibInt128ToNative(right));
+#else
     uint64_t losum = left.r.lo + right.r.lo;
     // Overflow check
     unsigned carry = (losum < left.r.lo || losum < right.r.lo);
     uint64_t hisum = left.r.hi + right.r.hi + carry;
     return MLIB_INIT(mlib_int128) MLIB_INT128_FROM_PARTS(losum, hisum);
+#endif
 }
 
 /**
@@ -139,11 +169,15 @@ static mlib_constexpr_fn mlib_int128 mlib_int128_negate(mlib_int128 v) {
  * @return mlib_int128 The difference between `from` and `less`
  */
 static mlib_constexpr_fn mlib_int128 mlib_int128_sub(mlib_int128 from, mlib_int128 less) {
+#if MLIB_INT128_HAVE_NATIVE
+    return _mlibInt128FromNative(_mlibInt128ToNative(from) - _mlibInt128ToNative(less));
+#else
     unsigned borrow = from.r.lo < less.r.lo;
     uint64_t low = from.r.lo - less.r.lo;
     uint64_t high = from.r.hi - less.r.hi;
     high -= borrow;
     return MLIB_INIT(mlib_int128) MLIB_INT128_FROM_PARTS(low, high);
+#endif
 }
 
 /**
@@ -154,6 +188,15 @@ static mlib_constexpr_fn mlib_int128 mlib_int128_sub(mlib_int128 from, mlib_int1
  * @return The result of the shift operation
  */
 static mlib_constexpr_fn mlib_int128 mlib_int128_lshift(mlib_int128 val, int off) {
+#if MLIB_INT128_HAVE_NATIVE
+    if (off > 0) {
+        return _mlibInt128FromNative(_mlibInt128ToNative(val) << off);
+    } else if (off < 0) {
+        return _mlibInt128FromNative(_mlibInt128ToNative(val) >> -off);
+    } else {
+        return val;
+    }
+#else
     if (off > 0) {
         if (off >= 64) {
             off -= 64;
@@ -180,6 +223,7 @@ static mlib_constexpr_fn mlib_int128 mlib_int128_lshift(mlib_int128 val, int off
     } else {
         return val;
     }
+#endif
 }
 
 /**
@@ -202,6 +246,9 @@ static mlib_constexpr_fn mlib_int128 mlib_int128_bitor(mlib_int128 l, mlib_int12
 
 // Multiply two 64bit integers to get a 128-bit result without overflow
 static mlib_constexpr_fn mlib_int128 _mlibUnsignedMult128(uint64_t left, uint64_t right) {
+#if MLIB_INT128_HAVE_NATIVE
+    return _mlibInt128FromNative((__uint128_t)left * right);
+#else
     // Perform a Knuth 4.3.1M multiplication
     uint32_t u[2] = {(uint32_t)left, (uint32_t)(left >> 32)};
     uint32_t v[2] = {(uint32_t)right, (uint32_t)(right >> 32)};
@@ -218,18 +265,23 @@ static mlib_constexpr_fn mlib_int128 _mlibUnsignedMult128(uint64_t left, uint64_
     }
 
     return MLIB_INIT(mlib_int128) MLIB_INT128_FROM_PARTS(((uint64_t)w[1] << 32) | w[0], ((uint64_t)w[3] << 32) | w[2]);
+#endif
 }
 
 /**
  * @brief Multiply two mlib_int128s together. Overflow will wrap.
  */
 static mlib_constexpr_fn mlib_int128 mlib_int128_mul(mlib_int128 l, mlib_int128 r) {
+#if MLIB_INT128_HAVE_NATIVE
+    return _mlibInt128FromNative(_mlibInt128ToNative(l) * _mlibInt128ToNative(r));
+#else
     // Multiply the low-order word
     mlib_int128 ret = _mlibUnsignedMult128(l.r.lo, r.r.lo);
     // Accumulate the high-order parts:
     ret.r.hi += l.r.lo * r.r.hi;
     ret.r.hi += l.r.hi * r.r.lo;
     return ret;
+#endif
 }
 
 /// Get the number of leading zeros in a 64bit number.
@@ -416,6 +468,11 @@ static mlib_constexpr_fn struct mlib_int128_divmod_result _mlibDivide_u128_by_u6
  * @return A struct with .quotient and .remainder results
  */
 static mlib_constexpr_fn mlib_int128_divmod_result mlib_int128_divmod(mlib_int128 numer, mlib_int128 denom) {
+#if MLIB_INT128_HAVE_NATIVE
+    const __uint128_t n = _mlibInt128ToNative(numer);
+    const __uint128_t d = _mlibInt128ToNative(denom);
+    return MLIB_INIT(mlib_int128_divmod_result){_mlibInt128FromNative(n / d), _mlibInt128FromNative(n % d)};
+#else
     const uint64_t nhi = numer.r.hi;
     const uint64_t nlo = numer.r.lo;
     const uint64_t dhi = denom.r.hi;
@@ -496,6 +553,7 @@ static mlib_constexpr_fn mlib_int128_divmod_result mlib_int128_divmod(mlib_int12
             remainder,
         };
     }
+#endif
 }
 
 /**
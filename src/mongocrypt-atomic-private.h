@@ -0,0 +1,90 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOCRYPT_ATOMIC_PRIVATE_H
+#define MONGOCRYPT_ATOMIC_PRIVATE_H
+
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+/* Sequentially consistent atomic operations on integers. Each returns the
+ * value stored before the operation. */
+
+static inline int32_t _mongocrypt_atomic_int32_fetch_add(volatile int32_t *p, int32_t n) {
+#ifdef _WIN32
+    return (int32_t)InterlockedExchangeAdd((volatile LONG *)p, (LONG)n);
+#else
+    return __sync_fetch_and_add(p, n);
+#endif
+}
+
+static inline int64_t _mongocrypt_atomic_int64_fetch_add(volatile int64_t *p, int64_t n) {
+#ifdef _WIN32
+    return (int64_t)InterlockedExchangeAdd64((volatile LONG64 *)p, (LONG64)n);
+#else
+    return __sync_fetch_and_add(p, n);
+#endif
+}
+
+static inline int32_t _mongocrypt_atomic_int32_exchange(volatile int32_t *p, int32_t n) {
+#ifdef _WIN32
+    return (int32_t)InterlockedExchange((volatile LONG *)p, (LONG)n);
+#else
+    int32_t old;
+
+    do {
+        old = *p;
+    } while (!__sync_bool_compare_and_swap(p, old, n));
+    return old;
+#endif
+}
+
+/* Stores @desired to @p if it holds @expected. */
+static inline int32_t _mongocrypt_atomic_int32_compare_exchange(volatile int32_t *p,
+                                                                int32_t expected,
+                                                                int32_t desired) {
+#ifdef _WIN32
+    return (int32_t)InterlockedCompareExchange((volatile LONG *)p, (LONG)desired, (LONG)expected);
+#else
+    return __sync_val_compare_and_swap(p, expected, desired);
+#endif
+}
+
+static inline int32_t _mongocrypt_atomic_int32_load(volatile int32_t *p) {
+    return _mongocrypt_atomic_int32_fetch_add(p, 0);
+}
+
+static inline int64_t _mongocrypt_atomic_int64_load(volatile int64_t *p) {
+    return _mongocrypt_atomic_int64_fetch_add(p, 0);
+}
+
+/* Reads @p without a read-modify-write, so concurrent readers do not contend
+ * for its cache line. Provides no ordering with other memory. */
+static inline int64_t _mongocrypt_atomic_int64_load_relaxed(volatile int64_t *p) {
+#if defined(_WIN32) && !defined(_WIN64)
+    /* Plain 64-bit reads may tear on 32-bit Windows. */
+    return _mongocrypt_atomic_int64_load(p);
+#elif defined(_WIN32)
+    return *p;
+#else
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+#endif
+}
+
+#endif /* MONGOCRYPT_ATOMIC_PRIVATE_H */
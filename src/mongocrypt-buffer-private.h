@@ -25,11 +25,13 @@
 #define PRF_LEN 32
 
 struct _mongocrypt_binary_t;
+struct _mongocrypt_shared_data_t;
 
 /* An internal struct to make working with binary values more convenient.
  * - a non-owning buffer can be constructed from a bson_iter_t.
  * - a non-owning buffer can become an owned buffer by copying.
  * - a buffer can be appended as a BSON binary in a bson_t.
+ * - a shared buffer holds a reference to immutable, reference counted data.
  */
 typedef struct __mongocrypt_buffer_t {
     uint8_t *data;
@@ -37,6 +39,8 @@ typedef struct __mongocrypt_buffer_t {
     bool owned;
     bson_subtype_t subtype;
     mongocrypt_binary_t bin;
+    /* Set if @data is shared. A shared buffer is not owned and must not be modified. */
+    struct _mongocrypt_shared_data_t *shared;
 } _mongocrypt_buffer_t;
 
 void _mongocrypt_buffer_init(_mongocrypt_buffer_t *buf);
@@ -45,6 +49,16 @@ void _mongocrypt_buffer_resize(_mongocrypt_buffer_t *buf, uint32_t len);
 
 void _mongocrypt_buffer_init_size(_mongocrypt_buffer_t *buf, uint32_t len);
 
+/* Small buffers, like UUIDs, IVs, and keys, may be kept in caller storage. */
+#define MONGOCRYPT_BUFFER_SMALL_LEN 64
+
+/* _mongocrypt_buffer_init_size_small initializes @buf to @len bytes. The bytes
+ * are kept in @storage if they fit, and are allocated otherwise. @buf must not
+ * outlive @storage. Caller must call _mongocrypt_buffer_cleanup. */
+void _mongocrypt_buffer_init_size_small(_mongocrypt_buffer_t *buf,
+                                        uint32_t len,
+                                        uint8_t storage[MONGOCRYPT_BUFFER_SMALL_LEN]);
+
 void _mongocrypt_buffer_steal(_mongocrypt_buffer_t *buf, _mongocrypt_buffer_t *src);
 
 /* @iter is iterated to a BSON binary value. */
@@ -80,6 +94,19 @@ void _mongocrypt_buffer_copy_to(const _mongocrypt_buffer_t *src, _mongocrypt_buf
 
 void _mongocrypt_buffer_set_to(const _mongocrypt_buffer_t *src, _mongocrypt_buffer_t *dst);
 
+/* _mongocrypt_buffer_copy_to_shared copies @src into new reference counted,
+ * immutable data and makes @dst the first reference to it. The data is meant
+ * for key material: it is allocated with _mongocrypt_secure_malloc, and zeroed
+ * when the last reference is cleaned up. Caller must call
+ * _mongocrypt_buffer_cleanup on @dst. */
+void _mongocrypt_buffer_copy_to_shared(const _mongocrypt_buffer_t *src, _mongocrypt_buffer_t *dst);
+
+/* _mongocrypt_buffer_share_to makes @dst another reference to the data of @src
+ * if @src is shared, and a copy of @src otherwise. References may be taken and
+ * cleaned up from multiple threads. Caller must call _mongocrypt_buffer_cleanup
+ * on @dst. */
+void _mongocrypt_buffer_share_to(const _mongocrypt_buffer_t *src, _mongocrypt_buffer_t *dst);
+
 int _mongocrypt_buffer_cmp(const _mongocrypt_buffer_t *a, const _mongocrypt_buffer_t *b);
 
 void _mongocrypt_buffer_cleanup(_mongocrypt_buffer_t *buf);
@@ -90,6 +117,11 @@ bool _mongocrypt_buffer_to_bson_value(_mongocrypt_buffer_t *plaintext,
                                       uint8_t type,
                                       bson_value_t *out) MONGOCRYPT_WARN_UNUSED_RESULT;
 
+/* _mongocrypt_buffer_is_bson_value returns true if @value holds the bytes of
+ * exactly one valid BSON value of @type, as _mongocrypt_buffer_to_bson_value
+ * would accept. Common types are checked in place without copying. */
+bool _mongocrypt_buffer_is_bson_value(const _mongocrypt_buffer_t *value, uint8_t type) MONGOCRYPT_WARN_UNUSED_RESULT;
+
 void _mongocrypt_buffer_from_iter(_mongocrypt_buffer_t *plaintext, bson_iter_t *iter);
 
 bool _mongocrypt_buffer_from_uuid_iter(_mongocrypt_buffer_t *buf, bson_iter_t *iter) MONGOCRYPT_WARN_UNUSED_RESULT;
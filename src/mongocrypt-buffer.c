@@ -14,8 +14,10 @@
  * limitations under the License.
  */
 
+#include "mongocrypt-atomic-private.h"
 #include "mongocrypt-buffer-private.h"
 #include "mongocrypt-endian-private.h"
+#include "mongocrypt-secure-arena-private.h"
 #include "mongocrypt-util-private.h"
 #include <bson/bson.h>
 
@@ -29,6 +31,25 @@
 #define NULL_BYTE_LEN 1
 #define NULL_BYTE_VAL 0x00
 
+/* Reference counted, immutable data of a shared buffer. The bytes follow the
+ * header in the same allocation. */
+struct _mongocrypt_shared_data_t {
+    volatile int32_t refcount;
+    uint32_t len;
+};
+
+static void _shared_data_release(struct _mongocrypt_shared_data_t *shared) {
+    BSON_ASSERT_PARAM(shared);
+
+    int32_t prev = _mongocrypt_atomic_int32_fetch_add(&shared->refcount, -1);
+    BSON_ASSERT(prev > 0);
+    if (prev > 1) {
+        return;
+    }
+    /* Shared data is key material. */
+    _mongocrypt_secure_free(shared, sizeof(*shared) + shared->len);
+}
+
 /* if a buffer is not owned, copy the data and make it owned. */
 static void _make_owned(_mongocrypt_buffer_t *buf) {
     uint8_t *tmp;
@@ -47,6 +68,10 @@ static void _make_owned(_mongocrypt_buffer_t *buf) {
     }
 
     buf->owned = true;
+    if (buf->shared) {
+        _shared_data_release(buf->shared);
+        buf->shared = NULL;
+    }
 }
 
 /* TODO CDRIVER-2990 have buffer operations require initialized buffer to
@@ -69,6 +94,10 @@ void _mongocrypt_buffer_resize(_mongocrypt_buffer_t *buf, uint32_t len) {
         return;
     }
 
+    if (buf->shared) {
+        _shared_data_release(buf->shared);
+        buf->shared = NULL;
+    }
     buf->data = bson_malloc(len);
     BSON_ASSERT(buf->data);
 
@@ -83,10 +112,37 @@ void _mongocrypt_buffer_init_size(_mongocrypt_buffer_t *buf, uint32_t len) {
     _mongocrypt_buffer_resize(buf, len);
 }
 
+void _mongocrypt_buffer_init_size_small(_mongocrypt_buffer_t *buf,
+                                        uint32_t len,
+                                        uint8_t storage[MONGOCRYPT_BUFFER_SMALL_LEN]) {
+    BSON_ASSERT_PARAM(buf);
+    BSON_ASSERT_PARAM(storage);
+
+    if (len > MONGOCRYPT_BUFFER_SMALL_LEN) {
+        _mongocrypt_buffer_init_size(buf, len);
+        return;
+    }
+
+    /* Non-owning, so _mongocrypt_buffer_cleanup does not free the storage. */
+    _mongocrypt_buffer_init(buf);
+    buf->data = storage;
+    buf->len = len;
+}
+
 void _mongocrypt_buffer_steal(_mongocrypt_buffer_t *buf, _mongocrypt_buffer_t *src) {
     BSON_ASSERT_PARAM(buf);
     BSON_ASSERT_PARAM(src);
 
+    if (src->shared) {
+        /* Move the reference. */
+        buf->data = src->data;
+        buf->len = src->len;
+        buf->owned = false;
+        buf->shared = src->shared;
+        _mongocrypt_buffer_init(src);
+        return;
+    }
+
     if (!src->owned) {
         _mongocrypt_buffer_copy_to(src, buf);
         _mongocrypt_buffer_init(src);
@@ -242,6 +298,53 @@ void _mongocrypt_buffer_set_to(const _mongocrypt_buffer_t *src, _mongocrypt_buff
     dst->len = src->len;
     dst->subtype = src->subtype;
     dst->owned = false;
+    dst->shared = NULL;
+}
+
+void _mongocrypt_buffer_copy_to_shared(const _mongocrypt_buffer_t *src, _mongocrypt_buffer_t *dst) {
+    BSON_ASSERT_PARAM(src);
+    BSON_ASSERT_PARAM(dst);
+    BSON_ASSERT(src != dst);
+
+    _mongocrypt_buffer_cleanup(dst);
+    _mongocrypt_buffer_init(dst);
+
+    struct _mongocrypt_shared_data_t *shared = _mongocrypt_secure_malloc(sizeof(*shared) + src->len);
+    BSON_ASSERT(shared);
+    shared->refcount = 1;
+    shared->len = src->len;
+    if (src->len > 0) {
+        memcpy(shared + 1, src->data, src->len);
+    }
+
+    dst->data = (uint8_t *)(shared + 1);
+    dst->len = src->len;
+    dst->subtype = src->subtype;
+    dst->shared = shared;
+}
+
+void _mongocrypt_buffer_share_to(const _mongocrypt_buffer_t *src, _mongocrypt_buffer_t *dst) {
+    BSON_ASSERT_PARAM(src);
+    BSON_ASSERT_PARAM(dst);
+
+    if (src == dst) {
+        return;
+    }
+
+    if (!src->shared) {
+        _mongocrypt_buffer_copy_to(src, dst);
+        return;
+    }
+
+    _mongocrypt_buffer_cleanup(dst);
+    _mongocrypt_buffer_init(dst);
+
+    int32_t prev = _mongocrypt_atomic_int32_fetch_add(&src->shared->refcount, 1);
+    BSON_ASSERT(prev > 0);
+    dst->data = src->data;
+    dst->len = src->len;
+    dst->subtype = src->subtype;
+    dst->shared = src->shared;
 }
 
 int _mongocrypt_buffer_cmp(const _mongocrypt_buffer_t *a, const _mongocrypt_buffer_t *b) {
@@ -260,6 +363,9 @@ int _mongocrypt_buffer_cmp(const _mongocrypt_buffer_t *a, const _mongocrypt_buff
 void _mongocrypt_buffer_cleanup(_mongocrypt_buffer_t *buf) {
     if (buf && buf->owned) {
         bson_free(buf->data);
+    } else if (buf && buf->shared) {
+        _shared_data_release(buf->shared);
+        buf->shared = NULL;
     }
 }
 
@@ -317,6 +423,56 @@ fail:
     return ret;
 }
 
+bool _mongocrypt_buffer_is_bson_value(const _mongocrypt_buffer_t *value, uint8_t type) {
+    uint32_t len_le;
+    uint32_t len;
+
+    BSON_ASSERT_PARAM(value);
+
+    switch (type) {
+    case BSON_TYPE_DOUBLE:
+    case BSON_TYPE_DATE_TIME:
+    case BSON_TYPE_TIMESTAMP:
+    case BSON_TYPE_INT64: return value->len == 8;
+    case BSON_TYPE_INT32: return value->len == 4;
+    case BSON_TYPE_OID: return value->len == 12;
+    case BSON_TYPE_DECIMAL128: return value->len == 16;
+    case BSON_TYPE_UTF8:
+    case BSON_TYPE_CODE:
+    case BSON_TYPE_SYMBOL:
+        /* int32 length, including the NUL terminator, then the string. */
+        if (value->len < INT32_LEN + NULL_BYTE_LEN) {
+            return false;
+        }
+        memcpy(&len_le, value->data, INT32_LEN);
+        len = BSON_UINT32_FROM_LE(len_le);
+        return len == value->len - INT32_LEN && value->data[value->len - 1] == NULL_BYTE_VAL;
+    case BSON_TYPE_BINARY:
+        /* int32 length, subtype, then the data. The old binary subtype nests
+         * another length, and is left to the general check. */
+        if (value->len < INT32_LEN + 1 || value->data[INT32_LEN] == BSON_SUBTYPE_BINARY_DEPRECATED) {
+            break;
+        }
+        memcpy(&len_le, value->data, INT32_LEN);
+        len = BSON_UINT32_FROM_LE(len_le);
+        return len == value->len - INT32_LEN - 1;
+    case BSON_TYPE_DOCUMENT:
+    case BSON_TYPE_ARRAY: {
+        bson_t doc;
+        return bson_init_static(&doc, value->data, value->len) && bson_validate(&doc, BSON_VALIDATE_NONE, NULL);
+    }
+    default: break;
+    }
+
+    /* Check remaining types by wrapping the value in a document. */
+    bson_value_t tmp;
+    if (!_mongocrypt_buffer_to_bson_value((_mongocrypt_buffer_t *)value, type, &tmp)) {
+        return false;
+    }
+    bson_value_destroy(&tmp);
+    return true;
+}
+
 void _mongocrypt_buffer_from_iter(_mongocrypt_buffer_t *plaintext, bson_iter_t *iter) {
     bson_t wrapper = BSON_INITIALIZER;
     int32_t offset = INT32_LEN      /* skips document size */
@@ -16,8 +16,40 @@
 #ifndef MONGOCRYPT_CACHE_COLLINFO_PRIVATE_H
 #define MONGOCRYPT_CACHE_COLLINFO_PRIVATE_H
 
+#include "mc-efc-private.h"
 #include "mongocrypt-cache-private.h"
 
+/* Collinfo cache values are reference counted and immutable once created. They
+ * hold the collection info and what auto encryption parses from it, so a cache
+ * hit returns a new reference rather than a copy to parse again. */
+typedef struct {
+    bson_t *collinfo;
+    /* encrypted_fields views options.encryptedFields of collinfo. It is empty
+     * if the collection has no encryptedFields. efc is parsed from it. */
+    _mongocrypt_buffer_t encrypted_fields;
+    mc_EncryptedFieldConfig_t efc;
+    /* schema views options.validator.$jsonSchema of collinfo. It is empty if
+     * the collection has no JSON schema. */
+    _mongocrypt_buffer_t schema;
+    /* has_siblings is true if options.validator has fields other than
+     * $jsonSchema. */
+    bool has_siblings;
+    volatile int32_t refcount;
+} _mongocrypt_cache_collinfo_value_t;
+
 void _mongocrypt_cache_collinfo_init(_mongocrypt_cache_t *cache);
 
+/* Parses the collection info @collinfo into a new value with one reference.
+ * Returns NULL and sets @status if @collinfo cannot be used for auto
+ * encryption, such as for a view. @collinfo is copied. */
+_mongocrypt_cache_collinfo_value_t *_mongocrypt_cache_collinfo_value_new(const bson_t *collinfo,
+                                                                         mongocrypt_status_t *status);
+
+/* Returns a new reference to @value. */
+_mongocrypt_cache_collinfo_value_t *_mongocrypt_cache_collinfo_value_retain(_mongocrypt_cache_collinfo_value_t *value);
+
+/* Releases a reference to @value. Frees @value when the last reference is
+ * released. */
+void _mongocrypt_cache_collinfo_value_destroy(void *value);
+
 #endif /* MONGOCRYPT_CACHE_COLLINFO_PRIVATE_H */
\ No newline at end of file
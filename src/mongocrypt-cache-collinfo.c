@@ -14,12 +14,16 @@
  * limitations under the License.
  */
 
-#include "mongocrypt-cache-private.h"
+#include "mongocrypt-atomic-private.h"
+#include "mongocrypt-cache-collinfo-private.h"
+#include "mongocrypt-private.h"
+#include "mongocrypt-util-private.h"
 
 /* The collinfo cache.
  *
  * Attribute is a null terminated namespace.
- * Value is a collection info doc (response to listCollections).
+ * Value is a _mongocrypt_cache_collinfo_value_t of a collection info doc
+ * (response to listCollections).
  */
 
 static bool _cmp_attr(void *a, void *b, int *out) {
@@ -31,6 +35,16 @@ static bool _cmp_attr(void *a, void *b, int *out) {
     return true;
 }
 
+static size_t _hash_attr(void *ns, uint32_t *hashes, size_t max) {
+    BSON_ASSERT_PARAM(ns);
+    BSON_ASSERT_PARAM(hashes);
+
+    if (max > 0) {
+        hashes[0] = mc_hash_bytes(ns, strlen((const char *)ns));
+    }
+    return 1;
+}
+
 static void *_copy_attr(void *ns) {
     BSON_ASSERT_PARAM(ns);
 
@@ -41,25 +55,148 @@ static void _destroy_attr(void *ns) {
     bson_free(ns);
 }
 
-static void *_copy_value(void *bson) {
-    BSON_ASSERT_PARAM(bson);
+_mongocrypt_cache_collinfo_value_t *_mongocrypt_cache_collinfo_value_new(const bson_t *collinfo,
+                                                                         mongocrypt_status_t *status) {
+    _mongocrypt_cache_collinfo_value_t *value;
+    bson_iter_t iter;
+    bool found_jsonschema = false;
+
+    BSON_ASSERT_PARAM(collinfo);
+
+    value = bson_malloc0(sizeof(*value));
+    BSON_ASSERT(value);
+    value->collinfo = bson_copy(collinfo);
+    value->refcount = 1;
+
+    /* Disallow views. */
+    if (bson_iter_init_find(&iter, value->collinfo, "type") && BSON_ITER_HOLDS_UTF8(&iter)
+        && 0 == strcmp("view", bson_iter_utf8(&iter, NULL))) {
+        CLIENT_ERR("cannot auto encrypt a view");
+        goto fail;
+    }
+
+    if (!bson_iter_init(&iter, value->collinfo)) {
+        CLIENT_ERR("BSON malformed");
+        goto fail;
+    }
+
+    if (bson_iter_find_descendant(&iter, "options.encryptedFields", &iter)) {
+        bson_t efc_bson;
+
+        if (!BSON_ITER_HOLDS_DOCUMENT(&iter)) {
+            CLIENT_ERR("options.encryptedFields is not a BSON document");
+            goto fail;
+        }
+        if (!_mongocrypt_buffer_from_document_iter(&value->encrypted_fields, &iter)) {
+            CLIENT_ERR("unable to copy options.encryptedFields");
+            goto fail;
+        }
+        if (!_mongocrypt_buffer_to_bson(&value->encrypted_fields, &efc_bson)) {
+            CLIENT_ERR("unable to create BSON from encrypted_field_config");
+            goto fail;
+        }
+        if (!mc_EncryptedFieldConfig_parse(&value->efc, &efc_bson, status)) {
+            goto fail;
+        }
+    }
+
+    BSON_ASSERT(bson_iter_init(&iter, value->collinfo));
+
+    if (bson_iter_find_descendant(&iter, "options.validator", &iter) && BSON_ITER_HOLDS_DOCUMENT(&iter)) {
+        if (!bson_iter_recurse(&iter, &iter)) {
+            CLIENT_ERR("BSON malformed");
+            goto fail;
+        }
+        while (bson_iter_next(&iter)) {
+            const char *key;
+
+            key = bson_iter_key(&iter);
+            BSON_ASSERT(key);
+            if (0 == strcmp("$jsonSchema", key)) {
+                if (found_jsonschema) {
+                    CLIENT_ERR("duplicate $jsonSchema fields found");
+                    goto fail;
+                }
+                if (!_mongocrypt_buffer_from_document_iter(&value->schema, &iter)) {
+                    CLIENT_ERR("malformed $jsonSchema");
+                    goto fail;
+                }
+                found_jsonschema = true;
+            } else {
+                value->has_siblings = true;
+            }
+        }
+    }
+
+    return value;
+
+fail:
+    _mongocrypt_cache_collinfo_value_destroy(value);
+    return NULL;
+}
+
+_mongocrypt_cache_collinfo_value_t *_mongocrypt_cache_collinfo_value_retain(_mongocrypt_cache_collinfo_value_t *value) {
+    int32_t prev;
+
+    BSON_ASSERT_PARAM(value);
+
+    prev = _mongocrypt_atomic_int32_fetch_add(&value->refcount, 1);
+    BSON_ASSERT(prev > 0);
+    return value;
+}
+
+void _mongocrypt_cache_collinfo_value_destroy(void *value) {
+    _mongocrypt_cache_collinfo_value_t *collinfo_value;
+    int32_t prev;
 
-    return bson_copy(bson);
+    if (!value) {
+        return;
+    }
+    collinfo_value = (_mongocrypt_cache_collinfo_value_t *)value;
+    prev = _mongocrypt_atomic_int32_fetch_add(&collinfo_value->refcount, -1);
+    BSON_ASSERT(prev > 0);
+    if (prev > 1) {
+        return;
+    }
+    mc_EncryptedFieldConfig_cleanup(&collinfo_value->efc);
+    bson_destroy(collinfo_value->collinfo);
+    bson_free(collinfo_value);
 }
 
-static void _destroy_value(void *bson) {
-    bson_destroy(bson);
+static void *_copy_value(void *value) {
+    BSON_ASSERT_PARAM(value);
+
+    return _mongocrypt_cache_collinfo_value_retain((_mongocrypt_cache_collinfo_value_t *)value);
+}
+
+static size_t _size_attr(void *ns) {
+    BSON_ASSERT_PARAM(ns);
+
+    return strlen((const char *)ns) + 1u;
+}
+
+/* The encrypted_fields and schema buffers view collinfo, so are not counted.
+ * The parsed efc is estimated from the encryptedFields it was parsed from. */
+static size_t _size_value(void *value_in) {
+    _mongocrypt_cache_collinfo_value_t *value;
+
+    BSON_ASSERT_PARAM(value_in);
+
+    value = (_mongocrypt_cache_collinfo_value_t *)value_in;
+    return sizeof(*value) + sizeof(bson_t) + value->collinfo->len + value->encrypted_fields.len;
 }
 
 void _mongocrypt_cache_collinfo_init(_mongocrypt_cache_t *cache) {
     BSON_ASSERT_PARAM(cache);
 
+    _mongocrypt_cache_init(cache);
+    cache->name = "collinfo";
     cache->cmp_attr = _cmp_attr;
+    cache->hash_attr = _hash_attr;
     cache->copy_attr = _copy_attr;
     cache->destroy_attr = _destroy_attr;
     cache->copy_value = _copy_value;
-    cache->destroy_value = _destroy_value;
-    _mongocrypt_mutex_init(&cache->mutex);
-    cache->pair = NULL;
-    cache->expiration = CACHE_EXPIRATION_MS;
+    cache->destroy_value = _mongocrypt_cache_collinfo_value_destroy;
+    cache->size_attr = _size_attr;
+    cache->size_value = _size_value;
 }
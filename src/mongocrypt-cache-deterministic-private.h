@@ -0,0 +1,37 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MONGOCRYPT_CACHE_DETERMINISTIC_PRIVATE_H
+#define MONGOCRYPT_CACHE_DETERMINISTIC_PRIVATE_H
+
+#include "mongocrypt-cache-private.h"
+
+/* The deterministic cache holds the ciphertexts of values encrypted with the
+ * Deterministic algorithm. Entries expire like the keys of the key cache, and
+ * are removed when their key is invalidated. Entries hold plaintext values and
+ * are zeroed when evicted. */
+void _mongocrypt_cache_deterministic_init(_mongocrypt_cache_t *cache);
+
+/* Removes the entries of values encrypted with the key @key_id. */
+void _mongocrypt_cache_deterministic_remove_key(_mongocrypt_cache_t *cache, const _mongocrypt_buffer_t *key_id);
+
+/* Sets @out to the cache key of the value @plaintext encrypted with the
+ * associated data @associated_data, which holds the key ID and the BSON type.
+ * @out must be cleaned up with _mongocrypt_buffer_cleanup. */
+void _mongocrypt_cache_deterministic_key(const _mongocrypt_buffer_t *associated_data,
+                                         const _mongocrypt_buffer_t *plaintext,
+                                         _mongocrypt_buffer_t *out);
+
+#endif /* MONGOCRYPT_CACHE_DETERMINISTIC_PRIVATE_H */
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "mongocrypt-cache-deterministic-private.h"
+
+/* The deterministic cache.
+ *
+ * Attribute is a _mongocrypt_buffer_t of the associated data of a ciphertext
+ * followed by the plaintext value.
+ * Value is a _mongocrypt_buffer_t of the encrypted data of the ciphertext.
+ */
+
+void _mongocrypt_cache_deterministic_init(_mongocrypt_cache_t *cache) {
+    BSON_ASSERT_PARAM(cache);
+
+    /* The attribute holds a plaintext value. */
+    _mongocrypt_cache_init_buffers(cache, "deterministic", CACHE_ZERO_ATTR);
+}
+
+/* The associated data starts with the blob subtype and the key ID. */
+static bool _attr_has_key_id(void *attr, void *key_id) {
+    const _mongocrypt_buffer_t *buf = (const _mongocrypt_buffer_t *)attr;
+    const _mongocrypt_buffer_t *id = (const _mongocrypt_buffer_t *)key_id;
+
+    BSON_ASSERT_PARAM(attr);
+    BSON_ASSERT_PARAM(key_id);
+
+    return buf->len > id->len && 0 == memcmp(buf->data + 1, id->data, id->len);
+}
+
+void _mongocrypt_cache_deterministic_remove_key(_mongocrypt_cache_t *cache, const _mongocrypt_buffer_t *key_id) {
+    BSON_ASSERT_PARAM(cache);
+    BSON_ASSERT_PARAM(key_id);
+
+    _mongocrypt_cache_remove_if(cache, _attr_has_key_id, (void *)key_id);
+}
+
+void _mongocrypt_cache_deterministic_key(const _mongocrypt_buffer_t *associated_data,
+                                         const _mongocrypt_buffer_t *plaintext,
+                                         _mongocrypt_buffer_t *out) {
+    _mongocrypt_buffer_t parts[2];
+
+    BSON_ASSERT_PARAM(associated_data);
+    BSON_ASSERT_PARAM(plaintext);
+    BSON_ASSERT_PARAM(out);
+
+    parts[0] = *associated_data;
+    parts[1] = *plaintext;
+    BSON_ASSERT(_mongocrypt_buffer_concat(out, parts, 2));
+}
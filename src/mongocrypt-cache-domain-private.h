@@ -0,0 +1,66 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOCRYPT_CACHE_DOMAIN_PRIVATE_H
+#define MONGOCRYPT_CACHE_DOMAIN_PRIVATE_H
+
+#include "mc-array-private.h"
+#include "mongocrypt-buffer-private.h"
+#include "mongocrypt-cache-private.h"
+#include "mongocrypt-mutex-private.h"
+#include "mongocrypt-status-private.h"
+
+/* A key cache and table of in-flight KMS decrypts shared by the mongocrypt_t
+ * handles of a process that set the same cache domain name. */
+typedef struct __mongocrypt_cache_domain_t {
+    char *name;
+    /* Identifies the KMS providers of the handles. Handles with other KMS
+     * providers may not join the domain. */
+    _mongocrypt_buffer_t kms_fingerprint;
+    /* Number of handles using the domain, protected by the global registry
+     * mutex. */
+    int refcount;
+    _mongocrypt_cache_t cache_key;
+    /* Protects kms_inflight. */
+    mongocrypt_mutex_t mutex;
+    /* Ids (_mongocrypt_buffer_t) of keys with a KMS decrypt in progress. */
+    mc_array_t kms_inflight;
+    struct __mongocrypt_cache_domain_t *next;
+} _mongocrypt_cache_domain_t;
+
+/* Returns the domain named @name, creating it if no handle uses it. A new
+ * domain applies @expiration_ms, @refresh_ahead and @max_entries to its key
+ * cache. Fails if the
+ * domain exists with a different @kms_fingerprint. Release the domain with
+ * _mongocrypt_cache_domain_release. */
+_mongocrypt_cache_domain_t *_mongocrypt_cache_domain_acquire(const char *name,
+                                                             const _mongocrypt_buffer_t *kms_fingerprint,
+                                                             uint64_t expiration_ms,
+                                                             double refresh_ahead,
+                                                             uint32_t max_entries,
+                                                             mongocrypt_status_t *status);
+
+/* Drops a reference to @domain. The last reference destroys it. */
+void _mongocrypt_cache_domain_release(_mongocrypt_cache_domain_t *domain);
+
+#ifndef _WIN32
+/* Called in the child after fork. Reinitializes the locks of every domain and
+ * drops their in-flight KMS decrypts, which belonged to threads of the parent.
+ * Cached keys are kept. */
+void _mongocrypt_cache_domain_atfork_child(void);
+#endif
+
+#endif /* MONGOCRYPT_CACHE_DOMAIN_PRIVATE_H */
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mlib/thread.h"
+
+#include "mongocrypt-cache-domain-private.h"
+#include "mongocrypt-cache-key-private.h"
+#include "mongocrypt-private.h"
+
+/* The domains in use, protected by g_cache_domains_mtx. */
+static _mongocrypt_cache_domain_t *g_cache_domains;
+static mongocrypt_mutex_t g_cache_domains_mtx;
+static mlib_once_flag g_cache_domains_init_flag = MLIB_ONCE_INITIALIZER;
+
+static void _init_cache_domains(void) {
+    _mongocrypt_mutex_init(&g_cache_domains_mtx);
+}
+
+static _mongocrypt_cache_domain_t *_cache_domain_new(const char *name,
+                                                     const _mongocrypt_buffer_t *kms_fingerprint,
+                                                     uint64_t expiration_ms,
+                                                     double refresh_ahead,
+                                                     uint32_t max_entries) {
+    _mongocrypt_cache_domain_t *domain = bson_malloc0(sizeof(*domain));
+
+    BSON_ASSERT(domain);
+    domain->name = bson_strdup(name);
+    _mongocrypt_buffer_copy_to(kms_fingerprint, &domain->kms_fingerprint);
+    _mongocrypt_cache_key_init(&domain->cache_key);
+    _mongocrypt_cache_set_expiration(&domain->cache_key, expiration_ms);
+    _mongocrypt_cache_set_refresh_ahead(&domain->cache_key, refresh_ahead);
+    _mongocrypt_cache_set_max_entries(&domain->cache_key, max_entries);
+    _mongocrypt_mutex_init(&domain->mutex);
+    _mc_array_init(&domain->kms_inflight, sizeof(_mongocrypt_buffer_t));
+    return domain;
+}
+
+static void _cache_domain_destroy(_mongocrypt_cache_domain_t *domain) {
+    for (size_t i = 0; i < domain->kms_inflight.len; i++) {
+        _mongocrypt_buffer_cleanup(&_mc_array_index(&domain->kms_inflight, _mongocrypt_buffer_t, i));
+    }
+    _mc_array_destroy(&domain->kms_inflight);
+    _mongocrypt_mutex_cleanup(&domain->mutex);
+    _mongocrypt_cache_cleanup(&domain->cache_key);
+    _mongocrypt_buffer_cleanup(&domain->kms_fingerprint);
+    bson_free(domain->name);
+    bson_free(domain);
+}
+
+_mongocrypt_cache_domain_t *_mongocrypt_cache_domain_acquire(const char *name,
+                                                             const _mongocrypt_buffer_t *kms_fingerprint,
+                                                             uint64_t expiration_ms,
+                                                             double refresh_ahead,
+                                                             uint32_t max_entries,
+                                                             mongocrypt_status_t *status) {
+    _mongocrypt_cache_domain_t *domain;
+
+    BSON_ASSERT_PARAM(name);
+    BSON_ASSERT_PARAM(kms_fingerprint);
+
+    mlib_call_once(&g_cache_domains_init_flag, _init_cache_domains);
+    _mongocrypt_mutex_lock(&g_cache_domains_mtx);
+    for (domain = g_cache_domains; domain; domain = domain->next) {
+        if (0 == strcmp(domain->name, name)) {
+            break;
+        }
+    }
+
+    if (!domain) {
+        domain = _cache_domain_new(name, kms_fingerprint, expiration_ms, refresh_ahead, max_entries);
+        domain->next = g_cache_domains;
+        g_cache_domains = domain;
+    } else if (0 != _mongocrypt_buffer_cmp(&domain->kms_fingerprint, kms_fingerprint)) {
+        _mongocrypt_mutex_unlock(&g_cache_domains_mtx);
+        CLIENT_ERR("cache domain '%s' is in use with different KMS providers", name);
+        return NULL;
+    }
+    domain->refcount++;
+    _mongocrypt_mutex_unlock(&g_cache_domains_mtx);
+    return domain;
+}
+
+void _mongocrypt_cache_domain_release(_mongocrypt_cache_domain_t *domain) {
+    _mongocrypt_cache_domain_t **link;
+
+    if (!domain) {
+        return;
+    }
+
+    _mongocrypt_mutex_lock(&g_cache_domains_mtx);
+    BSON_ASSERT(domain->refcount > 0);
+    if (--domain->refcount > 0) {
+        _mongocrypt_mutex_unlock(&g_cache_domains_mtx);
+        return;
+    }
+    for (link = &g_cache_domains; *link != domain; link = &(*link)->next) {
+        BSON_ASSERT(*link);
+    }
+    *link = domain->next;
+    _mongocrypt_mutex_unlock(&g_cache_domains_mtx);
+    _cache_domain_destroy(domain);
+}
+
+#ifndef _WIN32
+void _mongocrypt_cache_domain_atfork_child(void) {
+    _mongocrypt_mutex_init(&g_cache_domains_mtx);
+    for (_mongocrypt_cache_domain_t *domain = g_cache_domains; domain; domain = domain->next) {
+        _mongocrypt_mutex_init(&domain->mutex);
+        _mongocrypt_cache_atfork_child(&domain->cache_key);
+        for (size_t i = 0; i < domain->kms_inflight.len; i++) {
+            _mongocrypt_buffer_cleanup(&_mc_array_index(&domain->kms_inflight, _mongocrypt_buffer_t, i));
+        }
+        _mc_array_clear(&domain->kms_inflight);
+    }
+}
+#endif
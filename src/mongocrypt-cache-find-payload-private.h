@@ -0,0 +1,35 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MONGOCRYPT_CACHE_FIND_PAYLOAD_PRIVATE_H
+#define MONGOCRYPT_CACHE_FIND_PAYLOAD_PRIVATE_H
+
+#include "mongocrypt-cache-private.h"
+
+/* The find payload cache holds the FLE2FindEqualityPayloadV2 of query values.
+ * The payload only depends on the index key, the value and the contention
+ * factor, so entries do not expire. Entries hold plaintext values and are
+ * zeroed when evicted. */
+void _mongocrypt_cache_find_payload_init(_mongocrypt_cache_t *cache);
+
+/* Sets @out to the cache key of the value @value queried with the index key
+ * @index_key_id and the maximum contention factor @max_contention_factor.
+ * @out must be cleaned up with _mongocrypt_buffer_cleanup. */
+void _mongocrypt_cache_find_payload_key(const _mongocrypt_buffer_t *index_key_id,
+                                        const _mongocrypt_buffer_t *value,
+                                        int64_t max_contention_factor,
+                                        _mongocrypt_buffer_t *out);
+
+#endif /* MONGOCRYPT_CACHE_FIND_PAYLOAD_PRIVATE_H */
@@ -0,0 +1,51 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "mongocrypt-cache-find-payload-private.h"
+
+/* The find payload cache.
+ *
+ * Attribute is a _mongocrypt_buffer_t of the index key ID, the maximum
+ * contention factor as a little-endian int64 and the plaintext value.
+ * Value is a _mongocrypt_buffer_t of the serialized payload.
+ */
+
+void _mongocrypt_cache_find_payload_init(_mongocrypt_cache_t *cache) {
+    BSON_ASSERT_PARAM(cache);
+
+    /* The attribute holds a plaintext value. */
+    _mongocrypt_cache_init_buffers(cache, "find_payload", CACHE_ZERO_ATTR);
+    _mongocrypt_cache_set_expiration(cache, INT64_MAX);
+}
+
+void _mongocrypt_cache_find_payload_key(const _mongocrypt_buffer_t *index_key_id,
+                                        const _mongocrypt_buffer_t *value,
+                                        int64_t max_contention_factor,
+                                        _mongocrypt_buffer_t *out) {
+    _mongocrypt_buffer_t parts[3];
+    uint64_t cm_le;
+
+    BSON_ASSERT_PARAM(index_key_id);
+    BSON_ASSERT_PARAM(value);
+    BSON_ASSERT_PARAM(out);
+
+    cm_le = BSON_UINT64_TO_LE((uint64_t)max_contention_factor);
+    parts[0] = *index_key_id;
+    _mongocrypt_buffer_init(&parts[1]);
+    parts[1].data = (uint8_t *)&cm_le;
+    parts[1].len = (uint32_t)sizeof(cm_le);
+    parts[2] = *value;
+    BSON_ASSERT(_mongocrypt_buffer_concat(out, parts, 3));
+}
@@ -17,16 +17,34 @@
 #ifndef MONGOCRYPT_CACHE_KEY_PRIVATE_H
 #define MONGOCRYPT_CACHE_KEY_PRIVATE_H
 
+#include "mc-tokens-private.h"
 #include "mongocrypt-buffer-private.h"
 #include "mongocrypt-cache-private.h"
+#include "mongocrypt-crypto-private.h"
 #include "mongocrypt-key-private.h"
 #include "mongocrypt-mutex-private.h"
 #include "mongocrypt-opts-private.h"
 #include "mongocrypt-status-private.h"
 
+/* Queryable Encryption tokens derived only from the TokenKey of a data key.
+ * They do not depend on the value being encrypted, so are derived once when
+ * the key is cached. */
+typedef struct {
+    mc_CollectionsLevel1Token_t *collectionsLevel1Token;
+    mc_ServerDataEncryptionLevel1Token_t *serverDataEncryptionLevel1Token;
+    mc_ServerTokenDerivationLevel1Token_t *serverTokenDerivationLevel1Token;
+    mc_EDCToken_t *edcToken;
+    mc_ESCToken_t *escToken;
+    mc_ECOCToken_t *ecocToken;
+} _mongocrypt_cache_key_tokens_t;
+
+/* Key cache values are reference counted and immutable once created. A cache
+ * hit returns a new reference to the cached value rather than a copy. */
 typedef struct {
     _mongocrypt_key_doc_t *key_doc;
     _mongocrypt_buffer_t decrypted_key_material;
+    _mongocrypt_cache_key_tokens_t *tokens; /* may be NULL */
+    volatile int32_t refcount;
 } _mongocrypt_cache_key_value_t;
 
 typedef struct {
@@ -42,8 +60,68 @@ _mongocrypt_cache_key_attr_t *_mongocrypt_cache_key_attr_new(_mongocrypt_buffer_
 _mongocrypt_cache_key_value_t *_mongocrypt_cache_key_value_new(_mongocrypt_key_doc_t *key_doc,
                                                                _mongocrypt_buffer_t *decrypted_key_material);
 
+/* Derives the tokens of @value from its decrypted key material. Must be called
+ * before @value is shared. */
+bool _mongocrypt_cache_key_value_derive_tokens(_mongocrypt_cache_key_value_t *value,
+                                               _mongocrypt_crypto_t *crypto,
+                                               mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
+/* Returns a new reference to @value. */
+_mongocrypt_cache_key_value_t *_mongocrypt_cache_key_value_retain(_mongocrypt_cache_key_value_t *value);
+
+/* Releases a reference to @value. Frees @value when the last reference is
+ * released. */
 void _mongocrypt_cache_key_value_destroy(void *value);
 
 void _mongocrypt_cache_key_attr_destroy(_mongocrypt_cache_key_attr_t *attr);
 
+/* Number of entries of the thread-local key cache enabled with
+ * mongocrypt_setopt_key_cache_thread_local. */
+#define MC_KEY_CACHE_L1_ENTRIES 32
+
+/* Returns a new reference to the value of the key with the UUID @id in the
+ * thread-local cache in front of the key cache @cache, or NULL on a miss. An
+ * entry hits while the generation of its key id in @cache is unchanged since it
+ * was put, and until its pair expires or is offered for refresh. Takes no
+ * lock. */
+_mongocrypt_cache_key_value_t *_mongocrypt_cache_key_l1_get(_mongocrypt_cache_t *cache,
+                                                            const _mongocrypt_buffer_t *id);
+
+/* Puts a reference to @value, found in @cache with
+ * _mongocrypt_cache_get_with_validity, in the thread-local cache of the calling
+ * thread. Keys without a UUID @id are not put. */
+void _mongocrypt_cache_key_l1_put(_mongocrypt_cache_t *cache,
+                                  const _mongocrypt_buffer_t *id,
+                                  _mongocrypt_cache_key_value_t *value,
+                                  int64_t generation,
+                                  int64_t valid_until_ms);
+
+/* Releases the entries of @cache in the thread-local cache of the calling
+ * thread. Entries of other threads are released once @cache is cleaned up, when
+ * those threads next use the thread-local cache or exit. */
+void _mongocrypt_cache_key_l1_clear(_mongocrypt_cache_t *cache);
+
+/* Appends the unexpired entries of the key cache to @out. Decrypted key
+ * material is encrypted with the 96 byte @kek. @out must be initialized. */
+bool _mongocrypt_cache_key_export(_mongocrypt_cache_t *cache,
+                                  _mongocrypt_crypto_t *crypto,
+                                  _mongocrypt_buffer_t *kek,
+                                  bson_t *out,
+                                  mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
+/* Like _mongocrypt_cache_key_export, but exports only @value, as a new entry. */
+bool _mongocrypt_cache_key_export_value(_mongocrypt_cache_key_value_t *value,
+                                        _mongocrypt_crypto_t *crypto,
+                                        _mongocrypt_buffer_t *kek,
+                                        bson_t *out,
+                                        mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
+/* Adds the entries of a snapshot created by _mongocrypt_cache_key_export.
+ * Entries that have expired since the export are skipped. */
+bool _mongocrypt_cache_key_import(_mongocrypt_cache_t *cache,
+                                  _mongocrypt_crypto_t *crypto,
+                                  _mongocrypt_buffer_t *kek,
+                                  const bson_t *snapshot,
+                                  mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
 #endif /* MONGOCRYPT_CACHE_KEY_PRIVATE_H */
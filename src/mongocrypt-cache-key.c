@@ -15,6 +15,13 @@
  */
 
 #include "mongocrypt-cache-key-private.h"
+#include "mlib/thread.h"
+#include "mongocrypt-atomic-private.h"
+#include "mongocrypt-private.h"
+#include "mongocrypt-util-private.h"
+
+/* Version of the key cache snapshot format. */
+#define KEY_CACHE_SNAPSHOT_VERSION 1
 
 /* The key cache.
  *
@@ -37,6 +44,8 @@ static bool _cmp_attr(void *a, void *b, int *out) {
     if (!_mongocrypt_buffer_empty(&attr_a->id) && !_mongocrypt_buffer_empty(&attr_b->id)) {
         if (0 == _mongocrypt_buffer_cmp(&attr_a->id, &attr_b->id)) {
             *out = 0;
+            /* No need to compare the keyAltNames. */
+            return true;
         }
     }
 
@@ -48,6 +57,34 @@ static bool _cmp_attr(void *a, void *b, int *out) {
     return true;
 }
 
+/* An attribute is hashed by its key id and by each of its keyAltNames, since
+ * attributes match by either. */
+static size_t _hash_attr(void *attr_in, uint32_t *hashes, size_t max) {
+    _mongocrypt_cache_key_attr_t *attr;
+    _mongocrypt_key_alt_name_t *alt_name;
+    size_t count = 0;
+
+    BSON_ASSERT_PARAM(attr_in);
+    BSON_ASSERT_PARAM(hashes);
+
+    attr = (_mongocrypt_cache_key_attr_t *)attr_in;
+    if (!_mongocrypt_buffer_empty(&attr->id)) {
+        if (count < max) {
+            hashes[count] = mc_hash_bytes(attr->id.data, attr->id.len);
+        }
+        count++;
+    }
+
+    for (alt_name = attr->alt_names; NULL != alt_name; alt_name = alt_name->next) {
+        if (count < max) {
+            const char *str = _mongocrypt_key_alt_name_get_string(alt_name);
+            hashes[count] = mc_hash_bytes(str, strlen(str));
+        }
+        count++;
+    }
+    return count;
+}
+
 static void *_copy_attr(void *attr) {
     _mongocrypt_cache_key_attr_t *src;
 
@@ -62,13 +99,11 @@ static void _destroy_attr(void *attr) {
     _mongocrypt_cache_key_attr_destroy(attr);
 }
 
+/* Values are immutable, so "copying" shares the value. */
 static void *_copy_contents(void *value) {
-    _mongocrypt_cache_key_value_t *key_value;
-
     BSON_ASSERT_PARAM(value);
 
-    key_value = (_mongocrypt_cache_key_value_t *)value;
-    return _mongocrypt_cache_key_value_new(key_value->key_doc, &key_value->decrypted_key_material);
+    return _mongocrypt_cache_key_value_retain((_mongocrypt_cache_key_value_t *)value);
 }
 
 static void _dump_attr(void *attr_in) {
@@ -98,38 +133,328 @@ _mongocrypt_cache_key_value_t *_mongocrypt_cache_key_value_new(_mongocrypt_key_d
     key_value = bson_malloc0(sizeof(*key_value));
     BSON_ASSERT(key_value);
 
-    _mongocrypt_buffer_copy_to(decrypted_key_material, &key_value->decrypted_key_material);
+    /* Contexts take references to the key material rather than copies. */
+    _mongocrypt_buffer_copy_to_shared(decrypted_key_material, &key_value->decrypted_key_material);
 
+    /* Cached keys are already decrypted. The original BSON is not kept: it is
+     * only needed to export the key, and is recreated from the parsed
+     * fields. */
     key_value->key_doc = _mongocrypt_key_new();
-    _mongocrypt_key_doc_copy_to(key_doc, key_value->key_doc);
+    _mongocrypt_key_doc_copy_compact_to(key_doc, key_value->key_doc);
+    key_value->refcount = 1;
 
     return key_value;
 }
 
+static void _tokens_destroy(_mongocrypt_cache_key_tokens_t *tokens) {
+    if (!tokens) {
+        return;
+    }
+    mc_CollectionsLevel1Token_destroy(tokens->collectionsLevel1Token);
+    mc_ServerDataEncryptionLevel1Token_destroy(tokens->serverDataEncryptionLevel1Token);
+    mc_ServerTokenDerivationLevel1Token_destroy(tokens->serverTokenDerivationLevel1Token);
+    mc_EDCToken_destroy(tokens->edcToken);
+    mc_ESCToken_destroy(tokens->escToken);
+    mc_ECOCToken_destroy(tokens->ecocToken);
+    bson_free(tokens);
+}
+
+bool _mongocrypt_cache_key_value_derive_tokens(_mongocrypt_cache_key_value_t *value,
+                                               _mongocrypt_crypto_t *crypto,
+                                               mongocrypt_status_t *status) {
+    _mongocrypt_cache_key_tokens_t *tokens;
+    _mongocrypt_buffer_t token_key;
+
+    BSON_ASSERT_PARAM(value);
+    BSON_ASSERT_PARAM(crypto);
+    BSON_ASSERT(value->refcount == 1);
+
+    if (value->decrypted_key_material.len != MONGOCRYPT_KEY_LEN) {
+        CLIENT_ERR("invalid key material, expected len=%" PRIu32 ", got len=%" PRIu32,
+                   MONGOCRYPT_KEY_LEN,
+                   value->decrypted_key_material.len);
+        return false;
+    }
+
+    /* Key material is 3 equal sized keys: [Ke][Km][TokenKey] */
+    BSON_ASSERT(MONGOCRYPT_KEY_LEN == (3 * MONGOCRYPT_TOKEN_KEY_LEN));
+    if (!_mongocrypt_buffer_from_subrange(&token_key,
+                                          &value->decrypted_key_material,
+                                          2 * MONGOCRYPT_TOKEN_KEY_LEN,
+                                          MONGOCRYPT_TOKEN_KEY_LEN)) {
+        CLIENT_ERR("unable to get TokenKey from key material");
+        return false;
+    }
+
+    tokens = bson_malloc0(sizeof(*tokens));
+    BSON_ASSERT(tokens);
+
+    if (!(tokens->collectionsLevel1Token = mc_CollectionsLevel1Token_new(crypto, &token_key, status))
+        || !(tokens->serverDataEncryptionLevel1Token =
+                 mc_ServerDataEncryptionLevel1Token_new(crypto, &token_key, status))
+        || !(tokens->serverTokenDerivationLevel1Token =
+                 mc_ServerTokenDerivationLevel1Token_new(crypto, &token_key, status))
+        || !(tokens->edcToken = mc_EDCToken_new(crypto, tokens->collectionsLevel1Token, status))
+        || !(tokens->escToken = mc_ESCToken_new(crypto, tokens->collectionsLevel1Token, status))
+        || !(tokens->ecocToken = mc_ECOCToken_new(crypto, tokens->collectionsLevel1Token, status))) {
+        _tokens_destroy(tokens);
+        return false;
+    }
+
+    _tokens_destroy(value->tokens);
+    value->tokens = tokens;
+    return true;
+}
+
+_mongocrypt_cache_key_value_t *_mongocrypt_cache_key_value_retain(_mongocrypt_cache_key_value_t *value) {
+    int32_t prev;
+
+    BSON_ASSERT_PARAM(value);
+
+    prev = _mongocrypt_atomic_int32_fetch_add(&value->refcount, 1);
+    BSON_ASSERT(prev > 0);
+    return value;
+}
+
 void _mongocrypt_cache_key_value_destroy(void *value) {
     _mongocrypt_cache_key_value_t *key_value;
+    int32_t prev;
 
     if (!value) {
         return;
     }
     key_value = (_mongocrypt_cache_key_value_t *)value;
+    prev = _mongocrypt_atomic_int32_fetch_add(&key_value->refcount, -1);
+    BSON_ASSERT(prev > 0);
+    if (prev > 1) {
+        return;
+    }
     _mongocrypt_key_destroy(key_value->key_doc);
     _mongocrypt_buffer_cleanup(&key_value->decrypted_key_material);
+    _tokens_destroy(key_value->tokens);
     bson_free(key_value);
 }
 
+/* An entry of the thread-local key cache. */
+typedef struct {
+    _mongocrypt_cache_life_t *life; /* NULL if empty. */
+    uint32_t hash;                  /* The hash code of key_id in the key cache. */
+    int64_t generation;
+    int64_t valid_until_ms;
+    uint8_t key_id[UUID_LEN];
+    _mongocrypt_cache_key_value_t *value;
+} _key_l1_entry_t;
+
+/* The thread-local key cache is direct mapped by key id. */
+typedef struct {
+    /* The value of _mongocrypt_cache_ended_epoch at the last sweep. */
+    int64_t epoch;
+    _key_l1_entry_t entries[MC_KEY_CACHE_L1_ENTRIES];
+} _key_l1_t;
+
+static mongocrypt_thread_key_t _key_l1_thread_key;
+static mlib_once_flag _key_l1_once = MLIB_ONCE_INITIALIZER;
+
+static void _key_l1_entry_clear(_key_l1_entry_t *entry) {
+    BSON_ASSERT_PARAM(entry);
+
+    _mongocrypt_cache_key_value_destroy(entry->value);
+    _mongocrypt_cache_life_release(entry->life);
+    memset(entry, 0, sizeof(*entry));
+}
+
+static void MONGOCRYPT_THREAD_KEY_CALLBACK _key_l1_destroy(void *ptr) {
+    _key_l1_t *l1 = ptr;
+
+    if (!l1) {
+        return;
+    }
+    for (size_t i = 0; i < MC_KEY_CACHE_L1_ENTRIES; i++) {
+        _key_l1_entry_clear(&l1->entries[i]);
+    }
+    bson_free(l1);
+}
+
+static void _key_l1_init_once(void) {
+    _mongocrypt_thread_key_init(&_key_l1_thread_key, _key_l1_destroy);
+}
+
+/* Releases the entries of the caches cleaned up since the last sweep of @l1. A
+ * destroyed mongocrypt_t leaves no keys behind in a thread once it uses the
+ * thread-local cache again. */
+static void _key_l1_sweep(_key_l1_t *l1) {
+    const int64_t epoch = _mongocrypt_cache_ended_epoch();
+
+    BSON_ASSERT_PARAM(l1);
+
+    if (l1->epoch == epoch) {
+        return;
+    }
+    l1->epoch = epoch;
+    for (size_t i = 0; i < MC_KEY_CACHE_L1_ENTRIES; i++) {
+        if (l1->entries[i].life && _mongocrypt_cache_life_ended(l1->entries[i].life)) {
+            _key_l1_entry_clear(&l1->entries[i]);
+        }
+    }
+}
+
+/* Returns the thread-local key cache of the calling thread. Returns NULL if it
+ * does not exist yet and @create is false. */
+static _key_l1_t *_key_l1_get(bool create) {
+    _key_l1_t *l1;
+
+    BSON_ASSERT(mlib_call_once(&_key_l1_once, _key_l1_init_once));
+    l1 = _mongocrypt_thread_key_get(&_key_l1_thread_key);
+    if (!l1 && create) {
+        l1 = bson_malloc0(sizeof(*l1));
+        BSON_ASSERT(l1);
+        l1->epoch = _mongocrypt_cache_ended_epoch();
+        _mongocrypt_thread_key_set(&_key_l1_thread_key, l1);
+    }
+    if (l1) {
+        _key_l1_sweep(l1);
+    }
+    return l1;
+}
+
+static _key_l1_entry_t *_key_l1_entry(_key_l1_t *l1, _mongocrypt_cache_t *cache, const _mongocrypt_buffer_t *id) {
+    uint32_t hash;
+
+    BSON_ASSERT_PARAM(l1);
+    BSON_ASSERT_PARAM(cache);
+    BSON_ASSERT_PARAM(id);
+
+    /* Key ids are random UUIDs, so any four bytes spread well. */
+    memcpy(&hash, id->data, sizeof(hash));
+    hash ^= (uint32_t)((uintptr_t)cache->life >> 4) * 0x9E3779B9u;
+    return &l1->entries[hash % MC_KEY_CACHE_L1_ENTRIES];
+}
+
+_mongocrypt_cache_key_value_t *_mongocrypt_cache_key_l1_get(_mongocrypt_cache_t *cache,
+                                                            const _mongocrypt_buffer_t *id) {
+    _key_l1_t *l1;
+    _key_l1_entry_t *entry;
+
+    BSON_ASSERT_PARAM(cache);
+    BSON_ASSERT_PARAM(id);
+
+    if (id->len != UUID_LEN || !(l1 = _key_l1_get(false))) {
+        return NULL;
+    }
+    entry = _key_l1_entry(l1, cache, id);
+    if (entry->life != cache->life || 0 != memcmp(entry->key_id, id->data, UUID_LEN)) {
+        return NULL;
+    }
+    if (entry->generation != _mongocrypt_cache_generation(cache, entry->hash)
+        || bson_get_monotonic_time() / 1000 >= entry->valid_until_ms) {
+        _key_l1_entry_clear(entry);
+        return NULL;
+    }
+    return _mongocrypt_cache_key_value_retain(entry->value);
+}
+
+void _mongocrypt_cache_key_l1_put(_mongocrypt_cache_t *cache,
+                                  const _mongocrypt_buffer_t *id,
+                                  _mongocrypt_cache_key_value_t *value,
+                                  int64_t generation,
+                                  int64_t valid_until_ms) {
+    _key_l1_entry_t *entry;
+
+    BSON_ASSERT_PARAM(cache);
+    BSON_ASSERT_PARAM(id);
+    BSON_ASSERT_PARAM(value);
+
+    if (id->len != UUID_LEN) {
+        return;
+    }
+    entry = _key_l1_entry(_key_l1_get(true), cache, id);
+    _key_l1_entry_clear(entry);
+    entry->life = _mongocrypt_cache_life_retain(cache);
+    /* The first hash code of an attribute with an id, see _hash_attr. */
+    entry->hash = mc_hash_bytes(id->data, id->len);
+    entry->generation = generation;
+    entry->valid_until_ms = valid_until_ms;
+    memcpy(entry->key_id, id->data, UUID_LEN);
+    entry->value = _mongocrypt_cache_key_value_retain(value);
+}
+
+void _mongocrypt_cache_key_l1_clear(_mongocrypt_cache_t *cache) {
+    _key_l1_t *l1;
+
+    BSON_ASSERT_PARAM(cache);
+
+    if (!(l1 = _key_l1_get(false))) {
+        return;
+    }
+    for (size_t i = 0; i < MC_KEY_CACHE_L1_ENTRIES; i++) {
+        if (l1->entries[i].life == cache->life) {
+            _key_l1_entry_clear(&l1->entries[i]);
+        }
+    }
+}
+
+static size_t _alt_names_size(_mongocrypt_key_alt_name_t *alt_names) {
+    size_t bytes = 0;
+
+    for (; NULL != alt_names; alt_names = alt_names->next) {
+        bytes += sizeof(*alt_names) + strlen(_mongocrypt_key_alt_name_get_string(alt_names)) + 1u;
+    }
+    return bytes;
+}
+
+static size_t _size_attr(void *attr_in) {
+    _mongocrypt_cache_key_attr_t *attr;
+
+    BSON_ASSERT_PARAM(attr_in);
+
+    attr = (_mongocrypt_cache_key_attr_t *)attr_in;
+    return sizeof(*attr) + attr->id.len + _alt_names_size(attr->alt_names);
+}
+
+#define TOKEN_SIZE(Prefix, token) (sizeof(_mongocrypt_buffer_t) + BSON_CONCAT(Prefix, _get)(token)->len)
+
+static size_t _size_value(void *value_in) {
+    _mongocrypt_cache_key_value_t *value;
+    _mongocrypt_key_doc_t *key_doc;
+    size_t bytes;
+
+    BSON_ASSERT_PARAM(value_in);
+
+    value = (_mongocrypt_cache_key_value_t *)value_in;
+    key_doc = value->key_doc;
+    bytes = sizeof(*value) + value->decrypted_key_material.len;
+    bytes += sizeof(*key_doc) + key_doc->id.len + key_doc->key_material.len;
+    bytes += _alt_names_size(key_doc->key_alt_names);
+    if (value->tokens) {
+        _mongocrypt_cache_key_tokens_t *tokens = value->tokens;
+
+        bytes += sizeof(*tokens);
+        bytes += TOKEN_SIZE(mc_CollectionsLevel1Token, tokens->collectionsLevel1Token);
+        bytes += TOKEN_SIZE(mc_ServerDataEncryptionLevel1Token, tokens->serverDataEncryptionLevel1Token);
+        bytes += TOKEN_SIZE(mc_ServerTokenDerivationLevel1Token, tokens->serverTokenDerivationLevel1Token);
+        bytes += TOKEN_SIZE(mc_EDCToken, tokens->edcToken);
+        bytes += TOKEN_SIZE(mc_ESCToken, tokens->escToken);
+        bytes += TOKEN_SIZE(mc_ECOCToken, tokens->ecocToken);
+    }
+    return bytes;
+}
+
+#undef TOKEN_SIZE
+
 void _mongocrypt_cache_key_init(_mongocrypt_cache_t *cache) {
     BSON_ASSERT_PARAM(cache);
 
+    _mongocrypt_cache_init(cache);
+    cache->name = "key";
     cache->cmp_attr = _cmp_attr;
+    cache->hash_attr = _hash_attr;
     cache->copy_attr = _copy_attr;
     cache->destroy_attr = _destroy_attr;
     cache->copy_value = _copy_contents;
     cache->destroy_value = _mongocrypt_cache_key_value_destroy;
     cache->dump_attr = _dump_attr;
-    _mongocrypt_mutex_init(&cache->mutex);
-    cache->pair = NULL;
-    cache->expiration = CACHE_EXPIRATION_MS;
+    cache->size_attr = _size_attr;
+    cache->size_value = _size_value;
 }
 
 /* Since key cache may be looked up by either _id or keyAltName,
@@ -160,3 +485,254 @@ void _mongocrypt_cache_key_attr_destroy(_mongocrypt_cache_key_attr_t *attr) {
     _mongocrypt_key_alt_name_destroy_all(attr->alt_names);
     bson_free(attr);
 }
+
+typedef struct {
+    _mongocrypt_crypto_t *crypto;
+    _mongocrypt_buffer_t *kek;
+    bson_t *keys;
+    uint32_t count;
+    mongocrypt_status_t *status;
+} _export_ctx_t;
+
+static bool _export_one(void *attr, void *value, int64_t age_ms, void *ctx_in) {
+    _mongocrypt_cache_key_value_t *key_value;
+    _export_ctx_t *ctx;
+    _mongocrypt_buffer_t wrapped;
+    mongocrypt_status_t *status;
+    const char *index_str;
+    char storage[16];
+    bson_t entry;
+    bson_t key_doc = BSON_INITIALIZER;
+    bool ret = false;
+
+    BSON_ASSERT_PARAM(value);
+    BSON_ASSERT_PARAM(ctx_in);
+
+    key_value = (_mongocrypt_cache_key_value_t *)value;
+    ctx = (_export_ctx_t *)ctx_in;
+    status = ctx->status;
+
+    if (!_mongocrypt_wrap_key(ctx->crypto, ctx->kek, &key_value->decrypted_key_material, &wrapped, status)) {
+        goto done;
+    }
+    if (!_mongocrypt_key_doc_append(key_value->key_doc, &key_doc, status)) {
+        goto done;
+    }
+
+    bson_uint32_to_string(ctx->count, &index_str, storage, sizeof(storage));
+    if (!bson_append_document_begin(ctx->keys, index_str, -1, &entry)
+        || !BSON_APPEND_DOCUMENT(&entry, "keyDocument", &key_doc)
+        || !_mongocrypt_buffer_append(&wrapped, &entry, "keyMaterial", -1)
+        || !BSON_APPEND_INT64(&entry, "ageMS", age_ms) || !bson_append_document_end(ctx->keys, &entry)) {
+        CLIENT_ERR("failed to append key cache entry");
+        goto done;
+    }
+    ctx->count++;
+    ret = true;
+
+done:
+    bson_destroy(&key_doc);
+    _mongocrypt_buffer_cleanup(&wrapped);
+    return ret;
+}
+
+/* Exports the entries visited by @visit to @out. @visit calls _export_one for
+ * each entry. */
+static bool _export(_mongocrypt_crypto_t *crypto,
+                    _mongocrypt_buffer_t *kek,
+                    bool (*visit)(_export_ctx_t *ctx, void *visit_ctx),
+                    void *visit_ctx,
+                    bson_t *out,
+                    mongocrypt_status_t *status) {
+    _export_ctx_t ctx = {0};
+    bson_t keys;
+
+    BSON_ASSERT_PARAM(crypto);
+    BSON_ASSERT_PARAM(kek);
+    BSON_ASSERT_PARAM(out);
+
+    if (kek->len != MONGOCRYPT_KEY_LEN) {
+        CLIENT_ERR("key cache snapshot key must be %d bytes", MONGOCRYPT_KEY_LEN);
+        return false;
+    }
+
+    if (!BSON_APPEND_INT32(out, "v", KEY_CACHE_SNAPSHOT_VERSION) || !BSON_APPEND_ARRAY_BEGIN(out, "keys", &keys)) {
+        CLIENT_ERR("failed to append key cache snapshot");
+        return false;
+    }
+
+    ctx.crypto = crypto;
+    ctx.kek = kek;
+    ctx.keys = &keys;
+    ctx.status = status;
+    if (!visit(&ctx, visit_ctx)) {
+        bson_append_array_end(out, &keys);
+        return false;
+    }
+
+    if (!bson_append_array_end(out, &keys)) {
+        CLIENT_ERR("failed to append key cache snapshot");
+        return false;
+    }
+    return true;
+}
+
+static bool _visit_cache(_export_ctx_t *ctx, void *cache) {
+    return _mongocrypt_cache_foreach((_mongocrypt_cache_t *)cache, _export_one, ctx);
+}
+
+static bool _visit_value(_export_ctx_t *ctx, void *value) {
+    return _export_one(NULL, value, 0, ctx);
+}
+
+bool _mongocrypt_cache_key_export(_mongocrypt_cache_t *cache,
+                                  _mongocrypt_crypto_t *crypto,
+                                  _mongocrypt_buffer_t *kek,
+                                  bson_t *out,
+                                  mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(cache);
+
+    return _export(crypto, kek, _visit_cache, cache, out, status);
+}
+
+bool _mongocrypt_cache_key_export_value(_mongocrypt_cache_key_value_t *value,
+                                        _mongocrypt_crypto_t *crypto,
+                                        _mongocrypt_buffer_t *kek,
+                                        bson_t *out,
+                                        mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(value);
+
+    return _export(crypto, kek, _visit_value, value, out, status);
+}
+
+static bool _import_one(_mongocrypt_cache_t *cache,
+                        _mongocrypt_crypto_t *crypto,
+                        _mongocrypt_buffer_t *kek,
+                        bson_iter_t *entry_iter,
+                        mongocrypt_status_t *status) {
+    _mongocrypt_key_doc_t *key_doc = NULL;
+    _mongocrypt_cache_key_attr_t *attr = NULL;
+    _mongocrypt_cache_key_value_t *value;
+    _mongocrypt_buffer_t wrapped, material;
+    bson_iter_t iter;
+    bson_t doc_bson;
+    int64_t age_ms;
+    bool ret = false;
+
+    BSON_ASSERT_PARAM(entry_iter);
+
+    _mongocrypt_buffer_init(&wrapped);
+    _mongocrypt_buffer_init(&material);
+
+    if (!BSON_ITER_HOLDS_DOCUMENT(entry_iter) || !bson_iter_recurse(entry_iter, &iter)
+        || !bson_iter_find(&iter, "ageMS") || !BSON_ITER_HOLDS_INT64(&iter)) {
+        CLIENT_ERR("invalid key cache snapshot entry: expected int64 'ageMS'");
+        goto done;
+    }
+    age_ms = bson_iter_int64(&iter);
+    if (age_ms < 0) {
+        CLIENT_ERR("invalid key cache snapshot entry: negative 'ageMS'");
+        goto done;
+    }
+    BSON_ASSERT(cache->expiration <= INT64_MAX);
+    if (age_ms >= (int64_t)cache->expiration) {
+        /* Expired since the export. */
+        ret = true;
+        goto done;
+    }
+
+    if (!bson_iter_recurse(entry_iter, &iter) || !bson_iter_find(&iter, "keyMaterial")
+        || !_mongocrypt_buffer_copy_from_binary_iter(&wrapped, &iter)) {
+        CLIENT_ERR("invalid key cache snapshot entry: expected binary 'keyMaterial'");
+        goto done;
+    }
+
+    if (!bson_iter_recurse(entry_iter, &iter) || !bson_iter_find(&iter, "keyDocument")
+        || !BSON_ITER_HOLDS_DOCUMENT(&iter)) {
+        CLIENT_ERR("invalid key cache snapshot entry: expected document 'keyDocument'");
+        goto done;
+    }
+    {
+        const uint8_t *data;
+        uint32_t len;
+
+        bson_iter_document(&iter, &len, &data);
+        if (!bson_init_static(&doc_bson, data, len)) {
+            CLIENT_ERR("invalid key cache snapshot entry: malformed 'keyDocument'");
+            goto done;
+        }
+    }
+
+    key_doc = _mongocrypt_key_new();
+    /* Exported key documents may have been fetched with a projection. */
+    if (!_mongocrypt_key_parse_projected_owned(&doc_bson, key_doc, status)) {
+        goto done;
+    }
+
+    if (!_mongocrypt_unwrap_key(crypto, kek, &wrapped, &material, status)) {
+        goto done;
+    }
+    if (material.len != MONGOCRYPT_KEY_LEN) {
+        CLIENT_ERR("invalid key cache snapshot entry: decrypted key is incorrect length");
+        goto done;
+    }
+
+    attr = _mongocrypt_cache_key_attr_new(&key_doc->id, key_doc->key_alt_names);
+    if (!attr) {
+        CLIENT_ERR("could not create key cache attribute");
+        goto done;
+    }
+    value = _mongocrypt_cache_key_value_new(key_doc, &material);
+    if (!_mongocrypt_cache_key_value_derive_tokens(value, crypto, status)) {
+        _mongocrypt_cache_key_value_destroy(value);
+        goto done;
+    }
+    if (!_mongocrypt_cache_add_stolen_aged(cache, attr, value, age_ms, status)) {
+        goto done;
+    }
+    ret = true;
+
+done:
+    _mongocrypt_cache_key_attr_destroy(attr);
+    _mongocrypt_key_destroy(key_doc);
+    _mongocrypt_buffer_cleanup(&material);
+    _mongocrypt_buffer_cleanup(&wrapped);
+    return ret;
+}
+
+bool _mongocrypt_cache_key_import(_mongocrypt_cache_t *cache,
+                                  _mongocrypt_crypto_t *crypto,
+                                  _mongocrypt_buffer_t *kek,
+                                  const bson_t *snapshot,
+                                  mongocrypt_status_t *status) {
+    bson_iter_t iter, keys_iter;
+
+    BSON_ASSERT_PARAM(cache);
+    BSON_ASSERT_PARAM(crypto);
+    BSON_ASSERT_PARAM(kek);
+    BSON_ASSERT_PARAM(snapshot);
+
+    if (kek->len != MONGOCRYPT_KEY_LEN) {
+        CLIENT_ERR("key cache snapshot key must be %d bytes", MONGOCRYPT_KEY_LEN);
+        return false;
+    }
+
+    if (!bson_iter_init_find(&iter, snapshot, "v") || !BSON_ITER_HOLDS_INT32(&iter)
+        || bson_iter_int32(&iter) != KEY_CACHE_SNAPSHOT_VERSION) {
+        CLIENT_ERR("unsupported key cache snapshot version");
+        return false;
+    }
+
+    if (!bson_iter_init_find(&iter, snapshot, "keys") || !BSON_ITER_HOLDS_ARRAY(&iter)
+        || !bson_iter_recurse(&iter, &keys_iter)) {
+        CLIENT_ERR("invalid key cache snapshot: expected array 'keys'");
+        return false;
+    }
+
+    while (bson_iter_next(&keys_iter)) {
+        if (!_import_one(cache, crypto, kek, &keys_iter, status)) {
+            return false;
+        }
+    }
+    return true;
+}
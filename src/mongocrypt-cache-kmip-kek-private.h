@@ -0,0 +1,31 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MONGOCRYPT_CACHE_KMIP_KEK_PRIVATE_H
+#define MONGOCRYPT_CACHE_KMIP_KEK_PRIVATE_H
+
+#include "mongocrypt-cache-private.h"
+
+/* The KMIP KEK cache holds the SecretData retrieved with a KMIP Get by the
+ * KMIP endpoint and key ID, so data keys wrapped by the same KEK are unwrapped
+ * without another Get. Entries expire after opts.kmip_kek_cache_expiration_ms
+ * and are zeroed when evicted. */
+void _mongocrypt_cache_kmip_kek_init(_mongocrypt_cache_t *cache);
+
+/* Sets @out to the cache key of the KMIP key @key_id on the KMIP server
+ * @host_and_port. @out must be cleaned up with _mongocrypt_buffer_cleanup. */
+void _mongocrypt_cache_kmip_kek_key(const char *host_and_port, const char *key_id, _mongocrypt_buffer_t *out);
+
+#endif /* MONGOCRYPT_CACHE_KMIP_KEK_PRIVATE_H */
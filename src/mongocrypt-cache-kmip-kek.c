@@ -0,0 +1,47 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mongocrypt-cache-kmip-kek-private.h"
+
+/* The KMIP KEK cache.
+ *
+ * Attribute is a _mongocrypt_buffer_t of the KMIP endpoint and key ID, each
+ * followed by a NULL byte.
+ * Value is a _mongocrypt_buffer_t of the KEK SecretData.
+ */
+
+void _mongocrypt_cache_kmip_kek_init(_mongocrypt_cache_t *cache) {
+    BSON_ASSERT_PARAM(cache);
+
+    /* The value holds key material. */
+    _mongocrypt_cache_init_buffers(cache, "kmip_kek", CACHE_ZERO_VALUE);
+}
+
+void _mongocrypt_cache_kmip_kek_key(const char *host_and_port, const char *key_id, _mongocrypt_buffer_t *out) {
+    _mongocrypt_buffer_t parts[2];
+
+    BSON_ASSERT_PARAM(host_and_port);
+    BSON_ASSERT_PARAM(key_id);
+    BSON_ASSERT_PARAM(out);
+
+    _mongocrypt_buffer_init(&parts[0]);
+    parts[0].data = (uint8_t *)host_and_port;
+    parts[0].len = (uint32_t)strlen(host_and_port) + 1u;
+    _mongocrypt_buffer_init(&parts[1]);
+    parts[1].data = (uint8_t *)key_id;
+    parts[1].len = (uint32_t)strlen(key_id) + 1u;
+    BSON_ASSERT(_mongocrypt_buffer_concat(out, parts, 2));
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MONGOCRYPT_CACHE_MARKING_PRIVATE_H
+#define MONGOCRYPT_CACHE_MARKING_PRIVATE_H
+
+#include "mongocrypt-cache-private.h"
+
+/* The marking cache holds query analysis replies by command shape. A reply
+ * only depends on the command and the schema, and the schema is part of the
+ * shape, so entries do not expire. */
+void _mongocrypt_cache_marking_init(_mongocrypt_cache_t *cache);
+
+/* Sets @out to the cache key of the command @markings_cmd sent for query
+ * analysis on @ns from database @db. The key keeps the field names, the types
+ * of values, booleans, strings starting with '$', and the schema, but not
+ * other values.
+ * @out must be cleaned up with _mongocrypt_buffer_cleanup. */
+bool _mongocrypt_cache_marking_key(const char *ns,
+                                   const char *db,
+                                   const bson_t *markings_cmd,
+                                   _mongocrypt_buffer_t *out,
+                                   mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
+/* Sets @out to the query analysis reply @reply with the values of @markings_cmd
+ * in place of the values of the command @reply was returned for. Each
+ * marking's value is replaced with the value at the same path in
+ * @markings_cmd.
+ *
+ * Returns false if @reply cannot be applied to @markings_cmd: if a type or a
+ * string outside a marking differs, or a marking uses a key alt name. @out is
+ * then left uninitialized.
+ *
+ * A reply may be cached only if replaying it onto its own command returns it
+ * unchanged. */
+bool _mongocrypt_cache_marking_replay(const _mongocrypt_buffer_t *reply,
+                                      const bson_t *markings_cmd,
+                                      _mongocrypt_buffer_t *out) MONGOCRYPT_WARN_UNUSED_RESULT;
+
+/* Sets @out to the query analysis reply @reply with the value of each marking
+ * replaced by null, so the cache does not hold the values to encrypt. Replaying
+ * @out gives the same result as replaying @reply.
+ *
+ * Returns false if a marking cannot be stripped. @out is then left
+ * uninitialized. */
+bool _mongocrypt_cache_marking_strip(const _mongocrypt_buffer_t *reply,
+                                     _mongocrypt_buffer_t *out) MONGOCRYPT_WARN_UNUSED_RESULT;
+
+#endif /* MONGOCRYPT_CACHE_MARKING_PRIVATE_H */
@@ -0,0 +1,372 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mc-fle-blob-subtype-private.h"
+#include "mongocrypt-cache-marking-private.h"
+#include "mongocrypt-private.h"
+
+/* The marking cache.
+ *
+ * Attribute is a _mongocrypt_buffer_t of BSON encoding the namespace and the
+ * shape of the command sent for query analysis.
+ * Value is a _mongocrypt_buffer_t of the BSON query analysis reply.
+ */
+
+void _mongocrypt_cache_marking_init(_mongocrypt_cache_t *cache) {
+    BSON_ASSERT_PARAM(cache);
+
+    /* Replies are stripped of marked values, but may hold other values of the
+     * command. */
+    _mongocrypt_cache_init_buffers(cache, "marking", CACHE_ZERO_VALUE);
+    _mongocrypt_cache_set_expiration(cache, INT64_MAX);
+}
+
+/* The schema sent for query analysis is part of the shape. */
+static bool _is_schema_field(const char *key) {
+    return 0 == strcmp(key, "jsonSchema") || 0 == strcmp(key, "encryptionInformation");
+}
+
+static bool _append_shape(bson_iter_t *iter, bson_t *out) {
+    BSON_ASSERT_PARAM(iter);
+    BSON_ASSERT_PARAM(out);
+
+    while (bson_iter_next(iter)) {
+        const char *key = bson_iter_key(iter);
+        const int key_len = (int)bson_iter_key_len(iter);
+        const bson_type_t type = bson_iter_type(iter);
+        uint32_t str_len;
+
+        if (_is_schema_field(key) || type == BSON_TYPE_BOOL
+            || (type == BSON_TYPE_UTF8 && bson_iter_utf8(iter, &str_len)[0] == '$')) {
+            // Booleans and field paths may change what is analyzed.
+            if (!bson_append_iter(out, key, key_len, iter)) {
+                return false;
+            }
+        } else if (type == BSON_TYPE_DOCUMENT || type == BSON_TYPE_ARRAY) {
+            bson_iter_t child_iter;
+            bson_t child;
+
+            if (!bson_iter_recurse(iter, &child_iter)) {
+                return false;
+            }
+            if (type == BSON_TYPE_DOCUMENT ? !bson_append_document_begin(out, key, key_len, &child)
+                                           : !bson_append_array_begin(out, key, key_len, &child)) {
+                return false;
+            }
+            if (!_append_shape(&child_iter, &child)) {
+                return false;
+            }
+            if (type == BSON_TYPE_DOCUMENT ? !bson_append_document_end(out, &child)
+                                           : !bson_append_array_end(out, &child)) {
+                return false;
+            }
+        } else {
+            // Other values only contribute their type.
+            if (!bson_append_int32(out, key, key_len, (int32_t)type)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool _mongocrypt_cache_marking_key(const char *ns,
+                                   const char *db,
+                                   const bson_t *markings_cmd,
+                                   _mongocrypt_buffer_t *out,
+                                   mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(ns);
+    BSON_ASSERT_PARAM(db);
+    BSON_ASSERT_PARAM(markings_cmd);
+    BSON_ASSERT_PARAM(out);
+
+    bson_t key = BSON_INITIALIZER;
+    bson_t shape;
+    bson_iter_t iter;
+
+    if (!BSON_APPEND_UTF8(&key, "ns", ns) || !BSON_APPEND_UTF8(&key, "db", db)
+        || !BSON_APPEND_DOCUMENT_BEGIN(&key, "cmd", &shape) || !bson_iter_init(&iter, markings_cmd)
+        || !_append_shape(&iter, &shape) || !bson_append_document_end(&key, &shape)) {
+        CLIENT_ERR("failed to create marking cache key");
+        bson_destroy(&key);
+        return false;
+    }
+
+    _mongocrypt_buffer_steal_from_bson(out, &key);
+    return true;
+}
+
+static bool _iter_holds_marking(const bson_iter_t *iter) {
+    BSON_ASSERT_PARAM(iter);
+
+    bson_subtype_t subtype;
+    uint32_t len;
+    const uint8_t *data;
+
+    if (!BSON_ITER_HOLDS_BINARY(iter)) {
+        return false;
+    }
+    bson_iter_binary(iter, &subtype, &len, &data);
+    return subtype == BSON_SUBTYPE_ENCRYPTED && len > 0
+        && (data[0] == MC_SUBTYPE_FLE1EncryptionPlaceholder || data[0] == MC_SUBTYPE_FLE2EncryptionPlaceholder);
+}
+
+/* Appends the marking at @marking_iter with its value "v" replaced by the
+ * value at @value_iter. */
+static bool _replay_marking(const bson_iter_t *marking_iter,
+                            const bson_iter_t *value_iter,
+                            const char *key,
+                            int key_len,
+                            bson_t *out) {
+    BSON_ASSERT_PARAM(marking_iter);
+    BSON_ASSERT_PARAM(value_iter);
+    BSON_ASSERT_PARAM(key);
+    BSON_ASSERT_PARAM(out);
+
+    bson_subtype_t subtype;
+    uint32_t len;
+    const uint8_t *data;
+    bson_t marking;
+    bson_t replayed = BSON_INITIALIZER;
+    bson_iter_t iter;
+    bool found_v = false;
+    bool ok = false;
+    uint8_t *bytes = NULL;
+
+    bson_iter_binary(marking_iter, &subtype, &len, &data);
+    if (!bson_init_static(&marking, data + 1, len - 1) || !bson_iter_init(&iter, &marking)) {
+        goto done;
+    }
+    while (bson_iter_next(&iter)) {
+        const char *field = bson_iter_key(&iter);
+
+        if (0 == strcmp(field, "ka")) {
+            // The key alt name may come from a field of the command.
+            goto done;
+        }
+        if (0 == strcmp(field, "v")) {
+            found_v = true;
+            if (!bson_append_iter(&replayed, "v", 1, value_iter)) {
+                goto done;
+            }
+        } else if (!bson_append_iter(&replayed, field, -1, &iter)) {
+            goto done;
+        }
+    }
+    if (!found_v || replayed.len > UINT32_MAX - 1u) {
+        goto done;
+    }
+
+    bytes = bson_malloc(replayed.len + 1u);
+    bytes[0] = data[0];
+    memcpy(bytes + 1, bson_get_data(&replayed), replayed.len);
+    ok = bson_append_binary(out, key, key_len, BSON_SUBTYPE_ENCRYPTED, bytes, replayed.len + 1u);
+
+done:
+    bson_free(bytes);
+    bson_destroy(&replayed);
+    return ok;
+}
+
+/* Appends the fields of the analyzed command at @tmpl_iter to @out, taking
+ * values from the fields of @cmd with the same name. */
+static bool _replay_doc(bson_iter_t *tmpl_iter, const bson_t *cmd, bson_t *out) {
+    BSON_ASSERT_PARAM(tmpl_iter);
+    BSON_ASSERT_PARAM(cmd);
+    BSON_ASSERT_PARAM(out);
+
+    while (bson_iter_next(tmpl_iter)) {
+        const char *key = bson_iter_key(tmpl_iter);
+        const int key_len = (int)bson_iter_key_len(tmpl_iter);
+        const bson_type_t type = bson_iter_type(tmpl_iter);
+        bson_iter_t cmd_iter;
+
+        if (!bson_iter_init_find(&cmd_iter, cmd, key)) {
+            // Added by query analysis.
+            if (!bson_append_iter(out, key, key_len, tmpl_iter)) {
+                return false;
+            }
+            continue;
+        }
+
+        if (_iter_holds_marking(tmpl_iter)) {
+            if (!_replay_marking(tmpl_iter, &cmd_iter, key, key_len, out)) {
+                return false;
+            }
+            continue;
+        }
+
+        if (bson_iter_type(&cmd_iter) != type) {
+            return false;
+        }
+
+        if (type == BSON_TYPE_DOCUMENT || type == BSON_TYPE_ARRAY) {
+            bson_iter_t child_iter;
+            bson_t cmd_child;
+            bson_t child;
+            uint32_t len;
+            const uint8_t *data;
+
+            if (type == BSON_TYPE_DOCUMENT) {
+                bson_iter_document(&cmd_iter, &len, &data);
+            } else {
+                bson_iter_array(&cmd_iter, &len, &data);
+            }
+            if (!bson_init_static(&cmd_child, data, len) || !bson_iter_recurse(tmpl_iter, &child_iter)) {
+                return false;
+            }
+            if (type == BSON_TYPE_DOCUMENT ? !bson_append_document_begin(out, key, key_len, &child)
+                                           : !bson_append_array_begin(out, key, key_len, &child)) {
+                return false;
+            }
+            if (!_replay_doc(&child_iter, &cmd_child, &child)) {
+                // Close child so @out can be destroyed.
+                (void)(type == BSON_TYPE_DOCUMENT ? bson_append_document_end(out, &child)
+                                                  : bson_append_array_end(out, &child));
+                return false;
+            }
+            if (type == BSON_TYPE_DOCUMENT ? !bson_append_document_end(out, &child)
+                                           : !bson_append_array_end(out, &child)) {
+                return false;
+            }
+            continue;
+        }
+
+        if (type == BSON_TYPE_UTF8) {
+            // Strings outside markings may name fields or collections.
+            uint32_t tmpl_len, cmd_len;
+            const char *tmpl_str = bson_iter_utf8(tmpl_iter, &tmpl_len);
+            const char *cmd_str = bson_iter_utf8(&cmd_iter, &cmd_len);
+
+            if (tmpl_len != cmd_len || 0 != memcmp(tmpl_str, cmd_str, tmpl_len)) {
+                return false;
+            }
+        }
+
+        if (!bson_append_iter(out, key, key_len, &cmd_iter)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool _mongocrypt_cache_marking_replay(const _mongocrypt_buffer_t *reply,
+                                      const bson_t *markings_cmd,
+                                      _mongocrypt_buffer_t *out) {
+    BSON_ASSERT_PARAM(reply);
+    BSON_ASSERT_PARAM(markings_cmd);
+    BSON_ASSERT_PARAM(out);
+
+    bson_t reply_bson;
+    bson_t replayed = BSON_INITIALIZER;
+    bson_iter_t iter;
+
+    if (!_mongocrypt_buffer_to_bson(reply, &reply_bson) || !bson_iter_init(&iter, &reply_bson)) {
+        goto fail;
+    }
+    while (bson_iter_next(&iter)) {
+        const char *key = bson_iter_key(&iter);
+
+        if (0 == strcmp(key, "result") && BSON_ITER_HOLDS_DOCUMENT(&iter)) {
+            bson_iter_t result_iter;
+            bson_t result;
+            bool ok;
+
+            if (!bson_iter_recurse(&iter, &result_iter) || !BSON_APPEND_DOCUMENT_BEGIN(&replayed, "result", &result)) {
+                goto fail;
+            }
+            ok = _replay_doc(&result_iter, markings_cmd, &result);
+            if (!bson_append_document_end(&replayed, &result) || !ok) {
+                goto fail;
+            }
+        } else if (!bson_append_iter(&replayed, key, -1, &iter)) {
+            goto fail;
+        }
+    }
+
+    _mongocrypt_buffer_steal_from_bson(out, &replayed);
+    return true;
+
+fail:
+    bson_destroy(&replayed);
+    return false;
+}
+
+/* Appends the fields at @iter to @out with the value "v" of each marking
+ * replaced by null. */
+static bool _strip_doc(bson_iter_t *iter, const bson_iter_t *null_iter, bson_t *out) {
+    BSON_ASSERT_PARAM(iter);
+    BSON_ASSERT_PARAM(null_iter);
+    BSON_ASSERT_PARAM(out);
+
+    while (bson_iter_next(iter)) {
+        const char *key = bson_iter_key(iter);
+        const int key_len = (int)bson_iter_key_len(iter);
+        const bson_type_t type = bson_iter_type(iter);
+
+        if (_iter_holds_marking(iter)) {
+            if (!_replay_marking(iter, null_iter, key, key_len, out)) {
+                return false;
+            }
+        } else if (type == BSON_TYPE_DOCUMENT || type == BSON_TYPE_ARRAY) {
+            bson_iter_t child_iter;
+            bson_t child;
+            bool ok;
+
+            if (!bson_iter_recurse(iter, &child_iter)) {
+                return false;
+            }
+            if (type == BSON_TYPE_DOCUMENT ? !bson_append_document_begin(out, key, key_len, &child)
+                                           : !bson_append_array_begin(out, key, key_len, &child)) {
+                return false;
+            }
+            ok = _strip_doc(&child_iter, null_iter, &child);
+            if (type == BSON_TYPE_DOCUMENT ? !bson_append_document_end(out, &child)
+                                           : !bson_append_array_end(out, &child)) {
+                return false;
+            }
+            if (!ok) {
+                return false;
+            }
+        } else if (!bson_append_iter(out, key, key_len, iter)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool _mongocrypt_cache_marking_strip(const _mongocrypt_buffer_t *reply, _mongocrypt_buffer_t *out) {
+    BSON_ASSERT_PARAM(reply);
+    BSON_ASSERT_PARAM(out);
+
+    bson_t reply_bson;
+    bson_t null_doc = BSON_INITIALIZER;
+    bson_t stripped = BSON_INITIALIZER;
+    bson_iter_t iter;
+    bson_iter_t null_iter;
+
+    if (!_mongocrypt_buffer_to_bson(reply, &reply_bson) || !bson_iter_init(&iter, &reply_bson)
+        || !BSON_APPEND_NULL(&null_doc, "v") || !bson_iter_init_find(&null_iter, &null_doc, "v")
+        || !_strip_doc(&iter, &null_iter, &stripped)) {
+        bson_destroy(&null_doc);
+        bson_destroy(&stripped);
+        return false;
+    }
+
+    bson_destroy(&null_doc);
+    _mongocrypt_buffer_steal_from_bson(out, &stripped);
+    return true;
+}
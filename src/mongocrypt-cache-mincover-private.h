@@ -0,0 +1,25 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MONGOCRYPT_CACHE_MINCOVER_PRIVATE_H
+#define MONGOCRYPT_CACHE_MINCOVER_PRIVATE_H
+
+#include "mongocrypt-cache-private.h"
+
+/* The mincover cache holds the covers of range queries. A cover only depends
+ * on the bounds and index options of the query, so entries do not expire. */
+void _mongocrypt_cache_mincover_init(_mongocrypt_cache_t *cache);
+
+#endif /* MONGOCRYPT_CACHE_MINCOVER_PRIVATE_H */
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mc-range-mincover-private.h"
+#include "mongocrypt-cache-mincover-private.h"
+#include "mongocrypt-util-private.h"
+
+/* The mincover cache.
+ *
+ * Attribute is a _mongocrypt_buffer_t of BSON encoding the query bounds and
+ * index options.
+ * Value is an mc_mincover_t.
+ */
+
+static bool _cmp_attr(void *a, void *b, int *out) {
+    BSON_ASSERT_PARAM(a);
+    BSON_ASSERT_PARAM(b);
+    BSON_ASSERT_PARAM(out);
+
+    *out = _mongocrypt_buffer_cmp((const _mongocrypt_buffer_t *)a, (const _mongocrypt_buffer_t *)b);
+    return true;
+}
+
+static size_t _hash_attr(void *attr, uint32_t *hashes, size_t max) {
+    BSON_ASSERT_PARAM(attr);
+    BSON_ASSERT_PARAM(hashes);
+
+    const _mongocrypt_buffer_t *buf = (const _mongocrypt_buffer_t *)attr;
+    if (max > 0) {
+        hashes[0] = mc_hash_bytes(buf->data, buf->len);
+    }
+    return 1;
+}
+
+static void *_copy_attr(void *attr) {
+    BSON_ASSERT_PARAM(attr);
+
+    _mongocrypt_buffer_t *copy = bson_malloc0(sizeof(_mongocrypt_buffer_t));
+    _mongocrypt_buffer_copy_to((const _mongocrypt_buffer_t *)attr, copy);
+    return copy;
+}
+
+static void _destroy_attr(void *attr) {
+    _mongocrypt_buffer_t *buf = (_mongocrypt_buffer_t *)attr;
+
+    _mongocrypt_buffer_cleanup(buf);
+    bson_free(buf);
+}
+
+static void *_copy_value(void *mincover) {
+    BSON_ASSERT_PARAM(mincover);
+
+    return mc_mincover_copy((const mc_mincover_t *)mincover);
+}
+
+static void _destroy_value(void *mincover) {
+    mc_mincover_destroy((mc_mincover_t *)mincover);
+}
+
+void _mongocrypt_cache_mincover_init(_mongocrypt_cache_t *cache) {
+    BSON_ASSERT_PARAM(cache);
+
+    _mongocrypt_cache_init(cache);
+    cache->name = "mincover";
+    cache->cmp_attr = _cmp_attr;
+    cache->hash_attr = _hash_attr;
+    cache->copy_attr = _copy_attr;
+    cache->destroy_attr = _destroy_attr;
+    cache->copy_value = _copy_value;
+    cache->destroy_value = _destroy_value;
+    _mongocrypt_cache_set_expiration(cache, INT64_MAX);
+}
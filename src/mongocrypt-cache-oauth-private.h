@@ -17,6 +17,7 @@
 #ifndef MONGOCRYPT_CACHE_OAUTH_PRIVATE_H
 #define MONGOCRYPT_CACHE_OAUTH_PRIVATE_H
 
+#include "mongocrypt-cache-private.h"
 #include "mongocrypt-mutex-private.h"
 #include "mongocrypt-status-private.h"
 
@@ -28,11 +29,41 @@ void mc_mapof_kmsid_to_token_destroy(mc_mapof_kmsid_to_token_t *k2t);
 // `mc_mapof_kmsid_to_token_get_token` returns a copy of the base64 encoded oauth token, or NULL.
 // Thread-safe.
 char *mc_mapof_kmsid_to_token_get_token(mc_mapof_kmsid_to_token_t *k2t, const char *kmsid);
-// `mc_mapof_kmsid_to_token_add_response` overwrites an entry if `kms_id` exists.
+// `mc_mapof_kmsid_to_token_get_token_refresh` is like `mc_mapof_kmsid_to_token_get_token`, but also sets `*refresh`
+// if the returned token expires within `refresh_margin_us` and no other caller is fetching a token for `kmsid`. The
+// caller that gets `*refresh` set has claimed the fetch, as with `mc_mapof_kmsid_to_token_claim_fetch`.
+// Thread-safe.
+char *mc_mapof_kmsid_to_token_get_token_refresh(mc_mapof_kmsid_to_token_t *k2t,
+                                                const char *kmsid,
+                                                int64_t refresh_margin_us,
+                                                bool *refresh);
+// `mc_mapof_kmsid_to_token_claim_fetch` returns true if the caller should fetch a token for `kmsid`, and false if
+// another caller is already fetching one. The caller that gets true must pass the response to
+// `mc_mapof_kmsid_to_token_add_response`, or call `mc_mapof_kmsid_to_token_abandon_fetch`.
+// Thread-safe.
+bool mc_mapof_kmsid_to_token_claim_fetch(mc_mapof_kmsid_to_token_t *k2t, const char *kmsid);
+// `mc_mapof_kmsid_to_token_abandon_fetch` lets another caller fetch the token of `kmsid`.
+// Thread-safe.
+void mc_mapof_kmsid_to_token_abandon_fetch(mc_mapof_kmsid_to_token_t *k2t, const char *kmsid);
+// `mc_mapof_kmsid_to_token_add_response` overwrites an entry if `kms_id` exists, and ends a claimed fetch.
 // Thread-safe.
 bool mc_mapof_kmsid_to_token_add_response(mc_mapof_kmsid_to_token_t *k2t,
                                           const char *kmsid,
                                           bson_t *response,
                                           mongocrypt_status_t *status);
 
+// `mc_mapof_kmsid_to_token_stats` reads the activity counters of the token cache.
+// Thread-safe.
+void mc_mapof_kmsid_to_token_stats(mc_mapof_kmsid_to_token_t *k2t, _mongocrypt_cache_stats_t *out);
+
+// `mc_mapof_kmsid_to_token_memory_usage` returns an estimate of the bytes held by the token cache.
+// Thread-safe.
+size_t mc_mapof_kmsid_to_token_memory_usage(mc_mapof_kmsid_to_token_t *k2t);
+
+#ifndef _WIN32
+// `mc_mapof_kmsid_to_token_atfork_child` is called in the child after fork. It reinitializes the mutex and drops the
+// token requests that were in flight in the parent. Cached tokens are kept.
+void mc_mapof_kmsid_to_token_atfork_child(mc_mapof_kmsid_to_token_t *k2t);
+#endif
+
 #endif /* MONGOCRYPT_CACHE_OAUTH_PRIVATE_H */
@@ -33,12 +33,15 @@ typedef struct {
 
 struct _mc_mapof_kmsid_to_token_t {
     mc_array_t entries;
-    mongocrypt_mutex_t mutex; // Guards `entries`.
+    mc_array_t fetching;      // KMS IDs (char *) with a token request in flight.
+    mongocrypt_mutex_t mutex; // Guards `entries`, `fetching`, and `stats`.
+    _mongocrypt_cache_stats_t stats;
 };
 
 mc_mapof_kmsid_to_token_t *mc_mapof_kmsid_to_token_new(void) {
     mc_mapof_kmsid_to_token_t *k2t = bson_malloc0(sizeof(mc_mapof_kmsid_to_token_t));
     _mc_array_init(&k2t->entries, sizeof(mc_mapof_kmsid_to_token_entry_t));
+    _mc_array_init(&k2t->fetching, sizeof(char *));
     _mongocrypt_mutex_init(&k2t->mutex);
     return k2t;
 }
@@ -54,10 +57,41 @@ void mc_mapof_kmsid_to_token_destroy(mc_mapof_kmsid_to_token_t *k2t) {
         bson_free(k2te.access_token);
     }
     _mc_array_destroy(&k2t->entries);
+    for (size_t i = 0; i < k2t->fetching.len; i++) {
+        bson_free(_mc_array_index(&k2t->fetching, char *, i));
+    }
+    _mc_array_destroy(&k2t->fetching);
     bson_free(k2t);
 }
 
-char *mc_mapof_kmsid_to_token_get_token(mc_mapof_kmsid_to_token_t *k2t, const char *kmsid) {
+// `_claim_fetch` adds `kmsid` to `fetching` unless it is already there. Requires `mutex`.
+static bool _claim_fetch(mc_mapof_kmsid_to_token_t *k2t, const char *kmsid) {
+    for (size_t i = 0; i < k2t->fetching.len; i++) {
+        if (0 == strcmp(_mc_array_index(&k2t->fetching, char *, i), kmsid)) {
+            return false;
+        }
+    }
+    char *copy = bson_strdup(kmsid);
+    _mc_array_append_val(&k2t->fetching, copy);
+    return true;
+}
+
+// `_release_fetch` removes `kmsid` from `fetching`. Requires `mutex`.
+static void _release_fetch(mc_mapof_kmsid_to_token_t *k2t, const char *kmsid) {
+    for (size_t i = 0; i < k2t->fetching.len; i++) {
+        char *entry = _mc_array_index(&k2t->fetching, char *, i);
+        if (0 == strcmp(entry, kmsid)) {
+            bson_free(entry);
+            k2t->fetching.len--;
+            if (i < k2t->fetching.len) {
+                _mc_array_index(&k2t->fetching, char *, i) = _mc_array_index(&k2t->fetching, char *, k2t->fetching.len);
+            }
+            return;
+        }
+    }
+}
+
+static char *_get_token(mc_mapof_kmsid_to_token_t *k2t, const char *kmsid, int64_t refresh_margin_us, bool *refresh) {
     BSON_ASSERT_PARAM(k2t);
     BSON_ASSERT_PARAM(kmsid);
 
@@ -66,21 +100,69 @@ char *mc_mapof_kmsid_to_token_get_token(mc_mapof_kmsid_to_token_t *k2t, const ch
     for (size_t i = 0; i < k2t->entries.len; i++) {
         mc_mapof_kmsid_to_token_entry_t k2te = _mc_array_index(&k2t->entries, mc_mapof_kmsid_to_token_entry_t, i);
         if (0 == strcmp(k2te.kmsid, kmsid)) {
-            if (bson_get_monotonic_time() >= k2te.expiration_time_us) {
-                // Expired.
+            int64_t now_us = bson_get_monotonic_time();
+            if (now_us >= k2te.expiration_time_us) {
+                // Expired. Evict by moving the last entry into its place.
+                bson_free(k2te.kmsid);
+                bson_free(k2te.access_token);
+                k2t->entries.len--;
+                if (i < k2t->entries.len) {
+                    _mc_array_index(&k2t->entries, mc_mapof_kmsid_to_token_entry_t, i) =
+                        _mc_array_index(&k2t->entries, mc_mapof_kmsid_to_token_entry_t, k2t->entries.len);
+                }
+                k2t->stats.evictions++;
+                k2t->stats.misses++;
                 _mongocrypt_mutex_unlock(&k2t->mutex);
                 return NULL;
             }
             char *access_token = bson_strdup(k2te.access_token);
+            if (refresh && k2te.expiration_time_us - now_us <= refresh_margin_us) {
+                *refresh = _claim_fetch(k2t, kmsid);
+            }
+            k2t->stats.hits++;
             _mongocrypt_mutex_unlock(&k2t->mutex);
             return access_token;
         }
     }
 
+    k2t->stats.misses++;
     _mongocrypt_mutex_unlock(&k2t->mutex);
     return NULL;
 }
 
+char *mc_mapof_kmsid_to_token_get_token(mc_mapof_kmsid_to_token_t *k2t, const char *kmsid) {
+    return _get_token(k2t, kmsid, 0, NULL);
+}
+
+char *mc_mapof_kmsid_to_token_get_token_refresh(mc_mapof_kmsid_to_token_t *k2t,
+                                                const char *kmsid,
+                                                int64_t refresh_margin_us,
+                                                bool *refresh) {
+    BSON_ASSERT_PARAM(refresh);
+
+    *refresh = false;
+    return _get_token(k2t, kmsid, refresh_margin_us, refresh);
+}
+
+bool mc_mapof_kmsid_to_token_claim_fetch(mc_mapof_kmsid_to_token_t *k2t, const char *kmsid) {
+    BSON_ASSERT_PARAM(k2t);
+    BSON_ASSERT_PARAM(kmsid);
+
+    _mongocrypt_mutex_lock(&k2t->mutex);
+    bool claimed = _claim_fetch(k2t, kmsid);
+    _mongocrypt_mutex_unlock(&k2t->mutex);
+    return claimed;
+}
+
+void mc_mapof_kmsid_to_token_abandon_fetch(mc_mapof_kmsid_to_token_t *k2t, const char *kmsid) {
+    BSON_ASSERT_PARAM(k2t);
+    BSON_ASSERT_PARAM(kmsid);
+
+    _mongocrypt_mutex_lock(&k2t->mutex);
+    _release_fetch(k2t, kmsid);
+    _mongocrypt_mutex_unlock(&k2t->mutex);
+}
+
 bool mc_mapof_kmsid_to_token_add_response(mc_mapof_kmsid_to_token_t *k2t,
                                           const char *kmsid,
                                           bson_t *response,
@@ -121,6 +203,8 @@ bool mc_mapof_kmsid_to_token_add_response(mc_mapof_kmsid_to_token_t *k2t,
 
     _mongocrypt_mutex_lock(&k2t->mutex);
 
+    _release_fetch(k2t, kmsid);
+
     // Check if there is an existing entry.
     for (size_t i = 0; i < k2t->entries.len; i++) {
         mc_mapof_kmsid_to_token_entry_t *k2te = &_mc_array_index(&k2t->entries, mc_mapof_kmsid_to_token_entry_t, i);
@@ -129,6 +213,7 @@ bool mc_mapof_kmsid_to_token_add_response(mc_mapof_kmsid_to_token_t *k2t,
             bson_free(k2te->access_token);
             k2te->access_token = bson_strdup(access_token);
             k2te->expiration_time_us = expiration_time_us;
+            k2t->stats.insertions++;
             _mongocrypt_mutex_unlock(&k2t->mutex);
             return true;
         }
@@ -138,6 +223,52 @@ bool mc_mapof_kmsid_to_token_add_response(mc_mapof_kmsid_to_token_t *k2t,
                                               .access_token = bson_strdup(access_token),
                                               .expiration_time_us = expiration_time_us};
     _mc_array_append_val(&k2t->entries, to_put);
+    k2t->stats.insertions++;
     _mongocrypt_mutex_unlock(&k2t->mutex);
     return true;
 }
+
+void mc_mapof_kmsid_to_token_stats(mc_mapof_kmsid_to_token_t *k2t, _mongocrypt_cache_stats_t *out) {
+    BSON_ASSERT_PARAM(k2t);
+    BSON_ASSERT_PARAM(out);
+
+    _mongocrypt_mutex_lock(&k2t->mutex);
+    *out = k2t->stats;
+    int64_t now_us = bson_get_monotonic_time();
+    out->entries = 0;
+    for (size_t i = 0; i < k2t->entries.len; i++) {
+        mc_mapof_kmsid_to_token_entry_t k2te = _mc_array_index(&k2t->entries, mc_mapof_kmsid_to_token_entry_t, i);
+        if (now_us < k2te.expiration_time_us) {
+            out->entries++;
+        }
+    }
+    _mongocrypt_mutex_unlock(&k2t->mutex);
+}
+
+size_t mc_mapof_kmsid_to_token_memory_usage(mc_mapof_kmsid_to_token_t *k2t) {
+    BSON_ASSERT_PARAM(k2t);
+
+    _mongocrypt_mutex_lock(&k2t->mutex);
+    size_t bytes = sizeof(*k2t) + k2t->entries.allocated + k2t->fetching.allocated;
+    for (size_t i = 0; i < k2t->entries.len; i++) {
+        mc_mapof_kmsid_to_token_entry_t k2te = _mc_array_index(&k2t->entries, mc_mapof_kmsid_to_token_entry_t, i);
+        bytes += strlen(k2te.kmsid) + 1u + strlen(k2te.access_token) + 1u;
+    }
+    for (size_t i = 0; i < k2t->fetching.len; i++) {
+        bytes += strlen(_mc_array_index(&k2t->fetching, char *, i)) + 1u;
+    }
+    _mongocrypt_mutex_unlock(&k2t->mutex);
+    return bytes;
+}
+
+#ifndef _WIN32
+void mc_mapof_kmsid_to_token_atfork_child(mc_mapof_kmsid_to_token_t *k2t) {
+    BSON_ASSERT_PARAM(k2t);
+
+    _mongocrypt_mutex_init(&k2t->mutex);
+    for (size_t i = 0; i < k2t->fetching.len; i++) {
+        bson_free(_mc_array_index(&k2t->fetching, char *, i));
+    }
+    _mc_array_clear(&k2t->fetching);
+}
+#endif
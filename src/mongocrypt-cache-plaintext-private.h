@@ -0,0 +1,33 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MONGOCRYPT_CACHE_PLAINTEXT_PRIVATE_H
+#define MONGOCRYPT_CACHE_PLAINTEXT_PRIVATE_H
+
+#include "mongocrypt-cache-private.h"
+
+/* A decrypted value. */
+typedef struct {
+    uint8_t type;
+    _mongocrypt_buffer_t value;
+} _mongocrypt_cache_plaintext_value_t;
+
+/* The plaintext cache holds the values decrypted from Deterministic
+ * ciphertexts by one decryption context, so a ciphertext repeated in the
+ * decrypted document is decrypted once. The cache lives as long as the
+ * context. Values are zeroed when the cache is cleaned up. */
+void _mongocrypt_cache_plaintext_init(_mongocrypt_cache_t *cache);
+
+#endif /* MONGOCRYPT_CACHE_PLAINTEXT_PRIVATE_H */
@@ -31,47 +31,240 @@ typedef bool (*cache_compare_fn)(void *thing_a, void *thing_b, int *out);
 typedef void (*cache_destroy_fn)(void *thing);
 typedef void *(*cache_copy_fn)(void *thing);
 typedef void (*cache_dump_fn)(void *thing);
+/* Computes the hash codes of an attribute. Attributes that compare equal must
+ * share at least one hash code. Writes at most @max hash codes into @hashes and
+ * returns the total number of hash codes of @thing, which may exceed @max. */
+typedef size_t (*cache_hash_fn)(void *thing, uint32_t *hashes, size_t max);
+/* Returns true if the pair with the attribute @attr matches. */
+typedef bool (*cache_match_fn)(void *attr, void *ctx);
+/* Visits a pair that was last updated @age_ms ago. Returns false to stop. */
+typedef bool (*cache_visit_fn)(void *attr, void *value, int64_t age_ms, void *ctx);
+/* Returns an estimate of the bytes allocated for @thing, including the bytes of
+ * @thing itself. */
+typedef size_t (*cache_size_fn)(void *thing);
 
 typedef struct __mongocrypt_cache_pair_t {
     void *attr;
     void *value;
     struct __mongocrypt_cache_pair_t *next;
+    struct __mongocrypt_cache_pair_t *prev;
     int64_t last_updated;
+    uint64_t expiration;     /* lifetime in milliseconds. */
+    bool default_expiration; /* expiration follows the cache expiration. */
+    size_t heap_index;       /* position in the expiration heap. */
+    /* Nonzero once a caller was asked to refresh this pair. Updated
+     * atomically, since gets only hold a read lock. */
+    volatile int32_t refresh_claimed;
+    /* Nonzero if the pair was used since the clock hand last passed it.
+     * Updated atomically, since gets only hold a read lock. */
+    volatile int32_t referenced;
 } _mongocrypt_cache_pair_t;
 
+/* A slot of the open-addressing hash index. A pair is indexed once for each
+ * hash code of its attribute. */
 typedef struct {
+    uint32_t hash;
+    _mongocrypt_cache_pair_t *pair; /* NULL if empty. */
+} _mongocrypt_cache_slot_t;
+
+/* Number of generation counters of a cache. */
+#define CACHE_GENERATIONS 64
+
+/* Shared by a cache and the copies of its values kept outside of it, so the
+ * copies can be released once the cache is cleaned up. */
+typedef struct {
+    volatile int32_t refcount;
+    volatile int32_t ended; /* nonzero once the cache is cleaned up. */
+} _mongocrypt_cache_life_t;
+
+/* A snapshot of cache activity counters. */
+typedef struct {
+    int64_t hits;
+    int64_t misses;
+    int64_t evictions; /* entries removed because they expired or the cache was full. */
+    int64_t insertions;
+    int64_t entries; /* current number of unexpired entries. */
+} _mongocrypt_cache_stats_t;
+
+typedef struct {
+    const char *name; /* names the cache in probes. May be NULL. */
     cache_dump_fn dump_attr;
     cache_compare_fn cmp_attr;
     cache_copy_fn copy_attr;
     cache_destroy_fn destroy_attr;
     cache_copy_fn copy_value;
     cache_destroy_fn destroy_value;
+    cache_hash_fn hash_attr;  /* may be NULL. If NULL, lookups scan all pairs. */
+    cache_size_fn size_attr;  /* may be NULL. If NULL, attributes are not counted in memory usage. */
+    cache_size_fn size_value; /* may be NULL. If NULL, values are not counted in memory usage. */
     _mongocrypt_cache_pair_t *pair;
-    mongocrypt_mutex_t mutex; /* global lock of cache. */
-    uint64_t expiration;
+    _mongocrypt_cache_slot_t *slots; /* hash index of pairs. */
+    size_t slots_len;                /* 0 or a power of two. */
+    size_t slots_used;               /* live and deleted slots. */
+    /* min-heap of pairs ordered by the time they expire. */
+    _mongocrypt_cache_pair_t **heap;
+    size_t heap_len;
+    size_t heap_cap;
+    size_t num_pairs;
+    /* Maximum number of pairs. 0 means unbounded. When full, the least
+     * recently used pair (approximated with the CLOCK algorithm) is evicted. */
+    size_t max_entries;
+    _mongocrypt_cache_pair_t *tail;       /* oldest pair of the linked list. */
+    _mongocrypt_cache_pair_t *clock_hand; /* next pair to consider for eviction. NULL means the tail. */
+    mongocrypt_rwlock_t lock; /* global lock of cache. */
+    uint64_t expiration; /* default lifetime of pairs in milliseconds. */
+    /* Fraction of the expiration after which a pair is offered for refresh.
+     * 0 disables refresh-ahead. */
+    double refresh_ahead;
+    /* Activity counters. Updated atomically, since gets only hold a read lock.
+     */
+    volatile int64_t hits;
+    volatile int64_t misses;
+    volatile int64_t evictions;
+    volatile int64_t insertions;
+    /* Copies of values kept outside the cache hold a reference, so they can
+     * name the cache even after it is destroyed. */
+    _mongocrypt_cache_life_t *life;
+    /* generations[h % CACHE_GENERATIONS] is incremented whenever a pair with
+     * the hash code h is removed or its expiration changes. A copy of a value
+     * kept outside the cache is valid while the counter of its hash code is
+     * unchanged, so removing a pair rarely invalidates the copies of others.
+     * Updated atomically. */
+    volatile int64_t generations[CACHE_GENERATIONS];
 } _mongocrypt_cache_t;
 
+/* Initialize the fields common to all caches. Callbacks are set by the caller.
+ */
+void _mongocrypt_cache_init(_mongocrypt_cache_t *cache);
+
+/* Flags of _mongocrypt_cache_init_buffers. */
+#define CACHE_ZERO_ATTR (1 << 0)  /* zero attributes when they are destroyed. */
+#define CACHE_ZERO_VALUE (1 << 1) /* zero values when they are destroyed. */
+
+/* Initialize a cache whose attributes and values are _mongocrypt_buffer_t.
+ * Attributes are compared and hashed by their bytes. @zero_flags is a
+ * combination of the CACHE_ZERO_* flags, for buffers that hold key material or
+ * plaintext values. */
+void _mongocrypt_cache_init_buffers(_mongocrypt_cache_t *cache, const char *name, int zero_flags);
+
 /* Attempt to get an entry.
  * Returns boolean indicating success.
  */
 bool _mongocrypt_cache_get(_mongocrypt_cache_t *cache, void *attr, void **value) MONGOCRYPT_WARN_UNUSED_RESULT;
 
+/* Like _mongocrypt_cache_get, but also sets @needs_refresh if the entry is past
+ * the refresh-ahead point. Only one caller is asked to refresh each entry; the
+ * flag resets when the entry is replaced.
+ */
+bool _mongocrypt_cache_get_or_refresh(_mongocrypt_cache_t *cache, void *attr, void **value, bool *needs_refresh)
+    MONGOCRYPT_WARN_UNUSED_RESULT;
+
+/* Like _mongocrypt_cache_get_or_refresh, but also sets @generation to the
+ * generation of the first hash code of @attr at the lookup (see
+ * _mongocrypt_cache_generation), and @valid_until_ms to the monotonic time
+ * in milliseconds at which a found entry expires or is offered for refresh.
+ * @needs_refresh may be NULL.
+ */
+bool _mongocrypt_cache_get_with_validity(_mongocrypt_cache_t *cache,
+                                         void *attr,
+                                         void **value,
+                                         bool *needs_refresh,
+                                         int64_t *generation,
+                                         int64_t *valid_until_ms) MONGOCRYPT_WARN_UNUSED_RESULT;
+
+/* Returns the generation of the pairs of @cache with the hash code @hash. Takes
+ * no lock. */
+int64_t _mongocrypt_cache_generation(_mongocrypt_cache_t *cache, uint32_t hash);
+
+/* Returns a new reference to the life of @cache. */
+_mongocrypt_cache_life_t *_mongocrypt_cache_life_retain(_mongocrypt_cache_t *cache);
+
+/* Returns true if the cache of @life was cleaned up. */
+bool _mongocrypt_cache_life_ended(_mongocrypt_cache_life_t *life);
+
+void _mongocrypt_cache_life_release(_mongocrypt_cache_life_t *life);
+
+/* Returns a counter incremented whenever a cache whose life is referenced
+ * outside of it is cleaned up. */
+int64_t _mongocrypt_cache_ended_epoch(void);
+
 bool _mongocrypt_cache_add_copy(_mongocrypt_cache_t *cache, void *attr, void *value, mongocrypt_status_t *status)
     MONGOCRYPT_WARN_UNUSED_RESULT;
 
+/* Like _mongocrypt_cache_add_copy, but the entry expires after @milli
+ * milliseconds instead of the cache expiration. @milli must be nonzero. */
+bool _mongocrypt_cache_add_copy_with_expiration(_mongocrypt_cache_t *cache,
+                                                void *attr,
+                                                void *value,
+                                                uint64_t milli,
+                                                mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
 /* Steals the value instead of copying. Caller relinquishes value when calling.
  */
 bool _mongocrypt_cache_add_stolen(_mongocrypt_cache_t *cache, void *attr, void *value, mongocrypt_status_t *status)
     MONGOCRYPT_WARN_UNUSED_RESULT;
 
+/* Like _mongocrypt_cache_add_stolen, but the entry expires after @milli
+ * milliseconds instead of the cache expiration. @milli must be nonzero. */
+bool _mongocrypt_cache_add_stolen_with_expiration(_mongocrypt_cache_t *cache,
+                                                  void *attr,
+                                                  void *value,
+                                                  uint64_t milli,
+                                                  mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
+/* Like _mongocrypt_cache_add_stolen, but the entry is added as if it was last
+ * updated @age_ms ago. */
+bool _mongocrypt_cache_add_stolen_aged(_mongocrypt_cache_t *cache,
+                                       void *attr,
+                                       void *value,
+                                       int64_t age_ms,
+                                       mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
+/* Removes the entries matching @attr. */
+bool _mongocrypt_cache_remove(_mongocrypt_cache_t *cache, void *attr, mongocrypt_status_t *status)
+    MONGOCRYPT_WARN_UNUSED_RESULT;
+
+/* Removes the entries for which @match returns true. Removed entries are not
+ * counted as evictions. */
+void _mongocrypt_cache_remove_if(_mongocrypt_cache_t *cache, cache_match_fn match, void *ctx);
+
+/* Removes all entries. Removed entries are not counted as evictions. */
+void _mongocrypt_cache_clear(_mongocrypt_cache_t *cache);
+
+/* Calls @visit on each unexpired entry while holding a read lock. @visit must
+ * not modify the cache. Returns false if @visit returned false. */
+bool _mongocrypt_cache_foreach(_mongocrypt_cache_t *cache, cache_visit_fn visit, void *ctx);
+
 void _mongocrypt_cache_cleanup(_mongocrypt_cache_t *cache);
 
 /* A helper debug function to dump the state of the cache. */
 void _mongocrypt_cache_dump(_mongocrypt_cache_t *cache);
 
-/* Tests may override the default expiration */
+/* Tests may override the default expiration. Entries added with their own
+ * expiration keep it. */
 void _mongocrypt_cache_set_expiration(_mongocrypt_cache_t *cache, uint64_t milli);
 
+/* Set the maximum number of entries. 0 means unbounded. Excess entries are
+ * evicted on the next add. */
+void _mongocrypt_cache_set_max_entries(_mongocrypt_cache_t *cache, uint32_t max_entries);
+
+/* Set the fraction of the expiration after which entries are offered for
+ * refresh. @fraction must be in [0, 1). 0 disables refresh-ahead. */
+void _mongocrypt_cache_set_refresh_ahead(_mongocrypt_cache_t *cache, double fraction);
+
 uint32_t _mongocrypt_cache_num_entries(_mongocrypt_cache_t *cache);
 
+/* Evicts expired entries and reads the activity counters. */
+void _mongocrypt_cache_stats(_mongocrypt_cache_t *cache, _mongocrypt_cache_stats_t *out);
+
+/* Returns an estimate of the bytes held by the pairs and indexes of @cache.
+ * Values shared with contexts are counted in full. */
+size_t _mongocrypt_cache_memory_usage(_mongocrypt_cache_t *cache);
+
+#ifndef _WIN32
+/* Called in the child after fork. Reinitializes the lock of @cache. Entries
+ * are kept. */
+void _mongocrypt_cache_atfork_child(_mongocrypt_cache_t *cache);
+#endif
+
 #endif /* MONGOCRYPT_CACHE_PRIVATE */
\ No newline at end of file
@@ -0,0 +1,32 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MONGOCRYPT_CACHE_TOKENS_PRIVATE_H
+#define MONGOCRYPT_CACHE_TOKENS_PRIVATE_H
+
+#include "mongocrypt-cache-private.h"
+
+/* The token cache holds the deleteTokens and compactionTokens documents
+ * derived from an encryptedFields. The tokens only depend on the
+ * encryptedFields and the material of its keys, which does not change, so
+ * entries do not expire. */
+void _mongocrypt_cache_tokens_init(_mongocrypt_cache_t *cache);
+
+/* Sets @out to the cache key of the tokens named @kind derived from
+ * @encrypted_fields.
+ * @out must be cleaned up with _mongocrypt_buffer_cleanup. */
+void _mongocrypt_cache_tokens_key(const char *kind, const bson_t *encrypted_fields, _mongocrypt_buffer_t *out);
+
+#endif /* MONGOCRYPT_CACHE_TOKENS_PRIVATE_H */
@@ -0,0 +1,43 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mongocrypt-cache-tokens-private.h"
+
+/* The token cache.
+ *
+ * Attribute is a _mongocrypt_buffer_t of BSON encoding the kind of tokens and
+ * the encryptedFields they are derived from.
+ * Value is a _mongocrypt_buffer_t of the BSON tokens document.
+ */
+
+void _mongocrypt_cache_tokens_init(_mongocrypt_cache_t *cache) {
+    BSON_ASSERT_PARAM(cache);
+
+    _mongocrypt_cache_init_buffers(cache, "tokens", 0);
+    _mongocrypt_cache_set_expiration(cache, INT64_MAX);
+}
+
+void _mongocrypt_cache_tokens_key(const char *kind, const bson_t *encrypted_fields, _mongocrypt_buffer_t *out) {
+    bson_t key = BSON_INITIALIZER;
+
+    BSON_ASSERT_PARAM(kind);
+    BSON_ASSERT_PARAM(encrypted_fields);
+    BSON_ASSERT_PARAM(out);
+
+    BSON_ASSERT(BSON_APPEND_UTF8(&key, "kind", kind));
+    BSON_ASSERT(BSON_APPEND_DOCUMENT(&key, "encryptedFields", encrypted_fields));
+    _mongocrypt_buffer_steal_from_bson(out, &key);
+}
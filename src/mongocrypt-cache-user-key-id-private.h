@@ -0,0 +1,26 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MONGOCRYPT_CACHE_USER_KEY_ID_PRIVATE_H
+#define MONGOCRYPT_CACHE_USER_KEY_ID_PRIVATE_H
+
+#include "mongocrypt-cache-private.h"
+
+/* The user key id cache maps the S_KeyId of Queryable Encryption indexed
+ * values to the K_KeyId last found with it when decrypting. The K_KeyId is
+ * only a guess of the key to prefetch, so entries do not expire. */
+void _mongocrypt_cache_user_key_id_init(_mongocrypt_cache_t *cache);
+
+#endif /* MONGOCRYPT_CACHE_USER_KEY_ID_PRIVATE_H */
@@ -0,0 +1,30 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mongocrypt-cache-user-key-id-private.h"
+
+/* The user key id cache.
+ *
+ * Attribute is a _mongocrypt_buffer_t of the S_KeyId UUID.
+ * Value is a _mongocrypt_buffer_t of the K_KeyId UUID.
+ */
+
+void _mongocrypt_cache_user_key_id_init(_mongocrypt_cache_t *cache) {
+    BSON_ASSERT_PARAM(cache);
+
+    _mongocrypt_cache_init_buffers(cache, "user_key_id", 0);
+    _mongocrypt_cache_set_expiration(cache, INT64_MAX);
+}
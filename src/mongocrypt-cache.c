@@ -16,7 +16,235 @@
 
 #include "mongocrypt-cache-private.h"
 
+#include "mongocrypt-atomic-private.h"
 #include "mongocrypt-private.h"
+#include "mongocrypt-probes-private.h"
+#include "mongocrypt-util-private.h"
+
+/* Number of hash codes of an attribute computed without allocating. */
+#define CACHE_INLINE_HASHES 8
+/* Minimum number of slots in a non-empty hash index. */
+#define CACHE_MIN_SLOTS 16
+
+/* Marks an index slot whose pair was removed. Probing continues past it. */
+static _mongocrypt_cache_pair_t _deleted_pair;
+#define DELETED_SLOT (&_deleted_pair)
+
+/* Incremented when a cache whose life is referenced elsewhere is cleaned up. */
+static volatile int64_t _ended_epoch;
+
+void _mongocrypt_cache_init(_mongocrypt_cache_t *cache) {
+    BSON_ASSERT_PARAM(cache);
+
+    memset(cache, 0, sizeof(*cache));
+    _mongocrypt_rwlock_init(&cache->lock);
+    cache->expiration = CACHE_EXPIRATION_MS;
+    cache->life = bson_malloc0(sizeof(*cache->life));
+    BSON_ASSERT(cache->life);
+    cache->life->refcount = 1;
+}
+
+static bool _cmp_buffer(void *a, void *b, int *out) {
+    BSON_ASSERT_PARAM(a);
+    BSON_ASSERT_PARAM(b);
+    BSON_ASSERT_PARAM(out);
+
+    *out = _mongocrypt_buffer_cmp((const _mongocrypt_buffer_t *)a, (const _mongocrypt_buffer_t *)b);
+    return true;
+}
+
+static size_t _hash_buffer(void *attr, uint32_t *hashes, size_t max) {
+    BSON_ASSERT_PARAM(attr);
+    BSON_ASSERT_PARAM(hashes);
+
+    const _mongocrypt_buffer_t *buf = (const _mongocrypt_buffer_t *)attr;
+    if (max > 0) {
+        hashes[0] = mc_hash_bytes(buf->data, buf->len);
+    }
+    return 1;
+}
+
+static void *_copy_buffer(void *buf) {
+    BSON_ASSERT_PARAM(buf);
+
+    _mongocrypt_buffer_t *copy = bson_malloc0(sizeof(_mongocrypt_buffer_t));
+    _mongocrypt_buffer_copy_to((const _mongocrypt_buffer_t *)buf, copy);
+    return copy;
+}
+
+static void _destroy_buffer(void *buf) {
+    _mongocrypt_buffer_cleanup((_mongocrypt_buffer_t *)buf);
+    bson_free(buf);
+}
+
+static void _destroy_buffer_zeroed(void *buf_in) {
+    _mongocrypt_buffer_t *buf = (_mongocrypt_buffer_t *)buf_in;
+
+    if (!buf) {
+        return;
+    }
+
+    /* Copies made by _copy_buffer are owned. */
+    BSON_ASSERT(buf->owned || !buf->data);
+    bson_zero_free(buf->data, buf->len);
+    bson_free(buf);
+}
+
+void _mongocrypt_cache_init_buffers(_mongocrypt_cache_t *cache, const char *name, int zero_flags) {
+    BSON_ASSERT_PARAM(cache);
+
+    _mongocrypt_cache_init(cache);
+    cache->name = name;
+    cache->cmp_attr = _cmp_buffer;
+    cache->hash_attr = _hash_buffer;
+    cache->copy_attr = _copy_buffer;
+    cache->destroy_attr = (zero_flags & CACHE_ZERO_ATTR) ? _destroy_buffer_zeroed : _destroy_buffer;
+    cache->copy_value = _copy_buffer;
+    cache->destroy_value = (zero_flags & CACHE_ZERO_VALUE) ? _destroy_buffer_zeroed : _destroy_buffer;
+}
+
+/* Compute the hash codes of @attr. Returns either @inline_hashes or an
+ * allocated array. Free with _attr_hashes_free. */
+static uint32_t *_attr_hashes(_mongocrypt_cache_t *cache, void *attr, uint32_t *inline_hashes, size_t *count) {
+    uint32_t *hashes;
+    size_t needed;
+
+    BSON_ASSERT_PARAM(cache);
+    BSON_ASSERT_PARAM(attr);
+    BSON_ASSERT_PARAM(inline_hashes);
+    BSON_ASSERT_PARAM(count);
+    BSON_ASSERT(cache->hash_attr);
+
+    needed = cache->hash_attr(attr, inline_hashes, CACHE_INLINE_HASHES);
+    if (needed <= CACHE_INLINE_HASHES) {
+        *count = needed;
+        return inline_hashes;
+    }
+
+    BSON_ASSERT(needed <= SIZE_MAX / sizeof(uint32_t));
+    hashes = bson_malloc(needed * sizeof(uint32_t));
+    BSON_ASSERT(hashes);
+    *count = cache->hash_attr(attr, hashes, needed);
+    BSON_ASSERT(*count == needed);
+    return hashes;
+}
+
+static void _attr_hashes_free(uint32_t *hashes, uint32_t *inline_hashes) {
+    if (hashes != inline_hashes) {
+        bson_free(hashes);
+    }
+}
+
+/* Store @pair in the first free slot for @hash. Returns true if a previously
+ * empty slot was used. */
+static bool _slots_put(_mongocrypt_cache_slot_t *slots, size_t slots_len, uint32_t hash, _mongocrypt_cache_pair_t *pair) {
+    size_t mask;
+    size_t i;
+
+    BSON_ASSERT_PARAM(slots);
+    BSON_ASSERT_PARAM(pair);
+
+    mask = slots_len - 1;
+    i = hash & mask;
+    while (slots[i].pair && slots[i].pair != DELETED_SLOT) {
+        i = (i + 1) & mask;
+    }
+
+    bool was_empty = slots[i].pair == NULL;
+    slots[i].hash = hash;
+    slots[i].pair = pair;
+    return was_empty;
+}
+
+/* Ensure @n more slots may be used while keeping the index at most half full.
+ * Rebuilding also drops deleted slots. Caller must hold lock. */
+static void _index_reserve(_mongocrypt_cache_t *cache, size_t n) {
+    _mongocrypt_cache_slot_t *slots;
+    size_t slots_len;
+    size_t live = 0;
+
+    BSON_ASSERT_PARAM(cache);
+    BSON_ASSERT(n <= SIZE_MAX / 2 - cache->slots_used);
+
+    if ((cache->slots_used + n) * 2 <= cache->slots_len) {
+        return;
+    }
+
+    for (size_t i = 0; i < cache->slots_len; i++) {
+        if (cache->slots[i].pair && cache->slots[i].pair != DELETED_SLOT) {
+            live++;
+        }
+    }
+
+    slots_len = CACHE_MIN_SLOTS;
+    while (slots_len < (live + n) * 4) {
+        BSON_ASSERT(slots_len <= SIZE_MAX / 2 / sizeof(_mongocrypt_cache_slot_t));
+        slots_len *= 2;
+    }
+
+    slots = bson_malloc0(slots_len * sizeof(_mongocrypt_cache_slot_t));
+    BSON_ASSERT(slots);
+    for (size_t i = 0; i < cache->slots_len; i++) {
+        if (cache->slots[i].pair && cache->slots[i].pair != DELETED_SLOT) {
+            _slots_put(slots, slots_len, cache->slots[i].hash, cache->slots[i].pair);
+        }
+    }
+
+    bson_free(cache->slots);
+    cache->slots = slots;
+    cache->slots_len = slots_len;
+    cache->slots_used = live;
+}
+
+/* Index @pair under each hash code of its attribute. Caller must hold lock. */
+static void _index_insert(_mongocrypt_cache_t *cache, _mongocrypt_cache_pair_t *pair) {
+    uint32_t inline_hashes[CACHE_INLINE_HASHES];
+    uint32_t *hashes;
+    size_t count;
+
+    BSON_ASSERT_PARAM(cache);
+    BSON_ASSERT_PARAM(pair);
+
+    if (!cache->hash_attr) {
+        return;
+    }
+
+    hashes = _attr_hashes(cache, pair->attr, inline_hashes, &count);
+    _index_reserve(cache, count);
+    for (size_t i = 0; i < count; i++) {
+        if (_slots_put(cache->slots, cache->slots_len, hashes[i], pair)) {
+            cache->slots_used++;
+        }
+    }
+    _attr_hashes_free(hashes, inline_hashes);
+}
+
+/* Remove all index slots referring to @pair. Caller must hold lock. */
+static void _index_remove(_mongocrypt_cache_t *cache, _mongocrypt_cache_pair_t *pair) {
+    uint32_t inline_hashes[CACHE_INLINE_HASHES];
+    uint32_t *hashes;
+    size_t count;
+    size_t mask;
+
+    BSON_ASSERT_PARAM(cache);
+    BSON_ASSERT_PARAM(pair);
+
+    if (!cache->hash_attr || cache->slots_len == 0) {
+        return;
+    }
+
+    mask = cache->slots_len - 1;
+    hashes = _attr_hashes(cache, pair->attr, inline_hashes, &count);
+    for (size_t h = 0; h < count; h++) {
+        for (size_t i = hashes[h] & mask; cache->slots[i].pair; i = (i + 1) & mask) {
+            if (cache->slots[i].pair == pair && cache->slots[i].hash == hashes[h]) {
+                cache->slots[i].pair = DELETED_SLOT;
+                break;
+            }
+        }
+    }
+    _attr_hashes_free(hashes, inline_hashes);
+}
 
 /* Did the cache pair expire? Caller must hold lock. */
 static bool _pair_expired(_mongocrypt_cache_t *cache, _mongocrypt_cache_pair_t *pair) {
@@ -27,117 +255,402 @@ static bool _pair_expired(_mongocrypt_cache_t *cache, _mongocrypt_cache_pair_t *
 
     current = bson_get_monotonic_time() / 1000;
     BSON_ASSERT(current >= INT64_MIN + pair->last_updated);
-    BSON_ASSERT(cache->expiration <= INT64_MAX);
-    return (current - pair->last_updated) > (int64_t)cache->expiration;
+    BSON_ASSERT(pair->expiration <= INT64_MAX);
+    return (current - pair->last_updated) > (int64_t)pair->expiration;
 }
 
-/* Return the pair after the one being destroyed. */
-static _mongocrypt_cache_pair_t *
-_destroy_pair(_mongocrypt_cache_t *cache, _mongocrypt_cache_pair_t *prev, _mongocrypt_cache_pair_t *pair) {
-    _mongocrypt_cache_pair_t *tmp;
+/* Is the cache pair past the refresh-ahead point? Caller must hold lock. */
+static bool _pair_wants_refresh(_mongocrypt_cache_t *cache, _mongocrypt_cache_pair_t *pair) {
+    int64_t current;
+
+    BSON_ASSERT_PARAM(cache);
+    BSON_ASSERT_PARAM(pair);
+
+    if (cache->refresh_ahead <= 0) {
+        return false;
+    }
+
+    current = bson_get_monotonic_time() / 1000;
+    return (double)(current - pair->last_updated) >= (double)pair->expiration * cache->refresh_ahead;
+}
+
+/* Time at which the pair expires, saturating at INT64_MAX. */
+static int64_t _pair_deadline(_mongocrypt_cache_pair_t *pair) {
+    BSON_ASSERT_PARAM(pair);
+    BSON_ASSERT(pair->expiration <= INT64_MAX);
+
+    if (pair->last_updated >= 0 && pair->expiration > (uint64_t)(INT64_MAX - pair->last_updated)) {
+        return INT64_MAX;
+    }
+    return pair->last_updated + (int64_t)pair->expiration;
+}
+
+static bool _heap_less(_mongocrypt_cache_pair_t *a, _mongocrypt_cache_pair_t *b) {
+    BSON_ASSERT_PARAM(a);
+    BSON_ASSERT_PARAM(b);
+
+    return _pair_deadline(a) < _pair_deadline(b);
+}
+
+static void _heap_set(_mongocrypt_cache_t *cache, size_t i, _mongocrypt_cache_pair_t *pair) {
+    BSON_ASSERT_PARAM(cache);
+    BSON_ASSERT_PARAM(pair);
+
+    cache->heap[i] = pair;
+    pair->heap_index = i;
+}
+
+static void _heap_sift_up(_mongocrypt_cache_t *cache, size_t i) {
+    _mongocrypt_cache_pair_t *pair;
+
+    BSON_ASSERT_PARAM(cache);
+
+    pair = cache->heap[i];
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!_heap_less(pair, cache->heap[parent])) {
+            break;
+        }
+        _heap_set(cache, i, cache->heap[parent]);
+        i = parent;
+    }
+    _heap_set(cache, i, pair);
+}
+
+static void _heap_sift_down(_mongocrypt_cache_t *cache, size_t i) {
+    _mongocrypt_cache_pair_t *pair;
+
+    BSON_ASSERT_PARAM(cache);
+
+    pair = cache->heap[i];
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= cache->heap_len) {
+            break;
+        }
+        if (child + 1 < cache->heap_len && _heap_less(cache->heap[child + 1], cache->heap[child])) {
+            child++;
+        }
+        if (!_heap_less(cache->heap[child], pair)) {
+            break;
+        }
+        _heap_set(cache, i, cache->heap[child]);
+        i = child;
+    }
+    _heap_set(cache, i, pair);
+}
+
+/* Caller must hold lock. */
+static void _heap_push(_mongocrypt_cache_t *cache, _mongocrypt_cache_pair_t *pair) {
+    BSON_ASSERT_PARAM(cache);
+    BSON_ASSERT_PARAM(pair);
+
+    if (cache->heap_len == cache->heap_cap) {
+        BSON_ASSERT(cache->heap_cap <= SIZE_MAX / 2 / sizeof(_mongocrypt_cache_pair_t *));
+        cache->heap_cap = cache->heap_cap ? cache->heap_cap * 2 : CACHE_MIN_SLOTS;
+        cache->heap = bson_realloc(cache->heap, cache->heap_cap * sizeof(_mongocrypt_cache_pair_t *));
+        BSON_ASSERT(cache->heap);
+    }
+    _heap_set(cache, cache->heap_len, pair);
+    cache->heap_len++;
+    _heap_sift_up(cache, pair->heap_index);
+}
+
+/* Caller must hold lock. */
+static void _heap_remove(_mongocrypt_cache_t *cache, _mongocrypt_cache_pair_t *pair) {
+    _mongocrypt_cache_pair_t *moved;
+    size_t i;
+
+    BSON_ASSERT_PARAM(cache);
+    BSON_ASSERT_PARAM(pair);
+
+    i = pair->heap_index;
+    BSON_ASSERT(i < cache->heap_len && cache->heap[i] == pair);
+    cache->heap_len--;
+    if (i == cache->heap_len) {
+        return;
+    }
+    /* Fill the hole with the last pair and restore heap order. */
+    moved = cache->heap[cache->heap_len];
+    _heap_set(cache, i, moved);
+    _heap_sift_up(cache, i);
+    _heap_sift_down(cache, moved->heap_index);
+}
+
+/* Returns the index in generations of the first hash code of @attr. */
+static size_t _generation_index(_mongocrypt_cache_t *cache, void *attr) {
+    uint32_t hash;
+
+    BSON_ASSERT_PARAM(cache);
+    BSON_ASSERT_PARAM(attr);
+
+    if (!cache->hash_attr || 0 == cache->hash_attr(attr, &hash, 1)) {
+        return 0;
+    }
+    return hash % CACHE_GENERATIONS;
+}
+
+static void _bump_all_generations(_mongocrypt_cache_t *cache) {
+    BSON_ASSERT_PARAM(cache);
 
+    for (size_t i = 0; i < CACHE_GENERATIONS; i++) {
+        _mongocrypt_atomic_int64_fetch_add(&cache->generations[i], 1);
+    }
+}
+
+/* Increment the generation of each hash code of @attr. Caller must hold write
+ * lock. */
+static void _bump_generations(_mongocrypt_cache_t *cache, void *attr) {
+    uint32_t inline_hashes[CACHE_INLINE_HASHES];
+    uint32_t *hashes;
+    size_t count;
+
+    BSON_ASSERT_PARAM(cache);
+    BSON_ASSERT_PARAM(attr);
+
+    if (!cache->hash_attr) {
+        _bump_all_generations(cache);
+        return;
+    }
+    hashes = _attr_hashes(cache, attr, inline_hashes, &count);
+    if (count == 0) {
+        _mongocrypt_atomic_int64_fetch_add(&cache->generations[0], 1);
+    }
+    for (size_t h = 0; h < count; h++) {
+        _mongocrypt_atomic_int64_fetch_add(&cache->generations[hashes[h] % CACHE_GENERATIONS], 1);
+    }
+    _attr_hashes_free(hashes, inline_hashes);
+}
+
+/* Unlink, unindex, and destroy a pair. Caller must hold lock. */
+static void _destroy_pair(_mongocrypt_cache_t *cache, _mongocrypt_cache_pair_t *pair) {
     BSON_ASSERT_PARAM(cache);
-    /* prev is checked before being used, so it can be NULL */
     BSON_ASSERT_PARAM(pair);
 
-    tmp = pair->next;
+    _index_remove(cache, pair);
+    _heap_remove(cache, pair);
+
+    if (cache->clock_hand == pair) {
+        cache->clock_hand = pair->prev;
+    }
+    if (cache->tail == pair) {
+        cache->tail = pair->prev;
+    }
 
     /* Unlink */
-    if (!prev) {
-        cache->pair = cache->pair->next;
+    if (pair->prev) {
+        pair->prev->next = pair->next;
     } else {
-        prev->next = pair->next;
+        cache->pair = pair->next;
+    }
+    if (pair->next) {
+        pair->next->prev = pair->prev;
     }
 
     /* Destroy pair */
+    _bump_generations(cache, pair->attr);
     cache->destroy_attr(pair->attr);
     cache->destroy_value(pair->value);
     bson_free(pair);
-
-    return tmp;
+    BSON_ASSERT(cache->num_pairs > 0);
+    cache->num_pairs--;
 }
 
-/* Caller must hold mutex. */
+/* Destroy expired pairs. Only expired pairs are visited. Caller must hold
+ * write lock. */
 static void _mongocrypt_cache_evict(_mongocrypt_cache_t *cache) {
-    _mongocrypt_cache_pair_t *pair, *prev;
+    BSON_ASSERT_PARAM(cache);
+
+    while (cache->heap_len > 0 && _pair_expired(cache, cache->heap[0])) {
+        _destroy_pair(cache, cache->heap[0]);
+        _mongocrypt_atomic_int64_fetch_add(&cache->evictions, 1);
+    }
+}
 
+/* Destroy pairs until fewer than @max_entries remain. The clock hand sweeps
+ * from the oldest pair to the newest, giving recently used pairs a second
+ * chance. Caller must hold write lock. */
+static void _mongocrypt_cache_evict_to(_mongocrypt_cache_t *cache, size_t max_entries) {
     BSON_ASSERT_PARAM(cache);
 
-    prev = NULL;
-    pair = cache->pair;
-    while (pair) {
-        if (_pair_expired(cache, pair)) {
-            pair = _destroy_pair(cache, prev, pair);
+    while (cache->num_pairs > 0 && cache->num_pairs >= max_entries) {
+        _mongocrypt_cache_pair_t *pair = cache->clock_hand ? cache->clock_hand : cache->tail;
+
+        BSON_ASSERT(pair);
+        cache->clock_hand = pair->prev;
+        if (pair->referenced) {
+            pair->referenced = 0;
             continue;
         }
-        prev = pair;
-        pair = pair->next;
+        _destroy_pair(cache, pair);
+        _mongocrypt_atomic_int64_fetch_add(&cache->evictions, 1);
     }
 }
 
-/* Caller must hold mutex. */
+/* Caller must hold write lock. */
 static bool _mongocrypt_remove_matches(_mongocrypt_cache_t *cache, void *attr) {
-    _mongocrypt_cache_pair_t *pair, *prev;
-
     BSON_ASSERT_PARAM(cache);
     BSON_ASSERT_PARAM(attr);
 
-    prev = NULL;
-    pair = cache->pair;
-    while (pair) {
-        int res;
+    if (!cache->hash_attr) {
+        _mongocrypt_cache_pair_t *pair, *next;
 
-        if (!cache->cmp_attr(pair->attr, attr, &res)) {
-            return false;
-        }
+        for (pair = cache->pair; pair; pair = next) {
+            int res;
 
-        if (0 == res) {
-            pair = _destroy_pair(cache, prev, pair);
-            continue;
+            next = pair->next;
+            if (!cache->cmp_attr(pair->attr, attr, &res)) {
+                return false;
+            }
+
+            if (0 == res) {
+                _destroy_pair(cache, pair);
+            }
         }
-        prev = pair;
-        pair = pair->next;
+        return true;
     }
 
-    return true;
+    if (cache->slots_len == 0) {
+        return true;
+    }
+
+    uint32_t inline_hashes[CACHE_INLINE_HASHES];
+    uint32_t *hashes;
+    size_t count;
+    size_t mask = cache->slots_len - 1;
+    bool ok = true;
+
+    hashes = _attr_hashes(cache, attr, inline_hashes, &count);
+    for (size_t h = 0; h < count && ok; h++) {
+        /* Destroying a pair only marks its slots deleted, so probing may
+         * continue. */
+        for (size_t i = hashes[h] & mask; cache->slots[i].pair; i = (i + 1) & mask) {
+            _mongocrypt_cache_pair_t *pair = cache->slots[i].pair;
+            int res;
+
+            if (pair == DELETED_SLOT || cache->slots[i].hash != hashes[h]) {
+                continue;
+            }
+
+            if (!cache->cmp_attr(pair->attr, attr, &res)) {
+                ok = false;
+                break;
+            }
+
+            if (0 == res) {
+                _destroy_pair(cache, pair);
+            }
+        }
+    }
+    _attr_hashes_free(hashes, inline_hashes);
+    return ok;
 }
 
 void _mongocrypt_cache_set_expiration(_mongocrypt_cache_t *cache, uint64_t milli) {
+    _mongocrypt_cache_pair_t *pair;
+    bool changed = false;
+
     BSON_ASSERT_PARAM(cache);
+    BSON_ASSERT(milli <= INT64_MAX);
 
+    _mongocrypt_rwlock_write_lock(&cache->lock);
     cache->expiration = milli;
+    for (pair = cache->pair; pair; pair = pair->next) {
+        if (pair->default_expiration && pair->expiration != milli) {
+            pair->expiration = milli;
+            changed = true;
+        }
+    }
+    if (changed) {
+        _bump_all_generations(cache);
+        /* Pairs with their own expiration may now be out of order. */
+        for (size_t i = cache->heap_len / 2; i > 0; i--) {
+            _heap_sift_down(cache, i - 1);
+        }
+    }
+    _mongocrypt_rwlock_write_unlock(&cache->lock);
 }
 
-/* caller must hold lock. */
-static bool _find_pair(_mongocrypt_cache_t *cache, void *attr, _mongocrypt_cache_pair_t **out) {
-    _mongocrypt_cache_pair_t *pair;
+void _mongocrypt_cache_set_max_entries(_mongocrypt_cache_t *cache, uint32_t max_entries) {
+    BSON_ASSERT_PARAM(cache);
+
+    cache->max_entries = max_entries;
+}
+
+void _mongocrypt_cache_set_refresh_ahead(_mongocrypt_cache_t *cache, double fraction) {
+    BSON_ASSERT_PARAM(cache);
+    BSON_ASSERT(fraction >= 0 && fraction < 1);
+
+    cache->refresh_ahead = fraction;
+}
 
+/* Find an unexpired pair matching @attr. Does not modify the cache, so the
+ * caller may hold either a read or a write lock. */
+static bool _find_pair(_mongocrypt_cache_t *cache, void *attr, _mongocrypt_cache_pair_t **out) {
     BSON_ASSERT_PARAM(cache);
     BSON_ASSERT_PARAM(attr);
     BSON_ASSERT_PARAM(out);
 
     *out = NULL;
 
-    pair = cache->pair;
-    while (pair) {
-        int res;
-        /* TODO: this is a naive O(n) lookup. Consider optimizing
-           with a hash map (possibly vendor one). */
-        if (!cache->cmp_attr(pair->attr, attr, &res)) {
-            return false;
+    if (!cache->hash_attr) {
+        _mongocrypt_cache_pair_t *pair;
+
+        for (pair = cache->pair; pair; pair = pair->next) {
+            int res;
+
+            if (!cache->cmp_attr(pair->attr, attr, &res)) {
+                return false;
+            }
+
+            if (res == 0 && !_pair_expired(cache, pair)) {
+                *out = pair;
+                return true;
+            }
         }
+        return true;
+    }
+
+    if (cache->slots_len == 0) {
+        return true;
+    }
+
+    uint32_t inline_hashes[CACHE_INLINE_HASHES];
+    uint32_t *hashes;
+    size_t count;
+    size_t mask = cache->slots_len - 1;
+    bool ok = true;
 
-        if (res == 0) {
-            *out = pair;
-            return true;
+    hashes = _attr_hashes(cache, attr, inline_hashes, &count);
+    for (size_t h = 0; h < count && ok && !*out; h++) {
+        for (size_t i = hashes[h] & mask; cache->slots[i].pair; i = (i + 1) & mask) {
+            _mongocrypt_cache_pair_t *pair = cache->slots[i].pair;
+            int res;
+
+            if (pair == DELETED_SLOT || cache->slots[i].hash != hashes[h]) {
+                continue;
+            }
+
+            if (!cache->cmp_attr(pair->attr, attr, &res)) {
+                ok = false;
+                break;
+            }
+
+            if (res == 0 && !_pair_expired(cache, pair)) {
+                *out = pair;
+                break;
+            }
         }
-        pair = pair->next;
     }
-    return true;
+    _attr_hashes_free(hashes, inline_hashes);
+    return ok;
 }
 
 /* Create a new pair on linked list. Caller must hold lock. */
-static _mongocrypt_cache_pair_t *_pair_new(_mongocrypt_cache_t *cache, void *attr) {
+/* @expiration is the lifetime of the pair in milliseconds, or 0 to follow the
+ * cache expiration. */
+static _mongocrypt_cache_pair_t *
+_pair_new(_mongocrypt_cache_t *cache, void *attr, int64_t age_ms, uint64_t expiration) {
     _mongocrypt_cache_pair_t *pair;
 
     BSON_ASSERT_PARAM(cache);
@@ -149,8 +662,18 @@ static _mongocrypt_cache_pair_t *_pair_new(_mongocrypt_cache_t *cache, void *att
     pair->attr = cache->copy_attr(attr);
     /* add rest of values. */
     pair->next = cache->pair;
-    pair->last_updated = bson_get_monotonic_time() / 1000;
+    if (cache->pair) {
+        cache->pair->prev = pair;
+    } else {
+        cache->tail = pair;
+    }
+    pair->last_updated = bson_get_monotonic_time() / 1000 - age_ms;
+    pair->default_expiration = expiration == 0;
+    pair->expiration = pair->default_expiration ? cache->expiration : expiration;
     cache->pair = pair;
+    cache->num_pairs++;
+    _index_insert(cache, pair);
+    _heap_push(cache, pair);
     return pair;
 }
 
@@ -164,57 +687,173 @@ static void _cache_pair_destroy(_mongocrypt_cache_t *cache, _mongocrypt_cache_pa
     bson_free(pair);
 }
 
-bool _mongocrypt_cache_get(_mongocrypt_cache_t *cache,
-                           void *attr, /* attr of cache item */
-                           void **value /* copied to. */) {
+/* @generation and @valid_until_ms may be NULL. */
+static bool _cache_get(_mongocrypt_cache_t *cache,
+                       void *attr,
+                       void **value,
+                       bool *needs_refresh,
+                       int64_t *generation,
+                       int64_t *valid_until_ms) {
     _mongocrypt_cache_pair_t *match;
+    bool needs_evict;
 
     BSON_ASSERT_PARAM(cache);
     BSON_ASSERT_PARAM(attr);
     BSON_ASSERT_PARAM(value);
 
     *value = NULL;
+    if (needs_refresh) {
+        *needs_refresh = false;
+    }
 
-    _mongocrypt_mutex_lock(&cache->mutex);
-    /* TODO CDRIVER-3120: optimize the eviction algorithm to avoid unnecessary
-     * O(n) traversal */
-    _mongocrypt_cache_evict(cache);
+    /* Lookups only read the cache, so concurrent gets do not serialize.
+     * Expired pairs are skipped, and evicted below if any are found. */
+    _mongocrypt_rwlock_read_lock(&cache->lock);
     if (!_find_pair(cache, attr, &match)) {
-        _mongocrypt_mutex_unlock(&cache->mutex);
+        _mongocrypt_rwlock_read_unlock(&cache->lock);
         return false;
     }
 
+    if (generation) {
+        /* Pairs are only removed under the write lock. */
+        *generation = _mongocrypt_atomic_int64_load(&cache->generations[_generation_index(cache, attr)]);
+    }
+    if (match && valid_until_ms) {
+        *valid_until_ms = _pair_deadline(match);
+        if (cache->refresh_ahead > 0) {
+            double refresh_ms = (double)match->last_updated + (double)match->expiration * cache->refresh_ahead;
+
+            if (refresh_ms < (double)*valid_until_ms) {
+                *valid_until_ms = (int64_t)refresh_ms;
+            }
+        }
+    }
+
     if (match) {
         *value = cache->copy_value(match->value);
+        _mongocrypt_atomic_int64_fetch_add(&cache->hits, 1);
+        MONGOCRYPT_PROBE2(cache__hit, cache->name, cache->num_pairs);
+        if (cache->max_entries && _mongocrypt_atomic_int32_load(&match->referenced) == 0) {
+            _mongocrypt_atomic_int32_fetch_add(&match->referenced, 1);
+        }
+        if (needs_refresh && _mongocrypt_atomic_int32_load(&match->refresh_claimed) == 0
+            && _pair_wants_refresh(cache, match)) {
+            /* The first caller past the refresh point claims the refresh. */
+            *needs_refresh = 0 == _mongocrypt_atomic_int32_fetch_add(&match->refresh_claimed, 1);
+        }
+    } else {
+        _mongocrypt_atomic_int64_fetch_add(&cache->misses, 1);
+        MONGOCRYPT_PROBE2(cache__miss, cache->name, cache->num_pairs);
+    }
+    needs_evict = cache->heap_len > 0 && _pair_expired(cache, cache->heap[0]);
+    _mongocrypt_rwlock_read_unlock(&cache->lock);
+
+    if (needs_evict) {
+        _mongocrypt_rwlock_write_lock(&cache->lock);
+        _mongocrypt_cache_evict(cache);
+        _mongocrypt_rwlock_write_unlock(&cache->lock);
     }
-    _mongocrypt_mutex_unlock(&cache->mutex);
     return true;
 }
 
-static bool
-_cache_add(_mongocrypt_cache_t *cache, void *attr, void *value, mongocrypt_status_t *status, bool steal_value) {
+bool _mongocrypt_cache_get(_mongocrypt_cache_t *cache,
+                           void *attr, /* attr of cache item */
+                           void **value /* copied to. */) {
+    return _cache_get(cache, attr, value, NULL, NULL, NULL);
+}
+
+bool _mongocrypt_cache_get_or_refresh(_mongocrypt_cache_t *cache, void *attr, void **value, bool *needs_refresh) {
+    BSON_ASSERT_PARAM(needs_refresh);
+
+    return _cache_get(cache, attr, value, needs_refresh, NULL, NULL);
+}
+
+bool _mongocrypt_cache_get_with_validity(_mongocrypt_cache_t *cache,
+                                         void *attr,
+                                         void **value,
+                                         bool *needs_refresh,
+                                         int64_t *generation,
+                                         int64_t *valid_until_ms) {
+    BSON_ASSERT_PARAM(generation);
+    BSON_ASSERT_PARAM(valid_until_ms);
+
+    return _cache_get(cache, attr, value, needs_refresh, generation, valid_until_ms);
+}
+
+int64_t _mongocrypt_cache_generation(_mongocrypt_cache_t *cache, uint32_t hash) {
+    BSON_ASSERT_PARAM(cache);
+
+    return _mongocrypt_atomic_int64_load_relaxed(&cache->generations[hash % CACHE_GENERATIONS]);
+}
+
+_mongocrypt_cache_life_t *_mongocrypt_cache_life_retain(_mongocrypt_cache_t *cache) {
+    int32_t prev;
+
+    BSON_ASSERT_PARAM(cache);
+    BSON_ASSERT(cache->life);
+
+    prev = _mongocrypt_atomic_int32_fetch_add(&cache->life->refcount, 1);
+    BSON_ASSERT(prev > 0);
+    return cache->life;
+}
+
+bool _mongocrypt_cache_life_ended(_mongocrypt_cache_life_t *life) {
+    BSON_ASSERT_PARAM(life);
+
+    return 0 != _mongocrypt_atomic_int32_load(&life->ended);
+}
+
+void _mongocrypt_cache_life_release(_mongocrypt_cache_life_t *life) {
+    int32_t prev;
+
+    if (!life) {
+        return;
+    }
+    prev = _mongocrypt_atomic_int32_fetch_add(&life->refcount, -1);
+    BSON_ASSERT(prev > 0);
+    if (prev == 1) {
+        bson_free(life);
+    }
+}
+
+int64_t _mongocrypt_cache_ended_epoch(void) {
+    return _mongocrypt_atomic_int64_load_relaxed(&_ended_epoch);
+}
+
+static bool _cache_add(_mongocrypt_cache_t *cache,
+                       void *attr,
+                       void *value,
+                       int64_t age_ms,
+                       uint64_t expiration,
+                       mongocrypt_status_t *status,
+                       bool steal_value) {
     _mongocrypt_cache_pair_t *pair;
 
     BSON_ASSERT_PARAM(cache);
     BSON_ASSERT_PARAM(attr);
     BSON_ASSERT_PARAM(value);
 
-    _mongocrypt_mutex_lock(&cache->mutex);
+    _mongocrypt_rwlock_write_lock(&cache->lock);
     _mongocrypt_cache_evict(cache);
     if (!_mongocrypt_remove_matches(cache, attr)) {
         CLIENT_ERR("error removing from cache");
-        _mongocrypt_mutex_unlock(&cache->mutex);
+        _mongocrypt_rwlock_write_unlock(&cache->lock);
         return false;
     }
 
-    pair = _pair_new(cache, attr);
+    if (cache->max_entries) {
+        _mongocrypt_cache_evict_to(cache, cache->max_entries);
+    }
+
+    pair = _pair_new(cache, attr, age_ms, expiration);
 
     if (steal_value) {
         pair->value = value;
     } else {
         pair->value = cache->copy_value(value);
     }
-    _mongocrypt_mutex_unlock(&cache->mutex);
+    _mongocrypt_atomic_int64_fetch_add(&cache->insertions, 1);
+    _mongocrypt_rwlock_write_unlock(&cache->lock);
     return true;
 }
 
@@ -223,7 +862,20 @@ bool _mongocrypt_cache_add_copy(_mongocrypt_cache_t *cache, void *attr, void *va
     BSON_ASSERT_PARAM(attr);
     BSON_ASSERT_PARAM(value);
 
-    return _cache_add(cache, attr, value, status, false);
+    return _cache_add(cache, attr, value, 0, 0, status, false);
+}
+
+bool _mongocrypt_cache_add_copy_with_expiration(_mongocrypt_cache_t *cache,
+                                                void *attr,
+                                                void *value,
+                                                uint64_t milli,
+                                                mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(cache);
+    BSON_ASSERT_PARAM(attr);
+    BSON_ASSERT_PARAM(value);
+    BSON_ASSERT(milli > 0 && milli <= INT64_MAX);
+
+    return _cache_add(cache, attr, value, 0, milli, status, false);
 }
 
 bool _mongocrypt_cache_add_stolen(_mongocrypt_cache_t *cache, void *attr, void *value, mongocrypt_status_t *status) {
@@ -231,7 +883,97 @@ bool _mongocrypt_cache_add_stolen(_mongocrypt_cache_t *cache, void *attr, void *
     BSON_ASSERT_PARAM(attr);
     BSON_ASSERT_PARAM(value);
 
-    return _cache_add(cache, attr, value, status, true);
+    return _cache_add(cache, attr, value, 0, 0, status, true);
+}
+
+bool _mongocrypt_cache_add_stolen_with_expiration(_mongocrypt_cache_t *cache,
+                                                  void *attr,
+                                                  void *value,
+                                                  uint64_t milli,
+                                                  mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(cache);
+    BSON_ASSERT_PARAM(attr);
+    BSON_ASSERT_PARAM(value);
+    BSON_ASSERT(milli > 0 && milli <= INT64_MAX);
+
+    return _cache_add(cache, attr, value, 0, milli, status, true);
+}
+
+bool _mongocrypt_cache_add_stolen_aged(_mongocrypt_cache_t *cache,
+                                       void *attr,
+                                       void *value,
+                                       int64_t age_ms,
+                                       mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(cache);
+    BSON_ASSERT_PARAM(attr);
+    BSON_ASSERT_PARAM(value);
+    BSON_ASSERT(age_ms >= 0);
+
+    return _cache_add(cache, attr, value, age_ms, 0, status, true);
+}
+
+bool _mongocrypt_cache_remove(_mongocrypt_cache_t *cache, void *attr, mongocrypt_status_t *status) {
+    bool ok;
+
+    BSON_ASSERT_PARAM(cache);
+    BSON_ASSERT_PARAM(attr);
+
+    _mongocrypt_rwlock_write_lock(&cache->lock);
+    ok = _mongocrypt_remove_matches(cache, attr);
+    _mongocrypt_rwlock_write_unlock(&cache->lock);
+    if (!ok) {
+        CLIENT_ERR("error removing from cache");
+    }
+    return ok;
+}
+
+void _mongocrypt_cache_remove_if(_mongocrypt_cache_t *cache, cache_match_fn match, void *ctx) {
+    _mongocrypt_cache_pair_t *pair, *next;
+
+    BSON_ASSERT_PARAM(cache);
+    BSON_ASSERT_PARAM(match);
+
+    _mongocrypt_rwlock_write_lock(&cache->lock);
+    for (pair = cache->pair; pair; pair = next) {
+        next = pair->next;
+        if (match(pair->attr, ctx)) {
+            _destroy_pair(cache, pair);
+        }
+    }
+    _mongocrypt_rwlock_write_unlock(&cache->lock);
+}
+
+void _mongocrypt_cache_clear(_mongocrypt_cache_t *cache) {
+    BSON_ASSERT_PARAM(cache);
+
+    _mongocrypt_rwlock_write_lock(&cache->lock);
+    while (cache->pair) {
+        _destroy_pair(cache, cache->pair);
+    }
+    _mongocrypt_rwlock_write_unlock(&cache->lock);
+}
+
+bool _mongocrypt_cache_foreach(_mongocrypt_cache_t *cache, cache_visit_fn visit, void *ctx) {
+    _mongocrypt_cache_pair_t *pair;
+    int64_t current;
+    bool ret = true;
+
+    BSON_ASSERT_PARAM(cache);
+    BSON_ASSERT_PARAM(visit);
+
+    _mongocrypt_rwlock_read_lock(&cache->lock);
+    current = bson_get_monotonic_time() / 1000;
+    for (pair = cache->pair; pair; pair = pair->next) {
+        if (_pair_expired(cache, pair)) {
+            continue;
+        }
+        if (!visit(pair->attr, pair->value, current - pair->last_updated, ctx)) {
+            ret = false;
+            break;
+        }
+    }
+    _mongocrypt_rwlock_read_unlock(&cache->lock);
+    return ret;
 }
 
 void _mongocrypt_cache_cleanup(_mongocrypt_cache_t *cache) {
@@ -247,6 +989,29 @@ void _mongocrypt_cache_cleanup(_mongocrypt_cache_t *cache) {
         _cache_pair_destroy(cache, pair);
         pair = tmp;
     }
+    cache->pair = NULL;
+    cache->tail = NULL;
+    cache->clock_hand = NULL;
+    cache->num_pairs = 0;
+    bson_free(cache->slots);
+    cache->slots = NULL;
+    cache->slots_len = 0;
+    cache->slots_used = 0;
+    bson_free(cache->heap);
+    cache->heap = NULL;
+    cache->heap_len = 0;
+    cache->heap_cap = 0;
+    _mongocrypt_rwlock_cleanup(&cache->lock);
+    if (cache->life) {
+        /* Holders of the life release their copies once they see the epoch
+         * change. */
+        _mongocrypt_atomic_int32_exchange(&cache->life->ended, 1);
+        if (_mongocrypt_atomic_int32_load(&cache->life->refcount) > 1) {
+            _mongocrypt_atomic_int64_fetch_add(&_ended_epoch, 1);
+        }
+        _mongocrypt_cache_life_release(cache->life);
+        cache->life = NULL;
+    }
 }
 
 /* Print the contents of the cache (for debugging purposes) */
@@ -256,7 +1021,7 @@ void _mongocrypt_cache_dump(_mongocrypt_cache_t *cache) {
 
     BSON_ASSERT_PARAM(cache);
 
-    _mongocrypt_mutex_lock(&cache->mutex);
+    _mongocrypt_rwlock_read_lock(&cache->lock);
     count = 0;
     for (pair = cache->pair; pair != NULL; pair = pair->next) {
         /* don't check that int64_t fits in int, since this is only diagnostic */
@@ -268,21 +1033,65 @@ void _mongocrypt_cache_dump(_mongocrypt_cache_t *cache) {
         count++;
     }
 
-    _mongocrypt_mutex_unlock(&cache->mutex);
+    _mongocrypt_rwlock_read_unlock(&cache->lock);
 }
 
 uint32_t _mongocrypt_cache_num_entries(_mongocrypt_cache_t *cache) {
-    _mongocrypt_cache_pair_t *pair;
     uint32_t count;
+    bool ok;
 
     BSON_ASSERT_PARAM(cache);
 
-    _mongocrypt_mutex_lock(&cache->mutex);
-    count = 0;
+    /* Expired pairs may not have been evicted yet. */
+    _mongocrypt_rwlock_write_lock(&cache->lock);
+    _mongocrypt_cache_evict(cache);
+    ok = size_to_uint32(cache->num_pairs, &count);
+    _mongocrypt_rwlock_write_unlock(&cache->lock);
+    BSON_ASSERT(ok);
+    return count;
+}
+
+void _mongocrypt_cache_stats(_mongocrypt_cache_t *cache, _mongocrypt_cache_stats_t *out) {
+    BSON_ASSERT_PARAM(cache);
+    BSON_ASSERT_PARAM(out);
+
+    _mongocrypt_rwlock_write_lock(&cache->lock);
+    _mongocrypt_cache_evict(cache);
+    BSON_ASSERT(cache->num_pairs <= INT64_MAX);
+    out->entries = (int64_t)cache->num_pairs;
+    _mongocrypt_rwlock_write_unlock(&cache->lock);
+
+    out->hits = _mongocrypt_atomic_int64_load(&cache->hits);
+    out->misses = _mongocrypt_atomic_int64_load(&cache->misses);
+    out->evictions = _mongocrypt_atomic_int64_load(&cache->evictions);
+    out->insertions = _mongocrypt_atomic_int64_load(&cache->insertions);
+}
+
+size_t _mongocrypt_cache_memory_usage(_mongocrypt_cache_t *cache) {
+    _mongocrypt_cache_pair_t *pair;
+    size_t bytes;
+
+    BSON_ASSERT_PARAM(cache);
+
+    _mongocrypt_rwlock_read_lock(&cache->lock);
+    bytes = cache->slots_len * sizeof(_mongocrypt_cache_slot_t) + cache->heap_cap * sizeof(_mongocrypt_cache_pair_t *);
     for (pair = cache->pair; pair != NULL; pair = pair->next) {
-        count++;
+        bytes += sizeof(_mongocrypt_cache_pair_t);
+        if (cache->size_attr) {
+            bytes += cache->size_attr(pair->attr);
+        }
+        if (cache->size_value) {
+            bytes += cache->size_value(pair->value);
+        }
     }
+    _mongocrypt_rwlock_read_unlock(&cache->lock);
+    return bytes;
+}
 
-    _mongocrypt_mutex_unlock(&cache->mutex);
-    return count;
+#ifndef _WIN32
+void _mongocrypt_cache_atfork_child(_mongocrypt_cache_t *cache) {
+    BSON_ASSERT_PARAM(cache);
+
+    _mongocrypt_rwlock_init(&cache->lock);
 }
+#endif
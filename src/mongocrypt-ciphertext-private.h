@@ -19,6 +19,7 @@
 
 #include "mc-fle-blob-subtype-private.h"
 #include "mongocrypt-buffer-private.h"
+#include "mongocrypt-private.h"
 #include "mongocrypt.h"
 
 /**
@@ -49,4 +50,29 @@ bool _mongocrypt_serialize_ciphertext(_mongocrypt_ciphertext_t *ciphertext,
 bool _mongocrypt_ciphertext_serialize_associated_data(_mongocrypt_ciphertext_t *ciphertext,
                                                       _mongocrypt_buffer_t *out) MONGOCRYPT_WARN_UNUSED_RESULT;
 
+/* Returns true if the value at @iter may be encrypted with @algo. */
+bool _mongocrypt_permitted_for_encryption(bson_iter_t *iter,
+                                          mongocrypt_encryption_algorithm_t algo,
+                                          mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
+/* Encrypts the value at @v_iter into the FLE1 @ciphertext with the decrypted
+ * key material @key_material of the key @key_id. Deterministic ciphertexts are
+ * taken from and added to the deterministic cache of @crypt, if enabled. */
+bool _mongocrypt_fle1_encrypt(mongocrypt_t *crypt,
+                              mongocrypt_encryption_algorithm_t algorithm,
+                              const _mongocrypt_buffer_t *key_id,
+                              const _mongocrypt_buffer_t *key_material,
+                              bson_iter_t *v_iter,
+                              _mongocrypt_ciphertext_t *ciphertext,
+                              mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
+/* Decrypts the FLE1 @ciphertext with the decrypted key material @key_material.
+ * Sets @out to the bytes of the BSON value of type @type_out. */
+bool _mongocrypt_fle1_decrypt(_mongocrypt_crypto_t *crypto,
+                              _mongocrypt_ciphertext_t *ciphertext,
+                              const _mongocrypt_buffer_t *key_material,
+                              bson_type_t *type_out,
+                              _mongocrypt_buffer_t *out,
+                              mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
 #endif /* MONGOCRYPT_CIPHERTEXT_PRIVATE_H */
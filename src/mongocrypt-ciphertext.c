@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include "mongocrypt-cache-deterministic-private.h"
 #include "mongocrypt-ciphertext-private.h"
 #include "mongocrypt-private.h"
 
@@ -191,3 +192,256 @@ bool _mongocrypt_ciphertext_serialize_associated_data(_mongocrypt_ciphertext_t *
 
     return true;
 }
+
+bool _mongocrypt_permitted_for_encryption(bson_iter_t *iter,
+                                          mongocrypt_encryption_algorithm_t algo,
+                                          mongocrypt_status_t *status) {
+    bson_type_t bson_type;
+    const bson_value_t *bson_value;
+    bool ret = false;
+
+    BSON_ASSERT_PARAM(iter);
+
+    bson_value = bson_iter_value(iter);
+    if (!bson_value) {
+        CLIENT_ERR("Unknown BSON type");
+        goto fail;
+    }
+    bson_type = bson_value->value_type;
+    switch (bson_type) {
+    case BSON_TYPE_NULL:
+    case BSON_TYPE_MINKEY:
+    case BSON_TYPE_MAXKEY:
+    case BSON_TYPE_UNDEFINED: CLIENT_ERR("BSON type invalid for encryption"); goto fail;
+    case BSON_TYPE_BINARY:
+        if (bson_value->value.v_binary.subtype == BSON_SUBTYPE_ENCRYPTED) {
+            CLIENT_ERR("BSON binary subtype 6 is invalid for encryption");
+            goto fail;
+        }
+        /* ok */
+        break;
+    case BSON_TYPE_DOUBLE:
+    case BSON_TYPE_DOCUMENT:
+    case BSON_TYPE_ARRAY:
+    case BSON_TYPE_CODEWSCOPE:
+    case BSON_TYPE_BOOL:
+    case BSON_TYPE_DECIMAL128:
+        if (algo == MONGOCRYPT_ENCRYPTION_ALGORITHM_DETERMINISTIC) {
+            CLIENT_ERR("BSON type invalid for deterministic encryption");
+            goto fail;
+        }
+        break;
+    case BSON_TYPE_UTF8:
+    case BSON_TYPE_OID:
+    case BSON_TYPE_DATE_TIME:
+    case BSON_TYPE_REGEX:
+    case BSON_TYPE_DBPOINTER:
+    case BSON_TYPE_CODE:
+    case BSON_TYPE_SYMBOL:
+    case BSON_TYPE_INT32:
+    case BSON_TYPE_TIMESTAMP:
+    case BSON_TYPE_INT64:
+        /* ok */
+        break;
+    case BSON_TYPE_EOD:
+    default: CLIENT_ERR("invalid BSON value type 00"); goto fail;
+    }
+
+    ret = true;
+fail:
+    return ret;
+}
+
+bool _mongocrypt_fle1_encrypt(mongocrypt_t *crypt,
+                              mongocrypt_encryption_algorithm_t algorithm,
+                              const _mongocrypt_buffer_t *key_id,
+                              const _mongocrypt_buffer_t *key_material,
+                              bson_iter_t *v_iter,
+                              _mongocrypt_ciphertext_t *ciphertext,
+                              mongocrypt_status_t *status) {
+    const _mongocrypt_value_encryption_algorithm_t *fle1 = _mcFLE1Algorithm();
+    _mongocrypt_buffer_t plaintext;
+    _mongocrypt_buffer_t iv;
+    uint8_t iv_storage[MONGOCRYPT_BUFFER_SMALL_LEN];
+    _mongocrypt_buffer_t associated_data;
+    _mongocrypt_buffer_t cache_key;
+    _mongocrypt_crypto_t *crypto;
+    bool ret = false;
+    uint32_t bytes_written;
+
+    BSON_ASSERT_PARAM(crypt);
+    BSON_ASSERT_PARAM(key_id);
+    BSON_ASSERT_PARAM(key_material);
+    BSON_ASSERT_PARAM(v_iter);
+    BSON_ASSERT_PARAM(ciphertext);
+
+    _mongocrypt_buffer_init(&plaintext);
+    _mongocrypt_buffer_init(&associated_data);
+    _mongocrypt_buffer_init(&iv);
+    _mongocrypt_buffer_init(&cache_key);
+    crypto = crypt->crypto;
+
+    ciphertext->original_bson_type = (uint8_t)bson_iter_type(v_iter);
+    if (algorithm == MONGOCRYPT_ENCRYPTION_ALGORITHM_DETERMINISTIC) {
+        ciphertext->blob_subtype = MC_SUBTYPE_FLE1DeterministicEncryptedValue;
+    } else {
+        BSON_ASSERT(algorithm == MONGOCRYPT_ENCRYPTION_ALGORITHM_RANDOM);
+        ciphertext->blob_subtype = MC_SUBTYPE_FLE1RandomEncryptedValue;
+    }
+    _mongocrypt_buffer_copy_to(key_id, &ciphertext->key_id);
+    if (!_mongocrypt_ciphertext_serialize_associated_data(ciphertext, &associated_data)) {
+        CLIENT_ERR("could not serialize associated data");
+        goto fail;
+    }
+
+    _mongocrypt_buffer_from_iter(&plaintext, v_iter);
+
+    if (algorithm == MONGOCRYPT_ENCRYPTION_ALGORITHM_DETERMINISTIC && crypt->opts.deterministic_cache_max_entries > 0) {
+        _mongocrypt_buffer_t *cached = NULL;
+
+        _mongocrypt_cache_deterministic_key(&associated_data, &plaintext, &cache_key);
+        if (!_mongocrypt_cache_get(&crypt->cache_deterministic, &cache_key, (void **)&cached)) {
+            CLIENT_ERR("failed to retrieve from deterministic cache");
+            goto fail;
+        }
+        if (cached) {
+            _mongocrypt_buffer_steal(&ciphertext->data, cached);
+            bson_free(cached);
+            ret = true;
+            goto fail;
+        }
+    }
+
+    ciphertext->data.len = fle1->get_ciphertext_len(plaintext.len, status);
+    if (ciphertext->data.len == 0) {
+        goto fail;
+    }
+    ciphertext->data.data = bson_malloc(ciphertext->data.len);
+    BSON_ASSERT(ciphertext->data.data);
+
+    ciphertext->data.owned = true;
+
+    switch (algorithm) {
+    case MONGOCRYPT_ENCRYPTION_ALGORITHM_DETERMINISTIC:
+        /* Use deterministic encryption. */
+        _mongocrypt_buffer_init_size_small(&iv, MONGOCRYPT_IV_LEN, iv_storage);
+        ret = _mongocrypt_calculate_deterministic_iv(crypto, key_material, &plaintext, &associated_data, &iv, status);
+        if (!ret) {
+            goto fail;
+        }
+
+        ret = fle1->do_encrypt(crypto,
+                               &iv,
+                               &associated_data,
+                               key_material,
+                               &plaintext,
+                               &ciphertext->data,
+                               &bytes_written,
+                               status);
+        break;
+    case MONGOCRYPT_ENCRYPTION_ALGORITHM_RANDOM:
+        /* Use randomized encryption.
+         * In this case, we must generate a new, random iv. */
+        _mongocrypt_buffer_init_size_small(&iv, MONGOCRYPT_IV_LEN, iv_storage);
+        if (!_mongocrypt_random(crypto, &iv, MONGOCRYPT_IV_LEN, status)) {
+            goto fail;
+        }
+        ret = fle1->do_encrypt(crypto,
+                               &iv,
+                               &associated_data,
+                               key_material,
+                               &plaintext,
+                               &ciphertext->data,
+                               &bytes_written,
+                               status);
+        break;
+    case MONGOCRYPT_ENCRYPTION_ALGORITHM_NONE:
+    default:
+        /* Error. */
+        CLIENT_ERR("Unsupported value for encryption algorithm");
+        goto fail;
+    }
+
+    if (!ret) {
+        goto fail;
+    }
+
+    BSON_ASSERT(bytes_written == ciphertext->data.len);
+
+    if (cache_key.len > 0
+        && !_mongocrypt_cache_add_copy(&crypt->cache_deterministic, &cache_key, &ciphertext->data, status)) {
+        ret = false;
+        goto fail;
+    }
+
+    ret = true;
+
+fail:
+    /* The cache key holds the plaintext value. */
+    bson_zero_free(cache_key.data, cache_key.len);
+    _mongocrypt_buffer_cleanup(&iv);
+    _mongocrypt_buffer_cleanup(&plaintext);
+    _mongocrypt_buffer_cleanup(&associated_data);
+    return ret;
+}
+
+bool _mongocrypt_fle1_decrypt(_mongocrypt_crypto_t *crypto,
+                              _mongocrypt_ciphertext_t *ciphertext,
+                              const _mongocrypt_buffer_t *key_material,
+                              bson_type_t *type_out,
+                              _mongocrypt_buffer_t *out,
+                              mongocrypt_status_t *status) {
+    const _mongocrypt_value_encryption_algorithm_t *fle1alg = _mcFLE1Algorithm();
+    _mongocrypt_buffer_t plaintext;
+    _mongocrypt_buffer_t associated_data;
+    uint32_t bytes_written;
+    bool ret = false;
+
+    BSON_ASSERT_PARAM(crypto);
+    BSON_ASSERT_PARAM(ciphertext);
+    BSON_ASSERT_PARAM(key_material);
+    BSON_ASSERT_PARAM(type_out);
+    BSON_ASSERT_PARAM(out);
+
+    _mongocrypt_buffer_init(&plaintext);
+    _mongocrypt_buffer_init(&associated_data);
+
+    plaintext.len = fle1alg->get_plaintext_len(ciphertext->data.len, status);
+    if (plaintext.len == 0) {
+        goto fail;
+    }
+    plaintext.data = bson_malloc0(plaintext.len);
+    BSON_ASSERT(plaintext.data);
+
+    plaintext.owned = true;
+
+    if (!_mongocrypt_ciphertext_serialize_associated_data(ciphertext, &associated_data)) {
+        CLIENT_ERR("could not serialize associated data");
+        goto fail;
+    }
+
+    if (!fle1alg->do_decrypt(crypto,
+                             &associated_data,
+                             key_material,
+                             &ciphertext->data,
+                             &plaintext,
+                             &bytes_written,
+                             status)) {
+        goto fail;
+    }
+
+    plaintext.len = bytes_written;
+
+    if (!_mongocrypt_buffer_is_bson_value(&plaintext, ciphertext->original_bson_type)) {
+        CLIENT_ERR("malformed encrypted bson");
+        goto fail;
+    }
+    *type_out = (bson_type_t)ciphertext->original_bson_type;
+    _mongocrypt_buffer_steal(out, &plaintext);
+
+    ret = true;
+fail:
+    _mongocrypt_buffer_cleanup(&plaintext);
+    _mongocrypt_buffer_cleanup(&associated_data);
+    return ret;
+}
@@ -31,6 +31,24 @@
 #define MONGOCRYPT_HMAC_SHA256_LEN 32
 #define MONGOCRYPT_TOKEN_KEY_LEN 32
 
+/* Random requests of at most this many bytes (e.g. IVs) are served from the
+ * random pool. */
+#define MONGOCRYPT_RANDOM_POOL_MAX_REQUEST 32
+#define MONGOCRYPT_RANDOM_POOL_LEN 4096
+
+typedef struct _mongocrypt_random_pool_t _mongocrypt_random_pool_t;
+
+/* Creates a pool of buffered output from the native random source. */
+_mongocrypt_random_pool_t *_mongocrypt_random_pool_new(void);
+
+void _mongocrypt_random_pool_destroy(_mongocrypt_random_pool_t *pool);
+
+#ifndef _WIN32
+/* Called in the child after fork. Reinitializes the lock of @pool and discards
+ * the random bytes it shares with the parent. */
+void _mongocrypt_random_pool_atfork_child(_mongocrypt_random_pool_t *pool);
+#endif
+
 typedef struct {
     int hooks_enabled;
     mongocrypt_crypto_fn aes_256_cbc_encrypt;
@@ -41,10 +59,27 @@ typedef struct {
     mongocrypt_random_fn random;
     mongocrypt_hmac_fn hmac_sha_512;
     mongocrypt_hmac_fn hmac_sha_256;
+    mongocrypt_hmac_batch_fn hmac_sha_256_batch;
     mongocrypt_hash_fn sha_256;
     void *ctx;
+    /* May be NULL. Only used if hooks are not enabled. */
+    _mongocrypt_random_pool_t *random_pool;
+    /* May be NULL. Runs independent crypto work, possibly concurrently. */
+    mongocrypt_parallel_for_fn parallel_for;
+    void *parallel_for_ctx;
 } _mongocrypt_crypto_t;
 
+/* Whether @crypto calls hooks, or the hook @name is set. Without
+ * MONGOCRYPT_ENABLE_CRYPTO_HOOKS these are constant false, so the hook branches
+ * are compiled out and primitives bind directly to the native crypto. */
+#ifdef MONGOCRYPT_ENABLE_CRYPTO_HOOKS
+#define MONGOCRYPT_CRYPTO_HOOKS_ENABLED(crypto) ((crypto)->hooks_enabled)
+#define MONGOCRYPT_CRYPTO_HAS_HOOK(crypto, name) (NULL != (crypto)->name)
+#else
+#define MONGOCRYPT_CRYPTO_HOOKS_ENABLED(crypto) false
+#define MONGOCRYPT_CRYPTO_HAS_HOOK(crypto, name) false
+#endif
+
 typedef uint32_t (*_mongocrypt_ciphertextlen_fn)(uint32_t plaintext_len, mongocrypt_status_t *status);
 typedef uint32_t (*_mongocrypt_plaintextlen_fn)(uint32_t ciphertext_len, mongocrypt_status_t *status);
 typedef bool (*_mongocrypt_do_encryption_fn)(_mongocrypt_crypto_t *crypto,
@@ -166,6 +201,25 @@ bool _mongocrypt_hmac_sha_256(_mongocrypt_crypto_t *crypto,
                               _mongocrypt_buffer_t *out,
                               mongocrypt_status_t *status);
 
+/*
+ * _mongocrypt_hmac_sha_256_batch computes @count independent HMAC SHA-256s.
+ * outs[i] = HMAC(keys[i], ins[i]).
+ *
+ * Uses the hmac_sha_256_batch hook set on @crypto if set. Otherwise calls
+ * _mongocrypt_hmac_sha_256 for each.
+ *
+ * Each of @outs is initialized to 32 bytes, even on failure.
+ *
+ * Returns true if no error occurred.
+ * Returns false sets @status if an error occurred.
+ */
+bool _mongocrypt_hmac_sha_256_batch(_mongocrypt_crypto_t *crypto,
+                                    const _mongocrypt_buffer_t **keys,
+                                    const _mongocrypt_buffer_t **ins,
+                                    _mongocrypt_buffer_t *outs,
+                                    uint32_t count,
+                                    mongocrypt_status_t *status);
+
 /* Crypto implementations must implement these functions. */
 
 /* This variable must be defined in implementation
@@ -175,6 +229,17 @@ extern bool _native_crypto_initialized;
 
 void _native_crypto_init(void);
 
+/* Runs _native_crypto_init once, on the first call. Native crypto is set up
+ * lazily, so a process that never encrypts does not pay for it. Call this
+ * before calling any other _native_crypto_ function. */
+bool _native_crypto_ensure_init(mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
+#ifndef _WIN32
+/* Called in the child after fork. Reinitializes the locks of any state the
+ * implementation shares between threads. */
+void _native_crypto_atfork_child(void);
+#endif
+
 typedef struct {
     const _mongocrypt_buffer_t *key;
     const _mongocrypt_buffer_t *iv;
@@ -206,4 +271,18 @@ bool _native_crypto_hmac_sha_256(const _mongocrypt_buffer_t *key,
                                  _mongocrypt_buffer_t *out,
                                  mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
 
+/* Compute the HMAC of the concatenation of the @in_count buffers in @in,
+ * without copying them into one buffer. */
+bool _native_crypto_hmac_sha_512_parts(const _mongocrypt_buffer_t *key,
+                                       const _mongocrypt_buffer_t *in,
+                                       uint32_t in_count,
+                                       _mongocrypt_buffer_t *out,
+                                       mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
+bool _native_crypto_hmac_sha_256_parts(const _mongocrypt_buffer_t *key,
+                                       const _mongocrypt_buffer_t *in,
+                                       uint32_t in_count,
+                                       _mongocrypt_buffer_t *out,
+                                       mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
 #endif /* MONGOCRYPT_CRYPTO_PRIVATE_H */
@@ -21,19 +21,55 @@
 
 #include <bson/bson.h>
 
+#include "mlib/thread.h"
+
 #include "mongocrypt-binary-private.h"
 #include "mongocrypt-buffer-private.h"
 #include "mongocrypt-crypto-private.h"
 #include "mongocrypt-log-private.h"
+#include "mongocrypt-mutex-private.h"
 #include "mongocrypt-private.h"
 #include "mongocrypt-status-private.h"
 
 #include <inttypes.h>
 
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+static mlib_once_flag _native_crypto_init_flag = MLIB_ONCE_INITIALIZER;
+
+bool _native_crypto_ensure_init(mongocrypt_status_t *status) {
+    if (!mlib_call_once(&_native_crypto_init_flag, _native_crypto_init) || !_native_crypto_initialized) {
+        CLIENT_ERR("failed to initialize native crypto");
+        return false;
+    }
+    return true;
+}
+
+/* Maximum number of counter blocks passed to one ECB callback. */
+#define CTR_VIA_ECB_MAX_BLOCKS 256
+
+/* Increments the big-endian counter @ctr. */
+static void _ctr_increment(uint8_t *ctr, uint32_t len) {
+    uint32_t carry = 1;
+    /* assert rather than return since this should never happen */
+    BSON_ASSERT(len == 0u || len - 1u <= INT_MAX);
+    for (int i = (int)len - 1; i >= 0 && carry != 0; --i) {
+        uint32_t bpp = carry + ctr[i];
+        carry = bpp >> 8;
+        ctr[i] = bpp & 0xFF;
+    }
+}
+
 /* This function uses ECB callback to simulate CTR encrypt and decrypt
  *
  * Note: the same function performs both encrypt and decrypt using same ECB
  * encryption function
+ *
+ * Consecutive counter blocks are encrypted together, so the callback is called
+ * once per CTR_VIA_ECB_MAX_BLOCKS blocks instead of once per block, and the ECB
+ * implementation can process several blocks in parallel.
  */
 
 static bool _crypto_aes_256_ctr_encrypt_decrypt_via_ecb(void *ctx,
@@ -49,28 +85,48 @@ static bool _crypto_aes_256_ctr_encrypt_decrypt_via_ecb(void *ctx,
         return false;
     }
 
-    _mongocrypt_buffer_t ctr, tmp;
-    mongocrypt_binary_t key_bin, out_bin, in_bin, ctr_bin, tmp_bin;
+    const uint32_t block_len = args.iv->len;
+    const uint32_t in_blocks = args.in->len / block_len + (args.in->len % block_len ? 1u : 0u);
+    const uint32_t max_blocks = in_blocks < CTR_VIA_ECB_MAX_BLOCKS ? in_blocks : CTR_VIA_ECB_MAX_BLOCKS;
+    _mongocrypt_buffer_t ctr, ctrs, stream;
+    uint8_t ctr_storage[MONGOCRYPT_BUFFER_SMALL_LEN];
+    mongocrypt_binary_t key_bin;
     bool ret;
 
+    BSON_ASSERT(max_blocks <= UINT32_MAX / block_len);
+
     _mongocrypt_buffer_to_binary(args.key, &key_bin);
-    _mongocrypt_buffer_init(&ctr);
-    _mongocrypt_buffer_copy_to(args.iv, &ctr);
-    _mongocrypt_buffer_to_binary(&ctr, &ctr_bin);
-    _mongocrypt_buffer_to_binary(args.out, &out_bin);
-    _mongocrypt_buffer_to_binary(args.in, &in_bin);
-    _mongocrypt_buffer_init_size(&tmp, args.iv->len);
-    _mongocrypt_buffer_to_binary(&tmp, &tmp_bin);
+    _mongocrypt_buffer_init_size_small(&ctr, args.iv->len, ctr_storage);
+    memcpy(ctr.data, args.iv->data, args.iv->len);
+    _mongocrypt_buffer_init_size(&ctrs, max_blocks * block_len);
+    _mongocrypt_buffer_init_size(&stream, max_blocks * block_len);
 
     for (uint32_t ptr = 0; ptr < args.in->len;) {
-        /* Encrypt value in CTR buffer */
+        const uint32_t remaining = args.in->len - ptr;
+        uint32_t nblocks = remaining / block_len + (remaining % block_len ? 1u : 0u);
+        if (nblocks > max_blocks) {
+            nblocks = max_blocks;
+        }
+
+        /* Lay out consecutive values of the CTR buffer */
+        for (uint32_t b = 0; b < nblocks; b++) {
+            memcpy(ctrs.data + b * block_len, ctr.data, block_len);
+            _ctr_increment(ctr.data, ctr.len);
+        }
+
+        mongocrypt_binary_t ctrs_bin, stream_bin;
+        _mongocrypt_buffer_to_binary(&ctrs, &ctrs_bin);
+        _mongocrypt_buffer_to_binary(&stream, &stream_bin);
+        ctrs_bin.len = stream_bin.len = nblocks * block_len;
+
+        /* Encrypt the CTR values */
         uint32_t bytes_written = 0;
-        if (!aes_256_ecb_encrypt(ctx, &key_bin, NULL, &ctr_bin, &tmp_bin, &bytes_written, status)) {
+        if (!aes_256_ecb_encrypt(ctx, &key_bin, NULL, &ctrs_bin, &stream_bin, &bytes_written, status)) {
             ret = false;
             goto cleanup;
         }
 
-        if (bytes_written != tmp_bin.len) {
+        if (bytes_written != stream_bin.len) {
             CLIENT_ERR("encryption hook returned unexpected length");
             ret = false;
             goto cleanup;
@@ -78,21 +134,7 @@ static bool _crypto_aes_256_ctr_encrypt_decrypt_via_ecb(void *ctx,
 
         /* XOR resulting stream with original data */
         for (uint32_t i = 0; i < bytes_written && ptr < args.in->len; i++, ptr++) {
-            uint8_t *in_bin_u8 = in_bin.data;
-            uint8_t *out_bin_u8 = out_bin.data;
-            uint8_t *tmp_bin_u8 = tmp_bin.data;
-            out_bin_u8[ptr] = in_bin_u8[ptr] ^ tmp_bin_u8[i];
-        }
-
-        /* Increment value in CTR buffer */
-        uint32_t carry = 1;
-        /* assert rather than return since this should never happen */
-        BSON_ASSERT(ctr_bin.len == 0u || ctr_bin.len - 1u <= INT_MAX);
-        for (int i = (int)ctr_bin.len - 1; i >= 0 && carry != 0; --i) {
-            uint8_t *ctr_bin_u8 = ctr_bin.data;
-            uint32_t bpp = carry + ctr_bin_u8[i];
-            carry = bpp >> 8;
-            ctr_bin_u8[i] = bpp & 0xFF;
+            args.out->data[ptr] = args.in->data[ptr] ^ stream.data[i];
         }
     }
 
@@ -104,7 +146,8 @@ static bool _crypto_aes_256_ctr_encrypt_decrypt_via_ecb(void *ctx,
 
 cleanup:
     _mongocrypt_buffer_cleanup(&ctr);
-    _mongocrypt_buffer_cleanup(&tmp);
+    _mongocrypt_buffer_cleanup(&ctrs);
+    _mongocrypt_buffer_cleanup(&stream);
     return ret;
 }
 
@@ -127,7 +170,7 @@ static bool _crypto_aes_256_cbc_encrypt(_mongocrypt_crypto_t *crypto, aes_256_ar
         return false;
     }
 
-    if (crypto->hooks_enabled) {
+    if (MONGOCRYPT_CRYPTO_HOOKS_ENABLED(crypto)) {
         mongocrypt_binary_t enc_key_bin, iv_bin, out_bin, in_bin;
         bool ret;
 
@@ -145,6 +188,9 @@ static bool _crypto_aes_256_cbc_encrypt(_mongocrypt_crypto_t *crypto, aes_256_ar
                                           status);
         return ret;
     }
+    if (!_native_crypto_ensure_init(status)) {
+        return false;
+    }
     return _native_crypto_aes_256_cbc_encrypt(args);
 }
 
@@ -165,7 +211,7 @@ static bool _crypto_aes_256_ctr_encrypt(_mongocrypt_crypto_t *crypto, aes_256_ar
         return false;
     }
 
-    if (crypto->aes_256_ctr_encrypt) {
+    if (MONGOCRYPT_CRYPTO_HAS_HOOK(crypto, aes_256_ctr_encrypt)) {
         mongocrypt_binary_t enc_key_bin, iv_bin, out_bin, in_bin;
         bool ret;
 
@@ -184,10 +230,13 @@ static bool _crypto_aes_256_ctr_encrypt(_mongocrypt_crypto_t *crypto, aes_256_ar
         return ret;
     }
 
-    if (crypto->aes_256_ecb_encrypt) {
+    if (MONGOCRYPT_CRYPTO_HAS_HOOK(crypto, aes_256_ecb_encrypt)) {
         return _crypto_aes_256_ctr_encrypt_decrypt_via_ecb(crypto->ctx, crypto->aes_256_ecb_encrypt, args, status);
     }
 
+    if (!_native_crypto_ensure_init(status)) {
+        return false;
+    }
     return _native_crypto_aes_256_ctr_encrypt(args);
 }
 
@@ -202,7 +251,7 @@ static bool _crypto_aes_256_cbc_decrypt(_mongocrypt_crypto_t *crypto, aes_256_ar
         return false;
     }
 
-    if (crypto->hooks_enabled) {
+    if (MONGOCRYPT_CRYPTO_HOOKS_ENABLED(crypto)) {
         mongocrypt_binary_t enc_key_bin, iv_bin, out_bin, in_bin;
         bool ret;
 
@@ -220,6 +269,9 @@ static bool _crypto_aes_256_cbc_decrypt(_mongocrypt_crypto_t *crypto, aes_256_ar
                                           status);
         return ret;
     }
+    if (!_native_crypto_ensure_init(status)) {
+        return false;
+    }
     return _native_crypto_aes_256_cbc_decrypt(args);
 }
 
@@ -234,7 +286,7 @@ static bool _crypto_aes_256_ctr_decrypt(_mongocrypt_crypto_t *crypto, aes_256_ar
         return false;
     }
 
-    if (crypto->aes_256_ctr_decrypt) {
+    if (MONGOCRYPT_CRYPTO_HAS_HOOK(crypto, aes_256_ctr_decrypt)) {
         mongocrypt_binary_t enc_key_bin, iv_bin, out_bin, in_bin;
         bool ret;
 
@@ -253,10 +305,13 @@ static bool _crypto_aes_256_ctr_decrypt(_mongocrypt_crypto_t *crypto, aes_256_ar
         return ret;
     }
 
-    if (crypto->aes_256_ecb_encrypt) {
+    if (MONGOCRYPT_CRYPTO_HAS_HOOK(crypto, aes_256_ecb_encrypt)) {
         return _crypto_aes_256_ctr_encrypt_decrypt_via_ecb(crypto->ctx, crypto->aes_256_ecb_encrypt, args, status);
     }
 
+    if (!_native_crypto_ensure_init(status)) {
+        return false;
+    }
     return _native_crypto_aes_256_ctr_decrypt(args);
 }
 
@@ -280,7 +335,7 @@ static bool _crypto_hmac_sha_512(_mongocrypt_crypto_t *crypto,
         return false;
     }
 
-    if (crypto->hooks_enabled) {
+    if (MONGOCRYPT_CRYPTO_HOOKS_ENABLED(crypto)) {
         mongocrypt_binary_t hmac_key_bin, out_bin, in_bin;
         bool ret;
 
@@ -291,6 +346,9 @@ static bool _crypto_hmac_sha_512(_mongocrypt_crypto_t *crypto,
         ret = crypto->hmac_sha_512(crypto->ctx, &hmac_key_bin, &in_bin, &out_bin, status);
         return ret;
     }
+    if (!_native_crypto_ensure_init(status)) {
+        return false;
+    }
     return _native_crypto_hmac_sha_512(hmac_key, in, out, status);
 }
 
@@ -311,7 +369,7 @@ bool _mongocrypt_hmac_sha_256(_mongocrypt_crypto_t *crypto,
         return false;
     }
 
-    if (crypto->hooks_enabled) {
+    if (MONGOCRYPT_CRYPTO_HOOKS_ENABLED(crypto)) {
         mongocrypt_binary_t key_bin, out_bin, in_bin;
         _mongocrypt_buffer_to_binary(key, &key_bin);
         _mongocrypt_buffer_to_binary(out, &out_bin);
@@ -319,9 +377,164 @@ bool _mongocrypt_hmac_sha_256(_mongocrypt_crypto_t *crypto,
 
         return crypto->hmac_sha_256(crypto->ctx, &key_bin, &in_bin, &out_bin, status);
     }
+    if (!_native_crypto_ensure_init(status)) {
+        return false;
+    }
     return _native_crypto_hmac_sha_256(key, in, out, status);
 }
 
+bool _mongocrypt_hmac_sha_256_batch(_mongocrypt_crypto_t *crypto,
+                                    const _mongocrypt_buffer_t **keys,
+                                    const _mongocrypt_buffer_t **ins,
+                                    _mongocrypt_buffer_t *outs,
+                                    uint32_t count,
+                                    mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(crypto);
+    BSON_ASSERT(keys || count == 0);
+    BSON_ASSERT(ins || count == 0);
+    BSON_ASSERT(outs || count == 0);
+
+    BSON_ASSERT(count <= UINT32_MAX / 3u);
+
+    for (uint32_t i = 0; i < count; i++) {
+        _mongocrypt_buffer_init_size(&outs[i], MONGOCRYPT_HMAC_SHA256_LEN);
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        BSON_ASSERT(keys[i]);
+        BSON_ASSERT(ins[i]);
+        if (keys[i]->len != MONGOCRYPT_MAC_KEY_LEN) {
+            CLIENT_ERR("invalid hmac_sha_256 key length. Got %" PRIu32 ", expected: %" PRIu32,
+                       keys[i]->len,
+                       MONGOCRYPT_MAC_KEY_LEN);
+            return false;
+        }
+    }
+
+    if (!MONGOCRYPT_CRYPTO_HOOKS_ENABLED(crypto) || !MONGOCRYPT_CRYPTO_HAS_HOOK(crypto, hmac_sha_256_batch)) {
+        for (uint32_t i = 0; i < count; i++) {
+            if (!_mongocrypt_hmac_sha_256(crypto, keys[i], ins[i], &outs[i], status)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    if (count == 0) {
+        return true;
+    }
+
+    bool ret;
+    mongocrypt_binary_t *bins = bson_malloc0(3u * count * sizeof(mongocrypt_binary_t));
+    mongocrypt_binary_t **ptrs = bson_malloc0(3u * count * sizeof(mongocrypt_binary_t *));
+    BSON_ASSERT(bins);
+    BSON_ASSERT(ptrs);
+
+    /* ptrs is laid out as [keys][ins][outs]. */
+    for (uint32_t i = 0; i < count; i++) {
+        _mongocrypt_buffer_to_binary(keys[i], &bins[i]);
+        _mongocrypt_buffer_to_binary(ins[i], &bins[count + i]);
+        _mongocrypt_buffer_to_binary(&outs[i], &bins[2u * count + i]);
+        ptrs[i] = &bins[i];
+        ptrs[count + i] = &bins[count + i];
+        ptrs[2u * count + i] = &bins[2u * count + i];
+    }
+
+    ret = crypto->hmac_sha_256_batch(crypto->ctx, ptrs, ptrs + count, ptrs + 2u * count, count, status);
+    bson_free(ptrs);
+    bson_free(bins);
+    return ret;
+}
+
+struct _mongocrypt_random_pool_t {
+    mongocrypt_mutex_t mutex;
+    uint8_t data[MONGOCRYPT_RANDOM_POOL_LEN];
+    /* Bytes before offset have been served and zeroed. */
+    uint32_t offset;
+#ifndef _WIN32
+    /* The process that filled the pool. A forked child must not reuse the
+     * parent's random bytes. */
+    pid_t pid;
+#endif
+};
+
+_mongocrypt_random_pool_t *_mongocrypt_random_pool_new(void) {
+    _mongocrypt_random_pool_t *pool = bson_malloc0(sizeof(*pool));
+    BSON_ASSERT(pool);
+
+    _mongocrypt_mutex_init(&pool->mutex);
+    /* Empty. Filled on first use. */
+    pool->offset = MONGOCRYPT_RANDOM_POOL_LEN;
+    return pool;
+}
+
+void _mongocrypt_random_pool_destroy(_mongocrypt_random_pool_t *pool) {
+    if (!pool) {
+        return;
+    }
+
+    _mongocrypt_mutex_cleanup(&pool->mutex);
+    bson_free(pool);
+}
+
+#ifndef _WIN32
+void _mongocrypt_random_pool_atfork_child(_mongocrypt_random_pool_t *pool) {
+    if (!pool) {
+        return;
+    }
+
+    _mongocrypt_mutex_init(&pool->mutex);
+    memset(pool->data, 0, sizeof(pool->data));
+    pool->offset = MONGOCRYPT_RANDOM_POOL_LEN;
+}
+#endif
+
+/* Copies @count bytes from @pool into @out, refilling @pool from the native
+ * random source when it is empty or was filled by another process. */
+static bool _random_pool_read(_mongocrypt_random_pool_t *pool,
+                              _mongocrypt_buffer_t *out,
+                              uint32_t count,
+                              mongocrypt_status_t *status) {
+    bool ret = false;
+
+    BSON_ASSERT_PARAM(pool);
+    BSON_ASSERT_PARAM(out);
+    BSON_ASSERT(count <= MONGOCRYPT_RANDOM_POOL_MAX_REQUEST);
+    BSON_ASSERT(out->len >= count);
+
+    _mongocrypt_mutex_lock(&pool->mutex);
+    bool refill = MONGOCRYPT_RANDOM_POOL_LEN - pool->offset < count;
+#ifndef _WIN32
+    const pid_t pid = getpid();
+    refill = refill || pool->pid != pid;
+#endif
+    if (refill) {
+        _mongocrypt_buffer_t fill;
+
+        _mongocrypt_buffer_init(&fill);
+        fill.data = pool->data;
+        fill.len = MONGOCRYPT_RANDOM_POOL_LEN;
+        if (!_native_crypto_random(&fill, MONGOCRYPT_RANDOM_POOL_LEN, status)) {
+            memset(pool->data, 0, sizeof(pool->data));
+            pool->offset = MONGOCRYPT_RANDOM_POOL_LEN;
+            goto done;
+        }
+        pool->offset = 0;
+#ifndef _WIN32
+        pool->pid = pid;
+#endif
+    }
+
+    memcpy(out->data, pool->data + pool->offset, count);
+    /* Never serve the same bytes twice. */
+    memset(pool->data + pool->offset, 0, count);
+    pool->offset += count;
+    ret = true;
+done:
+    _mongocrypt_mutex_unlock(&pool->mutex);
+    return ret;
+}
+
 static bool
 _crypto_random(_mongocrypt_crypto_t *crypto, _mongocrypt_buffer_t *out, uint32_t count, mongocrypt_status_t *status) {
     BSON_ASSERT_PARAM(crypto);
@@ -332,12 +545,22 @@ _crypto_random(_mongocrypt_crypto_t *crypto, _mongocrypt_buffer_t *out, uint32_t
         return false;
     }
 
-    if (crypto->hooks_enabled) {
+    if (MONGOCRYPT_CRYPTO_HOOKS_ENABLED(crypto)) {
         mongocrypt_binary_t out_bin;
 
         _mongocrypt_buffer_to_binary(out, &out_bin);
         return crypto->random(crypto->ctx, &out_bin, count, status);
     }
+
+    if (!_native_crypto_ensure_init(status)) {
+        return false;
+    }
+
+    /* Small requests (IVs, UUIDs) are frequent. Serve them from a pool filled
+     * several KB at a time. */
+    if (crypto->random_pool && count <= MONGOCRYPT_RANDOM_POOL_MAX_REQUEST) {
+        return _random_pool_read(crypto->random_pool, out, count, status);
+    }
     return _native_crypto_random(out, count, status);
 }
 
@@ -525,54 +748,82 @@ static bool _encrypt_step(_mongocrypt_crypto_t *crypto,
 
     /* calculate how many extra bytes there are after a block boundary */
     const uint32_t unaligned = plaintext->len % MONGOCRYPT_BLOCK_SIZE;
+    const uint32_t aligned_len = plaintext->len - unaligned;
     uint32_t padding_byte = MONGOCRYPT_BLOCK_SIZE - unaligned;
-    _mongocrypt_buffer_t intermediates[2], to_encrypt;
     uint8_t final_block_storage[MONGOCRYPT_BLOCK_SIZE];
-    bool ret;
+    _mongocrypt_buffer_t final_block = {.data = final_block_storage, .len = sizeof(final_block_storage)};
+    _mongocrypt_buffer_t chain_iv, in, out;
+    uint32_t written = 0;
 
     BSON_ASSERT(MONGOCRYPT_BLOCK_SIZE >= unaligned);
 
+    if (ciphertext->len < aligned_len + MONGOCRYPT_BLOCK_SIZE) {
+        CLIENT_ERR("output ciphertext too small");
+        return false;
+    }
+
     /* Some crypto providers disallow variable length inputs, and require
-     * the input to be a multiple of the block size. So add everything up
-     * to but excluding the last block if not block aligned, then add
-     * the last block with padding. */
-    _mongocrypt_buffer_init(&intermediates[0]);
-    _mongocrypt_buffer_init(&intermediates[1]);
-    intermediates[0].data = (uint8_t *)plaintext->data;
-    /* don't check plaintext->len, as the above modulo operation guarantees
-     * that unaligned will be smaller */
-    intermediates[0].len = plaintext->len - unaligned;
-    intermediates[1].data = final_block_storage;
-    intermediates[1].len = sizeof(final_block_storage);
+     * the input to be a multiple of the block size. So encrypt everything up
+     * to but excluding the last block if not block aligned, then the last
+     * block with padding. The prefix is encrypted in place from the plaintext,
+     * and CBC chains from its last ciphertext block, so the plaintext is not
+     * copied to be padded. */
+    if (!_mongocrypt_buffer_from_subrange(&chain_iv, iv, 0, iv->len)) {
+        CLIENT_ERR("unable to create IV subrange");
+        return false;
+    }
+    if (aligned_len > 0) {
+        if (!_mongocrypt_buffer_from_subrange(&in, plaintext, 0, aligned_len)) {
+            CLIENT_ERR("unable to create plaintext subrange");
+            return false;
+        }
+        if (!_crypto_aes_256_cbc_encrypt(crypto,
+                                         (aes_256_args_t){.key = enc_key,
+                                                          .iv = &chain_iv,
+                                                          .in = &in,
+                                                          .out = ciphertext,
+                                                          .bytes_written = &written,
+                                                          .status = status})) {
+            return false;
+        }
+        if (written != aligned_len) {
+            CLIENT_ERR("encryption failure, wrote %d bytes, expected %d", written, aligned_len);
+            return false;
+        }
+        if (!_mongocrypt_buffer_from_subrange(&chain_iv,
+                                              ciphertext,
+                                              aligned_len - MONGOCRYPT_BLOCK_SIZE,
+                                              MONGOCRYPT_BLOCK_SIZE)) {
+            CLIENT_ERR("unable to create IV subrange from ciphertext");
+            return false;
+        }
+    }
 
     /* [MCGREW]: "Prior to CBC encryption, the plaintext P is padded by appending
      * a padding string PS to that data, to ensure that len(P || PS) is a
      * multiple of 128". This is also known as PKCS #7 padding. */
     if (unaligned) {
         /* Copy the unaligned bytes. */
-        memcpy(intermediates[1].data, plaintext->data + (plaintext->len - unaligned), unaligned);
+        memcpy(final_block.data, plaintext->data + aligned_len, unaligned);
     }
     /* Fill out block remained or whole block with padding_byte */
-    memset(intermediates[1].data + unaligned, (int)padding_byte, padding_byte);
+    memset(final_block.data + unaligned, (int)padding_byte, padding_byte);
 
-    _mongocrypt_buffer_init(&to_encrypt);
-    if (!_mongocrypt_buffer_concat(&to_encrypt, intermediates, 2)) {
-        CLIENT_ERR("failed to allocate buffer");
-        _mongocrypt_buffer_cleanup(&to_encrypt);
+    if (!_mongocrypt_buffer_from_subrange(&out, ciphertext, aligned_len, ciphertext->len - aligned_len)) {
+        CLIENT_ERR("unable to create ciphertext subrange");
         return false;
     }
-
-    ret = _crypto_aes_256_cbc_encrypt(crypto,
-                                      (aes_256_args_t){.key = enc_key,
-                                                       .iv = iv,
-                                                       .in = &to_encrypt,
-                                                       .out = ciphertext,
-                                                       .bytes_written = bytes_written,
-                                                       .status = status});
-    _mongocrypt_buffer_cleanup(&to_encrypt);
-    if (!ret) {
+    written = 0;
+    if (!_crypto_aes_256_cbc_encrypt(crypto,
+                                     (aes_256_args_t){.key = enc_key,
+                                                      .iv = &chain_iv,
+                                                      .in = &final_block,
+                                                      .out = &out,
+                                                      .bytes_written = &written,
+                                                      .status = status})) {
         return false;
     }
+    *bytes_written = aligned_len + written;
 
     if (*bytes_written % MONGOCRYPT_BLOCK_SIZE != 0) {
         CLIENT_ERR("encryption failure, wrote %d bytes, not a multiple of %d", *bytes_written, MONGOCRYPT_BLOCK_SIZE);
@@ -582,6 +833,9 @@ static bool _encrypt_step(_mongocrypt_crypto_t *crypto,
     return true;
 }
 
+/* HMAC inputs up to this length are joined on the stack for crypto hooks. */
+#define HMAC_STEP_STACK_LEN 256
+
 /* ----------------------------------------------------------------------------
  *
  * _hmac_step --
@@ -673,8 +927,32 @@ static bool _hmac_step(_mongocrypt_crypto_t *crypto,
         BSON_ASSERT((mac_format == MAC_FORMAT_FLE2AEAD) || (mac_format == MAC_FORMAT_FLE2v2AEAD));
     }
 
-    if (!_mongocrypt_buffer_concat(&to_hmac, intermediates, num_intermediates)) {
-        CLIENT_ERR("failed to allocate buffer");
+    // Hooks take one contiguous input. Native crypto hashes the parts where
+    // they are, so the ciphertext is not copied. Inputs of small values are
+    // joined on the stack.
+    const bool concat = MONGOCRYPT_CRYPTO_HOOKS_ENABLED(crypto);
+    uint8_t to_hmac_storage[HMAC_STEP_STACK_LEN];
+    if (concat) {
+        uint64_t total = 0;
+        for (uint32_t i = 0; i < num_intermediates; i++) {
+            total += intermediates[i].len;
+        }
+        if (total <= sizeof(to_hmac_storage)) {
+            uint32_t offset = 0;
+            for (uint32_t i = 0; i < num_intermediates; i++) {
+                if (intermediates[i].len) {
+                    memcpy(to_hmac_storage + offset, intermediates[i].data, intermediates[i].len);
+                }
+                offset += intermediates[i].len;
+            }
+            to_hmac.data = to_hmac_storage;
+            to_hmac.len = offset;
+        } else if (!_mongocrypt_buffer_concat(&to_hmac, intermediates, num_intermediates)) {
+            CLIENT_ERR("failed to allocate buffer");
+            goto done;
+        }
+    }
+    if (!concat && !_native_crypto_ensure_init(status)) {
         goto done;
     }
 
@@ -682,7 +960,8 @@ static bool _hmac_step(_mongocrypt_crypto_t *crypto,
         uint8_t storage[64];
         _mongocrypt_buffer_t tag = {.data = storage, .len = sizeof(storage)};
 
-        if (!_crypto_hmac_sha_512(crypto, Km, &to_hmac, &tag, status)) {
+        if (concat ? !_crypto_hmac_sha_512(crypto, Km, &to_hmac, &tag, status)
+                   : !_native_crypto_hmac_sha_512_parts(Km, intermediates, num_intermediates, &tag, status)) {
             goto done;
         }
 
@@ -691,7 +970,8 @@ static bool _hmac_step(_mongocrypt_crypto_t *crypto,
 
     } else {
         BSON_ASSERT(hmac == HMAC_SHA_256);
-        if (!_mongocrypt_hmac_sha_256(crypto, Km, &to_hmac, out, status)) {
+        if (concat ? !_mongocrypt_hmac_sha_256(crypto, Km, &to_hmac, out, status)
+                   : !_native_crypto_hmac_sha_256_parts(Km, intermediates, num_intermediates, out, status)) {
             goto done;
         }
     }
@@ -1290,6 +1570,7 @@ bool _mongocrypt_wrap_key(_mongocrypt_crypto_t *crypto,
     const _mongocrypt_value_encryption_algorithm_t *fle1alg = _mcFLE1Algorithm();
     uint32_t bytes_written;
     _mongocrypt_buffer_t iv = {0};
+    uint8_t iv_storage[MONGOCRYPT_BUFFER_SMALL_LEN];
     bool ret = false;
 
     BSON_ASSERT_PARAM(crypto);
@@ -1308,7 +1589,7 @@ bool _mongocrypt_wrap_key(_mongocrypt_crypto_t *crypto,
 
     // _mongocrypt_wrap_key() uses FLE1 algorithm parameters.
     _mongocrypt_buffer_resize(encrypted_dek, fle1alg->get_ciphertext_len(dek->len, status));
-    _mongocrypt_buffer_resize(&iv, MONGOCRYPT_IV_LEN);
+    _mongocrypt_buffer_init_size_small(&iv, MONGOCRYPT_IV_LEN, iv_storage);
 
     if (!_mongocrypt_random(crypto, &iv, MONGOCRYPT_IV_LEN, status)) {
         goto done;
@@ -1377,8 +1658,8 @@ bool _mongocrypt_random_uint64(_mongocrypt_crypto_t *crypto,
     uint64_t min = (0 - exclusive_upper_bound) % exclusive_upper_bound;
 
     _mongocrypt_buffer_t rand_u64_buf;
-    _mongocrypt_buffer_init(&rand_u64_buf);
-    _mongocrypt_buffer_resize(&rand_u64_buf, (uint32_t)sizeof(uint64_t));
+    uint8_t rand_u64_storage[MONGOCRYPT_BUFFER_SMALL_LEN];
+    _mongocrypt_buffer_init_size_small(&rand_u64_buf, (uint32_t)sizeof(uint64_t), rand_u64_storage);
 
     uint64_t rand_u64;
     for (;;) {
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mongocrypt-ctx-private.h"
+
+static bool _fail_from_dkctx(mongocrypt_ctx_t *ctx, mongocrypt_ctx_t *dkctx) {
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(dkctx);
+
+    _mongocrypt_status_copy_to(dkctx->status, ctx->status);
+    return _mongocrypt_ctx_fail(ctx);
+}
+
+/* Moves @ctx to MONGOCRYPT_CTX_NEED_KMS if any datakey context needs a KMS
+ * request, and otherwise to MONGOCRYPT_CTX_READY. */
+static void _state_from_dkctxs(mongocrypt_ctx_t *ctx) {
+    _mongocrypt_ctx_datakey_batch_t *const dkbctx = (_mongocrypt_ctx_datakey_batch_t *)ctx;
+
+    BSON_ASSERT_PARAM(ctx);
+
+    dkbctx->kms_next = 0u;
+    for (uint32_t i = 0u; i < dkbctx->count; i++) {
+        if (dkbctx->dkctxs[i]->state == MONGOCRYPT_CTX_NEED_KMS) {
+            ctx->state = MONGOCRYPT_CTX_NEED_KMS;
+            return;
+        }
+    }
+    ctx->state = MONGOCRYPT_CTX_READY;
+}
+
+static bool _finalize(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
+    _mongocrypt_ctx_datakey_batch_t *const dkbctx = (_mongocrypt_ctx_datakey_batch_t *)ctx;
+    bson_t doc = BSON_INITIALIZER;
+    bson_t array;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(out);
+
+    BSON_ASSERT(BSON_APPEND_ARRAY_BEGIN(&doc, "v", &array));
+    for (uint32_t i = 0u; i < dkbctx->count; i++) {
+        mongocrypt_binary_t bin;
+        bson_t key_doc;
+        char storage[16];
+        const char *key;
+
+        if (!mongocrypt_ctx_finalize(dkbctx->dkctxs[i], &bin)) {
+            BSON_ASSERT(bson_append_array_end(&doc, &array));
+            bson_destroy(&doc);
+            return _fail_from_dkctx(ctx, dkbctx->dkctxs[i]);
+        }
+
+        BSON_ASSERT(bson_init_static(&key_doc, bin.data, bin.len));
+        bson_uint32_to_string(i, &key, storage, sizeof(storage));
+        BSON_ASSERT(bson_append_document(&array, key, -1, &key_doc));
+    }
+    BSON_ASSERT(bson_append_array_end(&doc, &array));
+
+    _mongocrypt_buffer_steal_from_bson(&dkbctx->results, &doc);
+    _mongocrypt_buffer_to_binary(&dkbctx->results, out);
+    ctx->state = MONGOCRYPT_CTX_DONE;
+    return true;
+}
+
+/* Returns the KMS requests of every datakey context in turn, so all of a
+ * round's requests can be sent concurrently. */
+static mongocrypt_kms_ctx_t *_next_kms_ctx(mongocrypt_ctx_t *ctx) {
+    _mongocrypt_ctx_datakey_batch_t *const dkbctx = (_mongocrypt_ctx_datakey_batch_t *)ctx;
+
+    BSON_ASSERT_PARAM(ctx);
+
+    while (dkbctx->kms_next < dkbctx->count) {
+        mongocrypt_ctx_t *const dkctx = dkbctx->dkctxs[dkbctx->kms_next];
+
+        if (dkctx->state == MONGOCRYPT_CTX_NEED_KMS) {
+            mongocrypt_kms_ctx_t *const kms = mongocrypt_ctx_next_kms_ctx(dkctx);
+
+            if (kms) {
+                return kms;
+            }
+        }
+        dkbctx->kms_next++;
+    }
+    return NULL;
+}
+
+static bool _kms_done(mongocrypt_ctx_t *ctx) {
+    _mongocrypt_ctx_datakey_batch_t *const dkbctx = (_mongocrypt_ctx_datakey_batch_t *)ctx;
+
+    BSON_ASSERT_PARAM(ctx);
+
+    for (uint32_t i = 0u; i < dkbctx->count; i++) {
+        mongocrypt_ctx_t *const dkctx = dkbctx->dkctxs[i];
+
+        if (dkctx->state == MONGOCRYPT_CTX_NEED_KMS && !mongocrypt_ctx_kms_done(dkctx)) {
+            return _fail_from_dkctx(ctx, dkctx);
+        }
+    }
+
+    /* Some providers may require multiple rounds of KMS requests. */
+    _state_from_dkctxs(ctx);
+    return true;
+}
+
+static bool _kms_start(mongocrypt_ctx_t *ctx) {
+    _mongocrypt_ctx_datakey_batch_t *const dkbctx = (_mongocrypt_ctx_datakey_batch_t *)ctx;
+
+    BSON_ASSERT_PARAM(ctx);
+
+    /* Reuse the KMS credentials provided to the batch context. */
+    for (uint32_t i = 0u; i < dkbctx->count; i++) {
+        mongocrypt_ctx_t *const dkctx = dkbctx->dkctxs[i];
+
+        if (dkctx->state != MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS) {
+            continue;
+        }
+        memcpy(&dkctx->kms_providers, _mongocrypt_ctx_kms_providers(ctx), sizeof(_mongocrypt_opts_kms_providers_t));
+        if (!dkctx->vtable.after_kms_credentials_provided(dkctx)) {
+            return _fail_from_dkctx(ctx, dkctx);
+        }
+    }
+
+    _state_from_dkctxs(ctx);
+    return true;
+}
+
+static void _cleanup(mongocrypt_ctx_t *ctx) {
+    _mongocrypt_ctx_datakey_batch_t *const dkbctx = (_mongocrypt_ctx_datakey_batch_t *)ctx;
+
+    BSON_ASSERT_PARAM(ctx);
+
+    for (uint32_t i = 0u; i < dkbctx->count; i++) {
+        mongocrypt_ctx_destroy(dkbctx->dkctxs[i]);
+    }
+    bson_free(dkbctx->dkctxs);
+    _mongocrypt_buffer_cleanup(&dkbctx->results);
+}
+
+bool mongocrypt_ctx_datakey_batch_init(mongocrypt_ctx_t *ctx, uint32_t count) {
+    _mongocrypt_ctx_datakey_batch_t *const dkbctx = (_mongocrypt_ctx_datakey_batch_t *)ctx;
+    _mongocrypt_ctx_opts_spec_t opts_spec;
+
+    if (!ctx) {
+        return false;
+    }
+
+    memset(&opts_spec, 0, sizeof(opts_spec));
+    opts_spec.kek = OPT_REQUIRED;
+
+    if (!_mongocrypt_ctx_init(ctx, &opts_spec)) {
+        return false;
+    }
+
+    ctx->type = _MONGOCRYPT_TYPE_CREATE_DATA_KEY_BATCH;
+    ctx->vtable.mongo_op_keys = NULL;
+    ctx->vtable.mongo_feed_keys = NULL;
+    ctx->vtable.mongo_done_keys = NULL;
+    ctx->vtable.next_kms_ctx = _next_kms_ctx;
+    ctx->vtable.after_kms_credentials_provided = _kms_start;
+    ctx->vtable.kms_done = _kms_done;
+    ctx->vtable.finalize = _finalize;
+    ctx->vtable.cleanup = _cleanup;
+
+    if (count == 0u) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "count must be greater than 0");
+    }
+
+    /* Each key gets its own key material and KMS request from a datakey
+     * context. They are driven together by this context. */
+    dkbctx->dkctxs = bson_malloc0(sizeof(mongocrypt_ctx_t *) * count);
+    for (uint32_t i = 0u; i < count; i++) {
+        mongocrypt_ctx_t *const dkctx = mongocrypt_ctx_new(ctx->crypt);
+
+        dkbctx->dkctxs[i] = dkctx;
+        dkbctx->count = i + 1u;
+        _mongocrypt_kek_copy_to(&ctx->opts.kek, &dkctx->opts.kek);
+        if (!mongocrypt_ctx_datakey_init(dkctx)) {
+            return _fail_from_dkctx(ctx, dkctx);
+        }
+    }
+
+    if (_mongocrypt_needs_credentials_for_provider(ctx->crypt, ctx->opts.kek.kms_provider, ctx->opts.kek.kmsid_name)) {
+        ctx->state = MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS;
+        return true;
+    }
+
+    _state_from_dkctxs(ctx);
+    return true;
+}
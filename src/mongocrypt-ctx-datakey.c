@@ -41,7 +41,10 @@ static mongocrypt_kms_ctx_t *_next_kms_ctx(mongocrypt_ctx_t *ctx) {
 
     dkctx = (_mongocrypt_ctx_datakey_t *)ctx;
     if (dkctx->kms_returned) {
-        return NULL;
+        if (!dkctx->kms.should_retry) {
+            return NULL;
+        }
+        dkctx->kms.should_retry = false;
     }
     dkctx->kms_returned = true;
     return &dkctx->kms;
@@ -370,6 +373,11 @@ static bool _kms_done(mongocrypt_ctx_t *ctx) {
         return _mongocrypt_ctx_fail_w_msg(ctx, "KMS response unfinished");
     }
 
+    if (dkctx->kms.should_retry) {
+        /* Remain in MONGOCRYPT_CTX_NEED_KMS until the retried request completes. */
+        return true;
+    }
+
     /* If this was an oauth request, store the response and proceed to encrypt.
      */
     if (dkctx->kms.req_type == MONGOCRYPT_KMS_AZURE_OAUTH) {
@@ -530,6 +538,7 @@ bool mongocrypt_ctx_datakey_init(mongocrypt_ctx_t *ctx) {
 
     dkctx = (_mongocrypt_ctx_datakey_t *)ctx;
     ctx->type = _MONGOCRYPT_TYPE_CREATE_DATA_KEY;
+    _mongocrypt_counter_add(ctx->crypt, MC_COUNTER_CTX_CREATE_DATA_KEY, 1);
     ctx->vtable.mongo_op_keys = NULL;
     ctx->vtable.mongo_feed_keys = NULL;
     ctx->vtable.mongo_done_keys = NULL;
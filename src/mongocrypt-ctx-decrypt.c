@@ -21,9 +21,11 @@
 #include "mc-fle2-payload-iev-private.h"
 #include "mc-fle2-payload-uev-private.h"
 #include "mc-fle2-payload-uev-v2-private.h"
+#include "mongocrypt-cache-plaintext-private.h"
 #include "mongocrypt-ciphertext-private.h"
 #include "mongocrypt-crypto-private.h"
 #include "mongocrypt-ctx-private.h"
+#include "mongocrypt-probes-private.h"
 #include "mongocrypt-traverse-util-private.h"
 
 #define CHECK_AND_RETURN(cond)                                                                                         \
@@ -45,7 +47,8 @@
 
 static bool _replace_FLE2IndexedEncryptedValue_with_plaintext(void *ctx,
                                                               _mongocrypt_buffer_t *in,
-                                                              bson_value_t *out,
+                                                              bson_type_t *type_out,
+                                                              _mongocrypt_buffer_t *out,
                                                               mongocrypt_status_t *providedStatus) {
     bool ret = false;
     _mongocrypt_key_broker_t *kb = ctx;
@@ -56,6 +59,7 @@ static bool _replace_FLE2IndexedEncryptedValue_with_plaintext(void *ctx,
 
     BSON_ASSERT_PARAM(ctx);
     BSON_ASSERT_PARAM(in);
+    BSON_ASSERT_PARAM(type_out);
     BSON_ASSERT_PARAM(out);
 
     if (providedStatus == NULL) {
@@ -83,12 +87,13 @@ static bool _replace_FLE2IndexedEncryptedValue_with_plaintext(void *ctx,
     const _mongocrypt_buffer_t *clientValue = mc_FLE2IndexedEncryptedValue_get_ClientValue(iev, status);
     CHECK_AND_RETURN(clientValue);
 
-    // Marshal BSON value and type into a usable bson_value_t.
+    // Return the BSON value and type. The decrypted bytes are moved, not copied.
     bson_type_t original_bson_type = mc_FLE2IndexedEncryptedValue_get_original_bson_type(iev, status);
     CHECK_AND_RETURN(original_bson_type != BSON_TYPE_EOD);
-    CHECK_AND_RETURN_STATUS(
-        _mongocrypt_buffer_to_bson_value((_mongocrypt_buffer_t *)clientValue, (uint8_t)original_bson_type, out),
-        "decrypted clientValue is not valid BSON");
+    CHECK_AND_RETURN_STATUS(_mongocrypt_buffer_is_bson_value(clientValue, (uint8_t)original_bson_type),
+                            "decrypted clientValue is not valid BSON");
+    *type_out = original_bson_type;
+    _mongocrypt_buffer_steal(out, (_mongocrypt_buffer_t *)clientValue);
 
     ret = true;
 fail:
@@ -103,7 +108,8 @@ fail:
 
 static bool _replace_FLE2IndexedEncryptedValueV2_with_plaintext(void *ctx,
                                                                 _mongocrypt_buffer_t *in,
-                                                                bson_value_t *out,
+                                                                bson_type_t *type_out,
+                                                                _mongocrypt_buffer_t *out,
                                                                 mongocrypt_status_t *providedStatus) {
     bool ret = false;
     _mongocrypt_key_broker_t *kb = ctx;
@@ -114,6 +120,7 @@ static bool _replace_FLE2IndexedEncryptedValueV2_with_plaintext(void *ctx,
 
     BSON_ASSERT_PARAM(ctx);
     BSON_ASSERT_PARAM(in);
+    BSON_ASSERT_PARAM(type_out);
     BSON_ASSERT_PARAM(out);
 
     if (providedStatus == NULL) {
@@ -123,7 +130,7 @@ static bool _replace_FLE2IndexedEncryptedValueV2_with_plaintext(void *ctx,
     }
 
     // Parse the IEV payload to get S_KeyId.
-    CHECK_AND_RETURN(mc_FLE2IndexedEncryptedValueV2_parse(iev, in, status));
+    CHECK_AND_RETURN(mc_FLE2IndexedEncryptedValueV2_parse_borrowed(iev, in, status));
     const _mongocrypt_buffer_t *S_KeyId = mc_FLE2IndexedEncryptedValueV2_get_S_KeyId(iev, status);
     CHECK_AND_RETURN(S_KeyId);
     CHECK_AND_RETURN_KB_STATUS(_mongocrypt_key_broker_decrypted_key_by_id(kb, S_KeyId, &S_Key));
@@ -139,12 +146,13 @@ static bool _replace_FLE2IndexedEncryptedValueV2_with_plaintext(void *ctx,
     const _mongocrypt_buffer_t *clientValue = mc_FLE2IndexedEncryptedValueV2_get_ClientValue(iev, status);
     CHECK_AND_RETURN(clientValue);
 
-    // Marshal BSON value and type into a usable bson_value_t.
+    // Return the BSON value and type. The decrypted bytes are moved, not copied.
     bson_type_t bson_type = mc_FLE2IndexedEncryptedValueV2_get_bson_value_type(iev, status);
     CHECK_AND_RETURN(bson_type != BSON_TYPE_EOD);
-    CHECK_AND_RETURN_STATUS(
-        _mongocrypt_buffer_to_bson_value((_mongocrypt_buffer_t *)clientValue, (uint8_t)bson_type, out),
-        "decrypted clientValue is not valid BSON");
+    CHECK_AND_RETURN_STATUS(_mongocrypt_buffer_is_bson_value(clientValue, (uint8_t)bson_type),
+                            "decrypted clientValue is not valid BSON");
+    *type_out = bson_type;
+    _mongocrypt_buffer_steal(out, (_mongocrypt_buffer_t *)clientValue);
 
     ret = true;
 fail:
@@ -159,7 +167,8 @@ fail:
 
 static bool _replace_FLE2UnindexedEncryptedValue_with_plaintext(void *ctx,
                                                                 _mongocrypt_buffer_t *in,
-                                                                bson_value_t *out,
+                                                                bson_type_t *type_out,
+                                                                _mongocrypt_buffer_t *out,
                                                                 mongocrypt_status_t *status) {
     bool ret = false;
     _mongocrypt_key_broker_t *kb = ctx;
@@ -168,6 +177,7 @@ static bool _replace_FLE2UnindexedEncryptedValue_with_plaintext(void *ctx,
 
     BSON_ASSERT_PARAM(ctx);
     BSON_ASSERT_PARAM(in);
+    BSON_ASSERT_PARAM(type_out);
     BSON_ASSERT_PARAM(out);
 
     // Parse the UEV payload to get the encryption key.
@@ -183,13 +193,14 @@ static bool _replace_FLE2UnindexedEncryptedValue_with_plaintext(void *ctx,
         mc_FLE2UnindexedEncryptedValue_decrypt(kb->crypt->crypto, uev, &key, status);
     CHECK_AND_RETURN(plaintext);
 
-    // Marshal BSON value and type into a usable bson_value_t.
+    // Return the BSON value and type. The decrypted bytes are moved, not copied.
     bson_type_t original_bson_type = mc_FLE2UnindexedEncryptedValue_get_original_bson_type(uev, status);
     CHECK_AND_RETURN(original_bson_type != BSON_TYPE_EOD);
 
-    CHECK_AND_RETURN_STATUS(
-        _mongocrypt_buffer_to_bson_value((_mongocrypt_buffer_t *)plaintext, (uint8_t)original_bson_type, out),
-        "decrypted plaintext is not valid BSON");
+    CHECK_AND_RETURN_STATUS(_mongocrypt_buffer_is_bson_value(plaintext, (uint8_t)original_bson_type),
+                            "decrypted plaintext is not valid BSON");
+    *type_out = original_bson_type;
+    _mongocrypt_buffer_steal(out, (_mongocrypt_buffer_t *)plaintext);
 
     ret = true;
 fail:
@@ -200,7 +211,8 @@ fail:
 
 static bool _replace_FLE2UnindexedEncryptedValueV2_with_plaintext(void *ctx,
                                                                   _mongocrypt_buffer_t *in,
-                                                                  bson_value_t *out,
+                                                                  bson_type_t *type_out,
+                                                                  _mongocrypt_buffer_t *out,
                                                                   mongocrypt_status_t *status) {
     bool ret = false;
     _mongocrypt_key_broker_t *kb = ctx;
@@ -209,10 +221,11 @@ static bool _replace_FLE2UnindexedEncryptedValueV2_with_plaintext(void *ctx,
 
     BSON_ASSERT_PARAM(ctx);
     BSON_ASSERT_PARAM(in);
+    BSON_ASSERT_PARAM(type_out);
     BSON_ASSERT_PARAM(out);
 
     // Parse the UEV payload to get the encryption key.
-    CHECK_AND_RETURN(mc_FLE2UnindexedEncryptedValueV2_parse(uev, in, status));
+    CHECK_AND_RETURN(mc_FLE2UnindexedEncryptedValueV2_parse_borrowed(uev, in, status));
 
     const _mongocrypt_buffer_t *key_uuid = mc_FLE2UnindexedEncryptedValueV2_get_key_uuid(uev, status);
     CHECK_AND_RETURN(key_uuid);
@@ -224,13 +237,14 @@ static bool _replace_FLE2UnindexedEncryptedValueV2_with_plaintext(void *ctx,
         mc_FLE2UnindexedEncryptedValueV2_decrypt(kb->crypt->crypto, uev, &key, status);
     CHECK_AND_RETURN(plaintext);
 
-    // Marshal BSON value and type into a usable bson_value_t.
+    // Return the BSON value and type. The decrypted bytes are moved, not copied.
     bson_type_t original_bson_type = mc_FLE2UnindexedEncryptedValueV2_get_original_bson_type(uev, status);
     CHECK_AND_RETURN(original_bson_type != BSON_TYPE_EOD);
 
-    CHECK_AND_RETURN_STATUS(
-        _mongocrypt_buffer_to_bson_value((_mongocrypt_buffer_t *)plaintext, (uint8_t)original_bson_type, out),
-        "decrypted plaintext is not valid BSON");
+    CHECK_AND_RETURN_STATUS(_mongocrypt_buffer_is_bson_value(plaintext, (uint8_t)original_bson_type),
+                            "decrypted plaintext is not valid BSON");
+    *type_out = original_bson_type;
+    _mongocrypt_buffer_steal(out, (_mongocrypt_buffer_t *)plaintext);
 
     ret = true;
 fail:
@@ -241,7 +255,8 @@ fail:
 
 static bool _replace_FLE2InsertUpdatePayload_with_plaintext(void *ctx,
                                                             _mongocrypt_buffer_t *in,
-                                                            bson_value_t *out,
+                                                            bson_type_t *type_out,
+                                                            _mongocrypt_buffer_t *out,
                                                             mongocrypt_status_t *status) {
     bool ret = false;
     _mongocrypt_key_broker_t *kb = ctx;
@@ -250,6 +265,7 @@ static bool _replace_FLE2InsertUpdatePayload_with_plaintext(void *ctx,
 
     BSON_ASSERT_PARAM(ctx);
     BSON_ASSERT_PARAM(in);
+    BSON_ASSERT_PARAM(type_out);
     BSON_ASSERT_PARAM(out);
 
     mc_FLE2InsertUpdatePayload_init(&iup);
@@ -262,11 +278,12 @@ static bool _replace_FLE2InsertUpdatePayload_with_plaintext(void *ctx,
     const _mongocrypt_buffer_t *plaintext = mc_FLE2InsertUpdatePayload_decrypt(kb->crypt->crypto, &iup, &key, status);
     CHECK_AND_RETURN(plaintext);
 
-    // Marshal BSON value and type into a usable bson_value_t.
+    // Return the BSON value and type. The decrypted bytes are moved, not copied.
     bson_type_t original_bson_type = iup.valueType;
-    CHECK_AND_RETURN_STATUS(
-        _mongocrypt_buffer_to_bson_value((_mongocrypt_buffer_t *)plaintext, (uint8_t)original_bson_type, out),
-        "decrypted plaintext is not valid BSON");
+    CHECK_AND_RETURN_STATUS(_mongocrypt_buffer_is_bson_value(plaintext, (uint8_t)original_bson_type),
+                            "decrypted plaintext is not valid BSON");
+    *type_out = original_bson_type;
+    _mongocrypt_buffer_steal(out, (_mongocrypt_buffer_t *)plaintext);
 
     ret = true;
 fail:
@@ -277,7 +294,8 @@ fail:
 
 static bool _replace_FLE2InsertUpdatePayloadV2_with_plaintext(void *ctx,
                                                               _mongocrypt_buffer_t *in,
-                                                              bson_value_t *out,
+                                                              bson_type_t *type_out,
+                                                              _mongocrypt_buffer_t *out,
                                                               mongocrypt_status_t *status) {
     bool ret = false;
     _mongocrypt_key_broker_t *kb = ctx;
@@ -286,23 +304,25 @@ static bool _replace_FLE2InsertUpdatePayloadV2_with_plaintext(void *ctx,
 
     BSON_ASSERT_PARAM(ctx);
     BSON_ASSERT_PARAM(in);
+    BSON_ASSERT_PARAM(type_out);
     BSON_ASSERT_PARAM(out);
 
     mc_FLE2InsertUpdatePayloadV2_init(&iup);
 
-    // Parse the IUP payload to get the encryption key.
-    CHECK_AND_RETURN(mc_FLE2InsertUpdatePayloadV2_parse(&iup, in, status));
+    // Parse the IUP payload to get the encryption key. It was validated when collecting its key ID.
+    CHECK_AND_RETURN(mc_FLE2InsertUpdatePayloadV2_parse_unchecked(&iup, in, status));
     CHECK_AND_RETURN_KB_STATUS(_mongocrypt_key_broker_decrypted_key_by_id(kb, &iup.userKeyId, &key));
 
     // Decrypt the actual data value using encryption key.
     const _mongocrypt_buffer_t *plaintext = mc_FLE2InsertUpdatePayloadV2_decrypt(kb->crypt->crypto, &iup, &key, status);
     CHECK_AND_RETURN(plaintext);
 
-    // Marshal BSON value and type into a usable bson_value_t.
+    // Return the BSON value and type. The decrypted bytes are moved, not copied.
     bson_type_t original_bson_type = iup.valueType;
-    CHECK_AND_RETURN_STATUS(
-        _mongocrypt_buffer_to_bson_value((_mongocrypt_buffer_t *)plaintext, (uint8_t)original_bson_type, out),
-        "decrypted plaintext is not valid BSON");
+    CHECK_AND_RETURN_STATUS(_mongocrypt_buffer_is_bson_value(plaintext, (uint8_t)original_bson_type),
+                            "decrypted plaintext is not valid BSON");
+    *type_out = original_bson_type;
+    _mongocrypt_buffer_steal(out, (_mongocrypt_buffer_t *)plaintext);
 
     ret = true;
 fail:
@@ -313,23 +333,20 @@ fail:
 
 static bool _replace_FLE1Payload_with_plaintext(void *ctx,
                                                 _mongocrypt_buffer_t *in,
-                                                bson_value_t *out,
+                                                bson_type_t *type_out,
+                                                _mongocrypt_buffer_t *out,
                                                 mongocrypt_status_t *status) {
     _mongocrypt_key_broker_t *kb;
     _mongocrypt_ciphertext_t ciphertext;
-    _mongocrypt_buffer_t plaintext;
     _mongocrypt_buffer_t key_material;
-    _mongocrypt_buffer_t associated_data;
-    uint32_t bytes_written;
     bool ret = false;
 
     BSON_ASSERT_PARAM(ctx);
     BSON_ASSERT_PARAM(in);
+    BSON_ASSERT_PARAM(type_out);
     BSON_ASSERT_PARAM(out);
     BSON_ASSERT(in->data);
 
-    _mongocrypt_buffer_init(&plaintext);
-    _mongocrypt_buffer_init(&associated_data);
     _mongocrypt_buffer_init(&key_material);
     kb = (_mongocrypt_key_broker_t *)ctx;
 
@@ -339,76 +356,340 @@ static bool _replace_FLE1Payload_with_plaintext(void *ctx,
     CHECK_AND_RETURN_STATUS(_mongocrypt_key_broker_decrypted_key_by_id(kb, &ciphertext.key_id, &key_material),
                             "key not found");
 
-    const _mongocrypt_value_encryption_algorithm_t *fle1alg = _mcFLE1Algorithm();
-    plaintext.len = fle1alg->get_plaintext_len(ciphertext.data.len, status);
-    CHECK_AND_RETURN(plaintext.len != 0);
-    plaintext.data = bson_malloc0(plaintext.len);
-    BSON_ASSERT(plaintext.data);
-
-    plaintext.owned = true;
-
-    CHECK_AND_RETURN_STATUS(_mongocrypt_ciphertext_serialize_associated_data(&ciphertext, &associated_data),
-                            "could not serialize associated data");
-
-    CHECK_AND_RETURN(fle1alg->do_decrypt(kb->crypt->crypto,
-                                         &associated_data,
-                                         &key_material,
-                                         &ciphertext.data,
-                                         &plaintext,
-                                         &bytes_written,
-                                         status));
-
-    plaintext.len = bytes_written;
-
-    CHECK_AND_RETURN_STATUS(_mongocrypt_buffer_to_bson_value(&plaintext, ciphertext.original_bson_type, out),
-                            "malformed encrypted bson");
+    CHECK_AND_RETURN(_mongocrypt_fle1_decrypt(kb->crypt->crypto, &ciphertext, &key_material, type_out, out, status));
 
     ret = true;
 fail:
-    _mongocrypt_buffer_cleanup(&plaintext);
-    _mongocrypt_buffer_cleanup(&associated_data);
     _mongocrypt_buffer_cleanup(&key_material);
     return ret;
 }
 
+/* Deterministic ciphertexts are often repeated across the documents of a
+ * cursor batch. Each distinct ciphertext is decrypted once per context. */
+static bool _replace_FLE1DeterministicPayload_with_plaintext(_mongocrypt_ctx_decrypt_t *dctx,
+                                                             _mongocrypt_buffer_t *in,
+                                                             bson_type_t *type_out,
+                                                             _mongocrypt_buffer_t *out,
+                                                             mongocrypt_status_t *status) {
+    _mongocrypt_cache_plaintext_value_t *cached = NULL;
+    _mongocrypt_cache_plaintext_value_t decrypted;
+
+    BSON_ASSERT_PARAM(dctx);
+    BSON_ASSERT_PARAM(in);
+    BSON_ASSERT_PARAM(type_out);
+    BSON_ASSERT_PARAM(out);
+
+    if (!_mongocrypt_cache_get(&dctx->plaintext_cache, in, (void **)&cached)) {
+        CLIENT_ERR("failed to retrieve from plaintext cache");
+        return false;
+    }
+    if (cached) {
+        *type_out = (bson_type_t)cached->type;
+        _mongocrypt_buffer_steal(out, &cached->value);
+        bson_free(cached);
+        return true;
+    }
+
+    if (!_replace_FLE1Payload_with_plaintext(&dctx->parent.kb, in, type_out, out, status)) {
+        return false;
+    }
+    decrypted.type = (uint8_t)*type_out;
+    decrypted.value = *out;
+    return _mongocrypt_cache_add_copy(&dctx->plaintext_cache, in, &decrypted, status);
+}
+
 static bool _replace_ciphertext_with_plaintext(void *ctx,
                                                _mongocrypt_buffer_t *in,
-                                               bson_value_t *out,
+                                               bson_type_t *type_out,
+                                               _mongocrypt_buffer_t *out,
                                                mongocrypt_status_t *status) {
+    _mongocrypt_ctx_decrypt_t *dctx;
+    _mongocrypt_key_broker_t *kb;
+    mc_counter_t counter;
+    bool ret;
+
     BSON_ASSERT_PARAM(ctx);
     BSON_ASSERT_PARAM(in);
+    BSON_ASSERT_PARAM(type_out);
     BSON_ASSERT_PARAM(out);
     BSON_ASSERT(in->data);
 
+    dctx = (_mongocrypt_ctx_decrypt_t *)ctx;
+    kb = &dctx->parent.kb;
+
     switch (in->data[0]) {
     // FLE2v2
     case MC_SUBTYPE_FLE2IndexedEqualityEncryptedValueV2:
+        counter = MC_COUNTER_DECRYPTED_FLE2_EQUALITY;
+        ret = _replace_FLE2IndexedEncryptedValueV2_with_plaintext(kb, in, type_out, out, status);
+        break;
     case MC_SUBTYPE_FLE2IndexedRangeEncryptedValueV2:
-        return _replace_FLE2IndexedEncryptedValueV2_with_plaintext(ctx, in, out, status);
+        counter = MC_COUNTER_DECRYPTED_FLE2_RANGE;
+        ret = _replace_FLE2IndexedEncryptedValueV2_with_plaintext(kb, in, type_out, out, status);
+        break;
     case MC_SUBTYPE_FLE2InsertUpdatePayloadV2:
-        return _replace_FLE2InsertUpdatePayloadV2_with_plaintext(ctx, in, out, status);
+        /* Insert payloads are not stored values and are not counted. */
+        return _replace_FLE2InsertUpdatePayloadV2_with_plaintext(kb, in, type_out, out, status);
     case MC_SUBTYPE_FLE2UnindexedEncryptedValueV2:
-        return _replace_FLE2UnindexedEncryptedValueV2_with_plaintext(ctx, in, out, status);
+        counter = MC_COUNTER_DECRYPTED_FLE2_UNINDEXED;
+        ret = _replace_FLE2UnindexedEncryptedValueV2_with_plaintext(kb, in, type_out, out, status);
+        break;
 
     // FLE2v1
     case MC_SUBTYPE_FLE2IndexedEqualityEncryptedValue:
+        counter = MC_COUNTER_DECRYPTED_FLE2_EQUALITY;
+        ret = _replace_FLE2IndexedEncryptedValue_with_plaintext(kb, in, type_out, out, status);
+        break;
     case MC_SUBTYPE_FLE2IndexedRangeEncryptedValue:
-        return _replace_FLE2IndexedEncryptedValue_with_plaintext(ctx, in, out, status);
+        counter = MC_COUNTER_DECRYPTED_FLE2_RANGE;
+        ret = _replace_FLE2IndexedEncryptedValue_with_plaintext(kb, in, type_out, out, status);
+        break;
     case MC_SUBTYPE_FLE2InsertUpdatePayload:
-        return _replace_FLE2InsertUpdatePayload_with_plaintext(ctx, in, out, status);
+        return _replace_FLE2InsertUpdatePayload_with_plaintext(kb, in, type_out, out, status);
     case MC_SUBTYPE_FLE2UnindexedEncryptedValue:
-        return _replace_FLE2UnindexedEncryptedValue_with_plaintext(ctx, in, out, status);
+        counter = MC_COUNTER_DECRYPTED_FLE2_UNINDEXED;
+        ret = _replace_FLE2UnindexedEncryptedValue_with_plaintext(kb, in, type_out, out, status);
+        break;
 
     // FLE1
-    default: return _replace_FLE1Payload_with_plaintext(ctx, in, out, status);
+    case MC_SUBTYPE_FLE1DeterministicEncryptedValue:
+        counter = MC_COUNTER_DECRYPTED_FLE1;
+        ret = _replace_FLE1DeterministicPayload_with_plaintext(dctx, in, type_out, out, status);
+        break;
+    default:
+        counter = MC_COUNTER_DECRYPTED_FLE1;
+        ret = _replace_FLE1Payload_with_plaintext(kb, in, type_out, out, status);
+        break;
+    }
+
+    if (ret) {
+        _mongocrypt_counter_add(kb->crypt, counter, 1);
+    }
+    MONGOCRYPT_PROBE4(decrypt__value, in->data[0], in->len, ret ? out->len : 0, ret);
+    return ret;
+}
+
+typedef struct {
+    _mongocrypt_ctx_decrypt_t *dctx;
+    /* ciphertexts holds a _mongocrypt_buffer_t viewing each ciphertext of
+     * original_doc in traversal order. */
+    mc_array_t ciphertexts;
+    /* types[i] and plaintexts[i] are the decrypted value of ciphertexts[i]. */
+    bson_type_t *types;
+    _mongocrypt_buffer_t *plaintexts;
+    /* starts holds the uint32_t index of the first ciphertext of each piece.
+     * Each piece is decrypted by one task, which sets statuses[piece] and
+     * ok[piece]. */
+    mc_array_t starts;
+    mongocrypt_status_t **statuses;
+    bool *ok;
+    /* next is the index of the next plaintext to place in the document. */
+    size_t next;
+} _ciphertexts_batch_t;
+
+static bool _collect_ciphertext(void *ctx, _mongocrypt_buffer_t *in, mongocrypt_status_t *status) {
+    _ciphertexts_batch_t *batch = ctx;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(in);
+
+    _mc_array_append_val(&batch->ciphertexts, *in);
+    return true;
+}
+
+static void _piece_to_plaintexts_task(void *task_ctx, uint32_t piece) {
+    _ciphertexts_batch_t *batch = task_ctx;
+    const uint32_t start = _mc_array_index(&batch->starts, uint32_t, piece);
+    const uint32_t end = piece + 1u < batch->starts.len ? _mc_array_index(&batch->starts, uint32_t, piece + 1u)
+                                                        : (uint32_t)batch->ciphertexts.len;
+
+    for (uint32_t i = start; i < end; i++) {
+        _mongocrypt_buffer_t *in = &_mc_array_index(&batch->ciphertexts, _mongocrypt_buffer_t, i);
+
+        if (!_replace_ciphertext_with_plaintext(batch->dctx,
+                                                in,
+                                                &batch->types[i],
+                                                &batch->plaintexts[i],
+                                                batch->statuses[piece])) {
+            return;
+        }
+    }
+    batch->ok[piece] = true;
+}
+
+/* Appends to @starts the index of the first ciphertext of each piece of work.
+ * The ciphertexts of one document of cursor.firstBatch or cursor.nextBatch
+ * form one piece, so a cursor batch is split at document boundaries. Any other
+ * ciphertext is a piece of its own. */
+static void _partition_ciphertexts(_mongocrypt_ctx_decrypt_t *dctx, mc_array_t *starts) {
+    const mc_array_t *offsets = &dctx->ciphertext_offsets;
+    bson_t as_bson;
+    bson_iter_t iter;
+    bson_iter_t batch_iter;
+    uint32_t i = 0;
+
+    BSON_ASSERT_PARAM(dctx);
+    BSON_ASSERT_PARAM(starts);
+    BSON_ASSERT(offsets->len <= UINT32_MAX);
+
+    if (_mongocrypt_buffer_to_bson(&dctx->original_doc, &as_bson)
+        && ((bson_iter_init(&iter, &as_bson) && bson_iter_find_descendant(&iter, "cursor.firstBatch", &batch_iter))
+            || (bson_iter_init(&iter, &as_bson)
+                && bson_iter_find_descendant(&iter, "cursor.nextBatch", &batch_iter)))
+        && BSON_ITER_HOLDS_ARRAY(&batch_iter) && bson_iter_recurse(&batch_iter, &iter)) {
+        while (bson_iter_next(&iter)) {
+            uint32_t doc_len;
+            const uint8_t *doc_data;
+            uint32_t doc_offset;
+
+            if (!BSON_ITER_HOLDS_DOCUMENT(&iter)) {
+                continue;
+            }
+            bson_iter_document(&iter, &doc_len, &doc_data);
+            doc_offset = (uint32_t)(doc_data - dctx->original_doc.data);
+
+            while (i < offsets->len && _mc_array_index(offsets, uint32_t, i) < doc_offset) {
+                _mc_array_append_val(starts, i);
+                i++;
+            }
+            if (i < offsets->len && _mc_array_index(offsets, uint32_t, i) < doc_offset + doc_len) {
+                _mc_array_append_val(starts, i);
+                while (i < offsets->len && _mc_array_index(offsets, uint32_t, i) < doc_offset + doc_len) {
+                    i++;
+                }
+            }
+        }
+    }
+
+    for (; i < offsets->len; i++) {
+        _mc_array_append_val(starts, i);
+    }
+}
+
+static bool _place_plaintext(void *ctx,
+                             _mongocrypt_buffer_t *in,
+                             bson_type_t *type_out,
+                             _mongocrypt_buffer_t *out,
+                             mongocrypt_status_t *status) {
+    _ciphertexts_batch_t *batch = ctx;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(type_out);
+    BSON_ASSERT_PARAM(out);
+
+    if (batch->next >= batch->ciphertexts.len) {
+        CLIENT_ERR("unexpected ciphertext");
+        return false;
+    }
+    /* Ownership of the plaintext is transferred to the caller. */
+    *type_out = batch->types[batch->next];
+    _mongocrypt_buffer_steal(out, &batch->plaintexts[batch->next]);
+    batch->next++;
+    return true;
+}
+
+/* Sets dctx->decrypted_doc to original_doc with each ciphertext replaced by
+ * its plaintext. If a parallel_for executor is set and the document has at
+ * least opts.parallel_decrypt_threshold ciphertexts, the ciphertexts are
+ * decrypted by one task per piece of _partition_ciphertexts, then placed in
+ * order. */
+static bool _replace_ciphertexts_with_plaintexts(mongocrypt_ctx_t *ctx) {
+    _mongocrypt_ctx_decrypt_t *dctx;
+    _mongocrypt_crypto_t *crypto;
+    _ciphertexts_batch_t batch = {0};
+    const uint32_t threshold = ctx->crypt->opts.parallel_decrypt_threshold;
+    bool ret = false;
+    uint32_t n;
+    uint32_t pieces = 0;
+
+    BSON_ASSERT_PARAM(ctx);
+
+    dctx = (_mongocrypt_ctx_decrypt_t *)ctx;
+    crypto = ctx->crypt->crypto;
+    if (threshold == 0 || !crypto->parallel_for || dctx->ciphertext_offsets.len < threshold) {
+        /* Only the ciphertexts found by mongocrypt_ctx_decrypt_init are
+         * visited. The bytes between them are copied as is. */
+        return _mongocrypt_transform_binary_at_offsets(_replace_ciphertext_with_plaintext,
+                                                       ctx,
+                                                       &dctx->original_doc,
+                                                       &dctx->ciphertext_offsets,
+                                                       &dctx->container_offsets,
+                                                       &dctx->decrypted_doc,
+                                                       ctx->status);
+    }
+
+    if (dctx->ciphertext_offsets.len > UINT32_MAX - 1u) {
+        mongocrypt_status_t *status = ctx->status;
+        CLIENT_ERR("too many ciphertexts: %zu", dctx->ciphertext_offsets.len);
+        return false;
+    }
+    n = (uint32_t)dctx->ciphertext_offsets.len;
+
+    batch.dctx = dctx;
+    _mc_array_init(&batch.ciphertexts, sizeof(_mongocrypt_buffer_t));
+    _mc_array_init(&batch.starts, sizeof(uint32_t));
+    if (!_mongocrypt_traverse_binary_at_offsets(_collect_ciphertext,
+                                                &batch,
+                                                &dctx->original_doc,
+                                                &dctx->ciphertext_offsets,
+                                                ctx->status)) {
+        goto fail;
+    }
+    BSON_ASSERT(batch.ciphertexts.len == n);
+
+    _partition_ciphertexts(dctx, &batch.starts);
+    pieces = (uint32_t)batch.starts.len;
+
+    batch.types = bson_malloc0(sizeof(bson_type_t) * n);
+    batch.plaintexts = bson_malloc0(sizeof(_mongocrypt_buffer_t) * n);
+    for (uint32_t i = 0; i < n; i++) {
+        _mongocrypt_buffer_init(&batch.plaintexts[i]);
+    }
+    batch.statuses = bson_malloc0(sizeof(mongocrypt_status_t *) * pieces);
+    batch.ok = bson_malloc0(sizeof(bool) * pieces);
+    for (uint32_t i = 0; i < pieces; i++) {
+        batch.statuses[i] = mongocrypt_status_new();
+    }
+
+    crypto->parallel_for(crypto->parallel_for_ctx, _piece_to_plaintexts_task, &batch, pieces);
+
+    for (uint32_t i = 0; i < pieces; i++) {
+        if (!batch.ok[i]) {
+            _mongocrypt_status_copy_to(batch.statuses[i], ctx->status);
+            goto fail;
+        }
+    }
+
+    if (!_mongocrypt_transform_binary_at_offsets(_place_plaintext,
+                                                 &batch,
+                                                 &dctx->original_doc,
+                                                 &dctx->ciphertext_offsets,
+                                                 &dctx->container_offsets,
+                                                 &dctx->decrypted_doc,
+                                                 ctx->status)) {
+        goto fail;
+    }
+    BSON_ASSERT(batch.next == n);
+
+    ret = true;
+fail:
+    for (size_t i = 0; batch.plaintexts && i < n; i++) {
+        _mongocrypt_buffer_cleanup(&batch.plaintexts[i]);
+    }
+    for (size_t i = 0; batch.statuses && i < pieces; i++) {
+        mongocrypt_status_destroy(batch.statuses[i]);
     }
+    bson_free(batch.types);
+    bson_free(batch.plaintexts);
+    bson_free(batch.statuses);
+    bson_free(batch.ok);
+    _mc_array_destroy(&batch.starts);
+    _mc_array_destroy(&batch.ciphertexts);
+    return ret;
 }
 
 static bool _finalize(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
-    bson_t as_bson, final_bson;
-    bson_iter_t iter = {0};
     _mongocrypt_ctx_decrypt_t *dctx;
-    bool res;
 
     if (!ctx) {
         return false;
@@ -420,36 +701,142 @@ static bool _finalize(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
 
     dctx = (_mongocrypt_ctx_decrypt_t *)ctx;
 
+    if (dctx->streaming) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "cannot finalize after streaming decrypted documents");
+    }
+
     if (ctx->nothing_to_do) {
         _mongocrypt_buffer_to_binary(&dctx->original_doc, out);
         ctx->state = MONGOCRYPT_CTX_DONE;
         return true;
     }
 
-    if (!_mongocrypt_buffer_to_bson(&dctx->original_doc, &as_bson)) {
-        return _mongocrypt_ctx_fail_w_msg(ctx, "malformed bson");
-    }
-
-    bson_iter_init(&iter, &as_bson);
-    bson_init(&final_bson);
-    res = _mongocrypt_transform_binary_in_bson(_replace_ciphertext_with_plaintext,
-                                               &ctx->kb,
-                                               TRAVERSE_MATCH_CIPHERTEXT,
-                                               &iter,
-                                               &final_bson,
-                                               ctx->status);
-    if (!res) {
-        bson_destroy(&final_bson);
+    if (!_replace_ciphertexts_with_plaintexts(ctx)) {
         return _mongocrypt_ctx_fail(ctx);
     }
 
-    _mongocrypt_buffer_steal_from_bson(&dctx->decrypted_doc, &final_bson);
     out->data = dctx->decrypted_doc.data;
     out->len = dctx->decrypted_doc.len;
     ctx->state = MONGOCRYPT_CTX_DONE;
     return true;
 }
 
+/* Remembers @K_KeyId as the key found with @S_KeyId, so later decrypts can
+ * prefetch it along with the S_KeyId. */
+static bool _remember_K_KeyId(_mongocrypt_key_broker_t *kb,
+                              const _mongocrypt_buffer_t *S_KeyId,
+                              const _mongocrypt_buffer_t *K_KeyId,
+                              mongocrypt_status_t *status) {
+    _mongocrypt_buffer_t *cached = NULL;
+    bool ret;
+
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(S_KeyId);
+    BSON_ASSERT_PARAM(K_KeyId);
+
+    if (0 == _mongocrypt_buffer_cmp(S_KeyId, K_KeyId)) {
+        /* The K_KeyId is already fetched as the S_KeyId. */
+        return true;
+    }
+
+    if (_mongocrypt_cache_get(&kb->crypt->cache_user_key_id, (void *)S_KeyId, (void **)&cached) && cached
+        && 0 == _mongocrypt_buffer_cmp(cached, K_KeyId)) {
+        ret = true;
+    } else {
+        ret = _mongocrypt_cache_add_copy(&kb->crypt->cache_user_key_id, (void *)S_KeyId, (void *)K_KeyId, status);
+    }
+    if (cached) {
+        kb->crypt->cache_user_key_id.destroy_value(cached);
+    }
+    return ret;
+}
+
+/* Requests the K_KeyId last found with @S_KeyId, if any. The request is
+ * optional: the guess may be stale, and the K_KeyId is requested again once
+ * the S_Key is available to decrypt it. */
+static bool _prefetch_K_KeyId(_mongocrypt_key_broker_t *kb, const _mongocrypt_buffer_t *S_KeyId) {
+    _mongocrypt_buffer_t *K_KeyId = NULL;
+    bool ret = true;
+
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(S_KeyId);
+
+    /* A failed lookup is only a missed prefetch. */
+    if (_mongocrypt_cache_get(&kb->crypt->cache_user_key_id, (void *)S_KeyId, (void **)&K_KeyId) && K_KeyId) {
+        ret = _mongocrypt_key_broker_request_id_optional(kb, K_KeyId);
+    }
+    if (K_KeyId) {
+        kb->crypt->cache_user_key_id.destroy_value(K_KeyId);
+    }
+    return ret;
+}
+
+/* Decrypts the K_KeyId of @iev with the S_Key and requests it. The S_Key must
+ * be available in @kb. */
+static bool _request_K_KeyId_from_FLE2IndexedEncryptedValueV2(_mongocrypt_key_broker_t *kb,
+                                                              mc_FLE2IndexedEncryptedValueV2_t *iev,
+                                                              const _mongocrypt_buffer_t *S_KeyId,
+                                                              mongocrypt_status_t *status) {
+    bool ret = false;
+    _mongocrypt_buffer_t S_Key = {0};
+
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(iev);
+    BSON_ASSERT_PARAM(S_KeyId);
+
+    CHECK_AND_RETURN_KB_STATUS(_mongocrypt_key_broker_decrypted_key_by_id(kb, S_KeyId, &S_Key));
+
+    /* Decrypt InnerEncrypted to get K_KeyId. */
+    CHECK_AND_RETURN(mc_FLE2IndexedEncryptedValueV2_add_S_Key(kb->crypt->crypto, iev, &S_Key, status));
+
+    /* Add request for K_KeyId. */
+    const _mongocrypt_buffer_t *K_KeyId = mc_FLE2IndexedEncryptedValueV2_get_K_KeyId(iev, status);
+    CHECK_AND_RETURN(K_KeyId);
+
+    CHECK_AND_RETURN_KB_STATUS(_mongocrypt_key_broker_request_id(kb, K_KeyId));
+    CHECK_AND_RETURN(_remember_K_KeyId(kb, S_KeyId, K_KeyId, status));
+
+    ret = true;
+fail:
+    _mongocrypt_buffer_cleanup(&S_Key);
+    return ret;
+}
+
+/* Decrypts the K_KeyId of @iev with the S_Key and requests it. The S_Key must
+ * be available in @kb. */
+static bool _request_K_KeyId_from_FLE2IndexedEncryptedValue(_mongocrypt_key_broker_t *kb,
+                                                            mc_FLE2IndexedEncryptedValue_t *iev,
+                                                            const _mongocrypt_buffer_t *S_KeyId,
+                                                            mongocrypt_status_t *status) {
+    bool ret = false;
+    _mongocrypt_buffer_t S_Key = {0};
+
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(iev);
+    BSON_ASSERT_PARAM(S_KeyId);
+
+    CHECK_AND_RETURN_KB_STATUS(_mongocrypt_key_broker_decrypted_key_by_id(kb, S_KeyId, &S_Key));
+
+    /* Decrypt InnerEncrypted to get K_KeyId. */
+    CHECK_AND_RETURN(mc_FLE2IndexedEncryptedValue_add_S_Key(kb->crypt->crypto, iev, &S_Key, status));
+
+    /* Add request for K_KeyId. */
+    const _mongocrypt_buffer_t *K_KeyId = mc_FLE2IndexedEncryptedValue_get_K_KeyId(iev, status);
+    CHECK_AND_RETURN(K_KeyId);
+
+    CHECK_AND_RETURN_KB_STATUS(_mongocrypt_key_broker_request_id(kb, K_KeyId));
+    CHECK_AND_RETURN(_remember_K_KeyId(kb, S_KeyId, K_KeyId, status));
+
+    ret = true;
+fail:
+    _mongocrypt_buffer_cleanup(&S_Key);
+    return ret;
+}
+
+/* The _collect_S_KeyID functions request the S_KeyId of an indexed value. If
+ * the S_Key is already cached, the K_KeyId is requested too. Otherwise the
+ * K_KeyId last found with the S_KeyId is prefetched. Either way, the K_Key can
+ * usually be fetched in the same round as the S_Key. */
 static bool _collect_S_KeyID_from_FLE2IndexedEncryptedValue(void *ctx,
                                                             const _mongocrypt_buffer_t *in,
                                                             mongocrypt_status_t *status) {
@@ -465,6 +852,12 @@ static bool _collect_S_KeyID_from_FLE2IndexedEncryptedValue(void *ctx,
     CHECK_AND_RETURN(S_KeyId);
     CHECK_AND_RETURN_KB_STATUS(_mongocrypt_key_broker_request_id(kb, S_KeyId));
 
+    if (_mongocrypt_key_broker_has_decrypted_key_by_id(kb, S_KeyId)) {
+        CHECK_AND_RETURN(_request_K_KeyId_from_FLE2IndexedEncryptedValue(kb, iev, S_KeyId, status));
+    } else {
+        CHECK_AND_RETURN_KB_STATUS(_prefetch_K_KeyId(kb, S_KeyId));
+    }
+
     ret = true;
 fail:
     mc_FLE2IndexedEncryptedValue_destroy(iev);
@@ -481,11 +874,17 @@ static bool _collect_S_KeyID_from_FLE2IndexedEncryptedValueV2(void *ctx,
 
     mc_FLE2IndexedEncryptedValueV2_t *iev = mc_FLE2IndexedEncryptedValueV2_new();
     CHECK_AND_RETURN(iev);
-    CHECK_AND_RETURN(mc_FLE2IndexedEncryptedValueV2_parse(iev, in, status));
+    CHECK_AND_RETURN(mc_FLE2IndexedEncryptedValueV2_parse_borrowed(iev, in, status));
     const _mongocrypt_buffer_t *S_KeyId = mc_FLE2IndexedEncryptedValueV2_get_S_KeyId(iev, status);
     CHECK_AND_RETURN(S_KeyId);
     CHECK_AND_RETURN_KB_STATUS(_mongocrypt_key_broker_request_id(kb, S_KeyId));
 
+    if (_mongocrypt_key_broker_has_decrypted_key_by_id(kb, S_KeyId)) {
+        CHECK_AND_RETURN(_request_K_KeyId_from_FLE2IndexedEncryptedValueV2(kb, iev, S_KeyId, status));
+    } else {
+        CHECK_AND_RETURN_KB_STATUS(_prefetch_K_KeyId(kb, S_KeyId));
+    }
+
     ret = true;
 fail:
     mc_FLE2IndexedEncryptedValueV2_destroy(iev);
@@ -504,28 +903,16 @@ static bool _collect_K_KeyID_from_FLE2IndexedEncryptedValueV2(void *ctx,
                 || (in->data[0] == MC_SUBTYPE_FLE2IndexedRangeEncryptedValueV2));
 
     mc_FLE2IndexedEncryptedValueV2_t *iev = mc_FLE2IndexedEncryptedValueV2_new();
-    _mongocrypt_buffer_t S_Key = {0};
     CHECK_AND_RETURN(iev);
-    CHECK_AND_RETURN(mc_FLE2IndexedEncryptedValueV2_parse(iev, in, status));
+    CHECK_AND_RETURN(mc_FLE2IndexedEncryptedValueV2_parse_borrowed(iev, in, status));
 
     const _mongocrypt_buffer_t *S_KeyId = mc_FLE2IndexedEncryptedValueV2_get_S_KeyId(iev, status);
     CHECK_AND_RETURN(S_KeyId);
 
-    _mongocrypt_key_broker_t *kb = ctx;
-    CHECK_AND_RETURN_KB_STATUS(_mongocrypt_key_broker_decrypted_key_by_id(kb, S_KeyId, &S_Key));
-
-    /* Decrypt InnerEncrypted to get K_KeyId. */
-    CHECK_AND_RETURN(mc_FLE2IndexedEncryptedValueV2_add_S_Key(kb->crypt->crypto, iev, &S_Key, status));
-
-    /* Add request for K_KeyId. */
-    const _mongocrypt_buffer_t *K_KeyId = mc_FLE2IndexedEncryptedValueV2_get_K_KeyId(iev, status);
-    CHECK_AND_RETURN(K_KeyId);
-
-    CHECK_AND_RETURN_KB_STATUS(_mongocrypt_key_broker_request_id(kb, K_KeyId));
+    CHECK_AND_RETURN(_request_K_KeyId_from_FLE2IndexedEncryptedValueV2(ctx, iev, S_KeyId, status));
 
     ret = true;
 fail:
-    _mongocrypt_buffer_cleanup(&S_Key);
     mc_FLE2IndexedEncryptedValueV2_destroy(iev);
     return ret;
 }
@@ -537,7 +924,6 @@ static bool _collect_K_KeyID_from_FLE2IndexedEncryptedValue(void *ctx,
     BSON_ASSERT_PARAM(in);
     BSON_ASSERT(in->data);
     bool ret = false;
-    _mongocrypt_buffer_t S_Key = {0};
 
     BSON_ASSERT((in->data[0] == MC_SUBTYPE_FLE2IndexedEqualityEncryptedValue)
                 || (in->data[0] == MC_SUBTYPE_FLE2IndexedRangeEncryptedValue));
@@ -549,21 +935,10 @@ static bool _collect_K_KeyID_from_FLE2IndexedEncryptedValue(void *ctx,
     const _mongocrypt_buffer_t *S_KeyId = mc_FLE2IndexedEncryptedValue_get_S_KeyId(iev, status);
     CHECK_AND_RETURN(S_KeyId);
 
-    _mongocrypt_key_broker_t *kb = ctx;
-    CHECK_AND_RETURN_KB_STATUS(_mongocrypt_key_broker_decrypted_key_by_id(kb, S_KeyId, &S_Key));
-
-    /* Decrypt InnerEncrypted to get K_KeyId. */
-    CHECK_AND_RETURN(mc_FLE2IndexedEncryptedValue_add_S_Key(kb->crypt->crypto, iev, &S_Key, status));
-
-    /* Add request for K_KeyId. */
-    const _mongocrypt_buffer_t *K_KeyId = mc_FLE2IndexedEncryptedValue_get_K_KeyId(iev, status);
-    CHECK_AND_RETURN(K_KeyId);
-
-    CHECK_AND_RETURN_KB_STATUS(_mongocrypt_key_broker_request_id(kb, K_KeyId));
+    CHECK_AND_RETURN(_request_K_KeyId_from_FLE2IndexedEncryptedValue(ctx, iev, S_KeyId, status));
 
     ret = true;
 fail:
-    _mongocrypt_buffer_cleanup(&S_Key);
     mc_FLE2IndexedEncryptedValue_destroy(iev);
     return ret;
 }
@@ -590,7 +965,8 @@ static bool _collect_K_KeyIDs(void *ctx, _mongocrypt_buffer_t *in, mongocrypt_st
 }
 
 /* _check_for_K_KeyId must be called after requests for all S_KeyId are
- * satisfied. */
+ * satisfied. K_KeyIds already requested with the S_KeyIds need no second round
+ * of key requests. */
 static bool _check_for_K_KeyId(mongocrypt_ctx_t *ctx) {
     BSON_ASSERT_PARAM(ctx);
 
@@ -603,19 +979,12 @@ static bool _check_for_K_KeyId(mongocrypt_ctx_t *ctx) {
         return _mongocrypt_ctx_fail(ctx);
     }
 
-    bson_t as_bson;
-    bson_iter_t iter = {0};
     _mongocrypt_ctx_decrypt_t *dctx = (_mongocrypt_ctx_decrypt_t *)ctx;
-    if (!_mongocrypt_buffer_to_bson(&dctx->original_doc, &as_bson)) {
-        return _mongocrypt_ctx_fail_w_msg(ctx, "error converting original_doc to bson");
-    }
-    bson_iter_init(&iter, &as_bson);
-
-    if (!_mongocrypt_traverse_binary_in_bson(_collect_K_KeyIDs,
-                                             &ctx->kb,
-                                             TRAVERSE_MATCH_CIPHERTEXT,
-                                             &iter,
-                                             ctx->status)) {
+    if (!_mongocrypt_traverse_binary_at_offsets(_collect_K_KeyIDs,
+                                                &ctx->kb,
+                                                &dctx->original_doc,
+                                                &dctx->ciphertext_offsets,
+                                                ctx->status)) {
         return _mongocrypt_ctx_fail(ctx);
     }
 
@@ -657,7 +1026,7 @@ static bool _collect_key_uuid_from_FLE2UnindexedEncryptedValueV2(void *ctx,
 
     mc_FLE2UnindexedEncryptedValueV2_t *uev = mc_FLE2UnindexedEncryptedValueV2_new();
     CHECK_AND_RETURN(uev);
-    CHECK_AND_RETURN(mc_FLE2UnindexedEncryptedValueV2_parse(uev, in, status));
+    CHECK_AND_RETURN(mc_FLE2UnindexedEncryptedValueV2_parse_borrowed(uev, in, status));
 
     const _mongocrypt_buffer_t *key_uuid = mc_FLE2UnindexedEncryptedValueV2_get_key_uuid(uev, status);
     CHECK_AND_RETURN(key_uuid);
@@ -748,6 +1117,162 @@ static bool _collect_key_from_ciphertext(void *ctx, _mongocrypt_buffer_t *in, mo
     }
 }
 
+typedef struct {
+    const mc_array_t *offsets;
+    /* paths is the BSON array of opts.decrypt_paths. */
+    bson_t paths;
+    /* keys holds the const char * field names enclosing the current element.
+     * Array indexes are not included, so an array element is named by the path
+     * of the array. */
+    mc_array_t keys;
+    /* next is the index of the next ciphertext offset to visit. */
+    size_t next;
+    mc_array_t *selected;
+    mongocrypt_status_t *status;
+} _select_state_t;
+
+/* Returns true if the dotted @path names the field @keys or one of its
+ * enclosing fields. */
+static bool _path_selects(const char *path, const char *const *keys, size_t n_keys) {
+    BSON_ASSERT_PARAM(path);
+
+    for (size_t i = 0; i < n_keys; i++) {
+        const size_t len = strlen(keys[i]);
+
+        if (0 != strncmp(path, keys[i], len)) {
+            return false;
+        }
+        path += len;
+        if (*path == '\0') {
+            return true;
+        }
+        if (*path != '.') {
+            return false;
+        }
+        path++;
+    }
+    return false;
+}
+
+/* Returns true if one of the decrypt paths selects the current element. Field
+ * names before keys[base] are not part of the paths. */
+static bool _any_path_selects(_select_state_t *state, size_t base) {
+    bson_iter_t iter;
+
+    BSON_ASSERT_PARAM(state);
+    BSON_ASSERT(base <= state->keys.len);
+
+    if (!bson_iter_init(&iter, &state->paths)) {
+        return false;
+    }
+    while (bson_iter_next(&iter)) {
+        if (_path_selects(bson_iter_utf8(&iter, NULL),
+                          &_mc_array_index(&state->keys, const char *, base),
+                          state->keys.len - base)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* @base_offset is the offset of the document or array iterated by @iter. */
+static bool
+_select_recurse(_select_state_t *state, bson_iter_t *iter, uint32_t base_offset, bool is_array, size_t base) {
+    mongocrypt_status_t *status;
+
+    BSON_ASSERT_PARAM(state);
+    BSON_ASSERT_PARAM(iter);
+
+    status = state->status;
+    while (state->next < state->offsets->len && bson_iter_next(iter)) {
+        const uint32_t elem_offset = base_offset + bson_iter_offset(iter);
+        const uint32_t next_offset = _mc_array_index(state->offsets, uint32_t, state->next);
+        bool ret = true;
+
+        if (!is_array) {
+            const char *key = bson_iter_key(iter);
+            _mc_array_append_val(&state->keys, key);
+        }
+
+        if (elem_offset == next_offset) {
+            if (_any_path_selects(state, base)) {
+                _mc_array_append_val(state->selected, elem_offset);
+            }
+            state->next++;
+        } else if (elem_offset < next_offset && (BSON_ITER_HOLDS_ARRAY(iter) || BSON_ITER_HOLDS_DOCUMENT(iter))) {
+            bson_iter_t child;
+            /* The value follows the type byte and the key. */
+            const uint32_t child_offset = elem_offset + 1u + bson_iter_key_len(iter) + 1u;
+            const bool child_is_array = BSON_ITER_HOLDS_ARRAY(iter);
+            size_t child_base = base;
+
+            /* Paths in the documents of a cursor batch start at the document. */
+            if (child_is_array && base == 0 && state->keys.len == 2
+                && 0 == strcmp(_mc_array_index(&state->keys, const char *, 0), "cursor")
+                && (0 == strcmp(_mc_array_index(&state->keys, const char *, 1), "firstBatch")
+                    || 0 == strcmp(_mc_array_index(&state->keys, const char *, 1), "nextBatch"))) {
+                child_base = 2;
+            }
+
+            if (!bson_iter_recurse(iter, &child)) {
+                CLIENT_ERR("error recursing into %s", child_is_array ? "array" : "document");
+                ret = false;
+            } else {
+                ret = _select_recurse(state, &child, child_offset, child_is_array, child_base);
+            }
+        }
+
+        if (!is_array) {
+            state->keys.len--;
+        }
+        if (!ret) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Removes the ciphertexts not selected by opts.decrypt_paths from
+ * dctx->ciphertext_offsets. The container offsets are kept. Containers without
+ * a selected ciphertext are copied unchanged by the transform. */
+static bool _select_ciphertexts_by_path(mongocrypt_ctx_t *ctx, const bson_t *doc) {
+    _mongocrypt_ctx_decrypt_t *dctx;
+    _select_state_t state = {0};
+    mc_array_t selected;
+    bson_iter_t iter;
+    bool ret = false;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(doc);
+
+    dctx = (_mongocrypt_ctx_decrypt_t *)ctx;
+    if (!_mongocrypt_buffer_to_bson(&ctx->opts.decrypt_paths, &state.paths)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "malformed decrypt paths");
+    }
+    if (!bson_iter_init(&iter, doc)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "malformed bson");
+    }
+
+    _mc_array_init(&selected, sizeof(uint32_t));
+    _mc_array_init(&state.keys, sizeof(const char *));
+    state.offsets = &dctx->ciphertext_offsets;
+    state.selected = &selected;
+    state.status = ctx->status;
+    if (!_select_recurse(&state, &iter, 0, false, 0)) {
+        _mongocrypt_ctx_fail(ctx);
+        goto fail;
+    }
+
+    _mc_array_destroy(&dctx->ciphertext_offsets);
+    dctx->ciphertext_offsets = selected;
+    _mc_array_init(&selected, sizeof(uint32_t));
+    ret = true;
+fail:
+    _mc_array_destroy(&state.keys);
+    _mc_array_destroy(&selected);
+    return ret;
+}
+
 static void _cleanup(mongocrypt_ctx_t *ctx) {
     _mongocrypt_ctx_decrypt_t *dctx;
 
@@ -757,6 +1282,33 @@ static void _cleanup(mongocrypt_ctx_t *ctx) {
     dctx = (_mongocrypt_ctx_decrypt_t *)ctx;
     _mongocrypt_buffer_cleanup(&dctx->original_doc);
     _mongocrypt_buffer_cleanup(&dctx->decrypted_doc);
+    _mongocrypt_buffer_cleanup(&dctx->lazy_value);
+    _mc_array_destroy(&dctx->ciphertext_offsets);
+    _mc_array_destroy(&dctx->container_offsets);
+    _mongocrypt_cache_cleanup(&dctx->plaintext_cache);
+}
+
+/* Fails @ctx with @not_binary_msg if @iter is not a BSON binary of subtype 6. */
+static bool _check_explicit_ciphertext(mongocrypt_ctx_t *ctx, bson_iter_t *iter, const char *not_binary_msg) {
+    bson_subtype_t subtype;
+    const uint8_t *binary;
+    uint32_t binary_len;
+    mongocrypt_status_t *status = ctx->status;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(iter);
+    BSON_ASSERT_PARAM(not_binary_msg);
+
+    if (!BSON_ITER_HOLDS_BINARY(iter)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, not_binary_msg);
+    }
+
+    bson_iter_binary(iter, &subtype, &binary_len, &binary);
+    if (subtype != BSON_SUBTYPE_ENCRYPTED) {
+        CLIENT_ERR("decryption expected BSON binary subtype %d, got %d", (int)BSON_SUBTYPE_ENCRYPTED, (int)subtype);
+        return _mongocrypt_ctx_fail(ctx);
+    }
+    return true;
 }
 
 bool mongocrypt_ctx_explicit_decrypt_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *msg) {
@@ -766,6 +1318,7 @@ bool mongocrypt_ctx_explicit_decrypt_init(mongocrypt_ctx_t *ctx, mongocrypt_bina
     if (!ctx) {
         return false;
     }
+    _mongocrypt_ctx_record_init(ctx, "ctx_explicit_decrypt_init", NULL, 0, msg);
 
     if (!msg || !msg->data) {
         return _mongocrypt_ctx_fail_w_msg(ctx, "invalid msg");
@@ -790,26 +1343,579 @@ bool mongocrypt_ctx_explicit_decrypt_init(mongocrypt_ctx_t *ctx, mongocrypt_bina
         return _mongocrypt_ctx_fail_w_msg(ctx, "invalid msg, must contain 'v'");
     }
 
-    if (!BSON_ITER_HOLDS_BINARY(&iter)) {
-        return _mongocrypt_ctx_fail_w_msg(ctx, "invalid msg, 'v' must contain a binary");
+    if (!_check_explicit_ciphertext(ctx, &iter, "invalid msg, 'v' must contain a binary")) {
+        return false;
     }
 
-    {
-        bson_subtype_t subtype;
-        const uint8_t *binary;
-        uint32_t binary_len;
-        mongocrypt_status_t *status = ctx->status;
+    if (!_mongocrypt_buffer_empty(&ctx->opts.decrypt_paths)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "decrypt paths are prohibited on this context");
+    }
 
-        bson_iter_binary(&iter, &subtype, &binary_len, &binary);
-        if (subtype != BSON_SUBTYPE_ENCRYPTED) {
-            CLIENT_ERR("decryption expected BSON binary subtype %d, got %d", (int)BSON_SUBTYPE_ENCRYPTED, (int)subtype);
-            return _mongocrypt_ctx_fail(ctx);
+    if (!mongocrypt_ctx_decrypt_init(ctx, msg)) {
+        return false;
+    }
+    return true;
+}
+
+bool mongocrypt_ctx_explicit_decrypt_value_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *ciphertext) {
+    bson_t msg = BSON_INITIALIZER;
+    mongocrypt_binary_t *bin;
+    bool ret;
+
+    if (!ctx) {
+        bson_destroy(&msg);
+        return false;
+    }
+
+    if (!ciphertext || !ciphertext->data) {
+        bson_destroy(&msg);
+        return _mongocrypt_ctx_fail_w_msg(ctx, "invalid ciphertext");
+    }
+
+    if (!BSON_APPEND_BINARY(&msg, "v", BSON_SUBTYPE_ENCRYPTED, ciphertext->data, ciphertext->len)) {
+        bson_destroy(&msg);
+        return _mongocrypt_ctx_fail_w_msg(ctx, "ciphertext too large");
+    }
+
+    bin = mongocrypt_binary_new_from_data((uint8_t *)bson_get_data(&msg), msg.len);
+    ctx->raw_value = true;
+    ret = mongocrypt_ctx_explicit_decrypt_init(ctx, bin);
+    mongocrypt_binary_destroy(bin);
+    bson_destroy(&msg);
+    return ret;
+}
+
+bool mongocrypt_ctx_explicit_decrypt_batch_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *msg) {
+    bson_iter_t iter;
+    bson_iter_t array_iter;
+    bson_t as_bson;
+    bool any = false;
+
+    if (!ctx) {
+        return false;
+    }
+    _mongocrypt_ctx_record_init(ctx, "ctx_explicit_decrypt_batch_init", NULL, 0, msg);
+
+    if (!msg || !msg->data) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "invalid msg");
+    }
+
+    /* Expect msg to be the BSON a document of the form:
+       { "v" : [ (BSON BINARY value of subtype 6), ... ] }
+       Decryption collects the key IDs of all values before the keys are
+       requested, so each key is fetched once.
+    */
+    if (!_mongocrypt_binary_to_bson(msg, &as_bson)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "malformed bson");
+    }
+
+    if (!bson_iter_init_find(&iter, &as_bson, "v")) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "invalid msg, must contain 'v'");
+    }
+
+    if (!BSON_ITER_HOLDS_ARRAY(&iter) || !bson_iter_recurse(&iter, &array_iter)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "invalid msg, 'v' must be an array");
+    }
+
+    while (bson_iter_next(&array_iter)) {
+        if (!_check_explicit_ciphertext(ctx, &array_iter, "invalid msg, 'v' must only contain binaries")) {
+            return false;
         }
+        any = true;
     }
 
-    if (!mongocrypt_ctx_decrypt_init(ctx, msg)) {
+    if (!any) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "invalid msg, 'v' must not be empty");
+    }
+
+    if (!_mongocrypt_buffer_empty(&ctx->opts.decrypt_paths)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "decrypt paths are prohibited on this context");
+    }
+
+    return mongocrypt_ctx_decrypt_init(ctx, msg);
+}
+
+/* Sets up dctx->stream_iter to iterate the array cursor.firstBatch or
+ * cursor.nextBatch of original_doc. */
+static bool _stream_init(mongocrypt_ctx_t *ctx) {
+    _mongocrypt_ctx_decrypt_t *dctx;
+    bson_t as_bson;
+    bson_iter_t iter;
+    bson_iter_t cursor_iter;
+    uint32_t batch_offset;
+    uint32_t batch_len;
+    const uint8_t *batch_data;
+    bool found = false;
+
+    BSON_ASSERT_PARAM(ctx);
+
+    dctx = (_mongocrypt_ctx_decrypt_t *)ctx;
+    if (!_mongocrypt_buffer_to_bson(&dctx->original_doc, &as_bson)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "malformed bson");
+    }
+
+    if (!bson_iter_init_find(&iter, &as_bson, "cursor") || !BSON_ITER_HOLDS_DOCUMENT(&iter)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "expected document 'cursor' to stream decrypted documents");
+    }
+    if (!bson_iter_recurse(&iter, &cursor_iter)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "malformed bson");
+    }
+
+    while (bson_iter_next(&cursor_iter)) {
+        const char *key = bson_iter_key(&cursor_iter);
+
+        if (0 == strcmp(key, "firstBatch") || 0 == strcmp(key, "nextBatch")) {
+            found = true;
+            break;
+        }
+    }
+    if (!found || !BSON_ITER_HOLDS_ARRAY(&cursor_iter)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx,
+                                          "expected array 'cursor.firstBatch' or 'cursor.nextBatch' to stream "
+                                          "decrypted documents");
+    }
+    bson_iter_array(&cursor_iter, &batch_len, &batch_data);
+    batch_offset = (uint32_t)(batch_data - dctx->original_doc.data);
+
+    /* Only documents of the batch are returned, so no ciphertext may be outside
+     * of it. The offsets are in increasing order. */
+    if (dctx->ciphertext_offsets.len > 0) {
+        const uint32_t first = _mc_array_index(&dctx->ciphertext_offsets, uint32_t, 0);
+        const uint32_t last =
+            _mc_array_index(&dctx->ciphertext_offsets, uint32_t, dctx->ciphertext_offsets.len - 1u);
+
+        if (first <= batch_offset || last >= batch_offset + batch_len) {
+            return _mongocrypt_ctx_fail_w_msg(ctx,
+                                              "cannot stream decrypted documents with ciphertexts outside of the "
+                                              "cursor batch");
+        }
+    }
+
+    if (!bson_iter_recurse(&cursor_iter, &dctx->stream_iter)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "malformed bson");
+    }
+
+    dctx->streaming = true;
+    dctx->stream_next_ciphertext = 0;
+    /* Skip the reply, the cursor, and the batch. */
+    dctx->stream_next_container = 0;
+    while (dctx->stream_next_container < dctx->container_offsets.len
+           && _mc_array_index(&dctx->container_offsets, uint32_t, dctx->stream_next_container) <= batch_offset) {
+        dctx->stream_next_container++;
+    }
+    return true;
+}
+
+bool mongocrypt_ctx_decrypt_next_document(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
+    _mongocrypt_ctx_decrypt_t *dctx;
+    mc_array_t binary_offsets;
+    mc_array_t container_offsets;
+    _mongocrypt_buffer_t in;
+    uint32_t doc_offset;
+    uint32_t doc_len;
+    const uint8_t *doc_data;
+    bool ret;
+
+    if (!ctx) {
+        return false;
+    }
+    if (!ctx->initialized) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "ctx NULL or uninitialized");
+    }
+    if (!out) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "invalid NULL output");
+    }
+    if (ctx->type != _MONGOCRYPT_TYPE_DECRYPT) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "not applicable to context");
+    }
+    if (ctx->state == MONGOCRYPT_CTX_ERROR) {
+        return false;
+    }
+    if (ctx->state != MONGOCRYPT_CTX_READY) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "wrong state");
+    }
+
+    dctx = (_mongocrypt_ctx_decrypt_t *)ctx;
+    if (!dctx->streaming && !_stream_init(ctx)) {
+        return false;
+    }
+
+    _mongocrypt_buffer_cleanup(&dctx->decrypted_doc);
+    _mongocrypt_buffer_init(&dctx->decrypted_doc);
+
+    if (!bson_iter_next(&dctx->stream_iter)) {
+        /* Every document was returned. */
+        out->data = NULL;
+        out->len = 0;
+        ctx->state = MONGOCRYPT_CTX_DONE;
+        return true;
+    }
+
+    if (!BSON_ITER_HOLDS_DOCUMENT(&dctx->stream_iter)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "expected only documents in cursor batch");
+    }
+    bson_iter_document(&dctx->stream_iter, &doc_len, &doc_data);
+    doc_offset = (uint32_t)(doc_data - dctx->original_doc.data);
+
+    /* Take the offsets within this document, relative to its start. */
+    _mc_array_init(&binary_offsets, sizeof(uint32_t));
+    _mc_array_init(&container_offsets, sizeof(uint32_t));
+    while (dctx->stream_next_ciphertext < dctx->ciphertext_offsets.len) {
+        const uint32_t offset = _mc_array_index(&dctx->ciphertext_offsets, uint32_t, dctx->stream_next_ciphertext);
+        if (offset >= doc_offset + doc_len) {
+            break;
+        }
+        const uint32_t relative = offset - doc_offset;
+        _mc_array_append_val(&binary_offsets, relative);
+        dctx->stream_next_ciphertext++;
+    }
+    while (dctx->stream_next_container < dctx->container_offsets.len) {
+        const uint32_t offset = _mc_array_index(&dctx->container_offsets, uint32_t, dctx->stream_next_container);
+        if (offset >= doc_offset + doc_len) {
+            break;
+        }
+        const uint32_t relative = offset - doc_offset;
+        _mc_array_append_val(&container_offsets, relative);
+        dctx->stream_next_container++;
+    }
+
+    _mongocrypt_buffer_init(&in);
+    in.data = (uint8_t *)doc_data;
+    in.len = doc_len;
+    ret = _mongocrypt_transform_binary_at_offsets(_replace_ciphertext_with_plaintext,
+                                                  ctx,
+                                                  &in,
+                                                  &binary_offsets,
+                                                  &container_offsets,
+                                                  &dctx->decrypted_doc,
+                                                  ctx->status);
+    _mc_array_destroy(&binary_offsets);
+    _mc_array_destroy(&container_offsets);
+    if (!ret) {
+        return _mongocrypt_ctx_fail(ctx);
+    }
+
+    _mongocrypt_buffer_to_binary(&dctx->decrypted_doc, out);
+    return true;
+}
+
+/* Checks that @ctx is a decryption context in state MONGOCRYPT_CTX_READY
+ * that has not streamed documents. */
+static bool _check_lazy_decrypt(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
+    BSON_ASSERT_PARAM(ctx);
+
+    if (!ctx->initialized) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "ctx NULL or uninitialized");
+    }
+    if (!out) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "invalid NULL output");
+    }
+    if (ctx->type != _MONGOCRYPT_TYPE_DECRYPT) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "not applicable to context");
+    }
+    if (ctx->state == MONGOCRYPT_CTX_ERROR) {
+        return false;
+    }
+    if (ctx->state != MONGOCRYPT_CTX_READY) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "wrong state");
+    }
+    if (((_mongocrypt_ctx_decrypt_t *)ctx)->streaming) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "cannot decrypt values after streaming decrypted documents");
+    }
+    return true;
+}
+
+/* Sets @key_id to a copy of the ID of the key that decrypts the ciphertext
+ * @in. For FLE2 indexed values, this is the S_KeyId. */
+static bool _ciphertext_key_id(_mongocrypt_buffer_t *in, _mongocrypt_buffer_t *key_id, mongocrypt_status_t *status) {
+    const _mongocrypt_buffer_t *found = NULL;
+    mc_FLE2IndexedEncryptedValue_t *iev = NULL;
+    mc_FLE2IndexedEncryptedValueV2_t *iev_v2 = NULL;
+    mc_FLE2UnindexedEncryptedValue_t *uev = NULL;
+    mc_FLE2UnindexedEncryptedValueV2_t *uev_v2 = NULL;
+    mc_FLE2InsertUpdatePayload_t iup;
+    mc_FLE2InsertUpdatePayloadV2_t iup_v2;
+    _mongocrypt_ciphertext_t ciphertext;
+    bool ret = false;
+
+    BSON_ASSERT_PARAM(in);
+    BSON_ASSERT_PARAM(key_id);
+    BSON_ASSERT(in->data);
+
+    mc_FLE2InsertUpdatePayload_init(&iup);
+    mc_FLE2InsertUpdatePayloadV2_init(&iup_v2);
+    switch (in->data[0]) {
+    // FLE2v2
+    case MC_SUBTYPE_FLE2IndexedEqualityEncryptedValueV2:
+    case MC_SUBTYPE_FLE2IndexedRangeEncryptedValueV2:
+        iev_v2 = mc_FLE2IndexedEncryptedValueV2_new();
+        CHECK_AND_RETURN(iev_v2);
+        CHECK_AND_RETURN(mc_FLE2IndexedEncryptedValueV2_parse_borrowed(iev_v2, in, status));
+        found = mc_FLE2IndexedEncryptedValueV2_get_S_KeyId(iev_v2, status);
+        break;
+    case MC_SUBTYPE_FLE2UnindexedEncryptedValueV2:
+        uev_v2 = mc_FLE2UnindexedEncryptedValueV2_new();
+        CHECK_AND_RETURN(uev_v2);
+        CHECK_AND_RETURN(mc_FLE2UnindexedEncryptedValueV2_parse_borrowed(uev_v2, in, status));
+        found = mc_FLE2UnindexedEncryptedValueV2_get_key_uuid(uev_v2, status);
+        break;
+    case MC_SUBTYPE_FLE2InsertUpdatePayloadV2:
+        CHECK_AND_RETURN(mc_FLE2InsertUpdatePayloadV2_parse(&iup_v2, in, status));
+        found = &iup_v2.userKeyId;
+        break;
+
+    // FLE2v1
+    case MC_SUBTYPE_FLE2IndexedEqualityEncryptedValue:
+    case MC_SUBTYPE_FLE2IndexedRangeEncryptedValue:
+        iev = mc_FLE2IndexedEncryptedValue_new();
+        CHECK_AND_RETURN(iev);
+        CHECK_AND_RETURN(mc_FLE2IndexedEncryptedValue_parse(iev, in, status));
+        found = mc_FLE2IndexedEncryptedValue_get_S_KeyId(iev, status);
+        break;
+    case MC_SUBTYPE_FLE2UnindexedEncryptedValue:
+        uev = mc_FLE2UnindexedEncryptedValue_new();
+        CHECK_AND_RETURN(uev);
+        CHECK_AND_RETURN(mc_FLE2UnindexedEncryptedValue_parse(uev, in, status));
+        found = mc_FLE2UnindexedEncryptedValue_get_key_uuid(uev, status);
+        break;
+    case MC_SUBTYPE_FLE2InsertUpdatePayload:
+        CHECK_AND_RETURN(mc_FLE2InsertUpdatePayload_parse(&iup, in, status));
+        found = &iup.userKeyId;
+        break;
+
+    // FLE1
+    default:
+        CHECK_AND_RETURN(_mongocrypt_ciphertext_parse_unowned(in, &ciphertext, status));
+        found = &ciphertext.key_id;
+        break;
+    }
+    CHECK_AND_RETURN(found);
+
+    _mongocrypt_buffer_copy_to(found, key_id);
+    key_id->subtype = BSON_SUBTYPE_UUID;
+    ret = true;
+fail:
+    mc_FLE2IndexedEncryptedValue_destroy(iev);
+    mc_FLE2IndexedEncryptedValueV2_destroy(iev_v2);
+    mc_FLE2UnindexedEncryptedValue_destroy(uev);
+    mc_FLE2UnindexedEncryptedValueV2_destroy(uev_v2);
+    mc_FLE2InsertUpdatePayload_cleanup(&iup);
+    mc_FLE2InsertUpdatePayloadV2_cleanup(&iup_v2);
+    return ret;
+}
+
+typedef struct {
+    const mc_array_t *offsets;
+    /* next is the index of the ciphertext visited next. */
+    size_t next;
+    bson_t *values;
+} _index_state_t;
+
+static bool _append_index_entry(void *ctx, _mongocrypt_buffer_t *in, mongocrypt_status_t *status) {
+    _index_state_t *state = ctx;
+    _mongocrypt_buffer_t key_id;
+    bson_t entry;
+    char idx_str[32];
+    const char *idx_key;
+    bool ok;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(in);
+    BSON_ASSERT(state->next < state->offsets->len);
+    BSON_ASSERT(state->next <= UINT32_MAX);
+
+    _mongocrypt_buffer_init(&key_id);
+    if (!_ciphertext_key_id(in, &key_id, status)) {
+        return false;
+    }
+
+    const uint32_t offset = _mc_array_index(state->offsets, uint32_t, state->next);
+    (void)bson_uint32_to_string((uint32_t)state->next, &idx_key, idx_str, sizeof idx_str);
+    ok = BSON_APPEND_DOCUMENT_BEGIN(state->values, idx_key, &entry) && BSON_APPEND_INT64(&entry, "offset", offset)
+      && _mongocrypt_buffer_append(&key_id, &entry, "keyId", -1) && bson_append_document_end(state->values, &entry);
+    _mongocrypt_buffer_cleanup(&key_id);
+    if (!ok) {
+        CLIENT_ERR("failed to append index entry");
+        return false;
+    }
+    state->next++;
+    return true;
+}
+
+bool mongocrypt_ctx_decrypt_index(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
+    _mongocrypt_ctx_decrypt_t *dctx;
+    _index_state_t state = {0};
+    bson_t index = BSON_INITIALIZER;
+    bson_t values;
+    bool ret;
+
+    if (!ctx) {
+        return false;
+    }
+    if (!_check_lazy_decrypt(ctx, out)) {
+        return false;
+    }
+
+    dctx = (_mongocrypt_ctx_decrypt_t *)ctx;
+    BSON_ASSERT(BSON_APPEND_ARRAY_BEGIN(&index, "values", &values));
+    state.offsets = &dctx->ciphertext_offsets;
+    state.values = &values;
+    ret = _mongocrypt_traverse_binary_at_offsets(_append_index_entry,
+                                                 &state,
+                                                 &dctx->original_doc,
+                                                 &dctx->ciphertext_offsets,
+                                                 ctx->status);
+    BSON_ASSERT(bson_append_array_end(&index, &values));
+    if (!ret) {
+        bson_destroy(&index);
+        return _mongocrypt_ctx_fail(ctx);
+    }
+
+    _mongocrypt_buffer_cleanup(&dctx->lazy_value);
+    _mongocrypt_buffer_steal_from_bson(&dctx->lazy_value, &index);
+    _mongocrypt_buffer_to_binary(&dctx->lazy_value, out);
+    return true;
+}
+
+typedef struct {
+    _mongocrypt_ctx_decrypt_t *dctx;
+    bson_type_t type;
+    _mongocrypt_buffer_t value;
+} _lazy_value_t;
+
+static bool _decrypt_lazy_value(void *ctx, _mongocrypt_buffer_t *in, mongocrypt_status_t *status) {
+    _lazy_value_t *lv = ctx;
+
+    BSON_ASSERT_PARAM(ctx);
+
+    return _replace_ciphertext_with_plaintext(lv->dctx, in, &lv->type, &lv->value, status);
+}
+
+bool mongocrypt_ctx_decrypt_value_at(mongocrypt_ctx_t *ctx, uint32_t offset, mongocrypt_binary_t *out) {
+    _mongocrypt_ctx_decrypt_t *dctx;
+    _lazy_value_t lv = {0};
+    mc_array_t at;
+    bool found = false;
+    bool ret;
+
+    if (!ctx) {
         return false;
     }
+    if (!_check_lazy_decrypt(ctx, out)) {
+        return false;
+    }
+
+    dctx = (_mongocrypt_ctx_decrypt_t *)ctx;
+    /* Only the ciphertexts found by mongocrypt_ctx_decrypt_init have their keys.
+     * The offsets are in increasing order. */
+    for (size_t lo = 0, hi = dctx->ciphertext_offsets.len; lo < hi && !found;) {
+        const size_t mid = lo + (hi - lo) / 2u;
+        const uint32_t mid_offset = _mc_array_index(&dctx->ciphertext_offsets, uint32_t, mid);
+
+        if (mid_offset < offset) {
+            lo = mid + 1u;
+        } else if (mid_offset > offset) {
+            hi = mid;
+        } else {
+            found = true;
+        }
+    }
+    if (!found) {
+        mongocrypt_status_t *status = ctx->status;
+        CLIENT_ERR("no ciphertext to decrypt at offset %" PRIu32, offset);
+        return _mongocrypt_ctx_fail(ctx);
+    }
+
+    lv.dctx = dctx;
+    _mongocrypt_buffer_init(&lv.value);
+    _mc_array_init(&at, sizeof(uint32_t));
+    _mc_array_append_val(&at, offset);
+    ret = _mongocrypt_traverse_binary_at_offsets(_decrypt_lazy_value, &lv, &dctx->original_doc, &at, ctx->status);
+    _mc_array_destroy(&at);
+    if (!ret) {
+        _mongocrypt_buffer_cleanup(&lv.value);
+        return _mongocrypt_ctx_fail(ctx);
+    }
+
+    /* Return the document { "v": <value> }, like explicit decryption. */
+    {
+        const uint32_t len = 4u + 1u + 2u + lv.value.len + 1u;
+        const uint32_t len_le = BSON_UINT32_TO_LE(len);
+
+        _mongocrypt_buffer_cleanup(&dctx->lazy_value);
+        _mongocrypt_buffer_init_size(&dctx->lazy_value, len);
+        memcpy(dctx->lazy_value.data, &len_le, sizeof(len_le));
+        dctx->lazy_value.data[4] = (uint8_t)lv.type;
+        memcpy(dctx->lazy_value.data + 5, "v", 2);
+        if (lv.value.len > 0) {
+            memcpy(dctx->lazy_value.data + 7, lv.value.data, lv.value.len);
+        }
+        dctx->lazy_value.data[len - 1u] = 0;
+    }
+    _mongocrypt_buffer_cleanup(&lv.value);
+    _mongocrypt_buffer_to_binary(&dctx->lazy_value, out);
+    return true;
+}
+
+struct _mongocrypt_decrypt_plan_t {
+    /* paths holds the documents and arrays that enclosed ciphertexts. */
+    _mongocrypt_path_trie_t *paths;
+    /* key_ids holds the _mongocrypt_buffer_t ids of the keys of the last
+     * decryption. */
+    mc_array_t key_ids;
+};
+
+static void _decrypt_plan_clear_key_ids(mongocrypt_decrypt_plan_t *plan) {
+    for (size_t i = 0; i < plan->key_ids.len; i++) {
+        _mongocrypt_buffer_cleanup(&_mc_array_index(&plan->key_ids, _mongocrypt_buffer_t, i));
+    }
+    plan->key_ids.len = 0;
+}
+
+mongocrypt_decrypt_plan_t *mongocrypt_decrypt_plan_new(void) {
+    mongocrypt_decrypt_plan_t *plan = bson_malloc0(sizeof(*plan));
+
+    plan->paths = _mongocrypt_path_trie_new();
+    _mc_array_init(&plan->key_ids, sizeof(_mongocrypt_buffer_t));
+    return plan;
+}
+
+void mongocrypt_decrypt_plan_destroy(mongocrypt_decrypt_plan_t *plan) {
+    if (!plan) {
+        return;
+    }
+    _decrypt_plan_clear_key_ids(plan);
+    _mc_array_destroy(&plan->key_ids);
+    _mongocrypt_path_trie_destroy(plan->paths);
+    bson_free(plan);
+}
+
+/* Like _mongocrypt_ctx_state_from_key_broker, and records the ids of the keys
+ * of @ctx to its decrypt plan once they are all available. */
+static bool _state_from_key_broker(mongocrypt_ctx_t *ctx) {
+    mongocrypt_decrypt_plan_t *plan;
+
+    BSON_ASSERT_PARAM(ctx);
+
+    if (!_mongocrypt_ctx_state_from_key_broker(ctx)) {
+        return false;
+    }
+    plan = ctx->opts.decrypt_plan;
+    if (!plan || ctx->state != MONGOCRYPT_CTX_READY) {
+        return true;
+    }
+
+    /* Keys of requests by name, and prefetched keys that were not found, are
+     * not recorded. */
+    _decrypt_plan_clear_key_ids(plan);
+    for (key_request_t *req = ctx->kb.key_requests; req; req = req->next) {
+        if (req->satisfied && !req->alt_name && !_mongocrypt_buffer_empty(&req->id)) {
+            _mongocrypt_buffer_t id;
+
+            _mongocrypt_buffer_copy_to(&req->id, &id);
+            _mc_array_append_val(&plan->key_ids, id);
+        }
+    }
     return true;
 }
 
@@ -820,7 +1926,7 @@ static bool _mongo_done_keys(mongocrypt_ctx_t *ctx) {
     if (!_check_for_K_KeyId(ctx)) {
         return false;
     }
-    return _mongocrypt_ctx_state_from_key_broker(ctx);
+    return _state_from_key_broker(ctx);
 }
 
 static bool _kms_done(mongocrypt_ctx_t *ctx) {
@@ -837,20 +1943,73 @@ static bool _kms_done(mongocrypt_ctx_t *ctx) {
     if (!_check_for_K_KeyId(ctx)) {
         return false;
     }
-    return _mongocrypt_ctx_state_from_key_broker(ctx);
+    return _state_from_key_broker(ctx);
+}
+
+/* Finds the ciphertexts of @doc and calls @cb, which may be NULL, for each.
+ * With a decrypt plan, the keys of the plan are requested, and the paths of
+ * the plan are tried before a full traversal. */
+static bool _find_ciphertexts(mongocrypt_ctx_t *ctx, const bson_t *doc, _mongocrypt_traverse_callback_t cb) {
+    _mongocrypt_ctx_decrypt_t *dctx = (_mongocrypt_ctx_decrypt_t *)ctx;
+    mongocrypt_decrypt_plan_t *plan = ctx->opts.decrypt_plan;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(doc);
+
+    if (plan && !_mongocrypt_path_trie_empty(plan->paths)) {
+        bool complete;
+
+        if (!_mongocrypt_traverse_binary_offsets_at_paths(TRAVERSE_MATCH_CIPHERTEXT,
+                                                          doc,
+                                                          plan->paths,
+                                                          &dctx->ciphertext_offsets,
+                                                          &dctx->container_offsets,
+                                                          &complete,
+                                                          ctx->status)) {
+            return _mongocrypt_ctx_fail(ctx);
+        }
+        if (complete) {
+            if (cb
+                && !_mongocrypt_traverse_binary_at_offsets(cb,
+                                                           &ctx->kb,
+                                                           &dctx->original_doc,
+                                                           &dctx->ciphertext_offsets,
+                                                           ctx->status)) {
+                return _mongocrypt_ctx_fail(ctx);
+            }
+            return true;
+        }
+        /* The document may have ciphertexts elsewhere. */
+        dctx->ciphertext_offsets.len = 0;
+        dctx->container_offsets.len = 0;
+    }
+
+    if (!_mongocrypt_traverse_binary_offsets_in_bson(cb,
+                                                     &ctx->kb,
+                                                     TRAVERSE_MATCH_CIPHERTEXT,
+                                                     doc,
+                                                     &dctx->ciphertext_offsets,
+                                                     &dctx->container_offsets,
+                                                     plan ? plan->paths : NULL,
+                                                     ctx->status)) {
+        return _mongocrypt_ctx_fail(ctx);
+    }
+    return true;
 }
 
 bool mongocrypt_ctx_decrypt_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *doc) {
     _mongocrypt_ctx_decrypt_t *dctx;
     bson_t as_bson;
-    bson_iter_t iter = {0};
     _mongocrypt_ctx_opts_spec_t opts_spec;
 
     memset(&opts_spec, 0, sizeof(opts_spec));
     if (!ctx) {
         return false;
     }
+    _mongocrypt_ctx_record_init(ctx, "ctx_decrypt_init", NULL, 0, doc);
 
+    opts_spec.decrypt_paths = OPT_OPTIONAL;
+    opts_spec.decrypt_plan = OPT_OPTIONAL;
     if (!_mongocrypt_ctx_init(ctx, &opts_spec)) {
         return false;
     }
@@ -867,24 +2026,63 @@ bool mongocrypt_ctx_decrypt_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *doc
     }
     dctx = (_mongocrypt_ctx_decrypt_t *)ctx;
     ctx->type = _MONGOCRYPT_TYPE_DECRYPT;
+    _mongocrypt_counter_add(ctx->crypt, MC_COUNTER_CTX_DECRYPT, 1);
     ctx->vtable.finalize = _finalize;
     ctx->vtable.cleanup = _cleanup;
     ctx->vtable.mongo_done_keys = _mongo_done_keys;
     ctx->vtable.kms_done = _kms_done;
 
-    _mongocrypt_buffer_copy_from_binary(&dctx->original_doc, doc);
-    /* get keys. */
+    if (ctx->opts.borrow_input) {
+        _mongocrypt_buffer_from_binary(&dctx->original_doc, doc);
+    } else {
+        _mongocrypt_buffer_copy_from_binary(&dctx->original_doc, doc);
+    }
+    _mongocrypt_counter_add(ctx->crypt, MC_COUNTER_BYTES_DECRYPT, dctx->original_doc.len);
+    _mc_array_init(&dctx->ciphertext_offsets, sizeof(uint32_t));
+    _mc_array_init(&dctx->container_offsets, sizeof(uint32_t));
+    _mongocrypt_cache_plaintext_init(&dctx->plaintext_cache);
+    /* get keys, and record where the ciphertexts are. */
     if (!_mongocrypt_buffer_to_bson(&dctx->original_doc, &as_bson)) {
         return _mongocrypt_ctx_fail_w_msg(ctx, "malformed bson");
     }
 
-    bson_iter_init(&iter, &as_bson);
-    if (!_mongocrypt_traverse_binary_in_bson(_collect_key_from_ciphertext,
-                                             &ctx->kb,
-                                             TRAVERSE_MATCH_CIPHERTEXT,
-                                             &iter,
-                                             ctx->status)) {
-        return _mongocrypt_ctx_fail(ctx);
+    /* Skip the traversal of documents without ciphertexts. They are returned
+     * as is. */
+    if (_mongocrypt_may_contain_subtype6(&dctx->original_doc) && _mongocrypt_buffer_empty(&ctx->opts.decrypt_paths)) {
+        if (!_find_ciphertexts(ctx, &as_bson, _collect_key_from_ciphertext)) {
+            return false;
+        }
+    } else if (_mongocrypt_may_contain_subtype6(&dctx->original_doc)) {
+        /* Only the keys of the ciphertexts selected by the decrypt paths are
+         * requested. The others are returned as is. */
+        if (!_find_ciphertexts(ctx, &as_bson, NULL)) {
+            return false;
+        }
+        if (!_select_ciphertexts_by_path(ctx, &as_bson)) {
+            return false;
+        }
+        if (!_mongocrypt_traverse_binary_at_offsets(_collect_key_from_ciphertext,
+                                                    &ctx->kb,
+                                                    &dctx->original_doc,
+                                                    &dctx->ciphertext_offsets,
+                                                    ctx->status)) {
+            return _mongocrypt_ctx_fail(ctx);
+        }
+    }
+
+    /* Fetch the keys of the previous documents with the keys of this one, so
+     * K_KeyIds are fetched with their S_KeyIds. They are optional, as they may
+     * not be needed. */
+    if (ctx->opts.decrypt_plan && dctx->ciphertext_offsets.len > 0) {
+        const mc_array_t *key_ids = &ctx->opts.decrypt_plan->key_ids;
+
+        for (size_t i = 0; i < key_ids->len; i++) {
+            if (!_mongocrypt_key_broker_request_id_optional(&ctx->kb,
+                                                            &_mc_array_index(key_ids, _mongocrypt_buffer_t, i))) {
+                _mongocrypt_key_broker_status(&ctx->kb, ctx->status);
+                return _mongocrypt_ctx_fail(ctx);
+            }
+        }
     }
 
     (void)_mongocrypt_key_broker_requests_done(&ctx->kb);
@@ -892,5 +2090,5 @@ bool mongocrypt_ctx_decrypt_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *doc
     if (!_check_for_K_KeyId(ctx)) {
         return false;
     }
-    return _mongocrypt_ctx_state_from_key_broker(ctx);
+    return _state_from_key_broker(ctx);
 }
@@ -17,11 +17,15 @@
 #include "mc-efc-private.h"
 #include "mc-fle2-rfds-private.h"
 #include "mc-tokens-private.h"
+#include "mongocrypt-cache-marking-private.h"
+#include "mongocrypt-cache-tokens-private.h"
 #include "mongocrypt-ciphertext-private.h"
 #include "mongocrypt-crypto-private.h"
 #include "mongocrypt-ctx-private.h"
 #include "mongocrypt-key-broker-private.h"
 #include "mongocrypt-marking-private.h"
+#include "mongocrypt-probes-private.h"
+#include "mongocrypt-secure-arena-private.h"
 #include "mongocrypt-traverse-util-private.h"
 #include "mongocrypt-util-private.h" // mc_iter_document_as_bson
 #include "mongocrypt.h"
@@ -94,22 +98,87 @@ static bool _fle2_append_encryptedFieldConfig(const mongocrypt_ctx_t *ctx,
     return true;
 }
 
-static bool _fle2_append_encryptionInformation(const mongocrypt_ctx_t *ctx,
+/* _fle2_get_encryptionInformation_schema sets @out to a view of the "schema"
+ * document of "encryptionInformation". The namespace and encryptedFields of a
+ * context do not change, so the document is built on first use and kept in
+ * @schema_cache. */
+static bool _fle2_get_encryptionInformation_schema(mongocrypt_ctx_t *ctx,
+                                                   const char *target_ns,
+                                                   bson_t *encryptedFieldConfig,
+                                                   const char *target_coll,
+                                                   _mongocrypt_buffer_t *schema_cache,
+                                                   bson_t *out,
+                                                   mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(target_ns);
+    BSON_ASSERT_PARAM(encryptedFieldConfig);
+    BSON_ASSERT_PARAM(target_coll);
+    BSON_ASSERT_PARAM(schema_cache);
+    BSON_ASSERT_PARAM(out);
+
+    if (_mongocrypt_buffer_empty(schema_cache)) {
+        bson_t schema_bson = BSON_INITIALIZER;
+        bson_t encrypted_field_config_bson;
+
+        if (!BSON_APPEND_DOCUMENT_BEGIN(&schema_bson, target_ns, &encrypted_field_config_bson)) {
+            CLIENT_ERR("unable to begin appending 'encryptedFieldConfig' to "
+                       "'encryptionInformation'.'schema'");
+            bson_destroy(&schema_bson);
+            return false;
+        }
+
+        if (!_fle2_append_encryptedFieldConfig(ctx,
+                                               &encrypted_field_config_bson,
+                                               encryptedFieldConfig,
+                                               target_coll,
+                                               status)) {
+            bson_destroy(&schema_bson);
+            return false;
+        }
+
+        if (!bson_append_document_end(&schema_bson, &encrypted_field_config_bson)) {
+            CLIENT_ERR("unable to end appending 'encryptedFieldConfig' to "
+                       "'encryptionInformation'.'schema'");
+            bson_destroy(&schema_bson);
+            return false;
+        }
+        _mongocrypt_buffer_steal_from_bson(schema_cache, &schema_bson);
+    }
+
+    if (!_mongocrypt_buffer_to_bson(schema_cache, out)) {
+        CLIENT_ERR("unable to convert 'encryptionInformation'.'schema' to BSON");
+        return false;
+    }
+    return true;
+}
+
+static bool _fle2_append_encryptionInformation(mongocrypt_ctx_t *ctx,
                                                bson_t *dst,
                                                const char *target_ns,
                                                bson_t *encryptedFieldConfig,
                                                bson_t *deleteTokens,
                                                const char *target_coll,
+                                               _mongocrypt_buffer_t *schema_cache,
                                                mongocrypt_status_t *status) {
     bson_t encryption_information_bson;
     bson_t schema_bson;
-    bson_t encrypted_field_config_bson;
 
     BSON_ASSERT_PARAM(dst);
     BSON_ASSERT_PARAM(target_ns);
     BSON_ASSERT_PARAM(encryptedFieldConfig);
     /* deleteTokens may be NULL */
     BSON_ASSERT_PARAM(target_coll);
+    BSON_ASSERT_PARAM(schema_cache);
+
+    if (!_fle2_get_encryptionInformation_schema(ctx,
+                                                target_ns,
+                                                encryptedFieldConfig,
+                                                target_coll,
+                                                schema_cache,
+                                                &schema_bson,
+                                                status)) {
+        return false;
+    }
 
     if (!BSON_APPEND_DOCUMENT_BEGIN(dst, "encryptionInformation", &encryption_information_bson)) {
         CLIENT_ERR("unable to begin appending 'encryptionInformation'");
@@ -119,32 +188,8 @@ static bool _fle2_append_encryptionInformation(const mongocrypt_ctx_t *ctx,
         CLIENT_ERR("unable to append type to 'encryptionInformation'");
         return false;
     }
-    if (!BSON_APPEND_DOCUMENT_BEGIN(&encryption_information_bson, "schema", &schema_bson)) {
-        CLIENT_ERR("unable to begin appending 'schema' to 'encryptionInformation'");
-        return false;
-    }
-
-    if (!BSON_APPEND_DOCUMENT_BEGIN(&schema_bson, target_ns, &encrypted_field_config_bson)) {
-        CLIENT_ERR("unable to begin appending 'encryptedFieldConfig' to "
-                   "'encryptionInformation'.'schema'");
-        return false;
-    }
-
-    if (!_fle2_append_encryptedFieldConfig(ctx,
-                                           &encrypted_field_config_bson,
-                                           encryptedFieldConfig,
-                                           target_coll,
-                                           status)) {
-        return false;
-    }
-
-    if (!bson_append_document_end(&schema_bson, &encrypted_field_config_bson)) {
-        CLIENT_ERR("unable to end appending 'encryptedFieldConfig' to "
-                   "'encryptionInformation'.'schema'");
-        return false;
-    }
-    if (!bson_append_document_end(&encryption_information_bson, &schema_bson)) {
-        CLIENT_ERR("unable to end appending 'schema' to 'encryptionInformation'");
+    if (!BSON_APPEND_DOCUMENT(&encryption_information_bson, "schema", &schema_bson)) {
+        CLIENT_ERR("unable to append 'schema' to 'encryptionInformation'");
         return false;
     }
 
@@ -175,6 +220,124 @@ static bool _fle2_append_encryptionInformation(const mongocrypt_ctx_t *ctx,
 
 typedef enum { MC_TO_CSFLE, MC_TO_MONGOCRYPTD, MC_TO_MONGOD } mc_cmd_target_t;
 
+/* _fle2_insert_encryptionInformation_bulkWrite appends `encryptionInformation`
+ * inside each `nsInfo` document of a `bulkWrite` command. Each namespace gets
+ * the "schema" of its own encryptedFields. A namespace only given an empty
+ * encryptedFields for query analysis is left without `encryptionInformation`
+ * in the command to mongod. */
+static bool _fle2_insert_encryptionInformation_bulkWrite(mongocrypt_ctx_t *ctx,
+                                                         bson_t *cmd /* in and out */,
+                                                         bson_t *encryptedFieldConfig,
+                                                         bson_t *deleteTokens,
+                                                         mc_cmd_target_t cmd_target,
+                                                         mongocrypt_status_t *status) {
+    _mongocrypt_ctx_encrypt_t *ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+    bson_t out = BSON_INITIALIZER;
+    bson_t nsInfo_array;
+    bson_iter_t iter;
+    uint32_t i = 0;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(cmd);
+    BSON_ASSERT_PARAM(encryptedFieldConfig);
+    /* deleteTokens may be NULL */
+
+    if (!bson_iter_init_find(&iter, cmd, "nsInfo") || !BSON_ITER_HOLDS_ARRAY(&iter)
+        || !bson_iter_recurse(&iter, &iter)) {
+        CLIENT_ERR("expected `nsInfo` array in `bulkWrite`");
+        goto fail;
+    }
+
+    // Append everything from input except `nsInfo`.
+    bson_copy_to_excluding_noinit(cmd, &out, "nsInfo", NULL);
+    if (!BSON_APPEND_ARRAY_BEGIN(&out, "nsInfo", &nsInfo_array)) {
+        CLIENT_ERR("unable to begin appending 'nsInfo' array");
+        goto fail;
+    }
+
+    for (; bson_iter_next(&iter); i++) {
+        bson_t nsInfo; // Non-owning.
+        bson_t nsInfo_out;
+        bson_t ns_efc_bson;
+        bson_t *ns_efc = encryptedFieldConfig;
+        _mongocrypt_buffer_t *schema_cache = &ectx->encryption_information_schema;
+        bool used_empty_encryptedFields = ectx->used_empty_encryptedFields;
+        char storage[16];
+        const char *key;
+
+        if (i >= ectx->bulkWrite_ns_count) {
+            CLIENT_ERR("unexpected namespace in `bulkWrite` at `nsInfo.%" PRIu32 "`", i);
+            goto fail;
+        }
+        _mongocrypt_ctx_encrypt_ns_t *ns = &ectx->bulkWrite_ns[i];
+
+        if (!mc_iter_document_as_bson(&iter, &nsInfo, status)) {
+            goto fail;
+        }
+        // Ensure `nsInfo` does not already have an `encryptionInformation` field.
+        if (bson_has_field(&nsInfo, "encryptionInformation")) {
+            CLIENT_ERR("unexpected `encryptionInformation` present in input `nsInfo`.");
+            goto fail;
+        }
+
+        // The first namespace is the target namespace of the context.
+        if (i > 0) {
+            if (!_mongocrypt_buffer_to_bson(&ns->encrypted_field_config, &ns_efc_bson)) {
+                CLIENT_ERR("unable to convert encryptedFields of '%s' to BSON", ns->ns);
+                goto fail;
+            }
+            ns_efc = &ns_efc_bson;
+            schema_cache = &ns->encryption_information_schema;
+            used_empty_encryptedFields = ns->used_empty_encryptedFields;
+        }
+
+        bson_uint32_to_string(i, &key, storage, sizeof(storage));
+        if (!BSON_APPEND_DOCUMENT_BEGIN(&nsInfo_array, key, &nsInfo_out)) {
+            CLIENT_ERR("unable to append 'nsInfo.%s' document", key);
+            goto fail;
+        }
+        // Copy everything from input `nsInfo`.
+        bson_concat(&nsInfo_out, &nsInfo);
+        // And append `encryptionInformation`.
+        if (!used_empty_encryptedFields || cmd_target != MC_TO_MONGOD) {
+            if (!_fle2_append_encryptionInformation(ctx,
+                                                    &nsInfo_out,
+                                                    ns->ns,
+                                                    ns_efc,
+                                                    i == 0 ? deleteTokens : NULL,
+                                                    ns->coll,
+                                                    schema_cache,
+                                                    status)) {
+                goto fail;
+            }
+        }
+        if (!bson_append_document_end(&nsInfo_array, &nsInfo_out)) {
+            CLIENT_ERR("unable to end appending 'nsInfo' document in array");
+            goto fail;
+        }
+    }
+
+    if (i == 0) {
+        CLIENT_ERR("expected a namespace in `bulkWrite`, but found zero.");
+        goto fail;
+    }
+    if (!bson_append_array_end(&out, &nsInfo_array)) {
+        CLIENT_ERR("unable to end appending 'nsInfo' array");
+        goto fail;
+    }
+    // Overwrite `cmd`.
+    bson_destroy(cmd);
+    if (!bson_steal(cmd, &out)) {
+        CLIENT_ERR("failed to steal BSON with encryptionInformation");
+        goto fail;
+    }
+    return true;
+
+fail:
+    bson_destroy(&out);
+    return false;
+}
+
 /**
  * @brief Add "encryptionInformation" to a command.
  *
@@ -193,7 +356,7 @@ typedef enum { MC_TO_CSFLE, MC_TO_MONGOCRYPTD, MC_TO_MONGOD } mc_cmd_target_t;
  * @return true On success
  * @return false Otherwise. Sets a failing status message in this case.
  */
-static bool _fle2_insert_encryptionInformation(const mongocrypt_ctx_t *ctx,
+static bool _fle2_insert_encryptionInformation(mongocrypt_ctx_t *ctx,
                                                const char *cmd_name,
                                                bson_t *cmd /* in and out */,
                                                const char *target_ns,
@@ -202,6 +365,7 @@ static bool _fle2_insert_encryptionInformation(const mongocrypt_ctx_t *ctx,
                                                const char *target_coll,
                                                mc_cmd_target_t cmd_target,
                                                mongocrypt_status_t *status) {
+    _mongocrypt_ctx_encrypt_t *ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
     bson_t out = BSON_INITIALIZER;
     bson_t explain = BSON_INITIALIZER;
     bson_iter_t iter;
@@ -214,77 +378,17 @@ static bool _fle2_insert_encryptionInformation(const mongocrypt_ctx_t *ctx,
     /* deleteTokens may be NULL */
     BSON_ASSERT_PARAM(target_coll);
 
-    // For `bulkWrite`, append `encryptionInformation` inside the `nsInfo.0` document.
+    // For `bulkWrite`, append `encryptionInformation` inside the `nsInfo` documents.
     if (0 == strcmp(cmd_name, "bulkWrite")) {
-        // Get the single `nsInfo` document from the input command.
-        bson_t nsInfo; // Non-owning.
-        {
-            bson_iter_t nsInfo_iter;
-            if (!bson_iter_init(&nsInfo_iter, cmd)) {
-                CLIENT_ERR("failed to iterate command");
-                goto fail;
-            }
-            if (!bson_iter_find_descendant(&nsInfo_iter, "nsInfo.0", &nsInfo_iter)) {
-                CLIENT_ERR("expected one namespace in `bulkWrite`, but found zero.");
-                goto fail;
-            }
-            if (bson_has_field(cmd, "nsInfo.1")) {
-                CLIENT_ERR(
-                    "expected one namespace in `bulkWrite`, but found more than one. Only one namespace is supported.");
-                goto fail;
-            }
-            if (!mc_iter_document_as_bson(&nsInfo_iter, &nsInfo, status)) {
-                goto fail;
-            }
-            // Ensure `nsInfo` does not already have an `encryptionInformation` field.
-            if (bson_has_field(&nsInfo, "encryptionInformation")) {
-                CLIENT_ERR("unexpected `encryptionInformation` present in input `nsInfo`.");
-                goto fail;
-            }
-        }
-
-        // Copy input and append `encryptionInformation` to `nsInfo`.
-        {
-            // Append everything from input except `nsInfo`.
-            bson_copy_to_excluding_noinit(cmd, &out, "nsInfo", NULL);
-            // Append `nsInfo` array.
-            bson_t nsInfo_array;
-            if (!BSON_APPEND_ARRAY_BEGIN(&out, "nsInfo", &nsInfo_array)) {
-                CLIENT_ERR("unable to begin appending 'nsInfo' array");
-                goto fail;
-            }
-            bson_t nsInfo_array_0;
-            if (!BSON_APPEND_DOCUMENT_BEGIN(&nsInfo_array, "0", &nsInfo_array_0)) {
-                CLIENT_ERR("unable to append 'nsInfo.0' document");
-                goto fail;
-            }
-            // Copy everything from input `nsInfo`.
-            bson_concat(&nsInfo_array_0, &nsInfo);
-            // And append `encryptionInformation`.
-            if (!_fle2_append_encryptionInformation(ctx,
-                                                    &nsInfo_array_0,
-                                                    target_ns,
-                                                    encryptedFieldConfig,
-                                                    deleteTokens,
-                                                    target_coll,
-                                                    status)) {
-                goto fail;
-            }
-            if (!bson_append_document_end(&nsInfo_array, &nsInfo_array_0)) {
-                CLIENT_ERR("unable to end appending 'nsInfo' document in array");
-            }
-            if (!bson_append_array_end(&out, &nsInfo_array)) {
-                CLIENT_ERR("unable to end appending 'nsInfo' array");
-                goto fail;
-            }
-            // Overwrite `cmd`.
-            bson_destroy(cmd);
-            if (!bson_steal(cmd, &out)) {
-                CLIENT_ERR("failed to steal BSON with encryptionInformation");
-                goto fail;
-            }
+        bson_destroy(&out);
+        if (!_fle2_insert_encryptionInformation_bulkWrite(ctx,
+                                                          cmd,
+                                                          encryptedFieldConfig,
+                                                          deleteTokens,
+                                                          cmd_target,
+                                                          status)) {
+            return false;
         }
-
         goto success;
     }
 
@@ -298,6 +402,7 @@ static bool _fle2_insert_encryptionInformation(const mongocrypt_ctx_t *ctx,
                                                 encryptedFieldConfig,
                                                 deleteTokens,
                                                 target_coll,
+                                                &ectx->encryption_information_schema,
                                                 status)) {
             goto fail;
         }
@@ -341,6 +446,7 @@ static bool _fle2_insert_encryptionInformation(const mongocrypt_ctx_t *ctx,
                                             encryptedFieldConfig,
                                             deleteTokens,
                                             target_coll,
+                                            &ectx->encryption_information_schema,
                                             status)) {
         goto fail;
     }
@@ -367,6 +473,136 @@ fail:
     return ok;
 }
 
+/* _bulkWrite_ns_resolved returns true if the schema or encryptedFields of the
+ * `bulkWrite` namespace at @i are known. */
+static bool _bulkWrite_ns_resolved(const _mongocrypt_ctx_encrypt_t *ectx, size_t i) {
+    BSON_ASSERT_PARAM(ectx);
+    BSON_ASSERT(i < ectx->bulkWrite_ns_count);
+
+    if (i == 0) {
+        return !_mongocrypt_buffer_empty(&ectx->encrypted_field_config) || !_mongocrypt_buffer_empty(&ectx->schema);
+    }
+    return ectx->bulkWrite_ns[i].resolved;
+}
+
+/* _bulkWrite_ns_needs_collinfo returns true if the `bulkWrite` namespace at @i
+ * is requested in the current MONGOCRYPT_CTX_NEED_MONGO_COLLINFO_WITH_DB
+ * state. */
+static bool _bulkWrite_ns_needs_collinfo(const _mongocrypt_ctx_encrypt_t *ectx, size_t i) {
+    BSON_ASSERT_PARAM(ectx);
+
+    return ectx->collinfo_db && 0 == strcmp(ectx->bulkWrite_ns[i].db, ectx->collinfo_db)
+        && !_bulkWrite_ns_resolved(ectx, i);
+}
+
+/* _bulkWrite_collinfo_filter returns the `listCollections` filter for all
+ * namespaces requested in the current collinfo state. */
+static bson_t *_bulkWrite_collinfo_filter(const _mongocrypt_ctx_encrypt_t *ectx) {
+    bson_t *filter = bson_new();
+    const char *first = NULL;
+    uint32_t count = 0;
+
+    BSON_ASSERT_PARAM(ectx);
+
+    for (size_t i = 0; i < ectx->bulkWrite_ns_count; i++) {
+        if (_bulkWrite_ns_needs_collinfo(ectx, i)) {
+            first = first ? first : ectx->bulkWrite_ns[i].coll;
+            count++;
+        }
+    }
+    BSON_ASSERT(first);
+
+    if (count == 1) {
+        BSON_ASSERT(BSON_APPEND_UTF8(filter, "name", first));
+        return filter;
+    }
+
+    bson_t name;
+    bson_t in;
+    BSON_ASSERT(BSON_APPEND_DOCUMENT_BEGIN(filter, "name", &name));
+    BSON_ASSERT(BSON_APPEND_ARRAY_BEGIN(&name, "$in", &in));
+    count = 0;
+    for (size_t i = 0; i < ectx->bulkWrite_ns_count; i++) {
+        char storage[16];
+        const char *key;
+
+        if (!_bulkWrite_ns_needs_collinfo(ectx, i)) {
+            continue;
+        }
+        bson_uint32_to_string(count++, &key, storage, sizeof(storage));
+        BSON_ASSERT(BSON_APPEND_UTF8(&in, key, ectx->bulkWrite_ns[i].coll));
+    }
+    BSON_ASSERT(bson_append_array_end(&name, &in));
+    BSON_ASSERT(bson_append_document_end(filter, &name));
+    return filter;
+}
+
+/* _bulkWrite_empty_encryptedFields initializes @out to an empty encryptedFields
+ * for the collection @coll.
+ *
+ * `bulkWrite` is a special case. Sending `bulkWrite` with `jsonSchema` to query analysis results in an error:
+ * `The bulkWrite command only supports Queryable Encryption`
+ *
+ * An empty encryptedFields (rather than an empty JSON schema) ensures `bulkWrite` can be sent to query analysis. */
+static bool _bulkWrite_empty_encryptedFields(const char *coll, bson_t *out, mongocrypt_status_t *status) {
+    char *escCollection = bson_strdup_printf("enxcol_.%s.esc", coll);
+    char *ecocCollection = bson_strdup_printf("enxcol_.%s.ecoc", coll);
+    bson_t empty_array = BSON_INITIALIZER;
+    bool ok = false;
+
+    BSON_ASSERT_PARAM(out);
+
+    bson_init(out);
+    if (!BSON_APPEND_UTF8(out, "escCollection", escCollection)) {
+        CLIENT_ERR("failed to append `escCollection`");
+        goto fail;
+    }
+    if (!BSON_APPEND_UTF8(out, "ecocCollection", ecocCollection)) {
+        CLIENT_ERR("failed to append `ecocCollection`");
+        goto fail;
+    }
+    if (!BSON_APPEND_ARRAY(out, "fields", &empty_array)) {
+        CLIENT_ERR("failed to append `fields`");
+        goto fail;
+    }
+    ok = true;
+
+fail:
+    if (!ok) {
+        bson_destroy(out);
+    }
+    bson_destroy(&empty_array);
+    bson_free(escCollection);
+    bson_free(ecocCollection);
+    return ok;
+}
+
+/* _bulkWrite_set_ns_from_collinfo applies the parsed collection info
+ * @collinfo to a `bulkWrite` namespace other than the target namespace. */
+static bool _bulkWrite_set_ns_from_collinfo(_mongocrypt_ctx_encrypt_ns_t *ns,
+                                            _mongocrypt_cache_collinfo_value_t *collinfo,
+                                            mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(ns);
+    BSON_ASSERT_PARAM(collinfo);
+
+    _mongocrypt_cache_collinfo_value_destroy(ns->collinfo);
+    ns->collinfo = _mongocrypt_cache_collinfo_value_retain(collinfo);
+    _mongocrypt_buffer_cleanup(&ns->encrypted_field_config);
+    ns->used_empty_encryptedFields = _mongocrypt_buffer_empty(&collinfo->encrypted_fields);
+    if (ns->used_empty_encryptedFields) {
+        bson_t empty_encryptedFields;
+
+        if (!_bulkWrite_empty_encryptedFields(ns->coll, &empty_encryptedFields, status)) {
+            return false;
+        }
+        _mongocrypt_buffer_steal_from_bson(&ns->encrypted_field_config, &empty_encryptedFields);
+    } else {
+        _mongocrypt_buffer_set_to(&collinfo->encrypted_fields, &ns->encrypted_field_config);
+    }
+    ns->resolved = true;
+    return true;
+}
+
 /* Construct the list collections command to send. */
 static bool _mongo_op_collinfo(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
     _mongocrypt_ctx_encrypt_t *ectx;
@@ -376,77 +612,50 @@ static bool _mongo_op_collinfo(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out)
     BSON_ASSERT_PARAM(out);
 
     ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
-    cmd = BCON_NEW("name", BCON_UTF8(ectx->target_coll));
+    if (ctx->crypt->opts.prefetch_collinfo) {
+        /* List every collection of the database to fill the cache at once. */
+        cmd = bson_new();
+    } else if (ectx->bulkWrite_ns_count > 1) {
+        /* Request every namespace of `bulkWrite` in the database at once. */
+        cmd = _bulkWrite_collinfo_filter(ectx);
+    } else {
+        cmd = BCON_NEW("name", BCON_UTF8(ectx->target_coll));
+    }
     CRYPT_TRACEF(&ectx->parent.crypt->log, "constructed: %s\n", tmp_json(cmd));
+    /* A `bulkWrite` may request collinfo from more than one database. */
+    _mongocrypt_buffer_cleanup(&ectx->list_collections_filter);
     _mongocrypt_buffer_steal_from_bson(&ectx->list_collections_filter, cmd);
     out->data = ectx->list_collections_filter.data;
     out->len = ectx->list_collections_filter.len;
     return true;
 }
 
-static bool _set_schema_from_collinfo(mongocrypt_ctx_t *ctx, bson_t *collinfo) {
-    bson_iter_t iter;
+/* _set_schema_from_collinfo applies the parsed collection info @collinfo. The
+ * context keeps a reference to @collinfo, and its schema and encryptedFields
+ * view @collinfo. */
+static bool _set_schema_from_collinfo(mongocrypt_ctx_t *ctx, _mongocrypt_cache_collinfo_value_t *collinfo) {
     _mongocrypt_ctx_encrypt_t *ectx;
-    bool found_jsonschema = false;
 
     BSON_ASSERT_PARAM(ctx);
     BSON_ASSERT_PARAM(collinfo);
 
-    /* Parse out the schema. */
     ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
 
-    /* Disallow views. */
-    if (bson_iter_init_find(&iter, collinfo, "type") && BSON_ITER_HOLDS_UTF8(&iter) && bson_iter_utf8(&iter, NULL)
-        && 0 == strcmp("view", bson_iter_utf8(&iter, NULL))) {
-        return _mongocrypt_ctx_fail_w_msg(ctx, "cannot auto encrypt a view");
-    }
+    _mongocrypt_cache_collinfo_value_destroy(ectx->collinfo);
+    ectx->collinfo = _mongocrypt_cache_collinfo_value_retain(collinfo);
 
-    if (!bson_iter_init(&iter, collinfo)) {
-        return _mongocrypt_ctx_fail_w_msg(ctx, "BSON malformed");
+    if (!_mongocrypt_buffer_empty(&collinfo->encrypted_fields)) {
+        _mongocrypt_buffer_cleanup(&ectx->encrypted_field_config);
+        _mongocrypt_buffer_set_to(&collinfo->encrypted_fields, &ectx->encrypted_field_config);
+        ectx->shared_efc = &collinfo->efc;
     }
-
-    if (bson_iter_find_descendant(&iter, "options.encryptedFields", &iter)) {
-        if (!BSON_ITER_HOLDS_DOCUMENT(&iter)) {
-            return _mongocrypt_ctx_fail_w_msg(ctx, "options.encryptedFields is not a BSON document");
-        }
-        if (!_mongocrypt_buffer_copy_from_document_iter(&ectx->encrypted_field_config, &iter)) {
-            return _mongocrypt_ctx_fail_w_msg(ctx, "unable to copy options.encryptedFields");
-        }
-        bson_t efc_bson;
-        if (!_mongocrypt_buffer_to_bson(&ectx->encrypted_field_config, &efc_bson)) {
-            return _mongocrypt_ctx_fail_w_msg(ctx, "unable to create BSON from encrypted_field_config");
-        }
-        if (!mc_EncryptedFieldConfig_parse(&ectx->efc, &efc_bson, ctx->status)) {
-            _mongocrypt_ctx_fail(ctx);
-            return false;
-        }
-    } else if (0 == strcmp(ectx->cmd_name, "bulkWrite")) {
+    if (_mongocrypt_buffer_empty(&collinfo->encrypted_fields) && 0 == strcmp(ectx->cmd_name, "bulkWrite")) {
         ectx->used_empty_encryptedFields = true;
-        // `bulkWrite` is a special case. Sending `bulkWrite` with `jsonSchema` to query analysis results in an error:
-        // `The bulkWrite command only supports Queryable Encryption`
-        //
-        // Add an empty encryptedFields (rather than an empty JSON schema) to ensure `bulkWrite` can be sent to query
-        // analysis.
-        bson_t empty_encryptedFields = BSON_INITIALIZER;
-        {
-            char *escCollection = bson_strdup_printf("enxcol_.%s.esc", ectx->target_coll);
-            char *ecocCollection = bson_strdup_printf("enxcol_.%s.ecoc", ectx->target_coll);
-            bson_t empty_array = BSON_INITIALIZER;
-            if (!BSON_APPEND_UTF8(&empty_encryptedFields, "escCollection", escCollection)) {
-                return _mongocrypt_ctx_fail_w_msg(ctx, "failed to append `escCollection`");
-            }
-            if (!BSON_APPEND_UTF8(&empty_encryptedFields, "ecocCollection", ecocCollection)) {
-                return _mongocrypt_ctx_fail_w_msg(ctx, "failed to append `ecocCollection`");
-            }
-            if (!BSON_APPEND_ARRAY(&empty_encryptedFields, "fields", &empty_array)) {
-                return _mongocrypt_ctx_fail_w_msg(ctx, "failed to append `fields`");
-            }
+        bson_t empty_encryptedFields;
 
-            bson_destroy(&empty_array);
-            bson_free(escCollection);
-            bson_free(ecocCollection);
+        if (!_bulkWrite_empty_encryptedFields(ectx->target_coll, &empty_encryptedFields, ctx->status)) {
+            return _mongocrypt_ctx_fail(ctx);
         }
-
         if (!mc_EncryptedFieldConfig_parse(&ectx->efc, &empty_encryptedFields, ctx->status)) {
             bson_destroy(&empty_encryptedFields);
             _mongocrypt_ctx_fail(ctx);
@@ -455,40 +664,26 @@ static bool _set_schema_from_collinfo(mongocrypt_ctx_t *ctx, bson_t *collinfo) {
         _mongocrypt_buffer_steal_from_bson(&ectx->encrypted_field_config, &empty_encryptedFields);
     }
 
-    BSON_ASSERT(bson_iter_init(&iter, collinfo));
-
-    if (bson_iter_find_descendant(&iter, "options.validator", &iter) && BSON_ITER_HOLDS_DOCUMENT(&iter)) {
-        if (!bson_iter_recurse(&iter, &iter)) {
-            return _mongocrypt_ctx_fail_w_msg(ctx, "BSON malformed");
-        }
-        while (bson_iter_next(&iter)) {
-            const char *key;
-
-            key = bson_iter_key(&iter);
-            BSON_ASSERT(key);
-            if (0 == strcmp("$jsonSchema", key)) {
-                if (found_jsonschema) {
-                    return _mongocrypt_ctx_fail_w_msg(ctx, "duplicate $jsonSchema fields found");
-                }
-                if (!_mongocrypt_buffer_copy_from_document_iter(&ectx->schema, &iter)) {
-                    return _mongocrypt_ctx_fail_w_msg(ctx, "malformed $jsonSchema");
-                }
-                found_jsonschema = true;
-            } else {
-                ectx->collinfo_has_siblings = true;
-            }
-        }
-    }
-
-    if (!found_jsonschema) {
+    ectx->collinfo_has_siblings = collinfo->has_siblings;
+    _mongocrypt_buffer_cleanup(&ectx->schema);
+    if (_mongocrypt_buffer_empty(&collinfo->schema)) {
         bson_t empty = BSON_INITIALIZER;
 
         _mongocrypt_buffer_steal_from_bson(&ectx->schema, &empty);
+    } else {
+        _mongocrypt_buffer_set_to(&collinfo->schema, &ectx->schema);
     }
 
     return true;
 }
 
+/* _get_efc returns the parsed encryptedFields of @ectx. */
+static const mc_EncryptedFieldConfig_t *_get_efc(const _mongocrypt_ctx_encrypt_t *ectx) {
+    BSON_ASSERT_PARAM(ectx);
+
+    return ectx->shared_efc ? ectx->shared_efc : &ectx->efc;
+}
+
 /* get_command_name returns the name of a command. The command name is the first
  * field. For example, the command name of: {"find": "foo", "filter": {"bar":
  * 1}} is "find". */
@@ -578,7 +773,7 @@ static bool _fle2_collect_keys_for_deleteTokens(mongocrypt_ctx_t *ctx) {
 
     mc_EncryptedField_t *field;
 
-    for (field = ectx->efc.fields; field != NULL; field = field->next) {
+    for (field = _get_efc(ectx)->fields; field != NULL; field = field->next) {
         if (field->supported_queries) {
             if (!_mongocrypt_key_broker_request_id(&ctx->kb, &field->keyId)) {
                 _mongocrypt_key_broker_status(&ctx->kb, ctx->status);
@@ -615,7 +810,7 @@ static bool _fle2_collect_keys_for_compaction(mongocrypt_ctx_t *ctx) {
 
     mc_EncryptedField_t *field;
 
-    for (field = ectx->efc.fields; field != NULL; field = field->next) {
+    for (field = _get_efc(ectx)->fields; field != NULL; field = field->next) {
         if (!_mongocrypt_key_broker_request_id(&ctx->kb, &field->keyId)) {
             _mongocrypt_key_broker_status(&ctx->kb, ctx->status);
             _mongocrypt_ctx_fail(ctx);
@@ -625,78 +820,438 @@ static bool _fle2_collect_keys_for_compaction(mongocrypt_ctx_t *ctx) {
     return true;
 }
 
-static bool _mongo_feed_collinfo(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *in) {
-    bson_t as_bson;
+/* Cache the parsed collinfo of the namespace @ns. */
+static bool _cache_collinfo(mongocrypt_ctx_t *ctx, const char *ns, _mongocrypt_cache_collinfo_value_t *collinfo) {
+    uint64_t expiration_ms;
 
-    _mongocrypt_ctx_encrypt_t *ectx;
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(ns);
+    BSON_ASSERT_PARAM(collinfo);
+
+    expiration_ms = ctx->crypt->opts.unencrypted_collinfo_expiration_ms;
+    if (expiration_ms > 0 && _mongocrypt_buffer_empty(&collinfo->encrypted_fields)
+        && _mongocrypt_buffer_empty(&collinfo->schema)) {
+        return _mongocrypt_cache_add_copy_with_expiration(&ctx->crypt->cache_collinfo,
+                                                          (void *)ns,
+                                                          collinfo,
+                                                          expiration_ms,
+                                                          ctx->status);
+    }
+    return _mongocrypt_cache_add_copy(&ctx->crypt->cache_collinfo, (void *)ns, collinfo, ctx->status);
+}
+
+/* Cache the collinfo @in of the collection @name in the database @db. The
+ * context does not apply it. A collection that cannot be auto encrypted, such
+ * as a view, is not cached. Its error is reported if the context needs it. */
+static bool _cache_other_collinfo(mongocrypt_ctx_t *ctx, const char *db, const char *name, const bson_t *in) {
+    mongocrypt_status_t *status = mongocrypt_status_new();
+    _mongocrypt_cache_collinfo_value_t *collinfo;
+    char *ns;
+    bool ok;
 
     BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(db);
+    BSON_ASSERT_PARAM(name);
     BSON_ASSERT_PARAM(in);
 
-    ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
-    if (!bson_init_static(&as_bson, in->data, in->len)) {
-        return _mongocrypt_ctx_fail_w_msg(ctx, "BSON malformed");
+    collinfo = _mongocrypt_cache_collinfo_value_new(in, status);
+    mongocrypt_status_destroy(status);
+    if (!collinfo) {
+        return true;
     }
-
-    /* Cache the received collinfo. */
-    if (!_mongocrypt_cache_add_copy(&ctx->crypt->cache_collinfo, ectx->target_ns, &as_bson, ctx->status)) {
+    ns = bson_strdup_printf("%s.%s", db, name);
+    ok = _cache_collinfo(ctx, ns, collinfo);
+    bson_free(ns);
+    _mongocrypt_cache_collinfo_value_destroy(collinfo);
+    if (!ok) {
         return _mongocrypt_ctx_fail(ctx);
     }
-
-    if (!_set_schema_from_collinfo(ctx, &as_bson)) {
-        return false;
-    }
-
     return true;
 }
 
-static bool _try_run_csfle_marking(mongocrypt_ctx_t *ctx);
-
-static bool _mongo_done_collinfo(mongocrypt_ctx_t *ctx) {
-    _mongocrypt_ctx_encrypt_t *ectx;
+/* _bulkWrite_feed_collinfo applies the collinfo @in to every `bulkWrite`
+ * namespace it describes in the current collinfo state. */
+static bool _bulkWrite_feed_collinfo(mongocrypt_ctx_t *ctx, const bson_t *in) {
+    _mongocrypt_ctx_encrypt_t *ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+    _mongocrypt_cache_collinfo_value_t *collinfo;
+    bson_iter_t iter;
+    const char *name;
+    bool needed = false;
+    char *ns;
 
     BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(in);
 
-    ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
-    if (_mongocrypt_buffer_empty(&ectx->schema)) {
-        bson_t empty_collinfo = BSON_INITIALIZER;
-
-        /* If no collinfo was fed, apply and cache an empty collinfo. */
-        if (!_set_schema_from_collinfo(ctx, &empty_collinfo)) {
-            bson_destroy(&empty_collinfo);
-            return false;
-        }
-        if (!_mongocrypt_cache_add_copy(&ctx->crypt->cache_collinfo, ectx->target_ns, &empty_collinfo, ctx->status)) {
-            bson_destroy(&empty_collinfo);
-            return _mongocrypt_ctx_fail(ctx);
+    if (!bson_iter_init_find(&iter, in, "name") || !BSON_ITER_HOLDS_UTF8(&iter)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "expected collinfo to have UTF-8 'name'");
+    }
+    name = bson_iter_utf8(&iter, NULL);
+    for (size_t i = 0; i < ectx->bulkWrite_ns_count; i++) {
+        if (_bulkWrite_ns_needs_collinfo(ectx, i) && 0 == strcmp(ectx->bulkWrite_ns[i].coll, name)) {
+            needed = true;
         }
-        bson_destroy(&empty_collinfo);
     }
-
-    if (!_fle2_collect_keys_for_deleteTokens(ctx)) {
-        return false;
+    if (!needed) {
+        return _cache_other_collinfo(ctx, ectx->collinfo_db, name, in);
     }
 
-    if (!_fle2_collect_keys_for_compaction(ctx)) {
-        return false;
+    collinfo = _mongocrypt_cache_collinfo_value_new(in, ctx->status);
+    if (!collinfo) {
+        return _mongocrypt_ctx_fail(ctx);
     }
-
+    ns = bson_strdup_printf("%s.%s", ectx->collinfo_db, name);
+    if (!_cache_collinfo(ctx, ns, collinfo)) {
+        bson_free(ns);
+        _mongocrypt_cache_collinfo_value_destroy(collinfo);
+        return _mongocrypt_ctx_fail(ctx);
+    }
+    bson_free(ns);
+
+    for (size_t i = 0; i < ectx->bulkWrite_ns_count; i++) {
+        if (!_bulkWrite_ns_needs_collinfo(ectx, i) || 0 != strcmp(ectx->bulkWrite_ns[i].coll, name)) {
+            continue;
+        }
+        if (i == 0) {
+            if (!_set_schema_from_collinfo(ctx, collinfo)) {
+                _mongocrypt_cache_collinfo_value_destroy(collinfo);
+                return false;
+            }
+        } else if (!_bulkWrite_set_ns_from_collinfo(&ectx->bulkWrite_ns[i], collinfo, ctx->status)) {
+            _mongocrypt_cache_collinfo_value_destroy(collinfo);
+            return _mongocrypt_ctx_fail(ctx);
+        }
+    }
+    _mongocrypt_cache_collinfo_value_destroy(collinfo);
+    return true;
+}
+
+static bool _mongo_feed_collinfo(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *in) {
+    _mongocrypt_ctx_encrypt_t *ectx;
+    _mongocrypt_cache_collinfo_value_t *collinfo;
+    bson_t as_bson;
+    bool ok;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(in);
+
+    ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+    if (!bson_init_static(&as_bson, in->data, in->len)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "BSON malformed");
+    }
+
+    if (ectx->bulkWrite_ns_count > 1) {
+        return _bulkWrite_feed_collinfo(ctx, &as_bson);
+    }
+
+    if (ctx->crypt->opts.prefetch_collinfo) {
+        /* The reply lists every collection of the database. Cache each, and
+         * only apply the target collection. */
+        bson_iter_t iter;
+        const char *name;
+
+        if (!bson_iter_init_find(&iter, &as_bson, "name") || !BSON_ITER_HOLDS_UTF8(&iter)) {
+            return _mongocrypt_ctx_fail_w_msg(ctx, "expected collinfo to have UTF-8 'name'");
+        }
+        name = bson_iter_utf8(&iter, NULL);
+        if (0 != strcmp(name, ectx->target_coll)) {
+            return _cache_other_collinfo(ctx, ectx->target_db ? ectx->target_db : ectx->cmd_db, name, &as_bson);
+        }
+    }
+
+    collinfo = _mongocrypt_cache_collinfo_value_new(&as_bson, ctx->status);
+    if (!collinfo) {
+        return _mongocrypt_ctx_fail(ctx);
+    }
+
+    /* Cache the received collinfo. */
+    if (!_cache_collinfo(ctx, ectx->target_ns, collinfo)) {
+        _mongocrypt_cache_collinfo_value_destroy(collinfo);
+        return _mongocrypt_ctx_fail(ctx);
+    }
+
+    ok = _set_schema_from_collinfo(ctx, collinfo);
+    _mongocrypt_cache_collinfo_value_destroy(collinfo);
+    return ok;
+}
+
+static bool _try_run_csfle_marking(mongocrypt_ctx_t *ctx);
+
+static bool _key_id_in(const bson_t *key_ids, const _mongocrypt_buffer_t *key_id);
+
+static bool _key_id_cached(mongocrypt_t *crypt, const _mongocrypt_buffer_t *key_id);
+
+static bool _state_after_markings(mongocrypt_ctx_t *ctx);
+
+/* _append_efc_key_ids appends the key IDs of @efc to @key_ids that are not
+ * already in @key_ids or cached. */
+static void _append_efc_key_ids(mongocrypt_t *crypt, const mc_EncryptedFieldConfig_t *efc, bson_t *key_ids) {
+    BSON_ASSERT_PARAM(crypt);
+    BSON_ASSERT_PARAM(efc);
+    BSON_ASSERT_PARAM(key_ids);
+
+    for (const mc_EncryptedField_t *field = efc->fields; field != NULL; field = field->next) {
+        char storage[16];
+        const char *key;
+
+        /* Fields may share a key. */
+        if (_key_id_in(key_ids, &field->keyId) || _key_id_cached(crypt, &field->keyId)) {
+            continue;
+        }
+        bson_uint32_to_string(bson_count_keys(key_ids), &key, storage, sizeof(storage));
+        BSON_ASSERT(_mongocrypt_buffer_append(&field->keyId, key_ids, key, -1));
+    }
+}
+
+/* _bulkWrite_need_ops enters MONGOCRYPT_CTX_NEED_MONGO_OPS with a collinfo
+ * operation for each database of an unresolved `bulkWrite` namespace, and a key
+ * operation for the keys of the namespaces already resolved. The keys are
+ * likely needed after markings, and are fetched along with the collinfo. */
+static bool _bulkWrite_need_ops(mongocrypt_ctx_t *ctx) {
+    _mongocrypt_ctx_encrypt_t *ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+    bson_t key_ids = BSON_INITIALIZER;
+
+    BSON_ASSERT_PARAM(ctx);
+
+    _mongocrypt_ctx_clear_mongo_ops(ctx);
+    for (size_t i = 0; i < ectx->bulkWrite_ns_count; i++) {
+        bool seen = false;
+        bson_t *filter;
+
+        if (_bulkWrite_ns_resolved(ectx, i)) {
+            continue;
+        }
+        for (size_t j = 0; j < i; j++) {
+            if (!_bulkWrite_ns_resolved(ectx, j) && 0 == strcmp(ectx->bulkWrite_ns[j].db, ectx->bulkWrite_ns[i].db)) {
+                seen = true;
+            }
+        }
+        if (seen) {
+            continue;
+        }
+        ectx->collinfo_db = ectx->bulkWrite_ns[i].db;
+        filter = _bulkWrite_collinfo_filter(ectx);
+        _mongocrypt_ctx_add_mongo_op(ctx, MONGOCRYPT_CTX_NEED_MONGO_COLLINFO_WITH_DB, ectx->collinfo_db, filter);
+        bson_destroy(filter);
+    }
+    ectx->collinfo_db = NULL;
+
+    for (size_t i = 0; i < ectx->bulkWrite_ns_count; i++) {
+        const _mongocrypt_buffer_t *efc_buf =
+            i == 0 ? &ectx->encrypted_field_config : &ectx->bulkWrite_ns[i].encrypted_field_config;
+        mc_EncryptedFieldConfig_t efc;
+        bson_t efc_bson;
+
+        if (!_bulkWrite_ns_resolved(ectx, i) || _mongocrypt_buffer_empty(efc_buf)) {
+            continue;
+        }
+        if (i == 0) {
+            _append_efc_key_ids(ctx->crypt, _get_efc(ectx), &key_ids);
+            continue;
+        }
+        if (!_mongocrypt_buffer_to_bson(efc_buf, &efc_bson)) {
+            bson_destroy(&key_ids);
+            return _mongocrypt_ctx_fail_w_msg(ctx, "unable to convert encryptedFields to BSON");
+        }
+        if (!mc_EncryptedFieldConfig_parse(&efc, &efc_bson, ctx->status)) {
+            bson_destroy(&key_ids);
+            return _mongocrypt_ctx_fail(ctx);
+        }
+        _append_efc_key_ids(ctx->crypt, &efc, &key_ids);
+        mc_EncryptedFieldConfig_cleanup(&efc);
+    }
+    if (!bson_empty(&key_ids)) {
+        bson_t *filter = BCON_NEW("_id", "{", "$in", BCON_ARRAY(&key_ids), "}");
+
+        _mongocrypt_ctx_add_mongo_op(ctx, MONGOCRYPT_CTX_NEED_MONGO_KEYS, NULL, filter);
+        bson_destroy(filter);
+    }
+    bson_destroy(&key_ids);
+
+    ctx->state = MONGOCRYPT_CTX_NEED_MONGO_OPS;
+    return true;
+}
+
+/* _bulkWrite_need_collinfo enters MONGOCRYPT_CTX_NEED_MONGO_COLLINFO_WITH_DB
+ * for the database of the first unresolved `bulkWrite` namespace, and sets
+ * `collinfo_db`. If opted in, it instead enters MONGOCRYPT_CTX_NEED_MONGO_OPS
+ * for all databases. If all namespaces are resolved, `collinfo_db` is NULL and
+ * the state is unchanged. */
+static bool _bulkWrite_need_collinfo(mongocrypt_ctx_t *ctx) {
+    _mongocrypt_ctx_encrypt_t *ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+
+    BSON_ASSERT_PARAM(ctx);
+
+    ectx->collinfo_db = NULL;
+    for (size_t i = 0; i < ectx->bulkWrite_ns_count; i++) {
+        if (_bulkWrite_ns_resolved(ectx, i)) {
+            continue;
+        }
+        if (!ctx->crypt->opts.use_need_mongo_collinfo_with_db_state) {
+            return _mongocrypt_ctx_fail_w_msg(
+                ctx,
+                "Fetching remote collection information on separate databases is not supported. Try "
+                "upgrading driver, or specify a local schemaMap or encryptedFieldsMap.");
+        }
+        if (ctx->crypt->opts.use_need_mongo_ops_state) {
+            return _bulkWrite_need_ops(ctx);
+        }
+        ectx->collinfo_db = ectx->bulkWrite_ns[i].db;
+        ctx->state = MONGOCRYPT_CTX_NEED_MONGO_COLLINFO_WITH_DB;
+        return true;
+    }
+    return true;
+}
+
+/* _bulkWrite_apply_empty_collinfo applies an empty collinfo to each namespace
+ * requested in the current collinfo state that was not fed. */
+static bool _bulkWrite_apply_empty_collinfo(mongocrypt_ctx_t *ctx) {
+    _mongocrypt_ctx_encrypt_t *ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+    _mongocrypt_cache_collinfo_value_t *empty_collinfo;
+    bson_t empty = BSON_INITIALIZER;
+
+    BSON_ASSERT_PARAM(ctx);
+
+    empty_collinfo = _mongocrypt_cache_collinfo_value_new(&empty, ctx->status);
+    if (!empty_collinfo) {
+        return _mongocrypt_ctx_fail(ctx);
+    }
+    for (size_t i = 0; i < ectx->bulkWrite_ns_count; i++) {
+        _mongocrypt_ctx_encrypt_ns_t *ns = &ectx->bulkWrite_ns[i];
+
+        if (!_bulkWrite_ns_needs_collinfo(ectx, i)) {
+            continue;
+        }
+        if (i == 0) {
+            if (!_set_schema_from_collinfo(ctx, empty_collinfo)) {
+                _mongocrypt_cache_collinfo_value_destroy(empty_collinfo);
+                return false;
+            }
+        } else if (!_bulkWrite_set_ns_from_collinfo(ns, empty_collinfo, ctx->status)) {
+            _mongocrypt_cache_collinfo_value_destroy(empty_collinfo);
+            return _mongocrypt_ctx_fail(ctx);
+        }
+        if (!_cache_collinfo(ctx, ns->ns, empty_collinfo)) {
+            _mongocrypt_cache_collinfo_value_destroy(empty_collinfo);
+            return _mongocrypt_ctx_fail(ctx);
+        }
+    }
+    _mongocrypt_cache_collinfo_value_destroy(empty_collinfo);
+    return true;
+}
+
+/* _bulkWrite_done_collinfo finishes the current collinfo state, and requests
+ * collinfo from the next database if needed. */
+static bool _bulkWrite_done_collinfo(mongocrypt_ctx_t *ctx) {
+    BSON_ASSERT_PARAM(ctx);
+
+    if (!_bulkWrite_apply_empty_collinfo(ctx)) {
+        return false;
+    }
+    return _bulkWrite_need_collinfo(ctx);
+}
+
+static bool _mongo_done_collinfo(mongocrypt_ctx_t *ctx) {
+    _mongocrypt_ctx_encrypt_t *ectx;
+
+    BSON_ASSERT_PARAM(ctx);
+
+    ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+    if (ectx->bulkWrite_ns_count > 1) {
+        if (!_bulkWrite_done_collinfo(ctx)) {
+            return false;
+        }
+        if (ectx->collinfo_db || ctx->mongo_ops_len > 0) {
+            /* Namespaces of another database remain. */
+            return true;
+        }
+    } else if (_mongocrypt_buffer_empty(&ectx->schema)) {
+        bson_t empty = BSON_INITIALIZER;
+        _mongocrypt_cache_collinfo_value_t *empty_collinfo;
+
+        /* If no collinfo was fed, apply and cache an empty collinfo. */
+        empty_collinfo = _mongocrypt_cache_collinfo_value_new(&empty, ctx->status);
+        if (!empty_collinfo) {
+            return _mongocrypt_ctx_fail(ctx);
+        }
+        if (!_set_schema_from_collinfo(ctx, empty_collinfo)) {
+            _mongocrypt_cache_collinfo_value_destroy(empty_collinfo);
+            return false;
+        }
+        if (!_cache_collinfo(ctx, ectx->target_ns, empty_collinfo)) {
+            _mongocrypt_cache_collinfo_value_destroy(empty_collinfo);
+            return _mongocrypt_ctx_fail(ctx);
+        }
+        _mongocrypt_cache_collinfo_value_destroy(empty_collinfo);
+    }
+
+    if (!_fle2_collect_keys_for_deleteTokens(ctx)) {
+        return false;
+    }
+
+    if (!_fle2_collect_keys_for_compaction(ctx)) {
+        return false;
+    }
+
     if (ectx->bypass_query_analysis) {
         /* Keys may have been requested for deleteTokens or compactionTokens.
          * Finish key requests. */
-        _mongocrypt_key_broker_requests_done(&ctx->kb);
-        return _mongocrypt_ctx_state_from_key_broker(ctx);
+        return _state_after_markings(ctx);
     }
     ectx->parent.state = MONGOCRYPT_CTX_NEED_MONGO_MARKINGS;
     return _try_run_csfle_marking(ctx);
 }
 
+/* _mongo_feed_op applies a collinfo reply of a collinfo operation of
+ * MONGOCRYPT_CTX_NEED_MONGO_OPS. */
+static bool _mongo_feed_op(mongocrypt_ctx_t *ctx, mongocrypt_mongo_op_t *op, mongocrypt_binary_t *in) {
+    _mongocrypt_ctx_encrypt_t *ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+    bson_t as_bson;
+    bool ok;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(op);
+    BSON_ASSERT_PARAM(in);
+
+    if (!bson_init_static(&as_bson, in->data, in->len)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "BSON malformed");
+    }
+    ectx->collinfo_db = op->db;
+    ok = _bulkWrite_feed_collinfo(ctx, &as_bson);
+    ectx->collinfo_db = NULL;
+    return ok;
+}
+
+static bool _mongo_done_op(mongocrypt_ctx_t *ctx, mongocrypt_mongo_op_t *op) {
+    _mongocrypt_ctx_encrypt_t *ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+    bool ok;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(op);
+
+    ectx->collinfo_db = op->db;
+    ok = _bulkWrite_apply_empty_collinfo(ctx);
+    ectx->collinfo_db = NULL;
+    return ok;
+}
+
+/* _mongo_done_ops continues as after the last collinfo state. The key
+ * documents fed to a key operation are added once markings request them. */
+static bool _mongo_done_ops(mongocrypt_ctx_t *ctx) {
+    BSON_ASSERT_PARAM(ctx);
+
+    _mongocrypt_ctx_clear_mongo_ops(ctx);
+    return _mongo_done_collinfo(ctx);
+}
+
 static const char *_mongo_db_collinfo(mongocrypt_ctx_t *ctx) {
     _mongocrypt_ctx_encrypt_t *ectx;
 
     BSON_ASSERT_PARAM(ctx);
 
     ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+    if (ectx->collinfo_db) {
+        return ectx->collinfo_db;
+    }
     if (!ectx->target_db) {
         _mongocrypt_ctx_fail_w_msg(ctx, "Expected target database for `listCollections`, but none exists.");
         return NULL;
@@ -773,12 +1328,27 @@ static bool _create_markings_cmd_bson(mongocrypt_ctx_t *ctx, bson_t *out) {
         return false;
     }
 
+    // Schemas may be large. Allocate the output once, with room for the
+    // command, the schema, and the fields appended here and by _add_dollar_db.
+    uint64_t reserve = (uint64_t)ectx->original_cmd.len + ectx->schema.len + 64u;
+    if (ectx->cmd_db) {
+        reserve += strlen(ectx->cmd_db);
+    }
+    if (reserve > (uint64_t)INT32_MAX) {
+        reserve = (uint64_t)INT32_MAX;
+    }
+    bson_steal(out, bson_sized_new((size_t)reserve));
+
     // Copy the command to the output
     // If input command included $db, do not include it in the command to
     // mongocryptd. Drivers are expected to append $db in the RunCommand helper
     // used to send the command.
-    bson_init(out);
-    bson_copy_to_excluding_noinit(&bson_view, out, "$db", NULL);
+    if (bson_has_field(&bson_view, "$db")) {
+        bson_copy_to_excluding_noinit(&bson_view, out, "$db", NULL);
+    } else if (!bson_concat(out, &bson_view)) {
+        _mongocrypt_ctx_fail_w_msg(ctx, "unable to copy cmd");
+        return false;
+    }
 
     if (!_mongocrypt_buffer_empty(&ectx->schema)) {
         // We have a schema buffer. View it as BSON:
@@ -786,7 +1356,9 @@ static bool _create_markings_cmd_bson(mongocrypt_ctx_t *ctx, bson_t *out) {
             _mongocrypt_ctx_fail_w_msg(ctx, "invalid BSON schema");
             return false;
         }
-        // Append the jsonSchema to the output command
+        // Append the jsonSchema to the output command. ectx->schema views the
+        // serialized schema of the collinfo cache or schema map, so this
+        // copies its bytes once.
         BSON_APPEND_DOCUMENT(out, "jsonSchema", &bson_view);
     } else {
         bson_t empty = BSON_INITIALIZER;
@@ -837,19 +1409,26 @@ static bool _mongo_op_markings(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out)
 
 static bool _collect_key_from_marking(void *ctx, _mongocrypt_buffer_t *in, mongocrypt_status_t *status) {
     _mongocrypt_marking_t marking;
+    _mongocrypt_ctx_encrypt_t *ectx;
     _mongocrypt_key_broker_t *kb;
     bool res;
 
     BSON_ASSERT_PARAM(ctx);
     BSON_ASSERT_PARAM(in);
 
-    kb = (_mongocrypt_key_broker_t *)ctx;
+    ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+    kb = &ectx->parent.kb;
 
     if (!_mongocrypt_marking_parse_unowned(in, &marking, status)) {
         _mongocrypt_marking_cleanup(&marking);
         return false;
     }
 
+    ectx->ciphertext_len_estimate += _mongocrypt_marking_ciphertext_len_estimate(&marking, in);
+    if (_mongocrypt_marking_is_find_equality(&marking) && ectx->find_equality_markings < UINT32_MAX) {
+        ectx->find_equality_markings++;
+    }
+
     if (marking.type == MONGOCRYPT_MARKING_FLE1_BY_ID) {
         res = _mongocrypt_key_broker_request_id(kb, &marking.key_id);
     } else if (marking.type == MONGOCRYPT_MARKING_FLE1_BY_ALTNAME) {
@@ -871,7 +1450,9 @@ static bool _collect_key_from_marking(void *ctx, _mongocrypt_buffer_t *in, mongo
     return true;
 }
 
-static bool _mongo_feed_markings(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *in) {
+/* Feeds the query analysis reply @in. If @borrowed, the marked command views
+ * @in, which the caller keeps alive until finalize. */
+static bool _feed_markings_reply(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *in, bool borrowed) {
     /* Find keys. */
     bson_t as_bson;
     bson_iter_t iter = {0};
@@ -928,15 +1509,18 @@ static bool _mongo_feed_markings(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *in)
         return _mongocrypt_ctx_fail_w_msg(ctx, "malformed marking, no 'result'");
     }
 
-    if (!_mongocrypt_buffer_copy_from_document_iter(&ectx->marked_cmd, &iter)) {
+    if (borrowed ? !_mongocrypt_buffer_from_document_iter(&ectx->marked_cmd, &iter)
+                 : !_mongocrypt_buffer_copy_from_document_iter(&ectx->marked_cmd, &iter)) {
         return _mongocrypt_ctx_fail_w_msg(ctx, "malformed marking, 'result' must be a document");
     }
 
     if (!bson_iter_recurse(&iter, &iter)) {
         return _mongocrypt_ctx_fail_w_msg(ctx, "malformed marking, could not recurse into 'result'");
     }
+    ectx->ciphertext_len_estimate = 0;
+    ectx->find_equality_markings = 0;
     if (!_mongocrypt_traverse_binary_in_bson(_collect_key_from_marking,
-                                             (void *)&ctx->kb,
+                                             (void *)ectx,
                                              TRAVERSE_MATCH_MARKING,
                                              &iter,
                                              ctx->status)) {
@@ -946,8 +1530,75 @@ static bool _mongo_feed_markings(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *in)
     return true;
 }
 
+/* Adds the query analysis reply @in, stripped of marked values, to the marking
+ * cache if replaying it onto its own command returns it unchanged. */
+static bool _cache_markings_reply(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *in) {
+    _mongocrypt_ctx_encrypt_t *ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+    _mongocrypt_buffer_t reply;
+    _mongocrypt_buffer_t replayed;
+    _mongocrypt_buffer_t stripped;
+    bson_t cmd_bson;
+    bool ok = true;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(in);
+
+    if (_mongocrypt_buffer_empty(&ectx->marking_cache_key)) {
+        return true;
+    }
+
+    if (!_mongocrypt_buffer_to_bson(&ectx->mongocryptd_cmd, &cmd_bson)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "invalid BSON mongocryptd_cmd");
+    }
+
+    _mongocrypt_buffer_from_binary(&reply, in);
+    if (!_mongocrypt_cache_marking_replay(&reply, &cmd_bson, &replayed)) {
+        return true;
+    }
+    if (0 == _mongocrypt_buffer_cmp(&replayed, &reply) && _mongocrypt_cache_marking_strip(&reply, &stripped)) {
+        ok = _mongocrypt_cache_add_copy(&ctx->crypt->cache_marking, &ectx->marking_cache_key, &stripped, ctx->status);
+        _mongocrypt_buffer_cleanup(&stripped);
+    }
+    _mongocrypt_buffer_cleanup(&replayed);
+    if (!ok) {
+        return _mongocrypt_ctx_fail(ctx);
+    }
+    return true;
+}
+
+static bool _feed_and_cache_markings_reply(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *in, bool borrowed) {
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(in);
+
+    if (!_feed_markings_reply(ctx, in, borrowed)) {
+        return false;
+    }
+    return _cache_markings_reply(ctx, in);
+}
+
+static bool _mongo_feed_markings(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *in) {
+    BSON_ASSERT_PARAM(ctx);
+
+    return _feed_and_cache_markings_reply(ctx, in, ctx->opts.borrow_input);
+}
+
 static bool mongocrypt_ctx_encrypt_ismaster_done(mongocrypt_ctx_t *ctx);
 
+/* _state_after_markings moves @ctx past query analysis. An explain context
+ * is ready without requesting keys. */
+static bool _state_after_markings(mongocrypt_ctx_t *ctx) {
+    _mongocrypt_ctx_encrypt_t *ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+
+    BSON_ASSERT_PARAM(ctx);
+
+    if (ectx->explain) {
+        ctx->state = MONGOCRYPT_CTX_READY;
+        return true;
+    }
+    (void)_mongocrypt_key_broker_requests_done(&ctx->kb);
+    return _mongocrypt_ctx_state_from_key_broker(ctx);
+}
+
 static bool _mongo_done_markings(mongocrypt_ctx_t *ctx) {
     _mongocrypt_ctx_encrypt_t *ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
 
@@ -956,8 +1607,20 @@ static bool _mongo_done_markings(mongocrypt_ctx_t *ctx) {
     if (ectx->ismaster.needed) {
         return mongocrypt_ctx_encrypt_ismaster_done(ctx);
     }
-    (void)_mongocrypt_key_broker_requests_done(&ctx->kb);
-    return _mongocrypt_ctx_state_from_key_broker(ctx);
+    return _state_after_markings(ctx);
+}
+
+/* _mongo_done_mongocryptd_markings is called when the driver is done feeding
+ * the reply of mongocryptd. */
+static bool _mongo_done_mongocryptd_markings(mongocrypt_ctx_t *ctx) {
+    _mongocrypt_ctx_encrypt_t *ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+
+    BSON_ASSERT_PARAM(ctx);
+
+    if (!ectx->ismaster.needed) {
+        _mongocrypt_counter_add(ctx->crypt, MC_COUNTER_MARKINGS_MONGOCRYPTD, 1);
+    }
+    return _mongo_done_markings(ctx);
 }
 
 /**
@@ -1035,27 +1698,124 @@ fail:
     return ok;
 }
 
-/**
- * @brief Attempt to generate csfle markings using a csfle dynamic library.
- *
- * @param ctx A context which has state NEED_MONGO_MARKINGS
- * @return true On success
- * @return false On error.
- *
- * This should be called only when we are ready for markings in the command
- * document. This function will only do anything if the csfle dynamic library
- * is loaded, otherwise it returns success immediately and leaves the state
- * as NEED_MONGO_MARKINGS.
- *
- * If csfle is loaded, this function will request the csfle library generate a
- * marked command document based on the caller's schema. If successful, the
- * state will be changed via @ref _mongo_done_markings().
- *
- * The purpose of this function is to short-circuit the phase of encryption
- * wherein we would normally return to the driver and give them the opportunity
- * to generate the markings by passing a special command to a mongocryptd daemon
- * process. Instead, we'll do it ourselves here, if possible.
- */
+/* Applies the cached markings of a command with the same shape, if any. Sets
+ * @hit if they were applied and query analysis is not needed. */
+static bool _try_markings_from_cache(mongocrypt_ctx_t *ctx, bool *hit) {
+    _mongocrypt_ctx_encrypt_t *ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+    _mongocrypt_buffer_t *cached = NULL;
+    _mongocrypt_buffer_t replayed;
+    bson_t cmd_bson;
+    bool replayable;
+    bool ok;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(hit);
+    BSON_ASSERT(ectx->target_ns);
+    BSON_ASSERT(ectx->cmd_db);
+
+    *hit = false;
+    if (ctx->crypt->opts.marking_cache_max_entries == 0) {
+        return true;
+    }
+
+    // The command is kept to be sent to mongocryptd on a miss.
+    if (_mongocrypt_buffer_empty(&ectx->mongocryptd_cmd)) {
+        bson_t markings_cmd = BSON_INITIALIZER;
+        if (!_create_markings_cmd_bson(ctx, &markings_cmd)) {
+            bson_destroy(&markings_cmd);
+            return false;
+        }
+        _mongocrypt_buffer_steal_from_bson(&ectx->mongocryptd_cmd, &markings_cmd);
+    }
+    if (!_mongocrypt_buffer_to_bson(&ectx->mongocryptd_cmd, &cmd_bson)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "invalid BSON mongocryptd_cmd");
+    }
+
+    _mongocrypt_buffer_cleanup(&ectx->marking_cache_key);
+    if (!_mongocrypt_cache_marking_key(ectx->target_ns,
+                                       ectx->cmd_db,
+                                       &cmd_bson,
+                                       &ectx->marking_cache_key,
+                                       ctx->status)) {
+        return _mongocrypt_ctx_fail(ctx);
+    }
+
+    if (!_mongocrypt_cache_get(&ctx->crypt->cache_marking, &ectx->marking_cache_key, (void **)&cached)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "failed to retrieve from marking cache");
+    }
+    if (!cached) {
+        return true;
+    }
+
+    replayable = _mongocrypt_cache_marking_replay(cached, &cmd_bson, &replayed);
+    _mongocrypt_buffer_cleanup(cached);
+    bson_free(cached);
+    if (!replayable) {
+        // Run query analysis. Its result replaces the cached entry.
+        return true;
+    }
+
+    *hit = true;
+    _mongocrypt_counter_add(ctx->crypt, MC_COUNTER_MARKINGS_CACHE, 1);
+    ok = _feed_markings_reply(ctx, _mongocrypt_buffer_as_binary(&replayed), false) && _mongo_done_markings(ctx);
+    _mongocrypt_buffer_cleanup(&replayed);
+    return ok;
+}
+
+/* Take an idle query analyzer from the pool on @crypt, or create one if none
+ * is idle. Return it with _csfle_query_analyzer_release. */
+static mongo_crypt_v1_query_analyzer *_csfle_query_analyzer_acquire(mongocrypt_t *crypt,
+                                                                    mongo_crypt_v1_status *status) {
+    mongo_crypt_v1_query_analyzer *qa = NULL;
+
+    BSON_ASSERT_PARAM(crypt);
+
+    _mongocrypt_mutex_lock(&crypt->mutex);
+    if (crypt->csfle_query_analyzers.len > 0) {
+        crypt->csfle_query_analyzers.len--;
+        qa = _mc_array_index(&crypt->csfle_query_analyzers,
+                             mongo_crypt_v1_query_analyzer *,
+                             crypt->csfle_query_analyzers.len);
+    }
+    _mongocrypt_mutex_unlock(&crypt->mutex);
+
+    if (!qa) {
+        qa = crypt->csfle.query_analyzer_create(crypt->csfle_lib, status);
+    }
+    return qa;
+}
+
+/* Return @qa to the pool on @crypt for reuse by other contexts. */
+static void _csfle_query_analyzer_release(mongocrypt_t *crypt, mongo_crypt_v1_query_analyzer *qa) {
+    BSON_ASSERT_PARAM(crypt);
+    BSON_ASSERT_PARAM(qa);
+
+    _mongocrypt_mutex_lock(&crypt->mutex);
+    _mc_array_append_val(&crypt->csfle_query_analyzers, qa);
+    _mongocrypt_mutex_unlock(&crypt->mutex);
+}
+
+/**
+ * @brief Attempt to generate csfle markings using a csfle dynamic library.
+ *
+ * @param ctx A context which has state NEED_MONGO_MARKINGS
+ * @return true On success
+ * @return false On error.
+ *
+ * This should be called only when we are ready for markings in the command
+ * document. This function will only do anything if the csfle dynamic library
+ * is loaded, otherwise it returns success immediately and leaves the state
+ * as NEED_MONGO_MARKINGS.
+ *
+ * If csfle is loaded, this function will request the csfle library generate a
+ * marked command document based on the caller's schema. If successful, the
+ * state will be changed via @ref _mongo_done_markings().
+ *
+ * The purpose of this function is to short-circuit the phase of encryption
+ * wherein we would normally return to the driver and give them the opportunity
+ * to generate the markings by passing a special command to a mongocryptd daemon
+ * process. Instead, we'll do it ourselves here, if possible.
+ */
 static bool _try_run_csfle_marking(mongocrypt_ctx_t *ctx) {
     BSON_ASSERT_PARAM(ctx);
 
@@ -1067,6 +1827,14 @@ static bool _try_run_csfle_marking(mongocrypt_ctx_t *ctx) {
 
     BSON_ASSERT(ctx->crypt);
 
+    bool hit;
+    if (!_try_markings_from_cache(ctx, &hit)) {
+        return false;
+    }
+    if (hit) {
+        return true;
+    }
+
     // We have a valid schema and just need to mark the fields for encryption
     if (!ctx->crypt->csfle.okay) {
         // We don't have a csfle library to use to obtain the markings. It's up to
@@ -1111,8 +1879,10 @@ static bool _try_run_csfle_marking(mongocrypt_ctx_t *ctx) {
     mongo_crypt_v1_status *status = csfle.status_create();
     BSON_ASSERT(status);
 
-    mongo_crypt_v1_query_analyzer *qa = csfle.query_analyzer_create(csfle_lib, status);
+    mongo_crypt_v1_query_analyzer *qa = _csfle_query_analyzer_acquire(ctx->crypt, status);
     CHECK_CSFLE_ERROR("query_analyzer_create", fail_qa_create);
+    // Only analyzers that did not report an error are returned to the pool.
+    bool qa_reusable = false;
 
     uint32_t marked_bson_len = 0;
     uint8_t *marked_bson = csfle.analyze_query(qa,
@@ -1122,10 +1892,15 @@ static bool _try_run_csfle_marking(mongocrypt_ctx_t *ctx) {
                                                &marked_bson_len,
                                                status);
     CHECK_CSFLE_ERROR("analyze_query", fail_analyze_query);
+    qa_reusable = true;
 
-    // Copy out the marked document.
+    // Keep the marked document for marked_cmd to view, instead of copying it.
+    if (ectx->csfle_marked_bson) {
+        csfle.bson_free(ectx->csfle_marked_bson);
+    }
+    ectx->csfle_marked_bson = marked_bson;
     mongocrypt_binary_t *marked = mongocrypt_binary_new_from_data(marked_bson, marked_bson_len);
-    if (!_mongo_feed_markings(ctx, marked)) {
+    if (!_feed_and_cache_markings_reply(ctx, marked, true /* borrowed */)) {
         // Wrap error with additional information.
         _mongocrypt_set_error(ctx->status,
                               MONGOCRYPT_STATUS_ERROR_CLIENT,
@@ -1136,7 +1911,9 @@ static bool _try_run_csfle_marking(mongocrypt_ctx_t *ctx) {
     }
 
     okay = _mongo_done_markings(ctx);
-    if (!okay) {
+    if (okay) {
+        _mongocrypt_counter_add(ctx->crypt, MC_COUNTER_MARKINGS_CRYPT_SHARED, 1);
+    } else {
         // Wrap error with additional information.
         _mongocrypt_set_error(ctx->status,
                               MONGOCRYPT_STATUS_ERROR_CLIENT,
@@ -1147,9 +1924,12 @@ static bool _try_run_csfle_marking(mongocrypt_ctx_t *ctx) {
 
 fail_feed_markings:
     mongocrypt_binary_destroy(marked);
-    csfle.bson_free(marked_bson);
 fail_analyze_query:
-    csfle.query_analyzer_destroy(qa);
+    if (qa_reusable) {
+        _csfle_query_analyzer_release(ctx->crypt, qa);
+    } else {
+        csfle.query_analyzer_destroy(qa);
+    }
 fail_qa_create:
     csfle.status_destroy(status);
 fail_create_cmd:
@@ -1163,37 +1943,50 @@ static bool _mongocrypt_fle2_insert_update_find(mc_fle_blob_subtype_t subtype) {
         || (subtype == MC_SUBTYPE_FLE2FindRangePayload) || (subtype == MC_SUBTYPE_FLE2FindRangePayloadV2);
 }
 
-static bool
-_marking_to_bson_value(void *ctx, _mongocrypt_marking_t *marking, bson_value_t *out, mongocrypt_status_t *status) {
-    _mongocrypt_ciphertext_t ciphertext;
+/* _encrypted_value_counter returns the counter of values encrypted from @marking. */
+static mc_counter_t _encrypted_value_counter(const _mongocrypt_marking_t *marking) {
+    BSON_ASSERT_PARAM(marking);
+
+    if (marking->type != MONGOCRYPT_MARKING_FLE2_ENCRYPTION) {
+        return MC_COUNTER_ENCRYPTED_FLE1;
+    }
+    switch (marking->fle2.algorithm) {
+    case MONGOCRYPT_FLE2_ALGORITHM_EQUALITY: return MC_COUNTER_ENCRYPTED_FLE2_EQUALITY;
+    case MONGOCRYPT_FLE2_ALGORITHM_RANGE: return MC_COUNTER_ENCRYPTED_FLE2_RANGE;
+    case MONGOCRYPT_FLE2_ALGORITHM_UNINDEXED:
+    default: return MC_COUNTER_ENCRYPTED_FLE2_UNINDEXED;
+    }
+}
+
+/* Sets @out to a binary holding @ciphertext converted from @marking.
+ * Ownership of the binary data is transferred to the caller. */
+static bool _ciphertext_to_bson_value(_mongocrypt_key_broker_t *kb,
+                                      const _mongocrypt_marking_t *marking,
+                                      _mongocrypt_ciphertext_t *ciphertext,
+                                      bson_value_t *out,
+                                      mongocrypt_status_t *status) {
     _mongocrypt_buffer_t serialized_ciphertext = {0};
-    bool ret = false;
 
-    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(kb);
     BSON_ASSERT_PARAM(marking);
+    BSON_ASSERT_PARAM(ciphertext);
     BSON_ASSERT_PARAM(out);
 
-    _mongocrypt_ciphertext_init(&ciphertext);
-
-    if (!_mongocrypt_marking_to_ciphertext(ctx, marking, &ciphertext, status)) {
-        goto fail;
-    }
-
-    if (_mongocrypt_fle2_insert_update_find(ciphertext.blob_subtype)) {
+    if (_mongocrypt_fle2_insert_update_find(ciphertext->blob_subtype)) {
         /* ciphertext_data is already a BSON object, just need to prepend
          * blob_subtype */
-        if (ciphertext.data.len > UINT32_MAX - 1u) {
+        if (ciphertext->data.len > UINT32_MAX - 1u) {
             CLIENT_ERR("ciphertext too long");
-            goto fail;
+            return false;
         }
-        _mongocrypt_buffer_init_size(&serialized_ciphertext, ciphertext.data.len + 1);
+        _mongocrypt_buffer_init_size(&serialized_ciphertext, ciphertext->data.len + 1);
         /* ciphertext->blob_subtype is an enum and easily fits in uint8_t */
-        serialized_ciphertext.data[0] = (uint8_t)ciphertext.blob_subtype;
-        memcpy(serialized_ciphertext.data + 1, ciphertext.data.data, ciphertext.data.len);
+        serialized_ciphertext.data[0] = (uint8_t)ciphertext->blob_subtype;
+        memcpy(serialized_ciphertext.data + 1, ciphertext->data.data, ciphertext->data.len);
 
-    } else if (!_mongocrypt_serialize_ciphertext(&ciphertext, &serialized_ciphertext)) {
+    } else if (!_mongocrypt_serialize_ciphertext(ciphertext, &serialized_ciphertext)) {
         CLIENT_ERR("malformed ciphertext");
-        goto fail;
+        return false;
     };
 
     /* ownership of serialized_ciphertext is transferred to caller. */
@@ -1202,7 +1995,26 @@ _marking_to_bson_value(void *ctx, _mongocrypt_marking_t *marking, bson_value_t *
     out->value.v_binary.data_len = serialized_ciphertext.len;
     out->value.v_binary.subtype = (bson_subtype_t)BSON_SUBTYPE_ENCRYPTED;
 
-    ret = true;
+    _mongocrypt_counter_add(kb->crypt, _encrypted_value_counter(marking), 1);
+    return true;
+}
+
+static bool
+_marking_to_bson_value(void *ctx, _mongocrypt_marking_t *marking, bson_value_t *out, mongocrypt_status_t *status) {
+    _mongocrypt_ciphertext_t ciphertext;
+    bool ret = false;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(marking);
+    BSON_ASSERT_PARAM(out);
+
+    _mongocrypt_ciphertext_init(&ciphertext);
+
+    if (!_mongocrypt_marking_to_ciphertext(ctx, marking, &ciphertext, status)) {
+        goto fail;
+    }
+
+    ret = _ciphertext_to_bson_value(ctx, marking, &ciphertext, out, status);
 
 fail:
     _mongocrypt_ciphertext_cleanup(&ciphertext);
@@ -1219,21 +2031,257 @@ _replace_marking_with_ciphertext(void *ctx, _mongocrypt_buffer_t *in, bson_value
 
     memset(&marking, 0, sizeof(marking));
 
-    if (!_mongocrypt_marking_parse_unowned(in, &marking, status)) {
+    /* Markings were validated when collecting their keys. */
+    if (!_mongocrypt_marking_parse_unowned_unchecked(in, &marking, status)) {
         _mongocrypt_marking_cleanup(&marking);
         return false;
     }
 
     ret = _marking_to_bson_value(ctx, &marking, out, status);
+    MONGOCRYPT_PROBE4(encrypt__value,
+                      ret ? out->value.v_binary.data[0] : 0,
+                      in->len,
+                      ret ? out->value.v_binary.data_len : 0,
+                      ret);
     _mongocrypt_marking_cleanup(&marking);
     return ret;
 }
 
+typedef struct {
+    _mongocrypt_key_broker_t *kb;
+    /* markings holds a _mongocrypt_buffer_t viewing each marking in traversal
+     * order. */
+    mc_array_t markings;
+    /* values[i] is the ciphertext of markings[i]. */
+    bson_value_t *values;
+    mongocrypt_status_t **statuses;
+    bool *ok;
+    /* next is the index of the next ciphertext to place in the command. */
+    size_t next;
+} _markings_batch_t;
+
+static bool _collect_marking(void *ctx, _mongocrypt_buffer_t *in, mongocrypt_status_t *status) {
+    _markings_batch_t *batch = ctx;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(in);
+
+    _mc_array_append_val(&batch->markings, *in);
+    return true;
+}
+
+static void _marking_to_ciphertext_task(void *task_ctx, uint32_t index) {
+    _markings_batch_t *batch = task_ctx;
+
+    if (batch->ok[index]) {
+        /* Already converted by _convert_find_equality_markings. */
+        return;
+    }
+    batch->ok[index] = _replace_marking_with_ciphertext(batch->kb,
+                                                        &_mc_array_index(&batch->markings, _mongocrypt_buffer_t, index),
+                                                        &batch->values[index],
+                                                        batch->statuses[index]);
+}
+
+/* Converts the FLE2 equality find markings of @batch with
+ * _mongocrypt_find_equality_markings_to_ciphertexts, which derives the tokens of
+ * markings sharing an index key together. Sets ok[i] for each converted
+ * marking. Other markings are left for the caller. */
+static bool _convert_find_equality_markings(_markings_batch_t *batch, mongocrypt_status_t *status) {
+    const uint32_t n = (uint32_t)batch->markings.len;
+    _mongocrypt_marking_t *markings = bson_malloc0(sizeof(_mongocrypt_marking_t) * (n + 1u));
+    _mongocrypt_ciphertext_t *ciphertexts = bson_malloc0(sizeof(_mongocrypt_ciphertext_t) * (n + 1u));
+    /* indexes[j] is the index in batch->markings of markings[j]. */
+    uint32_t *indexes = bson_malloc0(sizeof(uint32_t) * (n + 1u));
+    uint32_t num_find = 0;
+    bool ret = false;
+
+    BSON_ASSERT_PARAM(batch);
+
+    for (uint32_t i = 0; i < n; i++) {
+        _mongocrypt_marking_t *marking = &markings[num_find];
+
+        if (!_mongocrypt_marking_parse_unowned_unchecked(&_mc_array_index(&batch->markings, _mongocrypt_buffer_t, i),
+                                                         marking,
+                                                         status)) {
+            _mongocrypt_marking_cleanup(marking);
+            goto fail;
+        }
+        if (!_mongocrypt_marking_is_find_equality(marking)) {
+            _mongocrypt_marking_cleanup(marking);
+            memset(marking, 0, sizeof(*marking));
+            continue;
+        }
+        _mongocrypt_ciphertext_init(&ciphertexts[num_find]);
+        indexes[num_find++] = i;
+    }
+
+    if (!_mongocrypt_find_equality_markings_to_ciphertexts(batch->kb, markings, ciphertexts, num_find, status)) {
+        goto fail;
+    }
+
+    for (uint32_t j = 0; j < num_find; j++) {
+        const uint32_t i = indexes[j];
+
+        if (!_ciphertext_to_bson_value(batch->kb, &markings[j], &ciphertexts[j], &batch->values[i], status)) {
+            goto fail;
+        }
+        batch->ok[i] = true;
+    }
+
+    ret = true;
+fail:
+    for (uint32_t j = 0; j < num_find; j++) {
+        _mongocrypt_marking_cleanup(&markings[j]);
+        _mongocrypt_ciphertext_cleanup(&ciphertexts[j]);
+    }
+    bson_free(markings);
+    bson_free(ciphertexts);
+    bson_free(indexes);
+    return ret;
+}
+
+static bool
+_place_ciphertext(void *ctx, _mongocrypt_buffer_t *in, bson_value_t *out, mongocrypt_status_t *status) {
+    _markings_batch_t *batch = ctx;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(out);
+
+    if (batch->next >= batch->markings.len) {
+        CLIENT_ERR("unexpected marking");
+        return false;
+    }
+    /* Ownership of the ciphertext is transferred to the caller. */
+    *out = batch->values[batch->next];
+    memset(&batch->values[batch->next], 0, sizeof(bson_value_t));
+    batch->next++;
+    return true;
+}
+
+/* A command with at least FIND_EQUALITY_BATCH_MIN FLE2 equality find markings,
+ * such as an $in with many values, has them converted together. */
+#define FIND_EQUALITY_BATCH_MIN 16
+
+/* Appends the command being iterated by @iter to @out with each marking
+ * replaced by its ciphertext. @out is initialized with room for the marked
+ * command plus the estimated ciphertexts, so it is grown at most rarely. The
+ * caller must destroy @out, even on failure. If a parallel_for executor is set
+ * and the command has at least opts.parallel_marking_threshold markings, the
+ * markings are converted by one task each, then placed in order. If the command
+ * has at least FIND_EQUALITY_BATCH_MIN FLE2v2 equality find markings, those are
+ * first converted with one token derivation pass per index key. */
+static bool _replace_markings_with_ciphertexts(mongocrypt_ctx_t *ctx, bson_iter_t *iter, bson_t *out) {
+    _mongocrypt_ctx_encrypt_t *ectx;
+    _mongocrypt_crypto_t *crypto;
+    _markings_batch_t batch = {0};
+    bool ret = false;
+    bool use_parallel;
+    bool use_find_batch;
+    uint64_t reserve;
+    uint32_t n;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(iter);
+    BSON_ASSERT_PARAM(out);
+
+    ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+    reserve = (uint64_t)ectx->marked_cmd.len + ectx->ciphertext_len_estimate;
+    if (reserve > (uint64_t)INT32_MAX) {
+        reserve = (uint64_t)INT32_MAX;
+    }
+    bson_steal(out, bson_sized_new((size_t)reserve));
+
+    crypto = ctx->crypt->crypto;
+    use_parallel = ctx->crypt->opts.parallel_marking_threshold > 0 && crypto->parallel_for;
+    use_find_batch = ctx->crypt->opts.use_fle2_v2 && ectx->find_equality_markings >= FIND_EQUALITY_BATCH_MIN;
+    if (!use_parallel && !use_find_batch) {
+        return _mongocrypt_transform_binary_in_bson(_replace_marking_with_ciphertext,
+                                                    &ctx->kb,
+                                                    TRAVERSE_MATCH_MARKING,
+                                                    iter,
+                                                    out,
+                                                    ctx->status);
+    }
+
+    batch.kb = &ctx->kb;
+    _mc_array_init(&batch.markings, sizeof(_mongocrypt_buffer_t));
+    if (!_mongocrypt_traverse_binary_in_bson(_collect_marking, &batch, TRAVERSE_MATCH_MARKING, iter, ctx->status)) {
+        goto fail;
+    }
+
+    use_parallel = use_parallel && batch.markings.len >= ctx->crypt->opts.parallel_marking_threshold;
+    if (!use_parallel && !use_find_batch) {
+        _mc_array_destroy(&batch.markings);
+        return _mongocrypt_transform_binary_in_bson(_replace_marking_with_ciphertext,
+                                                    &ctx->kb,
+                                                    TRAVERSE_MATCH_MARKING,
+                                                    iter,
+                                                    out,
+                                                    ctx->status);
+    }
+
+    if (batch.markings.len > UINT32_MAX - 1u) {
+        mongocrypt_status_t *status = ctx->status;
+        CLIENT_ERR("too many markings: %zu", batch.markings.len);
+        goto fail;
+    }
+    n = (uint32_t)batch.markings.len;
+
+    batch.values = bson_malloc0(sizeof(bson_value_t) * n);
+    batch.statuses = bson_malloc0(sizeof(mongocrypt_status_t *) * n);
+    batch.ok = bson_malloc0(sizeof(bool) * n);
+    for (uint32_t i = 0; i < n; i++) {
+        batch.statuses[i] = mongocrypt_status_new();
+    }
+
+    if (use_find_batch && !_convert_find_equality_markings(&batch, ctx->status)) {
+        goto fail;
+    }
+
+    if (use_parallel) {
+        crypto->parallel_for(crypto->parallel_for_ctx, _marking_to_ciphertext_task, &batch, n);
+    } else {
+        for (uint32_t i = 0; i < n; i++) {
+            _marking_to_ciphertext_task(&batch, i);
+        }
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        if (!batch.ok[i]) {
+            _mongocrypt_status_copy_to(batch.statuses[i], ctx->status);
+            goto fail;
+        }
+    }
+
+    if (!_mongocrypt_transform_binary_in_bson(_place_ciphertext,
+                                              &batch,
+                                              TRAVERSE_MATCH_MARKING,
+                                              iter,
+                                              out,
+                                              ctx->status)) {
+        goto fail;
+    }
+    BSON_ASSERT(batch.next == n);
+
+    ret = true;
+fail:
+    for (size_t i = 0; batch.statuses && i < batch.markings.len; i++) {
+        bson_value_destroy(&batch.values[i]);
+        mongocrypt_status_destroy(batch.statuses[i]);
+    }
+    bson_free(batch.values);
+    bson_free(batch.statuses);
+    bson_free(batch.ok);
+    _mc_array_destroy(&batch.markings);
+    return ret;
+}
+
 /* generate_delete_tokens generates the 'deleteTokens' document to be appended
  * to 'encryptionInformation'. */
 static bson_t *generate_delete_tokens(_mongocrypt_crypto_t *crypto,
                                       _mongocrypt_key_broker_t *kb,
-                                      mc_EncryptedFieldConfig_t *efc,
+                                      const mc_EncryptedFieldConfig_t *efc,
                                       mongocrypt_status_t *status) {
     bool ret = false;
     bson_t *out = bson_new();
@@ -1424,17 +2472,93 @@ static moe_result must_omit_encryptionInformation(const char *command_name,
     return (moe_result){.ok = true, .must_omit = false};
 }
 
+/* _compaction_field_tokens_t holds the tokens of one field of a
+ * compactStructuredEncryptionData or cleanupStructuredEncryptionData command.
+ * The tokens live in the struct, so need no cleanup. */
+typedef struct {
+    mc_ECOCToken_t ecocToken;
+    mc_ESCToken_t escToken;
+    bool needs_padding;
+} _compaction_field_tokens_t;
+
+/* Sets the ECOCToken of @out, and the ESCToken if @out->needs_padding, from the
+ * key with @key_id. The tokens derived when the key was cached are copied if
+ * available. Otherwise they are derived from the key material. */
+static bool _compaction_field_tokens_derive(_mongocrypt_crypto_t *crypto,
+                                            _mongocrypt_key_broker_t *kb,
+                                            const _mongocrypt_buffer_t *key_id,
+                                            _compaction_field_tokens_t *out,
+                                            mongocrypt_status_t *status) {
+    const _mongocrypt_cache_key_tokens_t *keyTokens;
+    _mongocrypt_buffer_t key = {0};
+    _mongocrypt_buffer_t tokenkey = {0};
+    mc_CollectionsLevel1Token_t cl1t;
+    bool ok = false;
+
+    BSON_ASSERT_PARAM(crypto);
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(key_id);
+    BSON_ASSERT_PARAM(out);
+
+    keyTokens = _mongocrypt_key_broker_key_tokens_by_id(kb, key_id);
+    if (keyTokens) {
+        mc_ECOCToken_init(&out->ecocToken, mc_ECOCToken_get(keyTokens->ecocToken));
+        mc_ESCToken_init(&out->escToken, mc_ESCToken_get(keyTokens->escToken));
+        return true;
+    }
+
+    if (!_mongocrypt_key_broker_decrypted_key_by_id(kb, key_id, &key)) {
+        _mongocrypt_key_broker_status(kb, status);
+        goto fail;
+    }
+    /* The last 32 bytes of the user key are the token key. */
+    if (key.len < MONGOCRYPT_TOKEN_KEY_LEN) {
+        CLIENT_ERR("key too short");
+        goto fail;
+    }
+    if (!_mongocrypt_buffer_from_subrange(&tokenkey,
+                                          &key,
+                                          key.len - MONGOCRYPT_TOKEN_KEY_LEN,
+                                          MONGOCRYPT_TOKEN_KEY_LEN)) {
+        CLIENT_ERR("unable to get TokenKey from Data Encryption Key");
+        goto fail;
+    }
+    if (!mc_CollectionsLevel1Token_derive(&cl1t, crypto, &tokenkey, status)) {
+        goto fail;
+    }
+    if (!mc_ECOCToken_derive(&out->ecocToken, crypto, &cl1t, status)) {
+        goto fail;
+    }
+    if (out->needs_padding && !mc_ESCToken_derive(&out->escToken, crypto, &cl1t, status)) {
+        goto fail;
+    }
+
+    ok = true;
+fail:
+    _mongocrypt_buffer_cleanup(&key);
+    return ok;
+}
+
 /* _fle2_append_compactionTokens appends compactionTokens if command_name is
  * "compactStructuredEncryptionData" or cleanupTokens if command_name is
- * "cleanupStructuredEncryptionData"
+ * "cleanupStructuredEncryptionData". The tokens of all fields are derived before
+ * any are appended: the ECOCTokens and ESCTokens are copied from the tokens
+ * cached with each key if available, and the AnchorPaddingTokenRoots of all
+ * range fields are derived with one batched HMAC call.
  */
 static bool _fle2_append_compactionTokens(mongocrypt_t *crypt,
                                           _mongocrypt_key_broker_t *kb,
-                                          mc_EncryptedFieldConfig_t *efc,
+                                          const mc_EncryptedFieldConfig_t *efc,
                                           const char *command_name,
                                           bson_t *out,
                                           mongocrypt_status_t *status) {
     bson_t result_compactionTokens;
+    _compaction_field_tokens_t *tokens = NULL;
+    const mc_ESCToken_t **escTokens = NULL;
+    mc_AnchorPaddingTokenRoot_t *padTokens = NULL;
+    const mc_EncryptedField_t *ptr;
+    uint32_t num_fields = 0;
+    uint32_t num_padded = 0;
     bool ret = false;
 
     BSON_ASSERT_PARAM(crypt);
@@ -1450,62 +2574,55 @@ static bool _fle2_append_compactionTokens(mongocrypt_t *crypt,
         return true;
     }
 
-    if (cleanup) {
-        BSON_APPEND_DOCUMENT_BEGIN(out, "cleanupTokens", &result_compactionTokens);
-    } else {
-        BSON_APPEND_DOCUMENT_BEGIN(out, "compactionTokens", &result_compactionTokens);
+    for (ptr = efc->fields; ptr != NULL; ptr = ptr->next) {
+        if (num_fields == UINT32_MAX) {
+            CLIENT_ERR("too many encrypted fields");
+            return false;
+        }
+        num_fields++;
     }
 
-    mc_EncryptedField_t *ptr;
-    for (ptr = efc->fields; ptr != NULL; ptr = ptr->next) {
-        /* Append tokens. */
-        _mongocrypt_buffer_t key = {0};
-        _mongocrypt_buffer_t tokenkey = {0};
-        mc_CollectionsLevel1Token_t *cl1t = NULL;
-        mc_ECOCToken_t *ecoct = NULL;
-        mc_ESCToken_t *esct = NULL;
-        mc_AnchorPaddingTokenRoot_t *padt = NULL;
-        bool ecoc_ok = false;
+    // Derive the tokens of all fields before appending any, so the
+    // AnchorPaddingTokenRoots are derived together.
+    if (num_fields > 0) {
+        tokens = _mongocrypt_secure_malloc(sizeof(*tokens) * num_fields);
+        memset(tokens, 0, sizeof(*tokens) * num_fields);
+        escTokens = bson_malloc(sizeof(*escTokens) * num_fields);
+    }
 
-        if (!_mongocrypt_key_broker_decrypted_key_by_id(kb, &ptr->keyId, &key)) {
-            _mongocrypt_key_broker_status(kb, status);
-            goto ecoc_fail;
-        }
-        /* The last 32 bytes of the user key are the token key. */
-        if (key.len < MONGOCRYPT_TOKEN_KEY_LEN) {
-            CLIENT_ERR("key too short");
-            goto ecoc_fail;
-        }
-        if (!_mongocrypt_buffer_from_subrange(&tokenkey,
-                                              &key,
-                                              key.len - MONGOCRYPT_TOKEN_KEY_LEN,
-                                              MONGOCRYPT_TOKEN_KEY_LEN)) {
-            CLIENT_ERR("unable to get TokenKey from Data Encryption Key");
-            goto ecoc_fail;
+    uint32_t i = 0;
+    for (ptr = efc->fields; ptr != NULL; ptr = ptr->next, i++) {
+        tokens[i].needs_padding = crypt->opts.use_range_v2 && (ptr->supported_queries & SUPPORTS_RANGE_QUERIES);
+        if (!_compaction_field_tokens_derive(crypto, kb, &ptr->keyId, &tokens[i], status)) {
+            goto fail;
         }
-        cl1t = mc_CollectionsLevel1Token_new(crypto, &tokenkey, status);
-        if (!cl1t) {
-            goto ecoc_fail;
+        if (tokens[i].needs_padding) {
+            escTokens[num_padded++] = &tokens[i].escToken;
         }
+    }
 
-        ecoct = mc_ECOCToken_new(crypto, cl1t, status);
-        if (!ecoct) {
-            goto ecoc_fail;
+    // AnchorPaddingTokenRoot = HMAC(ESCToken, d)
+    if (num_padded > 0) {
+        padTokens = _mongocrypt_secure_malloc(sizeof(*padTokens) * num_padded);
+        if (!mc_AnchorPaddingTokenRoot_derive_batch(padTokens, crypto, escTokens, num_padded, status)) {
+            goto fail;
         }
+    }
+
+    if (cleanup) {
+        BSON_APPEND_DOCUMENT_BEGIN(out, "cleanupTokens", &result_compactionTokens);
+    } else {
+        BSON_APPEND_DOCUMENT_BEGIN(out, "compactionTokens", &result_compactionTokens);
+    }
 
-        const _mongocrypt_buffer_t *ecoct_buf = mc_ECOCToken_get(ecoct);
+    i = 0;
+    uint32_t padded = 0;
+    for (ptr = efc->fields; ptr != NULL; ptr = ptr->next, i++) {
+        const _mongocrypt_buffer_t *ecoct_buf = mc_ECOCToken_get(&tokens[i].ecocToken);
 
-        if (crypt->opts.use_range_v2 && (ptr->supported_queries & SUPPORTS_RANGE_QUERIES)) {
+        if (tokens[i].needs_padding) {
             // Append the document {ecoc: <ECOCToken>, anchorPaddingToken: <AnchorPaddingTokenRoot>}
-            esct = mc_ESCToken_new(crypto, cl1t, status);
-            if (!esct) {
-                goto ecoc_fail;
-            }
-            padt = mc_AnchorPaddingTokenRoot_new(crypto, esct, status);
-            if (!padt) {
-                goto ecoc_fail;
-            }
-            const _mongocrypt_buffer_t *padt_buf = mc_AnchorPaddingTokenRoot_get(padt);
+            const _mongocrypt_buffer_t *padt_buf = mc_AnchorPaddingTokenRoot_get(&padTokens[padded++]);
             bson_t tokenDoc;
             BSON_APPEND_DOCUMENT_BEGIN(&result_compactionTokens, ptr->path, &tokenDoc);
             BSON_APPEND_BINARY(&tokenDoc, "ecoc", BSON_SUBTYPE_BINARY, ecoct_buf->data, ecoct_buf->len);
@@ -1519,26 +2636,94 @@ static bool _fle2_append_compactionTokens(mongocrypt_t *crypt,
                                ecoct_buf->data,
                                ecoct_buf->len);
         }
-
-        ecoc_ok = true;
-    ecoc_fail:
-        mc_AnchorPaddingTokenRoot_destroy(padt);
-        mc_ESCToken_destroy(esct);
-        mc_ECOCToken_destroy(ecoct);
-        mc_CollectionsLevel1Token_destroy(cl1t);
-        _mongocrypt_buffer_cleanup(&key);
-        if (!ecoc_ok) {
-            goto fail;
-        }
-    }
+    }
+    BSON_ASSERT(padded == num_padded);
 
     bson_append_document_end(out, &result_compactionTokens);
 
     ret = true;
 fail:
+    if (padTokens) {
+        _mongocrypt_secure_free(padTokens, sizeof(*padTokens) * num_padded);
+    }
+    if (tokens) {
+        _mongocrypt_secure_free(tokens, sizeof(*tokens) * num_fields);
+    }
+    bson_free(escTokens);
     return ret;
 }
 
+/* _token_cache_get sets @out to a copy of the tokens named @kind cached for the
+ * encryptedFields of @ctx. @out is set to NULL on a miss or if the token cache
+ * is disabled. */
+static bool _token_cache_get(mongocrypt_ctx_t *ctx, const char *kind, bson_t **out) {
+    _mongocrypt_ctx_encrypt_t *ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+    _mongocrypt_buffer_t key;
+    _mongocrypt_buffer_t *cached = NULL;
+    bson_t efc_bson;
+    bool ok;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(kind);
+    BSON_ASSERT_PARAM(out);
+
+    *out = NULL;
+    if (ctx->crypt->opts.token_cache_max_entries == 0) {
+        return true;
+    }
+
+    if (!_mongocrypt_buffer_to_bson(&ectx->encrypted_field_config, &efc_bson)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "unable to convert encrypted_field_config to BSON");
+    }
+    _mongocrypt_cache_tokens_key(kind, &efc_bson, &key);
+    ok = _mongocrypt_cache_get(&ctx->crypt->cache_tokens, &key, (void **)&cached);
+    _mongocrypt_buffer_cleanup(&key);
+    if (!ok) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "failed to retrieve from token cache");
+    }
+    if (!cached) {
+        return true;
+    }
+
+    *out = bson_new_from_data(cached->data, cached->len);
+    _mongocrypt_buffer_cleanup(cached);
+    bson_free(cached);
+    if (!*out) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "invalid BSON in token cache");
+    }
+    return true;
+}
+
+/* _token_cache_add caches @tokens as the tokens named @kind for the
+ * encryptedFields of @ctx, if the token cache is enabled. */
+static bool _token_cache_add(mongocrypt_ctx_t *ctx, const char *kind, const bson_t *tokens) {
+    _mongocrypt_ctx_encrypt_t *ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+    _mongocrypt_buffer_t key;
+    _mongocrypt_buffer_t value;
+    bson_t efc_bson;
+    bool ok;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(kind);
+    BSON_ASSERT_PARAM(tokens);
+
+    if (ctx->crypt->opts.token_cache_max_entries == 0) {
+        return true;
+    }
+
+    if (!_mongocrypt_buffer_to_bson(&ectx->encrypted_field_config, &efc_bson)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "unable to convert encrypted_field_config to BSON");
+    }
+    _mongocrypt_cache_tokens_key(kind, &efc_bson, &key);
+    _mongocrypt_buffer_from_bson(&value, tokens);
+    ok = _mongocrypt_cache_add_copy(&ctx->crypt->cache_tokens, &key, &value, ctx->status);
+    _mongocrypt_buffer_cleanup(&key);
+    if (!ok) {
+        return _mongocrypt_ctx_fail(ctx);
+    }
+    return true;
+}
+
 /**
  * @brief Removes "encryptionInformation" from cmd.
  */
@@ -1556,53 +2741,51 @@ _fle2_strip_encryptionInformation(const char *cmd_name, bson_t *cmd /* in and ou
     }
 
     if (0 == strcmp(cmd_name, "bulkWrite")) {
-        // Get the single `nsInfo` document from the input command.
-        bson_t nsInfo; // Non-owning.
-        {
-            bson_iter_t nsInfo_iter;
-            if (!bson_iter_init(&nsInfo_iter, cmd)) {
-                CLIENT_ERR("failed to iterate command");
-                goto fail;
-            }
-            if (!bson_iter_find_descendant(&nsInfo_iter, "nsInfo.0", &nsInfo_iter)) {
-                CLIENT_ERR("expected one namespace in `bulkWrite`, but found zero.");
-                goto fail;
-            }
-            if (bson_has_field(cmd, "nsInfo.1")) {
-                CLIENT_ERR(
-                    "expected one namespace in `bulkWrite`, but found more than one. Only one namespace is supported.");
-                goto fail;
-            }
-            if (!mc_iter_document_as_bson(&nsInfo_iter, &nsInfo, status)) {
-                goto fail;
-            }
+        bson_iter_t nsInfo_iter;
+        bson_t nsInfo_array;
+        uint32_t i = 0;
+
+        if (!bson_iter_init_find(&nsInfo_iter, cmd, "nsInfo") || !BSON_ITER_HOLDS_ARRAY(&nsInfo_iter)
+            || !bson_iter_recurse(&nsInfo_iter, &nsInfo_iter)) {
+            CLIENT_ERR("expected `nsInfo` array in `bulkWrite`");
+            goto fail;
         }
 
-        // Copy input and exclude `encryptionInformation` from `nsInfo`.
-        {
-            // Append everything from input except `nsInfo`.
-            bson_copy_to_excluding_noinit(cmd, &stripped, "nsInfo", NULL);
-            // Append `nsInfo` array.
-            bson_t nsInfo_array;
-            if (!BSON_APPEND_ARRAY_BEGIN(&stripped, "nsInfo", &nsInfo_array)) {
-                CLIENT_ERR("unable to begin appending 'nsInfo' array");
+        // Copy input and exclude `encryptionInformation` from each `nsInfo` document.
+        // Append everything from input except `nsInfo`.
+        bson_copy_to_excluding_noinit(cmd, &stripped, "nsInfo", NULL);
+        if (!BSON_APPEND_ARRAY_BEGIN(&stripped, "nsInfo", &nsInfo_array)) {
+            CLIENT_ERR("unable to begin appending 'nsInfo' array");
+            goto fail;
+        }
+        for (; bson_iter_next(&nsInfo_iter); i++) {
+            bson_t nsInfo; // Non-owning.
+            bson_t nsInfo_out;
+            char storage[16];
+            const char *key;
+
+            if (!mc_iter_document_as_bson(&nsInfo_iter, &nsInfo, status)) {
                 goto fail;
             }
-            bson_t nsInfo_array_0;
-            if (!BSON_APPEND_DOCUMENT_BEGIN(&nsInfo_array, "0", &nsInfo_array_0)) {
-                CLIENT_ERR("unable to append 'nsInfo.0' document");
+            bson_uint32_to_string(i, &key, storage, sizeof(storage));
+            if (!BSON_APPEND_DOCUMENT_BEGIN(&nsInfo_array, key, &nsInfo_out)) {
+                CLIENT_ERR("unable to append 'nsInfo.%s' document", key);
                 goto fail;
             }
-            // Copy everything from input `nsInfo` and exclude `encryptionInformation`.
-            bson_copy_to_excluding_noinit(&nsInfo, &nsInfo_array_0, "encryptionInformation", NULL);
-            if (!bson_append_document_end(&nsInfo_array, &nsInfo_array_0)) {
+            bson_copy_to_excluding_noinit(&nsInfo, &nsInfo_out, "encryptionInformation", NULL);
+            if (!bson_append_document_end(&nsInfo_array, &nsInfo_out)) {
                 CLIENT_ERR("unable to end appending 'nsInfo' document in array");
-            }
-            if (!bson_append_array_end(&stripped, &nsInfo_array)) {
-                CLIENT_ERR("unable to end appending 'nsInfo' array");
                 goto fail;
             }
         }
+        if (i == 0) {
+            CLIENT_ERR("expected a namespace in `bulkWrite`, but found zero.");
+            goto fail;
+        }
+        if (!bson_append_array_end(&stripped, &nsInfo_array)) {
+            CLIENT_ERR("unable to end appending 'nsInfo' array");
+            goto fail;
+        }
 
         goto success;
     }
@@ -1697,13 +2880,7 @@ static bool _fle2_finalize(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
         }
 
         bson_iter_init(&iter, &as_bson);
-        bson_init(&converted);
-        if (!_mongocrypt_transform_binary_in_bson(_replace_marking_with_ciphertext,
-                                                  &ctx->kb,
-                                                  TRAVERSE_MATCH_MARKING,
-                                                  &iter,
-                                                  &converted,
-                                                  ctx->status)) {
+        if (!_replace_markings_with_ciphertexts(ctx, &iter, &converted)) {
             bson_destroy(&converted);
             return _mongocrypt_ctx_fail(ctx);
         }
@@ -1720,10 +2897,21 @@ static bool _fle2_finalize(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
 
     bson_t *deleteTokens = NULL;
     if (command_needs_deleteTokens(ctx, command_name)) {
-        deleteTokens = generate_delete_tokens(ctx->crypt->crypto, &ctx->kb, &ectx->efc, ctx->status);
-        if (!deleteTokens) {
+        if (!_token_cache_get(ctx, "deleteTokens", &deleteTokens)) {
             bson_destroy(&converted);
-            return _mongocrypt_ctx_fail(ctx);
+            return false;
+        }
+        if (!deleteTokens) {
+            deleteTokens = generate_delete_tokens(ctx->crypt->crypto, &ctx->kb, _get_efc(ectx), ctx->status);
+            if (!deleteTokens) {
+                bson_destroy(&converted);
+                return _mongocrypt_ctx_fail(ctx);
+            }
+            if (!_token_cache_add(ctx, "deleteTokens", deleteTokens)) {
+                bson_destroy(&converted);
+                bson_destroy(deleteTokens);
+                return false;
+            }
         }
     }
 
@@ -1735,8 +2923,9 @@ static bool _fle2_finalize(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
         return _mongocrypt_ctx_fail(ctx);
     }
 
-    /* Append a new 'encryptionInformation'. */
-    if (!result.must_omit && !ectx->used_empty_encryptedFields) {
+    /* Append a new 'encryptionInformation'. An empty encryptedFields is only
+     * constructed for `bulkWrite`, which omits it per namespace. */
+    if (!result.must_omit) {
         if (!_fle2_insert_encryptionInformation(ctx,
                                                 command_name,
                                                 &converted,
@@ -1753,9 +2942,38 @@ static bool _fle2_finalize(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
     }
     bson_destroy(deleteTokens);
 
-    if (!_fle2_append_compactionTokens(ctx->crypt, &ctx->kb, &ectx->efc, command_name, &converted, ctx->status)) {
-        bson_destroy(&converted);
-        return _mongocrypt_ctx_fail(ctx);
+    if (0 == strcmp(command_name, "compactStructuredEncryptionData")
+        || 0 == strcmp(command_name, "cleanupStructuredEncryptionData")) {
+        bson_t *compactionTokens = NULL;
+
+        if (!_token_cache_get(ctx, command_name, &compactionTokens)) {
+            bson_destroy(&converted);
+            return false;
+        }
+        if (!compactionTokens) {
+            compactionTokens = bson_new();
+            if (!_fle2_append_compactionTokens(ctx->crypt,
+                                               &ctx->kb,
+                                               _get_efc(ectx),
+                                               command_name,
+                                               compactionTokens,
+                                               ctx->status)) {
+                bson_destroy(&converted);
+                bson_destroy(compactionTokens);
+                return _mongocrypt_ctx_fail(ctx);
+            }
+            if (!_token_cache_add(ctx, command_name, compactionTokens)) {
+                bson_destroy(&converted);
+                bson_destroy(compactionTokens);
+                return false;
+            }
+        }
+        if (!bson_concat(&converted, compactionTokens)) {
+            bson_destroy(&converted);
+            bson_destroy(compactionTokens);
+            return _mongocrypt_ctx_fail_w_msg(ctx, "unable to append compactionTokens");
+        }
+        bson_destroy(compactionTokens);
     }
 
     // If input command has $db, ensure output command has $db.
@@ -1773,15 +2991,71 @@ static bool _fle2_finalize(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
     return true;
 }
 
+/* Appends the FLE2RangeFindDriverSpec document @v_doc with its bounds replaced
+ * by placeholders to @out as @key. Fails @ctx on error. */
+static bool _range_expression_append_placeholders(mongocrypt_ctx_t *ctx,
+                                                  const bson_t *v_doc,
+                                                  mc_RangeFindIndexBounds_t *bounds,
+                                                  bson_t *out,
+                                                  const char *key) {
+    mc_FLE2RangeFindDriverSpec_t rfds;
+    bson_t with_placeholders = BSON_INITIALIZER;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(v_doc);
+    BSON_ASSERT_PARAM(bounds);
+    BSON_ASSERT_PARAM(out);
+    BSON_ASSERT_PARAM(key);
+
+    if (!mc_FLE2RangeFindDriverSpec_parse(&rfds, v_doc, ctx->status)) {
+        bson_destroy(&with_placeholders);
+        return _mongocrypt_ctx_fail(ctx);
+    }
+
+    // Each expression gets its own payload ID, so the server pairs the two
+    // operators of each expression.
+    if (!mc_FLE2RangeFindDriverSpec_to_placeholders_with_bounds(
+            &rfds,
+            &ctx->opts.rangeopts.value,
+            ctx->opts.contention_factor.value,
+            &ctx->opts.key_id,
+            _mongocrypt_buffer_empty(&ctx->opts.index_key_id) ? &ctx->opts.key_id : &ctx->opts.index_key_id,
+            mc_getNextPayloadId(),
+            bounds,
+            &with_placeholders,
+            ctx->status)) {
+        bson_destroy(&with_placeholders);
+        return _mongocrypt_ctx_fail(ctx);
+    }
+
+    if (!bson_append_document(out, key, -1, &with_placeholders)) {
+        bson_destroy(&with_placeholders);
+        return _mongocrypt_ctx_fail_w_msg(ctx, "unable to append placeholder document");
+    }
+    bson_destroy(&with_placeholders);
+    return true;
+}
+
+/* Encrypts the FLE2RangeFindDriverSpec document 'v', or for an expression
+ * batch each document of the array 'v'. The placeholders of all expressions
+ * are collected into one document, so the index min and max are set up once
+ * and the markings are converted in one pass, by a parallel_for executor if
+ * there are enough of them. */
 static bool FLE2RangeFindDriverSpec_to_ciphertexts(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
     bool ok = false;
     _mongocrypt_ctx_encrypt_t *ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+    mc_RangeFindIndexBounds_t bounds;
+    bson_t in_bson;
+    bson_iter_t v_iter;
+    bson_t v_doc;
 
     BSON_ASSERT_PARAM(ctx);
     BSON_ASSERT_PARAM(out);
 
+    /* with_placholders is the BSON document { 'v': <placeholders> }. */
     bson_t with_placholders = BSON_INITIALIZER;
     bson_t with_ciphertexts = BSON_INITIALIZER;
+    mc_RangeFindIndexBounds_init(&bounds);
 
     if (!ctx->opts.rangeopts.set) {
         _mongocrypt_ctx_fail_w_msg(ctx, "Expected RangeOpts to be set for Range Find");
@@ -1792,20 +3066,48 @@ static bool FLE2RangeFindDriverSpec_to_ciphertexts(mongocrypt_ctx_t *ctx, mongoc
         goto fail;
     }
 
-    bson_t in_bson;
     if (!_mongocrypt_buffer_to_bson(&ectx->original_cmd, &in_bson)) {
         _mongocrypt_ctx_fail_w_msg(ctx, "unable to convert input to BSON");
         goto fail;
     }
 
-    bson_t v_doc;
-    // Parse 'v' document from input.
-    {
-        bson_iter_t v_iter;
-        if (!bson_iter_init_find(&v_iter, &in_bson, "v")) {
-            _mongocrypt_ctx_fail_w_msg(ctx, "invalid input BSON, must contain 'v'");
+    if (!bson_iter_init_find(&v_iter, &in_bson, "v")) {
+        _mongocrypt_ctx_fail_w_msg(ctx, "invalid input BSON, must contain 'v'");
+        goto fail;
+    }
+
+    // Convert each FLE2RangeFindDriverSpec into a document with placeholders.
+    if (ectx->explicit_batch) {
+        bson_iter_t array_iter;
+        bson_t placeholders;
+        uint32_t i = 0;
+
+        if (!BSON_ITER_HOLDS_ARRAY(&v_iter) || !bson_iter_recurse(&v_iter, &array_iter)) {
+            _mongocrypt_ctx_fail_w_msg(ctx, "invalid input BSON, expected 'v' to be array");
             goto fail;
         }
+
+        BSON_APPEND_ARRAY_BEGIN(&with_placholders, "v", &placeholders);
+        while (bson_iter_next(&array_iter)) {
+            const char *key;
+            char buf[16];
+
+            if (!BSON_ITER_HOLDS_DOCUMENT(&array_iter)) {
+                bson_append_array_end(&with_placholders, &placeholders);
+                _mongocrypt_ctx_fail_w_msg(ctx, "invalid input BSON, expected elements of 'v' to be documents");
+                goto fail;
+            }
+            bson_uint32_to_string(i, &key, buf, sizeof(buf));
+            if (!mc_iter_document_as_bson(&array_iter, &v_doc, ctx->status)
+                || !_range_expression_append_placeholders(ctx, &v_doc, &bounds, &placeholders, key)) {
+                bson_append_array_end(&with_placholders, &placeholders);
+                _mongocrypt_ctx_fail(ctx);
+                goto fail;
+            }
+            i++;
+        }
+        bson_append_array_end(&with_placholders, &placeholders);
+    } else {
         if (!BSON_ITER_HOLDS_DOCUMENT(&v_iter)) {
             _mongocrypt_ctx_fail_w_msg(ctx, "invalid input BSON, expected 'v' to be document");
             goto fail;
@@ -1814,28 +3116,7 @@ static bool FLE2RangeFindDriverSpec_to_ciphertexts(mongocrypt_ctx_t *ctx, mongoc
             _mongocrypt_ctx_fail(ctx);
             goto fail;
         }
-    }
-
-    // Parse FLE2RangeFindDriverSpec.
-    {
-        mc_FLE2RangeFindDriverSpec_t rfds;
-
-        if (!mc_FLE2RangeFindDriverSpec_parse(&rfds, &v_doc, ctx->status)) {
-            _mongocrypt_ctx_fail(ctx);
-            goto fail;
-        }
-
-        // Convert FLE2RangeFindDriverSpec into a document with placeholders.
-        if (!mc_FLE2RangeFindDriverSpec_to_placeholders(
-                &rfds,
-                &ctx->opts.rangeopts.value,
-                ctx->opts.contention_factor.value,
-                &ctx->opts.key_id,
-                _mongocrypt_buffer_empty(&ctx->opts.index_key_id) ? &ctx->opts.key_id : &ctx->opts.index_key_id,
-                mc_getNextPayloadId(),
-                &with_placholders,
-                ctx->status)) {
-            _mongocrypt_ctx_fail(ctx);
+        if (!_range_expression_append_placeholders(ctx, &v_doc, &bounds, &with_placholders, "v")) {
             goto fail;
         }
     }
@@ -1847,54 +3128,38 @@ static bool FLE2RangeFindDriverSpec_to_ciphertexts(mongocrypt_ctx_t *ctx, mongoc
             _mongocrypt_ctx_fail_w_msg(ctx, "unable to iterate into placeholder document");
             goto fail;
         }
-        if (!_mongocrypt_transform_binary_in_bson(_replace_marking_with_ciphertext,
-                                                  &ctx->kb,
-                                                  TRAVERSE_MATCH_MARKING,
-                                                  &iter,
-                                                  &with_ciphertexts,
-                                                  ctx->status)) {
+        if (!_replace_markings_with_ciphertexts(ctx, &iter, &with_ciphertexts)) {
+            _mongocrypt_ctx_fail(ctx);
             goto fail;
         }
     }
 
-    // Wrap result in the document: { 'v': <result> }.
-    {
-        /* v_wrapped is the BSON document { 'v': <v_out> }. */
-        bson_t v_wrapped = BSON_INITIALIZER;
-        if (!bson_append_document(&v_wrapped, MONGOCRYPT_STR_AND_LEN("v"), &with_ciphertexts)) {
-            _mongocrypt_ctx_fail_w_msg(ctx, "unable to append document to 'v'");
-            goto fail;
-        }
-        _mongocrypt_buffer_steal_from_bson(&ectx->encrypted_cmd, &v_wrapped);
-        _mongocrypt_buffer_to_binary(&ectx->encrypted_cmd, out);
-        ctx->state = MONGOCRYPT_CTX_DONE;
-    }
+    _mongocrypt_buffer_steal_from_bson(&ectx->encrypted_cmd, &with_ciphertexts);
+    bson_init(&with_ciphertexts);
+    _mongocrypt_buffer_to_binary(&ectx->encrypted_cmd, out);
+    ctx->state = MONGOCRYPT_CTX_DONE;
 
     ok = true;
 fail:
+    mc_RangeFindIndexBounds_cleanup(&bounds);
     bson_destroy(&with_ciphertexts);
     bson_destroy(&with_placholders);
     return ok;
 }
 
-static bool _fle2_finalize_explicit(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
+/* Encrypts the value 'v' of the document @in with the FLE2 explicit encryption
+ * options of @ctx and sets @out to the ciphertext. Fails @ctx on error. */
+static bool _fle2_explicit_encrypt_value(mongocrypt_ctx_t *ctx, const bson_t *in, bson_value_t *out) {
     bool ret = false;
     _mongocrypt_marking_t marking;
-    _mongocrypt_ctx_encrypt_t *ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+    bson_t new_v = BSON_INITIALIZER;
 
     BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(in);
     BSON_ASSERT_PARAM(out);
 
     BSON_ASSERT(ctx->opts.index_type.set);
 
-    if (ctx->opts.rangeopts.set && ctx->opts.query_type.set) {
-        // RangeOpts with query type is a special case. The result contains two
-        // ciphertext values.
-        return FLE2RangeFindDriverSpec_to_ciphertexts(ctx, out);
-    }
-
-    bson_t new_v = BSON_INITIALIZER;
-
     _mongocrypt_marking_init(&marking);
     marking.type = MONGOCRYPT_MARKING_FLE2_ENCRYPTION;
     if (ctx->opts.query_type.set) {
@@ -1934,17 +3199,10 @@ static bool _fle2_finalize_explicit(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *
         // Process the RangeOpts and the input 'v' document into a new 'v'.
         // The new 'v' document will be a FLE2RangeFindSpec or
         // FLE2RangeInsertSpec.
-        bson_t old_v;
-
-        if (!_mongocrypt_buffer_to_bson(&ectx->original_cmd, &old_v)) {
-            _mongocrypt_ctx_fail_w_msg(ctx, "unable to convert input to BSON");
-            goto fail;
-        }
-
-        // RangeOpts with query_type is handled above.
+        // RangeOpts with query_type is handled by FLE2RangeFindDriverSpec_to_ciphertexts.
         BSON_ASSERT(!ctx->opts.query_type.set);
         if (!mc_RangeOpts_to_FLE2RangeInsertSpec(&ctx->opts.rangeopts.value,
-                                                 &old_v,
+                                                 in,
                                                  &new_v,
                                                  ctx->crypt->opts.use_range_v2,
                                                  ctx->status)) {
@@ -1959,72 +3217,386 @@ static bool _fle2_finalize_explicit(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *
 
         marking.fle2.sparsity = ctx->opts.rangeopts.value.sparsity;
 
-    } else {
-        bson_t as_bson;
+    } else {
+        /* Get iterator to input 'v' BSON value. */
+        if (!bson_iter_init_find(&marking.v_iter, in, "v")) {
+            _mongocrypt_ctx_fail_w_msg(ctx, "invalid input BSON, must contain 'v'");
+            goto fail;
+        }
+    }
+
+    _mongocrypt_buffer_copy_to(&ctx->opts.key_id, &marking.fle2.user_key_id);
+    if (!_mongocrypt_buffer_empty(&ctx->opts.index_key_id)) {
+        _mongocrypt_buffer_copy_to(&ctx->opts.index_key_id, &marking.fle2.index_key_id);
+    } else {
+        _mongocrypt_buffer_copy_to(&ctx->opts.key_id, &marking.fle2.index_key_id);
+    }
+
+    if (ctx->opts.contention_factor.set) {
+        marking.fle2.maxContentionFactor = ctx->opts.contention_factor.value;
+    } else if (ctx->opts.index_type.value == MONGOCRYPT_INDEX_TYPE_EQUALITY) {
+        _mongocrypt_ctx_fail_w_msg(ctx, "contention factor required for indexed algorithm");
+        goto fail;
+    }
+
+    /* Convert marking to ciphertext. */
+    if (!_marking_to_bson_value(&ctx->kb, &marking, out, ctx->status)) {
+        _mongocrypt_ctx_fail(ctx);
+        goto fail;
+    }
+
+    ret = true;
+fail:
+    bson_destroy(&new_v);
+    _mongocrypt_marking_cleanup(&marking);
+    return ret;
+}
+
+static bool _fle2_finalize_explicit(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
+    _mongocrypt_ctx_encrypt_t *ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+    bson_t as_bson;
+    bson_value_t v_out;
+    /* v_wrapped is the BSON document { 'v': <v_out> }. */
+    bson_t v_wrapped = BSON_INITIALIZER;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(out);
+
+    if (ctx->opts.rangeopts.set && ctx->opts.query_type.set) {
+        // RangeOpts with query type is a special case. The result contains two
+        // ciphertext values.
+        return FLE2RangeFindDriverSpec_to_ciphertexts(ctx, out);
+    }
+
+    if (!_mongocrypt_buffer_to_bson(&ectx->original_cmd, &as_bson)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "unable to convert input to BSON");
+    }
+
+    if (!_fle2_explicit_encrypt_value(ctx, &as_bson, &v_out)) {
+        return false;
+    }
+
+    bson_append_value(&v_wrapped, MONGOCRYPT_STR_AND_LEN("v"), &v_out);
+    _mongocrypt_buffer_steal_from_bson(&ectx->encrypted_cmd, &v_wrapped);
+    _mongocrypt_buffer_to_binary(&ectx->encrypted_cmd, out);
+    ctx->state = MONGOCRYPT_CTX_DONE;
+    bson_value_destroy(&v_out);
+    return true;
+}
+
+/* Encrypts the value 'v' of the document @in with the FLE1 explicit encryption
+ * options of @ctx and sets @out to the ciphertext. Fails @ctx on error. */
+static bool _fle1_explicit_encrypt_value(mongocrypt_ctx_t *ctx, const bson_t *in, bson_value_t *out) {
+    /* For explicit encryption, we have no marking, but we can fake one */
+    _mongocrypt_marking_t marking;
+    bool res;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(in);
+    BSON_ASSERT_PARAM(out);
+
+    _mongocrypt_marking_init(&marking);
+
+    if (!bson_iter_init_find(&marking.v_iter, in, "v")) {
+        _mongocrypt_marking_cleanup(&marking);
+        return _mongocrypt_ctx_fail_w_msg(ctx, "invalid msg, must contain 'v'");
+    }
+
+    marking.algorithm = ctx->opts.algorithm;
+    _mongocrypt_buffer_set_to(&ctx->opts.key_id, &marking.key_id);
+    if (ctx->opts.key_alt_names) {
+        bson_value_copy(&ctx->opts.key_alt_names->value, &marking.key_alt_name);
+        marking.type = MONGOCRYPT_MARKING_FLE1_BY_ALTNAME;
+    }
+
+    res = _marking_to_bson_value(&ctx->kb, &marking, out, ctx->status);
+    _mongocrypt_marking_cleanup(&marking);
+
+    if (!res) {
+        return _mongocrypt_ctx_fail(ctx);
+    }
+    return true;
+}
+
+/* Encrypts each element of the array 'v' of a batch explicit encryption and
+ * returns the ciphertexts as the array 'v' in the same order. */
+static bool _finalize_explicit_batch(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
+    _mongocrypt_ctx_encrypt_t *ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+    bson_t as_bson;
+    bson_iter_t iter;
+    bson_iter_t array_iter;
+    bson_t converted = BSON_INITIALIZER;
+    bson_t ciphertexts;
+    uint32_t i = 0;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(out);
+
+    if (ctx->opts.rangeopts.set && ctx->opts.query_type.set) {
+        // Each element is a range expression.
+        bson_destroy(&converted);
+        return FLE2RangeFindDriverSpec_to_ciphertexts(ctx, out);
+    }
+
+    if (!_mongocrypt_buffer_to_bson(&ectx->original_cmd, &as_bson)) {
+        bson_destroy(&converted);
+        return _mongocrypt_ctx_fail_w_msg(ctx, "malformed bson");
+    }
+
+    if (!bson_iter_init_find(&iter, &as_bson, "v") || !BSON_ITER_HOLDS_ARRAY(&iter)
+        || !bson_iter_recurse(&iter, &array_iter)) {
+        bson_destroy(&converted);
+        return _mongocrypt_ctx_fail_w_msg(ctx, "invalid msg, must contain array 'v'");
+    }
+
+    BSON_APPEND_ARRAY_BEGIN(&converted, "v", &ciphertexts);
+    while (bson_iter_next(&array_iter)) {
+        /* Each element is encrypted as if it were the single value of an
+         * explicit encryption. */
+        bson_t single = BSON_INITIALIZER;
+        bson_value_t value;
+        const char *key;
+        char buf[16];
+        bool res;
+
+        bson_append_iter(&single, MONGOCRYPT_STR_AND_LEN("v"), &array_iter);
+        if (ctx->opts.index_type.set) {
+            res = _fle2_explicit_encrypt_value(ctx, &single, &value);
+        } else {
+            res = _fle1_explicit_encrypt_value(ctx, &single, &value);
+        }
+        bson_destroy(&single);
+
+        if (!res) {
+            bson_append_array_end(&converted, &ciphertexts);
+            bson_destroy(&converted);
+            return false;
+        }
+
+        bson_uint32_to_string(i, &key, buf, sizeof(buf));
+        bson_append_value(&ciphertexts, key, -1, &value);
+        bson_value_destroy(&value);
+        i++;
+    }
+    bson_append_array_end(&converted, &ciphertexts);
+
+    _mongocrypt_buffer_steal_from_bson(&ectx->encrypted_cmd, &converted);
+    _mongocrypt_buffer_to_binary(&ectx->encrypted_cmd, out);
+    ctx->state = MONGOCRYPT_CTX_DONE;
+    return true;
+}
+
+/* _explain_t accumulates the report of an explain context. */
+typedef struct {
+    mongocrypt_ctx_t *ctx;
+    bson_t fields;
+    uint32_t fields_len;
+    /* uncached_key_ids holds each key ID not in the key cache once. */
+    bson_t uncached_key_ids;
+    int64_t marking_bytes;
+    int64_t ciphertext_bytes;
+} _explain_t;
+
+/* _key_alt_name_cached returns true if the key with @key_alt_name is in the
+ * key cache. */
+static bool _key_alt_name_cached(mongocrypt_t *crypt, const bson_value_t *key_alt_name) {
+    _mongocrypt_key_alt_name_t *alt_names;
+    _mongocrypt_cache_key_attr_t *attr;
+    _mongocrypt_cache_key_value_t *value = NULL;
+    bool cached;
+
+    BSON_ASSERT_PARAM(crypt);
+    BSON_ASSERT_PARAM(key_alt_name);
+
+    alt_names = _mongocrypt_key_alt_name_new(key_alt_name);
+    attr = _mongocrypt_cache_key_attr_new(NULL, alt_names);
+    cached = _mongocrypt_cache_get(_mongocrypt_key_cache(crypt), attr, (void **)&value) && value;
+    _mongocrypt_cache_key_value_destroy(value);
+    _mongocrypt_cache_key_attr_destroy(attr);
+    _mongocrypt_key_alt_name_destroy_all(alt_names);
+    return cached;
+}
+
+/* _explain_key_id appends @key_id to @field as @name, and whether the key is
+ * cached as @cached_name. */
+static void _explain_key_id(_explain_t *ex,
+                            bson_t *field,
+                            const char *name,
+                            const char *cached_name,
+                            const _mongocrypt_buffer_t *key_id) {
+    const bool cached = _key_id_cached(ex->ctx->crypt, key_id);
+
+    BSON_ASSERT(_mongocrypt_buffer_append(key_id, field, name, -1));
+    BSON_ASSERT(bson_append_bool(field, cached_name, -1, cached));
+    if (!cached && !_key_id_in(&ex->uncached_key_ids, key_id)) {
+        char storage[16];
+        const char *key;
+
+        bson_uint32_to_string(bson_count_keys(&ex->uncached_key_ids), &key, storage, sizeof(storage));
+        BSON_ASSERT(_mongocrypt_buffer_append(key_id, &ex->uncached_key_ids, key, -1));
+    }
+}
+
+static const char *_fle2_algorithm_name(mongocrypt_fle2_encryption_algorithm_t algorithm) {
+    switch (algorithm) {
+    case MONGOCRYPT_FLE2_ALGORITHM_EQUALITY: return MONGOCRYPT_ALGORITHM_INDEXED_STR;
+    case MONGOCRYPT_FLE2_ALGORITHM_RANGE: return MONGOCRYPT_ALGORITHM_RANGE_STR;
+    case MONGOCRYPT_FLE2_ALGORITHM_UNINDEXED:
+    default: return MONGOCRYPT_ALGORITHM_UNINDEXED_STR;
+    }
+}
+
+/* _explain_marking appends the report of the marking @in at @path. */
+static bool
+_explain_marking(_explain_t *ex, const char *path, const _mongocrypt_buffer_t *in, mongocrypt_status_t *status) {
+    _mongocrypt_marking_t marking;
+    bson_t field;
+    char storage[16];
+    const char *key;
+    uint64_t range_len;
+    uint64_t estimate;
+
+    _mongocrypt_marking_init(&marking);
+    if (!_mongocrypt_marking_parse_unowned_unchecked(in, &marking, status)
+        || !_mongocrypt_marking_range_len(ex->ctx->crypt, &marking, &range_len, status)) {
+        _mongocrypt_marking_cleanup(&marking);
+        return false;
+    }
+    estimate = _mongocrypt_marking_ciphertext_len_estimate(&marking, in);
+
+    bson_uint32_to_string(ex->fields_len++, &key, storage, sizeof(storage));
+    BSON_ASSERT(BSON_APPEND_DOCUMENT_BEGIN(&ex->fields, key, &field));
+    BSON_ASSERT(BSON_APPEND_UTF8(&field, "path", path));
+    if (marking.type == MONGOCRYPT_MARKING_FLE2_ENCRYPTION) {
+        const bool find = marking.fle2.type == MONGOCRYPT_FLE2_PLACEHOLDER_TYPE_FIND;
+
+        BSON_ASSERT(BSON_APPEND_UTF8(&field, "algorithm", _fle2_algorithm_name(marking.fle2.algorithm)));
+        BSON_ASSERT(BSON_APPEND_UTF8(&field, "type", find ? "find" : "insert"));
+        _explain_key_id(ex, &field, "keyId", "keyCached", &marking.fle2.user_key_id);
+        _explain_key_id(ex, &field, "indexKeyId", "indexKeyCached", &marking.fle2.index_key_id);
+        if (marking.fle2.algorithm == MONGOCRYPT_FLE2_ALGORITHM_RANGE) {
+            BSON_ASSERT(BSON_APPEND_INT64(&field, find ? "mincover" : "edges", (int64_t)range_len));
+        }
+    } else {
+        BSON_ASSERT(BSON_APPEND_UTF8(&field,
+                                     "algorithm",
+                                     marking.algorithm == MONGOCRYPT_ENCRYPTION_ALGORITHM_DETERMINISTIC
+                                         ? MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR
+                                         : MONGOCRYPT_ALGORITHM_RANDOM_STR));
+        if (marking.type == MONGOCRYPT_MARKING_FLE1_BY_ID) {
+            _explain_key_id(ex, &field, "keyId", "keyCached", &marking.key_id);
+        } else {
+            BSON_ASSERT(BSON_APPEND_VALUE(&field, "keyAltName", &marking.key_alt_name));
+            BSON_ASSERT(
+                BSON_APPEND_BOOL(&field, "keyCached", _key_alt_name_cached(ex->ctx->crypt, &marking.key_alt_name)));
+        }
+    }
+    BSON_ASSERT(BSON_APPEND_INT64(&field, "markingBytes", (int64_t)in->len));
+    BSON_ASSERT(BSON_APPEND_INT64(&field, "ciphertextBytesEstimate", (int64_t)estimate));
+    BSON_ASSERT(bson_append_document_end(&ex->fields, &field));
+
+    ex->marking_bytes += (int64_t)in->len;
+    ex->ciphertext_bytes += (int64_t)estimate;
+    _mongocrypt_marking_cleanup(&marking);
+    return true;
+}
+
+/* _explain_walk appends the report of each marking under @iter. @path is the
+ * dotted path of the elements of @iter, or NULL at the top level. */
+static bool _explain_walk(_explain_t *ex, bson_iter_t *iter, const char *path, mongocrypt_status_t *status) {
+    while (bson_iter_next(iter)) {
+        const char *key = bson_iter_key(iter);
+        char *field_path = path ? bson_strdup_printf("%s.%s", path, key) : bson_strdup(key);
+        bool ok = true;
+
+        if (BSON_ITER_HOLDS_DOCUMENT(iter) || BSON_ITER_HOLDS_ARRAY(iter)) {
+            bson_iter_t child;
+
+            if (!bson_iter_recurse(iter, &child)) {
+                CLIENT_ERR("malformed marked command");
+                ok = false;
+            } else {
+                ok = _explain_walk(ex, &child, field_path, status);
+            }
+        } else if (BSON_ITER_HOLDS_BINARY(iter)) {
+            _mongocrypt_buffer_t in;
 
-        /* Get iterator to input 'v' BSON value. */
-        if (!_mongocrypt_buffer_to_bson(&ectx->original_cmd, &as_bson)) {
-            _mongocrypt_ctx_fail_w_msg(ctx, "unable to convert input to BSON");
-            goto fail;
+            if (_mongocrypt_buffer_from_binary_iter(&in, iter) && in.subtype == BSON_SUBTYPE_ENCRYPTED && in.len > 0
+                && (in.data[0] == MC_SUBTYPE_FLE1EncryptionPlaceholder
+                    || in.data[0] == MC_SUBTYPE_FLE2EncryptionPlaceholder)) {
+                ok = _explain_marking(ex, field_path, &in, status);
+            }
         }
-
-        if (!bson_iter_init_find(&marking.v_iter, &as_bson, "v")) {
-            _mongocrypt_ctx_fail_w_msg(ctx, "invalid input BSON, must contain 'v'");
-            goto fail;
+        bson_free(field_path);
+        if (!ok) {
+            return false;
         }
     }
+    return true;
+}
 
-    _mongocrypt_buffer_copy_to(&ctx->opts.key_id, &marking.fle2.user_key_id);
-    if (!_mongocrypt_buffer_empty(&ctx->opts.index_key_id)) {
-        _mongocrypt_buffer_copy_to(&ctx->opts.index_key_id, &marking.fle2.index_key_id);
-    } else {
-        _mongocrypt_buffer_copy_to(&ctx->opts.key_id, &marking.fle2.index_key_id);
-    }
+/* _finalize_explain returns a report of the markings of the command instead of
+ * encrypting it. */
+static bool _finalize_explain(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
+    _mongocrypt_ctx_encrypt_t *ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+    _explain_t ex = {.ctx = ctx};
+    bson_t doc = BSON_INITIALIZER;
+    bool ok = true;
+
+    bson_init(&ex.fields);
+    bson_init(&ex.uncached_key_ids);
+    if (!_mongocrypt_buffer_empty(&ectx->marked_cmd)) {
+        bson_t marked;
+        bson_iter_t iter;
 
-    if (ctx->opts.contention_factor.set) {
-        marking.fle2.maxContentionFactor = ctx->opts.contention_factor.value;
-    } else if (ctx->opts.index_type.value == MONGOCRYPT_INDEX_TYPE_EQUALITY) {
-        _mongocrypt_ctx_fail_w_msg(ctx, "contention factor required for indexed algorithm");
-        goto fail;
+        if (!_mongocrypt_buffer_to_bson(&ectx->marked_cmd, &marked) || !bson_iter_init(&iter, &marked)) {
+            ok = _mongocrypt_ctx_fail_w_msg(ctx, "malformed bson");
+        } else if (!_explain_walk(&ex, &iter, NULL, ctx->status)) {
+            ok = _mongocrypt_ctx_fail(ctx);
+        }
     }
 
-    /* Convert marking to ciphertext. */
-    {
-        bson_value_t v_out;
-        /* v_wrapped is the BSON document { 'v': <v_out> }. */
-        bson_t v_wrapped = BSON_INITIALIZER;
-
-        if (!_marking_to_bson_value(&ctx->kb, &marking, &v_out, ctx->status)) {
-            bson_destroy(&v_wrapped);
-            _mongocrypt_ctx_fail(ctx);
-            goto fail;
-        }
+    if (ok) {
+        const int64_t cmd_bytes = (int64_t)ectx->original_cmd.len;
 
-        bson_append_value(&v_wrapped, MONGOCRYPT_STR_AND_LEN("v"), &v_out);
-        _mongocrypt_buffer_steal_from_bson(&ectx->encrypted_cmd, &v_wrapped);
+        BSON_ASSERT(BSON_APPEND_ARRAY(&doc, "fields", &ex.fields));
+        BSON_ASSERT(BSON_APPEND_ARRAY(&doc, "uncachedKeyIds", &ex.uncached_key_ids));
+        BSON_ASSERT(BSON_APPEND_INT64(&doc, "markingBytes", ex.marking_bytes));
+        BSON_ASSERT(BSON_APPEND_INT64(&doc, "ciphertextBytesEstimate", ex.ciphertext_bytes));
+        BSON_ASSERT(BSON_APPEND_INT64(&doc, "commandBytes", cmd_bytes));
+        BSON_ASSERT(BSON_APPEND_INT64(&doc,
+                                      "encryptedCommandBytesEstimate",
+                                      cmd_bytes - ex.marking_bytes + ex.ciphertext_bytes));
+        _mongocrypt_buffer_cleanup(&ectx->encrypted_cmd);
+        _mongocrypt_buffer_steal_from_bson(&ectx->encrypted_cmd, &doc);
         _mongocrypt_buffer_to_binary(&ectx->encrypted_cmd, out);
         ctx->state = MONGOCRYPT_CTX_DONE;
-        bson_value_destroy(&v_out);
+    } else {
+        bson_destroy(&doc);
     }
-
-    ret = true;
-fail:
-    bson_destroy(&new_v);
-    _mongocrypt_marking_cleanup(&marking);
-    return ret;
+    bson_destroy(&ex.uncached_key_ids);
+    bson_destroy(&ex.fields);
+    return ok;
 }
 
 static bool _finalize(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
     bson_t as_bson, converted;
     bson_iter_t iter = {0};
     _mongocrypt_ctx_encrypt_t *ectx;
-    bool res;
 
     BSON_ASSERT_PARAM(ctx);
     BSON_ASSERT_PARAM(out);
 
     ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
 
+    if (ectx->explain) {
+        return _finalize_explain(ctx, out);
+    }
+
+    if (ectx->explicit_batch) {
+        return _finalize_explicit_batch(ctx, out);
+    }
+
     if (context_uses_fle2(ctx)) {
         return _fle2_finalize(ctx, out);
     } else if (ctx->opts.index_type.set) {
@@ -2042,13 +3614,7 @@ static bool _finalize(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
         }
 
         bson_iter_init(&iter, &as_bson);
-        bson_init(&converted);
-        if (!_mongocrypt_transform_binary_in_bson(_replace_marking_with_ciphertext,
-                                                  &ctx->kb,
-                                                  TRAVERSE_MATCH_MARKING,
-                                                  &iter,
-                                                  &converted,
-                                                  ctx->status)) {
+        if (!_replace_markings_with_ciphertexts(ctx, &iter, &converted)) {
             bson_destroy(&converted);
             return _mongocrypt_ctx_fail(ctx);
         }
@@ -2067,43 +3633,19 @@ static bool _finalize(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
             }
         }
     } else {
-        /* For explicit encryption, we have no marking, but we can fake one */
-        _mongocrypt_marking_t marking;
         bson_value_t value;
 
-        memset(&value, 0, sizeof(value));
-
-        _mongocrypt_marking_init(&marking);
-
         if (!_mongocrypt_buffer_to_bson(&ectx->original_cmd, &as_bson)) {
             return _mongocrypt_ctx_fail_w_msg(ctx, "malformed bson");
         }
 
-        if (!bson_iter_init_find(&iter, &as_bson, "v")) {
-            return _mongocrypt_ctx_fail_w_msg(ctx, "invalid msg, must contain 'v'");
-        }
-
-        memcpy(&marking.v_iter, &iter, sizeof(bson_iter_t));
-        marking.algorithm = ctx->opts.algorithm;
-        _mongocrypt_buffer_set_to(&ctx->opts.key_id, &marking.key_id);
-        if (ctx->opts.key_alt_names) {
-            bson_value_copy(&ctx->opts.key_alt_names->value, &marking.key_alt_name);
-            marking.type = MONGOCRYPT_MARKING_FLE1_BY_ALTNAME;
+        if (!_fle1_explicit_encrypt_value(ctx, &as_bson, &value)) {
+            return false;
         }
 
         bson_init(&converted);
-        res = _marking_to_bson_value(&ctx->kb, &marking, &value, ctx->status);
-        if (res) {
-            bson_append_value(&converted, MONGOCRYPT_STR_AND_LEN("v"), &value);
-        }
-
+        bson_append_value(&converted, MONGOCRYPT_STR_AND_LEN("v"), &value);
         bson_value_destroy(&value);
-        _mongocrypt_marking_cleanup(&marking);
-
-        if (!res) {
-            bson_destroy(&converted);
-            return _mongocrypt_ctx_fail(ctx);
-        }
     }
 
     _mongocrypt_buffer_steal_from_bson(&ectx->encrypted_cmd, &converted);
@@ -2125,46 +3667,57 @@ static void _cleanup(mongocrypt_ctx_t *ctx) {
     bson_free(ectx->cmd_db);
     bson_free(ectx->target_db);
     bson_free(ectx->target_coll);
+    for (size_t i = 0; i < ectx->bulkWrite_ns_count; i++) {
+        _mongocrypt_ctx_encrypt_ns_t *ns = &ectx->bulkWrite_ns[i];
+
+        bson_free(ns->db);
+        bson_free(ns->coll);
+        bson_free(ns->ns);
+        _mongocrypt_buffer_cleanup(&ns->encrypted_field_config);
+        _mongocrypt_buffer_cleanup(&ns->encryption_information_schema);
+        _mongocrypt_cache_collinfo_value_destroy(ns->collinfo);
+    }
+    bson_free(ectx->bulkWrite_ns);
     _mongocrypt_buffer_cleanup(&ectx->list_collections_filter);
     _mongocrypt_buffer_cleanup(&ectx->schema);
     _mongocrypt_buffer_cleanup(&ectx->encrypted_field_config);
     _mongocrypt_buffer_cleanup(&ectx->original_cmd);
     _mongocrypt_buffer_cleanup(&ectx->mongocryptd_cmd);
+    _mongocrypt_buffer_cleanup(&ectx->marking_cache_key);
+    _mongocrypt_buffer_cleanup(&ectx->encryption_information_schema);
+    _mongocrypt_buffer_cleanup(&ectx->prefetch_key_ids);
     _mongocrypt_buffer_cleanup(&ectx->marked_cmd);
+    if (ectx->csfle_marked_bson) {
+        ctx->crypt->csfle.bson_free(ectx->csfle_marked_bson);
+    }
     _mongocrypt_buffer_cleanup(&ectx->encrypted_cmd);
     _mongocrypt_buffer_cleanup(&ectx->ismaster.cmd);
     mc_EncryptedFieldConfig_cleanup(&ectx->efc);
+    _mongocrypt_cache_collinfo_value_destroy(ectx->collinfo);
+    mc_mapof_ns_to_schema_destroy(ectx->schema_map);
+    mc_mapof_ns_to_schema_destroy(ectx->encrypted_field_config_map);
 }
 
 static bool _try_schema_from_schema_map(mongocrypt_ctx_t *ctx) {
-    mongocrypt_t *crypt;
     _mongocrypt_ctx_encrypt_t *ectx;
-    bson_t schema_map;
-    bson_iter_t iter;
+    const mc_schema_map_entry_t *entry;
 
     BSON_ASSERT_PARAM(ctx);
 
-    crypt = ctx->crypt;
     ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
 
-    if (_mongocrypt_buffer_empty(&crypt->opts.schema_map)) {
-        /* No schema map set. */
+    entry = mc_mapof_ns_to_schema_get(ectx->schema_map, ectx->target_ns);
+    if (!entry) {
+        /* No schema found in map. */
         return true;
     }
 
-    if (!_mongocrypt_buffer_to_bson(&crypt->opts.schema_map, &schema_map)) {
+    if (_mongocrypt_buffer_empty(&entry->doc)) {
         return _mongocrypt_ctx_fail_w_msg(ctx, "malformed schema map");
     }
-
-    if (bson_iter_init_find(&iter, &schema_map, ectx->target_ns)) {
-        if (!_mongocrypt_buffer_copy_from_document_iter(&ectx->schema, &iter)) {
-            return _mongocrypt_ctx_fail_w_msg(ctx, "malformed schema map");
-        }
-        ectx->used_local_schema = true;
-        ctx->state = MONGOCRYPT_CTX_NEED_MONGO_MARKINGS;
-    }
-
-    /* No schema found in map. */
+    _mongocrypt_buffer_set_to(&entry->doc, &ectx->schema);
+    ectx->used_local_schema = true;
+    ctx->state = MONGOCRYPT_CTX_NEED_MONGO_MARKINGS;
     return true;
 }
 
@@ -2173,49 +3726,37 @@ static bool _try_schema_from_schema_map(mongocrypt_ctx_t *ctx) {
  * If an encrypted field config is found, the context transitions to
  * MONGOCRYPT_CTX_NEED_MONGO_MARKINGS. */
 static bool _fle2_try_encrypted_field_config_from_map(mongocrypt_ctx_t *ctx) {
-    mongocrypt_t *crypt;
     _mongocrypt_ctx_encrypt_t *ectx;
-    bson_t encrypted_field_config_map;
-    bson_iter_t iter;
+    const mc_schema_map_entry_t *entry;
 
     BSON_ASSERT_PARAM(ctx);
 
-    crypt = ctx->crypt;
     ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
 
-    if (_mongocrypt_buffer_empty(&crypt->opts.encrypted_field_config_map)) {
-        /* No encrypted_field_config_map set. */
+    entry = mc_mapof_ns_to_schema_get(ectx->encrypted_field_config_map, ectx->target_ns);
+    if (!entry) {
+        /* No encrypted_field_config found in map. */
         return true;
     }
 
-    if (!_mongocrypt_buffer_to_bson(&crypt->opts.encrypted_field_config_map, &encrypted_field_config_map)) {
-        return _mongocrypt_ctx_fail_w_msg(ctx, "unable to convert encrypted_field_config_map to BSON");
+    if (_mongocrypt_buffer_empty(&entry->doc)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx,
+                                          "unable to copy encrypted_field_config from "
+                                          "encrypted_field_config_map");
     }
-
-    if (bson_iter_init_find(&iter, &encrypted_field_config_map, ectx->target_ns)) {
-        if (!_mongocrypt_buffer_copy_from_document_iter(&ectx->encrypted_field_config, &iter)) {
-            return _mongocrypt_ctx_fail_w_msg(ctx,
-                                              "unable to copy encrypted_field_config from "
-                                              "encrypted_field_config_map");
-        }
-        bson_t efc_bson;
-        if (!_mongocrypt_buffer_to_bson(&ectx->encrypted_field_config, &efc_bson)) {
-            return _mongocrypt_ctx_fail_w_msg(ctx, "unable to create BSON from encrypted_field_config");
-        }
-        if (!mc_EncryptedFieldConfig_parse(&ectx->efc, &efc_bson, ctx->status)) {
-            _mongocrypt_ctx_fail(ctx);
-            return false;
-        }
-        ctx->state = MONGOCRYPT_CTX_NEED_MONGO_MARKINGS;
+    if (entry->error) {
+        _mongocrypt_status_copy_to(entry->error, ctx->status);
+        return _mongocrypt_ctx_fail(ctx);
     }
-
-    /* No encrypted_field_config found in map. */
+    _mongocrypt_buffer_set_to(&entry->doc, &ectx->encrypted_field_config);
+    ectx->shared_efc = &entry->efc;
+    ctx->state = MONGOCRYPT_CTX_NEED_MONGO_MARKINGS;
     return true;
 }
 
 static bool _try_schema_from_cache(mongocrypt_ctx_t *ctx) {
     _mongocrypt_ctx_encrypt_t *ectx;
-    bson_t *collinfo = NULL;
+    _mongocrypt_cache_collinfo_value_t *collinfo = NULL;
 
     BSON_ASSERT_PARAM(ctx);
 
@@ -2231,7 +3772,7 @@ static bool _try_schema_from_cache(mongocrypt_ctx_t *ctx) {
 
     if (collinfo) {
         if (!_set_schema_from_collinfo(ctx, collinfo)) {
-            bson_destroy(collinfo);
+            _mongocrypt_cache_collinfo_value_destroy(collinfo);
             return _mongocrypt_ctx_fail(ctx);
         }
         ctx->state = MONGOCRYPT_CTX_NEED_MONGO_MARKINGS;
@@ -2251,7 +3792,55 @@ static bool _try_schema_from_cache(mongocrypt_ctx_t *ctx) {
         }
     }
 
-    bson_destroy(collinfo);
+    _mongocrypt_cache_collinfo_value_destroy(collinfo);
+    return true;
+}
+
+/* _bulkWrite_try_ns_from_map_or_cache resolves the `bulkWrite` namespaces after
+ * the target namespace from the encrypted field config map or the collinfo
+ * cache. */
+static bool _bulkWrite_try_ns_from_map_or_cache(mongocrypt_ctx_t *ctx) {
+    _mongocrypt_ctx_encrypt_t *ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+
+    BSON_ASSERT_PARAM(ctx);
+
+    for (size_t i = 1; i < ectx->bulkWrite_ns_count; i++) {
+        _mongocrypt_ctx_encrypt_ns_t *ns = &ectx->bulkWrite_ns[i];
+        _mongocrypt_cache_collinfo_value_t *collinfo = NULL;
+        const mc_schema_map_entry_t *entry;
+
+        if (ns->resolved) {
+            continue;
+        }
+
+        entry = mc_mapof_ns_to_schema_get(ectx->encrypted_field_config_map, ns->ns);
+        if (entry) {
+            if (_mongocrypt_buffer_empty(&entry->doc)) {
+                return _mongocrypt_ctx_fail_w_msg(ctx,
+                                                  "unable to copy encrypted_field_config from "
+                                                  "encrypted_field_config_map");
+            }
+            if (entry->error) {
+                _mongocrypt_status_copy_to(entry->error, ctx->status);
+                return _mongocrypt_ctx_fail(ctx);
+            }
+            _mongocrypt_buffer_set_to(&entry->doc, &ns->encrypted_field_config);
+            ns->resolved = true;
+            continue;
+        }
+
+        if (!_mongocrypt_cache_get(&ctx->crypt->cache_collinfo, ns->ns, (void **)&collinfo)) {
+            return _mongocrypt_ctx_fail_w_msg(ctx, "failed to retrieve from cache");
+        }
+        if (collinfo) {
+            bool ok = _bulkWrite_set_ns_from_collinfo(ns, collinfo, ctx->status);
+
+            _mongocrypt_cache_collinfo_value_destroy(collinfo);
+            if (!ok) {
+                return _mongocrypt_ctx_fail(ctx);
+            }
+        }
+    }
     return true;
 }
 
@@ -2340,68 +3929,13 @@ static bool _try_schema_from_create_or_collMod_cmd(mongocrypt_ctx_t *ctx) {
     return true;
 }
 
-static bool
-_permitted_for_encryption(bson_iter_t *iter, mongocrypt_encryption_algorithm_t algo, mongocrypt_status_t *status) {
-    bson_type_t bson_type;
-    const bson_value_t *bson_value;
-    bool ret = false;
-
-    BSON_ASSERT_PARAM(iter);
-
-    bson_value = bson_iter_value(iter);
-    if (!bson_value) {
-        CLIENT_ERR("Unknown BSON type");
-        goto fail;
-    }
-    bson_type = bson_value->value_type;
-    switch (bson_type) {
-    case BSON_TYPE_NULL:
-    case BSON_TYPE_MINKEY:
-    case BSON_TYPE_MAXKEY:
-    case BSON_TYPE_UNDEFINED: CLIENT_ERR("BSON type invalid for encryption"); goto fail;
-    case BSON_TYPE_BINARY:
-        if (bson_value->value.v_binary.subtype == BSON_SUBTYPE_ENCRYPTED) {
-            CLIENT_ERR("BSON binary subtype 6 is invalid for encryption");
-            goto fail;
-        }
-        /* ok */
-        break;
-    case BSON_TYPE_DOUBLE:
-    case BSON_TYPE_DOCUMENT:
-    case BSON_TYPE_ARRAY:
-    case BSON_TYPE_CODEWSCOPE:
-    case BSON_TYPE_BOOL:
-    case BSON_TYPE_DECIMAL128:
-        if (algo == MONGOCRYPT_ENCRYPTION_ALGORITHM_DETERMINISTIC) {
-            CLIENT_ERR("BSON type invalid for deterministic encryption");
-            goto fail;
-        }
-        break;
-    case BSON_TYPE_UTF8:
-    case BSON_TYPE_OID:
-    case BSON_TYPE_DATE_TIME:
-    case BSON_TYPE_REGEX:
-    case BSON_TYPE_DBPOINTER:
-    case BSON_TYPE_CODE:
-    case BSON_TYPE_SYMBOL:
-    case BSON_TYPE_INT32:
-    case BSON_TYPE_TIMESTAMP:
-    case BSON_TYPE_INT64:
-        /* ok */
-        break;
-    case BSON_TYPE_EOD:
-    default: CLIENT_ERR("invalid BSON value type 00"); goto fail;
-    }
-
-    ret = true;
-fail:
-    return ret;
-}
-
 // explicit_encrypt_init is common code shared by
-// mongocrypt_ctx_explicit_encrypt_init and
-// mongocrypt_ctx_explicit_encrypt_expression_init.
-static bool explicit_encrypt_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *msg) {
+// mongocrypt_ctx_explicit_encrypt_init,
+// mongocrypt_ctx_explicit_encrypt_expression_init,
+// mongocrypt_ctx_explicit_encrypt_batch_init, and
+// mongocrypt_ctx_explicit_encrypt_expression_batch_init. If `batch` is true,
+// 'v' must be an array of values or expressions to encrypt.
+static bool explicit_encrypt_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *msg, bool batch) {
     _mongocrypt_ctx_encrypt_t *ectx;
     bson_t as_bson;
     bson_iter_t iter;
@@ -2538,7 +4072,9 @@ static bool explicit_encrypt_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *ms
 
     ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
     ctx->type = _MONGOCRYPT_TYPE_ENCRYPT;
+    _mongocrypt_counter_add(ctx->crypt, MC_COUNTER_CTX_ENCRYPT, 1);
     ectx->explicit = true;
+    ectx->explicit_batch = batch;
     ctx->vtable.finalize = _finalize;
     ctx->vtable.cleanup = _cleanup;
 
@@ -2565,6 +4101,7 @@ static bool explicit_encrypt_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *ms
     _mongocrypt_buffer_init(&ectx->original_cmd);
 
     _mongocrypt_buffer_copy_from_binary(&ectx->original_cmd, msg);
+    _mongocrypt_counter_add(ctx->crypt, MC_COUNTER_BYTES_ENCRYPT, ectx->original_cmd.len);
     if (!_mongocrypt_buffer_to_bson(&ectx->original_cmd, &as_bson)) {
         return _mongocrypt_ctx_fail_w_msg(ctx, "msg must be bson");
     }
@@ -2580,7 +4117,25 @@ static bool explicit_encrypt_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *ms
         return _mongocrypt_ctx_fail_w_msg(ctx, "invalid msg, must contain 'v'");
     }
 
-    if (!_permitted_for_encryption(&iter, ctx->opts.algorithm, ctx->status)) {
+    if (batch) {
+        bson_iter_t array_iter;
+        bool any = false;
+
+        if (!BSON_ITER_HOLDS_ARRAY(&iter) || !bson_iter_recurse(&iter, &array_iter)) {
+            return _mongocrypt_ctx_fail_w_msg(ctx, "invalid msg, 'v' must be an array");
+        }
+
+        while (bson_iter_next(&array_iter)) {
+            if (!_mongocrypt_permitted_for_encryption(&array_iter, ctx->opts.algorithm, ctx->status)) {
+                return _mongocrypt_ctx_fail(ctx);
+            }
+            any = true;
+        }
+
+        if (!any) {
+            return _mongocrypt_ctx_fail_w_msg(ctx, "invalid msg, 'v' must not be empty");
+        }
+    } else if (!_mongocrypt_permitted_for_encryption(&iter, ctx->opts.algorithm, ctx->status)) {
         return _mongocrypt_ctx_fail(ctx);
     }
 
@@ -2589,7 +4144,11 @@ static bool explicit_encrypt_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *ms
 }
 
 bool mongocrypt_ctx_explicit_encrypt_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *msg) {
-    if (!explicit_encrypt_init(ctx, msg)) {
+    if (!ctx) {
+        return false;
+    }
+    _mongocrypt_ctx_record_init(ctx, "ctx_explicit_encrypt_init", NULL, 0, msg);
+    if (!explicit_encrypt_init(ctx, msg, false)) {
         return false;
     }
     if (ctx->opts.query_type.set
@@ -2600,8 +4159,94 @@ bool mongocrypt_ctx_explicit_encrypt_init(mongocrypt_ctx_t *ctx, mongocrypt_bina
     return true;
 }
 
+bool mongocrypt_ctx_explicit_encrypt_value_init(mongocrypt_ctx_t *ctx, uint8_t type, mongocrypt_binary_t *value) {
+    /* The document {v: <value>} is the length, the type byte, the key "v", the
+     * value, and the trailing NUL. */
+    const uint32_t overhead = 4u + 1u + 2u + 1u;
+    mongocrypt_binary_t *msg;
+    bson_t as_bson;
+    uint8_t *data;
+    uint32_t len;
+    bool ret;
+
+    if (!ctx) {
+        return false;
+    }
+
+    if (!value || (!value->data && value->len > 0)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "invalid value");
+    }
+
+    if (value->len > (uint32_t)INT32_MAX - overhead) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "value too large");
+    }
+
+    len = value->len + overhead;
+    data = bson_malloc(len);
+    BSON_ASSERT(data);
+    {
+        const uint32_t len_le = BSON_UINT32_TO_LE(len);
+        memcpy(data, &len_le, sizeof(len_le));
+    }
+    data[4] = type;
+    data[5] = 'v';
+    data[6] = '\0';
+    if (value->len > 0) {
+        memcpy(data + 7, value->data, value->len);
+    }
+    data[len - 1u] = '\0';
+
+    if (!bson_init_static(&as_bson, data, len) || !bson_validate(&as_bson, BSON_VALIDATE_NONE, NULL)) {
+        bson_free(data);
+        return _mongocrypt_ctx_fail_w_msg(ctx, "value is not a valid BSON value of the given type");
+    }
+
+    msg = mongocrypt_binary_new_from_data(data, len);
+    ctx->raw_value = true;
+    ret = mongocrypt_ctx_explicit_encrypt_init(ctx, msg);
+    mongocrypt_binary_destroy(msg);
+    bson_free(data);
+    return ret;
+}
+
+bool mongocrypt_ctx_explicit_encrypt_batch_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *msg) {
+    if (!ctx) {
+        return false;
+    }
+    _mongocrypt_ctx_record_init(ctx, "ctx_explicit_encrypt_batch_init", NULL, 0, msg);
+    if (!explicit_encrypt_init(ctx, msg, true)) {
+        return false;
+    }
+    if (ctx->opts.query_type.set
+        && (ctx->opts.query_type.value == MONGOCRYPT_QUERY_TYPE_RANGE
+            || ctx->opts.query_type.value == MONGOCRYPT_QUERY_TYPE_RANGEPREVIEW_DEPRECATED)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "EncryptBatch may not be used for range queries.");
+    }
+    return true;
+}
+
+bool mongocrypt_ctx_explicit_encrypt_expression_batch_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *msg) {
+    if (!ctx) {
+        return false;
+    }
+    _mongocrypt_ctx_record_init(ctx, "ctx_explicit_encrypt_expression_batch_init", NULL, 0, msg);
+    if (!explicit_encrypt_init(ctx, msg, true)) {
+        return false;
+    }
+    if (!ctx->opts.query_type.set
+        || !(ctx->opts.query_type.value == MONGOCRYPT_QUERY_TYPE_RANGE
+             || ctx->opts.query_type.value == MONGOCRYPT_QUERY_TYPE_RANGEPREVIEW_DEPRECATED)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "EncryptExpressionBatch may only be used for range queries.");
+    }
+    return true;
+}
+
 bool mongocrypt_ctx_explicit_encrypt_expression_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *msg) {
-    if (!explicit_encrypt_init(ctx, msg)) {
+    if (!ctx) {
+        return false;
+    }
+    _mongocrypt_ctx_record_init(ctx, "ctx_explicit_encrypt_expression_init", NULL, 0, msg);
+    if (!explicit_encrypt_init(ctx, msg, false)) {
         return false;
     }
     if (!ctx->opts.query_type.set
@@ -2612,54 +4257,75 @@ bool mongocrypt_ctx_explicit_encrypt_expression_init(mongocrypt_ctx_t *ctx, mong
     return true;
 }
 
+/* _check_cmd_for_auto_encrypt_bulkWrite parses the namespace of each element of
+ * `nsInfo` into @bulkWrite_ns. The array is set before the namespaces are
+ * parsed, so it must be freed on failure too. */
 static bool _check_cmd_for_auto_encrypt_bulkWrite(mongocrypt_binary_t *cmd,
-                                                  char **target_db,
-                                                  char **target_coll,
+                                                  _mongocrypt_ctx_encrypt_ns_t **bulkWrite_ns,
+                                                  size_t *bulkWrite_ns_count,
                                                   mongocrypt_status_t *status) {
     BSON_ASSERT_PARAM(cmd);
-    BSON_ASSERT_PARAM(target_db);
-    BSON_ASSERT_PARAM(target_coll);
+    BSON_ASSERT_PARAM(bulkWrite_ns);
+    BSON_ASSERT_PARAM(bulkWrite_ns_count);
 
     bson_t as_bson;
-    bson_iter_t cmd_iter = {0};
+    bson_iter_t nsInfo_iter = {0};
+    bson_iter_t iter;
+    size_t count = 0;
 
-    if (!_mongocrypt_binary_to_bson(cmd, &as_bson) || !bson_iter_init(&cmd_iter, &as_bson)) {
+    if (!_mongocrypt_binary_to_bson(cmd, &as_bson) || !bson_iter_init(&nsInfo_iter, &as_bson)) {
         CLIENT_ERR("invalid command BSON");
         return false;
     }
 
-    bson_iter_t ns_iter = cmd_iter;
-    if (!bson_iter_find_descendant(&ns_iter, "nsInfo.0.ns", &ns_iter)) {
+    if (!bson_iter_find(&nsInfo_iter, "nsInfo") || !BSON_ITER_HOLDS_ARRAY(&nsInfo_iter)
+        || !bson_iter_recurse(&nsInfo_iter, &iter)) {
         CLIENT_ERR("failed to find namespace in `bulkWrite` command");
         return false;
     }
-
-    if (!BSON_ITER_HOLDS_UTF8(&ns_iter)) {
-        CLIENT_ERR("expected namespace to be UTF8, got: %s", mc_bson_type_to_string(bson_iter_type(&ns_iter)));
-        return false;
-    }
-
-    const char *target_ns = bson_iter_utf8(&ns_iter, NULL /* length */);
-    // Parse `target_ns` into "<db>.<coll>"
-    const char *dot = strstr(target_ns, ".");
-    if (!dot) {
-        CLIENT_ERR("expected namespace to contain dot, got: %s", target_ns);
-        return false;
+    while (bson_iter_next(&iter)) {
+        count++;
     }
-    *target_coll = bson_strdup(dot + 1);
-    // Get the database from the `ns` field (which may differ from `cmd_db`).
-    ptrdiff_t db_len = dot - target_ns;
-    if ((uint64_t)db_len > SIZE_MAX) {
-        CLIENT_ERR("unexpected database length exceeds %zu", SIZE_MAX);
+    if (count == 0) {
+        CLIENT_ERR("failed to find namespace in `bulkWrite` command");
         return false;
     }
-    *target_db = bson_strndup(target_ns, (size_t)db_len);
 
-    // Ensure only one `nsInfo` element is present.
-    // Query analysis (mongocryptd/crypt_shared) currently only supports one namespace.
-    if (bson_has_field(&as_bson, "nsInfo.1")) {
-        CLIENT_ERR("expected one namespace in `bulkWrite`, but found more than one. Only one namespace is supported.");
-        return false;
+    *bulkWrite_ns = bson_malloc0(sizeof(_mongocrypt_ctx_encrypt_ns_t) * count);
+    *bulkWrite_ns_count = count;
+
+    BSON_ASSERT(bson_iter_recurse(&nsInfo_iter, &iter));
+    for (size_t i = 0; bson_iter_next(&iter); i++) {
+        _mongocrypt_ctx_encrypt_ns_t *ns = &(*bulkWrite_ns)[i];
+        bson_iter_t ns_iter;
+
+        if (!BSON_ITER_HOLDS_DOCUMENT(&iter) || !bson_iter_recurse(&iter, &ns_iter)
+            || !bson_iter_find(&ns_iter, "ns")) {
+            CLIENT_ERR("failed to find namespace in `bulkWrite` command");
+            return false;
+        }
+
+        if (!BSON_ITER_HOLDS_UTF8(&ns_iter)) {
+            CLIENT_ERR("expected namespace to be UTF8, got: %s", mc_bson_type_to_string(bson_iter_type(&ns_iter)));
+            return false;
+        }
+
+        const char *target_ns = bson_iter_utf8(&ns_iter, NULL /* length */);
+        // Parse `target_ns` into "<db>.<coll>"
+        const char *dot = strstr(target_ns, ".");
+        if (!dot) {
+            CLIENT_ERR("expected namespace to contain dot, got: %s", target_ns);
+            return false;
+        }
+        // Get the database from the `ns` field (which may differ from `cmd_db`).
+        ptrdiff_t db_len = dot - target_ns;
+        if ((uint64_t)db_len > SIZE_MAX) {
+            CLIENT_ERR("unexpected database length exceeds %zu", SIZE_MAX);
+            return false;
+        }
+        ns->db = bson_strndup(target_ns, (size_t)db_len);
+        ns->coll = bson_strdup(dot + 1);
+        ns->ns = bson_strdup(target_ns);
     }
 
     return true;
@@ -2846,13 +4512,15 @@ static bool needs_ismaster_check(mongocrypt_ctx_t *ctx) {
     return using_mongocryptd && (0 == strcmp(ectx->cmd_name, "create") || 0 == strcmp(ectx->cmd_name, "createIndexes"));
 }
 
-bool mongocrypt_ctx_encrypt_init(mongocrypt_ctx_t *ctx, const char *db, int32_t db_len, mongocrypt_binary_t *cmd) {
+static bool
+_encrypt_init(mongocrypt_ctx_t *ctx, const char *db, int32_t db_len, mongocrypt_binary_t *cmd, bool explain) {
     _mongocrypt_ctx_encrypt_t *ectx;
     _mongocrypt_ctx_opts_spec_t opts_spec;
 
     if (!ctx) {
         return false;
     }
+    _mongocrypt_ctx_record_init(ctx, explain ? "ctx_explain_encrypt_init" : "ctx_encrypt_init", db, db_len, cmd);
 
     if (!db) {
         return _mongocrypt_ctx_fail_w_msg(ctx, "invalid db");
@@ -2866,15 +4534,20 @@ bool mongocrypt_ctx_encrypt_init(mongocrypt_ctx_t *ctx, const char *db, int32_t
 
     ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
     ctx->type = _MONGOCRYPT_TYPE_ENCRYPT;
+    _mongocrypt_counter_add(ctx->crypt, MC_COUNTER_CTX_ENCRYPT, 1);
     ectx->explicit = false;
+    ectx->explain = explain;
     ctx->vtable.mongo_op_collinfo = _mongo_op_collinfo;
     ctx->vtable.mongo_feed_collinfo = _mongo_feed_collinfo;
     ctx->vtable.mongo_done_collinfo = _mongo_done_collinfo;
     ctx->vtable.mongo_db_collinfo = _mongo_db_collinfo;
+    ctx->vtable.mongo_feed_op = _mongo_feed_op;
+    ctx->vtable.mongo_done_op = _mongo_done_op;
+    ctx->vtable.mongo_done_ops = _mongo_done_ops;
     ctx->vtable.mongo_op_collinfo = _mongo_op_collinfo;
     ctx->vtable.mongo_op_markings = _mongo_op_markings;
     ctx->vtable.mongo_feed_markings = _mongo_feed_markings;
-    ctx->vtable.mongo_done_markings = _mongo_done_markings;
+    ctx->vtable.mongo_done_markings = _mongo_done_mongocryptd_markings;
     ctx->vtable.finalize = _finalize;
     ctx->vtable.cleanup = _cleanup;
     ectx->bypass_query_analysis = ctx->crypt->opts.bypass_query_analysis;
@@ -2883,7 +4556,14 @@ bool mongocrypt_ctx_encrypt_init(mongocrypt_ctx_t *ctx, const char *db, int32_t
         return _mongocrypt_ctx_fail_w_msg(ctx, "invalid command");
     }
 
-    _mongocrypt_buffer_copy_from_binary(&ectx->original_cmd, cmd);
+    /* A command that needs no encryption is finalized as original_cmd, so a
+     * borrowed command is returned without being copied. */
+    if (ctx->opts.borrow_input) {
+        _mongocrypt_buffer_from_binary(&ectx->original_cmd, cmd);
+    } else {
+        _mongocrypt_buffer_copy_from_binary(&ectx->original_cmd, cmd);
+    }
+    _mongocrypt_counter_add(ctx->crypt, MC_COUNTER_BYTES_ENCRYPT, ectx->original_cmd.len);
 
     ectx->cmd_name = get_command_name(&ectx->original_cmd, ctx->status);
     if (!ectx->cmd_name) {
@@ -2897,12 +4577,14 @@ bool mongocrypt_ctx_encrypt_init(mongocrypt_ctx_t *ctx, const char *db, int32_t
     if (0 == strcmp(ectx->cmd_name, "bulkWrite")) {
         // Handle `bulkWrite` as a special case.
         // `bulkWrite` includes the target namespaces in an `nsInfo` field.
-        // Only one target namespace is supported.
-        if (!_check_cmd_for_auto_encrypt_bulkWrite(cmd, &ectx->target_db, &ectx->target_coll, ctx->status)) {
+        // The first namespace is the target namespace. Others are resolved alongside it.
+        if (!_check_cmd_for_auto_encrypt_bulkWrite(cmd, &ectx->bulkWrite_ns, &ectx->bulkWrite_ns_count, ctx->status)) {
             return _mongocrypt_ctx_fail(ctx);
         }
 
-        ectx->target_ns = bson_strdup_printf("%s.%s", ectx->target_db, ectx->target_coll);
+        ectx->target_db = bson_strdup(ectx->bulkWrite_ns[0].db);
+        ectx->target_coll = bson_strdup(ectx->bulkWrite_ns[0].coll);
+        ectx->target_ns = bson_strdup(ectx->bulkWrite_ns[0].ns);
     } else {
         bool bypass;
         if (!_check_cmd_for_auto_encrypt(cmd, &bypass, &ectx->target_coll, ctx->status)) {
@@ -2951,6 +4633,12 @@ bool mongocrypt_ctx_encrypt_init(mongocrypt_ctx_t *ctx, const char *db, int32_t
         bson_free(cmd_val);
     }
 
+    /* Whether crypt_shared or mongocryptd is used is known once a deferred
+     * load of crypt_shared has been tried. */
+    if (!ectx->bypass_query_analysis && !_mongocrypt_load_deferred_csfle(ctx->crypt, ctx->status)) {
+        return _mongocrypt_ctx_fail(ctx);
+    }
+
     /* The "create" and "createIndexes" command require sending an isMaster
      * request to mongocryptd. */
     if (needs_ismaster_check(ctx)) {
@@ -2964,6 +4652,17 @@ bool mongocrypt_ctx_encrypt_init(mongocrypt_ctx_t *ctx, const char *db, int32_t
     return mongocrypt_ctx_encrypt_ismaster_done(ctx);
 }
 
+bool mongocrypt_ctx_encrypt_init(mongocrypt_ctx_t *ctx, const char *db, int32_t db_len, mongocrypt_binary_t *cmd) {
+    return _encrypt_init(ctx, db, db_len, cmd, false);
+}
+
+bool mongocrypt_ctx_explain_encrypt_init(mongocrypt_ctx_t *ctx,
+                                         const char *db,
+                                         int32_t db_len,
+                                         mongocrypt_binary_t *cmd) {
+    return _encrypt_init(ctx, db, db_len, cmd, true);
+}
+
 #define WIRE_VERSION_SERVER_6 17
 
 /* mongocrypt_ctx_encrypt_ismaster_done is called when:
@@ -2976,6 +4675,8 @@ static bool mongocrypt_ctx_encrypt_ismaster_done(mongocrypt_ctx_t *ctx) {
     BSON_ASSERT_PARAM(ctx);
 
     ectx->ismaster.needed = false;
+    /* Look up all namespaces in the maps as they are now, even if they are updated. */
+    _mongocrypt_acquire_schema_maps(ctx->crypt, &ectx->schema_map, &ectx->encrypted_field_config_map);
 
     /* The "create" and "createIndexes" command require bypassing on mongocryptd
      * older than version 6.0. */
@@ -3036,6 +4737,19 @@ static bool mongocrypt_ctx_encrypt_ismaster_done(mongocrypt_ctx_t *ctx) {
         }
     }
 
+    /* Resolve the other namespaces of a `bulkWrite` from the encrypted field
+     * config map or the cache. Those not found are requested in the same
+     * collinfo state as the target namespace. A local JSON schema is not
+     * supported by `bulkWrite`, and is left to query analysis to reject. */
+    if (ectx->bulkWrite_ns_count > 1 && !ectx->used_local_schema) {
+        if (!_bulkWrite_try_ns_from_map_or_cache(ctx)) {
+            return false;
+        }
+        if (!_bulkWrite_need_collinfo(ctx)) {
+            return false;
+        }
+    }
+
     /* If an encrypted_field_config was set, check if keys are required for
      * delete tokens. */
     if (!_fle2_collect_keys_for_deleteTokens(ctx)) {
@@ -3051,8 +4765,7 @@ static bool mongocrypt_ctx_encrypt_ismaster_done(mongocrypt_ctx_t *ctx) {
             /* Keys may have been requested for deleteTokens or compactionTokens.
              * Finish key requests.
              */
-            _mongocrypt_key_broker_requests_done(&ctx->kb);
-            return _mongocrypt_ctx_state_from_key_broker(ctx);
+            return _state_after_markings(ctx);
         }
         // We're ready for markings. Try to generate them ourself.
         return _try_run_csfle_marking(ctx);
@@ -3061,3 +4774,86 @@ static bool mongocrypt_ctx_encrypt_ismaster_done(mongocrypt_ctx_t *ctx) {
         return true;
     }
 }
+
+/* _key_id_in returns true if @key_id is one of the UUIDs in @key_ids. */
+static bool _key_id_in(const bson_t *key_ids, const _mongocrypt_buffer_t *key_id) {
+    bson_iter_t iter;
+
+    BSON_ASSERT_PARAM(key_ids);
+    BSON_ASSERT_PARAM(key_id);
+
+    BSON_ASSERT(bson_iter_init(&iter, key_ids));
+    while (bson_iter_next(&iter)) {
+        _mongocrypt_buffer_t appended;
+
+        if (_mongocrypt_buffer_from_uuid_iter(&appended, &iter) && 0 == _mongocrypt_buffer_cmp(&appended, key_id)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* _key_id_cached returns true if the key with @key_id is in the key cache. */
+static bool _key_id_cached(mongocrypt_t *crypt, const _mongocrypt_buffer_t *key_id) {
+    _mongocrypt_cache_key_attr_t *attr;
+    _mongocrypt_cache_key_value_t *value = NULL;
+    bool cached;
+
+    BSON_ASSERT_PARAM(crypt);
+    BSON_ASSERT_PARAM(key_id);
+
+    attr = _mongocrypt_cache_key_attr_new((_mongocrypt_buffer_t *)key_id, NULL);
+    /* A failed lookup only means the key is prefetched. */
+    cached = _mongocrypt_cache_get(_mongocrypt_key_cache(crypt), attr, (void **)&value) && value;
+    _mongocrypt_cache_key_value_destroy(value);
+    _mongocrypt_cache_key_attr_destroy(attr);
+    return cached;
+}
+
+bool mongocrypt_ctx_encrypt_prefetch_key_ids(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
+    _mongocrypt_ctx_encrypt_t *ectx;
+    bson_t doc = BSON_INITIALIZER;
+    bson_t key_ids = BSON_INITIALIZER;
+    uint32_t i = 0;
+
+    if (!ctx) {
+        return false;
+    }
+    if (!ctx->initialized) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "ctx NULL or uninitialized");
+    }
+    if (!out) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "invalid NULL output");
+    }
+    ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+    if (ctx->type != _MONGOCRYPT_TYPE_ENCRYPT || ectx->explicit) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "not applicable to context");
+    }
+    if (ctx->state == MONGOCRYPT_CTX_ERROR) {
+        return false;
+    }
+    if (ctx->state != MONGOCRYPT_CTX_NEED_MONGO_MARKINGS) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "wrong state");
+    }
+
+    if (!_mongocrypt_buffer_empty(&ectx->encrypted_field_config)) {
+        for (const mc_EncryptedField_t *field = _get_efc(ectx)->fields; field != NULL; field = field->next) {
+            char storage[16];
+            const char *key;
+
+            /* Fields may share a key. */
+            if (_key_id_in(&key_ids, &field->keyId) || _key_id_cached(ctx->crypt, &field->keyId)) {
+                continue;
+            }
+            bson_uint32_to_string(i++, &key, storage, sizeof(storage));
+            BSON_ASSERT(_mongocrypt_buffer_append(&field->keyId, &key_ids, key, -1));
+        }
+    }
+    BSON_ASSERT(BSON_APPEND_ARRAY(&doc, "keyIds", &key_ids));
+    bson_destroy(&key_ids);
+
+    _mongocrypt_buffer_cleanup(&ectx->prefetch_key_ids);
+    _mongocrypt_buffer_steal_from_bson(&ectx->prefetch_key_ids, &doc);
+    _mongocrypt_buffer_to_binary(&ectx->prefetch_key_ids, out);
+    return true;
+}
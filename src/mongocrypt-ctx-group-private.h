@@ -0,0 +1,39 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOCRYPT_CTX_GROUP_PRIVATE_H
+#define MONGOCRYPT_CTX_GROUP_PRIVATE_H
+
+#include "mongocrypt-ctx-private.h"
+
+typedef struct {
+    mongocrypt_ctx_t *ctx;
+    /* kms_returned is true if a KMS request of the context was returned in the
+     * current round. */
+    bool kms_returned;
+} _mongocrypt_ctx_group_member_t;
+
+struct _mongocrypt_ctx_group_t {
+    mongocrypt_t *crypt;
+    mongocrypt_status_t *status;
+    _mongocrypt_ctx_group_member_t *members;
+    uint32_t count;
+    uint32_t kms_next;
+    /* filter is the merged filter returned by mongocrypt_ctx_group_mongo_op. */
+    _mongocrypt_buffer_t filter;
+};
+
+#endif /* MONGOCRYPT_CTX_GROUP_PRIVATE_H */
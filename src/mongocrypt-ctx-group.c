@@ -0,0 +1,344 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mongocrypt-binary-private.h"
+#include "mongocrypt-ctx-group-private.h"
+
+static bool _group_fail_w_msg(mongocrypt_ctx_group_t *group, const char *msg) {
+    mongocrypt_status_t *status;
+
+    BSON_ASSERT_PARAM(group);
+    BSON_ASSERT_PARAM(msg);
+
+    status = group->status;
+    CLIENT_ERR("%s", msg);
+    return false;
+}
+
+/* _needs_keys returns true if @ctx is in MONGOCRYPT_CTX_NEED_MONGO_KEYS for
+ * the documents of a filter. Contexts accepting any key document are left to
+ * the caller. */
+static bool _needs_keys(mongocrypt_ctx_t *ctx) {
+    BSON_ASSERT_PARAM(ctx);
+
+    return ctx->state == MONGOCRYPT_CTX_NEED_MONGO_KEYS && ctx->kb.state == KB_ADDING_DOCS;
+}
+
+mongocrypt_ctx_group_t *mongocrypt_ctx_group_new(mongocrypt_t *crypt) {
+    mongocrypt_ctx_group_t *group;
+
+    BSON_ASSERT_PARAM(crypt);
+
+    group = bson_malloc0(sizeof(*group));
+    BSON_ASSERT(group);
+    group->crypt = crypt;
+    group->status = mongocrypt_status_new();
+    return group;
+}
+
+bool mongocrypt_ctx_group_add(mongocrypt_ctx_group_t *group, mongocrypt_ctx_t *ctx) {
+    if (!group) {
+        return false;
+    }
+    if (!mongocrypt_status_ok(group->status)) {
+        return false;
+    }
+    if (!ctx || !ctx->initialized) {
+        return _group_fail_w_msg(group, "ctx NULL or uninitialized");
+    }
+    if (ctx->crypt != group->crypt) {
+        return _group_fail_w_msg(group, "context belongs to another mongocrypt_t");
+    }
+    for (uint32_t i = 0; i < group->count; i++) {
+        if (group->members[i].ctx == ctx) {
+            return _group_fail_w_msg(group, "context is already in the group");
+        }
+    }
+
+    /* A key needed by several contexts is decrypted by one of them. */
+    ctx->kb.coalesce_kms_decrypts = true;
+    /* Key documents fed to the group are not recorded on the context, so it
+     * could not be replayed. */
+    if (ctx->record) {
+        ctx->record->started = false;
+    }
+
+    group->members = bson_realloc(group->members, sizeof(_mongocrypt_ctx_group_member_t) * (group->count + 1u));
+    group->members[group->count].ctx = ctx;
+    group->members[group->count].kms_returned = false;
+    group->count++;
+    return true;
+}
+
+mongocrypt_ctx_state_t mongocrypt_ctx_group_state(mongocrypt_ctx_group_t *group) {
+    bool needs_kms = false;
+
+    if (!group || !mongocrypt_status_ok(group->status)) {
+        return MONGOCRYPT_CTX_ERROR;
+    }
+
+    for (uint32_t i = 0; i < group->count; i++) {
+        mongocrypt_ctx_t *ctx = group->members[i].ctx;
+
+        if (_needs_keys(ctx)) {
+            return MONGOCRYPT_CTX_NEED_MONGO_KEYS;
+        }
+        needs_kms = needs_kms || ctx->state == MONGOCRYPT_CTX_NEED_KMS;
+    }
+    return needs_kms ? MONGOCRYPT_CTX_NEED_KMS : MONGOCRYPT_CTX_DONE;
+}
+
+/* _value_in returns true if the array @values has a value equal to @value.
+ * Only key IDs and keyAltNames are compared. */
+static bool _value_in(const bson_t *values, const bson_value_t *value) {
+    bson_iter_t iter;
+
+    BSON_ASSERT_PARAM(values);
+    BSON_ASSERT_PARAM(value);
+
+    BSON_ASSERT(bson_iter_init(&iter, values));
+    while (bson_iter_next(&iter)) {
+        const bson_value_t *other = bson_iter_value(&iter);
+
+        if (other->value_type != value->value_type) {
+            continue;
+        }
+        if (value->value_type == BSON_TYPE_BINARY && other->value.v_binary.subtype == value->value.v_binary.subtype
+            && other->value.v_binary.data_len == value->value.v_binary.data_len
+            && 0 == memcmp(other->value.v_binary.data, value->value.v_binary.data, value->value.v_binary.data_len)) {
+            return true;
+        }
+        if (value->value_type == BSON_TYPE_UTF8 && other->value.v_utf8.len == value->value.v_utf8.len
+            && 0 == memcmp(other->value.v_utf8.str, value->value.v_utf8.str, value->value.v_utf8.len)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* _merge_values appends the values of the array at @path of @filter to the
+ * array @merged, skipping duplicates. */
+static void _merge_values(const bson_t *filter, const char *path, bson_t *merged) {
+    bson_iter_t iter;
+    bson_iter_t child;
+
+    BSON_ASSERT_PARAM(filter);
+    BSON_ASSERT_PARAM(path);
+    BSON_ASSERT_PARAM(merged);
+
+    if (!bson_iter_init(&iter, filter) || !bson_iter_find_descendant(&iter, path, &child)
+        || !BSON_ITER_HOLDS_ARRAY(&child) || !bson_iter_recurse(&child, &iter)) {
+        return;
+    }
+    while (bson_iter_next(&iter)) {
+        const bson_value_t *value = bson_iter_value(&iter);
+        char storage[16];
+        const char *key;
+
+        if (_value_in(merged, value)) {
+            continue;
+        }
+        bson_uint32_to_string(bson_count_keys(merged), &key, storage, sizeof(storage));
+        BSON_ASSERT(bson_append_value(merged, key, -1, value));
+    }
+}
+
+bool mongocrypt_ctx_group_mongo_op(mongocrypt_ctx_group_t *group, mongocrypt_binary_t *out) {
+    bson_t ids = BSON_INITIALIZER;
+    bson_t names = BSON_INITIALIZER;
+    bson_t *filter;
+
+    if (!group) {
+        return false;
+    }
+    if (!mongocrypt_status_ok(group->status)) {
+        return false;
+    }
+    if (!out) {
+        return _group_fail_w_msg(group, "invalid NULL output");
+    }
+
+    for (uint32_t i = 0; i < group->count; i++) {
+        mongocrypt_ctx_t *ctx = group->members[i].ctx;
+        mongocrypt_binary_t ctx_filter;
+        bson_t ctx_filter_bson;
+
+        /* A context that fails is left in the error state. */
+        if (!_needs_keys(ctx) || !mongocrypt_ctx_mongo_op(ctx, &ctx_filter)) {
+            continue;
+        }
+        BSON_ASSERT(_mongocrypt_binary_to_bson(&ctx_filter, &ctx_filter_bson));
+        _merge_values(&ctx_filter_bson, "$or.0._id.$in", &ids);
+        _merge_values(&ctx_filter_bson, "$or.1.keyAltNames.$in", &names);
+    }
+
+    /* The same form as the filter of a single context. */
+    filter = BCON_NEW("$or",
+                      "[",
+                      "{",
+                      "_id",
+                      "{",
+                      "$in",
+                      BCON_ARRAY(&ids),
+                      "}",
+                      "}",
+                      "{",
+                      "keyAltNames",
+                      "{",
+                      "$in",
+                      BCON_ARRAY(&names),
+                      "}",
+                      "}",
+                      "]");
+    bson_destroy(&ids);
+    bson_destroy(&names);
+
+    _mongocrypt_buffer_cleanup(&group->filter);
+    _mongocrypt_buffer_steal_from_bson(&group->filter, filter);
+    _mongocrypt_buffer_to_binary(&group->filter, out);
+    return true;
+}
+
+bool mongocrypt_ctx_group_mongo_feed(mongocrypt_ctx_group_t *group, mongocrypt_binary_t *in) {
+    _mongocrypt_buffer_t buf;
+
+    if (!group) {
+        return false;
+    }
+    if (!mongocrypt_status_ok(group->status)) {
+        return false;
+    }
+    if (!in) {
+        return _group_fail_w_msg(group, "invalid NULL input");
+    }
+
+    _mongocrypt_buffer_from_binary(&buf, in);
+    for (uint32_t i = 0; i < group->count; i++) {
+        mongocrypt_ctx_t *ctx = group->members[i].ctx;
+
+        if (!_needs_keys(ctx)) {
+            continue;
+        }
+        /* The document is only added to the contexts that requested it. */
+        if (!_mongocrypt_key_broker_add_prefetched_doc(&ctx->kb, _mongocrypt_ctx_kms_providers(ctx), &buf)) {
+            BSON_ASSERT(!_mongocrypt_key_broker_status(&ctx->kb, ctx->status));
+            _mongocrypt_ctx_fail(ctx);
+        }
+    }
+    return true;
+}
+
+bool mongocrypt_ctx_group_mongo_done(mongocrypt_ctx_group_t *group) {
+    if (!group) {
+        return false;
+    }
+    if (!mongocrypt_status_ok(group->status)) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < group->count; i++) {
+        mongocrypt_ctx_t *ctx = group->members[i].ctx;
+
+        if (_needs_keys(ctx)) {
+            /* A context that fails is left in the error state. */
+            (void)mongocrypt_ctx_mongo_done(ctx);
+        }
+    }
+    group->kms_next = 0;
+    return true;
+}
+
+/* Returns the KMS requests of every context in turn, so all of a round's
+ * requests can be sent concurrently. */
+mongocrypt_kms_ctx_t *mongocrypt_ctx_group_next_kms_ctx(mongocrypt_ctx_group_t *group) {
+    if (!group) {
+        return NULL;
+    }
+    if (!mongocrypt_status_ok(group->status)) {
+        return NULL;
+    }
+
+    while (group->kms_next < group->count) {
+        _mongocrypt_ctx_group_member_t *member = &group->members[group->kms_next];
+
+        if (member->ctx->state == MONGOCRYPT_CTX_NEED_KMS) {
+            mongocrypt_kms_ctx_t *const kms = mongocrypt_ctx_next_kms_ctx(member->ctx);
+
+            if (kms) {
+                member->kms_returned = true;
+                return kms;
+            }
+        }
+        group->kms_next++;
+    }
+    return NULL;
+}
+
+bool mongocrypt_ctx_group_kms_done(mongocrypt_ctx_group_t *group) {
+    if (!group) {
+        return false;
+    }
+    if (!mongocrypt_status_ok(group->status)) {
+        return false;
+    }
+
+    /* Finish the contexts that sent KMS requests first. Contexts waiting on
+     * their keys then take them from the cache in the same round. */
+    for (int pass = 0; pass < 2; pass++) {
+        for (uint32_t i = 0; i < group->count; i++) {
+            _mongocrypt_ctx_group_member_t *member = &group->members[i];
+
+            if (member->kms_returned != (pass == 0) || member->ctx->state != MONGOCRYPT_CTX_NEED_KMS) {
+                continue;
+            }
+            /* A context that fails is left in the error state. */
+            (void)mongocrypt_ctx_kms_done(member->ctx);
+        }
+    }
+
+    for (uint32_t i = 0; i < group->count; i++) {
+        group->members[i].kms_returned = false;
+    }
+    group->kms_next = 0;
+    return true;
+}
+
+bool mongocrypt_ctx_group_status(mongocrypt_ctx_group_t *group, mongocrypt_status_t *out) {
+    if (!group) {
+        return false;
+    }
+    if (!out) {
+        return _group_fail_w_msg(group, "invalid NULL output");
+    }
+
+    if (!mongocrypt_status_ok(group->status)) {
+        _mongocrypt_status_copy_to(group->status, out);
+        return false;
+    }
+    _mongocrypt_status_reset(out);
+    return true;
+}
+
+void mongocrypt_ctx_group_destroy(mongocrypt_ctx_group_t *group) {
+    if (!group) {
+        return;
+    }
+
+    bson_free(group->members);
+    _mongocrypt_buffer_cleanup(&group->filter);
+    mongocrypt_status_destroy(group->status);
+    bson_free(group);
+}
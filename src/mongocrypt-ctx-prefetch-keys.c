@@ -0,0 +1,212 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mongocrypt-ctx-private.h"
+
+static bool _finalize(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
+    _mongocrypt_ctx_prefetch_keys_t *const pkctx = (_mongocrypt_ctx_prefetch_keys_t *)ctx;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(out);
+
+    /* Keys were added to the key cache by the key broker. There is nothing
+     * else to return. */
+    if (_mongocrypt_buffer_empty(&pkctx->result)) {
+        bson_t empty = BSON_INITIALIZER;
+
+        _mongocrypt_buffer_steal_from_bson(&pkctx->result, &empty);
+    }
+    _mongocrypt_buffer_to_binary(&pkctx->result, out);
+    ctx->state = MONGOCRYPT_CTX_DONE;
+    return true;
+}
+
+static void _cleanup(mongocrypt_ctx_t *ctx) {
+    _mongocrypt_ctx_prefetch_keys_t *const pkctx = (_mongocrypt_ctx_prefetch_keys_t *)ctx;
+
+    BSON_ASSERT_PARAM(ctx);
+
+    _mongocrypt_buffer_cleanup(&pkctx->result);
+    for (size_t i = 0; i < pkctx->pending_key_docs.len; i++) {
+        _mongocrypt_buffer_cleanup(&_mc_array_index(&pkctx->pending_key_docs, _mongocrypt_buffer_t, i));
+    }
+    _mc_array_destroy(&pkctx->pending_key_docs);
+}
+
+bool mongocrypt_ctx_prefetch_keys_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *key_ids) {
+    _mongocrypt_ctx_opts_spec_t opts_spec;
+    bson_t as_bson;
+    bson_iter_t iter;
+    bson_iter_t array_iter;
+    bool any = false;
+
+    if (!ctx) {
+        return false;
+    }
+
+    memset(&opts_spec, 0, sizeof(opts_spec));
+    if (!_mongocrypt_ctx_init(ctx, &opts_spec)) {
+        return false;
+    }
+
+    ctx->type = _MONGOCRYPT_TYPE_PREFETCH_KEYS;
+    _mongocrypt_counter_add(ctx->crypt, MC_COUNTER_CTX_PREFETCH_KEYS, 1);
+    ctx->vtable.finalize = _finalize;
+    ctx->vtable.cleanup = _cleanup;
+    _mc_array_init(&((_mongocrypt_ctx_prefetch_keys_t *)ctx)->pending_key_docs, sizeof(_mongocrypt_buffer_t));
+
+    if (!key_ids || !key_ids->data) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "invalid key_ids");
+    }
+
+    if (!_mongocrypt_binary_to_bson(key_ids, &as_bson)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "malformed bson");
+    }
+
+    if (!bson_iter_init_find(&iter, &as_bson, "keyIds") || !BSON_ITER_HOLDS_ARRAY(&iter)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "expected array 'keyIds'");
+    }
+
+    if (!bson_iter_recurse(&iter, &array_iter)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "malformed bson");
+    }
+
+    while (bson_iter_next(&array_iter)) {
+        _mongocrypt_buffer_t key_id;
+
+        if (!_mongocrypt_buffer_from_uuid_iter(&key_id, &array_iter)) {
+            return _mongocrypt_ctx_fail_w_msg(ctx, "expected UUID in 'keyIds'");
+        }
+
+        /* Keys already in the cache are satisfied without a fetch. */
+        if (!_mongocrypt_key_broker_request_id(&ctx->kb, &key_id)) {
+            _mongocrypt_key_broker_status(&ctx->kb, ctx->status);
+            return _mongocrypt_ctx_fail(ctx);
+        }
+        any = true;
+    }
+
+    if (!any) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "'keyIds' must not be empty");
+    }
+
+    (void)_mongocrypt_key_broker_requests_done(&ctx->kb);
+    return _mongocrypt_ctx_state_from_key_broker(ctx);
+}
+
+/* _add_pending_keys adds the taken key documents to the key broker, newest
+ * first, skipping older documents of the same key. */
+static bool _add_pending_keys(mongocrypt_ctx_t *ctx) {
+    _mongocrypt_ctx_prefetch_keys_t *const pkctx = (_mongocrypt_ctx_prefetch_keys_t *)ctx;
+    mc_array_t *const docs = &pkctx->pending_key_docs;
+    mc_array_t ids;
+    bool ok = false;
+
+    BSON_ASSERT_PARAM(ctx);
+
+    if (!_mongocrypt_key_broker_request_any(&ctx->kb)) {
+        _mongocrypt_key_broker_status(&ctx->kb, ctx->status);
+        return _mongocrypt_ctx_fail(ctx);
+    }
+
+    _mc_array_init(&ids, sizeof(_mongocrypt_buffer_t));
+    for (size_t i = docs->len; i > 0; i--) {
+        _mongocrypt_buffer_t *const doc = &_mc_array_index(docs, _mongocrypt_buffer_t, i - 1u);
+        _mongocrypt_buffer_t id;
+        bson_t doc_bson;
+        bson_iter_t iter;
+        bool seen = false;
+
+        /* Documents were validated by mongocrypt_add_key_documents. */
+        if (!_mongocrypt_buffer_to_bson(doc, &doc_bson) || !bson_iter_init_find(&iter, &doc_bson, "_id")
+            || !_mongocrypt_buffer_from_uuid_iter(&id, &iter)) {
+            _mongocrypt_ctx_fail_w_msg(ctx, "invalid key document");
+            goto done;
+        }
+        for (size_t j = 0; j < ids.len && !seen; j++) {
+            seen = 0 == _mongocrypt_buffer_cmp(&_mc_array_index(&ids, _mongocrypt_buffer_t, j), &id);
+        }
+        if (seen) {
+            continue;
+        }
+        _mc_array_append_val(&ids, id);
+
+        /* Keys already in the cache are skipped by the key broker. */
+        if (!_mongocrypt_key_broker_add_doc(&ctx->kb, _mongocrypt_ctx_kms_providers(ctx), doc)) {
+            _mongocrypt_key_broker_status(&ctx->kb, ctx->status);
+            _mongocrypt_ctx_fail(ctx);
+            goto done;
+        }
+    }
+
+    if (!_mongocrypt_key_broker_docs_done(&ctx->kb)) {
+        _mongocrypt_key_broker_status(&ctx->kb, ctx->status);
+        _mongocrypt_ctx_fail(ctx);
+        goto done;
+    }
+    ok = _mongocrypt_ctx_state_from_key_broker(ctx);
+
+done:
+    _mc_array_destroy(&ids);
+    return ok;
+}
+
+bool mongocrypt_ctx_unwrap_pending_keys_init(mongocrypt_ctx_t *ctx) {
+    _mongocrypt_ctx_prefetch_keys_t *pkctx;
+    _mongocrypt_ctx_opts_spec_t opts_spec;
+    mc_array_t *pending;
+
+    if (!ctx) {
+        return false;
+    }
+
+    memset(&opts_spec, 0, sizeof(opts_spec));
+    if (!_mongocrypt_ctx_init(ctx, &opts_spec)) {
+        return false;
+    }
+
+    pkctx = (_mongocrypt_ctx_prefetch_keys_t *)ctx;
+    ctx->type = _MONGOCRYPT_TYPE_PREFETCH_KEYS;
+    _mongocrypt_counter_add(ctx->crypt, MC_COUNTER_CTX_PREFETCH_KEYS, 1);
+    ctx->vtable.finalize = _finalize;
+    ctx->vtable.cleanup = _cleanup;
+    _mc_array_init(&pkctx->pending_key_docs, sizeof(_mongocrypt_buffer_t));
+
+    /* Take the whole queue. Documents added later go to the next context. */
+    pending = &ctx->crypt->pending_key_docs;
+    MONGOCRYPT_WITH_MUTEX(ctx->crypt->mutex) {
+        mc_array_t swap = pkctx->pending_key_docs;
+
+        pkctx->pending_key_docs = *pending;
+        *pending = swap;
+    }
+
+    if (pkctx->pending_key_docs.len == 0) {
+        ctx->nothing_to_do = true;
+        ctx->state = MONGOCRYPT_CTX_READY;
+        return true;
+    }
+
+    /* Unlike mongocrypt_ctx_prefetch_keys_init, no key documents are fetched,
+     * so on-demand credentials are needed before adding them. */
+    if (_mongocrypt_needs_credentials(ctx->crypt)) {
+        ctx->state = MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS;
+        ctx->vtable.after_kms_credentials_provided = _add_pending_keys;
+        return true;
+    }
+
+    return _add_pending_keys(ctx);
+}
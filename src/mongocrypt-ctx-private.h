@@ -21,6 +21,7 @@
 #include "mc-optional-private.h"
 #include "mc-rangeopts-private.h"
 #include "mongocrypt-buffer-private.h"
+#include "mongocrypt-cache-collinfo-private.h"
 #include "mongocrypt-endpoint-private.h"
 #include "mongocrypt-key-broker-private.h"
 #include "mongocrypt-key-private.h"
@@ -34,6 +35,8 @@ typedef enum {
     _MONGOCRYPT_TYPE_CREATE_DATA_KEY,
     _MONGOCRYPT_TYPE_REWRAP_MANY_DATAKEY,
     _MONGOCRYPT_TYPE_COMPACT,
+    _MONGOCRYPT_TYPE_PREFETCH_KEYS,
+    _MONGOCRYPT_TYPE_CREATE_DATA_KEY_BATCH,
 } _mongocrypt_ctx_type_t;
 
 typedef enum {
@@ -85,8 +88,35 @@ typedef struct __mongocrypt_ctx_opts_t {
         mc_RangeOpts_t value;
         bool set;
     } rangeopts;
+
+    /* borrow_input is set by mongocrypt_ctx_setopt_borrow_input. The document
+     * to decrypt and the markings reply are viewed rather than copied. */
+    bool borrow_input;
+
+    /* rewrap_skip_unchanged is set by mongocrypt_ctx_setopt_rewrap_skip_unchanged.
+     * Keys already wrapped with the new key encryption key are not rewrapped. */
+    bool rewrap_skip_unchanged;
+
+    /* decrypt_paths is set by mongocrypt_ctx_setopt_decrypt_paths. It holds
+     * the BSON array of dotted paths to decrypt. If unset, all are decrypted. */
+    _mongocrypt_buffer_t decrypt_paths;
+
+    /* decrypt_plan is set by mongocrypt_ctx_setopt_decrypt_plan. It is
+     * borrowed. */
+    mongocrypt_decrypt_plan_t *decrypt_plan;
 } _mongocrypt_ctx_opts_t;
 
+/* A MongoDB operation of the MONGOCRYPT_CTX_NEED_MONGO_OPS state. */
+struct _mongocrypt_mongo_op_t {
+    mongocrypt_ctx_t *ctx;
+    /* type is MONGOCRYPT_CTX_NEED_MONGO_COLLINFO_WITH_DB or
+     * MONGOCRYPT_CTX_NEED_MONGO_KEYS. */
+    mongocrypt_ctx_state_t type;
+    char *db;
+    _mongocrypt_buffer_t op;
+    bool done;
+};
+
 /* All derived contexts may override these methods. */
 typedef struct {
     const char *(*mongo_db_collinfo)(mongocrypt_ctx_t *ctx);
@@ -99,6 +129,11 @@ typedef struct {
     bool (*mongo_op_keys)(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out);
     bool (*mongo_feed_keys)(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *in);
     bool (*mongo_done_keys)(mongocrypt_ctx_t *ctx);
+    /* Collinfo operations of MONGOCRYPT_CTX_NEED_MONGO_OPS. Key operations are
+     * handled by the parent context. */
+    bool (*mongo_feed_op)(mongocrypt_ctx_t *ctx, mongocrypt_mongo_op_t *op, mongocrypt_binary_t *in);
+    bool (*mongo_done_op)(mongocrypt_ctx_t *ctx, mongocrypt_mongo_op_t *op);
+    bool (*mongo_done_ops)(mongocrypt_ctx_t *ctx);
     bool (*after_kms_credentials_provided)(mongocrypt_ctx_t *ctx);
     mongocrypt_kms_ctx_t *(*next_kms_ctx)(mongocrypt_ctx_t *ctx);
     bool (*kms_done)(mongocrypt_ctx_t *ctx);
@@ -106,6 +141,21 @@ typedef struct {
     void (*cleanup)(mongocrypt_ctx_t *ctx);
 } _mongocrypt_vtable_t;
 
+/* _mongocrypt_ctx_record_t holds the calls recorded on a context. */
+typedef struct {
+    /* mutex protects events and events_len, since KMS contexts returned by
+     * the context may be fed from separate threads. */
+    mongocrypt_mutex_t mutex;
+    bson_t events; /* An array of the recorded calls. */
+    uint32_t events_len;
+    /* started is true once an init function that can be replayed is
+     * recorded. Other contexts are not reported. */
+    bool started;
+    int64_t start_us;
+    /* kms_len is the number of KMS contexts given a record id. */
+    uint32_t kms_len;
+} _mongocrypt_ctx_record_t;
+
 struct _mongocrypt_ctx_t {
     mongocrypt_t *crypt;
     mongocrypt_ctx_state_t state;
@@ -116,7 +166,17 @@ struct _mongocrypt_ctx_t {
     _mongocrypt_ctx_opts_t opts;
     _mongocrypt_opts_kms_providers_t per_ctx_kms_providers; /* owned */
     _mongocrypt_opts_kms_providers_t kms_providers;         /* not owned, is merged from per-ctx / per-mongocrypt_t */
+    /* kms_credentials_provided is set once per_ctx_kms_providers is set, by
+     * the driver or from the cached credentials of the mongocrypt_t. */
+    bool kms_credentials_provided;
     bool initialized;
+    /* deadline_us is the monotonic time set by mongocrypt_ctx_setopt_deadline,
+     * or 0. */
+    int64_t deadline_us;
+    /* raw_value is set by mongocrypt_ctx_explicit_encrypt_value_init and
+     * mongocrypt_ctx_explicit_decrypt_value_init. The result is then also
+     * returned unwrapped by mongocrypt_ctx_finalize_value. */
+    bool raw_value;
     /* nothing_to_do is set to true under these conditions:
      * 1. No keys are requested
      * 2. The command is bypassed for automatic encryption (e.g. ping).
@@ -124,6 +184,33 @@ struct _mongocrypt_ctx_t {
      * TODO (MONGOCRYPT-422) replace nothing_to_do.
      */
     bool nothing_to_do;
+    /* finalized views the result of the last successful finalize. It is
+     * copied by mongocrypt_ctx_finalize_into. */
+    mongocrypt_binary_t finalized;
+    /* mongo_ops are the operations of the MONGOCRYPT_CTX_NEED_MONGO_OPS state.
+     * mongo_ops_next is the next returned by mongocrypt_ctx_next_mongo_op. */
+    mongocrypt_mongo_op_t **mongo_ops;
+    uint32_t mongo_ops_len;
+    uint32_t mongo_ops_next;
+    /* prefetched_keys are the key documents fed to key operations. They are
+     * added to the key broker once it requests them. */
+    _mongocrypt_buffer_t *prefetched_keys;
+    uint32_t prefetched_keys_len;
+    /* timings accumulates the time spent in each state, in microseconds.
+     * A state is timed from the call that first observes it until the call
+     * that observes the next state. */
+    struct {
+        int64_t state_entered_us;
+        /* timed_state is -1 until the first state after init is observed. */
+        int timed_state;
+        int64_t init_us;
+        int64_t state_us[MONGOCRYPT_CTX_NEED_MONGO_OPS + 1];
+        int64_t finalize_us;
+        _mongocrypt_buffer_t bson; /* Returned by mongocrypt_ctx_get_timings. */
+    } timings;
+    /* record holds the calls made on the context for the record handler. It
+     * is NULL until the first call is recorded. */
+    _mongocrypt_ctx_record_t *record;
 };
 
 /* Transition to the error state. An error status must have been set. */
@@ -132,9 +219,67 @@ bool _mongocrypt_ctx_fail(mongocrypt_ctx_t *ctx);
 /* Set an error status and transition to the error state. */
 bool _mongocrypt_ctx_fail_w_msg(mongocrypt_ctx_t *ctx, const char *msg);
 
+/* Add an operation for the MONGOCRYPT_CTX_NEED_MONGO_OPS state. @db may be
+ * NULL for a key operation. @op is copied. */
+mongocrypt_mongo_op_t *
+_mongocrypt_ctx_add_mongo_op(mongocrypt_ctx_t *ctx, mongocrypt_ctx_state_t type, const char *db, const bson_t *op);
+
+/* Destroy the operations of the MONGOCRYPT_CTX_NEED_MONGO_OPS state. */
+void _mongocrypt_ctx_clear_mongo_ops(mongocrypt_ctx_t *ctx);
+
+/* Returns true if a trace handler is set. Check before building attributes. */
+bool _mongocrypt_ctx_trace_enabled(const mongocrypt_ctx_t *ctx);
+
+/* Call the trace handler, if set, with @attributes. @attributes may be NULL
+ * for an empty document. */
+void _mongocrypt_ctx_trace(mongocrypt_ctx_t *ctx,
+                           mongocrypt_trace_event_t event,
+                           const char *span,
+                           const bson_t *attributes);
+
+/* Returns true if a record handler is set. Check before building arguments. */
+bool _mongocrypt_ctx_record_enabled(const mongocrypt_ctx_t *ctx);
+
+/* Record a call named @call on @ctx for the record handler, if set. The fields
+ * of @args, which may be NULL, are the arguments of the call. */
+void _mongocrypt_ctx_record(mongocrypt_ctx_t *ctx, const char *call, const bson_t *args);
+
+/* Like _mongocrypt_ctx_record, with @data as the "data" argument. @data may be
+ * NULL. */
+void _mongocrypt_ctx_record_binary(mongocrypt_ctx_t *ctx, const char *call, const mongocrypt_binary_t *data);
+
+/* Record a call of an init function that can be replayed. @db may be NULL. */
+void _mongocrypt_ctx_record_init(mongocrypt_ctx_t *ctx,
+                                 const char *call,
+                                 const char *db,
+                                 int32_t db_len,
+                                 const mongocrypt_binary_t *data);
+
+/* _mongocrypt_ctx_encrypt_ns_t is a namespace of a `bulkWrite` command, from
+ * one element of `nsInfo`. */
+typedef struct {
+    char *db;
+    char *coll;
+    // `ns` is "<db>.<coll>".
+    char *ns;
+    // `resolved` is true once `encrypted_field_config` is known. Only used for `nsInfo` elements after the first. The
+    // first element is the target namespace and is resolved through the fields of `_mongocrypt_ctx_encrypt_t`.
+    bool resolved;
+    // `encrypted_field_config` is the encryptedFields of the namespace. It views `collinfo` or the encrypted field
+    // config map, or owns an empty encryptedFields if `used_empty_encryptedFields` is true.
+    _mongocrypt_buffer_t encrypted_field_config;
+    _mongocrypt_cache_collinfo_value_t *collinfo;
+    bool used_empty_encryptedFields;
+    // `encryption_information_schema` is the "schema" of the `encryptionInformation` of this namespace.
+    _mongocrypt_buffer_t encryption_information_schema;
+} _mongocrypt_ctx_encrypt_ns_t;
+
 typedef struct {
     mongocrypt_ctx_t parent;
     bool explicit;
+    /* explicit_batch is true if original_cmd is {v: [<BSON values>]} and each
+     * value is encrypted. */
+    bool explicit_batch;
 
     // `cmd_db` is the command database (appended as `$db`).
     char *cmd_db;
@@ -151,6 +296,15 @@ typedef struct {
     // `target_coll` is the target namespace collection name.
     char *target_coll;
 
+    // `bulkWrite_ns` has one entry per element of `nsInfo` of a `bulkWrite` command. The first entry is the target
+    // namespace. Other entries are resolved to encryptedFields in the same collinfo phase as the target namespace.
+    _mongocrypt_ctx_encrypt_ns_t *bulkWrite_ns;
+    size_t bulkWrite_ns_count;
+
+    // `collinfo_db` is the database of the current MONGOCRYPT_CTX_NEED_MONGO_COLLINFO_WITH_DB state of a `bulkWrite`
+    // with more than one namespace. It views the `db` of an entry of `bulkWrite_ns`.
+    const char *collinfo_db;
+
     _mongocrypt_buffer_t list_collections_filter;
     _mongocrypt_buffer_t schema;
     /* TODO CDRIVER-3150: audit + rename these buffers.
@@ -167,10 +321,38 @@ typedef struct {
      */
     _mongocrypt_buffer_t original_cmd;
     _mongocrypt_buffer_t mongocryptd_cmd;
+    /* marking_cache_key is the key of mongocryptd_cmd in the marking cache. It
+     * is only set if the marking cache is enabled. */
+    _mongocrypt_buffer_t marking_cache_key;
+    /* encryption_information_schema is the "schema" document of the
+     * "encryptionInformation" appended to commands. It is built once and
+     * shared by the commands to query analysis and to mongod. */
+    _mongocrypt_buffer_t encryption_information_schema;
+    /* prefetch_key_ids is the {"keyIds": [...]} document returned by
+     * mongocrypt_ctx_encrypt_prefetch_key_ids. */
+    _mongocrypt_buffer_t prefetch_key_ids;
     _mongocrypt_buffer_t marked_cmd;
+    /* csfle_marked_bson is the output of crypt_shared query analysis, which
+     * marked_cmd views. It is freed with the bson_free of crypt_shared. */
+    uint8_t *csfle_marked_bson;
+    /* ciphertext_len_estimate is the sum of the estimated lengths of the
+     * ciphertexts replacing the markings in marked_cmd. */
+    uint64_t ciphertext_len_estimate;
+    /* find_equality_markings counts the FLE2 equality find markings in
+     * marked_cmd, such as one per value of an $in. */
+    uint32_t find_equality_markings;
     _mongocrypt_buffer_t encrypted_cmd;
     _mongocrypt_buffer_t key_id;
     bool used_local_schema;
+    /* schema_map and encrypted_field_config_map are references to the maps of
+     * crypt when the context started looking up schemas. Updating the maps of
+     * crypt does not change them. */
+    mc_mapof_ns_to_schema_t *schema_map;
+    mc_mapof_ns_to_schema_t *encrypted_field_config_map;
+    /* explain is true for a context initialized with
+     * mongocrypt_ctx_explain_encrypt_init. It is ready once the command is
+     * marked, and finalizes to a report of the markings. */
+    bool explain;
     /* collinfo_has_siblings is true if the schema came from a remote JSON
      * schema, and there were siblings. */
     bool collinfo_has_siblings;
@@ -184,6 +366,12 @@ typedef struct {
      */
     _mongocrypt_buffer_t encrypted_field_config;
     mc_EncryptedFieldConfig_t efc;
+    /* shared_efc is set to the parsed encrypted_field_config, rather than efc,
+     * if it was parsed by a cached collinfo or the encrypted field config map. */
+    const mc_EncryptedFieldConfig_t *shared_efc;
+    /* collinfo is the parsed collection info the schema came from, or NULL.
+     * schema and encrypted_field_config view it. */
+    _mongocrypt_cache_collinfo_value_t *collinfo;
     // `used_empty_encryptedFields` is true if the collection has no JSON schema or encryptedFields,
     // yet an empty encryptedFields was constructed to support query analysis.
     // When true, an empty encryptedFields is sent to query analysis, but not appended to the final command.
@@ -210,6 +398,25 @@ typedef struct {
      * */
     _mongocrypt_buffer_t original_doc;
     _mongocrypt_buffer_t decrypted_doc;
+    /* ciphertext_offsets holds the uint32_t offsets of the ciphertexts in
+     * original_doc, and container_offsets the offsets of the documents and
+     * arrays enclosing them. Later passes only visit these offsets. */
+    mc_array_t ciphertext_offsets;
+    mc_array_t container_offsets;
+    /* streaming is true once mongocrypt_ctx_decrypt_next_document is called.
+     * stream_iter iterates the cursor batch, and stream_next_ciphertext and
+     * stream_next_container index the first offsets after the documents
+     * already returned. */
+    bool streaming;
+    bson_iter_t stream_iter;
+    size_t stream_next_ciphertext;
+    size_t stream_next_container;
+    /* plaintext_cache holds the values of the Deterministic ciphertexts
+     * decrypted so far. */
+    _mongocrypt_cache_t plaintext_cache;
+    /* lazy_value holds the output of the last call to
+     * mongocrypt_ctx_decrypt_index or mongocrypt_ctx_decrypt_value_at. */
+    _mongocrypt_buffer_t lazy_value;
 } _mongocrypt_ctx_decrypt_t;
 
 typedef struct {
@@ -225,6 +432,16 @@ typedef struct {
     _mongocrypt_buffer_t kmip_secretdata;
 } _mongocrypt_ctx_datakey_t;
 
+typedef struct {
+    mongocrypt_ctx_t parent;
+    /* dkctxs holds one datakey context for each of the count keys. */
+    mongocrypt_ctx_t **dkctxs;
+    uint32_t count;
+    /* kms_next indexes the next datakey context asked for a KMS request. */
+    uint32_t kms_next;
+    _mongocrypt_buffer_t results;
+} _mongocrypt_ctx_datakey_batch_t;
+
 typedef struct _mongocrypt_ctx_rmd_datakey_t _mongocrypt_ctx_rmd_datakey_t;
 
 struct _mongocrypt_ctx_rmd_datakey_t {
@@ -240,6 +457,12 @@ typedef struct {
     _mongocrypt_ctx_rmd_datakey_t *datakeys;
     _mongocrypt_ctx_rmd_datakey_t *datakeys_iter;
     _mongocrypt_buffer_t results;
+    /* With rewrap_skip_unchanged: the new key encryption key as appended by
+     * _mongocrypt_kek_append, and the number of keys already wrapped with it. */
+    _mongocrypt_buffer_t skip_kek;
+    uint32_t skipped;
+    /* Set once a document of results was output. */
+    bool results_output;
 } _mongocrypt_ctx_rewrap_many_datakey_t;
 
 typedef struct {
@@ -248,6 +471,14 @@ typedef struct {
     mc_EncryptedFieldConfig_t efc;
 } _mongocrypt_ctx_compact_t;
 
+typedef struct {
+    mongocrypt_ctx_t parent;
+    _mongocrypt_buffer_t result;
+    /* pending_key_docs are the key documents (_mongocrypt_buffer_t) taken from
+     * the mongocrypt_t by mongocrypt_ctx_unwrap_pending_keys_init. */
+    mc_array_t pending_key_docs;
+} _mongocrypt_ctx_prefetch_keys_t;
+
 /* Used for option validation. True means required. False means prohibited. */
 typedef enum { OPT_PROHIBITED = 0, OPT_REQUIRED, OPT_OPTIONAL } _mongocrypt_ctx_opt_spec_t;
 
@@ -259,6 +490,8 @@ typedef struct {
     _mongocrypt_ctx_opt_spec_t key_material;
     _mongocrypt_ctx_opt_spec_t algorithm;
     _mongocrypt_ctx_opt_spec_t rangeopts;
+    _mongocrypt_ctx_opt_spec_t decrypt_paths;
+    _mongocrypt_ctx_opt_spec_t decrypt_plan;
 } _mongocrypt_ctx_opts_spec_t;
 
 /* Common initialization. */
@@ -16,7 +16,11 @@
 
 #include "mongocrypt-ctx-private.h"
 
-static bool _finalize(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
+/* Outputs { "v": [ ... ] } with the update fields of up to @max_keys
+ * rewrapped keys, or of every remaining key if @max_keys is 0. The datakey
+ * contexts of the output keys are destroyed, so a chunked caller only holds
+ * one batch of results at a time. */
+static bool _take_results(mongocrypt_ctx_t *ctx, uint32_t max_keys, mongocrypt_binary_t *out) {
     _mongocrypt_ctx_rewrap_many_datakey_t *const rmdctx = (_mongocrypt_ctx_rewrap_many_datakey_t *)ctx;
 
     bson_t doc = BSON_INITIALIZER;
@@ -27,10 +31,10 @@ static bool _finalize(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
 
     BSON_ASSERT(BSON_APPEND_ARRAY_BEGIN(&doc, "v", &array));
     {
-        _mongocrypt_ctx_rmd_datakey_t *iter = NULL;
-        size_t idx = 0u;
+        uint32_t idx = 0u;
 
-        for (iter = rmdctx->datakeys; iter; (iter = iter->next), (++idx)) {
+        while (rmdctx->datakeys && (max_keys == 0u || idx < max_keys)) {
+            _mongocrypt_ctx_rmd_datakey_t *const iter = rmdctx->datakeys;
             mongocrypt_binary_t bin;
             bson_t bson;
             bson_t elem = BSON_INITIALIZER;
@@ -73,27 +77,90 @@ static bool _finalize(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
 
             /* Array indicies must be specified manually. */
             {
-                char *idx_str = bson_strdup_printf("%zu", idx);
-                BSON_ASSERT(BSON_APPEND_DOCUMENT(&array, idx_str, &elem));
-                bson_free(idx_str);
+                char idx_str[16];
+                const char *key;
+
+                bson_uint32_to_string(idx, &key, idx_str, sizeof(idx_str));
+                BSON_ASSERT(bson_append_document(&array, key, -1, &elem));
             }
 
             bson_destroy(&elem);
+
+            rmdctx->datakeys = iter->next;
+            mongocrypt_ctx_destroy(iter->dkctx);
+            bson_free(iter);
+            idx++;
         }
     }
     BSON_ASSERT(bson_append_array_end(&doc, &array));
+    if (ctx->opts.rewrap_skip_unchanged) {
+        BSON_ASSERT(BSON_APPEND_INT64(&doc, "skipped", rmdctx->skipped));
+    }
+    rmdctx->results_output = true;
 
     /* Extend lifetime of bson so it can be referenced by out parameter. */
+    _mongocrypt_buffer_cleanup(&rmdctx->results);
     _mongocrypt_buffer_steal_from_bson(&rmdctx->results, &doc);
 
     out->data = rmdctx->results.data;
     out->len = rmdctx->results.len;
 
+    return true;
+}
+
+static bool _finalize(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(out);
+
+    if (!_take_results(ctx, 0u, out)) {
+        return false;
+    }
+
     ctx->state = MONGOCRYPT_CTX_DONE;
 
     return true;
 }
 
+bool mongocrypt_ctx_rewrap_many_datakey_next_batch(mongocrypt_ctx_t *ctx,
+                                                   uint32_t max_keys,
+                                                   mongocrypt_binary_t *out) {
+    _mongocrypt_ctx_rewrap_many_datakey_t *const rmdctx = (_mongocrypt_ctx_rewrap_many_datakey_t *)ctx;
+
+    if (!ctx) {
+        return false;
+    }
+    if (!ctx->initialized) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "ctx NULL or uninitialized");
+    }
+    if (!out) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "invalid NULL output");
+    }
+    if (ctx->type != _MONGOCRYPT_TYPE_REWRAP_MANY_DATAKEY) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "not applicable to context");
+    }
+    if (max_keys == 0u) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "max_keys must be greater than 0");
+    }
+    if (ctx->state == MONGOCRYPT_CTX_ERROR) {
+        return false;
+    }
+    if (ctx->state != MONGOCRYPT_CTX_READY) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "wrong state");
+    }
+
+    /* A context whose keys were all skipped outputs one empty batch with the
+     * skipped count. */
+    if (!rmdctx->datakeys && (rmdctx->results_output || rmdctx->skipped == 0u)) {
+        /* Every key was returned. */
+        out->data = NULL;
+        out->len = 0;
+        ctx->state = MONGOCRYPT_CTX_DONE;
+        return true;
+    }
+
+    return _take_results(ctx, max_keys, out);
+}
+
 static bool _kms_done_encrypt(mongocrypt_ctx_t *ctx) {
     _mongocrypt_ctx_rewrap_many_datakey_t *const rmdctx = (_mongocrypt_ctx_rewrap_many_datakey_t *)ctx;
 
@@ -270,7 +337,76 @@ static bool _start_kms_encrypt(mongocrypt_ctx_t *ctx) {
     return true;
 }
 
+/* Returns true if the key document @in is already wrapped with the key
+ * encryption key @skip_kek. Malformed documents are not skipped, so the key
+ * broker reports their errors. */
+static bool _is_unchanged(const _mongocrypt_buffer_t *skip_kek, mongocrypt_binary_t *in) {
+    bson_t doc;
+    bson_t master_key;
+    bson_iter_t iter;
+    _mongocrypt_kek_t kek = {0};
+    bson_t appended = BSON_INITIALIZER;
+    mongocrypt_status_t *status = mongocrypt_status_new();
+    bool ret = false;
+
+    BSON_ASSERT_PARAM(skip_kek);
+    BSON_ASSERT_PARAM(in);
+
+    if (!_mongocrypt_binary_to_bson(in, &doc) || !bson_iter_init_find(&iter, &doc, "masterKey")
+        || !BSON_ITER_HOLDS_DOCUMENT(&iter)) {
+        goto done;
+    }
+
+    {
+        const uint8_t *data;
+        uint32_t len;
+
+        bson_iter_document(&iter, &len, &data);
+        if (!bson_init_static(&master_key, data, len)) {
+            goto done;
+        }
+    }
+
+    if (!_mongocrypt_kek_parse_owned(&master_key, &kek, status) || !_mongocrypt_kek_append(&kek, &appended, status)) {
+        goto done;
+    }
+
+    ret = appended.len == skip_kek->len && 0 == memcmp(bson_get_data(&appended), skip_kek->data, skip_kek->len);
+
+done:
+    bson_destroy(&appended);
+    _mongocrypt_kek_cleanup(&kek);
+    mongocrypt_status_destroy(status);
+    return ret;
+}
+
+static bool _mongo_feed_keys(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *in) {
+    _mongocrypt_ctx_rewrap_many_datakey_t *const rmdctx = (_mongocrypt_ctx_rewrap_many_datakey_t *)ctx;
+    _mongocrypt_buffer_t buf;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(in);
+
+    /* Skipped keys never reach the key broker, so neither KMS phase sees them. */
+    if (rmdctx->skip_kek.len > 0u && _is_unchanged(&rmdctx->skip_kek, in)) {
+        if (rmdctx->skipped == UINT32_MAX) {
+            return _mongocrypt_ctx_fail_w_msg(ctx, "too many keys to skip");
+        }
+        rmdctx->skipped++;
+        return true;
+    }
+
+    _mongocrypt_buffer_from_binary(&buf, in);
+    if (!_mongocrypt_key_broker_add_doc(&ctx->kb, _mongocrypt_ctx_kms_providers(ctx), &buf)) {
+        BSON_ASSERT(!_mongocrypt_key_broker_status(&ctx->kb, ctx->status));
+        return _mongocrypt_ctx_fail(ctx);
+    }
+    return true;
+}
+
 static bool _mongo_done_keys(mongocrypt_ctx_t *ctx) {
+    _mongocrypt_ctx_rewrap_many_datakey_t *const rmdctx = (_mongocrypt_ctx_rewrap_many_datakey_t *)ctx;
+
     BSON_ASSERT_PARAM(ctx);
 
     if (!_mongocrypt_key_broker_docs_done(&ctx->kb) || !_mongocrypt_ctx_state_from_key_broker(ctx)) {
@@ -279,6 +415,12 @@ static bool _mongo_done_keys(mongocrypt_ctx_t *ctx) {
 
     /* No keys to rewrap, no work to be done. */
     if (!ctx->kb.key_requests) {
+        if (rmdctx->skipped > 0u) {
+            /* Report the skipped keys. */
+            ctx->state = MONGOCRYPT_CTX_READY;
+            ctx->vtable.finalize = _finalize;
+            return true;
+        }
         ctx->state = MONGOCRYPT_CTX_DONE;
         return true;
     }
@@ -328,6 +470,7 @@ static void _cleanup(mongocrypt_ctx_t *ctx) {
 
     _mongocrypt_kms_ctx_cleanup(&rmdctx->kms);
     _mongocrypt_buffer_cleanup(&rmdctx->filter);
+    _mongocrypt_buffer_cleanup(&rmdctx->skip_kek);
 }
 
 bool mongocrypt_ctx_rewrap_many_datakey_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *filter) {
@@ -353,14 +496,31 @@ bool mongocrypt_ctx_rewrap_many_datakey_init(mongocrypt_ctx_t *ctx, mongocrypt_b
     }
 
     ctx->type = _MONGOCRYPT_TYPE_REWRAP_MANY_DATAKEY;
+    _mongocrypt_counter_add(ctx->crypt, MC_COUNTER_CTX_REWRAP_MANY_DATAKEY, 1);
     ctx->state = MONGOCRYPT_CTX_NEED_MONGO_KEYS;
     ctx->vtable.cleanup = _cleanup;
     ctx->vtable.kms_done = _start_kms_encrypt;
     ctx->vtable.mongo_op_keys = _mongo_op_keys;
+    ctx->vtable.mongo_feed_keys = _mongo_feed_keys;
     ctx->vtable.mongo_done_keys = _mongo_done_keys;
 
     _mongocrypt_buffer_copy_from_binary(&rmdctx->filter, filter);
 
+    /* Without a new key encryption key every key is rewrapped with its own. A
+     * KMIP key encryption key without a keyId creates a new key, so it cannot
+     * match either. */
+    if (ctx->opts.rewrap_skip_unchanged && ctx->opts.kek.kms_provider != MONGOCRYPT_KMS_PROVIDER_NONE) {
+        bson_t kek = BSON_INITIALIZER;
+        mongocrypt_status_t *status = mongocrypt_status_new();
+
+        if (_mongocrypt_kek_append(&ctx->opts.kek, &kek, status)) {
+            _mongocrypt_buffer_steal_from_bson(&rmdctx->skip_kek, &kek);
+        } else {
+            bson_destroy(&kek);
+        }
+        mongocrypt_status_destroy(status);
+    }
+
     /* Obtain KMS credentials for use during decryption and encryption. */
     if (_mongocrypt_needs_credentials(ctx->crypt)) {
         ctx->state = MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS;
@@ -18,6 +18,7 @@
 
 #include "mongocrypt-ctx-private.h"
 #include "mongocrypt-key-broker-private.h"
+#include "mongocrypt-probes-private.h"
 
 bool _mongocrypt_ctx_fail_w_msg(mongocrypt_ctx_t *ctx, const char *msg) {
     BSON_ASSERT_PARAM(ctx);
@@ -87,6 +88,7 @@ bool mongocrypt_ctx_setopt_key_id(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *ke
         bson_free(key_id_val);
     }
 
+    _mongocrypt_ctx_record_binary(ctx, "ctx_setopt_key_id", key_id);
     return _set_binary_opt(ctx, key_id, &ctx->opts.key_id, BSON_SUBTYPE_UUID);
 }
 
@@ -99,6 +101,7 @@ bool mongocrypt_ctx_setopt_key_alt_name(mongocrypt_ctx_t *ctx, mongocrypt_binary
     if (!ctx) {
         return false;
     }
+    _mongocrypt_ctx_record_binary(ctx, "ctx_setopt_key_alt_name", key_alt_name);
 
     if (ctx->initialized) {
         return _mongocrypt_ctx_fail_w_msg(ctx, "cannot set options after init");
@@ -155,6 +158,7 @@ bool mongocrypt_ctx_setopt_key_material(mongocrypt_ctx_t *ctx, mongocrypt_binary
     if (!ctx) {
         return false;
     }
+    _mongocrypt_ctx_record_binary(ctx, "ctx_setopt_key_material", key_material);
 
     if (ctx->initialized) {
         return _mongocrypt_ctx_fail_w_msg(ctx, "cannot set options after init");
@@ -237,6 +241,13 @@ bool mongocrypt_ctx_setopt_algorithm(mongocrypt_ctx_t *ctx, const char *algorith
     }
 
     const size_t calculated_len = len == -1 ? strlen(algorithm) : (size_t)len;
+    if (_mongocrypt_ctx_record_enabled(ctx) && calculated_len <= INT_MAX) {
+        bson_t args = BSON_INITIALIZER;
+
+        BSON_ASSERT(bson_append_utf8(&args, "data", -1, algorithm, (int)calculated_len));
+        _mongocrypt_ctx_record(ctx, "ctx_setopt_algorithm", &args);
+        bson_destroy(&args);
+    }
     if (ctx->crypt->log.trace_enabled) {
         _mongocrypt_log(&ctx->crypt->log,
                         MONGOCRYPT_LOG_LEVEL_TRACE,
@@ -280,9 +291,22 @@ bool mongocrypt_ctx_setopt_algorithm(mongocrypt_ctx_t *ctx, const char *algorith
     return true;
 }
 
+/* _ctx_size returns the size of the largest context type. */
+static size_t _ctx_size(void) {
+    size_t ctx_size;
+
+    ctx_size = sizeof(_mongocrypt_ctx_encrypt_t);
+    if (sizeof(_mongocrypt_ctx_decrypt_t) > ctx_size) {
+        ctx_size = sizeof(_mongocrypt_ctx_decrypt_t);
+    }
+    if (sizeof(_mongocrypt_ctx_datakey_t) > ctx_size) {
+        ctx_size = sizeof(_mongocrypt_ctx_datakey_t);
+    }
+    return ctx_size;
+}
+
 mongocrypt_ctx_t *mongocrypt_ctx_new(mongocrypt_t *crypt) {
     mongocrypt_ctx_t *ctx;
-    size_t ctx_size;
 
     if (!crypt) {
         return NULL;
@@ -294,15 +318,7 @@ mongocrypt_ctx_t *mongocrypt_ctx_new(mongocrypt_t *crypt) {
         CLIENT_ERR("cannot create context from uninitialized crypt");
         return NULL;
     }
-    ctx_size = sizeof(_mongocrypt_ctx_encrypt_t);
-    if (sizeof(_mongocrypt_ctx_decrypt_t) > ctx_size) {
-        ctx_size = sizeof(_mongocrypt_ctx_decrypt_t);
-    }
-    if (sizeof(_mongocrypt_ctx_datakey_t) > ctx_size) {
-        ctx_size = sizeof(_mongocrypt_ctx_datakey_t);
-    }
-    ctx = bson_malloc0(ctx_size);
-    BSON_ASSERT(ctx);
+    ctx = _mongocrypt_malloc0(crypt, _ctx_size());
 
     ctx->crypt = crypt;
     ctx->status = mongocrypt_status_new();
@@ -373,13 +389,296 @@ static bool _kms_done(mongocrypt_ctx_t *ctx) {
     return _mongocrypt_ctx_state_from_key_broker(ctx);
 }
 
+bool _mongocrypt_ctx_trace_enabled(const mongocrypt_ctx_t *ctx) {
+    BSON_ASSERT_PARAM(ctx);
+
+    return ctx->crypt->opts.trace_fn != NULL;
+}
+
+void _mongocrypt_ctx_trace(mongocrypt_ctx_t *ctx,
+                           mongocrypt_trace_event_t event,
+                           const char *span,
+                           const bson_t *attributes) {
+    bson_t empty = BSON_INITIALIZER;
+    mongocrypt_binary_t bin;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(span);
+
+    if (!ctx->crypt->opts.trace_fn) {
+        return;
+    }
+
+    if (!attributes) {
+        attributes = &empty;
+    }
+    bin.data = (void *)bson_get_data(attributes);
+    bin.len = attributes->len;
+    ctx->crypt->opts.trace_fn(ctx, event, span, &bin, ctx->crypt->opts.trace_ctx);
+}
+
+bool _mongocrypt_ctx_record_enabled(const mongocrypt_ctx_t *ctx) {
+    BSON_ASSERT_PARAM(ctx);
+
+    return ctx->crypt->opts.record_fn != NULL;
+}
+
+void _mongocrypt_ctx_record(mongocrypt_ctx_t *ctx, const char *call, const bson_t *args) {
+    _mongocrypt_ctx_record_t *record;
+    bson_t event;
+    char idx_str[16];
+    const char *idx_key;
+    int64_t now;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(call);
+
+    if (!ctx->crypt->opts.record_fn) {
+        return;
+    }
+
+    now = bson_get_monotonic_time();
+    if (!ctx->record) {
+        /* Only calls on @ctx itself get here. KMS contexts are given a record
+         * id, and so record calls, once the record exists. */
+        ctx->record = bson_malloc0(sizeof(*ctx->record));
+        _mongocrypt_mutex_init(&ctx->record->mutex);
+        bson_init(&ctx->record->events);
+        ctx->record->start_us = now;
+    }
+    record = ctx->record;
+
+    MONGOCRYPT_WITH_MUTEX(record->mutex) {
+        bson_uint32_to_string(record->events_len++, &idx_key, idx_str, sizeof(idx_str));
+        BSON_ASSERT(BSON_APPEND_DOCUMENT_BEGIN(&record->events, idx_key, &event));
+        BSON_ASSERT(BSON_APPEND_UTF8(&event, "call", call));
+        BSON_ASSERT(BSON_APPEND_INT64(&event, "us", now - record->start_us));
+        if (args) {
+            BSON_ASSERT(bson_concat(&event, args));
+        }
+        BSON_ASSERT(bson_append_document_end(&record->events, &event));
+    }
+}
+
+void _mongocrypt_ctx_record_binary(mongocrypt_ctx_t *ctx, const char *call, const mongocrypt_binary_t *data) {
+    bson_t args = BSON_INITIALIZER;
+
+    BSON_ASSERT_PARAM(ctx);
+
+    if (!_mongocrypt_ctx_record_enabled(ctx)) {
+        return;
+    }
+    if (data && data->data) {
+        BSON_ASSERT(BSON_APPEND_BINARY(&args, "data", BSON_SUBTYPE_BINARY, data->data, data->len));
+    }
+    _mongocrypt_ctx_record(ctx, call, &args);
+    bson_destroy(&args);
+}
+
+void _mongocrypt_ctx_record_init(mongocrypt_ctx_t *ctx,
+                                 const char *call,
+                                 const char *db,
+                                 int32_t db_len,
+                                 const mongocrypt_binary_t *data) {
+    bson_t args = BSON_INITIALIZER;
+
+    BSON_ASSERT_PARAM(ctx);
+
+    if (!_mongocrypt_ctx_record_enabled(ctx)) {
+        return;
+    }
+    /* Init functions may call each other. Only the one called by the
+     * application is replayed. */
+    if (ctx->record && ctx->record->started) {
+        return;
+    }
+    if (db && db_len >= -1) {
+        BSON_ASSERT(bson_append_utf8(&args, "db", -1, db, db_len));
+    }
+    if (data && data->data) {
+        BSON_ASSERT(BSON_APPEND_BINARY(&args, "data", BSON_SUBTYPE_BINARY, data->data, data->len));
+    }
+    _mongocrypt_ctx_record(ctx, call, &args);
+    ctx->record->started = true;
+    bson_destroy(&args);
+}
+
+/* _record_report calls the record handler with the calls recorded on @ctx, if
+ * it was initialized to be replayed, and frees them. */
+static void _record_report(mongocrypt_ctx_t *ctx) {
+    _mongocrypt_ctx_record_t *record;
+
+    BSON_ASSERT_PARAM(ctx);
+
+    record = ctx->record;
+    if (!record) {
+        return;
+    }
+
+    if (record->started && ctx->crypt->opts.record_fn) {
+        bson_t session = BSON_INITIALIZER;
+        mongocrypt_binary_t bin;
+
+        BSON_ASSERT(BSON_APPEND_ARRAY(&session, "events", &record->events));
+        BSON_ASSERT(BSON_APPEND_INT32(&session, "state", (int32_t)ctx->state));
+        BSON_ASSERT(BSON_APPEND_BOOL(&session, "ok", ctx->state != MONGOCRYPT_CTX_ERROR));
+        if (!mongocrypt_status_ok(ctx->status)) {
+            BSON_ASSERT(BSON_APPEND_UTF8(&session, "error", mongocrypt_status_message(ctx->status, NULL)));
+        }
+        BSON_ASSERT(BSON_APPEND_INT64(&session, "durationUs", bson_get_monotonic_time() - record->start_us));
+        bin.data = (void *)bson_get_data(&session);
+        bin.len = session.len;
+        ctx->crypt->opts.record_fn(ctx, &bin, ctx->crypt->opts.record_ctx);
+        bson_destroy(&session);
+    }
+
+    bson_destroy(&record->events);
+    _mongocrypt_mutex_cleanup(&record->mutex);
+    bson_free(record);
+    ctx->record = NULL;
+}
+
+/* _record_mongo_op records a call on @op. @in may be NULL. */
+static void _record_mongo_op(mongocrypt_mongo_op_t *op, const char *call, const mongocrypt_binary_t *in) {
+    mongocrypt_ctx_t *ctx;
+    bson_t args = BSON_INITIALIZER;
+
+    BSON_ASSERT_PARAM(op);
+
+    ctx = op->ctx;
+    if (!_mongocrypt_ctx_record_enabled(ctx)) {
+        return;
+    }
+    for (uint32_t i = 0; i < ctx->mongo_ops_len; i++) {
+        if (ctx->mongo_ops[i] == op) {
+            BSON_ASSERT(i <= INT32_MAX);
+            BSON_ASSERT(BSON_APPEND_INT32(&args, "index", (int32_t)i));
+            break;
+        }
+    }
+    if (in && in->data) {
+        BSON_ASSERT(BSON_APPEND_BINARY(&args, "data", BSON_SUBTYPE_BINARY, in->data, in->len));
+    }
+    _mongocrypt_ctx_record(ctx, call, &args);
+    bson_destroy(&args);
+}
+
+/* _trace_attributes appends the attributes of a span beginning on @ctx. */
+static void _trace_attributes(mongocrypt_ctx_t *ctx, bson_t *out) {
+    int32_t keys = 0;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(out);
+
+    if (ctx->type == _MONGOCRYPT_TYPE_ENCRYPT) {
+        _mongocrypt_ctx_encrypt_t *ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+
+        if (ectx->target_ns) {
+            BSON_ASSERT(BSON_APPEND_UTF8(out, "ns", ectx->target_ns));
+        }
+    } else if (ctx->type == _MONGOCRYPT_TYPE_DECRYPT) {
+        _mongocrypt_ctx_decrypt_t *dctx = (_mongocrypt_ctx_decrypt_t *)ctx;
+
+        BSON_ASSERT(dctx->ciphertext_offsets.len <= INT32_MAX);
+        BSON_ASSERT(BSON_APPEND_INT32(out, "fields", (int32_t)dctx->ciphertext_offsets.len));
+    }
+
+    for (key_request_t *kr = ctx->kb.key_requests; kr != NULL; kr = kr->next) {
+        keys++;
+    }
+    BSON_ASSERT(BSON_APPEND_INT32(out, "keys", keys));
+}
+
+/* _trace_span_begin calls the trace handler for a span beginning on @ctx. */
+static void _trace_span_begin(mongocrypt_ctx_t *ctx, const char *span) {
+    bson_t attributes = BSON_INITIALIZER;
+
+    _trace_attributes(ctx, &attributes);
+    _mongocrypt_ctx_trace(ctx, MONGOCRYPT_TRACE_BEGIN, span, &attributes);
+    bson_destroy(&attributes);
+}
+
+/* _trace_span_end calls the trace handler for a span ending on @ctx. */
+static void _trace_span_end(mongocrypt_ctx_t *ctx, const char *span, bool ok) {
+    bson_t attributes = BSON_INITIALIZER;
+
+    BSON_ASSERT(BSON_APPEND_BOOL(&attributes, "ok", ok));
+    _mongocrypt_ctx_trace(ctx, MONGOCRYPT_TRACE_END, span, &attributes);
+    bson_destroy(&attributes);
+}
+
+/* _state_span returns the name of the trace span of @state, or NULL. */
+static const char *_state_span(int state) {
+    switch (state) {
+    case MONGOCRYPT_CTX_NEED_MONGO_COLLINFO:
+    case MONGOCRYPT_CTX_NEED_MONGO_COLLINFO_WITH_DB: return "collinfo";
+    case MONGOCRYPT_CTX_NEED_MONGO_MARKINGS: return "markings";
+    case MONGOCRYPT_CTX_NEED_MONGO_KEYS: return "keys";
+    case MONGOCRYPT_CTX_NEED_MONGO_OPS: return "ops";
+    default: return NULL;
+    }
+}
+
+/* _ctx_check_deadline fails @ctx if its deadline has passed while it still
+ * waits on the driver. A ready context only has local work left. */
+static void _ctx_check_deadline(mongocrypt_ctx_t *ctx) {
+    BSON_ASSERT_PARAM(ctx);
+
+    if (ctx->deadline_us == 0 || ctx->state == MONGOCRYPT_CTX_ERROR || ctx->state == MONGOCRYPT_CTX_READY
+        || ctx->state == MONGOCRYPT_CTX_DONE) {
+        return;
+    }
+    if (bson_get_monotonic_time() >= ctx->deadline_us) {
+        _mongocrypt_ctx_fail_w_msg(ctx, "deadline exceeded");
+    }
+}
+
+/* _ctx_observe_state charges the time since the last observed state change
+ * to that state if @ctx has since changed state. The trace spans of the
+ * states end and begin here too, and ctx__state fires. */
+static void _ctx_observe_state(mongocrypt_ctx_t *ctx) {
+    int64_t now;
+
+    BSON_ASSERT_PARAM(ctx);
+
+    if ((int)ctx->state == ctx->timings.timed_state) {
+        return;
+    }
+
+    now = bson_get_monotonic_time();
+    MONGOCRYPT_PROBE4(ctx__state, ctx, ctx->timings.timed_state, (int)ctx->state, now - ctx->timings.state_entered_us);
+    if (ctx->timings.timed_state < 0) {
+        ctx->timings.init_us += now - ctx->timings.state_entered_us;
+    } else {
+        ctx->timings.state_us[ctx->timings.timed_state] += now - ctx->timings.state_entered_us;
+    }
+
+    if (_mongocrypt_ctx_trace_enabled(ctx)) {
+        const char *ended = _state_span(ctx->timings.timed_state);
+        const char *begun = _state_span((int)ctx->state);
+
+        if (ended) {
+            _trace_span_end(ctx, ended, ctx->state != MONGOCRYPT_CTX_ERROR);
+        }
+        if (begun) {
+            _trace_span_begin(ctx, begun);
+        }
+    }
+
+    ctx->timings.timed_state = (int)ctx->state;
+    ctx->timings.state_entered_us = now;
+}
+
 bool mongocrypt_ctx_mongo_op(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
     if (!ctx) {
         return false;
     }
+    _mongocrypt_ctx_record(ctx, "ctx_mongo_op", NULL);
     if (!ctx->initialized) {
         return _mongocrypt_ctx_fail_w_msg(ctx, "ctx NULL or uninitialized");
     }
+    _ctx_check_deadline(ctx);
+    _ctx_observe_state(ctx);
 
     if (!out) {
         return _mongocrypt_ctx_fail_w_msg(ctx, "invalid NULL output");
@@ -394,6 +693,36 @@ bool mongocrypt_ctx_mongo_op(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
     case MONGOCRYPT_CTX_DONE:
     case MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS:
     case MONGOCRYPT_CTX_NEED_KMS:
+    case MONGOCRYPT_CTX_NEED_MONGO_OPS:
+    case MONGOCRYPT_CTX_READY:
+    default: return _mongocrypt_ctx_fail_w_msg(ctx, "wrong state");
+    }
+}
+
+bool mongocrypt_ctx_mongo_op_projection(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
+    if (!ctx) {
+        return false;
+    }
+    if (!ctx->initialized) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "ctx NULL or uninitialized");
+    }
+    _ctx_check_deadline(ctx);
+    _ctx_observe_state(ctx);
+
+    if (!out) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "invalid NULL output");
+    }
+
+    switch (ctx->state) {
+    case MONGOCRYPT_CTX_NEED_MONGO_KEYS: _mongocrypt_key_broker_projection(&ctx->kb, out); return true;
+    case MONGOCRYPT_CTX_ERROR: return false;
+    case MONGOCRYPT_CTX_NEED_MONGO_COLLINFO_WITH_DB:
+    case MONGOCRYPT_CTX_NEED_MONGO_COLLINFO:
+    case MONGOCRYPT_CTX_NEED_MONGO_MARKINGS:
+    case MONGOCRYPT_CTX_DONE:
+    case MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS:
+    case MONGOCRYPT_CTX_NEED_KMS:
+    case MONGOCRYPT_CTX_NEED_MONGO_OPS:
     case MONGOCRYPT_CTX_READY:
     default: return _mongocrypt_ctx_fail_w_msg(ctx, "wrong state");
     }
@@ -423,6 +752,7 @@ const char *mongocrypt_ctx_mongo_db(mongocrypt_ctx_t *ctx) {
     case MONGOCRYPT_CTX_DONE:
     case MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS:
     case MONGOCRYPT_CTX_NEED_KMS:
+    case MONGOCRYPT_CTX_NEED_MONGO_OPS:
     case MONGOCRYPT_CTX_READY:
     default: {
         _mongocrypt_ctx_fail_w_msg(ctx, "wrong state");
@@ -435,9 +765,12 @@ bool mongocrypt_ctx_mongo_feed(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *in) {
     if (!ctx) {
         return false;
     }
+    _mongocrypt_ctx_record_binary(ctx, "ctx_mongo_feed", in);
     if (!ctx->initialized) {
         return _mongocrypt_ctx_fail_w_msg(ctx, "ctx NULL or uninitialized");
     }
+    _ctx_check_deadline(ctx);
+    _ctx_observe_state(ctx);
 
     if (!in) {
         return _mongocrypt_ctx_fail_w_msg(ctx, "invalid NULL input");
@@ -460,6 +793,7 @@ bool mongocrypt_ctx_mongo_feed(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *in) {
     case MONGOCRYPT_CTX_DONE:
     case MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS:
     case MONGOCRYPT_CTX_NEED_KMS:
+    case MONGOCRYPT_CTX_NEED_MONGO_OPS:
     case MONGOCRYPT_CTX_READY:
     default: return _mongocrypt_ctx_fail_w_msg(ctx, "wrong state");
     }
@@ -469,15 +803,26 @@ bool mongocrypt_ctx_mongo_done(mongocrypt_ctx_t *ctx) {
     if (!ctx) {
         return false;
     }
+    _mongocrypt_ctx_record(ctx, "ctx_mongo_done", NULL);
     if (!ctx->initialized) {
         return _mongocrypt_ctx_fail_w_msg(ctx, "ctx NULL or uninitialized");
     }
+    _ctx_check_deadline(ctx);
+    _ctx_observe_state(ctx);
 
     switch (ctx->state) {
     case MONGOCRYPT_CTX_NEED_MONGO_COLLINFO_WITH_DB:
     case MONGOCRYPT_CTX_NEED_MONGO_COLLINFO: CHECK_AND_CALL(mongo_done_collinfo, ctx);
     case MONGOCRYPT_CTX_NEED_MONGO_MARKINGS: CHECK_AND_CALL(mongo_done_markings, ctx);
     case MONGOCRYPT_CTX_NEED_MONGO_KEYS: CHECK_AND_CALL(mongo_done_keys, ctx);
+    case MONGOCRYPT_CTX_NEED_MONGO_OPS: {
+        for (uint32_t i = 0; i < ctx->mongo_ops_len; i++) {
+            if (!ctx->mongo_ops[i]->done) {
+                return _mongocrypt_ctx_fail_w_msg(ctx, "not all mongo operations are done");
+            }
+        }
+        CHECK_AND_CALL(mongo_done_ops, ctx);
+    }
     case MONGOCRYPT_CTX_ERROR: return false;
     case MONGOCRYPT_CTX_DONE:
     case MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS:
@@ -487,6 +832,166 @@ bool mongocrypt_ctx_mongo_done(mongocrypt_ctx_t *ctx) {
     }
 }
 
+mongocrypt_mongo_op_t *
+_mongocrypt_ctx_add_mongo_op(mongocrypt_ctx_t *ctx, mongocrypt_ctx_state_t type, const char *db, const bson_t *op) {
+    mongocrypt_mongo_op_t *mongo_op;
+    _mongocrypt_buffer_t op_buf;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(op);
+
+    mongo_op = bson_malloc0(sizeof(*mongo_op));
+    BSON_ASSERT(mongo_op);
+    mongo_op->ctx = ctx;
+    mongo_op->type = type;
+    mongo_op->db = bson_strdup(db);
+    _mongocrypt_buffer_from_bson(&op_buf, op);
+    _mongocrypt_buffer_copy_to(&op_buf, &mongo_op->op);
+
+    ctx->mongo_ops = bson_realloc(ctx->mongo_ops, sizeof(mongocrypt_mongo_op_t *) * (ctx->mongo_ops_len + 1u));
+    ctx->mongo_ops[ctx->mongo_ops_len++] = mongo_op;
+    return mongo_op;
+}
+
+void _mongocrypt_ctx_clear_mongo_ops(mongocrypt_ctx_t *ctx) {
+    BSON_ASSERT_PARAM(ctx);
+
+    for (uint32_t i = 0; i < ctx->mongo_ops_len; i++) {
+        bson_free(ctx->mongo_ops[i]->db);
+        _mongocrypt_buffer_cleanup(&ctx->mongo_ops[i]->op);
+        bson_free(ctx->mongo_ops[i]);
+    }
+    bson_free(ctx->mongo_ops);
+    ctx->mongo_ops = NULL;
+    ctx->mongo_ops_len = 0;
+    ctx->mongo_ops_next = 0;
+}
+
+mongocrypt_mongo_op_t *mongocrypt_ctx_next_mongo_op(mongocrypt_ctx_t *ctx) {
+    if (!ctx) {
+        return NULL;
+    }
+    _mongocrypt_ctx_record(ctx, "ctx_next_mongo_op", NULL);
+    if (!ctx->initialized) {
+        _mongocrypt_ctx_fail_w_msg(ctx, "ctx NULL or uninitialized");
+        return NULL;
+    }
+    _ctx_check_deadline(ctx);
+    _ctx_observe_state(ctx);
+
+    switch (ctx->state) {
+    case MONGOCRYPT_CTX_NEED_MONGO_OPS: {
+        if (ctx->mongo_ops_next == ctx->mongo_ops_len) {
+            return NULL;
+        }
+        return ctx->mongo_ops[ctx->mongo_ops_next++];
+    }
+    case MONGOCRYPT_CTX_ERROR: return NULL;
+    case MONGOCRYPT_CTX_DONE:
+    case MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS:
+    case MONGOCRYPT_CTX_NEED_KMS:
+    case MONGOCRYPT_CTX_NEED_MONGO_COLLINFO_WITH_DB:
+    case MONGOCRYPT_CTX_NEED_MONGO_COLLINFO:
+    case MONGOCRYPT_CTX_NEED_MONGO_KEYS:
+    case MONGOCRYPT_CTX_NEED_MONGO_MARKINGS:
+    case MONGOCRYPT_CTX_READY:
+    default: _mongocrypt_ctx_fail_w_msg(ctx, "wrong state"); return NULL;
+    }
+}
+
+mongocrypt_ctx_state_t mongocrypt_mongo_op_type(mongocrypt_mongo_op_t *op) {
+    if (!op) {
+        return MONGOCRYPT_CTX_ERROR;
+    }
+    return op->type;
+}
+
+const char *mongocrypt_mongo_op_db(mongocrypt_mongo_op_t *op) {
+    if (!op) {
+        return NULL;
+    }
+    if (!op->db) {
+        _mongocrypt_ctx_fail_w_msg(op->ctx, "not applicable to mongo operation");
+        return NULL;
+    }
+    return op->db;
+}
+
+bool mongocrypt_mongo_op_op(mongocrypt_mongo_op_t *op, mongocrypt_binary_t *out) {
+    if (!op) {
+        return false;
+    }
+    if (!out) {
+        return _mongocrypt_ctx_fail_w_msg(op->ctx, "invalid NULL output");
+    }
+    _mongocrypt_buffer_to_binary(&op->op, out);
+    return true;
+}
+
+bool mongocrypt_mongo_op_projection(mongocrypt_mongo_op_t *op, mongocrypt_binary_t *out) {
+    if (!op) {
+        return false;
+    }
+    if (!out) {
+        return _mongocrypt_ctx_fail_w_msg(op->ctx, "invalid NULL output");
+    }
+    if (op->type != MONGOCRYPT_CTX_NEED_MONGO_KEYS) {
+        return _mongocrypt_ctx_fail_w_msg(op->ctx, "not applicable to mongo operation");
+    }
+    _mongocrypt_key_broker_projection(&op->ctx->kb, out);
+    return true;
+}
+
+bool mongocrypt_mongo_op_feed(mongocrypt_mongo_op_t *op, mongocrypt_binary_t *in) {
+    mongocrypt_ctx_t *ctx;
+
+    if (!op) {
+        return false;
+    }
+    ctx = op->ctx;
+    _record_mongo_op(op, "mongo_op_feed", in);
+    if (!in) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "invalid NULL input");
+    }
+    if (ctx->state == MONGOCRYPT_CTX_ERROR) {
+        return false;
+    }
+    if (op->done) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "mongo operation is done");
+    }
+
+    if (op->type == MONGOCRYPT_CTX_NEED_MONGO_KEYS) {
+        /* Key documents are added once the key broker requests them. */
+        ctx->prefetched_keys =
+            bson_realloc(ctx->prefetched_keys, sizeof(_mongocrypt_buffer_t) * (ctx->prefetched_keys_len + 1u));
+        _mongocrypt_buffer_copy_from_binary(&ctx->prefetched_keys[ctx->prefetched_keys_len++], in);
+        return true;
+    }
+    CHECK_AND_CALL(mongo_feed_op, ctx, op, in);
+}
+
+bool mongocrypt_mongo_op_done(mongocrypt_mongo_op_t *op) {
+    mongocrypt_ctx_t *ctx;
+
+    if (!op) {
+        return false;
+    }
+    ctx = op->ctx;
+    _record_mongo_op(op, "mongo_op_done", NULL);
+    if (ctx->state == MONGOCRYPT_CTX_ERROR) {
+        return false;
+    }
+    if (op->done) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "mongo operation is done");
+    }
+
+    op->done = true;
+    if (op->type == MONGOCRYPT_CTX_NEED_MONGO_KEYS) {
+        return true;
+    }
+    CHECK_AND_CALL(mongo_done_op, ctx, op);
+}
+
 mongocrypt_ctx_state_t mongocrypt_ctx_state(mongocrypt_ctx_t *ctx) {
     if (!ctx) {
         return MONGOCRYPT_CTX_ERROR;
@@ -495,18 +1000,46 @@ mongocrypt_ctx_state_t mongocrypt_ctx_state(mongocrypt_ctx_t *ctx) {
         _mongocrypt_ctx_fail_w_msg(ctx, "ctx NULL or uninitialized");
         return MONGOCRYPT_CTX_ERROR;
     }
+    _ctx_check_deadline(ctx);
+    _ctx_observe_state(ctx);
 
     return ctx->state;
 }
 
+/* _kms_request_counter returns the counter of KMS requests like @kms. */
+static mc_counter_t _kms_request_counter(const mongocrypt_kms_ctx_t *kms) {
+    BSON_ASSERT_PARAM(kms);
+
+    switch (kms->req_type) {
+    case MONGOCRYPT_KMS_AZURE_OAUTH:
+    case MONGOCRYPT_KMS_AZURE_WRAPKEY:
+    case MONGOCRYPT_KMS_AZURE_UNWRAPKEY: return MC_COUNTER_KMS_AZURE;
+    case MONGOCRYPT_KMS_GCP_OAUTH:
+    case MONGOCRYPT_KMS_GCP_ENCRYPT:
+    case MONGOCRYPT_KMS_GCP_DECRYPT: return MC_COUNTER_KMS_GCP;
+    case MONGOCRYPT_KMS_KMIP_REGISTER:
+    case MONGOCRYPT_KMS_KMIP_ACTIVATE:
+    case MONGOCRYPT_KMS_KMIP_GET:
+    case MONGOCRYPT_KMS_KMIP_ENCRYPT:
+    case MONGOCRYPT_KMS_KMIP_DECRYPT:
+    case MONGOCRYPT_KMS_KMIP_CREATE: return MC_COUNTER_KMS_KMIP;
+    case MONGOCRYPT_KMS_AWS_ENCRYPT:
+    case MONGOCRYPT_KMS_AWS_DECRYPT:
+    default: return MC_COUNTER_KMS_AWS;
+    }
+}
+
 mongocrypt_kms_ctx_t *mongocrypt_ctx_next_kms_ctx(mongocrypt_ctx_t *ctx) {
     if (!ctx) {
         return NULL;
     }
+    _mongocrypt_ctx_record(ctx, "ctx_next_kms_ctx", NULL);
     if (!ctx->initialized) {
         _mongocrypt_ctx_fail_w_msg(ctx, "ctx NULL or uninitialized");
         return NULL;
     }
+    _ctx_check_deadline(ctx);
+    _ctx_observe_state(ctx);
 
     if (!ctx->vtable.next_kms_ctx) {
         _mongocrypt_ctx_fail_w_msg(ctx, "not applicable to context");
@@ -514,7 +1047,42 @@ mongocrypt_kms_ctx_t *mongocrypt_ctx_next_kms_ctx(mongocrypt_ctx_t *ctx) {
     }
 
     switch (ctx->state) {
-    case MONGOCRYPT_CTX_NEED_KMS: return ctx->vtable.next_kms_ctx(ctx);
+    case MONGOCRYPT_CTX_NEED_KMS: {
+        mongocrypt_kms_ctx_t *kms = ctx->vtable.next_kms_ctx(ctx);
+
+        if (kms) {
+            kms->retry_enabled = ctx->crypt->opts.retry_kms;
+            kms->deadline_us = ctx->deadline_us;
+            kms->stats_crypt = ctx->crypt;
+            if (ctx->crypt->opts.kms_keep_alive) {
+                _mongocrypt_kms_ctx_set_keep_alive(kms);
+            }
+            kms->large_reads = ctx->crypt->opts.kms_large_reads;
+            /* Each return of the request is one send, including retries. */
+            kms->pace_usec = _mongocrypt_kms_rate_limit_take(ctx->crypt, kms->kmsid, kms->endpoint);
+            _mongocrypt_counter_add(ctx->crypt, _kms_request_counter(kms), 1);
+        }
+
+        if (kms && !kms->record_ctx && ctx->record) {
+            /* Later calls on the KMS context are recorded with this id. The
+             * replay numbers the KMS contexts it gets the same way. */
+            kms->record_ctx = ctx;
+            kms->record_id = ctx->record->kms_len++;
+        }
+
+        if (kms && !kms->trace_ctx && _mongocrypt_ctx_trace_enabled(ctx)) {
+            bson_t attributes = BSON_INITIALIZER;
+
+            BSON_ASSERT(BSON_APPEND_UTF8(&attributes, "kmsProvider", kms->kmsid));
+            if (kms->endpoint) {
+                BSON_ASSERT(BSON_APPEND_UTF8(&attributes, "endpoint", kms->endpoint));
+            }
+            kms->trace_ctx = ctx;
+            _mongocrypt_ctx_trace(ctx, MONGOCRYPT_TRACE_BEGIN, "kms", &attributes);
+            bson_destroy(&attributes);
+        }
+        return kms;
+    }
     case MONGOCRYPT_CTX_ERROR: return NULL;
     case MONGOCRYPT_CTX_DONE:
     case MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS:
@@ -522,20 +1090,100 @@ mongocrypt_kms_ctx_t *mongocrypt_ctx_next_kms_ctx(mongocrypt_ctx_t *ctx) {
     case MONGOCRYPT_CTX_NEED_MONGO_COLLINFO:
     case MONGOCRYPT_CTX_NEED_MONGO_KEYS:
     case MONGOCRYPT_CTX_NEED_MONGO_MARKINGS:
+    case MONGOCRYPT_CTX_NEED_MONGO_OPS:
     case MONGOCRYPT_CTX_READY:
     default: _mongocrypt_ctx_fail_w_msg(ctx, "wrong state"); return NULL;
     }
 }
 
+/* _add_snapshot_keys adds the key documents of the key vault snapshot that
+ * are requested by the key broker. If that satisfies every request, the
+ * MONGOCRYPT_CTX_NEED_MONGO_KEYS state is skipped. Errors are left in the key
+ * broker. */
+static void _add_snapshot_keys(mongocrypt_ctx_t *ctx) {
+    key_request_t *req;
+
+    BSON_ASSERT_PARAM(ctx);
+
+    for (req = ctx->kb.key_requests; req != NULL; req = req->next) {
+        const _mongocrypt_buffer_t *doc;
+
+        if (req->satisfied) {
+            continue;
+        }
+        doc = mc_key_vault_snapshot_find(ctx->crypt->key_vault_snapshot, &req->id, req->alt_name);
+        if (doc && !_mongocrypt_key_broker_add_prefetched_doc(&ctx->kb, _mongocrypt_ctx_kms_providers(ctx), doc)) {
+            return;
+        }
+    }
+    if (ctx->kb.num_unsatisfied == 0) {
+        (void)_mongocrypt_key_broker_docs_done(&ctx->kb);
+    }
+}
+
+/* _set_per_ctx_kms_providers parses on-demand credentials into the per-context
+ * KMS providers of @ctx, and merges them with those of the mongocrypt_t. */
+static bool _set_per_ctx_kms_providers(mongocrypt_ctx_t *ctx,
+                                       mongocrypt_binary_t *kms_providers_definition,
+                                       mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(kms_providers_definition);
+
+    _mongocrypt_opts_kms_providers_init(&ctx->per_ctx_kms_providers);
+
+    if (!_mongocrypt_parse_kms_providers(kms_providers_definition,
+                                         &ctx->per_ctx_kms_providers,
+                                         status,
+                                         &ctx->crypt->log)
+        || !_mongocrypt_opts_kms_providers_validate(&ctx->crypt->opts, &ctx->per_ctx_kms_providers, status)) {
+        /* Remove the parsed KMS providers if they are invalid */
+        _mongocrypt_opts_kms_providers_cleanup(&ctx->per_ctx_kms_providers);
+        memset(&ctx->per_ctx_kms_providers, 0, sizeof(ctx->per_ctx_kms_providers));
+        return false;
+    }
+
+    memcpy(&ctx->kms_providers, &ctx->crypt->opts.kms_providers, sizeof(_mongocrypt_opts_kms_providers_t));
+    _mongocrypt_opts_merge_kms_providers(&ctx->kms_providers, &ctx->per_ctx_kms_providers);
+    ctx->kms_credentials_provided = true;
+    return true;
+}
+
+/* _use_cached_kms_credentials returns true if @ctx has on-demand credentials,
+ * setting them from the credentials cached by the mongocrypt_t if needed. */
+static bool _use_cached_kms_credentials(mongocrypt_ctx_t *ctx) {
+    _mongocrypt_buffer_t cached;
+    bool ok;
+
+    BSON_ASSERT_PARAM(ctx);
+
+    if (ctx->kms_credentials_provided) {
+        return true;
+    }
+    if (!_mongocrypt_get_cached_kms_credentials(ctx->crypt, &cached)) {
+        return false;
+    }
+
+    /* The cached credentials were valid when provided, so this only fails if
+     * the options changed. Fall back to asking for credentials. */
+    mongocrypt_status_t *status = mongocrypt_status_new();
+    ok = _set_per_ctx_kms_providers(ctx, _mongocrypt_buffer_as_binary(&cached), status);
+    mongocrypt_status_destroy(status);
+    _mongocrypt_buffer_cleanup(&cached);
+    return ok;
+}
+
 bool mongocrypt_ctx_provide_kms_providers(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *kms_providers_definition) {
     if (!ctx) {
         return false;
     }
+    _mongocrypt_ctx_record_binary(ctx, "ctx_provide_kms_providers", kms_providers_definition);
 
     if (!ctx->initialized) {
         _mongocrypt_ctx_fail_w_msg(ctx, "ctx NULL or uninitialized");
         return false;
     }
+    _ctx_check_deadline(ctx);
+    _ctx_observe_state(ctx);
 
     if (ctx->state != MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS) {
         _mongocrypt_ctx_fail_w_msg(ctx, "wrong state");
@@ -547,24 +1195,18 @@ bool mongocrypt_ctx_provide_kms_providers(mongocrypt_ctx_t *ctx, mongocrypt_bina
         return false;
     }
 
-    _mongocrypt_opts_kms_providers_init(&ctx->per_ctx_kms_providers);
-
-    if (!_mongocrypt_parse_kms_providers(kms_providers_definition,
-                                         &ctx->per_ctx_kms_providers,
-                                         ctx->status,
-                                         &ctx->crypt->log)) {
-        return _mongocrypt_ctx_fail(ctx);
-    }
-
-    if (!_mongocrypt_opts_kms_providers_validate(&ctx->crypt->opts, &ctx->per_ctx_kms_providers, ctx->status)) {
-        /* Remove the parsed KMS providers if they are invalid */
-        _mongocrypt_opts_kms_providers_cleanup(&ctx->per_ctx_kms_providers);
-        memset(&ctx->per_ctx_kms_providers, 0, sizeof(ctx->per_ctx_kms_providers));
+    if (!_set_per_ctx_kms_providers(ctx, kms_providers_definition, ctx->status)) {
         return _mongocrypt_ctx_fail(ctx);
     }
+    _mongocrypt_cache_kms_credentials(ctx->crypt, kms_providers_definition);
 
-    memcpy(&ctx->kms_providers, &ctx->crypt->opts.kms_providers, sizeof(_mongocrypt_opts_kms_providers_t));
-    _mongocrypt_opts_merge_kms_providers(&ctx->kms_providers, &ctx->per_ctx_kms_providers);
+    if (ctx->kb.state == KB_ADDING_DOCS && ctx->crypt->key_vault_snapshot) {
+        /* The credentials are needed to add the keys of the snapshot. */
+        _add_snapshot_keys(ctx);
+        if (ctx->kb.state != KB_ADDING_DOCS) {
+            return _mongocrypt_ctx_state_from_key_broker(ctx);
+        }
+    }
 
     ctx->state = ctx->kb.state == KB_ADDING_DOCS ? MONGOCRYPT_CTX_NEED_MONGO_KEYS : MONGOCRYPT_CTX_NEED_KMS;
     if (ctx->vtable.after_kms_credentials_provided) {
@@ -577,9 +1219,12 @@ bool mongocrypt_ctx_kms_done(mongocrypt_ctx_t *ctx) {
     if (!ctx) {
         return false;
     }
+    _mongocrypt_ctx_record(ctx, "ctx_kms_done", NULL);
     if (!ctx->initialized) {
         return _mongocrypt_ctx_fail_w_msg(ctx, "ctx NULL or uninitialized");
     }
+    _ctx_check_deadline(ctx);
+    _ctx_observe_state(ctx);
 
     if (!ctx->vtable.kms_done) {
         return _mongocrypt_ctx_fail_w_msg(ctx, "not applicable to context");
@@ -594,6 +1239,7 @@ bool mongocrypt_ctx_kms_done(mongocrypt_ctx_t *ctx) {
     case MONGOCRYPT_CTX_NEED_MONGO_COLLINFO:
     case MONGOCRYPT_CTX_NEED_MONGO_KEYS:
     case MONGOCRYPT_CTX_NEED_MONGO_MARKINGS:
+    case MONGOCRYPT_CTX_NEED_MONGO_OPS:
     case MONGOCRYPT_CTX_READY:
     default: return _mongocrypt_ctx_fail_w_msg(ctx, "wrong state");
     }
@@ -603,9 +1249,12 @@ bool mongocrypt_ctx_finalize(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
     if (!ctx) {
         return false;
     }
+    _mongocrypt_ctx_record(ctx, "ctx_finalize", NULL);
     if (!ctx->initialized) {
         return _mongocrypt_ctx_fail_w_msg(ctx, "ctx NULL or uninitialized");
     }
+    _ctx_check_deadline(ctx);
+    _ctx_observe_state(ctx);
 
     if (!out) {
         return _mongocrypt_ctx_fail_w_msg(ctx, "invalid NULL output");
@@ -616,7 +1265,30 @@ bool mongocrypt_ctx_finalize(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
     }
 
     switch (ctx->state) {
-    case MONGOCRYPT_CTX_READY: return ctx->vtable.finalize(ctx, out);
+    case MONGOCRYPT_CTX_READY: {
+        const char *span = ctx->type == _MONGOCRYPT_TYPE_ENCRYPT   ? "encrypt"
+                         : ctx->type == _MONGOCRYPT_TYPE_DECRYPT ? "decrypt"
+                                                                 : NULL;
+        int64_t start = bson_get_monotonic_time();
+        bool ret;
+
+        if (span && _mongocrypt_ctx_trace_enabled(ctx)) {
+            _trace_span_begin(ctx, span);
+        }
+        ret = ctx->vtable.finalize(ctx, out);
+        if (span && _mongocrypt_ctx_trace_enabled(ctx)) {
+            _trace_span_end(ctx, span, ret);
+        }
+
+        ctx->timings.finalize_us += bson_get_monotonic_time() - start;
+        /* Remember the result for mongocrypt_ctx_finalize_into. */
+        if (ret) {
+            ctx->finalized = *out;
+        } else {
+            memset(&ctx->finalized, 0, sizeof(ctx->finalized));
+        }
+        return ret;
+    }
     case MONGOCRYPT_CTX_ERROR: return false;
     case MONGOCRYPT_CTX_DONE:
     case MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS:
@@ -625,10 +1297,98 @@ bool mongocrypt_ctx_finalize(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
     case MONGOCRYPT_CTX_NEED_MONGO_COLLINFO:
     case MONGOCRYPT_CTX_NEED_MONGO_KEYS:
     case MONGOCRYPT_CTX_NEED_MONGO_MARKINGS:
+    case MONGOCRYPT_CTX_NEED_MONGO_OPS:
     default: return _mongocrypt_ctx_fail_w_msg(ctx, "wrong state");
     }
 }
 
+bool mongocrypt_ctx_finalize_into(mongocrypt_ctx_t *ctx, uint8_t *buf, uint32_t buf_len, uint32_t *len) {
+    if (!ctx) {
+        return false;
+    }
+    if (!ctx->initialized) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "ctx NULL or uninitialized");
+    }
+
+    if (!len) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "invalid NULL length");
+    }
+
+    /* Finalize once. Later calls copy the remembered result. */
+    if (ctx->state != MONGOCRYPT_CTX_DONE || !ctx->finalized.data) {
+        mongocrypt_binary_t out;
+
+        if (!mongocrypt_ctx_finalize(ctx, &out)) {
+            return false;
+        }
+    }
+
+    *len = ctx->finalized.len;
+    if (buf && buf_len >= ctx->finalized.len) {
+        memcpy(buf, ctx->finalized.data, ctx->finalized.len);
+    }
+    return true;
+}
+
+bool mongocrypt_ctx_finalize_value(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out, uint8_t *type) {
+    bson_t as_bson;
+    bson_iter_t iter;
+    /* The value of the only element of {v: <value>} starts after the document
+     * length, the type byte, and the key "v". */
+    const uint32_t value_offset = 4u + 1u + 2u;
+
+    if (!ctx) {
+        return false;
+    }
+    if (!ctx->initialized) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "ctx NULL or uninitialized");
+    }
+
+    if (!out || !type) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "invalid NULL output");
+    }
+
+    if (!ctx->raw_value) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "context was not initialized with a raw value");
+    }
+
+    /* Finalize once. Later calls unwrap the remembered result. */
+    if (ctx->state != MONGOCRYPT_CTX_DONE || !ctx->finalized.data) {
+        mongocrypt_binary_t doc;
+
+        if (!mongocrypt_ctx_finalize(ctx, &doc)) {
+            return false;
+        }
+    }
+
+    if (!_mongocrypt_binary_to_bson(&ctx->finalized, &as_bson) || !bson_iter_init(&iter, &as_bson)
+        || !bson_iter_next(&iter) || 0 != strcmp(bson_iter_key(&iter), "v")) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "unexpected result, expected {v: <value>}");
+    }
+    *type = (uint8_t)bson_iter_type(&iter);
+
+    if (ctx->type == _MONGOCRYPT_TYPE_ENCRYPT) {
+        bson_subtype_t subtype;
+        const uint8_t *data;
+        uint32_t len;
+
+        if (!BSON_ITER_HOLDS_BINARY(&iter)) {
+            return _mongocrypt_ctx_fail_w_msg(ctx, "unexpected result, expected a ciphertext");
+        }
+        bson_iter_binary(&iter, &subtype, &len, &data);
+        if (subtype != BSON_SUBTYPE_ENCRYPTED) {
+            return _mongocrypt_ctx_fail_w_msg(ctx, "unexpected result, expected a ciphertext");
+        }
+        out->data = (uint8_t *)data;
+        out->len = len;
+        return true;
+    }
+
+    out->data = (uint8_t *)ctx->finalized.data + value_offset;
+    out->len = ctx->finalized.len - value_offset - 1u;
+    return true;
+}
+
 bool mongocrypt_ctx_status(mongocrypt_ctx_t *ctx, mongocrypt_status_t *out) {
     if (!ctx) {
         return false;
@@ -646,11 +1406,63 @@ bool mongocrypt_ctx_status(mongocrypt_ctx_t *ctx, mongocrypt_status_t *out) {
     return true;
 }
 
-void mongocrypt_ctx_destroy(mongocrypt_ctx_t *ctx) {
+bool mongocrypt_ctx_get_timings(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out) {
+    static const struct {
+        const char *name;
+        mongocrypt_ctx_state_t state;
+    } timed_states[] = {{"needMongoCollinfo", MONGOCRYPT_CTX_NEED_MONGO_COLLINFO},
+                        {"needMongoCollinfoWithDb", MONGOCRYPT_CTX_NEED_MONGO_COLLINFO_WITH_DB},
+                        {"needMongoMarkings", MONGOCRYPT_CTX_NEED_MONGO_MARKINGS},
+                        {"needMongoKeys", MONGOCRYPT_CTX_NEED_MONGO_KEYS},
+                        {"needMongoOps", MONGOCRYPT_CTX_NEED_MONGO_OPS},
+                        {"needKmsCredentials", MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS},
+                        {"needKms", MONGOCRYPT_CTX_NEED_KMS},
+                        {"ready", MONGOCRYPT_CTX_READY}};
+    bson_t bson;
+
     if (!ctx) {
-        return;
+        return false;
+    }
+    if (!ctx->initialized) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "ctx NULL or uninitialized");
+    }
+
+    if (!out) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "invalid NULL output");
+    }
+
+    _ctx_observe_state(ctx);
+
+    bson_init(&bson);
+    BSON_ASSERT(BSON_APPEND_INT64(&bson, "init", ctx->timings.init_us));
+    for (size_t i = 0; i < sizeof(timed_states) / sizeof(timed_states[0]); i++) {
+        BSON_ASSERT(BSON_APPEND_INT64(&bson, timed_states[i].name, ctx->timings.state_us[timed_states[i].state]));
+    }
+    BSON_ASSERT(BSON_APPEND_INT64(&bson, "finalize", ctx->timings.finalize_us));
+
+    _mongocrypt_buffer_cleanup(&ctx->timings.bson);
+    _mongocrypt_buffer_steal_from_bson(&ctx->timings.bson, &bson);
+    _mongocrypt_buffer_to_binary(&ctx->timings.bson, out);
+    return true;
+}
+
+/* _ctx_cleanup frees everything owned by @ctx except its status. */
+static void _ctx_cleanup(mongocrypt_ctx_t *ctx) {
+    const char *open_span;
+
+    BSON_ASSERT_PARAM(ctx);
+
+    /* End the span of the last observed state. It ended normally if the
+     * context has since moved on without error. */
+    open_span = _state_span(ctx->timings.timed_state);
+    if (open_span && _mongocrypt_ctx_trace_enabled(ctx)) {
+        _trace_span_end(ctx,
+                        open_span,
+                        (int)ctx->state != ctx->timings.timed_state && ctx->state != MONGOCRYPT_CTX_ERROR);
     }
 
+    _record_report(ctx);
+
     if (ctx->vtable.cleanup) {
         ctx->vtable.cleanup(ctx);
     }
@@ -658,13 +1470,50 @@ void mongocrypt_ctx_destroy(mongocrypt_ctx_t *ctx) {
     mc_RangeOpts_cleanup(&ctx->opts.rangeopts.value);
     _mongocrypt_opts_kms_providers_cleanup(&ctx->per_ctx_kms_providers);
     _mongocrypt_kek_cleanup(&ctx->opts.kek);
-    mongocrypt_status_destroy(ctx->status);
     _mongocrypt_key_broker_cleanup(&ctx->kb);
     _mongocrypt_buffer_cleanup(&ctx->opts.key_material);
     _mongocrypt_key_alt_name_destroy_all(ctx->opts.key_alt_names);
     _mongocrypt_buffer_cleanup(&ctx->opts.key_id);
     _mongocrypt_buffer_cleanup(&ctx->opts.index_key_id);
-    bson_free(ctx);
+    _mongocrypt_buffer_cleanup(&ctx->opts.decrypt_paths);
+    _mongocrypt_ctx_clear_mongo_ops(ctx);
+    for (uint32_t i = 0; i < ctx->prefetched_keys_len; i++) {
+        _mongocrypt_buffer_cleanup(&ctx->prefetched_keys[i]);
+    }
+    bson_free(ctx->prefetched_keys);
+    _mongocrypt_buffer_cleanup(&ctx->timings.bson);
+}
+
+bool mongocrypt_ctx_reset(mongocrypt_ctx_t *ctx) {
+    mongocrypt_t *crypt;
+    mongocrypt_status_t *status;
+
+    if (!ctx) {
+        return false;
+    }
+
+    crypt = ctx->crypt;
+    status = ctx->status;
+    _ctx_cleanup(ctx);
+
+    /* Keep the allocations of the context and its status. */
+    memset(ctx, 0, _ctx_size());
+    ctx->crypt = crypt;
+    ctx->status = status;
+    _mongocrypt_status_reset(ctx->status);
+    ctx->opts.algorithm = MONGOCRYPT_ENCRYPTION_ALGORITHM_NONE;
+    ctx->state = MONGOCRYPT_CTX_DONE;
+    return true;
+}
+
+void mongocrypt_ctx_destroy(mongocrypt_ctx_t *ctx) {
+    if (!ctx) {
+        return;
+    }
+
+    _ctx_cleanup(ctx);
+    mongocrypt_status_destroy(ctx->status);
+    _mongocrypt_free(ctx->crypt, ctx, _ctx_size());
     return;
 }
 
@@ -776,6 +1625,8 @@ bool _mongocrypt_ctx_init(mongocrypt_ctx_t *ctx, _mongocrypt_ctx_opts_spec_t *op
         return _mongocrypt_ctx_fail_w_msg(ctx, "cannot double initialize");
     }
     ctx->initialized = true;
+    ctx->timings.timed_state = -1;
+    ctx->timings.state_entered_us = bson_get_monotonic_time();
 
     if (ctx->state == MONGOCRYPT_CTX_ERROR) {
         return false;
@@ -871,10 +1722,37 @@ bool _mongocrypt_ctx_init(mongocrypt_ctx_t *ctx, _mongocrypt_ctx_opts_spec_t *op
         return _mongocrypt_ctx_fail_w_msg(ctx, "range opts are prohibited on this context");
     }
 
+    if (opts_spec->decrypt_paths == OPT_PROHIBITED && !_mongocrypt_buffer_empty(&ctx->opts.decrypt_paths)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "decrypt paths are prohibited on this context");
+    }
+
+    if (opts_spec->decrypt_plan == OPT_PROHIBITED && ctx->opts.decrypt_plan) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "decrypt plan is prohibited on this context");
+    }
+
     _mongocrypt_key_broker_init(&ctx->kb, ctx->crypt);
     return true;
 }
 
+/* _add_prefetched_keys adds the key documents of key operations that are
+ * requested by the key broker. If that satisfies every request, the
+ * MONGOCRYPT_CTX_NEED_MONGO_KEYS state is skipped. Errors are left in the key
+ * broker. */
+static void _add_prefetched_keys(mongocrypt_ctx_t *ctx) {
+    BSON_ASSERT_PARAM(ctx);
+
+    for (uint32_t i = 0; i < ctx->prefetched_keys_len; i++) {
+        if (!_mongocrypt_key_broker_add_prefetched_doc(&ctx->kb,
+                                                       _mongocrypt_ctx_kms_providers(ctx),
+                                                       &ctx->prefetched_keys[i])) {
+            return;
+        }
+    }
+    if (ctx->kb.num_unsatisfied == 0) {
+        (void)_mongocrypt_key_broker_docs_done(&ctx->kb);
+    }
+}
+
 bool _mongocrypt_ctx_state_from_key_broker(mongocrypt_ctx_t *ctx) {
     _mongocrypt_key_broker_t *kb;
     mongocrypt_status_t *status;
@@ -890,6 +1768,19 @@ bool _mongocrypt_ctx_state_from_key_broker(mongocrypt_ctx_t *ctx) {
         return false;
     }
 
+    /* Credentials cached from an earlier context skip the
+     * MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS state. */
+    const bool needs_credentials =
+        kb->state == KB_ADDING_DOCS && _mongocrypt_needs_credentials(ctx->crypt) && !_use_cached_kms_credentials(ctx);
+
+    if (kb->state == KB_ADDING_DOCS && ctx->prefetched_keys_len > 0 && !needs_credentials) {
+        _add_prefetched_keys(ctx);
+    }
+
+    if (kb->state == KB_ADDING_DOCS && ctx->crypt->key_vault_snapshot && !needs_credentials) {
+        _add_snapshot_keys(ctx);
+    }
+
     switch (kb->state) {
     case KB_ERROR:
         _mongocrypt_status_copy_to(kb->status, status);
@@ -899,7 +1790,7 @@ bool _mongocrypt_ctx_state_from_key_broker(mongocrypt_ctx_t *ctx) {
     case KB_ADDING_DOCS:
         /* Encrypted keys need KMS, which need to be provided before
          * adding docs. */
-        if (_mongocrypt_needs_credentials(ctx->crypt)) {
+        if (needs_credentials) {
             new_state = MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS;
         } else {
             /* Require key documents from driver. */
@@ -981,6 +1872,7 @@ bool mongocrypt_ctx_setopt_key_encryption_key(mongocrypt_ctx_t *ctx, mongocrypt_
     if (!ctx) {
         return false;
     }
+    _mongocrypt_ctx_record_binary(ctx, "ctx_setopt_key_encryption_key", bin);
 
     if (ctx->initialized) {
         return _mongocrypt_ctx_fail_w_msg(ctx, "cannot set options after init");
@@ -1025,16 +1917,195 @@ bool mongocrypt_ctx_setopt_contention_factor(mongocrypt_ctx_t *ctx, int64_t cont
     if (!ctx) {
         return false;
     }
+    if (_mongocrypt_ctx_record_enabled(ctx)) {
+        bson_t args = BSON_INITIALIZER;
+
+        BSON_ASSERT(BSON_APPEND_INT64(&args, "data", contention_factor));
+        _mongocrypt_ctx_record(ctx, "ctx_setopt_contention_factor", &args);
+        bson_destroy(&args);
+    }
     ctx->opts.contention_factor.value = contention_factor;
     ctx->opts.contention_factor.set = true;
     return true;
 }
 
+bool mongocrypt_ctx_setopt_borrow_input(mongocrypt_ctx_t *ctx) {
+    if (!ctx) {
+        return false;
+    }
+    _mongocrypt_ctx_record(ctx, "ctx_setopt_borrow_input", NULL);
+
+    if (ctx->initialized) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "cannot set options after init");
+    }
+
+    if (ctx->state == MONGOCRYPT_CTX_ERROR) {
+        return false;
+    }
+
+    ctx->opts.borrow_input = true;
+    return true;
+}
+
+bool mongocrypt_ctx_setopt_rewrap_skip_unchanged(mongocrypt_ctx_t *ctx) {
+    if (!ctx) {
+        return false;
+    }
+    _mongocrypt_ctx_record(ctx, "ctx_setopt_rewrap_skip_unchanged", NULL);
+
+    if (ctx->initialized) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "cannot set options after init");
+    }
+
+    if (ctx->state == MONGOCRYPT_CTX_ERROR) {
+        return false;
+    }
+
+    ctx->opts.rewrap_skip_unchanged = true;
+    return true;
+}
+
+bool mongocrypt_ctx_setopt_deadline(mongocrypt_ctx_t *ctx, int64_t timeout_ms) {
+    int64_t now;
+
+    if (!ctx) {
+        return false;
+    }
+    if (_mongocrypt_ctx_record_enabled(ctx)) {
+        bson_t args = BSON_INITIALIZER;
+
+        BSON_ASSERT(BSON_APPEND_INT64(&args, "data", timeout_ms));
+        _mongocrypt_ctx_record(ctx, "ctx_setopt_deadline", &args);
+        bson_destroy(&args);
+    }
+
+    if (ctx->initialized) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "cannot set options after init");
+    }
+
+    if (ctx->state == MONGOCRYPT_CTX_ERROR) {
+        return false;
+    }
+
+    now = bson_get_monotonic_time();
+    if (timeout_ms <= 0 || timeout_ms > (INT64_MAX - now) / 1000) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "invalid deadline, expected a positive number of milliseconds");
+    }
+
+    ctx->deadline_us = now + timeout_ms * 1000;
+    return true;
+}
+
+int64_t mongocrypt_ctx_remaining_us(mongocrypt_ctx_t *ctx) {
+    int64_t remaining;
+
+    if (!ctx || ctx->deadline_us == 0) {
+        return -1;
+    }
+    remaining = ctx->deadline_us - bson_get_monotonic_time();
+    return remaining > 0 ? remaining : 0;
+}
+
+bool mongocrypt_ctx_setopt_decrypt_paths(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *paths) {
+    bson_t as_bson;
+    bson_iter_t iter;
+    bson_iter_t array_iter;
+    uint32_t array_len;
+    const uint8_t *array_data;
+
+    if (!ctx) {
+        return false;
+    }
+    _mongocrypt_ctx_record_binary(ctx, "ctx_setopt_decrypt_paths", paths);
+
+    if (ctx->initialized) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "cannot set options after init");
+    }
+
+    if (ctx->state == MONGOCRYPT_CTX_ERROR) {
+        return false;
+    }
+
+    if (!_mongocrypt_buffer_empty(&ctx->opts.decrypt_paths)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "decrypt paths already set");
+    }
+
+    if (!paths || !paths->data) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "option must be non-NULL");
+    }
+
+    if (!_mongocrypt_binary_to_bson(paths, &as_bson)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "invalid decrypt paths bson object");
+    }
+
+    if (!bson_iter_init(&iter, &as_bson) || !bson_iter_next(&iter)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "invalid bson");
+    }
+
+    if (0 != strcmp(bson_iter_key(&iter), "paths")) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "decrypt paths must have field 'paths'");
+    }
+
+    if (!BSON_ITER_HOLDS_ARRAY(&iter) || !bson_iter_recurse(&iter, &array_iter)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "'paths' must be an array");
+    }
+
+    while (bson_iter_next(&array_iter)) {
+        uint32_t len;
+        const char *path;
+
+        if (!BSON_ITER_HOLDS_UTF8(&array_iter)) {
+            return _mongocrypt_ctx_fail_w_msg(ctx, "'paths' must only contain strings");
+        }
+        /* Each dot separates two non-empty field names. */
+        path = bson_iter_utf8(&array_iter, &len);
+        if (len == 0 || strlen(path) != len || path[0] == '.' || path[len - 1u] == '.' || strstr(path, "..")) {
+            mongocrypt_status_t *status = ctx->status;
+            CLIENT_ERR("invalid decrypt path: '%s'", path);
+            return _mongocrypt_ctx_fail(ctx);
+        }
+    }
+
+    if (bson_iter_next(&iter)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "unrecognized field, only paths expected");
+    }
+
+    BSON_ASSERT(bson_iter_init_find(&iter, &as_bson, "paths"));
+    bson_iter_array(&iter, &array_len, &array_data);
+    if (!_mongocrypt_buffer_copy_from_data_and_size(&ctx->opts.decrypt_paths, array_data, array_len)) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "failed to copy decrypt paths");
+    }
+    return true;
+}
+
+bool mongocrypt_ctx_setopt_decrypt_plan(mongocrypt_ctx_t *ctx, mongocrypt_decrypt_plan_t *plan) {
+    if (!ctx) {
+        return false;
+    }
+    _mongocrypt_ctx_record(ctx, "ctx_setopt_decrypt_plan", NULL);
+
+    if (ctx->initialized) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "cannot set options after init");
+    }
+
+    if (ctx->state == MONGOCRYPT_CTX_ERROR) {
+        return false;
+    }
+
+    if (!plan) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "option must be non-NULL");
+    }
+
+    ctx->opts.decrypt_plan = plan;
+    return true;
+}
+
 bool mongocrypt_ctx_setopt_index_key_id(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *key_id) {
     if (!ctx) {
         return false;
     }
 
+    _mongocrypt_ctx_record_binary(ctx, "ctx_setopt_index_key_id", key_id);
     return _set_binary_opt(ctx, key_id, &ctx->opts.index_key_id, BSON_SUBTYPE_UUID);
 }
 
@@ -1057,6 +2128,13 @@ bool mongocrypt_ctx_setopt_query_type(mongocrypt_ctx_t *ctx, const char *query_t
     }
 
     const size_t calc_len = len == -1 ? strlen(query_type) : (size_t)len;
+    if (_mongocrypt_ctx_record_enabled(ctx) && calc_len <= INT_MAX) {
+        bson_t args = BSON_INITIALIZER;
+
+        BSON_ASSERT(bson_append_utf8(&args, "data", -1, query_type, (int)calc_len));
+        _mongocrypt_ctx_record(ctx, "ctx_setopt_query_type", &args);
+        bson_destroy(&args);
+    }
     mstr_view qt_str = mstrv_view_data(query_type, calc_len);
     if (mstr_eq_ignore_case(qt_str, mstrv_lit(MONGOCRYPT_QUERY_TYPE_EQUALITY_STR))) {
         ctx->opts.query_type.value = MONGOCRYPT_QUERY_TYPE_EQUALITY;
@@ -1102,12 +2180,44 @@ const char *_mongocrypt_query_type_to_string(mongocrypt_query_type_t val) {
     }
 }
 
+/* Parses @in into @ro, using the range options cache of @crypt if it is
+ * enabled. */
+static bool _parse_range_opts(mongocrypt_t *crypt, const bson_t *in, mc_RangeOpts_t *ro, mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(crypt);
+    BSON_ASSERT_PARAM(in);
+    BSON_ASSERT_PARAM(ro);
+
+    if (crypt->opts.range_opts_cache_max_entries == 0) {
+        return mc_RangeOpts_parse(ro, in, crypt->opts.use_range_v2, status);
+    }
+
+    _mongocrypt_buffer_t attr;
+    mc_RangeOpts_t *cached = NULL;
+    _mongocrypt_buffer_from_bson(&attr, in);
+    if (!_mongocrypt_cache_get(&crypt->cache_range_opts, &attr, (void **)&cached)) {
+        CLIENT_ERR("failed to retrieve from range options cache");
+        return false;
+    }
+    if (cached) {
+        // Take ownership of the copy returned by the cache.
+        *ro = *cached;
+        bson_free(cached);
+        return true;
+    }
+
+    if (!mc_RangeOpts_parse(ro, in, crypt->opts.use_range_v2, status)) {
+        return false;
+    }
+    return _mongocrypt_cache_add_copy(&crypt->cache_range_opts, &attr, ro, status);
+}
+
 bool mongocrypt_ctx_setopt_algorithm_range(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *opts) {
     bson_t as_bson;
 
     if (!ctx) {
         return false;
     }
+    _mongocrypt_ctx_record_binary(ctx, "ctx_setopt_algorithm_range", opts);
 
     if (ctx->initialized) {
         return _mongocrypt_ctx_fail_w_msg(ctx, "cannot set options after init");
@@ -1125,7 +2235,7 @@ bool mongocrypt_ctx_setopt_algorithm_range(mongocrypt_ctx_t *ctx, mongocrypt_bin
         return _mongocrypt_ctx_fail_w_msg(ctx, "invalid BSON");
     }
 
-    if (!mc_RangeOpts_parse(&ctx->opts.rangeopts.value, &as_bson, ctx->crypt->opts.use_range_v2, ctx->status)) {
+    if (!_parse_range_opts(ctx->crypt, &as_bson, &ctx->opts.rangeopts.value, ctx->status)) {
         return _mongocrypt_ctx_fail(ctx);
     }
 
@@ -0,0 +1,44 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef MONGOCRYPT_FORK_PRIVATE_H
+#define MONGOCRYPT_FORK_PRIVATE_H
+
+#include "mongocrypt.h"
+
+/* Tracks the live mongocrypt_t handles of the process. On POSIX, the first
+ * registration installs a pthread_atfork child handler. In a child, it
+ * reinitializes the locks of every handle and of the process-wide state, drops
+ * the KMS decrypts and token requests that were in flight in threads of the
+ * parent, and discards buffered random bytes. Cached keys, collinfo and tokens
+ * are kept, so a child of a warmed process starts with warm caches.
+ *
+ * The child handler cannot repair data another thread of the parent was
+ * modifying when it forked. Fork while no other thread uses the handles. */
+void _mongocrypt_fork_register(mongocrypt_t *crypt);
+
+void _mongocrypt_fork_unregister(mongocrypt_t *crypt);
+
+#ifndef _WIN32
+/* Called by the child handler for each registered handle. */
+void _mongocrypt_atfork_child(mongocrypt_t *crypt);
+
+/* Called by the child handler for the state of the crypt_shared library. */
+void _mongocrypt_csfle_atfork_child(void);
+#endif
+
+#endif /* MONGOCRYPT_FORK_PRIVATE_H */
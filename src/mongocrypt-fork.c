@@ -0,0 +1,99 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "mongocrypt-fork-private.h"
+
+#ifndef _WIN32
+
+#include "mlib/thread.h"
+
+#include "mc-array-private.h"
+#include "mongocrypt-cache-domain-private.h"
+#include "mongocrypt-crypto-private.h"
+#include "mongocrypt-mutex-private.h"
+#include "mongocrypt-secure-arena-private.h"
+
+#include <pthread.h>
+
+/* The live handles (mongocrypt_t *), protected by g_handles_mtx. */
+static mc_array_t g_handles;
+static mongocrypt_mutex_t g_handles_mtx;
+static mlib_once_flag g_handles_init_flag = MLIB_ONCE_INITIALIZER;
+
+/* Hold the registry across fork, so the child sees a complete list. */
+static void _atfork_prepare(void) {
+    _mongocrypt_mutex_lock(&g_handles_mtx);
+}
+
+static void _atfork_parent(void) {
+    _mongocrypt_mutex_unlock(&g_handles_mtx);
+}
+
+/* The child has one thread. Locks held by other threads of the parent are
+ * never released, so every lock is reinitialized before it can be used. */
+static void _atfork_child(void) {
+    _mongocrypt_mutex_init(&g_handles_mtx);
+    _native_crypto_atfork_child();
+    _mongocrypt_csfle_atfork_child();
+    _mongocrypt_cache_domain_atfork_child();
+    _mongocrypt_secure_arena_atfork_child();
+    for (size_t i = 0; i < g_handles.len; i++) {
+        _mongocrypt_atfork_child(_mc_array_index(&g_handles, mongocrypt_t *, i));
+    }
+}
+
+static void _init_handles(void) {
+    _mongocrypt_mutex_init(&g_handles_mtx);
+    _mc_array_init(&g_handles, sizeof(mongocrypt_t *));
+    BSON_ASSERT(0 == pthread_atfork(_atfork_prepare, _atfork_parent, _atfork_child));
+}
+
+void _mongocrypt_fork_register(mongocrypt_t *crypt) {
+    BSON_ASSERT_PARAM(crypt);
+
+    mlib_call_once(&g_handles_init_flag, _init_handles);
+    _mongocrypt_mutex_lock(&g_handles_mtx);
+    _mc_array_append_val(&g_handles, crypt);
+    _mongocrypt_mutex_unlock(&g_handles_mtx);
+}
+
+void _mongocrypt_fork_unregister(mongocrypt_t *crypt) {
+    BSON_ASSERT_PARAM(crypt);
+
+    _mongocrypt_mutex_lock(&g_handles_mtx);
+    for (size_t i = 0; i < g_handles.len; i++) {
+        if (_mc_array_index(&g_handles, mongocrypt_t *, i) == crypt) {
+            g_handles.len--;
+            _mc_array_index(&g_handles, mongocrypt_t *, i) = _mc_array_index(&g_handles, mongocrypt_t *, g_handles.len);
+            break;
+        }
+    }
+    _mongocrypt_mutex_unlock(&g_handles_mtx);
+}
+
+#else
+
+/* Windows has no fork. */
+void _mongocrypt_fork_register(mongocrypt_t *crypt) {
+    BSON_ASSERT_PARAM(crypt);
+}
+
+void _mongocrypt_fork_unregister(mongocrypt_t *crypt) {
+    BSON_ASSERT_PARAM(crypt);
+}
+
+#endif /* _WIN32 */
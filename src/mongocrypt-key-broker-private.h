@@ -20,6 +20,7 @@
 #include <bson/bson.h>
 
 #include "kms_message/kms_message.h"
+#include "mc-arena-private.h"
 #include "mongocrypt-binary-private.h"
 #include "mongocrypt-cache-key-private.h"
 #include "mongocrypt-cache-private.h"
@@ -71,6 +72,12 @@ typedef struct _key_request_t {
     _mongocrypt_buffer_t id;
     _mongocrypt_key_alt_name_t *alt_name;
     bool satisfied; /* true if satisfied by a cache entry or a key returned. */
+    /* An optional request is a prefetch: it is fetched with the required
+     * requests, but it is not an error if no key matches it. It becomes
+     * required if the key is later requested with
+     * _mongocrypt_key_broker_request_id. */
+    bool optional;
+    bool fetched; /* true once an optional request was included in a filter. */
     struct _key_request_t *next;
 } key_request_t;
 
@@ -78,21 +85,75 @@ typedef struct _key_request_t {
 typedef struct _key_returned_t {
     _mongocrypt_key_doc_t *doc;
     _mongocrypt_buffer_t decrypted_key_material;
+    /* Set for keys from the cache, or once a key is stored to the cache. @doc
+     * and @decrypted_key_material are then borrowed from the shared cache value
+     * and must not be modified. */
+    _mongocrypt_cache_key_value_t *cache_value;
 
     mongocrypt_kms_ctx_t kms;
     bool decrypted;
+    /* With parallel_key_unwrap_threshold: the key is encrypted with a local
+     * KEK and is unwrapped by _mongocrypt_key_broker_docs_done. */
+    bool unwrap_deferred;
 
     bool needs_auth;
 
+    /* With coalesce_kms_decrypts: this key broker is the one decrypting the
+     * key with a KMS. */
+    bool kms_owner;
+    /* With coalesce_kms_decrypts: another key broker is decrypting the key.
+     * No KMS request is issued for it. */
+    bool kms_deferred;
+    /* The decrypted key was stored to, or taken from, the key cache. */
+    bool cached;
+
+    /* With batch_kmip_requests: the key whose KMS request gets this key, at
+     * item kmip_batch_index. No KMS request is issued for this key. */
+    struct _key_returned_t *kmip_batch_leader;
+    size_t kmip_batch_index;
+
+    /* With kmip_kek_cache_expiration_ms: the KMIP KEK cache key of the KEK
+     * this key's KMIP Get retrieves. Empty otherwise. */
+    _mongocrypt_buffer_t kmip_kek_cache_key;
+
+    /* With kms_hedge_endpoints: a second request for the key to an alternate
+     * endpoint, created once @kms waits too long. hedge_tried is set once it
+     * was attempted, and hedged once hedge_kms is initialized. hedge_winner is
+     * the hedge_winner of @kms and hedge_kms. */
+    mongocrypt_kms_ctx_t hedge_kms;
+    bool hedged;
+    bool hedge_tried;
+    volatile int32_t hedge_winner;
+
     struct _key_returned_t *next;
 } key_returned_t;
 
+/* A slot of a key broker hash index. An item is indexed once for its id and
+ * once for each keyAltName. */
+typedef struct {
+    uint32_t hash;
+    void *item; /* NULL for an empty slot. */
+} key_index_slot_t;
+
+/* An open-addressing hash index of key requests or keys returned. Items are
+ * never removed; they live as long as the key broker. */
+typedef struct {
+    key_index_slot_t *slots;
+    size_t slots_len;  /* 0 or a power of two. */
+    size_t slots_used; /* at most half of slots_len. */
+} key_index_t;
+
 typedef struct _mc_mapof_kmsid_to_authrequest_t mc_mapof_kmsid_to_authrequest_t;
 
 typedef struct {
     key_broker_state_t state;
     mongocrypt_status_t *status;
+    /* coalesce_kms_decrypts is set by mongocrypt_setopt_coalesce_kms_decrypts,
+     * or for the contexts of a mongocrypt_ctx_group_t. */
+    bool coalesce_kms_decrypts;
     key_request_t *key_requests;
+    key_index_t key_requests_index;
+    size_t num_unsatisfied; /* number of required key_requests not yet satisfied. */
     /* Keep keys returned from driver separate from keys returned from cache.
      * Keys returned from driver MUST not have conflicts (e.g. intersecting key
      * alt names)
@@ -101,11 +162,23 @@ typedef struct {
      */
     key_returned_t *keys_returned;
     key_returned_t *keys_cached;
+    key_index_t keys_returned_index;
+    key_index_t keys_cached_index;
     _mongocrypt_buffer_t filter;
+    _mongocrypt_buffer_t projection;
+    /* accepts_projected is set once the projection was returned. Key
+     * documents are then parsed with _mongocrypt_key_parse_projected_owned. */
+    bool accepts_projected;
     mongocrypt_t *crypt;
+    /* The KMS providers of the last added key document. Used to create hedged
+     * requests. */
+    _mongocrypt_opts_kms_providers_t *kms_providers;
 
     key_returned_t *decryptor_iter;
     mc_mapof_kmsid_to_authrequest_t *auth_requests;
+    /* Key requests and keys returned are allocated in arena. They live as long
+     * as the key broker, which lives as long as its context. */
+    mc_arena_t arena;
 } _mongocrypt_key_broker_t;
 
 void _mongocrypt_key_broker_init(_mongocrypt_key_broker_t *kb, mongocrypt_t *crypt);
@@ -114,6 +187,12 @@ void _mongocrypt_key_broker_init(_mongocrypt_key_broker_t *kb, mongocrypt_t *cry
 bool _mongocrypt_key_broker_request_id(_mongocrypt_key_broker_t *kb,
                                        const _mongocrypt_buffer_t *key_id) MONGOCRYPT_WARN_UNUSED_RESULT;
 
+/* Add an optional request for a key by UUID. The key is fetched along with
+ * the other requested keys if it is not cached, but the key broker does not
+ * fail if it is not found. */
+bool _mongocrypt_key_broker_request_id_optional(_mongocrypt_key_broker_t *kb,
+                                                const _mongocrypt_buffer_t *key_id) MONGOCRYPT_WARN_UNUSED_RESULT;
+
 /* Add keyAltName into the key broker.
    Key is added as KEY_EMPTY. */
 bool _mongocrypt_key_broker_request_name(_mongocrypt_key_broker_t *kb,
@@ -128,11 +207,22 @@ bool _mongocrypt_key_broker_requests_done(_mongocrypt_key_broker_t *kb);
 bool _mongocrypt_key_broker_filter(_mongocrypt_key_broker_t *kb,
                                    mongocrypt_binary_t *out) MONGOCRYPT_WARN_UNUSED_RESULT;
 
+/* Get the find command projection of the fields used from key documents.
+ * Key documents added after are accepted without the other fields. */
+void _mongocrypt_key_broker_projection(_mongocrypt_key_broker_t *kb, mongocrypt_binary_t *out);
+
 /* Add a key document. */
 bool _mongocrypt_key_broker_add_doc(_mongocrypt_key_broker_t *kb,
                                     _mongocrypt_opts_kms_providers_t *kms_providers,
                                     const _mongocrypt_buffer_t *doc) MONGOCRYPT_WARN_UNUSED_RESULT;
 
+/* Add a key document fetched before it was requested. Unlike
+ * _mongocrypt_key_broker_add_doc, a document that does not match an
+ * unsatisfied request is ignored. */
+bool _mongocrypt_key_broker_add_prefetched_doc(_mongocrypt_key_broker_t *kb,
+                                               _mongocrypt_opts_kms_providers_t *kms_providers,
+                                               const _mongocrypt_buffer_t *doc) MONGOCRYPT_WARN_UNUSED_RESULT;
+
 bool _mongocrypt_key_broker_docs_done(_mongocrypt_key_broker_t *kb);
 
 /* Iterate the keys needing KMS decryption. */
@@ -147,6 +237,17 @@ bool _mongocrypt_key_broker_decrypted_key_by_id(_mongocrypt_key_broker_t *kb,
                                                 const _mongocrypt_buffer_t *key_id,
                                                 _mongocrypt_buffer_t *out) MONGOCRYPT_WARN_UNUSED_RESULT;
 
+/* Get the Queryable Encryption tokens derived from a key when it was cached by
+ * looking up with a key_id. Returns NULL if the key or its tokens are not
+ * available. The tokens are valid until @kb is cleaned up. */
+const _mongocrypt_cache_key_tokens_t *_mongocrypt_key_broker_key_tokens_by_id(_mongocrypt_key_broker_t *kb,
+                                                                           const _mongocrypt_buffer_t *key_id);
+
+/* Returns true if the decrypted key material of the key with @key_id is
+ * available, e.g. from the cache while still requesting keys. Unlike
+ * _mongocrypt_key_broker_decrypted_key_by_id, this does not fail @kb. */
+bool _mongocrypt_key_broker_has_decrypted_key_by_id(_mongocrypt_key_broker_t *kb, const _mongocrypt_buffer_t *key_id);
+
 /* Get the final decrypted key material from a key, and optionally its key_id.
  * @key_id_out may be NULL. @out and @key_id_out (if not NULL) are always
  * initialized, even on error. */
@@ -15,13 +15,27 @@
  */
 
 #include "mc-array-private.h"
+#include "mongocrypt-atomic-private.h"
+#include "mongocrypt-cache-kmip-kek-private.h"
 #include "mongocrypt-key-broker-private.h"
 #include "mongocrypt-private.h"
+#include "mongocrypt-util-private.h"
+
+/* Minimum number of slots in a non-empty key index. */
+#define KEY_INDEX_MIN_SLOTS 16
 
 typedef struct _auth_request_t {
     mongocrypt_kms_ctx_t kms;
     bool returned;
     char *kmsid;
+    /* With oauth_refresh_margin_ms: fetches a replacement for a cached token
+     * that is still valid. Keys do not wait on this request. */
+    bool refresh;
+    /* This key broker claimed the token fetch in the oauth token cache. Other
+     * key brokers wait for the token. */
+    bool claimed;
+    /* The response was applied to the oauth token cache. */
+    bool done;
 } auth_request_t;
 
 auth_request_t *auth_request_new() {
@@ -102,8 +116,176 @@ void _mongocrypt_key_broker_init(_mongocrypt_key_broker_t *kb, mongocrypt_t *cry
     memset(kb, 0, sizeof(*kb));
     kb->crypt = crypt;
     kb->state = KB_REQUESTING;
+    kb->coalesce_kms_decrypts = crypt->opts.coalesce_kms_decrypts;
     kb->status = mongocrypt_status_new();
     kb->auth_requests = mc_mapof_kmsid_to_authrequest_new();
+    mc_arena_init(&kb->arena);
+    mc_arena_set_allocator(&kb->arena, crypt->opts.malloc_fn, crypt->opts.free_fn, crypt->opts.allocator_ctx);
+}
+
+static uint32_t _hash_id(const _mongocrypt_buffer_t *id) {
+    BSON_ASSERT_PARAM(id);
+    return mc_hash_bytes(id->data, id->len);
+}
+
+static uint32_t _hash_alt_name(_mongocrypt_key_alt_name_t *key_alt_name) {
+    const char *str;
+
+    BSON_ASSERT_PARAM(key_alt_name);
+    str = _mongocrypt_key_alt_name_get_string(key_alt_name);
+    return mc_hash_bytes(str, strlen(str));
+}
+
+/* Returns true if @key_alt_name is one of the names in @list. */
+static bool _alt_name_in(_mongocrypt_key_alt_name_t *list, _mongocrypt_key_alt_name_t *key_alt_name) {
+    const char *str;
+
+    BSON_ASSERT_PARAM(key_alt_name);
+
+    str = _mongocrypt_key_alt_name_get_string(key_alt_name);
+    for (; NULL != list; list = list->next) {
+        if (0 == strcmp(_mongocrypt_key_alt_name_get_string(list), str)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void _key_index_slots_put(key_index_slot_t *slots, size_t slots_len, uint32_t hash, void *item) {
+    size_t mask;
+    size_t i;
+
+    BSON_ASSERT_PARAM(slots);
+    BSON_ASSERT_PARAM(item);
+
+    mask = slots_len - 1;
+    i = hash & mask;
+    while (slots[i].item) {
+        i = (i + 1) & mask;
+    }
+    slots[i].hash = hash;
+    slots[i].item = item;
+}
+
+/* Index @item under @hash. Duplicate hashes and items are permitted. */
+static void _key_index_put(key_index_t *index, uint32_t hash, void *item) {
+    BSON_ASSERT_PARAM(index);
+    BSON_ASSERT_PARAM(item);
+
+    BSON_ASSERT(index->slots_used < SIZE_MAX / 2);
+    if ((index->slots_used + 1) * 2 > index->slots_len) {
+        key_index_slot_t *slots;
+        size_t slots_len = index->slots_len ? index->slots_len * 2 : KEY_INDEX_MIN_SLOTS;
+
+        BSON_ASSERT(slots_len <= SIZE_MAX / sizeof(key_index_slot_t));
+        slots = bson_malloc0(slots_len * sizeof(key_index_slot_t));
+        BSON_ASSERT(slots);
+        for (size_t i = 0; i < index->slots_len; i++) {
+            if (index->slots[i].item) {
+                _key_index_slots_put(slots, slots_len, index->slots[i].hash, index->slots[i].item);
+            }
+        }
+        bson_free(index->slots);
+        index->slots = slots;
+        index->slots_len = slots_len;
+    }
+    _key_index_slots_put(index->slots, index->slots_len, hash, item);
+    index->slots_used++;
+}
+
+typedef struct {
+    const key_index_t *index;
+    uint32_t hash;
+    size_t pos;
+} key_index_iter_t;
+
+static void _key_index_iter_init(key_index_iter_t *iter, const key_index_t *index, uint32_t hash) {
+    BSON_ASSERT_PARAM(iter);
+    BSON_ASSERT_PARAM(index);
+
+    iter->index = index;
+    iter->hash = hash;
+    iter->pos = index->slots_len ? hash & (index->slots_len - 1) : 0;
+}
+
+/* Returns the next item indexed under the iterator's hash, or NULL. Items
+ * must still be checked for a match, since hashes may collide. */
+static void *_key_index_iter_next(key_index_iter_t *iter) {
+    const key_index_t *index;
+
+    BSON_ASSERT_PARAM(iter);
+
+    index = iter->index;
+    if (0 == index->slots_len) {
+        return NULL;
+    }
+    /* The index is at most half full, so an empty slot ends the probe. */
+    while (index->slots[iter->pos].item) {
+        const key_index_slot_t *slot = &index->slots[iter->pos];
+
+        iter->pos = (iter->pos + 1) & (index->slots_len - 1);
+        if (slot->hash == iter->hash) {
+            return slot->item;
+        }
+    }
+    return NULL;
+}
+
+static void _key_index_cleanup(key_index_t *index) {
+    BSON_ASSERT_PARAM(index);
+    bson_free(index->slots);
+    memset(index, 0, sizeof(*index));
+}
+
+/* Index @key_returned by its id and each of its keyAltNames. */
+static void _key_returned_index(key_index_t *index, key_returned_t *key_returned) {
+    _mongocrypt_key_alt_name_t *key_alt_name;
+
+    BSON_ASSERT_PARAM(index);
+    BSON_ASSERT_PARAM(key_returned);
+    BSON_ASSERT(key_returned->doc);
+
+    if (!_mongocrypt_buffer_empty(&key_returned->doc->id)) {
+        _key_index_put(index, _hash_id(&key_returned->doc->id), key_returned);
+    }
+    for (key_alt_name = key_returned->doc->key_alt_names; NULL != key_alt_name; key_alt_name = key_alt_name->next) {
+        _key_index_put(index, _hash_alt_name(key_alt_name), key_returned);
+    }
+}
+
+/* Prepend @req to the key requests and index it by its id and each of its
+ * keyAltNames. */
+static void _key_request_add(_mongocrypt_key_broker_t *kb, key_request_t *req) {
+    _mongocrypt_key_alt_name_t *key_alt_name;
+
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(req);
+
+    req->next = kb->key_requests;
+    kb->key_requests = req;
+    if (!req->satisfied && !req->optional) {
+        kb->num_unsatisfied++;
+    }
+
+    if (!_mongocrypt_buffer_empty(&req->id)) {
+        _key_index_put(&kb->key_requests_index, _hash_id(&req->id), req);
+    }
+    for (key_alt_name = req->alt_name; NULL != key_alt_name; key_alt_name = key_alt_name->next) {
+        _key_index_put(&kb->key_requests_index, _hash_alt_name(key_alt_name), req);
+    }
+}
+
+static void _key_request_satisfy(_mongocrypt_key_broker_t *kb, key_request_t *req) {
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(req);
+
+    if (!req->satisfied) {
+        req->satisfied = true;
+        if (!req->optional) {
+            BSON_ASSERT(kb->num_unsatisfied > 0);
+            kb->num_unsatisfied--;
+        }
+    }
 }
 
 /*
@@ -112,15 +294,18 @@ void _mongocrypt_key_broker_init(_mongocrypt_key_broker_t *kb, mongocrypt_t *cry
  * Side effects:
  * - updates *list to point to a new head.
  */
-static key_returned_t *
-_key_returned_prepend(_mongocrypt_key_broker_t *kb, key_returned_t **list, _mongocrypt_key_doc_t *key_doc) {
+static key_returned_t *_key_returned_prepend(_mongocrypt_key_broker_t *kb,
+                                             key_returned_t **list,
+                                             key_index_t *index,
+                                             _mongocrypt_key_doc_t *key_doc) {
     key_returned_t *key_returned;
 
     BSON_ASSERT_PARAM(kb);
     BSON_ASSERT_PARAM(list);
+    BSON_ASSERT_PARAM(index);
     BSON_ASSERT_PARAM(key_doc);
 
-    key_returned = bson_malloc0(sizeof(*key_returned));
+    key_returned = mc_arena_malloc0(&kb->arena, sizeof(*key_returned));
     BSON_ASSERT(key_returned);
 
     key_returned->doc = _mongocrypt_key_new();
@@ -129,32 +314,38 @@ _key_returned_prepend(_mongocrypt_key_broker_t *kb, key_returned_t **list, _mong
     /* Prepend and update the head of the list. */
     key_returned->next = *list;
     *list = key_returned;
+    _key_returned_index(index, key_returned);
 
     /* Update the head of the decrypting iter. */
     kb->decryptor_iter = kb->keys_returned;
     return key_returned;
 }
 
-/* Find the first (if any) key_returned_t matching either a key_id or a list of
- * key_alt_names (both are NULLable) */
+/* Find a key_returned_t (if any) in @index matching either a key_id or a list
+ * of key_alt_names (both are NULLable) */
 static key_returned_t *
-_key_returned_find_one(key_returned_t *list, _mongocrypt_buffer_t *key_id, _mongocrypt_key_alt_name_t *key_alt_names) {
+_key_returned_find_one(key_index_t *index, _mongocrypt_buffer_t *key_id, _mongocrypt_key_alt_name_t *key_alt_names) {
+    key_index_iter_t iter;
     key_returned_t *key_returned;
 
-    /* list can be NULL. */
+    BSON_ASSERT_PARAM(index);
     /* key_id and key_alt_names are not dereferenced in this function and they
      * are checked just before being passed on as parameters. */
 
-    for (key_returned = list; NULL != key_returned; key_returned = key_returned->next) {
-        if (key_id) {
+    if (key_id) {
+        _key_index_iter_init(&iter, index, _hash_id(key_id));
+        while ((key_returned = _key_index_iter_next(&iter))) {
             BSON_ASSERT(key_returned->doc);
             if (0 == _mongocrypt_buffer_cmp(key_id, &key_returned->doc->id)) {
                 return key_returned;
             }
         }
-        if (key_alt_names) {
+    }
+    for (; NULL != key_alt_names; key_alt_names = key_alt_names->next) {
+        _key_index_iter_init(&iter, index, _hash_alt_name(key_alt_names));
+        while ((key_returned = _key_index_iter_next(&iter))) {
             BSON_ASSERT(key_returned->doc);
-            if (_mongocrypt_key_alt_name_intersects(key_alt_names, key_returned->doc->key_alt_names)) {
+            if (_alt_name_in(key_returned->doc->key_alt_names, key_alt_names)) {
                 return key_returned;
             }
         }
@@ -163,44 +354,59 @@ _key_returned_find_one(key_returned_t *list, _mongocrypt_buffer_t *key_id, _mong
     return NULL;
 }
 
-/* Find the first (if any) key_request_t in the key broker matching either a
- * key_id or a list of key_alt_names (both are NULLable) */
-static key_request_t *_key_request_find_one(_mongocrypt_key_broker_t *kb,
-                                            const _mongocrypt_buffer_t *key_id,
-                                            _mongocrypt_key_alt_name_t *key_alt_names) {
+/* Find a key_request_t (if any) in the key broker matching either a key_id or
+ * a list of key_alt_names (both are NULLable). If @satisfy is true, mark every
+ * matching request as satisfied. */
+static key_request_t *_key_request_find(_mongocrypt_key_broker_t *kb,
+                                        const _mongocrypt_buffer_t *key_id,
+                                        _mongocrypt_key_alt_name_t *key_alt_names,
+                                        bool satisfy) {
+    key_index_iter_t iter;
     key_request_t *key_request;
+    key_request_t *found = NULL;
 
     BSON_ASSERT_PARAM(kb);
     /* key_id and key_alt_names are not dereferenced in this function and they
      * are checked just before being passed on as parameters. */
 
-    for (key_request = kb->key_requests; NULL != key_request; key_request = key_request->next) {
-        if (key_id) {
+    if (key_id && !_mongocrypt_buffer_empty(key_id)) {
+        _key_index_iter_init(&iter, &kb->key_requests_index, _hash_id(key_id));
+        while ((key_request = _key_index_iter_next(&iter))) {
             if (0 == _mongocrypt_buffer_cmp(key_id, &key_request->id)) {
-                return key_request;
+                if (!satisfy) {
+                    return key_request;
+                }
+                _key_request_satisfy(kb, key_request);
+                found = key_request;
             }
         }
-        if (key_alt_names) {
-            if (_mongocrypt_key_alt_name_intersects(key_alt_names, key_request->alt_name)) {
-                return key_request;
+    }
+    for (; NULL != key_alt_names; key_alt_names = key_alt_names->next) {
+        _key_index_iter_init(&iter, &kb->key_requests_index, _hash_alt_name(key_alt_names));
+        while ((key_request = _key_index_iter_next(&iter))) {
+            if (_alt_name_in(key_request->alt_name, key_alt_names)) {
+                if (!satisfy) {
+                    return key_request;
+                }
+                _key_request_satisfy(kb, key_request);
+                found = key_request;
             }
         }
     }
 
-    return NULL;
+    return found;
 }
 
-static bool _all_key_requests_satisfied(_mongocrypt_key_broker_t *kb) {
-    key_request_t *key_request;
+static key_request_t *_key_request_find_one(_mongocrypt_key_broker_t *kb,
+                                            const _mongocrypt_buffer_t *key_id,
+                                            _mongocrypt_key_alt_name_t *key_alt_names) {
+    return _key_request_find(kb, key_id, key_alt_names, false /* satisfy */);
+}
 
+static bool _all_key_requests_satisfied(_mongocrypt_key_broker_t *kb) {
     BSON_ASSERT_PARAM(kb);
 
-    for (key_request = kb->key_requests; NULL != key_request; key_request = key_request->next) {
-        if (!key_request->satisfied) {
-            return false;
-        }
-    }
-    return true;
+    return 0 == kb->num_unsatisfied;
 }
 
 static bool _key_broker_fail_w_msg(_mongocrypt_key_broker_t *kb, const char *msg) {
@@ -225,9 +431,105 @@ static bool _key_broker_fail(_mongocrypt_key_broker_t *kb) {
     return false;
 }
 
+/* Initial size of the buffer passed to the key_cache_load hook. Snapshots of
+ * one key are usually smaller. */
+#define SHARED_KEY_CACHE_LOAD_LEN 4096
+
+/* Imports the snapshot of @id from the shared key cache tier, if any, into
+ * the key cache. */
+static bool _load_from_shared_cache(_mongocrypt_key_broker_t *kb, _mongocrypt_buffer_t *id) {
+    _mongocrypt_opts_t *opts;
+    mongocrypt_status_t *status;
+    _mongocrypt_buffer_t snapshot;
+    uint32_t len = 0;
+    bson_t bson;
+    bool ret = false;
+
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(id);
+
+    opts = &kb->crypt->opts;
+    status = kb->status;
+    _mongocrypt_buffer_init_size(&snapshot, SHARED_KEY_CACHE_LOAD_LEN);
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (!opts->key_cache_load(opts->key_cache_shared_ctx,
+                                  _mongocrypt_buffer_as_binary(id),
+                                  _mongocrypt_buffer_as_binary(&snapshot),
+                                  &len,
+                                  status)) {
+            if (mongocrypt_status_ok(status)) {
+                CLIENT_ERR("shared key cache load failed");
+            }
+            goto done;
+        }
+        if (len <= snapshot.len) {
+            break;
+        }
+        _mongocrypt_buffer_resize(&snapshot, len);
+    }
+
+    if (len > snapshot.len) {
+        CLIENT_ERR("shared key cache load returned a longer snapshot than requested");
+        goto done;
+    }
+
+    if (len == 0) {
+        /* Not stored. */
+        ret = true;
+        goto done;
+    }
+
+    if (!bson_init_static(&bson, snapshot.data, len) || !bson_validate(&bson, BSON_VALIDATE_NONE, NULL)) {
+        CLIENT_ERR("invalid BSON snapshot from shared key cache");
+        goto done;
+    }
+    ret = _mongocrypt_cache_key_import(_mongocrypt_key_cache(kb->crypt),
+                                       kb->crypt->crypto,
+                                       &opts->key_cache_shared_kek,
+                                       &bson,
+                                       status);
+
+done:
+    _mongocrypt_buffer_cleanup(&snapshot);
+    return ret;
+}
+
+/* Stores a snapshot of @value in the shared key cache tier. */
+static bool _store_to_shared_cache(_mongocrypt_key_broker_t *kb, _mongocrypt_cache_key_value_t *value) {
+    _mongocrypt_opts_t *opts;
+    mongocrypt_status_t *status;
+    _mongocrypt_buffer_t snapshot;
+    bson_t bson = BSON_INITIALIZER;
+    bool ret;
+
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(value);
+
+    opts = &kb->crypt->opts;
+    status = kb->status;
+    if (!_mongocrypt_cache_key_export_value(value, kb->crypt->crypto, &opts->key_cache_shared_kek, &bson, status)) {
+        bson_destroy(&bson);
+        return false;
+    }
+
+    _mongocrypt_buffer_steal_from_bson(&snapshot, &bson);
+    ret = opts->key_cache_store(opts->key_cache_shared_ctx,
+                                _mongocrypt_buffer_as_binary(&value->key_doc->id),
+                                _mongocrypt_buffer_as_binary(&snapshot),
+                                status);
+    if (!ret && mongocrypt_status_ok(status)) {
+        CLIENT_ERR("shared key cache store failed");
+    }
+    _mongocrypt_buffer_cleanup(&snapshot);
+    return ret;
+}
+
 static bool _try_satisfying_from_cache(_mongocrypt_key_broker_t *kb, key_request_t *req) {
+    _mongocrypt_cache_t *cache;
     _mongocrypt_cache_key_attr_t *attr = NULL;
     _mongocrypt_cache_key_value_t *value = NULL;
+    bool use_l1;
+    bool needs_refresh = false;
     bool ret = false;
 
     BSON_ASSERT_PARAM(kb);
@@ -238,30 +540,80 @@ static bool _try_satisfying_from_cache(_mongocrypt_key_broker_t *kb, key_request
         goto cleanup;
     }
 
-    attr = _mongocrypt_cache_key_attr_new(&req->id, req->alt_name);
-    if (!_mongocrypt_cache_get(&kb->crypt->cache_key, attr, (void **)&value)) {
-        _key_broker_fail_w_msg(kb, "failed to retrieve from cache");
+    /* Keys requested by id may be found in the thread-local cache without
+     * locking the shared cache. */
+    cache = _mongocrypt_key_cache(kb->crypt);
+    use_l1 = kb->crypt->opts.key_cache_thread_local && !req->alt_name;
+    if (use_l1) {
+        value = _mongocrypt_cache_key_l1_get(cache, &req->id);
+    }
+
+    if (!value) {
+        int64_t generation;
+        int64_t valid_until_ms;
+
+        attr = _mongocrypt_cache_key_attr_new(&req->id, req->alt_name);
+        if (!_mongocrypt_cache_get_with_validity(cache,
+                                                 attr,
+                                                 (void **)&value,
+                                                 &needs_refresh,
+                                                 &generation,
+                                                 &valid_until_ms)) {
+            _key_broker_fail_w_msg(kb, "failed to retrieve from cache");
+            goto cleanup;
+        }
+        if (value && use_l1 && !needs_refresh) {
+            _mongocrypt_cache_key_l1_put(cache, &req->id, value, generation, valid_until_ms);
+        }
+    }
+
+    if (!value && !needs_refresh && kb->crypt->opts.key_cache_load && !_mongocrypt_buffer_empty(&req->id)) {
+        /* Another process may have decrypted the key. */
+        if (!_load_from_shared_cache(kb, &req->id)) {
+            _key_broker_fail(kb);
+            goto cleanup;
+        }
+        if (!_mongocrypt_cache_get(cache, attr, (void **)&value)) {
+            _key_broker_fail_w_msg(kb, "failed to retrieve from cache");
+            goto cleanup;
+        }
+    }
+
+    if (needs_refresh) {
+        /* The entry is nearing expiration. Fetch the key again in this context
+         * so the cache is refreshed, while other contexts keep using the
+         * cached value until it expires. */
+        ret = true;
         goto cleanup;
     }
 
     if (value) {
         key_returned_t *key_returned;
 
-        req->satisfied = true;
+        _key_request_satisfy(kb, req);
         if (_mongocrypt_buffer_empty(&value->decrypted_key_material)) {
             _key_broker_fail_w_msg(kb, "cache entry does not have decrypted key material");
             goto cleanup;
         }
 
-        /* Add the cached key to our locally copied list.
+        /* Add the cached key to our local list. The key borrows from the
+         * shared cache value instead of copying it.
          * Note, we deduplicate requests, but *not* keys from the cache,
          * because the state of the cache may change between each call to
          * _mongocrypt_cache_get.
          */
-        key_returned = _key_returned_prepend(kb, &kb->keys_cached, value->key_doc);
-        _mongocrypt_buffer_init(&key_returned->decrypted_key_material);
-        _mongocrypt_buffer_copy_to(&value->decrypted_key_material, &key_returned->decrypted_key_material);
+        key_returned = mc_arena_malloc0(&kb->arena, sizeof(*key_returned));
+        BSON_ASSERT(key_returned);
+        key_returned->cache_value = value;
+        key_returned->doc = value->key_doc;
+        _mongocrypt_buffer_set_to(&value->decrypted_key_material, &key_returned->decrypted_key_material);
         key_returned->decrypted = true;
+        key_returned->next = kb->keys_cached;
+        kb->keys_cached = key_returned;
+        _key_returned_index(&kb->keys_cached_index, key_returned);
+        kb->decryptor_iter = kb->keys_returned;
+        /* Ownership of the reference moved to key_returned. */
+        value = NULL;
     }
 
     ret = true;
@@ -271,9 +623,33 @@ cleanup:
     return ret;
 }
 
+/* _key_expiration returns the lifetime in the key cache of keys with the KMS
+ * provider @kmsid set with mongocrypt_setopt_key_expiration_by_kms_provider,
+ * or 0 to follow the key cache expiration. */
+static uint64_t _key_expiration(_mongocrypt_key_broker_t *kb, const char *kmsid) {
+    bson_t expirations;
+    bson_iter_t iter;
+    int64_t expiration_ms;
+
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(kmsid);
+
+    if (_mongocrypt_buffer_empty(&kb->crypt->opts.key_expiration_by_kms_provider)) {
+        return 0;
+    }
+    /* Expirations were validated by mongocrypt_setopt_key_expiration_by_kms_provider. */
+    BSON_ASSERT(_mongocrypt_buffer_to_bson(&kb->crypt->opts.key_expiration_by_kms_provider, &expirations));
+    if (!bson_iter_init_find(&iter, &expirations, kmsid)) {
+        return 0;
+    }
+    expiration_ms = bson_iter_as_int64(&iter);
+    return expiration_ms == 0 ? (uint64_t)INT64_MAX : (uint64_t)expiration_ms;
+}
+
 static bool _store_to_cache(_mongocrypt_key_broker_t *kb, key_returned_t *key_returned) {
     _mongocrypt_cache_key_value_t *value;
     _mongocrypt_cache_key_attr_t *attr;
+    uint64_t expiration_ms;
     bool ret;
 
     BSON_ASSERT_PARAM(kb);
@@ -288,15 +664,48 @@ static bool _store_to_cache(_mongocrypt_key_broker_t *kb, key_returned_t *key_re
         return _key_broker_fail_w_msg(kb, "could not create key cache attribute");
     }
     value = _mongocrypt_cache_key_value_new(key_returned->doc, &key_returned->decrypted_key_material);
-    ret = _mongocrypt_cache_add_stolen(&kb->crypt->cache_key, attr, value, kb->status);
+    if (!_mongocrypt_cache_key_value_derive_tokens(value, kb->crypt->crypto, kb->status)) {
+        _mongocrypt_cache_key_value_destroy(value);
+        _mongocrypt_cache_key_attr_destroy(attr);
+        return _key_broker_fail(kb);
+    }
+    /* Keep a reference to borrow the key and its tokens from. */
+    _mongocrypt_cache_key_value_retain(value);
+    expiration_ms = _key_expiration(kb, key_returned->doc->kek.kmsid);
+    if (expiration_ms > 0) {
+        ret = _mongocrypt_cache_add_stolen_with_expiration(_mongocrypt_key_cache(kb->crypt),
+                                                           attr,
+                                                           value,
+                                                           expiration_ms,
+                                                           kb->status);
+    } else {
+        ret = _mongocrypt_cache_add_stolen(_mongocrypt_key_cache(kb->crypt), attr, value, kb->status);
+    }
     _mongocrypt_cache_key_attr_destroy(attr);
     if (!ret) {
+        _mongocrypt_cache_key_value_destroy(value);
         return _key_broker_fail(kb);
     }
+
+    if (kb->crypt->opts.key_cache_store && !_store_to_shared_cache(kb, value)) {
+        _mongocrypt_cache_key_value_destroy(value);
+        return _key_broker_fail(kb);
+    }
+
+    /* Borrow from the cached value instead of keeping a copy. */
+    if (key_returned->cache_value) {
+        _mongocrypt_cache_key_value_destroy(key_returned->cache_value);
+    } else {
+        _mongocrypt_key_destroy(key_returned->doc);
+        _mongocrypt_buffer_cleanup(&key_returned->decrypted_key_material);
+    }
+    key_returned->cache_value = value;
+    key_returned->doc = value->key_doc;
+    _mongocrypt_buffer_set_to(&value->decrypted_key_material, &key_returned->decrypted_key_material);
     return true;
 }
 
-bool _mongocrypt_key_broker_request_id(_mongocrypt_key_broker_t *kb, const _mongocrypt_buffer_t *key_id) {
+static bool _request_id(_mongocrypt_key_broker_t *kb, const _mongocrypt_buffer_t *key_id, bool optional) {
     key_request_t *req;
 
     BSON_ASSERT_PARAM(kb);
@@ -310,22 +719,39 @@ bool _mongocrypt_key_broker_request_id(_mongocrypt_key_broker_t *kb, const _mong
         return _key_broker_fail_w_msg(kb, "expected UUID for key id");
     }
 
-    if (_key_request_find_one(kb, key_id, NULL)) {
+    req = _key_request_find_one(kb, key_id, NULL);
+    if (req) {
+        if (req->optional && !optional) {
+            /* The key was prefetched but is now required. If it was not
+             * found, it is fetched again. */
+            req->optional = false;
+            if (!req->satisfied) {
+                kb->num_unsatisfied++;
+            }
+        }
         return true;
     }
 
-    req = bson_malloc0(sizeof *req);
+    req = mc_arena_malloc0(&kb->arena, sizeof *req);
     BSON_ASSERT(req);
 
     _mongocrypt_buffer_copy_to(key_id, &req->id);
-    req->next = kb->key_requests;
-    kb->key_requests = req;
+    req->optional = optional;
+    _key_request_add(kb, req);
     if (!_try_satisfying_from_cache(kb, req)) {
         return false;
     }
     return true;
 }
 
+bool _mongocrypt_key_broker_request_id(_mongocrypt_key_broker_t *kb, const _mongocrypt_buffer_t *key_id) {
+    return _request_id(kb, key_id, false /* optional */);
+}
+
+bool _mongocrypt_key_broker_request_id_optional(_mongocrypt_key_broker_t *kb, const _mongocrypt_buffer_t *key_id) {
+    return _request_id(kb, key_id, true /* optional */);
+}
+
 bool _mongocrypt_key_broker_request_name(_mongocrypt_key_broker_t *kb, const bson_value_t *key_alt_name_value) {
     key_request_t *req;
     _mongocrypt_key_alt_name_t *key_alt_name;
@@ -345,12 +771,11 @@ bool _mongocrypt_key_broker_request_name(_mongocrypt_key_broker_t *kb, const bso
         return true;
     }
 
-    req = bson_malloc0(sizeof *req);
+    req = mc_arena_malloc0(&kb->arena, sizeof *req);
     BSON_ASSERT(req);
 
     req->alt_name = key_alt_name /* takes ownership */;
-    req->next = kb->key_requests;
-    kb->key_requests = req;
+    _key_request_add(kb, req);
     if (!_try_satisfying_from_cache(kb, req)) {
         return false;
     }
@@ -392,6 +817,38 @@ bool _mongocrypt_key_broker_requests_done(_mongocrypt_key_broker_t *kb) {
     return true;
 }
 
+void _mongocrypt_key_broker_projection(_mongocrypt_key_broker_t *kb, mongocrypt_binary_t *out) {
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(out);
+
+    if (_mongocrypt_buffer_empty(&kb->projection)) {
+        bson_t *projection = BCON_NEW("_id",
+                                      BCON_INT32(1),
+                                      "keyAltNames",
+                                      BCON_INT32(1),
+                                      "keyMaterial",
+                                      BCON_INT32(1),
+                                      "masterKey",
+                                      BCON_INT32(1));
+
+        _mongocrypt_buffer_steal_from_bson(&kb->projection, projection);
+    }
+    kb->accepts_projected = true;
+    _mongocrypt_buffer_to_binary(&kb->projection, out);
+}
+
+/* Parses the key document @doc_bson into @key_doc. */
+static bool _parse_key_doc(_mongocrypt_key_broker_t *kb, const bson_t *doc_bson, _mongocrypt_key_doc_t *key_doc) {
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(doc_bson);
+    BSON_ASSERT_PARAM(key_doc);
+
+    if (kb->accepts_projected) {
+        return _mongocrypt_key_parse_projected_owned(doc_bson, key_doc, kb->status);
+    }
+    return _mongocrypt_key_parse_owned(doc_bson, key_doc, kb->status);
+}
+
 bool _mongocrypt_key_broker_filter(_mongocrypt_key_broker_t *kb, mongocrypt_binary_t *out) {
     key_request_t *req;
     _mongocrypt_key_alt_name_t *key_alt_name;
@@ -420,6 +877,14 @@ bool _mongocrypt_key_broker_filter(_mongocrypt_key_broker_t *kb, mongocrypt_bina
             continue;
         }
 
+        if (req->optional) {
+            /* Do not fetch a prefetched key again if it was not found. */
+            if (req->fetched) {
+                continue;
+            }
+            req->fetched = true;
+        }
+
         if (!_mongocrypt_buffer_empty(&req->id)) {
             /* Collect key_ids in "ids" */
             char *key_str;
@@ -483,13 +948,144 @@ bool _mongocrypt_key_broker_filter(_mongocrypt_key_broker_t *kb, mongocrypt_bina
     return true;
 }
 
+/* Create an oauth request for the KMS provider of @key_doc. If @claimed, the
+ * claim on the token fetch is released on failure. */
+static bool _add_auth_request(_mongocrypt_key_broker_t *kb,
+                              const _mongocrypt_key_doc_t *key_doc,
+                              const mc_kms_creds_t *kc,
+                              bool refresh,
+                              bool claimed) {
+    auth_request_t *ar;
+    bool ok;
+
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(key_doc);
+    BSON_ASSERT_PARAM(kc);
+
+    ar = auth_request_new();
+    if (key_doc->kek.kms_provider == MONGOCRYPT_KMS_PROVIDER_AZURE) {
+        ok = _mongocrypt_kms_ctx_init_azure_auth(&ar->kms,
+                                                 kc,
+                                                 /* The key vault endpoint is used to determine the scope. */
+                                                 key_doc->kek.provider.azure.key_vault_endpoint,
+                                                 key_doc->kek.kmsid,
+                                                 &kb->crypt->log);
+    } else {
+        BSON_ASSERT(key_doc->kek.kms_provider == MONGOCRYPT_KMS_PROVIDER_GCP);
+        ok = _mongocrypt_kms_ctx_init_gcp_auth(&ar->kms,
+                                               &kb->crypt->opts,
+                                               kc,
+                                               key_doc->kek.provider.gcp.endpoint,
+                                               key_doc->kek.kmsid,
+                                               &kb->crypt->log);
+    }
+    if (!ok) {
+        mongocrypt_kms_ctx_status(&ar->kms, kb->status);
+        auth_request_destroy(ar);
+        if (claimed) {
+            mc_mapof_kmsid_to_token_abandon_fetch(kb->crypt->cache_oauth, key_doc->kek.kmsid);
+        }
+        return _key_broker_fail(kb);
+    }
+    ar->kmsid = bson_strdup(key_doc->kek.kmsid);
+    ar->refresh = refresh;
+    ar->claimed = claimed;
+    mc_mapof_kmsid_to_authrequest_put(kb->auth_requests, ar);
+    return true;
+}
+
+/* Request an oauth token for the KMS provider of @key_doc. With
+ * coalesce_kms_decrypts, no request is created if another key broker is
+ * already fetching the token. The key then waits for it in KB_AUTHENTICATING. */
+static bool
+_request_token(_mongocrypt_key_broker_t *kb, const _mongocrypt_key_doc_t *key_doc, const mc_kms_creds_t *kc) {
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(key_doc);
+
+    if (!kb->coalesce_kms_decrypts) {
+        return _add_auth_request(kb, key_doc, kc, false /* refresh */, false /* claimed */);
+    }
+    if (!mc_mapof_kmsid_to_token_claim_fetch(kb->crypt->cache_oauth, key_doc->kek.kmsid)) {
+        return true;
+    }
+    return _add_auth_request(kb, key_doc, kc, false /* refresh */, true /* claimed */);
+}
+
+/* Get the cached oauth token for the KMS provider of @key_doc into
+ * @access_token, or NULL if there is none. With oauth_refresh_margin_ms, a
+ * token close to expiring is still returned, and this key broker may add a
+ * request to refresh it. */
+static bool _get_cached_token(_mongocrypt_key_broker_t *kb,
+                              const _mongocrypt_key_doc_t *key_doc,
+                              const mc_kms_creds_t *kc,
+                              char **access_token) {
+    bool refresh = false;
+
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(key_doc);
+    BSON_ASSERT_PARAM(kc);
+    BSON_ASSERT_PARAM(access_token);
+
+    if (kb->crypt->opts.oauth_refresh_margin_ms == 0) {
+        *access_token = mc_mapof_kmsid_to_token_get_token(kb->crypt->cache_oauth, key_doc->kek.kmsid);
+        return true;
+    }
+
+    *access_token = mc_mapof_kmsid_to_token_get_token_refresh(kb->crypt->cache_oauth,
+                                                             key_doc->kek.kmsid,
+                                                             (int64_t)kb->crypt->opts.oauth_refresh_margin_ms * 1000,
+                                                             &refresh);
+    if (!refresh) {
+        return true;
+    }
+    if (mc_mapof_kmsid_to_authrequest_has(kb->auth_requests, key_doc->kek.kmsid)) {
+        /* Already fetching a token for this KMS provider. */
+        mc_mapof_kmsid_to_token_abandon_fetch(kb->crypt->cache_oauth, key_doc->kek.kmsid);
+        return true;
+    }
+    return _add_auth_request(kb, key_doc, kc, true /* refresh */, true /* claimed */);
+}
+
+/* _unwrap_with_cached_kmip_kek decrypts @key_returned with its KEK from the
+ * KMIP KEK cache. Sets @unwrapped to false if the KEK is not cached. */
+static bool _unwrap_with_cached_kmip_kek(_mongocrypt_key_broker_t *kb, key_returned_t *key_returned, bool *unwrapped) {
+    _mongocrypt_buffer_t *kek = NULL;
+    bool ok;
+
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(key_returned);
+    BSON_ASSERT_PARAM(unwrapped);
+
+    *unwrapped = false;
+    if (!_mongocrypt_cache_get(&kb->crypt->cache_kmip_kek, &key_returned->kmip_kek_cache_key, (void **)&kek)) {
+        return _key_broker_fail_w_msg(kb, "failed to retrieve from KMIP KEK cache");
+    }
+    if (!kek) {
+        return true;
+    }
+
+    ok = _mongocrypt_unwrap_key(kb->crypt->crypto,
+                                kek,
+                                &key_returned->doc->key_material,
+                                &key_returned->decrypted_key_material,
+                                kb->status);
+    bson_zero_free(kek->data, kek->len);
+    bson_free(kek);
+    if (!ok) {
+        return _key_broker_fail(kb);
+    }
+
+    key_returned->decrypted = true;
+    *unwrapped = true;
+    return _store_to_cache(kb, key_returned);
+}
+
 bool _mongocrypt_key_broker_add_doc(_mongocrypt_key_broker_t *kb,
                                     _mongocrypt_opts_kms_providers_t *kms_providers,
                                     const _mongocrypt_buffer_t *doc) {
     bool ret = false;
     bson_t doc_bson;
     _mongocrypt_key_doc_t *key_doc = NULL;
-    key_request_t *key_request;
     key_returned_t *key_returned;
     _mongocrypt_kms_provider_t kek_provider;
     char *access_token = NULL;
@@ -501,6 +1097,7 @@ bool _mongocrypt_key_broker_add_doc(_mongocrypt_key_broker_t *kb,
         _key_broker_fail_w_msg(kb, "attempting to add a key doc, but in wrong state");
         goto done;
     }
+    kb->kms_providers = kms_providers;
 
     if (!doc) {
         _key_broker_fail_w_msg(kb, "invalid key");
@@ -514,7 +1111,7 @@ bool _mongocrypt_key_broker_add_doc(_mongocrypt_key_broker_t *kb,
         goto done;
     }
 
-    if (!_mongocrypt_key_parse_owned(&doc_bson, key_doc, kb->status)) {
+    if (!_parse_key_doc(kb, &doc_bson, key_doc)) {
         goto done;
     }
 
@@ -528,14 +1125,13 @@ bool _mongocrypt_key_broker_add_doc(_mongocrypt_key_broker_t *kb,
 
         /* If in any mode, add request for provided document now. */
         if (kb->state == KB_ADDING_DOCS_ANY) {
-            key_request_t *const req = bson_malloc0(sizeof(key_request_t));
+            key_request_t *const req = mc_arena_malloc0(&kb->arena, sizeof(key_request_t));
 
             BSON_ASSERT(req);
 
             _mongocrypt_buffer_copy_to(&key_doc->id, &req->id);
             req->alt_name = _mongocrypt_key_alt_name_copy_all(key_doc->key_alt_names);
-            req->next = kb->key_requests;
-            kb->key_requests = req;
+            _key_request_add(kb, req);
 
             if (!_try_satisfying_from_cache(kb, req)) {
                 goto done;
@@ -551,12 +1147,12 @@ bool _mongocrypt_key_broker_add_doc(_mongocrypt_key_broker_t *kb,
 
     /* Check if there are other keys_returned with intersecting altnames or
      * equal id. This is an error. Do *not* check cached keys. */
-    if (_key_returned_find_one(kb->keys_returned, &key_doc->id, key_doc->key_alt_names)) {
+    if (_key_returned_find_one(&kb->keys_returned_index, &key_doc->id, key_doc->key_alt_names)) {
         _key_broker_fail_w_msg(kb, "keys returned have duplicate keyAltNames or _id");
         goto done;
     }
 
-    key_returned = _key_returned_prepend(kb, &kb->keys_returned, key_doc);
+    key_returned = _key_returned_prepend(kb, &kb->keys_returned, &kb->keys_returned_index, key_doc);
 
     /* Check that the returned key doc's provider matches. */
     kek_provider = key_doc->kek.kms_provider;
@@ -572,7 +1168,11 @@ bool _mongocrypt_key_broker_add_doc(_mongocrypt_key_broker_t *kb,
     /* If the KMS provider is local, decrypt immediately. Otherwise, create the
      * HTTP KMS request. */
     BSON_ASSERT(kb->crypt);
-    if (kek_provider == MONGOCRYPT_KMS_PROVIDER_LOCAL) {
+    if (kek_provider == MONGOCRYPT_KMS_PROVIDER_LOCAL && kb->crypt->opts.parallel_key_unwrap_threshold > 0
+        && kb->crypt->crypto->parallel_for) {
+        /* Unwrapped with the other local keys once all documents are added. */
+        key_returned->unwrap_deferred = true;
+    } else if (kek_provider == MONGOCRYPT_KMS_PROVIDER_LOCAL) {
         BSON_ASSERT(kc.type == MONGOCRYPT_KMS_PROVIDER_LOCAL);
         if (!_mongocrypt_unwrap_key(kb->crypt->crypto,
                                     &kc.value.local.key,
@@ -601,27 +1201,15 @@ bool _mongocrypt_key_broker_add_doc(_mongocrypt_key_broker_t *kb,
         BSON_ASSERT(kc.type == MONGOCRYPT_KMS_PROVIDER_AZURE);
         if (kc.value.azure.access_token) {
             access_token = bson_strdup(kc.value.azure.access_token);
-        } else {
-            access_token = mc_mapof_kmsid_to_token_get_token(kb->crypt->cache_oauth, key_doc->kek.kmsid);
+        } else if (!_get_cached_token(kb, key_doc, &kc, &access_token)) {
+            goto done;
         }
         if (!access_token) {
             key_returned->needs_auth = true;
             /* Create an oauth request if one does not exist. */
-            if (!mc_mapof_kmsid_to_authrequest_has(kb->auth_requests, key_doc->kek.kmsid)) {
-                auth_request_t *ar = auth_request_new();
-                if (!_mongocrypt_kms_ctx_init_azure_auth(&ar->kms,
-                                                         &kc,
-                                                         /* The key vault endpoint is used to determine the scope. */
-                                                         key_doc->kek.provider.azure.key_vault_endpoint,
-                                                         key_doc->kek.kmsid,
-                                                         &kb->crypt->log)) {
-                    mongocrypt_kms_ctx_status(&ar->kms, kb->status);
-                    _key_broker_fail(kb);
-                    auth_request_destroy(ar);
-                    goto done;
-                }
-                ar->kmsid = bson_strdup(key_doc->kek.kmsid);
-                mc_mapof_kmsid_to_authrequest_put(kb->auth_requests, ar);
+            if (!mc_mapof_kmsid_to_authrequest_has(kb->auth_requests, key_doc->kek.kmsid)
+                && !_request_token(kb, key_doc, &kc)) {
+                goto done;
             }
         } else {
             if (!_mongocrypt_kms_ctx_init_azure_unwrapkey(&key_returned->kms,
@@ -639,27 +1227,15 @@ bool _mongocrypt_key_broker_add_doc(_mongocrypt_key_broker_t *kb,
         BSON_ASSERT(kc.type == MONGOCRYPT_KMS_PROVIDER_GCP);
         if (NULL != kc.value.gcp.access_token) {
             access_token = bson_strdup(kc.value.gcp.access_token);
-        } else {
-            access_token = mc_mapof_kmsid_to_token_get_token(kb->crypt->cache_oauth, key_doc->kek.kmsid);
+        } else if (!_get_cached_token(kb, key_doc, &kc, &access_token)) {
+            goto done;
         }
         if (!access_token) {
             key_returned->needs_auth = true;
             /* Create an oauth request if one does not exist. */
-            if (!mc_mapof_kmsid_to_authrequest_has(kb->auth_requests, key_doc->kek.kmsid)) {
-                auth_request_t *ar = auth_request_new();
-                if (!_mongocrypt_kms_ctx_init_gcp_auth(&ar->kms,
-                                                       &kb->crypt->opts,
-                                                       &kc,
-                                                       key_doc->kek.provider.gcp.endpoint,
-                                                       key_doc->kek.kmsid,
-                                                       &kb->crypt->log)) {
-                    mongocrypt_kms_ctx_status(&ar->kms, kb->status);
-                    _key_broker_fail(kb);
-                    auth_request_destroy(ar);
-                    goto done;
-                }
-                ar->kmsid = bson_strdup(key_doc->kek.kmsid);
-                mc_mapof_kmsid_to_authrequest_put(kb->auth_requests, ar);
+            if (!mc_mapof_kmsid_to_authrequest_has(kb->auth_requests, key_doc->kek.kmsid)
+                && !_request_token(kb, key_doc, &kc)) {
+                goto done;
             }
         } else {
             if (!_mongocrypt_kms_ctx_init_gcp_decrypt(&key_returned->kms,
@@ -705,11 +1281,23 @@ bool _mongocrypt_key_broker_add_doc(_mongocrypt_key_broker_t *kb,
                 goto done;
             }
         } else {
-            if (!_mongocrypt_kms_ctx_init_kmip_get(&key_returned->kms,
-                                                   endpoint,
-                                                   unique_identifier,
-                                                   key_doc->kek.kmsid,
-                                                   &kb->crypt->log)) {
+            bool unwrapped = false;
+
+            if (kb->crypt->opts.kmip_kek_cache_expiration_ms > 0) {
+                _mongocrypt_cache_kmip_kek_key(endpoint->host_and_port,
+                                               unique_identifier,
+                                               &key_returned->kmip_kek_cache_key);
+                if (!_unwrap_with_cached_kmip_kek(kb, key_returned, &unwrapped)) {
+                    goto done;
+                }
+            }
+            /* With a cached KEK, the key is decrypted like a local key. */
+            if (!unwrapped
+                && !_mongocrypt_kms_ctx_init_kmip_get(&key_returned->kms,
+                                                      endpoint,
+                                                      unique_identifier,
+                                                      key_doc->kek.kmsid,
+                                                      &kb->crypt->log)) {
                 mongocrypt_kms_ctx_status(&key_returned->kms, kb->status);
                 _key_broker_fail(kb);
                 goto done;
@@ -721,14 +1309,7 @@ bool _mongocrypt_key_broker_add_doc(_mongocrypt_key_broker_t *kb,
     }
 
     /* Mark all matching key requests as satisfied. */
-    for (key_request = kb->key_requests; NULL != key_request; key_request = key_request->next) {
-        if (0 == _mongocrypt_buffer_cmp(&key_doc->id, &key_request->id)) {
-            key_request->satisfied = true;
-        }
-        if (_mongocrypt_key_alt_name_intersects(key_doc->key_alt_names, key_request->alt_name)) {
-            key_request->satisfied = true;
-        }
-    }
+    _key_request_find(kb, &key_doc->id, key_doc->key_alt_names, true /* satisfy */);
 
     ret = true;
 done:
@@ -737,6 +1318,327 @@ done:
     return ret;
 }
 
+bool _mongocrypt_key_broker_add_prefetched_doc(_mongocrypt_key_broker_t *kb,
+                                               _mongocrypt_opts_kms_providers_t *kms_providers,
+                                               const _mongocrypt_buffer_t *doc) {
+    bson_t doc_bson;
+    _mongocrypt_key_doc_t *key_doc;
+    key_request_t *req;
+    bool wanted;
+
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(kms_providers);
+    BSON_ASSERT_PARAM(doc);
+
+    if (kb->state != KB_ADDING_DOCS) {
+        return _key_broker_fail_w_msg(kb, "attempting to add a key doc, but in wrong state");
+    }
+
+    key_doc = _mongocrypt_key_new();
+    if (!_mongocrypt_buffer_to_bson(doc, &doc_bson)) {
+        _mongocrypt_key_destroy(key_doc);
+        return _key_broker_fail_w_msg(kb, "malformed BSON for key document");
+    }
+    if (!_parse_key_doc(kb, &doc_bson, key_doc)) {
+        _mongocrypt_key_destroy(key_doc);
+        return _key_broker_fail(kb);
+    }
+
+    req = _key_request_find_one(kb, &key_doc->id, key_doc->key_alt_names);
+    wanted = req && !req->satisfied
+          && !_key_returned_find_one(&kb->keys_returned_index, &key_doc->id, key_doc->key_alt_names);
+    _mongocrypt_key_destroy(key_doc);
+    if (!wanted) {
+        return true;
+    }
+    return _mongocrypt_key_broker_add_doc(kb, kms_providers, doc);
+}
+
+/* State shared by the tasks of _unwrap_deferred_keys. */
+typedef struct {
+    _mongocrypt_crypto_t *crypto;
+    key_returned_t **keys;
+    /* keks views the local KEK of each key. */
+    _mongocrypt_buffer_t *keks;
+    mongocrypt_status_t **statuses;
+    bool *ok;
+} _unwrap_batch_t;
+
+static void _unwrap_task(void *task_ctx, uint32_t index) {
+    _unwrap_batch_t *batch = task_ctx;
+    key_returned_t *key_returned;
+
+    BSON_ASSERT_PARAM(task_ctx);
+
+    key_returned = batch->keys[index];
+    batch->ok[index] = _mongocrypt_unwrap_key(batch->crypto,
+                                              &batch->keks[index],
+                                              &key_returned->doc->key_material,
+                                              &key_returned->decrypted_key_material,
+                                              batch->statuses[index]);
+}
+
+/* _unwrap_deferred_keys unwraps the local keys added with unwrap_deferred and
+ * stores them to the cache. If there are at least
+ * opts.parallel_key_unwrap_threshold of them, each is unwrapped by its own
+ * task on the parallel_for executor. */
+static bool _unwrap_deferred_keys(_mongocrypt_key_broker_t *kb) {
+    _mongocrypt_crypto_t *crypto;
+    _unwrap_batch_t batch = {0};
+    key_returned_t *key_returned;
+    uint32_t n = 0;
+    uint32_t i;
+    bool ret = false;
+
+    BSON_ASSERT_PARAM(kb);
+
+    crypto = kb->crypt->crypto;
+    for (key_returned = kb->keys_returned; NULL != key_returned; key_returned = key_returned->next) {
+        if (key_returned->unwrap_deferred) {
+            if (n == UINT32_MAX) {
+                return _key_broker_fail_w_msg(kb, "too many keys to unwrap");
+            }
+            n++;
+        }
+    }
+    if (n == 0) {
+        return true;
+    }
+
+    batch.crypto = crypto;
+    batch.keys = bson_malloc0(sizeof(key_returned_t *) * n);
+    batch.keks = bson_malloc0(sizeof(_mongocrypt_buffer_t) * n);
+    batch.statuses = bson_malloc0(sizeof(mongocrypt_status_t *) * n);
+    batch.ok = bson_malloc0(sizeof(bool) * n);
+    i = 0;
+    for (key_returned = kb->keys_returned; NULL != key_returned; key_returned = key_returned->next) {
+        mc_kms_creds_t kc;
+
+        if (!key_returned->unwrap_deferred) {
+            continue;
+        }
+        batch.keys[i] = key_returned;
+        batch.statuses[i] = mongocrypt_status_new();
+        /* The KMS provider was found when the document was added. */
+        if (!kb->kms_providers
+            || !_mongocrypt_opts_kms_providers_lookup(kb->kms_providers, key_returned->doc->kek.kmsid, &kc)
+            || kc.type != MONGOCRYPT_KMS_PROVIDER_LOCAL) {
+            _key_broker_fail_w_msg(kb, "local KMS provider is not configured");
+            n = i + 1u;
+            goto done;
+        }
+        _mongocrypt_buffer_init(&batch.keks[i]);
+        _mongocrypt_buffer_set_to(&kc.value.local.key, &batch.keks[i]);
+        i++;
+    }
+
+    if (n >= kb->crypt->opts.parallel_key_unwrap_threshold) {
+        crypto->parallel_for(crypto->parallel_for_ctx, _unwrap_task, &batch, n);
+    } else {
+        for (i = 0; i < n; i++) {
+            _unwrap_task(&batch, i);
+        }
+    }
+
+    /* Cache the keys in order, on the calling thread. */
+    for (i = 0; i < n; i++) {
+        if (!batch.ok[i]) {
+            _mongocrypt_status_copy_to(batch.statuses[i], kb->status);
+            _key_broker_fail(kb);
+            goto done;
+        }
+        batch.keys[i]->unwrap_deferred = false;
+        batch.keys[i]->decrypted = true;
+        if (!_store_to_cache(kb, batch.keys[i])) {
+            goto done;
+        }
+    }
+    ret = true;
+
+done:
+    for (i = 0; i < n; i++) {
+        mongocrypt_status_destroy(batch.statuses[i]);
+    }
+    bson_free(batch.ok);
+    bson_free(batch.statuses);
+    bson_free(batch.keks);
+    bson_free(batch.keys);
+    return ret;
+}
+
+/* Returns the table of in-flight KMS decrypts of @kb and the mutex protecting
+ * it. The table is shared with the cache domain of the crypt, if any. */
+static mc_array_t *_kms_inflight(_mongocrypt_key_broker_t *kb, mongocrypt_mutex_t **mutex) {
+    _mongocrypt_cache_domain_t *const domain = kb->crypt->cache_domain;
+
+    if (domain) {
+        *mutex = &domain->mutex;
+        return &domain->kms_inflight;
+    }
+    *mutex = &kb->crypt->mutex;
+    return &kb->crypt->kms_inflight;
+}
+
+/* Claim the KMS decrypt of @id for this key broker. Returns false if another
+ * key broker already owns it. */
+static bool _kms_inflight_claim(_mongocrypt_key_broker_t *kb, const _mongocrypt_buffer_t *id) {
+    mc_array_t *inflight;
+    mongocrypt_mutex_t *mutex;
+    _mongocrypt_buffer_t copy;
+
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(id);
+
+    inflight = _kms_inflight(kb, &mutex);
+    _mongocrypt_mutex_lock(mutex);
+    for (size_t i = 0; i < inflight->len; i++) {
+        if (0 == _mongocrypt_buffer_cmp(&_mc_array_index(inflight, _mongocrypt_buffer_t, i), id)) {
+            _mongocrypt_mutex_unlock(mutex);
+            return false;
+        }
+    }
+    _mongocrypt_buffer_copy_to(id, &copy);
+    _mc_array_append_val(inflight, copy);
+    _mongocrypt_mutex_unlock(mutex);
+    return true;
+}
+
+static void _kms_inflight_release(_mongocrypt_key_broker_t *kb, const _mongocrypt_buffer_t *id) {
+    mc_array_t *inflight;
+    mongocrypt_mutex_t *mutex;
+
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(id);
+
+    inflight = _kms_inflight(kb, &mutex);
+    _mongocrypt_mutex_lock(mutex);
+    for (size_t i = 0; i < inflight->len; i++) {
+        _mongocrypt_buffer_t *entry = &_mc_array_index(inflight, _mongocrypt_buffer_t, i);
+
+        if (0 == _mongocrypt_buffer_cmp(entry, id)) {
+            _mongocrypt_buffer_cleanup(entry);
+            inflight->len--;
+            if (i < inflight->len) {
+                *entry = _mc_array_index(inflight, _mongocrypt_buffer_t, inflight->len);
+            }
+            break;
+        }
+    }
+    _mongocrypt_mutex_unlock(mutex);
+}
+
+/* Decide which key broker decrypts each key that still needs a KMS. Keys that
+ * another key broker has since stored in the cache are taken from it. Keys
+ * with a KMS decrypt in progress elsewhere are deferred. Transitions to
+ * KB_DONE if no keys remain to decrypt. */
+static bool _coalesce_kms_decrypts(_mongocrypt_key_broker_t *kb) {
+    key_returned_t *key_returned;
+    bool needs_decryption = false;
+
+    BSON_ASSERT_PARAM(kb);
+
+    for (key_returned = kb->keys_returned; NULL != key_returned; key_returned = key_returned->next) {
+        _mongocrypt_cache_key_attr_t *attr;
+        _mongocrypt_cache_key_value_t *value = NULL;
+
+        if (key_returned->decrypted || key_returned->kms_owner) {
+            needs_decryption = needs_decryption || !key_returned->decrypted;
+            continue;
+        }
+
+        attr = _mongocrypt_cache_key_attr_new(&key_returned->doc->id, NULL);
+        if (!_mongocrypt_cache_get(_mongocrypt_key_cache(kb->crypt), attr, (void **)&value)) {
+            _mongocrypt_cache_key_attr_destroy(attr);
+            return _key_broker_fail_w_msg(kb, "failed to retrieve from cache");
+        }
+        _mongocrypt_cache_key_attr_destroy(attr);
+
+        if (value) {
+            /* Decrypted by another key broker. */
+            _mongocrypt_buffer_share_to(&value->decrypted_key_material, &key_returned->decrypted_key_material);
+            _mongocrypt_cache_key_value_destroy(value);
+            key_returned->decrypted = true;
+            key_returned->kms_deferred = false;
+            key_returned->cached = true;
+            continue;
+        }
+
+        needs_decryption = true;
+        if (_kms_inflight_claim(kb, &key_returned->doc->id)) {
+            key_returned->kms_owner = true;
+            key_returned->kms_deferred = false;
+        } else {
+            key_returned->kms_deferred = true;
+        }
+    }
+
+    kb->decryptor_iter = kb->keys_returned;
+    kb->state = needs_decryption ? KB_DECRYPTING_KEY_MATERIAL : KB_DONE;
+    return true;
+}
+
+/* _is_kmip_get returns true if @key_returned is waiting on its own KMIP Get
+ * request. */
+static bool _is_kmip_get(const key_returned_t *key_returned) {
+    BSON_ASSERT_PARAM(key_returned);
+
+    return !key_returned->decrypted && !key_returned->kms_deferred && !key_returned->kmip_batch_leader
+        && key_returned->kms.req && key_returned->kms.req_type == MONGOCRYPT_KMS_KMIP_GET
+        && key_returned->kms.batch_len == 1;
+}
+
+/* Combine the KMIP Get requests of keys on the same KMIP server into one
+ * request with a batch item per key. */
+static bool _batch_kmip_requests(_mongocrypt_key_broker_t *kb) {
+    BSON_ASSERT_PARAM(kb);
+
+    for (key_returned_t *leader = kb->keys_returned; NULL != leader; leader = leader->next) {
+        const char *unique_identifiers[KMS_KMIP_REQUEST_MAX_BATCH_COUNT];
+        _mongocrypt_endpoint_t *endpoint;
+        size_t count = 1;
+
+        if (!_is_kmip_get(leader)) {
+            continue;
+        }
+
+        unique_identifiers[0] = leader->doc->kek.provider.kmip.key_id;
+        for (key_returned_t *follower = leader->next; NULL != follower && count < KMS_KMIP_REQUEST_MAX_BATCH_COUNT;
+             follower = follower->next) {
+            if (!_is_kmip_get(follower) || 0 != strcmp(follower->kms.kmsid, leader->kms.kmsid)
+                || 0 != strcmp(follower->kms.endpoint, leader->kms.endpoint)) {
+                continue;
+            }
+            follower->kmip_batch_leader = leader;
+            follower->kmip_batch_index = count;
+            unique_identifiers[count] = follower->doc->kek.provider.kmip.key_id;
+            count++;
+        }
+
+        if (count == 1) {
+            continue;
+        }
+
+        /* The endpoint of the request already has the default port applied. */
+        endpoint = _mongocrypt_endpoint_new(leader->kms.endpoint, -1, NULL /* opts */, kb->status);
+        if (!endpoint) {
+            return _key_broker_fail(kb);
+        }
+        _mongocrypt_kms_ctx_cleanup(&leader->kms);
+        if (!_mongocrypt_kms_ctx_init_kmip_get_batch(&leader->kms,
+                                                     endpoint,
+                                                     unique_identifiers,
+                                                     count,
+                                                     leader->doc->kek.kmsid,
+                                                     &kb->crypt->log)) {
+            mongocrypt_kms_ctx_status(&leader->kms, kb->status);
+            _mongocrypt_endpoint_destroy(endpoint);
+            return _key_broker_fail(kb);
+        }
+        _mongocrypt_endpoint_destroy(endpoint);
+    }
+    return true;
+}
+
 bool _mongocrypt_key_broker_docs_done(_mongocrypt_key_broker_t *kb) {
     key_returned_t *key_returned;
     bool needs_decryption;
@@ -755,6 +1657,10 @@ bool _mongocrypt_key_broker_docs_done(_mongocrypt_key_broker_t *kb) {
             "not all keys requested were satisfied. Verify that key vault DB/collection name was correctly specified.");
     }
 
+    if (!_unwrap_deferred_keys(kb)) {
+        return false;
+    }
+
     /* Transition to the next state.
      *  - If there are any Azure or GCP backed keys, and no oauth token is
      * cached, transition to KB_AUTHENTICATING.
@@ -779,12 +1685,134 @@ bool _mongocrypt_key_broker_docs_done(_mongocrypt_key_broker_t *kb) {
         kb->state = KB_AUTHENTICATING;
     } else if (needs_decryption) {
         kb->state = KB_DECRYPTING_KEY_MATERIAL;
+        if (kb->coalesce_kms_decrypts && !_coalesce_kms_decrypts(kb)) {
+            return false;
+        }
+        if (kb->state == KB_DECRYPTING_KEY_MATERIAL && kb->crypt->opts.batch_kmip_requests) {
+            return _batch_kmip_requests(kb);
+        }
     } else {
         kb->state = KB_DONE;
     }
     return true;
 }
 
+/* _hedge_due returns true if the KMS request of @key_returned has waited long
+ * enough on a response to be hedged. */
+static bool _hedge_due(_mongocrypt_key_broker_t *kb, key_returned_t *key_returned) {
+    mongocrypt_kms_ctx_t *kms;
+
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(key_returned);
+
+    kms = &key_returned->kms;
+    if (_mongocrypt_buffer_empty(&kb->crypt->opts.kms_hedge_endpoints) || key_returned->hedge_tried
+        || key_returned->decrypted || key_returned->kms_deferred || key_returned->kmip_batch_leader) {
+        return false;
+    }
+    /* Keys needing oauth have no AWS or KMIP request. Batched KMIP requests
+     * are not hedged. */
+    if (kms->req_type != MONGOCRYPT_KMS_AWS_DECRYPT && kms->req_type != MONGOCRYPT_KMS_KMIP_GET
+        && kms->req_type != MONGOCRYPT_KMS_KMIP_DECRYPT) {
+        return false;
+    }
+    if (kms->batch_len > 1 || kms->start_us == 0 || kms->should_retry || 0 == mongocrypt_kms_ctx_bytes_needed(kms)) {
+        return false;
+    }
+    return bson_get_monotonic_time() - kms->start_us >= (int64_t)kb->crypt->opts.kms_hedge_after_ms * 1000;
+}
+
+/* _init_hedge initializes the hedged request of @key_returned to @endpoint.
+ * Returns false if it could not be created or would go to the same endpoint. */
+static bool _init_hedge(_mongocrypt_key_broker_t *kb, key_returned_t *key_returned, _mongocrypt_endpoint_t *endpoint) {
+    _mongocrypt_key_doc_t *key_doc;
+    mongocrypt_kms_ctx_t *hedge;
+    bool ok;
+
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(key_returned);
+    BSON_ASSERT_PARAM(endpoint);
+
+    key_doc = key_returned->doc;
+    hedge = &key_returned->hedge_kms;
+    if (key_returned->kms.req_type == MONGOCRYPT_KMS_AWS_DECRYPT) {
+        BSON_ASSERT(kb->kms_providers);
+        ok = _mongocrypt_kms_ctx_init_aws_decrypt_at(hedge,
+                                                     kb->kms_providers,
+                                                     key_doc,
+                                                     endpoint,
+                                                     kb->crypt->crypto,
+                                                     key_doc->kek.kmsid,
+                                                     &kb->crypt->log);
+    } else if (key_returned->kms.req_type == MONGOCRYPT_KMS_KMIP_DECRYPT) {
+        ok = _mongocrypt_kms_ctx_init_kmip_decrypt(hedge, endpoint, key_doc->kek.kmsid, key_doc, &kb->crypt->log);
+    } else {
+        ok = _mongocrypt_kms_ctx_init_kmip_get(hedge,
+                                               endpoint,
+                                               key_doc->kek.provider.kmip.key_id,
+                                               key_doc->kek.kmsid,
+                                               &kb->crypt->log);
+    }
+
+    if (!ok) {
+        _mongocrypt_log(&kb->crypt->log,
+                        MONGOCRYPT_LOG_LEVEL_WARNING,
+                        "failed to create hedged KMS request to `%s`: %s",
+                        endpoint->host_and_port,
+                        mongocrypt_status_message(hedge->status, NULL));
+    } else if (0 == strcmp(hedge->endpoint, key_returned->kms.endpoint)) {
+        ok = false;
+    }
+
+    if (!ok) {
+        _mongocrypt_kms_ctx_cleanup(hedge);
+        memset(hedge, 0, sizeof(*hedge));
+        return false;
+    }
+
+    /* @kms joined the pair when it was first returned. */
+    _mongocrypt_kms_ctx_join_hedge(hedge, &key_returned->hedge_winner, MONGOCRYPT_KMS_HEDGE_ALTERNATE);
+    key_returned->hedged = true;
+    return true;
+}
+
+/* _create_hedge creates the hedged request of @key_returned to the first
+ * alternate endpoint of its KMS provider other than its own. */
+static bool _create_hedge(_mongocrypt_key_broker_t *kb, key_returned_t *key_returned) {
+    _mongocrypt_endpoint_parse_opts_t parse_opts = {.allow_empty_subdomain = true};
+    bson_t endpoints;
+    bson_iter_t iter;
+    bson_iter_t array_iter;
+
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(key_returned);
+
+    key_returned->hedge_tried = true;
+    BSON_ASSERT(_mongocrypt_buffer_to_bson(&kb->crypt->opts.kms_hedge_endpoints, &endpoints));
+    if (!bson_iter_init_find(&iter, &endpoints, key_returned->doc->kek.kmsid) || !BSON_ITER_HOLDS_ARRAY(&iter)
+        || !bson_iter_recurse(&iter, &array_iter)) {
+        return false;
+    }
+
+    while (bson_iter_next(&array_iter)) {
+        mongocrypt_status_t *status = mongocrypt_status_new();
+        _mongocrypt_endpoint_t *endpoint;
+        bool created = false;
+
+        /* Endpoints were validated by mongocrypt_setopt_kms_hedge. */
+        endpoint = _mongocrypt_endpoint_new(bson_iter_utf8(&array_iter, NULL), -1, &parse_opts, status);
+        if (endpoint) {
+            created = _init_hedge(kb, key_returned, endpoint);
+        }
+        _mongocrypt_endpoint_destroy(endpoint);
+        mongocrypt_status_destroy(status);
+        if (created) {
+            return true;
+        }
+    }
+    return false;
+}
+
 mongocrypt_kms_ctx_t *_mongocrypt_key_broker_next_kms(_mongocrypt_key_broker_t *kb) {
     BSON_ASSERT_PARAM(kb);
 
@@ -797,7 +1825,9 @@ mongocrypt_kms_ctx_t *_mongocrypt_key_broker_next_kms(_mongocrypt_key_broker_t *
     }
 
     if (kb->state == KB_AUTHENTICATING) {
-        if (mc_mapof_kmsid_to_authrequest_empty(kb->auth_requests)) {
+        /* With coalesce_kms_decrypts, keys may only be waiting on the oauth
+         * requests of other key brokers. */
+        if (mc_mapof_kmsid_to_authrequest_empty(kb->auth_requests) && !kb->coalesce_kms_decrypts) {
             _key_broker_fail_w_msg(kb,
                                    "unexpected, attempting to authenticate but "
                                    "KMS request not initialized");
@@ -814,24 +1844,167 @@ mongocrypt_kms_ctx_t *_mongocrypt_key_broker_next_kms(_mongocrypt_key_broker_t *
             return &ar->kms;
         }
 
+        // Return auth requests to retry.
+        for (size_t i = 0; i < mc_mapof_kmsid_to_authrequest_len(kb->auth_requests); i++) {
+            auth_request_t *ar = mc_mapof_kmsid_to_authrequest_at(kb->auth_requests, i);
+            if (ar->kms.should_retry) {
+                ar->kms.should_retry = false;
+                return &ar->kms;
+            }
+        }
+
         return NULL;
     }
 
     while (kb->decryptor_iter) {
-        if (!kb->decryptor_iter->decrypted) {
+        if (!kb->decryptor_iter->decrypted && !kb->decryptor_iter->kms_deferred
+            && !kb->decryptor_iter->kmip_batch_leader) {
             key_returned_t *key_returned;
 
             key_returned = kb->decryptor_iter;
             /* iterate before returning, so next call starts at next entry */
             kb->decryptor_iter = kb->decryptor_iter->next;
+            if (!_mongocrypt_buffer_empty(&kb->crypt->opts.kms_hedge_endpoints)) {
+                /* Join before the driver may feed @kms, since a hedged
+                 * request may be created while it is fed. */
+                _mongocrypt_kms_ctx_join_hedge(&key_returned->kms,
+                                               &key_returned->hedge_winner,
+                                               MONGOCRYPT_KMS_HEDGE_ORIGINAL);
+            }
             return &key_returned->kms;
         }
         kb->decryptor_iter = kb->decryptor_iter->next;
     }
 
+    /* Return refresh requests alongside the decrypt requests. */
+    for (size_t i = 0; i < mc_mapof_kmsid_to_authrequest_len(kb->auth_requests); i++) {
+        auth_request_t *ar = mc_mapof_kmsid_to_authrequest_at(kb->auth_requests, i);
+        if (ar->refresh && !ar->done) {
+            if (!ar->returned) {
+                ar->returned = true;
+                return &ar->kms;
+            }
+            if (ar->kms.should_retry) {
+                ar->kms.should_retry = false;
+                return &ar->kms;
+            }
+        }
+    }
+
+    /* Return requests to retry. */
+    for (key_returned_t *key_returned = kb->keys_returned; NULL != key_returned; key_returned = key_returned->next) {
+        if (!key_returned->decrypted && !key_returned->kms_deferred && key_returned->kms.should_retry
+            && !_mongocrypt_kms_ctx_hedge_lost(&key_returned->kms)) {
+            key_returned->kms.should_retry = false;
+            return &key_returned->kms;
+        }
+        if (!key_returned->decrypted && key_returned->hedged && key_returned->hedge_kms.should_retry
+            && !_mongocrypt_kms_ctx_hedge_lost(&key_returned->hedge_kms)) {
+            key_returned->hedge_kms.should_retry = false;
+            return &key_returned->hedge_kms;
+        }
+    }
+
+    /* Return hedged requests for requests waiting too long. */
+    for (key_returned_t *key_returned = kb->keys_returned; NULL != key_returned; key_returned = key_returned->next) {
+        if (_hedge_due(kb, key_returned) && _create_hedge(kb, key_returned)) {
+            return &key_returned->hedge_kms;
+        }
+    }
+
     return NULL;
 }
 
+/* _result_kms returns the KMS request of @key_returned to take the result from:
+ * the hedged request if it completed first, else the original request. */
+static mongocrypt_kms_ctx_t *_result_kms(key_returned_t *key_returned) {
+    BSON_ASSERT_PARAM(key_returned);
+
+    if (key_returned->hedged
+        && _mongocrypt_atomic_int32_load(&key_returned->hedge_winner) == MONGOCRYPT_KMS_HEDGE_ALTERNATE) {
+        return &key_returned->hedge_kms;
+    }
+    return &key_returned->kms;
+}
+
+/* _kms_retry_pending returns true if a KMS request of @kb is waiting to be
+ * returned again by _mongocrypt_key_broker_next_kms. */
+static bool _kms_retry_pending(_mongocrypt_key_broker_t *kb) {
+    BSON_ASSERT_PARAM(kb);
+
+    if (kb->state == KB_AUTHENTICATING) {
+        for (size_t i = 0; i < mc_mapof_kmsid_to_authrequest_len(kb->auth_requests); i++) {
+            if (mc_mapof_kmsid_to_authrequest_at(kb->auth_requests, i)->kms.should_retry) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    for (size_t i = 0; i < mc_mapof_kmsid_to_authrequest_len(kb->auth_requests); i++) {
+        auth_request_t *ar = mc_mapof_kmsid_to_authrequest_at(kb->auth_requests, i);
+        if (ar->refresh && !ar->done && ar->kms.should_retry) {
+            return true;
+        }
+    }
+
+    for (key_returned_t *key_returned = kb->keys_returned; NULL != key_returned; key_returned = key_returned->next) {
+        if (!key_returned->decrypted && !key_returned->kms_deferred && key_returned->kms.should_retry
+            && !_mongocrypt_kms_ctx_hedge_lost(&key_returned->kms)) {
+            return true;
+        }
+        if (!key_returned->decrypted && key_returned->hedged && key_returned->hedge_kms.should_retry
+            && !_mongocrypt_kms_ctx_hedge_lost(&key_returned->hedge_kms)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* A key has no oauth token after this key broker applied its oauth responses.
+ * With coalesce_kms_decrypts, the key waits for another key broker to fetch
+ * the token, or requests it if no key broker is fetching it anymore. */
+static bool _await_token(_mongocrypt_key_broker_t *kb, const _mongocrypt_key_doc_t *key_doc, const mc_kms_creds_t *kc) {
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(key_doc);
+
+    if (!kb->coalesce_kms_decrypts
+        || mc_mapof_kmsid_to_authrequest_has(kb->auth_requests, key_doc->kek.kmsid)) {
+        return _key_broker_fail_w_msg(kb, "authentication failed, no oauth token");
+    }
+    return _request_token(kb, key_doc, kc);
+}
+
+/* Apply the response of a refresh request to the oauth token cache. The
+ * cached token is still valid, so a failed refresh does not fail @kb. */
+static void _apply_refresh(_mongocrypt_key_broker_t *kb, auth_request_t *ar) {
+    bson_t oauth_response;
+    _mongocrypt_buffer_t oauth_response_buf;
+    mongocrypt_status_t *status;
+
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(ar);
+
+    ar->done = true;
+    status = mongocrypt_status_new();
+    if (!_mongocrypt_kms_ctx_result(&ar->kms, &oauth_response_buf)) {
+        mongocrypt_kms_ctx_status(&ar->kms, status);
+    } else {
+        BSON_ASSERT(_mongocrypt_buffer_to_bson(&oauth_response_buf, &oauth_response));
+        if (mc_mapof_kmsid_to_token_add_response(kb->crypt->cache_oauth, ar->kmsid, &oauth_response, status)) {
+            mongocrypt_status_destroy(status);
+            return;
+        }
+    }
+    _mongocrypt_log(&kb->crypt->log,
+                    MONGOCRYPT_LOG_LEVEL_WARNING,
+                    "failed to refresh oauth token for KMS provider `%s`: %s",
+                    ar->kmsid,
+                    mongocrypt_status_message(status, NULL));
+    mc_mapof_kmsid_to_token_abandon_fetch(kb->crypt->cache_oauth, ar->kmsid);
+    mongocrypt_status_destroy(status);
+}
+
 bool _mongocrypt_key_broker_kms_done(_mongocrypt_key_broker_t *kb, _mongocrypt_opts_kms_providers_t *kms_providers) {
     key_returned_t *key_returned;
 
@@ -842,6 +2015,11 @@ bool _mongocrypt_key_broker_kms_done(_mongocrypt_key_broker_t *kb, _mongocrypt_o
         return _key_broker_fail_w_msg(kb, "attempting to complete KMS requests, but in wrong state");
     }
 
+    if (_kms_retry_pending(kb)) {
+        /* Remain in the current state until the retried requests complete. */
+        return true;
+    }
+
     if (kb->state == KB_AUTHENTICATING) {
         bson_t oauth_response;
         _mongocrypt_buffer_t oauth_response_buf;
@@ -850,6 +2028,14 @@ bool _mongocrypt_key_broker_kms_done(_mongocrypt_key_broker_t *kb, _mongocrypt_o
         for (size_t i = 0; i < mc_mapof_kmsid_to_authrequest_len(kb->auth_requests); i++) {
             auth_request_t *ar = mc_mapof_kmsid_to_authrequest_at(kb->auth_requests, i);
 
+            if (ar->done) {
+                continue;
+            }
+            if (ar->refresh) {
+                _apply_refresh(kb, ar);
+                continue;
+            }
+
             if (!_mongocrypt_kms_ctx_result(&ar->kms, &oauth_response_buf)) {
                 mongocrypt_kms_ctx_status(&ar->kms, kb->status);
                 return _key_broker_fail(kb);
@@ -860,9 +2046,11 @@ bool _mongocrypt_key_broker_kms_done(_mongocrypt_key_broker_t *kb, _mongocrypt_o
             if (!mc_mapof_kmsid_to_token_add_response(kb->crypt->cache_oauth, ar->kmsid, &oauth_response, kb->status)) {
                 return _key_broker_fail(kb);
             }
+            ar->done = true;
         }
 
         /* Auth should be finished, create any remaining KMS requests. */
+        bool waiting = false;
         for (key_returned = kb->keys_returned; NULL != key_returned; key_returned = key_returned->next) {
             char *access_token;
 
@@ -887,7 +2075,11 @@ bool _mongocrypt_key_broker_kms_done(_mongocrypt_key_broker_t *kb, _mongocrypt_o
                 }
 
                 if (!access_token) {
-                    return _key_broker_fail_w_msg(kb, "authentication failed, no oauth token");
+                    if (!_await_token(kb, key_returned->doc, &kc)) {
+                        return false;
+                    }
+                    waiting = true;
+                    continue;
                 }
 
                 if (!_mongocrypt_kms_ctx_init_azure_unwrapkey(&key_returned->kms,
@@ -913,7 +2105,11 @@ bool _mongocrypt_key_broker_kms_done(_mongocrypt_key_broker_t *kb, _mongocrypt_o
                 }
 
                 if (!access_token) {
-                    return _key_broker_fail_w_msg(kb, "authentication failed, no oauth token");
+                    if (!_await_token(kb, key_returned->doc, &kc)) {
+                        return false;
+                    }
+                    waiting = true;
+                    continue;
                 }
 
                 if (!_mongocrypt_kms_ctx_init_gcp_decrypt(&key_returned->kms,
@@ -937,11 +2133,32 @@ bool _mongocrypt_key_broker_kms_done(_mongocrypt_key_broker_t *kb, _mongocrypt_o
             }
         }
 
+        if (waiting) {
+            /* Remain in KB_AUTHENTICATING until another key broker caches the
+             * token. */
+            return true;
+        }
+
         kb->state = KB_DECRYPTING_KEY_MATERIAL;
+        if (kb->coalesce_kms_decrypts) {
+            return _coalesce_kms_decrypts(kb);
+        }
         return true;
     }
 
+    for (size_t i = 0; i < mc_mapof_kmsid_to_authrequest_len(kb->auth_requests); i++) {
+        auth_request_t *ar = mc_mapof_kmsid_to_authrequest_at(kb->auth_requests, i);
+        if (ar->refresh && ar->returned && !ar->done) {
+            _apply_refresh(kb, ar);
+        }
+    }
+
     for (key_returned = kb->keys_returned; NULL != key_returned; key_returned = key_returned->next) {
+        if (key_returned->kms_deferred || key_returned->cached) {
+            /* Waiting on another key broker, or handled in an earlier round. */
+            continue;
+        }
+
         /* Local keys were already decrypted. */
         if (key_returned->doc->kek.kms_provider == MONGOCRYPT_KMS_PROVIDER_AWS
             || key_returned->doc->kek.kms_provider == MONGOCRYPT_KMS_PROVIDER_AZURE
@@ -956,21 +2173,37 @@ bool _mongocrypt_key_broker_kms_done(_mongocrypt_key_broker_t *kb, _mongocrypt_o
                 return _key_broker_fail_w_msg(kb, "unexpected, KMS not set on key returned");
             }
 
-            if (!_mongocrypt_kms_ctx_result(&key_returned->kms, &key_returned->decrypted_key_material)) {
+            mongocrypt_kms_ctx_t *kms = _result_kms(key_returned);
+            if (!_mongocrypt_kms_ctx_result(kms, &key_returned->decrypted_key_material)) {
                 /* Always fatal. Key attempted to decrypt but failed. */
-                mongocrypt_kms_ctx_status(&key_returned->kms, kb->status);
+                mongocrypt_kms_ctx_status(kms, kb->status);
                 return _key_broker_fail(kb);
             }
         } else if (key_returned->doc->kek.kms_provider == MONGOCRYPT_KMS_PROVIDER_KMIP) {
             _mongocrypt_buffer_t kek;
-            if (!_mongocrypt_kms_ctx_result(&key_returned->kms, &kek)) {
-                mongocrypt_kms_ctx_status(&key_returned->kms, kb->status);
+
+            if (key_returned->decrypted) {
+                /* Unwrapped with a KEK from the KMIP KEK cache, and stored to
+                 * the key cache by _mongocrypt_key_broker_add_doc. */
+                continue;
+            }
+
+            mongocrypt_kms_ctx_t *kms = _result_kms(key_returned);
+            if (key_returned->kmip_batch_leader) {
+                mongocrypt_kms_ctx_t *batch_kms = &key_returned->kmip_batch_leader->kms;
+
+                if (!_mongocrypt_kms_ctx_batch_result(batch_kms, key_returned->kmip_batch_index, &kek)) {
+                    mongocrypt_kms_ctx_status(batch_kms, kb->status);
+                    return _key_broker_fail(kb);
+                }
+            } else if (!_mongocrypt_kms_ctx_result(kms, &kek)) {
+                mongocrypt_kms_ctx_status(kms, kb->status);
                 return _key_broker_fail(kb);
             }
 
             if (key_returned->doc->kek.provider.kmip.delegated) {
-                if (!_mongocrypt_kms_ctx_result(&key_returned->kms, &key_returned->decrypted_key_material)) {
-                    mongocrypt_kms_ctx_status(&key_returned->kms, kb->status);
+                if (!_mongocrypt_kms_ctx_result(kms, &key_returned->decrypted_key_material)) {
+                    mongocrypt_kms_ctx_status(kms, kb->status);
                     return _key_broker_fail(kb);
                 }
             } else if (!_mongocrypt_unwrap_key(kb->crypt->crypto,
@@ -981,6 +2214,14 @@ bool _mongocrypt_key_broker_kms_done(_mongocrypt_key_broker_t *kb, _mongocrypt_o
                 _key_broker_fail(kb);
                 _mongocrypt_buffer_cleanup(&kek);
                 return false;
+            } else if (!_mongocrypt_buffer_empty(&key_returned->kmip_kek_cache_key)
+                       && !_mongocrypt_cache_add_copy(&kb->crypt->cache_kmip_kek,
+                                                      &key_returned->kmip_kek_cache_key,
+                                                      &kek,
+                                                      kb->status)) {
+                _key_broker_fail(kb);
+                _mongocrypt_buffer_cleanup(&kek);
+                return false;
             }
             _mongocrypt_buffer_cleanup(&kek);
         } else if (key_returned->doc->kek.kms_provider != MONGOCRYPT_KMS_PROVIDER_LOCAL) {
@@ -995,6 +2236,16 @@ bool _mongocrypt_key_broker_kms_done(_mongocrypt_key_broker_t *kb, _mongocrypt_o
         if (!_store_to_cache(kb, key_returned)) {
             return false;
         }
+        key_returned->cached = true;
+        if (key_returned->kms_owner) {
+            _kms_inflight_release(kb, &key_returned->doc->id);
+            key_returned->kms_owner = false;
+        }
+    }
+
+    if (kb->coalesce_kms_decrypts) {
+        /* Deferred keys may now be cached, or need a request of their own. */
+        return _coalesce_kms_decrypts(kb);
     }
 
     kb->state = KB_DONE;
@@ -1020,10 +2271,10 @@ static bool _get_decrypted_key_material(_mongocrypt_key_broker_t *kb,
     }
     /* Search both keys_returned and keys_cached. */
 
-    key_returned = _key_returned_find_one(kb->keys_returned, key_id, key_alt_name);
+    key_returned = _key_returned_find_one(&kb->keys_returned_index, key_id, key_alt_name);
     if (!key_returned) {
         /* Try the keys retrieved from the cache. */
-        key_returned = _key_returned_find_one(kb->keys_cached, key_id, key_alt_name);
+        key_returned = _key_returned_find_one(&kb->keys_cached_index, key_id, key_alt_name);
     }
 
     if (!key_returned) {
@@ -1034,7 +2285,12 @@ static bool _get_decrypted_key_material(_mongocrypt_key_broker_t *kb,
         return _key_broker_fail_w_msg(kb, "unexpected, key not decrypted");
     }
 
-    _mongocrypt_buffer_copy_to(&key_returned->decrypted_key_material, out);
+    if (key_returned->cache_value) {
+        /* decrypted_key_material is borrowed. Take a reference from the cache value. */
+        _mongocrypt_buffer_share_to(&key_returned->cache_value->decrypted_key_material, out);
+    } else {
+        _mongocrypt_buffer_share_to(&key_returned->decrypted_key_material, out);
+    }
     if (key_id_out) {
         _mongocrypt_buffer_copy_to(&key_returned->doc->id, key_id_out);
     }
@@ -1058,6 +2314,36 @@ bool _mongocrypt_key_broker_decrypted_key_by_id(_mongocrypt_key_broker_t *kb,
                                        NULL /* key id out */);
 }
 
+const _mongocrypt_cache_key_tokens_t *_mongocrypt_key_broker_key_tokens_by_id(_mongocrypt_key_broker_t *kb,
+                                                                           const _mongocrypt_buffer_t *key_id) {
+    key_returned_t *key_returned;
+
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(key_id);
+
+    key_returned = _key_returned_find_one(&kb->keys_returned_index, (_mongocrypt_buffer_t *)key_id, NULL);
+    if (!key_returned) {
+        key_returned = _key_returned_find_one(&kb->keys_cached_index, (_mongocrypt_buffer_t *)key_id, NULL);
+    }
+    if (!key_returned || !key_returned->decrypted || !key_returned->cache_value) {
+        return NULL;
+    }
+    return key_returned->cache_value->tokens;
+}
+
+bool _mongocrypt_key_broker_has_decrypted_key_by_id(_mongocrypt_key_broker_t *kb, const _mongocrypt_buffer_t *key_id) {
+    key_returned_t *key_returned;
+
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(key_id);
+
+    key_returned = _key_returned_find_one(&kb->keys_returned_index, (_mongocrypt_buffer_t *)key_id, NULL);
+    if (!key_returned) {
+        key_returned = _key_returned_find_one(&kb->keys_cached_index, (_mongocrypt_buffer_t *)key_id, NULL);
+    }
+    return key_returned && key_returned->decrypted;
+}
+
 bool _mongocrypt_key_broker_decrypted_key_by_name(_mongocrypt_key_broker_t *kb,
                                                   const bson_value_t *key_alt_name_value,
                                                   _mongocrypt_buffer_t *out,
@@ -1100,8 +2386,6 @@ static void _destroy_key_requests(key_request_t *head) {
 
         _mongocrypt_buffer_cleanup(&head->id);
         _mongocrypt_key_alt_name_destroy_all(head->alt_name);
-
-        bson_free(head);
         head = tmp;
     }
 }
@@ -1112,11 +2396,18 @@ static void _destroy_keys_returned(key_returned_t *head) {
     while (head) {
         tmp = head->next;
 
-        _mongocrypt_key_destroy(head->doc);
-        _mongocrypt_buffer_cleanup(&head->decrypted_key_material);
+        if (head->cache_value) {
+            /* doc and decrypted_key_material are borrowed. */
+            _mongocrypt_cache_key_value_destroy(head->cache_value);
+        } else {
+            _mongocrypt_key_destroy(head->doc);
+            _mongocrypt_buffer_cleanup(&head->decrypted_key_material);
+        }
+        _mongocrypt_buffer_cleanup(&head->kmip_kek_cache_key);
         _mongocrypt_kms_ctx_cleanup(&head->kms);
-
-        bson_free(head);
+        if (head->hedged) {
+            _mongocrypt_kms_ctx_cleanup(&head->hedge_kms);
+        }
         head = tmp;
     }
 }
@@ -1127,10 +2418,28 @@ void _mongocrypt_key_broker_cleanup(_mongocrypt_key_broker_t *kb) {
     }
     mongocrypt_status_destroy(kb->status);
     _mongocrypt_buffer_cleanup(&kb->filter);
+    _mongocrypt_buffer_cleanup(&kb->projection);
+    for (key_returned_t *key_returned = kb->keys_returned; NULL != key_returned; key_returned = key_returned->next) {
+        if (key_returned->kms_owner) {
+            /* Let a waiting key broker issue its own request. */
+            _kms_inflight_release(kb, &key_returned->doc->id);
+        }
+    }
+    for (size_t i = 0; i < mc_mapof_kmsid_to_authrequest_len(kb->auth_requests); i++) {
+        auth_request_t *ar = mc_mapof_kmsid_to_authrequest_at(kb->auth_requests, i);
+        if (ar->claimed && !ar->done) {
+            /* Let another key broker fetch the token. */
+            mc_mapof_kmsid_to_token_abandon_fetch(kb->crypt->cache_oauth, ar->kmsid);
+        }
+    }
     /* Delete all linked lists */
     _destroy_keys_returned(kb->keys_returned);
     _destroy_keys_returned(kb->keys_cached);
     _destroy_key_requests(kb->key_requests);
+    mc_arena_cleanup(&kb->arena);
+    _key_index_cleanup(&kb->keys_returned_index);
+    _key_index_cleanup(&kb->keys_cached_index);
+    _key_index_cleanup(&kb->key_requests_index);
     mc_mapof_kmsid_to_authrequest_destroy(kb->auth_requests);
 }
 
@@ -1144,7 +2453,7 @@ void _mongocrypt_key_broker_add_test_key(_mongocrypt_key_broker_t *kb, const _mo
     key_doc = _mongocrypt_key_new();
     _mongocrypt_buffer_copy_to(key_id, &key_doc->id);
 
-    key_returned = _key_returned_prepend(kb, &kb->keys_returned, key_doc);
+    key_returned = _key_returned_prepend(kb, &kb->keys_returned, &kb->keys_returned_index, key_doc);
     key_returned->decrypted = true;
     _mongocrypt_buffer_init(&key_returned->decrypted_key_material);
     _mongocrypt_buffer_resize(&key_returned->decrypted_key_material, MONGOCRYPT_KEY_LEN);
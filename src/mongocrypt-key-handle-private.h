@@ -0,0 +1,33 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MONGOCRYPT_KEY_HANDLE_PRIVATE_H
+#define MONGOCRYPT_KEY_HANDLE_PRIVATE_H
+
+#include "mongocrypt-private.h"
+
+struct _mongocrypt_key_handle_t {
+    mongocrypt_t *crypt;
+    mongocrypt_status_t *status;
+    mongocrypt_encryption_algorithm_t algorithm;
+    _mongocrypt_buffer_t key_id;
+    /* key_material shares the decrypted key of the key broker it was taken
+     * from. */
+    _mongocrypt_buffer_t key_material;
+    /* result is the output of the last encrypt or decrypt. */
+    _mongocrypt_buffer_t result;
+};
+
+#endif /* MONGOCRYPT_KEY_HANDLE_PRIVATE_H */
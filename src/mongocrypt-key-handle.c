@@ -0,0 +1,273 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mongocrypt-ciphertext-private.h"
+#include "mongocrypt-ctx-private.h"
+#include "mongocrypt-key-handle-private.h"
+
+static bool _handle_fail_w_msg(mongocrypt_key_handle_t *handle, const char *msg) {
+    mongocrypt_status_t *status;
+
+    BSON_ASSERT_PARAM(handle);
+    BSON_ASSERT_PARAM(msg);
+
+    status = handle->status;
+    CLIENT_ERR("%s", msg);
+    return false;
+}
+
+mongocrypt_key_handle_t *mongocrypt_ctx_key_handle(mongocrypt_ctx_t *ctx) {
+    _mongocrypt_ctx_encrypt_t *ectx;
+    mongocrypt_key_handle_t *handle;
+    _mongocrypt_buffer_t key_id;
+    _mongocrypt_buffer_t key_material;
+    bool key_found;
+
+    if (!ctx) {
+        return NULL;
+    }
+    if (!ctx->initialized) {
+        _mongocrypt_ctx_fail_w_msg(ctx, "ctx NULL or uninitialized");
+        return NULL;
+    }
+    ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+    if (ctx->type != _MONGOCRYPT_TYPE_ENCRYPT || !ectx->explicit) {
+        _mongocrypt_ctx_fail_w_msg(ctx, "not applicable to context");
+        return NULL;
+    }
+    if (ctx->opts.index_type.set) {
+        _mongocrypt_ctx_fail_w_msg(ctx, "key handles only support the Deterministic and Random algorithms");
+        return NULL;
+    }
+    if (ctx->state == MONGOCRYPT_CTX_ERROR) {
+        return NULL;
+    }
+    if (ctx->state != MONGOCRYPT_CTX_READY && ctx->state != MONGOCRYPT_CTX_DONE) {
+        _mongocrypt_ctx_fail_w_msg(ctx, "wrong state");
+        return NULL;
+    }
+
+    _mongocrypt_buffer_init(&key_id);
+    _mongocrypt_buffer_init(&key_material);
+    if (ctx->opts.key_alt_names) {
+        key_found = _mongocrypt_key_broker_decrypted_key_by_name(&ctx->kb,
+                                                                 &ctx->opts.key_alt_names->value,
+                                                                 &key_material,
+                                                                 &key_id);
+    } else {
+        key_found = _mongocrypt_key_broker_decrypted_key_by_id(&ctx->kb, &ctx->opts.key_id, &key_material);
+        _mongocrypt_buffer_copy_to(&ctx->opts.key_id, &key_id);
+    }
+    if (!key_found) {
+        _mongocrypt_key_broker_status(&ctx->kb, ctx->status);
+        _mongocrypt_ctx_fail(ctx);
+        _mongocrypt_buffer_cleanup(&key_id);
+        _mongocrypt_buffer_cleanup(&key_material);
+        return NULL;
+    }
+
+    handle = bson_malloc0(sizeof(*handle));
+    BSON_ASSERT(handle);
+    handle->crypt = ctx->crypt;
+    handle->status = mongocrypt_status_new();
+    handle->algorithm = ctx->opts.algorithm;
+    _mongocrypt_buffer_steal(&handle->key_id, &key_id);
+    _mongocrypt_buffer_steal(&handle->key_material, &key_material);
+    return handle;
+}
+
+/* _parse_msg sets @iter to the value 'v' of the document @msg. */
+static bool _parse_msg(mongocrypt_key_handle_t *handle, mongocrypt_binary_t *msg, bson_iter_t *iter) {
+    bson_t as_bson;
+
+    BSON_ASSERT_PARAM(handle);
+    BSON_ASSERT_PARAM(iter);
+
+    if (!msg || !msg->data) {
+        return _handle_fail_w_msg(handle, "invalid msg");
+    }
+    if (!_mongocrypt_binary_to_bson(msg, &as_bson)) {
+        return _handle_fail_w_msg(handle, "malformed bson");
+    }
+    if (!bson_iter_init_find(iter, &as_bson, "v")) {
+        return _handle_fail_w_msg(handle, "invalid msg, must contain 'v'");
+    }
+    return true;
+}
+
+/* _set_result sets the result of @handle to the document {v: @value}. */
+static void _set_result(mongocrypt_key_handle_t *handle, const bson_value_t *value, mongocrypt_binary_t *out) {
+    bson_t *result;
+
+    BSON_ASSERT_PARAM(handle);
+    BSON_ASSERT_PARAM(value);
+    BSON_ASSERT_PARAM(out);
+
+    result = bson_new();
+    BSON_ASSERT(bson_append_value(result, MONGOCRYPT_STR_AND_LEN("v"), value));
+    _mongocrypt_buffer_cleanup(&handle->result);
+    _mongocrypt_buffer_steal_from_bson(&handle->result, result);
+    _mongocrypt_buffer_to_binary(&handle->result, out);
+}
+
+bool mongocrypt_key_handle_encrypt(mongocrypt_key_handle_t *handle,
+                                   mongocrypt_binary_t *msg,
+                                   mongocrypt_binary_t *out) {
+    _mongocrypt_ciphertext_t ciphertext;
+    _mongocrypt_buffer_t serialized;
+    bson_value_t value;
+    bson_iter_t iter;
+    mongocrypt_status_t *status;
+    bool ret = false;
+
+    if (!handle) {
+        return false;
+    }
+    if (!out) {
+        return _handle_fail_w_msg(handle, "invalid NULL output");
+    }
+    _mongocrypt_status_reset(handle->status);
+    if (!_parse_msg(handle, msg, &iter)) {
+        return false;
+    }
+
+    status = handle->status;
+    if (!_mongocrypt_permitted_for_encryption(&iter, handle->algorithm, status)) {
+        return false;
+    }
+
+    _mongocrypt_ciphertext_init(&ciphertext);
+    _mongocrypt_buffer_init(&serialized);
+    if (!_mongocrypt_fle1_encrypt(handle->crypt,
+                                  handle->algorithm,
+                                  &handle->key_id,
+                                  &handle->key_material,
+                                  &iter,
+                                  &ciphertext,
+                                  status)) {
+        goto fail;
+    }
+    if (!_mongocrypt_serialize_ciphertext(&ciphertext, &serialized)) {
+        CLIENT_ERR("could not serialize ciphertext");
+        goto fail;
+    }
+    value.value_type = BSON_TYPE_BINARY;
+    value.value.v_binary.data = serialized.data;
+    value.value.v_binary.data_len = serialized.len;
+    value.value.v_binary.subtype = (bson_subtype_t)BSON_SUBTYPE_ENCRYPTED;
+    _set_result(handle, &value, out);
+    _mongocrypt_counter_add(handle->crypt, MC_COUNTER_ENCRYPTED_FLE1, 1);
+    ret = true;
+
+fail:
+    _mongocrypt_buffer_cleanup(&serialized);
+    _mongocrypt_ciphertext_cleanup(&ciphertext);
+    return ret;
+}
+
+bool mongocrypt_key_handle_decrypt(mongocrypt_key_handle_t *handle,
+                                   mongocrypt_binary_t *msg,
+                                   mongocrypt_binary_t *out) {
+    _mongocrypt_ciphertext_t ciphertext;
+    _mongocrypt_buffer_t in;
+    _mongocrypt_buffer_t plaintext;
+    bson_type_t type;
+    bson_value_t value;
+    bson_iter_t iter;
+    mongocrypt_status_t *status;
+    bool ret = false;
+
+    if (!handle) {
+        return false;
+    }
+    if (!out) {
+        return _handle_fail_w_msg(handle, "invalid NULL output");
+    }
+    _mongocrypt_status_reset(handle->status);
+    if (!_parse_msg(handle, msg, &iter)) {
+        return false;
+    }
+
+    status = handle->status;
+    _mongocrypt_buffer_init(&in);
+    _mongocrypt_buffer_init(&plaintext);
+    if (!_mongocrypt_buffer_from_binary_iter(&in, &iter) || in.subtype != BSON_SUBTYPE_ENCRYPTED) {
+        CLIENT_ERR("invalid msg, 'v' must contain a binary of subtype %d", (int)BSON_SUBTYPE_ENCRYPTED);
+        goto fail;
+    }
+    if (in.len == 0
+        || (in.data[0] != MC_SUBTYPE_FLE1DeterministicEncryptedValue
+            && in.data[0] != MC_SUBTYPE_FLE1RandomEncryptedValue)) {
+        CLIENT_ERR("key handles only decrypt values of the Deterministic and Random algorithms");
+        goto fail;
+    }
+    if (!_mongocrypt_ciphertext_parse_unowned(&in, &ciphertext, status)) {
+        goto fail;
+    }
+    if (0 != _mongocrypt_buffer_cmp(&ciphertext.key_id, &handle->key_id)) {
+        CLIENT_ERR("value was not encrypted with the key of the handle");
+        goto fail;
+    }
+    if (!_mongocrypt_fle1_decrypt(handle->crypt->crypto,
+                                  &ciphertext,
+                                  &handle->key_material,
+                                  &type,
+                                  &plaintext,
+                                  status)) {
+        goto fail;
+    }
+    if (!_mongocrypt_buffer_to_bson_value(&plaintext, (uint8_t)type, &value)) {
+        CLIENT_ERR("malformed encrypted bson");
+        goto fail;
+    }
+    _set_result(handle, &value, out);
+    bson_value_destroy(&value);
+    _mongocrypt_counter_add(handle->crypt, MC_COUNTER_DECRYPTED_FLE1, 1);
+    ret = true;
+
+fail:
+    _mongocrypt_buffer_cleanup(&plaintext);
+    _mongocrypt_buffer_cleanup(&in);
+    return ret;
+}
+
+bool mongocrypt_key_handle_status(mongocrypt_key_handle_t *handle, mongocrypt_status_t *out) {
+    if (!handle) {
+        return false;
+    }
+    if (!out) {
+        return _handle_fail_w_msg(handle, "invalid NULL output");
+    }
+
+    if (!mongocrypt_status_ok(handle->status)) {
+        _mongocrypt_status_copy_to(handle->status, out);
+        return false;
+    }
+    _mongocrypt_status_reset(out);
+    return true;
+}
+
+void mongocrypt_key_handle_destroy(mongocrypt_key_handle_t *handle) {
+    if (!handle) {
+        return;
+    }
+
+    _mongocrypt_buffer_cleanup(&handle->result);
+    _mongocrypt_buffer_cleanup(&handle->key_material);
+    _mongocrypt_buffer_cleanup(&handle->key_id);
+    mongocrypt_status_destroy(handle->status);
+    bson_free(handle);
+}
@@ -50,10 +50,28 @@ bool _mongocrypt_key_parse_owned(const bson_t *bson,
                                  _mongocrypt_key_doc_t *out,
                                  mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
 
+/* Parses a key document returned with the projection of
+ * _mongocrypt_key_broker_projection. Only '_id', 'keyMaterial' and
+ * 'masterKey' are required. Full key documents are also accepted. */
+bool _mongocrypt_key_parse_projected_owned(const bson_t *bson,
+                                           _mongocrypt_key_doc_t *out,
+                                           mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
 _mongocrypt_key_doc_t *_mongocrypt_key_new(void);
 
 void _mongocrypt_key_doc_copy_to(_mongocrypt_key_doc_t *src, _mongocrypt_key_doc_t *dst);
 
+/* Like _mongocrypt_key_doc_copy_to, but does not copy the original BSON. Use
+ * _mongocrypt_key_doc_append to recreate a key document from @dst. */
+void _mongocrypt_key_doc_copy_compact_to(const _mongocrypt_key_doc_t *src, _mongocrypt_key_doc_t *dst);
+
+/* Appends the fields of @key to @out as a key document. Only the fields
+ * parsed into @key are appended, so the result can be parsed with
+ * _mongocrypt_key_parse_projected_owned. */
+bool _mongocrypt_key_doc_append(const _mongocrypt_key_doc_t *key,
+                                bson_t *out,
+                                mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
 void _mongocrypt_key_destroy(_mongocrypt_key_doc_t *key);
 
 const char *_mongocrypt_key_alt_name_get_string(_mongocrypt_key_alt_name_t *key_alt_name);
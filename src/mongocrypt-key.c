@@ -125,8 +125,10 @@ bool _mongocrypt_key_alt_name_from_iter(const bson_iter_t *iter_in,
     return true;
 }
 
-/* Takes ownership of all fields. */
-bool _mongocrypt_key_parse_owned(const bson_t *bson, _mongocrypt_key_doc_t *out, mongocrypt_status_t *status) {
+/* Takes ownership of all fields. If @projected, the metadata fields the key
+ * broker does not use are optional. */
+static bool
+_key_parse_owned(const bson_t *bson, _mongocrypt_key_doc_t *out, bool projected, mongocrypt_status_t *status) {
     bson_iter_t iter = {0};
     bool has_id = false, has_key_material = false, has_status = false, has_creation_date = false,
          has_update_date = false, has_master_key = false;
@@ -250,6 +252,10 @@ bool _mongocrypt_key_parse_owned(const bson_t *bson, _mongocrypt_key_doc_t *out,
         return false;
     }
 
+    if (projected) {
+        return true;
+    }
+
     if (!has_status) {
         CLIENT_ERR("invalid key, no 'status'");
         return false;
@@ -268,6 +274,16 @@ bool _mongocrypt_key_parse_owned(const bson_t *bson, _mongocrypt_key_doc_t *out,
     return true;
 }
 
+bool _mongocrypt_key_parse_owned(const bson_t *bson, _mongocrypt_key_doc_t *out, mongocrypt_status_t *status) {
+    return _key_parse_owned(bson, out, false /* projected */, status);
+}
+
+bool _mongocrypt_key_parse_projected_owned(const bson_t *bson,
+                                           _mongocrypt_key_doc_t *out,
+                                           mongocrypt_status_t *status) {
+    return _key_parse_owned(bson, out, true /* projected */, status);
+}
+
 _mongocrypt_key_doc_t *_mongocrypt_key_new(void) {
     _mongocrypt_key_doc_t *key_doc;
 
@@ -305,6 +321,76 @@ void _mongocrypt_key_doc_copy_to(_mongocrypt_key_doc_t *src, _mongocrypt_key_doc
     dst->update_date = src->update_date;
 }
 
+void _mongocrypt_key_doc_copy_compact_to(const _mongocrypt_key_doc_t *src, _mongocrypt_key_doc_t *dst) {
+    BSON_ASSERT_PARAM(src);
+    BSON_ASSERT_PARAM(dst);
+
+    _mongocrypt_buffer_copy_to(&src->id, &dst->id);
+    _mongocrypt_buffer_copy_to(&src->key_material, &dst->key_material);
+    dst->key_alt_names = _mongocrypt_key_alt_name_copy_all(src->key_alt_names);
+    _mongocrypt_kek_copy_to(&src->kek, &dst->kek);
+    dst->creation_date = src->creation_date;
+    dst->update_date = src->update_date;
+}
+
+bool _mongocrypt_key_doc_append(const _mongocrypt_key_doc_t *key, bson_t *out, mongocrypt_status_t *status) {
+    bson_t child;
+    uint32_t i = 0;
+
+    BSON_ASSERT_PARAM(key);
+    BSON_ASSERT_PARAM(out);
+
+    if (!_mongocrypt_buffer_append(&key->id, out, "_id", -1)) {
+        CLIENT_ERR("failed to append '_id'");
+        return false;
+    }
+
+    if (key->key_alt_names) {
+        if (!BSON_APPEND_ARRAY_BEGIN(out, "keyAltNames", &child)) {
+            CLIENT_ERR("failed to append 'keyAltNames'");
+            return false;
+        }
+        for (_mongocrypt_key_alt_name_t *name = key->key_alt_names; name; name = name->next) {
+            char storage[16];
+            const char *index;
+
+            bson_uint32_to_string(i++, &index, storage, sizeof(storage));
+            if (!bson_append_value(&child, index, -1, &name->value)) {
+                CLIENT_ERR("failed to append 'keyAltNames'");
+                return false;
+            }
+        }
+        if (!bson_append_array_end(out, &child)) {
+            CLIENT_ERR("failed to append 'keyAltNames'");
+            return false;
+        }
+    }
+
+    if (!_mongocrypt_buffer_append(&key->key_material, out, "keyMaterial", -1)) {
+        CLIENT_ERR("failed to append 'keyMaterial'");
+        return false;
+    }
+
+    if (!BSON_APPEND_DOCUMENT_BEGIN(out, "masterKey", &child)) {
+        CLIENT_ERR("failed to append 'masterKey'");
+        return false;
+    }
+    if (!_mongocrypt_kek_append(&key->kek, &child, status)) {
+        return false;
+    }
+    if (!bson_append_document_end(out, &child)) {
+        CLIENT_ERR("failed to append 'masterKey'");
+        return false;
+    }
+
+    if (!BSON_APPEND_DATE_TIME(out, "creationDate", key->creation_date)
+        || !BSON_APPEND_DATE_TIME(out, "updateDate", key->update_date)) {
+        CLIENT_ERR("failed to append key dates");
+        return false;
+    }
+    return true;
+}
+
 _mongocrypt_key_alt_name_t *_mongocrypt_key_alt_name_copy_all(_mongocrypt_key_alt_name_t *ptr) {
     _mongocrypt_key_alt_name_t *ptr_copy = NULL, *head = NULL;
 
@@ -0,0 +1,1044 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mc-array-private.h"
+#include "mongocrypt-ctx-private.h"
+#include "mongocrypt-kms-ctx-private.h"
+#include "mongocrypt-private.h"
+
+#ifdef MONGOCRYPT_ENABLE_KMS_CLIENT
+#include <errno.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+#ifndef MSG_NOSIGNAL
+/* macOS has no MSG_NOSIGNAL. Sockets are created with SO_NOSIGPIPE. */
+#define MSG_NOSIGNAL 0
+#endif
+#endif
+
+#define KMS_CLIENT_DEFAULT_TIMEOUT_MS 10000
+/* Idle connections kept for each endpoint, and for how long. */
+#define KMS_CLIENT_MAX_IDLE 4
+#define KMS_CLIENT_IDLE_USEC ((int64_t)30 * 1000 * 1000)
+/* The size of a TLS record. */
+#define KMS_CLIENT_BUF_LEN 16384
+
+typedef struct {
+    char *kms_provider;
+    char *path;
+#ifdef MONGOCRYPT_ENABLE_KMS_CLIENT
+    SSL_CTX *ssl_ctx;
+#endif
+} _kms_cert_key_t;
+
+struct _mongocrypt_kms_client_t {
+    mongocrypt_status_t *status;
+    int64_t timeout_ms;
+    char *ca_file;
+    /* cert_key_files holds the _kms_cert_key_t of each KMS provider with a
+     * client certificate. */
+    mc_array_t cert_key_files;
+    /* ran is set on the first run. TLS options cannot change after. */
+    bool ran;
+#ifdef MONGOCRYPT_ENABLE_KMS_CLIENT
+    /* ssl_ctx is used for KMS providers without a client certificate. It is
+     * created on first use. */
+    SSL_CTX *ssl_ctx;
+    /* endpoints holds a _kms_endpoint_t pointer for each endpoint and KMS
+     * provider that was sent a request. */
+    mc_array_t endpoints;
+#endif
+};
+
+#ifdef MONGOCRYPT_ENABLE_KMS_CLIENT
+
+/* _kms_conn_t is a TLS connection. TLS records go through memory BIOs, so the
+ * socket is only written with send, which does not raise SIGPIPE. */
+typedef struct {
+    int fd;
+    SSL *ssl;
+    BIO *rbio;
+    BIO *wbio;
+    /* out holds the bytes of wbio that are not sent yet. */
+    uint8_t out[KMS_CLIENT_BUF_LEN];
+    size_t out_off;
+    size_t out_len;
+    int64_t idle_since_us;
+} _kms_conn_t;
+
+/* _kms_endpoint_t pools the connections to one endpoint of one KMS provider. */
+typedef struct {
+    char *kmsid;
+    char *endpoint;
+    char *host;
+    char *port;
+    /* ssl_ctx is borrowed from the client. */
+    SSL_CTX *ssl_ctx;
+    /* session is the TLS session of the last complete response, or NULL. */
+    SSL_SESSION *session;
+    /* idle holds _kms_conn_t pointers, the most recently used last. */
+    mc_array_t idle;
+} _kms_endpoint_t;
+
+typedef enum {
+    /* Waiting until send_us to send the request. */
+    KMS_OP_WAITING,
+    KMS_OP_CONNECTING,
+    KMS_OP_HANDSHAKE,
+    KMS_OP_READING,
+} _kms_op_state_t;
+
+/* _kms_op_t is one attempt of a KMS request. */
+typedef struct {
+    mongocrypt_kms_ctx_t *kms;
+    _kms_endpoint_t *ep;
+    _kms_op_state_t state;
+    _kms_conn_t *conn;
+    /* addrs are the resolved addresses of the endpoint, and next_addr the
+     * address to try if connecting fails. */
+    struct addrinfo *addrs;
+    struct addrinfo *next_addr;
+    /* reused is set if conn was taken from the pool. received is set once a
+     * byte of the response is read. A pooled connection closed by the server
+     * before any byte is read is replaced by a new connection, and fresh is set
+     * to not take another one from the pool. */
+    bool reused;
+    bool received;
+    bool fresh;
+    int64_t send_us;
+    int64_t deadline_us;
+    short revents;
+} _kms_op_t;
+
+typedef enum {
+    KMS_OP_PENDING,
+    KMS_OP_DONE,
+    KMS_OP_NETWORK_ERROR,
+    KMS_OP_CTX_ERROR,
+} _kms_op_result_t;
+
+/* _ssl_error_string sets @buf to the description of the last OpenSSL error of
+ * this thread, and clears the errors. */
+static const char *_ssl_error_string(char *buf, size_t len) {
+    unsigned long err = ERR_get_error();
+
+    BSON_ASSERT_PARAM(buf);
+
+    if (err == 0) {
+        bson_strncpy(buf, "unknown error", len);
+    } else {
+        ERR_error_string_n(err, buf, len);
+    }
+    ERR_clear_error();
+    return buf;
+}
+
+static SSL_CTX *_ssl_ctx_new(const char *ca_file, const char *cert_key_file, mongocrypt_status_t *status) {
+    SSL_CTX *ssl_ctx;
+    char err[256];
+
+    ssl_ctx = SSL_CTX_new(TLS_client_method());
+    if (!ssl_ctx) {
+        CLIENT_ERR("failed to create TLS context: %s", _ssl_error_string(err, sizeof err));
+        return NULL;
+    }
+    SSL_CTX_set_min_proto_version(ssl_ctx, TLS1_2_VERSION);
+    SSL_CTX_set_verify(ssl_ctx, SSL_VERIFY_PEER, NULL);
+
+    if (ca_file ? 1 != SSL_CTX_load_verify_locations(ssl_ctx, ca_file, NULL)
+                : 1 != SSL_CTX_set_default_verify_paths(ssl_ctx)) {
+        CLIENT_ERR("failed to load CA certificates: %s", _ssl_error_string(err, sizeof err));
+        goto fail;
+    }
+    if (cert_key_file
+        && (1 != SSL_CTX_use_certificate_chain_file(ssl_ctx, cert_key_file)
+            || 1 != SSL_CTX_use_PrivateKey_file(ssl_ctx, cert_key_file, SSL_FILETYPE_PEM)
+            || 1 != SSL_CTX_check_private_key(ssl_ctx))) {
+        CLIENT_ERR("failed to load client certificate '%s': %s", cert_key_file, _ssl_error_string(err, sizeof err));
+        goto fail;
+    }
+    return ssl_ctx;
+
+fail:
+    SSL_CTX_free(ssl_ctx);
+    return NULL;
+}
+
+static void _conn_destroy(_kms_conn_t *conn) {
+    if (!conn) {
+        return;
+    }
+    /* The BIOs are owned by the SSL object once set. */
+    if (conn->ssl) {
+        /* Connections are closed without a TLS shutdown. OpenSSL would mark
+         * the session not resumable, and it may be the endpoint's session. */
+        SSL_set_shutdown(conn->ssl, SSL_SENT_SHUTDOWN);
+        SSL_free(conn->ssl);
+    } else {
+        BIO_free(conn->rbio);
+        BIO_free(conn->wbio);
+    }
+    if (conn->fd >= 0) {
+        close(conn->fd);
+    }
+    bson_free(conn);
+}
+
+/* _conn_flush sends the TLS records written by OpenSSL. Returns false on a
+ * socket error. Bytes that cannot be sent without blocking stay in out. */
+static bool _conn_flush(_kms_conn_t *conn) {
+    BSON_ASSERT_PARAM(conn);
+
+    for (;;) {
+        ssize_t sent;
+
+        if (conn->out_off == conn->out_len) {
+            const int n = BIO_read(conn->wbio, conn->out, (int)sizeof conn->out);
+
+            conn->out_off = conn->out_len = 0;
+            if (n <= 0) {
+                return true;
+            }
+            conn->out_len = (size_t)n;
+        }
+        sent = send(conn->fd, conn->out + conn->out_off, conn->out_len - conn->out_off, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        conn->out_off += (size_t)sent;
+    }
+}
+
+static bool _conn_flushed(_kms_conn_t *conn) {
+    BSON_ASSERT_PARAM(conn);
+
+    return conn->out_off == conn->out_len && BIO_ctrl_pending(conn->wbio) == 0;
+}
+
+/* _conn_fill passes the bytes received on the socket to OpenSSL. Returns false
+ * on a socket error. At the end of the stream, OpenSSL reads EOF. */
+static bool _conn_fill(_kms_conn_t *conn) {
+    uint8_t buf[KMS_CLIENT_BUF_LEN];
+
+    BSON_ASSERT_PARAM(conn);
+
+    for (;;) {
+        const ssize_t n = recv(conn->fd, buf, sizeof buf, 0);
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        if (n == 0) {
+            BIO_set_mem_eof_return(conn->rbio, 0);
+            return true;
+        }
+        if (BIO_write(conn->rbio, buf, (int)n) != (int)n) {
+            return false;
+        }
+    }
+}
+
+/* _conn_result returns 1 if the OpenSSL call that returned @ret succeeded, 0
+ * if it waits for more bytes, or -1 on an error. */
+static int _conn_result(_kms_conn_t *conn, int ret) {
+    BSON_ASSERT_PARAM(conn);
+
+    if (ret > 0) {
+        return 1;
+    }
+    switch (SSL_get_error(conn->ssl, ret)) {
+    case SSL_ERROR_WANT_READ:
+    case SSL_ERROR_WANT_WRITE: return 0;
+    default: return -1;
+    }
+}
+
+/* _conn_is_stale returns true if an idle connection can no longer be used: it
+ * was idle for too long, or the server closed it or sent unexpected bytes. */
+static bool _conn_is_stale(_kms_conn_t *conn, int64_t now) {
+    struct pollfd pfd = {0};
+
+    BSON_ASSERT_PARAM(conn);
+
+    if (now - conn->idle_since_us > KMS_CLIENT_IDLE_USEC) {
+        return true;
+    }
+    pfd.fd = conn->fd;
+    pfd.events = POLLIN;
+    return 0 != poll(&pfd, 1, 0);
+}
+
+static void _endpoint_destroy(_kms_endpoint_t *ep) {
+    if (!ep) {
+        return;
+    }
+    for (size_t i = 0; i < ep->idle.len; i++) {
+        _conn_destroy(_mc_array_index(&ep->idle, _kms_conn_t *, i));
+    }
+    _mc_array_destroy(&ep->idle);
+    if (ep->session) {
+        SSL_SESSION_free(ep->session);
+    }
+    bson_free(ep->kmsid);
+    bson_free(ep->endpoint);
+    bson_free(ep->host);
+    bson_free(ep->port);
+    bson_free(ep);
+}
+
+/* _endpoint_take returns a pooled connection to @ep, or NULL. */
+static _kms_conn_t *_endpoint_take(_kms_endpoint_t *ep) {
+    const int64_t now = bson_get_monotonic_time();
+
+    BSON_ASSERT_PARAM(ep);
+
+    while (ep->idle.len > 0) {
+        _kms_conn_t *conn = _mc_array_index(&ep->idle, _kms_conn_t *, ep->idle.len - 1u);
+
+        ep->idle.len--;
+        if (!_conn_is_stale(conn, now)) {
+            return conn;
+        }
+        _conn_destroy(conn);
+    }
+    return NULL;
+}
+
+/* _endpoint_put pools @conn after a complete response, and keeps its session
+ * to resume later connections. */
+static void _endpoint_put(_kms_endpoint_t *ep, _kms_conn_t *conn) {
+    SSL_SESSION *session;
+
+    BSON_ASSERT_PARAM(ep);
+    BSON_ASSERT_PARAM(conn);
+
+    session = SSL_get1_session(conn->ssl);
+    if (session) {
+        if (ep->session) {
+            SSL_SESSION_free(ep->session);
+        }
+        ep->session = session;
+    }
+    if (!_conn_flushed(conn) || ep->idle.len >= KMS_CLIENT_MAX_IDLE) {
+        _conn_destroy(conn);
+        return;
+    }
+    conn->idle_since_us = bson_get_monotonic_time();
+    _mc_array_append_val(&ep->idle, conn);
+}
+
+/* _client_ssl_ctx returns the TLS context for requests to @kmsid. */
+static SSL_CTX *_client_ssl_ctx(mongocrypt_kms_client_t *client, const char *kmsid, mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(client);
+    BSON_ASSERT_PARAM(kmsid);
+
+    for (size_t i = 0; i < client->cert_key_files.len; i++) {
+        _kms_cert_key_t *ck = &_mc_array_index(&client->cert_key_files, _kms_cert_key_t, i);
+
+        if (0 == strcmp(ck->kms_provider, kmsid)) {
+            if (!ck->ssl_ctx) {
+                ck->ssl_ctx = _ssl_ctx_new(client->ca_file, ck->path, status);
+            }
+            return ck->ssl_ctx;
+        }
+    }
+    if (!client->ssl_ctx) {
+        client->ssl_ctx = _ssl_ctx_new(client->ca_file, NULL, status);
+    }
+    return client->ssl_ctx;
+}
+
+/* _client_endpoint returns the pool of @endpoint for @kmsid. */
+static _kms_endpoint_t *_client_endpoint(mongocrypt_kms_client_t *client,
+                                         const char *kmsid,
+                                         const char *endpoint,
+                                         mongocrypt_status_t *status) {
+    _kms_endpoint_t *ep;
+    SSL_CTX *ssl_ctx;
+    const char *colon;
+
+    BSON_ASSERT_PARAM(client);
+    BSON_ASSERT_PARAM(kmsid);
+    BSON_ASSERT_PARAM(endpoint);
+
+    for (size_t i = 0; i < client->endpoints.len; i++) {
+        ep = _mc_array_index(&client->endpoints, _kms_endpoint_t *, i);
+        if (0 == strcmp(ep->kmsid, kmsid) && 0 == strcmp(ep->endpoint, endpoint)) {
+            return ep;
+        }
+    }
+
+    /* The endpoint always has a port. */
+    colon = strrchr(endpoint, ':');
+    if (!colon || colon == endpoint || colon[1] == '\0') {
+        CLIENT_ERR("invalid KMS endpoint: '%s'", endpoint);
+        return NULL;
+    }
+    ssl_ctx = _client_ssl_ctx(client, kmsid, status);
+    if (!ssl_ctx) {
+        return NULL;
+    }
+
+    ep = bson_malloc0(sizeof(*ep));
+    ep->kmsid = bson_strdup(kmsid);
+    ep->endpoint = bson_strdup(endpoint);
+    if (endpoint[0] == '[' && colon[-1] == ']') {
+        /* An IPv6 address: [::1]:443 */
+        ep->host = bson_strndup(endpoint + 1, (size_t)(colon - endpoint) - 2);
+    } else {
+        ep->host = bson_strndup(endpoint, (size_t)(colon - endpoint));
+    }
+    ep->port = bson_strdup(colon + 1);
+    ep->ssl_ctx = ssl_ctx;
+    _mc_array_init(&ep->idle, sizeof(_kms_conn_t *));
+    _mc_array_append_val(&client->endpoints, ep);
+    return ep;
+}
+
+static void _op_close(_kms_op_t *op) {
+    BSON_ASSERT_PARAM(op);
+
+    _conn_destroy(op->conn);
+    op->conn = NULL;
+    if (op->addrs) {
+        freeaddrinfo(op->addrs);
+    }
+    op->addrs = op->next_addr = NULL;
+}
+
+/* _is_ip_literal returns true if @host is an IPv4 or IPv6 address. */
+static bool _is_ip_literal(const char *host) {
+    unsigned char addr[sizeof(struct in6_addr)];
+
+    BSON_ASSERT_PARAM(host);
+
+    return 1 == inet_pton(AF_INET, host, addr) || 1 == inet_pton(AF_INET6, host, addr);
+}
+
+/* _op_start_tls starts the handshake on the connected socket of @op. */
+static bool _op_start_tls(_kms_op_t *op) {
+    _kms_conn_t *conn;
+
+    BSON_ASSERT_PARAM(op);
+
+    conn = op->conn;
+    conn->ssl = SSL_new(op->ep->ssl_ctx);
+    if (!conn->ssl) {
+        return false;
+    }
+    SSL_set_bio(conn->ssl, conn->rbio, conn->wbio);
+    SSL_set_connect_state(conn->ssl);
+    if (_is_ip_literal(op->ep->host)) {
+        /* SNI does not allow IP addresses. Match the certificate's IP SAN. */
+        if (1 != X509_VERIFY_PARAM_set1_ip_asc(SSL_get0_param(conn->ssl), op->ep->host)) {
+            return false;
+        }
+    } else if (1 != SSL_set_tlsext_host_name(conn->ssl, op->ep->host) || 1 != SSL_set1_host(conn->ssl, op->ep->host)) {
+        return false;
+    }
+    if (op->ep->session) {
+        SSL_set_session(conn->ssl, op->ep->session);
+    }
+    op->state = KMS_OP_HANDSHAKE;
+    return true;
+}
+
+/* _op_connect connects a new socket to the next address of @op. Sets @reason
+ * if no address is left. */
+static bool _op_connect(_kms_op_t *op, const char **reason) {
+    BSON_ASSERT_PARAM(op);
+    BSON_ASSERT_PARAM(reason);
+
+    if (!op->addrs) {
+        struct addrinfo hints = {0};
+
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        if (0 != getaddrinfo(op->ep->host, op->ep->port, &hints, &op->addrs)) {
+            *reason = "failed to resolve the KMS endpoint";
+            return false;
+        }
+        op->next_addr = op->addrs;
+    }
+
+    for (; op->next_addr; op->next_addr = op->next_addr->ai_next) {
+        const struct addrinfo *addr = op->next_addr;
+        const int one = 1;
+        int fd;
+
+        fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        if (-1 == fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) || -1 == fcntl(fd, F_SETFD, FD_CLOEXEC)) {
+            close(fd);
+            continue;
+        }
+        /* A request is sent as a whole, so do not delay the last segment. */
+        (void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+#ifdef SO_NOSIGPIPE
+        (void)setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof one);
+#endif
+
+        op->conn = bson_malloc0(sizeof(*op->conn));
+        op->conn->fd = fd;
+        op->conn->rbio = BIO_new(BIO_s_mem());
+        op->conn->wbio = BIO_new(BIO_s_mem());
+        op->next_addr = addr->ai_next;
+        if (!op->conn->rbio || !op->conn->wbio) {
+            *reason = "failed to create TLS buffers";
+            return false;
+        }
+        if (0 == connect(fd, addr->ai_addr, addr->ai_addrlen)) {
+            if (!_op_start_tls(op)) {
+                *reason = "failed to start TLS";
+                return false;
+            }
+            return true;
+        }
+        if (errno == EINPROGRESS) {
+            op->state = KMS_OP_CONNECTING;
+            return true;
+        }
+        _conn_destroy(op->conn);
+        op->conn = NULL;
+    }
+    *reason = "failed to connect to the KMS endpoint";
+    return false;
+}
+
+/* _op_send writes the request of @op on its connection, which completed the
+ * handshake. The memory BIO takes the whole request. */
+static bool _op_send(_kms_op_t *op) {
+    mongocrypt_binary_t msg = {0};
+
+    BSON_ASSERT_PARAM(op);
+
+    if (!mongocrypt_kms_ctx_message(op->kms, &msg) || msg.len > (uint32_t)INT_MAX) {
+        return false;
+    }
+    if (msg.len > 0 && SSL_write(op->conn->ssl, msg.data, (int)msg.len) != (int)msg.len) {
+        return false;
+    }
+    op->state = KMS_OP_READING;
+    return _conn_flush(op->conn);
+}
+
+/* _op_begin sends the request of @op once its wait is over, on a pooled
+ * connection if one is available. */
+static _kms_op_result_t _op_begin(mongocrypt_kms_client_t *client, _kms_op_t *op, const char **reason) {
+    int64_t timeout_us, remaining_us;
+
+    BSON_ASSERT_PARAM(client);
+    BSON_ASSERT_PARAM(op);
+    BSON_ASSERT_PARAM(reason);
+
+    timeout_us = client->timeout_ms * 1000;
+    remaining_us = mongocrypt_kms_ctx_remaining_us(op->kms);
+    if (remaining_us >= 0 && remaining_us < timeout_us) {
+        timeout_us = remaining_us;
+    }
+    op->deadline_us = bson_get_monotonic_time() + timeout_us;
+
+    op->conn = op->fresh ? NULL : _endpoint_take(op->ep);
+    op->reused = op->conn != NULL;
+    if (op->reused) {
+        if (!_op_send(op)) {
+            *reason = "failed to send the KMS request";
+            return KMS_OP_NETWORK_ERROR;
+        }
+        return KMS_OP_PENDING;
+    }
+    return _op_connect(op, reason) ? KMS_OP_PENDING : KMS_OP_NETWORK_ERROR;
+}
+
+/* _op_step advances @op as far as it goes without blocking. */
+static _kms_op_result_t
+_op_step(mongocrypt_kms_client_t *client, mongocrypt_ctx_t *ctx, _kms_op_t *op, const char **reason) {
+    const short revents = op->revents;
+    _kms_conn_t *conn;
+
+    BSON_ASSERT_PARAM(client);
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(op);
+    BSON_ASSERT_PARAM(reason);
+
+    op->revents = 0;
+    /* A hedged request needs no more bytes once the other one completed. */
+    if (0 == mongocrypt_kms_ctx_bytes_needed(op->kms)) {
+        return mongocrypt_status_ok(op->kms->status) ? KMS_OP_DONE : KMS_OP_CTX_ERROR;
+    }
+
+    if (op->state == KMS_OP_WAITING) {
+        _kms_op_result_t result;
+
+        if (bson_get_monotonic_time() < op->send_us) {
+            return KMS_OP_PENDING;
+        }
+        result = _op_begin(client, op, reason);
+        if (result != KMS_OP_PENDING) {
+            return result;
+        }
+    } else if (bson_get_monotonic_time() >= op->deadline_us) {
+        *reason = "KMS request timed out";
+        return KMS_OP_NETWORK_ERROR;
+    }
+
+    if (op->state == KMS_OP_CONNECTING) {
+        int err = 0;
+        socklen_t err_len = sizeof err;
+
+        if (!(revents & (POLLOUT | POLLERR | POLLHUP))) {
+            return KMS_OP_PENDING;
+        }
+        if (0 != getsockopt(op->conn->fd, SOL_SOCKET, SO_ERROR, &err, &err_len) || err != 0) {
+            _conn_destroy(op->conn);
+            op->conn = NULL;
+            return _op_connect(op, reason) ? KMS_OP_PENDING : KMS_OP_NETWORK_ERROR;
+        }
+        if (!_op_start_tls(op)) {
+            *reason = "failed to start TLS";
+            return KMS_OP_NETWORK_ERROR;
+        }
+    }
+
+    conn = op->conn;
+    if (op->state == KMS_OP_CONNECTING) {
+        return KMS_OP_PENDING;
+    }
+    if ((revents & (POLLIN | POLLERR | POLLHUP)) && !_conn_fill(conn)) {
+        *reason = "failed to receive the KMS response";
+        return KMS_OP_NETWORK_ERROR;
+    }
+
+    if (op->state == KMS_OP_HANDSHAKE) {
+        const int ret = _conn_result(conn, SSL_do_handshake(conn->ssl));
+
+        if (ret < 0) {
+            const long verify = SSL_get_verify_result(conn->ssl);
+
+            *reason = verify != X509_V_OK ? X509_verify_cert_error_string(verify) : "TLS handshake failed";
+            ERR_clear_error();
+            return KMS_OP_NETWORK_ERROR;
+        }
+        if (ret == 0) {
+            if (!_conn_flush(conn)) {
+                *reason = "failed to send the TLS handshake";
+                return KMS_OP_NETWORK_ERROR;
+            }
+            return KMS_OP_PENDING;
+        }
+        if (!_op_send(op)) {
+            *reason = "failed to send the KMS request";
+            return KMS_OP_NETWORK_ERROR;
+        }
+    }
+
+    BSON_ASSERT(op->state == KMS_OP_READING);
+    for (;;) {
+        uint8_t buf[KMS_CLIENT_BUF_LEN];
+        const uint32_t needed = mongocrypt_kms_ctx_bytes_needed(op->kms);
+        mongocrypt_binary_t bytes = {0};
+        int ret;
+
+        if (needed == 0) {
+            return mongocrypt_status_ok(op->kms->status) ? KMS_OP_DONE : KMS_OP_CTX_ERROR;
+        }
+        ret = SSL_read(conn->ssl, buf, (int)BSON_MIN(needed, (uint32_t)sizeof buf));
+        if (ret <= 0) {
+            const int result = _conn_result(conn, ret);
+
+            ERR_clear_error();
+            if (result == 0 && _conn_flush(conn)) {
+                return KMS_OP_PENDING;
+            }
+            *reason = "failed to receive the KMS response";
+            return KMS_OP_NETWORK_ERROR;
+        }
+        op->received = true;
+        bytes.data = buf;
+        bytes.len = (uint32_t)ret;
+        if (!mongocrypt_kms_ctx_feed(op->kms, &bytes)) {
+            return KMS_OP_CTX_ERROR;
+        }
+    }
+}
+
+/* _op_finish closes or pools the connection of @op after it is done. */
+static void _op_finish(_kms_op_t *op) {
+    mongocrypt_kms_ctx_t *kms;
+
+    BSON_ASSERT_PARAM(op);
+
+    kms = op->kms;
+    /* Only a connection that read a complete response can be reused. A hedged
+     * request may be cut off by the other request of its pair. */
+    if (op->conn && op->state == KMS_OP_READING && op->received && mongocrypt_status_ok(kms->status)
+        && !kms->should_retry && (!kms->hedge_winner || !_mongocrypt_buffer_empty(&kms->result))) {
+        _endpoint_put(op->ep, op->conn);
+        op->conn = NULL;
+    }
+    _op_close(op);
+}
+
+/* _op_network_error handles a network error of @op. A pooled connection that
+ * the server closed is replaced. Otherwise @over is set, and the request is
+ * returned again by mongocrypt_ctx_next_kms_ctx if retries remain. Returns
+ * false and fails @ctx if the request failed. */
+static bool _op_network_error(mongocrypt_ctx_t *ctx, _kms_op_t *op, const char *reason, bool *over) {
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(op);
+    BSON_ASSERT_PARAM(reason);
+    BSON_ASSERT_PARAM(over);
+
+    _op_close(op);
+    if (op->reused && !op->received) {
+        op->state = KMS_OP_WAITING;
+        op->send_us = 0;
+        op->fresh = true;
+        *over = false;
+        return true;
+    }
+    *over = true;
+    if (mongocrypt_kms_ctx_fail(op->kms)) {
+        return true;
+    }
+
+    mongocrypt_status_t *status = ctx->status;
+    CLIENT_ERR("%s: %s: %s", op->ep->endpoint, reason, mongocrypt_status_message(op->kms->status, NULL));
+    return _mongocrypt_ctx_fail(ctx);
+}
+
+/* _op_events returns the poll events @op waits for. */
+static short _op_events(const _kms_op_t *op) {
+    BSON_ASSERT_PARAM(op);
+
+    switch (op->state) {
+    case KMS_OP_CONNECTING: return POLLOUT;
+    case KMS_OP_HANDSHAKE:
+    case KMS_OP_READING: return (short)(POLLIN | (_conn_flushed(op->conn) ? 0 : POLLOUT));
+    case KMS_OP_WAITING:
+    default: return 0;
+    }
+}
+
+/* _poll_ops waits until an operation of @ops may progress. */
+static bool _poll_ops(mongocrypt_ctx_t *ctx, mc_array_t *ops) {
+    struct pollfd *pfds;
+    int64_t wake_us = INT64_MAX, timeout_ms;
+    int ret;
+
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT_PARAM(ops);
+
+    pfds = bson_malloc0(sizeof(struct pollfd) * ops->len);
+    for (size_t i = 0; i < ops->len; i++) {
+        _kms_op_t *op = &_mc_array_index(ops, _kms_op_t, i);
+        const int64_t op_wake_us = op->state == KMS_OP_WAITING ? op->send_us : op->deadline_us;
+
+        /* poll ignores negative descriptors. */
+        pfds[i].fd = op->state == KMS_OP_WAITING ? -1 : op->conn->fd;
+        pfds[i].events = _op_events(op);
+        wake_us = BSON_MIN(wake_us, op_wake_us);
+    }
+
+    timeout_ms = (wake_us - bson_get_monotonic_time() + 999) / 1000;
+    timeout_ms = BSON_MAX(timeout_ms, 0);
+    ret = poll(pfds, (nfds_t)ops->len, (int)BSON_MIN(timeout_ms, INT_MAX));
+    if (ret < 0 && errno != EINTR) {
+        bson_free(pfds);
+        return _mongocrypt_ctx_fail_w_msg(ctx, "failed to poll KMS connections");
+    }
+    for (size_t i = 0; ret > 0 && i < ops->len; i++) {
+        _mc_array_index(ops, _kms_op_t, i).revents = pfds[i].revents;
+    }
+    bson_free(pfds);
+    return true;
+}
+
+/* _run_kms_requests performs the KMS requests of @ctx until none is left to
+ * send or retry. */
+static bool _run_kms_requests(mongocrypt_kms_client_t *client, mongocrypt_ctx_t *ctx) {
+    mc_array_t ops;
+    bool ok = false;
+
+    BSON_ASSERT_PARAM(client);
+    BSON_ASSERT_PARAM(ctx);
+
+    _mc_array_init(&ops, sizeof(_kms_op_t));
+    for (;;) {
+        mongocrypt_kms_ctx_t *kms;
+        bool removed = false;
+        size_t kept = 0;
+
+        /* Requests being retried are returned again. */
+        while ((kms = mongocrypt_ctx_next_kms_ctx(ctx))) {
+            _kms_op_t op = {0};
+            const char *endpoint;
+
+            if (!mongocrypt_kms_ctx_endpoint(kms, &endpoint)) {
+                _mongocrypt_status_copy_to(kms->status, ctx->status);
+                _mongocrypt_ctx_fail(ctx);
+                goto done;
+            }
+            op.ep = _client_endpoint(client, kms->kmsid, endpoint, ctx->status);
+            if (!op.ep) {
+                _mongocrypt_ctx_fail(ctx);
+                goto done;
+            }
+            _mongocrypt_kms_ctx_set_keep_alive(kms);
+            op.kms = kms;
+            op.state = KMS_OP_WAITING;
+            op.send_us = bson_get_monotonic_time() + mongocrypt_kms_ctx_usleep(kms);
+            _mc_array_append_val(&ops, op);
+        }
+        if (ctx->state == MONGOCRYPT_CTX_ERROR) {
+            goto done;
+        }
+        if (ops.len == 0) {
+            break;
+        }
+
+        for (size_t i = 0; i < ops.len; i++) {
+            _kms_op_t *op = &_mc_array_index(&ops, _kms_op_t, i);
+            const char *reason = "network error";
+            bool over = false;
+
+            switch (_op_step(client, ctx, op, &reason)) {
+            case KMS_OP_PENDING: break;
+            case KMS_OP_DONE:
+                _op_finish(op);
+                over = true;
+                break;
+            case KMS_OP_NETWORK_ERROR:
+                if (!_op_network_error(ctx, op, reason, &over)) {
+                    goto done;
+                }
+                break;
+            case KMS_OP_CTX_ERROR:
+            default:
+                _mongocrypt_status_copy_to(op->kms->status, ctx->status);
+                _mongocrypt_ctx_fail(ctx);
+                goto done;
+            }
+            if (over) {
+                removed = true;
+                continue;
+            }
+            /* Swap rather than copy, so each connection stays in one entry if
+             * a later operation fails the context. */
+            if (kept != i) {
+                _kms_op_t tmp = _mc_array_index(&ops, _kms_op_t, kept);
+
+                _mc_array_index(&ops, _kms_op_t, kept) = *op;
+                *op = tmp;
+            }
+            kept++;
+        }
+        ops.len = kept;
+        if (removed) {
+            continue;
+        }
+        if (!_poll_ops(ctx, &ops)) {
+            goto done;
+        }
+    }
+    ok = true;
+
+done:
+    for (size_t i = 0; i < ops.len; i++) {
+        _op_close(&_mc_array_index(&ops, _kms_op_t, i));
+    }
+    _mc_array_destroy(&ops);
+    return ok;
+}
+
+#endif /* MONGOCRYPT_ENABLE_KMS_CLIENT */
+
+bool mongocrypt_is_kms_client_available(void) {
+#ifdef MONGOCRYPT_ENABLE_KMS_CLIENT
+    return true;
+#else
+    return false;
+#endif
+}
+
+mongocrypt_kms_client_t *mongocrypt_kms_client_new(void) {
+    mongocrypt_kms_client_t *client = bson_malloc0(sizeof(*client));
+
+    client->status = mongocrypt_status_new();
+    client->timeout_ms = KMS_CLIENT_DEFAULT_TIMEOUT_MS;
+    _mc_array_init(&client->cert_key_files, sizeof(_kms_cert_key_t));
+#ifdef MONGOCRYPT_ENABLE_KMS_CLIENT
+    _mc_array_init(&client->endpoints, sizeof(_kms_endpoint_t *));
+#endif
+    return client;
+}
+
+bool mongocrypt_kms_client_setopt_tls_ca_file(mongocrypt_kms_client_t *client, const char *path) {
+    mongocrypt_status_t *status;
+
+    if (!client) {
+        return false;
+    }
+    status = client->status;
+    if (client->ran) {
+        CLIENT_ERR("cannot set TLS options after run");
+        return false;
+    }
+    if (!path) {
+        CLIENT_ERR("path must be non-NULL");
+        return false;
+    }
+    bson_free(client->ca_file);
+    client->ca_file = bson_strdup(path);
+    return true;
+}
+
+bool mongocrypt_kms_client_setopt_tls_cert_key_file(mongocrypt_kms_client_t *client,
+                                                    const char *kms_provider,
+                                                    const char *path) {
+    mongocrypt_status_t *status;
+    _kms_cert_key_t ck = {0};
+
+    if (!client) {
+        return false;
+    }
+    status = client->status;
+    if (client->ran) {
+        CLIENT_ERR("cannot set TLS options after run");
+        return false;
+    }
+    if (!kms_provider || !path) {
+        CLIENT_ERR("kms_provider and path must be non-NULL");
+        return false;
+    }
+    for (size_t i = 0; i < client->cert_key_files.len; i++) {
+        _kms_cert_key_t *existing = &_mc_array_index(&client->cert_key_files, _kms_cert_key_t, i);
+
+        if (0 == strcmp(existing->kms_provider, kms_provider)) {
+            bson_free(existing->path);
+            existing->path = bson_strdup(path);
+            return true;
+        }
+    }
+    ck.kms_provider = bson_strdup(kms_provider);
+    ck.path = bson_strdup(path);
+    _mc_array_append_val(&client->cert_key_files, ck);
+    return true;
+}
+
+bool mongocrypt_kms_client_setopt_timeout_ms(mongocrypt_kms_client_t *client, int64_t timeout_ms) {
+    mongocrypt_status_t *status;
+
+    if (!client) {
+        return false;
+    }
+    status = client->status;
+    /* Bound the timeout so it converts to microseconds. */
+    if (timeout_ms <= 0 || timeout_ms > INT64_MAX / 1000 / 2) {
+        CLIENT_ERR("timeout_ms must be positive, got: %" PRId64, timeout_ms);
+        return false;
+    }
+    client->timeout_ms = timeout_ms;
+    return true;
+}
+
+bool mongocrypt_kms_client_run(mongocrypt_kms_client_t *client, mongocrypt_ctx_t *ctx) {
+    if (!client || !ctx) {
+        return false;
+    }
+    if (!ctx->initialized) {
+        return _mongocrypt_ctx_fail_w_msg(ctx, "ctx NULL or uninitialized");
+    }
+#ifdef MONGOCRYPT_ENABLE_KMS_CLIENT
+    client->ran = true;
+    while (mongocrypt_ctx_state(ctx) == MONGOCRYPT_CTX_NEED_KMS) {
+        if (!_run_kms_requests(client, ctx)) {
+            return false;
+        }
+        if (!mongocrypt_ctx_kms_done(ctx)) {
+            return false;
+        }
+    }
+    return ctx->state != MONGOCRYPT_CTX_ERROR;
+#else
+    return _mongocrypt_ctx_fail_w_msg(ctx, "libmongocrypt was built without the KMS client, see ENABLE_KMS_CLIENT");
+#endif
+}
+
+bool mongocrypt_kms_client_status(mongocrypt_kms_client_t *client, mongocrypt_status_t *out) {
+    if (!client) {
+        return false;
+    }
+
+    if (!out) {
+        mongocrypt_status_t *status = client->status;
+        CLIENT_ERR("argument 'out' is required");
+        return false;
+    }
+
+    if (!mongocrypt_status_ok(client->status)) {
+        _mongocrypt_status_copy_to(client->status, out);
+        return false;
+    }
+    _mongocrypt_status_reset(out);
+    return true;
+}
+
+void mongocrypt_kms_client_destroy(mongocrypt_kms_client_t *client) {
+    if (!client) {
+        return;
+    }
+#ifdef MONGOCRYPT_ENABLE_KMS_CLIENT
+    for (size_t i = 0; i < client->endpoints.len; i++) {
+        _endpoint_destroy(_mc_array_index(&client->endpoints, _kms_endpoint_t *, i));
+    }
+    _mc_array_destroy(&client->endpoints);
+    SSL_CTX_free(client->ssl_ctx);
+#endif
+    for (size_t i = 0; i < client->cert_key_files.len; i++) {
+        _kms_cert_key_t *ck = &_mc_array_index(&client->cert_key_files, _kms_cert_key_t, i);
+
+#ifdef MONGOCRYPT_ENABLE_KMS_CLIENT
+        SSL_CTX_free(ck->ssl_ctx);
+#endif
+        bson_free(ck->kms_provider);
+        bson_free(ck->path);
+    }
+    _mc_array_destroy(&client->cert_key_files);
+    bson_free(client->ca_file);
+    mongocrypt_status_destroy(client->status);
+    bson_free(client);
+}
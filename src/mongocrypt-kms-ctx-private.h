@@ -46,6 +46,13 @@ typedef enum {
     MONGOCRYPT_KMS_KMIP_DECRYPT,
 } _kms_request_type_t;
 
+/* The request of a hedged pair a KMS context is. */
+typedef enum {
+    MONGOCRYPT_KMS_HEDGE_NONE,
+    MONGOCRYPT_KMS_HEDGE_ORIGINAL,
+    MONGOCRYPT_KMS_HEDGE_ALTERNATE,
+} _kms_hedge_role_t;
+
 struct _mongocrypt_kms_ctx_t {
     kms_request_t *req;
     _kms_request_type_t req_type;
@@ -56,6 +63,46 @@ struct _mongocrypt_kms_ctx_t {
     char *endpoint;
     _mongocrypt_log_t *log;
     char *kmsid;
+    /* trace_ctx is the context a "kms" trace span is open for, or NULL. */
+    mongocrypt_ctx_t *trace_ctx;
+    /* record_ctx is the context recording calls on this KMS context, or NULL.
+     * record_id identifies it in the recorded calls. */
+    mongocrypt_ctx_t *record_ctx;
+    uint32_t record_id;
+    /* retry_enabled is set from mongocrypt_setopt_retry_kms when the request
+     * is returned. should_retry is set when the request must be sent again
+     * after sleeping sleep_usec. attempts counts the retries so far. */
+    bool retry_enabled;
+    bool should_retry;
+    int attempts;
+    int64_t sleep_usec;
+    /* pace_usec is the wait before sending the request under the rate limit
+     * set with mongocrypt_setopt_kms_rate_limit. It is set each time the
+     * request is returned. */
+    int64_t pace_usec;
+    /* deadline_us is the monotonic time of the deadline of the context that
+     * returned the request, set with mongocrypt_ctx_setopt_deadline, or 0. */
+    int64_t deadline_us;
+    /* batch_results has batch_len results of a batched KMIP Get request, in the
+     * order of the unique identifiers. result holds the first. */
+    _mongocrypt_buffer_t *batch_results;
+    size_t batch_len;
+    /* stats_crypt receives the KMS stats of the request. It is set when the
+     * request is returned. start_us is the time of the first call to
+     * mongocrypt_kms_ctx_message of the current attempt, or 0.
+     * kmip_result_reason is the Result Reason of a failed KMIP response. */
+    mongocrypt_t *stats_crypt;
+    int64_t start_us;
+    uint32_t kmip_result_reason;
+    /* hedge_winner is shared by both requests of a hedged pair, or NULL. It
+     * holds MONGOCRYPT_KMS_HEDGE_NONE until one has a complete response, then
+     * the hedge_role of that request, and the other needs no more bytes. It is
+     * accessed atomically, since the pair may be fed from separate threads. */
+    volatile int32_t *hedge_winner;
+    _kms_hedge_role_t hedge_role;
+    /* large_reads is set from mongocrypt_setopt_kms_large_reads when the
+     * request is returned. */
+    bool large_reads;
 };
 
 bool _mongocrypt_kms_ctx_init_aws_decrypt(mongocrypt_kms_ctx_t *kms,
@@ -65,6 +112,17 @@ bool _mongocrypt_kms_ctx_init_aws_decrypt(mongocrypt_kms_ctx_t *kms,
                                           const char *kmsid,
                                           _mongocrypt_log_t *log) MONGOCRYPT_WARN_UNUSED_RESULT;
 
+/* _mongocrypt_kms_ctx_init_aws_decrypt_at is _mongocrypt_kms_ctx_init_aws_decrypt
+ * sending the request to @endpoint. A NULL @endpoint uses the regional
+ * endpoint. */
+bool _mongocrypt_kms_ctx_init_aws_decrypt_at(mongocrypt_kms_ctx_t *kms,
+                                             _mongocrypt_opts_kms_providers_t *kms_providers,
+                                             _mongocrypt_key_doc_t *key,
+                                             const _mongocrypt_endpoint_t *endpoint,
+                                             _mongocrypt_crypto_t *crypto,
+                                             const char *kmsid,
+                                             _mongocrypt_log_t *log) MONGOCRYPT_WARN_UNUSED_RESULT;
+
 bool _mongocrypt_kms_ctx_init_aws_encrypt(mongocrypt_kms_ctx_t *kms,
                                           _mongocrypt_opts_kms_providers_t *kms_providers,
                                           struct __mongocrypt_ctx_opts_t *ctx_opts,
@@ -77,6 +135,20 @@ bool _mongocrypt_kms_ctx_result(mongocrypt_kms_ctx_t *kms, _mongocrypt_buffer_t
 
 void _mongocrypt_kms_ctx_cleanup(mongocrypt_kms_ctx_t *kms);
 
+/* _mongocrypt_kms_ctx_set_keep_alive removes the "Connection: close" header
+ * from the HTTP request of @kms. It is a no-op for KMIP requests and if the
+ * header was already removed. */
+void _mongocrypt_kms_ctx_set_keep_alive(mongocrypt_kms_ctx_t *kms);
+
+/* _mongocrypt_kms_ctx_join_hedge makes @kms the @role request of the hedged
+ * pair sharing @winner. It must be called before @kms is returned to the
+ * driver. */
+void _mongocrypt_kms_ctx_join_hedge(mongocrypt_kms_ctx_t *kms, volatile int32_t *winner, _kms_hedge_role_t role);
+
+/* _mongocrypt_kms_ctx_hedge_lost returns true if the other request of the
+ * hedged pair of @kms has a complete response. */
+bool _mongocrypt_kms_ctx_hedge_lost(const mongocrypt_kms_ctx_t *kms);
+
 bool _mongocrypt_kms_ctx_init_azure_auth(mongocrypt_kms_ctx_t *kms,
                                          const mc_kms_creds_t *kc,
                                          _mongocrypt_endpoint_t *key_vault_endpoint,
@@ -140,6 +212,20 @@ bool _mongocrypt_kms_ctx_init_kmip_get(mongocrypt_kms_ctx_t *kms,
                                        const char *kmsid,
                                        _mongocrypt_log_t *log) MONGOCRYPT_WARN_UNUSED_RESULT;
 
+/* _mongocrypt_kms_ctx_init_kmip_get_batch creates one KMIP Get request for
+ * @count keys on the same endpoint. Retrieve the result of each key with
+ * _mongocrypt_kms_ctx_batch_result. */
+bool _mongocrypt_kms_ctx_init_kmip_get_batch(mongocrypt_kms_ctx_t *kms,
+                                             const _mongocrypt_endpoint_t *endpoint,
+                                             const char *const *unique_identifiers,
+                                             size_t count,
+                                             const char *kmsid,
+                                             _mongocrypt_log_t *log) MONGOCRYPT_WARN_UNUSED_RESULT;
+
+bool _mongocrypt_kms_ctx_batch_result(mongocrypt_kms_ctx_t *kms,
+                                      size_t index,
+                                      _mongocrypt_buffer_t *out) MONGOCRYPT_WARN_UNUSED_RESULT;
+
 bool _mongocrypt_kms_ctx_init_kmip_create(mongocrypt_kms_ctx_t *kms,
                                           const _mongocrypt_endpoint_t *endpoint,
                                           const char *kmsid,
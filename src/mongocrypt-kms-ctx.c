@@ -15,6 +15,7 @@
  */
 
 #include "kms_message/kms_kmip_request.h"
+#include "mongocrypt-atomic-private.h"
 #include "mongocrypt-binary-private.h"
 #include "mongocrypt-buffer-private.h"
 #include "mongocrypt-crypto-private.h"
@@ -24,6 +25,7 @@
 #include "mongocrypt-log-private.h"
 #include "mongocrypt-opts-private.h"
 #include "mongocrypt-private.h"
+#include "mongocrypt-probes-private.h"
 #include "mongocrypt-status-private.h"
 #include "mongocrypt-util-private.h"
 #include "mongocrypt.h"
@@ -47,6 +49,9 @@ typedef struct {
  * in kms_ctx_bytes_needed until we are fed the Content-Length.
  */
 #define DEFAULT_MAX_KMS_BYTE_REQUEST 1024
+/* With mongocrypt_setopt_kms_large_reads, at least this many bytes are
+ * requested until the response is complete. */
+#define LARGE_MAX_KMS_BYTE_REQUEST (64 * 1024)
 #define SHA256_LEN 32
 #define DEFAULT_HTTPS_PORT "443"
 #define DEFAULT_KMIP_PORT "5696"
@@ -115,7 +120,7 @@ _set_kms_crypto_hooks(_mongocrypt_crypto_t *crypto, ctx_with_status_t *ctx_with_
     BSON_ASSERT_PARAM(ctx_with_status);
     BSON_ASSERT_PARAM(opts);
 
-    if (crypto->hooks_enabled) {
+    if (MONGOCRYPT_CRYPTO_HOOKS_ENABLED(crypto)) {
         kms_request_opt_set_crypto_hooks(opts, _sha256, _sha256_hmac, ctx_with_status);
     }
 }
@@ -141,15 +146,157 @@ _init_common(mongocrypt_kms_ctx_t *kms, _mongocrypt_log_t *log, _kms_request_typ
     kms->log = log;
     kms->status = mongocrypt_status_new();
     kms->req_type = kms_type;
+    kms->trace_ctx = NULL;
+    kms->record_ctx = NULL;
+    kms->record_id = 0;
+    kms->retry_enabled = false;
+    kms->should_retry = false;
+    kms->attempts = 0;
+    kms->sleep_usec = 0;
+    kms->pace_usec = 0;
+    kms->batch_results = NULL;
+    kms->batch_len = 0;
+    kms->stats_crypt = NULL;
+    kms->start_us = 0;
+    kms->kmip_result_reason = 0;
+    kms->hedge_winner = NULL;
+    kms->hedge_role = MONGOCRYPT_KMS_HEDGE_NONE;
     _mongocrypt_buffer_init(&kms->result);
 }
 
+/* _end_trace ends the "kms" trace span of @kms if one is open. */
+static void _end_trace(mongocrypt_kms_ctx_t *kms, bool ok) {
+    bson_t attributes = BSON_INITIALIZER;
+
+    BSON_ASSERT_PARAM(kms);
+
+    if (!kms->trace_ctx) {
+        return;
+    }
+    BSON_ASSERT(BSON_APPEND_BOOL(&attributes, "ok", ok));
+    _mongocrypt_ctx_trace(kms->trace_ctx, MONGOCRYPT_TRACE_END, "kms", &attributes);
+    bson_destroy(&attributes);
+    kms->trace_ctx = NULL;
+}
+
+/* _record_call records a call on @kms for the record handler of the context
+ * it was returned from. @bytes may be NULL. */
+static void _record_call(mongocrypt_kms_ctx_t *kms, const char *call, const mongocrypt_binary_t *bytes) {
+    bson_t args = BSON_INITIALIZER;
+
+    BSON_ASSERT_PARAM(kms);
+
+    if (!kms->record_ctx) {
+        return;
+    }
+    BSON_ASSERT(kms->record_id <= INT32_MAX);
+    BSON_ASSERT(BSON_APPEND_INT32(&args, "id", (int32_t)kms->record_id));
+    if (bytes && bytes->data) {
+        BSON_ASSERT(BSON_APPEND_BINARY(&args, "data", BSON_SUBTYPE_BINARY, bytes->data, bytes->len));
+    }
+    _mongocrypt_ctx_record(kms->record_ctx, call, &args);
+    bson_destroy(&args);
+}
+
+/* _record_stats records the end of the current attempt of @kms in the KMS
+ * stats of the mongocrypt_t it was returned from, and fires kms__done. */
+static void _record_stats(mongocrypt_kms_ctx_t *kms, bool ok, int http_status) {
+    int64_t latency_us = -1;
+
+    BSON_ASSERT_PARAM(kms);
+
+    if (kms->start_us != 0) {
+        latency_us = bson_get_monotonic_time() - kms->start_us;
+    }
+    MONGOCRYPT_PROBE5(kms__done, kms->kmsid, (int)kms->req_type, ok, http_status, latency_us);
+    if (!kms->stats_crypt) {
+        kms->start_us = 0;
+        return;
+    }
+    _mongocrypt_kms_stats_record(kms->stats_crypt,
+                                 kms->kmsid,
+                                 kms->endpoint,
+                                 latency_us,
+                                 ok,
+                                 http_status,
+                                 kms->kmip_result_reason);
+    kms->start_us = 0;
+    kms->kmip_result_reason = 0;
+}
+
+/* _destroy_kmip_response keeps the Result Reason of @res for the KMS stats and
+ * destroys @res. */
+static void _destroy_kmip_response(mongocrypt_kms_ctx_t *kms, kms_response_t *res) {
+    BSON_ASSERT_PARAM(kms);
+
+    if (res) {
+        kms->kmip_result_reason = kms_kmip_response_get_result_reason(res);
+    }
+    kms_response_destroy(res);
+}
+
+#define KMS_MAX_RETRIES 3
+#define KMS_BACKOFF_INITIAL_USEC (200 * 1000)
+
+/* _reset_for_retry discards the partial response of @kms and schedules the
+ * request to be sent again. */
+static void _reset_for_retry(mongocrypt_kms_ctx_t *kms) {
+    BSON_ASSERT_PARAM(kms);
+
+    kms_response_parser_destroy(kms->parser);
+    if (is_kms(kms->req_type)) {
+        kms->parser = kms_kmip_response_parser_new(NULL /* reserved */);
+    } else {
+        kms->parser = kms_response_parser_new();
+    }
+    kms->attempts++;
+    kms->should_retry = true;
+    kms->sleep_usec = (int64_t)KMS_BACKOFF_INITIAL_USEC << (kms->attempts - 1);
+    _end_trace(kms, false);
+}
+
+/* _retry_fits_deadline returns true if @kms has no deadline, or if the
+ * deadline is after the sleep of the next retry. */
+static bool _retry_fits_deadline(const mongocrypt_kms_ctx_t *kms) {
+    BSON_ASSERT_PARAM(kms);
+
+    if (kms->deadline_us == 0) {
+        return true;
+    }
+    return bson_get_monotonic_time() + ((int64_t)KMS_BACKOFF_INITIAL_USEC << kms->attempts) < kms->deadline_us;
+}
+
+/* _is_retryable_http_status returns true for throttling and transient server
+ * errors. */
+static bool _is_retryable_http_status(int http_status) {
+    return http_status == 429 || http_status == 500 || http_status == 502 || http_status == 503
+        || http_status == 504;
+}
+
 bool _mongocrypt_kms_ctx_init_aws_decrypt(mongocrypt_kms_ctx_t *kms,
                                           _mongocrypt_opts_kms_providers_t *kms_providers,
                                           _mongocrypt_key_doc_t *key,
                                           _mongocrypt_crypto_t *crypto,
                                           const char *kmsid,
                                           _mongocrypt_log_t *log) {
+    BSON_ASSERT_PARAM(key);
+
+    return _mongocrypt_kms_ctx_init_aws_decrypt_at(kms,
+                                                   kms_providers,
+                                                   key,
+                                                   key->kek.provider.aws.endpoint,
+                                                   crypto,
+                                                   kmsid,
+                                                   log);
+}
+
+bool _mongocrypt_kms_ctx_init_aws_decrypt_at(mongocrypt_kms_ctx_t *kms,
+                                             _mongocrypt_opts_kms_providers_t *kms_providers,
+                                             _mongocrypt_key_doc_t *key,
+                                             const _mongocrypt_endpoint_t *endpoint,
+                                             _mongocrypt_crypto_t *crypto,
+                                             const char *kmsid,
+                                             _mongocrypt_log_t *log) {
     BSON_ASSERT_PARAM(kms);
     BSON_ASSERT_PARAM(key);
     BSON_ASSERT_PARAM(kms_providers);
@@ -228,8 +375,8 @@ bool _mongocrypt_kms_ctx_init_aws_decrypt(mongocrypt_kms_ctx_t *kms,
     }
 
     /* If an endpoint was set, override the default Host header. */
-    if (key->kek.provider.aws.endpoint) {
-        if (!kms_request_add_header_field(kms->req, "Host", key->kek.provider.aws.endpoint->host_and_port)) {
+    if (endpoint) {
+        if (!kms_request_add_header_field(kms->req, "Host", endpoint->host_and_port)) {
             CLIENT_ERR("error constructing KMS message: %s", kms_request_get_error(kms->req));
             _mongocrypt_status_append(status, ctx_with_status.status);
             goto done;
@@ -263,8 +410,8 @@ bool _mongocrypt_kms_ctx_init_aws_decrypt(mongocrypt_kms_ctx_t *kms,
     kms->msg.len = (uint32_t)strlen((char *)kms->msg.data);
     kms->msg.owned = true;
 
-    if (key->kek.provider.aws.endpoint) {
-        kms->endpoint = bson_strdup(key->kek.provider.aws.endpoint->host_and_port);
+    if (endpoint) {
+        kms->endpoint = bson_strdup(endpoint->host_and_port);
     } else {
         /* construct the endpoint from AWS region. */
         kms->endpoint = bson_strdup_printf("kms.%s.amazonaws.com", key->kek.provider.aws.region);
@@ -416,6 +563,39 @@ done:
     return ret;
 }
 
+void _mongocrypt_kms_ctx_join_hedge(mongocrypt_kms_ctx_t *kms, volatile int32_t *winner, _kms_hedge_role_t role) {
+    BSON_ASSERT_PARAM(kms);
+    BSON_ASSERT_PARAM(winner);
+    BSON_ASSERT(role != MONGOCRYPT_KMS_HEDGE_NONE);
+
+    kms->hedge_winner = winner;
+    kms->hedge_role = role;
+}
+
+bool _mongocrypt_kms_ctx_hedge_lost(const mongocrypt_kms_ctx_t *kms) {
+    int32_t winner;
+
+    BSON_ASSERT_PARAM(kms);
+
+    if (!kms->hedge_winner) {
+        return false;
+    }
+    winner = _mongocrypt_atomic_int32_load(kms->hedge_winner);
+    return winner != MONGOCRYPT_KMS_HEDGE_NONE && winner != (int32_t)kms->hedge_role;
+}
+
+/* _claim_hedge records @kms as the request of its hedged pair that is used,
+ * unless the other request already was. */
+static void _claim_hedge(mongocrypt_kms_ctx_t *kms) {
+    BSON_ASSERT_PARAM(kms);
+
+    if (kms->hedge_winner) {
+        (void)_mongocrypt_atomic_int32_compare_exchange(kms->hedge_winner,
+                                                        MONGOCRYPT_KMS_HEDGE_NONE,
+                                                        (int32_t)kms->hedge_role);
+    }
+}
+
 uint32_t mongocrypt_kms_ctx_bytes_needed(mongocrypt_kms_ctx_t *kms) {
     int want_bytes;
 
@@ -427,11 +607,43 @@ uint32_t mongocrypt_kms_ctx_bytes_needed(mongocrypt_kms_ctx_t *kms) {
     if (!mongocrypt_status_ok(kms->status) || !_mongocrypt_buffer_empty(&kms->result)) {
         return 0;
     }
+    if (kms->should_retry) {
+        /* The request must be sent again before more bytes are fed. */
+        return 0;
+    }
+    if (_mongocrypt_kms_ctx_hedge_lost(kms)) {
+        return 0;
+    }
     want_bytes = kms_response_parser_wants_bytes(kms->parser, DEFAULT_MAX_KMS_BYTE_REQUEST);
     BSON_ASSERT(want_bytes >= 0);
+    if (kms->large_reads && want_bytes > 0) {
+        /* mongocrypt_kms_ctx_feed splits the bytes for the parser. */
+        return want_bytes > LARGE_MAX_KMS_BYTE_REQUEST ? (uint32_t)want_bytes : LARGE_MAX_KMS_BYTE_REQUEST;
+    }
     return (uint32_t)want_bytes;
 }
 
+/* _large_read_len returns how many of the @len bytes at @data to feed the
+ * response parser of @kms at once, or 0 if the response is complete. While
+ * the parser does not know the length of what it parses, at most one line is
+ * fed, so the bytes after the headers are not fed past the end of the body. */
+static uint32_t _large_read_len(mongocrypt_kms_ctx_t *kms, const uint8_t *data, uint32_t len) {
+    const int32_t max = len > (uint32_t)INT32_MAX ? INT32_MAX : (int32_t)len;
+    const uint8_t *lf;
+    int want_bytes;
+
+    BSON_ASSERT_PARAM(kms);
+    BSON_ASSERT_PARAM(data);
+
+    want_bytes = kms_response_parser_wants_bytes(kms->parser, max);
+    BSON_ASSERT(want_bytes >= 0);
+    if (want_bytes < max) {
+        return (uint32_t)want_bytes;
+    }
+    lf = memchr(data, '\n', (size_t)max);
+    return lf ? (uint32_t)(lf - data) + 1u : (uint32_t)max;
+}
+
 static void
 _handle_non200_http_status(int http_status, const char *body, size_t body_len, mongocrypt_status_t *status) {
     BSON_ASSERT_PARAM(body);
@@ -455,6 +667,316 @@ _handle_non200_http_status(int http_status, const char *body, size_t body_len, m
     CLIENT_ERR("Error in KMS response. HTTP status=%d. Response body=\n%s", http_status, body);
 }
 
+static const char *_json_skip_ws(const char *p, const char *end) {
+    BSON_ASSERT_PARAM(p);
+    BSON_ASSERT_PARAM(end);
+
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+        p++;
+    }
+    return p;
+}
+
+/* Nesting of values the scan of a KMS response body checks. Deeper bodies are
+ * converted with bson_init_from_json. */
+#define JSON_MAX_DEPTH 16
+
+static bool _json_is_hex(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+/* _json_skip_string returns the position after the string starting at the
+ * quote @p, or NULL if it is not a terminated string of printable ASCII and
+ * valid escape sequences. Non-ASCII strings are left to bson_init_from_json
+ * to validate as UTF-8. @escaped is set if the string has escape sequences. */
+static const char *_json_skip_string(const char *p, const char *end, bool *escaped) {
+    BSON_ASSERT_PARAM(p);
+    BSON_ASSERT_PARAM(end);
+    BSON_ASSERT_PARAM(escaped);
+
+    *escaped = false;
+    for (p++; p < end; p++) {
+        const unsigned char c = (unsigned char)*p;
+
+        if (c == '"') {
+            return p + 1;
+        }
+        if (c < 0x20 || c >= 0x80) {
+            return NULL;
+        }
+        if (c != '\\') {
+            continue;
+        }
+        *escaped = true;
+        if (++p == end) {
+            return NULL;
+        }
+        if (*p == 'u') {
+            for (int i = 0; i < 4; i++) {
+                if (++p == end || !_json_is_hex(*p)) {
+                    return NULL;
+                }
+            }
+        } else if (*p == '\0' || !strchr("\"\\/bfnrt", *p)) {
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+static const char *_json_skip_digits(const char *p, const char *end) {
+    BSON_ASSERT_PARAM(p);
+    BSON_ASSERT_PARAM(end);
+
+    while (p < end && *p >= '0' && *p <= '9') {
+        p++;
+    }
+    return p;
+}
+
+/* _json_skip_number returns the position after the number starting at @p, or
+ * NULL if @p does not start with a number. */
+static const char *_json_skip_number(const char *p, const char *end) {
+    const char *digits;
+
+    BSON_ASSERT_PARAM(p);
+    BSON_ASSERT_PARAM(end);
+
+    if (p < end && *p == '-') {
+        p++;
+    }
+    digits = p;
+    p = (p < end && *p == '0') ? p + 1 : _json_skip_digits(p, end);
+    if (p == digits) {
+        return NULL;
+    }
+    if (p < end && *p == '.') {
+        digits = p + 1;
+        if ((p = _json_skip_digits(digits, end)) == digits) {
+            return NULL;
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        if (p < end && (*p == '+' || *p == '-')) {
+            p++;
+        }
+        digits = p;
+        if ((p = _json_skip_digits(digits, end)) == digits) {
+            return NULL;
+        }
+    }
+    return p;
+}
+
+/* _json_skip_literal returns the position after @literal if @p starts with
+ * it, or NULL. */
+static const char *_json_skip_literal(const char *p, const char *end, const char *literal) {
+    const size_t len = strlen(literal);
+
+    BSON_ASSERT_PARAM(p);
+    BSON_ASSERT_PARAM(end);
+
+    if ((size_t)(end - p) < len || 0 != memcmp(p, literal, len)) {
+        return NULL;
+    }
+    return p + len;
+}
+
+/* _json_skip_value returns the position after the value starting at @p, or
+ * NULL if it is not valid JSON or nests deeper than @depth. */
+static const char *_json_skip_value(const char *p, const char *end, int depth) {
+    bool escaped;
+
+    BSON_ASSERT_PARAM(p);
+    BSON_ASSERT_PARAM(end);
+
+    if (p == end) {
+        return NULL;
+    }
+    switch (*p) {
+    case '"': return _json_skip_string(p, end, &escaped);
+    case 't': return _json_skip_literal(p, end, "true");
+    case 'f': return _json_skip_literal(p, end, "false");
+    case 'n': return _json_skip_literal(p, end, "null");
+    case '{':
+    case '[': {
+        const char close = *p == '{' ? '}' : ']';
+
+        if (depth == 0) {
+            return NULL;
+        }
+        p = _json_skip_ws(p + 1, end);
+        if (p < end && *p == close) {
+            return p + 1;
+        }
+        while (true) {
+            if (close == '}') {
+                if (p == end || *p != '"' || !(p = _json_skip_string(p, end, &escaped))) {
+                    return NULL;
+                }
+                p = _json_skip_ws(p, end);
+                if (p == end || *p != ':') {
+                    return NULL;
+                }
+                p = _json_skip_ws(p + 1, end);
+            }
+            if (!(p = _json_skip_value(p, end, depth - 1))) {
+                return NULL;
+            }
+            p = _json_skip_ws(p, end);
+            if (p == end) {
+                return NULL;
+            }
+            if (*p == close) {
+                return p + 1;
+            }
+            if (*p != ',') {
+                return NULL;
+            }
+            p = _json_skip_ws(p + 1, end);
+        }
+    }
+    default: return _json_skip_number(p, end);
+    }
+}
+
+/* _json_find_utf8 scans the JSON object @body for the first top-level string
+ * field @field, and views its value in @value. The whole body is checked, so
+ * that malformed bodies are reported by bson_init_from_json. Returns false if
+ * the field is not found, or if the body is not in the simple form of KMS
+ * responses (e.g. the value has escape sequences or the body is not valid
+ * JSON). */
+static bool
+_json_find_utf8(const char *body, size_t body_len, const char *field, const char **value, size_t *value_len) {
+    const char *const end = body + body_len;
+    const size_t field_len = strlen(field);
+    const char *p;
+    bool found = false;
+    bool escaped;
+
+    BSON_ASSERT_PARAM(body);
+    BSON_ASSERT_PARAM(field);
+    BSON_ASSERT_PARAM(value);
+    BSON_ASSERT_PARAM(value_len);
+
+    p = _json_skip_ws(body, end);
+    if (p == end || *p != '{') {
+        return false;
+    }
+    p = _json_skip_ws(p + 1, end);
+    if (p < end && *p == '}') {
+        return false;
+    }
+
+    while (true) {
+        const char *key;
+        const char *start;
+        size_t key_len;
+
+        if (p == end || *p != '"') {
+            return false;
+        }
+        key = p + 1;
+        if (!(p = _json_skip_string(p, end, &escaped))) {
+            return false;
+        }
+        key_len = (size_t)(p - 1 - key);
+        p = _json_skip_ws(p, end);
+        if (p == end || *p != ':') {
+            return false;
+        }
+        start = _json_skip_ws(p + 1, end);
+        if (!(p = _json_skip_value(start, end, JSON_MAX_DEPTH))) {
+            return false;
+        }
+
+        if (!found && !escaped && key_len == field_len && 0 == memcmp(key, field, field_len)) {
+            if (*start != '"' || !_json_skip_string(start, end, &escaped) || escaped) {
+                return false;
+            }
+            *value = start + 1;
+            *value_len = (size_t)(p - 1 - *value);
+            found = true;
+        }
+
+        p = _json_skip_ws(p, end);
+        if (p == end) {
+            return false;
+        }
+        if (*p == '}') {
+            break;
+        }
+        if (*p != ',') {
+            return false;
+        }
+        p = _json_skip_ws(p + 1, end);
+    }
+
+    /* Only whitespace may follow the object. */
+    return found && _json_skip_ws(p + 1, end) == end;
+}
+
+/* _kms_body_find_utf8 sets @out to a copy of the top-level string field @field
+ * of the JSON KMS response @body. The body is scanned for the field without
+ * converting it to BSON. Bodies the scan does not handle are converted with
+ * bson_init_from_json, which also reports the errors. */
+static bool _kms_body_find_utf8(const char *body,
+                                size_t body_len,
+                                int http_status,
+                                const char *field,
+                                char **out,
+                                uint32_t *out_len,
+                                mongocrypt_status_t *status) {
+    bson_t body_bson;
+    bson_error_t bson_error;
+    bson_iter_t iter;
+    const char *value;
+    size_t value_len;
+    uint32_t utf8_len;
+
+    BSON_ASSERT_PARAM(body);
+    BSON_ASSERT_PARAM(field);
+    BSON_ASSERT_PARAM(out);
+    BSON_ASSERT_PARAM(out_len);
+
+    if (_json_find_utf8(body, body_len, field, &value, &value_len) && value_len < UINT32_MAX) {
+        *out = bson_strndup(value, value_len);
+        *out_len = (uint32_t)value_len;
+        return true;
+    }
+
+    if (body_len > (size_t)SSIZE_MAX) {
+        CLIENT_ERR("Error parsing JSON in KMS response. "
+                   "Response body exceeds maximum supported length");
+        return false;
+    }
+    if (!bson_init_from_json(&body_bson, body, (ssize_t)body_len, &bson_error)) {
+        CLIENT_ERR("Error parsing JSON in KMS response '%s'. "
+                   "HTTP status=%d. Response body=\n%s",
+                   bson_error.message,
+                   http_status,
+                   body);
+        return false;
+    }
+
+    if (!bson_iter_init_find(&iter, &body_bson, field) || !BSON_ITER_HOLDS_UTF8(&iter)) {
+        CLIENT_ERR("KMS JSON response does not include field '%s'. HTTP status=%d. "
+                   "Response body=\n%s",
+                   field,
+                   http_status,
+                   body);
+        bson_destroy(&body_bson);
+        return false;
+    }
+
+    value = bson_iter_utf8(&iter, &utf8_len);
+    *out = bson_strndup(value, utf8_len);
+    *out_len = utf8_len;
+    bson_destroy(&body_bson);
+    return true;
+}
+
 /* An AWS KMS context has received full response. Parse out the result or error.
  */
 static bool _ctx_done_aws(mongocrypt_kms_ctx_t *kms, const char *json_field) {
@@ -463,12 +985,9 @@ static bool _ctx_done_aws(mongocrypt_kms_ctx_t *kms, const char *json_field) {
 
     kms_response_t *response = NULL;
     const char *body;
-    bson_t body_bson = BSON_INITIALIZER;
     bool ret;
-    bson_error_t bson_error;
-    bson_iter_t iter;
     uint32_t b64_strlen;
-    char *b64_str;
+    char *b64_str = NULL;
     int http_status;
     size_t body_len;
     int result_len;
@@ -492,35 +1011,10 @@ static bool _ctx_done_aws(mongocrypt_kms_ctx_t *kms, const char *json_field) {
 
     /* If HTTP response succeeded (status 200) then body should contain JSON.
      */
-    bson_destroy(&body_bson);
-    if (body_len > (size_t)SSIZE_MAX) {
-        CLIENT_ERR("Error parsing JSON in KMS response '%s'. "
-                   "Response body exceeds maximum supported length",
-                   bson_error.message);
-        bson_init(&body_bson);
-        goto fail;
-    }
-    if (!bson_init_from_json(&body_bson, body, (ssize_t)body_len, &bson_error)) {
-        CLIENT_ERR("Error parsing JSON in KMS response '%s'. "
-                   "HTTP status=%d. Response body=\n%s",
-                   bson_error.message,
-                   http_status,
-                   body);
-        bson_init(&body_bson);
+    if (!_kms_body_find_utf8(body, body_len, http_status, json_field, &b64_str, &b64_strlen, status)) {
         goto fail;
     }
 
-    if (!bson_iter_init_find(&iter, &body_bson, json_field) || !BSON_ITER_HOLDS_UTF8(&iter)) {
-        CLIENT_ERR("KMS JSON response does not include field '%s'. HTTP status=%d. "
-                   "Response body=\n%s",
-                   json_field,
-                   http_status,
-                   body);
-        goto fail;
-    }
-
-    b64_str = (char *)bson_iter_utf8(&iter, &b64_strlen);
-    BSON_ASSERT(b64_str);
     uint8_t *result_data = bson_malloc((size_t)b64_strlen + 1u);
     BSON_ASSERT(result_data);
 
@@ -535,7 +1029,7 @@ static bool _ctx_done_aws(mongocrypt_kms_ctx_t *kms, const char *json_field) {
     kms->result.owned = true;
     ret = true;
 fail:
-    bson_destroy(&body_bson);
+    bson_free(b64_str);
     kms_response_destroy(response);
     return ret;
 }
@@ -622,11 +1116,10 @@ static bool _ctx_done_azure_wrapkey_unwrapkey(mongocrypt_kms_ctx_t *kms) {
     bson_t *bson_body = NULL;
     bool ret;
     bson_error_t bson_error;
-    bson_iter_t iter;
     int http_status;
     size_t body_len;
     mongocrypt_status_t *status;
-    const char *b64url_data = NULL;
+    char *b64url_data = NULL;
     uint32_t b64url_len;
     char *b64_data = NULL;
     uint32_t b64_len;
@@ -648,36 +1141,30 @@ static bool _ctx_done_azure_wrapkey_unwrapkey(mongocrypt_kms_ctx_t *kms) {
         goto fail;
     }
 
-    if (body_len > (size_t)SSIZE_MAX) {
-        CLIENT_ERR("Error parsing JSON in KMS response '%s'. "
-                   "Response body exceeds maximum supported length",
-                   bson_error.message);
-        goto fail;
-    }
-    bson_body = bson_new_from_json((const uint8_t *)body, (ssize_t)body_len, &bson_error);
-    if (!bson_body) {
-        CLIENT_ERR("Error parsing JSON in KMS response '%s'. "
-                   "HTTP status=%d. Response body=\n%s",
-                   bson_error.message,
-                   http_status,
-                   body);
-        goto fail;
-    }
-
     if (http_status != 200) {
+        /* The body of an error response must also be JSON. */
+        if (body_len > (size_t)SSIZE_MAX) {
+            CLIENT_ERR("Error parsing JSON in KMS response. "
+                       "Response body exceeds maximum supported length");
+            goto fail;
+        }
+        bson_body = bson_new_from_json((const uint8_t *)body, (ssize_t)body_len, &bson_error);
+        if (!bson_body) {
+            CLIENT_ERR("Error parsing JSON in KMS response '%s'. "
+                       "HTTP status=%d. Response body=\n%s",
+                       bson_error.message,
+                       http_status,
+                       body);
+            goto fail;
+        }
         _handle_non200_http_status(http_status, body, body_len, status);
         goto fail;
     }
 
-    if (!bson_iter_init_find(&iter, bson_body, "value") || !BSON_ITER_HOLDS_UTF8(&iter)) {
-        CLIENT_ERR("KMS JSON response does not include field 'value'. HTTP status=%d. "
-                   "Response body=\n%s",
-                   http_status,
-                   body);
+    if (!_kms_body_find_utf8(body, body_len, http_status, "value", &b64url_data, &b64url_len, status)) {
         goto fail;
     }
 
-    b64url_data = bson_iter_utf8(&iter, &b64url_len);
     BSON_ASSERT(b64url_len <= UINT32_MAX - 4u);
     /* add four for padding. */
     b64_len = b64url_len + 4;
@@ -705,6 +1192,7 @@ fail:
     bson_destroy(bson_body);
     kms_response_destroy(response);
     bson_free(b64_data);
+    bson_free(b64url_data);
     return ret;
 }
 
@@ -716,12 +1204,10 @@ static bool _ctx_done_gcp(mongocrypt_kms_ctx_t *kms, const char *json_field) {
 
     kms_response_t *response = NULL;
     const char *body;
-    bson_t body_bson = BSON_INITIALIZER;
     bool ret;
-    bson_error_t bson_error;
-    bson_iter_t iter;
     size_t outlen;
-    char *b64_str;
+    char *b64_str = NULL;
+    uint32_t b64_strlen;
     int http_status;
     size_t body_len;
     mongocrypt_status_t *status;
@@ -744,42 +1230,17 @@ static bool _ctx_done_gcp(mongocrypt_kms_ctx_t *kms, const char *json_field) {
 
     /* If HTTP response succeeded (status 200) then body should contain JSON.
      */
-    bson_destroy(&body_bson);
-    if (body_len > (size_t)SSIZE_MAX) {
-        CLIENT_ERR("Error parsing JSON in KMS response '%s'. "
-                   "Response body exceeds maximum supported length",
-                   bson_error.message);
-        bson_init(&body_bson);
-        goto fail;
-    }
-    if (!bson_init_from_json(&body_bson, body, (ssize_t)body_len, &bson_error)) {
-        CLIENT_ERR("Error parsing JSON in KMS response '%s'. "
-                   "HTTP status=%d. Response body=\n%s",
-                   bson_error.message,
-                   http_status,
-                   body);
-        bson_init(&body_bson);
+    if (!_kms_body_find_utf8(body, body_len, http_status, json_field, &b64_str, &b64_strlen, status)) {
         goto fail;
     }
 
-    if (!bson_iter_init_find(&iter, &body_bson, json_field) || !BSON_ITER_HOLDS_UTF8(&iter)) {
-        CLIENT_ERR("KMS JSON response does not include field '%s'. HTTP status=%d. "
-                   "Response body=\n%s",
-                   json_field,
-                   http_status,
-                   body);
-        goto fail;
-    }
-
-    b64_str = (char *)bson_iter_utf8(&iter, NULL);
-    BSON_ASSERT(b64_str);
     kms->result.data = kms_message_b64_to_raw(b64_str, &outlen);
     BSON_ASSERT(outlen <= UINT32_MAX);
     kms->result.len = (uint32_t)outlen;
     kms->result.owned = true;
     ret = true;
 fail:
-    bson_destroy(&body_bson);
+    bson_free(b64_str);
     kms_response_destroy(response);
     return ret;
 }
@@ -813,7 +1274,7 @@ static bool _ctx_done_kmip_register(mongocrypt_kms_ctx_t *kms_ctx) {
     ret = true;
 
 done:
-    kms_response_destroy(res);
+    _destroy_kmip_response(kms_ctx, res);
     return ret;
 }
 
@@ -838,6 +1299,34 @@ static bool _ctx_done_kmip_get(mongocrypt_kms_ctx_t *kms_ctx) {
         goto done;
     }
 
+    if (kms_ctx->batch_len > 1) {
+        if (kms_kmip_response_get_batch_count(res) != kms_ctx->batch_len) {
+            CLIENT_ERR("Expected %zu items in KMIP Get response, got %zu",
+                       kms_ctx->batch_len,
+                       kms_kmip_response_get_batch_count(res));
+            goto done;
+        }
+
+        kms_ctx->batch_results = bson_malloc0(kms_ctx->batch_len * sizeof(_mongocrypt_buffer_t));
+        BSON_ASSERT(kms_ctx->batch_results);
+        for (size_t i = 0; i < kms_ctx->batch_len; i++) {
+            secretdata = kms_kmip_response_get_secretdata_at(res, i, &secretdata_len);
+            if (!secretdata) {
+                CLIENT_ERR("Error getting SecretData from KMIP Get response: %s", kms_response_get_error(res));
+                goto done;
+            }
+
+            if (!_mongocrypt_buffer_steal_from_data_and_size(&kms_ctx->batch_results[i], secretdata, secretdata_len)) {
+                CLIENT_ERR("Error storing KMS SecretData result");
+                bson_free(secretdata);
+                goto done;
+            }
+        }
+        _mongocrypt_buffer_copy_to(&kms_ctx->batch_results[0], &kms_ctx->result);
+        ret = true;
+        goto done;
+    }
+
     secretdata = kms_kmip_response_get_secretdata(res, &secretdata_len);
     if (!secretdata) {
         CLIENT_ERR("Error getting SecretData from KMIP Get response: %s", kms_response_get_error(res));
@@ -853,7 +1342,7 @@ static bool _ctx_done_kmip_get(mongocrypt_kms_ctx_t *kms_ctx) {
     ret = true;
 
 done:
-    kms_response_destroy(res);
+    _destroy_kmip_response(kms_ctx, res);
     return ret;
 }
 
@@ -886,7 +1375,7 @@ static bool _ctx_done_kmip_create(mongocrypt_kms_ctx_t *kms_ctx) {
     ret = true;
 
 done:
-    kms_response_destroy(res);
+    _destroy_kmip_response(kms_ctx, res);
     return ret;
 }
 
@@ -954,7 +1443,7 @@ static bool _ctx_done_kmip_encrypt(mongocrypt_kms_ctx_t *kms_ctx) {
     ret = true;
 
 done:
-    kms_response_destroy(res);
+    _destroy_kmip_response(kms_ctx, res);
     _mongocrypt_buffer_cleanup(&iv_buf);
     _mongocrypt_buffer_cleanup(&data_buf);
     return ret;
@@ -991,7 +1480,7 @@ static bool _ctx_done_kmip_decrypt(mongocrypt_kms_ctx_t *kms_ctx) {
     ret = true;
 
 done:
-    kms_response_destroy(res);
+    _destroy_kmip_response(kms_ctx, res);
     return ret;
 }
 
@@ -999,12 +1488,18 @@ bool mongocrypt_kms_ctx_feed(mongocrypt_kms_ctx_t *kms, mongocrypt_binary_t *byt
     if (!kms) {
         return false;
     }
+    _record_call(kms, "kms_ctx_feed", bytes);
 
     mongocrypt_status_t *status = kms->status;
     if (!mongocrypt_status_ok(status)) {
         return false;
     }
 
+    if (_mongocrypt_kms_ctx_hedge_lost(kms)) {
+        /* The other request of the hedged pair was used. */
+        return true;
+    }
+
     if (!bytes) {
         CLIENT_ERR("argument 'bytes' is required");
         return false;
@@ -1020,6 +1515,12 @@ bool mongocrypt_kms_ctx_feed(mongocrypt_kms_ctx_t *kms, mongocrypt_binary_t *byt
         return false;
     }
 
+    if (kms->deadline_us != 0 && bson_get_monotonic_time() >= kms->deadline_us) {
+        CLIENT_ERR("deadline exceeded while reading the KMS response");
+        _end_trace(kms, false);
+        return false;
+    }
+
     if (kms->log && kms->log->trace_enabled) {
         _mongocrypt_log(kms->log,
                         MONGOCRYPT_LOG_LEVEL_TRACE,
@@ -1030,38 +1531,74 @@ bool mongocrypt_kms_ctx_feed(mongocrypt_kms_ctx_t *kms, mongocrypt_binary_t *byt
                         mongocrypt_binary_data(bytes));
     }
 
-    if (!kms_response_parser_feed(kms->parser, bytes->data, bytes->len)) {
-        if (is_kms(kms->req_type)) {
-            /* The KMIP response parser does not suport kms_response_parser_status.
-             * Only report the error string. */
-            CLIENT_ERR("KMS response parser error with error: '%s'", kms_response_parser_error(kms->parser));
-        } else {
-            CLIENT_ERR("KMS response parser error with status %d, error: '%s'",
-                       kms_response_parser_status(kms->parser),
-                       kms_response_parser_error(kms->parser));
+    for (uint32_t offset = 0u; offset < bytes->len;) {
+        uint8_t *const data = bytes->data + offset;
+        uint32_t len = bytes->len - offset;
+
+        if (kms->large_reads) {
+            len = _large_read_len(kms, data, len);
+            if (0u == len) {
+                CLIENT_ERR("KMS response fed too much data");
+                return false;
+            }
         }
 
-        return false;
+        if (!kms_response_parser_feed(kms->parser, data, len)) {
+            if (is_kms(kms->req_type)) {
+                /* The KMIP response parser does not suport kms_response_parser_status.
+                 * Only report the error string. */
+                CLIENT_ERR("KMS response parser error with error: '%s'", kms_response_parser_error(kms->parser));
+            } else {
+                CLIENT_ERR("KMS response parser error with status %d, error: '%s'",
+                           kms_response_parser_status(kms->parser),
+                           kms_response_parser_error(kms->parser));
+            }
+
+            _record_stats(kms, false, 0);
+            _end_trace(kms, false);
+            return false;
+        }
+        offset += len;
     }
 
     if (0 == mongocrypt_kms_ctx_bytes_needed(kms)) {
+        /* The KMIP response parser does not support kms_response_parser_status. */
+        int http_status = is_kms(kms->req_type) ? 0 : kms_response_parser_status(kms->parser);
+        bool ret;
+
+        if (kms->retry_enabled && !is_kms(kms->req_type) && kms->attempts < KMS_MAX_RETRIES
+            && _is_retryable_http_status(http_status) && _retry_fits_deadline(kms)) {
+            _record_stats(kms, false, http_status);
+            _reset_for_retry(kms);
+            return true;
+        }
+
         switch (kms->req_type) {
-        default: CLIENT_ERR("Unknown request type"); return false;
-        case MONGOCRYPT_KMS_AWS_ENCRYPT: return _ctx_done_aws(kms, "CiphertextBlob");
-        case MONGOCRYPT_KMS_AWS_DECRYPT: return _ctx_done_aws(kms, "Plaintext");
-        case MONGOCRYPT_KMS_AZURE_OAUTH: return _ctx_done_oauth(kms);
-        case MONGOCRYPT_KMS_AZURE_WRAPKEY: return _ctx_done_azure_wrapkey_unwrapkey(kms);
-        case MONGOCRYPT_KMS_AZURE_UNWRAPKEY: return _ctx_done_azure_wrapkey_unwrapkey(kms);
-        case MONGOCRYPT_KMS_GCP_OAUTH: return _ctx_done_oauth(kms);
-        case MONGOCRYPT_KMS_GCP_ENCRYPT: return _ctx_done_gcp(kms, "ciphertext");
-        case MONGOCRYPT_KMS_GCP_DECRYPT: return _ctx_done_gcp(kms, "plaintext");
-        case MONGOCRYPT_KMS_KMIP_REGISTER: return _ctx_done_kmip_register(kms);
-        case MONGOCRYPT_KMS_KMIP_ACTIVATE: return _ctx_done_kmip_activate(kms);
-        case MONGOCRYPT_KMS_KMIP_GET: return _ctx_done_kmip_get(kms);
-        case MONGOCRYPT_KMS_KMIP_ENCRYPT: return _ctx_done_kmip_encrypt(kms);
-        case MONGOCRYPT_KMS_KMIP_DECRYPT: return _ctx_done_kmip_decrypt(kms);
-        case MONGOCRYPT_KMS_KMIP_CREATE: return _ctx_done_kmip_create(kms);
+        default:
+            CLIENT_ERR("Unknown request type");
+            ret = false;
+            break;
+        case MONGOCRYPT_KMS_AWS_ENCRYPT: ret = _ctx_done_aws(kms, "CiphertextBlob"); break;
+        case MONGOCRYPT_KMS_AWS_DECRYPT: ret = _ctx_done_aws(kms, "Plaintext"); break;
+        case MONGOCRYPT_KMS_AZURE_OAUTH: ret = _ctx_done_oauth(kms); break;
+        case MONGOCRYPT_KMS_AZURE_WRAPKEY: ret = _ctx_done_azure_wrapkey_unwrapkey(kms); break;
+        case MONGOCRYPT_KMS_AZURE_UNWRAPKEY: ret = _ctx_done_azure_wrapkey_unwrapkey(kms); break;
+        case MONGOCRYPT_KMS_GCP_OAUTH: ret = _ctx_done_oauth(kms); break;
+        case MONGOCRYPT_KMS_GCP_ENCRYPT: ret = _ctx_done_gcp(kms, "ciphertext"); break;
+        case MONGOCRYPT_KMS_GCP_DECRYPT: ret = _ctx_done_gcp(kms, "plaintext"); break;
+        case MONGOCRYPT_KMS_KMIP_REGISTER: ret = _ctx_done_kmip_register(kms); break;
+        case MONGOCRYPT_KMS_KMIP_ACTIVATE: ret = _ctx_done_kmip_activate(kms); break;
+        case MONGOCRYPT_KMS_KMIP_GET: ret = _ctx_done_kmip_get(kms); break;
+        case MONGOCRYPT_KMS_KMIP_ENCRYPT: ret = _ctx_done_kmip_encrypt(kms); break;
+        case MONGOCRYPT_KMS_KMIP_DECRYPT: ret = _ctx_done_kmip_decrypt(kms); break;
+        case MONGOCRYPT_KMS_KMIP_CREATE: ret = _ctx_done_kmip_create(kms); break;
+        }
+        _record_stats(kms, ret, http_status);
+        _end_trace(kms, ret);
+        if (ret) {
+            _claim_hedge(kms);
         }
+        return ret;
     }
     return true;
 }
@@ -1081,7 +1618,7 @@ bool _mongocrypt_kms_ctx_result(mongocrypt_kms_ctx_t *kms, _mongocrypt_buffer_t
         return false;
     }
 
-    if (mongocrypt_kms_ctx_bytes_needed(kms) > 0) {
+    if (kms->should_retry || mongocrypt_kms_ctx_bytes_needed(kms) > 0) {
         CLIENT_ERR("KMS response unfinished");
         return false;
     }
@@ -1092,6 +1629,90 @@ bool _mongocrypt_kms_ctx_result(mongocrypt_kms_ctx_t *kms, _mongocrypt_buffer_t
     return true;
 }
 
+bool _mongocrypt_kms_ctx_batch_result(mongocrypt_kms_ctx_t *kms, size_t index, _mongocrypt_buffer_t *out) {
+    BSON_ASSERT_PARAM(kms);
+    BSON_ASSERT_PARAM(out);
+
+    if (index == 0) {
+        return _mongocrypt_kms_ctx_result(kms, out);
+    }
+
+    if (!_mongocrypt_kms_ctx_result(kms, out)) {
+        return false;
+    }
+
+    if (index >= kms->batch_len || !kms->batch_results) {
+        mongocrypt_status_t *status = kms->status;
+        CLIENT_ERR("KMIP batch result %zu not found", index);
+        return false;
+    }
+
+    _mongocrypt_buffer_init(out);
+    out->data = kms->batch_results[index].data;
+    out->len = kms->batch_results[index].len;
+    return true;
+}
+
+int64_t mongocrypt_kms_ctx_usleep(mongocrypt_kms_ctx_t *kms) {
+    int64_t sleep_usec;
+
+    if (!kms) {
+        return 0;
+    }
+    sleep_usec = kms->should_retry ? kms->sleep_usec : 0;
+    return kms->pace_usec > sleep_usec ? kms->pace_usec : sleep_usec;
+}
+
+int64_t mongocrypt_kms_ctx_remaining_us(mongocrypt_kms_ctx_t *kms) {
+    int64_t remaining;
+
+    if (!kms || kms->deadline_us == 0) {
+        return -1;
+    }
+    remaining = kms->deadline_us - bson_get_monotonic_time();
+    return remaining > 0 ? remaining : 0;
+}
+
+bool mongocrypt_kms_ctx_fail(mongocrypt_kms_ctx_t *kms) {
+    if (!kms) {
+        return false;
+    }
+    _record_call(kms, "kms_ctx_fail", NULL);
+
+    mongocrypt_status_t *status = kms->status;
+    if (!mongocrypt_status_ok(status)) {
+        return false;
+    }
+
+    if (_mongocrypt_kms_ctx_hedge_lost(kms)) {
+        /* The other request of the hedged pair was used. */
+        return true;
+    }
+
+    _record_stats(kms, false, 0);
+
+    if (!kms->retry_enabled) {
+        CLIENT_ERR("KMS request failed and retries are not enabled");
+        _end_trace(kms, false);
+        return false;
+    }
+
+    if (kms->attempts >= KMS_MAX_RETRIES) {
+        CLIENT_ERR("KMS request failed after %d retries", kms->attempts);
+        _end_trace(kms, false);
+        return false;
+    }
+
+    if (!_retry_fits_deadline(kms)) {
+        CLIENT_ERR("KMS request failed and the deadline leaves no time to retry");
+        _end_trace(kms, false);
+        return false;
+    }
+
+    _reset_for_retry(kms);
+    return true;
+}
+
 bool mongocrypt_kms_ctx_status(mongocrypt_kms_ctx_t *kms, mongocrypt_status_t *status_out) {
     if (!kms) {
         return false;
@@ -1106,10 +1727,38 @@ bool mongocrypt_kms_ctx_status(mongocrypt_kms_ctx_t *kms, mongocrypt_status_t *s
     return mongocrypt_status_ok(status_out);
 }
 
+void _mongocrypt_kms_ctx_set_keep_alive(mongocrypt_kms_ctx_t *kms) {
+    static const char header[] = "\r\nConnection:close\r\n";
+    const uint32_t header_len = (uint32_t)(sizeof(header) - 1u);
+
+    BSON_ASSERT_PARAM(kms);
+
+    if (is_kms(kms->req_type) || !kms->msg.owned) {
+        return;
+    }
+
+    /* The header is not signed, so it can be removed after signing. Only the
+     * header section is searched. The leading CRLF of the header is kept. */
+    for (uint32_t i = 0u; i + header_len <= kms->msg.len; i++) {
+        uint8_t *const at = kms->msg.data + i;
+
+        if (0 == memcmp(at, "\r\n\r\n", 4u)) {
+            return;
+        }
+        if (0 == memcmp(at, header, header_len)) {
+            memmove(at + 2u, at + header_len, kms->msg.len - i - header_len);
+            kms->msg.len -= header_len - 2u;
+            kms->msg.data[kms->msg.len] = '\0';
+            return;
+        }
+    }
+}
+
 void _mongocrypt_kms_ctx_cleanup(mongocrypt_kms_ctx_t *kms) {
     if (!kms) {
         return;
     }
+    _end_trace(kms, false);
     if (kms->req) {
         kms_request_destroy(kms->req);
     }
@@ -1119,6 +1768,10 @@ void _mongocrypt_kms_ctx_cleanup(mongocrypt_kms_ctx_t *kms) {
     mongocrypt_status_destroy(kms->status);
     _mongocrypt_buffer_cleanup(&kms->msg);
     _mongocrypt_buffer_cleanup(&kms->result);
+    for (size_t i = 0; kms->batch_results && i < kms->batch_len; i++) {
+        _mongocrypt_buffer_cleanup(&kms->batch_results[i]);
+    }
+    bson_free(kms->batch_results);
     bson_free(kms->endpoint);
     bson_free(kms->kmsid);
 }
@@ -1133,6 +1786,10 @@ bool mongocrypt_kms_ctx_message(mongocrypt_kms_ctx_t *kms, mongocrypt_binary_t *
         CLIENT_ERR("argument 'msg' is required");
         return false;
     }
+    if (kms->start_us == 0) {
+        kms->start_us = bson_get_monotonic_time();
+        MONGOCRYPT_PROBE3(kms__start, kms->kmsid, (int)kms->req_type, kms->msg.len);
+    }
     msg->data = kms->msg.data;
     msg->len = kms->msg.len;
     return true;
@@ -1694,9 +2351,20 @@ bool _mongocrypt_kms_ctx_init_kmip_get(mongocrypt_kms_ctx_t *kms_ctx,
                                        const char *unique_identifier,
                                        const char *kmsid,
                                        _mongocrypt_log_t *log) {
+    BSON_ASSERT_PARAM(unique_identifier);
+
+    return _mongocrypt_kms_ctx_init_kmip_get_batch(kms_ctx, endpoint, &unique_identifier, 1, kmsid, log);
+}
+
+bool _mongocrypt_kms_ctx_init_kmip_get_batch(mongocrypt_kms_ctx_t *kms_ctx,
+                                             const _mongocrypt_endpoint_t *endpoint,
+                                             const char *const *unique_identifiers,
+                                             size_t count,
+                                             const char *kmsid,
+                                             _mongocrypt_log_t *log) {
     BSON_ASSERT_PARAM(kms_ctx);
     BSON_ASSERT_PARAM(endpoint);
-    BSON_ASSERT_PARAM(unique_identifier);
+    BSON_ASSERT_PARAM(unique_identifiers);
 
     mongocrypt_status_t *status;
     bool ret = false;
@@ -1708,7 +2376,8 @@ bool _mongocrypt_kms_ctx_init_kmip_get(mongocrypt_kms_ctx_t *kms_ctx,
 
     kms_ctx->endpoint = bson_strdup(endpoint->host_and_port);
     _mongocrypt_apply_default_port(&kms_ctx->endpoint, DEFAULT_KMIP_PORT);
-    kms_ctx->req = kms_kmip_request_get_new(NULL /* reserved */, unique_identifier);
+    kms_ctx->batch_len = count;
+    kms_ctx->req = kms_kmip_request_get_batch_new(NULL /* reserved */, unique_identifiers, count);
 
     if (kms_request_get_error(kms_ctx->req)) {
         CLIENT_ERR("Error creating KMIP get request: %s", kms_request_get_error(kms_ctx->req));
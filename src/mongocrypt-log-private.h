@@ -21,9 +21,14 @@
 #include "mongocrypt.h"
 
 typedef struct {
-    mongocrypt_mutex_t mutex; /* protects fn and ctx. */
+    mongocrypt_mutex_t mutex; /* protects fn, ctx, and level. */
     mongocrypt_log_fn_t fn;
     void *ctx;
+    /* level is the least severe level passed to fn. */
+    mongocrypt_log_level_t level;
+    /* max_level is level, or -1 if fn is NULL. It is read atomically without
+     * the mutex, so messages that are dropped are not formatted. */
+    volatile int32_t max_level;
     bool trace_enabled;
 } _mongocrypt_log_t;
 
@@ -38,6 +43,10 @@ void _mongocrypt_log_cleanup(_mongocrypt_log_t *log);
 
 void _mongocrypt_log_set_fn(_mongocrypt_log_t *log, mongocrypt_log_fn_t fn, void *ctx);
 
+/* Drop messages less severe than @level. TRACE messages also require
+ * MONGOCRYPT_TRACE to be set. */
+void _mongocrypt_log_set_level(_mongocrypt_log_t *log, mongocrypt_log_level_t level);
+
 #ifdef MONGOCRYPT_ENABLE_TRACE
 
 #define CRYPT_TRACEF(log, fmt, ...)                                                                                    \
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include "mongocrypt-atomic-private.h"
 #include "mongocrypt-config.h"
 #include "mongocrypt-log-private.h"
 #include "mongocrypt-opts-private.h"
@@ -24,6 +25,7 @@ void _mongocrypt_log_init(_mongocrypt_log_t *log) {
     BSON_ASSERT_PARAM(log);
 
     _mongocrypt_mutex_init(&log->mutex);
+    log->level = MONGOCRYPT_LOG_LEVEL_TRACE;
     /* Initially, no log function is set. */
     _mongocrypt_log_set_fn(log, NULL, NULL);
 #ifdef MONGOCRYPT_ENABLE_TRACE
@@ -60,6 +62,16 @@ void _mongocrypt_log_set_fn(_mongocrypt_log_t *log, mongocrypt_log_fn_t fn, void
     _mongocrypt_mutex_lock(&log->mutex);
     log->fn = fn;
     log->ctx = ctx;
+    _mongocrypt_atomic_int32_exchange(&log->max_level, fn ? (int32_t)log->level : -1);
+    _mongocrypt_mutex_unlock(&log->mutex);
+}
+
+void _mongocrypt_log_set_level(_mongocrypt_log_t *log, mongocrypt_log_level_t level) {
+    BSON_ASSERT_PARAM(log);
+
+    _mongocrypt_mutex_lock(&log->mutex);
+    log->level = level;
+    _mongocrypt_atomic_int32_exchange(&log->max_level, log->fn ? (int32_t)log->level : -1);
     _mongocrypt_mutex_unlock(&log->mutex);
 }
 
@@ -74,6 +86,11 @@ void _mongocrypt_log(_mongocrypt_log_t *log, mongocrypt_log_level_t level, const
         return;
     }
 
+    /* Check before formatting whether the message would be dropped. */
+    if ((int32_t)level > _mongocrypt_atomic_int32_load(&log->max_level)) {
+        return;
+    }
+
     va_start(args, format);
     message = bson_strdupv_printf(format, args);
     va_end(args);
@@ -53,6 +53,12 @@ bool _mongocrypt_marking_parse_unowned(const _mongocrypt_buffer_t *in,
                                        _mongocrypt_marking_t *out,
                                        mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
 
+/* Like _mongocrypt_marking_parse_unowned, but skips validating the BSON of @in.
+ * Only use for a marking that was already parsed with validation. */
+bool _mongocrypt_marking_parse_unowned_unchecked(const _mongocrypt_buffer_t *in,
+                                                 _mongocrypt_marking_t *out,
+                                                 mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
 // Callers are expected to initialize `ciphertext` with
 // `_mongocrypt_ciphertext_init before calling,
 // and eventually free it using `_mongocrypt_ciphertext_cleanup`.
@@ -61,8 +67,46 @@ bool _mongocrypt_marking_to_ciphertext(void *ctx,
                                        _mongocrypt_ciphertext_t *ciphertext,
                                        mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
 
+/* Returns true if @marking is a FLE2 equality find placeholder. */
+bool _mongocrypt_marking_is_find_equality(const _mongocrypt_marking_t *marking);
+
+/* Converts each of the @n FLE2 equality find markings in @markings to the
+ * FLE2FindEqualityPayloadV2 in the matching entry of @ciphertexts, which must
+ * be initialized. Produces the same payloads as _mongocrypt_marking_to_ciphertext,
+ * but derives the tokens of markings sharing an index key in one pass, with one
+ * batched HMAC call or one parallel_for task per value. Requires
+ * opts.use_fle2_v2. */
+bool _mongocrypt_find_equality_markings_to_ciphertexts(void *ctx,
+                                                       _mongocrypt_marking_t *markings,
+                                                       _mongocrypt_ciphertext_t *ciphertexts,
+                                                       uint32_t n,
+                                                       mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
+/* Returns an estimate of the length of the ciphertext that replaces the
+ * marking @marking parsed from @in. It is used to reserve output buffers, so it
+ * need not be exact. */
+uint64_t _mongocrypt_marking_ciphertext_len_estimate(const _mongocrypt_marking_t *marking,
+                                                     const _mongocrypt_buffer_t *in);
+
+/* Sets @out to the number of edges of the range insert marking @marking, or to
+ * the length of the mincover of the range find marking @marking. Sets 0 for
+ * other markings. No keys are needed. */
+bool _mongocrypt_marking_range_len(mongocrypt_t *crypt,
+                                   _mongocrypt_marking_t *marking,
+                                   uint64_t *out,
+                                   mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
 mc_mincover_t *mc_get_mincover_from_FLE2RangeFindSpec(mc_FLE2RangeFindSpec_t *findSpec,
                                                       size_t sparsity,
                                                       mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
 
+/* mc_range_estimate computes the range index costs described at
+ * mongocrypt_range_estimate for the BSON document @in and appends them to
+ * @out. No values are encrypted. */
+bool mc_range_estimate(_mongocrypt_crypto_t *crypto,
+                       const bson_t *in,
+                       bool use_range_v2,
+                       bson_t *out,
+                       mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
 #endif /* MONGOCRYPT_MARKING_PRIVATE_H */
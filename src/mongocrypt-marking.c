@@ -28,8 +28,10 @@
 #include "mc-range-edge-generation-private.h"
 #include "mc-range-encoding-private.h"
 #include "mc-range-mincover-private.h"
+#include "mc-rangeopts-private.h"
 #include "mc-tokens-private.h"
 #include "mongocrypt-buffer-private.h"
+#include "mongocrypt-cache-find-payload-private.h"
 #include "mongocrypt-ciphertext-private.h"
 #include "mongocrypt-crypto-private.h"
 #include "mongocrypt-key-broker-private.h"
@@ -147,9 +149,10 @@ _mongocrypt_marking_parse_fle2_placeholder(const bson_t *in, _mongocrypt_marking
     return mc_FLE2EncryptionPlaceholder_parse(&out->fle2, in, status);
 }
 
-bool _mongocrypt_marking_parse_unowned(const _mongocrypt_buffer_t *in,
-                                       _mongocrypt_marking_t *out,
-                                       mongocrypt_status_t *status) {
+static bool _marking_parse(const _mongocrypt_buffer_t *in,
+                           _mongocrypt_marking_t *out,
+                           bool validate,
+                           mongocrypt_status_t *status) {
     bson_t bson;
 
     BSON_ASSERT_PARAM(in);
@@ -162,7 +165,8 @@ bool _mongocrypt_marking_parse_unowned(const _mongocrypt_buffer_t *in,
         return false;
     }
 
-    if (!bson_init_static(&bson, in->data + 1, in->len - 1) || !bson_validate(&bson, BSON_VALIDATE_NONE, NULL)) {
+    if (!bson_init_static(&bson, in->data + 1, in->len - 1)
+        || (validate && !bson_validate(&bson, BSON_VALIDATE_NONE, NULL))) {
         CLIENT_ERR("invalid BSON");
         return false;
     }
@@ -177,6 +181,18 @@ bool _mongocrypt_marking_parse_unowned(const _mongocrypt_buffer_t *in,
     }
 }
 
+bool _mongocrypt_marking_parse_unowned(const _mongocrypt_buffer_t *in,
+                                       _mongocrypt_marking_t *out,
+                                       mongocrypt_status_t *status) {
+    return _marking_parse(in, out, true /* validate */, status);
+}
+
+bool _mongocrypt_marking_parse_unowned_unchecked(const _mongocrypt_buffer_t *in,
+                                                 _mongocrypt_marking_t *out,
+                                                 mongocrypt_status_t *status) {
+    return _marking_parse(in, out, false /* validate */, status);
+}
+
 void _mongocrypt_marking_init(_mongocrypt_marking_t *marking) {
     BSON_ASSERT_PARAM(marking);
 
@@ -210,12 +226,15 @@ void _mongocrypt_marking_cleanup(_mongocrypt_marking_t *marking) {
  * If {useContentionFactor} is False, E?CDerivedFromDataToken is saved to out, and {contentionFactor} is ignored.
  * Otherwise, E?CDerivedFromDataTokenAndContentionFactor is saved to out using {contentionFactor}.
  *
+ * If {cachedToken} is not NULL, it is used as E?CToken instead of deriving it.
+ *
  * Note that {out} is initialized even on failure.
  */
 #define DERIVE_TOKEN_IMPL(Name)                                                                                        \
     static bool _fle2_derive_##Name##_token(_mongocrypt_crypto_t *crypto,                                              \
                                             _mongocrypt_buffer_t *out,                                                 \
                                             const mc_CollectionsLevel1Token_t *level1Token,                            \
+                                            const mc_##Name##Token_t *cachedToken,                                     \
                                             const _mongocrypt_buffer_t *value,                                         \
                                             bool useContentionFactor,                                                  \
                                             int64_t contentionFactor,                                                  \
@@ -227,42 +246,41 @@ void _mongocrypt_marking_cleanup(_mongocrypt_marking_t *marking) {
                                                                                                                        \
         _mongocrypt_buffer_init(out);                                                                                  \
                                                                                                                        \
-        mc_##Name##Token_t *token = mc_##Name##Token_new(crypto, level1Token, status);                                 \
+        /* Intermediate tokens are derived on the stack. */                                                            \
+        mc_##Name##Token_t derivedToken;                                                                               \
+        const mc_##Name##Token_t *token = cachedToken;                                                                 \
         if (!token) {                                                                                                  \
-            return false;                                                                                              \
+            if (!mc_##Name##Token_derive(&derivedToken, crypto, level1Token, status)) {                                \
+                return false;                                                                                          \
+            }                                                                                                          \
+            token = &derivedToken;                                                                                     \
         }                                                                                                              \
                                                                                                                        \
-        mc_##Name##DerivedFromDataToken_t *fromDataToken =                                                             \
-            mc_##Name##DerivedFromDataToken_new(crypto, token, value, status);                                         \
-        mc_##Name##Token_destroy(token);                                                                               \
-        if (!fromDataToken) {                                                                                          \
+        mc_##Name##DerivedFromDataToken_t fromDataToken;                                                               \
+        if (!mc_##Name##DerivedFromDataToken_derive(&fromDataToken, crypto, token, value, status)) {                   \
             return false;                                                                                              \
         }                                                                                                              \
                                                                                                                        \
         if (!useContentionFactor) {                                                                                    \
             /* FindEqualityPayload uses *fromDataToken */                                                              \
-            _mongocrypt_buffer_copy_to(mc_##Name##DerivedFromDataToken_get(fromDataToken), out);                       \
-            mc_##Name##DerivedFromDataToken_destroy(fromDataToken);                                                    \
+            _mongocrypt_buffer_copy_to(mc_##Name##DerivedFromDataToken_get(&fromDataToken), out);                      \
             return true;                                                                                               \
         }                                                                                                              \
                                                                                                                        \
         BSON_ASSERT(contentionFactor >= 0);                                                                            \
         /* InsertUpdatePayload continues through *fromDataTokenAndContentionFactor */                                  \
-        mc_##Name##DerivedFromDataTokenAndContentionFactor_t *fromTokenAndContentionFactor =                           \
-            mc_##Name##DerivedFromDataTokenAndContentionFactor_new(crypto,                                             \
-                                                                   fromDataToken,                                      \
-                                                                   (uint64_t)contentionFactor,                         \
-                                                                   status);                                            \
-        mc_##Name##DerivedFromDataToken_destroy(fromDataToken);                                                        \
-        if (!fromTokenAndContentionFactor) {                                                                           \
+        mc_##Name##DerivedFromDataTokenAndContentionFactor_t fromTokenAndContentionFactor;                             \
+        if (!mc_##Name##DerivedFromDataTokenAndContentionFactor_derive(&fromTokenAndContentionFactor,                  \
+                                                                       crypto,                                         \
+                                                                       &fromDataToken,                                 \
+                                                                       (uint64_t)contentionFactor,                     \
+                                                                       status)) {                                      \
             return false;                                                                                              \
         }                                                                                                              \
                                                                                                                        \
         _mongocrypt_buffer_copy_to(                                                                                    \
-            mc_##Name##DerivedFromDataTokenAndContentionFactor_get(fromTokenAndContentionFactor),                      \
+            mc_##Name##DerivedFromDataTokenAndContentionFactor_get(&fromTokenAndContentionFactor),                     \
             out);                                                                                                      \
-        mc_##Name##DerivedFromDataTokenAndContentionFactor_destroy(fromTokenAndContentionFactor);                      \
-                                                                                                                       \
         return true;                                                                                                   \
     }
 
@@ -285,18 +303,19 @@ static bool _fle2_derive_serverDerivedFromDataToken(_mongocrypt_crypto_t *crypto
 
     _mongocrypt_buffer_init(out);
 
-    mc_ServerDerivedFromDataToken_t *token = mc_ServerDerivedFromDataToken_new(crypto, level1Token, value, status);
-    if (!token) {
+    mc_ServerDerivedFromDataToken_t token;
+    if (!mc_ServerDerivedFromDataToken_derive(&token, crypto, level1Token, value, status)) {
         return false;
     }
 
-    _mongocrypt_buffer_copy_to(mc_ServerDerivedFromDataToken_get(token), out);
-    mc_ServerDerivedFromDataToken_destroy(token);
+    _mongocrypt_buffer_copy_to(mc_ServerDerivedFromDataToken_get(&token), out);
     return true;
 }
 
+// Encrypts {in} with a random IV, or with {iv_in} if it is not NULL.
 static bool _fle2_placeholder_aes_ctr_encrypt(_mongocrypt_crypto_t *crypto,
                                               const _mongocrypt_buffer_t *key,
+                                              const _mongocrypt_buffer_t *iv_in,
                                               const _mongocrypt_buffer_t *in,
                                               _mongocrypt_buffer_t *out,
                                               mongocrypt_status_t *status) {
@@ -316,7 +335,10 @@ static bool _fle2_placeholder_aes_ctr_encrypt(_mongocrypt_crypto_t *crypto,
     _mongocrypt_buffer_init_size(out, cipherlen);
 
     BSON_ASSERT(_mongocrypt_buffer_from_subrange(&iv, out, 0, MONGOCRYPT_IV_LEN));
-    if (!_mongocrypt_random(crypto, &iv, MONGOCRYPT_IV_LEN, status)) {
+    if (iv_in) {
+        BSON_ASSERT(iv_in->len == MONGOCRYPT_IV_LEN);
+        memcpy(iv.data, iv_in->data, MONGOCRYPT_IV_LEN);
+    } else if (!_mongocrypt_random(crypto, &iv, MONGOCRYPT_IV_LEN, status)) {
         return false;
     }
 
@@ -329,6 +351,8 @@ static bool _fle2_placeholder_aes_ctr_encrypt(_mongocrypt_crypto_t *crypto,
     return true;
 }
 
+// Sets out := keyId || EncryptAEAD(key, in). The ciphertext is written in place
+// after the key ID, so no intermediate ciphertext buffer is allocated.
 static bool _fle2_placeholder_aes_aead_encrypt(_mongocrypt_key_broker_t *kb,
                                                const _mongocrypt_value_encryption_algorithm_t *algorithm,
                                                _mongocrypt_buffer_t *out,
@@ -342,11 +366,16 @@ static bool _fle2_placeholder_aes_aead_encrypt(_mongocrypt_key_broker_t *kb,
     BSON_ASSERT(kb->crypt);
 
     _mongocrypt_crypto_t *crypto = kb->crypt->crypto;
-    _mongocrypt_buffer_t iv, key;
+    _mongocrypt_buffer_t iv, key, ciphertext;
+    uint8_t iv_storage[MONGOCRYPT_BUFFER_SMALL_LEN];
     const uint32_t cipherlen = algorithm->get_ciphertext_len(in->len, status);
     if (cipherlen == 0) {
         return false;
     }
+    if (cipherlen > UINT32_MAX - keyId->len) {
+        CLIENT_ERR("ciphertext too long: %" PRIu32, cipherlen);
+        return false;
+    }
     uint32_t written = 0;
     bool res;
 
@@ -355,14 +384,20 @@ static bool _fle2_placeholder_aes_aead_encrypt(_mongocrypt_key_broker_t *kb,
         return false;
     }
 
-    _mongocrypt_buffer_init_size(&iv, MONGOCRYPT_IV_LEN);
+    _mongocrypt_buffer_init_size_small(&iv, MONGOCRYPT_IV_LEN, iv_storage);
     if (!_mongocrypt_random(crypto, &iv, iv.len, status)) {
         _mongocrypt_buffer_cleanup(&key);
         return false;
     }
 
-    _mongocrypt_buffer_init_size(out, cipherlen);
-    res = algorithm->do_encrypt(crypto, &iv, keyId, &key, in, out, &written, status);
+    _mongocrypt_buffer_init_size(out, keyId->len + cipherlen);
+    memcpy(out->data, keyId->data, keyId->len);
+    if (!_mongocrypt_buffer_from_subrange(&ciphertext, out, keyId->len, cipherlen)) {
+        CLIENT_ERR("failed to create ciphertext subrange");
+        res = false;
+    } else {
+        res = algorithm->do_encrypt(crypto, &iv, keyId, &key, in, &ciphertext, &written, status);
+    }
     _mongocrypt_buffer_cleanup(&key);
     _mongocrypt_buffer_cleanup(&iv);
 
@@ -375,22 +410,53 @@ static bool _fle2_placeholder_aes_aead_encrypt(_mongocrypt_key_broker_t *kb,
     return true;
 }
 
+// Field derivations shared by both INSERT and FIND payloads.
+typedef struct {
+    _mongocrypt_buffer_t tokenKey;
+    mc_CollectionsLevel1Token_t *collectionsLevel1Token;
+    mc_ServerDataEncryptionLevel1Token_t *serverDataEncryptionLevel1Token;
+    mc_ServerTokenDerivationLevel1Token_t *serverTokenDerivationLevel1Token; // v2
+    _mongocrypt_buffer_t edcDerivedToken;
+    _mongocrypt_buffer_t escDerivedToken;
+    _mongocrypt_buffer_t eccDerivedToken;            // v1
+    _mongocrypt_buffer_t serverDerivedFromDataToken; // v2
+    // Tokens derived from the index key when it was cached. May be NULL.
+    const _mongocrypt_cache_key_tokens_t *keyTokens;
+} _FLE2EncryptedPayloadCommon_t;
+
+static void _FLE2EncryptedPayloadCommon_cleanup(_FLE2EncryptedPayloadCommon_t *common) {
+    if (!common) {
+        return;
+    }
+
+    _mongocrypt_buffer_cleanup(&common->tokenKey);
+    mc_CollectionsLevel1Token_destroy(common->collectionsLevel1Token);
+    mc_ServerDataEncryptionLevel1Token_destroy(common->serverDataEncryptionLevel1Token);
+    mc_ServerTokenDerivationLevel1Token_destroy(common->serverTokenDerivationLevel1Token);
+    _mongocrypt_buffer_cleanup(&common->edcDerivedToken);
+    _mongocrypt_buffer_cleanup(&common->escDerivedToken);
+    _mongocrypt_buffer_cleanup(&common->eccDerivedToken);
+    _mongocrypt_buffer_cleanup(&common->serverDerivedFromDataToken);
+    memset(common, 0, sizeof(*common));
+}
+
 // FLE V1: p := EncryptCTR(ECOCToken, ESCDerivedFromDataTokenAndContentionFactor ||
 //                            ECCDerivedFromDataTokenAndContentionFactor)
 // FLE V2: p := EncryptCTR(ECOCToken, ESCDerivedFromDataTokenAndContentionFactor)
 // Range V2: p := EncryptCTR(ECOCToken, ESCDerivedFromDataTokenAndContentionFactor || isLeaf)
-static bool _fle2_derive_encrypted_token(_mongocrypt_crypto_t *crypto,
-                                         _mongocrypt_buffer_t *out,
-                                         bool use_range_v2,
-                                         const mc_CollectionsLevel1Token_t *collectionsLevel1Token,
-                                         const _mongocrypt_buffer_t *escDerivedToken,
-                                         const _mongocrypt_buffer_t *eccDerivedToken,
-                                         mc_optional_bool_t is_leaf,
-                                         mongocrypt_status_t *status) {
-    mc_ECOCToken_t *ecocToken = mc_ECOCToken_new(crypto, collectionsLevel1Token, status);
-    if (!ecocToken) {
-        return false;
-    }
+// _fle2_encrypt_token is _fle2_derive_encrypted_token with an already derived {ecocToken}.
+// Like _fle2_encrypt_token, but encrypts with {iv} instead of a random IV if it is not NULL.
+static bool _fle2_encrypt_token_with_iv(_mongocrypt_crypto_t *crypto,
+                                        _mongocrypt_buffer_t *out,
+                                        bool use_range_v2,
+                                        const mc_ECOCToken_t *ecocToken,
+                                        const _mongocrypt_buffer_t *escDerivedToken,
+                                        const _mongocrypt_buffer_t *eccDerivedToken,
+                                        mc_optional_bool_t is_leaf,
+                                        const _mongocrypt_buffer_t *iv,
+                                        mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(ecocToken);
+
     bool ok = false;
 
     _mongocrypt_buffer_t tmp;
@@ -424,43 +490,126 @@ static bool _fle2_derive_encrypted_token(_mongocrypt_crypto_t *crypto,
         }
     }
 
-    if (!_fle2_placeholder_aes_ctr_encrypt(crypto, mc_ECOCToken_get(ecocToken), p, out, status)) {
+    if (!_fle2_placeholder_aes_ctr_encrypt(crypto, mc_ECOCToken_get(ecocToken), iv, p, out, status)) {
         goto fail;
     }
 
     ok = true;
 fail:
     _mongocrypt_buffer_cleanup(&tmp);
-    mc_ECOCToken_destroy(ecocToken);
     return ok;
 }
 
-// Field derivations shared by both INSERT and FIND payloads.
-typedef struct {
-    _mongocrypt_buffer_t tokenKey;
-    mc_CollectionsLevel1Token_t *collectionsLevel1Token;
-    mc_ServerDataEncryptionLevel1Token_t *serverDataEncryptionLevel1Token;
-    mc_ServerTokenDerivationLevel1Token_t *serverTokenDerivationLevel1Token; // v2
-    _mongocrypt_buffer_t edcDerivedToken;
-    _mongocrypt_buffer_t escDerivedToken;
-    _mongocrypt_buffer_t eccDerivedToken;            // v1
-    _mongocrypt_buffer_t serverDerivedFromDataToken; // v2
-} _FLE2EncryptedPayloadCommon_t;
+static bool _fle2_encrypt_token(_mongocrypt_crypto_t *crypto,
+                                _mongocrypt_buffer_t *out,
+                                bool use_range_v2,
+                                const mc_ECOCToken_t *ecocToken,
+                                const _mongocrypt_buffer_t *escDerivedToken,
+                                const _mongocrypt_buffer_t *eccDerivedToken,
+                                mc_optional_bool_t is_leaf,
+                                mongocrypt_status_t *status) {
+    return _fle2_encrypt_token_with_iv(crypto,
+                                       out,
+                                       use_range_v2,
+                                       ecocToken,
+                                       escDerivedToken,
+                                       eccDerivedToken,
+                                       is_leaf,
+                                       NULL /* iv */,
+                                       status);
+}
 
-static void _FLE2EncryptedPayloadCommon_cleanup(_FLE2EncryptedPayloadCommon_t *common) {
-    if (!common) {
+static bool _fle2_derive_encrypted_token(_mongocrypt_crypto_t *crypto,
+                                         _mongocrypt_buffer_t *out,
+                                         bool use_range_v2,
+                                         const _FLE2EncryptedPayloadCommon_t *common,
+                                         const _mongocrypt_buffer_t *escDerivedToken,
+                                         const _mongocrypt_buffer_t *eccDerivedToken,
+                                         mc_optional_bool_t is_leaf,
+                                         mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(common);
+
+    mc_ECOCToken_t derivedEcocToken;
+    const mc_ECOCToken_t *ecocToken = common->keyTokens ? common->keyTokens->ecocToken : NULL;
+    if (!ecocToken) {
+        if (!mc_ECOCToken_derive(&derivedEcocToken, crypto, common->collectionsLevel1Token, status)) {
+            return false;
+        }
+        ecocToken = &derivedEcocToken;
+    }
+
+    return _fle2_encrypt_token(crypto,
+                               out,
+                               use_range_v2,
+                               ecocToken,
+                               escDerivedToken,
+                               eccDerivedToken,
+                               is_leaf,
+                               status);
+}
+
+// Tokens derived only from the index key, shared by every edge of a range field.
+// Tokens found in the key cache are borrowed; the rest are derived once into the derived* storage.
+// The struct must not be copied once initialized, since the token pointers may point into it.
+typedef struct {
+    const mc_EDCToken_t *edcToken;
+    const mc_ESCToken_t *escToken;
+    const mc_ECCToken_t *eccToken; // FLE2v1 only.
+    const mc_ECOCToken_t *ecocToken;
+    mc_EDCToken_t derivedEdcToken;
+    mc_ESCToken_t derivedEscToken;
+    mc_ECCToken_t derivedEccToken;
+    mc_ECOCToken_t derivedEcocToken;
+} _fle2_edge_key_tokens_t;
+
+static void _fle2_edge_key_tokens_cleanup(_fle2_edge_key_tokens_t *tokens) {
+    if (!tokens) {
         return;
     }
 
-    _mongocrypt_buffer_cleanup(&common->tokenKey);
-    mc_CollectionsLevel1Token_destroy(common->collectionsLevel1Token);
-    mc_ServerDataEncryptionLevel1Token_destroy(common->serverDataEncryptionLevel1Token);
-    mc_ServerTokenDerivationLevel1Token_destroy(common->serverTokenDerivationLevel1Token);
-    _mongocrypt_buffer_cleanup(&common->edcDerivedToken);
-    _mongocrypt_buffer_cleanup(&common->escDerivedToken);
-    _mongocrypt_buffer_cleanup(&common->eccDerivedToken);
-    _mongocrypt_buffer_cleanup(&common->serverDerivedFromDataToken);
-    memset(common, 0, sizeof(*common));
+    // Derived tokens own no memory.
+    memset(tokens, 0, sizeof(*tokens));
+}
+
+// Derives the edge key tokens from {common}. {out} is initialized even on failure.
+static bool _fle2_edge_key_tokens_init(_mongocrypt_crypto_t *crypto,
+                                       const _FLE2EncryptedPayloadCommon_t *common,
+                                       bool use_ecc,
+                                       _fle2_edge_key_tokens_t *out,
+                                       mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(crypto);
+    BSON_ASSERT_PARAM(common);
+    BSON_ASSERT_PARAM(out);
+    BSON_ASSERT(common->collectionsLevel1Token);
+
+    const _mongocrypt_cache_key_tokens_t *keyTokens = common->keyTokens;
+    memset(out, 0, sizeof(*out));
+
+#define EDGE_KEY_TOKEN(Name, name, derived)                                                                            \
+    if (!out->name##Token) {                                                                                           \
+        if (!mc_##Name##Token_derive(&out->derived, crypto, common->collectionsLevel1Token, status)) {                 \
+            goto fail;                                                                                                 \
+        }                                                                                                              \
+        out->name##Token = &out->derived;                                                                              \
+    }
+
+    out->edcToken = keyTokens ? keyTokens->edcToken : NULL;
+    EDGE_KEY_TOKEN(EDC, edc, derivedEdcToken)
+    out->escToken = keyTokens ? keyTokens->escToken : NULL;
+    EDGE_KEY_TOKEN(ESC, esc, derivedEscToken)
+    if (use_ecc) {
+        EDGE_KEY_TOKEN(ECC, ecc, derivedEccToken)
+    }
+    out->ecocToken = keyTokens ? keyTokens->ecocToken : NULL;
+    EDGE_KEY_TOKEN(ECOC, ecoc, derivedEcocToken)
+
+#undef EDGE_KEY_TOKEN
+
+    return true;
+
+fail:
+    _fle2_edge_key_tokens_cleanup(out);
+    return false;
 }
 
 // _get_tokenKey returns the tokenKey identified by indexKeyId.
@@ -500,41 +649,88 @@ static bool _get_tokenKey(_mongocrypt_key_broker_t *kb,
     return true;
 }
 
-static bool _mongocrypt_fle2_placeholder_common(_mongocrypt_key_broker_t *kb,
-                                                _FLE2EncryptedPayloadCommon_t *ret,
-                                                const _mongocrypt_buffer_t *indexKeyId,
-                                                const _mongocrypt_buffer_t *value,
-                                                bool useContentionFactor,
-                                                int64_t contentionFactor,
-                                                mongocrypt_status_t *status) {
+// Derives the fields of {ret} that only depend on the index key {indexKeyId}.
+// {ret} must be cleaned up with _FLE2EncryptedPayloadCommon_cleanup, even on failure.
+static bool _fle2_placeholder_common_key_init(_mongocrypt_key_broker_t *kb,
+                                              _FLE2EncryptedPayloadCommon_t *ret,
+                                              const _mongocrypt_buffer_t *indexKeyId,
+                                              mongocrypt_status_t *status) {
     BSON_ASSERT_PARAM(kb);
     BSON_ASSERT_PARAM(ret);
     BSON_ASSERT_PARAM(indexKeyId);
-    BSON_ASSERT_PARAM(value);
 
     _mongocrypt_crypto_t *crypto = kb->crypt->crypto;
-    _mongocrypt_buffer_t indexKey = {0};
     *ret = (_FLE2EncryptedPayloadCommon_t){{0}};
 
     if (!_get_tokenKey(kb, indexKeyId, &ret->tokenKey, status)) {
-        goto fail;
+        return false;
     }
 
-    ret->collectionsLevel1Token = mc_CollectionsLevel1Token_new(crypto, &ret->tokenKey, status);
+    // Reuse the tokens derived when the key was cached, if any.
+    ret->keyTokens = _mongocrypt_key_broker_key_tokens_by_id(kb, indexKeyId);
+    const _mongocrypt_cache_key_tokens_t *keyTokens = ret->keyTokens;
+
+    if (keyTokens) {
+        ret->collectionsLevel1Token = mc_CollectionsLevel1Token_copy(keyTokens->collectionsLevel1Token);
+    } else {
+        ret->collectionsLevel1Token = mc_CollectionsLevel1Token_new(crypto, &ret->tokenKey, status);
+    }
     if (!ret->collectionsLevel1Token) {
         CLIENT_ERR("unable to derive collectionLevel1Token");
-        goto fail;
+        return false;
     }
 
-    ret->serverDataEncryptionLevel1Token = mc_ServerDataEncryptionLevel1Token_new(crypto, &ret->tokenKey, status);
+    if (keyTokens) {
+        ret->serverDataEncryptionLevel1Token =
+            mc_ServerDataEncryptionLevel1Token_copy(keyTokens->serverDataEncryptionLevel1Token);
+    } else {
+        ret->serverDataEncryptionLevel1Token = mc_ServerDataEncryptionLevel1Token_new(crypto, &ret->tokenKey, status);
+    }
     if (!ret->serverDataEncryptionLevel1Token) {
         CLIENT_ERR("unable to derive serverDataEncryptionLevel1Token");
+        return false;
+    }
+
+    if (kb->crypt->opts.use_fle2_v2) {
+        /* FLE2v2 */
+        if (keyTokens) {
+            ret->serverTokenDerivationLevel1Token =
+                mc_ServerTokenDerivationLevel1Token_copy(keyTokens->serverTokenDerivationLevel1Token);
+        } else {
+            ret->serverTokenDerivationLevel1Token =
+                mc_ServerTokenDerivationLevel1Token_new(crypto, &ret->tokenKey, status);
+        }
+        if (!ret->serverTokenDerivationLevel1Token) {
+            CLIENT_ERR("unable to derive serverTokenDerivationLevel1Token");
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool _mongocrypt_fle2_placeholder_common(_mongocrypt_key_broker_t *kb,
+                                                _FLE2EncryptedPayloadCommon_t *ret,
+                                                const _mongocrypt_buffer_t *indexKeyId,
+                                                const _mongocrypt_buffer_t *value,
+                                                bool useContentionFactor,
+                                                int64_t contentionFactor,
+                                                mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(ret);
+    BSON_ASSERT_PARAM(indexKeyId);
+    BSON_ASSERT_PARAM(value);
+
+    _mongocrypt_crypto_t *crypto = kb->crypt->crypto;
+
+    if (!_fle2_placeholder_common_key_init(kb, ret, indexKeyId, status)) {
         goto fail;
     }
+    const _mongocrypt_cache_key_tokens_t *keyTokens = ret->keyTokens;
 
     if (!_fle2_derive_EDC_token(crypto,
                                 &ret->edcDerivedToken,
                                 ret->collectionsLevel1Token,
+                                keyTokens ? keyTokens->edcToken : NULL,
                                 value,
                                 useContentionFactor,
                                 contentionFactor,
@@ -545,6 +741,7 @@ static bool _mongocrypt_fle2_placeholder_common(_mongocrypt_key_broker_t *kb,
     if (!_fle2_derive_ESC_token(crypto,
                                 &ret->escDerivedToken,
                                 ret->collectionsLevel1Token,
+                                keyTokens ? keyTokens->escToken : NULL,
                                 value,
                                 useContentionFactor,
                                 contentionFactor,
@@ -554,12 +751,6 @@ static bool _mongocrypt_fle2_placeholder_common(_mongocrypt_key_broker_t *kb,
 
     if (kb->crypt->opts.use_fle2_v2) {
         /* FLE2v2 */
-        ret->serverTokenDerivationLevel1Token = mc_ServerTokenDerivationLevel1Token_new(crypto, &ret->tokenKey, status);
-        if (!ret->serverTokenDerivationLevel1Token) {
-            CLIENT_ERR("unable to derive serverTokenDerivationLevel1Token");
-            goto fail;
-        }
-
         if (!_fle2_derive_serverDerivedFromDataToken(crypto,
                                                      &ret->serverDerivedFromDataToken,
                                                      ret->serverTokenDerivationLevel1Token,
@@ -572,6 +763,7 @@ static bool _mongocrypt_fle2_placeholder_common(_mongocrypt_key_broker_t *kb,
         if (!_fle2_derive_ECC_token(crypto,
                                     &ret->eccDerivedToken,
                                     ret->collectionsLevel1Token,
+                                    NULL /* cachedToken */,
                                     value,
                                     useContentionFactor,
                                     contentionFactor,
@@ -580,12 +772,10 @@ static bool _mongocrypt_fle2_placeholder_common(_mongocrypt_key_broker_t *kb,
         }
     }
 
-    _mongocrypt_buffer_cleanup(&indexKey);
     return true;
 
 fail:
     _FLE2EncryptedPayloadCommon_cleanup(ret);
-    _mongocrypt_buffer_cleanup(&indexKey);
     return false;
 }
 
@@ -643,7 +833,7 @@ static bool _mongocrypt_fle2_placeholder_to_insert_update_common_v1(_mongocrypt_
     if (!_fle2_derive_encrypted_token(crypto,
                                       &out->encryptedTokens,
                                       false, // Can't use range V2 with FLE V1
-                                      common->collectionsLevel1Token,
+                                      common,
                                       &out->escDerivedToken,
                                       &out->eccDerivedToken,
                                       (mc_optional_bool_t){0}, // Unset is_leaf as it's not used in V1
@@ -656,22 +846,13 @@ static bool _mongocrypt_fle2_placeholder_to_insert_update_common_v1(_mongocrypt_
     out->valueType = bson_iter_type(value_iter);  // t
 
     // v := UserKeyId + EncryptCTRAEAD(UserKey, value)
-    {
-        _mongocrypt_buffer_t ciphertext = {0};
-        if (!_fle2_placeholder_aes_aead_encrypt(kb,
-                                                _mcFLE2AEADAlgorithm(),
-                                                &ciphertext,
-                                                &placeholder->user_key_id,
-                                                &value,
-                                                status)) {
-            goto fail;
-        }
-        const _mongocrypt_buffer_t v[2] = {placeholder->user_key_id, ciphertext};
-        const bool ok = _mongocrypt_buffer_concat(&out->value, v, 2);
-        _mongocrypt_buffer_cleanup(&ciphertext);
-        if (!ok) {
-            goto fail;
-        }
+    if (!_fle2_placeholder_aes_aead_encrypt(kb,
+                                            _mcFLE2AEADAlgorithm(),
+                                            &out->value,
+                                            &placeholder->user_key_id,
+                                            &value,
+                                            status)) {
+        goto fail;
     }
 
     // e := ServerDataEncryptionLevel1Token
@@ -791,7 +972,7 @@ static bool _mongocrypt_fle2_placeholder_to_insert_update_common(_mongocrypt_key
             crypto,
             &out->encryptedTokens,
             kb->crypt->opts.use_range_v2,
-            common->collectionsLevel1Token,
+            common,
             &out->escDerivedToken,
             NULL, // unused in v2
             // If this is a range insert, we append isLeaf to the encryptedTokens. Otherwise, we don't.
@@ -805,22 +986,13 @@ static bool _mongocrypt_fle2_placeholder_to_insert_update_common(_mongocrypt_key
     out->valueType = bson_iter_type(value_iter);  // t
 
     // v := UserKeyId + EncryptCBCAEAD(UserKey, value)
-    {
-        _mongocrypt_buffer_t ciphertext = {0};
-        if (!_fle2_placeholder_aes_aead_encrypt(kb,
-                                                _mcFLE2v2AEADAlgorithm(),
-                                                &ciphertext,
-                                                &placeholder->user_key_id,
-                                                &value,
-                                                status)) {
-            goto fail;
-        }
-        const _mongocrypt_buffer_t v[2] = {placeholder->user_key_id, ciphertext};
-        const bool ok = _mongocrypt_buffer_concat(&out->value, v, 2);
-        _mongocrypt_buffer_cleanup(&ciphertext);
-        if (!ok) {
-            goto fail;
-        }
+    if (!_fle2_placeholder_aes_aead_encrypt(kb,
+                                            _mcFLE2v2AEADAlgorithm(),
+                                            &out->value,
+                                            &placeholder->user_key_id,
+                                            &value,
+                                            status)) {
+        goto fail;
     }
 
     // e := ServerDataEncryptionLevel1Token
@@ -1003,6 +1175,7 @@ static bool _mongocrypt_fle2_placeholder_to_insert_update_ciphertextForRange_v1(
     mc_FLE2InsertUpdatePayload_init(&payload);
     bool res = false;
     mc_edges_t *edges = NULL;
+    _fle2_edge_key_tokens_t keyTokens = {0};
 
     // Parse the value ("v"), min ("min"), and max ("max") from
     // FLE2EncryptionPlaceholder for range insert.
@@ -1030,60 +1203,75 @@ static bool _mongocrypt_fle2_placeholder_to_insert_update_ciphertextForRange_v1(
             goto fail;
         }
 
-        for (size_t i = 0; i < mc_edges_len(edges); ++i) {
+        // Edge tokens use the same index key as the value, so derive the key tokens once from common.
+        if (!_fle2_edge_key_tokens_init(kb->crypt->crypto, &common, true /* use_ecc */, &keyTokens, status)) {
+            goto fail;
+        }
+
+        mc_edges_iter_t it;
+        const char *edge;
+        size_t edge_len;
+        bool is_leaf;
+
+        mc_edges_iter_init(&it, edges);
+        while (mc_edges_iter_next(&it, &edge, &edge_len, &is_leaf)) {
             // Create an EdgeTokenSet from each edge.
-            bool loop_ok = false;
-            const char *edge = mc_edges_get(edges, i);
-            _mongocrypt_buffer_t edge_buf = {0};
-            _FLE2EncryptedPayloadCommon_t edge_tokens = {{0}};
-            _mongocrypt_buffer_t encryptedTokens = {0};
+            _mongocrypt_buffer_t edge_buf;
             mc_EdgeTokenSet_t etc = {{0}};
 
-            if (!_mongocrypt_buffer_from_string(&edge_buf, edge)) {
-                CLIENT_ERR("failed to copy edge to buffer");
-                goto fail_loop;
-            }
-
-            if (!_mongocrypt_fle2_placeholder_common(kb,
-                                                     &edge_tokens,
-                                                     &placeholder->index_key_id,
-                                                     &edge_buf,
-                                                     true, /* derive tokens using contentionFactor */
-                                                     contentionFactor,
-                                                     status)) {
-                goto fail_loop;
+            // The buffer references the edge string; nothing is copied.
+            _mongocrypt_buffer_init(&edge_buf);
+            if (!size_to_uint32(edge_len, &edge_buf.len)) {
+                CLIENT_ERR("edge too long: %zu", edge_len);
+                goto fail;
             }
+            edge_buf.data = (uint8_t *)edge;
 
             // d := EDCDerivedToken
-            _mongocrypt_buffer_steal(&etc.edcDerivedToken, &edge_tokens.edcDerivedToken);
             // s := ESCDerivedToken
-            _mongocrypt_buffer_steal(&etc.escDerivedToken, &edge_tokens.escDerivedToken);
             // c := ECCDerivedToken
-            _mongocrypt_buffer_steal(&etc.eccDerivedToken, &edge_tokens.eccDerivedToken);
-
             // p := EncryptCTR(ECOCToken, ESCDerivedFromDataTokenAndContentionFactor ||
             // ECCDerivedFromDataTokenAndContentionFactor)
-            if (!_fle2_derive_encrypted_token(kb->crypt->crypto,
-                                              &etc.encryptedTokens,
-                                              false, // Range V2 is incompatible with FLE V1
-                                              edge_tokens.collectionsLevel1Token,
-                                              &etc.escDerivedToken,
-                                              &etc.eccDerivedToken,
-                                              (mc_optional_bool_t){0}, // Dummy value for isLeaf, unused in FLE V1
-                                              status)) {
-                goto fail_loop;
+            if (!_fle2_derive_EDC_token(kb->crypt->crypto,
+                                        &etc.edcDerivedToken,
+                                        common.collectionsLevel1Token,
+                                        keyTokens.edcToken,
+                                        &edge_buf,
+                                        true, /* derive tokens using contentionFactor */
+                                        contentionFactor,
+                                        status)
+                || !_fle2_derive_ESC_token(kb->crypt->crypto,
+                                           &etc.escDerivedToken,
+                                           common.collectionsLevel1Token,
+                                           keyTokens.escToken,
+                                           &edge_buf,
+                                           true, /* derive tokens using contentionFactor */
+                                           contentionFactor,
+                                           status)
+                || !_fle2_derive_ECC_token(kb->crypt->crypto,
+                                           &etc.eccDerivedToken,
+                                           common.collectionsLevel1Token,
+                                           keyTokens.eccToken,
+                                           &edge_buf,
+                                           true, /* derive tokens using contentionFactor */
+                                           contentionFactor,
+                                           status)
+                || !_fle2_encrypt_token(kb->crypt->crypto,
+                                        &etc.encryptedTokens,
+                                        false, // Range V2 is incompatible with FLE V1
+                                        keyTokens.ecocToken,
+                                        &etc.escDerivedToken,
+                                        &etc.eccDerivedToken,
+                                        (mc_optional_bool_t){0}, // Dummy value for isLeaf, unused in FLE V1
+                                        status)) {
+                _mongocrypt_buffer_cleanup(&etc.edcDerivedToken);
+                _mongocrypt_buffer_cleanup(&etc.escDerivedToken);
+                _mongocrypt_buffer_cleanup(&etc.eccDerivedToken);
+                _mongocrypt_buffer_cleanup(&etc.encryptedTokens);
+                goto fail;
             }
 
             _mc_array_append_val(&payload.edgeTokenSetArray, etc);
-
-            loop_ok = true;
-        fail_loop:
-            _mongocrypt_buffer_cleanup(&encryptedTokens);
-            _FLE2EncryptedPayloadCommon_cleanup(&edge_tokens);
-            _mongocrypt_buffer_cleanup(&edge_buf);
-            if (!loop_ok) {
-                goto fail;
-            }
         }
     }
 
@@ -1099,6 +1287,7 @@ static bool _mongocrypt_fle2_placeholder_to_insert_update_ciphertextForRange_v1(
 
     res = true;
 fail:
+    _fle2_edge_key_tokens_cleanup(&keyTokens);
     mc_edges_destroy(edges);
     mc_FLE2InsertUpdatePayload_cleanup(&payload);
     _FLE2EncryptedPayloadCommon_cleanup(&common);
@@ -1106,121 +1295,364 @@ fail:
     return res;
 }
 
-/**
- * Payload subtype 11: FLE2InsertUpdatePayloadV2 for range updates
- * Delegates to ..._insert_update_ciphertextForRange_v1 for subtype 4
- *   when crypt.opts.use_fle2_v2 == false
- *
- * {d: EDC, s: ESC, p: encToken,
- *  u: indexKeyId, t: valueType, v: value,
- *  e: serverToken, l: serverDerivedFromDataToken,
- *  k: contentionFactor,
- *  g: [{d: EDC, s: ESC, l: serverDerivedFromDataToken, p: encToken},
- *      {d: EDC, s: ESC, l: serverDerivedFromDataToken, p: encToken},
- *      ...]}
- */
-static bool _mongocrypt_fle2_placeholder_to_insert_update_ciphertextForRange(_mongocrypt_key_broker_t *kb,
-                                                                             _mongocrypt_marking_t *marking,
-                                                                             _mongocrypt_ciphertext_t *ciphertext,
-                                                                             mongocrypt_status_t *status) {
-    BSON_ASSERT_PARAM(kb);
-    BSON_ASSERT_PARAM(marking);
-    BSON_ASSERT_PARAM(ciphertext);
-    BSON_ASSERT(kb->crypt);
-    BSON_ASSERT(marking->type == MONGOCRYPT_MARKING_FLE2_ENCRYPTION);
+static void _buffers_destroy(_mongocrypt_buffer_t *bufs, size_t len) {
+    if (!bufs) {
+        return;
+    }
 
-    if (!kb->crypt->opts.use_fle2_v2) {
-        return _mongocrypt_fle2_placeholder_to_insert_update_ciphertextForRange_v1(kb, marking, ciphertext, status);
+    for (size_t i = 0; i < len; i++) {
+        _mongocrypt_buffer_cleanup(&bufs[i]);
     }
+    bson_free(bufs);
+}
 
-    mc_FLE2EncryptionPlaceholder_t *placeholder = &marking->fle2;
-    _FLE2EncryptedPayloadCommon_t common = {{0}};
-    mc_FLE2InsertUpdatePayloadV2_t payload;
-    mc_FLE2InsertUpdatePayloadV2_init(&payload);
-    bool res = false;
-    mc_edges_t *edges = NULL;
+// State shared by the per-edge tasks run by a parallel_for executor.
+typedef struct {
+    _mongocrypt_crypto_t *crypto;
+    const _FLE2EncryptedPayloadCommon_t *common;
+    const _fle2_edge_key_tokens_t *keyTokens;
+    const _mongocrypt_buffer_t *edgeBufs;
+    const bool *isLeaf;
+    int64_t contentionFactor;
+    bool use_range_v2;
+    // MONGOCRYPT_IV_LEN random bytes per edge, drawn before the tasks run.
+    const _mongocrypt_buffer_t *ivs;
+    // One of each per edge. Each task only writes its own entries.
+    mc_EdgeTokenSetV2_t *sets;
+    mongocrypt_status_t **statuses;
+    bool *ok;
+} _fle2_edge_token_sets_task_t;
+
+static void _fle2_edge_token_set_task(void *task_ctx, uint32_t index) {
+    _fle2_edge_token_sets_task_t *task = task_ctx;
+    const _mongocrypt_buffer_t *edge = &task->edgeBufs[index];
+    mc_EdgeTokenSetV2_t *etc = &task->sets[index];
+    mongocrypt_status_t *status = task->statuses[index];
+    _mongocrypt_buffer_t iv;
 
-    // Parse the value ("v"), min ("min"), and max ("max") from
-    // FLE2EncryptionPlaceholder for range insert.
-    mc_FLE2RangeInsertSpec_t insertSpec;
-    if (!mc_FLE2RangeInsertSpec_parse(&insertSpec, &placeholder->v_iter, kb->crypt->opts.use_range_v2, status)) {
-        goto fail;
+    BSON_ASSERT(_mongocrypt_buffer_from_subrange(&iv, task->ivs, index * MONGOCRYPT_IV_LEN, MONGOCRYPT_IV_LEN));
+    task->ok[index] =
+        // d := EDCDerivedToken
+        _fle2_derive_EDC_token(task->crypto,
+                               &etc->edcDerivedToken,
+                               task->common->collectionsLevel1Token,
+                               task->keyTokens->edcToken,
+                               edge,
+                               true,
+                               task->contentionFactor,
+                               status)
+        // s := ESCDerivedToken
+        && _fle2_derive_ESC_token(task->crypto,
+                                  &etc->escDerivedToken,
+                                  task->common->collectionsLevel1Token,
+                                  task->keyTokens->escToken,
+                                  edge,
+                                  true,
+                                  task->contentionFactor,
+                                  status)
+        // l := serverDerivedFromDataToken
+        && _fle2_derive_serverDerivedFromDataToken(task->crypto,
+                                                   &etc->serverDerivedFromDataToken,
+                                                   task->common->serverTokenDerivationLevel1Token,
+                                                   edge,
+                                                   status)
+        // p := EncryptCTR(ECOCToken, ESCDerivedFromDataTokenAndContentionFactor)
+        // Or in Range V2: p := EncryptCTR(ECOCToken, ESCDerivedFromDataTokenAndContentionFactor || isLeaf)
+        && _fle2_encrypt_token_with_iv(task->crypto,
+                                       &etc->encryptedTokens,
+                                       task->use_range_v2,
+                                       task->keyTokens->ecocToken,
+                                       &etc->escDerivedToken,
+                                       NULL, // ecc unsed in FLE2v2
+                                       OPT_BOOL(task->isLeaf[index]),
+                                       &iv,
+                                       status);
+}
+
+// Derives the EdgeTokenSetV2 of each edge with one task per edge on crypto->parallel_for.
+// The random IVs are drawn up front in edge order, so the random hook is not called from the tasks and the output
+// does not depend on the order the tasks run in.
+static bool _fle2_append_edge_token_sets_parallel(_fle2_edge_token_sets_task_t *task,
+                                                  uint32_t n,
+                                                  mc_array_t *edgeTokenSetArray,
+                                                  mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(task);
+    BSON_ASSERT_PARAM(edgeTokenSetArray);
+    BSON_ASSERT(task->crypto->parallel_for);
+
+    bool ok = false;
+    _mongocrypt_buffer_t ivs;
+
+    if (n > UINT32_MAX / MONGOCRYPT_IV_LEN) {
+        CLIENT_ERR("too many edges: %" PRIu32, n);
+        return false;
     }
+    _mongocrypt_buffer_init_size(&ivs, n * MONGOCRYPT_IV_LEN);
+    if (!_mongocrypt_random(task->crypto, &ivs, n * MONGOCRYPT_IV_LEN, status)) {
+        _mongocrypt_buffer_cleanup(&ivs);
+        return false;
+    }
+    task->ivs = &ivs;
 
-    if (!_mongocrypt_fle2_placeholder_to_insert_update_common(kb,
-                                                              &payload,
-                                                              &common,
-                                                              &marking->fle2,
-                                                              &insertSpec.v,
-                                                              status)) {
-        goto fail;
+    task->sets = bson_malloc0(sizeof(mc_EdgeTokenSetV2_t) * n);
+    task->statuses = bson_malloc0(sizeof(mongocrypt_status_t *) * n);
+    task->ok = bson_malloc0(sizeof(bool) * n);
+    for (uint32_t i = 0; i < n; i++) {
+        task->statuses[i] = mongocrypt_status_new();
     }
 
-    // g:= array<EdgeTokenSetV2>
-    {
-        BSON_ASSERT(placeholder->sparsity >= 0 && (uint64_t)placeholder->sparsity <= (uint64_t)SIZE_MAX);
-        edges = get_edges(&insertSpec, (size_t)placeholder->sparsity, status);
-        if (!edges) {
+    task->crypto->parallel_for(task->crypto->parallel_for_ctx, _fle2_edge_token_set_task, task, n);
+
+    for (uint32_t i = 0; i < n; i++) {
+        if (!task->ok[i]) {
+            _mongocrypt_status_copy_to(task->statuses[i], status);
             goto fail;
         }
+    }
 
-        for (size_t i = 0; i < mc_edges_len(edges); ++i) {
-            // Create an EdgeTokenSet from each edge.
-            bool loop_ok = false;
-            const char *edge = mc_edges_get(edges, i);
-            bool is_leaf = mc_edges_is_leaf(edges, edge);
-            _mongocrypt_buffer_t edge_buf = {0};
-            _FLE2EncryptedPayloadCommon_t edge_tokens = {{0}};
-            _mongocrypt_buffer_t encryptedTokens = {0};
-            mc_EdgeTokenSetV2_t etc = {{0}};
-
-            if (!_mongocrypt_buffer_from_string(&edge_buf, edge)) {
-                CLIENT_ERR("failed to copy edge to buffer");
-                goto fail_loop;
-            }
+    for (uint32_t i = 0; i < n; i++) {
+        _mc_array_append_val(edgeTokenSetArray, task->sets[i]);
+        // Now owned by edgeTokenSetArray.
+        memset(&task->sets[i], 0, sizeof(mc_EdgeTokenSetV2_t));
+    }
 
-            if (!_mongocrypt_fle2_placeholder_common(kb,
-                                                     &edge_tokens,
-                                                     &placeholder->index_key_id,
-                                                     &edge_buf,
-                                                     true, /* derive tokens using contentionFactor */
-                                                     payload.contentionFactor,
-                                                     status)) {
-                goto fail_loop;
-            }
-            BSON_ASSERT(edge_tokens.eccDerivedToken.data == NULL);
+    ok = true;
+fail:
+    for (uint32_t i = 0; i < n; i++) {
+        _mongocrypt_buffer_cleanup(&task->sets[i].edcDerivedToken);
+        _mongocrypt_buffer_cleanup(&task->sets[i].escDerivedToken);
+        _mongocrypt_buffer_cleanup(&task->sets[i].serverDerivedFromDataToken);
+        _mongocrypt_buffer_cleanup(&task->sets[i].encryptedTokens);
+        mongocrypt_status_destroy(task->statuses[i]);
+    }
+    bson_free(task->sets);
+    bson_free(task->statuses);
+    bson_free(task->ok);
+    _mongocrypt_buffer_cleanup(&ivs);
+    return ok;
+}
 
-            // d := EDCDerivedToken
-            _mongocrypt_buffer_steal(&etc.edcDerivedToken, &edge_tokens.edcDerivedToken);
-            // s := ESCDerivedToken
-            _mongocrypt_buffer_steal(&etc.escDerivedToken, &edge_tokens.escDerivedToken);
-
-            // l := serverDerivedFromDataToken
-            _mongocrypt_buffer_steal(&etc.serverDerivedFromDataToken, &edge_tokens.serverDerivedFromDataToken);
-
-            // p := EncryptCTR(ECOCToken, ESCDerivedFromDataTokenAndContentionFactor)
-            // Or in Range V2: p := EncryptCTR(ECOCToken, ESCDerivedFromDataTokenAndContentionFactor || isLeaf)
-            if (!_fle2_derive_encrypted_token(kb->crypt->crypto,
-                                              &etc.encryptedTokens,
-                                              kb->crypt->opts.use_range_v2,
-                                              edge_tokens.collectionsLevel1Token,
-                                              &etc.escDerivedToken,
-                                              NULL, // ecc unsed in FLE2v2
-                                              OPT_BOOL(is_leaf),
-                                              status)) {
-                goto fail_loop;
-            }
+/**
+ * Appends one EdgeTokenSetV2 per edge in {edges} to {edgeTokenSetArray}.
+ *
+ * The HMACs of each derivation level are computed for all edges with one _mongocrypt_hmac_sha_256_batch call, so a
+ * batch crypto hook is called twice per value instead of several times per edge. The edges are then visited once more
+ * to encrypt each edge's token and append its EdgeTokenSetV2, stealing the derived tokens.
+ *
+ * If a parallel_for executor is set on {crypto}, each edge is instead derived by its own task.
+ *
+ * {common} must be derived from the index key.
+ */
+static bool _fle2_append_edge_token_sets_v2(_mongocrypt_crypto_t *crypto,
+                                            const _FLE2EncryptedPayloadCommon_t *common,
+                                            mc_edges_t *edges,
+                                            int64_t contentionFactor,
+                                            bool use_range_v2,
+                                            mc_array_t *edgeTokenSetArray,
+                                            mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(crypto);
+    BSON_ASSERT_PARAM(common);
+    BSON_ASSERT_PARAM(edges);
+    BSON_ASSERT_PARAM(edgeTokenSetArray);
+    BSON_ASSERT(common->collectionsLevel1Token);
+    BSON_ASSERT(common->serverTokenDerivationLevel1Token);
+    BSON_ASSERT(contentionFactor >= 0);
 
-            _mc_array_append_val(&payload.edgeTokenSetArray, etc);
+    bool ok = false;
+    const size_t n = mc_edges_len(edges);
+    _fle2_edge_key_tokens_t keyTokens = {0};
+    _mongocrypt_buffer_t *edgeBufs = NULL;
+    bool *isLeaf = NULL;
+    // [EDCDerivedFromDataToken...][ESCDerivedFromDataToken...][ServerDerivedFromDataToken...]
+    _mongocrypt_buffer_t *fromDataTokens = NULL;
+    // [EDCDerivedFromDataTokenAndContentionFactor...][ESCDerivedFromDataTokenAndContentionFactor...]
+    _mongocrypt_buffer_t *fromDataAndCfTokens = NULL;
+    const _mongocrypt_buffer_t **keys = NULL;
+    const _mongocrypt_buffer_t **ins = NULL;
+    _mongocrypt_buffer_t cf;
+
+    _mongocrypt_buffer_copy_from_uint64_le(&cf, (uint64_t)contentionFactor);
+
+    if (n > UINT32_MAX / 3u) {
+        CLIENT_ERR("too many edges: %zu", n);
+        goto fail;
+    }
+
+    if (!_fle2_edge_key_tokens_init(crypto, common, false /* use_ecc */, &keyTokens, status)) {
+        goto fail;
+    }
+
+    edgeBufs = bson_malloc0(sizeof(_mongocrypt_buffer_t) * (n + 1u));
+    isLeaf = bson_malloc0(sizeof(bool) * (n + 1u));
+    fromDataTokens = bson_malloc0(sizeof(_mongocrypt_buffer_t) * (3u * n + 1u));
+    fromDataAndCfTokens = bson_malloc0(sizeof(_mongocrypt_buffer_t) * (2u * n + 1u));
+    keys = bson_malloc0(sizeof(_mongocrypt_buffer_t *) * (3u * n + 1u));
+    ins = bson_malloc0(sizeof(_mongocrypt_buffer_t *) * (3u * n + 1u));
 
-            loop_ok = true;
-        fail_loop:
-            _mongocrypt_buffer_cleanup(&encryptedTokens);
-            _FLE2EncryptedPayloadCommon_cleanup(&edge_tokens);
-            _mongocrypt_buffer_cleanup(&edge_buf);
-            if (!loop_ok) {
+    // Edge buffers reference the edge strings; nothing is copied.
+    {
+        mc_edges_iter_t it;
+        const char *edge;
+        size_t edge_len;
+        size_t i = 0;
+
+        mc_edges_iter_init(&it, edges);
+        while (mc_edges_iter_next(&it, &edge, &edge_len, &isLeaf[i])) {
+            _mongocrypt_buffer_init(&edgeBufs[i]);
+            if (!size_to_uint32(edge_len, &edgeBufs[i].len)) {
+                CLIENT_ERR("edge too long: %zu", edge_len);
                 goto fail;
             }
+            edgeBufs[i].data = (uint8_t *)edge;
+            i++;
+        }
+        BSON_ASSERT(i == n);
+    }
+
+    if (crypto->parallel_for && n > 1) {
+        _fle2_edge_token_sets_task_t task = {.crypto = crypto,
+                                             .common = common,
+                                             .keyTokens = &keyTokens,
+                                             .edgeBufs = edgeBufs,
+                                             .isLeaf = isLeaf,
+                                             .contentionFactor = contentionFactor,
+                                             .use_range_v2 = use_range_v2};
+        ok = _fle2_append_edge_token_sets_parallel(&task, (uint32_t)n, edgeTokenSetArray, status);
+        goto fail;
+    }
+
+    // E?CDerivedFromDataToken = HMAC(E?CToken, edge)
+    // ServerDerivedFromDataToken = HMAC(ServerTokenDerivationLevel1Token, edge)
+    for (size_t i = 0; i < n; i++) {
+        keys[i] = mc_EDCToken_get(keyTokens.edcToken);
+        keys[n + i] = mc_ESCToken_get(keyTokens.escToken);
+        keys[2u * n + i] = mc_ServerTokenDerivationLevel1Token_get(common->serverTokenDerivationLevel1Token);
+        ins[i] = ins[n + i] = ins[2u * n + i] = &edgeBufs[i];
+    }
+    if (!_mongocrypt_hmac_sha_256_batch(crypto, keys, ins, fromDataTokens, (uint32_t)(3u * n), status)) {
+        goto fail;
+    }
+
+    // E?CDerivedFromDataTokenAndContentionFactor = HMAC(E?CDerivedFromDataToken, cf)
+    for (size_t i = 0; i < 2u * n; i++) {
+        keys[i] = &fromDataTokens[i];
+        ins[i] = &cf;
+    }
+    if (!_mongocrypt_hmac_sha_256_batch(crypto, keys, ins, fromDataAndCfTokens, (uint32_t)(2u * n), status)) {
+        goto fail;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        // Create an EdgeTokenSet from each edge.
+        mc_EdgeTokenSetV2_t etc = {{0}};
+
+        // d := EDCDerivedToken
+        _mongocrypt_buffer_steal(&etc.edcDerivedToken, &fromDataAndCfTokens[i]);
+        // s := ESCDerivedToken
+        _mongocrypt_buffer_steal(&etc.escDerivedToken, &fromDataAndCfTokens[n + i]);
+        // l := serverDerivedFromDataToken
+        _mongocrypt_buffer_steal(&etc.serverDerivedFromDataToken, &fromDataTokens[2u * n + i]);
+
+        // p := EncryptCTR(ECOCToken, ESCDerivedFromDataTokenAndContentionFactor)
+        // Or in Range V2: p := EncryptCTR(ECOCToken, ESCDerivedFromDataTokenAndContentionFactor || isLeaf)
+        if (!_fle2_encrypt_token(crypto,
+                                 &etc.encryptedTokens,
+                                 use_range_v2,
+                                 keyTokens.ecocToken,
+                                 &etc.escDerivedToken,
+                                 NULL, // ecc unsed in FLE2v2
+                                 OPT_BOOL(isLeaf[i]),
+                                 status)) {
+            _mongocrypt_buffer_cleanup(&etc.edcDerivedToken);
+            _mongocrypt_buffer_cleanup(&etc.escDerivedToken);
+            _mongocrypt_buffer_cleanup(&etc.serverDerivedFromDataToken);
+            _mongocrypt_buffer_cleanup(&etc.encryptedTokens);
+            goto fail;
+        }
+
+        _mc_array_append_val(edgeTokenSetArray, etc);
+    }
+
+    ok = true;
+fail:
+    _buffers_destroy(edgeBufs, n);
+    bson_free(isLeaf);
+    _buffers_destroy(fromDataTokens, 3u * n);
+    _buffers_destroy(fromDataAndCfTokens, 2u * n);
+    bson_free(keys);
+    bson_free(ins);
+    _fle2_edge_key_tokens_cleanup(&keyTokens);
+    _mongocrypt_buffer_cleanup(&cf);
+    return ok;
+}
+
+/**
+ * Payload subtype 11: FLE2InsertUpdatePayloadV2 for range updates
+ * Delegates to ..._insert_update_ciphertextForRange_v1 for subtype 4
+ *   when crypt.opts.use_fle2_v2 == false
+ *
+ * {d: EDC, s: ESC, p: encToken,
+ *  u: indexKeyId, t: valueType, v: value,
+ *  e: serverToken, l: serverDerivedFromDataToken,
+ *  k: contentionFactor,
+ *  g: [{d: EDC, s: ESC, l: serverDerivedFromDataToken, p: encToken},
+ *      {d: EDC, s: ESC, l: serverDerivedFromDataToken, p: encToken},
+ *      ...]}
+ */
+static bool _mongocrypt_fle2_placeholder_to_insert_update_ciphertextForRange(_mongocrypt_key_broker_t *kb,
+                                                                             _mongocrypt_marking_t *marking,
+                                                                             _mongocrypt_ciphertext_t *ciphertext,
+                                                                             mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(marking);
+    BSON_ASSERT_PARAM(ciphertext);
+    BSON_ASSERT(kb->crypt);
+    BSON_ASSERT(marking->type == MONGOCRYPT_MARKING_FLE2_ENCRYPTION);
+
+    if (!kb->crypt->opts.use_fle2_v2) {
+        return _mongocrypt_fle2_placeholder_to_insert_update_ciphertextForRange_v1(kb, marking, ciphertext, status);
+    }
+
+    mc_FLE2EncryptionPlaceholder_t *placeholder = &marking->fle2;
+    _FLE2EncryptedPayloadCommon_t common = {{0}};
+    mc_FLE2InsertUpdatePayloadV2_t payload;
+    mc_FLE2InsertUpdatePayloadV2_init(&payload);
+    bool res = false;
+    mc_edges_t *edges = NULL;
+
+    // Parse the value ("v"), min ("min"), and max ("max") from
+    // FLE2EncryptionPlaceholder for range insert.
+    mc_FLE2RangeInsertSpec_t insertSpec;
+    if (!mc_FLE2RangeInsertSpec_parse(&insertSpec, &placeholder->v_iter, kb->crypt->opts.use_range_v2, status)) {
+        goto fail;
+    }
+
+    if (!_mongocrypt_fle2_placeholder_to_insert_update_common(kb,
+                                                              &payload,
+                                                              &common,
+                                                              &marking->fle2,
+                                                              &insertSpec.v,
+                                                              status)) {
+        goto fail;
+    }
+
+    // g:= array<EdgeTokenSetV2>
+    {
+        BSON_ASSERT(placeholder->sparsity >= 0 && (uint64_t)placeholder->sparsity <= (uint64_t)SIZE_MAX);
+        edges = get_edges(&insertSpec, (size_t)placeholder->sparsity, status);
+        if (!edges) {
+            goto fail;
+        }
+
+        // Edge tokens use the same index key as the value, so derive them all from common.
+        if (!_fle2_append_edge_token_sets_v2(kb->crypt->crypto,
+                                             &common,
+                                             edges,
+                                             payload.contentionFactor,
+                                             kb->crypt->opts.use_range_v2,
+                                             &payload.edgeTokenSetArray,
+                                             status)) {
+            goto fail;
         }
     }
 
@@ -1332,8 +1764,10 @@ static bool _mongocrypt_fle2_placeholder_to_find_ciphertext(_mongocrypt_key_brok
 
     _FLE2EncryptedPayloadCommon_t common = {{0}};
     _mongocrypt_buffer_t value = {0};
+    _mongocrypt_buffer_t cache_key = {0};
     mc_FLE2EncryptionPlaceholder_t *placeholder = &marking->fle2;
     mc_FLE2FindEqualityPayloadV2_t payload;
+    const bool use_cache = kb->crypt->opts.find_payload_cache_max_entries > 0;
     bool res = false;
 
     BSON_ASSERT(marking->type == MONGOCRYPT_MARKING_FLE2_ENCRYPTION);
@@ -1344,6 +1778,33 @@ static bool _mongocrypt_fle2_placeholder_to_find_ciphertext(_mongocrypt_key_brok
 
     _mongocrypt_buffer_from_iter(&value, &placeholder->v_iter);
 
+    if (use_cache) {
+        _mongocrypt_buffer_t tokenKey;
+        _mongocrypt_buffer_t *cached = NULL;
+
+        // The index key is still required for a cached payload.
+        if (!_get_tokenKey(kb, &placeholder->index_key_id, &tokenKey, status)) {
+            goto fail;
+        }
+        _mongocrypt_buffer_cleanup(&tokenKey);
+
+        _mongocrypt_cache_find_payload_key(&placeholder->index_key_id,
+                                           &value,
+                                           placeholder->maxContentionFactor,
+                                           &cache_key);
+        if (!_mongocrypt_cache_get(&kb->crypt->cache_find_payload, &cache_key, (void **)&cached)) {
+            CLIENT_ERR("failed to retrieve from find payload cache");
+            goto fail;
+        }
+        if (cached) {
+            _mongocrypt_buffer_steal(&ciphertext->data, cached);
+            bson_free(cached);
+            ciphertext->blob_subtype = MC_SUBTYPE_FLE2FindEqualityPayloadV2;
+            res = true;
+            goto fail;
+        }
+    }
+
     if (!_mongocrypt_fle2_placeholder_common(kb,
                                              &common,
                                              &placeholder->index_key_id,
@@ -1375,15 +1836,315 @@ static bool _mongocrypt_fle2_placeholder_to_find_ciphertext(_mongocrypt_key_brok
     // not used for FLE2FindEqualityPayloadV2.
     ciphertext->blob_subtype = MC_SUBTYPE_FLE2FindEqualityPayloadV2;
 
+    if (use_cache
+        && !_mongocrypt_cache_add_copy(&kb->crypt->cache_find_payload, &cache_key, &ciphertext->data, status)) {
+        goto fail;
+    }
+
     res = true;
 fail:
     mc_FLE2FindEqualityPayloadV2_cleanup(&payload);
     _mongocrypt_buffer_cleanup(&value);
+    // The cache key holds the plaintext value.
+    bson_zero_free(cache_key.data, cache_key.len);
     _FLE2EncryptedPayloadCommon_cleanup(&common);
 
     return res;
 }
 
+// State shared by the per-value tasks of a batch of find equality markings run by a parallel_for executor.
+typedef struct {
+    _mongocrypt_crypto_t *crypto;
+    const _FLE2EncryptedPayloadCommon_t *common;
+    const _fle2_edge_key_tokens_t *keyTokens;
+    const _mongocrypt_buffer_t *const *values;
+    // [EDCDerivedToken...][ESCDerivedToken...][ServerDerivedFromDataToken...]
+    _mongocrypt_buffer_t *tokens;
+    uint32_t n;
+    // One of each per value. Each task only writes its own entries.
+    mongocrypt_status_t **statuses;
+    bool *ok;
+} _fle2_find_equality_tokens_task_t;
+
+static void _fle2_find_equality_tokens_task(void *task_ctx, uint32_t index) {
+    _fle2_find_equality_tokens_task_t *task = task_ctx;
+    const _mongocrypt_buffer_t *value = task->values[index];
+    mongocrypt_status_t *status = task->statuses[index];
+
+    task->ok[index] = _fle2_derive_EDC_token(task->crypto,
+                                             &task->tokens[index],
+                                             task->common->collectionsLevel1Token,
+                                             task->keyTokens->edcToken,
+                                             value,
+                                             false,
+                                             0,
+                                             status)
+                   && _fle2_derive_ESC_token(task->crypto,
+                                             &task->tokens[task->n + index],
+                                             task->common->collectionsLevel1Token,
+                                             task->keyTokens->escToken,
+                                             value,
+                                             false,
+                                             0,
+                                             status)
+                   && _fle2_derive_serverDerivedFromDataToken(task->crypto,
+                                                              &task->tokens[2u * task->n + index],
+                                                              task->common->serverTokenDerivationLevel1Token,
+                                                              value,
+                                                              status);
+}
+
+/**
+ * Derives the tokens of a FLE2FindEqualityPayloadV2 for each of the {n} {values}, all indexed by the key of {common}.
+ * Sets {tokens} to [EDCDerivedToken...][ESCDerivedToken...][ServerDerivedFromDataToken...].
+ *
+ * The HMACs of all values are computed with one _mongocrypt_hmac_sha_256_batch call. If a parallel_for executor is set
+ * on {crypto}, each value is instead derived by its own task.
+ */
+static bool _fle2_derive_find_equality_tokens(_mongocrypt_crypto_t *crypto,
+                                              const _FLE2EncryptedPayloadCommon_t *common,
+                                              const _fle2_edge_key_tokens_t *keyTokens,
+                                              const _mongocrypt_buffer_t *const *values,
+                                              uint32_t n,
+                                              _mongocrypt_buffer_t *tokens,
+                                              mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(crypto);
+    BSON_ASSERT_PARAM(common);
+    BSON_ASSERT_PARAM(keyTokens);
+    BSON_ASSERT_PARAM(values);
+    BSON_ASSERT_PARAM(tokens);
+    BSON_ASSERT(common->serverTokenDerivationLevel1Token);
+    BSON_ASSERT(n <= UINT32_MAX / 3u);
+
+    bool ok = false;
+
+    if (crypto->parallel_for && n > 1) {
+        _fle2_find_equality_tokens_task_t task = {.crypto = crypto,
+                                                  .common = common,
+                                                  .keyTokens = keyTokens,
+                                                  .values = values,
+                                                  .tokens = tokens,
+                                                  .n = n};
+
+        task.statuses = bson_malloc0(sizeof(mongocrypt_status_t *) * n);
+        task.ok = bson_malloc0(sizeof(bool) * n);
+        for (uint32_t i = 0; i < n; i++) {
+            task.statuses[i] = mongocrypt_status_new();
+        }
+
+        crypto->parallel_for(crypto->parallel_for_ctx, _fle2_find_equality_tokens_task, &task, n);
+
+        ok = true;
+        for (uint32_t i = 0; i < n; i++) {
+            if (ok && !task.ok[i]) {
+                _mongocrypt_status_copy_to(task.statuses[i], status);
+                ok = false;
+            }
+            mongocrypt_status_destroy(task.statuses[i]);
+        }
+        bson_free(task.statuses);
+        bson_free(task.ok);
+        return ok;
+    }
+
+    const _mongocrypt_buffer_t **keys = bson_malloc0(sizeof(_mongocrypt_buffer_t *) * (3u * n + 1u));
+    const _mongocrypt_buffer_t **ins = bson_malloc0(sizeof(_mongocrypt_buffer_t *) * (3u * n + 1u));
+
+    // E?CDerivedFromDataToken = HMAC(E?CToken, v)
+    // ServerDerivedFromDataToken = HMAC(ServerTokenDerivationLevel1Token, v)
+    for (uint32_t i = 0; i < n; i++) {
+        keys[i] = mc_EDCToken_get(keyTokens->edcToken);
+        keys[n + i] = mc_ESCToken_get(keyTokens->escToken);
+        keys[2u * n + i] = mc_ServerTokenDerivationLevel1Token_get(common->serverTokenDerivationLevel1Token);
+        ins[i] = ins[n + i] = ins[2u * n + i] = values[i];
+    }
+    ok = _mongocrypt_hmac_sha_256_batch(crypto, keys, ins, tokens, 3u * n, status);
+
+    bson_free(keys);
+    bson_free(ins);
+    return ok;
+}
+
+/* Converts the markings at {indexes} in {markings}, which all share an index key, to ciphertexts. The tokens depending
+ * only on the index key are derived once for the group. */
+static bool _fle2_find_equality_group_to_ciphertexts(_mongocrypt_key_broker_t *kb,
+                                                     _mongocrypt_marking_t *markings,
+                                                     _mongocrypt_ciphertext_t *ciphertexts,
+                                                     const uint32_t *indexes,
+                                                     uint32_t n,
+                                                     mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(kb);
+    BSON_ASSERT_PARAM(markings);
+    BSON_ASSERT_PARAM(ciphertexts);
+    BSON_ASSERT_PARAM(indexes);
+    BSON_ASSERT(n > 0 && n <= UINT32_MAX / 3u);
+
+    _mongocrypt_crypto_t *crypto = kb->crypt->crypto;
+    const bool use_cache = kb->crypt->opts.find_payload_cache_max_entries > 0;
+    const _mongocrypt_buffer_t *indexKeyId = &markings[indexes[0]].fle2.index_key_id;
+    _FLE2EncryptedPayloadCommon_t common = {{0}};
+    _fle2_edge_key_tokens_t keyTokens = {0};
+    _mongocrypt_buffer_t *values = bson_malloc0(sizeof(_mongocrypt_buffer_t) * n);
+    _mongocrypt_buffer_t *cache_keys = bson_malloc0(sizeof(_mongocrypt_buffer_t) * n);
+    // Indexes into {indexes} of the values not found in the find payload cache.
+    uint32_t *misses = bson_malloc0(sizeof(uint32_t) * n);
+    const _mongocrypt_buffer_t **missValues = bson_malloc0(sizeof(_mongocrypt_buffer_t *) * n);
+    _mongocrypt_buffer_t *tokens = bson_malloc0(sizeof(_mongocrypt_buffer_t) * 3u * n);
+    uint32_t num_misses = 0;
+    bool res = false;
+
+    // Also checks that the index key is available, even if every payload is cached.
+    if (!_fle2_placeholder_common_key_init(kb, &common, indexKeyId, status)) {
+        goto fail;
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        mc_FLE2EncryptionPlaceholder_t *placeholder = &markings[indexes[i]].fle2;
+        _mongocrypt_ciphertext_t *ciphertext = &ciphertexts[indexes[i]];
+        _mongocrypt_buffer_t *cached = NULL;
+
+        _mongocrypt_buffer_from_iter(&values[i], &placeholder->v_iter);
+
+        if (use_cache) {
+            _mongocrypt_cache_find_payload_key(indexKeyId,
+                                               &values[i],
+                                               placeholder->maxContentionFactor,
+                                               &cache_keys[i]);
+            if (!_mongocrypt_cache_get(&kb->crypt->cache_find_payload, &cache_keys[i], (void **)&cached)) {
+                CLIENT_ERR("failed to retrieve from find payload cache");
+                goto fail;
+            }
+        }
+        if (cached) {
+            _mongocrypt_buffer_steal(&ciphertext->data, cached);
+            bson_free(cached);
+            ciphertext->blob_subtype = MC_SUBTYPE_FLE2FindEqualityPayloadV2;
+            continue;
+        }
+        missValues[num_misses] = &values[i];
+        misses[num_misses++] = i;
+    }
+
+    if (num_misses == 0) {
+        res = true;
+        goto fail;
+    }
+
+    if (!_fle2_edge_key_tokens_init(crypto, &common, false /* use_ecc */, &keyTokens, status)) {
+        goto fail;
+    }
+
+    if (!_fle2_derive_find_equality_tokens(crypto, &common, &keyTokens, missValues, num_misses, tokens, status)) {
+        goto fail;
+    }
+
+    for (uint32_t m = 0; m < num_misses; m++) {
+        const uint32_t i = misses[m];
+        mc_FLE2EncryptionPlaceholder_t *placeholder = &markings[indexes[i]].fle2;
+        _mongocrypt_ciphertext_t *ciphertext = &ciphertexts[indexes[i]];
+        mc_FLE2FindEqualityPayloadV2_t payload;
+
+        mc_FLE2FindEqualityPayloadV2_init(&payload);
+        // d := EDCDerivedToken
+        _mongocrypt_buffer_steal(&payload.edcDerivedToken, &tokens[m]);
+        // s := ESCDerivedToken
+        _mongocrypt_buffer_steal(&payload.escDerivedToken, &tokens[num_misses + m]);
+        // l := serverDerivedFromDataToken
+        _mongocrypt_buffer_steal(&payload.serverDerivedFromDataToken, &tokens[2u * num_misses + m]);
+        // cm := maxContentionFactor
+        payload.maxContentionFactor = placeholder->maxContentionFactor;
+
+        {
+            bson_t out;
+            bson_init(&out);
+            mc_FLE2FindEqualityPayloadV2_serialize(&payload, &out);
+            _mongocrypt_buffer_steal_from_bson(&ciphertext->data, &out);
+        }
+        mc_FLE2FindEqualityPayloadV2_cleanup(&payload);
+        ciphertext->blob_subtype = MC_SUBTYPE_FLE2FindEqualityPayloadV2;
+
+        if (use_cache
+            && !_mongocrypt_cache_add_copy(&kb->crypt->cache_find_payload, &cache_keys[i], &ciphertext->data, status)) {
+            goto fail;
+        }
+    }
+
+    res = true;
+fail:
+    for (uint32_t i = 0; i < n; i++) {
+        _mongocrypt_buffer_cleanup(&values[i]);
+        // The cache key holds the plaintext value.
+        bson_zero_free(cache_keys[i].data, cache_keys[i].len);
+    }
+    bson_free(values);
+    bson_free(cache_keys);
+    bson_free(misses);
+    bson_free(missValues);
+    _buffers_destroy(tokens, 3u * n);
+    _fle2_edge_key_tokens_cleanup(&keyTokens);
+    _FLE2EncryptedPayloadCommon_cleanup(&common);
+    return res;
+}
+
+bool _mongocrypt_find_equality_markings_to_ciphertexts(void *ctx,
+                                                       _mongocrypt_marking_t *markings,
+                                                       _mongocrypt_ciphertext_t *ciphertexts,
+                                                       uint32_t n,
+                                                       mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(ctx);
+    BSON_ASSERT(markings || n == 0);
+    BSON_ASSERT(ciphertexts || n == 0);
+
+    _mongocrypt_key_broker_t *kb = (_mongocrypt_key_broker_t *)ctx;
+    bool *grouped = NULL;
+    uint32_t *indexes = NULL;
+    bool res = false;
+
+    BSON_ASSERT(kb->crypt->opts.use_fle2_v2);
+
+    if (n > UINT32_MAX / 3u) {
+        CLIENT_ERR("too many markings: %" PRIu32, n);
+        return false;
+    }
+
+    grouped = bson_malloc0(sizeof(bool) * (n + 1u));
+    indexes = bson_malloc0(sizeof(uint32_t) * (n + 1u));
+
+    for (uint32_t first = 0; first < n; first++) {
+        uint32_t group_len = 0;
+
+        BSON_ASSERT(_mongocrypt_marking_is_find_equality(&markings[first]));
+        if (grouped[first]) {
+            continue;
+        }
+        // Group the remaining markings with the same index key as {first}.
+        for (uint32_t i = first; i < n; i++) {
+            if (!grouped[i]
+                && 0 == _mongocrypt_buffer_cmp(&markings[i].fle2.index_key_id, &markings[first].fle2.index_key_id)) {
+                grouped[i] = true;
+                indexes[group_len++] = i;
+            }
+        }
+        if (!_fle2_find_equality_group_to_ciphertexts(kb, markings, ciphertexts, indexes, group_len, status)) {
+            goto fail;
+        }
+    }
+
+    res = true;
+fail:
+    bson_free(grouped);
+    bson_free(indexes);
+    return res;
+}
+
+bool _mongocrypt_marking_is_find_equality(const _mongocrypt_marking_t *marking) {
+    BSON_ASSERT_PARAM(marking);
+
+    return marking->type == MONGOCRYPT_MARKING_FLE2_ENCRYPTION
+        && marking->fle2.algorithm == MONGOCRYPT_FLE2_ALGORITHM_EQUALITY
+        && marking->fle2.type == MONGOCRYPT_FLE2_PLACEHOLDER_TYPE_FIND;
+}
+
 static bool isInfinite(bson_iter_t *iter) {
     return mc_isinf(bson_iter_double(iter));
 }
@@ -1556,6 +2317,61 @@ mc_get_mincover_from_FLE2RangeFindSpec(mc_FLE2RangeFindSpec_t *findSpec, size_t
     }
 }
 
+// _get_mincover returns the mincover of {findSpec}, using the mincover cache of
+// {crypt} if it is enabled. Returns NULL on error.
+static mc_mincover_t *
+_get_mincover(mongocrypt_t *crypt, mc_FLE2RangeFindSpec_t *findSpec, size_t sparsity, mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(crypt);
+    BSON_ASSERT_PARAM(findSpec);
+    BSON_ASSERT(findSpec->edgesInfo.set);
+
+    if (crypt->opts.mincover_cache_max_entries == 0) {
+        return mc_get_mincover_from_FLE2RangeFindSpec(findSpec, sparsity, status);
+    }
+
+    // The cover only depends on the bounds and index options. Values are
+    // appended with their types, so equal numbers of different types differ.
+    const mc_FLE2RangeFindSpecEdgesInfo_t *edgesInfo = &findSpec->edgesInfo.value;
+    mc_mincover_t *mincover = NULL;
+    _mongocrypt_buffer_t attr;
+    bson_t key = BSON_INITIALIZER;
+    if (!bson_append_iter(&key, "lb", 2, &edgesInfo->lowerBound)
+        || !BSON_APPEND_BOOL(&key, "lbIncluded", edgesInfo->lbIncluded)
+        || !bson_append_iter(&key, "ub", 2, &edgesInfo->upperBound)
+        || !BSON_APPEND_BOOL(&key, "ubIncluded", edgesInfo->ubIncluded)
+        || !bson_append_iter(&key, "min", 3, &edgesInfo->indexMin)
+        || !bson_append_iter(&key, "max", 3, &edgesInfo->indexMax)
+        || !BSON_APPEND_INT64(&key, "sparsity", (int64_t)sparsity)
+        || (edgesInfo->precision.set && !BSON_APPEND_INT64(&key, "precision", edgesInfo->precision.value))
+        || (edgesInfo->trimFactor.set && !BSON_APPEND_INT64(&key, "trimFactor", edgesInfo->trimFactor.value))) {
+        CLIENT_ERR("failed to create mincover cache key");
+        goto done;
+    }
+    _mongocrypt_buffer_from_bson(&attr, &key);
+
+    if (!_mongocrypt_cache_get(&crypt->cache_mincover, &attr, (void **)&mincover)) {
+        CLIENT_ERR("failed to retrieve from mincover cache");
+        goto done;
+    }
+    if (mincover) {
+        goto done;
+    }
+
+    mincover = mc_get_mincover_from_FLE2RangeFindSpec(findSpec, sparsity, status);
+    if (!mincover) {
+        goto done;
+    }
+    if (!_mongocrypt_cache_add_copy(&crypt->cache_mincover, &attr, mincover, status)) {
+        mc_mincover_destroy(mincover);
+        mincover = NULL;
+        goto done;
+    }
+
+done:
+    bson_destroy(&key);
+    return mincover;
+}
+
 /**
  * Payload subtype 10: FLE2FindRangePayload
  *
@@ -1602,20 +2418,18 @@ static bool _mongocrypt_fle2_placeholder_to_find_ciphertextForRange_v1(_mongocry
                 goto fail;
             }
 
-            mc_ServerDataEncryptionLevel1Token_t *serverToken =
-                mc_ServerDataEncryptionLevel1Token_new(crypto, &tokenKey, status);
-            if (!serverToken) {
+            mc_ServerDataEncryptionLevel1Token_t serverToken;
+            if (!mc_ServerDataEncryptionLevel1Token_derive(&serverToken, crypto, &tokenKey, status)) {
                 goto fail;
             }
-            _mongocrypt_buffer_copy_to(mc_ServerDataEncryptionLevel1Token_get(serverToken),
+            _mongocrypt_buffer_copy_to(mc_ServerDataEncryptionLevel1Token_get(&serverToken),
                                        &payload.payload.value.serverEncryptionToken);
-            mc_ServerDataEncryptionLevel1Token_destroy(serverToken);
         }
 
         // g:= array<EdgeFindTokenSet>
         {
             BSON_ASSERT(placeholder->sparsity >= 0 && (uint64_t)placeholder->sparsity <= (uint64_t)SIZE_MAX);
-            mincover = mc_get_mincover_from_FLE2RangeFindSpec(&findSpec, (size_t)placeholder->sparsity, status);
+            mincover = _get_mincover(kb->crypt, &findSpec, (size_t)placeholder->sparsity, status);
             if (!mincover) {
                 goto fail;
             }
@@ -1735,7 +2549,7 @@ static bool _mongocrypt_fle2_placeholder_to_find_ciphertextForRange(_mongocrypt_
         // g:= array<EdgeFindTokenSet>
         {
             BSON_ASSERT(placeholder->sparsity >= 0 && (uint64_t)placeholder->sparsity <= (uint64_t)SIZE_MAX);
-            mincover = mc_get_mincover_from_FLE2RangeFindSpec(&findSpec, (size_t)placeholder->sparsity, status);
+            mincover = _get_mincover(kb->crypt, &findSpec, (size_t)placeholder->sparsity, status);
             if (!mincover) {
                 goto fail;
             }
@@ -1873,15 +2687,10 @@ static bool _mongocrypt_fle1_marking_to_ciphertext(_mongocrypt_key_broker_t *kb,
                                                    _mongocrypt_marking_t *marking,
                                                    _mongocrypt_ciphertext_t *ciphertext,
                                                    mongocrypt_status_t *status) {
-    const _mongocrypt_value_encryption_algorithm_t *fle1 = _mcFLE1Algorithm();
-    _mongocrypt_buffer_t plaintext;
-    _mongocrypt_buffer_t iv;
-    _mongocrypt_buffer_t associated_data;
     _mongocrypt_buffer_t key_material;
     _mongocrypt_buffer_t key_id;
     bool ret = false;
     bool key_found;
-    uint32_t bytes_written;
 
     BSON_ASSERT_PARAM(kb);
     BSON_ASSERT_PARAM(marking);
@@ -1890,9 +2699,6 @@ static bool _mongocrypt_fle1_marking_to_ciphertext(_mongocrypt_key_broker_t *kb,
     BSON_ASSERT((marking->type == MONGOCRYPT_MARKING_FLE1_BY_ID)
                 || (marking->type == MONGOCRYPT_MARKING_FLE1_BY_ALTNAME));
 
-    _mongocrypt_buffer_init(&plaintext);
-    _mongocrypt_buffer_init(&associated_data);
-    _mongocrypt_buffer_init(&iv);
     _mongocrypt_buffer_init(&key_id);
     _mongocrypt_buffer_init(&key_material);
 
@@ -1912,89 +2718,17 @@ static bool _mongocrypt_fle1_marking_to_ciphertext(_mongocrypt_key_broker_t *kb,
         goto fail;
     }
 
-    ciphertext->original_bson_type = (uint8_t)bson_iter_type(&marking->v_iter);
-    if (marking->algorithm == MONGOCRYPT_ENCRYPTION_ALGORITHM_DETERMINISTIC) {
-        ciphertext->blob_subtype = MC_SUBTYPE_FLE1DeterministicEncryptedValue;
-    } else {
-        BSON_ASSERT(marking->algorithm == MONGOCRYPT_ENCRYPTION_ALGORITHM_RANDOM);
-        ciphertext->blob_subtype = MC_SUBTYPE_FLE1RandomEncryptedValue;
-    }
-    _mongocrypt_buffer_copy_to(&key_id, &ciphertext->key_id);
-    if (!_mongocrypt_ciphertext_serialize_associated_data(ciphertext, &associated_data)) {
-        CLIENT_ERR("could not serialize associated data");
-        goto fail;
-    }
-
-    _mongocrypt_buffer_from_iter(&plaintext, &marking->v_iter);
-    ciphertext->data.len = fle1->get_ciphertext_len(plaintext.len, status);
-    if (ciphertext->data.len == 0) {
-        goto fail;
-    }
-    ciphertext->data.data = bson_malloc(ciphertext->data.len);
-    BSON_ASSERT(ciphertext->data.data);
-
-    ciphertext->data.owned = true;
-
     BSON_ASSERT(kb->crypt);
-    switch (marking->algorithm) {
-    case MONGOCRYPT_ENCRYPTION_ALGORITHM_DETERMINISTIC:
-        /* Use deterministic encryption. */
-        _mongocrypt_buffer_resize(&iv, MONGOCRYPT_IV_LEN);
-        ret = _mongocrypt_calculate_deterministic_iv(kb->crypt->crypto,
-                                                     &key_material,
-                                                     &plaintext,
-                                                     &associated_data,
-                                                     &iv,
-                                                     status);
-        if (!ret) {
-            goto fail;
-        }
-
-        ret = fle1->do_encrypt(kb->crypt->crypto,
-                               &iv,
-                               &associated_data,
-                               &key_material,
-                               &plaintext,
-                               &ciphertext->data,
-                               &bytes_written,
-                               status);
-        break;
-    case MONGOCRYPT_ENCRYPTION_ALGORITHM_RANDOM:
-        /* Use randomized encryption.
-         * In this case, we must generate a new, random iv. */
-        _mongocrypt_buffer_resize(&iv, MONGOCRYPT_IV_LEN);
-        if (!_mongocrypt_random(kb->crypt->crypto, &iv, MONGOCRYPT_IV_LEN, status)) {
-            goto fail;
-        }
-        ret = fle1->do_encrypt(kb->crypt->crypto,
-                               &iv,
-                               &associated_data,
-                               &key_material,
-                               &plaintext,
-                               &ciphertext->data,
-                               &bytes_written,
-                               status);
-        break;
-    case MONGOCRYPT_ENCRYPTION_ALGORITHM_NONE:
-    default:
-        /* Error. */
-        CLIENT_ERR("Unsupported value for encryption algorithm");
-        goto fail;
-    }
-
-    if (!ret) {
-        goto fail;
-    }
-
-    BSON_ASSERT(bytes_written == ciphertext->data.len);
-
-    ret = true;
+    ret = _mongocrypt_fle1_encrypt(kb->crypt,
+                                   marking->algorithm,
+                                   &key_id,
+                                   &key_material,
+                                   &marking->v_iter,
+                                   ciphertext,
+                                   status);
 
 fail:
-    _mongocrypt_buffer_cleanup(&iv);
     _mongocrypt_buffer_cleanup(&key_id);
-    _mongocrypt_buffer_cleanup(&plaintext);
-    _mongocrypt_buffer_cleanup(&associated_data);
     _mongocrypt_buffer_cleanup(&key_material);
     return ret;
 }
@@ -2041,3 +2775,379 @@ bool _mongocrypt_marking_to_ciphertext(void *ctx,
     default: CLIENT_ERR("unexpected marking type: %d", (int)marking->type); return false;
     }
 }
+
+/* Per-payload overheads used by _mongocrypt_marking_ciphertext_len_estimate.
+ * They round up the sizes of the serialized tokens, key IDs, IV, HMAC, and
+ * padding, so the estimate is typically slightly above the exact length. */
+#define MARKING_FLE1_OVERHEAD 96u
+#define MARKING_FLE2_INSERT_OVERHEAD 512u
+#define MARKING_FLE2_FIND_OVERHEAD 256u
+#define MARKING_FLE2_EDGE_LEN 256u
+
+/* Returns the number of bits of the range domain of the value in the range
+ * insert spec @v_iter, or 64 if it cannot be determined. */
+static uint32_t _range_insert_bits(const bson_iter_t *v_iter) {
+    bson_iter_t iter = *v_iter;
+
+    if (!BSON_ITER_HOLDS_DOCUMENT(&iter) || !bson_iter_recurse(&iter, &iter) || !bson_iter_find(&iter, "v")) {
+        return 64u;
+    }
+    switch (bson_iter_type(&iter)) {
+    case BSON_TYPE_INT32: return 32u;
+    case BSON_TYPE_DECIMAL128: return 128u;
+    default: return 64u;
+    }
+}
+
+uint64_t _mongocrypt_marking_ciphertext_len_estimate(const _mongocrypt_marking_t *marking,
+                                                     const _mongocrypt_buffer_t *in) {
+    BSON_ASSERT_PARAM(marking);
+    BSON_ASSERT_PARAM(in);
+
+    /* The marking contains the plaintext, so its length bounds the plaintext
+     * length. */
+    const uint64_t plaintext_len = in->len;
+
+    if (marking->type != MONGOCRYPT_MARKING_FLE2_ENCRYPTION) {
+        return plaintext_len + MARKING_FLE1_OVERHEAD;
+    }
+
+    const mc_FLE2EncryptionPlaceholder_t *placeholder = &marking->fle2;
+    if (placeholder->algorithm == MONGOCRYPT_FLE2_ALGORITHM_UNINDEXED) {
+        return plaintext_len + MARKING_FLE1_OVERHEAD;
+    }
+    if (placeholder->type == MONGOCRYPT_FLE2_PLACEHOLDER_TYPE_FIND) {
+        /* Range find payloads depend on the mincover, which is not known
+         * until the keys are decrypted. Underestimating only costs a
+         * reallocation. */
+        return plaintext_len + MARKING_FLE2_FIND_OVERHEAD;
+    }
+
+    uint64_t len = plaintext_len + MARKING_FLE2_INSERT_OVERHEAD;
+    if (placeholder->algorithm == MONGOCRYPT_FLE2_ALGORITHM_RANGE && placeholder->sparsity > 0) {
+        /* One edge per sparsity bits of the domain, plus the root and leaf. */
+        const uint64_t n_edges = _range_insert_bits(&placeholder->v_iter) / (uint64_t)placeholder->sparsity + 2u;
+        len += n_edges * MARKING_FLE2_EDGE_LEN;
+    }
+    return len;
+}
+
+bool _mongocrypt_marking_range_len(mongocrypt_t *crypt,
+                                   _mongocrypt_marking_t *marking,
+                                   uint64_t *out,
+                                   mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(crypt);
+    BSON_ASSERT_PARAM(marking);
+    BSON_ASSERT_PARAM(out);
+
+    *out = 0;
+    if (marking->type != MONGOCRYPT_MARKING_FLE2_ENCRYPTION
+        || marking->fle2.algorithm != MONGOCRYPT_FLE2_ALGORITHM_RANGE) {
+        return true;
+    }
+
+    mc_FLE2EncryptionPlaceholder_t *placeholder = &marking->fle2;
+    BSON_ASSERT(placeholder->sparsity >= 0 && (uint64_t)placeholder->sparsity <= (uint64_t)SIZE_MAX);
+    if (placeholder->type == MONGOCRYPT_FLE2_PLACEHOLDER_TYPE_INSERT) {
+        mc_FLE2RangeInsertSpec_t insertSpec;
+        if (!mc_FLE2RangeInsertSpec_parse(&insertSpec, &placeholder->v_iter, crypt->opts.use_range_v2, status)) {
+            return false;
+        }
+        mc_edges_t *edges = get_edges(&insertSpec, (size_t)placeholder->sparsity, status);
+        if (!edges) {
+            return false;
+        }
+        *out = mc_edges_len(edges);
+        mc_edges_destroy(edges);
+        return true;
+    }
+
+    mc_FLE2RangeFindSpec_t findSpec;
+    if (!mc_FLE2RangeFindSpec_parse(&findSpec, &placeholder->v_iter, crypt->opts.use_range_v2, status)) {
+        return false;
+    }
+    if (!findSpec.edgesInfo.set) {
+        /* The second placeholder of a range query split in two has no edges. */
+        return true;
+    }
+    mc_mincover_t *mincover = _get_mincover(crypt, &findSpec, (size_t)placeholder->sparsity, status);
+    if (!mincover) {
+        return false;
+    }
+    *out = mc_mincover_len(mincover);
+    mc_mincover_destroy(mincover);
+    return true;
+}
+
+/* Token derivations costed per edge by mc_range_estimate. Each insert edge
+ * derives five HMAC-SHA-256 tokens and encrypts one, which costs about as much
+ * as another HMAC. Each query edge derives five tokens. */
+#define RANGE_ESTIMATE_INSERT_HMACS_PER_EDGE 6u
+#define RANGE_ESTIMATE_FIND_HMACS_PER_EDGE 5u
+#define RANGE_ESTIMATE_HMAC_SAMPLES 256u
+
+/* Returns the mean time of one HMAC-SHA-256 with @crypto in microseconds, or
+ * a negative value on error. */
+static double _range_estimate_hmac_usec(_mongocrypt_crypto_t *crypto, mongocrypt_status_t *status) {
+    uint8_t key_data[MONGOCRYPT_HMAC_SHA256_LEN] = {0};
+    uint8_t in_data[16] = {0};
+    _mongocrypt_buffer_t key, in, out;
+
+    _mongocrypt_buffer_init(&key);
+    key.data = key_data;
+    key.len = sizeof(key_data);
+    _mongocrypt_buffer_init(&in);
+    in.data = in_data;
+    in.len = sizeof(in_data);
+    _mongocrypt_buffer_init_size(&out, MONGOCRYPT_HMAC_SHA256_LEN);
+
+    const int64_t start = bson_get_monotonic_time();
+    for (uint32_t i = 0; i < RANGE_ESTIMATE_HMAC_SAMPLES; i++) {
+        if (!_mongocrypt_hmac_sha_256(crypto, &key, &in, &out, status)) {
+            _mongocrypt_buffer_cleanup(&out);
+            return -1;
+        }
+    }
+    const int64_t elapsed = bson_get_monotonic_time() - start;
+    _mongocrypt_buffer_cleanup(&out);
+    return (double)elapsed / (double)RANGE_ESTIMATE_HMAC_SAMPLES;
+}
+
+/* Returns the encoded length of a range value of type @type. */
+static uint32_t _range_value_len(bson_type_t type) {
+    switch (type) {
+    case BSON_TYPE_INT32: return 4u;
+    case BSON_TYPE_DECIMAL128: return 16u;
+    default: return 8u;
+    }
+}
+
+typedef struct {
+    int64_t count;
+    int64_t total;
+    int64_t max;
+    int64_t total_bytes;
+    int64_t max_bytes;
+    int64_t generate_usec;
+} _range_estimate_totals_t;
+
+static void _range_estimate_add(_range_estimate_totals_t *totals, size_t n, int64_t bytes, int64_t usec) {
+    const int64_t n64 = n > INT64_MAX ? INT64_MAX : (int64_t)n;
+
+    totals->count++;
+    totals->total += n64;
+    totals->max = BSON_MAX(totals->max, n64);
+    totals->total_bytes += bytes;
+    totals->max_bytes = BSON_MAX(totals->max_bytes, bytes);
+    totals->generate_usec += usec;
+}
+
+static bool _range_estimate_insert(const mc_RangeOpts_t *ro,
+                                   const bson_iter_t *value,
+                                   bool use_range_v2,
+                                   _range_estimate_totals_t *totals,
+                                   mongocrypt_status_t *status) {
+    bson_t v_doc = BSON_INITIALIZER;
+    bson_t spec_doc = BSON_INITIALIZER;
+    bson_iter_t spec_iter;
+    mc_FLE2RangeInsertSpec_t insertSpec;
+    mc_edges_t *edges = NULL;
+    bool ok = false;
+
+    if (!bson_append_iter(&v_doc, "v", 1, value)) {
+        CLIENT_ERR("failed to append value");
+        goto fail;
+    }
+    if (!mc_RangeOpts_to_FLE2RangeInsertSpec(ro, &v_doc, &spec_doc, use_range_v2, status)) {
+        goto fail;
+    }
+    if (!bson_iter_init_find(&spec_iter, &spec_doc, "v")) {
+        CLIENT_ERR("failed to find FLE2RangeInsertSpec");
+        goto fail;
+    }
+    if (!mc_FLE2RangeInsertSpec_parse(&insertSpec, &spec_iter, use_range_v2, status)) {
+        goto fail;
+    }
+
+    const int64_t start = bson_get_monotonic_time();
+    edges = get_edges(&insertSpec, (size_t)ro->sparsity, status);
+    if (!edges) {
+        goto fail;
+    }
+    const int64_t usec = bson_get_monotonic_time() - start;
+
+    const size_t n = mc_edges_len(edges);
+    const int64_t bytes = (int64_t)_range_value_len(bson_iter_type(&insertSpec.v)) + MARKING_FLE2_INSERT_OVERHEAD
+                        + (int64_t)n * MARKING_FLE2_EDGE_LEN;
+    _range_estimate_add(totals, n, bytes, usec);
+    ok = true;
+fail:
+    mc_edges_destroy(edges);
+    bson_destroy(&spec_doc);
+    bson_destroy(&v_doc);
+    return ok;
+}
+
+/* Parses an optional boolean field of a query. */
+static bool _range_estimate_included(const bson_t *query, const char *field, bool *out, mongocrypt_status_t *status) {
+    bson_iter_t iter;
+
+    *out = true;
+    if (!bson_iter_init_find(&iter, query, field)) {
+        return true;
+    }
+    if (!BSON_ITER_HOLDS_BOOL(&iter)) {
+        CLIENT_ERR("expected '%s' to be a bool, got: %s", field, mc_bson_type_to_string(bson_iter_type(&iter)));
+        return false;
+    }
+    *out = bson_iter_bool(&iter);
+    return true;
+}
+
+static bool _range_estimate_find(const mc_RangeOpts_t *ro,
+                                 const bson_iter_t *query_iter,
+                                 _range_estimate_totals_t *totals,
+                                 mongocrypt_status_t *status) {
+    bson_t query;
+    bson_t bounds = BSON_INITIALIZER;
+    bson_iter_t lower, upper;
+    bool has_lower, has_upper;
+    mc_FLE2RangeFindSpec_t findSpec;
+    mc_FLE2RangeFindSpecEdgesInfo_t *info = &findSpec.edgesInfo.value;
+    mc_mincover_t *mincover = NULL;
+    bool ok = false;
+
+    memset(&findSpec, 0, sizeof(findSpec));
+
+    if (!BSON_ITER_HOLDS_DOCUMENT(query_iter) || !mc_iter_document_as_bson(query_iter, &query, status)) {
+        CLIENT_ERR("expected each query to be a document");
+        goto fail;
+    }
+    has_lower = bson_iter_init_find(&lower, &query, "lowerBound");
+    has_upper = bson_iter_init_find(&upper, &query, "upperBound");
+    if (!has_lower && !has_upper) {
+        CLIENT_ERR("expected query to have 'lowerBound' or 'upperBound'");
+        goto fail;
+    }
+
+    const bson_type_t index_type = bson_iter_type(has_lower ? &lower : &upper);
+    if (!mc_RangeOpts_appendMin(ro, index_type, "indexMin", &bounds, status)
+        || !mc_RangeOpts_appendMax(ro, index_type, "indexMax", &bounds, status)) {
+        goto fail;
+    }
+    if (!bson_iter_init_find(&info->indexMin, &bounds, "indexMin")
+        || !bson_iter_init_find(&info->indexMax, &bounds, "indexMax")) {
+        CLIENT_ERR("failed to find index bounds");
+        goto fail;
+    }
+
+    // An open-ended query ranges to the index min or max.
+    info->lowerBound = has_lower ? lower : info->indexMin;
+    info->upperBound = has_upper ? upper : info->indexMax;
+    info->lbIncluded = true;
+    info->ubIncluded = true;
+    if ((has_lower && !_range_estimate_included(&query, "lbIncluded", &info->lbIncluded, status))
+        || (has_upper && !_range_estimate_included(&query, "ubIncluded", &info->ubIncluded, status))) {
+        goto fail;
+    }
+    info->precision = ro->precision;
+    info->trimFactor = ro->trimFactor;
+    findSpec.edgesInfo.set = true;
+
+    const int64_t start = bson_get_monotonic_time();
+    mincover = mc_get_mincover_from_FLE2RangeFindSpec(&findSpec, (size_t)ro->sparsity, status);
+    if (!mincover) {
+        goto fail;
+    }
+    const int64_t usec = bson_get_monotonic_time() - start;
+
+    const size_t n = mc_mincover_len(mincover);
+    _range_estimate_add(totals, n, (int64_t)n * MARKING_FLE2_EDGE_LEN + MARKING_FLE2_FIND_OVERHEAD, usec);
+    ok = true;
+fail:
+    mc_mincover_destroy(mincover);
+    bson_destroy(&bounds);
+    return ok;
+}
+
+static void _range_estimate_append(bson_t *out,
+                                   const char *name,
+                                   const _range_estimate_totals_t *totals,
+                                   uint32_t hmacs_per_edge,
+                                   double hmac_usec) {
+    bson_t child;
+    const double count = totals->count > 0 ? (double)totals->count : 1.0;
+    const double cpu_usec = (double)totals->generate_usec + (double)totals->total * hmacs_per_edge * hmac_usec;
+
+    BSON_ASSERT(BSON_APPEND_DOCUMENT_BEGIN(out, name, &child));
+    BSON_ASSERT(BSON_APPEND_INT64(&child, "count", totals->count));
+    BSON_ASSERT(BSON_APPEND_DOUBLE(&child, "edges", (double)totals->total / count));
+    BSON_ASSERT(BSON_APPEND_INT64(&child, "maxEdges", totals->max));
+    BSON_ASSERT(BSON_APPEND_DOUBLE(&child, "payloadBytes", (double)totals->total_bytes / count));
+    BSON_ASSERT(BSON_APPEND_INT64(&child, "maxPayloadBytes", totals->max_bytes));
+    BSON_ASSERT(BSON_APPEND_DOUBLE(&child, "cpuMicros", cpu_usec / count));
+    BSON_ASSERT(bson_append_document_end(out, &child));
+}
+
+bool mc_range_estimate(_mongocrypt_crypto_t *crypto,
+                       const bson_t *in,
+                       bool use_range_v2,
+                       bson_t *out,
+                       mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(crypto);
+    BSON_ASSERT_PARAM(in);
+    BSON_ASSERT_PARAM(out);
+
+    mc_RangeOpts_t ro = {0};
+    bson_t ro_doc;
+    bson_iter_t iter, array;
+    _range_estimate_totals_t inserts = {0}, finds = {0};
+    bool ok = false;
+
+    if (!bson_iter_init_find(&iter, in, "rangeOpts") || !BSON_ITER_HOLDS_DOCUMENT(&iter)
+        || !mc_iter_document_as_bson(&iter, &ro_doc, status)) {
+        CLIENT_ERR("expected 'rangeOpts' document");
+        return false;
+    }
+    if (!mc_RangeOpts_parse(&ro, &ro_doc, use_range_v2, status)) {
+        goto fail;
+    }
+    if (!mc_validate_sparsity(ro.sparsity, status)) {
+        goto fail;
+    }
+
+    if (bson_iter_init_find(&iter, in, "values")) {
+        if (!BSON_ITER_HOLDS_ARRAY(&iter) || !bson_iter_recurse(&iter, &array)) {
+            CLIENT_ERR("expected 'values' to be an array");
+            goto fail;
+        }
+        while (bson_iter_next(&array)) {
+            if (!_range_estimate_insert(&ro, &array, use_range_v2, &inserts, status)) {
+                goto fail;
+            }
+        }
+    }
+
+    if (bson_iter_init_find(&iter, in, "queries")) {
+        if (!BSON_ITER_HOLDS_ARRAY(&iter) || !bson_iter_recurse(&iter, &array)) {
+            CLIENT_ERR("expected 'queries' to be an array");
+            goto fail;
+        }
+        while (bson_iter_next(&array)) {
+            if (!_range_estimate_find(&ro, &array, &finds, status)) {
+                goto fail;
+            }
+        }
+    }
+
+    const double hmac_usec = _range_estimate_hmac_usec(crypto, status);
+    if (hmac_usec < 0) {
+        goto fail;
+    }
+    _range_estimate_append(out, "insert", &inserts, RANGE_ESTIMATE_INSERT_HMACS_PER_EDGE, hmac_usec);
+    _range_estimate_append(out, "find", &finds, RANGE_ESTIMATE_FIND_HMACS_PER_EDGE, hmac_usec);
+    ok = true;
+fail:
+    mc_RangeOpts_cleanup(&ro);
+    return ok;
+}
@@ -22,8 +22,14 @@
 #if defined(BSON_OS_UNIX)
 #include <pthread.h>
 #define mongocrypt_mutex_t pthread_mutex_t
+#define mongocrypt_rwlock_t pthread_rwlock_t
+#define mongocrypt_thread_key_t pthread_key_t
+#define MONGOCRYPT_THREAD_KEY_CALLBACK
 #else
 #define mongocrypt_mutex_t CRITICAL_SECTION
+#define mongocrypt_rwlock_t SRWLOCK
+#define mongocrypt_thread_key_t DWORD
+#define MONGOCRYPT_THREAD_KEY_CALLBACK NTAPI
 #endif
 
 void _mongocrypt_mutex_init(mongocrypt_mutex_t *mutex);
@@ -34,6 +40,32 @@ void _mongocrypt_mutex_lock(mongocrypt_mutex_t *mutex);
 
 void _mongocrypt_mutex_unlock(mongocrypt_mutex_t *mutex);
 
+/* A reader/writer lock. Any number of readers may hold the lock at once.
+ * Readers must release with _mongocrypt_rwlock_read_unlock and writers with
+ * _mongocrypt_rwlock_write_unlock. */
+void _mongocrypt_rwlock_init(mongocrypt_rwlock_t *rwlock);
+
+void _mongocrypt_rwlock_cleanup(mongocrypt_rwlock_t *rwlock);
+
+void _mongocrypt_rwlock_read_lock(mongocrypt_rwlock_t *rwlock);
+
+void _mongocrypt_rwlock_read_unlock(mongocrypt_rwlock_t *rwlock);
+
+void _mongocrypt_rwlock_write_lock(mongocrypt_rwlock_t *rwlock);
+
+void _mongocrypt_rwlock_write_unlock(mongocrypt_rwlock_t *rwlock);
+
+/* A key to a pointer stored separately by each thread, NULL until the thread
+ * sets it. When a thread exits, @destructor is called with its pointer if it is
+ * not NULL. Keys are never deleted. Declare @destructor with
+ * MONGOCRYPT_THREAD_KEY_CALLBACK. */
+void _mongocrypt_thread_key_init(mongocrypt_thread_key_t *key,
+                                 void(MONGOCRYPT_THREAD_KEY_CALLBACK *destructor)(void *));
+
+void *_mongocrypt_thread_key_get(mongocrypt_thread_key_t *key);
+
+void _mongocrypt_thread_key_set(mongocrypt_thread_key_t *key, void *value);
+
 #define MONGOCRYPT_WITH_MUTEX(Mutex)                                                                                   \
     for (int only_once = (_mongocrypt_mutex_lock(&(Mutex)), 1); only_once; _mongocrypt_mutex_unlock(&(Mutex)))         \
         for (; only_once; only_once = 0)
@@ -95,11 +95,27 @@ bool _mongocrypt_opts_kms_providers_lookup(const _mongocrypt_opts_kms_providers_
                                            const char *kmsid,
                                            mc_kms_creds_t *out);
 
+/* Writes a BSON document of the configured credentials of @kms_providers to
+ * @out. Providers configured the same way give equal documents. */
+void _mongocrypt_opts_kms_providers_fingerprint(const _mongocrypt_opts_kms_providers_t *kms_providers,
+                                                _mongocrypt_buffer_t *out);
+
 typedef struct {
     mongocrypt_log_fn_t log_fn;
     void *log_ctx;
+    mongocrypt_log_level_t log_level;
+    mongocrypt_trace_fn_t trace_fn;
+    void *trace_ctx;
+    mongocrypt_record_fn_t record_fn;
+    void *record_ctx;
+    // malloc_fn and free_fn allocate contexts and their key broker nodes. NULL uses bson_malloc.
+    mongocrypt_malloc_fn_t malloc_fn;
+    mongocrypt_free_fn_t free_fn;
+    void *allocator_ctx;
     _mongocrypt_buffer_t schema_map;
     _mongocrypt_buffer_t encrypted_field_config_map;
+    // Key documents of an offline copy of the key vault collection.
+    _mongocrypt_buffer_t key_vault_snapshot;
 
     _mongocrypt_opts_kms_providers_t kms_providers;
     mongocrypt_hmac_fn sign_rsaes_pkcs1_v1_5;
@@ -115,8 +131,26 @@ typedef struct {
     mstr crypt_shared_lib_override_path;
 
     bool use_need_kms_credentials_state;
+    // Lifetime of on-demand KMS credentials reused by later contexts. 0 does
+    // not reuse them.
+    uint64_t kms_credentials_cache_expiration_ms;
     bool use_need_mongo_collinfo_with_db_state;
+    bool use_need_mongo_ops_state;
     bool bypass_query_analysis;
+    /// Load crypt_shared on the first auto encryption that needs markings
+    /// instead of in mongocrypt_init().
+    bool defer_crypt_shared_load;
+
+    // Hooks of the second key cache tier shared with other processes, and the
+    // key encrypting its snapshots. NULL hooks disable the tier.
+    mongocrypt_key_cache_load_fn key_cache_load;
+    mongocrypt_key_cache_store_fn key_cache_store;
+    void *key_cache_shared_ctx;
+    _mongocrypt_buffer_t key_cache_shared_kek;
+
+    // Name of the process-wide cache domain to share the key cache with, or
+    // NULL.
+    char *cache_domain;
 
     // When creating new encrypted payloads,
     // use V2 variants of the FLE2 datatypes.
@@ -124,6 +158,112 @@ typedef struct {
 
     // Use the Queryable Encryption Range V2 protocol.
     bool use_range_v2;
+
+    // Fraction of the key cache expiration after which a cached key is
+    // fetched again. 0 disables refresh-ahead.
+    double key_cache_refresh_ahead;
+
+    // Maximum number of entries of the key and collinfo caches. 0 means
+    // unbounded.
+    uint32_t key_cache_max_entries;
+    uint32_t collinfo_cache_max_entries;
+
+    // Maximum number of cached range query covers. 0 disables the cache.
+    uint32_t mincover_cache_max_entries;
+
+    // Maximum number of cached query analysis replies. 0 disables the cache.
+    uint32_t marking_cache_max_entries;
+
+    // Maximum number of cached deleteTokens and compactionTokens documents. 0
+    // disables the cache.
+    uint32_t token_cache_max_entries;
+
+    // Maximum number of cached Deterministic ciphertexts. 0 disables the cache.
+    uint32_t deterministic_cache_max_entries;
+
+    // Maximum number of cached FLE2FindEqualityPayloadV2. 0 disables the cache.
+    uint32_t find_payload_cache_max_entries;
+
+    // Maximum number of cached parsed range options. 0 disables the cache.
+    uint32_t range_opts_cache_max_entries;
+
+    // Minimum number of markings in a command to convert them with the
+    // parallel_for executor. 0 converts markings on the calling thread.
+    uint32_t parallel_marking_threshold;
+
+    // Minimum number of ciphertexts in a document to decrypt them with the
+    // parallel_for executor. 0 decrypts on the calling thread.
+    uint32_t parallel_decrypt_threshold;
+
+    // Minimum number of keys with a local KEK added to a context to unwrap
+    // them with the parallel_for executor. 0 unwraps each key as it is added.
+    uint32_t parallel_key_unwrap_threshold;
+    /* lock_key_material allocates key material from the secure arena. */
+    bool lock_key_material;
+    /* eager_crypto_init initializes native crypto in mongocrypt_init instead
+     * of on first use. */
+    bool eager_crypto_init;
+
+    // Lifetime of cached collinfo. INT64_MAX means collinfo does not expire.
+    uint64_t collinfo_expiration_ms;
+
+    // Lifetime of cached collinfo for collections without a JSON schema or
+    // encryptedFields. 0 uses the collinfo cache expiration.
+    uint64_t unencrypted_collinfo_expiration_ms;
+
+    // Lifetime of cached KEK SecretData retrieved with KMIP Get. 0 disables
+    // the cache.
+    uint64_t kmip_kek_cache_expiration_ms;
+
+    // On a collinfo cache miss, list all collections of the database.
+    bool prefetch_collinfo;
+
+    // Only one context decrypts a key with a KMS at a time. Other contexts
+    // needing the key wait for it in the NEED_KMS state.
+    bool coalesce_kms_decrypts;
+
+    // Keep recently used keys in a cache of each thread in front of the key
+    // cache, so lookups by key id do not lock the shared cache.
+    bool key_cache_thread_local;
+
+    // Retry KMS requests on throttling, transient server errors, and network
+    // errors reported with mongocrypt_kms_ctx_fail.
+    bool retry_kms;
+
+    // Pace KMS requests to each KMS provider and endpoint to
+    // kms_rate_limit_per_sec requests per second, allowing bursts of
+    // kms_rate_limit_burst requests. 0 disables pacing.
+    uint32_t kms_rate_limit_per_sec;
+    uint32_t kms_rate_limit_burst;
+
+    // Omit the "Connection: close" header from KMS HTTP requests so drivers
+    // can reuse connections.
+    bool kms_keep_alive;
+
+    // Accept KMS response bytes beyond what the parser asked for, so drivers
+    // can read responses with fewer, larger reads.
+    bool kms_large_reads;
+
+    // Get the keys of a context on the same KMIP server with one request.
+    bool batch_kmip_requests;
+
+    // Fetch a new OAuth token once the cached one expires within this many
+    // milliseconds. 0 only fetches a token once the cached one expires.
+    uint64_t oauth_refresh_margin_ms;
+
+    // Alternate endpoints by KMS provider name, as a BSON document of arrays.
+    // A key decrypt request still waiting after kms_hedge_after_ms is sent
+    // again to an alternate endpoint. Empty disables hedged requests.
+    _mongocrypt_buffer_t kms_hedge_endpoints;
+    uint64_t kms_hedge_after_ms;
+
+    // Lifetime of cached data keys in milliseconds. INT64_MAX if keys do not
+    // expire.
+    uint64_t key_expiration_ms;
+    // Lifetimes of cached data keys by KMS provider name, as a BSON document
+    // of int64 milliseconds, where 0 means keys do not expire. Keys with other
+    // KMS providers use key_expiration_ms.
+    _mongocrypt_buffer_t key_expiration_by_kms_provider;
 } _mongocrypt_opts_t;
 
 void _mongocrypt_opts_kms_providers_cleanup(_mongocrypt_opts_kms_providers_t *kms_providers);
@@ -140,6 +280,12 @@ void _mongocrypt_opts_cleanup(_mongocrypt_opts_t *opts);
 
 bool _mongocrypt_opts_validate(_mongocrypt_opts_t *opts, mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
 
+/* _validate_encrypted_field_config_map_and_schema_map validates that the same
+ * namespace is not both in encrypted_field_config_map and schema_map. */
+bool _validate_encrypted_field_config_map_and_schema_map(const _mongocrypt_buffer_t *encrypted_field_config_map,
+                                                         const _mongocrypt_buffer_t *schema_map,
+                                                         mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
 bool _mongocrypt_opts_kms_providers_validate(_mongocrypt_opts_t *opts,
                                              _mongocrypt_opts_kms_providers_t *kms_providers,
                                              mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
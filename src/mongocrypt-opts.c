@@ -35,6 +35,9 @@ void _mongocrypt_opts_kms_providers_init(_mongocrypt_opts_kms_providers_t *kms_p
 void _mongocrypt_opts_init(_mongocrypt_opts_t *opts) {
     BSON_ASSERT_PARAM(opts);
     memset(opts, 0, sizeof(*opts));
+    opts->log_level = MONGOCRYPT_LOG_LEVEL_TRACE;
+    opts->key_expiration_ms = CACHE_EXPIRATION_MS;
+    opts->collinfo_expiration_ms = CACHE_EXPIRATION_MS;
 #ifdef QE_USE_RANGE_V2
     opts->use_range_v2 = true;
 #endif
@@ -152,12 +155,17 @@ void _mongocrypt_opts_cleanup(_mongocrypt_opts_t *opts) {
     _mongocrypt_opts_kms_providers_cleanup(&opts->kms_providers);
     _mongocrypt_buffer_cleanup(&opts->schema_map);
     _mongocrypt_buffer_cleanup(&opts->encrypted_field_config_map);
+    _mongocrypt_buffer_cleanup(&opts->key_vault_snapshot);
+    _mongocrypt_buffer_cleanup(&opts->kms_hedge_endpoints);
+    _mongocrypt_buffer_cleanup(&opts->key_expiration_by_kms_provider);
     // Free any lib search paths added by the caller
     for (int i = 0; i < opts->n_crypt_shared_lib_search_paths; ++i) {
         mstr_free(opts->crypt_shared_lib_search_paths[i]);
     }
     bson_free(opts->crypt_shared_lib_search_paths);
     mstr_free(opts->crypt_shared_lib_override_path);
+    bson_free(opts->cache_domain);
+    _mongocrypt_buffer_cleanup(&opts->key_cache_shared_kek);
 }
 
 bool _mongocrypt_opts_kms_providers_validate(_mongocrypt_opts_t *opts,
@@ -228,11 +236,9 @@ static bool _shares_bson_fields(bson_t *one, bson_t *two, const char **found, mo
     return true;
 }
 
-/* _validate_encrypted_field_config_map_and_schema_map validates that the same
- * namespace is not both in encrypted_field_config_map and schema_map. */
-static bool _validate_encrypted_field_config_map_and_schema_map(_mongocrypt_buffer_t *encrypted_field_config_map,
-                                                                _mongocrypt_buffer_t *schema_map,
-                                                                mongocrypt_status_t *status) {
+bool _validate_encrypted_field_config_map_and_schema_map(const _mongocrypt_buffer_t *encrypted_field_config_map,
+                                                         const _mongocrypt_buffer_t *schema_map,
+                                                         mongocrypt_status_t *status) {
     BSON_ASSERT_PARAM(encrypted_field_config_map);
     BSON_ASSERT_PARAM(schema_map);
 
@@ -323,6 +329,79 @@ bool _mongocrypt_opts_kms_providers_lookup(const _mongocrypt_opts_kms_providers_
     return false;
 }
 
+static void _append_optional_utf8(bson_t *doc, const char *key, const char *value) {
+    if (value) {
+        BSON_ASSERT(bson_append_utf8(doc, key, -1, value, -1));
+    }
+}
+
+static void _append_optional_endpoint(bson_t *doc, const char *key, const _mongocrypt_endpoint_t *endpoint) {
+    if (endpoint) {
+        _append_optional_utf8(doc, key, endpoint->original);
+    }
+}
+
+static void _append_creds(bson_t *doc, const char *kmsid, const mc_kms_creds_t *creds) {
+    bson_t child;
+
+    BSON_ASSERT(bson_append_document_begin(doc, kmsid, -1, &child));
+    switch (creds->type) {
+    default:
+    case MONGOCRYPT_KMS_PROVIDER_NONE: break;
+    case MONGOCRYPT_KMS_PROVIDER_AWS:
+        _append_optional_utf8(&child, "accessKeyId", creds->value.aws.access_key_id);
+        _append_optional_utf8(&child, "secretAccessKey", creds->value.aws.secret_access_key);
+        _append_optional_utf8(&child, "sessionToken", creds->value.aws.session_token);
+        break;
+    case MONGOCRYPT_KMS_PROVIDER_LOCAL:
+        BSON_ASSERT(_mongocrypt_buffer_append(&creds->value.local.key, &child, "key", -1));
+        break;
+    case MONGOCRYPT_KMS_PROVIDER_AZURE:
+        _append_optional_utf8(&child, "tenantId", creds->value.azure.tenant_id);
+        _append_optional_utf8(&child, "clientId", creds->value.azure.client_id);
+        _append_optional_utf8(&child, "clientSecret", creds->value.azure.client_secret);
+        _append_optional_endpoint(&child,
+                                  "identityPlatformEndpoint",
+                                  creds->value.azure.identity_platform_endpoint);
+        _append_optional_utf8(&child, "accessToken", creds->value.azure.access_token);
+        break;
+    case MONGOCRYPT_KMS_PROVIDER_GCP:
+        _append_optional_utf8(&child, "email", creds->value.gcp.email);
+        if (!_mongocrypt_buffer_empty(&creds->value.gcp.private_key)) {
+            BSON_ASSERT(_mongocrypt_buffer_append(&creds->value.gcp.private_key, &child, "privateKey", -1));
+        }
+        _append_optional_endpoint(&child, "endpoint", creds->value.gcp.endpoint);
+        _append_optional_utf8(&child, "accessToken", creds->value.gcp.access_token);
+        break;
+    case MONGOCRYPT_KMS_PROVIDER_KMIP: _append_optional_endpoint(&child, "endpoint", creds->value.kmip.endpoint); break;
+    }
+    BSON_ASSERT(bson_append_document_end(doc, &child));
+}
+
+void _mongocrypt_opts_kms_providers_fingerprint(const _mongocrypt_opts_kms_providers_t *kms_providers,
+                                                _mongocrypt_buffer_t *out) {
+    static const char *const unnamed[] = {"aws", "azure", "gcp", "local", "kmip"};
+    bson_t doc = BSON_INITIALIZER;
+
+    BSON_ASSERT_PARAM(kms_providers);
+    BSON_ASSERT_PARAM(out);
+
+    BSON_ASSERT(bson_append_int32(&doc, "needCredentials", -1, kms_providers->need_credentials));
+    for (size_t i = 0; i < sizeof(unnamed) / sizeof(unnamed[0]); i++) {
+        mc_kms_creds_t creds;
+
+        if (_mongocrypt_opts_kms_providers_lookup(kms_providers, unnamed[i], &creds)) {
+            _append_creds(&doc, unnamed[i], &creds);
+        }
+    }
+    for (size_t i = 0; i < kms_providers->named_mut.len; i++) {
+        mc_kms_creds_with_id_t kcwi = _mc_array_index(&kms_providers->named_mut, mc_kms_creds_with_id_t, i);
+
+        _append_creds(&doc, kcwi.kmsid, &kcwi.creds);
+    }
+    _mongocrypt_buffer_steal_from_bson(out, &doc);
+}
+
 bool _mongocrypt_parse_optional_utf8(const bson_t *bson, const char *dotkey, char **out, mongocrypt_status_t *status) {
     bson_iter_t iter;
     bson_iter_t child;
@@ -21,7 +21,11 @@
 #include "mongocrypt-config.h"
 #include "mongocrypt.h"
 
+#include "mc-array-private.h"
+#include "mc-key-vault-snapshot-private.h"
+#include "mc-schema-map-private.h"
 #include "mongocrypt-buffer-private.h"
+#include "mongocrypt-cache-domain-private.h"
 #include "mongocrypt-cache-key-private.h"
 #include "mongocrypt-cache-oauth-private.h"
 #include "mongocrypt-cache-private.h"
@@ -108,6 +112,69 @@ typedef struct _mongo_crypt_v1_vtable {
     bool okay;
 } _mongo_crypt_v1_vtable;
 
+/* Counters of activity on a mongocrypt_t, reported by mongocrypt_get_counters.
+ * The names are listed in _mongocrypt_counter_names. */
+typedef enum {
+    MC_COUNTER_CTX_ENCRYPT,
+    MC_COUNTER_CTX_DECRYPT,
+    MC_COUNTER_CTX_CREATE_DATA_KEY,
+    MC_COUNTER_CTX_REWRAP_MANY_DATAKEY,
+    MC_COUNTER_CTX_PREFETCH_KEYS,
+    MC_COUNTER_ENCRYPTED_FLE1,
+    MC_COUNTER_ENCRYPTED_FLE2_EQUALITY,
+    MC_COUNTER_ENCRYPTED_FLE2_RANGE,
+    MC_COUNTER_ENCRYPTED_FLE2_UNINDEXED,
+    MC_COUNTER_DECRYPTED_FLE1,
+    MC_COUNTER_DECRYPTED_FLE2_EQUALITY,
+    MC_COUNTER_DECRYPTED_FLE2_RANGE,
+    MC_COUNTER_DECRYPTED_FLE2_UNINDEXED,
+    MC_COUNTER_BYTES_ENCRYPT,
+    MC_COUNTER_BYTES_DECRYPT,
+    MC_COUNTER_KMS_AWS,
+    MC_COUNTER_KMS_AZURE,
+    MC_COUNTER_KMS_GCP,
+    MC_COUNTER_KMS_KMIP,
+    MC_COUNTER_MARKINGS_CRYPT_SHARED,
+    MC_COUNTER_MARKINGS_MONGOCRYPTD,
+    MC_COUNTER_MARKINGS_CACHE,
+    MC_COUNTER_COUNT
+} mc_counter_t;
+
+/* The number of buckets of a KMS latency histogram. The last bucket counts
+ * latencies above the largest bound of _mongocrypt_kms_latency_bounds_ms. */
+#define MC_KMS_LATENCY_BUCKET_COUNT 13
+
+/* A count of KMS errors with the same HTTP status or KMIP Result Reason. */
+typedef struct {
+    int64_t code;
+    int64_t count;
+} _mongocrypt_kms_error_count_t;
+
+/* KMS request latency and errors of one KMS provider and endpoint, reported by
+ * mongocrypt_get_kms_stats. */
+typedef struct {
+    char *kmsid;
+    char *endpoint;
+    int64_t requests;
+    int64_t total_us;
+    int64_t latency_buckets[MC_KMS_LATENCY_BUCKET_COUNT];
+    /* Counts of failed requests by HTTP status and by KMIP Result Reason.
+     * Elements are _mongocrypt_kms_error_count_t. */
+    mc_array_t http_errors;
+    mc_array_t kmip_errors;
+    /* Failed requests without a KMS response, like network errors. */
+    int64_t other_errors;
+} _mongocrypt_kms_stats_t;
+
+/* Pacing state of KMS requests to one KMS provider and endpoint, set with
+ * mongocrypt_setopt_kms_rate_limit. next_us is the monotonic time the next
+ * request could be sent at if no burst were allowed. */
+typedef struct {
+    char *kmsid;
+    char *endpoint;
+    int64_t next_us;
+} _mongocrypt_kms_rate_limit_t;
+
 struct _mongocrypt_t {
     bool initialized;
     _mongocrypt_opts_t opts;
@@ -115,6 +182,38 @@ struct _mongocrypt_t {
     /* The collinfo and key cache are protected with an internal mutex. */
     _mongocrypt_cache_t cache_collinfo;
     _mongocrypt_cache_t cache_key;
+    /// Range query covers. Only used if opts.mincover_cache_max_entries is set.
+    _mongocrypt_cache_t cache_mincover;
+    /// Query analysis replies by command shape. Only used if
+    /// opts.marking_cache_max_entries is set.
+    _mongocrypt_cache_t cache_marking;
+    /// deleteTokens and compactionTokens by encryptedFields. Only used if
+    /// opts.token_cache_max_entries is set.
+    _mongocrypt_cache_t cache_tokens;
+    /// Ciphertexts of the Deterministic algorithm by key and value. Only used
+    /// if opts.deterministic_cache_max_entries is set.
+    _mongocrypt_cache_t cache_deterministic;
+    /// Equality find payloads by index key, value and contention factor. Only
+    /// used if opts.find_payload_cache_max_entries is set.
+    _mongocrypt_cache_t cache_find_payload;
+    /// Parsed range options by their BSON. Only used if
+    /// opts.range_opts_cache_max_entries is set.
+    _mongocrypt_cache_t cache_range_opts;
+    /// KEK SecretData from KMIP Get by KMIP endpoint and key ID. Only used if
+    /// opts.kmip_kek_cache_expiration_ms is set.
+    _mongocrypt_cache_t cache_kmip_kek;
+    /// K_KeyId last found with each S_KeyId of a Queryable Encryption indexed
+    /// value. Used to prefetch the K_KeyId with the S_KeyId when decrypting.
+    _mongocrypt_cache_t cache_user_key_id;
+    /// opts.schema_map and opts.encrypted_field_config_map by namespace,
+    /// compiled by mongocrypt_init. NULL if the map is not set. Protected by
+    /// mutex, since they are replaced by mongocrypt_update_schema_map and
+    /// mongocrypt_update_encrypted_field_config_map. Contexts hold references.
+    mc_mapof_ns_to_schema_t *schema_map;
+    mc_mapof_ns_to_schema_t *encrypted_field_config_map;
+    /// opts.key_vault_snapshot, indexed by mongocrypt_init. NULL if the
+    /// snapshot is not set.
+    mc_key_vault_snapshot_t *key_vault_snapshot;
     _mongocrypt_log_t log;
     mongocrypt_status_t *status;
     _mongocrypt_crypto_t *crypto;
@@ -125,6 +224,55 @@ struct _mongocrypt_t {
     _mongo_crypt_v1_vtable csfle;
     /// Pointer to the global csfle_lib object. Should not be freed directly.
     mongo_crypt_v1_lib *csfle_lib;
+    /// Set by mongocrypt_init if loading crypt_shared was deferred. Cleared,
+    /// under mutex, once the first context has tried to load it.
+    bool csfle_load_pending;
+    /// Set, under mutex, if the deferred load of crypt_shared failed with a
+    /// hard error. The error is kept in status.
+    bool csfle_load_failed;
+    /// Idle query analyzers (mongo_crypt_v1_query_analyzer *) created from
+    /// csfle_lib, protected by mutex. Reused across contexts.
+    mc_array_t csfle_query_analyzers;
+    /// Output of the last mongocrypt_get_cache_stats call, protected by mutex.
+    _mongocrypt_buffer_t cache_stats;
+    /// Output of the last mongocrypt_export_key_cache call, protected by mutex.
+    _mongocrypt_buffer_t key_cache_snapshot;
+    /// Ids (_mongocrypt_buffer_t) of keys with a KMS decrypt in progress in
+    /// some context, protected by mutex. Used with coalesce_kms_decrypts.
+    mc_array_t kms_inflight;
+    /// Key documents (_mongocrypt_buffer_t) added by
+    /// mongocrypt_add_key_documents and not yet taken by a context of
+    /// mongocrypt_ctx_unwrap_pending_keys_init, protected by mutex.
+    mc_array_t pending_key_docs;
+    /// Set by mongocrypt_init if opts.cache_domain is set. Its key cache and
+    /// in-flight KMS decrypts are used instead of cache_key and kms_inflight.
+    _mongocrypt_cache_domain_t *cache_domain;
+    /// Activity counters indexed by mc_counter_t. Updated atomically.
+    volatile int64_t counters[MC_COUNTER_COUNT];
+    /// Output of the last mongocrypt_get_counters call, protected by mutex.
+    _mongocrypt_buffer_t counters_bson;
+    /// KMS stats (_mongocrypt_kms_stats_t) by KMS provider and endpoint,
+    /// protected by mutex.
+    mc_array_t kms_stats;
+    /// KMS pacing state (_mongocrypt_kms_rate_limit_t) by KMS provider and
+    /// endpoint, protected by mutex.
+    mc_array_t kms_rate_limits;
+    /// Output of the last mongocrypt_get_kms_stats call, protected by mutex.
+    _mongocrypt_buffer_t kms_stats_bson;
+    /// Output of the last mongocrypt_range_estimate call, protected by mutex.
+    _mongocrypt_buffer_t range_estimate_bson;
+    /// Number and bytes of allocations made with _mongocrypt_malloc0 and not
+    /// yet freed. Updated atomically.
+    volatile int64_t live_allocations;
+    volatile int64_t live_allocation_bytes;
+    /// Output of the last mongocrypt_get_memory_usage call, protected by mutex.
+    _mongocrypt_buffer_t memory_usage_bson;
+    /* The on-demand KMS credentials last provided to a context, and when they
+     * expire. Protected by mutex. */
+    _mongocrypt_buffer_t cached_kms_credentials;
+    int64_t cached_kms_credentials_expires_us;
+    /// Set by mongocrypt_init if it acquired the secure arena.
+    bool secure_arena_acquired;
 };
 
 typedef enum {
@@ -148,8 +296,44 @@ bool _mongocrypt_validate_and_copy_string(const char *in, int32_t in_len, char *
 
 char *_mongocrypt_new_string_from_bytes(const void *in, int len);
 
+/* _mongocrypt_malloc0 returns @size zeroed bytes from the allocator of @crypt.
+ * Free them with _mongocrypt_free, passing the same @size. Outstanding
+ * allocations are reported by mongocrypt_get_memory_usage. */
+void *_mongocrypt_malloc0(mongocrypt_t *crypt, size_t size);
+
+void _mongocrypt_free(mongocrypt_t *crypt, void *ptr, size_t size);
+
+/* _mongocrypt_key_cache returns the key cache used by @crypt. */
+_mongocrypt_cache_t *_mongocrypt_key_cache(mongocrypt_t *crypt);
+
+/* _mongocrypt_counter_add atomically adds @n to @counter of @crypt. */
+void _mongocrypt_counter_add(mongocrypt_t *crypt, mc_counter_t counter, int64_t n);
+
+/* _mongocrypt_kms_stats_record records a finished KMS request to @endpoint of
+ * @kmsid in the KMS stats of @crypt. @latency_us is negative if unknown. A
+ * failed request is counted by @http_status if nonzero, else by
+ * @kmip_result_reason if nonzero, else as another error. */
+void _mongocrypt_kms_stats_record(mongocrypt_t *crypt,
+                                  const char *kmsid,
+                                  const char *endpoint,
+                                  int64_t latency_us,
+                                  bool ok,
+                                  int http_status,
+                                  uint32_t kmip_result_reason);
+
+/* _mongocrypt_kms_rate_limit_take reserves the next request to @endpoint of
+ * @kmsid under the rate limit of @crypt. Returns the microseconds to wait before
+ * sending it, or 0 if it may be sent now or no rate limit is set. */
+int64_t _mongocrypt_kms_rate_limit_take(mongocrypt_t *crypt, const char *kmsid, const char *endpoint);
+
 char *_mongocrypt_new_json_string_from_binary(mongocrypt_binary_t *binary);
 
+/* _mongocrypt_load_deferred_csfle loads crypt_shared for @crypt if loading was
+ * deferred by mongocrypt_setopt_defer_crypt_shared_load and has not been tried
+ * yet. Safe to call from multiple threads. Returns false and sets @status if
+ * the library could not be loaded from the override path. */
+bool _mongocrypt_load_deferred_csfle(mongocrypt_t *crypt, mongocrypt_status_t *status);
+
 /* _mongocrypt_needs_credentials returns true if @crypt was configured to
  * request credentials for any KMS provider. */
 bool _mongocrypt_needs_credentials(mongocrypt_t *crypt);
@@ -160,6 +344,22 @@ bool _mongocrypt_needs_credentials_for_provider(mongocrypt_t *crypt,
                                                 _mongocrypt_kms_provider_t provider,
                                                 const char *name);
 
+/* _mongocrypt_cache_kms_credentials stores @kms_providers, on-demand
+ * credentials provided to a context, for reuse by later contexts. Does nothing
+ * unless mongocrypt_setopt_kms_credentials_cache_expiration_ms was set. */
+void _mongocrypt_cache_kms_credentials(mongocrypt_t *crypt, mongocrypt_binary_t *kms_providers);
+
+/* _mongocrypt_get_cached_kms_credentials copies the cached on-demand
+ * credentials into @out. Returns false if there are none, or they expired. */
+bool _mongocrypt_get_cached_kms_credentials(mongocrypt_t *crypt, _mongocrypt_buffer_t *out);
+
+/* _mongocrypt_acquire_schema_maps sets @schema_map and
+ * @encrypted_field_config_map to references to the current maps, which may be
+ * NULL. Release them with mc_mapof_ns_to_schema_destroy. */
+void _mongocrypt_acquire_schema_maps(mongocrypt_t *crypt,
+                                     mc_mapof_ns_to_schema_t **schema_map,
+                                     mc_mapof_ns_to_schema_t **encrypted_field_config_map);
+
 /**
  * Enable/disable the use of FLE2v2 payload types for write.
  *
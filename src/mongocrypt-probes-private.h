@@ -0,0 +1,57 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOCRYPT_PROBES_PRIVATE_H
+#define MONGOCRYPT_PROBES_PRIVATE_H
+
+#include "mongocrypt-config.h"
+
+/* USDT probes of the "mongocrypt" provider, for tools like bpftrace, perf and
+ * SystemTap. A probe is a nop until a tool attaches to it. Arguments are only
+ * evaluated in builds with MONGOCRYPT_ENABLE_USDT_PROBES, so they must not
+ * have side effects.
+ *
+ * ctx__state(ctx, from, to, us)
+ *    A context was observed in state @to. It entered state @from, or was
+ *    initialized if @from is -1, @us microseconds before.
+ * cache__hit(cache, entries), cache__miss(cache, entries)
+ *    A lookup in the cache named @cache, holding @entries entries.
+ * kms__start(kmsid, req_type, msg_len)
+ *    An attempt of a KMS request of type mongocrypt_kms_request_type_t begins.
+ * kms__done(kmsid, req_type, ok, http_status, us)
+ *    An attempt of a KMS request ends after @us microseconds, or -1 if unknown.
+ *    @http_status is 0 if there was no HTTP response.
+ * encrypt__value(subtype, marking_len, ciphertext_len, ok)
+ *    A marking is replaced by a ciphertext of BSON binary subtype 6 @subtype.
+ * decrypt__value(subtype, ciphertext_len, plaintext_len, ok)
+ *    A ciphertext of subtype @subtype is decrypted.
+ */
+
+#ifdef MONGOCRYPT_ENABLE_USDT_PROBES
+#include <sys/sdt.h>
+
+#define MONGOCRYPT_PROBE2(name, a1, a2) DTRACE_PROBE2(mongocrypt, name, a1, a2)
+#define MONGOCRYPT_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(mongocrypt, name, a1, a2, a3)
+#define MONGOCRYPT_PROBE4(name, a1, a2, a3, a4) DTRACE_PROBE4(mongocrypt, name, a1, a2, a3, a4)
+#define MONGOCRYPT_PROBE5(name, a1, a2, a3, a4, a5) DTRACE_PROBE5(mongocrypt, name, a1, a2, a3, a4, a5)
+#else
+#define MONGOCRYPT_PROBE2(name, a1, a2) ((void)0)
+#define MONGOCRYPT_PROBE3(name, a1, a2, a3) ((void)0)
+#define MONGOCRYPT_PROBE4(name, a1, a2, a3, a4) ((void)0)
+#define MONGOCRYPT_PROBE5(name, a1, a2, a3, a4, a5) ((void)0)
+#endif
+
+#endif /* MONGOCRYPT_PROBES_PRIVATE_H */
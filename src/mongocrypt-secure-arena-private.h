@@ -0,0 +1,68 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOCRYPT_SECURE_ARENA_PRIVATE_H
+#define MONGOCRYPT_SECURE_ARENA_PRIVATE_H
+
+#include "mongocrypt-status-private.h"
+
+/* The secure arena holds key material in memory locked in RAM, so it is never
+ * written to swap. Memory is locked a slab at a time and split into fixed size
+ * slots, so allocating a slot only takes it from a free list. Freed slots are
+ * zeroed. A slab is zeroed, unlocked and released as a whole once the arena is
+ * no longer used and none of its slots are allocated.
+ *
+ * The arena is shared by the process. It is used for new allocations while at
+ * least one mongocrypt_t has acquired it. Each allocation is preceded by a
+ * header naming its slab, so freeing does not search the slabs. Allocating and
+ * freeing a slot take a process-wide mutex for a few instructions. */
+
+/* The usable size of a slot. Larger allocations come from the heap. */
+#define MONGOCRYPT_SECURE_SLOT_LEN 128u
+
+/* Starts using the arena for new allocations. Fails if memory cannot be locked,
+ * for example because of RLIMIT_MEMLOCK. Each successful call must be matched
+ * with _mongocrypt_secure_arena_release. */
+bool _mongocrypt_secure_arena_acquire(mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
+void _mongocrypt_secure_arena_release(void);
+
+/* Returns @len bytes. They come from the arena if it is in use, @len fits in a
+ * slot, and a slot can be locked. Otherwise they come from the heap. Free them
+ * with _mongocrypt_secure_free. */
+void *_mongocrypt_secure_malloc(size_t len);
+
+/* Zeroes and frees @len bytes returned by _mongocrypt_secure_malloc. */
+void _mongocrypt_secure_free(void *ptr, size_t len);
+
+/* Returns @len bytes of zeroed, page aligned memory locked in RAM, or NULL if
+ * it cannot be allocated or locked. Implemented per OS. */
+void *_mongocrypt_os_alloc_locked(size_t len);
+
+/* Zeroes, unlocks and frees memory from _mongocrypt_os_alloc_locked. */
+void _mongocrypt_os_free_locked(void *ptr, size_t len);
+
+#ifndef _WIN32
+/* Called in the child after fork. Reinitializes the lock of the arena, and
+ * locks its slabs again, since a child does not inherit memory locks. */
+void _mongocrypt_secure_arena_atfork_child(void);
+
+/* Locks memory from _mongocrypt_os_alloc_locked again. Returns false if it
+ * cannot be locked. */
+bool _mongocrypt_os_relock(void *ptr, size_t len);
+#endif
+
+#endif /* MONGOCRYPT_SECURE_ARENA_PRIVATE_H */
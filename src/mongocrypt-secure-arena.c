@@ -0,0 +1,218 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mlib/thread.h"
+
+#include "mongocrypt-atomic-private.h"
+#include "mongocrypt-mutex-private.h"
+#include "mongocrypt-private.h"
+#include "mongocrypt-secure-arena-private.h"
+
+/* The size of a slab. A multiple of the page size of supported platforms. */
+#define SLAB_LEN (64u * 1024u)
+/* Each allocation is preceded by a header. Keeps allocations 16 byte aligned. */
+#define HEADER_LEN 16u
+#define SLOT_STRIDE (HEADER_LEN + MONGOCRYPT_SECURE_SLOT_LEN)
+#define SLOTS_PER_SLAB (SLAB_LEN / SLOT_STRIDE)
+
+/* Slab headers are kept on the heap, so the locked memory only holds slots. */
+typedef struct _slab_t {
+    uint8_t *base;
+    uint32_t used;   /* slots currently allocated. */
+    uint32_t unused; /* index of the first slot never allocated. */
+    struct _slab_t *next;
+} _slab_t;
+
+/* The header of an allocation. Names the slab of a slot, or NULL for heap
+ * memory, so freeing does not search the slabs. */
+typedef struct {
+    _slab_t *slab;
+} _header_t;
+
+/* A free slot. The link is stored in the zeroed slot itself. */
+typedef struct _free_slot_t {
+    struct _free_slot_t *next;
+} _free_slot_t;
+
+/* The arena, protected by g_arena_mtx. users is also read atomically without
+ * the mutex, so heap allocations do not take it. */
+static struct {
+    volatile int32_t users; /* acquired references. */
+    _slab_t *slabs;
+    _free_slot_t *free_slots;
+} g_arena;
+
+static mongocrypt_mutex_t g_arena_mtx;
+static mlib_once_flag g_arena_init_flag = MLIB_ONCE_INITIALIZER;
+
+static void _init_arena(void) {
+    _mongocrypt_mutex_init(&g_arena_mtx);
+}
+
+static _header_t *_header_of(const void *ptr) {
+    return (_header_t *)((uint8_t *)ptr - HEADER_LEN);
+}
+
+static _slab_t *_slab_new(void) {
+    uint8_t *base = _mongocrypt_os_alloc_locked(SLAB_LEN);
+    if (!base) {
+        return NULL;
+    }
+    _slab_t *slab = bson_malloc0(sizeof(*slab));
+    BSON_ASSERT(slab);
+    slab->base = base;
+    slab->next = g_arena.slabs;
+    g_arena.slabs = slab;
+    return slab;
+}
+
+/* Releases the slabs without allocated slots once the arena is unused. Their
+ * free slots are dropped from the free list. Requires g_arena_mtx. */
+static void _release_empty_slabs(void) {
+    if (g_arena.users > 0) {
+        return;
+    }
+
+    _free_slot_t **link = &g_arena.free_slots;
+    while (*link) {
+        _slab_t *slab = _header_of(*link)->slab;
+        BSON_ASSERT(slab);
+        if (slab->used == 0) {
+            *link = (*link)->next;
+        } else {
+            link = &(*link)->next;
+        }
+    }
+
+    _slab_t **slab_link = &g_arena.slabs;
+    while (*slab_link) {
+        _slab_t *slab = *slab_link;
+        if (slab->used == 0) {
+            *slab_link = slab->next;
+            _mongocrypt_os_free_locked(slab->base, SLAB_LEN);
+            bson_free(slab);
+        } else {
+            slab_link = &slab->next;
+        }
+    }
+}
+
+bool _mongocrypt_secure_arena_acquire(mongocrypt_status_t *status) {
+    bool ok = true;
+
+    mlib_call_once(&g_arena_init_flag, _init_arena);
+    _mongocrypt_mutex_lock(&g_arena_mtx);
+    /* Lock the first slab now, to report if memory cannot be locked. */
+    if (!g_arena.slabs && !_slab_new()) {
+        CLIENT_ERR("unable to lock memory for key material");
+        ok = false;
+    } else {
+        _mongocrypt_atomic_int32_fetch_add(&g_arena.users, 1);
+    }
+    _mongocrypt_mutex_unlock(&g_arena_mtx);
+    return ok;
+}
+
+void _mongocrypt_secure_arena_release(void) {
+    _mongocrypt_mutex_lock(&g_arena_mtx);
+    BSON_ASSERT(g_arena.users > 0);
+    _mongocrypt_atomic_int32_fetch_add(&g_arena.users, -1);
+    _release_empty_slabs();
+    _mongocrypt_mutex_unlock(&g_arena_mtx);
+}
+
+/* Returns a slot, or NULL if the arena is not in use or no more memory can be
+ * locked. */
+static void *_slot_malloc(void) {
+    void *ptr = NULL;
+
+    _mongocrypt_mutex_lock(&g_arena_mtx);
+    if (g_arena.users > 0) {
+        if (g_arena.free_slots) {
+            ptr = g_arena.free_slots;
+            g_arena.free_slots = g_arena.free_slots->next;
+            memset(ptr, 0, sizeof(_free_slot_t));
+            _header_of(ptr)->slab->used++;
+        } else {
+            _slab_t *slab;
+            for (slab = g_arena.slabs; slab; slab = slab->next) {
+                if (slab->unused < SLOTS_PER_SLAB) {
+                    break;
+                }
+            }
+            if (!slab) {
+                slab = _slab_new();
+            }
+            if (slab) {
+                uint8_t *slot = slab->base + (size_t)slab->unused * SLOT_STRIDE;
+                ((_header_t *)slot)->slab = slab;
+                ptr = slot + HEADER_LEN;
+                slab->unused++;
+                slab->used++;
+            }
+        }
+    }
+    _mongocrypt_mutex_unlock(&g_arena_mtx);
+    return ptr;
+}
+
+void *_mongocrypt_secure_malloc(size_t len) {
+    if (len <= MONGOCRYPT_SECURE_SLOT_LEN && 0 != _mongocrypt_atomic_int32_load(&g_arena.users)) {
+        void *ptr = _slot_malloc();
+        if (ptr) {
+            return ptr;
+        }
+    }
+
+    BSON_ASSERT(len <= SIZE_MAX - HEADER_LEN);
+    uint8_t *mem = bson_malloc(HEADER_LEN + len);
+    BSON_ASSERT(mem);
+    ((_header_t *)mem)->slab = NULL;
+    return mem + HEADER_LEN;
+}
+
+void _mongocrypt_secure_free(void *ptr, size_t len) {
+    if (!ptr) {
+        return;
+    }
+
+    _slab_t *slab = _header_of(ptr)->slab;
+    if (!slab) {
+        bson_zero_free(_header_of(ptr), HEADER_LEN + len);
+        return;
+    }
+
+    /* Zero the slot before taking the lock. The header is kept. */
+    memset(ptr, 0, MONGOCRYPT_SECURE_SLOT_LEN);
+    _mongocrypt_mutex_lock(&g_arena_mtx);
+    _free_slot_t *slot = ptr;
+    BSON_ASSERT(slab->used > 0);
+    slab->used--;
+    slot->next = g_arena.free_slots;
+    g_arena.free_slots = slot;
+    _release_empty_slabs();
+    _mongocrypt_mutex_unlock(&g_arena_mtx);
+}
+
+#ifndef _WIN32
+void _mongocrypt_secure_arena_atfork_child(void) {
+    _mongocrypt_mutex_init(&g_arena_mtx);
+    for (_slab_t *slab = g_arena.slabs; slab; slab = slab->next) {
+        /* Best effort. The slab stays usable if it cannot be locked. */
+        (void)_mongocrypt_os_relock(slab->base, SLAB_LEN);
+    }
+}
+#endif
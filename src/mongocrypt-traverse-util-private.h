@@ -17,6 +17,7 @@
 #ifndef MONGOCRYPT_TRAVERSE_UTIL_H
 #define MONGOCRYPT_TRAVERSE_UTIL_H
 
+#include "mc-array-private.h"
 #include "mongocrypt-buffer-private.h"
 #include "mongocrypt-status-private.h"
 
@@ -33,6 +34,16 @@ typedef bool (*_mongocrypt_transform_callback_t)(void *ctx,
                                                  bson_value_t *out,
                                                  mongocrypt_status_t *status);
 
+/* Like _mongocrypt_transform_callback_t, but returns the replacement as its
+ * BSON type in @type_out and its value bytes in @out, which must be a valid
+ * BSON value of that type. @out is initialized and is cleaned up by the
+ * caller. */
+typedef bool (*_mongocrypt_transform_raw_callback_t)(void *ctx,
+                                                     _mongocrypt_buffer_t *in,
+                                                     bson_type_t *type_out,
+                                                     _mongocrypt_buffer_t *out,
+                                                     mongocrypt_status_t *status);
+
 bool _mongocrypt_traverse_binary_in_bson(_mongocrypt_traverse_callback_t cb,
                                          void *ctx,
                                          traversal_match_t match,
@@ -46,4 +57,69 @@ bool _mongocrypt_transform_binary_in_bson(_mongocrypt_transform_callback_t cb,
                                           bson_t *out,
                                           mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
 
+/* _mongocrypt_path_trie_t holds paths of documents and arrays by field name.
+ * The elements of an array are named by any index. */
+typedef struct _mongocrypt_path_trie_t _mongocrypt_path_trie_t;
+
+_mongocrypt_path_trie_t *_mongocrypt_path_trie_new(void);
+
+void _mongocrypt_path_trie_destroy(_mongocrypt_path_trie_t *trie);
+
+/* Returns true if @trie holds no path. */
+bool _mongocrypt_path_trie_empty(const _mongocrypt_path_trie_t *trie);
+
+/* Like _mongocrypt_traverse_binary_in_bson, and appends the uint32_t offsets,
+ * from the start of @bson, of each matching element to @binary_offsets and of
+ * each document or array enclosing a matching element to @container_offsets.
+ * Both are appended in increasing order. @cb may be NULL. If @paths is set,
+ * the paths of the documents and arrays enclosing matching elements are added
+ * to it. */
+bool _mongocrypt_traverse_binary_offsets_in_bson(_mongocrypt_traverse_callback_t cb,
+                                                 void *ctx,
+                                                 traversal_match_t match,
+                                                 const bson_t *bson,
+                                                 mc_array_t *binary_offsets,
+                                                 mc_array_t *container_offsets,
+                                                 _mongocrypt_path_trie_t *paths,
+                                                 mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
+/* Like _mongocrypt_traverse_binary_offsets_in_bson without a callback, but
+ * only enters the documents and arrays at @paths. Sets @complete to true if
+ * that found every binary of subtype 6 in @bson. Otherwise, the offsets may
+ * be missing some, and a full traversal is needed. */
+bool _mongocrypt_traverse_binary_offsets_at_paths(traversal_match_t match,
+                                                  const bson_t *bson,
+                                                  const _mongocrypt_path_trie_t *paths,
+                                                  mc_array_t *binary_offsets,
+                                                  mc_array_t *container_offsets,
+                                                  bool *complete,
+                                                  mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
+/* Calls @cb for the binary elements of @in at @binary_offsets, as returned by
+ * _mongocrypt_traverse_binary_offsets_in_bson. */
+bool _mongocrypt_traverse_binary_at_offsets(_mongocrypt_traverse_callback_t cb,
+                                            void *ctx,
+                                            const _mongocrypt_buffer_t *in,
+                                            const mc_array_t *binary_offsets,
+                                            mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
+/* Sets @out to @in with the binary elements at @binary_offsets replaced by the
+ * values returned by @cb. Only the replaced elements are visited. The bytes
+ * between them, and the value bytes returned by @cb, are copied into @out as
+ * is, and the lengths of @container_offsets are updated. The offsets must be
+ * as returned by _mongocrypt_traverse_binary_offsets_in_bson.
+ * @out must be cleaned up with _mongocrypt_buffer_cleanup. */
+bool _mongocrypt_transform_binary_at_offsets(_mongocrypt_transform_raw_callback_t cb,
+                                             void *ctx,
+                                             const _mongocrypt_buffer_t *in,
+                                             const mc_array_t *binary_offsets,
+                                             const mc_array_t *container_offsets,
+                                             _mongocrypt_buffer_t *out,
+                                             mongocrypt_status_t *status) MONGOCRYPT_WARN_UNUSED_RESULT;
+
+/* Returns false if the BSON document @in cannot contain a binary element of
+ * subtype 6. This only scans the bytes of @in, so it is much faster than a
+ * traversal. A true result does not mean a subtype 6 binary is present. */
+bool _mongocrypt_may_contain_subtype6(const _mongocrypt_buffer_t *in);
+
 #endif /* MONGOCRYPT_TRAVERSE_UTIL_H */
@@ -23,16 +23,28 @@
 #include "mongocrypt-status-private.h"
 #include "mongocrypt-traverse-util-private.h"
 
+/* The number of nesting levels traversed before frames are allocated. */
+#define TRAVERSE_INLINE_DEPTH 16
+
+/* The state of one document or array being traversed. */
 typedef struct {
-    void *ctx;
     bson_iter_t iter;
     bson_t *copy; /* implies transform */
-    char *path;   /* only enabled during tracing. */
+    bson_t child; /* the copy of this level, if nested. */
+    bool is_array;
+} _frame_t;
+
+typedef struct {
+    void *ctx;
     _mongocrypt_traverse_callback_t traverse_cb;
     _mongocrypt_transform_callback_t transform_cb;
     mongocrypt_status_t *status;
     traversal_match_t match;
-    bson_t child;
+    _frame_t inline_frames[TRAVERSE_INLINE_DEPTH];
+    /* The _frame_t * of deeper levels. A frame does not move while its child
+     * copy is open, so each is allocated separately. They are reused by later
+     * levels of the same depth. */
+    mc_array_t heap_frames;
 } _recurse_state_t;
 
 static bool _check_first_byte(uint8_t byte, traversal_match_t match) {
@@ -52,109 +64,162 @@ static bool _check_first_byte(uint8_t byte, traversal_match_t match) {
     return false;
 }
 
-static bool _recurse(_recurse_state_t *state) {
+static _frame_t *_frame_at(_recurse_state_t *state, size_t depth) {
+    if (depth < TRAVERSE_INLINE_DEPTH) {
+        return &state->inline_frames[depth];
+    }
+    depth -= TRAVERSE_INLINE_DEPTH;
+    if (depth == state->heap_frames.len) {
+        _frame_t *frame = bson_malloc0(sizeof(_frame_t));
+        BSON_ASSERT(frame);
+        _mc_array_append_val(&state->heap_frames, frame);
+    }
+    return _mc_array_index(&state->heap_frames, _frame_t *, depth);
+}
+
+/* Closes the copy of @frame in the copy of its @parent. */
+static bool _end_child(_frame_t *parent, _frame_t *frame, mongocrypt_status_t *status) {
+    if (!frame->copy) {
+        return true;
+    }
+    if (frame->is_array) {
+        bson_append_array_end(parent->copy, frame->copy);
+        return true;
+    }
+    if (!bson_append_document_end(parent->copy, frame->copy)) {
+        CLIENT_ERR("error appending document");
+        return false;
+    }
+    return true;
+}
+
+/* Traverses the document of @iter, and appends the transformed elements to
+ * @copy if it is not NULL. Nested documents and arrays are traversed with a
+ * stack of frames instead of recursing. */
+static bool _recurse(_recurse_state_t *state, const bson_iter_t *iter, bson_t *copy) {
     mongocrypt_status_t *status;
+    size_t depth = 0;
+    _frame_t *frame;
+    bool ret = false;
 
     BSON_ASSERT_PARAM(state);
+    BSON_ASSERT_PARAM(iter);
 
     status = state->status;
-    while (bson_iter_next(&state->iter)) {
-        if (BSON_ITER_HOLDS_BINARY(&state->iter)) {
+    frame = _frame_at(state, 0);
+    frame->iter = *iter;
+    frame->copy = copy;
+
+    for (;;) {
+        if (!bson_iter_next(&frame->iter)) {
+            _frame_t *parent;
+
+            if (depth == 0) {
+                ret = true;
+                break;
+            }
+            parent = _frame_at(state, depth - 1u);
+            depth--;
+            if (!_end_child(parent, frame, status)) {
+                frame = parent;
+                break;
+            }
+            frame = parent;
+            continue;
+        }
+
+        if (BSON_ITER_HOLDS_BINARY(&frame->iter)) {
             _mongocrypt_buffer_t value;
 
-            BSON_ASSERT(_mongocrypt_buffer_from_binary_iter(&value, &state->iter));
+            BSON_ASSERT(_mongocrypt_buffer_from_binary_iter(&value, &frame->iter));
 
             if (value.subtype == BSON_SUBTYPE_ENCRYPTED && value.len > 0
                 && _check_first_byte(value.data[0], state->match)) {
-                bool ret;
+                bool cb_ret;
                 /* call the right callback. */
-                if (state->copy) {
+                if (frame->copy) {
                     bson_value_t value_out;
-                    ret = state->transform_cb(state->ctx, &value, &value_out, status);
-                    if (ret) {
-                        const uint32_t key_len = bson_iter_key_len(&state->iter);
+                    cb_ret = state->transform_cb(state->ctx, &value, &value_out, status);
+                    if (cb_ret) {
+                        const uint32_t key_len = bson_iter_key_len(&frame->iter);
                         BSON_ASSERT(key_len <= INT_MAX);
-                        bson_append_value(state->copy, bson_iter_key(&state->iter), (int)key_len, &value_out);
+                        bson_append_value(frame->copy, bson_iter_key(&frame->iter), (int)key_len, &value_out);
                         bson_value_destroy(&value_out);
                     }
                 } else {
-                    ret = state->traverse_cb(state->ctx, &value, status);
+                    cb_ret = state->traverse_cb(state->ctx, &value, status);
                 }
 
-                if (!ret) {
-                    return false;
+                if (!cb_ret) {
+                    break;
                 }
                 continue;
             }
             /* fall through and copy */
         }
 
-        if (BSON_ITER_HOLDS_ARRAY(&state->iter)) {
-            _recurse_state_t child_state;
-            bool ret;
-
-            memcpy(&child_state, state, sizeof(_recurse_state_t));
-            if (!bson_iter_recurse(&state->iter, &child_state.iter)) {
-                CLIENT_ERR("error recursing into array");
-                return false;
-            }
+        if (BSON_ITER_HOLDS_ARRAY(&frame->iter) || BSON_ITER_HOLDS_DOCUMENT(&frame->iter)) {
+            _frame_t *child = _frame_at(state, depth + 1u);
 
-            if (state->copy) {
-                const uint32_t key_len = bson_iter_key_len(&state->iter);
-                BSON_ASSERT(key_len <= INT_MAX);
-                bson_append_array_begin(state->copy, bson_iter_key(&state->iter), (int)key_len, &state->child);
-                child_state.copy = &state->child;
+            child->is_array = BSON_ITER_HOLDS_ARRAY(&frame->iter);
+            child->copy = NULL;
+            if (!bson_iter_recurse(&frame->iter, &child->iter)) {
+                CLIENT_ERR("error recursing into %s", child->is_array ? "array" : "document");
+                break;
             }
-            ret = _recurse(&child_state);
 
-            if (state->copy) {
-                bson_append_array_end(state->copy, &state->child);
-            }
-            if (!ret) {
-                return false;
-            }
-            continue;
-        }
-
-        if (BSON_ITER_HOLDS_DOCUMENT(&state->iter)) {
-            _recurse_state_t child_state;
-            bool ret;
-
-            memcpy(&child_state, state, sizeof(_recurse_state_t));
-            if (!bson_iter_recurse(&state->iter, &child_state.iter)) {
-                CLIENT_ERR("error recursing into document");
-                return false;
-            }
-            /* TODO: check for errors everywhere. */
-            if (state->copy) {
-                const uint32_t key_len = bson_iter_key_len(&state->iter);
+            if (frame->copy) {
+                const uint32_t key_len = bson_iter_key_len(&frame->iter);
                 BSON_ASSERT(key_len <= INT_MAX);
-                bson_append_document_begin(state->copy, bson_iter_key(&state->iter), (int)key_len, &state->child);
-                child_state.copy = &state->child;
-            }
-
-            ret = _recurse(&child_state);
-
-            if (state->copy) {
-                if (!bson_append_document_end(state->copy, &state->child)) {
-                    CLIENT_ERR("error appending document");
-                    return false;
+                if (child->is_array) {
+                    bson_append_array_begin(frame->copy, bson_iter_key(&frame->iter), (int)key_len, &child->child);
+                } else {
+                    bson_append_document_begin(frame->copy, bson_iter_key(&frame->iter), (int)key_len, &child->child);
                 }
+                child->copy = &child->child;
             }
-
-            if (!ret) {
-                return false;
-            }
+            depth++;
+            frame = child;
             continue;
         }
 
-        if (state->copy) {
-            const uint32_t key_len = bson_iter_key_len(&state->iter);
+        if (frame->copy) {
+            const uint32_t key_len = bson_iter_key_len(&frame->iter);
             BSON_ASSERT(key_len <= INT_MAX);
-            bson_append_value(state->copy, bson_iter_key(&state->iter), (int)key_len, bson_iter_value(&state->iter));
+            bson_append_value(frame->copy, bson_iter_key(&frame->iter), (int)key_len, bson_iter_value(&frame->iter));
         }
     }
-    return true;
+
+    /* On error, close the copies left open. */
+    while (depth > 0) {
+        _frame_t *parent = _frame_at(state, depth - 1u);
+        (void)_end_child(parent, frame, status);
+        depth--;
+        frame = parent;
+    }
+    return ret;
+}
+
+static void _recurse_state_init(_recurse_state_t *state,
+                                void *ctx,
+                                _mongocrypt_traverse_callback_t traverse_cb,
+                                _mongocrypt_transform_callback_t transform_cb,
+                                traversal_match_t match,
+                                mongocrypt_status_t *status) {
+    memset(state, 0, sizeof(*state));
+    state->ctx = ctx;
+    state->traverse_cb = traverse_cb;
+    state->transform_cb = transform_cb;
+    state->match = match;
+    state->status = status;
+    _mc_array_init(&state->heap_frames, sizeof(_frame_t *));
+}
+
+static void _recurse_state_cleanup(_recurse_state_t *state) {
+    for (size_t i = 0; i < state->heap_frames.len; i++) {
+        bson_free(_mc_array_index(&state->heap_frames, _frame_t *, i));
+    }
+    _mc_array_destroy(&state->heap_frames);
 }
 
 bool _mongocrypt_transform_binary_in_bson(_mongocrypt_transform_callback_t cb,
@@ -163,10 +228,13 @@ bool _mongocrypt_transform_binary_in_bson(_mongocrypt_transform_callback_t cb,
                                           bson_iter_t *iter,
                                           bson_t *out,
                                           mongocrypt_status_t *status) {
-    _recurse_state_t starting_state =
-        {ctx, *iter, out /* copy */, NULL /* path */, NULL /* traverse callback */, cb, status, match, {0}};
+    _recurse_state_t state;
+    bool ret;
 
-    return _recurse(&starting_state);
+    _recurse_state_init(&state, ctx, NULL /* traverse callback */, cb, match, status);
+    ret = _recurse(&state, iter, out /* copy */);
+    _recurse_state_cleanup(&state);
+    return ret;
 }
 
 /*-----------------------------------------------------------------------------
@@ -187,8 +255,473 @@ bool _mongocrypt_traverse_binary_in_bson(_mongocrypt_traverse_callback_t cb,
                                          traversal_match_t match,
                                          bson_iter_t *iter,
                                          mongocrypt_status_t *status) {
-    _recurse_state_t starting_state =
-        {ctx, *iter, NULL /* copy */, NULL /* path */, cb, NULL /* transform callback */, status, match, {0}};
+    _recurse_state_t state;
+    bool ret;
+
+    _recurse_state_init(&state, ctx, cb, NULL /* transform callback */, match, status);
+    ret = _recurse(&state, iter, NULL /* copy */);
+    _recurse_state_cleanup(&state);
+    return ret;
+}
+
+/* Returns the number of possible binary elements of subtype 6 in the BSON @data
+ * of @len bytes, up to @limit. A binary element is the type byte, the key, a
+ * NUL byte, an int32 length, the subtype, and the data. Look for a 0x06 byte
+ * after a NUL byte and a length that fits in the document. memchr skips the
+ * bytes in between. Every binary of subtype 6 is counted, and rarely a few
+ * bytes that are not. */
+static uint32_t _count_subtype6_candidates(const uint8_t *data, uint32_t len, uint32_t limit) {
+    const uint32_t min_offset = 4u + 1u + 1u + 4u;
+    uint32_t offset = min_offset;
+    uint32_t count = 0;
+
+    while (offset < len && count < limit) {
+        const uint8_t *found = memchr(data + offset, BSON_SUBTYPE_ENCRYPTED, len - offset);
+        uint32_t subtype_offset;
+        uint32_t len_le;
+
+        if (!found) {
+            break;
+        }
+        subtype_offset = (uint32_t)(found - data);
+        memcpy(&len_le, found - 4, sizeof(len_le));
+        if (data[subtype_offset - 5u] == '\0' && (uint64_t)subtype_offset + 1u + BSON_UINT32_FROM_LE(len_le) < len) {
+            count++;
+        }
+        offset = subtype_offset + 1u;
+    }
+    return count;
+}
+
+struct _mongocrypt_path_trie_t {
+    /* key is the field name of a document, or NULL for the elements of an
+     * array. It is unused in the root. */
+    char *key;
+    /* children holds the _mongocrypt_path_trie_t * of the enclosed documents
+     * and arrays. There are rarely more than a few. */
+    mc_array_t children;
+};
+
+_mongocrypt_path_trie_t *_mongocrypt_path_trie_new(void) {
+    _mongocrypt_path_trie_t *trie = bson_malloc0(sizeof(*trie));
+
+    _mc_array_init(&trie->children, sizeof(_mongocrypt_path_trie_t *));
+    return trie;
+}
+
+void _mongocrypt_path_trie_destroy(_mongocrypt_path_trie_t *trie) {
+    if (!trie) {
+        return;
+    }
+    for (size_t i = 0; i < trie->children.len; i++) {
+        _mongocrypt_path_trie_destroy(_mc_array_index(&trie->children, _mongocrypt_path_trie_t *, i));
+    }
+    _mc_array_destroy(&trie->children);
+    bson_free(trie->key);
+    bson_free(trie);
+}
+
+bool _mongocrypt_path_trie_empty(const _mongocrypt_path_trie_t *trie) {
+    BSON_ASSERT_PARAM(trie);
+
+    return trie->children.len == 0;
+}
+
+/* Returns the child of @trie for @key, or NULL. */
+static _mongocrypt_path_trie_t *_path_trie_child(const _mongocrypt_path_trie_t *trie, const char *key) {
+    for (size_t i = 0; i < trie->children.len; i++) {
+        _mongocrypt_path_trie_t *child = _mc_array_index(&trie->children, _mongocrypt_path_trie_t *, i);
+
+        if (key ? (child->key && 0 == strcmp(child->key, key)) : !child->key) {
+            return child;
+        }
+    }
+    return NULL;
+}
+
+/* Adds the path of the @n_keys field names @keys, NULL for array elements. */
+static void _path_trie_add(_mongocrypt_path_trie_t *trie, const char *const *keys, size_t n_keys) {
+    for (size_t i = 0; i < n_keys; i++) {
+        _mongocrypt_path_trie_t *child = _path_trie_child(trie, keys[i]);
+
+        if (!child) {
+            child = _mongocrypt_path_trie_new();
+            child->key = keys[i] ? bson_strdup(keys[i]) : NULL;
+            _mc_array_append_val(&trie->children, child);
+        }
+        trie = child;
+    }
+}
+
+typedef struct {
+    _mongocrypt_traverse_callback_t cb;
+    void *ctx;
+    traversal_match_t match;
+    mc_array_t *binary_offsets;
+    mc_array_t *container_offsets;
+    /* path holds the offsets of the documents and arrays enclosing the current
+     * element, outermost first. Documents are rarely deeper than its inline
+     * storage. */
+    mc_small_array_t path;
+    /* The first n_recorded entries of path are in container_offsets. */
+    size_t n_recorded;
+    /* If set, the paths of the containers of matching elements are added to
+     * capture. keys then holds the const char * field name of each entry of
+     * path after the root, NULL for array elements. */
+    _mongocrypt_path_trie_t *capture;
+    mc_small_array_t keys;
+    /* The number of binary elements of subtype 6 visited. */
+    uint32_t n_subtype6;
+    mongocrypt_status_t *status;
+} _offsets_state_t;
+
+/* @base_offset is the offset of the document iterated by @iter, and @in_array
+ * is true if it is an array. If @guide is set, only the documents and arrays
+ * among its paths are entered. */
+static bool _recurse_offsets(_offsets_state_t *state,
+                             bson_iter_t *iter,
+                             uint32_t base_offset,
+                             bool in_array,
+                             const _mongocrypt_path_trie_t *guide) {
+    mongocrypt_status_t *status;
+
+    BSON_ASSERT_PARAM(state);
+    BSON_ASSERT_PARAM(iter);
+
+    status = state->status;
+    while (bson_iter_next(iter)) {
+        const uint32_t elem_offset = base_offset + bson_iter_offset(iter);
+
+        if (BSON_ITER_HOLDS_BINARY(iter)) {
+            _mongocrypt_buffer_t value;
 
-    return _recurse(&starting_state);
+            BSON_ASSERT(_mongocrypt_buffer_from_binary_iter(&value, iter));
+
+            if (value.subtype == BSON_SUBTYPE_ENCRYPTED) {
+                state->n_subtype6++;
+            }
+            if (value.subtype == BSON_SUBTYPE_ENCRYPTED && value.len > 0
+                && _check_first_byte(value.data[0], state->match)) {
+                if (state->capture && state->n_recorded < state->path.array.len) {
+                    _path_trie_add(state->capture,
+                                   (const char *const *)state->keys.array.data,
+                                   state->keys.array.len);
+                }
+                for (; state->n_recorded < state->path.array.len; state->n_recorded++) {
+                    _mc_array_append_val(state->container_offsets,
+                                         _mc_array_index(&state->path.array, uint32_t, state->n_recorded));
+                }
+                _mc_array_append_val(state->binary_offsets, elem_offset);
+
+                if (state->cb && !state->cb(state->ctx, &value, status)) {
+                    return false;
+                }
+                continue;
+            }
+        }
+
+        if (BSON_ITER_HOLDS_ARRAY(iter) || BSON_ITER_HOLDS_DOCUMENT(iter)) {
+            bson_iter_t child;
+            /* The value follows the type byte and the key. */
+            const uint32_t child_offset = elem_offset + 1u + bson_iter_key_len(iter) + 1u;
+            const char *key = in_array ? NULL : bson_iter_key(iter);
+            const _mongocrypt_path_trie_t *child_guide = NULL;
+            bool ret;
+
+            if (guide && !(child_guide = _path_trie_child(guide, key))) {
+                continue;
+            }
+
+            if (!bson_iter_recurse(iter, &child)) {
+                CLIENT_ERR("error recursing into %s", BSON_ITER_HOLDS_ARRAY(iter) ? "array" : "document");
+                return false;
+            }
+
+            _mc_array_append_val(&state->path.array, child_offset);
+            if (state->capture) {
+                _mc_array_append_val(&state->keys.array, key);
+            }
+            ret = _recurse_offsets(state, &child, child_offset, BSON_ITER_HOLDS_ARRAY(iter), child_guide);
+            state->path.array.len--;
+            if (state->capture) {
+                state->keys.array.len--;
+            }
+            if (state->n_recorded > state->path.array.len) {
+                state->n_recorded = state->path.array.len;
+            }
+            if (!ret) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool _traverse_offsets(_offsets_state_t *state,
+                              const bson_t *bson,
+                              const _mongocrypt_path_trie_t *guide,
+                              mongocrypt_status_t *status) {
+    bson_iter_t iter;
+    const uint32_t root_offset = 0;
+    bool ret;
+
+    if (!bson_iter_init(&iter, bson)) {
+        CLIENT_ERR("invalid BSON");
+        return false;
+    }
+
+    state->status = status;
+    _mc_small_array_init(&state->path, sizeof(uint32_t));
+    _mc_small_array_init(&state->keys, sizeof(const char *));
+    _mc_array_append_val(&state->path.array, root_offset);
+
+    ret = _recurse_offsets(state, &iter, root_offset, false /* in_array */, guide);
+    _mc_array_destroy(&state->path.array);
+    _mc_array_destroy(&state->keys.array);
+    return ret;
+}
+
+bool _mongocrypt_traverse_binary_offsets_in_bson(_mongocrypt_traverse_callback_t cb,
+                                                 void *ctx,
+                                                 traversal_match_t match,
+                                                 const bson_t *bson,
+                                                 mc_array_t *binary_offsets,
+                                                 mc_array_t *container_offsets,
+                                                 _mongocrypt_path_trie_t *paths,
+                                                 mongocrypt_status_t *status) {
+    _offsets_state_t state = {0};
+
+    BSON_ASSERT_PARAM(bson);
+    BSON_ASSERT_PARAM(binary_offsets);
+    BSON_ASSERT_PARAM(container_offsets);
+
+    state.cb = cb;
+    state.ctx = ctx;
+    state.match = match;
+    state.binary_offsets = binary_offsets;
+    state.container_offsets = container_offsets;
+    state.capture = paths;
+    return _traverse_offsets(&state, bson, NULL /* guide */, status);
+}
+
+bool _mongocrypt_traverse_binary_offsets_at_paths(traversal_match_t match,
+                                                  const bson_t *bson,
+                                                  const _mongocrypt_path_trie_t *paths,
+                                                  mc_array_t *binary_offsets,
+                                                  mc_array_t *container_offsets,
+                                                  bool *complete,
+                                                  mongocrypt_status_t *status) {
+    _offsets_state_t state = {0};
+
+    BSON_ASSERT_PARAM(bson);
+    BSON_ASSERT_PARAM(paths);
+    BSON_ASSERT_PARAM(binary_offsets);
+    BSON_ASSERT_PARAM(container_offsets);
+    BSON_ASSERT_PARAM(complete);
+
+    state.match = match;
+    state.binary_offsets = binary_offsets;
+    state.container_offsets = container_offsets;
+    if (!_traverse_offsets(&state, bson, paths, status)) {
+        return false;
+    }
+
+    /* Every binary of subtype 6 is a candidate of the byte scan, so if there
+     * are no more candidates than visited binaries, none was skipped. */
+    *complete = _count_subtype6_candidates(bson_get_data(bson), bson->len, state.n_subtype6 + 1u) == state.n_subtype6;
+    return true;
+}
+
+/* Sets @iter to the binary element of @in at @offset. */
+static bool _binary_iter_at_offset(const _mongocrypt_buffer_t *in,
+                                   uint32_t offset,
+                                   bson_iter_t *iter,
+                                   _mongocrypt_buffer_t *value,
+                                   mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(in);
+    BSON_ASSERT_PARAM(iter);
+    BSON_ASSERT_PARAM(value);
+
+    /* The key starts after the type byte. */
+    if (offset >= in->len - 1u) {
+        CLIENT_ERR("binary offset %" PRIu32 " out of range", offset);
+        return false;
+    }
+    const uint8_t *key = in->data + offset + 1u;
+    const uint8_t *key_end = memchr(key, 0, in->len - offset - 1u);
+
+    if (!key_end
+        || !bson_iter_init_from_data_at_offset(iter, in->data, in->len, offset, (uint32_t)(key_end - key))
+        || !BSON_ITER_HOLDS_BINARY(iter) || !_mongocrypt_buffer_from_binary_iter(value, iter)) {
+        CLIENT_ERR("expected binary at offset %" PRIu32, offset);
+        return false;
+    }
+    return true;
+}
+
+bool _mongocrypt_traverse_binary_at_offsets(_mongocrypt_traverse_callback_t cb,
+                                            void *ctx,
+                                            const _mongocrypt_buffer_t *in,
+                                            const mc_array_t *binary_offsets,
+                                            mongocrypt_status_t *status) {
+    BSON_ASSERT_PARAM(cb);
+    BSON_ASSERT_PARAM(in);
+    BSON_ASSERT_PARAM(binary_offsets);
+
+    for (size_t i = 0; i < binary_offsets->len; i++) {
+        bson_iter_t iter;
+        _mongocrypt_buffer_t value;
+
+        if (!_binary_iter_at_offset(in, _mc_array_index(binary_offsets, uint32_t, i), &iter, &value, status)) {
+            return false;
+        }
+        if (!cb(ctx, &value, status)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Returns the number of @offsets less than @bound. */
+static size_t _count_offsets_below(const mc_array_t *offsets, uint64_t bound) {
+    size_t lo = 0, hi = offsets->len;
+
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2u;
+        if (_mc_array_index(offsets, uint32_t, mid) < bound) {
+            lo = mid + 1u;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+bool _mongocrypt_transform_binary_at_offsets(_mongocrypt_transform_raw_callback_t cb,
+                                             void *ctx,
+                                             const _mongocrypt_buffer_t *in,
+                                             const mc_array_t *binary_offsets,
+                                             const mc_array_t *container_offsets,
+                                             _mongocrypt_buffer_t *out,
+                                             mongocrypt_status_t *status) {
+    const size_t n = binary_offsets->len;
+    /* types[i] and values[i] hold the replacement of the element at
+     * binary_offsets[i]. The value bytes are copied into @out once. */
+    bson_type_t *types = NULL;
+    _mongocrypt_buffer_t *values = NULL;
+    uint32_t *key_lens = NULL;
+    uint32_t *old_lens = NULL;
+    /* shift[i] is the change in length from replacing the first i elements. */
+    int64_t *shift = NULL;
+    size_t n_values = 0;
+    bool ret = false;
+
+    BSON_ASSERT_PARAM(cb);
+    BSON_ASSERT_PARAM(in);
+    BSON_ASSERT_PARAM(binary_offsets);
+    BSON_ASSERT_PARAM(container_offsets);
+    BSON_ASSERT_PARAM(out);
+
+    _mongocrypt_buffer_init(out);
+    if (n == 0) {
+        _mongocrypt_buffer_copy_to(in, out);
+        return true;
+    }
+
+    types = bson_malloc0(sizeof(bson_type_t) * n);
+    values = bson_malloc0(sizeof(_mongocrypt_buffer_t) * n);
+    key_lens = bson_malloc0(sizeof(uint32_t) * n);
+    old_lens = bson_malloc0(sizeof(uint32_t) * n);
+    shift = bson_malloc0(sizeof(int64_t) * (n + 1u));
+
+    for (size_t i = 0; i < n; i++) {
+        const uint32_t offset = _mc_array_index(binary_offsets, uint32_t, i);
+        bson_iter_t iter;
+        _mongocrypt_buffer_t value;
+
+        if (!_binary_iter_at_offset(in, offset, &iter, &value, status)) {
+            goto fail;
+        }
+        _mongocrypt_buffer_init(&values[i]);
+        n_values++;
+        if (!cb(ctx, &value, &types[i], &values[i], status)) {
+            goto fail;
+        }
+        key_lens[i] = bson_iter_key_len(&iter);
+
+        /* type byte, key, NUL, int32 length, subtype, data. */
+        old_lens[i] = 1u + key_lens[i] + 1u + 4u + 1u + value.len;
+        /* type byte, key, NUL, value. */
+        const int64_t new_len = 1 + (int64_t)key_lens[i] + 1 + (int64_t)values[i].len;
+        shift[i + 1u] = shift[i] + new_len - (int64_t)old_lens[i];
+    }
+
+    if ((int64_t)in->len + shift[n] > INT32_MAX) {
+        CLIENT_ERR("transformed document too large");
+        goto fail;
+    }
+
+    _mongocrypt_buffer_init_size(out, (uint32_t)((int64_t)in->len + shift[n]));
+    {
+        uint32_t in_pos = 0, out_pos = 0;
+
+        for (size_t i = 0; i < n; i++) {
+            const uint32_t offset = _mc_array_index(binary_offsets, uint32_t, i);
+
+            memcpy(out->data + out_pos, in->data + in_pos, offset - in_pos);
+            out_pos += offset - in_pos;
+            out->data[out_pos++] = (uint8_t)types[i];
+            /* The key and its NUL are unchanged. */
+            memcpy(out->data + out_pos, in->data + offset + 1u, key_lens[i] + 1u);
+            out_pos += key_lens[i] + 1u;
+            if (values[i].len > 0) {
+                memcpy(out->data + out_pos, values[i].data, values[i].len);
+            }
+            out_pos += values[i].len;
+            in_pos = offset + old_lens[i];
+        }
+        memcpy(out->data + out_pos, in->data + in_pos, in->len - in_pos);
+    }
+
+    /* Update the length of each document and array enclosing a replaced
+     * element. No replaced element starts at a container offset. */
+    for (size_t i = 0; i < container_offsets->len; i++) {
+        const uint32_t offset = _mc_array_index(container_offsets, uint32_t, i);
+        uint32_t len_le;
+        uint32_t len;
+
+        memcpy(&len_le, in->data + offset, sizeof(len_le));
+        len = BSON_UINT32_FROM_LE(len_le);
+
+        const size_t before = _count_offsets_below(binary_offsets, offset);
+        const size_t within = _count_offsets_below(binary_offsets, (uint64_t)offset + len);
+        len = (uint32_t)((int64_t)len + shift[within] - shift[before]);
+        len_le = BSON_UINT32_TO_LE(len);
+        memcpy(out->data + (uint32_t)((int64_t)offset + shift[before]), &len_le, sizeof(len_le));
+    }
+
+    ret = true;
+fail:
+    if (!ret) {
+        _mongocrypt_buffer_cleanup(out);
+        _mongocrypt_buffer_init(out);
+    }
+    for (size_t i = 0; i < n_values; i++) {
+        _mongocrypt_buffer_cleanup(&values[i]);
+    }
+    bson_free(types);
+    bson_free(values);
+    bson_free(key_lens);
+    bson_free(old_lens);
+    bson_free(shift);
+    return ret;
+}
+
+bool _mongocrypt_may_contain_subtype6(const _mongocrypt_buffer_t *in) {
+    BSON_ASSERT_PARAM(in);
+
+    if (!in->data) {
+        return false;
+    }
+    return _count_subtype6_candidates(in->data, in->len, 1u) > 0u;
 }
@@ -63,6 +63,10 @@ const char *mc_bson_type_to_string(bson_type_t bson_type);
  * @bson. */
 bool mc_iter_document_as_bson(const bson_iter_t *iter, bson_t *bson, mongocrypt_status_t *status);
 
+/* mc_hash_bytes returns a 32-bit FNV-1a hash of @len bytes at @data. Not
+ * suitable for cryptographic purposes. */
+uint32_t mc_hash_bytes(const void *data, size_t len);
+
 // mc_isnan is a wrapper around isnan. It avoids a conversion warning on glibc.
 bool mc_isnan(double d);
 // mc_isinf is a wrapper around isinf. It avoids a conversion warning on glibc.
@@ -150,6 +150,19 @@ bool mc_iter_document_as_bson(const bson_iter_t *iter, bson_t *bson, mongocrypt_
  * MONGOCRYPT-501. */
 MC_BEGIN_CONVERSION_IGNORE
 
+uint32_t mc_hash_bytes(const void *data, size_t len) {
+    const uint8_t *bytes = data;
+    uint32_t hash = 2166136261u;
+
+    BSON_ASSERT(data || len == 0);
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
 bool mc_isnan(double d) {
     return isnan(d);
 }
@@ -21,15 +21,27 @@
 #include <bson/bson.h>
 #include <kms_message/kms_message.h>
 
+#include "mongocrypt-atomic-private.h"
 #include "mongocrypt-binary-private.h"
 #include "mongocrypt-cache-collinfo-private.h"
 #include "mongocrypt-cache-key-private.h"
+#include "mongocrypt-cache-marking-private.h"
+#include "mongocrypt-cache-deterministic-private.h"
+#include "mongocrypt-cache-find-payload-private.h"
+#include "mongocrypt-cache-kmip-kek-private.h"
+#include "mongocrypt-cache-mincover-private.h"
+#include "mongocrypt-cache-range-opts-private.h"
+#include "mongocrypt-cache-tokens-private.h"
+#include "mongocrypt-cache-user-key-id-private.h"
 #include "mongocrypt-config.h"
 #include "mongocrypt-crypto-private.h"
+#include "mongocrypt-fork-private.h"
 #include "mongocrypt-log-private.h"
+#include "mongocrypt-marking-private.h"
 #include "mongocrypt-mutex-private.h"
 #include "mongocrypt-opts-private.h"
 #include "mongocrypt-private.h"
+#include "mongocrypt-secure-arena-private.h"
 #include "mongocrypt-status-private.h"
 #include "mongocrypt-util-private.h"
 
@@ -99,7 +111,7 @@ const char *tmp_buf(const _mongocrypt_buffer_t *buf) {
 
 static void _mongocrypt_do_init(void) {
     (void)kms_message_init();
-    _native_crypto_init();
+    /* Native crypto is initialized on first use. See _native_crypto_ensure_init. */
 }
 
 mongocrypt_t *mongocrypt_new(void) {
@@ -109,10 +121,19 @@ mongocrypt_t *mongocrypt_new(void) {
     BSON_ASSERT(crypt);
     crypt->crypto = bson_malloc0(sizeof(*crypt->crypto));
     BSON_ASSERT(crypt->crypto);
+    crypt->crypto->random_pool = _mongocrypt_random_pool_new();
 
     _mongocrypt_mutex_init(&crypt->mutex);
     _mongocrypt_cache_collinfo_init(&crypt->cache_collinfo);
     _mongocrypt_cache_key_init(&crypt->cache_key);
+    _mongocrypt_cache_mincover_init(&crypt->cache_mincover);
+    _mongocrypt_cache_marking_init(&crypt->cache_marking);
+    _mongocrypt_cache_tokens_init(&crypt->cache_tokens);
+    _mongocrypt_cache_deterministic_init(&crypt->cache_deterministic);
+    _mongocrypt_cache_find_payload_init(&crypt->cache_find_payload);
+    _mongocrypt_cache_range_opts_init(&crypt->cache_range_opts);
+    _mongocrypt_cache_kmip_kek_init(&crypt->cache_kmip_kek);
+    _mongocrypt_cache_user_key_id_init(&crypt->cache_user_key_id);
     crypt->status = mongocrypt_status_new();
     _mongocrypt_opts_init(&crypt->opts);
     _mongocrypt_log_init(&crypt->log);
@@ -120,11 +141,17 @@ mongocrypt_t *mongocrypt_new(void) {
     crypt->opts.use_fle2_v2 = true;
     crypt->ctx_counter = 1;
     crypt->cache_oauth = mc_mapof_kmsid_to_token_new();
+    _mc_array_init(&crypt->kms_inflight, sizeof(_mongocrypt_buffer_t));
+    _mc_array_init(&crypt->pending_key_docs, sizeof(_mongocrypt_buffer_t));
+    _mc_array_init(&crypt->kms_stats, sizeof(_mongocrypt_kms_stats_t));
+    _mc_array_init(&crypt->kms_rate_limits, sizeof(_mongocrypt_kms_rate_limit_t));
+    _mc_array_init(&crypt->csfle_query_analyzers, sizeof(mongo_crypt_v1_query_analyzer *));
     crypt->csfle = (_mongo_crypt_v1_vtable){.okay = false};
+    _mongocrypt_fork_register(crypt);
 
     static mlib_once_flag init_flag = MLIB_ONCE_INITIALIZER;
 
-    if (!mlib_call_once(&init_flag, _mongocrypt_do_init) || !_native_crypto_initialized) {
+    if (!mlib_call_once(&init_flag, _mongocrypt_do_init)) {
         mongocrypt_status_t *status = crypt->status;
 
         CLIENT_ERR("failed to initialize");
@@ -160,788 +187,2170 @@ bool mongocrypt_setopt_use_range_v2(mongocrypt_t *crypt) {
     return true;
 }
 
-bool mongocrypt_setopt_log_handler(mongocrypt_t *crypt, mongocrypt_log_fn_t log_fn, void *log_ctx) {
+bool mongocrypt_setopt_key_cache_refresh_ahead(mongocrypt_t *crypt, double fraction) {
     ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
-    crypt->opts.log_fn = log_fn;
-    crypt->opts.log_ctx = log_ctx;
+
+    if (!(fraction > 0 && fraction < 1)) {
+        mongocrypt_status_t *status = crypt->status;
+        CLIENT_ERR("key cache refresh-ahead fraction must be greater than 0 and less than 1");
+        return false;
+    }
+
+    crypt->opts.key_cache_refresh_ahead = fraction;
     return true;
 }
 
-bool mongocrypt_setopt_kms_provider_aws(mongocrypt_t *crypt,
-                                        const char *aws_access_key_id,
-                                        int32_t aws_access_key_id_len,
-                                        const char *aws_secret_access_key,
-                                        int32_t aws_secret_access_key_len) {
+bool mongocrypt_setopt_key_cache_max_entries(mongocrypt_t *crypt, uint32_t max_entries) {
     ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
 
-    mongocrypt_status_t *status = crypt->status;
-    _mongocrypt_opts_kms_providers_t *const kms_providers = &crypt->opts.kms_providers;
+    crypt->opts.key_cache_max_entries = max_entries;
+    return true;
+}
 
-    if (0 != (kms_providers->configured_providers & MONGOCRYPT_KMS_PROVIDER_AWS)) {
-        CLIENT_ERR("aws kms provider already set");
+bool mongocrypt_setopt_collinfo_cache_max_entries(mongocrypt_t *crypt, uint32_t max_entries) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    crypt->opts.collinfo_cache_max_entries = max_entries;
+    return true;
+}
+
+bool mongocrypt_setopt_mincover_cache_max_entries(mongocrypt_t *crypt, uint32_t max_entries) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    crypt->opts.mincover_cache_max_entries = max_entries;
+    return true;
+}
+
+bool mongocrypt_setopt_marking_cache_max_entries(mongocrypt_t *crypt, uint32_t max_entries) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    crypt->opts.marking_cache_max_entries = max_entries;
+    return true;
+}
+
+bool mongocrypt_setopt_token_cache_max_entries(mongocrypt_t *crypt, uint32_t max_entries) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    crypt->opts.token_cache_max_entries = max_entries;
+    return true;
+}
+
+bool mongocrypt_setopt_deterministic_cache_max_entries(mongocrypt_t *crypt, uint32_t max_entries) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    crypt->opts.deterministic_cache_max_entries = max_entries;
+    return true;
+}
+
+bool mongocrypt_setopt_find_payload_cache_max_entries(mongocrypt_t *crypt, uint32_t max_entries) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    crypt->opts.find_payload_cache_max_entries = max_entries;
+    return true;
+}
+
+bool mongocrypt_setopt_range_opts_cache_max_entries(mongocrypt_t *crypt, uint32_t max_entries) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    crypt->opts.range_opts_cache_max_entries = max_entries;
+    return true;
+}
+
+bool mongocrypt_setopt_unencrypted_collinfo_expiration_ms(mongocrypt_t *crypt, uint64_t expiration_ms) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    if (expiration_ms == 0 || expiration_ms > INT64_MAX) {
+        mongocrypt_status_t *status = crypt->status;
+        CLIENT_ERR("unencrypted collinfo expiration must be greater than 0 and at most INT64_MAX");
         return false;
     }
 
-    if (!_mongocrypt_validate_and_copy_string(aws_access_key_id,
-                                              aws_access_key_id_len,
-                                              &kms_providers->aws_mut.access_key_id)) {
-        CLIENT_ERR("invalid aws access key id");
+    crypt->opts.unencrypted_collinfo_expiration_ms = expiration_ms;
+    return true;
+}
+
+bool mongocrypt_setopt_collinfo_expiration_ms(mongocrypt_t *crypt, uint64_t expiration_ms) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    if (expiration_ms > INT64_MAX) {
+        mongocrypt_status_t *status = crypt->status;
+        CLIENT_ERR("collinfo expiration must be at most INT64_MAX");
         return false;
     }
 
-    if (!_mongocrypt_validate_and_copy_string(aws_secret_access_key,
-                                              aws_secret_access_key_len,
-                                              &kms_providers->aws_mut.secret_access_key)) {
-        CLIENT_ERR("invalid aws secret access key");
+    crypt->opts.collinfo_expiration_ms = expiration_ms == 0 ? (uint64_t)INT64_MAX : expiration_ms;
+    return true;
+}
+
+bool mongocrypt_setopt_kmip_kek_cache_expiration_ms(mongocrypt_t *crypt, uint64_t expiration_ms) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    if (expiration_ms > INT64_MAX) {
+        mongocrypt_status_t *status = crypt->status;
+        CLIENT_ERR("KMIP KEK cache expiration must be at most INT64_MAX");
         return false;
     }
 
-    if (crypt->log.trace_enabled) {
-        _mongocrypt_log(&crypt->log,
-                        MONGOCRYPT_LOG_LEVEL_TRACE,
-                        "%s (%s=\"%s\", %s=%d, %s=\"%s\", %s=%d)",
-                        BSON_FUNC,
-                        "aws_access_key_id",
-                        kms_providers->aws_mut.access_key_id,
-                        "aws_access_key_id_len",
-                        aws_access_key_id_len,
-                        "aws_secret_access_key",
-                        kms_providers->aws_mut.secret_access_key,
-                        "aws_secret_access_key_len",
-                        aws_secret_access_key_len);
-    }
-    kms_providers->configured_providers |= MONGOCRYPT_KMS_PROVIDER_AWS;
+    crypt->opts.kmip_kek_cache_expiration_ms = expiration_ms;
     return true;
 }
 
-char *_mongocrypt_new_string_from_bytes(const void *in, int len) {
-    const int max_bytes = 100;
-    const int chars_per_byte = 2;
-    int out_size = max_bytes * chars_per_byte;
-    const unsigned char *src = in;
-    char *out;
-    char *ret;
+bool mongocrypt_setopt_prefetch_collinfo(mongocrypt_t *crypt) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
 
-    out_size += len > max_bytes ? (int)sizeof("...") : 1 /* for null */;
-    out = bson_malloc0((size_t)out_size);
-    BSON_ASSERT(out);
+    crypt->opts.prefetch_collinfo = true;
+    return true;
+}
 
-    ret = out;
+bool mongocrypt_setopt_coalesce_kms_decrypts(mongocrypt_t *crypt) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
 
-    for (int i = 0; i < len && i < max_bytes; i++, out += chars_per_byte) {
-        sprintf(out, "%02X", src[i]);
-    }
+    crypt->opts.coalesce_kms_decrypts = true;
+    return true;
+}
 
-    sprintf(out, (len > max_bytes) ? "..." : "");
-    return ret;
+bool mongocrypt_setopt_key_cache_thread_local(mongocrypt_t *crypt) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    crypt->opts.key_cache_thread_local = true;
+    return true;
 }
 
-char *_mongocrypt_new_json_string_from_binary(mongocrypt_binary_t *binary) {
-    bson_t bson;
-    uint32_t len;
+bool mongocrypt_setopt_retry_kms(mongocrypt_t *crypt, bool enable) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
 
-    BSON_ASSERT_PARAM(binary);
+    crypt->opts.retry_kms = enable;
+    return true;
+}
 
-    if (!_mongocrypt_binary_to_bson(binary, &bson) || !bson_validate(&bson, BSON_VALIDATE_NONE, NULL)) {
-        char *hex;
-        char *full_str;
+bool mongocrypt_setopt_kms_rate_limit(mongocrypt_t *crypt, uint32_t requests_per_sec, uint32_t burst) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
 
-        BSON_ASSERT(binary->len <= (uint32_t)INT_MAX);
-        hex = _mongocrypt_new_string_from_bytes(binary->data, (int)binary->len);
-        full_str = bson_strdup_printf("(malformed) %s", hex);
-        bson_free(hex);
-        return full_str;
+    if (requests_per_sec > 1000000) {
+        mongocrypt_status_t *status = crypt->status;
+        CLIENT_ERR("KMS rate limit must be at most 1000000 requests per second");
+        return false;
     }
-    return bson_as_canonical_extended_json(&bson, (size_t *)&len);
+
+    crypt->opts.kms_rate_limit_per_sec = requests_per_sec;
+    crypt->opts.kms_rate_limit_burst = burst == 0 ? 1 : burst;
+    return true;
 }
 
-bool mongocrypt_setopt_schema_map(mongocrypt_t *crypt, mongocrypt_binary_t *schema_map) {
+bool mongocrypt_setopt_kms_keep_alive(mongocrypt_t *crypt) {
     ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
 
-    bson_t tmp;
-    bson_error_t bson_err;
-    mongocrypt_status_t *status = crypt->status;
+    crypt->opts.kms_keep_alive = true;
+    return true;
+}
 
-    if (!schema_map || !mongocrypt_binary_data(schema_map)) {
-        CLIENT_ERR("passed null schema map");
-        return false;
-    }
+bool mongocrypt_setopt_kms_large_reads(mongocrypt_t *crypt) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
 
-    if (!_mongocrypt_buffer_empty(&crypt->opts.schema_map)) {
-        CLIENT_ERR("already set schema map");
-        return false;
-    }
+    crypt->opts.kms_large_reads = true;
+    return true;
+}
 
-    _mongocrypt_buffer_copy_from_binary(&crypt->opts.schema_map, schema_map);
+bool mongocrypt_setopt_batch_kmip_requests(mongocrypt_t *crypt) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
 
-    /* validate bson */
-    if (!_mongocrypt_buffer_to_bson(&crypt->opts.schema_map, &tmp)) {
-        CLIENT_ERR("invalid bson");
-        return false;
-    }
+    crypt->opts.batch_kmip_requests = true;
+    return true;
+}
 
-    if (!bson_validate_with_error(&tmp, BSON_VALIDATE_NONE, &bson_err)) {
-        CLIENT_ERR("%s", bson_err.message);
+bool mongocrypt_setopt_oauth_refresh_margin_ms(mongocrypt_t *crypt, uint64_t margin_ms) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    if (margin_ms > INT64_MAX / 1000) {
+        mongocrypt_status_t *status = crypt->status;
+        CLIENT_ERR("oauth refresh margin must be at most INT64_MAX / 1000");
         return false;
     }
 
+    crypt->opts.oauth_refresh_margin_ms = margin_ms;
     return true;
 }
 
-bool mongocrypt_setopt_encrypted_field_config_map(mongocrypt_t *crypt, mongocrypt_binary_t *efc_map) {
+bool mongocrypt_setopt_kms_hedge(mongocrypt_t *crypt, mongocrypt_binary_t *endpoints, uint64_t hedge_after_ms) {
     ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
 
     mongocrypt_status_t *status = crypt->status;
+    _mongocrypt_endpoint_parse_opts_t parse_opts = {.allow_empty_subdomain = true};
     bson_t as_bson;
-    bson_error_t bson_err;
+    bson_iter_t iter;
 
-    if (!efc_map || !mongocrypt_binary_data(efc_map)) {
-        CLIENT_ERR("passed null encrypted_field_config_map");
+    if (!endpoints || !mongocrypt_binary_data(endpoints)) {
+        CLIENT_ERR("passed null hedge endpoints");
         return false;
     }
 
-    if (!_mongocrypt_buffer_empty(&crypt->opts.encrypted_field_config_map)) {
-        CLIENT_ERR("already set encrypted_field_config_map");
+    if (hedge_after_ms > INT64_MAX / 1000) {
+        CLIENT_ERR("hedge delay must be at most INT64_MAX / 1000");
         return false;
     }
 
-    _mongocrypt_buffer_copy_from_binary(&crypt->opts.encrypted_field_config_map, efc_map);
-
-    /* validate bson */
-    if (!_mongocrypt_buffer_to_bson(&crypt->opts.encrypted_field_config_map, &as_bson)) {
-        CLIENT_ERR("invalid bson");
+    if (!_mongocrypt_binary_to_bson(endpoints, &as_bson) || !bson_iter_init(&iter, &as_bson)) {
+        CLIENT_ERR("invalid BSON");
         return false;
     }
 
-    if (!bson_validate_with_error(&as_bson, BSON_VALIDATE_NONE, &bson_err)) {
-        CLIENT_ERR("%s", bson_err.message);
+    while (bson_iter_next(&iter)) {
+        const char *kmsid = bson_iter_key(&iter);
+        _mongocrypt_kms_provider_t type;
+        const char *name;
+        bson_iter_t array_iter;
+
+        if (!mc_kmsid_parse(kmsid, &type, &name, status)) {
+            return false;
+        }
+        if (type != MONGOCRYPT_KMS_PROVIDER_AWS && type != MONGOCRYPT_KMS_PROVIDER_KMIP) {
+            CLIENT_ERR("hedged KMS requests are only supported for aws and kmip, got: %s", kmsid);
+            return false;
+        }
+        if (!BSON_ITER_HOLDS_ARRAY(&iter) || !bson_iter_recurse(&iter, &array_iter)) {
+            CLIENT_ERR("expected array of endpoints for KMS provider `%s`", kmsid);
+            return false;
+        }
+        while (bson_iter_next(&array_iter)) {
+            _mongocrypt_endpoint_t *endpoint;
+            uint32_t len;
+            const char *str;
+
+            if (!BSON_ITER_HOLDS_UTF8(&array_iter)) {
+                CLIENT_ERR("expected string endpoint for KMS provider `%s`", kmsid);
+                return false;
+            }
+            str = bson_iter_utf8(&array_iter, &len);
+            endpoint = _mongocrypt_endpoint_new(str, (int32_t)len, &parse_opts, status);
+            if (!endpoint) {
+                return false;
+            }
+            _mongocrypt_endpoint_destroy(endpoint);
+        }
+    }
+
+    _mongocrypt_buffer_cleanup(&crypt->opts.kms_hedge_endpoints);
+    _mongocrypt_buffer_copy_from_binary(&crypt->opts.kms_hedge_endpoints, endpoints);
+    crypt->opts.kms_hedge_after_ms = hedge_after_ms;
+    return true;
+}
+
+bool mongocrypt_setopt_key_expiration(mongocrypt_t *crypt, uint64_t cache_expiration_ms) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    if (cache_expiration_ms > INT64_MAX) {
+        mongocrypt_status_t *status = crypt->status;
+        CLIENT_ERR("expiration time must be less than %" PRId64 ", but got %" PRIu64, INT64_MAX, cache_expiration_ms);
         return false;
     }
 
+    crypt->opts.key_expiration_ms = cache_expiration_ms == 0 ? (uint64_t)INT64_MAX : cache_expiration_ms;
     return true;
 }
 
-bool mongocrypt_setopt_kms_provider_local(mongocrypt_t *crypt, mongocrypt_binary_t *key) {
+bool mongocrypt_setopt_key_expiration_by_kms_provider(mongocrypt_t *crypt, mongocrypt_binary_t *expirations) {
     ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
 
     mongocrypt_status_t *status = crypt->status;
-    _mongocrypt_opts_kms_providers_t *const kms_providers = &crypt->opts.kms_providers;
+    bson_t as_bson;
+    bson_iter_t iter;
 
-    if (0 != (kms_providers->configured_providers & MONGOCRYPT_KMS_PROVIDER_LOCAL)) {
-        CLIENT_ERR("local kms provider already set");
+    if (!expirations || !mongocrypt_binary_data(expirations)) {
+        CLIENT_ERR("passed null key expirations");
         return false;
     }
-
-    if (!key) {
-        CLIENT_ERR("passed null key");
+    if (!_mongocrypt_binary_to_bson(expirations, &as_bson) || !bson_iter_init(&iter, &as_bson)) {
+        CLIENT_ERR("invalid BSON");
         return false;
     }
 
-    if (mongocrypt_binary_len(key) != MONGOCRYPT_KEY_LEN) {
-        CLIENT_ERR("local key must be %d bytes", MONGOCRYPT_KEY_LEN);
+    while (bson_iter_next(&iter)) {
+        const char *kmsid = bson_iter_key(&iter);
+        _mongocrypt_kms_provider_t type;
+        const char *name;
+
+        if (!mc_kmsid_parse(kmsid, &type, &name, status)) {
+            return false;
+        }
+        if (!BSON_ITER_HOLDS_INT(&iter) || bson_iter_as_int64(&iter) < 0) {
+            CLIENT_ERR("expected non-negative integer expiration for KMS provider `%s`", kmsid);
+            return false;
+        }
+    }
+
+    _mongocrypt_buffer_cleanup(&crypt->opts.key_expiration_by_kms_provider);
+    _mongocrypt_buffer_copy_from_binary(&crypt->opts.key_expiration_by_kms_provider, expirations);
+    return true;
+}
+
+bool mongocrypt_setopt_log_handler(mongocrypt_t *crypt, mongocrypt_log_fn_t log_fn, void *log_ctx) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+    crypt->opts.log_fn = log_fn;
+    crypt->opts.log_ctx = log_ctx;
+    return true;
+}
+
+bool mongocrypt_setopt_log_level(mongocrypt_t *crypt, mongocrypt_log_level_t level) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    if ((int)level < (int)MONGOCRYPT_LOG_LEVEL_FATAL || (int)level > (int)MONGOCRYPT_LOG_LEVEL_TRACE) {
+        mongocrypt_status_t *status = crypt->status;
+        CLIENT_ERR("invalid log level: %d", (int)level);
         return false;
     }
+    crypt->opts.log_level = level;
+    return true;
+}
 
-    if (crypt->log.trace_enabled) {
-        char *key_val;
-        BSON_ASSERT(key->len <= (uint32_t)INT_MAX);
-        key_val = _mongocrypt_new_string_from_bytes(key->data, (int)key->len);
+bool mongocrypt_setopt_trace_handler(mongocrypt_t *crypt, mongocrypt_trace_fn_t trace_fn, void *trace_ctx) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+    crypt->opts.trace_fn = trace_fn;
+    crypt->opts.trace_ctx = trace_ctx;
+    return true;
+}
 
-        _mongocrypt_log(&crypt->log, MONGOCRYPT_LOG_LEVEL_TRACE, "%s (%s=\"%s\")", BSON_FUNC, "key", key_val);
-        bson_free(key_val);
+bool mongocrypt_setopt_record_handler(mongocrypt_t *crypt, mongocrypt_record_fn_t record_fn, void *record_ctx) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+    crypt->opts.record_fn = record_fn;
+    crypt->opts.record_ctx = record_ctx;
+    return true;
+}
+
+bool mongocrypt_setopt_allocator(mongocrypt_t *crypt,
+                                 mongocrypt_malloc_fn_t malloc_fn,
+                                 mongocrypt_free_fn_t free_fn,
+                                 void *ctx) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    mongocrypt_status_t *status = crypt->status;
+
+    if (!malloc_fn || !free_fn) {
+        CLIENT_ERR("malloc_fn and free_fn are required");
+        return false;
     }
 
-    _mongocrypt_buffer_copy_from_binary(&kms_providers->local_mut.key, key);
-    kms_providers->configured_providers |= MONGOCRYPT_KMS_PROVIDER_LOCAL;
+    crypt->opts.malloc_fn = malloc_fn;
+    crypt->opts.free_fn = free_fn;
+    crypt->opts.allocator_ctx = ctx;
     return true;
 }
 
-typedef struct {
-    /// Whether the load is successful
-    bool okay;
-    /// The DLL handle to the opened library.
-    mcr_dll lib;
-    /// A vtable for the functions in the DLL
-    _mongo_crypt_v1_vtable vtable;
-} _loaded_csfle;
+void *_mongocrypt_malloc0(mongocrypt_t *crypt, size_t size) {
+    void *ptr;
 
-/**
- * @brief Attempt to open the CSFLE dynamic library and initialize a vtable for
- * it.
- *
- * @param status is an optional status to set an error message if `mcr_dll_open` fails.
- */
-static _loaded_csfle _try_load_csfle(const char *filepath, mongocrypt_status_t *status, _mongocrypt_log_t *log) {
-    // Try to open the dynamic lib
-    mcr_dll lib = mcr_dll_open(filepath);
-    // Check for errors, which are represented by strings
-    if (lib.error_string.data) {
-        // Error opening candidate
-        _mongocrypt_log(log,
-                        MONGOCRYPT_LOG_LEVEL_WARNING,
-                        "Error while opening candidate for CSFLE dynamic library [%s]: %s",
-                        filepath,
-                        lib.error_string.data);
-        CLIENT_ERR("Error while opening candidate for CSFLE dynamic library [%s]: %s", filepath, lib.error_string.data);
-        // Free resources, which will include the error string
-        mcr_dll_close(lib);
-        // Bad:
-        return (_loaded_csfle){.okay = false};
-    }
+    BSON_ASSERT_PARAM(crypt);
+    BSON_ASSERT(size <= INT64_MAX);
+
+    _mongocrypt_atomic_int64_fetch_add(&crypt->live_allocations, 1);
+    _mongocrypt_atomic_int64_fetch_add(&crypt->live_allocation_bytes, (int64_t)size);
+    if (!crypt->opts.malloc_fn) {
+        return bson_malloc0(size);
+    }
+    /* Like bson_malloc0, failing to allocate is fatal. */
+    ptr = crypt->opts.malloc_fn(size, crypt->opts.allocator_ctx);
+    BSON_ASSERT(ptr);
+    memset(ptr, 0, size);
+    return ptr;
+}
 
-    // Successfully opened DLL
-    _mongocrypt_log(log, MONGOCRYPT_LOG_LEVEL_TRACE, "Loading CSFLE dynamic library [%s]", filepath);
+void _mongocrypt_free(mongocrypt_t *crypt, void *ptr, size_t size) {
+    BSON_ASSERT_PARAM(crypt);
 
-    // Construct the library vtable
-    _mongo_crypt_v1_vtable vtable = {.okay = true};
-#define X_FUNC(Name, RetType, ...)                                                                                     \
-    {                                                                                                                  \
-        /* Symbol names are qualified by the lib name and version: */                                                  \
-        const char *symname = "mongo_crypt_v1_" #Name;                                                                 \
-        vtable.Name = mcr_dll_sym(lib, symname);                                                                       \
-        if (vtable.Name == NULL) {                                                                                     \
-            /* The requested symbol is not present */                                                                  \
-            _mongocrypt_log(log,                                                                                       \
-                            MONGOCRYPT_LOG_LEVEL_ERROR,                                                                \
-                            "Missing required symbol '%s' from CSFLE dynamic library [%s]",                            \
-                            symname,                                                                                   \
-                            filepath);                                                                                 \
-            /* Mark the vtable as broken, but keep trying to load more symbols to                                      \
-             * produce error messages for all missing symbols */                                                       \
-            vtable.okay = false;                                                                                       \
-        }                                                                                                              \
+    if (!ptr) {
+        return;
     }
-    MONGOC_CSFLE_FUNCTIONS_X
-#undef X_FUNC
-
-    if (!vtable.okay) {
-        mcr_dll_close(lib);
-        _mongocrypt_log(log,
-                        MONGOCRYPT_LOG_LEVEL_ERROR,
-                        "One or more required symbols are missing from CSFLE dynamic library "
-                        "[%s], so this dynamic library will not be used.",
-                        filepath);
-        return (_loaded_csfle){.okay = false};
+    BSON_ASSERT(size <= INT64_MAX);
+    _mongocrypt_atomic_int64_fetch_add(&crypt->live_allocations, -1);
+    _mongocrypt_atomic_int64_fetch_add(&crypt->live_allocation_bytes, -(int64_t)size);
+    if (!crypt->opts.free_fn) {
+        bson_free(ptr);
+        return;
     }
+    crypt->opts.free_fn(ptr, size, crypt->opts.allocator_ctx);
+}
 
-    // Success!
-    _mongocrypt_log(log, MONGOCRYPT_LOG_LEVEL_INFO, "Opened CSFLE dynamic library [%s]", filepath);
-    return (_loaded_csfle){.okay = true, .lib = lib, .vtable = vtable};
+void _mongocrypt_counter_add(mongocrypt_t *crypt, mc_counter_t counter, int64_t n) {
+    BSON_ASSERT_PARAM(crypt);
+    BSON_ASSERT(counter < MC_COUNTER_COUNT);
+
+    _mongocrypt_atomic_int64_fetch_add(&crypt->counters[counter], n);
 }
 
-/**
- * @brief If the leading path element in `filepath` is $ORIGIN, replace that
- * with the directory containing the current executing module.
- *
- * @return true If no error occurred and the path is valid
- * @return false If there was an error and `filepath` cannot be processed
- */
-static bool _try_replace_dollar_origin(mstr *filepath, _mongocrypt_log_t *log) {
-    const mstr_view dollar_origin = mstrv_lit("$ORIGIN");
+/* _mongocrypt_kms_latency_bounds_ms has the upper bounds of the buckets of KMS
+ * latency histograms. */
+static const int64_t _mongocrypt_kms_latency_bounds_ms[MC_KMS_LATENCY_BUCKET_COUNT - 1] =
+    {1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000};
 
-    BSON_ASSERT_PARAM(filepath);
+static void _kms_error_count_add(mc_array_t *errors, int64_t code) {
+    BSON_ASSERT_PARAM(errors);
 
-    if (!mstr_starts_with(filepath->view, dollar_origin)) {
-        // Nothing to replace
-        return true;
-    }
-    // Check that the next char is a path separator or end-of-string:
-    char peek = filepath->data[dollar_origin.len];
-    if (peek != 0 && !mpath_is_sep(peek, MPATH_NATIVE)) {
-        // Not a single path element
-        return true;
-    }
-    // Replace $ORIGIN with the directory of the current module
-    const current_module_result self_exe_r = current_module_path();
-    if (self_exe_r.error) {
-        // Failed to get the current module to load replace $ORIGIN
-        mstr error = merror_system_error_string(self_exe_r.error);
-        _mongocrypt_log(log,
-                        MONGOCRYPT_LOG_LEVEL_WARNING,
-                        "Error while loading the executable module path for "
-                        "substitution of $ORIGIN in CSFLE search path [%s]: %s",
-                        filepath->data,
-                        error.data);
-        mstr_free(error);
-        return false;
+    for (size_t i = 0; i < errors->len; i++) {
+        _mongocrypt_kms_error_count_t *error = &_mc_array_index(errors, _mongocrypt_kms_error_count_t, i);
+
+        if (error->code == code) {
+            error->count++;
+            return;
+        }
     }
-    const mstr_view self_dir = mpath_parent(self_exe_r.path.view, MPATH_NATIVE);
-    mstr_inplace_splice(filepath, 0, dollar_origin.len, self_dir);
-    mstr_free(self_exe_r.path);
-    return true;
+
+    _mongocrypt_kms_error_count_t error = {.code = code, .count = 1};
+    _mc_array_append_val(errors, error);
 }
 
-static _loaded_csfle _try_find_csfle(mongocrypt_t *crypt) {
-    _loaded_csfle candidate_csfle = {0};
-    mstr csfle_cand_filepath = MSTR_NULL;
+void _mongocrypt_kms_stats_record(mongocrypt_t *crypt,
+                                  const char *kmsid,
+                                  const char *endpoint,
+                                  int64_t latency_us,
+                                  bool ok,
+                                  int http_status,
+                                  uint32_t kmip_result_reason) {
+    _mongocrypt_kms_stats_t *kms_stats = NULL;
 
     BSON_ASSERT_PARAM(crypt);
+    BSON_ASSERT_PARAM(kmsid);
 
-    if (crypt->opts.crypt_shared_lib_override_path.data) {
-        // If an override path was specified, skip the library searching behavior
-        csfle_cand_filepath = mstr_copy(crypt->opts.crypt_shared_lib_override_path.view);
-        if (_try_replace_dollar_origin(&csfle_cand_filepath, &crypt->log)) {
-            // Succesfully substituted $ORIGIN
-            // Do not allow a plain filename to go through, as that will cause the
-            // DLL load to search the system.
-            mstr_assign(&csfle_cand_filepath, mpath_absolute(csfle_cand_filepath.view, MPATH_NATIVE));
-            candidate_csfle = _try_load_csfle(csfle_cand_filepath.data, crypt->status, &crypt->log);
-        }
-    } else {
-        // No override path was specified, so try to find it on the provided
-        // search paths.
-        for (int i = 0; i < crypt->opts.n_crypt_shared_lib_search_paths; ++i) {
-            mstr_view cand_dir = crypt->opts.crypt_shared_lib_search_paths[i].view;
-            mstr_view csfle_filename = mstrv_lit("mongo_crypt_v1" MCR_DLL_SUFFIX);
-            if (mstr_eq(cand_dir, mstrv_lit("$SYSTEM"))) {
-                // Caller wants us to search for the library on the system's default
-                // library paths. Pass only the library's filename to cause dll_open
-                // to search on the library paths.
-                mstr_assign(&csfle_cand_filepath, mstr_copy(csfle_filename));
-            } else {
-                // Compose the candidate filepath:
-                mstr_assign(&csfle_cand_filepath, mpath_join(cand_dir, csfle_filename, MPATH_NATIVE));
-                if (!_try_replace_dollar_origin(&csfle_cand_filepath, &crypt->log)) {
-                    // Error while substituting $ORIGIN
-                    continue;
-                }
-            }
-            // Try to load the file:
-            candidate_csfle = _try_load_csfle(csfle_cand_filepath.data, NULL /* status */, &crypt->log);
-            if (candidate_csfle.okay) {
-                // Stop searching:
-                break;
-            }
-        }
+    if (!endpoint) {
+        endpoint = "";
     }
 
-    mstr_free(csfle_cand_filepath);
-    return candidate_csfle;
-}
+    _mongocrypt_mutex_lock(&crypt->mutex);
+    for (size_t i = 0; i < crypt->kms_stats.len; i++) {
+        _mongocrypt_kms_stats_t *found = &_mc_array_index(&crypt->kms_stats, _mongocrypt_kms_stats_t, i);
 
-/// Global state for the application's csfle library
-typedef struct csfle_global_lib_state {
-    /// Synchronization around the reference count:
-    mongocrypt_mutex_t mtx;
-    int refcount;
-    /// The open library handle:
-    mcr_dll dll;
-    /// vtable for the APIs:
-    _mongo_crypt_v1_vtable vtable;
-    /// The global library state managed by the csfle library:
-    mongo_crypt_v1_lib *csfle_lib;
-} csfle_global_lib_state;
+        if (0 == strcmp(found->kmsid, kmsid) && 0 == strcmp(found->endpoint, endpoint)) {
+            kms_stats = found;
+            break;
+        }
+    }
+    if (!kms_stats) {
+        _mongocrypt_kms_stats_t created = {0};
 
-csfle_global_lib_state g_csfle_state;
+        created.kmsid = bson_strdup(kmsid);
+        created.endpoint = bson_strdup(endpoint);
+        _mc_array_init(&created.http_errors, sizeof(_mongocrypt_kms_error_count_t));
+        _mc_array_init(&created.kmip_errors, sizeof(_mongocrypt_kms_error_count_t));
+        _mc_array_append_val(&crypt->kms_stats, created);
+        kms_stats = &_mc_array_index(&crypt->kms_stats, _mongocrypt_kms_stats_t, crypt->kms_stats.len - 1u);
+    }
 
-static void init_csfle_state(void) {
-    _mongocrypt_mutex_init(&g_csfle_state.mtx);
-}
+    kms_stats->requests++;
+    if (latency_us >= 0) {
+        size_t bucket = 0;
 
-mlib_once_flag g_csfle_init_flag = MLIB_ONCE_INITIALIZER;
+        while (bucket < MC_KMS_LATENCY_BUCKET_COUNT - 1
+               && latency_us > _mongocrypt_kms_latency_bounds_ms[bucket] * 1000) {
+            bucket++;
+        }
+        kms_stats->latency_buckets[bucket]++;
+        kms_stats->total_us += latency_us;
+    }
+    if (!ok) {
+        if (http_status != 0) {
+            _kms_error_count_add(&kms_stats->http_errors, http_status);
+        } else if (kmip_result_reason != 0) {
+            _kms_error_count_add(&kms_stats->kmip_errors, kmip_result_reason);
+        } else {
+            kms_stats->other_errors++;
+        }
+    }
+    _mongocrypt_mutex_unlock(&crypt->mutex);
+}
 
-/**
- * @brief Verify that `found` refers to the same library that is globally loaded
- * for the application.
- *
- * @param crypt The requesting mongocrypt_t. Error information may be set
- * through here.
- * @param found The result of _try_load_csfle()
- * @return true If `found` matches the global state
- * @return false Otherwise
- *
- * @note This function assumes that the global csfle state is valid and will not
- * be destroyed by any other thread. (One must hold the reference count >= 1)
- */
-static bool _validate_csfle_singleton(mongocrypt_t *crypt, _loaded_csfle found) {
-    mongocrypt_status_t *status;
+int64_t _mongocrypt_kms_rate_limit_take(mongocrypt_t *crypt, const char *kmsid, const char *endpoint) {
+    _mongocrypt_kms_rate_limit_t *rate_limit = NULL;
+    int64_t interval_us;
+    int64_t now_us;
+    int64_t wait_us;
 
     BSON_ASSERT_PARAM(crypt);
+    BSON_ASSERT_PARAM(kmsid);
 
-    if (!mcr_dll_path_supported()) {
-        _mongocrypt_log(&crypt->log,
-                        MONGOCRYPT_LOG_LEVEL_WARNING,
-                        "Cannot get path of loaded library on this platform. Skipping validation to ensure "
-                        "exactly one csfle library is loaded.");
-        return true;
+    if (crypt->opts.kms_rate_limit_per_sec == 0) {
+        return 0;
+    }
+    if (!endpoint) {
+        endpoint = "";
     }
 
-    status = crypt->status;
+    /* Each request reserves the next slot of interval_us. A request may be
+     * sent up to burst - 1 slots ahead of its own. */
+    interval_us = 1000000 / (int64_t)crypt->opts.kms_rate_limit_per_sec;
+    now_us = bson_get_monotonic_time();
+    _mongocrypt_mutex_lock(&crypt->mutex);
+    for (size_t i = 0; i < crypt->kms_rate_limits.len; i++) {
+        _mongocrypt_kms_rate_limit_t *found =
+            &_mc_array_index(&crypt->kms_rate_limits, _mongocrypt_kms_rate_limit_t, i);
 
-    // Path to the existing loaded csfle:
-    mcr_dll_path_result existing_path_ = mcr_dll_path(g_csfle_state.dll);
-    assert(existing_path_.path.data && "Failed to get path to already-loaded csfle library");
-    mstr_view existing_path = existing_path_.path.view;
-    bool okay = true;
-    if (!found.okay) {
-        // There is one loaded, but we failed to find that same library. Error:
-        CLIENT_ERR("An existing CSFLE library is loaded by the application at "
-                   "[%s], but the current call to mongocrypt_init() failed to "
-                   "find that same library.",
-                   existing_path.data);
-        okay = false;
-    } else {
-        // Get the path to what we found:
-        mcr_dll_path_result found_path = mcr_dll_path(found.lib);
-        assert(found_path.path.data
-               && "Failed to get the dynamic library filepath of the library that "
-                  "was loaded for csfle");
-        if (!mstr_eq(found_path.path.view, existing_path)) {
-            // Our find-result should only ever find the existing same library.
-            // Error:
-            CLIENT_ERR("An existing CSFLE library is loaded by the application at [%s], "
-                       "but the current call to mongocrypt_init() attempted to load a "
-                       "second CSFLE library from [%s]. This is not allowed.",
-                       existing_path.data,
-                       found_path.path.data);
-            okay = false;
+        if (0 == strcmp(found->kmsid, kmsid) && 0 == strcmp(found->endpoint, endpoint)) {
+            rate_limit = found;
+            break;
         }
-        mstr_free(found_path.path);
-        mstr_free(found_path.error_string);
     }
+    if (!rate_limit) {
+        _mongocrypt_kms_rate_limit_t created = {0};
 
-    mstr_free(existing_path_.path);
-    mstr_free(existing_path_.error_string);
-    return okay;
+        created.kmsid = bson_strdup(kmsid);
+        created.endpoint = bson_strdup(endpoint);
+        created.next_us = now_us;
+        _mc_array_append_val(&crypt->kms_rate_limits, created);
+        rate_limit =
+            &_mc_array_index(&crypt->kms_rate_limits, _mongocrypt_kms_rate_limit_t, crypt->kms_rate_limits.len - 1u);
+    }
+
+    if (rate_limit->next_us < now_us) {
+        rate_limit->next_us = now_us;
+    }
+    wait_us = rate_limit->next_us - interval_us * ((int64_t)crypt->opts.kms_rate_limit_burst - 1) - now_us;
+    rate_limit->next_us += interval_us;
+    _mongocrypt_mutex_unlock(&crypt->mutex);
+    return wait_us > 0 ? wait_us : 0;
 }
 
-/**
- * @brief Drop a reference count to the global csfle loaded library.
- *
- * This should be called as part of mongocrypt_t destruction following a
- * successful loading of csfle.
- */
-static void _csfle_drop_global_ref(void) {
-    mlib_call_once(&g_csfle_init_flag, init_csfle_state);
+bool mongocrypt_setopt_kms_provider_aws(mongocrypt_t *crypt,
+                                        const char *aws_access_key_id,
+                                        int32_t aws_access_key_id_len,
+                                        const char *aws_secret_access_key,
+                                        int32_t aws_secret_access_key_len) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
 
-    MONGOCRYPT_WITH_MUTEX(g_csfle_state.mtx) {
-        assert(g_csfle_state.refcount > 0);
-        int new_rc = --g_csfle_state.refcount;
-        if (new_rc == 0) {
-            mongo_crypt_v1_status *status = g_csfle_state.vtable.status_create();
-            const int destroy_rc = g_csfle_state.vtable.lib_destroy(g_csfle_state.csfle_lib, status);
-            if (destroy_rc != MONGO_CRYPT_V1_SUCCESS && status) {
-                fprintf(stderr,
-                        "csfle lib_destroy() failed: %s [Error %d, code %d]\n",
-                        g_csfle_state.vtable.status_get_explanation(status),
-                        g_csfle_state.vtable.status_get_error(status),
-                        g_csfle_state.vtable.status_get_code(status));
+    mongocrypt_status_t *status = crypt->status;
+    _mongocrypt_opts_kms_providers_t *const kms_providers = &crypt->opts.kms_providers;
+
+    if (0 != (kms_providers->configured_providers & MONGOCRYPT_KMS_PROVIDER_AWS)) {
+        CLIENT_ERR("aws kms provider already set");
+        return false;
+    }
+
+    if (!_mongocrypt_validate_and_copy_string(aws_access_key_id,
+                                              aws_access_key_id_len,
+                                              &kms_providers->aws_mut.access_key_id)) {
+        CLIENT_ERR("invalid aws access key id");
+        return false;
+    }
+
+    if (!_mongocrypt_validate_and_copy_string(aws_secret_access_key,
+                                              aws_secret_access_key_len,
+                                              &kms_providers->aws_mut.secret_access_key)) {
+        CLIENT_ERR("invalid aws secret access key");
+        return false;
+    }
+
+    if (crypt->log.trace_enabled) {
+        _mongocrypt_log(&crypt->log,
+                        MONGOCRYPT_LOG_LEVEL_TRACE,
+                        "%s (%s=\"%s\", %s=%d, %s=\"%s\", %s=%d)",
+                        BSON_FUNC,
+                        "aws_access_key_id",
+                        kms_providers->aws_mut.access_key_id,
+                        "aws_access_key_id_len",
+                        aws_access_key_id_len,
+                        "aws_secret_access_key",
+                        kms_providers->aws_mut.secret_access_key,
+                        "aws_secret_access_key_len",
+                        aws_secret_access_key_len);
+    }
+    kms_providers->configured_providers |= MONGOCRYPT_KMS_PROVIDER_AWS;
+    return true;
+}
+
+char *_mongocrypt_new_string_from_bytes(const void *in, int len) {
+    const int max_bytes = 100;
+    const int chars_per_byte = 2;
+    int out_size = max_bytes * chars_per_byte;
+    const unsigned char *src = in;
+    char *out;
+    char *ret;
+
+    out_size += len > max_bytes ? (int)sizeof("...") : 1 /* for null */;
+    out = bson_malloc0((size_t)out_size);
+    BSON_ASSERT(out);
+
+    ret = out;
+
+    for (int i = 0; i < len && i < max_bytes; i++, out += chars_per_byte) {
+        sprintf(out, "%02X", src[i]);
+    }
+
+    sprintf(out, (len > max_bytes) ? "..." : "");
+    return ret;
+}
+
+char *_mongocrypt_new_json_string_from_binary(mongocrypt_binary_t *binary) {
+    bson_t bson;
+    uint32_t len;
+
+    BSON_ASSERT_PARAM(binary);
+
+    if (!_mongocrypt_binary_to_bson(binary, &bson) || !bson_validate(&bson, BSON_VALIDATE_NONE, NULL)) {
+        char *hex;
+        char *full_str;
+
+        BSON_ASSERT(binary->len <= (uint32_t)INT_MAX);
+        hex = _mongocrypt_new_string_from_bytes(binary->data, (int)binary->len);
+        full_str = bson_strdup_printf("(malformed) %s", hex);
+        bson_free(hex);
+        return full_str;
+    }
+    return bson_as_canonical_extended_json(&bson, (size_t *)&len);
+}
+
+bool mongocrypt_setopt_schema_map(mongocrypt_t *crypt, mongocrypt_binary_t *schema_map) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    bson_t tmp;
+    bson_error_t bson_err;
+    mongocrypt_status_t *status = crypt->status;
+
+    if (!schema_map || !mongocrypt_binary_data(schema_map)) {
+        CLIENT_ERR("passed null schema map");
+        return false;
+    }
+
+    if (!_mongocrypt_buffer_empty(&crypt->opts.schema_map)) {
+        CLIENT_ERR("already set schema map");
+        return false;
+    }
+
+    _mongocrypt_buffer_copy_from_binary(&crypt->opts.schema_map, schema_map);
+
+    /* validate bson */
+    if (!_mongocrypt_buffer_to_bson(&crypt->opts.schema_map, &tmp)) {
+        CLIENT_ERR("invalid bson");
+        return false;
+    }
+
+    if (!bson_validate_with_error(&tmp, BSON_VALIDATE_NONE, &bson_err)) {
+        CLIENT_ERR("%s", bson_err.message);
+        return false;
+    }
+
+    return true;
+}
+
+bool mongocrypt_setopt_encrypted_field_config_map(mongocrypt_t *crypt, mongocrypt_binary_t *efc_map) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    mongocrypt_status_t *status = crypt->status;
+    bson_t as_bson;
+    bson_error_t bson_err;
+
+    if (!efc_map || !mongocrypt_binary_data(efc_map)) {
+        CLIENT_ERR("passed null encrypted_field_config_map");
+        return false;
+    }
+
+    if (!_mongocrypt_buffer_empty(&crypt->opts.encrypted_field_config_map)) {
+        CLIENT_ERR("already set encrypted_field_config_map");
+        return false;
+    }
+
+    _mongocrypt_buffer_copy_from_binary(&crypt->opts.encrypted_field_config_map, efc_map);
+
+    /* validate bson */
+    if (!_mongocrypt_buffer_to_bson(&crypt->opts.encrypted_field_config_map, &as_bson)) {
+        CLIENT_ERR("invalid bson");
+        return false;
+    }
+
+    if (!bson_validate_with_error(&as_bson, BSON_VALIDATE_NONE, &bson_err)) {
+        CLIENT_ERR("%s", bson_err.message);
+        return false;
+    }
+
+    return true;
+}
+
+bool mongocrypt_setopt_key_vault_snapshot(mongocrypt_t *crypt, mongocrypt_binary_t *key_docs) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    mongocrypt_status_t *status = crypt->status;
+
+    if (!key_docs || !mongocrypt_binary_data(key_docs)) {
+        CLIENT_ERR("passed null key vault snapshot");
+        return false;
+    }
+
+    if (!_mongocrypt_buffer_empty(&crypt->opts.key_vault_snapshot)) {
+        CLIENT_ERR("already set key vault snapshot");
+        return false;
+    }
+
+    /* The documents are validated when indexed by mongocrypt_init. */
+    _mongocrypt_buffer_copy_from_binary(&crypt->opts.key_vault_snapshot, key_docs);
+    return true;
+}
+
+bool mongocrypt_setopt_kms_provider_local(mongocrypt_t *crypt, mongocrypt_binary_t *key) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    mongocrypt_status_t *status = crypt->status;
+    _mongocrypt_opts_kms_providers_t *const kms_providers = &crypt->opts.kms_providers;
+
+    if (0 != (kms_providers->configured_providers & MONGOCRYPT_KMS_PROVIDER_LOCAL)) {
+        CLIENT_ERR("local kms provider already set");
+        return false;
+    }
+
+    if (!key) {
+        CLIENT_ERR("passed null key");
+        return false;
+    }
+
+    if (mongocrypt_binary_len(key) != MONGOCRYPT_KEY_LEN) {
+        CLIENT_ERR("local key must be %d bytes", MONGOCRYPT_KEY_LEN);
+        return false;
+    }
+
+    if (crypt->log.trace_enabled) {
+        char *key_val;
+        BSON_ASSERT(key->len <= (uint32_t)INT_MAX);
+        key_val = _mongocrypt_new_string_from_bytes(key->data, (int)key->len);
+
+        _mongocrypt_log(&crypt->log, MONGOCRYPT_LOG_LEVEL_TRACE, "%s (%s=\"%s\")", BSON_FUNC, "key", key_val);
+        bson_free(key_val);
+    }
+
+    _mongocrypt_buffer_copy_from_binary(&kms_providers->local_mut.key, key);
+    kms_providers->configured_providers |= MONGOCRYPT_KMS_PROVIDER_LOCAL;
+    return true;
+}
+
+typedef struct {
+    /// Whether the load is successful
+    bool okay;
+    /// The DLL handle to the opened library.
+    mcr_dll lib;
+    /// A vtable for the functions in the DLL
+    _mongo_crypt_v1_vtable vtable;
+} _loaded_csfle;
+
+/**
+ * @brief Attempt to open the CSFLE dynamic library and initialize a vtable for
+ * it.
+ *
+ * @param status is an optional status to set an error message if `mcr_dll_open` fails.
+ */
+static _loaded_csfle _try_load_csfle(const char *filepath, mongocrypt_status_t *status, _mongocrypt_log_t *log) {
+    // Try to open the dynamic lib
+    mcr_dll lib = mcr_dll_open(filepath);
+    // Check for errors, which are represented by strings
+    if (lib.error_string.data) {
+        // Error opening candidate
+        _mongocrypt_log(log,
+                        MONGOCRYPT_LOG_LEVEL_WARNING,
+                        "Error while opening candidate for CSFLE dynamic library [%s]: %s",
+                        filepath,
+                        lib.error_string.data);
+        CLIENT_ERR("Error while opening candidate for CSFLE dynamic library [%s]: %s", filepath, lib.error_string.data);
+        // Free resources, which will include the error string
+        mcr_dll_close(lib);
+        // Bad:
+        return (_loaded_csfle){.okay = false};
+    }
+
+    // Successfully opened DLL
+    _mongocrypt_log(log, MONGOCRYPT_LOG_LEVEL_TRACE, "Loading CSFLE dynamic library [%s]", filepath);
+
+    // Construct the library vtable
+    _mongo_crypt_v1_vtable vtable = {.okay = true};
+#define X_FUNC(Name, RetType, ...)                                                                                     \
+    {                                                                                                                  \
+        /* Symbol names are qualified by the lib name and version: */                                                  \
+        const char *symname = "mongo_crypt_v1_" #Name;                                                                 \
+        vtable.Name = mcr_dll_sym(lib, symname);                                                                       \
+        if (vtable.Name == NULL) {                                                                                     \
+            /* The requested symbol is not present */                                                                  \
+            _mongocrypt_log(log,                                                                                       \
+                            MONGOCRYPT_LOG_LEVEL_ERROR,                                                                \
+                            "Missing required symbol '%s' from CSFLE dynamic library [%s]",                            \
+                            symname,                                                                                   \
+                            filepath);                                                                                 \
+            /* Mark the vtable as broken, but keep trying to load more symbols to                                      \
+             * produce error messages for all missing symbols */                                                       \
+            vtable.okay = false;                                                                                       \
+        }                                                                                                              \
+    }
+    MONGOC_CSFLE_FUNCTIONS_X
+#undef X_FUNC
+
+    if (!vtable.okay) {
+        mcr_dll_close(lib);
+        _mongocrypt_log(log,
+                        MONGOCRYPT_LOG_LEVEL_ERROR,
+                        "One or more required symbols are missing from CSFLE dynamic library "
+                        "[%s], so this dynamic library will not be used.",
+                        filepath);
+        return (_loaded_csfle){.okay = false};
+    }
+
+    // Success!
+    _mongocrypt_log(log, MONGOCRYPT_LOG_LEVEL_INFO, "Opened CSFLE dynamic library [%s]", filepath);
+    return (_loaded_csfle){.okay = true, .lib = lib, .vtable = vtable};
+}
+
+/**
+ * @brief If the leading path element in `filepath` is $ORIGIN, replace that
+ * with the directory containing the current executing module.
+ *
+ * @return true If no error occurred and the path is valid
+ * @return false If there was an error and `filepath` cannot be processed
+ */
+static bool _try_replace_dollar_origin(mstr *filepath, _mongocrypt_log_t *log) {
+    const mstr_view dollar_origin = mstrv_lit("$ORIGIN");
+
+    BSON_ASSERT_PARAM(filepath);
+
+    if (!mstr_starts_with(filepath->view, dollar_origin)) {
+        // Nothing to replace
+        return true;
+    }
+    // Check that the next char is a path separator or end-of-string:
+    char peek = filepath->data[dollar_origin.len];
+    if (peek != 0 && !mpath_is_sep(peek, MPATH_NATIVE)) {
+        // Not a single path element
+        return true;
+    }
+    // Replace $ORIGIN with the directory of the current module
+    const current_module_result self_exe_r = current_module_path();
+    if (self_exe_r.error) {
+        // Failed to get the current module to load replace $ORIGIN
+        mstr error = merror_system_error_string(self_exe_r.error);
+        _mongocrypt_log(log,
+                        MONGOCRYPT_LOG_LEVEL_WARNING,
+                        "Error while loading the executable module path for "
+                        "substitution of $ORIGIN in CSFLE search path [%s]: %s",
+                        filepath->data,
+                        error.data);
+        mstr_free(error);
+        return false;
+    }
+    const mstr_view self_dir = mpath_parent(self_exe_r.path.view, MPATH_NATIVE);
+    mstr_inplace_splice(filepath, 0, dollar_origin.len, self_dir);
+    mstr_free(self_exe_r.path);
+    return true;
+}
+
+static _loaded_csfle _try_find_csfle(mongocrypt_t *crypt) {
+    _loaded_csfle candidate_csfle = {0};
+    mstr csfle_cand_filepath = MSTR_NULL;
+
+    BSON_ASSERT_PARAM(crypt);
+
+    if (crypt->opts.crypt_shared_lib_override_path.data) {
+        // If an override path was specified, skip the library searching behavior
+        csfle_cand_filepath = mstr_copy(crypt->opts.crypt_shared_lib_override_path.view);
+        if (_try_replace_dollar_origin(&csfle_cand_filepath, &crypt->log)) {
+            // Succesfully substituted $ORIGIN
+            // Do not allow a plain filename to go through, as that will cause the
+            // DLL load to search the system.
+            mstr_assign(&csfle_cand_filepath, mpath_absolute(csfle_cand_filepath.view, MPATH_NATIVE));
+            candidate_csfle = _try_load_csfle(csfle_cand_filepath.data, crypt->status, &crypt->log);
+        }
+    } else {
+        // No override path was specified, so try to find it on the provided
+        // search paths.
+        for (int i = 0; i < crypt->opts.n_crypt_shared_lib_search_paths; ++i) {
+            mstr_view cand_dir = crypt->opts.crypt_shared_lib_search_paths[i].view;
+            mstr_view csfle_filename = mstrv_lit("mongo_crypt_v1" MCR_DLL_SUFFIX);
+            if (mstr_eq(cand_dir, mstrv_lit("$SYSTEM"))) {
+                // Caller wants us to search for the library on the system's default
+                // library paths. Pass only the library's filename to cause dll_open
+                // to search on the library paths.
+                mstr_assign(&csfle_cand_filepath, mstr_copy(csfle_filename));
+            } else {
+                // Compose the candidate filepath:
+                mstr_assign(&csfle_cand_filepath, mpath_join(cand_dir, csfle_filename, MPATH_NATIVE));
+                if (!_try_replace_dollar_origin(&csfle_cand_filepath, &crypt->log)) {
+                    // Error while substituting $ORIGIN
+                    continue;
+                }
+            }
+            // Try to load the file:
+            candidate_csfle = _try_load_csfle(csfle_cand_filepath.data, NULL /* status */, &crypt->log);
+            if (candidate_csfle.okay) {
+                // Stop searching:
+                break;
+            }
+        }
+    }
+
+    mstr_free(csfle_cand_filepath);
+    return candidate_csfle;
+}
+
+/// Global state for the application's csfle library
+typedef struct csfle_global_lib_state {
+    /// Synchronization around the reference count:
+    mongocrypt_mutex_t mtx;
+    int refcount;
+    /// The open library handle:
+    mcr_dll dll;
+    /// vtable for the APIs:
+    _mongo_crypt_v1_vtable vtable;
+    /// The global library state managed by the csfle library:
+    mongo_crypt_v1_lib *csfle_lib;
+} csfle_global_lib_state;
+
+csfle_global_lib_state g_csfle_state;
+
+static void init_csfle_state(void) {
+    _mongocrypt_mutex_init(&g_csfle_state.mtx);
+}
+
+mlib_once_flag g_csfle_init_flag = MLIB_ONCE_INITIALIZER;
+
+#ifndef _WIN32
+void _mongocrypt_csfle_atfork_child(void) {
+    _mongocrypt_mutex_init(&g_csfle_state.mtx);
+}
+
+void _mongocrypt_atfork_child(mongocrypt_t *crypt) {
+    BSON_ASSERT_PARAM(crypt);
+
+    _mongocrypt_mutex_init(&crypt->mutex);
+    _mongocrypt_mutex_init(&crypt->log.mutex);
+    _mongocrypt_cache_atfork_child(&crypt->cache_collinfo);
+    _mongocrypt_cache_atfork_child(&crypt->cache_key);
+    _mongocrypt_cache_atfork_child(&crypt->cache_mincover);
+    _mongocrypt_cache_atfork_child(&crypt->cache_marking);
+    _mongocrypt_cache_atfork_child(&crypt->cache_tokens);
+    _mongocrypt_cache_atfork_child(&crypt->cache_deterministic);
+    _mongocrypt_cache_atfork_child(&crypt->cache_find_payload);
+    _mongocrypt_cache_atfork_child(&crypt->cache_range_opts);
+    _mongocrypt_cache_atfork_child(&crypt->cache_kmip_kek);
+    _mongocrypt_cache_atfork_child(&crypt->cache_user_key_id);
+    if (crypt->cache_oauth) {
+        mc_mapof_kmsid_to_token_atfork_child(crypt->cache_oauth);
+    }
+    /* The contexts decrypting these keys are in the parent. */
+    for (size_t i = 0; i < crypt->kms_inflight.len; i++) {
+        _mongocrypt_buffer_cleanup(&_mc_array_index(&crypt->kms_inflight, _mongocrypt_buffer_t, i));
+    }
+    _mc_array_clear(&crypt->kms_inflight);
+    _mongocrypt_random_pool_atfork_child(crypt->crypto->random_pool);
+}
+#endif
+
+/**
+ * @brief Verify that `found` refers to the same library that is globally loaded
+ * for the application.
+ *
+ * @param crypt The requesting mongocrypt_t. Error information may be set
+ * through here.
+ * @param found The result of _try_load_csfle()
+ * @return true If `found` matches the global state
+ * @return false Otherwise
+ *
+ * @note This function assumes that the global csfle state is valid and will not
+ * be destroyed by any other thread. (One must hold the reference count >= 1)
+ */
+static bool _validate_csfle_singleton(mongocrypt_t *crypt, _loaded_csfle found) {
+    mongocrypt_status_t *status;
+
+    BSON_ASSERT_PARAM(crypt);
+
+    if (!mcr_dll_path_supported()) {
+        _mongocrypt_log(&crypt->log,
+                        MONGOCRYPT_LOG_LEVEL_WARNING,
+                        "Cannot get path of loaded library on this platform. Skipping validation to ensure "
+                        "exactly one csfle library is loaded.");
+        return true;
+    }
+
+    status = crypt->status;
+
+    // Path to the existing loaded csfle:
+    mcr_dll_path_result existing_path_ = mcr_dll_path(g_csfle_state.dll);
+    assert(existing_path_.path.data && "Failed to get path to already-loaded csfle library");
+    mstr_view existing_path = existing_path_.path.view;
+    bool okay = true;
+    if (!found.okay) {
+        // There is one loaded, but we failed to find that same library. Error:
+        CLIENT_ERR("An existing CSFLE library is loaded by the application at "
+                   "[%s], but the current call to mongocrypt_init() failed to "
+                   "find that same library.",
+                   existing_path.data);
+        okay = false;
+    } else {
+        // Get the path to what we found:
+        mcr_dll_path_result found_path = mcr_dll_path(found.lib);
+        assert(found_path.path.data
+               && "Failed to get the dynamic library filepath of the library that "
+                  "was loaded for csfle");
+        if (!mstr_eq(found_path.path.view, existing_path)) {
+            // Our find-result should only ever find the existing same library.
+            // Error:
+            CLIENT_ERR("An existing CSFLE library is loaded by the application at [%s], "
+                       "but the current call to mongocrypt_init() attempted to load a "
+                       "second CSFLE library from [%s]. This is not allowed.",
+                       existing_path.data,
+                       found_path.path.data);
+            okay = false;
+        }
+        mstr_free(found_path.path);
+        mstr_free(found_path.error_string);
+    }
+
+    mstr_free(existing_path_.path);
+    mstr_free(existing_path_.error_string);
+    return okay;
+}
+
+/**
+ * @brief Drop a reference count to the global csfle loaded library.
+ *
+ * This should be called as part of mongocrypt_t destruction following a
+ * successful loading of csfle.
+ */
+static void _csfle_drop_global_ref(void) {
+    mlib_call_once(&g_csfle_init_flag, init_csfle_state);
+
+    MONGOCRYPT_WITH_MUTEX(g_csfle_state.mtx) {
+        assert(g_csfle_state.refcount > 0);
+        int new_rc = --g_csfle_state.refcount;
+        if (new_rc == 0) {
+            mongo_crypt_v1_status *status = g_csfle_state.vtable.status_create();
+            const int destroy_rc = g_csfle_state.vtable.lib_destroy(g_csfle_state.csfle_lib, status);
+            if (destroy_rc != MONGO_CRYPT_V1_SUCCESS && status) {
+                fprintf(stderr,
+                        "csfle lib_destroy() failed: %s [Error %d, code %d]\n",
+                        g_csfle_state.vtable.status_get_explanation(status),
+                        g_csfle_state.vtable.status_get_error(status),
+                        g_csfle_state.vtable.status_get_code(status));
             }
             g_csfle_state.vtable.status_destroy(status);
 #ifndef __linux__
             mcr_dll_close(g_csfle_state.dll);
 #else
-            /// NOTE: On Linux, skip closing the CSFLE library itself, since a bug in
-            /// the way ld-linux and GCC interact causes static destructors to not run
-            /// during dlclose(). Still, free the error string:
-            ///
-            /// Please see: https://jira.mongodb.org/browse/SERVER-63710
-            mstr_free(g_csfle_state.dll.error_string);
+            /// NOTE: On Linux, skip closing the CSFLE library itself, since a bug in
+            /// the way ld-linux and GCC interact causes static destructors to not run
+            /// during dlclose(). Still, free the error string:
+            ///
+            /// Please see: https://jira.mongodb.org/browse/SERVER-63710
+            mstr_free(g_csfle_state.dll.error_string);
+#endif
+        }
+    }
+}
+
+/**
+ * @brief Following a call to _try_find_csfle, reconcile the result with the
+ * current application-global csfle status.
+ *
+ * csfle contains global state that can only be loaded once for the entire
+ * application. For this reason, there is a global object that manages the
+ * loaded library. Attempts to create more than one mongocrypt_t that all
+ * request csfle requires that all instances attempt to open the same csfle
+ * library.
+ *
+ * This function checks if there is already a csfle loaded for the process. If
+ * there is, we validate that the given find-result found the same library
+ * that is already loaded. If not, then this function sets an error and returns
+ * `false`.
+ *
+ * If there was no prior loaded csfle and the find-result indicates that it
+ * found the library, this function will store the find-result in the global
+ * state for later calls to mongocrypt_init() that request csfle.
+ *
+ * This function performs reference counting on the global state. Following a
+ * successful call to this function (i.e. it returns `true`), one must have a
+ * corresponding call to _csfle_drop_global_ref(), which will release the
+ * resources acquired by this function.
+ *
+ * @param crypt The requesting mongocrypt_t instance. An error may be set
+ * through this object.
+ * @param found The result of _try_find_csfle().
+ * @return true Upon success AND `found->okay`
+ * @return false Otherwise.
+ *
+ * @note If there was no prior global state loaded, this function will steal
+ * the library referenced by `found`. The caller should release `found->lib`
+ * regardless.
+ */
+static bool _csfle_replace_or_take_validate_singleton(mongocrypt_t *crypt, _loaded_csfle *found) {
+    mlib_call_once(&g_csfle_init_flag, init_csfle_state);
+
+    // If we have a loaded library, create a csfle_status object to use with
+    // lib_create
+    mongo_crypt_v1_status *csfle_status = NULL;
+
+    BSON_ASSERT_PARAM(crypt);
+    BSON_ASSERT_PARAM(found);
+
+    if (found->okay) {
+        // Create the status. Note that this may fail, so do not assume
+        // csfle_status is non-null.
+        csfle_status = found->vtable.status_create();
+    }
+
+    /**
+     * Atomically:
+     *
+     * 1. If there is an existing global library, increment its reference count.
+     * 2. Otherwise, if we have successfully loaded a new csfle, replace the
+     *    global library and set its reference count to 1.
+     * 3. Otherwise, do nothing.
+     */
+    enum {
+        TOOK_REFERENCE,
+        DID_NOTHING,
+        REPLACED_GLOBAL,
+        LIB_CREATE_FAILED,
+    } action;
+
+    MONGOCRYPT_WITH_MUTEX(g_csfle_state.mtx) {
+        if (g_csfle_state.refcount) {
+            // Increment the refcount to prevent the global csfle library from
+            // disappearing
+            ++g_csfle_state.refcount;
+            action = TOOK_REFERENCE;
+        } else if (found->okay) {
+            // We have found csfle, and no one else is holding one. Our result will
+            // now become the global result.
+            // Create the single csfle_lib object for the application:
+            mongo_crypt_v1_lib *csfle_lib = found->vtable.lib_create(csfle_status);
+            if (csfle_lib == NULL) {
+                // Creation failed:
+                action = LIB_CREATE_FAILED;
+            } else {
+                // Creation succeeded: Store the result:
+                g_csfle_state.dll = found->lib;
+                g_csfle_state.vtable = found->vtable;
+                g_csfle_state.csfle_lib = csfle_lib;
+                g_csfle_state.refcount = 1;
+                action = REPLACED_GLOBAL;
+            }
+        } else {
+            // We failed to load the library, and no one else has one either.
+            // Nothing to do.
+            action = DID_NOTHING;
+        }
+    }
+
+    // Get the possible failure status information.
+    mstr message = MSTR_NULL;
+    int err = 0;
+    int code = 0;
+    if (csfle_status) {
+        assert(found->okay);
+        message = mstr_copy_cstr(found->vtable.status_get_explanation(csfle_status));
+        err = found->vtable.status_get_error(csfle_status);
+        code = found->vtable.status_get_code(csfle_status);
+        found->vtable.status_destroy(csfle_status);
+    }
+
+    bool have_csfle = true;
+    switch (action) {
+    case TOOK_REFERENCE: {
+        const bool is_valid = _validate_csfle_singleton(crypt, *found);
+        if (!is_valid) {
+            //  We've failed validation, so we're not going to continue to
+            //  reference the global instance it. Drop it now:
+            _csfle_drop_global_ref();
+        }
+        have_csfle = is_valid;
+        break;
+    }
+    case REPLACED_GLOBAL:
+        // Reset the library in the caller so they can't unload the DLL. The DLL
+        // is now managed in the global variable.
+        found->lib = MCR_DLL_NULL;
+        _mongocrypt_log(&crypt->log, MONGOCRYPT_LOG_LEVEL_TRACE, "Loading new csfle library for the application.");
+        have_csfle = true;
+        break;
+    case LIB_CREATE_FAILED:
+        if (!message.data) {
+            // We failed to obtain a message about the failure
+            _mongocrypt_set_error(crypt->status,
+                                  MONGOCRYPT_STATUS_ERROR_CRYPT_SHARED,
+                                  MONGOCRYPT_GENERIC_ERROR_CODE,
+                                  "csfle lib_create() failed");
+        } else {
+            // Record the message, error, and code from csfle about the failure
+            _mongocrypt_set_error(crypt->status,
+                                  MONGOCRYPT_STATUS_ERROR_CRYPT_SHARED,
+                                  MONGOCRYPT_GENERIC_ERROR_CODE,
+                                  "csfle lib_create() failed: %s [Error %d, code %d]",
+                                  message.data,
+                                  err,
+                                  code);
+        }
+        have_csfle = false;
+        break;
+    case DID_NOTHING:
+    default: have_csfle = false; break;
+    }
+
+    mstr_free(message);
+    return have_csfle;
+}
+
+/**
+ * @return true If the given mongocrypt wants csfle
+ * @return false Otherwise
+ *
+ * @note "Requesting csfle" means that it has set at least one search path OR
+ * has set the override path
+ */
+static bool _wants_csfle(mongocrypt_t *c) {
+    BSON_ASSERT_PARAM(c);
+
+    if (c->opts.bypass_query_analysis) {
+        return false;
+    }
+    return c->opts.n_crypt_shared_lib_search_paths != 0 || c->opts.crypt_shared_lib_override_path.data != NULL;
+}
+
+/**
+ * @brief Try to enable csfle for the given mongocrypt
+ *
+ * @param crypt The crypt object for which we should enable csfle
+ * @return true If no errors occurred
+ * @return false Otherwise
+ *
+ * @note Returns `true` even if loading fails to find the csfle library on the
+ * requested paths. `false` is only for hard-errors, which includes failure to
+ * load from the override path.
+ */
+static bool _try_enable_csfle(mongocrypt_t *crypt) {
+    mongocrypt_status_t *status;
+    _loaded_csfle found;
+
+    BSON_ASSERT_PARAM(crypt);
+
+    found = _try_find_csfle(crypt);
+
+    status = crypt->status;
+
+    // If a crypt_shared override path was specified, but we did not succeed in
+    // loading crypt_shared, that is a hard-error.
+    if (crypt->opts.crypt_shared_lib_override_path.data && !found.okay) {
+        // Wrap error with additional information.
+        CLIENT_ERR("A crypt_shared override path was specified [%s], but we failed to open a dynamic "
+                   "library at that location. Load error: [%s]",
+                   crypt->opts.crypt_shared_lib_override_path.data,
+                   mongocrypt_status_message(crypt->status, NULL /* len */));
+        return false;
+    }
+
+    // Attempt to validate the try-find result against the global state:
+    const bool got_csfle = _csfle_replace_or_take_validate_singleton(crypt, &found);
+    // Close the lib we found (may have been stolen in validate_singleton())
+    mcr_dll_close(found.lib);
+
+    if (got_csfle) {
+        crypt->csfle = g_csfle_state.vtable;
+        crypt->csfle_lib = g_csfle_state.csfle_lib;
+    }
+    // In cast of failure, validate_singleton() will set a non-ok status.
+    return mongocrypt_status_type(status) == MONGOCRYPT_STATUS_OK;
+}
+
+/* Returns the shortest lifetime of keys in the key cache. */
+static uint64_t _shortest_key_expiration(mongocrypt_t *crypt) {
+    uint64_t shortest;
+    bson_t expirations;
+    bson_iter_t iter;
+
+    BSON_ASSERT_PARAM(crypt);
+
+    shortest = crypt->opts.key_expiration_ms;
+    if (_mongocrypt_buffer_empty(&crypt->opts.key_expiration_by_kms_provider)) {
+        return shortest;
+    }
+    /* Expirations were validated by mongocrypt_setopt_key_expiration_by_kms_provider. */
+    BSON_ASSERT(_mongocrypt_buffer_to_bson(&crypt->opts.key_expiration_by_kms_provider, &expirations));
+    BSON_ASSERT(bson_iter_init(&iter, &expirations));
+    while (bson_iter_next(&iter)) {
+        const int64_t expiration_ms = bson_iter_as_int64(&iter);
+
+        /* 0 disables expiration. */
+        if (expiration_ms > 0 && (uint64_t)expiration_ms < shortest) {
+            shortest = (uint64_t)expiration_ms;
+        }
+    }
+    return shortest;
+}
+
+bool mongocrypt_init(mongocrypt_t *crypt) {
+    BSON_ASSERT_PARAM(crypt);
+
+    mongocrypt_status_t *status = crypt->status;
+    if (crypt->initialized) {
+        CLIENT_ERR("already initialized");
+        return false;
+    }
+
+    crypt->initialized = true;
+
+    if (!mongocrypt_status_ok(crypt->status)) {
+        return false;
+    }
+
+    if (!_mongocrypt_opts_validate(&crypt->opts, status)) {
+        return false;
+    }
+
+    _mongocrypt_log_set_level(&crypt->log, crypt->opts.log_level);
+    if (crypt->opts.log_fn) {
+        _mongocrypt_log_set_fn(&crypt->log, crypt->opts.log_fn, crypt->opts.log_ctx);
+    }
+
+    _mongocrypt_cache_set_expiration(&crypt->cache_key, crypt->opts.key_expiration_ms);
+    _mongocrypt_cache_set_refresh_ahead(&crypt->cache_key, crypt->opts.key_cache_refresh_ahead);
+    _mongocrypt_cache_set_max_entries(&crypt->cache_key, crypt->opts.key_cache_max_entries);
+    _mongocrypt_cache_set_expiration(&crypt->cache_collinfo, crypt->opts.collinfo_expiration_ms);
+    _mongocrypt_cache_set_max_entries(&crypt->cache_collinfo, crypt->opts.collinfo_cache_max_entries);
+    _mongocrypt_cache_set_max_entries(&crypt->cache_mincover, crypt->opts.mincover_cache_max_entries);
+    _mongocrypt_cache_set_max_entries(&crypt->cache_marking, crypt->opts.marking_cache_max_entries);
+    _mongocrypt_cache_set_max_entries(&crypt->cache_tokens, crypt->opts.token_cache_max_entries);
+    _mongocrypt_cache_set_expiration(&crypt->cache_deterministic, _shortest_key_expiration(crypt));
+    _mongocrypt_cache_set_max_entries(&crypt->cache_deterministic, crypt->opts.deterministic_cache_max_entries);
+    _mongocrypt_cache_set_max_entries(&crypt->cache_find_payload, crypt->opts.find_payload_cache_max_entries);
+    _mongocrypt_cache_set_max_entries(&crypt->cache_range_opts, crypt->opts.range_opts_cache_max_entries);
+    _mongocrypt_cache_set_max_entries(&crypt->cache_user_key_id, crypt->opts.key_cache_max_entries);
+    if (crypt->opts.kmip_kek_cache_expiration_ms > 0) {
+        _mongocrypt_cache_set_expiration(&crypt->cache_kmip_kek, crypt->opts.kmip_kek_cache_expiration_ms);
+    }
+
+    if (crypt->opts.lock_key_material) {
+        if (!_mongocrypt_secure_arena_acquire(status)) {
+            return false;
+        }
+        crypt->secure_arena_acquired = true;
+    }
+
+    if (crypt->opts.cache_domain) {
+        _mongocrypt_buffer_t kms_fingerprint;
+
+        _mongocrypt_opts_kms_providers_fingerprint(&crypt->opts.kms_providers, &kms_fingerprint);
+        crypt->cache_domain = _mongocrypt_cache_domain_acquire(crypt->opts.cache_domain,
+                                                               &kms_fingerprint,
+                                                               crypt->opts.key_expiration_ms,
+                                                               crypt->opts.key_cache_refresh_ahead,
+                                                               crypt->opts.key_cache_max_entries,
+                                                               status);
+        _mongocrypt_buffer_cleanup(&kms_fingerprint);
+        if (!crypt->cache_domain) {
+            return false;
+        }
+    }
+
+    if (!_mongocrypt_buffer_empty(&crypt->opts.schema_map)) {
+        crypt->schema_map = mc_mapof_ns_to_schema_new(&crypt->opts.schema_map, false /* parse_efc */, status);
+        if (!crypt->schema_map) {
+            return false;
+        }
+    }
+
+    if (!_mongocrypt_buffer_empty(&crypt->opts.encrypted_field_config_map)) {
+        crypt->encrypted_field_config_map =
+            mc_mapof_ns_to_schema_new(&crypt->opts.encrypted_field_config_map, true /* parse_efc */, status);
+        if (!crypt->encrypted_field_config_map) {
+            return false;
+        }
+    }
+
+    if (!_mongocrypt_buffer_empty(&crypt->opts.key_vault_snapshot)) {
+        crypt->key_vault_snapshot = mc_key_vault_snapshot_new(&crypt->opts.key_vault_snapshot, status);
+        if (!crypt->key_vault_snapshot) {
+            return false;
+        }
+    }
+
+    if (!crypt->crypto) {
+#ifndef MONGOCRYPT_ENABLE_CRYPTO
+        CLIENT_ERR("libmongocrypt built with native crypto disabled. crypto "
+                   "hooks required");
+        return false;
+#else
+        /* set default hooks. */
+        crypt->crypto = bson_malloc0(sizeof(*crypt->crypto));
+        BSON_ASSERT(crypt->crypto);
+#endif
+    }
+
+    if (crypt->opts.eager_crypto_init && !_native_crypto_ensure_init(status)) {
+        return false;
+    }
+
+    if (!_wants_csfle(crypt)) {
+        // User does not want csfle. Just succeed.
+        return true;
+    }
+
+    if (crypt->opts.defer_crypt_shared_load) {
+        // Load on the first context that needs markings.
+        crypt->csfle_load_pending = true;
+        return true;
+    }
+
+    return _try_enable_csfle(crypt);
+}
+
+bool _mongocrypt_load_deferred_csfle(mongocrypt_t *crypt, mongocrypt_status_t *status) {
+    bool ok = true;
+
+    BSON_ASSERT_PARAM(crypt);
+    BSON_ASSERT_PARAM(status);
+
+    MONGOCRYPT_WITH_MUTEX(crypt->mutex) {
+        if (crypt->csfle_load_pending) {
+            crypt->csfle_load_pending = false;
+            crypt->csfle_load_failed = !_try_enable_csfle(crypt);
+        }
+        if (crypt->csfle_load_failed) {
+            _mongocrypt_status_copy_to(crypt->status, status);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool mongocrypt_is_crypto_available(void) {
+#ifdef MONGOCRYPT_ENABLE_CRYPTO
+    return true;
+#else
+    return false;
 #endif
+}
+
+bool mongocrypt_status(mongocrypt_t *crypt, mongocrypt_status_t *out) {
+    BSON_ASSERT_PARAM(crypt);
+
+    if (!out) {
+        mongocrypt_status_t *status = crypt->status;
+        CLIENT_ERR("argument 'out' is required");
+        return false;
+    }
+
+    if (!mongocrypt_status_ok(crypt->status)) {
+        _mongocrypt_status_copy_to(crypt->status, out);
+        return false;
+    }
+    _mongocrypt_status_reset(out);
+    return true;
+}
+
+void mongocrypt_destroy(mongocrypt_t *crypt) {
+    if (!crypt) {
+        return;
+    }
+    _mongocrypt_fork_unregister(crypt);
+    if (crypt->opts.key_cache_thread_local) {
+        /* Entries of other threads are released after the key cache is cleaned
+         * up. A shared cache domain may outlive this handle. */
+        _mongocrypt_cache_key_l1_clear(_mongocrypt_key_cache(crypt));
+    }
+    _mongocrypt_opts_cleanup(&crypt->opts);
+    _mongocrypt_cache_cleanup(&crypt->cache_collinfo);
+    _mongocrypt_cache_cleanup(&crypt->cache_key);
+    _mongocrypt_cache_cleanup(&crypt->cache_mincover);
+    _mongocrypt_cache_cleanup(&crypt->cache_marking);
+    _mongocrypt_cache_cleanup(&crypt->cache_tokens);
+    _mongocrypt_cache_cleanup(&crypt->cache_deterministic);
+    _mongocrypt_cache_cleanup(&crypt->cache_find_payload);
+    _mongocrypt_cache_cleanup(&crypt->cache_range_opts);
+    _mongocrypt_cache_cleanup(&crypt->cache_kmip_kek);
+    _mongocrypt_cache_cleanup(&crypt->cache_user_key_id);
+    mc_mapof_ns_to_schema_destroy(crypt->schema_map);
+    mc_mapof_ns_to_schema_destroy(crypt->encrypted_field_config_map);
+    mc_key_vault_snapshot_destroy(crypt->key_vault_snapshot);
+    _mongocrypt_mutex_cleanup(&crypt->mutex);
+    _mongocrypt_log_cleanup(&crypt->log);
+    mongocrypt_status_destroy(crypt->status);
+    if (crypt->crypto) {
+        _mongocrypt_random_pool_destroy(crypt->crypto->random_pool);
+    }
+    bson_free(crypt->crypto);
+    mc_mapof_kmsid_to_token_destroy(crypt->cache_oauth);
+    if (crypt->secure_arena_acquired) {
+        _mongocrypt_secure_arena_release();
+    }
+    _mongocrypt_buffer_cleanup(&crypt->cache_stats);
+    _mongocrypt_buffer_cleanup(&crypt->counters_bson);
+    _mongocrypt_buffer_cleanup(&crypt->key_cache_snapshot);
+    for (size_t i = 0; i < crypt->kms_inflight.len; i++) {
+        _mongocrypt_buffer_cleanup(&_mc_array_index(&crypt->kms_inflight, _mongocrypt_buffer_t, i));
+    }
+    _mc_array_destroy(&crypt->kms_inflight);
+    for (size_t i = 0; i < crypt->pending_key_docs.len; i++) {
+        _mongocrypt_buffer_cleanup(&_mc_array_index(&crypt->pending_key_docs, _mongocrypt_buffer_t, i));
+    }
+    _mc_array_destroy(&crypt->pending_key_docs);
+    _mongocrypt_cache_domain_release(crypt->cache_domain);
+    for (size_t i = 0; i < crypt->kms_stats.len; i++) {
+        _mongocrypt_kms_stats_t *kms_stats = &_mc_array_index(&crypt->kms_stats, _mongocrypt_kms_stats_t, i);
+
+        bson_free(kms_stats->kmsid);
+        bson_free(kms_stats->endpoint);
+        _mc_array_destroy(&kms_stats->http_errors);
+        _mc_array_destroy(&kms_stats->kmip_errors);
+    }
+    _mc_array_destroy(&crypt->kms_stats);
+    for (size_t i = 0; i < crypt->kms_rate_limits.len; i++) {
+        _mongocrypt_kms_rate_limit_t *rate_limit =
+            &_mc_array_index(&crypt->kms_rate_limits, _mongocrypt_kms_rate_limit_t, i);
+
+        bson_free(rate_limit->kmsid);
+        bson_free(rate_limit->endpoint);
+    }
+    _mc_array_destroy(&crypt->kms_rate_limits);
+    _mongocrypt_buffer_cleanup(&crypt->kms_stats_bson);
+    _mongocrypt_buffer_cleanup(&crypt->range_estimate_bson);
+    _mongocrypt_buffer_cleanup(&crypt->memory_usage_bson);
+    _mongocrypt_buffer_cleanup(&crypt->cached_kms_credentials);
+
+    // Query analyzers must be destroyed before the csfle library.
+    for (size_t i = 0; i < crypt->csfle_query_analyzers.len; i++) {
+        crypt->csfle.query_analyzer_destroy(
+            _mc_array_index(&crypt->csfle_query_analyzers, mongo_crypt_v1_query_analyzer *, i));
+    }
+    _mc_array_destroy(&crypt->csfle_query_analyzers);
+
+    if (crypt->csfle.okay) {
+        _csfle_drop_global_ref();
+        crypt->csfle.okay = false;
+    }
+
+    bson_free(crypt);
+}
+
+static void _append_cache_stats(bson_t *bson, const char *name, const _mongocrypt_cache_stats_t *stats) {
+    bson_t child;
+
+    BSON_ASSERT(BSON_APPEND_DOCUMENT_BEGIN(bson, name, &child));
+    BSON_ASSERT(BSON_APPEND_INT64(&child, "hits", stats->hits));
+    BSON_ASSERT(BSON_APPEND_INT64(&child, "misses", stats->misses));
+    BSON_ASSERT(BSON_APPEND_INT64(&child, "evictions", stats->evictions));
+    BSON_ASSERT(BSON_APPEND_INT64(&child, "insertions", stats->insertions));
+    BSON_ASSERT(BSON_APPEND_INT64(&child, "entries", stats->entries));
+    BSON_ASSERT(bson_append_document_end(bson, &child));
+}
+
+bool mongocrypt_get_cache_stats(mongocrypt_t *crypt, mongocrypt_binary_t *stats) {
+    _mongocrypt_cache_stats_t key_stats, collinfo_stats, oauth_stats;
+    mongocrypt_status_t *status;
+    bson_t bson;
+
+    if (!crypt) {
+        return false;
+    }
+    status = crypt->status;
+
+    if (!crypt->initialized) {
+        CLIENT_ERR("mongocrypt_init not called");
+        return false;
+    }
+
+    if (!stats) {
+        CLIENT_ERR("invalid NULL stats");
+        return false;
+    }
+
+    _mongocrypt_cache_stats(_mongocrypt_key_cache(crypt), &key_stats);
+    _mongocrypt_cache_stats(&crypt->cache_collinfo, &collinfo_stats);
+    mc_mapof_kmsid_to_token_stats(crypt->cache_oauth, &oauth_stats);
+
+    bson_init(&bson);
+    _append_cache_stats(&bson, "key", &key_stats);
+    _append_cache_stats(&bson, "collinfo", &collinfo_stats);
+    _append_cache_stats(&bson, "oauth", &oauth_stats);
+
+    _mongocrypt_mutex_lock(&crypt->mutex);
+    _mongocrypt_buffer_cleanup(&crypt->cache_stats);
+    _mongocrypt_buffer_steal_from_bson(&crypt->cache_stats, &bson);
+    _mongocrypt_buffer_to_binary(&crypt->cache_stats, stats);
+    _mongocrypt_mutex_unlock(&crypt->mutex);
+    return true;
+}
+
+static void _append_size_t(bson_t *bson, const char *name, size_t value) {
+    BSON_ASSERT_PARAM(bson);
+    BSON_ASSERT_PARAM(name);
+
+    BSON_ASSERT(value <= INT64_MAX);
+    BSON_ASSERT(BSON_APPEND_INT64(bson, name, (int64_t)value));
+}
+
+bool mongocrypt_get_memory_usage(mongocrypt_t *crypt, mongocrypt_binary_t *usage) {
+    mongocrypt_status_t *status;
+    size_t key_bytes, collinfo_bytes, oauth_bytes;
+    int64_t context_count, context_bytes;
+    bson_t bson;
+    bson_t child;
+
+    if (!crypt) {
+        return false;
+    }
+    status = crypt->status;
+
+    if (!crypt->initialized) {
+        CLIENT_ERR("mongocrypt_init not called");
+        return false;
+    }
+
+    if (!usage) {
+        CLIENT_ERR("invalid NULL usage");
+        return false;
+    }
+
+    key_bytes = _mongocrypt_cache_memory_usage(_mongocrypt_key_cache(crypt));
+    collinfo_bytes = _mongocrypt_cache_memory_usage(&crypt->cache_collinfo);
+    oauth_bytes = mc_mapof_kmsid_to_token_memory_usage(crypt->cache_oauth);
+    context_count = _mongocrypt_atomic_int64_load(&crypt->live_allocations);
+    context_bytes = _mongocrypt_atomic_int64_load(&crypt->live_allocation_bytes);
+
+    bson_init(&bson);
+    BSON_ASSERT(BSON_APPEND_DOCUMENT_BEGIN(&bson, "caches", &child));
+    _append_size_t(&child, "key", key_bytes);
+    _append_size_t(&child, "collinfo", collinfo_bytes);
+    _append_size_t(&child, "oauth", oauth_bytes);
+    BSON_ASSERT(bson_append_document_end(&bson, &child));
+
+    BSON_ASSERT(BSON_APPEND_DOCUMENT_BEGIN(&bson, "contexts", &child));
+    BSON_ASSERT(BSON_APPEND_INT64(&child, "count", context_count));
+    BSON_ASSERT(BSON_APPEND_INT64(&child, "bytes", context_bytes));
+    BSON_ASSERT(bson_append_document_end(&bson, &child));
+
+    _mongocrypt_mutex_lock(&crypt->mutex);
+    /* crypt_shared allocates with its own allocator, so only its state is
+     * reported. */
+    BSON_ASSERT(BSON_APPEND_DOCUMENT_BEGIN(&bson, "cryptShared", &child));
+    BSON_ASSERT(BSON_APPEND_BOOL(&child, "loaded", crypt->csfle.okay));
+    _append_size_t(&child, "idleQueryAnalyzers", crypt->csfle_query_analyzers.len);
+    BSON_ASSERT(bson_append_document_end(&bson, &child));
+
+    _mongocrypt_buffer_cleanup(&crypt->memory_usage_bson);
+    _mongocrypt_buffer_steal_from_bson(&crypt->memory_usage_bson, &bson);
+    _mongocrypt_buffer_to_binary(&crypt->memory_usage_bson, usage);
+    _mongocrypt_mutex_unlock(&crypt->mutex);
+    return true;
+}
+
+/* _mongocrypt_counter_names has the group and name of each mc_counter_t, in
+ * order. Counters of a group are adjacent. */
+static const struct {
+    const char *group;
+    const char *name;
+} _mongocrypt_counter_names[MC_COUNTER_COUNT] = {
+    {"contexts", "encrypt"},
+    {"contexts", "decrypt"},
+    {"contexts", "createDataKey"},
+    {"contexts", "rewrapManyDataKey"},
+    {"contexts", "prefetchKeys"},
+    {"encryptedValues", "fle1"},
+    {"encryptedValues", "fle2Equality"},
+    {"encryptedValues", "fle2Range"},
+    {"encryptedValues", "fle2Unindexed"},
+    {"decryptedValues", "fle1"},
+    {"decryptedValues", "fle2Equality"},
+    {"decryptedValues", "fle2Range"},
+    {"decryptedValues", "fle2Unindexed"},
+    {"bytes", "encrypt"},
+    {"bytes", "decrypt"},
+    {"kmsRequests", "aws"},
+    {"kmsRequests", "azure"},
+    {"kmsRequests", "gcp"},
+    {"kmsRequests", "kmip"},
+    {"markings", "cryptShared"},
+    {"markings", "mongocryptd"},
+    {"markings", "cache"},
+};
+
+bool mongocrypt_get_counters(mongocrypt_t *crypt, mongocrypt_binary_t *counters) {
+    mongocrypt_status_t *status;
+    bson_t bson;
+    bson_t group;
+
+    if (!crypt) {
+        return false;
+    }
+    status = crypt->status;
+
+    if (!crypt->initialized) {
+        CLIENT_ERR("mongocrypt_init not called");
+        return false;
+    }
+
+    if (!counters) {
+        CLIENT_ERR("invalid NULL counters");
+        return false;
+    }
+
+    bson_init(&bson);
+    for (size_t i = 0; i < MC_COUNTER_COUNT; i++) {
+        const char *group_name = _mongocrypt_counter_names[i].group;
+
+        if (i == 0 || 0 != strcmp(group_name, _mongocrypt_counter_names[i - 1].group)) {
+            BSON_ASSERT(BSON_APPEND_DOCUMENT_BEGIN(&bson, group_name, &group));
+        }
+        BSON_ASSERT(BSON_APPEND_INT64(&group,
+                                      _mongocrypt_counter_names[i].name,
+                                      _mongocrypt_atomic_int64_load(&crypt->counters[i])));
+        if (i + 1 == MC_COUNTER_COUNT || 0 != strcmp(group_name, _mongocrypt_counter_names[i + 1].group)) {
+            BSON_ASSERT(bson_append_document_end(&bson, &group));
         }
     }
+
+    _mongocrypt_mutex_lock(&crypt->mutex);
+    _mongocrypt_buffer_cleanup(&crypt->counters_bson);
+    _mongocrypt_buffer_steal_from_bson(&crypt->counters_bson, &bson);
+    _mongocrypt_buffer_to_binary(&crypt->counters_bson, counters);
+    _mongocrypt_mutex_unlock(&crypt->mutex);
+    return true;
 }
 
-/**
- * @brief Following a call to _try_find_csfle, reconcile the result with the
- * current application-global csfle status.
- *
- * csfle contains global state that can only be loaded once for the entire
- * application. For this reason, there is a global object that manages the
- * loaded library. Attempts to create more than one mongocrypt_t that all
- * request csfle requires that all instances attempt to open the same csfle
- * library.
- *
- * This function checks if there is already a csfle loaded for the process. If
- * there is, we validate that the given find-result found the same library
- * that is already loaded. If not, then this function sets an error and returns
- * `false`.
- *
- * If there was no prior loaded csfle and the find-result indicates that it
- * found the library, this function will store the find-result in the global
- * state for later calls to mongocrypt_init() that request csfle.
- *
- * This function performs reference counting on the global state. Following a
- * successful call to this function (i.e. it returns `true`), one must have a
- * corresponding call to _csfle_drop_global_ref(), which will release the
- * resources acquired by this function.
- *
- * @param crypt The requesting mongocrypt_t instance. An error may be set
- * through this object.
- * @param found The result of _try_find_csfle().
- * @return true Upon success AND `found->okay`
- * @return false Otherwise.
- *
- * @note If there was no prior global state loaded, this function will steal
- * the library referenced by `found`. The caller should release `found->lib`
- * regardless.
- */
-static bool _csfle_replace_or_take_validate_singleton(mongocrypt_t *crypt, _loaded_csfle *found) {
-    mlib_call_once(&g_csfle_init_flag, init_csfle_state);
+static void _append_kms_error_counts(bson_t *bson, const char *name, const mc_array_t *errors) {
+    bson_t child;
 
-    // If we have a loaded library, create a csfle_status object to use with
-    // lib_create
-    mongo_crypt_v1_status *csfle_status = NULL;
+    BSON_ASSERT_PARAM(bson);
+    BSON_ASSERT_PARAM(name);
+    BSON_ASSERT_PARAM(errors);
 
-    BSON_ASSERT_PARAM(crypt);
-    BSON_ASSERT_PARAM(found);
+    BSON_ASSERT(BSON_APPEND_DOCUMENT_BEGIN(bson, name, &child));
+    for (size_t i = 0; i < errors->len; i++) {
+        const _mongocrypt_kms_error_count_t *error = &_mc_array_index(errors, _mongocrypt_kms_error_count_t, i);
+        char code[32];
 
-    if (found->okay) {
-        // Create the status. Note that this may fail, so do not assume
-        // csfle_status is non-null.
-        csfle_status = found->vtable.status_create();
+        bson_snprintf(code, sizeof(code), "%" PRId64, error->code);
+        BSON_ASSERT(BSON_APPEND_INT64(&child, code, error->count));
     }
+    BSON_ASSERT(bson_append_document_end(bson, &child));
+}
 
-    /**
-     * Atomically:
-     *
-     * 1. If there is an existing global library, increment its reference count.
-     * 2. Otherwise, if we have successfully loaded a new csfle, replace the
-     *    global library and set its reference count to 1.
-     * 3. Otherwise, do nothing.
-     */
-    enum {
-        TOOK_REFERENCE,
-        DID_NOTHING,
-        REPLACED_GLOBAL,
-        LIB_CREATE_FAILED,
-    } action;
+bool mongocrypt_get_kms_stats(mongocrypt_t *crypt, mongocrypt_binary_t *stats) {
+    mongocrypt_status_t *status;
+    bson_t bson;
+    bson_t providers;
 
-    MONGOCRYPT_WITH_MUTEX(g_csfle_state.mtx) {
-        if (g_csfle_state.refcount) {
-            // Increment the refcount to prevent the global csfle library from
-            // disappearing
-            ++g_csfle_state.refcount;
-            action = TOOK_REFERENCE;
-        } else if (found->okay) {
-            // We have found csfle, and no one else is holding one. Our result will
-            // now become the global result.
-            // Create the single csfle_lib object for the application:
-            mongo_crypt_v1_lib *csfle_lib = found->vtable.lib_create(csfle_status);
-            if (csfle_lib == NULL) {
-                // Creation failed:
-                action = LIB_CREATE_FAILED;
+    if (!crypt) {
+        return false;
+    }
+    status = crypt->status;
+
+    if (!crypt->initialized) {
+        CLIENT_ERR("mongocrypt_init not called");
+        return false;
+    }
+
+    if (!stats) {
+        CLIENT_ERR("invalid NULL stats");
+        return false;
+    }
+
+    bson_init(&bson);
+    _mongocrypt_mutex_lock(&crypt->mutex);
+    BSON_ASSERT(BSON_APPEND_ARRAY_BEGIN(&bson, "kms", &providers));
+    for (size_t i = 0; i < crypt->kms_stats.len; i++) {
+        const _mongocrypt_kms_stats_t *kms_stats = &_mc_array_index(&crypt->kms_stats, _mongocrypt_kms_stats_t, i);
+        bson_t entry;
+        bson_t histogram;
+        char key[16];
+        const char *key_str;
+
+        BSON_ASSERT(i <= UINT32_MAX);
+        bson_uint32_to_string((uint32_t)i, &key_str, key, sizeof(key));
+        BSON_ASSERT(BSON_APPEND_DOCUMENT_BEGIN(&providers, key_str, &entry));
+        BSON_ASSERT(BSON_APPEND_UTF8(&entry, "kmsProvider", kms_stats->kmsid));
+        BSON_ASSERT(BSON_APPEND_UTF8(&entry, "endpoint", kms_stats->endpoint));
+        BSON_ASSERT(BSON_APPEND_INT64(&entry, "requests", kms_stats->requests));
+        BSON_ASSERT(BSON_APPEND_INT64(&entry, "totalLatencyMicros", kms_stats->total_us));
+        BSON_ASSERT(BSON_APPEND_DOCUMENT_BEGIN(&entry, "latencyMillis", &histogram));
+        for (size_t b = 0; b < MC_KMS_LATENCY_BUCKET_COUNT; b++) {
+            char bound[32];
+
+            if (b < MC_KMS_LATENCY_BUCKET_COUNT - 1) {
+                bson_snprintf(bound, sizeof(bound), "le%" PRId64, _mongocrypt_kms_latency_bounds_ms[b]);
             } else {
-                // Creation succeeded: Store the result:
-                g_csfle_state.dll = found->lib;
-                g_csfle_state.vtable = found->vtable;
-                g_csfle_state.csfle_lib = csfle_lib;
-                g_csfle_state.refcount = 1;
-                action = REPLACED_GLOBAL;
+                bson_snprintf(bound, sizeof(bound), "inf");
             }
-        } else {
-            // We failed to load the library, and no one else has one either.
-            // Nothing to do.
-            action = DID_NOTHING;
+            BSON_ASSERT(BSON_APPEND_INT64(&histogram, bound, kms_stats->latency_buckets[b]));
         }
+        BSON_ASSERT(bson_append_document_end(&entry, &histogram));
+        _append_kms_error_counts(&entry, "httpErrors", &kms_stats->http_errors);
+        _append_kms_error_counts(&entry, "kmipErrors", &kms_stats->kmip_errors);
+        BSON_ASSERT(BSON_APPEND_INT64(&entry, "otherErrors", kms_stats->other_errors));
+        BSON_ASSERT(bson_append_document_end(&providers, &entry));
+    }
+    BSON_ASSERT(bson_append_array_end(&bson, &providers));
+
+    _mongocrypt_buffer_cleanup(&crypt->kms_stats_bson);
+    _mongocrypt_buffer_steal_from_bson(&crypt->kms_stats_bson, &bson);
+    _mongocrypt_buffer_to_binary(&crypt->kms_stats_bson, stats);
+    _mongocrypt_mutex_unlock(&crypt->mutex);
+    return true;
+}
+
+bool mongocrypt_range_estimate(mongocrypt_t *crypt, mongocrypt_binary_t *in, mongocrypt_binary_t *out) {
+    mongocrypt_status_t *status;
+    bson_t in_bson;
+    bson_t bson;
+
+    if (!crypt) {
+        return false;
     }
+    status = crypt->status;
 
-    // Get the possible failure status information.
-    mstr message = MSTR_NULL;
-    int err = 0;
-    int code = 0;
-    if (csfle_status) {
-        assert(found->okay);
-        message = mstr_copy_cstr(found->vtable.status_get_explanation(csfle_status));
-        err = found->vtable.status_get_error(csfle_status);
-        code = found->vtable.status_get_code(csfle_status);
-        found->vtable.status_destroy(csfle_status);
+    if (!crypt->initialized) {
+        CLIENT_ERR("mongocrypt_init not called");
+        return false;
     }
 
-    bool have_csfle = true;
-    switch (action) {
-    case TOOK_REFERENCE: {
-        const bool is_valid = _validate_csfle_singleton(crypt, *found);
-        if (!is_valid) {
-            //  We've failed validation, so we're not going to continue to
-            //  reference the global instance it. Drop it now:
-            _csfle_drop_global_ref();
-        }
-        have_csfle = is_valid;
-        break;
+    if (!in || !_mongocrypt_binary_to_bson(in, &in_bson) || !bson_validate(&in_bson, BSON_VALIDATE_NONE, NULL)) {
+        CLIENT_ERR("invalid BSON input");
+        return false;
     }
-    case REPLACED_GLOBAL:
-        // Reset the library in the caller so they can't unload the DLL. The DLL
-        // is now managed in the global variable.
-        found->lib = MCR_DLL_NULL;
-        _mongocrypt_log(&crypt->log, MONGOCRYPT_LOG_LEVEL_TRACE, "Loading new csfle library for the application.");
-        have_csfle = true;
-        break;
-    case LIB_CREATE_FAILED:
-        if (!message.data) {
-            // We failed to obtain a message about the failure
-            _mongocrypt_set_error(crypt->status,
-                                  MONGOCRYPT_STATUS_ERROR_CRYPT_SHARED,
-                                  MONGOCRYPT_GENERIC_ERROR_CODE,
-                                  "csfle lib_create() failed");
-        } else {
-            // Record the message, error, and code from csfle about the failure
-            _mongocrypt_set_error(crypt->status,
-                                  MONGOCRYPT_STATUS_ERROR_CRYPT_SHARED,
-                                  MONGOCRYPT_GENERIC_ERROR_CODE,
-                                  "csfle lib_create() failed: %s [Error %d, code %d]",
-                                  message.data,
-                                  err,
-                                  code);
-        }
-        have_csfle = false;
-        break;
-    case DID_NOTHING:
-    default: have_csfle = false; break;
+
+    if (!out) {
+        CLIENT_ERR("invalid NULL out");
+        return false;
     }
 
-    mstr_free(message);
-    return have_csfle;
+    bson_init(&bson);
+    if (!mc_range_estimate(crypt->crypto, &in_bson, crypt->opts.use_range_v2, &bson, status)) {
+        bson_destroy(&bson);
+        return false;
+    }
+
+    _mongocrypt_mutex_lock(&crypt->mutex);
+    _mongocrypt_buffer_cleanup(&crypt->range_estimate_bson);
+    _mongocrypt_buffer_steal_from_bson(&crypt->range_estimate_bson, &bson);
+    _mongocrypt_buffer_to_binary(&crypt->range_estimate_bson, out);
+    _mongocrypt_mutex_unlock(&crypt->mutex);
+    return true;
 }
 
-/**
- * @return true If the given mongocrypt wants csfle
- * @return false Otherwise
- *
- * @note "Requesting csfle" means that it has set at least one search path OR
- * has set the override path
- */
-static bool _wants_csfle(mongocrypt_t *c) {
-    BSON_ASSERT_PARAM(c);
+bool mongocrypt_export_key_cache(mongocrypt_t *crypt, mongocrypt_binary_t *kek, mongocrypt_binary_t *snapshot) {
+    _mongocrypt_buffer_t kek_buf;
+    mongocrypt_status_t *status;
+    bson_t bson;
 
-    if (c->opts.bypass_query_analysis) {
+    if (!crypt) {
         return false;
     }
-    return c->opts.n_crypt_shared_lib_search_paths != 0 || c->opts.crypt_shared_lib_override_path.data != NULL;
+    status = crypt->status;
+
+    if (!crypt->initialized) {
+        CLIENT_ERR("mongocrypt_init not called");
+        return false;
+    }
+
+    if (!kek) {
+        CLIENT_ERR("invalid NULL kek");
+        return false;
+    }
+
+    if (!snapshot) {
+        CLIENT_ERR("invalid NULL snapshot");
+        return false;
+    }
+
+    _mongocrypt_buffer_from_binary(&kek_buf, kek);
+    bson_init(&bson);
+    if (!_mongocrypt_cache_key_export(_mongocrypt_key_cache(crypt), crypt->crypto, &kek_buf, &bson, status)) {
+        bson_destroy(&bson);
+        return false;
+    }
+
+    _mongocrypt_mutex_lock(&crypt->mutex);
+    _mongocrypt_buffer_cleanup(&crypt->key_cache_snapshot);
+    _mongocrypt_buffer_steal_from_bson(&crypt->key_cache_snapshot, &bson);
+    _mongocrypt_buffer_to_binary(&crypt->key_cache_snapshot, snapshot);
+    _mongocrypt_mutex_unlock(&crypt->mutex);
+    return true;
 }
 
-/**
- * @brief Try to enable csfle for the given mongocrypt
- *
- * @param crypt The crypt object for which we should enable csfle
- * @return true If no errors occurred
- * @return false Otherwise
- *
- * @note Returns `true` even if loading fails to find the csfle library on the
- * requested paths. `false` is only for hard-errors, which includes failure to
- * load from the override path.
- */
-static bool _try_enable_csfle(mongocrypt_t *crypt) {
+bool mongocrypt_import_key_cache(mongocrypt_t *crypt, mongocrypt_binary_t *kek, mongocrypt_binary_t *snapshot) {
+    _mongocrypt_buffer_t kek_buf;
     mongocrypt_status_t *status;
-    _loaded_csfle found;
+    bson_t bson;
+
+    if (!crypt) {
+        return false;
+    }
+    status = crypt->status;
+
+    if (!crypt->initialized) {
+        CLIENT_ERR("mongocrypt_init not called");
+        return false;
+    }
+
+    if (!kek) {
+        CLIENT_ERR("invalid NULL kek");
+        return false;
+    }
+
+    if (!snapshot || !_mongocrypt_binary_to_bson(snapshot, &bson) || !bson_validate(&bson, BSON_VALIDATE_NONE, NULL)) {
+        CLIENT_ERR("invalid BSON snapshot");
+        return false;
+    }
+
+    _mongocrypt_buffer_from_binary(&kek_buf, kek);
+    return _mongocrypt_cache_key_import(_mongocrypt_key_cache(crypt), crypt->crypto, &kek_buf, &bson, status);
+}
+
+bool mongocrypt_add_key_documents(mongocrypt_t *crypt, mongocrypt_binary_t *key_docs) {
+    mongocrypt_status_t *status;
+    bson_t bson;
+    bson_iter_t iter;
+    bson_iter_t array_iter;
+    mc_array_t docs;
+    bool ok = false;
+
+    if (!crypt) {
+        return false;
+    }
+    status = crypt->status;
+
+    if (!crypt->initialized) {
+        CLIENT_ERR("mongocrypt_init not called");
+        return false;
+    }
+
+    if (!key_docs || !_mongocrypt_binary_to_bson(key_docs, &bson) || !bson_validate(&bson, BSON_VALIDATE_NONE, NULL)) {
+        CLIENT_ERR("invalid BSON key documents");
+        return false;
+    }
+
+    if (!bson_iter_init_find(&iter, &bson, "keys") || !BSON_ITER_HOLDS_ARRAY(&iter)
+        || !bson_iter_recurse(&iter, &array_iter)) {
+        CLIENT_ERR("expected array 'keys'");
+        return false;
+    }
+
+    /* Parse all documents before queueing any, so a malformed document does
+     * not leave the others half added. */
+    _mc_array_init(&docs, sizeof(_mongocrypt_buffer_t));
+    while (bson_iter_next(&array_iter)) {
+        _mongocrypt_key_doc_t *key_doc;
+        _mongocrypt_buffer_t doc;
+        bson_t doc_bson;
+        const uint8_t *data;
+        uint32_t len;
+
+        if (!BSON_ITER_HOLDS_DOCUMENT(&array_iter)) {
+            CLIENT_ERR("expected document in 'keys'");
+            goto done;
+        }
+        bson_iter_document(&array_iter, &len, &data);
+        if (!bson_init_static(&doc_bson, data, len)) {
+            CLIENT_ERR("malformed BSON for key document");
+            goto done;
+        }
+        key_doc = _mongocrypt_key_new();
+        if (!_mongocrypt_key_parse_owned(&doc_bson, key_doc, status)) {
+            _mongocrypt_key_destroy(key_doc);
+            goto done;
+        }
+        _mongocrypt_key_destroy(key_doc);
+
+        if (!_mongocrypt_buffer_copy_from_data_and_size(&doc, data, len)) {
+            CLIENT_ERR("failed to copy key document");
+            goto done;
+        }
+        _mc_array_append_val(&docs, doc);
+    }
+
+    MONGOCRYPT_WITH_MUTEX(crypt->mutex) {
+        _mc_array_append_vals(&crypt->pending_key_docs, docs.data, docs.len);
+    }
+    /* The queue owns the documents now. */
+    _mc_array_clear(&docs);
+    ok = true;
 
-    BSON_ASSERT_PARAM(crypt);
+done:
+    for (size_t i = 0; i < docs.len; i++) {
+        _mongocrypt_buffer_cleanup(&_mc_array_index(&docs, _mongocrypt_buffer_t, i));
+    }
+    _mc_array_destroy(&docs);
+    return ok;
+}
 
-    found = _try_find_csfle(crypt);
+bool mongocrypt_invalidate_collinfo(mongocrypt_t *crypt, const char *ns, int32_t len) {
+    mongocrypt_status_t *status;
+    char *ns_copy;
+    bool ok;
 
+    if (!crypt) {
+        return false;
+    }
     status = crypt->status;
 
-    // If a crypt_shared override path was specified, but we did not succeed in
-    // loading crypt_shared, that is a hard-error.
-    if (crypt->opts.crypt_shared_lib_override_path.data && !found.okay) {
-        // Wrap error with additional information.
-        CLIENT_ERR("A crypt_shared override path was specified [%s], but we failed to open a dynamic "
-                   "library at that location. Load error: [%s]",
-                   crypt->opts.crypt_shared_lib_override_path.data,
-                   mongocrypt_status_message(crypt->status, NULL /* len */));
+    if (!crypt->initialized) {
+        CLIENT_ERR("mongocrypt_init not called");
         return false;
     }
 
-    // Attempt to validate the try-find result against the global state:
-    const bool got_csfle = _csfle_replace_or_take_validate_singleton(crypt, &found);
-    // Close the lib we found (may have been stolen in validate_singleton())
-    mcr_dll_close(found.lib);
-
-    if (got_csfle) {
-        crypt->csfle = g_csfle_state.vtable;
-        crypt->csfle_lib = g_csfle_state.csfle_lib;
+    if (!_mongocrypt_validate_and_copy_string(ns, len, &ns_copy)) {
+        CLIENT_ERR("invalid namespace");
+        return false;
     }
-    // In cast of failure, validate_singleton() will set a non-ok status.
-    return mongocrypt_status_type(status) == MONGOCRYPT_STATUS_OK;
+    ok = _mongocrypt_cache_remove(&crypt->cache_collinfo, ns_copy, status);
+    bson_free(ns_copy);
+    return ok;
 }
 
-bool mongocrypt_init(mongocrypt_t *crypt) {
-    BSON_ASSERT_PARAM(crypt);
+bool mongocrypt_invalidate_all_collinfo(mongocrypt_t *crypt) {
+    if (!crypt) {
+        return false;
+    }
 
-    mongocrypt_status_t *status = crypt->status;
-    if (crypt->initialized) {
-        CLIENT_ERR("already initialized");
+    if (!crypt->initialized) {
+        mongocrypt_status_t *status = crypt->status;
+        CLIENT_ERR("mongocrypt_init not called");
         return false;
     }
 
-    crypt->initialized = true;
+    _mongocrypt_cache_clear(&crypt->cache_collinfo);
+    return true;
+}
 
-    if (!mongocrypt_status_ok(crypt->status)) {
+bool mongocrypt_invalidate_key(mongocrypt_t *crypt, mongocrypt_binary_t *key_id) {
+    _mongocrypt_cache_key_attr_t *attr;
+    _mongocrypt_buffer_t id;
+    mongocrypt_status_t *status;
+    bool ok;
+
+    if (!crypt) {
         return false;
     }
+    status = crypt->status;
 
-    if (!_mongocrypt_opts_validate(&crypt->opts, status)) {
+    if (!crypt->initialized) {
+        CLIENT_ERR("mongocrypt_init not called");
         return false;
     }
 
-    if (crypt->opts.log_fn) {
-        _mongocrypt_log_set_fn(&crypt->log, crypt->opts.log_fn, crypt->opts.log_ctx);
+    if (!key_id || mongocrypt_binary_len(key_id) != UUID_LEN) {
+        CLIENT_ERR("invalid key ID, expected a %d byte UUID", UUID_LEN);
+        return false;
     }
 
-    if (!crypt->crypto) {
-#ifndef MONGOCRYPT_ENABLE_CRYPTO
-        CLIENT_ERR("libmongocrypt built with native crypto disabled. crypto "
-                   "hooks required");
+    _mongocrypt_buffer_from_binary(&id, key_id);
+    id.subtype = BSON_SUBTYPE_UUID;
+    attr = _mongocrypt_cache_key_attr_new(&id, NULL);
+    ok = _mongocrypt_cache_remove(_mongocrypt_key_cache(crypt), attr, status);
+    _mongocrypt_cache_key_attr_destroy(attr);
+    /* Deterministic ciphertexts are reached without the key. */
+    _mongocrypt_cache_deterministic_remove_key(&crypt->cache_deterministic, &id);
+    return ok;
+}
+
+bool mongocrypt_invalidate_all_keys(mongocrypt_t *crypt) {
+    if (!crypt) {
         return false;
-#else
-        /* set default hooks. */
-        crypt->crypto = bson_malloc0(sizeof(*crypt->crypto));
-        BSON_ASSERT(crypt->crypto);
-#endif
     }
 
-    if (!_wants_csfle(crypt)) {
-        // User does not want csfle. Just succeed.
-        return true;
+    if (!crypt->initialized) {
+        mongocrypt_status_t *status = crypt->status;
+        CLIENT_ERR("mongocrypt_init not called");
+        return false;
     }
 
-    return _try_enable_csfle(crypt);
-}
-
-bool mongocrypt_is_crypto_available(void) {
-#ifdef MONGOCRYPT_ENABLE_CRYPTO
+    _mongocrypt_cache_clear(_mongocrypt_key_cache(crypt));
+    _mongocrypt_cache_clear(&crypt->cache_deterministic);
     return true;
-#else
-    return false;
-#endif
 }
 
-bool mongocrypt_status(mongocrypt_t *crypt, mongocrypt_status_t *out) {
-    BSON_ASSERT_PARAM(crypt);
+/* Replaces the schema map, or the encrypted field config map if @is_efc_map.
+ * The new map is compiled without the mutex. Contexts that acquired the old
+ * map keep using it. */
+static bool _update_schema_map(mongocrypt_t *crypt, mongocrypt_binary_t *map, bool is_efc_map) {
+    const char *name = is_efc_map ? "encrypted_field_config_map" : "schema map";
+    _mongocrypt_buffer_t map_buf;
+    mc_mapof_ns_to_schema_t *n2s;
+    mongocrypt_status_t *status;
+    bson_error_t bson_err;
+    bson_t as_bson;
+    bool ok = false;
 
-    if (!out) {
-        mongocrypt_status_t *status = crypt->status;
-        CLIENT_ERR("argument 'out' is required");
+    if (!crypt) {
         return false;
     }
+    status = crypt->status;
 
-    if (!mongocrypt_status_ok(crypt->status)) {
-        _mongocrypt_status_copy_to(crypt->status, out);
+    if (!crypt->initialized) {
+        CLIENT_ERR("mongocrypt_init not called");
         return false;
     }
-    _mongocrypt_status_reset(out);
-    return true;
-}
 
-void mongocrypt_destroy(mongocrypt_t *crypt) {
-    if (!crypt) {
-        return;
+    if (!map || !mongocrypt_binary_data(map)) {
+        CLIENT_ERR("passed null %s", name);
+        return false;
     }
-    _mongocrypt_opts_cleanup(&crypt->opts);
-    _mongocrypt_cache_cleanup(&crypt->cache_collinfo);
-    _mongocrypt_cache_cleanup(&crypt->cache_key);
-    _mongocrypt_mutex_cleanup(&crypt->mutex);
-    _mongocrypt_log_cleanup(&crypt->log);
-    mongocrypt_status_destroy(crypt->status);
-    bson_free(crypt->crypto);
-    mc_mapof_kmsid_to_token_destroy(crypt->cache_oauth);
 
-    if (crypt->csfle.okay) {
-        _csfle_drop_global_ref();
-        crypt->csfle.okay = false;
+    _mongocrypt_buffer_copy_from_binary(&map_buf, map);
+    if (!_mongocrypt_buffer_to_bson(&map_buf, &as_bson)) {
+        CLIENT_ERR("invalid bson");
+        _mongocrypt_buffer_cleanup(&map_buf);
+        return false;
+    }
+    if (!bson_validate_with_error(&as_bson, BSON_VALIDATE_NONE, &bson_err)) {
+        CLIENT_ERR("%s", bson_err.message);
+        _mongocrypt_buffer_cleanup(&map_buf);
+        return false;
     }
 
-    bson_free(crypt);
+    n2s = mc_mapof_ns_to_schema_new(&map_buf, is_efc_map /* parse_efc */, status);
+    if (!n2s) {
+        _mongocrypt_buffer_cleanup(&map_buf);
+        return false;
+    }
+
+    MONGOCRYPT_WITH_MUTEX(crypt->mutex) {
+        _mongocrypt_buffer_t *opt = is_efc_map ? &crypt->opts.encrypted_field_config_map : &crypt->opts.schema_map;
+        mc_mapof_ns_to_schema_t **current = is_efc_map ? &crypt->encrypted_field_config_map : &crypt->schema_map;
+        mc_mapof_ns_to_schema_t *old;
+
+        if (is_efc_map) {
+            ok = _validate_encrypted_field_config_map_and_schema_map(&map_buf, &crypt->opts.schema_map, status);
+        } else {
+            ok = _validate_encrypted_field_config_map_and_schema_map(&crypt->opts.encrypted_field_config_map,
+                                                                      &map_buf,
+                                                                      status);
+        }
+        if (ok) {
+            _mongocrypt_buffer_cleanup(opt);
+            *opt = map_buf;
+            _mongocrypt_buffer_init(&map_buf);
+            old = *current;
+            *current = n2s;
+            n2s = old;
+        }
+    }
+
+    /* Release the old map, or the new one if it was not used. */
+    mc_mapof_ns_to_schema_destroy(n2s);
+    _mongocrypt_buffer_cleanup(&map_buf);
+    return ok;
+}
+
+bool mongocrypt_update_schema_map(mongocrypt_t *crypt, mongocrypt_binary_t *schema_map) {
+    return _update_schema_map(crypt, schema_map, false /* is_efc_map */);
+}
+
+bool mongocrypt_update_encrypted_field_config_map(mongocrypt_t *crypt, mongocrypt_binary_t *efc_map) {
+    return _update_schema_map(crypt, efc_map, true /* is_efc_map */);
+}
+
+void _mongocrypt_acquire_schema_maps(mongocrypt_t *crypt,
+                                     mc_mapof_ns_to_schema_t **schema_map,
+                                     mc_mapof_ns_to_schema_t **encrypted_field_config_map) {
+    BSON_ASSERT_PARAM(crypt);
+    BSON_ASSERT_PARAM(schema_map);
+    BSON_ASSERT_PARAM(encrypted_field_config_map);
+
+    MONGOCRYPT_WITH_MUTEX(crypt->mutex) {
+        *schema_map = mc_mapof_ns_to_schema_ref(crypt->schema_map);
+        *encrypted_field_config_map = mc_mapof_ns_to_schema_ref(crypt->encrypted_field_config_map);
+    }
+}
+
+_mongocrypt_cache_t *_mongocrypt_key_cache(mongocrypt_t *crypt) {
+    BSON_ASSERT_PARAM(crypt);
+
+    return crypt->cache_domain ? &crypt->cache_domain->cache_key : &crypt->cache_key;
 }
 
 const char *mongocrypt_crypt_shared_lib_version_string(const mongocrypt_t *crypt, uint32_t *len) {
@@ -996,6 +2405,10 @@ bool mongocrypt_setopt_crypto_hooks(mongocrypt_t *crypt,
     ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
 
     mongocrypt_status_t *status = crypt->status;
+#ifndef MONGOCRYPT_ENABLE_CRYPTO_HOOKS
+    CLIENT_ERR("crypto hooks are disabled in this build of libmongocrypt");
+    return false;
+#endif
 
     if (!crypt->crypto) {
         crypt->crypto = bson_malloc0(sizeof(*crypt->crypto));
@@ -1067,6 +2480,10 @@ bool mongocrypt_setopt_aes_256_ctr(mongocrypt_t *crypt,
     ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
 
     mongocrypt_status_t *status = crypt->status;
+#ifndef MONGOCRYPT_ENABLE_CRYPTO_HOOKS
+    CLIENT_ERR("crypto hooks are disabled in this build of libmongocrypt");
+    return false;
+#endif
 
     if (!crypt->crypto) {
         crypt->crypto = bson_malloc0(sizeof(*crypt->crypto));
@@ -1092,13 +2509,18 @@ bool mongocrypt_setopt_aes_256_ctr(mongocrypt_t *crypt,
 bool mongocrypt_setopt_aes_256_ecb(mongocrypt_t *crypt, mongocrypt_crypto_fn aes_256_ecb_encrypt, void *ctx) {
     ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
 
+    mongocrypt_status_t *status = crypt->status;
+#ifndef MONGOCRYPT_ENABLE_CRYPTO_HOOKS
+    CLIENT_ERR("crypto hooks are disabled in this build of libmongocrypt");
+    return false;
+#endif
+
     if (!crypt->crypto) {
         crypt->crypto = bson_malloc0(sizeof(*crypt->crypto));
         BSON_ASSERT(crypt->crypto);
     }
 
     if (!aes_256_ecb_encrypt) {
-        mongocrypt_status_t *status = crypt->status;
         CLIENT_ERR("aes_256_ecb_encrypt not set");
         return false;
     }
@@ -1108,6 +2530,84 @@ bool mongocrypt_setopt_aes_256_ecb(mongocrypt_t *crypt, mongocrypt_crypto_fn aes
     return true;
 }
 
+bool mongocrypt_setopt_crypto_hook_hmac_sha_256_batch(mongocrypt_t *crypt,
+                                                       mongocrypt_hmac_batch_fn hmac_sha_256_batch,
+                                                       void *ctx) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    mongocrypt_status_t *status = crypt->status;
+#ifndef MONGOCRYPT_ENABLE_CRYPTO_HOOKS
+    CLIENT_ERR("crypto hooks are disabled in this build of libmongocrypt");
+    return false;
+#endif
+
+    if (!crypt->crypto || !crypt->crypto->hooks_enabled) {
+        CLIENT_ERR("crypto hooks must be set before hmac_sha_256_batch");
+        return false;
+    }
+
+    if (!hmac_sha_256_batch) {
+        CLIENT_ERR("hmac_sha_256_batch not set");
+        return false;
+    }
+
+    crypt->crypto->hmac_sha_256_batch = hmac_sha_256_batch;
+
+    return true;
+}
+
+bool mongocrypt_setopt_parallel_for(mongocrypt_t *crypt, mongocrypt_parallel_for_fn parallel_for, void *ctx) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    mongocrypt_status_t *status = crypt->status;
+
+    if (!parallel_for) {
+        CLIENT_ERR("parallel_for not set");
+        return false;
+    }
+
+    BSON_ASSERT(crypt->crypto);
+    crypt->crypto->parallel_for = parallel_for;
+    crypt->crypto->parallel_for_ctx = ctx;
+
+    return true;
+}
+
+bool mongocrypt_setopt_parallel_marking_threshold(mongocrypt_t *crypt, uint32_t min_markings) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    crypt->opts.parallel_marking_threshold = min_markings;
+    return true;
+}
+
+bool mongocrypt_setopt_parallel_decrypt_threshold(mongocrypt_t *crypt, uint32_t min_ciphertexts) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    crypt->opts.parallel_decrypt_threshold = min_ciphertexts;
+    return true;
+}
+
+bool mongocrypt_setopt_parallel_key_unwrap_threshold(mongocrypt_t *crypt, uint32_t min_keys) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    crypt->opts.parallel_key_unwrap_threshold = min_keys;
+    return true;
+}
+
+bool mongocrypt_setopt_lock_key_material(mongocrypt_t *crypt) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    crypt->opts.lock_key_material = true;
+    return true;
+}
+
+bool mongocrypt_setopt_eager_crypto_init(mongocrypt_t *crypt) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    crypt->opts.eager_crypto_init = true;
+    return true;
+}
+
 bool mongocrypt_setopt_kms_providers(mongocrypt_t *crypt, mongocrypt_binary_t *kms_providers_definition) {
     ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
     BSON_ASSERT_PARAM(kms_providers_definition);
@@ -1149,6 +2649,12 @@ void mongocrypt_setopt_use_need_mongo_collinfo_with_db_state(mongocrypt_t *crypt
     crypt->opts.use_need_mongo_collinfo_with_db_state = true;
 }
 
+void mongocrypt_setopt_use_need_mongo_ops_state(mongocrypt_t *crypt) {
+    BSON_ASSERT_PARAM(crypt);
+
+    crypt->opts.use_need_mongo_ops_state = true;
+}
+
 void mongocrypt_setopt_set_crypt_shared_lib_path_override(mongocrypt_t *crypt, const char *path) {
     BSON_ASSERT_PARAM(crypt);
     BSON_ASSERT_PARAM(path);
@@ -1183,8 +2689,111 @@ bool _mongocrypt_needs_credentials_for_provider(mongocrypt_t *crypt,
     return (crypt->opts.kms_providers.need_credentials & (int)provider) != 0;
 }
 
+bool mongocrypt_setopt_kms_credentials_cache_expiration_ms(mongocrypt_t *crypt, uint64_t expiration_ms) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    mongocrypt_status_t *status = crypt->status;
+
+    if (expiration_ms > INT64_MAX / 1000) {
+        CLIENT_ERR("KMS credentials cache expiration must be at most INT64_MAX / 1000");
+        return false;
+    }
+    crypt->opts.kms_credentials_cache_expiration_ms = expiration_ms;
+    return true;
+}
+
+void _mongocrypt_cache_kms_credentials(mongocrypt_t *crypt, mongocrypt_binary_t *kms_providers) {
+    BSON_ASSERT_PARAM(crypt);
+    BSON_ASSERT_PARAM(kms_providers);
+
+    if (crypt->opts.kms_credentials_cache_expiration_ms == 0) {
+        return;
+    }
+
+    MONGOCRYPT_WITH_MUTEX(crypt->mutex) {
+        _mongocrypt_buffer_cleanup(&crypt->cached_kms_credentials);
+        _mongocrypt_buffer_copy_from_binary(&crypt->cached_kms_credentials, kms_providers);
+        crypt->cached_kms_credentials_expires_us =
+            bson_get_monotonic_time() + (int64_t)crypt->opts.kms_credentials_cache_expiration_ms * 1000;
+    }
+}
+
+bool _mongocrypt_get_cached_kms_credentials(mongocrypt_t *crypt, _mongocrypt_buffer_t *out) {
+    bool found = false;
+
+    BSON_ASSERT_PARAM(crypt);
+    BSON_ASSERT_PARAM(out);
+
+    if (crypt->opts.kms_credentials_cache_expiration_ms == 0) {
+        return false;
+    }
+
+    MONGOCRYPT_WITH_MUTEX(crypt->mutex) {
+        if (!_mongocrypt_buffer_empty(&crypt->cached_kms_credentials)
+            && bson_get_monotonic_time() < crypt->cached_kms_credentials_expires_us) {
+            _mongocrypt_buffer_copy_to(&crypt->cached_kms_credentials, out);
+            found = true;
+        }
+    }
+    return found;
+}
+
 void mongocrypt_setopt_bypass_query_analysis(mongocrypt_t *crypt) {
     BSON_ASSERT_PARAM(crypt);
 
     crypt->opts.bypass_query_analysis = true;
 }
+
+bool mongocrypt_setopt_defer_crypt_shared_load(mongocrypt_t *crypt) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    crypt->opts.defer_crypt_shared_load = true;
+    return true;
+}
+
+bool mongocrypt_setopt_key_cache_shared_hooks(mongocrypt_t *crypt,
+                                              mongocrypt_binary_t *kek,
+                                              mongocrypt_key_cache_load_fn load,
+                                              mongocrypt_key_cache_store_fn store,
+                                              void *ctx) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    mongocrypt_status_t *status = crypt->status;
+
+    if (!load || !store) {
+        CLIENT_ERR("shared key cache hooks must both be set");
+        return false;
+    }
+
+    if (!kek || mongocrypt_binary_len(kek) != MONGOCRYPT_KEY_LEN) {
+        CLIENT_ERR("shared key cache kek must be %d bytes", MONGOCRYPT_KEY_LEN);
+        return false;
+    }
+
+    _mongocrypt_buffer_cleanup(&crypt->opts.key_cache_shared_kek);
+    _mongocrypt_buffer_copy_from_binary(&crypt->opts.key_cache_shared_kek, kek);
+    crypt->opts.key_cache_load = load;
+    crypt->opts.key_cache_store = store;
+    crypt->opts.key_cache_shared_ctx = ctx;
+    return true;
+}
+
+bool mongocrypt_setopt_cache_domain(mongocrypt_t *crypt, const char *name, int32_t len) {
+    ASSERT_MONGOCRYPT_PARAM_UNINIT(crypt);
+
+    mongocrypt_status_t *status = crypt->status;
+
+    if (crypt->opts.cache_domain) {
+        CLIENT_ERR("cache domain already set");
+        return false;
+    }
+
+    if (!_mongocrypt_validate_and_copy_string(name, len, &crypt->opts.cache_domain)
+        || 0 == strlen(crypt->opts.cache_domain)) {
+        bson_free(crypt->opts.cache_domain);
+        crypt->opts.cache_domain = NULL;
+        CLIENT_ERR("invalid cache domain name");
+        return false;
+    }
+    return true;
+}
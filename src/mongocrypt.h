@@ -26,6 +26,8 @@
 #include "mongocrypt-compat.h"
 #include "mongocrypt-export.h"
 
+#include <stddef.h> /* size_t */
+
 /* clang-format off */
 #ifndef __has_include
    #include "mongocrypt-config.h"
@@ -280,6 +282,12 @@ typedef void (*mongocrypt_log_fn_t)(mongocrypt_log_level_t level, const char *me
  * thread. See each handle's documentation for thread-safety considerations.
  *
  * Multiple mongocrypt_t handles may be created.
+ *
+ * On POSIX, a mongocrypt_t may be used in a child process created with fork,
+ * for example by a pre-fork server that warms the caches before forking
+ * workers. Cached keys, collection info and access tokens are kept in the
+ * child. Fork while no other thread is using the handle, and do not use a
+ * mongocrypt_ctx_t created before the fork in the child.
  */
 typedef struct _mongocrypt_t mongocrypt_t;
 
@@ -310,6 +318,67 @@ mongocrypt_t *mongocrypt_new(void);
 MONGOCRYPT_EXPORT
 bool mongocrypt_setopt_log_handler(mongocrypt_t *crypt, mongocrypt_log_fn_t log_fn, void *log_ctx);
 
+/**
+ * Set the least severe level of messages passed to the log handler.
+ *
+ * Messages less severe than @p level are dropped before they are formatted.
+ * The default is MONGOCRYPT_LOG_LEVEL_TRACE, which passes all messages. Trace
+ * messages are only logged if the MONGOCRYPT_TRACE environment variable is
+ * set.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] level The least severe @ref mongocrypt_log_level_t to log.
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_log_level(mongocrypt_t *crypt, mongocrypt_log_level_t level);
+
+/**
+ * An allocation callback. Set with @ref mongocrypt_setopt_allocator.
+ *
+ * @param[in] size The number of bytes to allocate.
+ * @param[in] ctx A context provided by the caller of @ref
+ * mongocrypt_setopt_allocator.
+ * @returns The allocated memory, or NULL on failure. The memory must be
+ * aligned like memory returned by malloc.
+ */
+typedef void *(*mongocrypt_malloc_fn_t)(size_t size, void *ctx);
+
+/**
+ * A deallocation callback. Set with @ref mongocrypt_setopt_allocator.
+ *
+ * @param[in] ptr Memory returned by the @ref mongocrypt_malloc_fn_t callback.
+ * @param[in] size The size @p ptr was allocated with. The memory may have held
+ * key material, so it may be zeroed before it is freed.
+ * @param[in] ctx A context provided by the caller of @ref
+ * mongocrypt_setopt_allocator.
+ */
+typedef void (*mongocrypt_free_fn_t)(void *ptr, size_t size, void *ctx);
+
+/**
+ * Set an allocator for the memory owned by contexts of a @ref mongocrypt_t.
+ *
+ * Contexts and the key requests and keys of their key brokers are allocated
+ * with @p malloc_fn and freed with @p free_fn. Other memory, including BSON
+ * documents and memory of kms-message, is still allocated through libbson and
+ * the C library.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] malloc_fn The allocation callback.
+ * @param[in] free_fn The deallocation callback.
+ * @param[in] ctx A context passed as an argument to the callbacks.
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_allocator(mongocrypt_t *crypt,
+                                 mongocrypt_malloc_fn_t malloc_fn,
+                                 mongocrypt_free_fn_t free_fn,
+                                 void *ctx);
+
 /**
  * Configure an AWS KMS provider on the @ref mongocrypt_t object.
  *
@@ -399,6 +468,62 @@ bool mongocrypt_setopt_schema_map(mongocrypt_t *crypt, mongocrypt_binary_t *sche
 MONGOCRYPT_EXPORT
 bool mongocrypt_setopt_encrypted_field_config_map(mongocrypt_t *crypt, mongocrypt_binary_t *efc_map);
 
+/**
+ * Replace the local schema map of an initialized @ref mongocrypt_t.
+ *
+ * Caches and the loaded crypt_shared library are kept. Contexts that already
+ * looked up their schema keep using the previous map. Later contexts use the
+ * new map. An empty document removes all schemas.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object after a successful call to
+ * mongocrypt_init.
+ * @param[in] schema_map A BSON document, as passed to @ref
+ * mongocrypt_setopt_schema_map. The viewed data is copied. No namespace may
+ * also be in the encrypted field config map.
+ * @returns A boolean indicating success. If false, the map is unchanged and an
+ * error status is set. Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_update_schema_map(mongocrypt_t *crypt, mongocrypt_binary_t *schema_map);
+
+/**
+ * Replace the local EncryptedFieldConfigMap of an initialized @ref
+ * mongocrypt_t, like @ref mongocrypt_update_schema_map.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object after a successful call to
+ * mongocrypt_init.
+ * @param[in] efc_map A BSON document, as passed to @ref
+ * mongocrypt_setopt_encrypted_field_config_map. The viewed data is copied. No
+ * namespace may also be in the schema map.
+ * @returns A boolean indicating success. If false, the map is unchanged and an
+ * error status is set. Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_update_encrypted_field_config_map(mongocrypt_t *crypt, mongocrypt_binary_t *efc_map);
+
+/**
+ * Set an offline snapshot of the key vault collection.
+ *
+ * Keys requested by a context are taken from the snapshot instead of the key
+ * vault collection. If the snapshot has every requested key, the context does
+ * not enter @ref MONGOCRYPT_CTX_NEED_MONGO_KEYS. Keys that are not in the
+ * snapshot are still requested in @ref MONGOCRYPT_CTX_NEED_MONGO_KEYS. The key
+ * material of keys from the snapshot is decrypted with KMS as usual.
+ *
+ * The snapshot is indexed by _id and keyAltNames in @ref mongocrypt_init.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] key_docs The key documents as a sequence of BSON documents, as
+ * written by mongodump. A snapshot file may be memory-mapped and passed
+ * directly. The viewed data is copied. It is valid to destroy @p key_docs with
+ * @ref mongocrypt_binary_destroy immediately after.
+ * @pre @p crypt has not been initialized.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_key_vault_snapshot(mongocrypt_t *crypt, mongocrypt_binary_t *key_docs);
+
 /**
  * @brief Append an additional search directory to the search path for loading
  * the crypt_shared dynamic library.
@@ -473,6 +598,29 @@ void mongocrypt_setopt_set_crypt_shared_lib_path_override(mongocrypt_t *crypt, c
 MONGOCRYPT_EXPORT
 void mongocrypt_setopt_use_need_kms_credentials_state(mongocrypt_t *crypt);
 
+/**
+ * @brief Reuse on-demand KMS credentials across contexts.
+ *
+ * By default, every context that needs KMS credentials enters the
+ * MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS state. If set, the credentials last
+ * passed to @ref mongocrypt_ctx_provide_kms_providers are cached for @p
+ * expiration_ms milliseconds, and contexts of automatic or explicit encryption
+ * and decryption use them instead of entering the state. Data key and rewrap
+ * contexts always enter the state.
+ *
+ * Temporary credentials, such as AWS session credentials or an Azure or GCP
+ * access token, must stay valid for @p expiration_ms after they are provided.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object to update
+ * @param[in] expiration_ms The lifetime of cached credentials. 0 disables the
+ * cache, the default.
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_kms_credentials_cache_expiration_ms(mongocrypt_t *crypt, uint64_t expiration_ms);
+
 /**
  * @brief Opt-into handling the MONGOCRYPT_CTX_NEED_MONGO_COLLINFO_WITH_DB state.
  *
@@ -480,11 +628,30 @@ void mongocrypt_setopt_use_need_kms_credentials_state(mongocrypt_t *crypt);
  * processing a `bulkWrite` command. The target database of the `bulkWrite` may differ from the command database
  * ("admin").
  *
+ * A `bulkWrite` with namespaces in more than one database enters the state once per database. Call
+ * @ref mongocrypt_ctx_mongo_db each time to get the database to run `listCollections` on.
+ *
  * @param[in] crypt The @ref mongocrypt_t object to update
  */
 MONGOCRYPT_EXPORT
 void mongocrypt_setopt_use_need_mongo_collinfo_with_db_state(mongocrypt_t *crypt);
 
+/**
+ * @brief Opt-into handling the MONGOCRYPT_CTX_NEED_MONGO_OPS state.
+ *
+ * A context enters the MONGOCRYPT_CTX_NEED_MONGO_OPS state when it has more
+ * than one MongoDB operation that may run at once. Currently this is a
+ * `bulkWrite` with namespaces in more than one database: each `listCollections`
+ * and the `find` of the keys of the already known encryptedFields are returned
+ * together rather than in one state per database.
+ *
+ * Requires @ref mongocrypt_setopt_use_need_mongo_collinfo_with_db_state.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object to update
+ */
+MONGOCRYPT_EXPORT
+void mongocrypt_setopt_use_need_mongo_ops_state(mongocrypt_t *crypt);
+
 /**
  * Initialize new @ref mongocrypt_t object.
  *
@@ -565,694 +732,2813 @@ MONGOCRYPT_EXPORT
 uint64_t mongocrypt_crypt_shared_lib_version(const mongocrypt_t *crypt);
 
 /**
- * Manages the state machine for encryption or decryption.
+ * Export the decrypted data keys in the key cache.
+ *
+ * The decrypted key material is re-encrypted with @p kek in the same way as
+ * the "local" KMS provider. The snapshot can be imported into another
+ * @ref mongocrypt_t with @ref mongocrypt_import_key_cache so it does not need
+ * to decrypt those keys with a KMS again. Only keys that have not yet expired
+ * from the cache are exported.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object after a successful call to
+ * mongocrypt_init.
+ * @param[in] kek A 96 byte key used to encrypt the key material.
+ * @param[out] snapshot Receives the snapshot as a BSON document. The data is
+ * owned by @p crypt and is valid until the next call to
+ * @ref mongocrypt_export_key_cache or @ref mongocrypt_destroy. Calls must not
+ * overlap.
+ *
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
  */
-typedef struct _mongocrypt_ctx_t mongocrypt_ctx_t;
+MONGOCRYPT_EXPORT
+bool mongocrypt_export_key_cache(mongocrypt_t *crypt, mongocrypt_binary_t *kek, mongocrypt_binary_t *snapshot);
 
 /**
- * Create a new uninitialized @ref mongocrypt_ctx_t.
+ * Import a snapshot created by @ref mongocrypt_export_key_cache into the key
+ * cache.
  *
- * Initialize the context with functions like @ref mongocrypt_ctx_encrypt_init.
- * When done, destroy it with @ref mongocrypt_ctx_destroy.
+ * Keys keep the age they had when exported. The time between the export and
+ * the import is not counted. Keys already expired are skipped. The snapshot
+ * is not retained.
  *
- * @param[in] crypt The @ref mongocrypt_t object.
- * @returns A new context.
+ * @param[in] crypt The @ref mongocrypt_t object after a successful call to
+ * mongocrypt_init.
+ * @param[in] kek The 96 byte key passed to @ref mongocrypt_export_key_cache.
+ * @param[in] snapshot The BSON snapshot.
+ *
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
  */
 MONGOCRYPT_EXPORT
-mongocrypt_ctx_t *mongocrypt_ctx_new(mongocrypt_t *crypt);
+bool mongocrypt_import_key_cache(mongocrypt_t *crypt, mongocrypt_binary_t *kek, mongocrypt_binary_t *snapshot);
 
 /**
- * Get the status associated with a @ref mongocrypt_ctx_t object.
+ * Queue key documents to be decrypted into the key cache before they are
+ * needed, for example documents read from a change stream or a periodic scan
+ * of the key vault collection.
  *
- * @param[in] ctx The @ref mongocrypt_ctx_t object.
- * @param[out] status Receives the status.
+ * The documents are only parsed. Their key material is decrypted by the next
+ * context initialized with @ref mongocrypt_ctx_unwrap_pending_keys_init. Once
+ * cached, contexts using the keys do not enter
+ * @ref MONGOCRYPT_CTX_NEED_MONGO_KEYS for them.
  *
- * @returns True if the output is an ok status, false if it is an error
- * status.
+ * This method expects the passed-in BSON to be of the form:
+ * { "keys" : [ key document, ... ] }
  *
- * @see mongocrypt_status_ok
+ * @param[in] crypt The @ref mongocrypt_t object after a successful call to
+ * mongocrypt_init.
+ * @param[in] key_docs A BSON document holding the key documents. The viewed
+ * data is copied. If any key document is invalid, none are queued.
+ *
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
  */
 MONGOCRYPT_EXPORT
-bool mongocrypt_ctx_status(mongocrypt_ctx_t *ctx, mongocrypt_status_t *status);
+bool mongocrypt_add_key_documents(mongocrypt_t *crypt, mongocrypt_binary_t *key_docs);
 
 /**
- * Set the key id to use for explicit encryption.
+ * Remove the cached collection info of a namespace, for example after a DDL
+ * command changed its schema or encryptedFields. The next context targeting
+ * the namespace enters @ref MONGOCRYPT_CTX_NEED_MONGO_COLLINFO. Contexts that
+ * already have the collection info keep using it.
  *
- * It is an error to set both this and the key alt name.
+ * @param[in] crypt The @ref mongocrypt_t object after a successful call to
+ * mongocrypt_init.
+ * @param[in] ns The namespace, as "<db>.<collection>".
+ * @param[in] len The length of @p ns. Pass -1 if @p ns is NULL terminated.
  *
- * @param[in] ctx The @ref mongocrypt_ctx_t object.
- * @param[in] key_id The binary corresponding to the _id (a UUID) of the data
- * key to use from the key vault collection. Note, the UUID must be encoded with
- * RFC-4122 byte order. The viewed data is copied. It is valid to destroy
- * @p key_id with @ref mongocrypt_binary_destroy immediately after.
- * @pre @p ctx has not been initialized.
  * @returns A boolean indicating success. If false, an error status is set.
- * Retrieve it with @ref mongocrypt_ctx_status
+ * Retrieve it with @ref mongocrypt_status
  */
 MONGOCRYPT_EXPORT
-bool mongocrypt_ctx_setopt_key_id(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *key_id);
+bool mongocrypt_invalidate_collinfo(mongocrypt_t *crypt, const char *ns, int32_t len);
 
 /**
- * Set the keyAltName to use for explicit encryption or
- * data key creation.
- *
- * Pass the binary encoding a BSON document like the following:
- *
- *   { "keyAltName" : (BSON UTF8 value) }
- *
- * For explicit encryption, it is an error to set both the keyAltName
- * and the key id.
+ * Remove all cached collection info.
  *
- * For creating data keys, call this function repeatedly to set
- * multiple keyAltNames.
+ * @param[in] crypt The @ref mongocrypt_t object after a successful call to
+ * mongocrypt_init.
  *
- * @param[in] ctx The @ref mongocrypt_ctx_t object.
- * @param[in] key_alt_name The name to use. The viewed data is copied. It is
- * valid to destroy @p key_alt_name with @ref mongocrypt_binary_destroy
- * immediately after.
- * @pre @p ctx has not been initialized.
  * @returns A boolean indicating success. If false, an error status is set.
- * Retrieve it with @ref mongocrypt_ctx_status
+ * Retrieve it with @ref mongocrypt_status
  */
 MONGOCRYPT_EXPORT
-bool mongocrypt_ctx_setopt_key_alt_name(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *key_alt_name);
+bool mongocrypt_invalidate_all_collinfo(mongocrypt_t *crypt);
 
 /**
- * Set the keyMaterial to use for encrypting data.
+ * Remove a data key from the key cache, for example after it was deleted or
+ * its keyAltNames changed. The next context using the key fetches it again.
+ * Ciphertexts of the key cached with @ref
+ * mongocrypt_setopt_deterministic_cache_max_entries are removed too.
  *
- * Pass the binary encoding of a BSON document like the following:
+ * With @ref mongocrypt_setopt_cache_domain, the key is removed from the cache
+ * shared by the domain. A cache set with @ref
+ * mongocrypt_setopt_key_cache_shared_hooks is not changed.
  *
- *   { "keyMaterial" : (BSON BINARY value) }
+ * @param[in] crypt The @ref mongocrypt_t object after a successful call to
+ * mongocrypt_init.
+ * @param[in] key_id The 16 byte UUID of the data key.
  *
- * @param[in] ctx The @ref mongocrypt_ctx_t object.
- * @param[in] key_material The data encryption key to use. The viewed data is
- * copied. It is valid to destroy @p key_material with @ref
- * mongocrypt_binary_destroy immediately after.
- * @pre @p ctx has not been initialized.
  * @returns A boolean indicating success. If false, an error status is set.
- * Retrieve it with @ref mongocrypt_ctx_status
+ * Retrieve it with @ref mongocrypt_status
  */
 MONGOCRYPT_EXPORT
-bool mongocrypt_ctx_setopt_key_material(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *key_material);
+bool mongocrypt_invalidate_key(mongocrypt_t *crypt, mongocrypt_binary_t *key_id);
 
 /**
- * Set the algorithm used for encryption to either
- * deterministic or random encryption. This value
- * should only be set when using explicit encryption.
- *
- * If -1 is passed in for "len", then "algorithm" is
- * assumed to be a null-terminated string.
+ * Remove all data keys from the key cache, like @ref mongocrypt_invalidate_key.
  *
- * Valid values for algorithm are:
- *   "AEAD_AES_256_CBC_HMAC_SHA_512-Deterministic"
- *   "AEAD_AES_256_CBC_HMAC_SHA_512-Random"
+ * @param[in] crypt The @ref mongocrypt_t object after a successful call to
+ * mongocrypt_init.
  *
- * @param[in] ctx The @ref mongocrypt_ctx_t object.
- * @param[in] algorithm A string specifying the algorithm to
- * use for encryption.
- * @param[in] len The length of the algorithm string.
- * @pre @p ctx has not been initialized.
  * @returns A boolean indicating success. If false, an error status is set.
- * Retrieve it with @ref mongocrypt_ctx_status
+ * Retrieve it with @ref mongocrypt_status
  */
 MONGOCRYPT_EXPORT
-bool mongocrypt_ctx_setopt_algorithm(mongocrypt_ctx_t *ctx, const char *algorithm, int len);
+bool mongocrypt_invalidate_all_keys(mongocrypt_t *crypt);
 
-/// String constant for setopt_algorithm "Deterministic" encryption
-#define MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR "AEAD_AES_256_CBC_HMAC_SHA_512-Deterministic"
-/// String constant for setopt_algorithm "Random" encryption
-#define MONGOCRYPT_ALGORITHM_RANDOM_STR "AEAD_AES_256_CBC_HMAC_SHA_512-Random"
-/// String constant for setopt_algorithm "Indexed" explicit encryption
-#define MONGOCRYPT_ALGORITHM_INDEXED_STR "Indexed"
-/// String constant for setopt_algorithm "Unindexed" explicit encryption
-#define MONGOCRYPT_ALGORITHM_UNINDEXED_STR "Unindexed"
-/// String constant for setopt_algorithm "rangePreview" explicit encryption (deprecated in favor of "range")
-/// NOTE: "rangePreview" is experimental only and is not intended for public use.
-/// API for "rangePreview" may be removed in a future release.
-#define MONGOCRYPT_ALGORITHM_RANGEPREVIEW_DEPRECATED_STR "RangePreview"
-#define MONGOCRYPT_ALGORITHM_RANGE_STR "Range"
+/**
+ * Looks up a data key in a shared key cache.
+ *
+ * @param[in] ctx The context passed to @ref
+ * mongocrypt_setopt_key_cache_shared_hooks.
+ * @param[in] key_id The UUID bytes of the data key.
+ * @param[out] out A buffer to copy the stored snapshot into.
+ * @param[out] len Set to the length of the stored snapshot, or 0 if none is
+ * stored. If the snapshot is longer than @p out, set @p len without copying it.
+ * The function is called again with a buffer of at least @p len bytes.
+ * @param[out] status An optional status to pass error messages. See @ref
+ * mongocrypt_status_set.
+ * @returns A boolean indicating success. If returning false, set @p status
+ * with a message indiciating the error using @ref mongocrypt_status_set.
+ */
+typedef bool (*mongocrypt_key_cache_load_fn)(void *ctx,
+                                             mongocrypt_binary_t *key_id,
+                                             mongocrypt_binary_t *out,
+                                             uint32_t *len,
+                                             mongocrypt_status_t *status);
 
 /**
- * Identify the AWS KMS master key to use for creating a data key.
+ * Stores a data key in a shared key cache.
  *
- * This has been superseded by the more flexible:
- * @ref mongocrypt_ctx_setopt_key_encryption_key
+ * @param[in] ctx The context passed to @ref
+ * mongocrypt_setopt_key_cache_shared_hooks.
+ * @param[in] key_id The UUID bytes of the data key.
+ * @param[in] snapshot The snapshot to store for @p key_id. The data is only
+ * valid during the call.
+ * @param[out] status An optional status to pass error messages. See @ref
+ * mongocrypt_status_set.
+ * @returns A boolean indicating success. If returning false, set @p status
+ * with a message indiciating the error using @ref mongocrypt_status_set.
+ */
+typedef bool (*mongocrypt_key_cache_store_fn)(void *ctx,
+                                              mongocrypt_binary_t *key_id,
+                                              mongocrypt_binary_t *snapshot,
+                                              mongocrypt_status_t *status);
+
+/**
+ * Set hooks to share decrypted data keys with other processes.
  *
- * @param[in] ctx The @ref mongocrypt_ctx_t object.
- * @param[in] region The AWS region.
- * @param[in] region_len The string length of @p region. Pass -1 to determine
- * the string length with strlen (must be NULL terminated).
- * @param[in] cmk The Amazon Resource Name (ARN) of the customer master key
- * (CMK).
- * @param[in] cmk_len The string length of @p cmk_len. Pass -1 to determine the
- * string length with strlen (must be NULL terminated).
- * @pre @p ctx has not been initialized.
+ * The hooks back a second tier of the key cache, for example in shared memory
+ * of the processes of a host. When a key is not in the key cache, @p load is
+ * called with its id, and a stored snapshot is imported as with @ref
+ * mongocrypt_import_key_cache. After a key is decrypted with a KMS, @p store
+ * is called with a snapshot of only that key, as created by @ref
+ * mongocrypt_export_key_cache. Keys looked up by keyAltName are only shared
+ * once they are in the key cache by id.
+ *
+ * The snapshots are encrypted with @p kek. All processes sharing the tier must
+ * use the same @p kek, such as a random key generated by a parent process.
+ * Snapshots do not record when they were stored, so the store should discard
+ * them after the key cache expiration. The hooks may be called concurrently
+ * from the threads using @p crypt.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] kek A 96 byte key used to encrypt the key material.
+ * @param[in] load Looks up a snapshot of a key.
+ * @param[in] store Stores a snapshot of a key.
+ * @param[in] ctx A context passed to the hooks.
+ *
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
  * @returns A boolean indicating success. If false, an error status is set.
- * Retrieve it with @ref mongocrypt_ctx_status
+ * Retrieve it with @ref mongocrypt_status
  */
 MONGOCRYPT_EXPORT
-bool mongocrypt_ctx_setopt_masterkey_aws(mongocrypt_ctx_t *ctx,
-                                         const char *region,
-                                         int32_t region_len,
-                                         const char *cmk,
-                                         int32_t cmk_len);
+bool mongocrypt_setopt_key_cache_shared_hooks(mongocrypt_t *crypt,
+                                              mongocrypt_binary_t *kek,
+                                              mongocrypt_key_cache_load_fn load,
+                                              mongocrypt_key_cache_store_fn store,
+                                              void *ctx);
 
 /**
- * Identify a custom AWS endpoint when creating a data key.
- * This is used internally to construct the correct HTTP request
- * (with the Host header set to this endpoint). This endpoint
- * is persisted in the new data key, and will be returned via
- * @ref mongocrypt_kms_ctx_endpoint.
+ * @brief Set how long to cache data keys.
  *
- * This has been superseded by the more flexible:
- * @ref mongocrypt_ctx_setopt_key_encryption_key
+ * Decrypted data keys are cached for 60 seconds by default. A longer lifetime
+ * makes fewer KMS requests, at the cost of using a key for longer after it is
+ * changed or its KMS access is revoked.
  *
- * @param[in] ctx The @ref mongocrypt_ctx_t object.
- * @param[in] endpoint The endpoint.
- * @param[in] endpoint_len The string length of @p endpoint. Pass -1 to
- * determine the string length with strlen (must be NULL terminated).
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] cache_expiration_ms The lifetime in milliseconds, or 0 for keys
+ * to never expire. Must be at most INT64_MAX.
+ *
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
  * @returns A boolean indicating success. If false, an error status is set.
- * Retrieve it with @ref mongocrypt_ctx_status
+ * Retrieve it with @ref mongocrypt_status
  */
 MONGOCRYPT_EXPORT
-bool mongocrypt_ctx_setopt_masterkey_aws_endpoint(mongocrypt_ctx_t *ctx, const char *endpoint, int32_t endpoint_len);
+bool mongocrypt_setopt_key_expiration(mongocrypt_t *crypt, uint64_t cache_expiration_ms);
 
 /**
- * Set the master key to "local" for creating a data key.
- * This has been superseded by the more flexible:
- * @ref mongocrypt_ctx_setopt_key_encryption_key
+ * @brief Set how long to cache data keys of some KMS providers.
  *
- * @param[in] ctx The @ref mongocrypt_ctx_t object.
- * @pre @p ctx has not been initialized.
+ * Overrides @ref mongocrypt_setopt_key_expiration for data keys whose
+ * masterKey has one of the given KMS providers. @p expirations is a BSON
+ * document of lifetimes in milliseconds by KMS provider name, where 0 means
+ * keys never expire. Names are matched exactly, so a named KMS provider like
+ * "kmip:name" needs its own entry. Example:
+ * { "local": 600000, "kmip": 600000, "aws": 30000 }.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] expirations A BSON document mapping KMS provider names to
+ * non-negative integer lifetimes. The viewed data is copied.
+ *
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
  * @returns A boolean indicating success. If false, an error status is set.
- * Retrieve it with @ref mongocrypt_ctx_status
+ * Retrieve it with @ref mongocrypt_status
  */
 MONGOCRYPT_EXPORT
-bool mongocrypt_ctx_setopt_masterkey_local(mongocrypt_ctx_t *ctx);
+bool mongocrypt_setopt_key_expiration_by_kms_provider(mongocrypt_t *crypt, mongocrypt_binary_t *expirations);
 
 /**
- * Set key encryption key document for creating a data key or for rewrapping
- * datakeys.
+ * @brief Opt-into refreshing cached data keys before they expire.
  *
- * @param[in] ctx The @ref mongocrypt_ctx_t object.
- * @param[in] bin BSON representing the key encryption key document with
- * an additional "provider" field. The following forms are accepted:
+ * Data keys are cached for 60 seconds, or as set with
+ * @ref mongocrypt_setopt_key_expiration. Once a cached key is older than
+ * @p fraction of that lifetime, the next context that needs it fetches the key
+ * again (entering @ref MONGOCRYPT_CTX_NEED_MONGO_KEYS and, if required,
+ * @ref MONGOCRYPT_CTX_NEED_KMS) and replaces the cached entry. Other contexts
+ * continue to use the cached key until it expires.
  *
- * AWS
- * {
- *    provider: "aws",
- *    region: <string>,
- *    key: <string>,
- *    endpoint: <optional string>
- * }
- *
- * Azure
- * {
- *    provider: "azure",
- *    keyVaultEndpoint: <string>,
- *    keyName: <string>,
- *    keyVersion: <optional string>
- * }
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] fraction The fraction of the cache lifetime after which to
+ * refresh. Must be greater than 0 and less than 1.
  *
- * GCP
- * {
- *    provider: "gcp",
- *    projectId: <string>,
- *    location: <string>,
- *    keyRing: <string>,
- *    keyName: <string>,
- *    keyVersion: <optional string>,
- *    endpoint: <optional string>
- * }
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_key_cache_refresh_ahead(mongocrypt_t *crypt, double fraction);
+
+/**
+ * @brief Bound the number of entries of the data key cache.
  *
- * Local
- * {
- *    provider: "local"
- * }
+ * When the cache is full, adding a key evicts an entry that has not been used
+ * recently. By default the cache is unbounded.
  *
- * KMIP
- * {
- *    provider: "kmip",
- *    keyId: <optional string>
- *    endpoint: <string>
- * }
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] max_entries The maximum number of cached data keys, or 0 for no
+ * limit.
  *
- * @pre @p ctx has not been initialized.
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
  * @returns A boolean indicating success. If false, an error status is set.
- * Retrieve it with @ref mongocrypt_ctx_status.
+ * Retrieve it with @ref mongocrypt_status
  */
 MONGOCRYPT_EXPORT
-bool mongocrypt_ctx_setopt_key_encryption_key(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *bin);
+bool mongocrypt_setopt_key_cache_max_entries(mongocrypt_t *crypt, uint32_t max_entries);
 
 /**
- * Initialize a context to create a data key.
+ * @brief Bound the number of entries of the collection info cache.
  *
- * Associated options:
- * - @ref mongocrypt_ctx_setopt_masterkey_aws
- * - @ref mongocrypt_ctx_setopt_masterkey_aws_endpoint
- * - @ref mongocrypt_ctx_setopt_masterkey_local
+ * When the cache is full, adding a collection info evicts an entry that has
+ * not been used recently. By default the cache is unbounded.
  *
- * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] max_entries The maximum number of cached collection infos, or 0
+ * for no limit.
+ *
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
  * @returns A boolean indicating success. If false, an error status is set.
- * Retrieve it with @ref mongocrypt_ctx_status
- * @pre A master key option has been set, and an associated KMS provider
- * has been set on the parent @ref mongocrypt_t.
+ * Retrieve it with @ref mongocrypt_status
  */
 MONGOCRYPT_EXPORT
-bool mongocrypt_ctx_datakey_init(mongocrypt_ctx_t *ctx);
+bool mongocrypt_setopt_collinfo_cache_max_entries(mongocrypt_t *crypt, uint32_t max_entries);
 
 /**
- * Initialize a context for encryption.
+ * @brief Cache the covers computed for range queries.
  *
- * @param[in] ctx The @ref mongocrypt_ctx_t object.
- * @param[in] db The database name.
- * @param[in] db_len The byte length of @p db. Pass -1 to determine the string
- * length with strlen (must
- * be NULL terminated).
- * @param[in] cmd The BSON command to be encrypted. The viewed data is copied.
- * It is valid to destroy @p cmd with @ref mongocrypt_binary_destroy immediately
- * after.
+ * Encrypting a range query computes a set of edges (the "mincover") covering
+ * the queried bounds. If enabled, covers are cached by the bounds, their
+ * inclusivity, and the index min, max, precision, sparsity, and trimFactor, so
+ * repeating a query with the same bounds only derives tokens. When the cache
+ * is full, adding a cover evicts an entry that has not been used recently. By
+ * default covers are not cached.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] max_entries The maximum number of cached covers, or 0 to disable
+ * the cache.
+ *
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
  * @returns A boolean indicating success. If false, an error status is set.
- * Retrieve it with @ref mongocrypt_ctx_status
+ * Retrieve it with @ref mongocrypt_status
  */
 MONGOCRYPT_EXPORT
-bool mongocrypt_ctx_encrypt_init(mongocrypt_ctx_t *ctx, const char *db, int32_t db_len, mongocrypt_binary_t *cmd);
+bool mongocrypt_setopt_mincover_cache_max_entries(mongocrypt_t *crypt, uint32_t max_entries);
 
 /**
- * Explicit helper method to encrypt a single BSON object. Contexts
- * created for explicit encryption will not go through mongocryptd.
- *
- * To specify a key_id, algorithm, or iv to use, please use the
- * corresponding mongocrypt_setopt methods before calling this.
+ * @brief Cache query analysis results by command shape.
  *
- * This method expects the passed-in BSON to be of the form:
- * { "v" : BSON value to encrypt }
+ * Auto encryption sends each command to mongocryptd or crypt_shared to find
+ * the values to encrypt. If enabled, the results are cached by namespace,
+ * schema, and command shape: the field names and value types of the command,
+ * with booleans and strings starting with '$' kept. A command with a cached
+ * shape skips query analysis, and its values are placed into the cached
+ * markings. A result is only reused if the other strings of the command are
+ * unchanged, and is not cached if it does not keep the command's values at
+ * the same paths, as for range insert markings or markings with key alt names.
+ * When the cache is full, adding a result evicts an entry that has not been
+ * used recently. By default results are not cached.
  *
- * The value of "v" is expected to be the BSON value passed to a driver
- * ClientEncryption.encrypt helper.
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] max_entries The maximum number of cached results, or 0 to
+ * disable the cache.
  *
- * Associated options for FLE 1:
- * - @ref mongocrypt_ctx_setopt_key_id
- * - @ref mongocrypt_ctx_setopt_key_alt_name
- * - @ref mongocrypt_ctx_setopt_algorithm
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_marking_cache_max_entries(mongocrypt_t *crypt, uint32_t max_entries);
+
+/**
+ * @brief Cache the tokens derived for delete and compaction commands.
  *
- * Associated options for Queryable Encryption:
- * - @ref mongocrypt_ctx_setopt_key_id
- * - @ref mongocrypt_ctx_setopt_index_key_id
- * - @ref mongocrypt_ctx_setopt_contention_factor
- * - @ref mongocrypt_ctx_setopt_query_type
- * - @ref mongocrypt_ctx_setopt_algorithm_range
+ * Auto encryption of a delete, findAndModify, compactStructuredEncryptionData,
+ * or cleanupStructuredEncryptionData command on a collection with
+ * encryptedFields derives tokens for each indexed field. If enabled, the
+ * tokens are cached by the encryptedFields, so later commands on the
+ * collection reuse them. A change to the encryptedFields or its keys uses a
+ * new entry. The data keys are still required for each command. When the
+ * cache is full, adding tokens evicts an entry that has not been used
+ * recently. By default tokens are not cached.
  *
- * An error is returned if FLE 1 and Queryable Encryption incompatible options
- * are set.
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] max_entries The maximum number of cached token documents, or 0
+ * to disable the cache.
  *
- * @param[in] ctx A @ref mongocrypt_ctx_t.
- * @param[in] msg A @ref mongocrypt_binary_t the plaintext BSON value. The
- * viewed data is copied. It is valid to destroy @p msg with @ref
- * mongocrypt_binary_destroy immediately after.
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
  * @returns A boolean indicating success. If false, an error status is set.
- * Retrieve it with @ref mongocrypt_ctx_status
+ * Retrieve it with @ref mongocrypt_status
  */
 MONGOCRYPT_EXPORT
-bool mongocrypt_ctx_explicit_encrypt_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *msg);
+bool mongocrypt_setopt_token_cache_max_entries(mongocrypt_t *crypt, uint32_t max_entries);
 
 /**
- * Explicit helper method to encrypt a Match Expression or Aggregate Expression.
- * Contexts created for explicit encryption will not go through mongocryptd.
- * Requires query_type to be "range" or "rangePreview".
- *
- * NOTE: "rangePreview" is experimental only and is not intended for public use.
- * API for "rangePreview" may be removed in a future release.
- *
- * This method expects the passed-in BSON to be of the form:
- * { "v" : FLE2RangeFindDriverSpec }
+ * @brief Cache the ciphertexts of the Deterministic algorithm.
  *
- * FLE2RangeFindDriverSpec is a BSON document with one of these forms:
+ * The Deterministic algorithm always encrypts the same value with the same
+ * key to the same ciphertext. If enabled, ciphertexts are cached by the key ID
+ * and the value, so encrypting a repeated value skips the cryptography. The
+ * data keys are still required for each encryption. When the cache is full,
+ * adding a ciphertext evicts an entry that has not been used recently. By
+ * default ciphertexts are not cached.
  *
- * 1. A Match Expression of this form:
- *    {$and: [{<field>: {<op>: <value1>, {<field>: {<op>: <value2> }}]}
- * 2. An Aggregate Expression of this form:
- *    {$and: [{<op>: [<fieldpath>, <value1>]}, {<op>: [<fieldpath>, <value2>]}]
+ * Entries expire like cached data keys, and are removed by @ref
+ * mongocrypt_invalidate_key. The cache holds plaintext values in memory.
+ * Entries are zeroed when they are evicted or when @p crypt is destroyed.
  *
- * <op> may be $lt, $lte, $gt, or $gte.
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] max_entries The maximum number of cached ciphertexts, or 0 to
+ * disable the cache.
  *
- * The value of "v" is expected to be the BSON value passed to a driver
- * ClientEncryption.encryptExpression helper.
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_deterministic_cache_max_entries(mongocrypt_t *crypt, uint32_t max_entries);
+
+/**
+ * @brief Cache the payloads of Queryable Encryption equality queries.
  *
- * Associated options for FLE 1:
- * - @ref mongocrypt_ctx_setopt_key_id
- * - @ref mongocrypt_ctx_setopt_key_alt_name
- * - @ref mongocrypt_ctx_setopt_algorithm
+ * Encrypting an equality query on an indexed field derives tokens from the
+ * queried value with several HMACs. If enabled, the resulting payloads are
+ * cached by the index key ID, the value and the contention factor, so
+ * querying a repeated value skips the derivation. The data keys are still
+ * required for each query. When the cache is full, adding a payload evicts an
+ * entry that has not been used recently. By default payloads are not cached.
  *
- * Associated options for Queryable Encryption:
- * - @ref mongocrypt_ctx_setopt_key_id
- * - @ref mongocrypt_ctx_setopt_index_key_id
- * - @ref mongocrypt_ctx_setopt_contention_factor
- * - @ref mongocrypt_ctx_setopt_query_type
- * - @ref mongocrypt_ctx_setopt_algorithm_range
+ * The cache holds plaintext values in memory. Entries are zeroed when they are
+ * evicted or when @p crypt is destroyed.
  *
- * An error is returned if FLE 1 and Queryable Encryption incompatible options
- * are set.
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] max_entries The maximum number of cached payloads, or 0 to
+ * disable the cache.
  *
- * @param[in] ctx A @ref mongocrypt_ctx_t.
- * @param[in] msg A @ref mongocrypt_binary_t the plaintext BSON value. The
- * viewed data is copied. It is valid to destroy @p msg with @ref
- * mongocrypt_binary_destroy immediately after.
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
  * @returns A boolean indicating success. If false, an error status is set.
- * Retrieve it with @ref mongocrypt_ctx_status
+ * Retrieve it with @ref mongocrypt_status
  */
 MONGOCRYPT_EXPORT
-bool mongocrypt_ctx_explicit_encrypt_expression_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *msg);
+bool mongocrypt_setopt_find_payload_cache_max_entries(mongocrypt_t *crypt, uint32_t max_entries);
 
 /**
- * Initialize a context for decryption.
+ * @brief Cache the range options of explicit encryption.
  *
- * This method expects the passed-in BSON to be of the form:
- * { "v" : BSON value to encrypt }
+ * @ref mongocrypt_ctx_setopt_algorithm_range parses and validates the range
+ * options of each context, and encrypting a value checks the trimFactor
+ * against the number of bits of the domain. If enabled, the parsed options and
+ * the number of bits are cached by the options document, so contexts passing
+ * the same options for a field skip both. When the cache is full, adding
+ * options evicts an entry that has not been used recently. By default options
+ * are not cached.
  *
- * @param[in] ctx The @ref mongocrypt_ctx_t object.
- * @param[in] doc The document to be decrypted. The viewed data is copied. It is
- * valid to destroy @p doc with @ref mongocrypt_binary_destroy immediately
- * after.
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] max_entries The maximum number of cached options, or 0 to disable
+ * the cache.
+ *
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
  * @returns A boolean indicating success. If false, an error status is set.
- * Retrieve it with @ref mongocrypt_ctx_status
+ * Retrieve it with @ref mongocrypt_status
  */
 MONGOCRYPT_EXPORT
-bool mongocrypt_ctx_decrypt_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *doc);
+bool mongocrypt_setopt_range_opts_cache_max_entries(mongocrypt_t *crypt, uint32_t max_entries);
 
 /**
- * Explicit helper method to decrypt a single BSON object.
+ * @brief Set how long to cache collection info.
  *
- * Pass the binary encoding of a BSON document containing the BSON value to
- * encrypt like the following:
+ * Collection info from listCollections is cached for 60 seconds by default.
+ * With a long lifetime, call @ref mongocrypt_invalidate_collinfo when the
+ * schema or encryptedFields of a collection change.
  *
- *   { "v" : (BSON BINARY value of subtype 6) }
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] expiration_ms The lifetime in milliseconds, or 0 for collection
+ * info that does not expire.
  *
- * @param[in] ctx A @ref mongocrypt_ctx_t.
- * @param[in] msg A @ref mongocrypt_binary_t the encrypted BSON. The viewed data
- * is copied. It is valid to destroy @p msg with @ref mongocrypt_binary_destroy
- * immediately after.
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
  */
 MONGOCRYPT_EXPORT
-bool mongocrypt_ctx_explicit_decrypt_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *msg);
+bool mongocrypt_setopt_collinfo_expiration_ms(mongocrypt_t *crypt, uint64_t expiration_ms);
 
 /**
- * @brief Initialize a context to rewrap datakeys.
+ * @brief Set how long to cache collection info for unencrypted collections.
  *
- * Associated options:
- * - @ref mongocrypt_ctx_setopt_key_encryption_key
+ * Collection info from listCollections is cached for 60 seconds. Collections
+ * with neither a $jsonSchema validator nor encryptedFields, including
+ * collections that do not exist, may use a separate lifetime so that commands
+ * on plain collections skip @ref MONGOCRYPT_CTX_NEED_MONGO_COLLINFO for longer.
  *
- * @param[in] ctx The @ref mongocrypt_ctx_t object.
- * @param[in] filter The filter to use for the find command on the key vault
- * collection to retrieve datakeys to rewrap.
- * @return A boolean indicating success. If false, an error status is set.
- * Retrieve it with @ref mongocrypt_ctx_status.
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] expiration_ms The lifetime in milliseconds. Must be greater than
+ * 0.
+ *
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
  */
 MONGOCRYPT_EXPORT
-bool mongocrypt_ctx_rewrap_many_datakey_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *filter);
+bool mongocrypt_setopt_unencrypted_collinfo_expiration_ms(mongocrypt_t *crypt, uint64_t expiration_ms);
 
 /**
- * Indicates the state of the @ref mongocrypt_ctx_t. Each state requires
- * different handling. See [the integration
- * guide](https://github.com/mongodb/libmongocrypt/blob/master/integrating.md#state-machine)
- * for information on what to do for each state.
+ * @brief Cache the KEKs retrieved from KMIP servers.
+ *
+ * A data key with a KMIP KEK that is not delegated is decrypted by retrieving
+ * the KEK with a KMIP Get request and unwrapping the key locally. If enabled,
+ * the KEK is cached by the KMIP endpoint and key ID for @p expiration_ms, so
+ * decrypting other data keys wrapped by the same KEK in that time skips the
+ * KMIP request. By default KEKs are not cached.
+ *
+ * The cache holds key material in memory. Entries are zeroed when they expire
+ * or when @p crypt is destroyed. Prefer a short lifetime.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] expiration_ms The lifetime in milliseconds, or 0 to disable the
+ * cache.
+ *
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
  */
-typedef enum {
-    MONGOCRYPT_CTX_ERROR = 0,
-    MONGOCRYPT_CTX_NEED_MONGO_COLLINFO = 1,         /* run on main MongoClient */
-    MONGOCRYPT_CTX_NEED_MONGO_COLLINFO_WITH_DB = 8, /* run on main MongoClient */
-    MONGOCRYPT_CTX_NEED_MONGO_MARKINGS = 2,         /* run on mongocryptd. */
-    MONGOCRYPT_CTX_NEED_MONGO_KEYS = 3,             /* run on key vault */
-    MONGOCRYPT_CTX_NEED_KMS = 4,
-    MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS = 7, /* fetch/renew KMS credentials */
-    MONGOCRYPT_CTX_READY = 5,                /* ready for encryption/decryption */
-    MONGOCRYPT_CTX_DONE = 6,
-} mongocrypt_ctx_state_t;
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_kmip_kek_cache_expiration_ms(mongocrypt_t *crypt, uint64_t expiration_ms);
 
 /**
- * Get the current state of a context.
+ * @brief Opt-into fetching collection info for a whole database at once.
  *
- * @param[in] ctx The @ref mongocrypt_ctx_t object.
- * @returns A @ref mongocrypt_ctx_state_t.
+ * If opted in, the filter returned by @ref mongocrypt_ctx_mongo_op in the
+ * @ref MONGOCRYPT_CTX_NEED_MONGO_COLLINFO state is empty, so listCollections
+ * returns every collection of the database. Pass each result to
+ * @ref mongocrypt_ctx_mongo_feed. All are cached, so later commands on other
+ * collections of the database do not need collection info again.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ *
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
  */
 MONGOCRYPT_EXPORT
-mongocrypt_ctx_state_t mongocrypt_ctx_state(mongocrypt_ctx_t *ctx);
+bool mongocrypt_setopt_prefetch_collinfo(mongocrypt_t *crypt);
 
 /**
- * Get BSON necessary to run the mongo operation when mongocrypt_ctx_t
- * is in MONGOCRYPT_CTX_NEED_MONGO_* states.
+ * @brief Opt-into coalescing KMS decrypts of the same key across contexts.
  *
- * @p op_bson is a BSON document to be used for the operation.
- * - For MONGOCRYPT_CTX_NEED_MONGO_COLLINFO(_WITH_DB) it is a listCollections filter.
- * - For MONGOCRYPT_CTX_NEED_MONGO_KEYS it is a find filter.
- * - For MONGOCRYPT_CTX_NEED_MONGO_MARKINGS it is a command to send to
- * mongocryptd.
+ * If opted in, when several contexts of @p crypt need the same data key that
+ * is not cached, only the first issues a KMS request for it. The others stay
+ * in the @ref MONGOCRYPT_CTX_NEED_KMS state without a KMS request for that key
+ * until the first context has stored the key in the cache. In that case
+ * @ref mongocrypt_ctx_next_kms_ctx may return NULL immediately, and the
+ * context remains in @ref MONGOCRYPT_CTX_NEED_KMS after
+ * @ref mongocrypt_ctx_kms_done. The driver should then wait briefly before
+ * calling @ref mongocrypt_ctx_next_kms_ctx and @ref mongocrypt_ctx_kms_done
+ * again. If the first context fails or is destroyed, a waiting context issues
+ * its own request.
  *
- * The lifetime of @p op_bson is tied to the lifetime of @p ctx. It is valid
- * until @ref mongocrypt_ctx_destroy is called.
+ * Azure and GCP OAuth token requests are coalesced the same way: only one
+ * context requests a token for a KMS provider, and other contexts needing the
+ * token wait for it in @ref MONGOCRYPT_CTX_NEED_KMS.
  *
- * @param[in] ctx The @ref mongocrypt_ctx_t object.
- * @param[out] op_bson A BSON document for the MongoDB operation. The data
- * viewed by @p op_bson is guaranteed to be valid until @p ctx is destroyed with
- * @ref mongocrypt_ctx_destroy.
+ * @param[in] crypt The @ref mongocrypt_t object.
+ *
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
  * @returns A boolean indicating success. If false, an error status is set.
- * Retrieve it with @ref mongocrypt_ctx_status
+ * Retrieve it with @ref mongocrypt_status
  */
 MONGOCRYPT_EXPORT
-bool mongocrypt_ctx_mongo_op(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *op_bson);
+bool mongocrypt_setopt_coalesce_kms_decrypts(mongocrypt_t *crypt);
 
 /**
- * Get the database to run the mongo operation.
+ * Opt-into a small cache of recently used keys in each thread.
  *
- * Only applies when mongocrypt_ctx_t is in the state:
+ * Each thread keeps up to 32 decrypted keys, with their derived tokens, in
+ * front of the key cache. A context looking up a key by id finds it there
+ * without locking the key cache. An entry is dropped when its key is evicted or
+ * invalidated, and once the cached key expires or is due for a refresh with
+ * @ref mongocrypt_setopt_key_cache_refresh_ahead. Evicting a key may also drop
+ * a few entries of other keys. Lookups by key alt name always use the key
+ * cache.
+ *
+ * After @p crypt is destroyed, the entries of other threads than the one
+ * calling @ref mongocrypt_destroy are released when those threads next use a
+ * thread-local key cache, or exit. Until then, their keys stay in memory.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ *
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_key_cache_thread_local(mongocrypt_t *crypt);
+
+/**
+ * Opt-into retrying failed KMS requests.
+ *
+ * If enabled, a request that receives an HTTP 429, 500, 502, 503, or 504
+ * response is retried up to three times. Feeding such a response succeeds and
+ * @ref mongocrypt_kms_ctx_bytes_needed returns 0.
+ * @ref mongocrypt_ctx_next_kms_ctx returns the same @ref mongocrypt_kms_ctx_t
+ * again, and the driver should sleep for
+ * @ref mongocrypt_kms_ctx_usleep microseconds before resending the message.
+ * The sleep doubles with each attempt. A driver may also report a network
+ * error with @ref mongocrypt_kms_ctx_fail to have the request retried.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] enable Whether to retry KMS requests.
+ *
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_retry_kms(mongocrypt_t *crypt, bool enable);
+
+/**
+ * Pace KMS requests to avoid being throttled by the KMS.
+ *
+ * Requests to each KMS provider and endpoint are limited to @p
+ * requests_per_sec across all contexts of @p crypt, allowing bursts of up to @p
+ * burst requests. Each time @ref mongocrypt_ctx_next_kms_ctx returns a request,
+ * including a retried one, it takes the next free slot, and
+ * @ref mongocrypt_kms_ctx_usleep returns how long the driver should sleep
+ * before sending the message. Combine with
+ * @ref mongocrypt_setopt_coalesce_kms_decrypts so contexts needing the same
+ * key share one request.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] requests_per_sec The requests per second to each endpoint, at
+ * most 1000000. 0 disables pacing, which is the default.
+ * @param[in] burst The requests that may be sent at once. 0 is treated as 1.
+ *
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_kms_rate_limit(mongocrypt_t *crypt, uint32_t requests_per_sec, uint32_t burst);
+
+/**
+ * Opt-into keeping KMS connections alive.
+ *
+ * By default, KMS HTTP requests include a "Connection: close" header, and each
+ * request needs a new TLS connection. If enabled, the header is omitted so the
+ * driver may pool connections and send later requests on the same connection.
+ * Connections may be shared by requests with the same
+ * @ref mongocrypt_kms_ctx_endpoint.
+ *
+ * A response is complete once @ref mongocrypt_kms_ctx_bytes_needed returns 0.
+ * This does not depend on the server closing the connection. The driver must
+ * read at most @ref mongocrypt_kms_ctx_bytes_needed bytes at a time and feed
+ * whatever was read, rather than waiting for that many bytes to arrive.
+ * A pooled connection may have been closed by the server. Report the error
+ * with @ref mongocrypt_kms_ctx_fail to have the request retried.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ *
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_kms_keep_alive(mongocrypt_t *crypt);
+
+/**
+ * Opt-into reading KMS responses with large reads.
+ *
+ * By default, @ref mongocrypt_kms_ctx_bytes_needed returns 1024 until the
+ * length of the response is known, and then exactly the bytes that remain,
+ * so a driver needs several reads per response. If enabled,
+ * @ref mongocrypt_kms_ctx_bytes_needed returns at least 65536 until the
+ * response is complete. The driver may feed whatever one read returned, and
+ * the bytes are split for the response parser internally. Feeding bytes past
+ * the end of the response is still an error.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ *
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_kms_large_reads(mongocrypt_t *crypt);
+
+/**
+ * Opt-into batching KMIP requests.
+ *
+ * If opted in, the KMIP-backed data keys a context needs from the same KMIP
+ * server are requested with one KMIP Get request containing a batch item per
+ * key, instead of one request per key. The KMIP server must support multiple
+ * batch items in a request message. Keys using delegated encryption are still
+ * requested one at a time.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ *
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_batch_kmip_requests(mongocrypt_t *crypt);
+
+/**
+ * Opt-into refreshing cached Azure and GCP OAuth tokens before they expire.
+ *
+ * By default, a context that finds the cached OAuth token expired requests a
+ * new token before it can send its KMS request. If a margin is set, the first
+ * context that uses a cached token expiring within @p margin_ms also returns
+ * an OAuth request from @ref mongocrypt_ctx_next_kms_ctx, next to the KMS
+ * requests that use the still valid token. The response replaces the cached
+ * token. Only one context at a time refreshes the token of a KMS provider. A
+ * failed refresh is logged and does not fail the context.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] margin_ms How long before expiration to refresh a token. 0
+ * disables refreshing.
+ *
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_oauth_refresh_margin_ms(mongocrypt_t *crypt, uint64_t margin_ms);
+
+/**
+ * Opt-into hedged KMS requests to alternate AWS and KMIP endpoints.
+ *
+ * @p endpoints is a BSON document mapping KMS provider names to arrays of
+ * alternate endpoints, e.g.
+ * { "aws": ["kms-fips.us-east-1.amazonaws.com"], "kmip": ["kmip2.example.com:5696"] }.
+ *
+ * Drivers that send KMS requests concurrently may call
+ * @ref mongocrypt_ctx_next_kms_ctx again while requests are in flight. Once a
+ * request to decrypt a key has been waiting on a response for @p
+ * hedge_after_ms since its first @ref mongocrypt_kms_ctx_message call, it
+ * returns a second request for the key to the first alternate endpoint that
+ * differs from the request's own. Whichever of the two gets a complete
+ * response first is used. From then on, @ref mongocrypt_kms_ctx_bytes_needed
+ * returns 0 for the other request, and @ref mongocrypt_kms_ctx_feed and @ref
+ * mongocrypt_kms_ctx_fail ignore it, so the driver can stop reading it. The
+ * two requests may be fed from separate threads.
+ *
+ * An AWS request is signed again for the alternate endpoint. Batched KMIP
+ * requests (see @ref mongocrypt_setopt_batch_kmip_requests) are not hedged.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] endpoints A BSON document of alternate endpoints by KMS provider.
+ * The viewed data is copied. It is valid to destroy @p endpoints with @ref
+ * mongocrypt_binary_destroy immediately after.
+ * @param[in] hedge_after_ms How long a request waits before it is hedged.
+ *
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_kms_hedge(mongocrypt_t *crypt, mongocrypt_binary_t *endpoints, uint64_t hedge_after_ms);
+
+/**
+ * Get activity counters for the caches of a @ref mongocrypt_t object.
+ *
+ * @p stats is set to a BSON document of the form:
+ *
+ *   {
+ *     "key": { "hits": <int64>, "misses": <int64>, "evictions": <int64>,
+ *              "insertions": <int64>, "entries": <int64> },
+ *     "collinfo": { ... },
+ *     "oauth": { ... }
+ *   }
+ *
+ * Counters accumulate from @ref mongocrypt_new. "entries" is the number of
+ * unexpired entries currently held.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object after a successful call to
+ * mongocrypt_init.
+ * @param[out] stats Receives the BSON document. The data is owned by @p crypt
+ * and is valid until the next call to @ref mongocrypt_get_cache_stats or
+ * @ref mongocrypt_destroy. Calls must not overlap.
+ *
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_get_cache_stats(mongocrypt_t *crypt, mongocrypt_binary_t *stats);
+
+/**
+ * Get an estimate of the memory held by a @ref mongocrypt_t object.
+ *
+ * @p usage is set to a BSON document of the form:
+ *
+ *   {
+ *     "caches": { "key": <int64>, "collinfo": <int64>, "oauth": <int64> },
+ *     "contexts": { "count": <int64>, "bytes": <int64> },
+ *     "cryptShared": { "loaded": <bool>, "idleQueryAnalyzers": <int64> }
+ *   }
+ *
+ * "caches" has the estimated bytes held by each cache, including expired
+ * entries not yet evicted. A key cache shared with @ref
+ * mongocrypt_setopt_cache_domain is reported in full by each @ref mongocrypt_t.
+ * "contexts" has the number of @ref mongocrypt_ctx_t objects not yet destroyed
+ * and the bytes allocated for them with the allocator of @p crypt. Memory that
+ * contexts allocate while running is not included. crypt_shared allocates
+ * with its own allocator, so only whether it is loaded and how many query
+ * analyzers are pooled are reported.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object after a successful call to
+ * mongocrypt_init.
+ * @param[out] usage Receives the BSON document. The data is owned by @p crypt
+ * and is valid until the next call to @ref mongocrypt_get_memory_usage or
+ * @ref mongocrypt_destroy. Calls must not overlap.
+ *
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_get_memory_usage(mongocrypt_t *crypt, mongocrypt_binary_t *usage);
+
+/**
+ * Get activity counters of a @ref mongocrypt_t object.
+ *
+ * @p counters is set to a BSON document of int64 counts of the form:
+ *
+ *   {
+ *     "contexts": { "encrypt", "decrypt", "createDataKey",
+ *                   "rewrapManyDataKey", "prefetchKeys" },
+ *     "encryptedValues": { "fle1", "fle2Equality", "fle2Range",
+ *                          "fle2Unindexed" },
+ *     "decryptedValues": { "fle1", "fle2Equality", "fle2Range",
+ *                          "fle2Unindexed" },
+ *     "bytes": { "encrypt", "decrypt" },
+ *     "kmsRequests": { "aws", "azure", "gcp", "kmip" },
+ *     "markings": { "cryptShared", "mongocryptd", "cache" }
+ *   }
+ *
+ * Counters accumulate from @ref mongocrypt_new and are updated atomically, so
+ * this may be called while contexts are in use. "contexts" counts initialized
+ * contexts by type. "bytes" counts the bytes of the commands, documents and
+ * values passed to encrypt and decrypt contexts. "kmsRequests" counts KMS
+ * requests returned by @ref mongocrypt_ctx_next_kms_ctx by provider, including
+ * OAuth requests. "markings" counts commands marked by crypt_shared, by
+ * mongocryptd, or from the marking cache.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object after a successful call to
+ * mongocrypt_init.
+ * @param[out] counters Receives the BSON document. The data is owned by @p
+ * crypt and is valid until the next call to @ref mongocrypt_get_counters or
+ * @ref mongocrypt_destroy. Calls must not overlap.
+ *
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_get_counters(mongocrypt_t *crypt, mongocrypt_binary_t *counters);
+
+/**
+ * Get KMS request latency and error stats of a @ref mongocrypt_t object.
+ *
+ * @p stats is set to a BSON document with one entry per KMS provider and
+ * endpoint:
+ *
+ *   {
+ *     "kms": [
+ *       {
+ *         "kmsProvider": <utf8>, "endpoint": <utf8>,
+ *         "requests": <int64>, "totalLatencyMicros": <int64>,
+ *         "latencyMillis": { "le1": <int64>, "le2": <int64>, "le5": <int64>,
+ *                            ..., "le5000": <int64>, "inf": <int64> },
+ *         "httpErrors": { <HTTP status>: <int64>, ... },
+ *         "kmipErrors": { <KMIP Result Reason>: <int64>, ... },
+ *         "otherErrors": <int64>
+ *       },
+ *       ...
+ *     ]
+ *   }
+ *
+ * A request is timed from the first call to @ref mongocrypt_kms_ctx_message to
+ * the call to @ref mongocrypt_kms_ctx_feed that completes the response. Each
+ * retry of a request is counted separately. "latencyMillis" counts requests
+ * by the smallest bound in milliseconds that their latency does not exceed.
+ * Failed requests are counted by HTTP status, by KMIP Result Reason, or in
+ * "otherErrors" if there was no response (see @ref mongocrypt_kms_ctx_fail)
+ * or it could not be parsed.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object after a successful call to
+ * mongocrypt_init.
+ * @param[out] stats Receives the BSON document. The data is owned by @p crypt
+ * and is valid until the next call to @ref mongocrypt_get_kms_stats or
+ * @ref mongocrypt_destroy. Calls must not overlap.
+ *
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_get_kms_stats(mongocrypt_t *crypt, mongocrypt_binary_t *stats);
+
+/**
+ * Estimate the costs of a range index without encrypting anything.
+ *
+ * Intended for choosing the "sparsity" and "trimFactor" range options. @p in
+ * is a BSON document with the range options (as passed to
+ * @ref mongocrypt_ctx_setopt_algorithm_range), sample values to insert, and
+ * sample query bounds:
+ *
+ *   {
+ *     "rangeOpts": { "min": ..., "max": ..., "sparsity": <int64>,
+ *                    "precision": <int32>, "trimFactor": <int32> },
+ *     "values": [ <value>, ... ],
+ *     "queries": [ { "lowerBound": <value>, "lbIncluded": <bool>,
+ *                    "upperBound": <value>, "ubIncluded": <bool> }, ... ]
+ *   }
+ *
+ * "values" and "queries" are optional. A query may omit one bound to range to
+ * the index min or max. Bounds are included by default.
+ *
+ * @p out is set to a BSON document with the mean over the samples:
+ *
+ *   {
+ *     "insert": { "count": <int64>, "edges": <double>, "maxEdges": <int64>,
+ *                 "payloadBytes": <double>, "maxPayloadBytes": <int64>,
+ *                 "cpuMicros": <double> },
+ *     "find": { ... the same fields, with "edges" the mincover size ... }
+ *   }
+ *
+ * Payload sizes round up the serialized token sizes, as when reserving output
+ * buffers. "cpuMicros" is the measured time to generate the edges or mincover
+ * plus the token derivations for each edge, costed by timing HMAC-SHA-256
+ * with the crypto hooks of @p crypt. It excludes key retrieval and
+ * decryption.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object after a successful call to
+ * mongocrypt_init. Its @ref mongocrypt_setopt_use_range_v2 setting applies.
+ * @param[in] in The BSON document described above.
+ * @param[out] out Receives the BSON document. The data is owned by @p crypt
+ * and is valid until the next call to @ref mongocrypt_range_estimate or
+ * @ref mongocrypt_destroy. Calls must not overlap.
+ *
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_range_estimate(mongocrypt_t *crypt, mongocrypt_binary_t *in, mongocrypt_binary_t *out);
+
+/**
+ * Manages the state machine for encryption or decryption.
+ */
+typedef struct _mongocrypt_ctx_t mongocrypt_ctx_t;
+
+/**
+ * Indicates whether a trace event begins or ends a span.
+ */
+typedef enum { MONGOCRYPT_TRACE_BEGIN = 0, MONGOCRYPT_TRACE_END = 1 } mongocrypt_trace_event_t;
+
+/**
+ * A trace callback function. Set a trace callback with @ref
+ * mongocrypt_setopt_trace_handler.
+ *
+ * @param[in] ctx The context the span belongs to. Spans of a context do not
+ * overlap, except "kms" spans, which may overlap each other.
+ * @param[in] event Whether the span begins or ends.
+ * @param[in] span The name of the span. One of:
+ * - "collinfo": the context is in MONGOCRYPT_CTX_NEED_MONGO_COLLINFO(_WITH_DB).
+ * - "markings": the context is in MONGOCRYPT_CTX_NEED_MONGO_MARKINGS.
+ * - "keys": the context is in MONGOCRYPT_CTX_NEED_MONGO_KEYS.
+ * - "ops": the context is in MONGOCRYPT_CTX_NEED_MONGO_OPS.
+ * - "kms": one KMS request, from @ref mongocrypt_ctx_next_kms_ctx returning it
+ *   until the last reply bytes are fed.
+ * - "encrypt": replacing markings with ciphertexts in @ref
+ *   mongocrypt_ctx_finalize.
+ * - "decrypt": replacing ciphertexts with plaintexts in @ref
+ *   mongocrypt_ctx_finalize.
+ * @param[in] attributes A BSON document. Begin events may include "ns" (the
+ * target namespace), "keys" (the number of keys requested), "fields" (the
+ * number of ciphertexts to decrypt), "kmsProvider" and "endpoint". End events
+ * include "ok", which is false if the span ended with an error. The data is
+ * only valid during the callback.
+ * @param[in] trace_ctx A context provided by the caller of @ref
+ * mongocrypt_setopt_trace_handler.
+ */
+typedef void (*mongocrypt_trace_fn_t)(mongocrypt_ctx_t *ctx,
+                                      mongocrypt_trace_event_t event,
+                                      const char *span,
+                                      mongocrypt_binary_t *attributes,
+                                      void *trace_ctx);
+
+/**
+ * Set a handler on the @ref mongocrypt_t object to get called on the begin and
+ * end of each phase of a context.
+ *
+ * A state span begins with the first call on the context that observes the
+ * state, such as @ref mongocrypt_ctx_state, and ends with the first call that
+ * observes the next state. A span still open when the context is destroyed
+ * ends with "ok" false.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] trace_fn The trace callback.
+ * @param[in] trace_ctx A context passed as an argument to the trace callback
+ * every invocation.
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_trace_handler(mongocrypt_t *crypt, mongocrypt_trace_fn_t trace_fn, void *trace_ctx);
+
+/**
+ * A record callback function. Set a record callback with @ref
+ * mongocrypt_setopt_record_handler.
+ *
+ * @param[in] ctx The context being destroyed or reset.
+ * @param[in] session A BSON document of the calls made on @p ctx, to be
+ * replayed offline by the bench-replay tool:
+ *
+ *   {
+ *     "events": [ { "call": <name>, "us": <int64>, ...arguments }, ... ],
+ *     "state": <int32>, "ok": <bool>, "error": <string>, "durationUs": <int64>
+ *   }
+ *
+ * "call" names the function without the "mongocrypt_" prefix, such as
+ * "ctx_encrypt_init", "ctx_mongo_feed" or "kms_ctx_feed". "us" is the time of
+ * the call in microseconds since the first recorded call. Input passed to the
+ * call is in "data" (and "db" for "ctx_encrypt_init"). KMS and mongo
+ * operation calls identify their object with "id" or "index". Calls on KMS
+ * contexts fed from separate threads are recorded in the order each call
+ * takes an internal lock, so the calls of one KMS context keep their order
+ * but may interleave with those of another. "state" is the final state of the
+ * context and "error" its error message, if any. The data is only valid
+ * during the callback.
+ * @param[in] record_ctx A context provided by the caller of @ref
+ * mongocrypt_setopt_record_handler.
+ */
+typedef void (*mongocrypt_record_fn_t)(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *session, void *record_ctx);
+
+/**
+ * Set a handler on the @ref mongocrypt_t object to get called with the
+ * recorded calls of each context when it is destroyed or reset.
+ *
+ * Contexts initialized with @ref mongocrypt_ctx_encrypt_init, @ref
+ * mongocrypt_ctx_decrypt_init, or the explicit encryption and decryption init
+ * functions are recorded. Other contexts, and contexts added to a @ref
+ * mongocrypt_ctx_group_t, are not.
+ *
+ * @warning Sessions contain commands and documents before encryption, KMS
+ * credentials, and KMS replies holding decrypted data keys. Only record
+ * where that data may be kept, such as when reproducing a performance issue.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] record_fn The record callback.
+ * @param[in] record_ctx A context passed as an argument to the record
+ * callback every invocation.
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_record_handler(mongocrypt_t *crypt, mongocrypt_record_fn_t record_fn, void *record_ctx);
+
+/**
+ * Create a new uninitialized @ref mongocrypt_ctx_t.
+ *
+ * Initialize the context with functions like @ref mongocrypt_ctx_encrypt_init.
+ * When done, destroy it with @ref mongocrypt_ctx_destroy.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @returns A new context.
+ */
+MONGOCRYPT_EXPORT
+mongocrypt_ctx_t *mongocrypt_ctx_new(mongocrypt_t *crypt);
+
+/**
+ * Get the status associated with a @ref mongocrypt_ctx_t object.
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @param[out] status Receives the status.
+ *
+ * @returns True if the output is an ok status, false if it is an error
+ * status.
+ *
+ * @see mongocrypt_status_ok
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_status(mongocrypt_ctx_t *ctx, mongocrypt_status_t *status);
+
+/**
+ * Set the key id to use for explicit encryption.
+ *
+ * It is an error to set both this and the key alt name.
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @param[in] key_id The binary corresponding to the _id (a UUID) of the data
+ * key to use from the key vault collection. Note, the UUID must be encoded with
+ * RFC-4122 byte order. The viewed data is copied. It is valid to destroy
+ * @p key_id with @ref mongocrypt_binary_destroy immediately after.
+ * @pre @p ctx has not been initialized.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_setopt_key_id(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *key_id);
+
+/**
+ * Set the keyAltName to use for explicit encryption or
+ * data key creation.
+ *
+ * Pass the binary encoding a BSON document like the following:
+ *
+ *   { "keyAltName" : (BSON UTF8 value) }
+ *
+ * For explicit encryption, it is an error to set both the keyAltName
+ * and the key id.
+ *
+ * For creating data keys, call this function repeatedly to set
+ * multiple keyAltNames.
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @param[in] key_alt_name The name to use. The viewed data is copied. It is
+ * valid to destroy @p key_alt_name with @ref mongocrypt_binary_destroy
+ * immediately after.
+ * @pre @p ctx has not been initialized.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_setopt_key_alt_name(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *key_alt_name);
+
+/**
+ * Set the keyMaterial to use for encrypting data.
+ *
+ * Pass the binary encoding of a BSON document like the following:
+ *
+ *   { "keyMaterial" : (BSON BINARY value) }
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @param[in] key_material The data encryption key to use. The viewed data is
+ * copied. It is valid to destroy @p key_material with @ref
+ * mongocrypt_binary_destroy immediately after.
+ * @pre @p ctx has not been initialized.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_setopt_key_material(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *key_material);
+
+/**
+ * Set the algorithm used for encryption to either
+ * deterministic or random encryption. This value
+ * should only be set when using explicit encryption.
+ *
+ * If -1 is passed in for "len", then "algorithm" is
+ * assumed to be a null-terminated string.
+ *
+ * Valid values for algorithm are:
+ *   "AEAD_AES_256_CBC_HMAC_SHA_512-Deterministic"
+ *   "AEAD_AES_256_CBC_HMAC_SHA_512-Random"
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @param[in] algorithm A string specifying the algorithm to
+ * use for encryption.
+ * @param[in] len The length of the algorithm string.
+ * @pre @p ctx has not been initialized.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_setopt_algorithm(mongocrypt_ctx_t *ctx, const char *algorithm, int len);
+
+/// String constant for setopt_algorithm "Deterministic" encryption
+#define MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR "AEAD_AES_256_CBC_HMAC_SHA_512-Deterministic"
+/// String constant for setopt_algorithm "Random" encryption
+#define MONGOCRYPT_ALGORITHM_RANDOM_STR "AEAD_AES_256_CBC_HMAC_SHA_512-Random"
+/// String constant for setopt_algorithm "Indexed" explicit encryption
+#define MONGOCRYPT_ALGORITHM_INDEXED_STR "Indexed"
+/// String constant for setopt_algorithm "Unindexed" explicit encryption
+#define MONGOCRYPT_ALGORITHM_UNINDEXED_STR "Unindexed"
+/// String constant for setopt_algorithm "rangePreview" explicit encryption (deprecated in favor of "range")
+/// NOTE: "rangePreview" is experimental only and is not intended for public use.
+/// API for "rangePreview" may be removed in a future release.
+#define MONGOCRYPT_ALGORITHM_RANGEPREVIEW_DEPRECATED_STR "RangePreview"
+#define MONGOCRYPT_ALGORITHM_RANGE_STR "Range"
+
+/**
+ * Identify the AWS KMS master key to use for creating a data key.
+ *
+ * This has been superseded by the more flexible:
+ * @ref mongocrypt_ctx_setopt_key_encryption_key
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @param[in] region The AWS region.
+ * @param[in] region_len The string length of @p region. Pass -1 to determine
+ * the string length with strlen (must be NULL terminated).
+ * @param[in] cmk The Amazon Resource Name (ARN) of the customer master key
+ * (CMK).
+ * @param[in] cmk_len The string length of @p cmk_len. Pass -1 to determine the
+ * string length with strlen (must be NULL terminated).
+ * @pre @p ctx has not been initialized.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_setopt_masterkey_aws(mongocrypt_ctx_t *ctx,
+                                         const char *region,
+                                         int32_t region_len,
+                                         const char *cmk,
+                                         int32_t cmk_len);
+
+/**
+ * Identify a custom AWS endpoint when creating a data key.
+ * This is used internally to construct the correct HTTP request
+ * (with the Host header set to this endpoint). This endpoint
+ * is persisted in the new data key, and will be returned via
+ * @ref mongocrypt_kms_ctx_endpoint.
+ *
+ * This has been superseded by the more flexible:
+ * @ref mongocrypt_ctx_setopt_key_encryption_key
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @param[in] endpoint The endpoint.
+ * @param[in] endpoint_len The string length of @p endpoint. Pass -1 to
+ * determine the string length with strlen (must be NULL terminated).
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_setopt_masterkey_aws_endpoint(mongocrypt_ctx_t *ctx, const char *endpoint, int32_t endpoint_len);
+
+/**
+ * Set the master key to "local" for creating a data key.
+ * This has been superseded by the more flexible:
+ * @ref mongocrypt_ctx_setopt_key_encryption_key
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @pre @p ctx has not been initialized.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_setopt_masterkey_local(mongocrypt_ctx_t *ctx);
+
+/**
+ * Set key encryption key document for creating a data key or for rewrapping
+ * datakeys.
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @param[in] bin BSON representing the key encryption key document with
+ * an additional "provider" field. The following forms are accepted:
+ *
+ * AWS
+ * {
+ *    provider: "aws",
+ *    region: <string>,
+ *    key: <string>,
+ *    endpoint: <optional string>
+ * }
+ *
+ * Azure
+ * {
+ *    provider: "azure",
+ *    keyVaultEndpoint: <string>,
+ *    keyName: <string>,
+ *    keyVersion: <optional string>
+ * }
+ *
+ * GCP
+ * {
+ *    provider: "gcp",
+ *    projectId: <string>,
+ *    location: <string>,
+ *    keyRing: <string>,
+ *    keyName: <string>,
+ *    keyVersion: <optional string>,
+ *    endpoint: <optional string>
+ * }
+ *
+ * Local
+ * {
+ *    provider: "local"
+ * }
+ *
+ * KMIP
+ * {
+ *    provider: "kmip",
+ *    keyId: <optional string>
+ *    endpoint: <string>
+ * }
+ *
+ * @pre @p ctx has not been initialized.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status.
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_setopt_key_encryption_key(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *bin);
+
+/**
+ * Initialize a context to create a data key.
+ *
+ * Associated options:
+ * - @ref mongocrypt_ctx_setopt_masterkey_aws
+ * - @ref mongocrypt_ctx_setopt_masterkey_aws_endpoint
+ * - @ref mongocrypt_ctx_setopt_masterkey_local
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ * @pre A master key option has been set, and an associated KMS provider
+ * has been set on the parent @ref mongocrypt_t.
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_datakey_init(mongocrypt_ctx_t *ctx);
+
+/**
+ * Initialize a context to create many data keys at once.
+ *
+ * Each key gets its own generated key material, encrypted with the key
+ * encryption key set by @ref mongocrypt_ctx_setopt_key_encryption_key. The
+ * KMS requests of all keys are returned together in state @ref
+ * MONGOCRYPT_CTX_NEED_KMS, so they can be sent concurrently. @ref
+ * mongocrypt_ctx_finalize returns a document of the form
+ * { "v": [ <key document>, ... ] } with @p count key documents, ready for one
+ * insertMany into the key vault collection.
+ *
+ * Associated options:
+ * - @ref mongocrypt_ctx_setopt_key_encryption_key
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @param[in] count The number of data keys to create. Must be greater than 0.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ * @pre A key encryption key has been set, and an associated KMS provider
+ * has been set on the parent @ref mongocrypt_t.
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_datakey_batch_init(mongocrypt_ctx_t *ctx, uint32_t count);
+
+/**
+ * Initialize a context for encryption.
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @param[in] db The database name.
+ * @param[in] db_len The byte length of @p db. Pass -1 to determine the string
+ * length with strlen (must
+ * be NULL terminated).
+ * @param[in] cmd The BSON command to be encrypted. The viewed data is copied.
+ * It is valid to destroy @p cmd with @ref mongocrypt_binary_destroy immediately
+ * after.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_encrypt_init(mongocrypt_ctx_t *ctx, const char *db, int32_t db_len, mongocrypt_binary_t *cmd);
+
+/**
+ * Initialize a context to report the encryption work of a command without
+ * encrypting it.
+ *
+ * The context runs like one initialized with @ref mongocrypt_ctx_encrypt_init
+ * until the command is marked. It then enters @ref MONGOCRYPT_CTX_READY without
+ * requesting keys, so no key documents are fetched and no KMS requests are
+ * made. @ref mongocrypt_ctx_finalize returns a document of the form:
+ *
+ *   {
+ *     "fields": [ {
+ *       "path": <string>, "algorithm": <string>, "type": "insert" | "find",
+ *       "keyId": <UUID>, "keyCached": <bool>,
+ *       "indexKeyId": <UUID>, "indexKeyCached": <bool>,
+ *       "edges": <int64>, "mincover": <int64>,
+ *       "markingBytes": <int64>, "ciphertextBytesEstimate": <int64>
+ *     }, ... ],
+ *     "uncachedKeyIds": [ <UUID>, ... ],
+ *     "markingBytes": <int64>, "ciphertextBytesEstimate": <int64>,
+ *     "commandBytes": <int64>, "encryptedCommandBytesEstimate": <int64>
+ *   }
+ *
+ * There is one entry in "fields" per value to encrypt, in the order of the
+ * marked command. "path" is the dotted path of the value in the marked
+ * command. "type" and "indexKeyId" are only present for Queryable Encryption.
+ * "edges" (insert) or "mincover" (find) counts the tokens of a "Range" value.
+ * A CSFLE value with a key alt name has "keyAltName" instead of "keyId".
+ * "uncachedKeyIds" lists the keys that encrypting the command would fetch.
+ * Byte counts ending in "Estimate" are estimates, not exact lengths.
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @param[in] db The database name.
+ * @param[in] db_len The byte length of @p db. Pass -1 to determine the string
+ * length with strlen (must be NULL terminated).
+ * @param[in] cmd The BSON command to be explained. The viewed data is copied.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_explain_encrypt_init(mongocrypt_ctx_t *ctx,
+                                         const char *db,
+                                         int32_t db_len,
+                                         mongocrypt_binary_t *cmd);
+
+/**
+ * Get the keys of the encryptedFields of an auto encryption context to
+ * prefetch while the command is marked.
+ *
+ * In state @ref MONGOCRYPT_CTX_NEED_MONGO_MARKINGS the encryptedFields of a
+ * Queryable Encryption collection is known, but the keys are only requested
+ * once the markings are fed. Pass the output to @ref
+ * mongocrypt_ctx_prefetch_keys_init on another context, and run it while
+ * running the command to mongocryptd, so the keys are fetched concurrently.
+ * Finish the prefetch context before calling @ref mongocrypt_ctx_mongo_done so
+ * the keys are found in the key cache.
+ *
+ * The output has the form: { "keyIds" : [ UUID, ... ] }. Keys already in the
+ * key cache are not included. If "keyIds" is empty, there is nothing to
+ * prefetch.
+ *
+ * @param[in] ctx A @ref mongocrypt_ctx_t initialized with @ref
+ * mongocrypt_ctx_encrypt_init.
+ * @param[out] out The key ids. The data viewed by @p out is valid until the
+ * next call with @p ctx or until @p ctx is destroyed.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_encrypt_prefetch_key_ids(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out);
+
+/**
+ * Explicit helper method to encrypt a single BSON object. Contexts
+ * created for explicit encryption will not go through mongocryptd.
+ *
+ * To specify a key_id, algorithm, or iv to use, please use the
+ * corresponding mongocrypt_setopt methods before calling this.
+ *
+ * This method expects the passed-in BSON to be of the form:
+ * { "v" : BSON value to encrypt }
+ *
+ * The value of "v" is expected to be the BSON value passed to a driver
+ * ClientEncryption.encrypt helper.
+ *
+ * Associated options for FLE 1:
+ * - @ref mongocrypt_ctx_setopt_key_id
+ * - @ref mongocrypt_ctx_setopt_key_alt_name
+ * - @ref mongocrypt_ctx_setopt_algorithm
+ *
+ * Associated options for Queryable Encryption:
+ * - @ref mongocrypt_ctx_setopt_key_id
+ * - @ref mongocrypt_ctx_setopt_index_key_id
+ * - @ref mongocrypt_ctx_setopt_contention_factor
+ * - @ref mongocrypt_ctx_setopt_query_type
+ * - @ref mongocrypt_ctx_setopt_algorithm_range
+ *
+ * An error is returned if FLE 1 and Queryable Encryption incompatible options
+ * are set.
+ *
+ * @param[in] ctx A @ref mongocrypt_ctx_t.
+ * @param[in] msg A @ref mongocrypt_binary_t the plaintext BSON value. The
+ * viewed data is copied. It is valid to destroy @p msg with @ref
+ * mongocrypt_binary_destroy immediately after.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_explicit_encrypt_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *msg);
+
+/**
+ * Explicit helper method to encrypt a single BSON value given without a
+ * wrapping document.
+ *
+ * Behaves like @ref mongocrypt_ctx_explicit_encrypt_init with the document
+ * { "v" : <value> }, but the caller need not build that document. Options
+ * are the same as for @ref mongocrypt_ctx_explicit_encrypt_init. Use @ref
+ * mongocrypt_ctx_finalize_value to get the ciphertext without the wrapping
+ * document. @ref mongocrypt_ctx_finalize still returns the document.
+ *
+ * @param[in] ctx A @ref mongocrypt_ctx_t.
+ * @param[in] type The BSON type of the value, e.g. 0x02 for a string.
+ * @param[in] value A @ref mongocrypt_binary_t viewing the BSON encoding of the
+ * value, without type byte or key. The viewed data is copied. It is valid to
+ * destroy @p value with @ref mongocrypt_binary_destroy immediately after.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_explicit_encrypt_value_init(mongocrypt_ctx_t *ctx, uint8_t type, mongocrypt_binary_t *value);
+
+/**
+ * Explicit helper method to encrypt a Match Expression or Aggregate Expression.
+ * Contexts created for explicit encryption will not go through mongocryptd.
+ * Requires query_type to be "range" or "rangePreview".
+ *
+ * NOTE: "rangePreview" is experimental only and is not intended for public use.
+ * API for "rangePreview" may be removed in a future release.
+ *
+ * This method expects the passed-in BSON to be of the form:
+ * { "v" : FLE2RangeFindDriverSpec }
+ *
+ * FLE2RangeFindDriverSpec is a BSON document with one of these forms:
+ *
+ * 1. A Match Expression of this form:
+ *    {$and: [{<field>: {<op>: <value1>, {<field>: {<op>: <value2> }}]}
+ * 2. An Aggregate Expression of this form:
+ *    {$and: [{<op>: [<fieldpath>, <value1>]}, {<op>: [<fieldpath>, <value2>]}]
+ *
+ * <op> may be $lt, $lte, $gt, or $gte.
+ *
+ * The value of "v" is expected to be the BSON value passed to a driver
+ * ClientEncryption.encryptExpression helper.
+ *
+ * Associated options for FLE 1:
+ * - @ref mongocrypt_ctx_setopt_key_id
+ * - @ref mongocrypt_ctx_setopt_key_alt_name
+ * - @ref mongocrypt_ctx_setopt_algorithm
+ *
+ * Associated options for Queryable Encryption:
+ * - @ref mongocrypt_ctx_setopt_key_id
+ * - @ref mongocrypt_ctx_setopt_index_key_id
+ * - @ref mongocrypt_ctx_setopt_contention_factor
+ * - @ref mongocrypt_ctx_setopt_query_type
+ * - @ref mongocrypt_ctx_setopt_algorithm_range
+ *
+ * An error is returned if FLE 1 and Queryable Encryption incompatible options
+ * are set.
+ *
+ * @param[in] ctx A @ref mongocrypt_ctx_t.
+ * @param[in] msg A @ref mongocrypt_binary_t the plaintext BSON value. The
+ * viewed data is copied. It is valid to destroy @p msg with @ref
+ * mongocrypt_binary_destroy immediately after.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_explicit_encrypt_expression_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *msg);
+
+/**
+ * Explicit helper method to encrypt many values with the same options in one
+ * context.
+ *
+ * This method expects the passed-in BSON to be of the form:
+ * { "v" : [ BSON value to encrypt, ... ] }
+ *
+ * Each value is encrypted as by @ref mongocrypt_ctx_explicit_encrypt_init
+ * with the options set on @p ctx. The keys are only requested once for all
+ * values. @ref mongocrypt_ctx_finalize returns a document of the form:
+ * { "v" : [ ciphertext, ... ] }
+ * with the ciphertexts in the order of the values.
+ *
+ * The associated options are those of @ref
+ * mongocrypt_ctx_explicit_encrypt_init. The "range" and "rangePreview" query
+ * types are not supported.
+ *
+ * @param[in] ctx A @ref mongocrypt_ctx_t.
+ * @param[in] msg A @ref mongocrypt_binary_t the BSON array of plaintext
+ * values. The viewed data is copied. It is valid to destroy @p msg with @ref
+ * mongocrypt_binary_destroy immediately after.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_explicit_encrypt_batch_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *msg);
+
+/**
+ * Explicit helper method to encrypt many range expressions on the same field
+ * in one context.
+ *
+ * This method expects the passed-in BSON to be of the form:
+ * { "v" : [ expression to encrypt, ... ] }
+ *
+ * Each expression is encrypted as by @ref
+ * mongocrypt_ctx_explicit_encrypt_expression_init with the options set on @p
+ * ctx. The keys are only requested once, and the index bounds of the range
+ * options are only set up once per BSON type, for all expressions. @ref
+ * mongocrypt_ctx_finalize returns a document of the form:
+ * { "v" : [ encrypted expression, ... ] }
+ * with the encrypted expressions in the order of the expressions.
+ *
+ * The associated options are those of @ref
+ * mongocrypt_ctx_explicit_encrypt_expression_init. The query type must be
+ * "range" or "rangePreview".
+ *
+ * @param[in] ctx A @ref mongocrypt_ctx_t.
+ * @param[in] msg A @ref mongocrypt_binary_t the BSON array of expressions. The
+ * viewed data is copied. It is valid to destroy @p msg with @ref
+ * mongocrypt_binary_destroy immediately after.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_explicit_encrypt_expression_batch_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *msg);
+
+/**
+ * Borrow large inputs instead of copying them.
+ *
+ * By default, the document passed to @ref mongocrypt_ctx_decrypt_init (or to
+ * the explicit decrypt inits), the command passed to @ref
+ * mongocrypt_ctx_encrypt_init, and the query analysis reply passed to @ref
+ * mongocrypt_ctx_mongo_feed are copied.
+ * With this option, @p ctx views them instead. This saves a copy of large
+ * cursor replies and commands.
+ *
+ * If a command passed to @ref mongocrypt_ctx_encrypt_init needs no encryption,
+ * such as a command on a collection without encrypted fields, the result of
+ * @ref mongocrypt_ctx_finalize views the command itself: its data is the data
+ * of the @ref mongocrypt_binary_t passed to init. A driver can check for this
+ * and send its own buffer unchanged.
+ *
+ * The caller must keep the viewed data alive and unmodified until @p ctx is
+ * destroyed or reset. The result of @ref mongocrypt_ctx_finalize may view it.
+ * Other inputs, such as key documents and collection info, are still copied.
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @pre @p ctx has not been initialized.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_setopt_borrow_input(mongocrypt_ctx_t *ctx);
+
+/**
+ * Set a latency budget for the context.
+ *
+ * The deadline is @p timeout_ms milliseconds after this call. Once it passes,
+ * the next call that observes the state of @p ctx moves it to @ref
+ * MONGOCRYPT_CTX_ERROR with the message "deadline exceeded", unless @p ctx is
+ * already @ref MONGOCRYPT_CTX_READY or @ref MONGOCRYPT_CTX_DONE. KMS requests
+ * returned by @ref mongocrypt_ctx_next_kms_ctx share the deadline: @ref
+ * mongocrypt_kms_ctx_feed fails once it has passed, and a failed request is
+ * not retried if the backoff would pass it.
+ *
+ * Drivers should cap their own network waits with @ref
+ * mongocrypt_ctx_remaining_us and @ref mongocrypt_kms_ctx_remaining_us.
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @param[in] timeout_ms The budget in milliseconds. Must be positive.
+ * @pre @p ctx has not been initialized.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_setopt_deadline(mongocrypt_ctx_t *ctx, int64_t timeout_ms);
+
+/**
+ * Get the time left before the deadline set with @ref
+ * mongocrypt_ctx_setopt_deadline.
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @returns The remaining microseconds, 0 if the deadline has passed, or -1 if
+ * no deadline is set.
+ */
+MONGOCRYPT_EXPORT
+int64_t mongocrypt_ctx_remaining_us(mongocrypt_ctx_t *ctx);
+
+/**
+ * Only decrypt the encrypted fields at the given paths.
+ *
+ * By default, @ref mongocrypt_ctx_decrypt_init decrypts every encrypted value
+ * of the document, and requests every key they need. With this option, only
+ * the values at @p paths are decrypted, and only their keys are requested.
+ * Other encrypted values are returned as is.
+ *
+ * A path is a dotted list of field names, like "a.b". It selects the field
+ * and every value nested in it. Array indexes are not part of paths: "a.b"
+ * selects b in each document of the array a. If the document has
+ * cursor.firstBatch or cursor.nextBatch, paths start at each document of the
+ * batch. An empty array of paths decrypts nothing.
+ *
+ * This option only applies to @ref mongocrypt_ctx_decrypt_init.
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @param[in] paths A BSON document like { "paths": [ "ssn", "address.zip" ] }.
+ * The viewed data is copied. It is valid to destroy @p paths with @ref
+ * mongocrypt_binary_destroy immediately after.
+ * @pre @p ctx has not been initialized.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_setopt_decrypt_paths(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *paths);
+
+/**
+ * @struct mongocrypt_decrypt_plan_t
+ * @brief Where the ciphertexts of a series of similar documents are.
+ *
+ * A decrypt plan is filled by each decryption it is set on, and guides the
+ * next. It is meant for the replies of one cursor: the first batch fills it,
+ * and each getMore reply then starts the keys it used before, and only looks
+ * for ciphertexts in the documents and arrays that held ciphertexts before.
+ */
+typedef struct _mongocrypt_decrypt_plan_t mongocrypt_decrypt_plan_t;
+
+/**
+ * Create a new, empty decrypt plan.
+ *
+ * @returns A new @ref mongocrypt_decrypt_plan_t. Free it with @ref
+ * mongocrypt_decrypt_plan_destroy.
+ */
+MONGOCRYPT_EXPORT
+mongocrypt_decrypt_plan_t *mongocrypt_decrypt_plan_new(void);
+
+/**
+ * Free a @ref mongocrypt_decrypt_plan_t.
+ *
+ * @param[in] plan The plan to destroy. May be NULL.
+ */
+MONGOCRYPT_EXPORT
+void mongocrypt_decrypt_plan_destroy(mongocrypt_decrypt_plan_t *plan);
+
+/**
+ * Use and update a decrypt plan.
+ *
+ * @ref mongocrypt_ctx_decrypt_init requests the keys the plan recorded, along
+ * with the keys the document needs. A key that is no longer needed or no
+ * longer exists is not an error. It then only enters the documents and arrays
+ * of the plan to find ciphertexts. If a scan of the bytes of the document
+ * finds that there may be ciphertexts elsewhere, the whole document is
+ * traversed, as without a plan, so the result is the same either way.
+ *
+ * The paths of the ciphertexts found by a traversal are added to the plan,
+ * and once the keys are available, the plan records their ids.
+ *
+ * A plan is not thread-safe: it must only be set on one context at a time,
+ * and it must outlive the contexts it is set on. This option only applies to
+ * @ref mongocrypt_ctx_decrypt_init.
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @param[in] plan The @ref mongocrypt_decrypt_plan_t to use and update.
+ * @pre @p ctx has not been initialized.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_setopt_decrypt_plan(mongocrypt_ctx_t *ctx, mongocrypt_decrypt_plan_t *plan);
+
+/**
+ * Initialize a context for decryption.
+ *
+ * This method expects the passed-in BSON to be of the form:
+ * { "v" : BSON value to encrypt }
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @param[in] doc The document to be decrypted. The viewed data is copied. It is
+ * valid to destroy @p doc with @ref mongocrypt_binary_destroy immediately
+ * after, unless @ref mongocrypt_ctx_setopt_borrow_input was set.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_decrypt_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *doc);
+
+/**
+ * Explicit helper method to decrypt a single BSON object.
+ *
+ * Pass the binary encoding of a BSON document containing the BSON value to
+ * encrypt like the following:
+ *
+ *   { "v" : (BSON BINARY value of subtype 6) }
+ *
+ * @param[in] ctx A @ref mongocrypt_ctx_t.
+ * @param[in] msg A @ref mongocrypt_binary_t the encrypted BSON. The viewed data
+ * is copied. It is valid to destroy @p msg with @ref mongocrypt_binary_destroy
+ * immediately after.
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_explicit_decrypt_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *msg);
+
+/**
+ * Explicit helper method to decrypt a single ciphertext given without a
+ * wrapping document.
+ *
+ * Behaves like @ref mongocrypt_ctx_explicit_decrypt_init with the document
+ * { "v" : (BSON BINARY value of subtype 6 with data @p ciphertext) }. Use @ref
+ * mongocrypt_ctx_finalize_value to get the decrypted value without the
+ * wrapping document.
+ *
+ * @param[in] ctx A @ref mongocrypt_ctx_t.
+ * @param[in] ciphertext A @ref mongocrypt_binary_t viewing the data of the
+ * BSON binary of subtype 6. The viewed data is copied. It is valid to destroy
+ * @p ciphertext with @ref mongocrypt_binary_destroy immediately after.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_explicit_decrypt_value_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *ciphertext);
+
+/**
+ * Explicit helper method to decrypt many BSON values in one context.
+ *
+ * Pass the binary encoding of a BSON document containing the BSON values to
+ * decrypt like the following:
+ *
+ *   { "v" : [ (BSON BINARY value of subtype 6), ... ] }
+ *
+ * The keys of all values are requested together. @ref mongocrypt_ctx_finalize
+ * returns a document of the form { "v" : [ plaintext, ... ] } with the
+ * plaintexts in the order of the ciphertexts.
+ *
+ * @param[in] ctx A @ref mongocrypt_ctx_t.
+ * @param[in] msg A @ref mongocrypt_binary_t the encrypted BSON. The viewed data
+ * is copied. It is valid to destroy @p msg with @ref mongocrypt_binary_destroy
+ * immediately after.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_explicit_decrypt_batch_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *msg);
+
+/**
+ * Decrypt the next document of a cursor batch.
+ *
+ * An alternative to @ref mongocrypt_ctx_finalize for a decryption context of
+ * a command reply with a "cursor.firstBatch" or "cursor.nextBatch" array. Each
+ * call in state @ref MONGOCRYPT_CTX_READY outputs the next document of the
+ * batch, decrypted. A document is only decrypted when it is returned, so the
+ * documents can be processed while the rest of the batch is decrypted. The
+ * call after the last document sets @p out to an empty binary and transitions
+ * the context to @ref MONGOCRYPT_CTX_DONE.
+ *
+ * Other fields of the reply are not returned. It is an error if they contain
+ * ciphertexts. @ref mongocrypt_ctx_finalize cannot be called after this
+ * function.
+ *
+ * @param[in] ctx A @ref mongocrypt_ctx_t initialized with @ref
+ * mongocrypt_ctx_decrypt_init.
+ * @param[out] out The decrypted document. The data viewed by @p out is valid
+ * until the next call with @p ctx or until @p ctx is destroyed.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_decrypt_next_document(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out);
+
+/**
+ * Get the index of the encrypted values of the document to decrypt.
+ *
+ * Together with @ref mongocrypt_ctx_decrypt_value_at, an alternative to @ref
+ * mongocrypt_ctx_finalize for callers that only read some of the encrypted
+ * fields, and want to decrypt them when they are accessed. The document passed
+ * to @ref mongocrypt_ctx_decrypt_init is used as is, and each encrypted value
+ * is decrypted on request.
+ *
+ * The index is a BSON document of the form:
+ * { "values": [ { "offset": <int64>, "keyId": <UUID> }, ... ] }
+ * with one entry per encrypted value, in document order. "offset" is the
+ * offset of the BSON element of the value from the start of the document, and
+ * "keyId" the ID of the data key that decrypts it. With @ref
+ * mongocrypt_ctx_setopt_decrypt_paths, only the selected values are indexed.
+ *
+ * @param[in] ctx A @ref mongocrypt_ctx_t initialized with @ref
+ * mongocrypt_ctx_decrypt_init, in state @ref MONGOCRYPT_CTX_READY.
+ * @param[out] out The index. The data viewed by @p out is valid until the next
+ * call with @p ctx or until @p ctx is destroyed.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_decrypt_index(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out);
+
+/**
+ * Decrypt one encrypted value of the document to decrypt.
+ *
+ * The context stays in state @ref MONGOCRYPT_CTX_READY, so any number of
+ * values may be decrypted, and @ref mongocrypt_ctx_finalize may still be
+ * called.
+ *
+ * @param[in] ctx A @ref mongocrypt_ctx_t initialized with @ref
+ * mongocrypt_ctx_decrypt_init, in state @ref MONGOCRYPT_CTX_READY.
+ * @param[in] offset The offset of the encrypted value, as returned by @ref
+ * mongocrypt_ctx_decrypt_index.
+ * @param[out] out The BSON document { "v": <decrypted value> }. The data viewed
+ * by @p out is valid until the next call with @p ctx or until @p ctx is
+ * destroyed.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_decrypt_value_at(mongocrypt_ctx_t *ctx, uint32_t offset, mongocrypt_binary_t *out);
+
+/**
+ * @brief Initialize a context to rewrap datakeys.
+ *
+ * Associated options:
+ * - @ref mongocrypt_ctx_setopt_key_encryption_key
+ * - @ref mongocrypt_ctx_setopt_rewrap_skip_unchanged
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @param[in] filter The filter to use for the find command on the key vault
+ * collection to retrieve datakeys to rewrap.
+ * @return A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status.
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_rewrap_many_datakey_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *filter);
+
+/**
+ * Skip datakeys that would not change when rewrapped.
+ *
+ * For a context initialized with @ref mongocrypt_ctx_rewrap_many_datakey_init
+ * with a key encryption key set by @ref
+ * mongocrypt_ctx_setopt_key_encryption_key, datakeys whose "masterKey"
+ * already describes that key encryption key are neither decrypted nor
+ * encrypted with a KMS, and are not in the output. This avoids repeating the
+ * KMS work of keys done by a previous, partially completed rotation.
+ *
+ * The documents output by @ref mongocrypt_ctx_finalize and @ref
+ * mongocrypt_ctx_rewrap_many_datakey_next_batch then include the number of
+ * skipped datakeys as "skipped". If every datakey is skipped, the context
+ * still goes to @ref MONGOCRYPT_CTX_READY and outputs { "v": [], "skipped": n }.
+ *
+ * Without this option, every matching datakey is rewrapped, which lets a KMS
+ * re-encrypt them with a rotated version of the same key.
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @pre @p ctx has not been initialized.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_setopt_rewrap_skip_unchanged(mongocrypt_ctx_t *ctx);
+
+/**
+ * Output the next batch of rewrapped datakeys.
+ *
+ * An alternative to @ref mongocrypt_ctx_finalize for a context initialized
+ * with @ref mongocrypt_ctx_rewrap_many_datakey_init. Each call in state @ref
+ * MONGOCRYPT_CTX_READY outputs a document of the same form as @ref
+ * mongocrypt_ctx_finalize, with at most @p max_keys keys in "v". The state
+ * for those keys is freed, so each batch can be bulk-updated into the key
+ * vault collection while later batches are built. After the last key, the
+ * next call sets @p out to an empty binary and moves the context to @ref
+ * MONGOCRYPT_CTX_DONE. @ref mongocrypt_ctx_finalize may be called instead at
+ * any point to output all remaining keys.
+ *
+ * @param[in] ctx A @ref mongocrypt_ctx_t initialized with @ref
+ * mongocrypt_ctx_rewrap_many_datakey_init.
+ * @param[in] max_keys The maximum number of keys in a batch. Must be greater
+ * than 0.
+ * @param[out] out The batch. The data viewed by @p out is valid until the next
+ * call with @p ctx or until @p ctx is destroyed.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_rewrap_many_datakey_next_batch(mongocrypt_ctx_t *ctx,
+                                                   uint32_t max_keys,
+                                                   mongocrypt_binary_t *out);
+
+/**
+ * @brief Initialize a context to fetch and decrypt data keys into the key
+ * cache ahead of their use.
+ *
+ * The context only enters the states @ref MONGOCRYPT_CTX_NEED_MONGO_KEYS,
+ * @ref MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS, and @ref MONGOCRYPT_CTX_NEED_KMS.
+ * Keys already in the cache are not fetched. Finalizing returns an empty
+ * document.
+ *
+ * This method expects the passed-in BSON to be of the form:
+ * { "keyIds" : [ UUID, ... ] }
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @param[in] key_ids A BSON document holding the UUIDs of the keys to fetch.
+ * The viewed data is copied. It is valid to destroy @p key_ids with @ref
+ * mongocrypt_binary_destroy immediately after.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status.
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_prefetch_keys_init(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *key_ids);
+
+/**
+ * @brief Initialize a context to decrypt the key documents queued with @ref
+ * mongocrypt_add_key_documents into the key cache.
+ *
+ * The context takes all queued documents. It only enters the states @ref
+ * MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS and @ref MONGOCRYPT_CTX_NEED_KMS, so it
+ * can be run by a background loop without a key vault client. Keys already in
+ * the cache are skipped, and if a key was queued more than once, the last
+ * document is used. If the context fails, the documents it took are not queued
+ * again. Finalizing returns an empty document.
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status.
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_unwrap_pending_keys_init(mongocrypt_ctx_t *ctx);
+
+/**
+ * Indicates the state of the @ref mongocrypt_ctx_t. Each state requires
+ * different handling. See [the integration
+ * guide](https://github.com/mongodb/libmongocrypt/blob/master/integrating.md#state-machine)
+ * for information on what to do for each state.
+ */
+typedef enum {
+    MONGOCRYPT_CTX_ERROR = 0,
+    MONGOCRYPT_CTX_NEED_MONGO_COLLINFO = 1,         /* run on main MongoClient */
+    MONGOCRYPT_CTX_NEED_MONGO_COLLINFO_WITH_DB = 8, /* run on main MongoClient */
+    MONGOCRYPT_CTX_NEED_MONGO_MARKINGS = 2,         /* run on mongocryptd. */
+    MONGOCRYPT_CTX_NEED_MONGO_KEYS = 3,             /* run on key vault */
+    MONGOCRYPT_CTX_NEED_KMS = 4,
+    MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS = 7, /* fetch/renew KMS credentials */
+    MONGOCRYPT_CTX_READY = 5,                /* ready for encryption/decryption */
+    MONGOCRYPT_CTX_DONE = 6,
+    MONGOCRYPT_CTX_NEED_MONGO_OPS = 9, /* run each of mongocrypt_ctx_next_mongo_op */
+} mongocrypt_ctx_state_t;
+
+/**
+ * Get the current state of a context.
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @returns A @ref mongocrypt_ctx_state_t.
+ */
+MONGOCRYPT_EXPORT
+mongocrypt_ctx_state_t mongocrypt_ctx_state(mongocrypt_ctx_t *ctx);
+
+/**
+ * Get BSON necessary to run the mongo operation when mongocrypt_ctx_t
+ * is in MONGOCRYPT_CTX_NEED_MONGO_* states.
+ *
+ * @p op_bson is a BSON document to be used for the operation.
+ * - For MONGOCRYPT_CTX_NEED_MONGO_COLLINFO(_WITH_DB) it is a listCollections filter.
+ * - For MONGOCRYPT_CTX_NEED_MONGO_KEYS it is a find filter.
+ * - For MONGOCRYPT_CTX_NEED_MONGO_MARKINGS it is a command to send to
+ * mongocryptd.
+ *
+ * The lifetime of @p op_bson is tied to the lifetime of @p ctx. It is valid
+ * until @ref mongocrypt_ctx_destroy is called.
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @param[out] op_bson A BSON document for the MongoDB operation. The data
+ * viewed by @p op_bson is guaranteed to be valid until @p ctx is destroyed with
+ * @ref mongocrypt_ctx_destroy.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_mongo_op(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *op_bson);
+
+/**
+ * Get a projection for the find filter of @ref mongocrypt_ctx_mongo_op.
+ *
+ * Only applies when mongocrypt_ctx_t is in the state:
+ * MONGOCRYPT_CTX_NEED_MONGO_KEYS.
+ *
+ * The projection only includes the fields of key documents that are used to
+ * encrypt and decrypt. Applying it to the find is optional, and reduces the
+ * size of the key documents returned. Once the projection is retrieved, key
+ * documents without the `status`, `creationDate` or `updateDate` fields are
+ * accepted by @ref mongocrypt_ctx_mongo_feed.
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @param[out] projection A BSON document for the find projection. The data
+ * viewed by @p projection is guaranteed to be valid until @p ctx is destroyed
+ * with @ref mongocrypt_ctx_destroy.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_mongo_op_projection(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *projection);
+
+/**
+ * Get the database to run the mongo operation.
+ *
+ * Only applies when mongocrypt_ctx_t is in the state:
  * MONGOCRYPT_CTX_NEED_MONGO_COLLINFO_WITH_DB.
  *
- * The lifetime of the returned string is tied to the lifetime of @p ctx. It is
- * valid until @ref mongocrypt_ctx_destroy is called.
+ * The lifetime of the returned string is tied to the lifetime of @p ctx. It is
+ * valid until @ref mongocrypt_ctx_destroy is called.
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @returns A string or NULL. If NULL, an error status is set. Retrieve it with
+ * @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+const char *mongocrypt_ctx_mongo_db(mongocrypt_ctx_t *ctx);
+
+/**
+ * Feed a BSON reply or result when mongocrypt_ctx_t is in
+ * MONGOCRYPT_CTX_NEED_MONGO_* states. This may be called multiple times
+ * depending on the operation.
+ *
+ * reply is a BSON document result being fed back for this operation.
+ * - For MONGOCRYPT_CTX_NEED_MONGO_COLLINFO(_WITH_DB) it is a doc from a listCollections
+ * cursor. (Note, if listCollections returned no result, do not call this
+ * function.)
+ * - For MONGOCRYPT_CTX_NEED_MONGO_KEYS it is a doc from a find cursor.
+ *   (Note, if find returned no results, do not call this function. reply must
+ * not
+ *   be NULL.)
+ * - For MONGOCRYPT_CTX_NEED_MONGO_MARKINGS it is a reply from mongocryptd.
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @param[in] reply A BSON document for the MongoDB operation. The viewed data
+ * is copied. It is valid to destroy @p reply with @ref
+ * mongocrypt_binary_destroy immediately after, unless @ref
+ * mongocrypt_ctx_setopt_borrow_input was set and @p reply is a reply from
+ * mongocryptd.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_mongo_feed(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *reply);
+
+/**
+ * Call when done feeding the reply (or replies) back to the context.
+ *
+ * In the MONGOCRYPT_CTX_NEED_MONGO_OPS state, call once every operation from
+ * @ref mongocrypt_ctx_next_mongo_op is done.
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_mongo_done(mongocrypt_ctx_t *ctx);
+
+/**
+ * Manages a single MongoDB operation of the MONGOCRYPT_CTX_NEED_MONGO_OPS
+ * state.
+ */
+typedef struct _mongocrypt_mongo_op_t mongocrypt_mongo_op_t;
+
+/**
+ * Get the next MongoDB operation handle.
+ *
+ * Only applies when mongocrypt_ctx_t is in the state:
+ * MONGOCRYPT_CTX_NEED_MONGO_OPS.
+ *
+ * All operations may be run at once. Operation handles are not thread-safe:
+ * feed the handles of one context from one thread at a time.
+ *
+ * The lifetime of the returned handle is tied to the lifetime of @p ctx. It is
+ * valid until @ref mongocrypt_ctx_mongo_done or @ref mongocrypt_ctx_destroy is
+ * called.
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @returns The next @ref mongocrypt_mongo_op_t, or NULL once all are returned
+ * or on error. Check @ref mongocrypt_ctx_status to distinguish.
+ */
+MONGOCRYPT_EXPORT
+mongocrypt_mongo_op_t *mongocrypt_ctx_next_mongo_op(mongocrypt_ctx_t *ctx);
+
+/**
+ * Get the kind of MongoDB operation.
+ *
+ * @param[in] op The @ref mongocrypt_mongo_op_t.
+ * @returns MONGOCRYPT_CTX_NEED_MONGO_COLLINFO_WITH_DB for a `listCollections`
+ * on the main MongoClient, or MONGOCRYPT_CTX_NEED_MONGO_KEYS for a `find` on
+ * the key vault. Handle the operation as in that state.
+ */
+MONGOCRYPT_EXPORT
+mongocrypt_ctx_state_t mongocrypt_mongo_op_type(mongocrypt_mongo_op_t *op);
+
+/**
+ * Get the database to run the MongoDB operation. Only applies to operations of
+ * type MONGOCRYPT_CTX_NEED_MONGO_COLLINFO_WITH_DB.
+ *
+ * @param[in] op The @ref mongocrypt_mongo_op_t.
+ * @returns A string or NULL. If NULL, an error status is set on the context.
+ */
+MONGOCRYPT_EXPORT
+const char *mongocrypt_mongo_op_db(mongocrypt_mongo_op_t *op);
+
+/**
+ * Get BSON necessary to run the MongoDB operation. See @ref
+ * mongocrypt_ctx_mongo_op.
+ *
+ * @param[in] op The @ref mongocrypt_mongo_op_t.
+ * @param[out] op_bson A BSON document for the MongoDB operation. The data
+ * viewed by @p op_bson is valid until the handle is no longer valid.
+ * @returns A boolean indicating success. If false, an error status is set on
+ * the context.
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_mongo_op_op(mongocrypt_mongo_op_t *op, mongocrypt_binary_t *op_bson);
+
+/**
+ * Get a projection for the find of the MongoDB operation. Only applies to
+ * operations of type MONGOCRYPT_CTX_NEED_MONGO_KEYS. See @ref
+ * mongocrypt_ctx_mongo_op_projection.
+ *
+ * @param[in] op The @ref mongocrypt_mongo_op_t.
+ * @param[out] projection A BSON document for the find projection. The data
+ * viewed by @p projection is valid until the context is destroyed.
+ * @returns A boolean indicating success. If false, an error status is set on
+ * the context.
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_mongo_op_projection(mongocrypt_mongo_op_t *op, mongocrypt_binary_t *projection);
+
+/**
+ * Feed a BSON reply or result of the MongoDB operation. See @ref
+ * mongocrypt_ctx_mongo_feed.
+ *
+ * @param[in] op The @ref mongocrypt_mongo_op_t.
+ * @param[in] reply A BSON document for the MongoDB operation. The viewed data
+ * is copied.
+ * @returns A boolean indicating success. If false, an error status is set on
+ * the context.
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_mongo_op_feed(mongocrypt_mongo_op_t *op, mongocrypt_binary_t *reply);
+
+/**
+ * Call when done feeding the reply (or replies) of the MongoDB operation.
+ *
+ * @param[in] op The @ref mongocrypt_mongo_op_t.
+ * @returns A boolean indicating success. If false, an error status is set on
+ * the context.
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_mongo_op_done(mongocrypt_mongo_op_t *op);
+
+/**
+ * Manages a single KMS HTTP request/response.
+ */
+typedef struct _mongocrypt_kms_ctx_t mongocrypt_kms_ctx_t;
+
+/**
+ * Get the next KMS handle.
+ *
+ * Multiple KMS handles may be retrieved at once. Drivers may do this to fan
+ * out multiple concurrent KMS HTTP requests. Feeding multiple KMS requests
+ * is thread-safe.
+ *
+ * If KMS handles are being handled synchronously, the driver can reuse the same
+ * TLS socket to send HTTP requests and receive responses.
+ *
+ * @param[in] ctx A @ref mongocrypt_ctx_t.
+ * @returns a new @ref mongocrypt_kms_ctx_t or NULL.
+ */
+MONGOCRYPT_EXPORT
+mongocrypt_kms_ctx_t *mongocrypt_ctx_next_kms_ctx(mongocrypt_ctx_t *ctx);
+
+/**
+ * Get the HTTP request message for a KMS handle.
+ *
+ * The lifetime of @p msg is tied to the lifetime of @p kms. It is valid
+ * until @ref mongocrypt_ctx_kms_done is called.
+ *
+ * @param[in] kms A @ref mongocrypt_kms_ctx_t.
+ * @param[out] msg The HTTP request to send to KMS. The data viewed by @p msg is
+ * guaranteed to be valid until the call of @ref mongocrypt_ctx_kms_done of the
+ * parent @ref mongocrypt_ctx_t.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_kms_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_kms_ctx_message(mongocrypt_kms_ctx_t *kms, mongocrypt_binary_t *msg);
+
+/**
+ * Get the hostname from which to connect over TLS.
+ *
+ * The storage for @p endpoint is not owned by the caller, but
+ * is valid until calling @ref mongocrypt_ctx_kms_done.
+ *
+ * @param[in] kms A @ref mongocrypt_kms_ctx_t.
+ * @param[out] endpoint The output endpoint as a NULL terminated string.
+ * The endpoint consists of a hostname and port separated by a colon.
+ * E.g. "example.com:123". A port is always present.
+ *
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_kms_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_kms_ctx_endpoint(mongocrypt_kms_ctx_t *kms, const char **endpoint);
+
+/**
+ * Indicates how many bytes to feed into @ref mongocrypt_kms_ctx_feed.
+ *
+ * @param[in] kms The @ref mongocrypt_kms_ctx_t.
+ * @returns The number of requested bytes.
+ */
+MONGOCRYPT_EXPORT
+uint32_t mongocrypt_kms_ctx_bytes_needed(mongocrypt_kms_ctx_t *kms);
+
+/**
+ * Feed bytes from the HTTP response.
+ *
+ * Feeding more bytes than what has been returned in @ref
+ * mongocrypt_kms_ctx_bytes_needed is an error.
+ *
+ * @param[in] kms The @ref mongocrypt_kms_ctx_t.
+ * @param[in] bytes The bytes to feed. The viewed data is copied. It is valid to
+ * destroy @p bytes with @ref mongocrypt_binary_destroy immediately after.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_kms_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_kms_ctx_feed(mongocrypt_kms_ctx_t *kms, mongocrypt_binary_t *bytes);
+
+/**
+ * Indicates how long to sleep before sending the message of a retried request,
+ * or of a request paced by @ref mongocrypt_setopt_kms_rate_limit.
+ *
+ * @param[in] kms The @ref mongocrypt_kms_ctx_t.
+ * @returns The number of microseconds to sleep, or 0 if the request is neither
+ * being retried nor paced.
+ */
+MONGOCRYPT_EXPORT
+int64_t mongocrypt_kms_ctx_usleep(mongocrypt_kms_ctx_t *kms);
+
+/**
+ * Get the time left before the deadline of the context that returned the
+ * request, set with @ref mongocrypt_ctx_setopt_deadline. Use it to cap the
+ * connect, send, and receive timeouts of the request.
+ *
+ * @param[in] kms The @ref mongocrypt_kms_ctx_t.
+ * @returns The remaining microseconds, 0 if the deadline has passed, or -1 if
+ * no deadline is set.
+ */
+MONGOCRYPT_EXPORT
+int64_t mongocrypt_kms_ctx_remaining_us(mongocrypt_kms_ctx_t *kms);
+
+/**
+ * Indicate a network error while sending the message or receiving the response.
+ *
+ * If retries are enabled with @ref mongocrypt_setopt_retry_kms and remain,
+ * the partial response is discarded and the request is returned again by
+ * @ref mongocrypt_ctx_next_kms_ctx. Otherwise an error status is set.
+ *
+ * @param[in] kms The @ref mongocrypt_kms_ctx_t.
+ * @returns A boolean indicating whether the request will be retried. If false,
+ * an error status is set. Retrieve it with @ref mongocrypt_kms_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_kms_ctx_fail(mongocrypt_kms_ctx_t *kms);
+
+/**
+ * Get the status associated with a @ref mongocrypt_kms_ctx_t object.
+ *
+ * @param[in] kms The @ref mongocrypt_kms_ctx_t object.
+ * @param[out] status Receives the status.
+ *
+ * @returns A boolean indicating success. If false, an error status is set.
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_kms_ctx_status(mongocrypt_kms_ctx_t *kms, mongocrypt_status_t *status);
+
+/**
+ * Get the KMS provider identifier associated with this KMS request.
+ *
+ * This is used to conditionally configure TLS connections based on the KMS
+ * request. It is useful for KMIP, which authenticates with a client
+ * certificate.
+ *
+ * @param[in] kms The @ref mongocrypt_kms_ctx_t object.
+ * @param[out] len Receives the length of the returned string. It may be NULL.
+ * If it is not NULL, it is set to the length of the returned string without
+ * the NULL terminator.
+ *
+ * @returns One of the NULL terminated static strings: "aws", "azure", "gcp", or
+ * "kmip".
+ */
+MONGOCRYPT_EXPORT
+const char *mongocrypt_kms_ctx_get_kms_provider(mongocrypt_kms_ctx_t *kms, uint32_t *len);
+
+/**
+ * Call when done handling all KMS contexts.
  *
  * @param[in] ctx The @ref mongocrypt_ctx_t object.
- * @returns A string or NULL. If NULL, an error status is set. Retrieve it with
- * @ref mongocrypt_ctx_status
+ *
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
  */
 MONGOCRYPT_EXPORT
-const char *mongocrypt_ctx_mongo_db(mongocrypt_ctx_t *ctx);
+bool mongocrypt_ctx_kms_done(mongocrypt_ctx_t *ctx);
 
 /**
- * Feed a BSON reply or result when mongocrypt_ctx_t is in
- * MONGOCRYPT_CTX_NEED_MONGO_* states. This may be called multiple times
- * depending on the operation.
+ * A built-in client that performs the KMS requests of a context.
  *
- * reply is a BSON document result being fed back for this operation.
- * - For MONGOCRYPT_CTX_NEED_MONGO_COLLINFO(_WITH_DB) it is a doc from a listCollections
- * cursor. (Note, if listCollections returned no result, do not call this
- * function.)
- * - For MONGOCRYPT_CTX_NEED_MONGO_KEYS it is a doc from a find cursor.
- *   (Note, if find returned no results, do not call this function. reply must
- * not
- *   be NULL.)
- * - For MONGOCRYPT_CTX_NEED_MONGO_MARKINGS it is a reply from mongocryptd.
+ * It is available if libmongocrypt is configured with
+ * -DENABLE_KMS_CLIENT=ON. It requires OpenSSL and POSIX sockets. Check with
+ * @ref mongocrypt_is_kms_client_available.
+ *
+ * The client sends all pending requests of a context at once over
+ * non-blocking TLS connections, and waits for them with poll. After a complete
+ * response, the connection is kept for later requests to the same endpoint,
+ * and the TLS session is reused to resume new connections. Requests are sent
+ * without the "Connection: close" header, as with
+ * @ref mongocrypt_setopt_kms_keep_alive.
+ *
+ * Host names are resolved with the blocking getaddrinfo.
+ *
+ * A client is not thread-safe. Use one client per thread, or serialize calls.
+ * Pooled connections are shared by the contexts run with the same client.
+ */
+typedef struct _mongocrypt_kms_client_t mongocrypt_kms_client_t;
+
+/**
+ * Indicates whether libmongocrypt was built with the KMS client.
+ *
+ * @returns True if @ref mongocrypt_kms_client_run can perform KMS requests.
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_is_kms_client_available(void);
+
+/**
+ * Allocate a new @ref mongocrypt_kms_client_t object.
+ *
+ * @returns A new @ref mongocrypt_kms_client_t. Free it with @ref
+ * mongocrypt_kms_client_destroy.
+ */
+MONGOCRYPT_EXPORT
+mongocrypt_kms_client_t *mongocrypt_kms_client_new(void);
+
+/**
+ * Set the CA file used to verify KMS servers, instead of the default
+ * certificate store of OpenSSL.
+ *
+ * @param[in] client The @ref mongocrypt_kms_client_t object.
+ * @param[in] path The path to a PEM file of CA certificates.
+ * @pre @ref mongocrypt_kms_client_run has not been called on @p client.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_kms_client_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_kms_client_setopt_tls_ca_file(mongocrypt_kms_client_t *client, const char *path);
+
+/**
+ * Set the client certificate presented to the KMS servers of a KMS provider.
+ * It is required by KMIP servers.
+ *
+ * @param[in] client The @ref mongocrypt_kms_client_t object.
+ * @param[in] kms_provider The name of the KMS provider, like "kmip" or
+ * "kmip:name", as returned by @ref mongocrypt_kms_ctx_get_kms_provider.
+ * @param[in] path The path to a PEM file with the certificate and its private
+ * key.
+ * @pre @ref mongocrypt_kms_client_run has not been called on @p client.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_kms_client_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_kms_client_setopt_tls_cert_key_file(mongocrypt_kms_client_t *client,
+                                                    const char *kms_provider,
+                                                    const char *path);
+
+/**
+ * Set the timeout of one attempt of a KMS request, from connecting to
+ * receiving the complete response. It is capped by the deadline of the
+ * context set with @ref mongocrypt_ctx_setopt_deadline. Defaults to 10000.
+ *
+ * A request that times out or fails on a network error is retried if
+ * @ref mongocrypt_setopt_retry_kms is enabled.
+ *
+ * @param[in] client The @ref mongocrypt_kms_client_t object.
+ * @param[in] timeout_ms The timeout in milliseconds. Must be positive.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_kms_client_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_kms_client_setopt_timeout_ms(mongocrypt_kms_client_t *client, int64_t timeout_ms);
+
+/**
+ * Perform the KMS requests of a context in the MONGOCRYPT_CTX_NEED_KMS state.
  *
+ * Replaces the loop over @ref mongocrypt_ctx_next_kms_ctx and the call of @ref
+ * mongocrypt_ctx_kms_done. Returns once @p ctx left the
+ * MONGOCRYPT_CTX_NEED_KMS state. Does nothing if @p ctx is in another state.
+ *
+ * @param[in] client The @ref mongocrypt_kms_client_t object.
  * @param[in] ctx The @ref mongocrypt_ctx_t object.
- * @param[in] reply A BSON document for the MongoDB operation. The viewed data
- * is copied. It is valid to destroy @p reply with @ref
- * mongocrypt_binary_destroy immediately after.
+ * @returns A boolean indicating success. If false, an error status is set on
+ * @p ctx. Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_kms_client_run(mongocrypt_kms_client_t *client, mongocrypt_ctx_t *ctx);
+
+/**
+ * Get the status associated with a @ref mongocrypt_kms_client_t object.
+ *
+ * @param[in] client The @ref mongocrypt_kms_client_t object.
+ * @param[out] status Receives the status.
+ * @returns A boolean indicating success. If false, an error status is set.
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_kms_client_status(mongocrypt_kms_client_t *client, mongocrypt_status_t *status);
+
+/**
+ * Destroy the @ref mongocrypt_kms_client_t object and close its connections.
+ *
+ * @param[in] client The @ref mongocrypt_kms_client_t object.
+ */
+MONGOCRYPT_EXPORT
+void mongocrypt_kms_client_destroy(mongocrypt_kms_client_t *client);
+
+/**
+ * Call in response to the MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS state
+ * to set per-context KMS provider settings. These follow the same format
+ * as @ref mongocrypt_setopt_kms_providers. If no keys are present in the
+ * BSON input, the KMS provider settings configured for the @ref mongocrypt_t
+ * at initialization are used.
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @param[in] kms_providers_definition A BSON document mapping the KMS provider
+ * names to credentials.
+ *
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status.
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_provide_kms_providers(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *kms_providers_definition);
+
+/**
+ * Perform the final encryption or decryption.
+ *
+ * @param[in] ctx A @ref mongocrypt_ctx_t.
+ * @param[out] out The final BSON. The data viewed by @p out is guaranteed
+ * to be valid until @p ctx is destroyed with @ref mongocrypt_ctx_destroy.
+ * The meaning of this BSON depends on the type of @p ctx.
+ *
+ * If @p ctx was initialized with @ref mongocrypt_ctx_encrypt_init, then
+ * this BSON is the (possibly) encrypted command to send to the server.
+ *
+ * If @p ctx was initialized with @ref mongocrypt_ctx_decrypt_init, then
+ * this BSON is the decrypted result to return to the user.
+ *
+ * If @p ctx was initialized with @ref mongocrypt_ctx_explicit_encrypt_init,
+ * then this BSON has the form { "v": (BSON binary) } where the BSON binary
+ * is the resulting encrypted value.
+ *
+ * If @p ctx was initialized with @ref mongocrypt_ctx_explicit_decrypt_init,
+ * then this BSON has the form { "v": (BSON value) } where the BSON value
+ * is the resulting decrypted value.
+ *
+ * If @p ctx was initialized with @ref mongocrypt_ctx_datakey_init, then
+ * this BSON is the document containing the new data key to be inserted into
+ * the key vault collection.
+ *
+ * If @p ctx was initialized with @ref mongocrypt_ctx_rewrap_many_datakey_init,
+ * then this BSON has the form:
+ *   { "v": [{ "_id": ..., "keyMaterial": ..., "masterKey": ... }, ...] }
+ * where each BSON document in the array contains the updated fields of a
+ * rewrapped datakey to be bulk-updated into the key vault collection.
+ * Note: the updateDate field should be updated using the $currentDate operator.
+ *
+ * @returns a bool indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_finalize(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out);
+
+/**
+ * Perform the final encryption or decryption and copy the resulting BSON
+ * into caller-provided memory.
+ *
+ * This is an alternative to @ref mongocrypt_ctx_finalize for bindings that
+ * copy the result into memory they own. The result is copied once, directly
+ * into @p buf.
+ *
+ * The first call in state MONGOCRYPT_CTX_READY finalizes @p ctx, as @ref
+ * mongocrypt_ctx_finalize does. Later calls in state MONGOCRYPT_CTX_DONE copy
+ * the same result without finalizing again. So the size may be queried first
+ * by passing a NULL @p buf, then the result copied into a buffer of that size.
+ * Calls are also allowed after @ref mongocrypt_ctx_finalize.
+ *
+ * @param[in] ctx A @ref mongocrypt_ctx_t.
+ * @param[out] buf The memory to receive the final BSON. May be NULL.
+ * @param[in] buf_len The length of @p buf.
+ * @param[out] len Receives the length of the final BSON. The BSON is copied
+ * into @p buf only if @p buf is not NULL and @p buf_len is at least @p len.
+ *
+ * @returns a bool indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_finalize_into(mongocrypt_ctx_t *ctx, uint8_t *buf, uint32_t buf_len, uint32_t *len);
+
+/**
+ * Perform the final encryption or decryption of a context initialized with
+ * @ref mongocrypt_ctx_explicit_encrypt_value_init or @ref
+ * mongocrypt_ctx_explicit_decrypt_value_init and return the single resulting
+ * value without the wrapping { "v" : ... } document.
+ *
+ * The first call in state MONGOCRYPT_CTX_READY finalizes @p ctx. Later calls
+ * in state MONGOCRYPT_CTX_DONE return the same result, as with @ref
+ * mongocrypt_ctx_finalize_into. No data is copied.
+ *
+ * @param[in] ctx A @ref mongocrypt_ctx_t.
+ * @param[out] out Is set to view the value. For encryption, this is the data
+ * of the BSON binary of subtype 6. For decryption, this is the BSON encoding of
+ * the value, without type byte or key. The data viewed by @p out lives until
+ * @p ctx is destroyed.
+ * @param[out] type Receives the BSON type of the value. For encryption, this
+ * is always 0x05 (binary).
+ *
+ * @returns a bool indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_ctx_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_ctx_finalize_value(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out, uint8_t *type);
+
+/**
+ * Get the time a context has spent in each state.
+ *
+ * @p out is set to a BSON document of int64 durations in microseconds:
+ *
+ *   {
+ *     "init": <int64>, "needMongoCollinfo": <int64>,
+ *     "needMongoCollinfoWithDb": <int64>, "needMongoMarkings": <int64>,
+ *     "needMongoKeys": <int64>, "needMongoOps": <int64>,
+ *     "needKmsCredentials": <int64>, "needKms": <int64>, "ready": <int64>,
+ *     "finalize": <int64>
+ *   }
+ *
+ * A state is timed from the first call on @p ctx that observes it, such as
+ * @ref mongocrypt_ctx_state, until the first call that observes the next
+ * state. The time in the current state is not included until it is left.
+ * "init" is the time from initialization until the first state is observed.
+ * "finalize" is the time spent in @ref mongocrypt_ctx_finalize.
+ *
+ * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @param[out] out Receives the BSON document. The data is owned by @p ctx
+ * and is valid until the next call to @ref mongocrypt_ctx_get_timings or
+ * @ref mongocrypt_ctx_destroy.
  * @returns A boolean indicating success. If false, an error status is set.
  * Retrieve it with @ref mongocrypt_ctx_status
  */
 MONGOCRYPT_EXPORT
-bool mongocrypt_ctx_mongo_feed(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *reply);
+bool mongocrypt_ctx_get_timings(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out);
+
+/**
+ * Destroy and free all memory associated with a @ref mongocrypt_ctx_t.
+ *
+ * @param[in] ctx A @ref mongocrypt_ctx_t.
+ */
+MONGOCRYPT_EXPORT
+void mongocrypt_ctx_destroy(mongocrypt_ctx_t *ctx);
+
+/**
+ * Drives the key fetching of many contexts together.
+ *
+ * Contexts of a group in MONGOCRYPT_CTX_NEED_MONGO_KEYS share one key vault
+ * `find`, and contexts in MONGOCRYPT_CTX_NEED_KMS share their KMS requests:
+ * a key needed by several contexts is decrypted with one KMS request, as with
+ * @ref mongocrypt_setopt_coalesce_kms_decrypts. Contexts in other states are
+ * not driven by the group, and are handled as usual.
+ */
+typedef struct _mongocrypt_ctx_group_t mongocrypt_ctx_group_t;
+
+/**
+ * Create a new, empty context group.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object of every context of the group.
+ * @returns A new @ref mongocrypt_ctx_group_t. Destroy with @ref
+ * mongocrypt_ctx_group_destroy.
+ */
+MONGOCRYPT_EXPORT
+mongocrypt_ctx_group_t *mongocrypt_ctx_group_new(mongocrypt_t *crypt);
 
 /**
- * Call when done feeding the reply (or replies) back to the context.
+ * Add a context to a group.
  *
- * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * Add contexts once initialized, and before they finish
+ * MONGOCRYPT_CTX_NEED_MONGO_KEYS. The group does not own @p ctx: destroy the
+ * group before its contexts.
+ *
+ * @param[in] group The @ref mongocrypt_ctx_group_t.
+ * @param[in] ctx The @ref mongocrypt_ctx_t to add.
  * @returns A boolean indicating success. If false, an error status is set.
- * Retrieve it with @ref mongocrypt_ctx_status
+ * Retrieve it with @ref mongocrypt_ctx_group_status.
  */
 MONGOCRYPT_EXPORT
-bool mongocrypt_ctx_mongo_done(mongocrypt_ctx_t *ctx);
+bool mongocrypt_ctx_group_add(mongocrypt_ctx_group_t *group, mongocrypt_ctx_t *ctx);
 
 /**
- * Manages a single KMS HTTP request/response.
+ * Get the state of a group.
+ *
+ * @param[in] group The @ref mongocrypt_ctx_group_t.
+ * @returns MONGOCRYPT_CTX_NEED_MONGO_KEYS if a context needs keys,
+ * otherwise MONGOCRYPT_CTX_NEED_KMS if a context needs KMS, otherwise
+ * MONGOCRYPT_CTX_DONE. MONGOCRYPT_CTX_ERROR if the group has an error. A
+ * context that fails does not fail the group: check the state of each context
+ * once the group is done.
  */
-typedef struct _mongocrypt_kms_ctx_t mongocrypt_kms_ctx_t;
+MONGOCRYPT_EXPORT
+mongocrypt_ctx_state_t mongocrypt_ctx_group_state(mongocrypt_ctx_group_t *group);
 
 /**
- * Get the next KMS handle.
- *
- * Multiple KMS handles may be retrieved at once. Drivers may do this to fan
- * out multiple concurrent KMS HTTP requests. Feeding multiple KMS requests
- * is thread-safe.
- *
- * If KMS handles are being handled synchronously, the driver can reuse the same
- * TLS socket to send HTTP requests and receive responses.
+ * Get the key vault `find` filter for every context of the group in
+ * MONGOCRYPT_CTX_NEED_MONGO_KEYS. Like @ref mongocrypt_ctx_mongo_op.
  *
- * @param[in] ctx A @ref mongocrypt_ctx_t.
- * @returns a new @ref mongocrypt_kms_ctx_t or NULL.
+ * @param[in] group The @ref mongocrypt_ctx_group_t.
+ * @param[out] op_bson The filter. The data viewed by @p op_bson is valid until
+ * the next call to @ref mongocrypt_ctx_group_mongo_op or @p group is destroyed.
+ * @returns A boolean indicating success. If false, an error status is set.
  */
 MONGOCRYPT_EXPORT
-mongocrypt_kms_ctx_t *mongocrypt_ctx_next_kms_ctx(mongocrypt_ctx_t *ctx);
+bool mongocrypt_ctx_group_mongo_op(mongocrypt_ctx_group_t *group, mongocrypt_binary_t *op_bson);
 
 /**
- * Get the HTTP request message for a KMS handle.
- *
- * The lifetime of @p msg is tied to the lifetime of @p kms. It is valid
- * until @ref mongocrypt_ctx_kms_done is called.
+ * Feed a key document from the `find` cursor. It is added to every context of
+ * the group that requested it. Like @ref mongocrypt_ctx_mongo_feed.
  *
- * @param[in] kms A @ref mongocrypt_kms_ctx_t.
- * @param[out] msg The HTTP request to send to KMS. The data viewed by @p msg is
- * guaranteed to be valid until the call of @ref mongocrypt_ctx_kms_done of the
- * parent @ref mongocrypt_ctx_t.
+ * @param[in] group The @ref mongocrypt_ctx_group_t.
+ * @param[in] reply A key document. The viewed data is copied.
  * @returns A boolean indicating success. If false, an error status is set.
- * Retrieve it with @ref mongocrypt_kms_ctx_status
  */
 MONGOCRYPT_EXPORT
-bool mongocrypt_kms_ctx_message(mongocrypt_kms_ctx_t *kms, mongocrypt_binary_t *msg);
+bool mongocrypt_ctx_group_mongo_feed(mongocrypt_ctx_group_t *group, mongocrypt_binary_t *reply);
 
 /**
- * Get the hostname from which to connect over TLS.
- *
- * The storage for @p endpoint is not owned by the caller, but
- * is valid until calling @ref mongocrypt_ctx_kms_done.
- *
- * @param[in] kms A @ref mongocrypt_kms_ctx_t.
- * @param[out] endpoint The output endpoint as a NULL terminated string.
- * The endpoint consists of a hostname and port separated by a colon.
- * E.g. "example.com:123". A port is always present.
+ * Call when done feeding key documents. Calls @ref mongocrypt_ctx_mongo_done
+ * on every context of the group in MONGOCRYPT_CTX_NEED_MONGO_KEYS.
  *
+ * @param[in] group The @ref mongocrypt_ctx_group_t.
  * @returns A boolean indicating success. If false, an error status is set.
- * Retrieve it with @ref mongocrypt_kms_ctx_status
  */
 MONGOCRYPT_EXPORT
-bool mongocrypt_kms_ctx_endpoint(mongocrypt_kms_ctx_t *kms, const char **endpoint);
+bool mongocrypt_ctx_group_mongo_done(mongocrypt_ctx_group_t *group);
 
 /**
- * Indicates how many bytes to feed into @ref mongocrypt_kms_ctx_feed.
+ * Get the next KMS handle of any context of the group in
+ * MONGOCRYPT_CTX_NEED_KMS. Like @ref mongocrypt_ctx_next_kms_ctx.
  *
- * @param[in] kms The @ref mongocrypt_kms_ctx_t.
- * @returns The number of requested bytes.
+ * The group may remain in MONGOCRYPT_CTX_NEED_KMS without KMS handles while a
+ * context outside the group decrypts a key. See @ref
+ * mongocrypt_setopt_coalesce_kms_decrypts.
+ *
+ * @param[in] group The @ref mongocrypt_ctx_group_t.
+ * @returns a @ref mongocrypt_kms_ctx_t or NULL.
  */
 MONGOCRYPT_EXPORT
-uint32_t mongocrypt_kms_ctx_bytes_needed(mongocrypt_kms_ctx_t *kms);
+mongocrypt_kms_ctx_t *mongocrypt_ctx_group_next_kms_ctx(mongocrypt_ctx_group_t *group);
 
 /**
- * Feed bytes from the HTTP response.
- *
- * Feeding more bytes than what has been returned in @ref
- * mongocrypt_kms_ctx_bytes_needed is an error.
+ * Call when done with the KMS handles of the group. Calls @ref
+ * mongocrypt_ctx_kms_done on every context of the group in
+ * MONGOCRYPT_CTX_NEED_KMS.
  *
- * @param[in] kms The @ref mongocrypt_kms_ctx_t.
- * @param[in] bytes The bytes to feed. The viewed data is copied. It is valid to
- * destroy @p bytes with @ref mongocrypt_binary_destroy immediately after.
+ * @param[in] group The @ref mongocrypt_ctx_group_t.
  * @returns A boolean indicating success. If false, an error status is set.
- * Retrieve it with @ref mongocrypt_kms_ctx_status
  */
 MONGOCRYPT_EXPORT
-bool mongocrypt_kms_ctx_feed(mongocrypt_kms_ctx_t *kms, mongocrypt_binary_t *bytes);
+bool mongocrypt_ctx_group_kms_done(mongocrypt_ctx_group_t *group);
 
 /**
- * Get the status associated with a @ref mongocrypt_kms_ctx_t object.
+ * Get the status of a group.
  *
- * @param[in] kms The @ref mongocrypt_kms_ctx_t object.
+ * @param[in] group The @ref mongocrypt_ctx_group_t.
  * @param[out] status Receives the status.
- *
  * @returns A boolean indicating success. If false, an error status is set.
  */
 MONGOCRYPT_EXPORT
-bool mongocrypt_kms_ctx_status(mongocrypt_kms_ctx_t *kms, mongocrypt_status_t *status);
+bool mongocrypt_ctx_group_status(mongocrypt_ctx_group_t *group, mongocrypt_status_t *status);
 
 /**
- * Get the KMS provider identifier associated with this KMS request.
+ * Destroy a group. The contexts of the group are not destroyed.
  *
- * This is used to conditionally configure TLS connections based on the KMS
- * request. It is useful for KMIP, which authenticates with a client
- * certificate.
+ * @param[in] group The @ref mongocrypt_ctx_group_t.
+ */
+MONGOCRYPT_EXPORT
+void mongocrypt_ctx_group_destroy(mongocrypt_ctx_group_t *group);
+
+/**
+ * A decrypted data encryption key, kept to encrypt and decrypt values
+ * explicitly without a context.
  *
- * @param[in] kms The @ref mongocrypt_kms_ctx_t object.
- * @param[out] len Receives the length of the returned string. It may be NULL.
- * If it is not NULL, it is set to the length of the returned string without
- * the NULL terminator.
+ * A handle is taken from an explicit encryption context once its key is
+ * decrypted. Values are then encrypted and decrypted with the handle directly,
+ * without the key cache and the state machine of a context. Only the
+ * Deterministic and Random algorithms are supported.
  *
- * @returns One of the NULL terminated static strings: "aws", "azure", "gcp", or
- * "kmip".
+ * A handle holds the key material in memory until it is destroyed.
  */
-MONGOCRYPT_EXPORT
-const char *mongocrypt_kms_ctx_get_kms_provider(mongocrypt_kms_ctx_t *kms, uint32_t *len);
+typedef struct _mongocrypt_key_handle_t mongocrypt_key_handle_t;
 
 /**
- * Call when done handling all KMS contexts.
+ * Take a handle to the key of an explicit encryption context.
+ *
+ * @p ctx must be initialized with @ref mongocrypt_ctx_explicit_encrypt_init or
+ * @ref mongocrypt_ctx_explicit_encrypt_batch_init with the Deterministic or
+ * Random algorithm, and be in state @ref MONGOCRYPT_CTX_READY or @ref
+ * MONGOCRYPT_CTX_DONE. The handle encrypts with the algorithm of @p ctx.
  *
  * @param[in] ctx The @ref mongocrypt_ctx_t object.
+ * @returns A new @ref mongocrypt_key_handle_t, or NULL and an error status is
+ * set on @p ctx. Destroy with @ref mongocrypt_key_handle_destroy. The handle
+ * may outlive @p ctx, but not the @ref mongocrypt_t of @p ctx.
+ */
+MONGOCRYPT_EXPORT
+mongocrypt_key_handle_t *mongocrypt_ctx_key_handle(mongocrypt_ctx_t *ctx);
+
+/**
+ * Explicit encrypt a value with a key handle.
  *
+ * @param[in] handle The @ref mongocrypt_key_handle_t.
+ * @param[in] msg A BSON document of the form { "v": BSON value to encrypt }.
+ * @param[out] out Set to a BSON document of the form { "v": BSON binary
+ * subtype 6 }. The data viewed by @p out is valid until the next use of
+ * @p handle, or until @p handle is destroyed.
  * @returns A boolean indicating success. If false, an error status is set.
- * Retrieve it with @ref mongocrypt_ctx_status
+ * Retrieve it with @ref mongocrypt_key_handle_status.
  */
 MONGOCRYPT_EXPORT
-bool mongocrypt_ctx_kms_done(mongocrypt_ctx_t *ctx);
+bool mongocrypt_key_handle_encrypt(mongocrypt_key_handle_t *handle, mongocrypt_binary_t *msg, mongocrypt_binary_t *out);
 
 /**
- * Call in response to the MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS state
- * to set per-context KMS provider settings. These follow the same format
- * as @ref mongocrypt_setopt_kms_providers. If no keys are present in the
- * BSON input, the KMS provider settings configured for the @ref mongocrypt_t
- * at initialization are used.
+ * Explicit decrypt a value with a key handle.
  *
- * @param[in] ctx The @ref mongocrypt_ctx_t object.
- * @param[in] kms_providers_definition A BSON document mapping the KMS provider
- * names to credentials.
+ * The value must have been encrypted with the Deterministic or Random
+ * algorithm and the key of @p handle.
  *
+ * @param[in] handle The @ref mongocrypt_key_handle_t.
+ * @param[in] msg A BSON document of the form { "v": BSON binary subtype 6 }.
+ * @param[out] out Set to a BSON document of the form { "v": decrypted BSON
+ * value }. The data viewed by @p out is valid until the next use of @p handle,
+ * or until @p handle is destroyed.
  * @returns A boolean indicating success. If false, an error status is set.
- * Retrieve it with @ref mongocrypt_ctx_status.
+ * Retrieve it with @ref mongocrypt_key_handle_status.
  */
 MONGOCRYPT_EXPORT
-bool mongocrypt_ctx_provide_kms_providers(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *kms_providers_definition);
+bool mongocrypt_key_handle_decrypt(mongocrypt_key_handle_t *handle, mongocrypt_binary_t *msg, mongocrypt_binary_t *out);
 
 /**
- * Perform the final encryption or decryption.
+ * Get the status of the last failed operation of a key handle.
  *
- * @param[in] ctx A @ref mongocrypt_ctx_t.
- * @param[out] out The final BSON. The data viewed by @p out is guaranteed
- * to be valid until @p ctx is destroyed with @ref mongocrypt_ctx_destroy.
- * The meaning of this BSON depends on the type of @p ctx.
- *
- * If @p ctx was initialized with @ref mongocrypt_ctx_encrypt_init, then
- * this BSON is the (possibly) encrypted command to send to the server.
- *
- * If @p ctx was initialized with @ref mongocrypt_ctx_decrypt_init, then
- * this BSON is the decrypted result to return to the user.
- *
- * If @p ctx was initialized with @ref mongocrypt_ctx_explicit_encrypt_init,
- * then this BSON has the form { "v": (BSON binary) } where the BSON binary
- * is the resulting encrypted value.
- *
- * If @p ctx was initialized with @ref mongocrypt_ctx_explicit_decrypt_init,
- * then this BSON has the form { "v": (BSON value) } where the BSON value
- * is the resulting decrypted value.
- *
- * If @p ctx was initialized with @ref mongocrypt_ctx_datakey_init, then
- * this BSON is the document containing the new data key to be inserted into
- * the key vault collection.
+ * An error does not invalidate the handle.
  *
- * If @p ctx was initialized with @ref mongocrypt_ctx_rewrap_many_datakey_init,
- * then this BSON has the form:
- *   { "v": [{ "_id": ..., "keyMaterial": ..., "masterKey": ... }, ...] }
- * where each BSON document in the array contains the updated fields of a
- * rewrapped datakey to be bulk-updated into the key vault collection.
- * Note: the updateDate field should be updated using the $currentDate operator.
+ * @param[in] handle The @ref mongocrypt_key_handle_t.
+ * @param[out] status Receives the status.
+ * @returns A boolean indicating success. If false, an error status is set.
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_key_handle_status(mongocrypt_key_handle_t *handle, mongocrypt_status_t *status);
+
+/**
+ * Destroy a key handle and its key material.
  *
- * @returns a bool indicating success. If false, an error status is set.
- * Retrieve it with @ref mongocrypt_ctx_status
+ * @param[in] handle The @ref mongocrypt_key_handle_t.
  */
 MONGOCRYPT_EXPORT
-bool mongocrypt_ctx_finalize(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *out);
+void mongocrypt_key_handle_destroy(mongocrypt_key_handle_t *handle);
 
 /**
- * Destroy and free all memory associated with a @ref mongocrypt_ctx_t.
+ * Reset a @ref mongocrypt_ctx_t to the state of a new context.
+ *
+ * The options and state of the previous operation are cleared, and the same
+ * context may be initialized again. This avoids allocating a new context for
+ * each operation. Output obtained from @p ctx, such as from @ref
+ * mongocrypt_ctx_finalize, is no longer valid after reset.
  *
  * @param[in] ctx A @ref mongocrypt_ctx_t.
+ * @returns A boolean indicating success.
  */
 MONGOCRYPT_EXPORT
-void mongocrypt_ctx_destroy(mongocrypt_ctx_t *ctx);
+bool mongocrypt_ctx_reset(mongocrypt_ctx_t *ctx);
 
 /**
  * An crypto AES-256-CBC encrypt or decrypt function.
@@ -1335,6 +3621,13 @@ typedef bool (*mongocrypt_hash_fn)(void *ctx,
  */
 typedef bool (*mongocrypt_random_fn)(void *ctx, mongocrypt_binary_t *out, uint32_t count, mongocrypt_status_t *status);
 
+/**
+ * Set the crypto hooks to use instead of the native crypto.
+ *
+ * Fails if libmongocrypt was built with ENABLE_CRYPTO_HOOKS=OFF, as do
+ * @ref mongocrypt_setopt_aes_256_ctr, @ref mongocrypt_setopt_aes_256_ecb and
+ * @ref mongocrypt_setopt_crypto_hook_hmac_sha_256_batch.
+ */
 MONGOCRYPT_EXPORT
 bool mongocrypt_setopt_crypto_hooks(mongocrypt_t *crypt,
                                     mongocrypt_crypto_fn aes_256_cbc_encrypt,
@@ -1382,6 +3675,218 @@ bool mongocrypt_setopt_aes_256_ctr(mongocrypt_t *crypt,
 MONGOCRYPT_EXPORT
 bool mongocrypt_setopt_aes_256_ecb(mongocrypt_t *crypt, mongocrypt_crypto_fn aes_256_ecb_encrypt, void *ctx);
 
+/**
+ * A batched crypto HMAC function. Computes @p count independent HMACs.
+ *
+ * Currently used in callbacks for HMAC SHA-256 when deriving tokens for
+ * Queryable Encryption.
+ *
+ * @param[in] ctx An optional context object that may have been set when hooks
+ * were enabled.
+ * @param[in] keys An array of @p count keys.
+ * @param[in] ins An array of @p count inputs.
+ * @param[out] outs An array of @p count preallocated byte arrays for the
+ * outputs. See @ref mongocrypt_binary_data.
+ * @param[in] count The number of HMACs to compute.
+ * @param[out] status An optional status to pass error messages. See @ref
+ * mongocrypt_status_set.
+ * @returns A boolean indicating success. If returning false, set @p status
+ * with a message indiciating the error using @ref mongocrypt_status_set.
+ */
+typedef bool (*mongocrypt_hmac_batch_fn)(void *ctx,
+                                         mongocrypt_binary_t **keys,
+                                         mongocrypt_binary_t **ins,
+                                         mongocrypt_binary_t **outs,
+                                         uint32_t count,
+                                         mongocrypt_status_t *status);
+
+/**
+ * Set a batched crypto hook for HMAC SHA-256.
+ *
+ * When set, libmongocrypt passes groups of independent HMACs to one callback
+ * instead of calling the hmac_sha_256 hook once per HMAC. This reduces the
+ * number of callbacks for range payloads. The hmac_sha_256 hook is still used
+ * for single HMACs.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] hmac_sha_256_batch The crypto callback function.
+ * @param[in] ctx Unused. The callback receives the context passed to @ref
+ * mongocrypt_setopt_crypto_hooks.
+ * @pre @ref mongocrypt_setopt_crypto_hooks has been called on @p crypt.
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ *
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_crypto_hook_hmac_sha_256_batch(mongocrypt_t *crypt,
+                                                       mongocrypt_hmac_batch_fn hmac_sha_256_batch,
+                                                       void *ctx);
+
+/**
+ * A task run by a @ref mongocrypt_parallel_for_fn.
+ *
+ * @param[in] task_ctx The task context passed to the executor.
+ * @param[in] index The index of this call, in [0, count).
+ */
+typedef void (*mongocrypt_task_fn)(void *task_ctx, uint32_t index);
+
+/**
+ * An executor for independent tasks.
+ *
+ * The executor must call @p task exactly once with each index in [0, @p count)
+ * and return only after every call has returned. The calls may run
+ * concurrently and on any threads.
+ *
+ * @param[in] ctx The context passed to @ref mongocrypt_setopt_parallel_for.
+ * @param[in] task The task to run.
+ * @param[in] task_ctx The context to pass to every call of @p task.
+ * @param[in] count The number of times to call @p task.
+ */
+typedef void (*mongocrypt_parallel_for_fn)(void *ctx, mongocrypt_task_fn task, void *task_ctx, uint32_t count);
+
+/**
+ * Set an executor to spread the work of encrypting one value across threads.
+ *
+ * Currently used to derive the edge tokens of range insert payloads with one
+ * task per edge, to convert markings if @ref
+ * mongocrypt_setopt_parallel_marking_threshold is set, to decrypt
+ * ciphertexts if @ref mongocrypt_setopt_parallel_decrypt_threshold is set, and
+ * to unwrap local keys if @ref mongocrypt_setopt_parallel_key_unwrap_threshold
+ * is set. Without an executor,
+ * edges are processed on the calling thread. Tasks call the crypto hooks, if
+ * set, so the hooks must be safe to call concurrently. Unless markings are
+ * converted by the executor, the random hook is only called from the calling
+ * thread. The hmac_sha_256_batch hook is not used for edge tokens derived by
+ * the executor.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] parallel_for The executor.
+ * @param[in] ctx A context passed to every call of @p parallel_for.
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_parallel_for(mongocrypt_t *crypt, mongocrypt_parallel_for_fn parallel_for, void *ctx);
+
+/**
+ * Set the number of markings from which an encrypted command converts its
+ * markings to ciphertexts with the executor set by @ref
+ * mongocrypt_setopt_parallel_for.
+ *
+ * Each marking, e.g. one encrypted field of one document of a bulk insert, is
+ * converted by its own task and the ciphertexts are placed in the command in
+ * order. Tasks call the crypto hooks, including the random hook, so all hooks
+ * must be safe to call concurrently. A task may call the executor again to
+ * derive the edge tokens of a range insert payload, so the executor must not
+ * wait on a task that is itself waiting for the executor.
+ *
+ * By default, markings are converted on the calling thread. This option has no
+ * effect without an executor.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] min_markings The minimum number of markings in a command to use
+ * the executor, or 0 to always convert markings on the calling thread.
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_parallel_marking_threshold(mongocrypt_t *crypt, uint32_t min_markings);
+
+/**
+ * Set the number of ciphertexts from which @ref mongocrypt_ctx_finalize of a
+ * decryption context decrypts them with the executor set by @ref
+ * mongocrypt_setopt_parallel_for.
+ *
+ * The ciphertexts of each document of cursor.firstBatch or cursor.nextBatch are
+ * decrypted by one task, and any other ciphertext by its own task. The
+ * plaintexts are placed in the document in order. Tasks call the crypto hooks, so the hooks must be safe
+ * to call concurrently. Documents streamed with @ref
+ * mongocrypt_ctx_decrypt_next_document are decrypted on the calling thread.
+ *
+ * By default, ciphertexts are decrypted on the calling thread. This option has
+ * no effect without an executor.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] min_ciphertexts The minimum number of ciphertexts in a document to
+ * use the executor, or 0 to always decrypt on the calling thread.
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_parallel_decrypt_threshold(mongocrypt_t *crypt, uint32_t min_ciphertexts);
+
+/**
+ * Set the number of data keys encrypted with a "local" KMS provider from which
+ * a context unwraps them with the executor set by @ref
+ * mongocrypt_setopt_parallel_for.
+ *
+ * With this option, local keys are not unwrapped as their documents are added
+ * with @ref mongocrypt_ctx_mongo_feed, but together by @ref
+ * mongocrypt_ctx_mongo_done, each key by its own task if there are at least
+ * @p min_keys of them. This speeds up contexts that fetch many keys, like @ref
+ * mongocrypt_ctx_rewrap_many_datakey_init and @ref
+ * mongocrypt_ctx_prefetch_keys_init. Tasks call the crypto hooks, so the hooks
+ * must be safe to call concurrently.
+ *
+ * By default, each local key is unwrapped on the calling thread when it is
+ * added. This option has no effect without an executor.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] min_keys The minimum number of local keys added to a context to
+ * use the executor, or 0 to unwrap each key as it is added.
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_parallel_key_unwrap_threshold(mongocrypt_t *crypt, uint32_t min_keys);
+
+/**
+ * Keep decrypted key material in memory locked in RAM.
+ *
+ * With this option, the decrypted data keys held by the key cache and by
+ * contexts, and the Queryable Encryption tokens derived from them, are
+ * allocated from an arena of locked memory, so they are never written to swap.
+ * Memory is locked in 64 KiB slabs that are split into fixed size slots, so
+ * allocating key material stays cheap. Slots are zeroed when freed.
+ *
+ * The arena is shared by the process, and used while any @ref mongocrypt_t with
+ * this option exists. If a slot cannot be locked later, for example because the
+ * RLIMIT_MEMLOCK limit is reached, key material falls back to the heap.
+ * Allocating and freeing key material takes a lock shared by the process, so
+ * threads that create many contexts at once may contend on it.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status. @ref mongocrypt_init fails if no
+ * memory can be locked.
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_lock_key_material(mongocrypt_t *crypt);
+
+/**
+ * Initialize the native crypto library in @ref mongocrypt_init.
+ *
+ * By default, the native crypto library (OpenSSL, CNG, or Common Crypto) is
+ * initialized by the first crypto operation of the process, so creating a
+ * @ref mongocrypt_t that never encrypts or decrypts does not pay for it. If
+ * opted in, @ref mongocrypt_init initializes it instead, so the first
+ * operation is not slowed down, and initialization errors are reported early.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status. @ref mongocrypt_init fails if the
+ * native crypto library cannot be initialized.
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_eager_crypto_init(mongocrypt_t *crypt);
+
 /**
  * Set a crypto hook for the RSASSA-PKCS1-v1_5 algorithm with a SHA-256 hash.
  *
@@ -1416,6 +3921,59 @@ bool mongocrypt_setopt_crypto_hook_sign_rsaes_pkcs1_v1_5(mongocrypt_t *crypt,
 MONGOCRYPT_EXPORT
 void mongocrypt_setopt_bypass_query_analysis(mongocrypt_t *crypt);
 
+/**
+ * @brief Opt-into loading the crypt_shared library when it is first needed.
+ *
+ * By default, @ref mongocrypt_init loads and initializes the crypt_shared
+ * library, which may take a noticeable amount of time. If opted in,
+ * @ref mongocrypt_init only records that crypt_shared is requested, and the
+ * library is searched for, loaded, and initialized by the first call to @ref
+ * mongocrypt_ctx_encrypt_init for a command that needs query analysis.
+ *
+ * Errors that @ref mongocrypt_init would report for the crypt_shared library,
+ * such as failing to load from the path given to @ref
+ * mongocrypt_setopt_set_crypt_shared_lib_path_override, are instead reported
+ * by that and every later call to @ref mongocrypt_ctx_encrypt_init.
+ * @ref mongocrypt_crypt_shared_lib_version and @ref
+ * mongocrypt_crypt_shared_lib_version_string report no library until it has
+ * been loaded.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object to update
+ *
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_defer_crypt_shared_load(mongocrypt_t *crypt);
+
+/**
+ * @brief Share the key cache with other @ref mongocrypt_t objects of the
+ * process.
+ *
+ * All @ref mongocrypt_t objects initialized with the same cache domain name
+ * share one key cache. If they also set @ref
+ * mongocrypt_setopt_coalesce_kms_decrypts, contexts of any of them needing the
+ * same uncached key send one KMS request.
+ * The key cache options of the first @ref mongocrypt_t object to initialize
+ * the domain apply. The domain is destroyed with the last @ref mongocrypt_t
+ * object using it.
+ *
+ * @ref mongocrypt_init fails if another @ref mongocrypt_t object uses the
+ * domain with different KMS providers.
+ *
+ * @param[in] crypt The @ref mongocrypt_t object.
+ * @param[in] name The name of the cache domain.
+ * @param[in] len The byte length of @p name. Pass -1 to determine the string
+ * length with strlen (must be NULL terminated).
+ *
+ * @pre @ref mongocrypt_init has not been called on @p crypt.
+ * @returns A boolean indicating success. If false, an error status is set.
+ * Retrieve it with @ref mongocrypt_status
+ */
+MONGOCRYPT_EXPORT
+bool mongocrypt_setopt_cache_domain(mongocrypt_t *crypt, const char *name, int32_t len);
+
 /**
  * @brief Opt-into use of Queryable Encryption Range V2 protocol.
  *
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../mongocrypt-secure-arena-private.h"
+
+#ifndef _WIN32
+
+#include <string.h>
+#include <sys/mman.h>
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+void *_mongocrypt_os_alloc_locked(size_t len) {
+    void *ptr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        return NULL;
+    }
+    if (0 != mlock(ptr, len)) {
+        munmap(ptr, len);
+        return NULL;
+    }
+#ifdef MADV_DONTDUMP
+    /* Also keep key material out of core dumps. Not required to succeed. */
+    (void)madvise(ptr, len, MADV_DONTDUMP);
+#endif
+    return ptr;
+}
+
+bool _mongocrypt_os_relock(void *ptr, size_t len) {
+    return 0 == mlock(ptr, len);
+}
+
+void _mongocrypt_os_free_locked(void *ptr, size_t len) {
+    if (!ptr) {
+        return;
+    }
+    memset(ptr, 0, len);
+    munlock(ptr, len);
+    munmap(ptr, len);
+}
+
+#endif /* _WIN32 */
@@ -46,4 +46,64 @@ void _mongocrypt_mutex_unlock(mongocrypt_mutex_t *mutex) {
     }
 }
 
+void _mongocrypt_rwlock_init(mongocrypt_rwlock_t *rwlock) {
+    int ret = pthread_rwlock_init(rwlock, NULL);
+    if (ret) {
+        abort();
+    }
+}
+
+void _mongocrypt_rwlock_cleanup(mongocrypt_rwlock_t *rwlock) {
+    int ret = pthread_rwlock_destroy(rwlock);
+    if (ret) {
+        abort();
+    }
+}
+
+void _mongocrypt_rwlock_read_lock(mongocrypt_rwlock_t *rwlock) {
+    int ret = pthread_rwlock_rdlock(rwlock);
+    if (ret) {
+        abort();
+    }
+}
+
+void _mongocrypt_rwlock_read_unlock(mongocrypt_rwlock_t *rwlock) {
+    int ret = pthread_rwlock_unlock(rwlock);
+    if (ret) {
+        abort();
+    }
+}
+
+void _mongocrypt_rwlock_write_lock(mongocrypt_rwlock_t *rwlock) {
+    int ret = pthread_rwlock_wrlock(rwlock);
+    if (ret) {
+        abort();
+    }
+}
+
+void _mongocrypt_rwlock_write_unlock(mongocrypt_rwlock_t *rwlock) {
+    int ret = pthread_rwlock_unlock(rwlock);
+    if (ret) {
+        abort();
+    }
+}
+
+void _mongocrypt_thread_key_init(mongocrypt_thread_key_t *key, void (*destructor)(void *)) {
+    int ret = pthread_key_create(key, destructor);
+    if (ret) {
+        abort();
+    }
+}
+
+void *_mongocrypt_thread_key_get(mongocrypt_thread_key_t *key) {
+    return pthread_getspecific(*key);
+}
+
+void _mongocrypt_thread_key_set(mongocrypt_thread_key_t *key, void *value) {
+    int ret = pthread_setspecific(*key, value);
+    if (ret) {
+        abort();
+    }
+}
+
 #endif /* _WIN32 */
\ No newline at end of file
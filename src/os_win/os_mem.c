@@ -0,0 +1,44 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../mongocrypt-secure-arena-private.h"
+
+#ifdef _WIN32
+
+#include <windows.h>
+
+void *_mongocrypt_os_alloc_locked(size_t len) {
+    void *ptr = VirtualAlloc(NULL, len, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (!ptr) {
+        return NULL;
+    }
+    if (!VirtualLock(ptr, len)) {
+        VirtualFree(ptr, 0, MEM_RELEASE);
+        return NULL;
+    }
+    return ptr;
+}
+
+void _mongocrypt_os_free_locked(void *ptr, size_t len) {
+    if (!ptr) {
+        return;
+    }
+    SecureZeroMemory(ptr, len);
+    VirtualUnlock(ptr, len);
+    VirtualFree(ptr, 0, MEM_RELEASE);
+}
+
+#endif /* _WIN32 */
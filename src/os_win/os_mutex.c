@@ -34,4 +34,47 @@ void _mongocrypt_mutex_unlock(mongocrypt_mutex_t *mutex) {
     LeaveCriticalSection(mutex);
 }
 
+void _mongocrypt_rwlock_init(mongocrypt_rwlock_t *rwlock) {
+    InitializeSRWLock(rwlock);
+}
+
+void _mongocrypt_rwlock_cleanup(mongocrypt_rwlock_t *rwlock) {
+    /* SRW locks do not need to be destroyed. */
+    (void)rwlock;
+}
+
+void _mongocrypt_rwlock_read_lock(mongocrypt_rwlock_t *rwlock) {
+    AcquireSRWLockShared(rwlock);
+}
+
+void _mongocrypt_rwlock_read_unlock(mongocrypt_rwlock_t *rwlock) {
+    ReleaseSRWLockShared(rwlock);
+}
+
+void _mongocrypt_rwlock_write_lock(mongocrypt_rwlock_t *rwlock) {
+    AcquireSRWLockExclusive(rwlock);
+}
+
+void _mongocrypt_rwlock_write_unlock(mongocrypt_rwlock_t *rwlock) {
+    ReleaseSRWLockExclusive(rwlock);
+}
+
+void _mongocrypt_thread_key_init(mongocrypt_thread_key_t *key, void(NTAPI *destructor)(void *)) {
+    /* Fiber local storage, unlike thread local storage, calls a destructor. */
+    *key = FlsAlloc(destructor);
+    if (*key == FLS_OUT_OF_INDEXES) {
+        abort();
+    }
+}
+
+void *_mongocrypt_thread_key_get(mongocrypt_thread_key_t *key) {
+    return FlsGetValue(*key);
+}
+
+void _mongocrypt_thread_key_set(mongocrypt_thread_key_t *key, void *value) {
+    if (!FlsSetValue(*key, value)) {
+        abort();
+    }
+}
+
 #endif /* _WIN32 */
\ No newline at end of file
@@ -0,0 +1,322 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * bench-cache measures contention on the key and collinfo caches. Threads look
+ * up random entries of a cache holding 10 to 100k entries with
+ * _mongocrypt_cache_get, and one operation in 64 replaces an entry with
+ * _mongocrypt_cache_add_copy, as when a key or collinfo is refreshed.
+ *
+ * Each case reports total throughput, the mean latency of an operation, and
+ * the estimated lock wait: how much longer an operation takes than with one
+ * thread on the same cache size. The cache lock is not instrumented, so time
+ * spent waiting for it is only visible as that increase.
+ *
+ * Run from the source directory, optionally passing the maximum number of
+ * threads (up to 128) and a substring to select cases by name:
+ *
+ *   ./cmake-build/bench-cache [-t max_threads] [filter]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <bson/bson.h>
+#include <mongocrypt.h>
+
+#include "mongocrypt-cache-collinfo-private.h"
+#include "mongocrypt-cache-key-private.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+// Time to measure each case, in microseconds.
+#define BENCH_USEC (300 * 1000)
+
+// One operation in ADD_INTERVAL is an add rather than a get.
+#define ADD_INTERVAL 64
+
+#define MAX_THREADS 128
+
+#define KEY_DOC_PATH "./test/data/keys/ABCDEFAB123498761234123456789012-local-document.json"
+
+static void _fail(const char *what, mongocrypt_status_t *status) {
+    fprintf(stderr, "%s failed: %s\n", what, status ? mongocrypt_status_message(status, NULL) : "");
+    abort();
+}
+
+/* A cache filled with @num_entries entries, and the attributes to look them
+ * up with. Adds replace entries with @value. */
+typedef struct {
+    const char *name;
+    _mongocrypt_cache_t cache;
+    void **attrs;
+    size_t num_entries;
+    void *value;
+    cache_destroy_fn destroy_attr;
+    cache_destroy_fn destroy_value;
+} cache_case_t;
+
+static void _cache_case_fill(cache_case_t *cc) {
+    mongocrypt_status_t *status = mongocrypt_status_new();
+
+    for (size_t i = 0; i < cc->num_entries; i++) {
+        if (!_mongocrypt_cache_add_copy(&cc->cache, cc->attrs[i], cc->value, status)) {
+            _fail("_mongocrypt_cache_add_copy", status);
+        }
+    }
+    mongocrypt_status_destroy(status);
+}
+
+static void _destroy_key_attr(void *attr) {
+    _mongocrypt_cache_key_attr_destroy(attr);
+}
+
+static void _key_case_init(cache_case_t *cc, size_t num_entries) {
+    mongocrypt_status_t *status = mongocrypt_status_new();
+    bson_json_reader_t *reader;
+    bson_error_t error;
+    bson_t key_bson;
+    _mongocrypt_key_doc_t *key_doc = _mongocrypt_key_new();
+    _mongocrypt_buffer_t material;
+
+    reader = bson_json_reader_new_from_file(KEY_DOC_PATH, &error);
+    if (!reader) {
+        fprintf(stderr, "could not open %s (run from the source directory): %s\n", KEY_DOC_PATH, error.message);
+        abort();
+    }
+    bson_init(&key_bson);
+    BSON_ASSERT(bson_json_reader_read(reader, &key_bson, &error) == 1);
+    bson_json_reader_destroy(reader);
+    if (!_mongocrypt_key_parse_owned(&key_bson, key_doc, status)) {
+        _fail("_mongocrypt_key_parse_owned", status);
+    }
+
+    _mongocrypt_buffer_init_size(&material, MONGOCRYPT_KEY_LEN);
+    memset(material.data, 0, material.len);
+
+    memset(cc, 0, sizeof *cc);
+    cc->name = "key";
+    _mongocrypt_cache_key_init(&cc->cache);
+    cc->num_entries = num_entries;
+    cc->attrs = bson_malloc0(num_entries * sizeof(void *));
+    for (size_t i = 0; i < num_entries; i++) {
+        uint8_t id_data[16] = {0};
+        _mongocrypt_buffer_t id;
+
+        memcpy(id_data, &i, sizeof i);
+        _mongocrypt_buffer_init(&id);
+        id.data = id_data;
+        id.len = sizeof id_data;
+        id.subtype = BSON_SUBTYPE_UUID;
+        cc->attrs[i] = _mongocrypt_cache_key_attr_new(&id, NULL);
+    }
+    cc->value = _mongocrypt_cache_key_value_new(key_doc, &material);
+    cc->destroy_attr = _destroy_key_attr;
+    cc->destroy_value = _mongocrypt_cache_key_value_destroy;
+    _cache_case_fill(cc);
+
+    _mongocrypt_buffer_cleanup(&material);
+    _mongocrypt_key_destroy(key_doc);
+    bson_destroy(&key_bson);
+    mongocrypt_status_destroy(status);
+}
+
+static void _collinfo_case_init(cache_case_t *cc, size_t num_entries) {
+    mongocrypt_status_t *status = mongocrypt_status_new();
+    bson_t *collinfo = BCON_NEW("name", "coll", "type", "collection", "options", "{", "}");
+
+    memset(cc, 0, sizeof *cc);
+    cc->name = "collinfo";
+    _mongocrypt_cache_collinfo_init(&cc->cache);
+    cc->num_entries = num_entries;
+    cc->attrs = bson_malloc0(num_entries * sizeof(void *));
+    for (size_t i = 0; i < num_entries; i++) {
+        cc->attrs[i] = bson_strdup_printf("db.coll%zu", i);
+    }
+    cc->value = _mongocrypt_cache_collinfo_value_new(collinfo, status);
+    if (!cc->value) {
+        _fail("_mongocrypt_cache_collinfo_value_new", status);
+    }
+    cc->destroy_attr = bson_free;
+    cc->destroy_value = _mongocrypt_cache_collinfo_value_destroy;
+    _cache_case_fill(cc);
+
+    bson_destroy(collinfo);
+    mongocrypt_status_destroy(status);
+}
+
+static void _cache_case_cleanup(cache_case_t *cc) {
+    _mongocrypt_cache_cleanup(&cc->cache);
+    for (size_t i = 0; i < cc->num_entries; i++) {
+        cc->destroy_attr(cc->attrs[i]);
+    }
+    bson_free(cc->attrs);
+    cc->destroy_value(cc->value);
+}
+
+typedef struct {
+    cache_case_t *cc;
+    uint64_t rand_state;
+    int64_t deadline;
+    int64_t ops;
+    int64_t busy_usec;
+} worker_t;
+
+static void _worker_run(worker_t *w) {
+    cache_case_t *cc = w->cc;
+    mongocrypt_status_t *status = mongocrypt_status_new();
+    const int64_t start = bson_get_monotonic_time();
+
+    for (;;) {
+        // Check the clock every 256 operations.
+        if ((w->ops & 255) == 0 && bson_get_monotonic_time() >= w->deadline) {
+            break;
+        }
+        // xorshift64
+        w->rand_state ^= w->rand_state << 13;
+        w->rand_state ^= w->rand_state >> 7;
+        w->rand_state ^= w->rand_state << 17;
+        void *attr = cc->attrs[w->rand_state % cc->num_entries];
+
+        if (w->ops % ADD_INTERVAL == ADD_INTERVAL - 1) {
+            if (!_mongocrypt_cache_add_copy(&cc->cache, attr, cc->value, status)) {
+                _fail("_mongocrypt_cache_add_copy", status);
+            }
+        } else {
+            void *value;
+            if (!_mongocrypt_cache_get(&cc->cache, attr, &value) || !value) {
+                _fail("_mongocrypt_cache_get", NULL);
+            }
+            cc->destroy_value(value);
+        }
+        w->ops++;
+    }
+    w->busy_usec = bson_get_monotonic_time() - start;
+    mongocrypt_status_destroy(status);
+}
+
+#ifdef _WIN32
+typedef HANDLE thread_t;
+
+static DWORD WINAPI _worker_main(LPVOID arg) {
+    _worker_run(arg);
+    return 0;
+}
+
+static void _thread_start(thread_t *thread, worker_t *w) {
+    *thread = CreateThread(NULL, 0, _worker_main, w, 0, NULL);
+    BSON_ASSERT(*thread);
+}
+
+static void _thread_join(thread_t thread) {
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+#else
+typedef pthread_t thread_t;
+
+static void *_worker_main(void *arg) {
+    _worker_run(arg);
+    return NULL;
+}
+
+static void _thread_start(thread_t *thread, worker_t *w) {
+    BSON_ASSERT(0 == pthread_create(thread, NULL, _worker_main, w));
+}
+
+static void _thread_join(thread_t thread) {
+    BSON_ASSERT(0 == pthread_join(thread, NULL));
+}
+#endif
+
+static const char *_filter;
+
+/* Runs @cc on @nthreads threads. Returns the mean latency of an operation in
+ * nanoseconds. @base_ns is the latency with one thread, or 0 if unknown. */
+static double _run(cache_case_t *cc, int nthreads, double base_ns) {
+    char name[128];
+    worker_t workers[MAX_THREADS] = {{0}};
+    thread_t threads[MAX_THREADS];
+    int64_t ops = 0, busy_usec = 0;
+
+    bson_snprintf(name, sizeof name, "%s/entries=%zu/threads=%d", cc->name, cc->num_entries, nthreads);
+    if (_filter && !strstr(name, _filter)) {
+        return 0;
+    }
+
+    const int64_t start = bson_get_monotonic_time();
+    for (int i = 0; i < nthreads; i++) {
+        workers[i].cc = cc;
+        workers[i].rand_state = 0x9E3779B97F4A7C15ull * (uint64_t)(i + 1);
+        workers[i].deadline = start + BENCH_USEC;
+        _thread_start(&threads[i], &workers[i]);
+    }
+    for (int i = 0; i < nthreads; i++) {
+        _thread_join(threads[i]);
+        ops += workers[i].ops;
+        busy_usec += workers[i].busy_usec;
+    }
+    const int64_t elapsed = bson_get_monotonic_time() - start;
+    const double latency_ns = (double)busy_usec * 1000.0 / (double)ops;
+
+    printf("%-40s %12.0f ops/s %10.1f ns/op", name, (double)ops * 1e6 / (double)elapsed, latency_ns);
+    if (base_ns > 0) {
+        printf(" %10.1f ns/op lock wait (est)", latency_ns > base_ns ? latency_ns - base_ns : 0.0);
+    }
+    printf("\n");
+    fflush(stdout);
+    return latency_ns;
+}
+
+int main(int argc, char **argv) {
+    int max_threads = 16;
+    int i = 1;
+
+    if (i + 1 < argc && 0 == strcmp(argv[i], "-t")) {
+        max_threads = atoi(argv[i + 1]);
+        i += 2;
+    }
+    if (max_threads < 1 || max_threads > MAX_THREADS || argc - i > 1) {
+        fprintf(stderr, "usage: %s [-t max_threads] [filter]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    _filter = i < argc ? argv[i] : NULL;
+
+    const size_t entry_counts[] = {10, 1000, 100000};
+    void (*const inits[])(cache_case_t *, size_t) = {_key_case_init, _collinfo_case_init};
+
+    for (size_t c = 0; c < sizeof inits / sizeof inits[0]; c++) {
+        for (size_t e = 0; e < sizeof entry_counts / sizeof entry_counts[0]; e++) {
+            cache_case_t cc;
+            double base_ns = 0;
+
+            inits[c](&cc, entry_counts[e]);
+            for (int nthreads = 1; nthreads <= max_threads; nthreads *= 2) {
+                const double latency_ns = _run(&cc, nthreads, base_ns);
+                if (nthreads == 1) {
+                    base_ns = latency_ns;
+                }
+            }
+            _cache_case_cleanup(&cc);
+        }
+    }
+    return EXIT_SUCCESS;
+}
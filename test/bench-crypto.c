@@ -0,0 +1,402 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * bench-crypto measures the value encryption algorithms (FLE1, FLE2AEAD, FLE2,
+ * and FLE2v2AEAD) encrypting and decrypting payloads from 16B to 1MB, and the
+ * HMAC-SHA-256 derivation of QE tokens.
+ *
+ * Each is measured with the native crypto backend this library was built with
+ * (libcrypto, CommonCrypto, or CNG, chosen by MONGOCRYPT_CRYPTO), and with
+ * crypto hooks that forward to that same backend, so the difference is the
+ * cost of the hooks. To compare native backends, run it from builds with each.
+ *
+ * Run from the source directory, optionally passing a substring to select
+ * cases by name:
+ *
+ *   ./cmake-build/bench-crypto [filter]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <bson/bson.h>
+#include <mongocrypt.h>
+
+#include "mc-tokens-private.h"
+#include "mongocrypt-buffer-private.h"
+#include "mongocrypt-crypto-private.h"
+#include "mongocrypt-private.h"
+
+#if defined(MONGOCRYPT_ENABLE_CRYPTO_LIBCRYPTO)
+#define NATIVE_NAME "libcrypto"
+#elif defined(MONGOCRYPT_ENABLE_CRYPTO_COMMON_CRYPTO)
+#define NATIVE_NAME "commoncrypto"
+#elif defined(MONGOCRYPT_ENABLE_CRYPTO_CNG)
+#define NATIVE_NAME "cng"
+#else
+#define NATIVE_NAME "native"
+#endif
+
+// Minimum time to measure each case, in microseconds.
+#define BENCH_MIN_USEC (100 * 1000)
+
+static void _fail(const char *what, mongocrypt_status_t *status) {
+    fprintf(stderr, "%s failed: %s\n", what, status ? mongocrypt_status_message(status, NULL) : "");
+    abort();
+}
+
+typedef void (*bench_fn)(void *arg);
+
+static const char *_filter;
+
+// Runs @fn until it takes at least BENCH_MIN_USEC. If @bytes is not zero, it is
+// the payload size of one call, and throughput is also reported.
+static void _run(const char *name, bench_fn fn, void *arg, uint32_t bytes) {
+    if (_filter && !strstr(name, _filter)) {
+        return;
+    }
+
+    // Warm up.
+    fn(arg);
+
+    for (int64_t iters = 1;; iters *= 2) {
+        const int64_t start = bson_get_monotonic_time();
+        for (int64_t i = 0; i < iters; i++) {
+            fn(arg);
+        }
+        const int64_t elapsed = bson_get_monotonic_time() - start;
+        if (elapsed >= BENCH_MIN_USEC) {
+            printf("%-56s %12.0f ns/op", name, (double)elapsed * 1000.0 / (double)iters);
+            if (bytes) {
+                // Bytes per microsecond is MB/s.
+                printf(" %10.1f MB/s", (double)bytes * (double)iters / (double)elapsed);
+            }
+            printf("\n");
+            fflush(stdout);
+            return;
+        }
+    }
+}
+
+/* Crypto hooks that forward to the native backend. ctx is ignored. */
+
+static bool _hook_aes_256(bool (*native)(aes_256_args_t args),
+                          mongocrypt_binary_t *key,
+                          mongocrypt_binary_t *iv,
+                          mongocrypt_binary_t *in,
+                          mongocrypt_binary_t *out,
+                          uint32_t *bytes_written,
+                          mongocrypt_status_t *status) {
+    _mongocrypt_buffer_t keybuf, ivbuf, inbuf, outbuf;
+    _mongocrypt_buffer_from_binary(&keybuf, key);
+    _mongocrypt_buffer_from_binary(&ivbuf, iv);
+    _mongocrypt_buffer_from_binary(&inbuf, in);
+    _mongocrypt_buffer_from_binary(&outbuf, out);
+
+    aes_256_args_t args =
+        {.key = &keybuf, .iv = &ivbuf, .in = &inbuf, .out = &outbuf, .bytes_written = bytes_written, .status = status};
+    return native(args);
+}
+
+static bool _hook_aes_256_cbc_encrypt(void *ctx,
+                                      mongocrypt_binary_t *key,
+                                      mongocrypt_binary_t *iv,
+                                      mongocrypt_binary_t *in,
+                                      mongocrypt_binary_t *out,
+                                      uint32_t *bytes_written,
+                                      mongocrypt_status_t *status) {
+    return _hook_aes_256(_native_crypto_aes_256_cbc_encrypt, key, iv, in, out, bytes_written, status);
+}
+
+static bool _hook_aes_256_cbc_decrypt(void *ctx,
+                                      mongocrypt_binary_t *key,
+                                      mongocrypt_binary_t *iv,
+                                      mongocrypt_binary_t *in,
+                                      mongocrypt_binary_t *out,
+                                      uint32_t *bytes_written,
+                                      mongocrypt_status_t *status) {
+    return _hook_aes_256(_native_crypto_aes_256_cbc_decrypt, key, iv, in, out, bytes_written, status);
+}
+
+static bool _hook_aes_256_ctr_encrypt(void *ctx,
+                                      mongocrypt_binary_t *key,
+                                      mongocrypt_binary_t *iv,
+                                      mongocrypt_binary_t *in,
+                                      mongocrypt_binary_t *out,
+                                      uint32_t *bytes_written,
+                                      mongocrypt_status_t *status) {
+    return _hook_aes_256(_native_crypto_aes_256_ctr_encrypt, key, iv, in, out, bytes_written, status);
+}
+
+static bool _hook_aes_256_ctr_decrypt(void *ctx,
+                                      mongocrypt_binary_t *key,
+                                      mongocrypt_binary_t *iv,
+                                      mongocrypt_binary_t *in,
+                                      mongocrypt_binary_t *out,
+                                      uint32_t *bytes_written,
+                                      mongocrypt_status_t *status) {
+    return _hook_aes_256(_native_crypto_aes_256_ctr_decrypt, key, iv, in, out, bytes_written, status);
+}
+
+static bool _hook_random(void *ctx, mongocrypt_binary_t *out, uint32_t count, mongocrypt_status_t *status) {
+    _mongocrypt_buffer_t outbuf;
+    _mongocrypt_buffer_from_binary(&outbuf, out);
+    return _native_crypto_random(&outbuf, count, status);
+}
+
+static bool _hook_hmac_sha_512(void *ctx,
+                               mongocrypt_binary_t *key,
+                               mongocrypt_binary_t *in,
+                               mongocrypt_binary_t *out,
+                               mongocrypt_status_t *status) {
+    _mongocrypt_buffer_t keybuf, inbuf, outbuf;
+    _mongocrypt_buffer_from_binary(&keybuf, key);
+    _mongocrypt_buffer_from_binary(&inbuf, in);
+    _mongocrypt_buffer_from_binary(&outbuf, out);
+    return _native_crypto_hmac_sha_512(&keybuf, &inbuf, &outbuf, status);
+}
+
+static bool _hook_hmac_sha_256(void *ctx,
+                               mongocrypt_binary_t *key,
+                               mongocrypt_binary_t *in,
+                               mongocrypt_binary_t *out,
+                               mongocrypt_status_t *status) {
+    _mongocrypt_buffer_t keybuf, inbuf, outbuf;
+    _mongocrypt_buffer_from_binary(&keybuf, key);
+    _mongocrypt_buffer_from_binary(&inbuf, in);
+    _mongocrypt_buffer_from_binary(&outbuf, out);
+    return _native_crypto_hmac_sha_256(&keybuf, &inbuf, &outbuf, status);
+}
+
+static bool _hook_sha_256(void *ctx, mongocrypt_binary_t *in, mongocrypt_binary_t *out, mongocrypt_status_t *status) {
+    // Not used by the benchmarked operations, and there is no native SHA-256 to forward to.
+    CLIENT_ERR("sha_256 not expected to have been called");
+    return false;
+}
+
+static mongocrypt_t *_crypt_new(bool hooks) {
+    mongocrypt_t *crypt = mongocrypt_new();
+    uint8_t localkey_data[MONGOCRYPT_KEY_LEN] = {0};
+    mongocrypt_binary_t *localkey = mongocrypt_binary_new_from_data(localkey_data, sizeof localkey_data);
+
+    if (!mongocrypt_setopt_kms_provider_local(crypt, localkey)) {
+        goto fail;
+    }
+    if (hooks
+        && (!mongocrypt_setopt_crypto_hooks(crypt,
+                                            _hook_aes_256_cbc_encrypt,
+                                            _hook_aes_256_cbc_decrypt,
+                                            _hook_random,
+                                            _hook_hmac_sha_512,
+                                            _hook_hmac_sha_256,
+                                            _hook_sha_256,
+                                            NULL /* ctx */)
+            || !mongocrypt_setopt_aes_256_ctr(crypt, _hook_aes_256_ctr_encrypt, _hook_aes_256_ctr_decrypt, NULL))) {
+        goto fail;
+    }
+    if (!mongocrypt_init(crypt)) {
+        goto fail;
+    }
+    mongocrypt_binary_destroy(localkey);
+    return crypt;
+
+fail: {
+    mongocrypt_status_t *status = mongocrypt_status_new();
+    mongocrypt_status(crypt, status);
+    _fail("mongocrypt_init", status);
+    return NULL;
+}
+}
+
+typedef struct {
+    _mongocrypt_crypto_t *crypto;
+    const _mongocrypt_value_encryption_algorithm_t *alg;
+    _mongocrypt_buffer_t key;
+    _mongocrypt_buffer_t iv;
+    _mongocrypt_buffer_t aad;
+    _mongocrypt_buffer_t plaintext;
+    _mongocrypt_buffer_t ciphertext;
+    // Output of each encryption or decryption.
+    _mongocrypt_buffer_t out_ciphertext;
+    _mongocrypt_buffer_t out_plaintext;
+} crypt_case_t;
+
+static void _fill(_mongocrypt_buffer_t *buf, uint32_t len, uint8_t seed) {
+    _mongocrypt_buffer_init_size(buf, len);
+    for (uint32_t i = 0; i < len; i++) {
+        buf->data[i] = (uint8_t)(seed + i * 31u);
+    }
+}
+
+static void _bench_encrypt(void *arg) {
+    crypt_case_t *cc = arg;
+    mongocrypt_status_t *status = mongocrypt_status_new();
+    uint32_t written;
+
+    if (!cc->alg->do_encrypt(cc->crypto,
+                             &cc->iv,
+                             &cc->aad,
+                             &cc->key,
+                             &cc->plaintext,
+                             &cc->out_ciphertext,
+                             &written,
+                             status)) {
+        _fail("do_encrypt", status);
+    }
+    mongocrypt_status_destroy(status);
+}
+
+static void _bench_decrypt(void *arg) {
+    crypt_case_t *cc = arg;
+    mongocrypt_status_t *status = mongocrypt_status_new();
+    uint32_t written;
+
+    if (!cc->alg->do_decrypt(cc->crypto, &cc->aad, &cc->key, &cc->ciphertext, &cc->out_plaintext, &written, status)) {
+        _fail("do_decrypt", status);
+    }
+    mongocrypt_status_destroy(status);
+}
+
+static void _crypt_case_init(crypt_case_t *cc,
+                             _mongocrypt_crypto_t *crypto,
+                             const _mongocrypt_value_encryption_algorithm_t *alg,
+                             uint32_t key_len,
+                             uint32_t size) {
+    mongocrypt_status_t *status = mongocrypt_status_new();
+
+    memset(cc, 0, sizeof *cc);
+    cc->crypto = crypto;
+    cc->alg = alg;
+    _fill(&cc->key, key_len, 1);
+    _fill(&cc->iv, MONGOCRYPT_IV_LEN, 2);
+    _fill(&cc->aad, 16, 3);
+    _fill(&cc->plaintext, size, 4);
+
+    const uint32_t ciphertext_len = alg->get_ciphertext_len(size, status);
+    if (!mongocrypt_status_ok(status)) {
+        _fail("get_ciphertext_len", status);
+    }
+    _mongocrypt_buffer_init_size(&cc->out_ciphertext, ciphertext_len);
+    _bench_encrypt(cc);
+    _mongocrypt_buffer_copy_to(&cc->out_ciphertext, &cc->ciphertext);
+
+    const uint32_t plaintext_len = alg->get_plaintext_len(ciphertext_len, status);
+    if (!mongocrypt_status_ok(status)) {
+        _fail("get_plaintext_len", status);
+    }
+    _mongocrypt_buffer_init_size(&cc->out_plaintext, plaintext_len);
+    mongocrypt_status_destroy(status);
+}
+
+static void _crypt_case_cleanup(crypt_case_t *cc) {
+    _mongocrypt_buffer_cleanup(&cc->out_plaintext);
+    _mongocrypt_buffer_cleanup(&cc->out_ciphertext);
+    _mongocrypt_buffer_cleanup(&cc->ciphertext);
+    _mongocrypt_buffer_cleanup(&cc->plaintext);
+    _mongocrypt_buffer_cleanup(&cc->aad);
+    _mongocrypt_buffer_cleanup(&cc->iv);
+    _mongocrypt_buffer_cleanup(&cc->key);
+}
+
+typedef struct {
+    _mongocrypt_crypto_t *crypto;
+    _mongocrypt_buffer_t root_key;
+    _mongocrypt_buffer_t value;
+} token_case_t;
+
+// Derives the tokens for an indexed equality insert: four HMAC-SHA-256s.
+static void _bench_tokens(void *arg) {
+    token_case_t *tc = arg;
+    mongocrypt_status_t *status = mongocrypt_status_new();
+    mc_CollectionsLevel1Token_t cl1;
+    mc_EDCToken_t edc;
+    mc_EDCDerivedFromDataToken_t edc_data;
+    mc_EDCDerivedFromDataTokenAndContentionFactor_t edc_data_cf;
+
+    if (!mc_CollectionsLevel1Token_derive(&cl1, tc->crypto, &tc->root_key, status)
+        || !mc_EDCToken_derive(&edc, tc->crypto, &cl1, status)
+        || !mc_EDCDerivedFromDataToken_derive(&edc_data, tc->crypto, &edc, &tc->value, status)
+        || !mc_EDCDerivedFromDataTokenAndContentionFactor_derive(&edc_data_cf, tc->crypto, &edc_data, 4, status)) {
+        _fail("deriving tokens", status);
+    }
+    mongocrypt_status_destroy(status);
+}
+
+int main(int argc, char **argv) {
+    if (argc > 2) {
+        fprintf(stderr, "usage: %s [filter]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    _filter = argc == 2 ? argv[1] : NULL;
+
+    // The hooks call _native_crypto_ functions directly, so initialize native crypto first.
+    mongocrypt_status_t *status = mongocrypt_status_new();
+    if (!_native_crypto_ensure_init(status)) {
+        _fail("_native_crypto_ensure_init", status);
+    }
+    mongocrypt_status_destroy(status);
+
+    const struct {
+        const char *name;
+        const _mongocrypt_value_encryption_algorithm_t *alg;
+        uint32_t key_len;
+    } algs[] = {
+        {"FLE1", _mcFLE1Algorithm(), MONGOCRYPT_KEY_LEN},
+        {"FLE2AEAD", _mcFLE2AEADAlgorithm(), MONGOCRYPT_KEY_LEN},
+        {"FLE2", _mcFLE2Algorithm(), MONGOCRYPT_ENC_KEY_LEN},
+        {"FLE2v2AEAD", _mcFLE2v2AEADAlgorithm(), MONGOCRYPT_KEY_LEN},
+    };
+    const uint32_t sizes[] = {16, 256, 4 * 1024, 64 * 1024, 1024 * 1024};
+
+#ifdef MONGOCRYPT_ENABLE_CRYPTO_HOOKS
+    const int max_hooks = 1;
+#else
+    /* Hooks cannot be set in this build. */
+    const int max_hooks = 0;
+#endif
+
+    for (int hooks = 0; hooks <= max_hooks; hooks++) {
+        const char *backend = hooks ? "hooks-" NATIVE_NAME : "native-" NATIVE_NAME;
+        mongocrypt_t *crypt = _crypt_new(hooks);
+        char name[128];
+
+        for (size_t a = 0; a < sizeof algs / sizeof algs[0]; a++) {
+            for (size_t s = 0; s < sizeof sizes / sizeof sizes[0]; s++) {
+                crypt_case_t cc;
+
+                _crypt_case_init(&cc, crypt->crypto, algs[a].alg, algs[a].key_len, sizes[s]);
+                bson_snprintf(name, sizeof name, "%s/%s/encrypt/%" PRIu32 "B", backend, algs[a].name, sizes[s]);
+                _run(name, _bench_encrypt, &cc, sizes[s]);
+                bson_snprintf(name, sizeof name, "%s/%s/decrypt/%" PRIu32 "B", backend, algs[a].name, sizes[s]);
+                _run(name, _bench_decrypt, &cc, sizes[s]);
+                _crypt_case_cleanup(&cc);
+            }
+        }
+
+        token_case_t tc = {.crypto = crypt->crypto};
+        _fill(&tc.root_key, MONGOCRYPT_HMAC_SHA256_LEN, 5);
+        _fill(&tc.value, 16, 6);
+        bson_snprintf(name, sizeof name, "%s/tokens/derive", backend);
+        _run(name, _bench_tokens, &tc, 0);
+        _mongocrypt_buffer_cleanup(&tc.value);
+        _mongocrypt_buffer_cleanup(&tc.root_key);
+
+        mongocrypt_destroy(crypt);
+    }
+    return EXIT_SUCCESS;
+}
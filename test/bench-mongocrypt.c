@@ -0,0 +1,626 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * bench-mongocrypt measures whole operations through the public API: auto
+ * encryption and decryption of ./test/example/cmd.json, and explicit Queryable
+ * Encryption of an indexed equality value and of a range value and query.
+ * Replies from mongod,
+ * mongocryptd, and KMS are mocked from the files in ./test/example and
+ * ./test/data, as in example-state-machine.
+ *
+ * Each operation is measured with warm caches, sharing one mongocrypt_t that
+ * has already run the operation once, and with cold caches, creating a new
+ * mongocrypt_t for every operation. Each is run on 1, 2, 4, ... threads up to
+ * the maximum, and reports throughput and latency percentiles.
+ *
+ * With -a, each operation is instead run single-threaded with warm caches
+ * under a counting bson_mem_vtable_t, which libmongocrypt uses for all of its
+ * own allocations, and reports allocations, bytes allocated, and peak live
+ * bytes per operation.
+ *
+ * Run from the source directory, optionally passing the maximum number of
+ * threads and a substring to select cases by name:
+ *
+ *   ./cmake-build/bench-mongocrypt [-a] [-t max_threads] [filter]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <bson/bson.h>
+#include <mongocrypt.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+// Time to measure each case, in microseconds.
+#define BENCH_USEC (1000 * 1000)
+
+// Operations to run per case with -a.
+#define ALLOC_ITERS 100
+
+#define LOCAL_KEY_ID_HEX "ABCDEFAB123498761234123456789012"
+#define LOCAL_KEY_DOC_PATH "./test/data/keys/" LOCAL_KEY_ID_HEX "-local-document.json"
+
+// Each counted allocation is prefixed with its size, so frees can be counted.
+// The prefix is 16 bytes to keep the alignment malloc guarantees.
+#define ALLOC_PREFIX 16
+
+// Allocation counters for -a. Only updated while a single thread runs.
+static struct {
+    int64_t count;
+    int64_t bytes;
+    int64_t live;
+    int64_t peak;
+} _allocs;
+
+static void *_alloc_track(uint8_t *mem, size_t num_bytes) {
+    if (!mem) {
+        return NULL;
+    }
+    memcpy(mem, &num_bytes, sizeof num_bytes);
+    _allocs.count++;
+    _allocs.bytes += (int64_t)num_bytes;
+    _allocs.live += (int64_t)num_bytes;
+    if (_allocs.live > _allocs.peak) {
+        _allocs.peak = _allocs.live;
+    }
+    return mem + ALLOC_PREFIX;
+}
+
+static uint8_t *_alloc_untrack(void *mem) {
+    uint8_t *base = (uint8_t *)mem - ALLOC_PREFIX;
+    size_t num_bytes;
+
+    memcpy(&num_bytes, base, sizeof num_bytes);
+    _allocs.live -= (int64_t)num_bytes;
+    return base;
+}
+
+static void *_counting_malloc(size_t num_bytes) {
+    return _alloc_track(malloc(num_bytes + ALLOC_PREFIX), num_bytes);
+}
+
+static void *_counting_calloc(size_t n_members, size_t num_bytes) {
+    if (num_bytes && n_members > (SIZE_MAX - ALLOC_PREFIX) / num_bytes) {
+        return NULL;
+    }
+    return _alloc_track(calloc(1, n_members * num_bytes + ALLOC_PREFIX), n_members * num_bytes);
+}
+
+static void *_counting_realloc(void *mem, size_t num_bytes) {
+    if (!mem) {
+        return _counting_malloc(num_bytes);
+    }
+    return _alloc_track(realloc(_alloc_untrack(mem), num_bytes + ALLOC_PREFIX), num_bytes);
+}
+
+static void _counting_free(void *mem) {
+    if (mem) {
+        free(_alloc_untrack(mem));
+    }
+}
+
+static void _fail(const char *what, mongocrypt_status_t *status) {
+    fprintf(stderr, "%s failed: %s\n", what, status ? mongocrypt_status_message(status, NULL) : "");
+    abort();
+}
+
+static void _read_json(const char *path, bson_t *out) {
+    bson_error_t error;
+    bson_json_reader_t *reader = bson_json_reader_new_from_file(path, &error);
+    if (!reader) {
+        fprintf(stderr, "could not open %s (run from the source directory): %s\n", path, error.message);
+        abort();
+    }
+    bson_init(out);
+    if (bson_json_reader_read(reader, out, &error) != 1) {
+        fprintf(stderr, "could not read %s: %s\n", path, error.message);
+        abort();
+    }
+    bson_json_reader_destroy(reader);
+}
+
+// Reads an HTTP reply, replacing each \n with \r\n.
+static char *_read_http(const char *path, uint32_t *len) {
+    FILE *file = fopen(path, "rb");
+    char *data = NULL;
+    int c;
+
+    if (!file) {
+        fprintf(stderr, "could not open %s (run from the source directory)\n", path);
+        abort();
+    }
+    *len = 0;
+    for (uint32_t cap = 0; (c = fgetc(file)) != EOF;) {
+        if (*len + 2 > cap) {
+            cap = cap ? cap * 2 : 1024;
+            data = bson_realloc(data, cap);
+        }
+        if (c == '\n' && (*len == 0 || data[*len - 1] != '\r')) {
+            data[(*len)++] = '\r';
+        }
+        data[(*len)++] = (char)c;
+    }
+    fclose(file);
+    return data;
+}
+
+static mongocrypt_binary_t *_bson_to_binary(const bson_t *bson) {
+    return mongocrypt_binary_new_from_data((uint8_t *)bson_get_data(bson), bson->len);
+}
+
+// The mocked requests and replies. They are read once and only read after.
+static struct {
+    bson_t cmd;
+    bson_t collinfo;
+    bson_t markings;
+    bson_t aws_key_doc;
+    char *kms_reply;
+    uint32_t kms_reply_len;
+    bson_t local_key_doc;
+    uint8_t local_key_id[16];
+    bson_t encrypted_cmd;
+} _fx;
+
+static mongocrypt_t *_crypt_new(void) {
+    mongocrypt_t *crypt = mongocrypt_new();
+    uint8_t localkey_data[96] = {0};
+    mongocrypt_binary_t *localkey = mongocrypt_binary_new_from_data(localkey_data, sizeof localkey_data);
+
+    if (!mongocrypt_setopt_kms_provider_aws(crypt, "example", -1, "example", -1)
+        || !mongocrypt_setopt_kms_provider_local(crypt, localkey) || !mongocrypt_setopt_use_range_v2(crypt)
+        || !mongocrypt_init(crypt)) {
+        mongocrypt_status_t *status = mongocrypt_status_new();
+        mongocrypt_status(crypt, status);
+        _fail("mongocrypt_init", status);
+    }
+    mongocrypt_binary_destroy(localkey);
+    return crypt;
+}
+
+// Runs @ctx to completion, replying with the mocked replies. The key document
+// @key_doc is fed for keys. If @result is not NULL, it is set to the result.
+static void _run_ctx(mongocrypt_ctx_t *ctx, const bson_t *key_doc, bson_t *result) {
+    mongocrypt_binary_t *out = mongocrypt_binary_new();
+    mongocrypt_binary_t *in = NULL;
+    mongocrypt_kms_ctx_t *kms;
+
+    for (;;) {
+        switch (mongocrypt_ctx_state(ctx)) {
+        case MONGOCRYPT_CTX_NEED_MONGO_COLLINFO_WITH_DB:
+        case MONGOCRYPT_CTX_NEED_MONGO_COLLINFO: in = _bson_to_binary(&_fx.collinfo); goto feed;
+        case MONGOCRYPT_CTX_NEED_MONGO_MARKINGS: in = _bson_to_binary(&_fx.markings); goto feed;
+        case MONGOCRYPT_CTX_NEED_MONGO_KEYS:
+            in = _bson_to_binary(key_doc);
+        feed:
+            if (!mongocrypt_ctx_mongo_feed(ctx, in) || !mongocrypt_ctx_mongo_done(ctx)) {
+                goto fail;
+            }
+            mongocrypt_binary_destroy(in);
+            break;
+        case MONGOCRYPT_CTX_NEED_KMS:
+            while ((kms = mongocrypt_ctx_next_kms_ctx(ctx))) {
+                in = mongocrypt_binary_new_from_data((uint8_t *)_fx.kms_reply, _fx.kms_reply_len);
+                if (!mongocrypt_kms_ctx_feed(kms, in)) {
+                    mongocrypt_status_t *status = mongocrypt_status_new();
+                    mongocrypt_kms_ctx_status(kms, status);
+                    _fail("mongocrypt_kms_ctx_feed", status);
+                }
+                mongocrypt_binary_destroy(in);
+            }
+            if (!mongocrypt_ctx_kms_done(ctx)) {
+                goto fail;
+            }
+            break;
+        case MONGOCRYPT_CTX_READY:
+            if (!mongocrypt_ctx_finalize(ctx, out)) {
+                goto fail;
+            }
+            if (result) {
+                bson_t tmp;
+                BSON_ASSERT(bson_init_static(&tmp, mongocrypt_binary_data(out), mongocrypt_binary_len(out)));
+                bson_copy_to(&tmp, result);
+            }
+            break;
+        case MONGOCRYPT_CTX_DONE: mongocrypt_binary_destroy(out); return;
+        default: goto fail;
+        }
+    }
+
+fail: {
+    mongocrypt_status_t *status = mongocrypt_status_new();
+    mongocrypt_ctx_status(ctx, status);
+    _fail("running context", status);
+}
+}
+
+static void _op_auto_encrypt(mongocrypt_t *crypt, bson_t *result) {
+    mongocrypt_ctx_t *ctx = mongocrypt_ctx_new(crypt);
+    mongocrypt_binary_t *cmd = _bson_to_binary(&_fx.cmd);
+
+    if (!mongocrypt_ctx_encrypt_init(ctx, "test", -1, cmd)) {
+        mongocrypt_status_t *status = mongocrypt_status_new();
+        mongocrypt_ctx_status(ctx, status);
+        _fail("mongocrypt_ctx_encrypt_init", status);
+    }
+    _run_ctx(ctx, &_fx.aws_key_doc, result);
+    mongocrypt_binary_destroy(cmd);
+    mongocrypt_ctx_destroy(ctx);
+}
+
+static void _bench_auto_encrypt(mongocrypt_t *crypt) {
+    _op_auto_encrypt(crypt, NULL);
+}
+
+static void _bench_auto_decrypt(mongocrypt_t *crypt) {
+    mongocrypt_ctx_t *ctx = mongocrypt_ctx_new(crypt);
+    mongocrypt_binary_t *doc = _bson_to_binary(&_fx.encrypted_cmd);
+
+    if (!mongocrypt_ctx_decrypt_init(ctx, doc)) {
+        mongocrypt_status_t *status = mongocrypt_status_new();
+        mongocrypt_ctx_status(ctx, status);
+        _fail("mongocrypt_ctx_decrypt_init", status);
+    }
+    _run_ctx(ctx, &_fx.aws_key_doc, NULL);
+    mongocrypt_binary_destroy(doc);
+    mongocrypt_ctx_destroy(ctx);
+}
+
+// Explicitly encrypts {"v": @value} with the local key and @algorithm. If
+// @query_type is not NULL, {"v": @value} is encrypted as a query expression.
+static void _explicit_encrypt(mongocrypt_t *crypt,
+                              const char *algorithm,
+                              const char *query_type,
+                              const bson_t *range_opts,
+                              bson_t *value) {
+    mongocrypt_ctx_t *ctx = mongocrypt_ctx_new(crypt);
+    mongocrypt_binary_t *key_id = mongocrypt_binary_new_from_data(_fx.local_key_id, sizeof _fx.local_key_id);
+    mongocrypt_binary_t *msg = _bson_to_binary(value);
+    mongocrypt_binary_t *opts = range_opts ? _bson_to_binary(range_opts) : NULL;
+
+    if (!mongocrypt_ctx_setopt_key_id(ctx, key_id) || !mongocrypt_ctx_setopt_algorithm(ctx, algorithm, -1)
+        || !mongocrypt_ctx_setopt_contention_factor(ctx, 4)
+        || (opts && !mongocrypt_ctx_setopt_algorithm_range(ctx, opts))
+        || (query_type && !mongocrypt_ctx_setopt_query_type(ctx, query_type, -1))
+        || (query_type ? !mongocrypt_ctx_explicit_encrypt_expression_init(ctx, msg)
+                       : !mongocrypt_ctx_explicit_encrypt_init(ctx, msg))) {
+        mongocrypt_status_t *status = mongocrypt_status_new();
+        mongocrypt_ctx_status(ctx, status);
+        _fail("mongocrypt_ctx_explicit_encrypt_init", status);
+    }
+    _run_ctx(ctx, &_fx.local_key_doc, NULL);
+    mongocrypt_binary_destroy(opts);
+    mongocrypt_binary_destroy(msg);
+    mongocrypt_binary_destroy(key_id);
+    mongocrypt_ctx_destroy(ctx);
+}
+
+static void _bench_explicit_equality(mongocrypt_t *crypt) {
+    bson_t *value = BCON_NEW("v", "457-55-5462");
+
+    _explicit_encrypt(crypt, MONGOCRYPT_ALGORITHM_INDEXED_STR, NULL, NULL, value);
+    bson_destroy(value);
+}
+
+static bson_t *_range_opts_new(void) {
+    return BCON_NEW("min",
+                    BCON_INT32(0),
+                    "max",
+                    BCON_INT32(1000000),
+                    "sparsity",
+                    BCON_INT64(1),
+                    "trimFactor",
+                    BCON_INT32(6));
+}
+
+static void _bench_explicit_range_insert(mongocrypt_t *crypt) {
+    bson_t *range_opts = _range_opts_new();
+    bson_t *value = BCON_NEW("v", BCON_INT32(123456));
+
+    _explicit_encrypt(crypt, MONGOCRYPT_ALGORITHM_RANGE_STR, NULL, range_opts, value);
+    bson_destroy(value);
+    bson_destroy(range_opts);
+}
+
+static void _bench_explicit_range_find(mongocrypt_t *crypt) {
+    bson_t *range_opts = _range_opts_new();
+    bson_t *expr = BCON_NEW("v",
+                            "{",
+                            "$and",
+                            "[",
+                            "{",
+                            "v",
+                            "{",
+                            "$gte",
+                            BCON_INT32(1000),
+                            "}",
+                            "}",
+                            "{",
+                            "v",
+                            "{",
+                            "$lte",
+                            BCON_INT32(2000),
+                            "}",
+                            "}",
+                            "]",
+                            "}");
+
+    _explicit_encrypt(crypt, MONGOCRYPT_ALGORITHM_RANGE_STR, MONGOCRYPT_QUERY_TYPE_RANGE_STR, range_opts, expr);
+    bson_destroy(expr);
+    bson_destroy(range_opts);
+}
+
+typedef void (*bench_fn)(mongocrypt_t *crypt);
+
+typedef struct {
+    bench_fn fn;
+    // The shared mongocrypt_t of a warm case, or NULL to create one per operation.
+    mongocrypt_t *crypt;
+    int64_t deadline;
+    // The latency of each operation, in microseconds.
+    int64_t *latencies;
+    size_t len;
+    size_t cap;
+} worker_t;
+
+static void _worker_run(worker_t *w) {
+    for (;;) {
+        const int64_t start = bson_get_monotonic_time();
+        if (start >= w->deadline) {
+            return;
+        }
+        if (w->crypt) {
+            w->fn(w->crypt);
+        } else {
+            mongocrypt_t *crypt = _crypt_new();
+            w->fn(crypt);
+            mongocrypt_destroy(crypt);
+        }
+        if (w->len == w->cap) {
+            w->cap = w->cap ? w->cap * 2 : 1024;
+            w->latencies = bson_realloc(w->latencies, w->cap * sizeof(int64_t));
+        }
+        w->latencies[w->len++] = bson_get_monotonic_time() - start;
+    }
+}
+
+#ifdef _WIN32
+typedef HANDLE thread_t;
+
+static DWORD WINAPI _worker_main(LPVOID arg) {
+    _worker_run(arg);
+    return 0;
+}
+
+static void _thread_start(thread_t *thread, worker_t *w) {
+    *thread = CreateThread(NULL, 0, _worker_main, w, 0, NULL);
+    BSON_ASSERT(*thread);
+}
+
+static void _thread_join(thread_t thread) {
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+#else
+typedef pthread_t thread_t;
+
+static void *_worker_main(void *arg) {
+    _worker_run(arg);
+    return NULL;
+}
+
+static void _thread_start(thread_t *thread, worker_t *w) {
+    BSON_ASSERT(0 == pthread_create(thread, NULL, _worker_main, w));
+}
+
+static void _thread_join(thread_t thread) {
+    BSON_ASSERT(0 == pthread_join(thread, NULL));
+}
+#endif
+
+static int _cmp_int64(const void *a, const void *b) {
+    const int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static const char *_filter;
+
+static void _run(const char *name, bench_fn fn, bool warm, int nthreads) {
+    char full_name[128];
+    worker_t *workers = bson_malloc0((size_t)nthreads * sizeof(worker_t));
+    thread_t *threads = bson_malloc0((size_t)nthreads * sizeof(thread_t));
+    mongocrypt_t *crypt = NULL;
+    int64_t *all;
+    size_t total = 0;
+
+    bson_snprintf(full_name, sizeof full_name, "%s/%s/threads=%d", name, warm ? "warm" : "cold", nthreads);
+    if (_filter && !strstr(full_name, _filter)) {
+        bson_free(threads);
+        bson_free(workers);
+        return;
+    }
+
+    if (warm) {
+        crypt = _crypt_new();
+        // Populate the caches.
+        fn(crypt);
+    }
+
+    const int64_t start = bson_get_monotonic_time();
+    for (int i = 0; i < nthreads; i++) {
+        workers[i].fn = fn;
+        workers[i].crypt = crypt;
+        workers[i].deadline = start + BENCH_USEC;
+        _thread_start(&threads[i], &workers[i]);
+    }
+    for (int i = 0; i < nthreads; i++) {
+        _thread_join(threads[i]);
+        total += workers[i].len;
+    }
+    const int64_t elapsed = bson_get_monotonic_time() - start;
+
+    all = bson_malloc0((total ? total : 1u) * sizeof(int64_t));
+    total = 0;
+    for (int i = 0; i < nthreads; i++) {
+        memcpy(all + total, workers[i].latencies, workers[i].len * sizeof(int64_t));
+        total += workers[i].len;
+        bson_free(workers[i].latencies);
+    }
+    qsort(all, total, sizeof(int64_t), _cmp_int64);
+
+    if (total > 0) {
+        printf("%-48s %10.0f ops/s   p50 %8" PRId64 " us   p90 %8" PRId64 " us   p99 %8" PRId64 " us\n",
+               full_name,
+               (double)total * 1000000.0 / (double)elapsed,
+               all[(total - 1) * 50 / 100],
+               all[(total - 1) * 90 / 100],
+               all[(total - 1) * 99 / 100]);
+        fflush(stdout);
+    }
+
+    bson_free(all);
+    bson_free(threads);
+    bson_free(workers);
+    mongocrypt_destroy(crypt);
+}
+
+static void _run_allocs(const char *name, bench_fn fn) {
+    char full_name[128];
+    int64_t count, bytes, peak = 0;
+
+    bson_snprintf(full_name, sizeof full_name, "%s/allocs", name);
+    if (_filter && !strstr(full_name, _filter)) {
+        return;
+    }
+
+    mongocrypt_t *crypt = _crypt_new();
+    // Populate the caches.
+    fn(crypt);
+
+    count = _allocs.count;
+    bytes = _allocs.bytes;
+    for (int i = 0; i < ALLOC_ITERS; i++) {
+        const int64_t live = _allocs.live;
+        _allocs.peak = live;
+        fn(crypt);
+        if (_allocs.peak - live > peak) {
+            peak = _allocs.peak - live;
+        }
+    }
+    printf("%-48s %10.1f allocs/op %12.1f bytes/op %10" PRId64 " peak live bytes\n",
+           full_name,
+           (double)(_allocs.count - count) / ALLOC_ITERS,
+           (double)(_allocs.bytes - bytes) / ALLOC_ITERS,
+           peak);
+    fflush(stdout);
+    mongocrypt_destroy(crypt);
+}
+
+static void _fixtures_init(void) {
+    bson_iter_t iter;
+    const uint8_t *data;
+    uint32_t len;
+
+    _read_json("./test/example/cmd.json", &_fx.cmd);
+    _read_json("./test/example/collection-info.json", &_fx.collinfo);
+    _read_json("./test/example/mongocryptd-reply.json", &_fx.markings);
+    _read_json("./test/example/key-document.json", &_fx.aws_key_doc);
+    _fx.kms_reply = _read_http("./test/example/kms-decrypt-reply.txt", &_fx.kms_reply_len);
+    _read_json(LOCAL_KEY_DOC_PATH, &_fx.local_key_doc);
+
+    BSON_ASSERT(bson_iter_init_find(&iter, &_fx.local_key_doc, "_id") && BSON_ITER_HOLDS_BINARY(&iter));
+    bson_iter_binary(&iter, NULL, &len, &data);
+    BSON_ASSERT(len == sizeof _fx.local_key_id);
+    memcpy(_fx.local_key_id, data, len);
+
+    mongocrypt_t *crypt = _crypt_new();
+    bson_init(&_fx.encrypted_cmd);
+    _op_auto_encrypt(crypt, &_fx.encrypted_cmd);
+    mongocrypt_destroy(crypt);
+}
+
+static void _fixtures_cleanup(void) {
+    bson_destroy(&_fx.encrypted_cmd);
+    bson_destroy(&_fx.local_key_doc);
+    bson_free(_fx.kms_reply);
+    bson_destroy(&_fx.aws_key_doc);
+    bson_destroy(&_fx.markings);
+    bson_destroy(&_fx.collinfo);
+    bson_destroy(&_fx.cmd);
+}
+
+int main(int argc, char **argv) {
+    int max_threads = 4;
+    bool allocs = false;
+    int i = 1;
+
+    if (i < argc && 0 == strcmp(argv[i], "-a")) {
+        allocs = true;
+        i++;
+    }
+    if (i + 1 < argc && 0 == strcmp(argv[i], "-t")) {
+        max_threads = atoi(argv[i + 1]);
+        i += 2;
+    }
+    if (max_threads < 1 || argc - i > 1) {
+        fprintf(stderr, "usage: %s [-a] [-t max_threads] [filter]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    _filter = i < argc ? argv[i] : NULL;
+
+    if (allocs) {
+        const bson_mem_vtable_t vtable = {
+            .malloc = _counting_malloc,
+            .calloc = _counting_calloc,
+            .realloc = _counting_realloc,
+            .free = _counting_free,
+        };
+        // Must be set before anything is allocated with libbson.
+        bson_mem_set_vtable(&vtable);
+    }
+
+    const struct {
+        const char *name;
+        bench_fn fn;
+    } cases[] = {
+        {"auto-encrypt", _bench_auto_encrypt},
+        {"auto-decrypt", _bench_auto_decrypt},
+        {"explicit-equality", _bench_explicit_equality},
+        {"explicit-range-insert", _bench_explicit_range_insert},
+        {"explicit-range-find", _bench_explicit_range_find},
+    };
+
+    _fixtures_init();
+    for (size_t c = 0; c < sizeof cases / sizeof cases[0]; c++) {
+        if (allocs) {
+            _run_allocs(cases[c].name, cases[c].fn);
+            continue;
+        }
+        for (int warm = 1; warm >= 0; warm--) {
+            for (int nthreads = 1; nthreads <= max_threads; nthreads *= 2) {
+                _run(cases[c].name, cases[c].fn, warm, nthreads);
+            }
+        }
+    }
+    _fixtures_cleanup();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,517 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * bench-range measures the cost of range indexes: edge generation for inserts,
+ * mincover generation for queries, and explicit encryption of both payloads.
+ * Each is measured for every supported type across sparsity, trimFactor, and
+ * bounded/unbounded domains. Allocations are counted through the libbson
+ * allocator, which libmongocrypt uses for all of its own allocations.
+ *
+ * Run from the source directory, optionally passing a substring to select
+ * cases by name:
+ *
+ *   ./cmake-build/bench-range [filter]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <bson/bson.h>
+#include <mongocrypt.h>
+
+#include "mc-range-edge-generation-private.h"
+#include "mc-range-mincover-private.h"
+
+// Minimum time to measure each case, in microseconds.
+#define BENCH_MIN_USEC (100 * 1000)
+
+#define KEY_ID_HEX "ABCDEFAB123498761234123456789012"
+#define KEY_DOC_PATH "./test/data/keys/" KEY_ID_HEX "-local-document.json"
+
+static int64_t _alloc_count;
+
+static void *_counting_malloc(size_t num_bytes) {
+    _alloc_count++;
+    return malloc(num_bytes);
+}
+
+static void *_counting_calloc(size_t n_members, size_t num_bytes) {
+    _alloc_count++;
+    return calloc(n_members, num_bytes);
+}
+
+static void *_counting_realloc(void *mem, size_t num_bytes) {
+    _alloc_count++;
+    return realloc(mem, num_bytes);
+}
+
+static void _fail(const char *what, mongocrypt_status_t *status) {
+    fprintf(stderr, "%s failed: %s\n", what, status ? mongocrypt_status_message(status, NULL) : "");
+    abort();
+}
+
+typedef void (*bench_fn)(const void *arg);
+
+static const char *_filter;
+
+static void _run(const char *name, bench_fn fn, const void *arg) {
+    if (_filter && !strstr(name, _filter)) {
+        return;
+    }
+
+    // Warm up. This also populates the key cache for encryption cases.
+    fn(arg);
+
+    for (int64_t iters = 1;; iters *= 2) {
+        const int64_t allocs_start = _alloc_count;
+        const int64_t start = bson_get_monotonic_time();
+        for (int64_t i = 0; i < iters; i++) {
+            fn(arg);
+        }
+        const int64_t elapsed = bson_get_monotonic_time() - start;
+        if (elapsed >= BENCH_MIN_USEC) {
+            printf("%-64s %12.0f ns/op %10.1f allocs/op\n",
+                   name,
+                   (double)elapsed * 1000.0 / (double)iters,
+                   (double)(_alloc_count - allocs_start) / (double)iters);
+            fflush(stdout);
+            return;
+        }
+    }
+}
+
+typedef struct {
+    bson_type_t type;
+    bool bounded;
+    size_t sparsity;
+    uint32_t trimFactor;
+} range_case_t;
+
+static const char *_type_name(bson_type_t type) {
+    switch (type) {
+    case BSON_TYPE_INT32: return "int32";
+    case BSON_TYPE_INT64: return "int64";
+    case BSON_TYPE_DOUBLE: return "double";
+    case BSON_TYPE_DECIMAL128: return "decimal128";
+    default: return "unknown";
+    }
+}
+
+/* The value inserted, the query bounds, and the domain of a bounded index for
+ * each type. Unbounded integer indexes span the whole type. Unbounded double
+ * and Decimal128 indexes have no min, max, or precision. */
+#define INT32_VALUE 123456
+#define INT32_QUERY_LB 1000
+#define INT32_QUERY_UB 900000
+#define INT32_MIN_BOUND 0
+#define INT32_MAX_BOUND 1000000
+#define INT64_VALUE INT64_C(123456789012)
+#define INT64_QUERY_LB INT64_C(1000)
+#define INT64_QUERY_UB INT64_C(100000000000)
+#define INT64_MIN_BOUND INT64_C(0)
+#define INT64_MAX_BOUND INT64_C(1000000000000)
+#define DOUBLE_VALUE "123.456"
+#define DOUBLE_QUERY_LB "-1234.5"
+#define DOUBLE_QUERY_UB "5678.25"
+#define DOUBLE_MIN_BOUND "-1000000"
+#define DOUBLE_MAX_BOUND "1000000"
+#define DOUBLE_PRECISION 2
+
+static void _bench_edges(const void *arg) {
+    const range_case_t *rc = arg;
+    mongocrypt_status_t *status = mongocrypt_status_new();
+    mc_edges_t *edges = NULL;
+
+    switch (rc->type) {
+    case BSON_TYPE_INT32: {
+        mc_getEdgesInt32_args_t args = {.value = INT32_VALUE,
+                                        .min = OPT_I32(rc->bounded ? INT32_MIN_BOUND : INT32_MIN),
+                                        .max = OPT_I32(rc->bounded ? INT32_MAX_BOUND : INT32_MAX),
+                                        .sparsity = rc->sparsity,
+                                        .trimFactor = rc->trimFactor};
+        edges = mc_getEdgesInt32(args, status);
+        break;
+    }
+    case BSON_TYPE_INT64: {
+        mc_getEdgesInt64_args_t args = {.value = INT64_VALUE,
+                                        .min = OPT_I64(rc->bounded ? INT64_MIN_BOUND : INT64_MIN),
+                                        .max = OPT_I64(rc->bounded ? INT64_MAX_BOUND : INT64_MAX),
+                                        .sparsity = rc->sparsity,
+                                        .trimFactor = rc->trimFactor};
+        edges = mc_getEdgesInt64(args, status);
+        break;
+    }
+    case BSON_TYPE_DOUBLE: {
+        mc_getEdgesDouble_args_t args = {.value = strtod(DOUBLE_VALUE, NULL),
+                                         .sparsity = rc->sparsity,
+                                         .trimFactor = rc->trimFactor};
+        if (rc->bounded) {
+            args.min = OPT_DOUBLE(strtod(DOUBLE_MIN_BOUND, NULL));
+            args.max = OPT_DOUBLE(strtod(DOUBLE_MAX_BOUND, NULL));
+            args.precision = OPT_U32(DOUBLE_PRECISION);
+        }
+        edges = mc_getEdgesDouble(args, status);
+        break;
+    }
+#if MONGOCRYPT_HAVE_DECIMAL128_SUPPORT
+    case BSON_TYPE_DECIMAL128: {
+        mc_getEdgesDecimal128_args_t args = {.value = mc_dec128_from_string(DOUBLE_VALUE),
+                                             .sparsity = rc->sparsity,
+                                             .trimFactor = rc->trimFactor};
+        if (rc->bounded) {
+            args.min = OPT_MC_DEC128(mc_dec128_from_string(DOUBLE_MIN_BOUND));
+            args.max = OPT_MC_DEC128(mc_dec128_from_string(DOUBLE_MAX_BOUND));
+            args.precision = OPT_U32(DOUBLE_PRECISION);
+        }
+        edges = mc_getEdgesDecimal128(args, status);
+        break;
+    }
+#endif
+    default: abort();
+    }
+
+    if (!edges) {
+        _fail("mc_getEdges", status);
+    }
+    mc_edges_destroy(edges);
+    mongocrypt_status_destroy(status);
+}
+
+static void _bench_mincover(const void *arg) {
+    const range_case_t *rc = arg;
+    mongocrypt_status_t *status = mongocrypt_status_new();
+    mc_mincover_t *mc = NULL;
+
+    switch (rc->type) {
+    case BSON_TYPE_INT32: {
+        mc_getMincoverInt32_args_t args = {.lowerBound = INT32_QUERY_LB,
+                                           .includeLowerBound = true,
+                                           .upperBound = INT32_QUERY_UB,
+                                           .includeUpperBound = true,
+                                           .min = OPT_I32(rc->bounded ? INT32_MIN_BOUND : INT32_MIN),
+                                           .max = OPT_I32(rc->bounded ? INT32_MAX_BOUND : INT32_MAX),
+                                           .sparsity = rc->sparsity,
+                                           .trimFactor = rc->trimFactor};
+        mc = mc_getMincoverInt32(args, status);
+        break;
+    }
+    case BSON_TYPE_INT64: {
+        mc_getMincoverInt64_args_t args = {.lowerBound = INT64_QUERY_LB,
+                                           .includeLowerBound = true,
+                                           .upperBound = INT64_QUERY_UB,
+                                           .includeUpperBound = true,
+                                           .min = OPT_I64(rc->bounded ? INT64_MIN_BOUND : INT64_MIN),
+                                           .max = OPT_I64(rc->bounded ? INT64_MAX_BOUND : INT64_MAX),
+                                           .sparsity = rc->sparsity,
+                                           .trimFactor = rc->trimFactor};
+        mc = mc_getMincoverInt64(args, status);
+        break;
+    }
+    case BSON_TYPE_DOUBLE: {
+        mc_getMincoverDouble_args_t args = {.lowerBound = strtod(DOUBLE_QUERY_LB, NULL),
+                                            .includeLowerBound = true,
+                                            .upperBound = strtod(DOUBLE_QUERY_UB, NULL),
+                                            .includeUpperBound = true,
+                                            .sparsity = rc->sparsity,
+                                            .trimFactor = rc->trimFactor};
+        if (rc->bounded) {
+            args.min = OPT_DOUBLE(strtod(DOUBLE_MIN_BOUND, NULL));
+            args.max = OPT_DOUBLE(strtod(DOUBLE_MAX_BOUND, NULL));
+            args.precision = OPT_U32(DOUBLE_PRECISION);
+        }
+        mc = mc_getMincoverDouble(args, status);
+        break;
+    }
+#if MONGOCRYPT_HAVE_DECIMAL128_SUPPORT
+    case BSON_TYPE_DECIMAL128: {
+        mc_getMincoverDecimal128_args_t args = {.lowerBound = mc_dec128_from_string(DOUBLE_QUERY_LB),
+                                                .includeLowerBound = true,
+                                                .upperBound = mc_dec128_from_string(DOUBLE_QUERY_UB),
+                                                .includeUpperBound = true,
+                                                .sparsity = rc->sparsity,
+                                                .trimFactor = rc->trimFactor};
+        if (rc->bounded) {
+            args.min = OPT_MC_DEC128(mc_dec128_from_string(DOUBLE_MIN_BOUND));
+            args.max = OPT_MC_DEC128(mc_dec128_from_string(DOUBLE_MAX_BOUND));
+            args.precision = OPT_U32(DOUBLE_PRECISION);
+        }
+        mc = mc_getMincoverDecimal128(args, status);
+        break;
+    }
+#endif
+    default: abort();
+    }
+
+    if (!mc) {
+        _fail("mc_getMincover", status);
+    }
+    mc_mincover_destroy(mc);
+    mongocrypt_status_destroy(status);
+}
+
+// Appends a value of `type` parsed from `str` (a decimal number).
+static void _append_number(bson_t *out, const char *key, bson_type_t type, const char *str) {
+    switch (type) {
+    case BSON_TYPE_INT32: BSON_ASSERT(BSON_APPEND_INT32(out, key, (int32_t)strtol(str, NULL, 10))); break;
+    case BSON_TYPE_INT64: BSON_ASSERT(BSON_APPEND_INT64(out, key, (int64_t)strtoll(str, NULL, 10))); break;
+    case BSON_TYPE_DOUBLE: BSON_ASSERT(BSON_APPEND_DOUBLE(out, key, strtod(str, NULL))); break;
+    case BSON_TYPE_DECIMAL128: {
+        bson_decimal128_t dec;
+        BSON_ASSERT(bson_decimal128_from_string(str, &dec));
+        BSON_ASSERT(BSON_APPEND_DECIMAL128(out, key, &dec));
+        break;
+    }
+    default: abort();
+    }
+}
+
+typedef struct {
+    mongocrypt_t *crypt;
+    mongocrypt_binary_t *key_id;
+    mongocrypt_binary_t *key_doc;
+    bool is_query;
+    bson_t range_opts;
+    bson_t msg;
+} encrypt_case_t;
+
+static void _encrypt_case_init(encrypt_case_t *ec, const range_case_t *rc, bool is_query) {
+    char buf[32];
+
+    ec->is_query = is_query;
+    bson_init(&ec->range_opts);
+    bson_init(&ec->msg);
+
+    if (rc->type == BSON_TYPE_INT32) {
+        bson_snprintf(buf, sizeof buf, "%" PRId32, rc->bounded ? INT32_MIN_BOUND : INT32_MIN);
+        _append_number(&ec->range_opts, "min", rc->type, buf);
+        bson_snprintf(buf, sizeof buf, "%" PRId32, rc->bounded ? INT32_MAX_BOUND : INT32_MAX);
+        _append_number(&ec->range_opts, "max", rc->type, buf);
+    } else if (rc->type == BSON_TYPE_INT64) {
+        bson_snprintf(buf, sizeof buf, "%" PRId64, rc->bounded ? INT64_MIN_BOUND : INT64_MIN);
+        _append_number(&ec->range_opts, "min", rc->type, buf);
+        bson_snprintf(buf, sizeof buf, "%" PRId64, rc->bounded ? INT64_MAX_BOUND : INT64_MAX);
+        _append_number(&ec->range_opts, "max", rc->type, buf);
+    } else if (rc->bounded) {
+        _append_number(&ec->range_opts, "min", rc->type, DOUBLE_MIN_BOUND);
+        _append_number(&ec->range_opts, "max", rc->type, DOUBLE_MAX_BOUND);
+        BSON_ASSERT(BSON_APPEND_INT32(&ec->range_opts, "precision", DOUBLE_PRECISION));
+    }
+    BSON_ASSERT(BSON_APPEND_INT64(&ec->range_opts, "sparsity", (int64_t)rc->sparsity));
+    BSON_ASSERT(BSON_APPEND_INT32(&ec->range_opts, "trimFactor", (int32_t)rc->trimFactor));
+
+    const bool is_int = rc->type == BSON_TYPE_INT32 || rc->type == BSON_TYPE_INT64;
+    if (!is_query) {
+        bson_snprintf(buf, sizeof buf, "%" PRId64, rc->type == BSON_TYPE_INT32 ? (int64_t)INT32_VALUE : INT64_VALUE);
+        _append_number(&ec->msg, "v", rc->type, is_int ? buf : DOUBLE_VALUE);
+        return;
+    }
+
+    // {"v": {"$and": [{"v": {"$gte": lb}}, {"v": {"$lte": ub}}]}}
+    char lb[32], ub[32];
+    if (rc->type == BSON_TYPE_INT32) {
+        bson_snprintf(lb, sizeof lb, "%d", INT32_QUERY_LB);
+        bson_snprintf(ub, sizeof ub, "%d", INT32_QUERY_UB);
+    } else if (rc->type == BSON_TYPE_INT64) {
+        bson_snprintf(lb, sizeof lb, "%" PRId64, INT64_QUERY_LB);
+        bson_snprintf(ub, sizeof ub, "%" PRId64, INT64_QUERY_UB);
+    } else {
+        bson_snprintf(lb, sizeof lb, "%s", DOUBLE_QUERY_LB);
+        bson_snprintf(ub, sizeof ub, "%s", DOUBLE_QUERY_UB);
+    }
+    bson_t v, and, elem, op;
+    BSON_ASSERT(BSON_APPEND_DOCUMENT_BEGIN(&ec->msg, "v", &v));
+    BSON_ASSERT(BSON_APPEND_ARRAY_BEGIN(&v, "$and", &and));
+    BSON_ASSERT(BSON_APPEND_DOCUMENT_BEGIN(&and, "0", &elem));
+    BSON_ASSERT(BSON_APPEND_DOCUMENT_BEGIN(&elem, "v", &op));
+    _append_number(&op, "$gte", rc->type, lb);
+    BSON_ASSERT(bson_append_document_end(&elem, &op));
+    BSON_ASSERT(bson_append_document_end(&and, &elem));
+    BSON_ASSERT(BSON_APPEND_DOCUMENT_BEGIN(&and, "1", &elem));
+    BSON_ASSERT(BSON_APPEND_DOCUMENT_BEGIN(&elem, "v", &op));
+    _append_number(&op, "$lte", rc->type, ub);
+    BSON_ASSERT(bson_append_document_end(&elem, &op));
+    BSON_ASSERT(bson_append_document_end(&and, &elem));
+    BSON_ASSERT(bson_append_array_end(&v, &and));
+    BSON_ASSERT(bson_append_document_end(&ec->msg, &v));
+}
+
+static void _encrypt_case_cleanup(encrypt_case_t *ec) {
+    bson_destroy(&ec->range_opts);
+    bson_destroy(&ec->msg);
+}
+
+static void _bench_encrypt(const void *arg) {
+    const encrypt_case_t *ec = arg;
+    mongocrypt_ctx_t *ctx = mongocrypt_ctx_new(ec->crypt);
+    mongocrypt_binary_t *range_opts =
+        mongocrypt_binary_new_from_data((uint8_t *)bson_get_data(&ec->range_opts), ec->range_opts.len);
+    mongocrypt_binary_t *msg = mongocrypt_binary_new_from_data((uint8_t *)bson_get_data(&ec->msg), ec->msg.len);
+    mongocrypt_binary_t *out = mongocrypt_binary_new();
+
+    if (!mongocrypt_ctx_setopt_key_id(ctx, ec->key_id)
+        || !mongocrypt_ctx_setopt_algorithm(ctx, MONGOCRYPT_ALGORITHM_RANGE_STR, -1)
+        || !mongocrypt_ctx_setopt_contention_factor(ctx, 4) || !mongocrypt_ctx_setopt_algorithm_range(ctx, range_opts)
+        || (ec->is_query && !mongocrypt_ctx_setopt_query_type(ctx, MONGOCRYPT_QUERY_TYPE_RANGE_STR, -1))) {
+        goto fail;
+    }
+    if (ec->is_query ? !mongocrypt_ctx_explicit_encrypt_expression_init(ctx, msg)
+                     : !mongocrypt_ctx_explicit_encrypt_init(ctx, msg)) {
+        goto fail;
+    }
+
+    for (;;) {
+        switch (mongocrypt_ctx_state(ctx)) {
+        case MONGOCRYPT_CTX_NEED_MONGO_KEYS:
+            if (!mongocrypt_ctx_mongo_feed(ctx, ec->key_doc) || !mongocrypt_ctx_mongo_done(ctx)) {
+                goto fail;
+            }
+            break;
+        case MONGOCRYPT_CTX_READY:
+            if (!mongocrypt_ctx_finalize(ctx, out)) {
+                goto fail;
+            }
+            break;
+        case MONGOCRYPT_CTX_DONE: goto done;
+        default: goto fail;
+        }
+    }
+
+done:
+    mongocrypt_binary_destroy(out);
+    mongocrypt_binary_destroy(msg);
+    mongocrypt_binary_destroy(range_opts);
+    mongocrypt_ctx_destroy(ctx);
+    return;
+
+fail: {
+    mongocrypt_status_t *status = mongocrypt_status_new();
+    mongocrypt_ctx_status(ctx, status);
+    _fail("explicit encrypt", status);
+}
+}
+
+static mongocrypt_t *_crypt_new(void) {
+    mongocrypt_t *crypt = mongocrypt_new();
+    uint8_t localkey_data[96] = {0};
+    mongocrypt_binary_t *localkey = mongocrypt_binary_new_from_data(localkey_data, sizeof localkey_data);
+    mongocrypt_status_t *status = mongocrypt_status_new();
+
+    if (!mongocrypt_setopt_kms_provider_local(crypt, localkey) || !mongocrypt_setopt_use_range_v2(crypt)
+        || !mongocrypt_init(crypt)) {
+        mongocrypt_status(crypt, status);
+        _fail("mongocrypt_init", status);
+    }
+    mongocrypt_status_destroy(status);
+    mongocrypt_binary_destroy(localkey);
+    return crypt;
+}
+
+static mongocrypt_binary_t *_read_key_doc(bson_t *storage) {
+    bson_error_t error;
+    bson_json_reader_t *reader = bson_json_reader_new_from_file(KEY_DOC_PATH, &error);
+    if (!reader) {
+        fprintf(stderr, "could not open %s (run from the source directory): %s\n", KEY_DOC_PATH, error.message);
+        abort();
+    }
+    bson_init(storage);
+    if (bson_json_reader_read(reader, storage, &error) != 1) {
+        fprintf(stderr, "could not read %s: %s\n", KEY_DOC_PATH, error.message);
+        abort();
+    }
+    bson_json_reader_destroy(reader);
+    return mongocrypt_binary_new_from_data((uint8_t *)bson_get_data(storage), storage->len);
+}
+
+static mongocrypt_binary_t *_key_id_new(uint8_t storage[16]) {
+    for (size_t i = 0; i < 16; i++) {
+        unsigned int byte;
+        BSON_ASSERT(sscanf(KEY_ID_HEX + 2 * i, "%2x", &byte) == 1);
+        storage[i] = (uint8_t)byte;
+    }
+    return mongocrypt_binary_new_from_data(storage, 16);
+}
+
+int main(int argc, char **argv) {
+    const bson_mem_vtable_t vtable = {
+        .malloc = _counting_malloc,
+        .calloc = _counting_calloc,
+        .realloc = _counting_realloc,
+        .free = free,
+    };
+    // Must be set before anything is allocated with libbson.
+    bson_mem_set_vtable(&vtable);
+
+    if (argc > 2) {
+        fprintf(stderr, "usage: %s [filter]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    _filter = argc == 2 ? argv[1] : NULL;
+
+    const bson_type_t types[] = {
+        BSON_TYPE_INT32,
+        BSON_TYPE_INT64,
+        BSON_TYPE_DOUBLE,
+#if MONGOCRYPT_HAVE_DECIMAL128_SUPPORT
+        BSON_TYPE_DECIMAL128,
+#endif
+    };
+    const uint32_t trimFactors[] = {0, 4, 8};
+
+    mongocrypt_t *crypt = _crypt_new();
+    bson_t key_doc_storage;
+    uint8_t key_id_storage[16];
+    mongocrypt_binary_t *key_doc = _read_key_doc(&key_doc_storage);
+    mongocrypt_binary_t *key_id = _key_id_new(key_id_storage);
+
+    for (size_t t = 0; t < sizeof types / sizeof types[0]; t++) {
+        for (int bounded = 1; bounded >= 0; bounded--) {
+            for (size_t sparsity = 1; sparsity <= 4; sparsity++) {
+                for (size_t tf = 0; tf < sizeof trimFactors / sizeof trimFactors[0]; tf++) {
+                    const range_case_t rc = {types[t], bounded, sparsity, trimFactors[tf]};
+                    char suffix[128], name[160];
+                    bson_snprintf(suffix,
+                                  sizeof suffix,
+                                  "%s/%s/sparsity=%zu/trimFactor=%" PRIu32,
+                                  _type_name(rc.type),
+                                  rc.bounded ? "bounded" : "unbounded",
+                                  rc.sparsity,
+                                  rc.trimFactor);
+
+                    bson_snprintf(name, sizeof name, "edges/%s", suffix);
+                    _run(name, _bench_edges, &rc);
+                    bson_snprintf(name, sizeof name, "mincover/%s", suffix);
+                    _run(name, _bench_mincover, &rc);
+
+                    for (int is_query = 0; is_query <= 1; is_query++) {
+                        encrypt_case_t ec = {.crypt = crypt, .key_id = key_id, .key_doc = key_doc};
+                        _encrypt_case_init(&ec, &rc, is_query);
+                        bson_snprintf(name, sizeof name, "%s/%s", is_query ? "encrypt-find" : "encrypt-insert", suffix);
+                        _run(name, _bench_encrypt, &ec);
+                        _encrypt_case_cleanup(&ec);
+                    }
+                }
+            }
+        }
+    }
+
+    mongocrypt_binary_destroy(key_id);
+    mongocrypt_binary_destroy(key_doc);
+    bson_destroy(&key_doc_storage);
+    mongocrypt_destroy(crypt);
+    return EXIT_SUCCESS;
+}
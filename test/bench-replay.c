@@ -0,0 +1,415 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * bench-replay replays contexts recorded by mongocrypt_setopt_record_handler,
+ * such as with `csfle ... --record_file sessions.bson`, without a cluster or
+ * KMS. The sessions file holds one BSON session document after another.
+ *
+ * The sessions are replayed in order on one mongocrypt_t, so caches warm up as
+ * they did when recording. Options of the mongocrypt_t are not part of the
+ * sessions: pass the KMS providers, schema map, encryptedFields map and
+ * crypt_shared library the recording one used. With -n, the sessions file is
+ * replayed that many times.
+ *
+ * Each session is checked to end in the recorded state. The time spent in each
+ * call is reported, along with the total replay time against the recorded
+ * time, which also includes the time the application spent between calls on
+ * network round trips.
+ *
+ *   ./cmake-build/bench-replay [-k kms_providers.json] [-s schema_map.json]
+ *       [-e encrypted_fields_map.json] [-c crypt_shared_lib_path] [-n repeat]
+ *       sessions.bson
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <bson/bson.h>
+#include <mongocrypt.h>
+
+#define MAX_CALLS 64
+
+// Time and count of each replayed call, by call name.
+static struct {
+    const char *name;
+    int64_t count;
+    int64_t usec;
+} _calls[MAX_CALLS];
+
+static size_t _calls_len;
+
+static void _add_call(const char *name, int64_t usec) {
+    size_t i;
+
+    for (i = 0; i < _calls_len; i++) {
+        if (0 == strcmp(_calls[i].name, name)) {
+            break;
+        }
+    }
+    if (i == _calls_len) {
+        if (_calls_len == MAX_CALLS) {
+            fprintf(stderr, "too many distinct calls\n");
+            abort();
+        }
+        _calls[_calls_len++].name = bson_strdup(name);
+    }
+    _calls[i].count++;
+    _calls[i].usec += usec;
+}
+
+static bson_t *_read_json(const char *path) {
+    bson_json_reader_t *reader;
+    bson_error_t error;
+    bson_t *bson = bson_new();
+
+    reader = bson_json_reader_new_from_file(path, &error);
+    if (!reader || 1 != bson_json_reader_read(reader, bson, &error)) {
+        fprintf(stderr, "failed to read %s: %s\n", path, error.message);
+        exit(EXIT_FAILURE);
+    }
+    bson_json_reader_destroy(reader);
+    return bson;
+}
+
+static void _setopt_json(mongocrypt_t *crypt, bool (*setopt)(mongocrypt_t *, mongocrypt_binary_t *), const char *path) {
+    bson_t *bson = _read_json(path);
+    mongocrypt_binary_t *bin = mongocrypt_binary_new_from_data((uint8_t *)bson_get_data(bson), bson->len);
+
+    if (!setopt(crypt, bin)) {
+        mongocrypt_status_t *status = mongocrypt_status_new();
+
+        mongocrypt_status(crypt, status);
+        fprintf(stderr, "failed to set %s: %s\n", path, mongocrypt_status_message(status, NULL));
+        exit(EXIT_FAILURE);
+    }
+    mongocrypt_binary_destroy(bin);
+    bson_destroy(bson);
+}
+
+/* Objects returned while replaying one session. Recorded KMS contexts are
+ * numbered in the order the context first returns them, and mongo operations
+ * in the order they are returned. */
+typedef struct {
+    mongocrypt_kms_ctx_t **kms;
+    uint32_t kms_len;
+    mongocrypt_mongo_op_t **ops;
+    uint32_t ops_len;
+    /* A recorded plan is not available, so a session starts with an empty
+     * one. */
+    mongocrypt_decrypt_plan_t *decrypt_plan;
+} replay_t;
+
+static void _replay_add_kms(replay_t *r, mongocrypt_kms_ctx_t *kms) {
+    for (uint32_t i = 0; i < r->kms_len; i++) {
+        if (r->kms[i] == kms) {
+            return;
+        }
+    }
+    r->kms = bson_realloc(r->kms, sizeof(*r->kms) * (r->kms_len + 1u));
+    r->kms[r->kms_len++] = kms;
+}
+
+/* Returns the object numbered by @field of @event, or NULL. */
+static void *_lookup(const bson_t *event, const char *field, void **objs, uint32_t len) {
+    bson_iter_t iter;
+
+    if (!bson_iter_init_find(&iter, event, field) || !BSON_ITER_HOLDS_INT32(&iter)) {
+        return NULL;
+    }
+    const int32_t i = bson_iter_int32(&iter);
+    return i >= 0 && (uint32_t)i < len ? objs[i] : NULL;
+}
+
+/* Replays one recorded call on @ctx. Returns false if the call name is
+ * unknown. The result of the call is not checked: failures are compared at the
+ * end of the session. */
+static bool _replay_call(mongocrypt_ctx_t *ctx, replay_t *r, const char *call, const bson_t *event) {
+    bson_iter_t iter;
+    mongocrypt_binary_t *data = NULL;
+    const char *str = NULL;
+    uint32_t str_len = 0;
+    int64_t num = 0;
+    const char *db = NULL;
+    mongocrypt_binary_t *out = mongocrypt_binary_new();
+
+    if (bson_iter_init_find(&iter, event, "data")) {
+        if (BSON_ITER_HOLDS_BINARY(&iter)) {
+            const uint8_t *bytes;
+            uint32_t len;
+
+            bson_iter_binary(&iter, NULL, &len, &bytes);
+            data = mongocrypt_binary_new_from_data((uint8_t *)bytes, len);
+        } else if (BSON_ITER_HOLDS_UTF8(&iter)) {
+            str = bson_iter_utf8(&iter, &str_len);
+        } else if (BSON_ITER_HOLDS_INT64(&iter)) {
+            num = bson_iter_int64(&iter);
+        }
+    }
+    if (bson_iter_init_find(&iter, event, "db") && BSON_ITER_HOLDS_UTF8(&iter)) {
+        db = bson_iter_utf8(&iter, NULL);
+    }
+
+    bool known = true;
+    if (0 == strcmp(call, "ctx_setopt_key_id")) {
+        (void)mongocrypt_ctx_setopt_key_id(ctx, data);
+    } else if (0 == strcmp(call, "ctx_setopt_key_alt_name")) {
+        (void)mongocrypt_ctx_setopt_key_alt_name(ctx, data);
+    } else if (0 == strcmp(call, "ctx_setopt_key_material")) {
+        (void)mongocrypt_ctx_setopt_key_material(ctx, data);
+    } else if (0 == strcmp(call, "ctx_setopt_algorithm")) {
+        (void)mongocrypt_ctx_setopt_algorithm(ctx, str, (int)str_len);
+    } else if (0 == strcmp(call, "ctx_setopt_query_type")) {
+        (void)mongocrypt_ctx_setopt_query_type(ctx, str, (int)str_len);
+    } else if (0 == strcmp(call, "ctx_setopt_contention_factor")) {
+        (void)mongocrypt_ctx_setopt_contention_factor(ctx, num);
+    } else if (0 == strcmp(call, "ctx_setopt_index_key_id")) {
+        (void)mongocrypt_ctx_setopt_index_key_id(ctx, data);
+    } else if (0 == strcmp(call, "ctx_setopt_algorithm_range")) {
+        (void)mongocrypt_ctx_setopt_algorithm_range(ctx, data);
+    } else if (0 == strcmp(call, "ctx_setopt_key_encryption_key")) {
+        (void)mongocrypt_ctx_setopt_key_encryption_key(ctx, data);
+    } else if (0 == strcmp(call, "ctx_setopt_borrow_input")) {
+        (void)mongocrypt_ctx_setopt_borrow_input(ctx);
+    } else if (0 == strcmp(call, "ctx_setopt_deadline")) {
+        (void)mongocrypt_ctx_setopt_deadline(ctx, num);
+    } else if (0 == strcmp(call, "ctx_setopt_decrypt_paths")) {
+        (void)mongocrypt_ctx_setopt_decrypt_paths(ctx, data);
+    } else if (0 == strcmp(call, "ctx_setopt_decrypt_plan")) {
+        if (!r->decrypt_plan) {
+            r->decrypt_plan = mongocrypt_decrypt_plan_new();
+        }
+        (void)mongocrypt_ctx_setopt_decrypt_plan(ctx, r->decrypt_plan);
+    } else if (0 == strcmp(call, "ctx_encrypt_init")) {
+        (void)mongocrypt_ctx_encrypt_init(ctx, db, -1, data);
+    } else if (0 == strcmp(call, "ctx_explain_encrypt_init")) {
+        (void)mongocrypt_ctx_explain_encrypt_init(ctx, db, -1, data);
+    } else if (0 == strcmp(call, "ctx_decrypt_init")) {
+        (void)mongocrypt_ctx_decrypt_init(ctx, data);
+    } else if (0 == strcmp(call, "ctx_explicit_encrypt_init")) {
+        (void)mongocrypt_ctx_explicit_encrypt_init(ctx, data);
+    } else if (0 == strcmp(call, "ctx_explicit_encrypt_expression_init")) {
+        (void)mongocrypt_ctx_explicit_encrypt_expression_init(ctx, data);
+    } else if (0 == strcmp(call, "ctx_explicit_encrypt_batch_init")) {
+        (void)mongocrypt_ctx_explicit_encrypt_batch_init(ctx, data);
+    } else if (0 == strcmp(call, "ctx_explicit_encrypt_expression_batch_init")) {
+        (void)mongocrypt_ctx_explicit_encrypt_expression_batch_init(ctx, data);
+    } else if (0 == strcmp(call, "ctx_explicit_decrypt_init")) {
+        (void)mongocrypt_ctx_explicit_decrypt_init(ctx, data);
+    } else if (0 == strcmp(call, "ctx_explicit_decrypt_batch_init")) {
+        (void)mongocrypt_ctx_explicit_decrypt_batch_init(ctx, data);
+    } else if (0 == strcmp(call, "ctx_mongo_op")) {
+        (void)mongocrypt_ctx_mongo_op(ctx, out);
+    } else if (0 == strcmp(call, "ctx_mongo_feed")) {
+        (void)mongocrypt_ctx_mongo_feed(ctx, data);
+    } else if (0 == strcmp(call, "ctx_mongo_done")) {
+        (void)mongocrypt_ctx_mongo_done(ctx);
+    } else if (0 == strcmp(call, "ctx_next_mongo_op")) {
+        mongocrypt_mongo_op_t *op = mongocrypt_ctx_next_mongo_op(ctx);
+
+        if (op) {
+            r->ops = bson_realloc(r->ops, sizeof(*r->ops) * (r->ops_len + 1u));
+            r->ops[r->ops_len++] = op;
+        }
+    } else if (0 == strcmp(call, "mongo_op_feed")) {
+        (void)mongocrypt_mongo_op_feed(_lookup(event, "index", (void **)r->ops, r->ops_len), data);
+    } else if (0 == strcmp(call, "mongo_op_done")) {
+        (void)mongocrypt_mongo_op_done(_lookup(event, "index", (void **)r->ops, r->ops_len));
+    } else if (0 == strcmp(call, "ctx_provide_kms_providers")) {
+        (void)mongocrypt_ctx_provide_kms_providers(ctx, data);
+    } else if (0 == strcmp(call, "ctx_next_kms_ctx")) {
+        mongocrypt_kms_ctx_t *kms = mongocrypt_ctx_next_kms_ctx(ctx);
+
+        if (kms) {
+            _replay_add_kms(r, kms);
+        }
+    } else if (0 == strcmp(call, "kms_ctx_feed")) {
+        (void)mongocrypt_kms_ctx_feed(_lookup(event, "id", (void **)r->kms, r->kms_len), data);
+    } else if (0 == strcmp(call, "kms_ctx_fail")) {
+        (void)mongocrypt_kms_ctx_fail(_lookup(event, "id", (void **)r->kms, r->kms_len));
+    } else if (0 == strcmp(call, "ctx_kms_done")) {
+        (void)mongocrypt_ctx_kms_done(ctx);
+    } else if (0 == strcmp(call, "ctx_finalize")) {
+        (void)mongocrypt_ctx_finalize(ctx, out);
+    } else {
+        known = false;
+    }
+
+    mongocrypt_binary_destroy(out);
+    mongocrypt_binary_destroy(data);
+    return known;
+}
+
+/* Replays @session on a new context of @crypt. Returns false if it does not
+ * end in the recorded state. Adds the replay time to @replay_usec. */
+static bool _replay_session(mongocrypt_t *crypt, const bson_t *session, int64_t *replay_usec) {
+    bson_iter_t iter, events;
+    mongocrypt_ctx_t *ctx = mongocrypt_ctx_new(crypt);
+    replay_t r = {0};
+    int32_t recorded_state = -1;
+
+    if (!bson_iter_init_find(&iter, session, "events") || !BSON_ITER_HOLDS_ARRAY(&iter)
+        || !bson_iter_recurse(&iter, &events)) {
+        fprintf(stderr, "session has no events\n");
+        exit(EXIT_FAILURE);
+    }
+    if (bson_iter_init_find(&iter, session, "state") && BSON_ITER_HOLDS_INT32(&iter)) {
+        recorded_state = bson_iter_int32(&iter);
+    }
+
+    while (bson_iter_next(&events)) {
+        const uint8_t *doc;
+        uint32_t doc_len;
+        bson_t event;
+        bson_iter_t call_iter;
+
+        bson_iter_document(&events, &doc_len, &doc);
+        BSON_ASSERT(bson_init_static(&event, doc, doc_len));
+        if (!bson_iter_init_find(&call_iter, &event, "call") || !BSON_ITER_HOLDS_UTF8(&call_iter)) {
+            fprintf(stderr, "event has no call\n");
+            exit(EXIT_FAILURE);
+        }
+        const char *call = bson_iter_utf8(&call_iter, NULL);
+
+        const int64_t start = bson_get_monotonic_time();
+        if (!_replay_call(ctx, &r, call, &event)) {
+            fprintf(stderr, "unknown call: %s\n", call);
+            exit(EXIT_FAILURE);
+        }
+        const int64_t usec = bson_get_monotonic_time() - start;
+        _add_call(call, usec);
+        *replay_usec += usec;
+    }
+
+    const int state = (int)mongocrypt_ctx_state(ctx);
+    const bool matched = state == recorded_state;
+    if (!matched) {
+        mongocrypt_status_t *status = mongocrypt_status_new();
+
+        mongocrypt_ctx_status(ctx, status);
+        fprintf(stderr,
+                "session ended in state %d, recorded %d: %s\n",
+                state,
+                (int)recorded_state,
+                mongocrypt_status_message(status, NULL));
+        mongocrypt_status_destroy(status);
+    }
+
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_decrypt_plan_destroy(r.decrypt_plan);
+    bson_free(r.kms);
+    bson_free(r.ops);
+    return matched;
+}
+
+static void _usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [-k kms_providers.json] [-s schema_map.json] [-e encrypted_fields_map.json] "
+            "[-c crypt_shared_lib_path] [-n repeat] sessions.bson\n",
+            argv0);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv) {
+    mongocrypt_t *crypt = mongocrypt_new();
+    const char *path = NULL;
+    int repeat = 1;
+    int64_t sessions = 0, mismatched = 0, recorded_usec = 0, replay_usec = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+
+        if (arg[0] != '-') {
+            if (path) {
+                _usage(argv[0]);
+            }
+            path = arg;
+            continue;
+        }
+        if (i + 1 == argc || strlen(arg) != 2) {
+            _usage(argv[0]);
+        }
+        const char *value = argv[++i];
+        switch (arg[1]) {
+        case 'k': _setopt_json(crypt, mongocrypt_setopt_kms_providers, value); break;
+        case 's': _setopt_json(crypt, mongocrypt_setopt_schema_map, value); break;
+        case 'e': _setopt_json(crypt, mongocrypt_setopt_encrypted_field_config_map, value); break;
+        case 'c': mongocrypt_setopt_set_crypt_shared_lib_path_override(crypt, value); break;
+        case 'n': repeat = atoi(value); break;
+        default: _usage(argv[0]);
+        }
+    }
+    if (!path || repeat < 1) {
+        _usage(argv[0]);
+    }
+
+    if (!mongocrypt_init(crypt)) {
+        mongocrypt_status_t *status = mongocrypt_status_new();
+
+        mongocrypt_status(crypt, status);
+        fprintf(stderr, "mongocrypt_init failed: %s\n", mongocrypt_status_message(status, NULL));
+        return EXIT_FAILURE;
+    }
+
+    for (int pass = 0; pass < repeat; pass++) {
+        bson_error_t error;
+        bson_reader_t *reader = bson_reader_new_from_file(path, &error);
+        const bson_t *session;
+        bool eof = false;
+
+        if (!reader) {
+            fprintf(stderr, "failed to open %s: %s\n", path, error.message);
+            return EXIT_FAILURE;
+        }
+        while ((session = bson_reader_read(reader, &eof))) {
+            bson_iter_t iter;
+
+            if (bson_iter_init_find(&iter, session, "durationUs") && BSON_ITER_HOLDS_INT64(&iter)) {
+                recorded_usec += bson_iter_int64(&iter);
+            }
+            if (!_replay_session(crypt, session, &replay_usec)) {
+                mismatched++;
+            }
+            sessions++;
+        }
+        if (!eof) {
+            fprintf(stderr, "%s is truncated or not BSON\n", path);
+            return EXIT_FAILURE;
+        }
+        bson_reader_destroy(reader);
+    }
+
+    printf("%-40s %10s %12s %10s\n", "call", "count", "total us", "mean us");
+    for (size_t i = 0; i < _calls_len; i++) {
+        printf("%-40s %10" PRId64 " %12" PRId64 " %10.1f\n",
+               _calls[i].name,
+               _calls[i].count,
+               _calls[i].usec,
+               (double)_calls[i].usec / (double)_calls[i].count);
+    }
+    printf("%" PRId64 " sessions replayed in %.3f ms (recorded %.3f ms), %" PRId64 " mismatched\n",
+           sessions,
+           (double)replay_usec / 1000.0,
+           (double)recorded_usec / 1000.0,
+           mismatched);
+
+    for (size_t i = 0; i < _calls_len; i++) {
+        bson_free((char *)_calls[i].name);
+    }
+    mongocrypt_destroy(crypt);
+    return mismatched == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mc-arena-private.h"
+#include "test-mongocrypt-assert.h"
+#include "test-mongocrypt.h"
+
+static void _test_mc_arena(_mongocrypt_tester_t *tester) {
+    mc_arena_t arena;
+    uint8_t *small[1000];
+    uint8_t *large;
+
+    mc_arena_init(&arena);
+
+    /* Allocations are zeroed, aligned, and do not overlap. */
+    for (size_t i = 0; i < sizeof(small) / sizeof(small[0]); i++) {
+        small[i] = mc_arena_malloc0(&arena, 24);
+        ASSERT((uintptr_t)small[i] % 8 == 0);
+        for (size_t j = 0; j < 24; j++) {
+            ASSERT_CMPUINT8(small[i][j], ==, 0);
+        }
+        memset(small[i], (int)(i % 255) + 1, 24);
+    }
+
+    /* Large allocations do not use the free space of the current chunk. */
+    large = mc_arena_malloc0(&arena, 100 * 1000);
+    memset(large, 0xff, 100 * 1000);
+    small[0] = mc_arena_malloc0(&arena, 24);
+    ASSERT_CMPUINT8(small[0][0], ==, 0);
+
+    for (size_t i = 1; i < sizeof(small) / sizeof(small[0]); i++) {
+        ASSERT_CMPUINT8(small[i][23], ==, (uint8_t)((i % 255) + 1));
+    }
+
+    /* Zero-size allocations are valid. */
+    ASSERT(mc_arena_malloc0(&arena, 0));
+
+    mc_arena_cleanup(&arena);
+    /* An arena may be cleaned up twice. */
+    mc_arena_cleanup(&arena);
+}
+
+void _mongocrypt_tester_install_mc_arena(_mongocrypt_tester_t *tester) {
+    INSTALL_TEST(_test_mc_arena);
+}
@@ -68,6 +68,36 @@ static void _test_efc(_mongocrypt_tester_t *tester) {
         ASSERT_STREQUAL(ptr->path, "firstName");
         ASSERT_CMPBUF(expect_keyId1, ptr->keyId);
         ASSERT(ptr->next == NULL);
+        ASSERT(mc_EncryptedFieldConfig_find(&efc, "firstName") == ptr);
+        ASSERT(mc_EncryptedFieldConfig_find(&efc, "lastName") == efc.fields);
+        ASSERT(mc_EncryptedFieldConfig_find(&efc, "middleName") == NULL);
+        ASSERT(mc_EncryptedFieldConfig_find(&efc, "firstName.x") == NULL);
+        mc_EncryptedFieldConfig_cleanup(&efc);
+    }
+
+    {
+        /* Nested paths share the nodes of their common prefix. */
+        const mc_EncryptedFieldPath_t *node;
+
+        ASSERT_OK_STATUS(mc_EncryptedFieldConfig_parse(
+                             &efc,
+                             TMP_BSON("{'fields': [{'keyId': {'$binary': {'base64': 'EjRWeBI0mHYSNBI0VniQEg==', "
+                                      "'subType': '04'}}, 'path': 'a.b'}, {'keyId': {'$binary': {'base64': "
+                                      "'q83vqxI0mHYSNBI0VniQEg==', 'subType': '04'}}, 'path': 'a.c.d'}]}"),
+                             status),
+                         status);
+        ASSERT_STREQUAL(mc_EncryptedFieldConfig_find(&efc, "a.b")->path, "a.b");
+        ASSERT_STREQUAL(mc_EncryptedFieldConfig_find(&efc, "a.c.d")->path, "a.c.d");
+        ASSERT(mc_EncryptedFieldConfig_find(&efc, "a") == NULL);
+        ASSERT(mc_EncryptedFieldConfig_find(&efc, "a.c") == NULL);
+        ASSERT(mc_EncryptedFieldConfig_find(&efc, "a.cd") == NULL);
+
+        node = mc_EncryptedFieldPath_child(&efc.paths, "a", 1);
+        ASSERT(node);
+        ASSERT(node->field == NULL);
+        ASSERT(mc_EncryptedFieldPath_child(node, "c.d", 1));
+        ASSERT(mc_EncryptedFieldPath_child(node, "b", 1)->field == efc.fields->next);
+        ASSERT(mc_EncryptedFieldPath_child(node, "d", 1) == NULL);
         mc_EncryptedFieldConfig_cleanup(&efc);
     }
 
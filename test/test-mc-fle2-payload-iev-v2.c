@@ -148,6 +148,65 @@ static void _mc_fle2_iev_v2_test_run(_mongocrypt_tester_t *tester, _mc_fle2_iev_
     mongocrypt_status_destroy(status);
 }
 
+// Decrypt with S_KeyId and ServerEncryptedValue borrowed from the payload.
+static void _mc_fle2_iev_v2_test_run_borrowed(_mongocrypt_tester_t *tester, _mc_fle2_iev_v2_test *test) {
+    mongocrypt_status_t *status = mongocrypt_status_new();
+    mongocrypt_t *crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+
+    mc_FLE2IndexedEncryptedValueV2_t *iev = mc_FLE2IndexedEncryptedValueV2_new();
+    ASSERT_OK_STATUS(mc_FLE2IndexedEncryptedValueV2_parse_borrowed(iev, &test->payload, status), status);
+
+    // S_KeyId follows fle_blob_subtype in the payload.
+    const _mongocrypt_buffer_t *S_KeyId = mc_FLE2IndexedEncryptedValueV2_get_S_KeyId(iev, status);
+    ASSERT_OK_STATUS(S_KeyId, status);
+    ASSERT_CMPBUF(*S_KeyId, test->S_KeyId);
+    ASSERT(!S_KeyId->owned);
+    ASSERT(S_KeyId->data == test->payload.data + 1);
+
+    ASSERT_OK_STATUS(mc_FLE2IndexedEncryptedValueV2_add_S_Key(crypt->crypto, iev, &test->S_Key, status), status);
+    ASSERT_OK_STATUS(mc_FLE2IndexedEncryptedValueV2_add_K_Key(crypt->crypto, iev, &test->K_Key, status), status);
+    const _mongocrypt_buffer_t *bson_value = mc_FLE2IndexedEncryptedValueV2_get_ClientValue(iev, status);
+    ASSERT_OK_STATUS(bson_value, status);
+    ASSERT_CMPBUF(*bson_value, test->bson_value);
+
+    mc_FLE2IndexedEncryptedValueV2_destroy(iev);
+    mongocrypt_destroy(crypt);
+    mongocrypt_status_destroy(status);
+}
+
+// Metadata blocks are not needed to decrypt, and are not validated.
+static void _mc_fle2_iev_v2_test_run_ignores_metadata(_mongocrypt_tester_t *tester, _mc_fle2_iev_v2_test *test) {
+    mongocrypt_status_t *status = mongocrypt_status_new();
+    mongocrypt_t *crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+
+    // Equality has one metadata block. Range has edge_count blocks, where
+    // edge_count follows fle_blob_subtype, S_KeyId and original_bson_type.
+    uint32_t metadata_len = 96;
+    if (test->type == kTypeRange) {
+        ASSERT(test->payload.len > 18);
+        metadata_len *= test->payload.data[18];
+    }
+    ASSERT(test->payload.len > metadata_len);
+
+    _mongocrypt_buffer_t payload;
+    _mongocrypt_buffer_init(&payload);
+    _mongocrypt_buffer_copy_to(&test->payload, &payload);
+    memset(payload.data + payload.len - metadata_len, 0xFF, metadata_len);
+
+    mc_FLE2IndexedEncryptedValueV2_t *iev = mc_FLE2IndexedEncryptedValueV2_new();
+    ASSERT_OK_STATUS(mc_FLE2IndexedEncryptedValueV2_parse(iev, &payload, status), status);
+    ASSERT_OK_STATUS(mc_FLE2IndexedEncryptedValueV2_add_S_Key(crypt->crypto, iev, &test->S_Key, status), status);
+    ASSERT_OK_STATUS(mc_FLE2IndexedEncryptedValueV2_add_K_Key(crypt->crypto, iev, &test->K_Key, status), status);
+    const _mongocrypt_buffer_t *bson_value = mc_FLE2IndexedEncryptedValueV2_get_ClientValue(iev, status);
+    ASSERT_OK_STATUS(bson_value, status);
+    ASSERT_CMPBUF(*bson_value, test->bson_value);
+
+    mc_FLE2IndexedEncryptedValueV2_destroy(iev);
+    _mongocrypt_buffer_cleanup(&payload);
+    mongocrypt_destroy(crypt);
+    mongocrypt_status_destroy(status);
+}
+
 // Synthesize documents using ctx-decrypt workflow.
 static void _mc_fle2_iev_v2_test_explicit_ctx(_mongocrypt_tester_t *tester, _mc_fle2_iev_v2_test *test) {
     mongocrypt_status_t *status = mongocrypt_status_new();
@@ -227,6 +286,8 @@ static void test_fle2_iev_v2_test(_mongocrypt_tester_t *tester, const char *path
     ASSERT(bson_iter_init(&iter, &test_bson));
     ASSERT(_mc_fle2_iev_v2_test_parse(&test, &iter));
     _mc_fle2_iev_v2_test_run(tester, &test);
+    _mc_fle2_iev_v2_test_run_borrowed(tester, &test);
+    _mc_fle2_iev_v2_test_run_ignores_metadata(tester, &test);
     _mc_fle2_iev_v2_test_explicit_ctx(tester, &test);
     _mc_fle2_iev_v2_test_destroy(&test);
 }
@@ -66,6 +66,26 @@ static void test_FLE2UnindexedEncryptedValueV2_parse(_mongocrypt_tester_t *teste
         mongocrypt_status_destroy(status);
     }
 
+    /* Test successful borrowed parse. */
+    {
+        mongocrypt_status_t *status = mongocrypt_status_new();
+        _mongocrypt_buffer_copy_from_hex(&input, TEST_UEV_HEX);
+        _mongocrypt_buffer_copy_from_hex(&expect_key_uuid, TEST_KEY_UUID_HEX);
+
+        uev = mc_FLE2UnindexedEncryptedValueV2_new();
+        ASSERT_OK_STATUS(mc_FLE2UnindexedEncryptedValueV2_parse_borrowed(uev, &input, status), status);
+        const _mongocrypt_buffer_t *got = mc_FLE2UnindexedEncryptedValueV2_get_key_uuid(uev, status);
+        ASSERT_OR_PRINT(got != NULL, status);
+        ASSERT_CMPBUF(expect_key_uuid, *got);
+        /* key_uuid follows fle_blob_subtype in the input. */
+        ASSERT(!got->owned);
+        ASSERT(got->data == input.data + 1);
+        mc_FLE2UnindexedEncryptedValueV2_destroy(uev);
+        _mongocrypt_buffer_cleanup(&expect_key_uuid);
+        _mongocrypt_buffer_cleanup(&input);
+        mongocrypt_status_destroy(status);
+    }
+
     /* Test too-short input. */
     {
         mongocrypt_status_t *status = mongocrypt_status_new();
@@ -73,7 +93,7 @@ static void test_FLE2UnindexedEncryptedValueV2_parse(_mongocrypt_tester_t *teste
         uev = mc_FLE2UnindexedEncryptedValueV2_new();
         ASSERT_FAILS_STATUS(mc_FLE2UnindexedEncryptedValueV2_parse(uev, &input, status),
                             status,
-                            "expected byte length >= 17 got: 7");
+                            "expected byte length >= 18 got: 7");
         mc_FLE2UnindexedEncryptedValueV2_destroy(uev);
         _mongocrypt_buffer_cleanup(&input);
         mongocrypt_status_destroy(status);
@@ -64,7 +64,7 @@ static void test_FLE2UnindexedEncryptedValue_parse(_mongocrypt_tester_t *tester)
         uev = mc_FLE2UnindexedEncryptedValue_new();
         ASSERT_FAILS_STATUS(mc_FLE2UnindexedEncryptedValue_parse(uev, &input, status),
                             status,
-                            "expected byte length >= 17 got: 7");
+                            "expected byte length >= 18 got: 7");
         mc_FLE2UnindexedEncryptedValue_destroy(uev);
         _mongocrypt_buffer_cleanup(&input);
         mongocrypt_status_destroy(status);
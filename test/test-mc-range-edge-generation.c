@@ -368,6 +368,44 @@ static void _test_getEdgesDecimal128(_mongocrypt_tester_t *tester) {
 }
 #endif // MONGOCRYPT_HAVE_DECIMAL128_SUPPORT
 
+static void _test_edges_iter(_mongocrypt_tester_t *tester) {
+    const uint32_t trimFactors[] = {0, 1, 3};
+
+    for (size_t t = 0; t < sizeof(trimFactors) / sizeof(trimFactors[0]); t++) {
+        mongocrypt_status_t *const status = mongocrypt_status_new();
+        mc_getEdgesInt32_args_t args = {.value = 5,
+                                        .min = OPT_I32(-10),
+                                        .max = OPT_I32(100),
+                                        .sparsity = 2,
+                                        .trimFactor = trimFactors[t]};
+        mc_edges_t *got = mc_getEdgesInt32(args, status);
+        ASSERT_OK_STATUS(got != NULL, status);
+
+        mc_edges_iter_t it;
+        const char *edge;
+        size_t len;
+        bool is_leaf;
+        size_t i = 0;
+        size_t leaves = 0;
+
+        mc_edges_iter_init(&it, got);
+        while (mc_edges_iter_next(&it, &edge, &len, &is_leaf)) {
+            ASSERT_CMPPTR(edge, ==, mc_edges_get(got, i));
+            ASSERT_CMPSIZE_T(len, ==, strlen(edge));
+            ASSERT(is_leaf == mc_edges_is_leaf(got, edge));
+            leaves += is_leaf ? 1u : 0u;
+            i++;
+        }
+        ASSERT_CMPSIZE_T(i, ==, mc_edges_len(got));
+        ASSERT_CMPSIZE_T(leaves, ==, 1);
+        // An exhausted iterator stays exhausted.
+        ASSERT(!mc_edges_iter_next(&it, &edge, &len, &is_leaf));
+
+        mc_edges_destroy(got);
+        mongocrypt_status_destroy(status);
+    }
+}
+
 static void _test_count_leading_zeros(_mongocrypt_tester_t *tester) {
     ASSERT_CMPSIZE_T(mc_count_leading_zeros_u64(UINT64_C(0)), ==, 64);
     ASSERT_CMPSIZE_T(mc_count_leading_zeros_u64(UINT64_C(1)), ==, 63);
@@ -482,6 +520,7 @@ void _mongocrypt_tester_install_range_edge_generation(_mongocrypt_tester_t *test
 #if MONGOCRYPT_HAVE_DECIMAL128_SUPPORT
     INSTALL_TEST(_test_getEdgesDecimal128);
 #endif
+    INSTALL_TEST(_test_edges_iter);
     INSTALL_TEST(_test_count_leading_zeros);
     INSTALL_TEST(_test_convert_to_bitstring);
 }
@@ -436,6 +436,26 @@ static void _test_RangeTest_Encode_Double(_mongocrypt_tester_t *tester) {
             ASSERT_CMPUINT64(got.value, ==, test->expect);
             ASSERT_CMPUINT64(got.min, ==, 0);
             ASSERT_CMPUINT64(got.max, ==, test->expectMax.set ? test->expectMax.value : UINT64_MAX);
+
+            if (test->precision.set) {
+                // A scale computed once for the field encodes the same.
+                mc_DoubleScale_t scale;
+                mc_OSTType_Double scaled;
+
+                ASSERT_OK_STATUS(
+                    mc_DoubleScale_init(&scale, test->min.value, test->max.value, test->precision.value, status),
+                    status);
+                ASSERT_OK_STATUS(mc_getTypeInfoDouble((mc_getTypeInfoDouble_args_t){.value = test->value,
+                                                                                    .min = test->min,
+                                                                                    .max = test->max,
+                                                                                    .precision = test->precision,
+                                                                                    .scale = &scale},
+                                                      &scaled,
+                                                      status),
+                                 status);
+                ASSERT_CMPUINT64(scaled.value, ==, got.value);
+                ASSERT_CMPUINT64(scaled.max, ==, got.max);
+            }
         }
         mongocrypt_status_destroy(status);
     }
@@ -716,6 +736,12 @@ static void _test_RangeTest_Encode_Decimal128(_mongocrypt_tester_t *tester) {
         // min has more places after the decimal than precision.
         ASSERT_EIBB(5, 18446744073709551616, .01, 1, 49),
 
+        // min×10^precision is an integer.
+        ASSERT_EIBB(123.456, 1000, -1000.5, 1, 11239),
+        // min×10^precision has a fractional part.
+        ASSERT_EIBB(123.456, 1000, -1000.25, 1, 11236),
+        ASSERT_EIBB(-999.999, 0, -1000, 2, 1),
+
 #undef ASSERT_EIBB
 #undef ASSERT_EIBB_OVERFLOW
 
@@ -328,7 +328,55 @@ static void test_mc_RangeOpts_to_FLE2RangeInsertSpec(_mongocrypt_tester_t *teste
     }
 }
 
+static void test_mc_RangeOpts_copy(_mongocrypt_tester_t *tester) {
+    mongocrypt_status_t *status = mongocrypt_status_new();
+    mc_RangeOpts_t ro, copy;
+    bson_t out = BSON_INITIALIZER;
+
+    ASSERT_OK_STATUS(mc_RangeOpts_parse(&ro,
+                                        TMP_BSON(RAW_STRING({
+                                            "min" : 0,
+                                            "max" : 7,
+                                            "trimFactor" : 2,
+                                            "sparsity" : {"$numberLong" : "1"}
+                                        })),
+                                        true /* use_range_v2 */,
+                                        status),
+                     status);
+    // The domain [0, 7] needs 3 bits.
+    ASSERT(ro.domainBits.set);
+    ASSERT_CMPUINT32(ro.domainBits.value, ==, 3);
+
+    mc_RangeOpts_copy(&copy, &ro);
+    mc_RangeOpts_cleanup(&ro);
+    ASSERT_OK_STATUS(mc_RangeOpts_to_FLE2RangeInsertSpec(&copy, TMP_BSON("{'v': 5}"), &out, true, status), status);
+    ASSERT_EQUAL_BSON(TMP_BSON(RAW_STRING({"v" : {"v" : 5, "min" : 0, "max" : 7, "trimFactor" : 2}})), &out);
+    bson_destroy(&out);
+    mc_RangeOpts_cleanup(&copy);
+
+    // An invalid domain is reported when the trimFactor is validated.
+    ASSERT_OK_STATUS(mc_RangeOpts_parse(&ro,
+                                        TMP_BSON(RAW_STRING({
+                                            "min" : 7,
+                                            "max" : 0,
+                                            "trimFactor" : 1,
+                                            "sparsity" : {"$numberLong" : "1"}
+                                        })),
+                                        true /* use_range_v2 */,
+                                        status),
+                     status);
+    ASSERT(!ro.domainBits.set);
+    bson_init(&out);
+    ASSERT_FAILS_STATUS(mc_RangeOpts_to_FLE2RangeInsertSpec(&ro, TMP_BSON("{'v': 5}"), &out, true, status),
+                        status,
+                        "The minimum value must be less than the maximum value");
+    bson_destroy(&out);
+    mc_RangeOpts_cleanup(&ro);
+    mongocrypt_status_destroy(status);
+}
+
 void _mongocrypt_tester_install_mc_RangeOpts(_mongocrypt_tester_t *tester) {
     INSTALL_TEST(test_mc_RangeOpts_parse);
     INSTALL_TEST(test_mc_RangeOpts_to_FLE2RangeInsertSpec);
+    INSTALL_TEST(test_mc_RangeOpts_copy);
 }
@@ -45,6 +45,38 @@ static void _test_mc_reader(_mongocrypt_tester_t *tester) {
     mongocrypt_status_destroy(status);
 }
 
+static void _test_mc_reader_unchecked(_mongocrypt_tester_t *tester) {
+    _mongocrypt_buffer_t input_buf;
+    _mongocrypt_buffer_copy_from_hex(&input_buf, "AB0102CD");
+
+    mongocrypt_status_t *status;
+    status = mongocrypt_status_new();
+
+    mc_reader_t reader;
+    mc_reader_init_from_buffer(&reader, &input_buf, __FUNCTION__);
+
+    ASSERT_OK_STATUS(mc_reader_require(&reader, 4, status), status);
+    ASSERT_FAILS_STATUS(mc_reader_require(&reader, 5, status), status, "expected byte length >= 5 got: 4");
+
+    ASSERT_CMPUINT(mc_reader_read_u8_unchecked(&reader), ==, 0xAB);
+
+    _mongocrypt_buffer_t copied, borrowed;
+    mc_reader_read_buffer_unchecked(&reader, &copied, 2, false);
+    ASSERT(copied.owned);
+    ASSERT_CMPBYTES(input_buf.data + 1, 2, copied.data, copied.len);
+    ASSERT_CMPUINT64(mc_reader_get_consumed_length(&reader), ==, 3);
+
+    mc_reader_read_buffer_unchecked(&reader, &borrowed, 1, true);
+    ASSERT(!borrowed.owned);
+    ASSERT(borrowed.data == input_buf.data + 3);
+    ASSERT_CMPUINT64(mc_reader_get_remaining_length(&reader), ==, 0);
+
+    _mongocrypt_buffer_cleanup(&borrowed);
+    _mongocrypt_buffer_cleanup(&copied);
+    _mongocrypt_buffer_cleanup(&input_buf);
+    mongocrypt_status_destroy(status);
+}
+
 static void _test_mc_reader_uuid(_mongocrypt_tester_t *tester) {
     const uint8_t expected_bytes[] =
         {0x12, 0x34, 0x56, 0x78, 0x90, 0x12, 0x34, 0x56, 0x78, 0x90, 0x12, 0x34, 0x56, 0x78, 0x90, 0x12};
@@ -165,4 +197,5 @@ void _mongocrypt_tester_install_mc_reader(_mongocrypt_tester_t *tester) {
     INSTALL_TEST(_test_mc_reader_prfblock);
     INSTALL_TEST(_test_mc_reader_ints);
     INSTALL_TEST(_test_mc_reader_bytes);
+    INSTALL_TEST(_test_mc_reader_unchecked);
 }
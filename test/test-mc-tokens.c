@@ -274,8 +274,112 @@ static void _test_mc_tokens_raw_buffer(_mongocrypt_tester_t *tester) {
     mc_ServerDataEncryptionLevel1Token_destroy(token);
 }
 
+static void _test_mc_tokens_caller_storage(_mongocrypt_tester_t *tester) {
+    mongocrypt_status_t *status = mongocrypt_status_new();
+    mongocrypt_t *crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    _mongocrypt_buffer_t RootKey;
+    _mongocrypt_buffer_t value;
+
+    _mongocrypt_buffer_copy_from_hex(&RootKey, "6c6a349956c19f9c5e638e612011a71fbb71921edb540310c17cd0208b7f548b");
+    _mongocrypt_buffer_copy_from_hex(&value, "c07c0df51257948e1a0fc70dd4568e3af99b23b3434c9858237ca7db62db9766");
+
+    /* Derive a token chain on the stack. */
+    mc_CollectionsLevel1Token_t collectionsLevel1Token;
+    mc_EDCToken_t EDCToken;
+    mc_EDCDerivedFromDataToken_t EDCDerivedFromDataToken;
+    mc_EDCDerivedFromDataTokenAndContentionFactor_t EDCDerivedFromDataTokenAndContentionFactor;
+    ASSERT_OK_STATUS(mc_CollectionsLevel1Token_derive(&collectionsLevel1Token, crypt->crypto, &RootKey, status),
+                     status);
+    ASSERT_OK_STATUS(mc_EDCToken_derive(&EDCToken, crypt->crypto, &collectionsLevel1Token, status), status);
+    ASSERT_OK_STATUS(
+        mc_EDCDerivedFromDataToken_derive(&EDCDerivedFromDataToken, crypt->crypto, &EDCToken, &value, status),
+        status);
+    ASSERT_OK_STATUS(mc_EDCDerivedFromDataTokenAndContentionFactor_derive(&EDCDerivedFromDataTokenAndContentionFactor,
+                                                                          crypt->crypto,
+                                                                          &EDCDerivedFromDataToken,
+                                                                          1234,
+                                                                          status),
+                     status);
+
+    /* Assert the stack tokens match the heap tokens. */
+    mc_CollectionsLevel1Token_t *heapCollectionsLevel1Token =
+        mc_CollectionsLevel1Token_new(crypt->crypto, &RootKey, status);
+    ASSERT_OR_PRINT(heapCollectionsLevel1Token, status);
+    mc_EDCToken_t *heapEDCToken = mc_EDCToken_new(crypt->crypto, heapCollectionsLevel1Token, status);
+    ASSERT_OR_PRINT(heapEDCToken, status);
+    mc_EDCDerivedFromDataToken_t *heapEDCDerivedFromDataToken =
+        mc_EDCDerivedFromDataToken_new(crypt->crypto, heapEDCToken, &value, status);
+    ASSERT_OR_PRINT(heapEDCDerivedFromDataToken, status);
+    mc_EDCDerivedFromDataTokenAndContentionFactor_t *heapEDCDerivedFromDataTokenAndContentionFactor =
+        mc_EDCDerivedFromDataTokenAndContentionFactor_new(crypt->crypto, heapEDCDerivedFromDataToken, 1234, status);
+    ASSERT_OR_PRINT(heapEDCDerivedFromDataTokenAndContentionFactor, status);
+
+    ASSERT_CMPBUF(*mc_CollectionsLevel1Token_get(&collectionsLevel1Token),
+                  *mc_CollectionsLevel1Token_get(heapCollectionsLevel1Token));
+    ASSERT_CMPBUF(*mc_EDCToken_get(&EDCToken), *mc_EDCToken_get(heapEDCToken));
+    ASSERT_CMPBUF(*mc_EDCDerivedFromDataToken_get(&EDCDerivedFromDataToken),
+                  *mc_EDCDerivedFromDataToken_get(heapEDCDerivedFromDataToken));
+    ASSERT_CMPBUF(
+        *mc_EDCDerivedFromDataTokenAndContentionFactor_get(&EDCDerivedFromDataTokenAndContentionFactor),
+        *mc_EDCDerivedFromDataTokenAndContentionFactor_get(heapEDCDerivedFromDataTokenAndContentionFactor));
+
+    /* Stack tokens own no memory. */
+    ASSERT(!mc_EDCToken_get(&EDCToken)->owned);
+
+    /* _init copies a raw value into caller storage. */
+    mc_EDCToken_t copied;
+    mc_EDCToken_init(&copied, mc_EDCToken_get(heapEDCToken));
+    ASSERT(mc_EDCToken_get(&copied)->data != mc_EDCToken_get(heapEDCToken)->data);
+    ASSERT_CMPBUF(*mc_EDCToken_get(&copied), *mc_EDCToken_get(heapEDCToken));
+
+    mc_EDCDerivedFromDataTokenAndContentionFactor_destroy(heapEDCDerivedFromDataTokenAndContentionFactor);
+    mc_EDCDerivedFromDataToken_destroy(heapEDCDerivedFromDataToken);
+    mc_EDCToken_destroy(heapEDCToken);
+    mc_CollectionsLevel1Token_destroy(heapCollectionsLevel1Token);
+    _mongocrypt_buffer_cleanup(&value);
+    _mongocrypt_buffer_cleanup(&RootKey);
+    mongocrypt_destroy(crypt);
+    mongocrypt_status_destroy(status);
+}
+
+static void _test_mc_tokens_anchor_padding_batch(_mongocrypt_tester_t *tester) {
+    mongocrypt_status_t *status = mongocrypt_status_new();
+    mongocrypt_t *crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    const char *rootKeys[] = {"6c6a349956c19f9c5e638e612011a71fbb71921edb540310c17cd0208b7f548b",
+                              "c07c0df51257948e1a0fc70dd4568e3af99b23b3434c9858237ca7db62db9766"};
+    mc_ESCToken_t ESCTokens[2];
+    const mc_ESCToken_t *ESCTokenPtrs[2];
+    mc_AnchorPaddingTokenRoot_t batched[2];
+
+    for (int i = 0; i < 2; i++) {
+        _mongocrypt_buffer_t RootKey;
+        mc_CollectionsLevel1Token_t collectionsLevel1Token;
+
+        _mongocrypt_buffer_copy_from_hex(&RootKey, rootKeys[i]);
+        ASSERT_OK_STATUS(mc_CollectionsLevel1Token_derive(&collectionsLevel1Token, crypt->crypto, &RootKey, status),
+                         status);
+        ASSERT_OK_STATUS(mc_ESCToken_derive(&ESCTokens[i], crypt->crypto, &collectionsLevel1Token, status), status);
+        ESCTokenPtrs[i] = &ESCTokens[i];
+        _mongocrypt_buffer_cleanup(&RootKey);
+    }
+
+    /* Each batched token matches the token derived alone. */
+    ASSERT_OK_STATUS(mc_AnchorPaddingTokenRoot_derive_batch(batched, crypt->crypto, ESCTokenPtrs, 2, status), status);
+    for (int i = 0; i < 2; i++) {
+        mc_AnchorPaddingTokenRoot_t *single = mc_AnchorPaddingTokenRoot_new(crypt->crypto, &ESCTokens[i], status);
+        ASSERT_OR_PRINT(single, status);
+        ASSERT_CMPBUF(*mc_AnchorPaddingTokenRoot_get(&batched[i]), *mc_AnchorPaddingTokenRoot_get(single));
+        mc_AnchorPaddingTokenRoot_destroy(single);
+    }
+
+    mongocrypt_destroy(crypt);
+    mongocrypt_status_destroy(status);
+}
+
 void _mongocrypt_tester_install_mc_tokens(_mongocrypt_tester_t *tester) {
     INSTALL_TEST(_test_mc_tokens);
     INSTALL_TEST(_test_mc_tokens_error);
     INSTALL_TEST(_test_mc_tokens_raw_buffer);
+    INSTALL_TEST(_test_mc_tokens_caller_storage);
+    INSTALL_TEST(_test_mc_tokens_anchor_padding_batch);
 }
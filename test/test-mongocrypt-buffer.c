@@ -232,6 +232,136 @@ static void _test_mongocrypt_buffer_from_subrange(_mongocrypt_tester_t *tester)
     _mongocrypt_buffer_cleanup(&input);
 }
 
+static void _test_mongocrypt_buffer_init_size_small(_mongocrypt_tester_t *tester) {
+    uint8_t storage[MONGOCRYPT_BUFFER_SMALL_LEN];
+    _mongocrypt_buffer_t buf;
+
+    /* Small lengths use the caller storage. */
+    _mongocrypt_buffer_init_size_small(&buf, MONGOCRYPT_BUFFER_SMALL_LEN, storage);
+    ASSERT(buf.data == storage);
+    ASSERT(buf.len == MONGOCRYPT_BUFFER_SMALL_LEN);
+    ASSERT(!buf.owned);
+    _mongocrypt_buffer_cleanup(&buf);
+
+    /* Larger lengths are allocated. */
+    _mongocrypt_buffer_init_size_small(&buf, MONGOCRYPT_BUFFER_SMALL_LEN + 1, storage);
+    ASSERT(buf.data != storage);
+    ASSERT(buf.len == MONGOCRYPT_BUFFER_SMALL_LEN + 1);
+    ASSERT(buf.owned);
+    _mongocrypt_buffer_cleanup(&buf);
+}
+
+static void _test_mongocrypt_buffer_shared(_mongocrypt_tester_t *tester) {
+    uint8_t data[] = {1, 2, 3, 4};
+    _mongocrypt_buffer_t src, a, b, c;
+
+    _mongocrypt_buffer_init(&a);
+    _mongocrypt_buffer_init(&b);
+    _mongocrypt_buffer_init(&c);
+    ASSERT(_mongocrypt_buffer_copy_from_data_and_size(&src, data, sizeof(data)));
+
+    /* Sharing a buffer that is not shared copies. */
+    _mongocrypt_buffer_share_to(&src, &a);
+    ASSERT(a.owned);
+    ASSERT(!a.shared);
+    ASSERT(a.data != data);
+    _mongocrypt_buffer_cleanup(&a);
+
+    _mongocrypt_buffer_copy_to_shared(&src, &a);
+    ASSERT(!a.owned);
+    ASSERT(a.shared);
+    ASSERT(a.data != data);
+    ASSERT_CMPBUF(a, src);
+
+    /* References share the same data. */
+    _mongocrypt_buffer_share_to(&a, &b);
+    _mongocrypt_buffer_share_to(&b, &c);
+    ASSERT(b.data == a.data);
+    ASSERT(c.data == a.data);
+    ASSERT(b.shared == a.shared);
+
+    /* Data remains valid until the last reference is cleaned up. */
+    _mongocrypt_buffer_cleanup(&a);
+    ASSERT(!a.shared);
+    ASSERT_CMPBYTES(data, sizeof(data), c.data, c.len);
+
+    /* Resizing a shared buffer allocates and releases the reference. */
+    _mongocrypt_buffer_resize(&b, 2);
+    ASSERT(b.owned);
+    ASSERT(!b.shared);
+    ASSERT(b.data != c.data);
+    ASSERT_CMPBYTES(data, 2, c.data, 2);
+
+    _mongocrypt_buffer_cleanup(&b);
+    _mongocrypt_buffer_cleanup(&c);
+    _mongocrypt_buffer_cleanup(&src);
+}
+
+static void _test_mongocrypt_buffer_shared_locked(_mongocrypt_tester_t *tester) {
+    uint8_t data[96] = {1, 2, 3, 4};
+    _mongocrypt_buffer_t src, a, b;
+    mongocrypt_t *crypt = mongocrypt_new();
+
+    ASSERT_OK(mongocrypt_setopt_kms_provider_aws(crypt, "example", -1, "example", -1), crypt);
+    ASSERT_OK(mongocrypt_setopt_lock_key_material(crypt), crypt);
+    if (!mongocrypt_init(crypt)) {
+        /* Locking memory may not be permitted, e.g. with a low RLIMIT_MEMLOCK. */
+        ASSERT_STATUS_CONTAINS(crypt->status, "unable to lock memory");
+        printf("Unable to lock memory. Skipping.");
+        mongocrypt_destroy(crypt);
+        return;
+    }
+
+    /* Shared data that fits in a slot comes from the arena, and behaves the same. */
+    ASSERT(_mongocrypt_buffer_copy_from_data_and_size(&src, data, sizeof(data)));
+    _mongocrypt_buffer_copy_to_shared(&src, &a);
+    _mongocrypt_buffer_share_to(&a, &b);
+    ASSERT(b.data == a.data);
+    ASSERT_CMPBUF(a, src);
+    _mongocrypt_buffer_cleanup(&a);
+    ASSERT_CMPBUF(b, src);
+
+    /* Data outlives the mongocrypt_t that acquired the arena. */
+    mongocrypt_destroy(crypt);
+    ASSERT_CMPBUF(b, src);
+    _mongocrypt_buffer_cleanup(&b);
+
+    /* Larger data comes from the heap. */
+    uint8_t *large = bson_malloc0(1024);
+    _mongocrypt_buffer_cleanup(&src);
+    ASSERT(_mongocrypt_buffer_copy_from_data_and_size(&src, large, 1024));
+    _mongocrypt_buffer_copy_to_shared(&src, &a);
+    ASSERT_CMPBUF(a, src);
+    _mongocrypt_buffer_cleanup(&a);
+    _mongocrypt_buffer_cleanup(&src);
+    bson_free(large);
+}
+
+static void _test_mongocrypt_buffer_is_bson_value(_mongocrypt_tester_t *tester) {
+    _mongocrypt_buffer_t buf;
+
+#define EXPECT(hex, type, expect)                                                                                      \
+    _mongocrypt_buffer_copy_from_hex(&buf, hex);                                                                       \
+    ASSERT(_mongocrypt_buffer_is_bson_value(&buf, type) == expect);                                                    \
+    _mongocrypt_buffer_cleanup(&buf);
+
+    EXPECT("01000000", BSON_TYPE_INT32, true);
+    EXPECT("0100000000", BSON_TYPE_INT32, false);
+    /* "ab" */
+    EXPECT("03000000616200", BSON_TYPE_UTF8, true);
+    EXPECT("04000000616200", BSON_TYPE_UTF8, false);
+    EXPECT("03000000616201", BSON_TYPE_UTF8, false);
+    /* Binary subtype 0 of length 2. */
+    EXPECT("02000000000102", BSON_TYPE_BINARY, true);
+    EXPECT("03000000000102", BSON_TYPE_BINARY, false);
+    /* {"a": 1} */
+    EXPECT("0c0000001061000100000000", BSON_TYPE_DOCUMENT, true);
+    EXPECT("0c0000001061000100000001", BSON_TYPE_DOCUMENT, false);
+    /* Other types are checked by wrapping in a document. */
+    EXPECT("01", BSON_TYPE_BOOL, true);
+#undef EXPECT
+}
+
 void _mongocrypt_tester_install_buffer(_mongocrypt_tester_t *tester) {
     INSTALL_TEST(_test_mongocrypt_buffer_from_iter);
     INSTALL_TEST(_test_mongocrypt_buffer_copy_from_data_and_size);
@@ -239,4 +369,8 @@ void _mongocrypt_tester_install_buffer(_mongocrypt_tester_t *tester) {
     INSTALL_TEST(_test_mongocrypt_buffer_steal_from_string);
     INSTALL_TEST(_test_mongocrypt_buffer_copy_from_uint64_le);
     INSTALL_TEST(_test_mongocrypt_buffer_from_subrange);
+    INSTALL_TEST(_test_mongocrypt_buffer_init_size_small);
+    INSTALL_TEST(_test_mongocrypt_buffer_shared);
+    INSTALL_TEST(_test_mongocrypt_buffer_shared_locked);
+    INSTALL_TEST(_test_mongocrypt_buffer_is_bson_value);
 }
@@ -56,6 +56,91 @@ static void _test_cache_oauth_expiration(_mongocrypt_tester_t *tester) {
     mongocrypt_status_destroy(status);
 }
 
+static void _test_cache_oauth_refresh(_mongocrypt_tester_t *tester) {
+    mc_mapof_kmsid_to_token_t *cache;
+    mongocrypt_status_t *status;
+    const int64_t margin_us = 60 * 1000 * 1000;
+    bool refresh;
+    char *token;
+
+    cache = mc_mapof_kmsid_to_token_new();
+    status = mongocrypt_status_new();
+
+    /* A missing token is not refreshed. */
+    token = mc_mapof_kmsid_to_token_get_token_refresh(cache, "azure", margin_us, &refresh);
+    BSON_ASSERT(!token);
+    BSON_ASSERT(!refresh);
+
+    /* A token expiring within the margin is returned and refreshed once. */
+    ASSERT_OK_STATUS(mc_mapof_kmsid_to_token_add_response(cache,
+                                                          "azure",
+                                                          TMP_BSON("{'expires_in': 30, 'access_token': 'foo'}"),
+                                                          status),
+                     status);
+    token = mc_mapof_kmsid_to_token_get_token_refresh(cache, "azure", margin_us, &refresh);
+    ASSERT_STREQUAL(token, "foo");
+    BSON_ASSERT(refresh);
+    bson_free(token);
+
+    token = mc_mapof_kmsid_to_token_get_token_refresh(cache, "azure", margin_us, &refresh);
+    ASSERT_STREQUAL(token, "foo");
+    BSON_ASSERT(!refresh);
+    bson_free(token);
+
+    /* After abandoning, another caller refreshes. */
+    mc_mapof_kmsid_to_token_abandon_fetch(cache, "azure");
+    token = mc_mapof_kmsid_to_token_get_token_refresh(cache, "azure", margin_us, &refresh);
+    ASSERT_STREQUAL(token, "foo");
+    BSON_ASSERT(refresh);
+    bson_free(token);
+
+    /* A new token outside the margin is not refreshed. */
+    ASSERT_OK_STATUS(mc_mapof_kmsid_to_token_add_response(cache,
+                                                          "azure",
+                                                          TMP_BSON("{'expires_in': 1000, 'access_token': 'bar'}"),
+                                                          status),
+                     status);
+    token = mc_mapof_kmsid_to_token_get_token_refresh(cache, "azure", margin_us, &refresh);
+    ASSERT_STREQUAL(token, "bar");
+    BSON_ASSERT(!refresh);
+    bson_free(token);
+
+    mc_mapof_kmsid_to_token_destroy(cache);
+    mongocrypt_status_destroy(status);
+}
+
+static void _test_cache_oauth_claim_fetch(_mongocrypt_tester_t *tester) {
+    mc_mapof_kmsid_to_token_t *cache;
+    mongocrypt_status_t *status;
+    char *token;
+
+    cache = mc_mapof_kmsid_to_token_new();
+    status = mongocrypt_status_new();
+
+    /* Only one caller fetches a token per KMS ID. */
+    ASSERT(mc_mapof_kmsid_to_token_claim_fetch(cache, "azure"));
+    ASSERT(!mc_mapof_kmsid_to_token_claim_fetch(cache, "azure"));
+    ASSERT(mc_mapof_kmsid_to_token_claim_fetch(cache, "azure:name1"));
+
+    /* After abandoning, another caller fetches. */
+    mc_mapof_kmsid_to_token_abandon_fetch(cache, "azure:name1");
+    ASSERT(mc_mapof_kmsid_to_token_claim_fetch(cache, "azure:name1"));
+
+    /* Adding the response ends the fetch. */
+    ASSERT_OK_STATUS(mc_mapof_kmsid_to_token_add_response(cache,
+                                                          "azure",
+                                                          TMP_BSON("{'expires_in': 1000, 'access_token': 'foo'}"),
+                                                          status),
+                     status);
+    token = mc_mapof_kmsid_to_token_get_token(cache, "azure");
+    ASSERT_STREQUAL(token, "foo");
+    bson_free(token);
+    ASSERT(mc_mapof_kmsid_to_token_claim_fetch(cache, "azure"));
+
+    mc_mapof_kmsid_to_token_destroy(cache);
+    mongocrypt_status_destroy(status);
+}
+
 #define BSON_STR(...) #__VA_ARGS__
 
 static void test_mc_mapof_kmsid_to_token(_mongocrypt_tester_t *tester) {
@@ -134,5 +219,7 @@ static void test_mc_mapof_kmsid_to_token(_mongocrypt_tester_t *tester) {
 
 void _mongocrypt_tester_install_cache_oauth(_mongocrypt_tester_t *tester) {
     INSTALL_TEST(_test_cache_oauth_expiration);
+    INSTALL_TEST(_test_cache_oauth_refresh);
+    INSTALL_TEST(_test_cache_oauth_claim_fetch);
     INSTALL_TEST(test_mc_mapof_kmsid_to_token);
 }
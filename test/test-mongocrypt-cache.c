@@ -18,6 +18,27 @@
 #include "mongocrypt-crypto-private.h"
 #include "test-mongocrypt.h"
 
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+static void *_bson_copy_value(void *value) {
+    return bson_copy((const bson_t *)value);
+}
+
+static void _bson_destroy_value(void *value) {
+    bson_destroy((bson_t *)value);
+}
+
+/* _bson_cache_init initializes a cache of BSON documents by namespace to test
+ * the generic cache. */
+static void _bson_cache_init(_mongocrypt_cache_t *cache) {
+    _mongocrypt_cache_collinfo_init(cache);
+    cache->copy_value = _bson_copy_value;
+    cache->destroy_value = _bson_destroy_value;
+}
+
 void _test_cache(_mongocrypt_tester_t *tester) {
     _mongocrypt_cache_t cache;
     mongocrypt_status_t *status;
@@ -26,7 +47,7 @@ void _test_cache(_mongocrypt_tester_t *tester) {
 
     status = mongocrypt_status_new();
 
-    _mongocrypt_cache_collinfo_init(&cache);
+    _bson_cache_init(&cache);
 
     /* Test get on an empty cache. */
     BSON_ASSERT(_mongocrypt_cache_get(&cache, "1", (void **)&tmp));
@@ -94,7 +115,7 @@ static void _test_cache_expiration(_mongocrypt_tester_t *tester) {
 
     status = mongocrypt_status_new();
 
-    _mongocrypt_cache_collinfo_init(&cache);
+    _bson_cache_init(&cache);
     _mongocrypt_cache_set_expiration(&cache, 1);
     /* Test set + get */
     ASSERT_OR_PRINT(_mongocrypt_cache_add_copy(&cache, "1", entry, status), status);
@@ -234,8 +255,1074 @@ static void _test_cache_duplicates(_mongocrypt_tester_t *tester) {
     _mongocrypt_cache_cleanup(&cache);
 }
 
+static void _test_cache_many_entries(_mongocrypt_tester_t *tester) {
+    _mongocrypt_cache_t cache;
+    mongocrypt_status_t *status;
+    bson_t *entry = BCON_NEW("a", "b");
+    bson_t *tmp = NULL;
+    char ns[32];
+
+    status = mongocrypt_status_new();
+
+    _bson_cache_init(&cache);
+
+    /* Enough entries to grow the hash index several times. */
+    for (int i = 0; i < 1000; i++) {
+        bson_snprintf(ns, sizeof(ns), "db.coll%d", i);
+        ASSERT_OR_PRINT(_mongocrypt_cache_add_copy(&cache, ns, entry, status), status);
+    }
+    BSON_ASSERT(_mongocrypt_cache_num_entries(&cache) == 1000);
+
+    /* Overwriting leaves deleted index slots behind. */
+    for (int i = 0; i < 1000; i += 2) {
+        bson_snprintf(ns, sizeof(ns), "db.coll%d", i);
+        ASSERT_OR_PRINT(_mongocrypt_cache_add_copy(&cache, ns, entry, status), status);
+    }
+    BSON_ASSERT(_mongocrypt_cache_num_entries(&cache) == 1000);
+
+    for (int i = 0; i < 1000; i++) {
+        bson_snprintf(ns, sizeof(ns), "db.coll%d", i);
+        BSON_ASSERT(_mongocrypt_cache_get(&cache, ns, (void **)&tmp));
+        BSON_ASSERT(tmp);
+        BSON_ASSERT(bson_equal(entry, tmp));
+        bson_destroy(tmp);
+    }
+
+    BSON_ASSERT(_mongocrypt_cache_get(&cache, "db.coll1000", (void **)&tmp));
+    BSON_ASSERT(!tmp);
+
+    _mongocrypt_cache_cleanup(&cache);
+    mongocrypt_status_destroy(status);
+    bson_destroy(entry);
+}
+
+static void _test_cache_key_many_alt_names(_mongocrypt_tester_t *tester) {
+    _mongocrypt_cache_t cache;
+    mongocrypt_status_t *status;
+    _mongocrypt_key_doc_t *placeholder_keydoc;
+    _mongocrypt_cache_key_value_t *value, *tmp;
+    _mongocrypt_cache_key_attr_t *attr, *by_id, *by_name, *by_other_name;
+    _mongocrypt_buffer_t id, material;
+    _mongocrypt_key_alt_name_t *alt_names, *last_name, *other_name;
+
+    status = mongocrypt_status_new();
+
+    _mongocrypt_buffer_copy_from_hex(&id, "ABCDEFAB123498761234123456789012");
+    _mongocrypt_buffer_init(&material);
+    _mongocrypt_buffer_resize(&material, MONGOCRYPT_KEY_LEN);
+    material.data[0] = 1;
+
+    placeholder_keydoc = _mongocrypt_key_new();
+    value = _mongocrypt_cache_key_value_new(placeholder_keydoc, &material);
+
+    /* More alt names than hash codes computed without allocating. */
+    alt_names = _MONGOCRYPT_KEY_ALT_NAME_CREATE("a", "b", "c", "d", "e", "f", "g", "h", "i", "j");
+    last_name = _MONGOCRYPT_KEY_ALT_NAME_CREATE("j");
+    other_name = _MONGOCRYPT_KEY_ALT_NAME_CREATE("k");
+
+    attr = _mongocrypt_cache_key_attr_new(&id, alt_names);
+    by_id = _mongocrypt_cache_key_attr_new(&id, NULL);
+    by_name = _mongocrypt_cache_key_attr_new(NULL, last_name);
+    by_other_name = _mongocrypt_cache_key_attr_new(NULL, other_name);
+
+    _mongocrypt_cache_key_init(&cache);
+    ASSERT_OR_PRINT(_mongocrypt_cache_add_copy(&cache, attr, value, status), status);
+
+    BSON_ASSERT(_mongocrypt_cache_get(&cache, by_id, (void **)&tmp));
+    BSON_ASSERT(tmp);
+    BSON_ASSERT(tmp->decrypted_key_material.data[0] == 1);
+    _mongocrypt_cache_key_value_destroy(tmp);
+
+    BSON_ASSERT(_mongocrypt_cache_get(&cache, by_name, (void **)&tmp));
+    BSON_ASSERT(tmp);
+    BSON_ASSERT(tmp->decrypted_key_material.data[0] == 1);
+    _mongocrypt_cache_key_value_destroy(tmp);
+
+    BSON_ASSERT(_mongocrypt_cache_get(&cache, by_other_name, (void **)&tmp));
+    BSON_ASSERT(!tmp);
+
+    /* Adding an entry that shares an alt name replaces the first entry. */
+    ASSERT_OR_PRINT(_mongocrypt_cache_add_copy(&cache, by_name, value, status), status);
+    BSON_ASSERT(_mongocrypt_cache_num_entries(&cache) == 1);
+    BSON_ASSERT(_mongocrypt_cache_get(&cache, by_id, (void **)&tmp));
+    BSON_ASSERT(!tmp);
+
+    _mongocrypt_cache_cleanup(&cache);
+    _mongocrypt_cache_key_attr_destroy(attr);
+    _mongocrypt_cache_key_attr_destroy(by_id);
+    _mongocrypt_cache_key_attr_destroy(by_name);
+    _mongocrypt_cache_key_attr_destroy(by_other_name);
+    _mongocrypt_key_alt_name_destroy_all(alt_names);
+    _mongocrypt_key_alt_name_destroy_all(last_name);
+    _mongocrypt_key_alt_name_destroy_all(other_name);
+    _mongocrypt_cache_key_value_destroy(value);
+    _mongocrypt_key_destroy(placeholder_keydoc);
+    _mongocrypt_buffer_cleanup(&material);
+    _mongocrypt_buffer_cleanup(&id);
+    mongocrypt_status_destroy(status);
+}
+
+/* Evicting a key removes it from the keyAltName index. */
+static void _test_cache_key_evict_alt_names(_mongocrypt_tester_t *tester) {
+    _mongocrypt_cache_t cache;
+    mongocrypt_status_t *status;
+    _mongocrypt_key_doc_t *placeholder_keydoc;
+    _mongocrypt_cache_key_value_t *value, *tmp;
+    _mongocrypt_cache_key_attr_t *attr1, *attr2, *by_name;
+    _mongocrypt_buffer_t id1, id2, material;
+    _mongocrypt_key_alt_name_t *alt_names1, *alt_names2, *name;
+
+    status = mongocrypt_status_new();
+
+    _mongocrypt_buffer_copy_from_hex(&id1, "ABCDEFAB123498761234123456789012");
+    _mongocrypt_buffer_copy_from_hex(&id2, "ABCDEFAB123498761234123456789013");
+    _mongocrypt_buffer_init(&material);
+    _mongocrypt_buffer_resize(&material, MONGOCRYPT_KEY_LEN);
+
+    placeholder_keydoc = _mongocrypt_key_new();
+    value = _mongocrypt_cache_key_value_new(placeholder_keydoc, &material);
+
+    alt_names1 = _MONGOCRYPT_KEY_ALT_NAME_CREATE("a", "b");
+    alt_names2 = _MONGOCRYPT_KEY_ALT_NAME_CREATE("c");
+    name = _MONGOCRYPT_KEY_ALT_NAME_CREATE("b");
+
+    attr1 = _mongocrypt_cache_key_attr_new(&id1, alt_names1);
+    attr2 = _mongocrypt_cache_key_attr_new(&id2, alt_names2);
+    by_name = _mongocrypt_cache_key_attr_new(NULL, name);
+
+    _mongocrypt_cache_key_init(&cache);
+    _mongocrypt_cache_set_max_entries(&cache, 1);
+    ASSERT_OR_PRINT(_mongocrypt_cache_add_copy(&cache, attr1, value, status), status);
+    BSON_ASSERT(_mongocrypt_cache_get(&cache, by_name, (void **)&tmp));
+    BSON_ASSERT(tmp);
+    _mongocrypt_cache_key_value_destroy(tmp);
+
+    /* Adding the second key evicts the first. */
+    ASSERT_OR_PRINT(_mongocrypt_cache_add_copy(&cache, attr2, value, status), status);
+    BSON_ASSERT(_mongocrypt_cache_num_entries(&cache) == 1);
+    BSON_ASSERT(_mongocrypt_cache_get(&cache, by_name, (void **)&tmp));
+    BSON_ASSERT(!tmp);
+
+    /* And the first may be added again. */
+    ASSERT_OR_PRINT(_mongocrypt_cache_add_copy(&cache, attr1, value, status), status);
+    BSON_ASSERT(_mongocrypt_cache_get(&cache, by_name, (void **)&tmp));
+    BSON_ASSERT(tmp);
+    _mongocrypt_cache_key_value_destroy(tmp);
+
+    _mongocrypt_cache_cleanup(&cache);
+    _mongocrypt_cache_key_attr_destroy(attr1);
+    _mongocrypt_cache_key_attr_destroy(attr2);
+    _mongocrypt_cache_key_attr_destroy(by_name);
+    _mongocrypt_key_alt_name_destroy_all(alt_names1);
+    _mongocrypt_key_alt_name_destroy_all(alt_names2);
+    _mongocrypt_key_alt_name_destroy_all(name);
+    _mongocrypt_cache_key_value_destroy(value);
+    _mongocrypt_key_destroy(placeholder_keydoc);
+    _mongocrypt_buffer_cleanup(&material);
+    _mongocrypt_buffer_cleanup(&id1);
+    _mongocrypt_buffer_cleanup(&id2);
+    mongocrypt_status_destroy(status);
+}
+
+/* Key cache hits share the cached value instead of copying it. */
+static void _test_cache_key_shared_value(_mongocrypt_tester_t *tester) {
+    _mongocrypt_cache_t cache;
+    mongocrypt_status_t *status;
+    _mongocrypt_key_doc_t *placeholder_keydoc;
+    _mongocrypt_cache_key_value_t *value, *hit1, *hit2;
+    _mongocrypt_cache_key_attr_t *attr;
+    _mongocrypt_buffer_t id, material;
+
+    status = mongocrypt_status_new();
+
+    _mongocrypt_buffer_copy_from_hex(&id, "ABCDEFAB123498761234123456789012");
+    _mongocrypt_buffer_init(&material);
+    _mongocrypt_buffer_resize(&material, MONGOCRYPT_KEY_LEN);
+    material.data[0] = 1;
+
+    placeholder_keydoc = _mongocrypt_key_new();
+    value = _mongocrypt_cache_key_value_new(placeholder_keydoc, &material);
+    attr = _mongocrypt_cache_key_attr_new(&id, NULL);
+
+    _mongocrypt_cache_key_init(&cache);
+    ASSERT_OR_PRINT(_mongocrypt_cache_add_stolen(&cache, attr, value, status), status);
+
+    BSON_ASSERT(_mongocrypt_cache_get(&cache, attr, (void **)&hit1));
+    BSON_ASSERT(_mongocrypt_cache_get(&cache, attr, (void **)&hit2));
+    BSON_ASSERT(hit1 == value);
+    BSON_ASSERT(hit2 == value);
+
+    /* References outlive the cache entry. */
+    _mongocrypt_cache_cleanup(&cache);
+    BSON_ASSERT(hit1->decrypted_key_material.data[0] == 1);
+    _mongocrypt_cache_key_value_destroy(hit1);
+    BSON_ASSERT(hit2->decrypted_key_material.data[0] == 1);
+    _mongocrypt_cache_key_value_destroy(hit2);
+
+    _mongocrypt_cache_key_attr_destroy(attr);
+    _mongocrypt_key_destroy(placeholder_keydoc);
+    _mongocrypt_buffer_cleanup(&material);
+    _mongocrypt_buffer_cleanup(&id);
+    mongocrypt_status_destroy(status);
+}
+
+static void _test_cache_refresh_ahead(_mongocrypt_tester_t *tester) {
+    _mongocrypt_cache_t cache;
+    mongocrypt_status_t *status;
+    bson_t *entry = BCON_NEW("a", "b");
+    bson_t *tmp = NULL;
+    bool needs_refresh;
+
+    status = mongocrypt_status_new();
+
+    _bson_cache_init(&cache);
+    _mongocrypt_cache_set_expiration(&cache, 1000);
+    _mongocrypt_cache_set_refresh_ahead(&cache, 0.05);
+    ASSERT_OR_PRINT(_mongocrypt_cache_add_copy(&cache, "1", entry, status), status);
+
+    /* A fresh entry does not need a refresh. */
+    BSON_ASSERT(_mongocrypt_cache_get_or_refresh(&cache, "1", (void **)&tmp, &needs_refresh));
+    BSON_ASSERT(tmp);
+    BSON_ASSERT(!needs_refresh);
+    bson_destroy(tmp);
+
+    _usleep(1000 * 100);
+
+    /* Only the first caller past the refresh point is asked to refresh. */
+    BSON_ASSERT(_mongocrypt_cache_get_or_refresh(&cache, "1", (void **)&tmp, &needs_refresh));
+    BSON_ASSERT(tmp);
+    BSON_ASSERT(needs_refresh);
+    bson_destroy(tmp);
+    BSON_ASSERT(_mongocrypt_cache_get_or_refresh(&cache, "1", (void **)&tmp, &needs_refresh));
+    BSON_ASSERT(tmp);
+    BSON_ASSERT(!needs_refresh);
+    bson_destroy(tmp);
+
+    /* Replacing the entry resets it. */
+    ASSERT_OR_PRINT(_mongocrypt_cache_add_copy(&cache, "1", entry, status), status);
+    BSON_ASSERT(_mongocrypt_cache_get_or_refresh(&cache, "1", (void **)&tmp, &needs_refresh));
+    BSON_ASSERT(tmp);
+    BSON_ASSERT(!needs_refresh);
+    bson_destroy(tmp);
+
+    _mongocrypt_cache_cleanup(&cache);
+    mongocrypt_status_destroy(status);
+    bson_destroy(entry);
+}
+
+static void _test_setopt_key_cache_refresh_ahead(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+
+    crypt = mongocrypt_new();
+    ASSERT_FAILS(mongocrypt_setopt_key_cache_refresh_ahead(crypt, 0), crypt, "must be greater than 0");
+    mongocrypt_destroy(crypt);
+
+    crypt = mongocrypt_new();
+    ASSERT_FAILS(mongocrypt_setopt_key_cache_refresh_ahead(crypt, 1), crypt, "less than 1");
+    mongocrypt_destroy(crypt);
+
+    crypt = mongocrypt_new();
+    ASSERT_OK(mongocrypt_setopt_key_cache_refresh_ahead(crypt, 0.8), crypt);
+    ASSERT_OK(mongocrypt_setopt_kms_provider_aws(crypt, "example", -1, "example", -1), crypt);
+    ASSERT_OK(mongocrypt_init(crypt), crypt);
+    BSON_ASSERT(crypt->cache_key.refresh_ahead == 0.8);
+    mongocrypt_destroy(crypt);
+}
+
+static void _test_setopt_key_expiration(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+
+    crypt = mongocrypt_new();
+    ASSERT_FAILS(mongocrypt_setopt_key_expiration(crypt, UINT64_MAX), crypt, "expiration time must be less than");
+    mongocrypt_destroy(crypt);
+
+    crypt = mongocrypt_new();
+    ASSERT_FAILS(mongocrypt_setopt_key_expiration_by_kms_provider(crypt, TEST_BSON("{'local': -1}")),
+                 crypt,
+                 "expected non-negative integer expiration");
+    mongocrypt_destroy(crypt);
+
+    crypt = mongocrypt_new();
+    ASSERT_FAILS(mongocrypt_setopt_key_expiration_by_kms_provider(crypt, TEST_BSON("{'local': 'soon'}")),
+                 crypt,
+                 "expected non-negative integer expiration");
+    mongocrypt_destroy(crypt);
+
+    crypt = mongocrypt_new();
+    ASSERT_OK(mongocrypt_setopt_key_expiration(crypt, 10 * 60 * 1000), crypt);
+    ASSERT_OK(mongocrypt_setopt_key_expiration_by_kms_provider(crypt, TEST_BSON("{'aws': 30000, 'kmip:name': 0}")),
+              crypt);
+    ASSERT_OK(mongocrypt_setopt_kms_provider_aws(crypt, "example", -1, "example", -1), crypt);
+    ASSERT_OK(mongocrypt_init(crypt), crypt);
+    ASSERT_CMPUINT64(crypt->cache_key.expiration, ==, 10 * 60 * 1000);
+    mongocrypt_destroy(crypt);
+
+    /* 0 means keys never expire. */
+    crypt = mongocrypt_new();
+    ASSERT_OK(mongocrypt_setopt_key_expiration(crypt, 0), crypt);
+    ASSERT_OK(mongocrypt_setopt_kms_provider_aws(crypt, "example", -1, "example", -1), crypt);
+    ASSERT_OK(mongocrypt_init(crypt), crypt);
+    ASSERT_CMPUINT64(crypt->cache_key.expiration, ==, INT64_MAX);
+    mongocrypt_destroy(crypt);
+}
+
+static void _test_cache_max_entries(_mongocrypt_tester_t *tester) {
+    _mongocrypt_cache_t cache;
+    _mongocrypt_cache_stats_t stats;
+    mongocrypt_status_t *status;
+    bson_t *entry = BCON_NEW("a", "b");
+    bson_t *tmp = NULL;
+
+    status = mongocrypt_status_new();
+
+    _bson_cache_init(&cache);
+    _mongocrypt_cache_set_max_entries(&cache, 3);
+    ASSERT_OR_PRINT(_mongocrypt_cache_add_copy(&cache, "a", entry, status), status);
+    ASSERT_OR_PRINT(_mongocrypt_cache_add_copy(&cache, "b", entry, status), status);
+    ASSERT_OR_PRINT(_mongocrypt_cache_add_copy(&cache, "c", entry, status), status);
+
+    /* Using "a" protects it from the next eviction. */
+    BSON_ASSERT(_mongocrypt_cache_get(&cache, "a", (void **)&tmp));
+    BSON_ASSERT(tmp);
+    bson_destroy(tmp);
+
+    ASSERT_OR_PRINT(_mongocrypt_cache_add_copy(&cache, "d", entry, status), status);
+    BSON_ASSERT(_mongocrypt_cache_num_entries(&cache) == 3);
+    BSON_ASSERT(_mongocrypt_cache_get(&cache, "b", (void **)&tmp));
+    BSON_ASSERT(!tmp);
+    BSON_ASSERT(_mongocrypt_cache_get(&cache, "a", (void **)&tmp));
+    BSON_ASSERT(tmp);
+    bson_destroy(tmp);
+
+    /* Many more entries than the bound. */
+    for (int i = 0; i < 100; i++) {
+        char ns[32];
+
+        bson_snprintf(ns, sizeof(ns), "db.coll%d", i);
+        ASSERT_OR_PRINT(_mongocrypt_cache_add_copy(&cache, ns, entry, status), status);
+        BSON_ASSERT(_mongocrypt_cache_num_entries(&cache) <= 3);
+    }
+    BSON_ASSERT(_mongocrypt_cache_get(&cache, "db.coll99", (void **)&tmp));
+    BSON_ASSERT(tmp);
+    bson_destroy(tmp);
+
+    _mongocrypt_cache_stats(&cache, &stats);
+    ASSERT_CMPINT64(stats.evictions, ==, 101);
+
+    _mongocrypt_cache_cleanup(&cache);
+    mongocrypt_status_destroy(status);
+    bson_destroy(entry);
+}
+
+static void _test_setopt_cache_max_entries(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    _mongocrypt_key_doc_t *key_doc;
+    _mongocrypt_buffer_t material;
+    bson_t *entry = BCON_NEW("name", "a");
+
+    crypt = mongocrypt_new();
+    ASSERT_OK(mongocrypt_setopt_key_cache_max_entries(crypt, 2), crypt);
+    ASSERT_OK(mongocrypt_setopt_collinfo_cache_max_entries(crypt, 3), crypt);
+    ASSERT_OK(mongocrypt_setopt_kms_provider_aws(crypt, "example", -1, "example", -1), crypt);
+    ASSERT_OK(mongocrypt_init(crypt), crypt);
+    ASSERT_FAILS(mongocrypt_setopt_key_cache_max_entries(crypt, 1), crypt, "cannot be set after initialization");
+
+    /* The bounds hold for many more entries. */
+    key_doc = _mongocrypt_key_new();
+    _mongocrypt_tester_fill_buffer(&material, MONGOCRYPT_KEY_LEN);
+    for (int i = 0; i < 10; i++) {
+        _mongocrypt_cache_collinfo_value_t *value;
+        _mongocrypt_cache_key_value_t *key_value;
+        _mongocrypt_cache_key_attr_t *key_attr;
+        _mongocrypt_buffer_t id;
+        char ns[32];
+
+        bson_snprintf(ns, sizeof(ns), "db.coll%d", i);
+        value = _mongocrypt_cache_collinfo_value_new(entry, crypt->status);
+        ASSERT_OK_STATUS(value, crypt->status);
+        ASSERT_OK_STATUS(_mongocrypt_cache_add_copy(&crypt->cache_collinfo, ns, value, crypt->status),
+                         crypt->status);
+        _mongocrypt_cache_collinfo_value_destroy(value);
+
+        _mongocrypt_buffer_init(&id);
+        _mongocrypt_buffer_resize(&id, 16);
+        memset(id.data, i, id.len);
+        id.subtype = BSON_SUBTYPE_UUID;
+        key_value = _mongocrypt_cache_key_value_new(key_doc, &material);
+        key_attr = _mongocrypt_cache_key_attr_new(&id, NULL);
+        ASSERT_OK_STATUS(_mongocrypt_cache_add_stolen(&crypt->cache_key, key_attr, key_value, crypt->status),
+                         crypt->status);
+        _mongocrypt_buffer_cleanup(&id);
+
+        ASSERT_CMPUINT32(_mongocrypt_cache_num_entries(&crypt->cache_collinfo), <=, 3);
+        ASSERT_CMPUINT32(_mongocrypt_cache_num_entries(&crypt->cache_key), <=, 2);
+    }
+    ASSERT_CMPUINT32(_mongocrypt_cache_num_entries(&crypt->cache_collinfo), ==, 3);
+    ASSERT_CMPUINT32(_mongocrypt_cache_num_entries(&crypt->cache_key), ==, 2);
+
+    _mongocrypt_key_destroy(key_doc);
+    _mongocrypt_buffer_cleanup(&material);
+    mongocrypt_destroy(crypt);
+    bson_destroy(entry);
+}
+
+static void _test_key_cache_snapshot(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt, *restarted;
+    _mongocrypt_key_doc_t *key_doc;
+    _mongocrypt_cache_key_value_t *value, *hit;
+    _mongocrypt_cache_key_attr_t *attr;
+    _mongocrypt_buffer_t material, kek_buf, wrong_kek_buf;
+    mongocrypt_binary_t *kek, *short_kek, *wrong_kek, *snapshot;
+    bson_t key_bson;
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+
+    key_doc = _mongocrypt_key_new();
+    ASSERT(_mongocrypt_binary_to_bson(TEST_FILE("./test/data/key-document-local.json"), &key_bson));
+    ASSERT_OK_STATUS(_mongocrypt_key_parse_owned(&key_bson, key_doc, crypt->status), crypt->status);
+    _mongocrypt_tester_fill_buffer(&material, MONGOCRYPT_KEY_LEN);
+    value = _mongocrypt_cache_key_value_new(key_doc, &material);
+    /* Cache entries do not keep the original BSON of the key document. */
+    ASSERT(bson_empty(&value->key_doc->bson));
+    attr = _mongocrypt_cache_key_attr_new(&key_doc->id, NULL);
+    ASSERT_OK_STATUS(_mongocrypt_cache_add_stolen(&crypt->cache_key, attr, value, crypt->status), crypt->status);
+
+    _mongocrypt_tester_fill_buffer(&kek_buf, MONGOCRYPT_KEY_LEN);
+    kek = _mongocrypt_buffer_as_binary(&kek_buf);
+    snapshot = mongocrypt_binary_new();
+
+    ASSERT_OK(mongocrypt_export_key_cache(crypt, kek, snapshot), crypt);
+
+    /* A new mongocrypt_t starts with the key cached. */
+    restarted = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    ASSERT_OK(mongocrypt_import_key_cache(restarted, kek, snapshot), restarted);
+    BSON_ASSERT(_mongocrypt_cache_get(&restarted->cache_key, attr, (void **)&hit));
+    BSON_ASSERT(hit);
+    ASSERT_CMPBUF(hit->decrypted_key_material, material);
+    ASSERT_CMPBUF(hit->key_doc->id, key_doc->id);
+    ASSERT_CMPBUF(hit->key_doc->key_material, key_doc->key_material);
+    ASSERT_CMPINT(hit->key_doc->kek.kms_provider, ==, key_doc->kek.kms_provider);
+    ASSERT_CMPINT64(hit->key_doc->creation_date, ==, key_doc->creation_date);
+    _mongocrypt_cache_key_value_destroy(hit);
+    mongocrypt_destroy(restarted);
+
+    /* Importing with a different key fails. */
+    _mongocrypt_buffer_copy_to(&kek_buf, &wrong_kek_buf);
+    wrong_kek_buf.data[0] ^= 1;
+    wrong_kek = _mongocrypt_buffer_as_binary(&wrong_kek_buf);
+    restarted = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    ASSERT_FAILS(mongocrypt_import_key_cache(restarted, wrong_kek, snapshot), restarted, "HMAC validation failure");
+    mongocrypt_destroy(restarted);
+
+    /* Expired keys are not imported. */
+    restarted = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    _mongocrypt_cache_set_expiration(&restarted->cache_key, 0);
+    ASSERT_OK(mongocrypt_import_key_cache(restarted, kek, snapshot), restarted);
+    BSON_ASSERT(_mongocrypt_cache_num_entries(&restarted->cache_key) == 0);
+    mongocrypt_destroy(restarted);
+
+    short_kek = mongocrypt_binary_new_from_data(kek_buf.data, 16);
+    ASSERT_FAILS(mongocrypt_export_key_cache(crypt, short_kek, snapshot), crypt, "must be 96 bytes");
+    mongocrypt_binary_destroy(short_kek);
+
+    mongocrypt_binary_destroy(wrong_kek);
+    mongocrypt_binary_destroy(snapshot);
+    mongocrypt_binary_destroy(kek);
+    _mongocrypt_buffer_cleanup(&wrong_kek_buf);
+    _mongocrypt_buffer_cleanup(&kek_buf);
+    _mongocrypt_cache_key_attr_destroy(attr);
+    _mongocrypt_buffer_cleanup(&material);
+    _mongocrypt_key_destroy(key_doc);
+    mongocrypt_destroy(crypt);
+}
+
+static void _test_cache_entry_expiration(_mongocrypt_tester_t *tester) {
+    _mongocrypt_cache_t cache;
+    mongocrypt_status_t *status;
+    bson_t *entry = BCON_NEW("a", "b");
+    bson_t *tmp = NULL;
+
+    status = mongocrypt_status_new();
+
+    _bson_cache_init(&cache);
+    ASSERT_OR_PRINT(_mongocrypt_cache_add_copy_with_expiration(&cache, "long", entry, 60 * 60 * 1000, status), status);
+    ASSERT_OR_PRINT(_mongocrypt_cache_add_copy(&cache, "default", entry, status), status);
+    ASSERT_OR_PRINT(_mongocrypt_cache_add_copy_with_expiration(&cache, "short", entry, 1, status), status);
+
+    /* Shortening the cache expiration applies to entries without their own. */
+    _mongocrypt_cache_set_expiration(&cache, 1);
+    _usleep(1000 * 10);
+    BSON_ASSERT(_mongocrypt_cache_get(&cache, "short", (void **)&tmp));
+    BSON_ASSERT(!tmp);
+    BSON_ASSERT(_mongocrypt_cache_get(&cache, "default", (void **)&tmp));
+    BSON_ASSERT(!tmp);
+    BSON_ASSERT(_mongocrypt_cache_get(&cache, "long", (void **)&tmp));
+    BSON_ASSERT(tmp);
+    bson_destroy(tmp);
+    BSON_ASSERT(_mongocrypt_cache_num_entries(&cache) == 1);
+
+    _mongocrypt_cache_cleanup(&cache);
+    mongocrypt_status_destroy(status);
+    bson_destroy(entry);
+}
+
+static void _test_unencrypted_collinfo_expiration(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+
+    crypt = mongocrypt_new();
+    ASSERT_FAILS(mongocrypt_setopt_unencrypted_collinfo_expiration_ms(crypt, 0), crypt, "must be greater than 0");
+    mongocrypt_destroy(crypt);
+
+    crypt = mongocrypt_new();
+    ASSERT_OK(mongocrypt_setopt_kms_provider_aws(crypt, "example", -1, "example", -1), crypt);
+    ASSERT_OK(mongocrypt_setopt_unencrypted_collinfo_expiration_ms(crypt, 60 * 60 * 1000), crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+    _mongocrypt_cache_set_expiration(&crypt->cache_collinfo, 1);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "test", -1, TEST_FILE("./test/example/cmd.json")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_COLLINFO);
+    ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx, TEST_FILE("./test/data/collection-info-no-validator.json")), ctx);
+    ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+    mongocrypt_ctx_destroy(ctx);
+
+    /* The unencrypted collinfo outlives the collinfo cache expiration. */
+    _usleep(1000 * 10);
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "test", -1, TEST_FILE("./test/example/cmd.json")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_MARKINGS);
+    mongocrypt_ctx_destroy(ctx);
+
+    /* Collinfo with a schema uses the collinfo cache expiration. */
+    _mongocrypt_cache_cleanup(&crypt->cache_collinfo);
+    _mongocrypt_cache_collinfo_init(&crypt->cache_collinfo);
+    _mongocrypt_cache_set_expiration(&crypt->cache_collinfo, 1);
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "test", -1, TEST_FILE("./test/example/cmd.json")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_COLLINFO);
+    ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx, TEST_FILE("./test/example/collection-info.json")), ctx);
+    ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+    mongocrypt_ctx_destroy(ctx);
+
+    _usleep(1000 * 10);
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "test", -1, TEST_FILE("./test/example/cmd.json")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_COLLINFO);
+    mongocrypt_ctx_destroy(ctx);
+
+    mongocrypt_destroy(crypt);
+}
+
+static int64_t _stats_get(const bson_t *bson, const char *path) {
+    bson_iter_t iter;
+
+    ASSERT(bson_iter_init(&iter, bson));
+    ASSERT(bson_iter_find_descendant(&iter, path, &iter));
+    ASSERT(BSON_ITER_HOLDS_INT64(&iter));
+    return bson_iter_int64(&iter);
+}
+
+static void _test_cache_stats(_mongocrypt_tester_t *tester) {
+    _mongocrypt_cache_t cache;
+    _mongocrypt_cache_stats_t stats;
+    mongocrypt_status_t *status;
+    bson_t *entry = BCON_NEW("a", "b");
+    bson_t *tmp = NULL;
+
+    status = mongocrypt_status_new();
+
+    _bson_cache_init(&cache);
+    ASSERT_OR_PRINT(_mongocrypt_cache_add_copy(&cache, "db.a", entry, status), status);
+    ASSERT_OR_PRINT(_mongocrypt_cache_add_copy(&cache, "db.a", entry, status), status);
+    ASSERT_OR_PRINT(_mongocrypt_cache_add_copy(&cache, "db.b", entry, status), status);
+
+    BSON_ASSERT(_mongocrypt_cache_get(&cache, "db.a", (void **)&tmp));
+    BSON_ASSERT(tmp);
+    bson_destroy(tmp);
+    BSON_ASSERT(_mongocrypt_cache_get(&cache, "db.c", (void **)&tmp));
+    BSON_ASSERT(!tmp);
+
+    _mongocrypt_cache_stats(&cache, &stats);
+    ASSERT_CMPINT64(stats.hits, ==, 1);
+    ASSERT_CMPINT64(stats.misses, ==, 1);
+    ASSERT_CMPINT64(stats.insertions, ==, 3);
+    ASSERT_CMPINT64(stats.evictions, ==, 0);
+    ASSERT_CMPINT64(stats.entries, ==, 2);
+
+    /* Expired entries are evicted and no longer reported. */
+    _mongocrypt_cache_set_expiration(&cache, 1);
+    _usleep(1000 * 10);
+    _mongocrypt_cache_stats(&cache, &stats);
+    ASSERT_CMPINT64(stats.evictions, ==, 2);
+    ASSERT_CMPINT64(stats.entries, ==, 0);
+
+    _mongocrypt_cache_cleanup(&cache);
+    mongocrypt_status_destroy(status);
+    bson_destroy(entry);
+}
+
+static void _test_cache_stats_public(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_binary_t *bin;
+    bson_t *entry = BCON_NEW("name", "a");
+    _mongocrypt_cache_collinfo_value_t *value, *tmp = NULL;
+    bson_t stats;
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    value = _mongocrypt_cache_collinfo_value_new(entry, crypt->status);
+    ASSERT_OK_STATUS(value, crypt->status);
+    ASSERT_OK_STATUS(_mongocrypt_cache_add_copy(&crypt->cache_collinfo, "db.a", value, crypt->status), crypt->status);
+    BSON_ASSERT(_mongocrypt_cache_get(&crypt->cache_collinfo, "db.a", (void **)&tmp));
+    _mongocrypt_cache_collinfo_value_destroy(tmp);
+    _mongocrypt_cache_collinfo_value_destroy(value);
+
+    bin = mongocrypt_binary_new();
+    ASSERT_OK(mongocrypt_get_cache_stats(crypt, bin), crypt);
+    ASSERT(_mongocrypt_binary_to_bson(bin, &stats));
+    ASSERT_CMPINT64(_stats_get(&stats, "collinfo.hits"), ==, 1);
+    ASSERT_CMPINT64(_stats_get(&stats, "collinfo.insertions"), ==, 1);
+    ASSERT_CMPINT64(_stats_get(&stats, "collinfo.entries"), ==, 1);
+    ASSERT_CMPINT64(_stats_get(&stats, "key.entries"), ==, 0);
+    ASSERT_CMPINT64(_stats_get(&stats, "oauth.misses"), ==, 0);
+
+    mongocrypt_binary_destroy(bin);
+    mongocrypt_destroy(crypt);
+    bson_destroy(entry);
+}
+
+static void _test_memory_usage(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *bin;
+    bson_t *entry = BCON_NEW("name", "a");
+    _mongocrypt_cache_collinfo_value_t *value;
+    bson_t usage;
+    int64_t collinfo_bytes;
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    bin = mongocrypt_binary_new();
+
+    ASSERT_OK(mongocrypt_get_memory_usage(crypt, bin), crypt);
+    ASSERT(_mongocrypt_binary_to_bson(bin, &usage));
+    collinfo_bytes = _stats_get(&usage, "caches.collinfo");
+    ASSERT_CMPINT64(_stats_get(&usage, "caches.key"), ==, 0);
+    ASSERT_CMPINT64(_stats_get(&usage, "contexts.count"), ==, 0);
+    ASSERT_CMPINT64(_stats_get(&usage, "contexts.bytes"), ==, 0);
+
+    /* A cached entry and an outstanding context are reported. */
+    value = _mongocrypt_cache_collinfo_value_new(entry, crypt->status);
+    ASSERT_OK_STATUS(value, crypt->status);
+    ASSERT_OK_STATUS(_mongocrypt_cache_add_copy(&crypt->cache_collinfo, "db.a", value, crypt->status), crypt->status);
+    _mongocrypt_cache_collinfo_value_destroy(value);
+    ctx = mongocrypt_ctx_new(crypt);
+
+    ASSERT_OK(mongocrypt_get_memory_usage(crypt, bin), crypt);
+    ASSERT(_mongocrypt_binary_to_bson(bin, &usage));
+    ASSERT_CMPINT64(_stats_get(&usage, "caches.collinfo"), >, collinfo_bytes + (int64_t)entry->len);
+    ASSERT_CMPINT64(_stats_get(&usage, "contexts.count"), ==, 1);
+    ASSERT_CMPINT64(_stats_get(&usage, "contexts.bytes"), >, 0);
+
+    mongocrypt_ctx_destroy(ctx);
+    ASSERT_OK(mongocrypt_get_memory_usage(crypt, bin), crypt);
+    ASSERT(_mongocrypt_binary_to_bson(bin, &usage));
+    ASSERT_CMPINT64(_stats_get(&usage, "contexts.count"), ==, 0);
+    ASSERT_CMPINT64(_stats_get(&usage, "contexts.bytes"), ==, 0);
+
+    mongocrypt_binary_destroy(bin);
+    mongocrypt_destroy(crypt);
+    bson_destroy(entry);
+}
+
+static void _test_fork_keeps_caches(_mongocrypt_tester_t *tester) {
+#ifdef _WIN32
+    printf("Windows has no fork. Skipping.");
+#else
+    mongocrypt_t *crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    bson_t *entry = BCON_NEW("name", "a");
+    _mongocrypt_cache_collinfo_value_t *value;
+    _mongocrypt_key_doc_t *key_doc;
+    _mongocrypt_cache_key_value_t *key_value;
+    _mongocrypt_cache_key_attr_t *key_attr;
+    _mongocrypt_buffer_t id, material, random, child_random;
+    int fds[2];
+    int child_status;
+
+    value = _mongocrypt_cache_collinfo_value_new(entry, crypt->status);
+    ASSERT_OK_STATUS(value, crypt->status);
+    ASSERT_OK_STATUS(_mongocrypt_cache_add_copy(&crypt->cache_collinfo, "db.a", value, crypt->status), crypt->status);
+    _mongocrypt_cache_collinfo_value_destroy(value);
+
+    _mongocrypt_buffer_copy_from_hex(&id, "ABCDEFAB123498761234123456789012");
+    _mongocrypt_buffer_init(&material);
+    _mongocrypt_buffer_resize(&material, MONGOCRYPT_KEY_LEN);
+    material.data[0] = 1;
+    key_doc = _mongocrypt_key_new();
+    key_value = _mongocrypt_cache_key_value_new(key_doc, &material);
+    key_attr = _mongocrypt_cache_key_attr_new(&id, NULL);
+    ASSERT_OK_STATUS(_mongocrypt_cache_add_copy(&crypt->cache_key, key_attr, key_value, crypt->status),
+                     crypt->status);
+
+    /* Fill the random pool, so the child would reuse it. */
+    ASSERT(crypt->crypto->random_pool);
+    _mongocrypt_buffer_init(&random);
+    _mongocrypt_buffer_resize(&random, 16);
+    ASSERT_OK_STATUS(_mongocrypt_random(crypt->crypto, &random, 16, crypt->status), crypt->status);
+
+    ASSERT(0 == pipe(fds));
+    /* Fork while holding locks, as another thread of the parent might. */
+    _mongocrypt_mutex_lock(&crypt->mutex);
+    _mongocrypt_rwlock_write_lock(&crypt->cache_collinfo.lock);
+    _mongocrypt_rwlock_write_lock(&crypt->cache_key.lock);
+    pid_t pid = fork();
+    ASSERT(pid >= 0);
+    if (pid == 0) {
+        /* The child can take the locks, and finds the cached entries. */
+        void *got = NULL;
+        _mongocrypt_cache_key_value_t *got_key = NULL;
+        bool ok;
+
+        _mongocrypt_mutex_lock(&crypt->mutex);
+        _mongocrypt_mutex_unlock(&crypt->mutex);
+        ok = _mongocrypt_cache_get(&crypt->cache_collinfo, "db.a", &got) && got;
+        _mongocrypt_cache_collinfo_value_destroy(got);
+        ok = ok && _mongocrypt_cache_get(&crypt->cache_key, key_attr, (void **)&got_key) && got_key
+          && got_key->decrypted_key_material.data[0] == 1;
+        _mongocrypt_cache_key_value_destroy(got_key);
+        /* The child draws its own random bytes. */
+        ok = ok && _mongocrypt_random(crypt->crypto, &random, 16, crypt->status)
+          && 16 == write(fds[1], random.data, 16);
+        _exit(ok ? 0 : 1);
+    }
+    _mongocrypt_rwlock_write_unlock(&crypt->cache_key.lock);
+    _mongocrypt_rwlock_write_unlock(&crypt->cache_collinfo.lock);
+    _mongocrypt_mutex_unlock(&crypt->mutex);
+
+    ASSERT(pid == waitpid(pid, &child_status, 0));
+    ASSERT(WIFEXITED(child_status));
+    ASSERT_CMPINT(WEXITSTATUS(child_status), ==, 0);
+
+    /* The parent and the child drew different bytes. */
+    _mongocrypt_buffer_init(&child_random);
+    _mongocrypt_buffer_resize(&child_random, 16);
+    ASSERT(16 == read(fds[0], child_random.data, 16));
+    ASSERT_OK_STATUS(_mongocrypt_random(crypt->crypto, &random, 16, crypt->status), crypt->status);
+    ASSERT(0 != _mongocrypt_buffer_cmp(&random, &child_random));
+    close(fds[0]);
+    close(fds[1]);
+
+    _mongocrypt_buffer_cleanup(&child_random);
+    _mongocrypt_buffer_cleanup(&random);
+    _mongocrypt_cache_key_attr_destroy(key_attr);
+    _mongocrypt_cache_key_value_destroy(key_value);
+    _mongocrypt_key_destroy(key_doc);
+    _mongocrypt_buffer_cleanup(&material);
+    _mongocrypt_buffer_cleanup(&id);
+    mongocrypt_destroy(crypt);
+    bson_destroy(entry);
+#endif
+}
+
+static void _test_cache_collinfo_shared_value(_mongocrypt_tester_t *tester) {
+    _mongocrypt_cache_t cache;
+    mongocrypt_status_t *status;
+    _mongocrypt_cache_collinfo_value_t *value, *hit1 = NULL, *hit2 = NULL;
+    bson_t *collinfo;
+
+    status = mongocrypt_status_new();
+    _mongocrypt_cache_collinfo_init(&cache);
+
+    /* The collection info is parsed once. */
+    collinfo = BCON_NEW("name",
+                        "coll",
+                        "options",
+                        "{",
+                        "validator",
+                        "{",
+                        "$jsonSchema",
+                        "{",
+                        "bsonType",
+                        "object",
+                        "}",
+                        "x",
+                        BCON_INT32(1),
+                        "}",
+                        "}");
+    value = _mongocrypt_cache_collinfo_value_new(collinfo, status);
+    ASSERT_OK_STATUS(value, status);
+    BSON_ASSERT(!_mongocrypt_buffer_empty(&value->schema));
+    BSON_ASSERT(_mongocrypt_buffer_empty(&value->encrypted_fields));
+    BSON_ASSERT(value->has_siblings);
+    ASSERT_OR_PRINT(_mongocrypt_cache_add_copy(&cache, "db.coll", value, status), status);
+    _mongocrypt_cache_collinfo_value_destroy(value);
+    bson_destroy(collinfo);
+
+    /* Hits share the parsed value. */
+    BSON_ASSERT(_mongocrypt_cache_get(&cache, "db.coll", (void **)&hit1));
+    BSON_ASSERT(_mongocrypt_cache_get(&cache, "db.coll", (void **)&hit2));
+    BSON_ASSERT(hit1);
+    BSON_ASSERT(hit1 == hit2);
+    _mongocrypt_cache_collinfo_value_destroy(hit1);
+    _mongocrypt_cache_collinfo_value_destroy(hit2);
+
+    /* Views cannot be parsed. */
+    collinfo = BCON_NEW("name", "view", "type", "view");
+    value = _mongocrypt_cache_collinfo_value_new(collinfo, status);
+    BSON_ASSERT(!value);
+    ASSERT_STATUS_CONTAINS(status, "cannot auto encrypt a view");
+    bson_destroy(collinfo);
+
+    _mongocrypt_cache_cleanup(&cache);
+    mongocrypt_status_destroy(status);
+}
+
+static mongocrypt_t *_cache_domain_mongocrypt(const char *domain, const char *aws_secret) {
+    mongocrypt_t *crypt = mongocrypt_new();
+
+    ASSERT_OK(mongocrypt_setopt_kms_provider_aws(crypt, "example", -1, aws_secret, -1), crypt);
+    ASSERT_OK(mongocrypt_setopt_cache_domain(crypt, domain, -1), crypt);
+    return crypt;
+}
+
+static void _test_cache_domain(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt1, *crypt2, *other_kms, *other_domain;
+    _mongocrypt_key_doc_t *key_doc;
+    _mongocrypt_cache_key_value_t *value, *hit;
+    _mongocrypt_cache_key_attr_t *attr;
+    _mongocrypt_buffer_t material;
+    bson_t key_bson;
+
+    crypt1 = mongocrypt_new();
+    ASSERT_FAILS(mongocrypt_setopt_cache_domain(crypt1, "", -1), crypt1, "invalid cache domain name");
+    mongocrypt_destroy(crypt1);
+
+    crypt1 = _cache_domain_mongocrypt("test-domain", "example");
+    ASSERT_OK(mongocrypt_init(crypt1), crypt1);
+    crypt2 = _cache_domain_mongocrypt("test-domain", "example");
+    ASSERT_OK(mongocrypt_init(crypt2), crypt2);
+    BSON_ASSERT(_mongocrypt_key_cache(crypt1) == _mongocrypt_key_cache(crypt2));
+
+    /* A key cached by one handle is a hit for the other. */
+    key_doc = _mongocrypt_key_new();
+    ASSERT(_mongocrypt_binary_to_bson(TEST_FILE("./test/data/key-document-local.json"), &key_bson));
+    ASSERT_OK_STATUS(_mongocrypt_key_parse_owned(&key_bson, key_doc, crypt1->status), crypt1->status);
+    _mongocrypt_tester_fill_buffer(&material, MONGOCRYPT_KEY_LEN);
+    value = _mongocrypt_cache_key_value_new(key_doc, &material);
+    attr = _mongocrypt_cache_key_attr_new(&key_doc->id, NULL);
+    ASSERT_OK_STATUS(_mongocrypt_cache_add_stolen(_mongocrypt_key_cache(crypt1), attr, value, crypt1->status),
+                     crypt1->status);
+    BSON_ASSERT(_mongocrypt_cache_get(_mongocrypt_key_cache(crypt2), attr, (void **)&hit));
+    BSON_ASSERT(hit);
+    ASSERT_CMPBUF(hit->decrypted_key_material, material);
+    _mongocrypt_cache_key_value_destroy(hit);
+
+    /* Handles with other KMS providers may not join. */
+    other_kms = _cache_domain_mongocrypt("test-domain", "other");
+    ASSERT_FAILS(mongocrypt_init(other_kms), other_kms, "in use with different KMS providers");
+    mongocrypt_destroy(other_kms);
+
+    other_domain = _cache_domain_mongocrypt("other-domain", "other");
+    ASSERT_OK(mongocrypt_init(other_domain), other_domain);
+    BSON_ASSERT(_mongocrypt_key_cache(other_domain) != _mongocrypt_key_cache(crypt1));
+    mongocrypt_destroy(other_domain);
+
+    /* The domain outlives the handle that created it. */
+    mongocrypt_destroy(crypt1);
+    BSON_ASSERT(_mongocrypt_cache_get(_mongocrypt_key_cache(crypt2), attr, (void **)&hit));
+    BSON_ASSERT(hit);
+    _mongocrypt_cache_key_value_destroy(hit);
+    mongocrypt_destroy(crypt2);
+
+    /* A new domain of the same name starts empty. */
+    crypt1 = _cache_domain_mongocrypt("test-domain", "other");
+    ASSERT_OK(mongocrypt_init(crypt1), crypt1);
+    BSON_ASSERT(_mongocrypt_cache_num_entries(_mongocrypt_key_cache(crypt1)) == 0);
+    mongocrypt_destroy(crypt1);
+
+    _mongocrypt_cache_key_attr_destroy(attr);
+    _mongocrypt_buffer_cleanup(&material);
+    _mongocrypt_key_destroy(key_doc);
+}
+
+static void _test_key_cache_thread_local(_mongocrypt_tester_t *tester) {
+    _mongocrypt_cache_t cache, other_cache;
+    _mongocrypt_key_doc_t *key_doc;
+    _mongocrypt_cache_key_value_t *value, *hit;
+    _mongocrypt_cache_key_attr_t *attr, *other_attr;
+    _mongocrypt_buffer_t material, other_id;
+    uint32_t hash;
+    mongocrypt_status_t *status;
+    int64_t generation, valid_until_ms;
+    bson_t key_bson;
+
+    status = mongocrypt_status_new();
+    _mongocrypt_cache_key_init(&cache);
+    key_doc = _mongocrypt_key_new();
+    ASSERT(_mongocrypt_binary_to_bson(TEST_FILE("./test/data/key-document-local.json"), &key_bson));
+    ASSERT_OK_STATUS(_mongocrypt_key_parse_owned(&key_bson, key_doc, status), status);
+    _mongocrypt_tester_fill_buffer(&material, MONGOCRYPT_KEY_LEN);
+    attr = _mongocrypt_cache_key_attr_new(&key_doc->id, NULL);
+    value = _mongocrypt_cache_key_value_new(key_doc, &material);
+    ASSERT_OK_STATUS(_mongocrypt_cache_add_stolen(&cache, attr, value, status), status);
+    ASSERT(!_mongocrypt_cache_key_l1_get(&cache, &key_doc->id));
+
+    /* A value put in the thread-local cache hits without a shared lookup. */
+    ASSERT(_mongocrypt_cache_get_with_validity(&cache, attr, (void **)&hit, NULL, &generation, &valid_until_ms));
+    ASSERT(hit == value);
+    ASSERT_CMPINT64(valid_until_ms, >, bson_get_monotonic_time() / 1000);
+    _mongocrypt_cache_key_l1_put(&cache, &key_doc->id, hit, generation, valid_until_ms);
+    _mongocrypt_cache_key_value_destroy(hit);
+    hit = _mongocrypt_cache_key_l1_get(&cache, &key_doc->id);
+    ASSERT(hit == value);
+    _mongocrypt_cache_key_value_destroy(hit);
+    ASSERT_CMPINT64(cache.hits, ==, 1);
+
+    /* Removing a key with another generation keeps the entry. */
+    hash = mc_hash_bytes(key_doc->id.data, key_doc->id.len);
+    _mongocrypt_buffer_copy_to(&key_doc->id, &other_id);
+    do {
+        other_id.data[0]++;
+    } while (mc_hash_bytes(other_id.data, other_id.len) % CACHE_GENERATIONS == hash % CACHE_GENERATIONS);
+    other_attr = _mongocrypt_cache_key_attr_new(&other_id, NULL);
+    ASSERT_OK_STATUS(_mongocrypt_cache_add_copy(&cache, other_attr, value, status), status);
+    ASSERT_OK_STATUS(_mongocrypt_cache_remove(&cache, other_attr, status), status);
+    hit = _mongocrypt_cache_key_l1_get(&cache, &key_doc->id);
+    ASSERT(hit == value);
+    _mongocrypt_cache_key_value_destroy(hit);
+
+    /* Removing the pair of the key from the shared cache invalidates the entry. */
+    ASSERT_OK_STATUS(_mongocrypt_cache_remove(&cache, attr, status), status);
+    ASSERT(!_mongocrypt_cache_key_l1_get(&cache, &key_doc->id));
+
+    /* Clearing releases the entries of the calling thread. */
+    value = _mongocrypt_cache_key_value_new(key_doc, &material);
+    ASSERT_OK_STATUS(_mongocrypt_cache_add_stolen(&cache, attr, value, status), status);
+    ASSERT(_mongocrypt_cache_get_with_validity(&cache, attr, (void **)&hit, NULL, &generation, &valid_until_ms));
+    _mongocrypt_cache_key_l1_put(&cache, &key_doc->id, hit, generation, valid_until_ms);
+    _mongocrypt_cache_key_value_destroy(hit);
+    _mongocrypt_cache_key_l1_clear(&cache);
+    ASSERT(!_mongocrypt_cache_key_l1_get(&cache, &key_doc->id));
+
+    /* Entries of a cleaned up cache are released on the next use of the
+     * thread-local cache, as another thread would. */
+    ASSERT(_mongocrypt_cache_get_with_validity(&cache, attr, (void **)&hit, NULL, &generation, &valid_until_ms));
+    _mongocrypt_cache_key_l1_put(&cache, &key_doc->id, hit, generation, valid_until_ms);
+    _mongocrypt_cache_key_value_destroy(hit);
+    value = _mongocrypt_cache_key_value_retain(value);
+    _mongocrypt_cache_cleanup(&cache);
+    ASSERT_CMPINT32(value->refcount, ==, 2);
+    _mongocrypt_cache_key_init(&other_cache);
+    ASSERT(!_mongocrypt_cache_key_l1_get(&other_cache, &key_doc->id));
+    ASSERT_CMPINT32(value->refcount, ==, 1);
+    _mongocrypt_cache_key_value_destroy(value);
+
+    _mongocrypt_cache_cleanup(&other_cache);
+    _mongocrypt_cache_key_attr_destroy(other_attr);
+    _mongocrypt_cache_key_attr_destroy(attr);
+    _mongocrypt_buffer_cleanup(&other_id);
+    _mongocrypt_buffer_cleanup(&material);
+    _mongocrypt_key_destroy(key_doc);
+    mongocrypt_status_destroy(status);
+}
+
+/* Contexts encrypting and decrypting with a key by id find it in the
+ * thread-local cache, without a lookup in the key cache. */
+static void _test_key_cache_thread_local_ctx(_mongocrypt_tester_t *tester) {
+    /* The BSON encoding of the string "abc". */
+    uint8_t string_value[] = {4, 0, 0, 0, 'a', 'b', 'c', 0};
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *key_id, *value, *ciphertext = NULL;
+    mongocrypt_binary_t out;
+    _mongocrypt_cache_t *cache;
+    _mongocrypt_buffer_t key_id_buf;
+    _mongocrypt_cache_key_value_t *hit;
+    int64_t hits;
+    uint8_t type;
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_WITH_KEY_CACHE_THREAD_LOCAL);
+    cache = _mongocrypt_key_cache(crypt);
+    key_id = mongocrypt_binary_new_from_data(MONGOCRYPT_DATA_AND_LEN("aaaaaaaaaaaaaaaa"));
+    _mongocrypt_buffer_from_binary(&key_id_buf, key_id);
+    key_id_buf.subtype = BSON_SUBTYPE_UUID;
+    value = mongocrypt_binary_new_from_data(string_value, sizeof(string_value));
+
+    for (int i = 0; i < 3; i++) {
+        /* The first context fetches the key, the second finds it in the key
+         * cache, and the third in the thread-local cache. */
+        hits = _mongocrypt_atomic_int64_load(&cache->hits);
+        ctx = mongocrypt_ctx_new(crypt);
+        ASSERT_OK(mongocrypt_ctx_setopt_key_id(ctx, key_id), ctx);
+        ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx, MONGOCRYPT_ALGORITHM_RANDOM_STR, -1), ctx);
+        ASSERT_OK(mongocrypt_ctx_explicit_encrypt_value_init(ctx, BSON_TYPE_UTF8, value), ctx);
+        if (i == 0) {
+            _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+        } else {
+            ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+            ASSERT_CMPINT64(_mongocrypt_atomic_int64_load(&cache->hits), ==, i == 1 ? hits + 1 : hits);
+        }
+        ASSERT_OK(mongocrypt_ctx_finalize_value(ctx, &out, &type), ctx);
+        mongocrypt_binary_destroy(ciphertext);
+        ciphertext = mongocrypt_binary_new_from_data(out.data, out.len);
+        mongocrypt_ctx_destroy(ctx);
+    }
+    hit = _mongocrypt_cache_key_l1_get(cache, &key_id_buf);
+    ASSERT(hit);
+    _mongocrypt_cache_key_value_destroy(hit);
+
+    /* Decrypting finds the key in the thread-local cache. */
+    hits = _mongocrypt_atomic_int64_load(&cache->hits);
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_explicit_decrypt_value_init(ctx, ciphertext), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    ASSERT_CMPINT64(_mongocrypt_atomic_int64_load(&cache->hits), ==, hits);
+    ASSERT_OK(mongocrypt_ctx_finalize_value(ctx, &out, &type), ctx);
+    ASSERT_CMPINT(type, ==, BSON_TYPE_UTF8);
+    ASSERT_CMPUINT32(out.len, ==, (uint32_t)sizeof(string_value));
+    ASSERT(0 == memcmp(out.data, string_value, sizeof(string_value)));
+    mongocrypt_ctx_destroy(ctx);
+
+    /* Invalidating the key in the key cache misses the thread-local cache. */
+    {
+        _mongocrypt_cache_key_attr_t *attr = _mongocrypt_cache_key_attr_new(&key_id_buf, NULL);
+
+        ASSERT_OK_STATUS(_mongocrypt_cache_remove(cache, attr, crypt->status), crypt->status);
+        _mongocrypt_cache_key_attr_destroy(attr);
+    }
+    ASSERT(!_mongocrypt_cache_key_l1_get(cache, &key_id_buf));
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_explicit_decrypt_value_init(ctx, ciphertext), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+    mongocrypt_ctx_destroy(ctx);
+
+    mongocrypt_binary_destroy(ciphertext);
+    mongocrypt_binary_destroy(value);
+    mongocrypt_binary_destroy(key_id);
+    mongocrypt_destroy(crypt);
+}
+
 void _mongocrypt_tester_install_cache(_mongocrypt_tester_t *tester) {
     INSTALL_TEST(_test_cache);
     INSTALL_TEST(_test_cache_expiration);
     INSTALL_TEST(_test_cache_duplicates);
+    INSTALL_TEST(_test_cache_many_entries);
+    INSTALL_TEST(_test_cache_key_many_alt_names);
+    INSTALL_TEST(_test_cache_key_evict_alt_names);
+    INSTALL_TEST(_test_cache_key_shared_value);
+    INSTALL_TEST(_test_cache_collinfo_shared_value);
+    INSTALL_TEST(_test_cache_stats);
+    INSTALL_TEST(_test_cache_stats_public);
+    INSTALL_TEST(_test_memory_usage);
+    INSTALL_TEST(_test_fork_keeps_caches);
+    INSTALL_TEST(_test_cache_refresh_ahead);
+    INSTALL_TEST(_test_setopt_key_cache_refresh_ahead);
+    INSTALL_TEST(_test_setopt_key_expiration);
+    INSTALL_TEST(_test_cache_max_entries);
+    INSTALL_TEST(_test_setopt_cache_max_entries);
+    INSTALL_TEST(_test_key_cache_snapshot);
+    INSTALL_TEST(_test_cache_entry_expiration);
+    INSTALL_TEST(_test_unencrypted_collinfo_expiration);
+    INSTALL_TEST(_test_cache_domain);
+    INSTALL_TEST(_test_key_cache_thread_local);
+    INSTALL_TEST(_test_key_cache_thread_local_ctx);
 }
\ No newline at end of file
@@ -83,6 +83,46 @@ static void _test_compact_success(_mongocrypt_tester_t *tester) {
     }
 }
 
+static void _test_compact_token_cache(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_WITH_TOKEN_CACHE);
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *out = mongocrypt_binary_new();
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "db", -1, TEST_FILE("./test/data/compact/success/cmd.json")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_COLLINFO);
+    ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx, TEST_FILE("./test/data/compact/success/collinfo.json")), ctx);
+    ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+    ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx,
+                                        TEST_FILE("./test/data/keys/12345678123498761234123456789012-local-document.json")),
+              ctx);
+    ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx,
+                                        TEST_FILE("./test/data/keys/ABCDEFAB123498761234123456789012-local-document.json")),
+              ctx);
+    ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx,
+                                        TEST_FILE("./test/data/keys/12345678123498761234123456789013-local-document.json")),
+              ctx);
+    ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, out), ctx);
+    ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_FILE("./test/data/compact/success/encrypted-payload.json"), out);
+    ASSERT_CMPUINT32(_mongocrypt_cache_num_entries(&crypt->cache_tokens), ==, 1);
+    mongocrypt_ctx_destroy(ctx);
+
+    /* The second command uses the cached collinfo, keys, and tokens. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "db", -1, TEST_FILE("./test/data/compact/success/cmd.json")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, out), ctx);
+    ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_FILE("./test/data/compact/success/encrypted-payload.json"), out);
+    ASSERT_CMPUINT32(_mongocrypt_cache_num_entries(&crypt->cache_tokens), ==, 1);
+    mongocrypt_ctx_destroy(ctx);
+
+    mongocrypt_binary_destroy(out);
+    mongocrypt_destroy(crypt);
+}
+
 static void _test_compact_nonlocal_kms(_mongocrypt_tester_t *tester) {
     mongocrypt_t *crypt;
     mongocrypt_ctx_t *ctx;
@@ -376,6 +416,7 @@ static void _test_compact_from_encrypted_field_config_map(_mongocrypt_tester_t *
 
 void _mongocrypt_tester_install_compact(_mongocrypt_tester_t *tester) {
     INSTALL_TEST(_test_compact_success);
+    INSTALL_TEST(_test_compact_token_cache);
     INSTALL_TEST(_test_compact_nonlocal_kms);
     INSTALL_TEST(_test_compact_missing_key_id);
     INSTALL_TEST(_test_compact_key_not_provided);
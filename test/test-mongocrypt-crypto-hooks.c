@@ -335,6 +335,7 @@ _test_crypto_hooks_encryption_helper(_mongocrypt_tester_t *tester, const char *e
 }
 
 static void _test_crypto_hooks_encryption(_mongocrypt_tester_t *tester) {
+    SKIP_WITHOUT_CRYPTO_HOOKS();
     _test_crypto_hooks_encryption_helper(tester, "error_on:none", false, false);
     _test_crypto_hooks_encryption_helper(tester, "error_on:aes_256_cbc_encrypt", false, false);
     _test_crypto_hooks_encryption_helper(tester, "error_on:aes_256_ctr_encrypt", true, false);
@@ -407,6 +408,7 @@ _test_crypto_hooks_decryption_helper(_mongocrypt_tester_t *tester, const char *e
 }
 
 static void _test_crypto_hooks_decryption(_mongocrypt_tester_t *tester) {
+    SKIP_WITHOUT_CRYPTO_HOOKS();
     _test_crypto_hooks_decryption_helper(tester, "error_on:none", false, false);
     _test_crypto_hooks_decryption_helper(tester, "error_on:aes_256_cbc_decrypt", false, false);
     _test_crypto_hooks_decryption_helper(tester, "error_on:aes_256_ctr_decrypt", true, false);
@@ -462,6 +464,7 @@ static void _test_crypto_hooks_iv_gen_helper(_mongocrypt_tester_t *tester, char
 }
 
 static void _test_crypto_hooks_iv_gen(_mongocrypt_tester_t *tester) {
+    SKIP_WITHOUT_CRYPTO_HOOKS();
     _test_crypto_hooks_iv_gen_helper(tester, "error_on:none");
     _test_crypto_hooks_iv_gen_helper(tester, "error_on:hmac_sha512");
 }
@@ -504,6 +507,7 @@ static void _test_crypto_hooks_random_helper(_mongocrypt_tester_t *tester, const
 }
 
 static void _test_crypto_hooks_random(_mongocrypt_tester_t *tester) {
+    SKIP_WITHOUT_CRYPTO_HOOKS();
     _test_crypto_hooks_random_helper(tester, "error_on:none");
     _test_crypto_hooks_random_helper(tester, "error_on:random");
 }
@@ -543,6 +547,7 @@ static void _test_kms_request_helper(_mongocrypt_tester_t *tester, const char *e
 }
 
 static void _test_kms_request(_mongocrypt_tester_t *tester) {
+    SKIP_WITHOUT_CRYPTO_HOOKS();
     _test_kms_request_helper(tester, "error_on:none");
     _test_kms_request_helper(tester, "error_on:hmac_sha256");
     _test_kms_request_helper(tester, "error_on:sha256");
@@ -560,6 +565,7 @@ static void _test_crypto_hooks_unset(_mongocrypt_tester_t *tester) {
 /* test a bug fix, that an error on explicit encryption in the crypto hooks sets
  * the context state */
 static void _test_crypto_hooks_explicit_err(_mongocrypt_tester_t *tester) {
+    SKIP_WITHOUT_CRYPTO_HOOKS();
     mongocrypt_t *crypt;
     mongocrypt_ctx_t *ctx;
     mongocrypt_binary_t *bin, *key_id;
@@ -590,6 +596,7 @@ static void _test_crypto_hooks_explicit_err(_mongocrypt_tester_t *tester) {
 
 /* validate that sha256 errors are handled correctly */
 static void _test_crypto_hooks_explicit_sha256_err(_mongocrypt_tester_t *tester) {
+    SKIP_WITHOUT_CRYPTO_HOOKS();
     mongocrypt_t *crypt;
     mongocrypt_status_t *status;
     mongocrypt_ctx_t *ctx;
@@ -610,6 +617,7 @@ static void _test_crypto_hooks_explicit_sha256_err(_mongocrypt_tester_t *tester)
 }
 
 static void _test_crypto_hook_sign_rsaes_pkcs1_v1_5(_mongocrypt_tester_t *tester) {
+    SKIP_WITHOUT_CRYPTO_HOOKS();
     mongocrypt_t *crypt;
     mongocrypt_ctx_t *ctx;
 
@@ -686,6 +694,7 @@ static bool _aes_256_ecb_encrypt(void *ctx,
 }
 
 void _test_fle2_crypto_via_ecb_hook(_mongocrypt_tester_t *tester) {
+    SKIP_WITHOUT_CRYPTO_HOOKS();
     const _mongocrypt_value_encryption_algorithm_t *fle2alg = _mcFLE2Algorithm();
     bool ret;
     _mongocrypt_buffer_t key;
@@ -797,6 +806,7 @@ static bool _aes_256_ctr_decrypt_and_count(void *ctx,
 }
 
 static void test_setting_only_ctr_hook(_mongocrypt_tester_t *tester) {
+    SKIP_WITHOUT_CRYPTO_HOOKS();
     // Test that the CTR hook can be set without setting other crypto hooks.
     // This enables supporting macOS <= 10.14 in bindings using libmongocrypt with native crypto.
     // macOS <= 10.14 does not support native CTR encryption.
@@ -884,7 +894,119 @@ static void test_setting_only_ctr_hook(_mongocrypt_tester_t *tester) {
     mongocrypt_destroy(crypt);
 }
 
+static int hmac_sha_256_batch_count;
+
+static bool _hmac_sha_256_batch_and_count(void *ctx,
+                                          mongocrypt_binary_t **keys,
+                                          mongocrypt_binary_t **ins,
+                                          mongocrypt_binary_t **outs,
+                                          uint32_t count,
+                                          mongocrypt_status_t *status) {
+    hmac_sha_256_batch_count++;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!_std_hook_native_hmac_sha256(ctx, keys[i], ins[i], outs[i], status)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void _test_crypto_hook_hmac_sha_256_batch(_mongocrypt_tester_t *tester) {
+    SKIP_WITHOUT_CRYPTO_HOOKS();
+    mongocrypt_t *crypt;
+
+    // Requires crypto hooks.
+    {
+        crypt = mongocrypt_new();
+        ASSERT_FAILS(mongocrypt_setopt_crypto_hook_hmac_sha_256_batch(crypt, _hmac_sha_256_batch_and_count, NULL),
+                     crypt,
+                     "crypto hooks must be set");
+        mongocrypt_destroy(crypt);
+    }
+
+    crypt = mongocrypt_new();
+    ASSERT_OK(mongocrypt_setopt_crypto_hooks(crypt,
+                                             _std_hook_native_crypto_aes_256_cbc_encrypt,
+                                             _std_hook_native_crypto_aes_256_cbc_decrypt,
+                                             _std_hook_native_crypto_random,
+                                             _std_hook_native_hmac_sha512,
+                                             _std_hook_native_hmac_sha256,
+                                             _error_hook_native_sha256,
+                                             NULL /* ctx */),
+              crypt);
+    ASSERT_FAILS(mongocrypt_setopt_crypto_hook_hmac_sha_256_batch(crypt, NULL, NULL),
+                 crypt,
+                 "hmac_sha_256_batch not set");
+    ASSERT_OK(mongocrypt_setopt_crypto_hook_hmac_sha_256_batch(crypt, _hmac_sha_256_batch_and_count, NULL), crypt);
+    ASSERT_OK(mongocrypt_setopt_kms_provider_aws(crypt, "example", -1, "example", -1), crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+
+    // The batch matches computing each HMAC individually.
+    {
+        mongocrypt_status_t *status = mongocrypt_status_new();
+        _mongocrypt_buffer_t key1, key2, in1, in2, expect;
+        _mongocrypt_buffer_t outs[3];
+
+        _mongocrypt_buffer_copy_from_hex(&key1, HMAC_KEY_HEX);
+        _mongocrypt_buffer_copy_from_hex(&key2, ENCRYPTION_KEY_HEX);
+        _mongocrypt_buffer_copy_from_hex(&in1, HASH_HEX);
+        _mongocrypt_buffer_copy_from_hex(&in2, IV_HEX);
+        const _mongocrypt_buffer_t *keys[] = {&key1, &key2, &key1};
+        const _mongocrypt_buffer_t *ins[] = {&in1, &in1, &in2};
+
+        hmac_sha_256_batch_count = 0;
+        ASSERT_OK_STATUS(_mongocrypt_hmac_sha_256_batch(crypt->crypto, keys, ins, outs, 3, status), status);
+        ASSERT_CMPINT(hmac_sha_256_batch_count, ==, 1);
+
+        for (int i = 0; i < 3; i++) {
+            _mongocrypt_buffer_init_size(&expect, MONGOCRYPT_HMAC_SHA256_LEN);
+            ASSERT_OK_STATUS(_mongocrypt_hmac_sha_256(crypt->crypto, keys[i], ins[i], &expect, status), status);
+            ASSERT_CMPBUF(expect, outs[i]);
+            _mongocrypt_buffer_cleanup(&expect);
+            _mongocrypt_buffer_cleanup(&outs[i]);
+        }
+
+        // Keys of the wrong length are rejected before calling the hook.
+        keys[1] = &in2;
+        ASSERT_FAILS_STATUS(_mongocrypt_hmac_sha_256_batch(crypt->crypto, keys, ins, outs, 3, status),
+                            status,
+                            "invalid hmac_sha_256 key length");
+        ASSERT_CMPINT(hmac_sha_256_batch_count, ==, 1);
+        for (int i = 0; i < 3; i++) {
+            _mongocrypt_buffer_cleanup(&outs[i]);
+        }
+
+        _mongocrypt_buffer_cleanup(&in2);
+        _mongocrypt_buffer_cleanup(&in1);
+        _mongocrypt_buffer_cleanup(&key2);
+        _mongocrypt_buffer_cleanup(&key1);
+        mongocrypt_status_destroy(status);
+    }
+
+    mongocrypt_destroy(crypt);
+}
+
+#ifndef MONGOCRYPT_ENABLE_CRYPTO_HOOKS
+static void _test_crypto_hooks_disabled(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt = mongocrypt_new();
+    ASSERT_FAILS(mongocrypt_setopt_crypto_hooks(crypt,
+                                                _mock_aes_256_xxx_encrypt,
+                                                _mock_aes_256_xxx_decrypt,
+                                                _random,
+                                                _hmac_sha_512,
+                                                _hmac_sha_256,
+                                                _sha_256,
+                                                NULL),
+                 crypt,
+                 "crypto hooks are disabled");
+    mongocrypt_destroy(crypt);
+}
+#endif
+
 void _mongocrypt_tester_install_crypto_hooks(_mongocrypt_tester_t *tester) {
+#ifndef MONGOCRYPT_ENABLE_CRYPTO_HOOKS
+    INSTALL_TEST_CRYPTO(_test_crypto_hooks_disabled, CRYPTO_REQUIRED);
+#endif
     INSTALL_TEST_CRYPTO(_test_crypto_hooks_encryption, CRYPTO_OPTIONAL);
     INSTALL_TEST_CRYPTO(_test_crypto_hooks_decryption, CRYPTO_OPTIONAL);
     INSTALL_TEST_CRYPTO(_test_crypto_hooks_iv_gen, CRYPTO_OPTIONAL);
@@ -897,6 +1019,7 @@ void _mongocrypt_tester_install_crypto_hooks(_mongocrypt_tester_t *tester) {
     INSTALL_TEST_CRYPTO(test_is_crypto_available_with_crypto_required, CRYPTO_REQUIRED);
     INSTALL_TEST_CRYPTO(test_is_crypto_available_with_crypto_prohibited, CRYPTO_PROHIBITED);
     INSTALL_TEST_CRYPTO(test_setting_only_ctr_hook, CRYPTO_REQUIRED);
+    INSTALL_TEST_CRYPTO(_test_crypto_hook_hmac_sha_256_batch, CRYPTO_REQUIRED);
 #ifdef MONGOCRYPT_ENABLE_CRYPTO_LIBCRYPTO
     INSTALL_TEST(_test_fle2_crypto_via_ecb_hook);
 #endif
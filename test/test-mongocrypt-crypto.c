@@ -311,10 +311,10 @@ void _test_native_crypto_hmac_sha_256(_mongocrypt_tester_t *tester) {
 #include "./data/NIST-CAVP.cstructs"
                                    {0}};
     hmac_sha_256_test_t *test;
-    mongocrypt_t *crypt;
+    mongocrypt_status_t *init_status = mongocrypt_status_new();
 
-    /* Create a mongocrypt_t to call _native_crypto_init(). */
-    crypt = mongocrypt_new();
+    ASSERT_OR_PRINT(_native_crypto_ensure_init(init_status), init_status);
+    mongocrypt_status_destroy(init_status);
 
     for (test = tests; test->testname != NULL; test++) {
         bool ret;
@@ -341,6 +341,19 @@ void _test_native_crypto_hmac_sha_256(_mongocrypt_tester_t *tester) {
         }
         ASSERT_CMPBYTES(expect.data, expect.len, got.data, got.len);
 
+        /* Hashing the input in two parts gives the same tag. */
+        _mongocrypt_buffer_t parts[2];
+        ASSERT(_mongocrypt_buffer_from_subrange(&parts[0], &input, 0, input.len / 2));
+        ASSERT(_mongocrypt_buffer_from_subrange(&parts[1], &input, input.len / 2, input.len - input.len / 2));
+        got.len = MONGOCRYPT_HMAC_SHA256_LEN;
+        memset(got.data, 0, got.len);
+        ret = _native_crypto_hmac_sha_256_parts(&key, parts, 2, &got, status);
+        ASSERT_OR_PRINT(ret, status);
+        if (expect.len < got.len) {
+            got.len = expect.len;
+        }
+        ASSERT_CMPBYTES(expect.data, expect.len, got.data, got.len);
+
         mongocrypt_status_destroy(status);
         _mongocrypt_buffer_cleanup(&got);
         _mongocrypt_buffer_cleanup(&expect);
@@ -349,8 +362,6 @@ void _test_native_crypto_hmac_sha_256(_mongocrypt_tester_t *tester) {
 
         printf("End test '%s'.\n", test->testname);
     }
-
-    mongocrypt_destroy(crypt);
 }
 
 static bool _hook_hmac_sha_256(void *ctx,
@@ -368,7 +379,6 @@ static bool _hook_hmac_sha_256(void *ctx,
 }
 
 static void _test_mongocrypt_hmac_sha_256_hook(_mongocrypt_tester_t *tester) {
-    mongocrypt_t *crypt;
     _mongocrypt_crypto_t crypto = {0};
     _mongocrypt_buffer_t key = {0};
     _mongocrypt_buffer_t in = {0};
@@ -376,9 +386,6 @@ static void _test_mongocrypt_hmac_sha_256_hook(_mongocrypt_tester_t *tester) {
     _mongocrypt_buffer_t got;
     mongocrypt_status_t *status;
 
-    /* Create a mongocrypt_t to call _native_crypto_init(). */
-    crypt = mongocrypt_new();
-
     status = mongocrypt_status_new();
     _mongocrypt_buffer_resize(&key, MONGOCRYPT_MAC_KEY_LEN);
     _mongocrypt_buffer_copy_from_hex(&expect,
@@ -399,7 +406,6 @@ static void _test_mongocrypt_hmac_sha_256_hook(_mongocrypt_tester_t *tester) {
     _mongocrypt_buffer_cleanup(&expect);
     _mongocrypt_buffer_cleanup(&key);
     mongocrypt_status_destroy(status);
-    mongocrypt_destroy(crypt);
 }
 
 static void _test_random_int64(_mongocrypt_tester_t *tester) {
@@ -432,9 +438,57 @@ static void _test_random_int64(_mongocrypt_tester_t *tester) {
     mongocrypt_destroy(crypt);
 }
 
+static void _test_random_pool(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_status_t *status;
+    _mongocrypt_buffer_t prev, got;
+    const uint8_t zeros[MONGOCRYPT_IV_LEN] = {0};
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    status = mongocrypt_status_new();
+    ASSERT(crypt->crypto->random_pool);
+
+    _mongocrypt_buffer_init_size(&prev, MONGOCRYPT_IV_LEN);
+    ASSERT_OR_PRINT(_mongocrypt_random(crypt->crypto, &prev, prev.len, status), status);
+
+    /* Draw enough IVs to refill the pool several times. No IV repeats the
+     * previous one or is left zeroed. */
+    for (int i = 0; i < 4 * MONGOCRYPT_RANDOM_POOL_LEN / MONGOCRYPT_IV_LEN; i++) {
+        _mongocrypt_buffer_init_size(&got, MONGOCRYPT_IV_LEN);
+        ASSERT_OR_PRINT(_mongocrypt_random(crypt->crypto, &got, got.len, status), status);
+        ASSERT(0 != memcmp(got.data, prev.data, MONGOCRYPT_IV_LEN));
+        ASSERT(0 != memcmp(got.data, zeros, MONGOCRYPT_IV_LEN));
+        _mongocrypt_buffer_cleanup(&prev);
+        _mongocrypt_buffer_steal(&prev, &got);
+    }
+
+    /* Large requests bypass the pool. */
+    _mongocrypt_buffer_init_size(&got, MONGOCRYPT_KEY_LEN);
+    ASSERT_OR_PRINT(_mongocrypt_random(crypt->crypto, &got, got.len, status), status);
+    _mongocrypt_buffer_cleanup(&got);
+
+    _mongocrypt_buffer_cleanup(&prev);
+    mongocrypt_status_destroy(status);
+    mongocrypt_destroy(crypt);
+}
+
+static void _test_eager_crypto_init(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+
+    crypt = mongocrypt_new();
+    ASSERT_OK(mongocrypt_setopt_eager_crypto_init(crypt), crypt);
+    ASSERT_OK(mongocrypt_setopt_kms_providers(crypt, TEST_BSON("{'aws': {}}")), crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+    ASSERT(_native_crypto_initialized);
+    ASSERT_FAILS(mongocrypt_setopt_eager_crypto_init(crypt), crypt, "options cannot be set after initialization");
+    mongocrypt_destroy(crypt);
+}
+
 void _mongocrypt_tester_install_crypto(_mongocrypt_tester_t *tester) {
     INSTALL_TEST(_test_roundtrip);
     INSTALL_TEST(_test_native_crypto_hmac_sha_256);
     INSTALL_TEST_CRYPTO(_test_mongocrypt_hmac_sha_256_hook, CRYPTO_OPTIONAL);
     INSTALL_TEST(_test_random_int64);
+    INSTALL_TEST(_test_random_pool);
+    INSTALL_TEST(_test_eager_crypto_init);
 }
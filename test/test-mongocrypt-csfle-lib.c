@@ -170,6 +170,54 @@ static void _test_override_error_includes_reason(_mongocrypt_tester_t *tester) {
     mongocrypt_destroy(crypt);
 }
 
+static void _test_csfle_deferred_load(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *const crypt = get_test_mongocrypt(tester);
+    mongocrypt_setopt_append_crypt_shared_lib_search_path(crypt, "$ORIGIN");
+    ASSERT_OK(mongocrypt_setopt_defer_crypt_shared_load(crypt), crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+    // csfle was not loaded yet:
+    BSON_ASSERT(mongocrypt_crypt_shared_lib_version_string(crypt, NULL) == NULL);
+    BSON_ASSERT(mongocrypt_crypt_shared_lib_version(crypt) == 0);
+
+    // A command that does not need markings does not load it:
+    mongocrypt_ctx_t *ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "admin", -1, TEST_BSON("{'ping': 1}")), ctx);
+    BSON_ASSERT(mongocrypt_crypt_shared_lib_version(crypt) == 0);
+    mongocrypt_ctx_destroy(ctx);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "test", -1, TEST_FILE("./test/example/cmd.json")), ctx);
+    // csfle WAS loaded:
+    BSON_ASSERT(mongocrypt_crypt_shared_lib_version_string(crypt, NULL) != NULL);
+    BSON_ASSERT(mongocrypt_crypt_shared_lib_version(crypt) != 0);
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_destroy(crypt);
+}
+
+static void _test_csfle_deferred_load_override_fail(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *const crypt = get_test_mongocrypt(tester);
+    mongocrypt_setopt_set_crypt_shared_lib_path_override(crypt,
+                                                         "/no-such-file-or-directory/mongo_crypt_v1" MCR_DLL_SUFFIX);
+    ASSERT_OK(mongocrypt_setopt_defer_crypt_shared_load(crypt), crypt);
+    // The failure is reported when the library is needed:
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+
+    mongocrypt_ctx_t *ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_FAILS(mongocrypt_ctx_encrypt_init(ctx, "test", -1, TEST_FILE("./test/example/cmd.json")),
+                 ctx,
+                 "but we failed to open a dynamic library at that location");
+    mongocrypt_ctx_destroy(ctx);
+
+    // ... and again for later contexts:
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_FAILS(mongocrypt_ctx_encrypt_init(ctx, "test", -1, TEST_FILE("./test/example/cmd.json")),
+                 ctx,
+                 "but we failed to open a dynamic library at that location");
+    BSON_ASSERT(mongocrypt_crypt_shared_lib_version(crypt) == 0);
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_destroy(crypt);
+}
+
 void _mongocrypt_tester_install_csfle_lib(_mongocrypt_tester_t *tester) {
     INSTALL_TEST(_test_csfle_no_paths);
     INSTALL_TEST(_test_csfle_not_found);
@@ -181,4 +229,6 @@ void _mongocrypt_tester_install_csfle_lib(_mongocrypt_tester_t *tester) {
     INSTALL_TEST(_test_cur_exe_path);
     INSTALL_TEST(_test_csfle_not_loaded_with_bypassqueryanalysis);
     INSTALL_TEST(_test_override_error_includes_reason);
+    INSTALL_TEST(_test_csfle_deferred_load);
+    INSTALL_TEST(_test_csfle_deferred_load_override_fail);
 }
@@ -15,6 +15,7 @@
  */
 
 #include "kms_message/kms_b64.h" // kms_message_raw_to_b64
+#include "mc-fle-blob-subtype-private.h"
 #include "mongocrypt-ctx-private.h"
 #include "mongocrypt.h"
 #include "test-mongocrypt-assert-match-bson.h"
@@ -122,6 +123,48 @@ static void _test_decrypt_ready(_mongocrypt_tester_t *tester) {
     mongocrypt_binary_destroy(encrypted);
 }
 
+static void _test_decrypt_borrow_input(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *encrypted, *decrypted;
+    _mongocrypt_ctx_decrypt_t *dctx;
+    _mongocrypt_buffer_t expected;
+
+    encrypted = _mongocrypt_tester_encrypted_doc(tester);
+    decrypted = mongocrypt_binary_new();
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, encrypted), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, decrypted), ctx);
+    _mongocrypt_buffer_copy_from_binary(&expected, decrypted);
+    mongocrypt_ctx_destroy(ctx);
+
+    /* The borrowed document is viewed, not copied, and decrypts the same. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_borrow_input(ctx), ctx);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, encrypted), ctx);
+    dctx = (_mongocrypt_ctx_decrypt_t *)ctx;
+    ASSERT(!dctx->original_doc.owned);
+    ASSERT(dctx->original_doc.data == mongocrypt_binary_data(encrypted));
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, decrypted), ctx);
+    ASSERT_CMPBYTES(expected.data, expected.len, mongocrypt_binary_data(decrypted), mongocrypt_binary_len(decrypted));
+    mongocrypt_ctx_destroy(ctx);
+
+    /* The option must be set before init. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, encrypted), ctx);
+    ASSERT_FAILS(mongocrypt_ctx_setopt_borrow_input(ctx), ctx, "cannot set options after init");
+    mongocrypt_ctx_destroy(ctx);
+
+    _mongocrypt_buffer_cleanup(&expected);
+    mongocrypt_binary_destroy(decrypted);
+    mongocrypt_destroy(crypt);
+    mongocrypt_binary_destroy(encrypted);
+}
+
 /* Test with empty AWS credentials. */
 void _test_decrypt_empty_aws(_mongocrypt_tester_t *tester) {
     mongocrypt_t *crypt;
@@ -174,6 +217,850 @@ static void _test_decrypt_empty_binary(_mongocrypt_tester_t *tester) {
     mongocrypt_destroy(crypt);
 }
 
+static void _test_ctx_reset(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *bin;
+    _mongocrypt_buffer_t encrypted;
+
+    bin = mongocrypt_binary_new();
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    ctx = mongocrypt_ctx_new(crypt);
+
+    /* A failed context can be reset. */
+    ASSERT_FAILS(mongocrypt_ctx_explicit_decrypt_init(ctx, TEST_BSON("{}")), ctx, "invalid msg");
+    ASSERT_OK(mongocrypt_ctx_reset(ctx), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_DONE);
+
+    /* Encrypt, then decrypt with the same context. */
+    ASSERT_OK(mongocrypt_ctx_setopt_key_alt_name(ctx, TEST_BSON("{'keyAltName': 'keyDocumentName'}")), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx, MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR, -1), ctx);
+    ASSERT_OK(mongocrypt_ctx_explicit_encrypt_init(ctx, TEST_BSON("{'v': 'foo'}")), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, bin), ctx);
+    _mongocrypt_buffer_copy_from_binary(&encrypted, bin);
+
+    ASSERT_OK(mongocrypt_ctx_reset(ctx), ctx);
+    ASSERT_OK(mongocrypt_ctx_explicit_decrypt_init(ctx, _mongocrypt_buffer_as_binary(&encrypted)), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, bin), ctx);
+    ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_BSON("{'v': 'foo'}"), bin);
+
+    mongocrypt_binary_destroy(bin);
+    mongocrypt_ctx_destroy(ctx);
+    _mongocrypt_buffer_cleanup(&encrypted);
+    mongocrypt_destroy(crypt);
+}
+
+static void _test_ctx_get_timings(_mongocrypt_tester_t *tester) {
+    const char *const names[] = {"init",
+                                 "needMongoCollinfo",
+                                 "needMongoCollinfoWithDb",
+                                 "needMongoMarkings",
+                                 "needMongoKeys",
+                                 "needMongoOps",
+                                 "needKmsCredentials",
+                                 "needKms",
+                                 "ready",
+                                 "finalize"};
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *bin;
+    bson_t timings;
+
+    bin = mongocrypt_binary_new();
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    ctx = mongocrypt_ctx_new(crypt);
+
+    ASSERT_FAILS(mongocrypt_ctx_get_timings(ctx, bin), ctx, "ctx NULL or uninitialized");
+    mongocrypt_ctx_destroy(ctx);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_key_alt_name(ctx, TEST_BSON("{'keyAltName': 'keyDocumentName'}")), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx, MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR, -1), ctx);
+    ASSERT_OK(mongocrypt_ctx_explicit_encrypt_init(ctx, TEST_BSON("{'v': 'foo'}")), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, bin), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_DONE);
+
+    ASSERT_OK(mongocrypt_ctx_get_timings(ctx, bin), ctx);
+    ASSERT(_mongocrypt_binary_to_bson(bin, &timings));
+    ASSERT_CMPUINT32(bson_count_keys(&timings), ==, sizeof(names) / sizeof(names[0]));
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        bson_iter_t iter;
+
+        ASSERT(bson_iter_init_find(&iter, &timings, names[i]));
+        ASSERT(BSON_ITER_HOLDS_INT64(&iter));
+        ASSERT_CMPINT64(bson_iter_int64(&iter), >=, 0);
+    }
+
+    mongocrypt_binary_destroy(bin);
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_destroy(crypt);
+}
+
+static void _test_ctx_finalize_into(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *bin;
+    uint8_t *buf;
+    uint32_t len = 0, len_again = 0;
+
+    bin = mongocrypt_binary_new();
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+
+    /* Deterministic encryption gives the same result in both contexts. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_key_alt_name(ctx, TEST_BSON("{'keyAltName': 'keyDocumentName'}")), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx, MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR, -1), ctx);
+    ASSERT_OK(mongocrypt_ctx_explicit_encrypt_init(ctx, TEST_BSON("{'v': 'foo'}")), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, bin), ctx);
+
+    mongocrypt_ctx_t *ctx_into = mongocrypt_ctx_new(crypt);
+    ASSERT_FAILS(mongocrypt_ctx_finalize_into(ctx_into, NULL, 0, &len), ctx_into, "ctx NULL or uninitialized");
+    mongocrypt_ctx_destroy(ctx_into);
+
+    ctx_into = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_key_alt_name(ctx_into, TEST_BSON("{'keyAltName': 'keyDocumentName'}")), ctx_into);
+    ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx_into, MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR, -1), ctx_into);
+    ASSERT_OK(mongocrypt_ctx_explicit_encrypt_init(ctx_into, TEST_BSON("{'v': 'foo'}")), ctx_into);
+    _mongocrypt_tester_run_ctx_to(tester, ctx_into, MONGOCRYPT_CTX_READY);
+
+    /* Query the size. This finalizes. */
+    ASSERT_OK(mongocrypt_ctx_finalize_into(ctx_into, NULL, 0, &len), ctx_into);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx_into), MONGOCRYPT_CTX_DONE);
+    ASSERT_CMPUINT32(len, ==, mongocrypt_binary_len(bin));
+
+    /* A short buffer is left untouched. */
+    buf = bson_malloc(len);
+    memset(buf, 0xAA, len);
+    ASSERT_OK(mongocrypt_ctx_finalize_into(ctx_into, buf, len - 1u, &len_again), ctx_into);
+    ASSERT_CMPUINT32(len_again, ==, len);
+    ASSERT_CMPUINT8(buf[0], ==, 0xAA);
+
+    ASSERT_OK(mongocrypt_ctx_finalize_into(ctx_into, buf, len, &len_again), ctx_into);
+    ASSERT_CMPBYTES(mongocrypt_binary_data(bin), mongocrypt_binary_len(bin), buf, len_again);
+
+    bson_free(buf);
+    mongocrypt_ctx_destroy(ctx_into);
+    mongocrypt_binary_destroy(bin);
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_destroy(crypt);
+}
+
+static void _test_explicit_decrypt_batch(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *bin;
+    _mongocrypt_buffer_t encrypted;
+
+    bin = mongocrypt_binary_new();
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+
+    /* Encrypt a batch of values. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_key_alt_name(ctx, TEST_BSON("{'keyAltName': 'keyDocumentName'}")), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx, MONGOCRYPT_ALGORITHM_RANDOM_STR, -1), ctx);
+    ASSERT_OK(mongocrypt_ctx_explicit_encrypt_batch_init(ctx, TEST_BSON("{'v': [123, 'abc', {'x': 1.5}]}")), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, bin), ctx);
+    _mongocrypt_buffer_copy_from_binary(&encrypted, bin);
+    mongocrypt_ctx_destroy(ctx);
+
+    /* Decrypt them back in order. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_explicit_decrypt_batch_init(ctx, _mongocrypt_buffer_as_binary(&encrypted)), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, bin), ctx);
+    ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_BSON("{'v': [123, 'abc', {'x': 1.5}]}"), bin);
+    mongocrypt_ctx_destroy(ctx);
+
+    /* Every value must be a ciphertext. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_FAILS(mongocrypt_ctx_explicit_decrypt_batch_init(ctx, TEST_BSON("{'v': 123}")),
+                 ctx,
+                 "'v' must be an array");
+    mongocrypt_ctx_destroy(ctx);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_FAILS(mongocrypt_ctx_explicit_decrypt_batch_init(ctx, TEST_BSON("{'v': []}")),
+                 ctx,
+                 "'v' must not be empty");
+    mongocrypt_ctx_destroy(ctx);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_FAILS(mongocrypt_ctx_explicit_decrypt_batch_init(ctx, TEST_BSON("{'v': [123]}")),
+                 ctx,
+                 "'v' must only contain binaries");
+    mongocrypt_ctx_destroy(ctx);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_FAILS(mongocrypt_ctx_explicit_decrypt_batch_init(
+                     ctx,
+                     TEST_BSON("{'v': [{'$binary': {'base64': 'AAAA', 'subType': '00'}}]}")),
+                 ctx,
+                 "decryption expected BSON binary subtype 6, got 0");
+    mongocrypt_ctx_destroy(ctx);
+
+    mongocrypt_binary_destroy(bin);
+    _mongocrypt_buffer_cleanup(&encrypted);
+    mongocrypt_destroy(crypt);
+}
+
+static void _test_decrypt_next_document(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *bin;
+    bson_t encrypted;
+    bson_iter_t iter;
+    bson_value_t ciphertexts[2];
+    bson_t reply = BSON_INITIALIZER;
+    bson_t cursor, batch, doc, array;
+    mongocrypt_binary_t *reply_bin;
+
+    bin = mongocrypt_binary_new();
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_key_alt_name(ctx, TEST_BSON("{'keyAltName': 'keyDocumentName'}")), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx, MONGOCRYPT_ALGORITHM_RANDOM_STR, -1), ctx);
+    ASSERT_OK(mongocrypt_ctx_explicit_encrypt_batch_init(ctx, TEST_BSON("{'v': [123, 'abc']}")), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, bin), ctx);
+    ASSERT(_mongocrypt_binary_to_bson(bin, &encrypted));
+    ASSERT(bson_iter_init(&iter, &encrypted));
+    ASSERT(bson_iter_find_descendant(&iter, "v.0", &iter));
+    bson_value_copy(bson_iter_value(&iter), &ciphertexts[0]);
+    ASSERT(bson_iter_init(&iter, &encrypted));
+    ASSERT(bson_iter_find_descendant(&iter, "v.1", &iter));
+    bson_value_copy(bson_iter_value(&iter), &ciphertexts[1]);
+    mongocrypt_ctx_destroy(ctx);
+
+    /* { cursor: { nextBatch: [ { a: <ct0> }, { b: 1 }, { c: [ <ct1>, 'x' ] } ], id: 0 }, ok: 1 } */
+    BSON_APPEND_DOCUMENT_BEGIN(&reply, "cursor", &cursor);
+    BSON_APPEND_ARRAY_BEGIN(&cursor, "nextBatch", &batch);
+    BSON_APPEND_DOCUMENT_BEGIN(&batch, "0", &doc);
+    BSON_APPEND_VALUE(&doc, "a", &ciphertexts[0]);
+    bson_append_document_end(&batch, &doc);
+    BSON_APPEND_DOCUMENT_BEGIN(&batch, "1", &doc);
+    BSON_APPEND_INT32(&doc, "b", 1);
+    bson_append_document_end(&batch, &doc);
+    BSON_APPEND_DOCUMENT_BEGIN(&batch, "2", &doc);
+    BSON_APPEND_ARRAY_BEGIN(&doc, "c", &array);
+    BSON_APPEND_VALUE(&array, "0", &ciphertexts[1]);
+    BSON_APPEND_UTF8(&array, "1", "x");
+    bson_append_array_end(&doc, &array);
+    bson_append_document_end(&batch, &doc);
+    bson_append_array_end(&cursor, &batch);
+    BSON_APPEND_INT64(&cursor, "id", 0);
+    bson_append_document_end(&reply, &cursor);
+    BSON_APPEND_INT32(&reply, "ok", 1);
+    reply_bin = mongocrypt_binary_new_from_data((uint8_t *)bson_get_data(&reply), reply.len);
+
+    /* Documents are returned one at a time. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, reply_bin), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_decrypt_next_document(ctx, bin), ctx);
+    ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_BSON("{'a': 123}"), bin);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_decrypt_next_document(ctx, bin), ctx);
+    ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_BSON("{'b': 1}"), bin);
+    ASSERT_OK(mongocrypt_ctx_decrypt_next_document(ctx, bin), ctx);
+    ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_BSON("{'c': ['abc', 'x']}"), bin);
+    ASSERT_FAILS(mongocrypt_ctx_finalize(ctx, bin), ctx, "cannot finalize after streaming decrypted documents");
+    mongocrypt_ctx_destroy(ctx);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, reply_bin), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    for (int i = 0; i < 3; i++) {
+        ASSERT_OK(mongocrypt_ctx_decrypt_next_document(ctx, bin), ctx);
+    }
+    ASSERT_OK(mongocrypt_ctx_decrypt_next_document(ctx, bin), ctx);
+    ASSERT_CMPUINT32(mongocrypt_binary_len(bin), ==, 0);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_DONE);
+    mongocrypt_ctx_destroy(ctx);
+
+    /* Ciphertexts outside of the batch would not be returned. */
+    mongocrypt_binary_destroy(reply_bin);
+    bson_reinit(&reply);
+    BSON_APPEND_VALUE(&reply, "a", &ciphertexts[0]);
+    BSON_APPEND_DOCUMENT_BEGIN(&reply, "cursor", &cursor);
+    BSON_APPEND_ARRAY_BEGIN(&cursor, "firstBatch", &batch);
+    bson_append_array_end(&cursor, &batch);
+    bson_append_document_end(&reply, &cursor);
+    reply_bin = mongocrypt_binary_new_from_data((uint8_t *)bson_get_data(&reply), reply.len);
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, reply_bin), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    ASSERT_FAILS(mongocrypt_ctx_decrypt_next_document(ctx, bin),
+                 ctx,
+                 "cannot stream decrypted documents with ciphertexts outside of the cursor batch");
+    mongocrypt_ctx_destroy(ctx);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_BSON("{'a': 1}")), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    ASSERT_FAILS(mongocrypt_ctx_decrypt_next_document(ctx, bin),
+                 ctx,
+                 "expected document 'cursor' to stream decrypted documents");
+    mongocrypt_ctx_destroy(ctx);
+
+    bson_value_destroy(&ciphertexts[0]);
+    bson_value_destroy(&ciphertexts[1]);
+    mongocrypt_binary_destroy(reply_bin);
+    bson_destroy(&reply);
+    mongocrypt_binary_destroy(bin);
+    mongocrypt_destroy(crypt);
+}
+
+static void _test_decrypt_repeated_deterministic(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *bin;
+    mongocrypt_binary_t *doc_bin;
+    _mongocrypt_cache_stats_t stats;
+    bson_t encrypted;
+    bson_t doc = BSON_INITIALIZER;
+    bson_t array;
+    bson_iter_t iter;
+
+    bin = mongocrypt_binary_new();
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_key_alt_name(ctx, TEST_BSON("{'keyAltName': 'keyDocumentName'}")), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx, MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR, -1), ctx);
+    ASSERT_OK(mongocrypt_ctx_explicit_encrypt_init(ctx, TEST_BSON("{'v': 'US'}")), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, bin), ctx);
+    ASSERT(_mongocrypt_binary_to_bson(bin, &encrypted));
+    ASSERT(bson_iter_init_find(&iter, &encrypted, "v"));
+
+    /* The same ciphertext in several places of one document. */
+    ASSERT(bson_append_value(&doc, "a", -1, bson_iter_value(&iter)));
+    ASSERT(bson_append_value(&doc, "b", -1, bson_iter_value(&iter)));
+    ASSERT(BSON_APPEND_ARRAY_BEGIN(&doc, "c", &array));
+    ASSERT(bson_append_value(&array, "0", -1, bson_iter_value(&iter)));
+    ASSERT(bson_append_array_end(&doc, &array));
+    mongocrypt_ctx_destroy(ctx);
+
+    /* It is decrypted once. */
+    ctx = mongocrypt_ctx_new(crypt);
+    doc_bin = mongocrypt_binary_new_from_data((uint8_t *)bson_get_data(&doc), doc.len);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, doc_bin), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, bin), ctx);
+    ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_BSON("{'a': 'US', 'b': 'US', 'c': ['US']}"), bin);
+    _mongocrypt_cache_stats(&((_mongocrypt_ctx_decrypt_t *)ctx)->plaintext_cache, &stats);
+    ASSERT_CMPINT64(stats.misses, ==, 1);
+    ASSERT_CMPINT64(stats.hits, ==, 2);
+    mongocrypt_ctx_destroy(ctx);
+
+    mongocrypt_binary_destroy(doc_bin);
+    bson_destroy(&doc);
+    mongocrypt_binary_destroy(bin);
+    mongocrypt_destroy(crypt);
+}
+
+static void _decrypt_to_bin(_mongocrypt_tester_t *tester,
+                            mongocrypt_t *crypt,
+                            const bson_t *doc,
+                            mongocrypt_binary_t *out) {
+    mongocrypt_binary_t *doc_bin = mongocrypt_binary_new_from_data((uint8_t *)bson_get_data(doc), doc->len);
+    mongocrypt_ctx_t *ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, doc_bin), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, out), ctx);
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_binary_destroy(doc_bin);
+}
+
+/* Appends the random ciphertext of the string @value to @dst as @key. */
+static void _append_random_ciphertext(_mongocrypt_tester_t *tester,
+                                      mongocrypt_t *crypt,
+                                      bson_t *dst,
+                                      const char *key,
+                                      const char *value) {
+    mongocrypt_ctx_t *ctx = mongocrypt_ctx_new(crypt);
+    mongocrypt_binary_t *bin = mongocrypt_binary_new();
+    bson_t encrypted;
+    bson_iter_t iter;
+
+    ASSERT_OK(mongocrypt_ctx_setopt_key_alt_name(ctx, TEST_BSON("{'keyAltName': 'keyDocumentName'}")), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx, MONGOCRYPT_ALGORITHM_RANDOM_STR, -1), ctx);
+    ASSERT_OK(mongocrypt_ctx_explicit_encrypt_init(ctx, TEST_BSON("{'v': '%s'}", value)), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, bin), ctx);
+    ASSERT(_mongocrypt_binary_to_bson(bin, &encrypted));
+    ASSERT(bson_iter_init_find(&iter, &encrypted, "v"));
+    ASSERT(bson_append_value(dst, key, -1, bson_iter_value(&iter)));
+    mongocrypt_binary_destroy(bin);
+    mongocrypt_ctx_destroy(ctx);
+}
+
+// Test that ciphertexts decrypted by a parallel_for executor are placed in order.
+static void _test_decrypt_parallel_for(_mongocrypt_tester_t *tester) {
+    const char *values[] = {"a", "b", "c", "d"};
+    _reverse_parallel_for_ctx pctx = {0};
+    mongocrypt_t *crypt;
+    mongocrypt_binary_t *bin;
+    bson_t ciphertexts = BSON_INITIALIZER;
+    bson_t doc = BSON_INITIALIZER;
+    bson_t cursor_doc = BSON_INITIALIZER;
+    bson_t child, batch, batch_doc;
+    bson_iter_t iter;
+
+    bin = mongocrypt_binary_new();
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    crypt->crypto->parallel_for = _reverse_parallel_for;
+    crypt->crypto->parallel_for_ctx = &pctx;
+
+    /* A different ciphertext for each value. */
+    for (size_t i = 0; i < sizeof values / sizeof values[0]; i++) {
+        char key[2] = {(char)('0' + i), 0};
+        _append_random_ciphertext(tester, crypt, &ciphertexts, key, values[i]);
+    }
+
+    /* {'arr': [<a>, <b>, <c>, <d>], 'plain': 'e'} */
+    ASSERT(BSON_APPEND_ARRAY(&doc, "arr", &ciphertexts));
+    ASSERT(BSON_APPEND_UTF8(&doc, "plain", "e"));
+
+    /* Below the threshold, ciphertexts are decrypted on the calling thread. */
+    crypt->opts.parallel_decrypt_threshold = 5;
+    _decrypt_to_bin(tester, crypt, &doc, bin);
+    ASSERT_CMPINT(pctx.calls, ==, 0);
+    ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_BSON("{'arr': ['a', 'b', 'c', 'd'], 'plain': 'e'}"), bin);
+
+    /* Outside of a cursor batch, each ciphertext is decrypted by its own task.
+     * Plaintexts decrypted in reverse order are placed in order. */
+    crypt->opts.parallel_decrypt_threshold = 4;
+    _decrypt_to_bin(tester, crypt, &doc, bin);
+    ASSERT_CMPINT(pctx.calls, ==, 1);
+    ASSERT_CMPUINT32(pctx.last_count, ==, 4);
+    ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_BSON("{'arr': ['a', 'b', 'c', 'd'], 'plain': 'e'}"), bin);
+
+    /* {'cursor': {'firstBatch': [{'x': <a>, 'y': <b>}, {}, {'x': <c>, 'y': [<d>]}], 'id': 0}, 'ok': 1} */
+    ASSERT(BSON_APPEND_DOCUMENT_BEGIN(&cursor_doc, "cursor", &child));
+    ASSERT(BSON_APPEND_ARRAY_BEGIN(&child, "firstBatch", &batch));
+    ASSERT(BSON_APPEND_DOCUMENT_BEGIN(&batch, "0", &batch_doc));
+    ASSERT(bson_iter_init_find(&iter, &ciphertexts, "0"));
+    ASSERT(bson_append_value(&batch_doc, "x", -1, bson_iter_value(&iter)));
+    ASSERT(bson_iter_init_find(&iter, &ciphertexts, "1"));
+    ASSERT(bson_append_value(&batch_doc, "y", -1, bson_iter_value(&iter)));
+    ASSERT(bson_append_document_end(&batch, &batch_doc));
+    ASSERT(BSON_APPEND_DOCUMENT_BEGIN(&batch, "1", &batch_doc));
+    ASSERT(bson_append_document_end(&batch, &batch_doc));
+    ASSERT(BSON_APPEND_DOCUMENT_BEGIN(&batch, "2", &batch_doc));
+    ASSERT(bson_iter_init_find(&iter, &ciphertexts, "2"));
+    ASSERT(bson_append_value(&batch_doc, "x", -1, bson_iter_value(&iter)));
+    {
+        bson_t arr;
+        ASSERT(BSON_APPEND_ARRAY_BEGIN(&batch_doc, "y", &arr));
+        ASSERT(bson_iter_init_find(&iter, &ciphertexts, "3"));
+        ASSERT(bson_append_value(&arr, "0", -1, bson_iter_value(&iter)));
+        ASSERT(bson_append_array_end(&batch_doc, &arr));
+    }
+    ASSERT(bson_append_document_end(&batch, &batch_doc));
+    ASSERT(bson_append_array_end(&child, &batch));
+    ASSERT(BSON_APPEND_INT64(&child, "id", 0));
+    ASSERT(bson_append_document_end(&cursor_doc, &child));
+    ASSERT(BSON_APPEND_INT32(&cursor_doc, "ok", 1));
+
+    /* A cursor batch is split at document boundaries: one task per document
+     * with ciphertexts. */
+    _decrypt_to_bin(tester, crypt, &cursor_doc, bin);
+    ASSERT_CMPINT(pctx.calls, ==, 2);
+    ASSERT_CMPUINT32(pctx.last_count, ==, 2);
+    ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_BSON("{'cursor': {'firstBatch': [{'x': 'a', 'y': 'b'}, {}, "
+                                                  "{'x': 'c', 'y': ['d']}], 'id': {'$numberLong': '0'}}, 'ok': 1}"),
+                                        bin);
+
+    bson_destroy(&cursor_doc);
+    bson_destroy(&doc);
+    bson_destroy(&ciphertexts);
+    mongocrypt_binary_destroy(bin);
+    mongocrypt_destroy(crypt);
+}
+
+/* Returns true if @path of @bin holds a binary. */
+static bool _holds_binary(mongocrypt_binary_t *bin, const char *path) {
+    bson_t as_bson;
+    bson_iter_t iter;
+
+    ASSERT(_mongocrypt_binary_to_bson(bin, &as_bson));
+    ASSERT(bson_iter_init(&iter, &as_bson));
+    ASSERT(bson_iter_find_descendant(&iter, path, &iter));
+    return BSON_ITER_HOLDS_BINARY(&iter);
+}
+
+static void _test_decrypt_paths(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *bin, *doc_bin;
+    bson_t doc = BSON_INITIALIZER;
+    bson_t child, arr, elem;
+
+    bin = mongocrypt_binary_new();
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+
+    /* {'x': <a>, 'y': {'z': <b>, 'zz': <c>}, 'arr': [{'z': <d>}], 'cursor': {}} */
+    _append_random_ciphertext(tester, crypt, &doc, "x", "a");
+    ASSERT(BSON_APPEND_DOCUMENT_BEGIN(&doc, "y", &child));
+    _append_random_ciphertext(tester, crypt, &child, "z", "b");
+    _append_random_ciphertext(tester, crypt, &child, "zz", "c");
+    ASSERT(bson_append_document_end(&doc, &child));
+    ASSERT(BSON_APPEND_ARRAY_BEGIN(&doc, "arr", &arr));
+    ASSERT(BSON_APPEND_DOCUMENT_BEGIN(&arr, "0", &elem));
+    _append_random_ciphertext(tester, crypt, &elem, "z", "d");
+    ASSERT(bson_append_document_end(&arr, &elem));
+    ASSERT(bson_append_array_end(&doc, &arr));
+    doc_bin = mongocrypt_binary_new_from_data((uint8_t *)bson_get_data(&doc), doc.len);
+
+    /* Only the selected fields are decrypted. Array indexes are not part of
+     * paths, and "y.z" does not select "y.zz". */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_decrypt_paths(ctx, TEST_BSON("{'paths': ['y.z', 'arr.z']}")), ctx);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, doc_bin), ctx);
+    ASSERT_CMPSIZE_T(((_mongocrypt_ctx_decrypt_t *)ctx)->ciphertext_offsets.len, ==, 2);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, bin), ctx);
+    ASSERT(_holds_binary(bin, "x"));
+    ASSERT(!_holds_binary(bin, "y.z"));
+    ASSERT(_holds_binary(bin, "y.zz"));
+    ASSERT(!_holds_binary(bin, "arr.0.z"));
+    mongocrypt_ctx_destroy(ctx);
+
+    /* A path selects every value nested in the field. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_decrypt_paths(ctx, TEST_BSON("{'paths': ['y']}")), ctx);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, doc_bin), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, bin), ctx);
+    ASSERT(_holds_binary(bin, "x"));
+    ASSERT(!_holds_binary(bin, "y.z"));
+    ASSERT(!_holds_binary(bin, "y.zz"));
+    ASSERT(_holds_binary(bin, "arr.0.z"));
+    mongocrypt_ctx_destroy(ctx);
+
+    /* No keys are needed if no ciphertext is selected. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_decrypt_paths(ctx, TEST_BSON("{'paths': ['missing']}")), ctx);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, doc_bin), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, bin), ctx);
+    ASSERT_CMPBYTES(mongocrypt_binary_data(doc_bin),
+                    mongocrypt_binary_len(doc_bin),
+                    mongocrypt_binary_data(bin),
+                    mongocrypt_binary_len(bin));
+    mongocrypt_ctx_destroy(ctx);
+
+    /* Invalid options. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_FAILS(mongocrypt_ctx_setopt_decrypt_paths(ctx, TEST_BSON("{'paths': 'x'}")), ctx, "must be an array");
+    mongocrypt_ctx_destroy(ctx);
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_FAILS(mongocrypt_ctx_setopt_decrypt_paths(ctx, TEST_BSON("{'paths': ['a..b']}")),
+                 ctx,
+                 "invalid decrypt path");
+    mongocrypt_ctx_destroy(ctx);
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_decrypt_paths(ctx, TEST_BSON("{'paths': ['x']}")), ctx);
+    ASSERT_FAILS(mongocrypt_ctx_explicit_decrypt_init(ctx, TEST_BSON("{'v': {'$binary': {'base64': 'AQ==', "
+                                                                     "'subType': '06'}}}")),
+                 ctx,
+                 "decrypt paths are prohibited");
+    mongocrypt_ctx_destroy(ctx);
+
+    mongocrypt_binary_destroy(doc_bin);
+    bson_destroy(&doc);
+    mongocrypt_binary_destroy(bin);
+    mongocrypt_destroy(crypt);
+}
+
+static void _test_decrypt_plan(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_decrypt_plan_t *plan;
+    mongocrypt_binary_t *bin, *doc_bin;
+    bson_t doc = BSON_INITIALIZER;
+    bson_t child, cursor, batch, elem;
+
+    bin = mongocrypt_binary_new();
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+
+    /* {'cursor': {'nextBatch': [{'x': <a>, 'y': {'z': <b>}}]}} */
+    ASSERT(BSON_APPEND_DOCUMENT_BEGIN(&doc, "cursor", &cursor));
+    ASSERT(BSON_APPEND_ARRAY_BEGIN(&cursor, "nextBatch", &batch));
+    ASSERT(BSON_APPEND_DOCUMENT_BEGIN(&batch, "0", &elem));
+    _append_random_ciphertext(tester, crypt, &elem, "x", "a");
+    ASSERT(BSON_APPEND_DOCUMENT_BEGIN(&elem, "y", &child));
+    _append_random_ciphertext(tester, crypt, &child, "z", "b");
+    ASSERT(bson_append_document_end(&elem, &child));
+    ASSERT(bson_append_document_end(&batch, &elem));
+    ASSERT(bson_append_array_end(&cursor, &batch));
+    ASSERT(bson_append_document_end(&doc, &cursor));
+    doc_bin = mongocrypt_binary_new_from_data((uint8_t *)bson_get_data(&doc), doc.len);
+
+    /* The first reply fills the plan, and later replies reuse it. Each reply
+     * decrypts as without a plan. */
+    plan = mongocrypt_decrypt_plan_new();
+    for (int i = 0; i < 2; i++) {
+        ctx = mongocrypt_ctx_new(crypt);
+        ASSERT_OK(mongocrypt_ctx_setopt_decrypt_plan(ctx, plan), ctx);
+        ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, doc_bin), ctx);
+        ASSERT_CMPSIZE_T(((_mongocrypt_ctx_decrypt_t *)ctx)->ciphertext_offsets.len, ==, 2);
+        _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+        ASSERT_OK(mongocrypt_ctx_finalize(ctx, bin), ctx);
+        ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_BSON("{'cursor': {'nextBatch': [{'x': 'a', 'y': {'z': 'b'}}]}}"),
+                                            bin);
+        mongocrypt_ctx_destroy(ctx);
+    }
+
+    /* A reply without ciphertexts needs no keys, even with a filled plan. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_decrypt_plan(ctx, plan), ctx);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_BSON("{'cursor': {'nextBatch': [{'x': 1}]}}")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    mongocrypt_ctx_destroy(ctx);
+
+    /* Invalid options. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_FAILS(mongocrypt_ctx_setopt_decrypt_plan(ctx, NULL), ctx, "option must be non-NULL");
+    mongocrypt_ctx_destroy(ctx);
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_decrypt_plan(ctx, plan), ctx);
+    ASSERT_FAILS(mongocrypt_ctx_explicit_decrypt_init(ctx, TEST_BSON("{'v': {'$binary': {'base64': 'AQ==', "
+                                                                     "'subType': '06'}}}")),
+                 ctx,
+                 "decrypt plan is prohibited");
+    mongocrypt_ctx_destroy(ctx);
+
+    mongocrypt_decrypt_plan_destroy(plan);
+    mongocrypt_binary_destroy(doc_bin);
+    bson_destroy(&doc);
+    mongocrypt_binary_destroy(bin);
+    mongocrypt_destroy(crypt);
+}
+
+static void _test_decrypt_value_at(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *bin, *doc_bin;
+    bson_t doc = BSON_INITIALIZER;
+    bson_t child, index;
+    bson_iter_t iter;
+    uint32_t offsets[2];
+    _mongocrypt_buffer_t key_id, expected_key_id;
+
+    bin = mongocrypt_binary_new();
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+
+    /* {'x': <a>, 'y': {'z': <b>}} */
+    _append_random_ciphertext(tester, crypt, &doc, "x", "a");
+    ASSERT(BSON_APPEND_DOCUMENT_BEGIN(&doc, "y", &child));
+    _append_random_ciphertext(tester, crypt, &child, "z", "b");
+    ASSERT(bson_append_document_end(&doc, &child));
+    doc_bin = mongocrypt_binary_new_from_data((uint8_t *)bson_get_data(&doc), doc.len);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, doc_bin), ctx);
+    ASSERT_FAILS(mongocrypt_ctx_decrypt_index(ctx, bin), ctx, "wrong state");
+    mongocrypt_ctx_destroy(ctx);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, doc_bin), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+
+    /* The index has the offset and key ID of each value, in order. */
+    ASSERT_OK(mongocrypt_ctx_decrypt_index(ctx, bin), ctx);
+    ASSERT(_mongocrypt_binary_to_bson(bin, &index));
+    _mongocrypt_buffer_copy_from_hex(&expected_key_id, "61616161616161616161616161616161");
+    for (size_t i = 0; i < 2; i++) {
+        char path[32];
+
+        ASSERT(bson_iter_init(&iter, &index));
+        ASSERT(0 < bson_snprintf(path, sizeof path, "values.%zu.offset", i));
+        ASSERT(bson_iter_find_descendant(&iter, path, &iter));
+        offsets[i] = (uint32_t)bson_iter_int64(&iter);
+        ASSERT(bson_iter_init(&iter, &index));
+        ASSERT(0 < bson_snprintf(path, sizeof path, "values.%zu.keyId", i));
+        ASSERT(bson_iter_find_descendant(&iter, path, &iter));
+        ASSERT(_mongocrypt_buffer_from_uuid_iter(&key_id, &iter));
+        ASSERT_CMPBUF(expected_key_id, key_id);
+    }
+    ASSERT(bson_iter_init(&iter, &index));
+    ASSERT(!bson_iter_find_descendant(&iter, "values.2", &iter));
+    ASSERT_CMPUINT32(offsets[0], <, offsets[1]);
+    ASSERT_CMPUINT32(offsets[1], <, doc.len);
+
+    /* Values are decrypted on request. */
+    ASSERT_OK(mongocrypt_ctx_decrypt_value_at(ctx, offsets[1], bin), ctx);
+    ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_BSON("{'v': 'b'}"), bin);
+    ASSERT_OK(mongocrypt_ctx_decrypt_value_at(ctx, offsets[0], bin), ctx);
+    ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_BSON("{'v': 'a'}"), bin);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+
+    /* The document can still be finalized. */
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, bin), ctx);
+    ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_BSON("{'x': 'a', 'y': {'z': 'b'}}"), bin);
+    mongocrypt_ctx_destroy(ctx);
+
+    /* Only offsets of the index can be decrypted. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, doc_bin), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    ASSERT_FAILS(mongocrypt_ctx_decrypt_value_at(ctx, offsets[0] + 1u, bin), ctx, "no ciphertext to decrypt at offset");
+    mongocrypt_ctx_destroy(ctx);
+
+    _mongocrypt_buffer_cleanup(&expected_key_id);
+    mongocrypt_binary_destroy(doc_bin);
+    bson_destroy(&doc);
+    mongocrypt_binary_destroy(bin);
+    mongocrypt_destroy(crypt);
+}
+
+static void _test_decrypt_projected_keys(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *bin;
+    mongocrypt_binary_t *projected_bin;
+    bson_t key_doc;
+    bson_t projected = BSON_INITIALIZER;
+
+    /* The key document as returned with the projection. */
+    ASSERT(_mongocrypt_binary_to_bson(TEST_FILE("./test/example/key-document.json"), &key_doc));
+    bson_copy_to_excluding_noinit(&key_doc, &projected, "status", "creationDate", "updateDate", NULL);
+    projected_bin = mongocrypt_binary_new_from_data((uint8_t *)bson_get_data(&projected), projected.len);
+    bin = mongocrypt_binary_new();
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+
+    /* Without the projection, key documents are validated in full. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+    ASSERT_FAILS(mongocrypt_ctx_mongo_feed(ctx, projected_bin), ctx, "invalid key, no 'status'");
+    mongocrypt_ctx_destroy(ctx);
+
+    /* With the projection, only the fields used are required. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+    ASSERT_OK(mongocrypt_ctx_mongo_op_projection(ctx, bin), ctx);
+    ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_BSON("{'_id': 1, 'keyAltNames': 1, 'keyMaterial': 1, 'masterKey': 1}"),
+                                        bin);
+    ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx, projected_bin), ctx);
+    ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_DONE);
+    mongocrypt_ctx_destroy(ctx);
+
+    /* The projection only applies to key documents. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_DONE);
+    ASSERT_FAILS(mongocrypt_ctx_mongo_op_projection(ctx, bin), ctx, "wrong state");
+    mongocrypt_ctx_destroy(ctx);
+
+    mongocrypt_destroy(crypt);
+    mongocrypt_binary_destroy(bin);
+    mongocrypt_binary_destroy(projected_bin);
+    bson_destroy(&projected);
+}
+
+static void _test_decrypt_key_vault_snapshot(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    uint8_t local_kek_raw[MONGOCRYPT_KEY_LEN] = {0};
+    char *local_kek = kms_message_raw_to_b64(local_kek_raw, sizeof(local_kek_raw));
+    _mongocrypt_buffer_t local_uuid_buf;
+    uint8_t truncated_data[] = {0x10, 0x00, 0x00, 0x00, 0x00};
+    mongocrypt_binary_t *truncated;
+
+    /* Keys in the snapshot are not requested from the key vault. */
+    crypt = mongocrypt_new();
+    mongocrypt_setopt_kms_providers(crypt,
+                                    TEST_BSON("{'aws': {'accessKeyId': 'example', 'secretAccessKey': 'example'}}"));
+    ASSERT_OK(mongocrypt_setopt_key_vault_snapshot(crypt, TEST_FILE("./test/example/key-document.json")), crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_KMS);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_DONE);
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_destroy(crypt);
+
+    /* Keys are also found by keyAltName. */
+    crypt = mongocrypt_new();
+    mongocrypt_setopt_kms_providers(crypt,
+                                    TEST_BSON("{'aws': {'accessKeyId': 'example', 'secretAccessKey': 'example'}}"));
+    ASSERT_OK(mongocrypt_setopt_key_vault_snapshot(crypt, TEST_FILE("./test/data/key-document-with-alt-name.json")),
+              crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_key_alt_name(ctx, TEST_BSON("{'keyAltName': 'Kasey'}")), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx, MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR, -1), ctx);
+    ASSERT_OK(mongocrypt_ctx_explicit_encrypt_init(ctx, TEST_BSON("{'v': 'foo'}")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_KMS);
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_destroy(crypt);
+
+    /* Keys not in the snapshot are requested. */
+    crypt = mongocrypt_new();
+    mongocrypt_setopt_kms_providers(crypt,
+                                    TEST_BSON("{'aws': {'accessKeyId': 'example', 'secretAccessKey': 'example'}}"));
+    ASSERT_OK(mongocrypt_setopt_key_vault_snapshot(crypt, TEST_FILE("./test/data/key-document-full.json")), crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_destroy(crypt);
+
+    /* With on-demand credentials, keys are added once credentials are
+     * provided. The local key is decrypted without a KMS request. */
+    crypt = mongocrypt_new();
+    mongocrypt_setopt_use_need_kms_credentials_state(crypt);
+    mongocrypt_setopt_kms_providers(crypt, TEST_BSON("{'local': {}}"));
+    ASSERT_OK(mongocrypt_setopt_key_vault_snapshot(crypt, TEST_FILE("./test/data/key-document-local.json")), crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+    ctx = mongocrypt_ctx_new(crypt);
+    _mongocrypt_buffer_copy_from_hex(&local_uuid_buf, "61616161616161616161616161616161");
+    ASSERT_OK(mongocrypt_ctx_setopt_key_id(ctx, _mongocrypt_buffer_as_binary(&local_uuid_buf)), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx, MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR, -1), ctx);
+    ASSERT_OK(mongocrypt_ctx_explicit_encrypt_init(ctx, TEST_BSON("{'v': 'foo'}")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS);
+    ASSERT_OK(mongocrypt_ctx_provide_kms_providers(ctx,
+                                                   TEST_BSON("{'local':{'key': { '$binary': {'base64': '%s', "
+                                                             "'subType': '00'}}}}",
+                                                             local_kek)),
+              ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_destroy(crypt);
+
+    /* The snapshot must be a sequence of key documents. */
+    crypt = mongocrypt_new();
+    ASSERT_OK(mongocrypt_setopt_key_vault_snapshot(crypt, TEST_BSON("{'a': 1}")), crypt);
+    ASSERT_FAILS(_mongocrypt_init_for_test(crypt), crypt, "unrecognized field 'a'");
+    mongocrypt_destroy(crypt);
+
+    crypt = mongocrypt_new();
+    truncated = mongocrypt_binary_new_from_data(truncated_data, sizeof(truncated_data));
+    ASSERT_OK(mongocrypt_setopt_key_vault_snapshot(crypt, truncated), crypt);
+    ASSERT_FAILS(_mongocrypt_init_for_test(crypt), crypt, "invalid key vault snapshot: malformed BSON at offset 0");
+    mongocrypt_binary_destroy(truncated);
+    mongocrypt_destroy(crypt);
+
+    crypt = mongocrypt_new();
+    ASSERT_FAILS(mongocrypt_setopt_key_vault_snapshot(crypt, NULL), crypt, "passed null key vault snapshot");
+    mongocrypt_destroy(crypt);
+
+    _mongocrypt_buffer_cleanup(&local_uuid_buf);
+    bson_free(local_kek);
+}
+
 static void _test_decrypt_per_ctx_credentials(_mongocrypt_tester_t *tester) {
     mongocrypt_t *crypt;
     mongocrypt_ctx_t *ctx;
@@ -270,6 +1157,63 @@ static void _test_decrypt_per_ctx_credentials_local(_mongocrypt_tester_t *tester
     bson_free(local_kek);
 }
 
+static void _test_decrypt_cached_credentials(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx1, *ctx2;
+    /* local_kek is the KEK used to encrypt the keyMaterial in
+     * ./test/data/key-document-local.json */
+    uint8_t local_kek_raw[MONGOCRYPT_KEY_LEN] = {0};
+    char *local_kek = kms_message_raw_to_b64(local_kek_raw, sizeof(local_kek_raw));
+    _mongocrypt_buffer_t local_uuid_buf;
+
+    _mongocrypt_buffer_copy_from_hex(&local_uuid_buf, "61616161616161616161616161616161");
+
+    for (int cache = 0; cache <= 1; cache++) {
+        crypt = mongocrypt_new();
+        mongocrypt_setopt_use_need_kms_credentials_state(crypt);
+        mongocrypt_setopt_kms_providers(crypt, TEST_BSON("{'local': {}}"));
+        if (cache) {
+            ASSERT_OK(mongocrypt_setopt_kms_credentials_cache_expiration_ms(crypt, 60 * 1000), crypt);
+        }
+        ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+
+        ctx1 = mongocrypt_ctx_new(crypt);
+        ASSERT_OK(mongocrypt_ctx_setopt_key_id(ctx1, _mongocrypt_buffer_as_binary(&local_uuid_buf)), ctx1);
+        ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx1, MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR, -1), ctx1);
+        ASSERT_OK(mongocrypt_ctx_explicit_encrypt_init(ctx1, TEST_BSON("{'v': 'foo'}")), ctx1);
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx1), MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS);
+        ASSERT_OK(mongocrypt_ctx_provide_kms_providers(ctx1,
+                                                       TEST_BSON("{'local':{'key': { '$binary': {'base64': '%s', "
+                                                                 "'subType': '00'}}}}",
+                                                                 local_kek)),
+                  ctx1);
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx1), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+
+        /* The key is not cached yet, so a second context needs the key
+         * document. It only needs credentials without the cache. */
+        ctx2 = mongocrypt_ctx_new(crypt);
+        ASSERT_OK(mongocrypt_ctx_setopt_key_id(ctx2, _mongocrypt_buffer_as_binary(&local_uuid_buf)), ctx2);
+        ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx2, MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR, -1), ctx2);
+        ASSERT_OK(mongocrypt_ctx_explicit_encrypt_init(ctx2, TEST_BSON("{'v': 'foo'}")), ctx2);
+        if (!cache) {
+            ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx2), MONGOCRYPT_CTX_NEED_KMS_CREDENTIALS);
+        } else {
+            ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx2), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+            /* The cached credentials decrypt the key. */
+            ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx2, TEST_FILE("./test/data/key-document-local.json")), ctx2);
+            ASSERT_OK(mongocrypt_ctx_mongo_done(ctx2), ctx2);
+            ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx2), MONGOCRYPT_CTX_READY);
+        }
+
+        mongocrypt_ctx_destroy(ctx2);
+        mongocrypt_ctx_destroy(ctx1);
+        mongocrypt_destroy(crypt);
+    }
+
+    _mongocrypt_buffer_cleanup(&local_uuid_buf);
+    bson_free(local_kek);
+}
+
 static void _test_decrypt_fle2(_mongocrypt_tester_t *tester) {
     _mongocrypt_buffer_t S_KeyId;
     _mongocrypt_buffer_t K_KeyId;
@@ -518,9 +1462,128 @@ static void _test_decrypt_fle2(_mongocrypt_tester_t *tester) {
                                                       "document.json")),
                   ctx);
         ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
-        /* The second transition to MONGOCRYPT_CTX_NEED_MONGO_KEYS requests K_Key.
-         */
+        /* The second transition to MONGOCRYPT_CTX_NEED_MONGO_KEYS requests K_Key.
+         */
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+        ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx,
+                                            TEST_FILE("./test/data/keys/"
+                                                      "ABCDEFAB123498761234123456789012-local-"
+                                                      "document.json")),
+                  ctx);
+        ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+        mongocrypt_ctx_destroy(ctx);
+
+        /* Create a new ctx. S_Key and K_Key are cached in crypt. */
+        ctx = mongocrypt_ctx_new(crypt);
+        ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx,
+                                              TEST_BSON("{'plainText':'sample','encrypted':{'$binary':{'base64':"
+                                                        "'" TEST_IEEV_BASE64 "','subType':'6'}}}")),
+                  ctx);
+        out = mongocrypt_binary_new();
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+        ASSERT_OK(mongocrypt_ctx_finalize(ctx, out), ctx);
+        ASSERT(_mongocrypt_binary_to_bson(out, &out_bson));
+        _assert_match_bson(&out_bson, TMP_BSON("{'plainText': 'sample', 'encrypted': 'value123'}"));
+        mongocrypt_binary_destroy(out);
+        mongocrypt_ctx_destroy(ctx);
+        mongocrypt_destroy(crypt);
+    }
+
+    /* Test K_Key is fetched with S_Key once the K_KeyId of S_KeyId is known. */
+    {
+        mongocrypt_t *crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+        mongocrypt_ctx_t *ctx;
+        mongocrypt_binary_t *out;
+        bson_t out_bson;
+
+        ctx = mongocrypt_ctx_new(crypt);
+        ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx,
+                                              TEST_BSON("{'plainText':'sample','encrypted':{'$binary':{'base64':"
+                                                        "'" TEST_IEEV_BASE64 "','subType':'6'}}}")),
+                  ctx);
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+        ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx,
+                                            TEST_FILE("./test/data/keys/"
+                                                      "12345678123498761234123456789012-local-"
+                                                      "document.json")),
+                  ctx);
+        ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+        ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx,
+                                            TEST_FILE("./test/data/keys/"
+                                                      "ABCDEFAB123498761234123456789012-local-"
+                                                      "document.json")),
+                  ctx);
+        ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+        mongocrypt_ctx_destroy(ctx);
+
+        /* Clear the key cache. The K_KeyId of S_KeyId is still known. */
+        _mongocrypt_cache_cleanup(&crypt->cache_key);
+        _mongocrypt_cache_key_init(&crypt->cache_key);
+
+        ctx = mongocrypt_ctx_new(crypt);
+        ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx,
+                                              TEST_BSON("{'plainText':'sample','encrypted':{'$binary':{'base64':"
+                                                        "'" TEST_IEEV_BASE64 "','subType':'6'}}}")),
+                  ctx);
+        /* The only transition to MONGOCRYPT_CTX_NEED_MONGO_KEYS requests S_Key
+         * and K_Key. */
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+        {
+            mongocrypt_binary_t *filter = mongocrypt_binary_new();
+            ASSERT_OK(mongocrypt_ctx_mongo_op(ctx, filter), ctx);
+            ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(
+                TEST_BSON("{'$or': [{'_id': {'$in': [{'$binary': {'base64': 'q83vqxI0mHYSNBI0VniQEg==', 'subType': "
+                          "'04'}}, {'$binary': {'base64': 'EjRWeBI0mHYSNBI0VniQEg==', 'subType': '04'}}]}}, "
+                          "{'keyAltNames': {'$in': []}}]}"),
+                filter);
+            mongocrypt_binary_destroy(filter);
+        }
+        ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx,
+                                            TEST_FILE("./test/data/keys/"
+                                                      "12345678123498761234123456789012-local-"
+                                                      "document.json")),
+                  ctx);
+        ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx,
+                                            TEST_FILE("./test/data/keys/"
+                                                      "ABCDEFAB123498761234123456789012-local-"
+                                                      "document.json")),
+                  ctx);
+        ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+        out = mongocrypt_binary_new();
+        ASSERT_OK(mongocrypt_ctx_finalize(ctx, out), ctx);
+        ASSERT(_mongocrypt_binary_to_bson(out, &out_bson));
+        _assert_match_bson(&out_bson, TMP_BSON("{'plainText': 'sample', 'encrypted': 'value123'}"));
+        mongocrypt_binary_destroy(out);
+        mongocrypt_ctx_destroy(ctx);
+
+        /* Clear the key cache again. A prefetched K_Key that is not found is
+         * requested again once S_Key is available. */
+        _mongocrypt_cache_cleanup(&crypt->cache_key);
+        _mongocrypt_cache_key_init(&crypt->cache_key);
+
+        ctx = mongocrypt_ctx_new(crypt);
+        ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx,
+                                              TEST_BSON("{'plainText':'sample','encrypted':{'$binary':{'base64':"
+                                                        "'" TEST_IEEV_BASE64 "','subType':'6'}}}")),
+                  ctx);
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+        ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx,
+                                            TEST_FILE("./test/data/keys/"
+                                                      "12345678123498761234123456789012-local-"
+                                                      "document.json")),
+                  ctx);
+        ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
         ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+        {
+            mongocrypt_binary_t *filter = mongocrypt_binary_new();
+            ASSERT_OK(mongocrypt_ctx_mongo_op(ctx, filter), ctx);
+            ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_FILE("./test/data/fle2-decrypt-ieev/second-filter.json"), filter);
+            mongocrypt_binary_destroy(filter);
+        }
         ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx,
                                             TEST_FILE("./test/data/keys/"
                                                       "ABCDEFAB123498761234123456789012-local-"
@@ -528,16 +1591,7 @@ static void _test_decrypt_fle2(_mongocrypt_tester_t *tester) {
                   ctx);
         ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
         ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
-        mongocrypt_ctx_destroy(ctx);
-
-        /* Create a new ctx. S_Key and K_Key are cached in crypt. */
-        ctx = mongocrypt_ctx_new(crypt);
-        ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx,
-                                              TEST_BSON("{'plainText':'sample','encrypted':{'$binary':{'base64':"
-                                                        "'" TEST_IEEV_BASE64 "','subType':'6'}}}")),
-                  ctx);
         out = mongocrypt_binary_new();
-        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
         ASSERT_OK(mongocrypt_ctx_finalize(ctx, out), ctx);
         ASSERT(_mongocrypt_binary_to_bson(out, &out_bson));
         _assert_match_bson(&out_bson, TMP_BSON("{'plainText': 'sample', 'encrypted': 'value123'}"));
@@ -940,15 +1994,776 @@ static void _test_explicit_decrypt_fle2_iup_with_edges(_mongocrypt_tester_t *tes
     mongocrypt_destroy(crypt);
 }
 
+static void _test_decrypt_coalesce_kms(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *owner, *waiter;
+    mongocrypt_kms_ctx_t *kms;
+
+    crypt = mongocrypt_new();
+    ASSERT_OK(mongocrypt_setopt_kms_provider_aws(crypt, "example", -1, "example", -1), crypt);
+    ASSERT_OK(mongocrypt_setopt_coalesce_kms_decrypts(crypt), crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+
+    /* The first context to need the key owns the KMS request. */
+    owner = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(owner, TEST_FILE("./test/data/encrypted-cmd.json")), owner);
+    _mongocrypt_tester_run_ctx_to(tester, owner, MONGOCRYPT_CTX_NEED_KMS);
+
+    /* The second waits on it without a KMS request. */
+    waiter = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(waiter, TEST_FILE("./test/data/encrypted-cmd.json")), waiter);
+    _mongocrypt_tester_run_ctx_to(tester, waiter, MONGOCRYPT_CTX_NEED_KMS);
+    ASSERT(!mongocrypt_ctx_next_kms_ctx(waiter));
+    ASSERT_OK(mongocrypt_ctx_kms_done(waiter), waiter);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(waiter), MONGOCRYPT_CTX_NEED_KMS);
+
+    /* Once the owner is done, the waiter uses the cached key. */
+    _mongocrypt_tester_run_ctx_to(tester, owner, MONGOCRYPT_CTX_DONE);
+    ASSERT(!mongocrypt_ctx_next_kms_ctx(waiter));
+    ASSERT_OK(mongocrypt_ctx_kms_done(waiter), waiter);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(waiter), MONGOCRYPT_CTX_READY);
+    _mongocrypt_tester_run_ctx_to(tester, waiter, MONGOCRYPT_CTX_DONE);
+    mongocrypt_ctx_destroy(waiter);
+    mongocrypt_ctx_destroy(owner);
+    mongocrypt_destroy(crypt);
+
+    /* If the owner is destroyed, the waiter issues its own request. */
+    crypt = mongocrypt_new();
+    ASSERT_OK(mongocrypt_setopt_kms_provider_aws(crypt, "example", -1, "example", -1), crypt);
+    ASSERT_OK(mongocrypt_setopt_coalesce_kms_decrypts(crypt), crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+
+    owner = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(owner, TEST_FILE("./test/data/encrypted-cmd.json")), owner);
+    _mongocrypt_tester_run_ctx_to(tester, owner, MONGOCRYPT_CTX_NEED_KMS);
+    waiter = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(waiter, TEST_FILE("./test/data/encrypted-cmd.json")), waiter);
+    _mongocrypt_tester_run_ctx_to(tester, waiter, MONGOCRYPT_CTX_NEED_KMS);
+    ASSERT(!mongocrypt_ctx_next_kms_ctx(waiter));
+    mongocrypt_ctx_destroy(owner);
+    ASSERT_OK(mongocrypt_ctx_kms_done(waiter), waiter);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(waiter), MONGOCRYPT_CTX_NEED_KMS);
+    kms = mongocrypt_ctx_next_kms_ctx(waiter);
+    ASSERT(kms);
+    _mongocrypt_tester_satisfy_kms(tester, kms);
+    ASSERT(!mongocrypt_ctx_next_kms_ctx(waiter));
+    ASSERT_OK(mongocrypt_ctx_kms_done(waiter), waiter);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(waiter), MONGOCRYPT_CTX_READY);
+    _mongocrypt_tester_run_ctx_to(tester, waiter, MONGOCRYPT_CTX_DONE);
+    mongocrypt_ctx_destroy(waiter);
+    mongocrypt_destroy(crypt);
+}
+
+typedef struct {
+    _mongocrypt_buffer_t snapshot;
+    int loads;
+    int stores;
+} _shared_key_cache_t;
+
+static bool _shared_key_cache_load(void *ctx,
+                                   mongocrypt_binary_t *key_id,
+                                   mongocrypt_binary_t *out,
+                                   uint32_t *len,
+                                   mongocrypt_status_t *status) {
+    _shared_key_cache_t *shared = ctx;
+
+    shared->loads++;
+    *len = shared->snapshot.len;
+    if (*len <= mongocrypt_binary_len(out)) {
+        memcpy(mongocrypt_binary_data(out), shared->snapshot.data, shared->snapshot.len);
+    }
+    return true;
+}
+
+static bool _shared_key_cache_store(void *ctx,
+                                    mongocrypt_binary_t *key_id,
+                                    mongocrypt_binary_t *snapshot,
+                                    mongocrypt_status_t *status) {
+    _shared_key_cache_t *shared = ctx;
+
+    shared->stores++;
+    _mongocrypt_buffer_cleanup(&shared->snapshot);
+    _mongocrypt_buffer_copy_from_binary(&shared->snapshot, snapshot);
+    return true;
+}
+
+static mongocrypt_t *_shared_key_cache_mongocrypt(_shared_key_cache_t *shared, _mongocrypt_buffer_t *kek) {
+    mongocrypt_t *crypt = mongocrypt_new();
+
+    ASSERT_OK(mongocrypt_setopt_kms_provider_aws(crypt, "example", -1, "example", -1), crypt);
+    ASSERT_OK(mongocrypt_setopt_key_cache_shared_hooks(crypt,
+                                                       _mongocrypt_buffer_as_binary(kek),
+                                                       _shared_key_cache_load,
+                                                       _shared_key_cache_store,
+                                                       shared),
+              crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+    return crypt;
+}
+
+static void _test_decrypt_shared_key_cache(_mongocrypt_tester_t *tester) {
+    _shared_key_cache_t shared = {{0}};
+    _mongocrypt_buffer_t kek, wrong_kek;
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+
+    _mongocrypt_tester_fill_buffer(&kek, MONGOCRYPT_KEY_LEN);
+    _mongocrypt_buffer_copy_to(&kek, &wrong_kek);
+    wrong_kek.data[0] ^= 1;
+
+    crypt = mongocrypt_new();
+    ASSERT_FAILS(mongocrypt_setopt_key_cache_shared_hooks(crypt,
+                                                          _mongocrypt_buffer_as_binary(&kek),
+                                                          _shared_key_cache_load,
+                                                          NULL,
+                                                          &shared),
+                 crypt,
+                 "must both be set");
+    mongocrypt_destroy(crypt);
+
+    /* The first process decrypts the key with the KMS and stores it. */
+    crypt = _shared_key_cache_mongocrypt(&shared, &kek);
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_DONE);
+    ASSERT_CMPINT(shared.loads, ==, 1);
+    ASSERT_CMPINT(shared.stores, ==, 1);
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_destroy(crypt);
+
+    /* Another process loads it without fetching or decrypting it. */
+    crypt = _shared_key_cache_mongocrypt(&shared, &kek);
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_DONE);
+    ASSERT_CMPINT(shared.loads, ==, 2);
+    ASSERT_CMPINT(shared.stores, ==, 1);
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_destroy(crypt);
+
+    /* Snapshots cannot be read with another key. */
+    crypt = _shared_key_cache_mongocrypt(&shared, &wrong_kek);
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_FAILS(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")),
+                 ctx,
+                 "HMAC validation failure");
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_destroy(crypt);
+
+    _mongocrypt_buffer_cleanup(&shared.snapshot);
+    _mongocrypt_buffer_cleanup(&wrong_kek);
+    _mongocrypt_buffer_cleanup(&kek);
+}
+
+static bool _kms_message_has_connection_close(mongocrypt_kms_ctx_t *kms) {
+    mongocrypt_binary_t *msg = mongocrypt_binary_new();
+    bool found;
+
+    ASSERT_OK(mongocrypt_kms_ctx_message(kms, msg), kms);
+    found = NULL != strstr((const char *)mongocrypt_binary_data(msg), "\r\nConnection:close\r\n");
+    mongocrypt_binary_destroy(msg);
+    return found;
+}
+
+static void _test_decrypt_kms_keep_alive(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_kms_ctx_t *kms;
+
+    /* Connections are closed by default. */
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_NEED_KMS);
+    kms = mongocrypt_ctx_next_kms_ctx(ctx);
+    ASSERT(kms);
+    ASSERT(_kms_message_has_connection_close(kms));
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_destroy(crypt);
+
+    crypt = mongocrypt_new();
+    ASSERT_OK(mongocrypt_setopt_kms_provider_aws(crypt, "example", -1, "example", -1), crypt);
+    ASSERT_OK(mongocrypt_setopt_kms_keep_alive(crypt), crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_NEED_KMS);
+    kms = mongocrypt_ctx_next_kms_ctx(ctx);
+    ASSERT(kms);
+    ASSERT(!_kms_message_has_connection_close(kms));
+
+    /* The response is complete without the connection being closed. */
+    _mongocrypt_tester_satisfy_kms(tester, kms);
+    ASSERT_CMPUINT32(mongocrypt_kms_ctx_bytes_needed(kms), ==, 0);
+    ASSERT(!mongocrypt_ctx_next_kms_ctx(ctx));
+    ASSERT_OK(mongocrypt_ctx_kms_done(ctx), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_destroy(crypt);
+}
+
+/* _large_kms_response returns an AWS decrypt response for the key of
+ * ./test/data/encrypted-cmd.json, padded to more than 1024 bytes, followed by
+ * @extra. */
+static char *_large_kms_response(const char *extra) {
+    const char *body = "{\"KeyId\": "
+                       "\"arn:aws:kms:us-east-1:579766882180:key/89fcc2c4-08b0-4bd9-9f25-e30687b580d0\", "
+                       "\"Plaintext\": "
+                       "\"TqhXy3tKckECjy4/ZNykMWG8amBF46isVPzeOgeusKrwheBmYaU8TMG5AHR/NeUDKukqo8hBGgogiQOV"
+                       "pLPkqBQHD8YkLsNbDmHoGOill5QAHnniF/Lz405bGucB5TfR\"}";
+    char pad[2048];
+
+    memset(pad, 'a', sizeof(pad) - 1u);
+    pad[sizeof(pad) - 1u] = '\0';
+    return bson_strdup_printf("HTTP/1.1 200 OK\r\nx-pad: %s\r\nContent-Length: %d\r\n\r\n%s%s",
+                              pad,
+                              (int)strlen(body),
+                              body,
+                              extra);
+}
+
+static void _test_decrypt_kms_large_reads(_mongocrypt_tester_t *tester) {
+    char *response = _large_kms_response("");
+    char *too_long = _large_kms_response("HTTP/1.1");
+    mongocrypt_binary_t *bin;
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_kms_ctx_t *kms;
+
+    /* By default, at most 1024 bytes are read before the length is known. */
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_NEED_KMS);
+    kms = mongocrypt_ctx_next_kms_ctx(ctx);
+    ASSERT(kms);
+    ASSERT_CMPUINT32(mongocrypt_kms_ctx_bytes_needed(kms), ==, 1024);
+    bin = mongocrypt_binary_new_from_data((uint8_t *)response, (uint32_t)strlen(response));
+    ASSERT_FAILS(mongocrypt_kms_ctx_feed(kms, bin), kms, "KMS response fed too much data");
+    mongocrypt_binary_destroy(bin);
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_destroy(crypt);
+
+    crypt = mongocrypt_new();
+    ASSERT_OK(mongocrypt_setopt_kms_provider_aws(crypt, "example", -1, "example", -1), crypt);
+    ASSERT_OK(mongocrypt_setopt_kms_large_reads(crypt), crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+
+    /* The whole response is fed at once. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_NEED_KMS);
+    kms = mongocrypt_ctx_next_kms_ctx(ctx);
+    ASSERT(kms);
+    ASSERT_CMPUINT32(mongocrypt_kms_ctx_bytes_needed(kms), ==, 64 * 1024);
+    bin = mongocrypt_binary_new_from_data((uint8_t *)response, 1500u);
+    ASSERT_OK(mongocrypt_kms_ctx_feed(kms, bin), kms);
+    mongocrypt_binary_destroy(bin);
+    ASSERT_CMPUINT32(mongocrypt_kms_ctx_bytes_needed(kms), ==, 64 * 1024);
+    bin = mongocrypt_binary_new_from_data((uint8_t *)response + 1500, (uint32_t)strlen(response) - 1500u);
+    ASSERT_OK(mongocrypt_kms_ctx_feed(kms, bin), kms);
+    mongocrypt_binary_destroy(bin);
+    ASSERT_CMPUINT32(mongocrypt_kms_ctx_bytes_needed(kms), ==, 0);
+    ASSERT_OK(mongocrypt_ctx_kms_done(ctx), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    mongocrypt_ctx_destroy(ctx);
+
+    /* Bytes past the end of the response are still an error. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_NEED_KMS);
+    kms = mongocrypt_ctx_next_kms_ctx(ctx);
+    ASSERT(kms);
+    bin = mongocrypt_binary_new_from_data((uint8_t *)too_long, (uint32_t)strlen(too_long));
+    ASSERT_FAILS(mongocrypt_kms_ctx_feed(kms, bin), kms, "KMS response fed too much data");
+    mongocrypt_binary_destroy(bin);
+    mongocrypt_ctx_destroy(ctx);
+
+    mongocrypt_destroy(crypt);
+    bson_free(too_long);
+    bson_free(response);
+}
+
+static void _test_decrypt_retry_kms(_mongocrypt_tester_t *tester) {
+    const char *throttled = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n";
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_kms_ctx_t *kms;
+    mongocrypt_binary_t *bin;
+
+    bin = mongocrypt_binary_new_from_data((uint8_t *)throttled, (uint32_t)strlen(throttled));
+    crypt = mongocrypt_new();
+    ASSERT_OK(mongocrypt_setopt_kms_provider_aws(crypt, "example", -1, "example", -1), crypt);
+    ASSERT_OK(mongocrypt_setopt_retry_kms(crypt, true), crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_NEED_KMS);
+
+    /* A throttled response schedules the request again after a sleep. */
+    kms = mongocrypt_ctx_next_kms_ctx(ctx);
+    ASSERT(kms);
+    ASSERT_CMPINT64(mongocrypt_kms_ctx_usleep(kms), ==, 0);
+    ASSERT_OK(mongocrypt_kms_ctx_feed(kms, bin), kms);
+    ASSERT_CMPUINT32(mongocrypt_kms_ctx_bytes_needed(kms), ==, 0);
+    ASSERT_CMPINT64(mongocrypt_kms_ctx_usleep(kms), ==, 200 * 1000);
+    ASSERT(mongocrypt_ctx_next_kms_ctx(ctx) == kms);
+    ASSERT(!mongocrypt_ctx_next_kms_ctx(ctx));
+
+    /* A network error doubles the sleep. */
+    ASSERT_OK(mongocrypt_kms_ctx_fail(kms), kms);
+    ASSERT_CMPINT64(mongocrypt_kms_ctx_usleep(kms), ==, 400 * 1000);
+    ASSERT_OK(mongocrypt_ctx_kms_done(ctx), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_KMS);
+    ASSERT(mongocrypt_ctx_next_kms_ctx(ctx) == kms);
+
+    _mongocrypt_tester_satisfy_kms(tester, kms);
+    ASSERT(!mongocrypt_ctx_next_kms_ctx(ctx));
+    ASSERT_OK(mongocrypt_ctx_kms_done(ctx), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    mongocrypt_ctx_destroy(ctx);
+
+    /* Retries are limited. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_NEED_KMS);
+    kms = mongocrypt_ctx_next_kms_ctx(ctx);
+    ASSERT(kms);
+    ASSERT_OK(mongocrypt_kms_ctx_fail(kms), kms);
+    ASSERT_OK(mongocrypt_kms_ctx_fail(kms), kms);
+    ASSERT_OK(mongocrypt_kms_ctx_fail(kms), kms);
+    ASSERT_FAILS(mongocrypt_kms_ctx_fail(kms), kms, "KMS request failed after 3 retries");
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_destroy(crypt);
+    mongocrypt_binary_destroy(bin);
+}
+
+static void _test_decrypt_kms_rate_limit(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx1;
+    mongocrypt_ctx_t *ctx2;
+    mongocrypt_kms_ctx_t *kms;
+
+    crypt = mongocrypt_new();
+    ASSERT_FAILS(mongocrypt_setopt_kms_rate_limit(crypt, 1000001, 1), crypt, "must be at most 1000000");
+    mongocrypt_destroy(crypt);
+
+    crypt = mongocrypt_new();
+    ASSERT_OK(mongocrypt_setopt_kms_provider_aws(crypt, "example", -1, "example", -1), crypt);
+    ASSERT_OK(mongocrypt_setopt_kms_rate_limit(crypt, 1, 1), crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+
+    ctx1 = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx1, TEST_FILE("./test/data/encrypted-cmd.json")), ctx1);
+    _mongocrypt_tester_run_ctx_to(tester, ctx1, MONGOCRYPT_CTX_NEED_KMS);
+    ctx2 = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx2, TEST_FILE("./test/data/encrypted-cmd.json")), ctx2);
+    _mongocrypt_tester_run_ctx_to(tester, ctx2, MONGOCRYPT_CTX_NEED_KMS);
+
+    /* The first request to the endpoint is sent now. */
+    kms = mongocrypt_ctx_next_kms_ctx(ctx1);
+    ASSERT(kms);
+    ASSERT_CMPINT64(mongocrypt_kms_ctx_usleep(kms), ==, 0);
+
+    /* The second waits for the next slot, about one second later. */
+    kms = mongocrypt_ctx_next_kms_ctx(ctx2);
+    ASSERT(kms);
+    ASSERT_CMPINT64(mongocrypt_kms_ctx_usleep(kms), >, 900 * 1000);
+    ASSERT_CMPINT64(mongocrypt_kms_ctx_usleep(kms), <=, 1000 * 1000);
+
+    mongocrypt_ctx_destroy(ctx2);
+    mongocrypt_ctx_destroy(ctx1);
+    mongocrypt_destroy(crypt);
+}
+
+static void _test_decrypt_deadline(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_kms_ctx_t *kms;
+    mongocrypt_binary_t *bin;
+
+    crypt = mongocrypt_new();
+    ASSERT_OK(mongocrypt_setopt_kms_provider_aws(crypt, "example", -1, "example", -1), crypt);
+    ASSERT_OK(mongocrypt_setopt_retry_kms(crypt, true), crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_CMPINT64(mongocrypt_ctx_remaining_us(ctx), ==, -1);
+    ASSERT_FAILS(mongocrypt_ctx_setopt_deadline(ctx, 0), ctx, "invalid deadline");
+    mongocrypt_ctx_destroy(ctx);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+    ASSERT_FAILS(mongocrypt_ctx_setopt_deadline(ctx, 1000), ctx, "cannot set options after init");
+    mongocrypt_ctx_destroy(ctx);
+
+    /* KMS requests share the budget of the context. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_deadline(ctx, 60 * 1000), ctx);
+    ASSERT_CMPINT64(mongocrypt_ctx_remaining_us(ctx), >, 0);
+    ASSERT_CMPINT64(mongocrypt_ctx_remaining_us(ctx), <=, 60 * 1000 * 1000);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_NEED_KMS);
+    kms = mongocrypt_ctx_next_kms_ctx(ctx);
+    ASSERT(kms);
+    ASSERT_CMPINT64(mongocrypt_kms_ctx_remaining_us(kms), >, 0);
+    ASSERT_CMPINT64(mongocrypt_kms_ctx_remaining_us(kms), <=, mongocrypt_ctx_remaining_us(ctx));
+
+    /* A retry is not scheduled if its backoff would pass the deadline. */
+    kms->deadline_us = bson_get_monotonic_time() + 100 * 1000;
+    ASSERT_FAILS(mongocrypt_kms_ctx_fail(kms), kms, "deadline leaves no time to retry");
+    mongocrypt_ctx_destroy(ctx);
+
+    /* A response is not read after the deadline. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_deadline(ctx, 60 * 1000), ctx);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_NEED_KMS);
+    kms = mongocrypt_ctx_next_kms_ctx(ctx);
+    ASSERT(kms);
+    kms->deadline_us = 1;
+    ASSERT_CMPINT64(mongocrypt_kms_ctx_remaining_us(kms), ==, 0);
+    bin = TEST_FILE("./test/example/kms-decrypt-reply.txt");
+    ASSERT_FAILS(mongocrypt_kms_ctx_feed(kms, bin), kms, "deadline exceeded");
+
+    /* The context fails once it observes the deadline. */
+    ctx->deadline_us = 1;
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_ERROR);
+    ASSERT_FAILS(mongocrypt_ctx_kms_done(ctx), ctx, "deadline exceeded");
+    mongocrypt_ctx_destroy(ctx);
+
+    /* A ready context only has local work left and is not failed. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_deadline(ctx, 60 * 1000), ctx);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    ctx->deadline_us = 1;
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    bin = mongocrypt_binary_new();
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, bin), ctx);
+    mongocrypt_binary_destroy(bin);
+    mongocrypt_ctx_destroy(ctx);
+
+    mongocrypt_destroy(crypt);
+}
+
+static void _test_decrypt_hedge_kms(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_kms_ctx_t *kms;
+    mongocrypt_kms_ctx_t *hedge;
+    mongocrypt_binary_t *msg;
+    const char *endpoint;
+
+    crypt = mongocrypt_new();
+    ASSERT_FAILS(mongocrypt_setopt_kms_hedge(crypt, TEST_BSON("{'gcp': ['example.com']}"), 0),
+                 crypt,
+                 "only supported for aws and kmip");
+    ASSERT_FAILS(mongocrypt_setopt_kms_hedge(crypt, TEST_BSON("{'aws': 'example.com'}"), 0),
+                 crypt,
+                 "expected array of endpoints");
+    mongocrypt_destroy(crypt);
+
+    msg = mongocrypt_binary_new();
+    crypt = mongocrypt_new();
+    ASSERT_OK(mongocrypt_setopt_kms_provider_aws(crypt, "example", -1, "example", -1), crypt);
+    ASSERT_OK(mongocrypt_setopt_kms_hedge(crypt,
+                                          TEST_BSON("{'aws': ['kms.us-east-1.amazonaws.com', "
+                                                    "'kms-fips.us-east-1.amazonaws.com']}"),
+                                          0),
+              crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_NEED_KMS);
+
+    /* A request is not hedged before it is sent. */
+    kms = mongocrypt_ctx_next_kms_ctx(ctx);
+    ASSERT(kms);
+    ASSERT(!mongocrypt_ctx_next_kms_ctx(ctx));
+
+    /* Once sent, the request is hedged to the first other endpoint. */
+    ASSERT_OK(mongocrypt_kms_ctx_message(kms, msg), kms);
+    hedge = mongocrypt_ctx_next_kms_ctx(ctx);
+    ASSERT(hedge && hedge != kms);
+    ASSERT_OK(mongocrypt_kms_ctx_endpoint(hedge, &endpoint), hedge);
+    ASSERT_STREQUAL(endpoint, "kms-fips.us-east-1.amazonaws.com:443");
+    ASSERT(!mongocrypt_ctx_next_kms_ctx(ctx));
+
+    /* The hedged request responds first. The original needs no more bytes. */
+    ASSERT_OK(mongocrypt_kms_ctx_message(hedge, msg), hedge);
+    ASSERT_OK(mongocrypt_kms_ctx_feed(hedge, TEST_FILE("./test/data/kms-aws/decrypt-response.txt")), hedge);
+    ASSERT_CMPUINT32(mongocrypt_kms_ctx_bytes_needed(kms), ==, 0);
+    ASSERT_OK(mongocrypt_kms_ctx_feed(kms, TEST_FILE("./test/data/kms-aws/decrypt-response.txt")), kms);
+    ASSERT_OK(mongocrypt_ctx_kms_done(ctx), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_DONE);
+
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_destroy(crypt);
+    mongocrypt_binary_destroy(msg);
+}
+
+typedef struct {
+    mongocrypt_kms_ctx_t *kms;
+    mongocrypt_binary_t *response;
+    bool ok;
+    int feeds;
+} _hedge_feeder_t;
+
+/* Feed the response of a request of a hedged pair a few bytes at a time, until
+ * it needs no more bytes. */
+static void _feed_hedge(void *arg) {
+    _hedge_feeder_t *feeder = arg;
+    uint32_t len = mongocrypt_binary_len(feeder->response);
+    uint32_t offset = 0;
+
+    feeder->ok = true;
+    while (feeder->ok && offset < len) {
+        mongocrypt_binary_t *chunk;
+        uint32_t n = mongocrypt_kms_ctx_bytes_needed(feeder->kms);
+
+        if (n == 0) {
+            break;
+        }
+        n = BSON_MIN(n, BSON_MIN(4u, len - offset));
+        chunk = mongocrypt_binary_new_from_data(mongocrypt_binary_data(feeder->response) + offset, n);
+        feeder->ok = mongocrypt_kms_ctx_feed(feeder->kms, chunk);
+        feeder->feeds++;
+        mongocrypt_binary_destroy(chunk);
+        offset += n;
+    }
+}
+
+/* Both requests of a hedged pair may be fed at once from separate threads. */
+static void _test_decrypt_hedge_kms_threads(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_binary_t *msg;
+
+    msg = mongocrypt_binary_new();
+    crypt = mongocrypt_new();
+    ASSERT_OK(mongocrypt_setopt_kms_provider_aws(crypt, "example", -1, "example", -1), crypt);
+    ASSERT_OK(mongocrypt_setopt_kms_hedge(crypt, TEST_BSON("{'aws': ['kms-fips.us-east-1.amazonaws.com']}"), 0),
+              crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+
+    for (int i = 0; i < 50; i++) {
+        mongocrypt_ctx_t *ctx = mongocrypt_ctx_new(crypt);
+        _hedge_feeder_t original = {0};
+        _hedge_feeder_t alternate = {0};
+        _mongocrypt_tester_thread_t *threads[2];
+
+        ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+        _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_NEED_KMS);
+
+        original.kms = mongocrypt_ctx_next_kms_ctx(ctx);
+        ASSERT(original.kms);
+        ASSERT_OK(mongocrypt_kms_ctx_message(original.kms, msg), original.kms);
+        alternate.kms = mongocrypt_ctx_next_kms_ctx(ctx);
+        ASSERT(alternate.kms && alternate.kms != original.kms);
+        ASSERT_OK(mongocrypt_kms_ctx_message(alternate.kms, msg), alternate.kms);
+        original.response = TEST_FILE("./test/data/kms-aws/decrypt-response.txt");
+        alternate.response = original.response;
+
+        threads[0] = _mongocrypt_tester_thread_start(_feed_hedge, &original);
+        threads[1] = _mongocrypt_tester_thread_start(_feed_hedge, &alternate);
+        _mongocrypt_tester_thread_join(threads[0]);
+        _mongocrypt_tester_thread_join(threads[1]);
+
+        ASSERT_OK(original.ok, original.kms);
+        ASSERT_OK(alternate.ok, alternate.kms);
+        ASSERT_CMPUINT32(mongocrypt_kms_ctx_bytes_needed(original.kms), ==, 0);
+        ASSERT_CMPUINT32(mongocrypt_kms_ctx_bytes_needed(alternate.kms), ==, 0);
+        ASSERT(!mongocrypt_ctx_next_kms_ctx(ctx));
+        ASSERT_OK(mongocrypt_ctx_kms_done(ctx), ctx);
+        _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_DONE);
+        mongocrypt_ctx_destroy(ctx);
+    }
+
+    mongocrypt_destroy(crypt);
+    mongocrypt_binary_destroy(msg);
+}
+
+/* Counts the kms_ctx_feed calls of the KMS contexts with record ids 0 and 1. */
+static void _count_kms_feeds(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *session, void *record_ctx) {
+    int *feeds = record_ctx;
+    bson_t bson;
+    bson_iter_t iter, events, event;
+    int events_len = 0;
+
+    ASSERT(ctx);
+    ASSERT(_mongocrypt_binary_to_bson(session, &bson));
+    ASSERT(bson_validate(&bson, BSON_VALIDATE_NONE, NULL));
+    ASSERT(bson_iter_init_find(&iter, &bson, "events"));
+    ASSERT(bson_iter_recurse(&iter, &events));
+    while (bson_iter_next(&events)) {
+        char key[16];
+
+        /* Events are appended under consecutive keys. */
+        ASSERT(bson_snprintf(key, sizeof(key), "%d", events_len++) > 0);
+        ASSERT_STREQUAL(bson_iter_key(&events), key);
+        ASSERT(bson_iter_recurse(&events, &event));
+        ASSERT(bson_iter_find(&event, "call"));
+        if (0 != strcmp(bson_iter_utf8(&event, NULL), "kms_ctx_feed")) {
+            continue;
+        }
+        ASSERT(bson_iter_recurse(&events, &event));
+        ASSERT(bson_iter_find(&event, "id"));
+        ASSERT(bson_iter_int32(&event) == 0 || bson_iter_int32(&event) == 1);
+        feeds[bson_iter_int32(&event)]++;
+    }
+}
+
+/* Calls on KMS contexts fed from separate threads are all recorded. */
+static void _test_decrypt_hedge_kms_record(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_binary_t *msg;
+
+    msg = mongocrypt_binary_new();
+    for (int i = 0; i < 50; i++) {
+        mongocrypt_ctx_t *ctx;
+        _hedge_feeder_t original = {0};
+        _hedge_feeder_t alternate = {0};
+        _mongocrypt_tester_thread_t *threads[2];
+        int feeds[2] = {0};
+
+        crypt = mongocrypt_new();
+        ASSERT_OK(mongocrypt_setopt_record_handler(crypt, _count_kms_feeds, feeds), crypt);
+        ASSERT_OK(mongocrypt_setopt_kms_provider_aws(crypt, "example", -1, "example", -1), crypt);
+        ASSERT_OK(mongocrypt_setopt_kms_hedge(crypt, TEST_BSON("{'aws': ['kms-fips.us-east-1.amazonaws.com']}"), 0),
+                  crypt);
+        ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+
+        ctx = mongocrypt_ctx_new(crypt);
+        ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+        _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_NEED_KMS);
+        original.kms = mongocrypt_ctx_next_kms_ctx(ctx);
+        ASSERT(original.kms);
+        ASSERT_OK(mongocrypt_kms_ctx_message(original.kms, msg), original.kms);
+        alternate.kms = mongocrypt_ctx_next_kms_ctx(ctx);
+        ASSERT(alternate.kms);
+        ASSERT_OK(mongocrypt_kms_ctx_message(alternate.kms, msg), alternate.kms);
+        original.response = TEST_FILE("./test/data/kms-aws/decrypt-response.txt");
+        alternate.response = original.response;
+
+        threads[0] = _mongocrypt_tester_thread_start(_feed_hedge, &original);
+        threads[1] = _mongocrypt_tester_thread_start(_feed_hedge, &alternate);
+        _mongocrypt_tester_thread_join(threads[0]);
+        _mongocrypt_tester_thread_join(threads[1]);
+        ASSERT_OK(original.ok, original.kms);
+        ASSERT_OK(alternate.ok, alternate.kms);
+        ASSERT_OK(mongocrypt_ctx_kms_done(ctx), ctx);
+        _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_DONE);
+        mongocrypt_ctx_destroy(ctx);
+
+        ASSERT_CMPINT(feeds[0], ==, original.feeds);
+        ASSERT_CMPINT(feeds[1], ==, alternate.feeds);
+        mongocrypt_destroy(crypt);
+    }
+    mongocrypt_binary_destroy(msg);
+}
+
+static void _test_explicit_value_roundtrip(_mongocrypt_tester_t *tester) {
+    /* The BSON encoding of the string "abc". */
+    uint8_t string_value[] = {4, 0, 0, 0, 'a', 'b', 'c', 0};
+    uint8_t truncated_value[] = {4, 0, 0, 0, 'a'};
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *value;
+    mongocrypt_binary_t ciphertext;
+    mongocrypt_binary_t *ciphertext_copy;
+    mongocrypt_binary_t out;
+    uint8_t type;
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+
+    /* A value not matching its type is rejected. */
+    value = mongocrypt_binary_new_from_data(truncated_value, sizeof(truncated_value));
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_key_alt_name(ctx, TEST_BSON("{'keyAltName': 'keyDocumentName'}")), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx, MONGOCRYPT_ALGORITHM_RANDOM_STR, -1), ctx);
+    ASSERT_FAILS(mongocrypt_ctx_explicit_encrypt_value_init(ctx, BSON_TYPE_UTF8, value),
+                 ctx,
+                 "value is not a valid BSON value");
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_binary_destroy(value);
+
+    /* Encrypt the value without a wrapping document. */
+    value = mongocrypt_binary_new_from_data(string_value, sizeof(string_value));
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_key_alt_name(ctx, TEST_BSON("{'keyAltName': 'keyDocumentName'}")), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx, MONGOCRYPT_ALGORITHM_RANDOM_STR, -1), ctx);
+    ASSERT_OK(mongocrypt_ctx_explicit_encrypt_value_init(ctx, BSON_TYPE_UTF8, value), ctx);
+    mongocrypt_binary_destroy(value);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_finalize_value(ctx, &ciphertext, &type), ctx);
+    ASSERT_CMPINT(type, ==, BSON_TYPE_BINARY);
+    ASSERT_CMPINT(((uint8_t *)ciphertext.data)[0], ==, MC_SUBTYPE_FLE1RandomEncryptedValue);
+    /* A second call returns the same view. */
+    ASSERT_OK(mongocrypt_ctx_finalize_value(ctx, &out, &type), ctx);
+    ASSERT(out.data == ciphertext.data && out.len == ciphertext.len);
+    ciphertext_copy = mongocrypt_binary_new_from_data(ciphertext.data, ciphertext.len);
+    mongocrypt_ctx_destroy(ctx);
+
+    /* Decrypt the ciphertext back to the value. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_explicit_decrypt_value_init(ctx, ciphertext_copy), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_finalize_value(ctx, &out, &type), ctx);
+    ASSERT_CMPINT(type, ==, BSON_TYPE_UTF8);
+    ASSERT_CMPUINT32(out.len, ==, (uint32_t)sizeof(string_value));
+    ASSERT(0 == memcmp(out.data, string_value, sizeof(string_value)));
+    mongocrypt_ctx_destroy(ctx);
+
+    /* Contexts not initialized with a raw value are rejected. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_explicit_decrypt_init(ctx, TEST_BSON("{'v': 'plaintext'}")), ctx);
+    ASSERT_FAILS(mongocrypt_ctx_finalize_value(ctx, &out, &type), ctx, "not initialized with a raw value");
+    mongocrypt_ctx_destroy(ctx);
+
+    mongocrypt_binary_destroy(ciphertext_copy);
+    mongocrypt_destroy(crypt);
+}
+
 void _mongocrypt_tester_install_ctx_decrypt(_mongocrypt_tester_t *tester) {
     INSTALL_TEST(_test_explicit_decrypt_init);
     INSTALL_TEST(_test_decrypt_init);
     INSTALL_TEST(_test_decrypt_need_keys);
     INSTALL_TEST(_test_decrypt_ready);
     INSTALL_TEST(_test_decrypt_empty_aws);
+    INSTALL_TEST(_test_decrypt_coalesce_kms);
+    INSTALL_TEST(_test_decrypt_shared_key_cache);
+    INSTALL_TEST(_test_decrypt_retry_kms);
+    INSTALL_TEST(_test_decrypt_kms_rate_limit);
+    INSTALL_TEST(_test_decrypt_deadline);
+    INSTALL_TEST(_test_decrypt_kms_keep_alive);
+    INSTALL_TEST(_test_decrypt_kms_large_reads);
+    INSTALL_TEST(_test_decrypt_hedge_kms);
+    INSTALL_TEST(_test_decrypt_hedge_kms_threads);
+    INSTALL_TEST(_test_decrypt_hedge_kms_record);
+    INSTALL_TEST(_test_explicit_value_roundtrip);
     INSTALL_TEST(_test_decrypt_empty_binary);
+    INSTALL_TEST(_test_explicit_decrypt_batch);
+    INSTALL_TEST(_test_decrypt_next_document);
+    INSTALL_TEST(_test_decrypt_repeated_deterministic);
+    INSTALL_TEST(_test_decrypt_parallel_for);
+    INSTALL_TEST(_test_decrypt_paths);
+    INSTALL_TEST(_test_decrypt_plan);
+    INSTALL_TEST(_test_decrypt_value_at);
+    INSTALL_TEST(_test_decrypt_projected_keys);
+    INSTALL_TEST(_test_decrypt_key_vault_snapshot);
+    INSTALL_TEST(_test_ctx_reset);
+    INSTALL_TEST(_test_ctx_get_timings);
+    INSTALL_TEST(_test_ctx_finalize_into);
+    INSTALL_TEST(_test_decrypt_borrow_input);
     INSTALL_TEST(_test_decrypt_per_ctx_credentials);
     INSTALL_TEST(_test_decrypt_per_ctx_credentials_local);
+    INSTALL_TEST(_test_decrypt_cached_credentials);
     INSTALL_TEST(_test_decrypt_fle2);
     INSTALL_TEST(_test_explicit_decrypt_fle2_ieev);
     INSTALL_TEST(_test_decrypt_fle2_iup);
@@ -523,6 +523,151 @@ static void _test_encrypt_csfle_no_needs_markings(_mongocrypt_tester_t *tester)
     mongocrypt_destroy(crypt);
 }
 
+// Test that one crypt_shared query analyzer is reused by successive contexts.
+static void _test_encrypt_csfle_reuses_query_analyzer(_mongocrypt_tester_t *tester) {
+    if (!TEST_MONGOCRYPT_HAVE_REAL_CRYPT_SHARED_LIB) {
+        fputs("No 'real' csfle library is available. The "
+              "_test_encrypt_csfle_reuses_query_analyzer test is a no-op.",
+              stderr);
+        return;
+    }
+
+    mongocrypt_t *crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_WITH_CRYPT_SHARED_LIB);
+    ASSERT_CMPSIZE_T(crypt->csfle_query_analyzers.len, ==, 0);
+    for (int i = 0; i < 2; i++) {
+        mongocrypt_ctx_t *ctx = mongocrypt_ctx_new(crypt);
+        ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "test", -1, TEST_FILE("./test/example/cmd.json")), ctx);
+        _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+        // The analyzer is returned to the pool once the markings are consumed.
+        ASSERT_CMPSIZE_T(crypt->csfle_query_analyzers.len, ==, 1);
+        mongocrypt_ctx_destroy(ctx);
+    }
+    mongocrypt_destroy(crypt);
+}
+
+// Test that a command with the shape of an analyzed command reuses its markings.
+static void _test_encrypt_marking_cache(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_WITH_MARKING_CACHE);
+
+    // The first command is analyzed.
+    {
+        mongocrypt_ctx_t *ctx = mongocrypt_ctx_new(crypt);
+        ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "test", -1, TEST_FILE("./test/example/cmd.json")), ctx);
+        _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_NEED_MONGO_MARKINGS);
+        ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx, TEST_FILE("./test/example/mongocryptd-reply.json")), ctx);
+        ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+        ASSERT_CMPUINT32(_mongocrypt_cache_num_entries(&crypt->cache_marking), ==, 1);
+
+        // The cached reply does not hold the marked value.
+        _mongocrypt_ctx_encrypt_t *ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+        mongocrypt_status_t *status = mongocrypt_status_new();
+        _mongocrypt_buffer_t *cached;
+        _mongocrypt_marking_t marking;
+        _mongocrypt_buffer_t marking_buf;
+        bson_t reply;
+        bson_iter_t iter;
+        bson_iter_t ssn_iter;
+
+        ASSERT(_mongocrypt_cache_get(&crypt->cache_marking, &ectx->marking_cache_key, (void **)&cached));
+        ASSERT(cached);
+        ASSERT(_mongocrypt_buffer_to_bson(cached, &reply));
+        ASSERT(bson_iter_init(&iter, &reply));
+        ASSERT(bson_iter_find_descendant(&iter, "result.filter.ssn", &ssn_iter));
+        ASSERT(_mongocrypt_buffer_from_binary_iter(&marking_buf, &ssn_iter));
+        ASSERT_OK_STATUS(_mongocrypt_marking_parse_unowned(&marking_buf, &marking, status), status);
+        ASSERT(BSON_ITER_HOLDS_NULL(&marking.v_iter));
+        _mongocrypt_marking_cleanup(&marking);
+        _mongocrypt_buffer_cleanup(cached);
+        bson_free(cached);
+        mongocrypt_status_destroy(status);
+        mongocrypt_ctx_destroy(ctx);
+    }
+
+    // A command of the same shape skips analysis. Its own value is marked.
+    {
+        mongocrypt_ctx_t *ctx = mongocrypt_ctx_new(crypt);
+        ASSERT_OK(
+            mongocrypt_ctx_encrypt_init(ctx, "test", -1, TEST_BSON("{'find': 'test', 'filter': {'ssn': '123-45-6789'}}")),
+            ctx);
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+
+        _mongocrypt_ctx_encrypt_t *ectx = (_mongocrypt_ctx_encrypt_t *)ctx;
+        mongocrypt_status_t *status = mongocrypt_status_new();
+        _mongocrypt_marking_t marking;
+        _mongocrypt_buffer_t marking_buf;
+        bson_t marked;
+        bson_iter_t iter;
+        bson_iter_t ssn_iter;
+
+        ASSERT(_mongocrypt_buffer_to_bson(&ectx->marked_cmd, &marked));
+        ASSERT(bson_iter_init(&iter, &marked));
+        ASSERT(bson_iter_find_descendant(&iter, "filter.ssn", &ssn_iter));
+        ASSERT(_mongocrypt_buffer_from_binary_iter(&marking_buf, &ssn_iter));
+        ASSERT_OK_STATUS(_mongocrypt_marking_parse_unowned(&marking_buf, &marking, status), status);
+        ASSERT_STREQUAL(bson_iter_utf8(&marking.v_iter, NULL), "123-45-6789");
+        _mongocrypt_marking_cleanup(&marking);
+        mongocrypt_status_destroy(status);
+        mongocrypt_ctx_destroy(ctx);
+    }
+
+    // A command of another shape is analyzed.
+    {
+        mongocrypt_ctx_t *ctx = mongocrypt_ctx_new(crypt);
+        ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "test", -1, TEST_BSON("{'find': 'test', 'filter': {'ssn': 123}}")),
+                  ctx);
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_MARKINGS);
+        mongocrypt_ctx_destroy(ctx);
+    }
+
+    mongocrypt_destroy(crypt);
+}
+
+static void _test_encrypt_explain(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *out;
+    bson_t as_bson;
+    bson_iter_t iter;
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_explain_encrypt_init(ctx, "test", -1, TEST_FILE("./test/example/cmd.json")), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_NEED_MONGO_MARKINGS);
+    ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx, TEST_FILE("./test/example/mongocryptd-reply.json")), ctx);
+    ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+    /* No keys are requested. */
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+
+    out = mongocrypt_binary_new();
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, out), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_DONE);
+    BSON_ASSERT(_mongocrypt_binary_to_bson(out, &as_bson));
+
+    BSON_ASSERT(bson_iter_init(&iter, &as_bson));
+    BSON_ASSERT(bson_iter_find_descendant(&iter, "fields.0.path", &iter));
+    ASSERT_STREQUAL(bson_iter_utf8(&iter, NULL), "filter.ssn");
+    BSON_ASSERT(bson_iter_init(&iter, &as_bson));
+    BSON_ASSERT(bson_iter_find_descendant(&iter, "fields.0.algorithm", &iter));
+    ASSERT_STREQUAL(bson_iter_utf8(&iter, NULL), MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR);
+    BSON_ASSERT(bson_iter_init(&iter, &as_bson));
+    BSON_ASSERT(bson_iter_find_descendant(&iter, "fields.0.keyCached", &iter));
+    BSON_ASSERT(!bson_iter_bool(&iter));
+    BSON_ASSERT(bson_iter_init(&iter, &as_bson));
+    BSON_ASSERT(bson_iter_find_descendant(&iter, "fields.1", &iter) == false);
+    BSON_ASSERT(bson_iter_init(&iter, &as_bson));
+    BSON_ASSERT(bson_iter_find_descendant(&iter, "uncachedKeyIds.0", &iter));
+    BSON_ASSERT(bson_iter_init(&iter, &as_bson));
+    BSON_ASSERT(bson_iter_find_descendant(&iter, "uncachedKeyIds.1", &iter) == false);
+    BSON_ASSERT(bson_iter_init(&iter, &as_bson));
+    BSON_ASSERT(bson_iter_find(&iter, "ciphertextBytesEstimate"));
+    BSON_ASSERT(bson_iter_int64(&iter) > 0);
+
+    mongocrypt_binary_destroy(out);
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_destroy(crypt);
+}
+
 static void _test_encrypt_need_keys(_mongocrypt_tester_t *tester) {
     mongocrypt_t *crypt;
     mongocrypt_ctx_t *ctx;
@@ -703,6 +848,59 @@ static void _test_local_schema(_mongocrypt_tester_t *tester) {
     mongocrypt_destroy(crypt);
 }
 
+static void _test_update_schema_map(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx, *old_ctx;
+    mongocrypt_binary_t *schema_map, *mongocryptd_cmd;
+
+    crypt = mongocrypt_new();
+    schema_map = TEST_FILE("./test/data/schema-map.json");
+    ASSERT_OK(mongocrypt_setopt_kms_provider_aws(crypt, "example", -1, "example", -1), crypt);
+    ASSERT_FAILS(mongocrypt_update_schema_map(crypt, schema_map), crypt, "mongocrypt_init not called");
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+
+    /* No map is set, so the schema is requested. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "test", -1, TEST_FILE("./test/example/cmd.json")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_COLLINFO);
+    mongocrypt_ctx_destroy(ctx);
+
+    ASSERT_OK(mongocrypt_update_schema_map(crypt, schema_map), crypt);
+    old_ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(old_ctx, "test", -1, TEST_FILE("./test/example/cmd.json")), old_ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(old_ctx), MONGOCRYPT_CTX_NEED_MONGO_MARKINGS);
+
+    /* A namespace cannot be in both maps. The map is unchanged on error. */
+    ASSERT_FAILS(mongocrypt_update_encrypted_field_config_map(crypt, TEST_BSON("{'test.test': {'fields': []}}")),
+                 crypt,
+                 "test.test is present in both schema_map and encrypted_field_config_map");
+    ASSERT_FAILS(mongocrypt_update_schema_map(crypt, NULL), crypt, "passed null schema map");
+
+    /* Removing the schema affects later contexts. */
+    ASSERT_OK(mongocrypt_update_schema_map(crypt, TEST_BSON("{}")), crypt);
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "test", -1, TEST_FILE("./test/example/cmd.json")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_COLLINFO);
+    mongocrypt_ctx_destroy(ctx);
+
+    /* The context started before the update keeps the old schema. */
+    mongocryptd_cmd = mongocrypt_binary_new();
+    ASSERT_OK(mongocrypt_ctx_mongo_op(old_ctx, mongocryptd_cmd), old_ctx);
+    _assert_schema_compares(schema_map, "test.test", mongocryptd_cmd);
+    _mongocrypt_tester_run_ctx_to(tester, old_ctx, MONGOCRYPT_CTX_DONE);
+    mongocrypt_ctx_destroy(old_ctx);
+    mongocrypt_binary_destroy(mongocryptd_cmd);
+
+    /* Now the namespace may be in the encrypted field config map. */
+    ASSERT_OK(mongocrypt_update_encrypted_field_config_map(crypt, TEST_BSON("{'test.test': {'fields': []}}")), crypt);
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "test", -1, TEST_FILE("./test/example/cmd.json")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_MARKINGS);
+    mongocrypt_ctx_destroy(ctx);
+
+    mongocrypt_destroy(crypt);
+}
+
 static void _test_encrypt_caches_collinfo(_mongocrypt_tester_t *tester) {
     mongocrypt_t *crypt;
     mongocrypt_ctx_t *ctx;
@@ -755,6 +953,68 @@ static void _test_encrypt_caches_keys(_mongocrypt_tester_t *tester) {
     mongocrypt_destroy(crypt);
 }
 
+static void _test_encrypt_invalidate_caches(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *key_id, *other_key_id, *short_key_id;
+
+    crypt = mongocrypt_new();
+    ASSERT_OK(mongocrypt_setopt_kms_provider_aws(crypt, "example", -1, "example", -1), crypt);
+    ASSERT_OK(mongocrypt_setopt_collinfo_expiration_ms(crypt, 0), crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+    key_id = mongocrypt_binary_new_from_data((uint8_t *)"aaaaaaaaaaaaaaaa", 16);
+    other_key_id = mongocrypt_binary_new_from_data((uint8_t *)"bbbbbbbbbbbbbbbb", 16);
+    short_key_id = mongocrypt_binary_new_from_data((uint8_t *)"short", 5);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "test", -1, TEST_FILE("./test/example/cmd.json")), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_DONE);
+    mongocrypt_ctx_destroy(ctx);
+
+    /* The collinfo and the key are cached. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "test", -1, TEST_FILE("./test/example/cmd.json")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_MARKINGS);
+    ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx, TEST_FILE("./test/example/mongocryptd-reply.json")), ctx);
+    ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    mongocrypt_ctx_destroy(ctx);
+
+    /* Other namespaces and keys are not affected. */
+    ASSERT_OK(mongocrypt_invalidate_collinfo(crypt, "test.other", -1), crypt);
+    ASSERT_OK(mongocrypt_invalidate_key(crypt, other_key_id), crypt);
+    ASSERT_FAILS(mongocrypt_invalidate_key(crypt, short_key_id), crypt, "expected a 16 byte UUID");
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "test", -1, TEST_FILE("./test/example/cmd.json")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_MARKINGS);
+    ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx, TEST_FILE("./test/example/mongocryptd-reply.json")), ctx);
+    ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    mongocrypt_ctx_destroy(ctx);
+
+    ASSERT_OK(mongocrypt_invalidate_collinfo(crypt, "test.test", -1), crypt);
+    ASSERT_OK(mongocrypt_invalidate_key(crypt, key_id), crypt);
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "test", -1, TEST_FILE("./test/example/cmd.json")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_COLLINFO);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_NEED_MONGO_MARKINGS);
+    ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx, TEST_FILE("./test/example/mongocryptd-reply.json")), ctx);
+    ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_DONE);
+    mongocrypt_ctx_destroy(ctx);
+
+    ASSERT_OK(mongocrypt_invalidate_all_collinfo(crypt), crypt);
+    ASSERT_OK(mongocrypt_invalidate_all_keys(crypt), crypt);
+    ASSERT_CMPUINT32(_mongocrypt_cache_num_entries(&crypt->cache_collinfo), ==, 0);
+    ASSERT_CMPUINT32(_mongocrypt_cache_num_entries(&crypt->cache_key), ==, 0);
+
+    mongocrypt_binary_destroy(short_key_id);
+    mongocrypt_binary_destroy(other_key_id);
+    mongocrypt_binary_destroy(key_id);
+    mongocrypt_destroy(crypt);
+}
+
 static void _test_encrypt_caches_keys_by_alt_name(_mongocrypt_tester_t *tester) {
     mongocrypt_t *crypt;
     mongocrypt_ctx_t *ctx;
@@ -907,6 +1167,51 @@ static void _init_bypass(_mongocrypt_tester_t *tester, const char *json) {
     mongocrypt_destroy(crypt);
 }
 
+static void _test_encrypt_borrow_input_passthrough(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *cmd, *out;
+
+    out = mongocrypt_binary_new();
+
+    /* A bypassed command is returned as the borrowed command. */
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    ctx = mongocrypt_ctx_new(crypt);
+    cmd = TEST_BSON("{'ping': 1}");
+    ASSERT_OK(mongocrypt_ctx_setopt_borrow_input(ctx), ctx);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "test", -1, cmd), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, out), ctx);
+    ASSERT(mongocrypt_binary_data(out) == mongocrypt_binary_data(cmd));
+    ASSERT_CMPUINT32(mongocrypt_binary_len(out), ==, mongocrypt_binary_len(cmd));
+    mongocrypt_ctx_destroy(ctx);
+
+    /* So is a command without encrypted placeholders. */
+    ctx = mongocrypt_ctx_new(crypt);
+    cmd = TEST_FILE("./test/example/cmd.json");
+    ASSERT_OK(mongocrypt_ctx_setopt_borrow_input(ctx), ctx);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "test", -1, cmd), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_NEED_MONGO_MARKINGS);
+    ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx, TEST_FILE("./test/data/mongocryptd-reply-no-markings.json")), ctx);
+    ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, out), ctx);
+    ASSERT(mongocrypt_binary_data(out) == mongocrypt_binary_data(cmd));
+    mongocrypt_ctx_destroy(ctx);
+
+    /* Without the option, the command is copied. */
+    ctx = mongocrypt_ctx_new(crypt);
+    cmd = TEST_BSON("{'ping': 1}");
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "test", -1, cmd), ctx);
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, out), ctx);
+    ASSERT(mongocrypt_binary_data(out) != mongocrypt_binary_data(cmd));
+    ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(cmd, out);
+    mongocrypt_ctx_destroy(ctx);
+
+    mongocrypt_destroy(crypt);
+    mongocrypt_binary_destroy(out);
+}
+
 static void _test_encrypt_init_each_cmd(_mongocrypt_tester_t *tester) {
     /* collection aggregate is ok */
     _init_ok(tester, "{'aggregate': 'coll'}");
@@ -1080,6 +1385,201 @@ static void _test_explicit_encryption(_mongocrypt_tester_t *tester) {
     mongocrypt_destroy(crypt);
 }
 
+static void _explicit_encrypt_deterministic(_mongocrypt_tester_t *tester,
+                                            mongocrypt_t *crypt,
+                                            mongocrypt_binary_t *msg,
+                                            bool batch,
+                                            _mongocrypt_buffer_t *out) {
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *bin, *key_id;
+
+    key_id = mongocrypt_binary_new_from_data(MONGOCRYPT_DATA_AND_LEN("aaaaaaaaaaaaaaaa"));
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx, MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR, -1), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_key_id(ctx, key_id), ctx);
+    if (batch) {
+        ASSERT_OK(mongocrypt_ctx_explicit_encrypt_batch_init(ctx, msg), ctx);
+    } else {
+        ASSERT_OK(mongocrypt_ctx_explicit_encrypt_init(ctx, msg), ctx);
+    }
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    bin = mongocrypt_binary_new();
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, bin), ctx);
+    _mongocrypt_buffer_copy_from_binary(out, bin);
+    mongocrypt_binary_destroy(bin);
+    mongocrypt_binary_destroy(key_id);
+    mongocrypt_ctx_destroy(ctx);
+}
+
+/* Encrypts {'v': @value} explicitly with @algorithm and the key of
+ * ./test/example/key-document.json into @out. */
+static void _explicit_encrypt_with_key_document(_mongocrypt_tester_t *tester,
+                                                mongocrypt_t *crypt,
+                                                const char *algorithm,
+                                                mongocrypt_binary_t *msg,
+                                                _mongocrypt_buffer_t *out) {
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *bin, *key_id;
+
+    key_id = mongocrypt_binary_new_from_data(MONGOCRYPT_DATA_AND_LEN("aaaaaaaaaaaaaaaa"));
+    bin = mongocrypt_binary_new();
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx, algorithm, -1), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_key_id(ctx, key_id), ctx);
+    ASSERT_OK(mongocrypt_ctx_explicit_encrypt_init(ctx, msg), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, bin), ctx);
+    _mongocrypt_buffer_copy_from_binary(out, bin);
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_binary_destroy(bin);
+    mongocrypt_binary_destroy(key_id);
+}
+
+static void _test_explicit_encryption_deterministic_cache(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_binary_t *key_id, *other_key_id;
+    _mongocrypt_buffer_t expected, actual;
+    _mongocrypt_cache_stats_t stats;
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    _explicit_encrypt_with_key_document(tester,
+                                        crypt,
+                                        MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR,
+                                        TEST_BSON("{'v': 'US'}"),
+                                        &expected);
+    ASSERT_CMPUINT32(_mongocrypt_cache_num_entries(&crypt->cache_deterministic), ==, 0);
+    mongocrypt_destroy(crypt);
+
+    /* A repeated value is taken from the cache. */
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_WITH_DETERMINISTIC_CACHE);
+    for (int i = 0; i < 2; i++) {
+        _explicit_encrypt_with_key_document(tester,
+                                            crypt,
+                                            MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR,
+                                            TEST_BSON("{'v': 'US'}"),
+                                            &actual);
+        ASSERT_CMPBUF(expected, actual);
+        _mongocrypt_buffer_cleanup(&actual);
+    }
+    _mongocrypt_cache_stats(&crypt->cache_deterministic, &stats);
+    ASSERT_CMPINT64(stats.hits, ==, 1);
+    ASSERT_CMPINT64(stats.misses, ==, 1);
+
+    /* Random ciphertexts are not cached. */
+    _explicit_encrypt_with_key_document(tester,
+                                        crypt,
+                                        MONGOCRYPT_ALGORITHM_RANDOM_STR,
+                                        TEST_BSON("{'v': 'US'}"),
+                                        &actual);
+    _mongocrypt_buffer_cleanup(&actual);
+    ASSERT_CMPUINT32(_mongocrypt_cache_num_entries(&crypt->cache_deterministic), ==, 1);
+
+    /* A full cache evicts the least recently used value. */
+    _explicit_encrypt_with_key_document(tester,
+                                        crypt,
+                                        MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR,
+                                        TEST_BSON("{'v': 'CA'}"),
+                                        &actual);
+    _mongocrypt_buffer_cleanup(&actual);
+    _mongocrypt_cache_stats(&crypt->cache_deterministic, &stats);
+    ASSERT_CMPINT64(stats.evictions, ==, 1);
+    ASSERT_CMPUINT32(_mongocrypt_cache_num_entries(&crypt->cache_deterministic), ==, 1);
+
+    /* Values expire with the key. */
+    ASSERT_CMPUINT64(crypt->cache_deterministic.expiration, ==, crypt->cache_key.expiration);
+
+    /* Invalidating another key keeps the value. Invalidating its key removes it. */
+    other_key_id = mongocrypt_binary_new_from_data(MONGOCRYPT_DATA_AND_LEN("bbbbbbbbbbbbbbbb"));
+    ASSERT_OK(mongocrypt_invalidate_key(crypt, other_key_id), crypt);
+    ASSERT_CMPUINT32(_mongocrypt_cache_num_entries(&crypt->cache_deterministic), ==, 1);
+    key_id = mongocrypt_binary_new_from_data(MONGOCRYPT_DATA_AND_LEN("aaaaaaaaaaaaaaaa"));
+    ASSERT_OK(mongocrypt_invalidate_key(crypt, key_id), crypt);
+    ASSERT_CMPUINT32(_mongocrypt_cache_num_entries(&crypt->cache_deterministic), ==, 0);
+
+    /* Invalidating all keys removes all values. */
+    _explicit_encrypt_with_key_document(tester,
+                                        crypt,
+                                        MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR,
+                                        TEST_BSON("{'v': 'US'}"),
+                                        &actual);
+    _mongocrypt_buffer_cleanup(&actual);
+    ASSERT_CMPUINT32(_mongocrypt_cache_num_entries(&crypt->cache_deterministic), ==, 1);
+    ASSERT_OK(mongocrypt_invalidate_all_keys(crypt), crypt);
+    ASSERT_CMPUINT32(_mongocrypt_cache_num_entries(&crypt->cache_deterministic), ==, 0);
+
+    mongocrypt_binary_destroy(other_key_id);
+    mongocrypt_binary_destroy(key_id);
+    _mongocrypt_buffer_cleanup(&expected);
+    mongocrypt_destroy(crypt);
+}
+
+static void _test_explicit_encryption_batch(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *key_id;
+    _mongocrypt_buffer_t single[2], batched;
+    bson_t single_bson, batched_bson;
+    bson_iter_t single_iter, batched_iter;
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+
+    /* The batch returns the ciphertexts of each value in order. */
+    _explicit_encrypt_deterministic(tester, crypt, TEST_BSON("{'v': 123}"), false, &single[0]);
+    _explicit_encrypt_deterministic(tester, crypt, TEST_BSON("{'v': 'abc'}"), false, &single[1]);
+    _explicit_encrypt_deterministic(tester, crypt, TEST_BSON("{'v': [123, 'abc']}"), true, &batched);
+
+    ASSERT(_mongocrypt_buffer_to_bson(&batched, &batched_bson));
+    ASSERT(bson_iter_init_find(&batched_iter, &batched_bson, "v"));
+    ASSERT(BSON_ITER_HOLDS_ARRAY(&batched_iter));
+    ASSERT(bson_iter_recurse(&batched_iter, &batched_iter));
+    for (int i = 0; i < 2; i++) {
+        const bson_value_t *got, *expect;
+
+        ASSERT(bson_iter_next(&batched_iter));
+        ASSERT(_mongocrypt_buffer_to_bson(&single[i], &single_bson));
+        ASSERT(bson_iter_init_find(&single_iter, &single_bson, "v"));
+        got = bson_iter_value(&batched_iter);
+        expect = bson_iter_value(&single_iter);
+        ASSERT(got->value_type == BSON_TYPE_BINARY);
+        ASSERT(expect->value_type == BSON_TYPE_BINARY);
+        ASSERT_CMPUINT32(got->value.v_binary.data_len, ==, expect->value.v_binary.data_len);
+        ASSERT(0 == memcmp(got->value.v_binary.data, expect->value.v_binary.data, got->value.v_binary.data_len));
+        _mongocrypt_buffer_cleanup(&single[i]);
+    }
+    ASSERT(!bson_iter_next(&batched_iter));
+    _mongocrypt_buffer_cleanup(&batched);
+
+    /* 'v' must be a non-empty array. */
+    key_id = mongocrypt_binary_new_from_data(MONGOCRYPT_DATA_AND_LEN("aaaaaaaaaaaaaaaa"));
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx, MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR, -1), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_key_id(ctx, key_id), ctx);
+    ASSERT_FAILS(mongocrypt_ctx_explicit_encrypt_batch_init(ctx, TEST_BSON("{'v': 123}")),
+                 ctx,
+                 "'v' must be an array");
+    mongocrypt_ctx_destroy(ctx);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx, MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR, -1), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_key_id(ctx, key_id), ctx);
+    ASSERT_FAILS(mongocrypt_ctx_explicit_encrypt_batch_init(ctx, TEST_BSON("{'v': []}")),
+                 ctx,
+                 "'v' must not be empty");
+    mongocrypt_ctx_destroy(ctx);
+
+    /* Each value is checked. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx, MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR, -1), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_key_id(ctx, key_id), ctx);
+    ASSERT_FAILS(mongocrypt_ctx_explicit_encrypt_batch_init(ctx, TEST_BSON("{'v': [123, 1.23]}")),
+                 ctx,
+                 "BSON type invalid for deterministic encryption");
+    mongocrypt_ctx_destroy(ctx);
+
+    mongocrypt_binary_destroy(key_id);
+    mongocrypt_destroy(crypt);
+}
+
 /* Test with empty AWS credentials. */
 void _test_encrypt_empty_aws(_mongocrypt_tester_t *tester) {
     mongocrypt_t *crypt;
@@ -1293,6 +1793,48 @@ static void _test_encrypt_caches_collinfo_without_jsonschema(_mongocrypt_tester_
     mongocrypt_destroy(crypt);
 }
 
+static void _test_encrypt_prefetch_collinfo(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *filter;
+
+    crypt = mongocrypt_new();
+    ASSERT_OK(mongocrypt_setopt_kms_provider_aws(crypt, "example", -1, "example", -1), crypt);
+    ASSERT_OK(mongocrypt_setopt_prefetch_collinfo(crypt), crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "test", -1, TEST_FILE("./test/example/cmd.json")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_COLLINFO);
+    filter = mongocrypt_binary_new();
+    ASSERT_OK(mongocrypt_ctx_mongo_op(ctx, filter), ctx);
+    ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_BSON("{}"), filter);
+    mongocrypt_binary_destroy(filter);
+    ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx, TEST_BSON("{'name': 'other', 'type': 'collection', 'options': {}}")), ctx);
+    ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx, TEST_FILE("./test/example/collection-info.json")), ctx);
+    ASSERT_FAILS(mongocrypt_ctx_mongo_feed(ctx, TEST_BSON("{'type': 'collection'}")), ctx, "expected collinfo to have");
+    mongocrypt_ctx_destroy(ctx);
+
+    /* Both collections are cached. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "test", -1, TEST_FILE("./test/example/cmd.json")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_MARKINGS);
+    mongocrypt_ctx_destroy(ctx);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "test", -1, TEST_BSON("{'find': 'other', 'filter': {}}")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_MARKINGS);
+    mongocrypt_ctx_destroy(ctx);
+
+    /* Other databases are not. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "db2", -1, TEST_BSON("{'find': 'other', 'filter': {}}")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_COLLINFO);
+    mongocrypt_ctx_destroy(ctx);
+
+    mongocrypt_destroy(crypt);
+}
+
 static void _test_encrypt_with_encrypted_field_config_map(_mongocrypt_tester_t *tester) {
     mongocrypt_t *crypt;
     mongocrypt_ctx_t *ctx;
@@ -1340,6 +1882,75 @@ static void _test_encrypt_with_encrypted_field_config_map(_mongocrypt_tester_t *
     mongocrypt_destroy(crypt);
 }
 
+static void _test_encrypt_prefetch_key_ids(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_ctx_t *prefetch_ctx;
+    mongocrypt_binary_t *key_ids;
+    char localkey_data[MONGOCRYPT_KEY_LEN] = {0};
+    mongocrypt_binary_t *localkey;
+
+    crypt = mongocrypt_new();
+    localkey = mongocrypt_binary_new_from_data((uint8_t *)localkey_data, sizeof localkey_data);
+    ASSERT_OK(mongocrypt_setopt_kms_provider_local(crypt, localkey), crypt);
+    mongocrypt_binary_destroy(localkey);
+    /* Fields 'a' and 'b' share a key. */
+    ASSERT_OK(mongocrypt_setopt_encrypted_field_config_map(
+                  crypt,
+                  TEST_BSON("{'db.coll': {'fields': ["
+                            "{'keyId': {'$binary': {'base64': 'EjRWeBI0mHYSNBI0VniQEg==', 'subType': '04'}}, "
+                            "'path': 'a', 'bsonType': 'string'}, "
+                            "{'keyId': {'$binary': {'base64': 'EjRWeBI0mHYSNBI0VniQEg==', 'subType': '04'}}, "
+                            "'path': 'b', 'bsonType': 'string'}, "
+                            "{'keyId': {'$binary': {'base64': 'q83vqxI0mHYSNBI0VniQEg==', 'subType': '04'}}, "
+                            "'path': 'c', 'bsonType': 'string'}]}}")),
+              crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "db", -1, TEST_BSON("{'insert': 'coll', 'documents': [{'a': 'x'}]}")),
+              ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_MARKINGS);
+    key_ids = mongocrypt_binary_new();
+    ASSERT_OK(mongocrypt_ctx_encrypt_prefetch_key_ids(ctx, key_ids), ctx);
+    ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(
+        TEST_BSON("{'keyIds': [{'$binary': {'base64': 'q83vqxI0mHYSNBI0VniQEg==', 'subType': '04'}}, "
+                  "{'$binary': {'base64': 'EjRWeBI0mHYSNBI0VniQEg==', 'subType': '04'}}]}"),
+        key_ids);
+
+    /* Prefetch the keys on another context. */
+    prefetch_ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_prefetch_keys_init(prefetch_ctx, key_ids), prefetch_ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(prefetch_ctx), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+    ASSERT_OK(mongocrypt_ctx_mongo_feed(prefetch_ctx,
+                                        TEST_FILE("./test/data/keys/"
+                                                  "12345678123498761234123456789012-local-document.json")),
+              prefetch_ctx);
+    ASSERT_OK(mongocrypt_ctx_mongo_feed(prefetch_ctx,
+                                        TEST_FILE("./test/data/keys/"
+                                                  "ABCDEFAB123498761234123456789012-local-document.json")),
+              prefetch_ctx);
+    ASSERT_OK(mongocrypt_ctx_mongo_done(prefetch_ctx), prefetch_ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(prefetch_ctx), MONGOCRYPT_CTX_READY);
+    mongocrypt_ctx_destroy(prefetch_ctx);
+
+    /* Cached keys are not included. */
+    ASSERT_OK(mongocrypt_ctx_encrypt_prefetch_key_ids(ctx, key_ids), ctx);
+    ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_BSON("{'keyIds': []}"), key_ids);
+    mongocrypt_binary_destroy(key_ids);
+    mongocrypt_ctx_destroy(ctx);
+
+    /* Only applicable to auto encryption contexts marking a command. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_BSON("{}")), ctx);
+    key_ids = mongocrypt_binary_new();
+    ASSERT_FAILS(mongocrypt_ctx_encrypt_prefetch_key_ids(ctx, key_ids), ctx, "not applicable to context");
+    mongocrypt_binary_destroy(key_ids);
+    mongocrypt_ctx_destroy(ctx);
+
+    mongocrypt_destroy(crypt);
+}
+
 /* Test encrypting a bypassed command on a collection present in the encrypted
  * field config map. Expect no encryptionInformation. */
 static void _test_encrypt_with_encrypted_field_config_map_bypassed(_mongocrypt_tester_t *tester) {
@@ -1931,6 +2542,8 @@ static void _test_encrypt_fle2_encryption_placeholder(_mongocrypt_tester_t *test
     mongocrypt_t *crypt;
     char pathbuf[2048];
 
+    SKIP_WITHOUT_CRYPTO_HOOKS();
+
 #define MAKE_PATH(mypath)                                                                                              \
     if (1) {                                                                                                           \
         int pathbuf_ret = snprintf(pathbuf, sizeof(pathbuf), "./test/data/%s/%s", data_path, mypath);                  \
@@ -2214,14 +2827,20 @@ typedef struct {
     const char *expect_init_error;
     bool is_expression;
     bool use_v2;
+    mongocrypt_t *crypt; // If set, used instead of creating a mongocrypt_t.
 } ee_testcase;
 
 static void ee_testcase_run(ee_testcase *tc) {
+    if (!tc->crypt && tc->rng_data.buf.len > 0) {
+        SKIP_WITHOUT_CRYPTO_HOOKS();
+    }
     printf("  explicit_encryption_finalize test case: %s ... begin\n", tc->desc);
     extern void mc_reset_payloadId_for_testing(void);
     mc_reset_payloadId_for_testing();
     mongocrypt_t *crypt;
-    if (tc->rng_data.buf.len > 0) {
+    if (tc->crypt) {
+        crypt = tc->crypt;
+    } else if (tc->rng_data.buf.len > 0) {
         // Use fixed data for random number generation to produce deterministic
         // results.
         crypt = _crypt_with_rng(&tc->rng_data, tc->use_v2);
@@ -2298,7 +2917,9 @@ static void ee_testcase_run(ee_testcase *tc) {
 cleanup:
     printf("  explicit_encryption_finalize test case: %s ... end\n", tc->desc);
     mongocrypt_ctx_destroy(ctx);
-    mongocrypt_destroy(crypt);
+    if (!tc->crypt) {
+        mongocrypt_destroy(crypt);
+    }
 }
 
 // Test the finalized output of explicit encryption.
@@ -3107,44 +3728,425 @@ static void _test_encrypt_fle2_explicit(_mongocrypt_tester_t *tester) {
         ee_testcase_run(&tc);
     }
 
-    {
+    {
+        ee_testcase tc = {0};
+        tc.desc = "min is required to find int for range";
+        tc.algorithm = MONGOCRYPT_ALGORITHM_RANGE_STR;
+        tc.query_type = MONGOCRYPT_QUERY_TYPE_RANGE_STR;
+        tc.user_key_id = &keyABC_id;
+        tc.contention_factor = OPT_I64(0);
+        tc.range_opts = TEST_BSON(RAW_STRING({"max" : {"$numberInt" : "200"}, "sparsity" : {"$numberLong" : "1"}}));
+        tc.msg = TEST_BSON(RAW_STRING({
+            "v" : {"$and" :
+                       [ {"age" : {"$gte" : {"$numberInt" : "23"}}}, {"age" : {"$lte" : {"$numberInt" : "35"}}} ]}
+        }));
+        tc.keys_to_feed[0] = keyABC;
+        tc.expect_finalize_error = "Range option 'min' is required";
+        tc.is_expression = true;
+        ee_testcase_run(&tc);
+    }
+
+    {
+        ee_testcase tc = {0};
+        tc.desc = "max is required to find int for range";
+        tc.algorithm = MONGOCRYPT_ALGORITHM_RANGE_STR;
+        tc.query_type = MONGOCRYPT_QUERY_TYPE_RANGE_STR;
+        tc.user_key_id = &keyABC_id;
+        tc.contention_factor = OPT_I64(0);
+        tc.range_opts = TEST_BSON(RAW_STRING({"min" : {"$numberInt" : "0"}, "sparsity" : {"$numberLong" : "1"}}));
+        tc.msg = TEST_BSON(RAW_STRING({
+            "v" : {"$and" :
+                       [ {"age" : {"$gte" : {"$numberInt" : "23"}}}, {"age" : {"$lte" : {"$numberInt" : "35"}}} ]}
+        }));
+        tc.keys_to_feed[0] = keyABC;
+        tc.expect_finalize_error = "Range option 'max' is required";
+        tc.is_expression = true;
+        ee_testcase_run(&tc);
+    }
+
+    _mongocrypt_buffer_cleanup(&keyABC_id);
+    _mongocrypt_buffer_cleanup(&key123_id);
+}
+
+// Test that range edge tokens derived by a parallel_for executor match the edge tokens derived in order.
+static void _test_encrypt_fle2_explicit_parallel_for(_mongocrypt_tester_t *tester) {
+    _mongocrypt_buffer_t keyABC_id;
+    _mongocrypt_buffer_t key123_id;
+
+    SKIP_WITHOUT_CRYPTO_HOOKS();
+    if (!_aes_ctr_is_supported_by_os) {
+        printf("Common Crypto with no CTR support detected. Skipping.");
+        return;
+    }
+
+    _mongocrypt_buffer_copy_from_hex(&keyABC_id, "ABCDEFAB123498761234123456789012");
+    _mongocrypt_buffer_copy_from_hex(&key123_id, "12345678123498761234123456789012");
+    mongocrypt_binary_t *keyABC = TEST_FILE("./test/data/keys/"
+                                            "ABCDEFAB123498761234123456789012-local-"
+                                            "document.json");
+    mongocrypt_binary_t *key123 = TEST_FILE("./test/data/keys/"
+                                            "12345678123498761234123456789012-local-"
+                                            "document.json");
+
+    ee_testcase tc = {0};
+    tc.desc = "algorithm='Range' with sparsity=2 with int32 (v2) with parallel_for";
+#include "./data/fle2-insert-range-explicit/sparsity-2/RNG_DATA.h"
+    tc.rng_data = (_test_rng_data_source){.buf = {.data = (uint8_t *)RNG_DATA, .len = sizeof(RNG_DATA) - 1}};
+#undef RNG_DATA
+    tc.algorithm = MONGOCRYPT_ALGORITHM_RANGE_STR;
+    tc.user_key_id = &keyABC_id;
+    tc.index_key_id = &key123_id;
+    tc.contention_factor = OPT_I64(0);
+    tc.range_opts = TEST_FILE("./test/data/fle2-insert-range-explicit/"
+                              "sparsity-2/rangeopts.json");
+    tc.msg = TEST_FILE("./test/data/fle2-insert-range-explicit/sparsity-2/"
+                       "value-to-encrypt.json");
+    tc.keys_to_feed[0] = keyABC;
+    tc.keys_to_feed[1] = key123;
+    tc.expect = TEST_FILE("./test/data/fle2-insert-range-explicit/sparsity-2/"
+                          "encrypted-payload-v2.json");
+    tc.use_v2 = true;
+
+    _reverse_parallel_for_ctx pctx = {0};
+    {
+        char localkey_data[MONGOCRYPT_KEY_LEN] = {0};
+        mongocrypt_binary_t *localkey = mongocrypt_binary_new_from_data((uint8_t *)localkey_data, sizeof localkey_data);
+        mongocrypt_t *crypt = mongocrypt_new();
+        mongocrypt_setopt_log_handler(crypt, _mongocrypt_stdout_log_fn, NULL);
+        ASSERT_OK(mongocrypt_setopt_kms_provider_local(crypt, localkey), crypt);
+        ASSERT_OK(mongocrypt_setopt_crypto_hooks(crypt,
+                                                 _std_hook_native_crypto_aes_256_cbc_encrypt,
+                                                 _std_hook_native_crypto_aes_256_cbc_decrypt,
+                                                 _test_rng_source,
+                                                 _std_hook_native_hmac_sha512,
+                                                 _std_hook_native_hmac_sha256,
+                                                 _error_hook_native_sha256,
+                                                 &tc.rng_data /* ctx */),
+                  crypt);
+        ASSERT_OK(mongocrypt_setopt_parallel_for(crypt, _reverse_parallel_for, &pctx), crypt);
+        ASSERT_OK(mongocrypt_setopt_fle2v2(crypt, true), crypt);
+        ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+        mongocrypt_binary_destroy(localkey);
+        tc.crypt = crypt;
+    }
+
+    ee_testcase_run(&tc);
+    ASSERT_CMPINT(pctx.calls, ==, 1);
+
+    mongocrypt_destroy(tc.crypt);
+    _mongocrypt_buffer_cleanup(&key123_id);
+    _mongocrypt_buffer_cleanup(&keyABC_id);
+}
+
+static void _encrypt_with_many_markings(_mongocrypt_tester_t *tester, mongocrypt_t *crypt, _mongocrypt_buffer_t *out) {
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *bin;
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "test", -1, TEST_FILE("./test/example/cmd.json")), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_NEED_MONGO_MARKINGS);
+    ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx, TEST_FILE("./test/data/mongocryptd-reply-many-markings.json")), ctx);
+    ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    bin = mongocrypt_binary_new();
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, bin), ctx);
+    _mongocrypt_buffer_copy_from_binary(out, bin);
+    mongocrypt_binary_destroy(bin);
+    mongocrypt_ctx_destroy(ctx);
+}
+
+// Test that markings converted by a parallel_for executor are placed in order.
+static void _test_encrypt_parallel_markings(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    _mongocrypt_buffer_t serial, parallel;
+    _reverse_parallel_for_ctx pctx = {0};
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    _encrypt_with_many_markings(tester, crypt, &serial);
+    mongocrypt_destroy(crypt);
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    crypt->crypto->parallel_for = _reverse_parallel_for;
+    crypt->crypto->parallel_for_ctx = &pctx;
+
+    /* Below the threshold, markings are converted on the calling thread. */
+    crypt->opts.parallel_marking_threshold = 4;
+    _encrypt_with_many_markings(tester, crypt, &parallel);
+    ASSERT_CMPINT(pctx.calls, ==, 0);
+    ASSERT_CMPBUF(serial, parallel);
+    _mongocrypt_buffer_cleanup(&parallel);
+
+    /* Deterministic ciphertexts match the ones converted in order. */
+    crypt->opts.parallel_marking_threshold = 3;
+    _encrypt_with_many_markings(tester, crypt, &parallel);
+    ASSERT_CMPINT(pctx.calls, ==, 1);
+    ASSERT_CMPBUF(serial, parallel);
+    _mongocrypt_buffer_cleanup(&parallel);
+
+    _mongocrypt_buffer_cleanup(&serial);
+    mongocrypt_destroy(crypt);
+}
+
+// Test that cached range query covers produce the same payloads.
+static void _test_encrypt_fle2_explicit_mincover_cache(_mongocrypt_tester_t *tester) {
+    _mongocrypt_buffer_t keyABC_id;
+
+    if (!_aes_ctr_is_supported_by_os) {
+        printf("Common Crypto with no CTR support detected. Skipping.");
+        return;
+    }
+
+    _mongocrypt_buffer_copy_from_hex(&keyABC_id, "ABCDEFAB123498761234123456789012");
+    mongocrypt_binary_t *keyABC = TEST_FILE("./test/data/keys/"
+                                            "ABCDEFAB123498761234123456789012-local-"
+                                            "document.json");
+
+    // The cache is disabled by default.
+    {
+        mongocrypt_t *crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+        ee_testcase tc = {0};
+        tc.desc = "range query without mincover cache";
+        tc.algorithm = MONGOCRYPT_ALGORITHM_RANGE_STR;
+        tc.user_key_id = &keyABC_id;
+        tc.index_key_id = &keyABC_id;
+        tc.contention_factor = OPT_I64(4);
+        tc.query_type = MONGOCRYPT_QUERY_TYPE_RANGE_STR;
+        tc.range_opts = TEST_FILE("./test/data/fle2-find-range-explicit/int32/rangeopts.json");
+        tc.msg = TEST_FILE("./test/data/fle2-find-range-explicit/int32/value-to-encrypt.json");
+        tc.keys_to_feed[0] = keyABC;
+        tc.expect = TEST_FILE("./test/data/fle2-find-range-explicit/int32/encrypted-payload-v2.json");
+        tc.is_expression = true;
+        tc.use_v2 = true;
+        tc.crypt = crypt;
+        ee_testcase_run(&tc);
+        ASSERT_CMPUINT32(_mongocrypt_cache_num_entries(&crypt->cache_mincover), ==, 0);
+        mongocrypt_destroy(crypt);
+    }
+
+    // Repeated queries reuse the cached cover.
+    {
+        mongocrypt_t *crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_WITH_MINCOVER_CACHE);
+        for (int i = 0; i < 2; i++) {
+            ee_testcase tc = {0};
+            tc.desc = i == 0 ? "range query populates mincover cache" : "range query hits mincover cache";
+            tc.algorithm = MONGOCRYPT_ALGORITHM_RANGE_STR;
+            tc.user_key_id = &keyABC_id;
+            tc.index_key_id = &keyABC_id;
+            tc.contention_factor = OPT_I64(4);
+            tc.query_type = MONGOCRYPT_QUERY_TYPE_RANGE_STR;
+            tc.range_opts = TEST_FILE("./test/data/fle2-find-range-explicit/int32/rangeopts.json");
+            tc.msg = TEST_FILE("./test/data/fle2-find-range-explicit/int32/value-to-encrypt.json");
+            tc.keys_to_feed[0] = keyABC;
+            tc.expect = TEST_FILE("./test/data/fle2-find-range-explicit/int32/encrypted-payload-v2.json");
+            tc.is_expression = true;
+            tc.use_v2 = true;
+            tc.crypt = crypt;
+            ee_testcase_run(&tc);
+            ASSERT_CMPUINT32(_mongocrypt_cache_num_entries(&crypt->cache_mincover), ==, 1);
+        }
+
+        _mongocrypt_cache_stats_t stats;
+        _mongocrypt_cache_stats(&crypt->cache_mincover, &stats);
+        ASSERT_CMPINT64(stats.hits, ==, 1);
+        ASSERT_CMPINT64(stats.misses, ==, 1);
+        mongocrypt_destroy(crypt);
+    }
+
+    _mongocrypt_buffer_cleanup(&keyABC_id);
+}
+
+// Test that a batch of range expressions is encrypted like the expressions one by one.
+static void _test_encrypt_fle2_explicit_expression_batch(_mongocrypt_tester_t *tester) {
+    const char *expr = "{'$and': [{'age': {'$gte': {'$numberInt': '23'}}}, {'age': {'$lte': {'$numberInt': '35'}}}]}";
+    extern void mc_reset_payloadId_for_testing(void);
+    _mongocrypt_buffer_t keyABC_id;
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *got;
+    bson_t got_bson, expect_bson;
+    bson_iter_t got_iter, expect_iter;
+    bson_t got_doc, expect_doc;
+
+    if (!_aes_ctr_is_supported_by_os) {
+        printf("Common Crypto with no CTR support detected. Skipping.");
+        return;
+    }
+
+    _mongocrypt_buffer_copy_from_hex(&keyABC_id, "ABCDEFAB123498761234123456789012");
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    got = mongocrypt_binary_new();
+
+    // The first expression gets the same payload as a single expression.
+    mc_reset_payloadId_for_testing();
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx, MONGOCRYPT_ALGORITHM_RANGE_STR, -1), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_key_id(ctx, _mongocrypt_buffer_as_binary(&keyABC_id)), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_contention_factor(ctx, 4), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_query_type(ctx, MONGOCRYPT_QUERY_TYPE_RANGE_STR, -1), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_algorithm_range(
+                  ctx,
+                  TEST_FILE("./test/data/fle2-find-range-explicit/int32/rangeopts.json")),
+              ctx);
+    ASSERT_OK(mongocrypt_ctx_explicit_encrypt_expression_batch_init(ctx, TEST_BSON("{'v': [%s, %s]}", expr, expr)),
+              ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+    ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx,
+                                        TEST_FILE("./test/data/keys/"
+                                                  "ABCDEFAB123498761234123456789012-local-document.json")),
+              ctx);
+    ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, got), ctx);
+
+    ASSERT(_mongocrypt_binary_to_bson(got, &got_bson));
+    ASSERT(bson_iter_init_find(&got_iter, &got_bson, "v"));
+    ASSERT(BSON_ITER_HOLDS_ARRAY(&got_iter));
+    ASSERT(bson_iter_recurse(&got_iter, &got_iter));
+    ASSERT(bson_iter_next(&got_iter));
+    ASSERT(mc_iter_document_as_bson(&got_iter, &got_doc, NULL));
+    ASSERT(_mongocrypt_binary_to_bson(
+        TEST_FILE("./test/data/fle2-find-range-explicit/int32/encrypted-payload-v2.json"),
+        &expect_bson));
+    ASSERT(bson_iter_init_find(&expect_iter, &expect_bson, "v"));
+    ASSERT(mc_iter_document_as_bson(&expect_iter, &expect_doc, NULL));
+    ASSERT(bson_equal(&got_doc, &expect_doc));
+
+    // The second expression has its own payload ID.
+    ASSERT(bson_iter_next(&got_iter));
+    ASSERT(mc_iter_document_as_bson(&got_iter, &got_doc, NULL));
+    ASSERT(!bson_equal(&got_doc, &expect_doc));
+    ASSERT(!bson_iter_next(&got_iter));
+    mongocrypt_ctx_destroy(ctx);
+
+    // Only range queries may be batched.
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx, MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR, -1), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_key_id(ctx, _mongocrypt_buffer_as_binary(&keyABC_id)), ctx);
+    ASSERT_FAILS(mongocrypt_ctx_explicit_encrypt_expression_batch_init(ctx, TEST_BSON("{'v': [1]}")),
+                 ctx,
+                 "may only be used for range queries");
+    mongocrypt_ctx_destroy(ctx);
+
+    mongocrypt_binary_destroy(got);
+    mongocrypt_destroy(crypt);
+    _mongocrypt_buffer_cleanup(&keyABC_id);
+}
+
+// Test that cached range options produce the same payloads.
+static void _test_encrypt_fle2_explicit_range_opts_cache(_mongocrypt_tester_t *tester) {
+    _mongocrypt_buffer_t keyABC_id;
+
+    if (!_aes_ctr_is_supported_by_os) {
+        printf("Common Crypto with no CTR support detected. Skipping.");
+        return;
+    }
+
+    _mongocrypt_buffer_copy_from_hex(&keyABC_id, "ABCDEFAB123498761234123456789012");
+    mongocrypt_binary_t *keyABC = TEST_FILE("./test/data/keys/"
+                                            "ABCDEFAB123498761234123456789012-local-"
+                                            "document.json");
+
+    mongocrypt_t *crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_WITH_RANGE_OPTS_CACHE);
+    for (int i = 0; i < 2; i++) {
         ee_testcase tc = {0};
-        tc.desc = "min is required to find int for range";
+        tc.desc = i == 0 ? "range options populate cache" : "range options hit cache";
         tc.algorithm = MONGOCRYPT_ALGORITHM_RANGE_STR;
-        tc.query_type = MONGOCRYPT_QUERY_TYPE_RANGE_STR;
         tc.user_key_id = &keyABC_id;
-        tc.contention_factor = OPT_I64(0);
-        tc.range_opts = TEST_BSON(RAW_STRING({"max" : {"$numberInt" : "200"}, "sparsity" : {"$numberLong" : "1"}}));
-        tc.msg = TEST_BSON(RAW_STRING({
-            "v" : {"$and" :
-                       [ {"age" : {"$gte" : {"$numberInt" : "23"}}}, {"age" : {"$lte" : {"$numberInt" : "35"}}} ]}
-        }));
+        tc.index_key_id = &keyABC_id;
+        tc.contention_factor = OPT_I64(4);
+        tc.query_type = MONGOCRYPT_QUERY_TYPE_RANGE_STR;
+        tc.range_opts = TEST_FILE("./test/data/fle2-find-range-explicit/int32/rangeopts.json");
+        tc.msg = TEST_FILE("./test/data/fle2-find-range-explicit/int32/value-to-encrypt.json");
         tc.keys_to_feed[0] = keyABC;
-        tc.expect_finalize_error = "Range option 'min' is required";
+        tc.expect = TEST_FILE("./test/data/fle2-find-range-explicit/int32/encrypted-payload-v2.json");
         tc.is_expression = true;
+        tc.use_v2 = true;
+        tc.crypt = crypt;
         ee_testcase_run(&tc);
+        ASSERT_CMPUINT32(_mongocrypt_cache_num_entries(&crypt->cache_range_opts), ==, 1);
     }
 
+    _mongocrypt_cache_stats_t stats;
+    _mongocrypt_cache_stats(&crypt->cache_range_opts, &stats);
+    ASSERT_CMPINT64(stats.hits, ==, 1);
+    ASSERT_CMPINT64(stats.misses, ==, 1);
+
+    // Invalid options are not cached.
+    mongocrypt_ctx_t *ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_FAILS(mongocrypt_ctx_setopt_algorithm_range(ctx, TEST_BSON("{'min': 0, 'max': 200}")),
+                 ctx,
+                 "Missing field 'sparsity'");
+    ASSERT_CMPUINT32(_mongocrypt_cache_num_entries(&crypt->cache_range_opts), ==, 1);
+    mongocrypt_ctx_destroy(ctx);
+
+    mongocrypt_destroy(crypt);
+    _mongocrypt_buffer_cleanup(&keyABC_id);
+}
+
+static void _test_encrypt_fle2_explicit_find_payload_cache(_mongocrypt_tester_t *tester) {
+    _mongocrypt_buffer_t keyABC_id;
+    _mongocrypt_buffer_t key123_id;
+
+    _mongocrypt_buffer_copy_from_hex(&keyABC_id, "ABCDEFAB123498761234123456789012");
+    _mongocrypt_buffer_copy_from_hex(&key123_id, "12345678123498761234123456789012");
+    mongocrypt_binary_t *keyABC = TEST_FILE("./test/data/keys/"
+                                            "ABCDEFAB123498761234123456789012-local-"
+                                            "document.json");
+    mongocrypt_binary_t *key123 = TEST_FILE("./test/data/keys/"
+                                            "12345678123498761234123456789012-local-"
+                                            "document.json");
+
+    // The cache is disabled by default.
     {
+        mongocrypt_t *crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
         ee_testcase tc = {0};
-        tc.desc = "max is required to find int for range";
-        tc.algorithm = MONGOCRYPT_ALGORITHM_RANGE_STR;
-        tc.query_type = MONGOCRYPT_QUERY_TYPE_RANGE_STR;
+        tc.desc = "equality query without find payload cache";
+        tc.algorithm = MONGOCRYPT_ALGORITHM_INDEXED_STR;
+        tc.query_type = MONGOCRYPT_QUERY_TYPE_EQUALITY_STR;
         tc.user_key_id = &keyABC_id;
+        tc.index_key_id = &key123_id;
         tc.contention_factor = OPT_I64(0);
-        tc.range_opts = TEST_BSON(RAW_STRING({"min" : {"$numberInt" : "0"}, "sparsity" : {"$numberLong" : "1"}}));
-        tc.msg = TEST_BSON(RAW_STRING({
-            "v" : {"$and" :
-                       [ {"age" : {"$gte" : {"$numberInt" : "23"}}}, {"age" : {"$lte" : {"$numberInt" : "35"}}} ]}
-        }));
+        tc.msg = TEST_BSON("{'v': 123456}");
         tc.keys_to_feed[0] = keyABC;
-        tc.expect_finalize_error = "Range option 'max' is required";
-        tc.is_expression = true;
+        tc.keys_to_feed[1] = key123;
+        tc.expect = TEST_FILE("./test/data/fle2-explicit/find-indexed-v2.json");
+        tc.use_v2 = true;
+        tc.crypt = crypt;
         ee_testcase_run(&tc);
+        ASSERT_CMPUINT32(_mongocrypt_cache_num_entries(&crypt->cache_find_payload), ==, 0);
+        mongocrypt_destroy(crypt);
+    }
+
+    // Repeated queries reuse the cached payload.
+    {
+        mongocrypt_t *crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_WITH_FIND_PAYLOAD_CACHE);
+        for (int i = 0; i < 2; i++) {
+            ee_testcase tc = {0};
+            tc.desc = i == 0 ? "equality query populates find payload cache" : "equality query hits find payload cache";
+            tc.algorithm = MONGOCRYPT_ALGORITHM_INDEXED_STR;
+            tc.query_type = MONGOCRYPT_QUERY_TYPE_EQUALITY_STR;
+            tc.user_key_id = &keyABC_id;
+            tc.index_key_id = &key123_id;
+            tc.contention_factor = OPT_I64(0);
+            tc.msg = TEST_BSON("{'v': 123456}");
+            tc.keys_to_feed[0] = keyABC;
+            tc.keys_to_feed[1] = key123;
+            tc.expect = TEST_FILE("./test/data/fle2-explicit/find-indexed-v2.json");
+            tc.use_v2 = true;
+            tc.crypt = crypt;
+            ee_testcase_run(&tc);
+            ASSERT_CMPUINT32(_mongocrypt_cache_num_entries(&crypt->cache_find_payload), ==, 1);
+        }
+
+        _mongocrypt_cache_stats_t stats;
+        _mongocrypt_cache_stats(&crypt->cache_find_payload, &stats);
+        ASSERT_CMPINT64(stats.hits, ==, 1);
+        ASSERT_CMPINT64(stats.misses, ==, 1);
+        mongocrypt_destroy(crypt);
     }
 
-    _mongocrypt_buffer_cleanup(&keyABC_id);
     _mongocrypt_buffer_cleanup(&key123_id);
+    _mongocrypt_buffer_cleanup(&keyABC_id);
 }
 
 static void _test_encrypt_applies_default_state_collections(_mongocrypt_tester_t *tester) {
@@ -4735,7 +5737,16 @@ static void _test_bulkWrite(_mongocrypt_tester_t *tester) {
             mongocrypt_ctx_t *ctx = mongocrypt_ctx_new(crypt);
             mongocrypt_binary_t *cmd =
                 TEST_BSON(BSON_STR({"bulkWrite" : 1, "nsInfo" : [ {"ns" : "db.coll"}, {"ns" : "db.coll2"} ]}));
-            ASSERT_FAILS(mongocrypt_ctx_encrypt_init(ctx, "admin", -1, cmd), ctx, "found more than one");
+            ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "admin", -1, cmd), ctx);
+            mongocrypt_ctx_destroy(ctx);
+        }
+
+        // A later `nsInfo.ns` is not correct form.
+        {
+            mongocrypt_ctx_t *ctx = mongocrypt_ctx_new(crypt);
+            mongocrypt_binary_t *cmd =
+                TEST_BSON(BSON_STR({"bulkWrite" : 1, "nsInfo" : [ {"ns" : "db.coll"}, {"ns" : "invalid"} ]}));
+            ASSERT_FAILS(mongocrypt_ctx_encrypt_init(ctx, "admin", -1, cmd), ctx, "expected namespace to contain dot");
             mongocrypt_ctx_destroy(ctx);
         }
 
@@ -4875,6 +5886,283 @@ static void _test_bulkWrite(_mongocrypt_tester_t *tester) {
         mongocrypt_destroy(crypt);
     }
 
+    // Test a bulkWrite with more than one namespace. Namespaces of a database are fetched in one collinfo state.
+    {
+        mongocrypt_t *crypt = mongocrypt_new();
+        mongocrypt_setopt_use_need_mongo_collinfo_with_db_state(crypt);
+
+        mongocrypt_setopt_kms_providers(
+            crypt,
+            TEST_BSON(BSON_STR({"local" : {"key" : {"$binary" : {"base64" : "%s", "subType" : "00"}}}}), local_kek));
+
+        ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+
+        mongocrypt_ctx_t *ctx = mongocrypt_ctx_new(crypt);
+
+        ASSERT_OK(
+            mongocrypt_ctx_encrypt_init(ctx, "admin", -1, TEST_FILE("./test/data/bulkWrite/multiNamespace/cmd.json")),
+            ctx);
+
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_COLLINFO_WITH_DB);
+        {
+            const char *db = mongocrypt_ctx_mongo_db(ctx);
+            ASSERT_OK(db, ctx);
+            ASSERT_STREQUAL(db, "db");
+
+            {
+                mongocrypt_binary_t *cmd = mongocrypt_binary_new();
+                ASSERT_OK(mongocrypt_ctx_mongo_op(ctx, cmd), ctx);
+                ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_BSON(BSON_STR({"name" : {"$in" : [ "test", "other" ]}})),
+                                                    cmd);
+                mongocrypt_binary_destroy(cmd);
+            }
+            // Only feed `db.test`. `db.other` is unencrypted.
+            ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx, TEST_FILE("./test/data/bulkWrite/simple/collinfo.json")), ctx);
+            ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+        }
+
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_COLLINFO_WITH_DB);
+        {
+            const char *db = mongocrypt_ctx_mongo_db(ctx);
+            ASSERT_OK(db, ctx);
+            ASSERT_STREQUAL(db, "db2");
+
+            {
+                mongocrypt_binary_t *cmd = mongocrypt_binary_new();
+                ASSERT_OK(mongocrypt_ctx_mongo_op(ctx, cmd), ctx);
+                ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_BSON(BSON_STR({"name" : "other"})), cmd);
+                mongocrypt_binary_destroy(cmd);
+            }
+            // `db2.other` is unencrypted.
+            ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+        }
+
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_MARKINGS);
+        {
+            mongocrypt_binary_t *cmd_to_mongocryptd = mongocrypt_binary_new();
+
+            ASSERT_OK(mongocrypt_ctx_mongo_op(ctx, cmd_to_mongocryptd), ctx);
+            ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(
+                TEST_FILE("./test/data/bulkWrite/multiNamespace/cmd-to-mongocryptd.json"),
+                cmd_to_mongocryptd);
+            mongocrypt_binary_destroy(cmd_to_mongocryptd);
+            ASSERT_OK(
+                mongocrypt_ctx_mongo_feed(ctx,
+                                          TEST_FILE("./test/data/bulkWrite/multiNamespace/mongocryptd-reply.json")),
+                ctx);
+            ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+        }
+
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+        {
+            ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx, TEST_FILE("./test/data/key-document-local.json")), ctx);
+            ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+        }
+
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+        {
+            mongocrypt_binary_t *out = mongocrypt_binary_new();
+            ASSERT_OK(mongocrypt_ctx_finalize(ctx, out), ctx);
+
+            // Match results.
+            bson_t out_bson;
+            ASSERT(_mongocrypt_binary_to_bson(out, &out_bson));
+            mongocrypt_binary_t *pattern =
+                TEST_FILE("./test/data/bulkWrite/multiNamespace/encrypted-payload-pattern.json");
+            bson_t pattern_bson;
+            ASSERT(_mongocrypt_binary_to_bson(pattern, &pattern_bson));
+            _assert_match_bson(&out_bson, &pattern_bson);
+            // Unencrypted namespaces do not get `encryptionInformation`.
+            ASSERT(!bson_has_field(&out_bson, "nsInfo.1.encryptionInformation"));
+            ASSERT(!bson_has_field(&out_bson, "nsInfo.2.encryptionInformation"));
+
+            mongocrypt_binary_destroy(out);
+        }
+
+        mongocrypt_ctx_destroy(ctx);
+
+        // Test again to ensure every namespace is loaded from the collinfo cache.
+        ctx = mongocrypt_ctx_new(crypt);
+
+        ASSERT_OK(
+            mongocrypt_ctx_encrypt_init(ctx, "admin", -1, TEST_FILE("./test/data/bulkWrite/multiNamespace/cmd.json")),
+            ctx);
+
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_MARKINGS);
+        {
+            mongocrypt_binary_t *cmd_to_mongocryptd = mongocrypt_binary_new();
+
+            ASSERT_OK(mongocrypt_ctx_mongo_op(ctx, cmd_to_mongocryptd), ctx);
+            ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(
+                TEST_FILE("./test/data/bulkWrite/multiNamespace/cmd-to-mongocryptd.json"),
+                cmd_to_mongocryptd);
+            mongocrypt_binary_destroy(cmd_to_mongocryptd);
+        }
+
+        mongocrypt_ctx_destroy(ctx);
+        mongocrypt_destroy(crypt);
+    }
+
+    // Test a bulkWrite with more than one namespace in MONGOCRYPT_CTX_NEED_MONGO_OPS. The collinfo of each database
+    // and the keys of the local encryptedFields are fetched at once.
+    {
+        mongocrypt_t *crypt = mongocrypt_new();
+        mongocrypt_setopt_use_need_mongo_collinfo_with_db_state(crypt);
+        mongocrypt_setopt_use_need_mongo_ops_state(crypt);
+
+        mongocrypt_setopt_kms_providers(
+            crypt,
+            TEST_BSON(BSON_STR({"local" : {"key" : {"$binary" : {"base64" : "%s", "subType" : "00"}}}}), local_kek));
+
+        ASSERT_OK(mongocrypt_setopt_encrypted_field_config_map(
+                      crypt,
+                      TEST_FILE("./test/data/bulkWrite/simple/encrypted-field-map.json")),
+                  crypt);
+        ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+
+        mongocrypt_ctx_t *ctx = mongocrypt_ctx_new(crypt);
+
+        ASSERT_OK(
+            mongocrypt_ctx_encrypt_init(ctx, "admin", -1, TEST_FILE("./test/data/bulkWrite/multiNamespace/cmd.json")),
+            ctx);
+
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_OPS);
+        {
+            mongocrypt_mongo_op_t *collinfo_db = mongocrypt_ctx_next_mongo_op(ctx);
+            mongocrypt_mongo_op_t *collinfo_db2 = mongocrypt_ctx_next_mongo_op(ctx);
+            mongocrypt_mongo_op_t *keys = mongocrypt_ctx_next_mongo_op(ctx);
+            mongocrypt_binary_t *cmd = mongocrypt_binary_new();
+
+            ASSERT(collinfo_db && collinfo_db2 && keys);
+            ASSERT(!mongocrypt_ctx_next_mongo_op(ctx));
+
+            ASSERT_STATE_EQUAL(mongocrypt_mongo_op_type(collinfo_db), MONGOCRYPT_CTX_NEED_MONGO_COLLINFO_WITH_DB);
+            ASSERT_STREQUAL(mongocrypt_mongo_op_db(collinfo_db), "db");
+            ASSERT_OK(mongocrypt_mongo_op_op(collinfo_db, cmd), ctx);
+            ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_BSON(BSON_STR({"name" : "other"})), cmd);
+
+            ASSERT_STATE_EQUAL(mongocrypt_mongo_op_type(collinfo_db2), MONGOCRYPT_CTX_NEED_MONGO_COLLINFO_WITH_DB);
+            ASSERT_STREQUAL(mongocrypt_mongo_op_db(collinfo_db2), "db2");
+
+            ASSERT_STATE_EQUAL(mongocrypt_mongo_op_type(keys), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+            ASSERT_OK(mongocrypt_mongo_op_op(keys, cmd), ctx);
+            ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(
+                TEST_BSON(BSON_STR(
+                    {"_id" : {"$in" : [ {"$binary" : {"base64" : "YWFhYWFhYWFhYWFhYWFhYQ==", "subType" : "04"}} ]}})),
+                cmd);
+            ASSERT_OK(mongocrypt_mongo_op_projection(keys, cmd), ctx);
+            ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(
+                TEST_BSON("{'_id': 1, 'keyAltNames': 1, 'keyMaterial': 1, 'masterKey': 1}"),
+                cmd);
+            mongocrypt_binary_destroy(cmd);
+
+            // The state is only left once every operation is done. Both other namespaces are unencrypted.
+            ASSERT_OK(mongocrypt_mongo_op_feed(keys, TEST_FILE("./test/data/key-document-local.json")), ctx);
+            ASSERT_OK(mongocrypt_mongo_op_done(keys), ctx);
+            ASSERT_OK(mongocrypt_mongo_op_done(collinfo_db2), ctx);
+            ASSERT_FAILS(mongocrypt_mongo_op_feed(keys, TEST_FILE("./test/data/key-document-local.json")),
+                         ctx,
+                         "mongo operation is done");
+        }
+        mongocrypt_ctx_destroy(ctx);
+
+        ctx = mongocrypt_ctx_new(crypt);
+        ASSERT_OK(
+            mongocrypt_ctx_encrypt_init(ctx, "admin", -1, TEST_FILE("./test/data/bulkWrite/multiNamespace/cmd.json")),
+            ctx);
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_OPS);
+        {
+            mongocrypt_mongo_op_t *op;
+            mongocrypt_mongo_op_t *collinfo_db = NULL;
+
+            while ((op = mongocrypt_ctx_next_mongo_op(ctx))) {
+                if (mongocrypt_mongo_op_type(op) == MONGOCRYPT_CTX_NEED_MONGO_KEYS) {
+                    ASSERT_OK(mongocrypt_mongo_op_feed(op, TEST_FILE("./test/data/key-document-local.json")), ctx);
+                    ASSERT_OK(mongocrypt_mongo_op_done(op), ctx);
+                } else if (0 == strcmp(mongocrypt_mongo_op_db(op), "db")) {
+                    collinfo_db = op;
+                } else {
+                    ASSERT_OK(mongocrypt_mongo_op_done(op), ctx);
+                }
+            }
+            ASSERT(collinfo_db);
+            ASSERT_FAILS(mongocrypt_ctx_mongo_done(ctx), ctx, "not all mongo operations are done");
+        }
+        mongocrypt_ctx_destroy(ctx);
+
+        ctx = mongocrypt_ctx_new(crypt);
+        ASSERT_OK(
+            mongocrypt_ctx_encrypt_init(ctx, "admin", -1, TEST_FILE("./test/data/bulkWrite/multiNamespace/cmd.json")),
+            ctx);
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_OPS);
+        {
+            mongocrypt_mongo_op_t *op;
+
+            while ((op = mongocrypt_ctx_next_mongo_op(ctx))) {
+                if (mongocrypt_mongo_op_type(op) == MONGOCRYPT_CTX_NEED_MONGO_KEYS) {
+                    ASSERT_OK(mongocrypt_mongo_op_feed(op, TEST_FILE("./test/data/key-document-local.json")), ctx);
+                }
+                ASSERT_OK(mongocrypt_mongo_op_done(op), ctx);
+            }
+            ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+        }
+
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_MARKINGS);
+        {
+            ASSERT_OK(
+                mongocrypt_ctx_mongo_feed(ctx,
+                                          TEST_FILE("./test/data/bulkWrite/multiNamespace/mongocryptd-reply.json")),
+                ctx);
+            ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+        }
+
+        // The prefetched key satisfies the markings. MONGOCRYPT_CTX_NEED_MONGO_KEYS is skipped.
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+        {
+            mongocrypt_binary_t *out = mongocrypt_binary_new();
+            ASSERT_OK(mongocrypt_ctx_finalize(ctx, out), ctx);
+
+            bson_t out_bson;
+            ASSERT(_mongocrypt_binary_to_bson(out, &out_bson));
+            mongocrypt_binary_t *pattern =
+                TEST_FILE("./test/data/bulkWrite/multiNamespace/encrypted-payload-pattern.json");
+            bson_t pattern_bson;
+            ASSERT(_mongocrypt_binary_to_bson(pattern, &pattern_bson));
+            _assert_match_bson(&out_bson, &pattern_bson);
+
+            mongocrypt_binary_destroy(out);
+        }
+
+        mongocrypt_ctx_destroy(ctx);
+        mongocrypt_destroy(crypt);
+    }
+
+    // Test a bulkWrite with more than one namespace where only the target namespace is local.
+    {
+        mongocrypt_t *crypt = mongocrypt_new();
+
+        mongocrypt_setopt_kms_providers(
+            crypt,
+            TEST_BSON(BSON_STR({"local" : {"key" : {"$binary" : {"base64" : "%s", "subType" : "00"}}}}), local_kek));
+
+        ASSERT_OK(mongocrypt_setopt_encrypted_field_config_map(
+                      crypt,
+                      TEST_FILE("./test/data/bulkWrite/simple/encrypted-field-map.json")),
+                  crypt);
+        ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+
+        mongocrypt_ctx_t *ctx = mongocrypt_ctx_new(crypt);
+
+        // Fetching `db.other` requires MONGOCRYPT_CTX_NEED_MONGO_COLLINFO_WITH_DB.
+        ASSERT_FAILS(
+            mongocrypt_ctx_encrypt_init(ctx, "admin", -1, TEST_FILE("./test/data/bulkWrite/multiNamespace/cmd.json")),
+            ctx,
+            "Fetching remote collection information on separate databases is not supported");
+
+        mongocrypt_ctx_destroy(ctx);
+        mongocrypt_destroy(crypt);
+    }
+
     // Test a bulkWrite with remote schema when MONGOCRYPT_CTX_NEED_MONGO_COLLINFO_WITH_DB is not supported.
     {
         mongocrypt_t *crypt = mongocrypt_new();
@@ -5071,31 +6359,41 @@ void _mongocrypt_tester_install_ctx_encrypt(_mongocrypt_tester_t *tester) {
     INSTALL_TEST(_test_encrypt_init);
     INSTALL_TEST(_test_encrypt_need_collinfo);
     INSTALL_TEST(_test_encrypt_need_markings);
+    INSTALL_TEST(_test_encrypt_explain);
     INSTALL_TEST(_test_encrypt_csfle_no_needs_markings);
+    INSTALL_TEST(_test_encrypt_csfle_reuses_query_analyzer);
+    INSTALL_TEST(_test_encrypt_marking_cache);
     INSTALL_TEST(_test_encrypt_need_keys);
     INSTALL_TEST(_test_encrypt_ready);
     INSTALL_TEST(_test_key_missing_region);
     INSTALL_TEST(_test_view);
     INSTALL_TEST(_test_local_schema);
+    INSTALL_TEST(_test_update_schema_map);
     INSTALL_TEST(_test_encrypt_caches_collinfo);
     INSTALL_TEST(_test_encrypt_caches_keys);
+    INSTALL_TEST(_test_encrypt_invalidate_caches);
     INSTALL_TEST(_test_encrypt_caches_keys_by_alt_name);
     INSTALL_TEST(_test_encrypt_random);
     INSTALL_TEST(_test_encrypt_is_remote_schema);
     INSTALL_TEST(_test_encrypt_init_each_cmd);
+    INSTALL_TEST(_test_encrypt_borrow_input_passthrough);
     INSTALL_TEST(_test_encrypt_invalid_siblings);
     INSTALL_TEST(_test_encrypt_dupe_jsonschema);
     INSTALL_TEST(_test_encrypting_with_explicit_encryption);
     INSTALL_TEST(_test_explicit_encryption);
+    INSTALL_TEST(_test_explicit_encryption_deterministic_cache);
+    INSTALL_TEST(_test_explicit_encryption_batch);
     INSTALL_TEST(_test_encrypt_empty_aws);
     INSTALL_TEST(_test_encrypt_custom_endpoint);
     INSTALL_TEST(_test_encrypt_with_aws_session_token);
     INSTALL_TEST(_test_encrypt_caches_empty_collinfo);
     INSTALL_TEST(_test_encrypt_caches_collinfo_without_jsonschema);
+    INSTALL_TEST(_test_encrypt_prefetch_collinfo);
     INSTALL_TEST(_test_encrypt_per_ctx_credentials);
     INSTALL_TEST(_test_encrypt_per_ctx_credentials_given_empty);
     INSTALL_TEST(_test_encrypt_per_ctx_credentials_local);
     INSTALL_TEST(_test_encrypt_with_encrypted_field_config_map);
+    INSTALL_TEST(_test_encrypt_prefetch_key_ids);
     INSTALL_TEST(_test_encrypt_with_encrypted_field_config_map_bypassed);
     INSTALL_TEST(_test_encrypt_no_schema);
     INSTALL_TEST(_test_encrypt_remote_encryptedfields);
@@ -5105,6 +6403,12 @@ void _mongocrypt_tester_install_ctx_encrypt(_mongocrypt_tester_t *tester) {
     INSTALL_TEST(_test_encrypt_fle2_find_payload);
     INSTALL_TEST(_test_encrypt_fle2_unindexed_encrypted_payload);
     INSTALL_TEST(_test_encrypt_fle2_explicit);
+    INSTALL_TEST(_test_encrypt_fle2_explicit_mincover_cache);
+    INSTALL_TEST(_test_encrypt_fle2_explicit_range_opts_cache);
+    INSTALL_TEST(_test_encrypt_fle2_explicit_expression_batch);
+    INSTALL_TEST(_test_encrypt_fle2_explicit_find_payload_cache);
+    INSTALL_TEST(_test_encrypt_fle2_explicit_parallel_for);
+    INSTALL_TEST(_test_encrypt_parallel_markings);
     INSTALL_TEST(_test_encrypt_applies_default_state_collections);
     INSTALL_TEST(_test_encrypt_fle2_delete);
     INSTALL_TEST(_test_encrypt_fle2_omits_encryptionInformation);
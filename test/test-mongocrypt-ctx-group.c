@@ -0,0 +1,112 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mongocrypt-ctx-group-private.h"
+#include "test-mongocrypt.h"
+
+/* The _id of ./test/example/key-document.json */
+#define TEST_GROUP_KEY_ID "{'$binary': {'base64': 'YWFhYWFhYWFhYWFhYWFhYQ==', 'subType': '04'}}"
+
+static void _test_ctx_group(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctxs[2];
+    mongocrypt_ctx_group_t *group;
+    mongocrypt_kms_ctx_t *kms;
+    mongocrypt_binary_t *bin;
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    group = mongocrypt_ctx_group_new(crypt);
+    for (size_t i = 0; i < 2; i++) {
+        ctxs[i] = mongocrypt_ctx_new(crypt);
+        ASSERT_OK(mongocrypt_ctx_decrypt_init(ctxs[i], TEST_FILE("./test/data/encrypted-cmd.json")), ctxs[i]);
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctxs[i]), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+        ASSERT_OK(mongocrypt_ctx_group_add(group, ctxs[i]), group);
+    }
+
+    /* Both contexts need the same key. It is fetched once. */
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_group_state(group), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+    bin = mongocrypt_binary_new();
+    ASSERT_OK(mongocrypt_ctx_group_mongo_op(group, bin), group);
+    ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(
+        TEST_BSON("{'$or': [{'_id': {'$in': [" TEST_GROUP_KEY_ID "]}}, {'keyAltNames': {'$in': []}}]}"),
+        bin);
+    mongocrypt_binary_destroy(bin);
+    ASSERT_OK(mongocrypt_ctx_group_mongo_feed(group, TEST_FILE("./test/example/key-document.json")), group);
+    ASSERT_OK(mongocrypt_ctx_group_mongo_done(group), group);
+
+    /* And decrypted with one KMS request. */
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_group_state(group), MONGOCRYPT_CTX_NEED_KMS);
+    kms = mongocrypt_ctx_group_next_kms_ctx(group);
+    ASSERT(kms);
+    _mongocrypt_tester_satisfy_kms(tester, kms);
+    ASSERT(!mongocrypt_ctx_group_next_kms_ctx(group));
+    ASSERT_OK(mongocrypt_ctx_group_kms_done(group), group);
+
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_group_state(group), MONGOCRYPT_CTX_DONE);
+    mongocrypt_ctx_group_destroy(group);
+    for (size_t i = 0; i < 2; i++) {
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctxs[i]), MONGOCRYPT_CTX_READY);
+        _mongocrypt_tester_run_ctx_to(tester, ctxs[i], MONGOCRYPT_CTX_DONE);
+        mongocrypt_ctx_destroy(ctxs[i]);
+    }
+
+    mongocrypt_destroy(crypt);
+}
+
+static void _test_ctx_group_invalid(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_t *other_crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_ctx_group_t *group;
+    mongocrypt_status_t *status;
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    other_crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+
+    group = mongocrypt_ctx_group_new(crypt);
+    ctx = mongocrypt_ctx_new(other_crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+    ASSERT_FAILS(mongocrypt_ctx_group_add(group, ctx), group, "context belongs to another mongocrypt_t");
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_group_state(group), MONGOCRYPT_CTX_ERROR);
+    status = mongocrypt_status_new();
+    ASSERT(!mongocrypt_ctx_group_status(group, status));
+    ASSERT_STATUS_CONTAINS(status, "context belongs to another mongocrypt_t");
+    mongocrypt_status_destroy(status);
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_ctx_group_destroy(group);
+
+    group = mongocrypt_ctx_group_new(crypt);
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_FAILS(mongocrypt_ctx_group_add(group, ctx), group, "ctx NULL or uninitialized");
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_ctx_group_destroy(group);
+
+    group = mongocrypt_ctx_group_new(crypt);
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+    ASSERT_OK(mongocrypt_ctx_group_add(group, ctx), group);
+    ASSERT_FAILS(mongocrypt_ctx_group_add(group, ctx), group, "context is already in the group");
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_ctx_group_destroy(group);
+
+    mongocrypt_destroy(other_crypt);
+    mongocrypt_destroy(crypt);
+}
+
+void _mongocrypt_tester_install_ctx_group(_mongocrypt_tester_t *tester) {
+    INSTALL_TEST(_test_ctx_group);
+    INSTALL_TEST(_test_ctx_group_invalid);
+}
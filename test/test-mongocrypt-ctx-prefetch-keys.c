@@ -0,0 +1,237 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "test-mongocrypt.h"
+
+/* The _id of ./test/example/key-document.json */
+#define TEST_PREFETCH_KEY_ID "{'$binary': {'base64': 'YWFhYWFhYWFhYWFhYWFhYQ==', 'subType': '04'}}"
+
+static void _test_prefetch_keys(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *out;
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+
+    /* Fetch and decrypt the key. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_prefetch_keys_init(ctx, TEST_BSON("{'keyIds': [" TEST_PREFETCH_KEY_ID "]}")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    out = mongocrypt_binary_new();
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, out), ctx);
+    ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_BSON("{}"), out);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_DONE);
+    mongocrypt_binary_destroy(out);
+    mongocrypt_ctx_destroy(ctx);
+
+    ASSERT_CMPSIZE_T(_mongocrypt_cache_num_entries(&crypt->cache_key), ==, 1);
+
+    /* The key is now cached. Nothing is fetched. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_prefetch_keys_init(ctx, TEST_BSON("{'keyIds': [" TEST_PREFETCH_KEY_ID "]}")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    mongocrypt_ctx_destroy(ctx);
+
+    /* A decrypt using the key does not need to fetch it either. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    mongocrypt_ctx_destroy(ctx);
+
+    mongocrypt_destroy(crypt);
+}
+
+static void _test_prefetch_keys_invalid(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_FAILS(mongocrypt_ctx_prefetch_keys_init(ctx, NULL), ctx, "invalid key_ids");
+    mongocrypt_ctx_destroy(ctx);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_FAILS(mongocrypt_ctx_prefetch_keys_init(ctx, TEST_BSON("{}")), ctx, "expected array 'keyIds'");
+    mongocrypt_ctx_destroy(ctx);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_FAILS(mongocrypt_ctx_prefetch_keys_init(ctx, TEST_BSON("{'keyIds': []}")), ctx, "must not be empty");
+    mongocrypt_ctx_destroy(ctx);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_FAILS(mongocrypt_ctx_prefetch_keys_init(ctx, TEST_BSON("{'keyIds': ['not a UUID']}")),
+                 ctx,
+                 "expected UUID");
+    mongocrypt_ctx_destroy(ctx);
+
+    mongocrypt_destroy(crypt);
+}
+
+/* Returns {'keys': [key-document.json, key-document.json]}. */
+static mongocrypt_binary_t *_key_documents(_mongocrypt_tester_t *tester) {
+    bson_t key_doc;
+    mongocrypt_binary_t *docs;
+    char *json;
+
+    ASSERT(_mongocrypt_binary_to_bson(TEST_FILE("./test/example/key-document.json"), &key_doc));
+    json = bson_as_canonical_extended_json(&key_doc, NULL);
+    docs = TEST_BSON("{'keys': [%s, %s]}", json, json);
+    bson_free(json);
+    return docs;
+}
+
+static void _test_unwrap_pending_keys(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *out;
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+
+    /* Nothing is queued. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_unwrap_pending_keys_init(ctx), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    mongocrypt_ctx_destroy(ctx);
+
+    /* The key is queued twice, but decrypted once, without a key vault
+     * query. */
+    ASSERT_OK(mongocrypt_add_key_documents(crypt, _key_documents(tester)), crypt);
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_unwrap_pending_keys_init(ctx), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_KMS);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    out = mongocrypt_binary_new();
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, out), ctx);
+    ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_BSON("{}"), out);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_DONE);
+    mongocrypt_binary_destroy(out);
+    mongocrypt_ctx_destroy(ctx);
+
+    ASSERT_CMPSIZE_T(_mongocrypt_cache_num_entries(&crypt->cache_key), ==, 1);
+
+    /* A decrypt using the key does not need to fetch it. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    mongocrypt_ctx_destroy(ctx);
+
+    /* Cached keys are skipped. */
+    ASSERT_OK(mongocrypt_add_key_documents(crypt, _key_documents(tester)), crypt);
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_unwrap_pending_keys_init(ctx), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    mongocrypt_ctx_destroy(ctx);
+
+    mongocrypt_destroy(crypt);
+}
+
+static void _test_add_key_documents_invalid(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+
+    crypt = mongocrypt_new();
+    ASSERT_FAILS(mongocrypt_add_key_documents(crypt, _key_documents(tester)), crypt, "mongocrypt_init not called");
+    mongocrypt_destroy(crypt);
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    ASSERT_FAILS(mongocrypt_add_key_documents(crypt, NULL), crypt, "invalid BSON key documents");
+    ASSERT_FAILS(mongocrypt_add_key_documents(crypt, TEST_BSON("{}")), crypt, "expected array 'keys'");
+    ASSERT_FAILS(mongocrypt_add_key_documents(crypt, TEST_BSON("{'keys': [1]}")), crypt, "expected document");
+    ASSERT_FAILS(mongocrypt_add_key_documents(crypt, TEST_BSON("{'keys': [{'_id': 1}]}")), crypt, "is not a UUID");
+
+    /* Nothing was queued. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_unwrap_pending_keys_init(ctx), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    mongocrypt_ctx_destroy(ctx);
+
+    mongocrypt_destroy(crypt);
+}
+
+/* The _id of ./test/data/rmd/key-document-local.json */
+#define TEST_LOCAL_KEY_ID "{'$binary': {'base64': 'bG9jYWxrZXlsb2NhbGtleQ==', 'subType': '04'}}"
+
+typedef struct {
+    int calls;
+    uint32_t last_count;
+} _counting_parallel_for_ctx;
+
+static void _counting_parallel_for(void *ctx, mongocrypt_task_fn task, void *task_ctx, uint32_t count) {
+    _counting_parallel_for_ctx *pctx = ctx;
+    pctx->calls++;
+    pctx->last_count = count;
+    for (uint32_t i = 0; i < count; i++) {
+        task(task_ctx, i);
+    }
+}
+
+/* Fetches the local key with a prefetch context and returns the number of
+ * keys in the key cache. */
+static size_t _prefetch_local_key(_mongocrypt_tester_t *tester, mongocrypt_t *crypt) {
+    mongocrypt_ctx_t *ctx;
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_prefetch_keys_init(ctx, TEST_BSON("{'keyIds': [" TEST_LOCAL_KEY_ID "]}")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+    ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx, TEST_FILE("./test/data/rmd/key-document-local.json")), ctx);
+    ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    mongocrypt_ctx_destroy(ctx);
+    return _mongocrypt_cache_num_entries(&crypt->cache_key);
+}
+
+static void _test_prefetch_keys_parallel_unwrap(_mongocrypt_tester_t *tester) {
+    _counting_parallel_for_ctx pctx = {0};
+    mongocrypt_t *crypt;
+
+    /* Without a threshold, the key is unwrapped when fed. */
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    crypt->crypto->parallel_for = _counting_parallel_for;
+    crypt->crypto->parallel_for_ctx = &pctx;
+    ASSERT_CMPSIZE_T(_prefetch_local_key(tester, crypt), ==, 1);
+    ASSERT_CMPINT(pctx.calls, ==, 0);
+    mongocrypt_destroy(crypt);
+
+    /* Below the threshold, the deferred key is unwrapped on the calling
+     * thread. */
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    crypt->crypto->parallel_for = _counting_parallel_for;
+    crypt->crypto->parallel_for_ctx = &pctx;
+    crypt->opts.parallel_key_unwrap_threshold = 2;
+    ASSERT_CMPSIZE_T(_prefetch_local_key(tester, crypt), ==, 1);
+    ASSERT_CMPINT(pctx.calls, ==, 0);
+    mongocrypt_destroy(crypt);
+
+    /* At the threshold, the key is unwrapped by the executor. */
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    crypt->crypto->parallel_for = _counting_parallel_for;
+    crypt->crypto->parallel_for_ctx = &pctx;
+    crypt->opts.parallel_key_unwrap_threshold = 1;
+    ASSERT_CMPSIZE_T(_prefetch_local_key(tester, crypt), ==, 1);
+    ASSERT_CMPINT(pctx.calls, ==, 1);
+    ASSERT_CMPUINT32(pctx.last_count, ==, 1);
+    mongocrypt_destroy(crypt);
+}
+
+void _mongocrypt_tester_install_ctx_prefetch_keys(_mongocrypt_tester_t *tester) {
+    INSTALL_TEST(_test_prefetch_keys);
+    INSTALL_TEST(_test_prefetch_keys_invalid);
+    INSTALL_TEST(_test_prefetch_keys_parallel_unwrap);
+    INSTALL_TEST(_test_unwrap_pending_keys);
+    INSTALL_TEST(_test_add_key_documents_invalid);
+}
@@ -744,6 +744,183 @@ static void _test_rewrap_many_datakey_finalize(_mongocrypt_tester_t *tester) {
     mongocrypt_destroy(crypt);
 }
 
+static void _test_rewrap_many_datakey_next_batch(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *const crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    mongocrypt_ctx_t *const ctx = mongocrypt_ctx_new(crypt);
+
+    mongocrypt_binary_t *const filter = TEST_BSON("{'keyAltName': {'$in': ['keyDocumentA', 'keyDocumentB']}}");
+
+    mongocrypt_binary_t *const key_doc_a = TEST_FILE("./test/data/rmd/key-document-a.json");
+    mongocrypt_binary_t *const key_doc_b = TEST_FILE("./test/data/rmd/key-document-b.json");
+
+    _test_datakey_fields_t *const fields_a = _find_datakey_fields(key_doc_a);
+    _test_datakey_fields_t *const fields_b = _find_datakey_fields(key_doc_b);
+
+    mongocrypt_kms_ctx_t *kms = NULL;
+    mongocrypt_binary_t res;
+
+    ASSERT_OK(mongocrypt_ctx_setopt_key_encryption_key(ctx,
+                                                       TEST_BSON("{'provider': 'aws',"
+                                                                 " 'region': 'us-east-1',"
+                                                                 " 'key': '" TEST_REWRAP_MASTER_KEY_ID_NEW "'}")),
+              ctx);
+    ASSERT_OK(mongocrypt_ctx_rewrap_many_datakey_init(ctx, filter), ctx);
+    ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx, key_doc_a), ctx);
+    ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx, key_doc_b), ctx);
+    ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+
+    ASSERT_FAILS(mongocrypt_ctx_rewrap_many_datakey_next_batch(ctx, 0u, &res), ctx, "max_keys must be greater than 0");
+    mongocrypt_ctx_destroy(ctx);
+
+    mongocrypt_ctx_t *const ctx2 = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_key_encryption_key(ctx2,
+                                                       TEST_BSON("{'provider': 'aws',"
+                                                                 " 'region': 'us-east-1',"
+                                                                 " 'key': '" TEST_REWRAP_MASTER_KEY_ID_NEW "'}")),
+              ctx2);
+    ASSERT_OK(mongocrypt_ctx_rewrap_many_datakey_init(ctx2, filter), ctx2);
+    ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx2, key_doc_a), ctx2);
+    ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx2, key_doc_b), ctx2);
+    ASSERT_OK(mongocrypt_ctx_mongo_done(ctx2), ctx2);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx2), MONGOCRYPT_CTX_NEED_KMS);
+    ASSERT((kms = mongocrypt_ctx_next_kms_ctx(ctx2)));
+    ASSERT_OK(mongocrypt_kms_ctx_feed(kms, TEST_FILE("./test/data/rmd/kms-decrypt-reply-b.txt")), kms);
+    ASSERT((kms = mongocrypt_ctx_next_kms_ctx(ctx2)));
+    ASSERT_OK(mongocrypt_kms_ctx_feed(kms, TEST_FILE("./test/data/rmd/kms-decrypt-reply-a.txt")), kms);
+    ASSERT_OK(mongocrypt_ctx_kms_done(ctx2), ctx2);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx2), MONGOCRYPT_CTX_NEED_KMS);
+
+    /* The encrypt requests of both keys are returned in one round. */
+    ASSERT((kms = mongocrypt_ctx_next_kms_ctx(ctx2)));
+    ASSERT_OK(mongocrypt_kms_ctx_feed(kms, TEST_FILE("./test/data/rmd/kms-encrypt-reply-a.txt")), kms);
+    ASSERT((kms = mongocrypt_ctx_next_kms_ctx(ctx2)));
+    ASSERT_OK(mongocrypt_kms_ctx_feed(kms, TEST_FILE("./test/data/rmd/kms-encrypt-reply-b.txt")), kms);
+    ASSERT(!mongocrypt_ctx_next_kms_ctx(ctx2));
+    ASSERT_OK(mongocrypt_ctx_kms_done(ctx2), ctx2);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx2), MONGOCRYPT_CTX_READY);
+
+    /* Each batch has one key. */
+    {
+        bool seen_a = false, seen_b = false;
+
+        for (int i = 0; i < 2; i++) {
+            bson_t bson;
+            bson_iter_t iter;
+            _mongocrypt_buffer_t id;
+
+            ASSERT_OK(mongocrypt_ctx_rewrap_many_datakey_next_batch(ctx2, 1u, &res), ctx2);
+            ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx2), MONGOCRYPT_CTX_READY);
+            ASSERT(_mongocrypt_binary_to_bson(&res, &bson));
+            ASSERT(bson_iter_init(&iter, &bson));
+            ASSERT(!bson_iter_find_descendant(&iter, "v.1", &iter));
+            ASSERT(bson_iter_init(&iter, &bson));
+            ASSERT(bson_iter_find_descendant(&iter, "v.0.masterKey.key", &iter));
+            ASSERT_STREQUAL(TEST_REWRAP_MASTER_KEY_ID_NEW, bson_iter_utf8(&iter, NULL));
+
+            /* The batch is only valid until the next call. */
+            ASSERT(bson_iter_init(&iter, &bson));
+            ASSERT(bson_iter_find_descendant(&iter, "v.0._id", &iter));
+            id = _find_key_id_from_iter(&iter);
+            seen_a |= _buffer_cmp_equal(&fields_a->id, &id);
+            seen_b |= _buffer_cmp_equal(&fields_b->id, &id);
+        }
+
+        ASSERT(seen_a && seen_b);
+    }
+
+    /* The call after the last key ends the batches. */
+    ASSERT_OK(mongocrypt_ctx_rewrap_many_datakey_next_batch(ctx2, 1u, &res), ctx2);
+    ASSERT_CMPUINT32(res.len, ==, 0u);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx2), MONGOCRYPT_CTX_DONE);
+    mongocrypt_ctx_destroy(ctx2);
+
+    _test_datakey_fields_destroy(fields_b);
+    _test_datakey_fields_destroy(fields_a);
+    mongocrypt_destroy(crypt);
+}
+
+static void _test_rewrap_many_datakey_skip_unchanged(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *const crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+
+    mongocrypt_binary_t *const filter = TEST_BSON("{'keyAltName': {'$in': ['keyDocumentA', 'keyDocumentB']}}");
+    /* Key document A has this masterKey, with fields in another order. Key
+     * document B also has an endpoint. */
+    mongocrypt_binary_t *const kek = TEST_BSON("{'provider': 'aws',"
+                                               " 'region': 'us-east-1',"
+                                               " 'key': '" TEST_REWRAP_MASTER_KEY_ID_OLD "'}");
+
+    mongocrypt_kms_ctx_t *kms = NULL;
+    mongocrypt_binary_t res;
+
+    /* Key A is neither decrypted nor encrypted. */
+    {
+        mongocrypt_ctx_t *const ctx = mongocrypt_ctx_new(crypt);
+        bson_t bson;
+        bson_iter_t iter;
+
+        ASSERT_OK(mongocrypt_ctx_setopt_key_encryption_key(ctx, kek), ctx);
+        ASSERT_OK(mongocrypt_ctx_setopt_rewrap_skip_unchanged(ctx), ctx);
+        ASSERT_OK(mongocrypt_ctx_rewrap_many_datakey_init(ctx, filter), ctx);
+        ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx, TEST_FILE("./test/data/rmd/key-document-a.json")), ctx);
+        ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx, TEST_FILE("./test/data/rmd/key-document-b.json")), ctx);
+        ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_KMS);
+        ASSERT((kms = mongocrypt_ctx_next_kms_ctx(ctx)));
+        _assert_aws_kms_endpoint(kms, "example.com:443");
+        ASSERT_OK(mongocrypt_kms_ctx_feed(kms, TEST_FILE("./test/data/rmd/kms-decrypt-reply-b.txt")), kms);
+        ASSERT(!mongocrypt_ctx_next_kms_ctx(ctx));
+        ASSERT_OK(mongocrypt_ctx_kms_done(ctx), ctx);
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_KMS);
+        ASSERT((kms = mongocrypt_ctx_next_kms_ctx(ctx)));
+        ASSERT_OK(mongocrypt_kms_ctx_feed(kms, TEST_FILE("./test/data/rmd/kms-encrypt-reply-b.txt")), kms);
+        ASSERT(!mongocrypt_ctx_next_kms_ctx(ctx));
+        ASSERT_OK(mongocrypt_ctx_kms_done(ctx), ctx);
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+
+        ASSERT_OK(mongocrypt_ctx_finalize(ctx, &res), ctx);
+        ASSERT(_mongocrypt_binary_to_bson(&res, &bson));
+        ASSERT(bson_iter_init(&iter, &bson));
+        ASSERT(bson_iter_find_descendant(&iter, "v.0", &iter));
+        ASSERT(bson_iter_init(&iter, &bson));
+        ASSERT(!bson_iter_find_descendant(&iter, "v.1", &iter));
+        ASSERT(bson_iter_init_find(&iter, &bson, "skipped"));
+        ASSERT_CMPINT64(bson_iter_int64(&iter), ==, 1);
+        mongocrypt_ctx_destroy(ctx);
+    }
+
+    /* If every key is skipped, the count is still output. */
+    {
+        mongocrypt_ctx_t *const ctx = mongocrypt_ctx_new(crypt);
+
+        ASSERT_OK(mongocrypt_ctx_setopt_key_encryption_key(ctx, kek), ctx);
+        ASSERT_OK(mongocrypt_ctx_setopt_rewrap_skip_unchanged(ctx), ctx);
+        ASSERT_OK(mongocrypt_ctx_rewrap_many_datakey_init(ctx, filter), ctx);
+        ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx, TEST_FILE("./test/data/rmd/key-document-a.json")), ctx);
+        ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+        ASSERT_OK(mongocrypt_ctx_rewrap_many_datakey_next_batch(ctx, 1u, &res), ctx);
+        ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_BSON("{'v': [], 'skipped': {'$numberLong': '1'}}"), &res);
+        ASSERT_OK(mongocrypt_ctx_rewrap_many_datakey_next_batch(ctx, 1u, &res), ctx);
+        ASSERT_CMPUINT32(res.len, ==, 0u);
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_DONE);
+        mongocrypt_ctx_destroy(ctx);
+    }
+
+    /* Without the option, key A is rewrapped. */
+    {
+        mongocrypt_ctx_t *const ctx = mongocrypt_ctx_new(crypt);
+
+        ASSERT_OK(mongocrypt_ctx_setopt_key_encryption_key(ctx, kek), ctx);
+        ASSERT_OK(mongocrypt_ctx_rewrap_many_datakey_init(ctx, filter), ctx);
+        ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx, TEST_FILE("./test/data/rmd/key-document-a.json")), ctx);
+        ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_KMS);
+        mongocrypt_ctx_destroy(ctx);
+    }
+
+    mongocrypt_destroy(crypt);
+}
+
 static void _test_rewrap_many_datakey_kms_credentials(_mongocrypt_tester_t *tester) {
     mongocrypt_t *crypt = NULL;
     mongocrypt_ctx_t *ctx = NULL;
@@ -843,5 +1020,7 @@ void _mongocrypt_tester_install_ctx_rewrap_many_datakey(_mongocrypt_tester_t *te
     INSTALL_TEST(_test_rewrap_many_datakey_need_kms_decrypt);
     INSTALL_TEST(_test_rewrap_many_datakey_need_kms_encrypt);
     INSTALL_TEST(_test_rewrap_many_datakey_finalize);
+    INSTALL_TEST(_test_rewrap_many_datakey_next_batch);
+    INSTALL_TEST(_test_rewrap_many_datakey_skip_unchanged);
     INSTALL_TEST(_test_rewrap_many_datakey_kms_credentials);
 }
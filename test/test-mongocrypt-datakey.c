@@ -399,6 +399,66 @@ static void _test_datakey_custom_key_material(_mongocrypt_tester_t *tester) {
     mongocrypt_destroy(crypt);
 }
 
+static void _test_datakey_batch(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_kms_ctx_t *kms;
+    mongocrypt_binary_t *bin;
+    bson_t as_bson;
+    bson_iter_t iter;
+    _mongocrypt_buffer_t id0, id2;
+    int n_kms = 0;
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_masterkey_local(ctx), ctx);
+    ASSERT_FAILS(mongocrypt_ctx_datakey_batch_init(ctx, 0), ctx, "count must be greater than 0");
+    mongocrypt_ctx_destroy(ctx);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_FAILS(mongocrypt_ctx_datakey_batch_init(ctx, 1), ctx, "master key required");
+    mongocrypt_ctx_destroy(ctx);
+
+    /* The KMS requests of all keys are returned in one round. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_masterkey_aws(ctx, "region", -1, "cmk", -1), ctx);
+    ASSERT_OK(mongocrypt_ctx_datakey_batch_init(ctx, 3), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_KMS);
+    while ((kms = mongocrypt_ctx_next_kms_ctx(ctx))) {
+        ASSERT_OK(mongocrypt_kms_ctx_feed(kms, TEST_FILE("./test/data/kms-aws/encrypt-response.txt")), kms);
+        ASSERT_CMPUINT32(mongocrypt_kms_ctx_bytes_needed(kms), ==, 0);
+        n_kms++;
+    }
+    ASSERT_CMPINT(n_kms, ==, 3);
+    ASSERT_OK(mongocrypt_ctx_kms_done(ctx), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+
+    bin = mongocrypt_binary_new();
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, bin), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_DONE);
+    BSON_ASSERT(_mongocrypt_binary_to_bson(bin, &as_bson));
+    BSON_ASSERT(bson_iter_init(&iter, &as_bson));
+    BSON_ASSERT(!bson_iter_find_descendant(&iter, "v.3", &iter));
+    BSON_ASSERT(bson_iter_init(&iter, &as_bson));
+    BSON_ASSERT(bson_iter_find_descendant(&iter, "v.2.masterKey.key", &iter));
+    ASSERT_STREQUAL(bson_iter_utf8(&iter, NULL), "cmk");
+
+    /* Each key has its own ID. */
+    BSON_ASSERT(bson_iter_init(&iter, &as_bson));
+    BSON_ASSERT(bson_iter_find_descendant(&iter, "v.0._id", &iter));
+    BSON_ASSERT(_mongocrypt_buffer_from_binary_iter(&id0, &iter));
+    BSON_ASSERT(bson_iter_init(&iter, &as_bson));
+    BSON_ASSERT(bson_iter_find_descendant(&iter, "v.2._id", &iter));
+    BSON_ASSERT(_mongocrypt_buffer_from_binary_iter(&id2, &iter));
+    BSON_ASSERT(id0.subtype == BSON_SUBTYPE_UUID);
+    BSON_ASSERT(0 != _mongocrypt_buffer_cmp(&id0, &id2));
+
+    mongocrypt_binary_destroy(bin);
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_destroy(crypt);
+}
+
 static void _test_create_data_key(_mongocrypt_tester_t *tester) {
     _test_create_data_key_with_provider(tester, MONGOCRYPT_KMS_PROVIDER_AWS, false /* with_alt_name */);
     _test_create_data_key_with_provider(tester, MONGOCRYPT_KMS_PROVIDER_LOCAL, false /* with_alt_name */);
@@ -414,4 +474,5 @@ void _mongocrypt_tester_install_data_key(_mongocrypt_tester_t *tester) {
     INSTALL_TEST(_test_datakey_kms_per_ctx_credentials);
     INSTALL_TEST(_test_datakey_kms_per_ctx_credentials_not_requested);
     INSTALL_TEST(_test_datakey_kms_per_ctx_credentials_local);
+    INSTALL_TEST(_test_datakey_batch);
 }
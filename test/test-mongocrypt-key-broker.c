@@ -702,6 +702,192 @@ static void _test_key_broker_kmip(_mongocrypt_tester_t *tester) {
     mongocrypt_destroy(crypt);
 }
 
+/* _read_ttlv_len reads the big-endian length of the TTLV item at @p. */
+static uint32_t _read_ttlv_len(const uint8_t *p) {
+    return (uint32_t)p[4] << 24 | (uint32_t)p[5] << 16 | (uint32_t)p[6] << 8 | (uint32_t)p[7];
+}
+
+static void _test_key_broker_kmip_batch(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    _mongocrypt_key_broker_t kb;
+    bson_t keydoc_bson;
+    bson_t keydoc2_bson = BSON_INITIALIZER;
+    bson_iter_t iter;
+    _mongocrypt_buffer_t id;
+    _mongocrypt_buffer_t id2;
+    _mongocrypt_buffer_t keydoc;
+    _mongocrypt_buffer_t keydoc2;
+    mongocrypt_kms_ctx_t *kms;
+    _mongocrypt_opts_kms_providers_t *kms_providers;
+    _mongocrypt_buffer_t secretdata;
+    uint8_t response[2 * sizeof(SUCCESS_GET_RESPONSE)];
+    size_t response_len;
+    uint32_t header_len, item_len, message_len;
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    crypt->opts.batch_kmip_requests = true;
+    kms_providers = &crypt->opts.kms_providers;
+    _mongocrypt_key_broker_init(&kb, crypt);
+
+    /* Request two keys backed by the same KMIP server. */
+    _load_json_as_bson("./test/data/key-document-kmip.json", &keydoc_bson);
+    ASSERT(bson_iter_init_find(&iter, &keydoc_bson, "_id"));
+    BSON_ASSERT(_mongocrypt_buffer_from_binary_iter(&id, &iter));
+    _gen_uuid(1, &id2);
+    bson_copy_to_excluding_noinit(&keydoc_bson, &keydoc2_bson, "_id", NULL);
+    ASSERT(_mongocrypt_buffer_append(&id2, &keydoc2_bson, "_id", 3));
+    ASSERT_OK(_mongocrypt_key_broker_request_id(&kb, &id), &kb);
+    ASSERT_OK(_mongocrypt_key_broker_request_id(&kb, &id2), &kb);
+    ASSERT_OK(_mongocrypt_key_broker_requests_done(&kb), &kb);
+
+    _mongocrypt_buffer_from_bson(&keydoc, &keydoc_bson);
+    _mongocrypt_buffer_from_bson(&keydoc2, &keydoc2_bson);
+    ASSERT_OK(_mongocrypt_key_broker_add_doc(&kb, kms_providers, &keydoc), &kb);
+    ASSERT_OK(_mongocrypt_key_broker_add_doc(&kb, kms_providers, &keydoc2), &kb);
+    ASSERT_OK(_mongocrypt_key_broker_docs_done(&kb), &kb);
+
+    /* Expect one KMS request for both keys. */
+    kms = _mongocrypt_key_broker_next_kms(&kb);
+    ASSERT_OR_PRINT_MSG(kms, "expected KMS context returned, got none");
+    ASSERT(!_mongocrypt_key_broker_next_kms(&kb));
+
+    /* Respond with the BatchItem of the single Get response twice. */
+    header_len = _read_ttlv_len(SUCCESS_GET_RESPONSE + 8);
+    item_len = _read_ttlv_len(SUCCESS_GET_RESPONSE + 16 + header_len);
+    response_len = sizeof(SUCCESS_GET_RESPONSE) + 8 + item_len;
+    memcpy(response, SUCCESS_GET_RESPONSE, sizeof(SUCCESS_GET_RESPONSE));
+    memcpy(response + sizeof(SUCCESS_GET_RESPONSE), SUCCESS_GET_RESPONSE + 16 + header_len, 8 + item_len);
+    message_len = (uint32_t)(response_len - 8);
+    response[4] = (uint8_t)(message_len >> 24);
+    response[5] = (uint8_t)(message_len >> 16);
+    response[6] = (uint8_t)(message_len >> 8);
+    response[7] = (uint8_t)message_len;
+
+    ASSERT_OK(kms_ctx_feed_all(kms, response, (uint32_t)response_len), kms);
+    ASSERT_OK(_mongocrypt_key_broker_kms_done(&kb, kms_providers), &kb);
+
+    BSON_ASSERT(_mongocrypt_key_broker_decrypted_key_by_id(&kb, &id, &secretdata));
+    ASSERT_CMPBYTES(secretdata.data, secretdata.len, EXPECTED_SECRETDATA, sizeof(EXPECTED_SECRETDATA));
+    _mongocrypt_buffer_cleanup(&secretdata);
+    BSON_ASSERT(_mongocrypt_key_broker_decrypted_key_by_id(&kb, &id2, &secretdata));
+    ASSERT_CMPBYTES(secretdata.data, secretdata.len, EXPECTED_SECRETDATA, sizeof(EXPECTED_SECRETDATA));
+    _mongocrypt_buffer_cleanup(&secretdata);
+
+    _mongocrypt_buffer_cleanup(&keydoc2);
+    _mongocrypt_buffer_cleanup(&keydoc);
+    _mongocrypt_buffer_cleanup(&id2);
+    _mongocrypt_buffer_cleanup(&id);
+    bson_destroy(&keydoc2_bson);
+    bson_destroy(&keydoc_bson);
+    _mongocrypt_key_broker_cleanup(&kb);
+    mongocrypt_destroy(crypt);
+}
+
+static void _test_key_broker_key_expiration_by_kms_provider(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    _mongocrypt_key_broker_t kb;
+    bson_t keydoc_bson;
+    bson_iter_t iter;
+    _mongocrypt_buffer_t id;
+    _mongocrypt_buffer_t keydoc;
+    mongocrypt_kms_ctx_t *kms;
+    _mongocrypt_opts_kms_providers_t *kms_providers;
+    _mongocrypt_cache_pair_t *pair;
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    _mongocrypt_buffer_copy_from_binary(&crypt->opts.key_expiration_by_kms_provider,
+                                        TEST_BSON("{'kmip': {'$numberLong': '3600000'}}"));
+    kms_providers = &crypt->opts.kms_providers;
+    _mongocrypt_key_broker_init(&kb, crypt);
+
+    _load_json_as_bson("./test/data/key-document-kmip.json", &keydoc_bson);
+    ASSERT(bson_iter_init_find(&iter, &keydoc_bson, "_id"));
+    BSON_ASSERT(_mongocrypt_buffer_from_binary_iter(&id, &iter));
+    ASSERT_OK(_mongocrypt_key_broker_request_id(&kb, &id), &kb);
+    ASSERT_OK(_mongocrypt_key_broker_requests_done(&kb), &kb);
+    _mongocrypt_buffer_from_bson(&keydoc, &keydoc_bson);
+    ASSERT_OK(_mongocrypt_key_broker_add_doc(&kb, kms_providers, &keydoc), &kb);
+    ASSERT_OK(_mongocrypt_key_broker_docs_done(&kb), &kb);
+    kms = _mongocrypt_key_broker_next_kms(&kb);
+    ASSERT_OR_PRINT_MSG(kms, "expected KMS context returned, got none");
+    ASSERT_OK(kms_ctx_feed_all(kms, SUCCESS_GET_RESPONSE, sizeof(SUCCESS_GET_RESPONSE)), kms);
+    ASSERT_OK(_mongocrypt_key_broker_kms_done(&kb, kms_providers), &kb);
+
+    /* The key is cached with the lifetime of its KMS provider. */
+    ASSERT_CMPUINT32(_mongocrypt_cache_num_entries(&crypt->cache_key), ==, 1);
+    pair = crypt->cache_key.pair;
+    BSON_ASSERT(!pair->default_expiration);
+    ASSERT_CMPUINT64(pair->expiration, ==, 3600000);
+
+    _mongocrypt_buffer_cleanup(&keydoc);
+    _mongocrypt_buffer_cleanup(&id);
+    bson_destroy(&keydoc_bson);
+    _mongocrypt_key_broker_cleanup(&kb);
+    mongocrypt_destroy(crypt);
+}
+
+static void _test_key_broker_kmip_kek_cache(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    _mongocrypt_key_broker_t kb;
+    bson_t keydoc_bson;
+    bson_t keydoc2_bson = BSON_INITIALIZER;
+    bson_iter_t iter;
+    _mongocrypt_buffer_t id;
+    _mongocrypt_buffer_t id2;
+    _mongocrypt_buffer_t keydoc;
+    _mongocrypt_buffer_t keydoc2;
+    mongocrypt_kms_ctx_t *kms;
+    _mongocrypt_opts_kms_providers_t *kms_providers;
+    _mongocrypt_buffer_t secretdata;
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    crypt->opts.kmip_kek_cache_expiration_ms = CACHE_EXPIRATION_MS;
+    kms_providers = &crypt->opts.kms_providers;
+
+    /* Two keys wrapped by the same KMIP key. */
+    _load_json_as_bson("./test/data/key-document-kmip.json", &keydoc_bson);
+    ASSERT(bson_iter_init_find(&iter, &keydoc_bson, "_id"));
+    BSON_ASSERT(_mongocrypt_buffer_from_binary_iter(&id, &iter));
+    _gen_uuid(1, &id2);
+    bson_copy_to_excluding_noinit(&keydoc_bson, &keydoc2_bson, "_id", NULL);
+    ASSERT(_mongocrypt_buffer_append(&id2, &keydoc2_bson, "_id", 3));
+    _mongocrypt_buffer_from_bson(&keydoc, &keydoc_bson);
+    _mongocrypt_buffer_from_bson(&keydoc2, &keydoc2_bson);
+
+    /* The first key is decrypted with a KMIP Get. */
+    _mongocrypt_key_broker_init(&kb, crypt);
+    ASSERT_OK(_mongocrypt_key_broker_request_id(&kb, &id), &kb);
+    ASSERT_OK(_mongocrypt_key_broker_requests_done(&kb), &kb);
+    ASSERT_OK(_mongocrypt_key_broker_add_doc(&kb, kms_providers, &keydoc), &kb);
+    ASSERT_OK(_mongocrypt_key_broker_docs_done(&kb), &kb);
+    kms = _mongocrypt_key_broker_next_kms(&kb);
+    ASSERT_OR_PRINT_MSG(kms, "expected KMS context returned, got none");
+    ASSERT_OK(kms_ctx_feed_all(kms, SUCCESS_GET_RESPONSE, sizeof(SUCCESS_GET_RESPONSE)), kms);
+    ASSERT_OK(_mongocrypt_key_broker_kms_done(&kb, kms_providers), &kb);
+    ASSERT_CMPUINT32(_mongocrypt_cache_num_entries(&crypt->cache_kmip_kek), ==, 1);
+    _mongocrypt_key_broker_cleanup(&kb);
+
+    /* The second key is unwrapped with the cached KEK, without a KMS request. */
+    _mongocrypt_key_broker_init(&kb, crypt);
+    ASSERT_OK(_mongocrypt_key_broker_request_id(&kb, &id2), &kb);
+    ASSERT_OK(_mongocrypt_key_broker_requests_done(&kb), &kb);
+    ASSERT_OK(_mongocrypt_key_broker_add_doc(&kb, kms_providers, &keydoc2), &kb);
+    ASSERT_OK(_mongocrypt_key_broker_docs_done(&kb), &kb);
+    ASSERT(kb.state == KB_DONE);
+    BSON_ASSERT(_mongocrypt_key_broker_decrypted_key_by_id(&kb, &id2, &secretdata));
+    ASSERT_CMPBYTES(secretdata.data, secretdata.len, EXPECTED_SECRETDATA, sizeof(EXPECTED_SECRETDATA));
+    _mongocrypt_buffer_cleanup(&secretdata);
+    _mongocrypt_key_broker_cleanup(&kb);
+
+    _mongocrypt_buffer_cleanup(&keydoc2);
+    _mongocrypt_buffer_cleanup(&keydoc);
+    _mongocrypt_buffer_cleanup(&id2);
+    _mongocrypt_buffer_cleanup(&id);
+    bson_destroy(&keydoc2_bson);
+    bson_destroy(&keydoc_bson);
+    mongocrypt_destroy(crypt);
+}
+
 /*
 <ResponseMessage tag="0x42007b" type="Structure">
  <ResponseHeader tag="0x42007a" type="Structure">
@@ -1009,6 +1195,132 @@ static void _test_key_broker_get_decrypted_key_while_requesting(_mongocrypt_test
     mongocrypt_status_destroy(status);
 }
 
+/* Test that requests and keys are found among many others. */
+static void _test_key_broker_many_keys(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    _mongocrypt_buffer_t key_ids[100];
+    _mongocrypt_buffer_t unknown_id, key_decrypted;
+    _mongocrypt_key_broker_t kb;
+    const int num_keys = 100;
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    for (int i = 0; i < num_keys; i++) {
+        _gen_uuid((uint8_t)i, &key_ids[i]);
+    }
+    _gen_uuid((uint8_t)num_keys, &unknown_id);
+
+    /* Duplicate requests by id or name are deduplicated. */
+    _mongocrypt_key_broker_init(&kb, crypt);
+    for (int i = 0; i < num_keys; i++) {
+        char *name = bson_strdup_printf("name%d", i);
+
+        ASSERT_OK(_mongocrypt_key_broker_request_id(&kb, &key_ids[i]), &kb);
+        _key_broker_add_name(&kb, name);
+        bson_free(name);
+    }
+    for (int i = 0; i < num_keys; i++) {
+        char *name = bson_strdup_printf("name%d", i);
+
+        ASSERT_OK(_mongocrypt_key_broker_request_id(&kb, &key_ids[i]), &kb);
+        _key_broker_add_name(&kb, name);
+        bson_free(name);
+    }
+    ASSERT_CMPINT(_key_broker_num_satisfied(&kb), ==, 0);
+    ASSERT_CMPSIZE_T(kb.num_unsatisfied, ==, (size_t)num_keys * 2);
+    ASSERT_OK(_mongocrypt_key_broker_requests_done(&kb), &kb);
+    ASSERT(kb.state == KB_ADDING_DOCS);
+    _mongocrypt_key_broker_cleanup(&kb);
+
+    /* Decrypted keys are found by id. */
+    _mongocrypt_key_broker_init(&kb, crypt);
+    for (int i = 0; i < num_keys; i++) {
+        _mongocrypt_key_broker_add_test_key(&kb, &key_ids[i]);
+    }
+    for (int i = 0; i < num_keys; i++) {
+        ASSERT_OK(_mongocrypt_key_broker_decrypted_key_by_id(&kb, &key_ids[i], &key_decrypted), &kb);
+        ASSERT_CMPSIZE_T(key_decrypted.len, ==, MONGOCRYPT_KEY_LEN);
+        _mongocrypt_buffer_cleanup(&key_decrypted);
+    }
+    ASSERT_FAILS(_mongocrypt_key_broker_decrypted_key_by_id(&kb, &unknown_id, &key_decrypted),
+                 &kb,
+                 "could not find key");
+    _mongocrypt_buffer_cleanup(&key_decrypted);
+    _mongocrypt_key_broker_cleanup(&kb);
+
+    _mongocrypt_buffer_cleanup(&unknown_id);
+    for (int i = 0; i < num_keys; i++) {
+        _mongocrypt_buffer_cleanup(&key_ids[i]);
+    }
+    mongocrypt_destroy(crypt);
+}
+
+/* Test that tokens derived from a key are cached with it. */
+static void _test_key_broker_key_tokens(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_status_t *status;
+    _mongocrypt_buffer_t key_id1, key_id2, key_doc1, key_decrypted1, token_key;
+    _mongocrypt_key_broker_t kb;
+    _mongocrypt_opts_kms_providers_t *kms_providers;
+    const _mongocrypt_cache_key_tokens_t *tokens, *cached_tokens;
+    mc_CollectionsLevel1Token_t *cl1t;
+    mc_ECOCToken_t *ecoct;
+    mongocrypt_kms_ctx_t *kms;
+
+    status = mongocrypt_status_new();
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    kms_providers = &crypt->opts.kms_providers;
+    _gen_uuid_and_key(tester, 1, &key_id1, &key_doc1);
+    _gen_uuid(2, &key_id2);
+
+    _mongocrypt_key_broker_init(&kb, crypt);
+    ASSERT_OK(_mongocrypt_key_broker_request_id(&kb, &key_id1), &kb);
+    ASSERT_OK(_mongocrypt_key_broker_requests_done(&kb), &kb);
+    ASSERT_OK(_mongocrypt_key_broker_add_doc(&kb, kms_providers, &key_doc1), &kb);
+    ASSERT_OK(_mongocrypt_key_broker_docs_done(&kb), &kb);
+    kms = _mongocrypt_key_broker_next_kms(&kb);
+    ASSERT(kms);
+    _mongocrypt_tester_satisfy_kms(tester, kms);
+    ASSERT_OK(_mongocrypt_key_broker_kms_done(&kb, kms_providers), &kb);
+    ASSERT(kb.state == KB_DONE);
+
+    tokens = _mongocrypt_key_broker_key_tokens_by_id(&kb, &key_id1);
+    ASSERT(tokens);
+    ASSERT(NULL == _mongocrypt_key_broker_key_tokens_by_id(&kb, &key_id2));
+
+    /* Tokens match those derived from the TokenKey. */
+    ASSERT_OK(_mongocrypt_key_broker_decrypted_key_by_id(&kb, &key_id1, &key_decrypted1), &kb);
+    ASSERT(_mongocrypt_buffer_from_subrange(&token_key,
+                                            &key_decrypted1,
+                                            key_decrypted1.len - MONGOCRYPT_TOKEN_KEY_LEN,
+                                            MONGOCRYPT_TOKEN_KEY_LEN));
+    cl1t = mc_CollectionsLevel1Token_new(crypt->crypto, &token_key, status);
+    ASSERT_OR_PRINT(cl1t, status);
+    ecoct = mc_ECOCToken_new(crypt->crypto, cl1t, status);
+    ASSERT_OR_PRINT(ecoct, status);
+    ASSERT_CMPBUF(*mc_CollectionsLevel1Token_get(cl1t), *mc_CollectionsLevel1Token_get(tokens->collectionsLevel1Token));
+    ASSERT_CMPBUF(*mc_ECOCToken_get(ecoct), *mc_ECOCToken_get(tokens->ecocToken));
+    mc_ECOCToken_destroy(ecoct);
+    mc_CollectionsLevel1Token_destroy(cl1t);
+    _mongocrypt_buffer_cleanup(&key_decrypted1);
+    _mongocrypt_key_broker_cleanup(&kb);
+
+    /* A key broker satisfied from the cache shares the same tokens. */
+    _mongocrypt_key_broker_init(&kb, crypt);
+    ASSERT_OK(_mongocrypt_key_broker_request_id(&kb, &key_id1), &kb);
+    ASSERT_OK(_mongocrypt_key_broker_requests_done(&kb), &kb);
+    ASSERT(kb.state == KB_DONE);
+    cached_tokens = _mongocrypt_key_broker_key_tokens_by_id(&kb, &key_id1);
+    ASSERT(cached_tokens);
+    ASSERT(cached_tokens->ecocToken);
+    _mongocrypt_key_broker_cleanup(&kb);
+
+    _mongocrypt_buffer_cleanup(&key_id2);
+    _mongocrypt_buffer_cleanup(&key_doc1);
+    _mongocrypt_buffer_cleanup(&key_id1);
+    mongocrypt_destroy(crypt);
+    mongocrypt_status_destroy(status);
+}
+
 void _mongocrypt_tester_install_key_broker(_mongocrypt_tester_t *tester) {
     INSTALL_TEST(_test_key_broker_get_key_filter);
     INSTALL_TEST(_test_key_broker_add_key);
@@ -1017,8 +1329,13 @@ void _mongocrypt_tester_install_key_broker(_mongocrypt_tester_t *tester) {
     INSTALL_TEST(_test_key_broker_multi_match);
     INSTALL_TEST(_test_key_broker_kmip);
     INSTALL_TEST(_test_key_broker_kmip_notfound);
+    INSTALL_TEST(_test_key_broker_kmip_batch);
+    INSTALL_TEST(_test_key_broker_kmip_kek_cache);
+    INSTALL_TEST(_test_key_broker_key_expiration_by_kms_provider);
     INSTALL_TEST(_test_key_broker_request_any);
     INSTALL_TEST(_test_key_broker_add_any);
     INSTALL_TEST(_test_key_broker_restart);
     INSTALL_TEST(_test_key_broker_get_decrypted_key_while_requesting);
+    INSTALL_TEST(_test_key_broker_many_keys);
+    INSTALL_TEST(_test_key_broker_key_tokens);
 }
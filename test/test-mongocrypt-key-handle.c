@@ -0,0 +1,155 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mongocrypt-key-handle-private.h"
+#include "test-mongocrypt.h"
+
+/* Runs an explicit encryption of @msg with @algorithm to READY. */
+static mongocrypt_ctx_t *_explicit_encrypt_ctx(_mongocrypt_tester_t *tester,
+                                               mongocrypt_t *crypt,
+                                               const char *algorithm,
+                                               mongocrypt_binary_t *msg) {
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *key_id;
+
+    key_id = mongocrypt_binary_new_from_data(MONGOCRYPT_DATA_AND_LEN("aaaaaaaaaaaaaaaa"));
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_key_id(ctx, key_id), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx, algorithm, -1), ctx);
+    ASSERT_OK(mongocrypt_ctx_explicit_encrypt_init(ctx, msg), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    mongocrypt_binary_destroy(key_id);
+    return ctx;
+}
+
+static void _test_key_handle_roundtrip(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_key_handle_t *handle;
+    mongocrypt_binary_t *bin;
+    _mongocrypt_buffer_t expected;
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    bin = mongocrypt_binary_new();
+
+    /* A deterministic handle encrypts as the context it was taken from. */
+    ctx = _explicit_encrypt_ctx(tester, crypt, MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR, TEST_BSON("{'v': 'abc'}"));
+    handle = mongocrypt_ctx_key_handle(ctx);
+    ASSERT_OR_PRINT(handle, ctx->status);
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, bin), ctx);
+    _mongocrypt_buffer_copy_from_binary(&expected, bin);
+    mongocrypt_ctx_destroy(ctx);
+
+    ASSERT_OK(mongocrypt_key_handle_encrypt(handle, TEST_BSON("{'v': 'abc'}"), bin), handle);
+    ASSERT_CMPBYTES(expected.data, expected.len, mongocrypt_binary_data(bin), mongocrypt_binary_len(bin));
+    ASSERT_OK(mongocrypt_key_handle_decrypt(handle, _mongocrypt_buffer_as_binary(&expected), bin), handle);
+    ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_BSON("{'v': 'abc'}"), bin);
+    _mongocrypt_buffer_cleanup(&expected);
+    mongocrypt_key_handle_destroy(handle);
+
+    /* A random handle decrypts what it encrypts. */
+    ctx = _explicit_encrypt_ctx(tester, crypt, MONGOCRYPT_ALGORITHM_RANDOM_STR, TEST_BSON("{'v': 1.5}"));
+    handle = mongocrypt_ctx_key_handle(ctx);
+    ASSERT_OR_PRINT(handle, ctx->status);
+    mongocrypt_ctx_destroy(ctx);
+
+    ASSERT_OK(mongocrypt_key_handle_encrypt(handle, TEST_BSON("{'v': {'x': 1.5}}"), bin), handle);
+    _mongocrypt_buffer_copy_from_binary(&expected, bin);
+    ASSERT_OK(mongocrypt_key_handle_decrypt(handle, _mongocrypt_buffer_as_binary(&expected), bin), handle);
+    ASSERT_MONGOCRYPT_BINARY_EQUAL_BSON(TEST_BSON("{'v': {'x': 1.5}}"), bin);
+    _mongocrypt_buffer_cleanup(&expected);
+    mongocrypt_key_handle_destroy(handle);
+
+    mongocrypt_binary_destroy(bin);
+    mongocrypt_destroy(crypt);
+}
+
+static void _test_key_handle_invalid(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_key_handle_t *handle;
+    mongocrypt_binary_t *bin;
+    mongocrypt_binary_t *key_id;
+    mongocrypt_binary_t *truncated_bin;
+    mongocrypt_status_t *status;
+    bson_t encrypted;
+    bson_t truncated = BSON_INITIALIZER;
+    bson_iter_t iter;
+    bson_subtype_t subtype;
+    uint32_t len;
+    const uint8_t *data;
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    bin = mongocrypt_binary_new();
+    status = mongocrypt_status_new();
+
+    /* Only explicit encryption contexts with a decrypted key have a handle. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+    ASSERT_FAILS(mongocrypt_ctx_key_handle(ctx) != NULL, ctx, "not applicable to context");
+    mongocrypt_ctx_destroy(ctx);
+
+    key_id = mongocrypt_binary_new_from_data(MONGOCRYPT_DATA_AND_LEN("aaaaaaaaaaaaaaaa"));
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_key_id(ctx, key_id), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx, MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR, -1), ctx);
+    ASSERT_OK(mongocrypt_ctx_explicit_encrypt_init(ctx, TEST_BSON("{'v': 'abc'}")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+    ASSERT_FAILS(mongocrypt_ctx_key_handle(ctx) != NULL, ctx, "wrong state");
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_binary_destroy(key_id);
+
+    /* Values are checked as with a context. */
+    ctx = _explicit_encrypt_ctx(tester, crypt, MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR, TEST_BSON("{'v': 'abc'}"));
+    handle = mongocrypt_ctx_key_handle(ctx);
+    ASSERT_OR_PRINT(handle, ctx->status);
+    mongocrypt_ctx_destroy(ctx);
+    ASSERT_FAILS(mongocrypt_key_handle_encrypt(handle, TEST_BSON("{'v': 1.5}"), bin),
+                 handle,
+                 "BSON type invalid for deterministic encryption");
+    ASSERT_FAILS(mongocrypt_key_handle_encrypt(handle, TEST_BSON("{'x': 1}"), bin),
+                 handle,
+                 "invalid msg, must contain 'v'");
+    ASSERT_FAILS(mongocrypt_key_handle_decrypt(handle, TEST_BSON("{'v': 123}"), bin), handle, "must contain a binary");
+
+    /* A truncated ciphertext fails. The error is read from the handle. */
+    ASSERT_OK(mongocrypt_key_handle_encrypt(handle, TEST_BSON("{'v': 'abc'}"), bin), handle);
+    ASSERT(_mongocrypt_binary_to_bson(bin, &encrypted));
+    ASSERT(bson_iter_init_find(&iter, &encrypted, "v"));
+    bson_iter_binary(&iter, &subtype, &len, &data);
+    ASSERT_CMPUINT32(len, >, 18);
+    ASSERT(BSON_APPEND_BINARY(&truncated, "v", subtype, data, 18));
+    truncated_bin = mongocrypt_binary_new_from_data((uint8_t *)bson_get_data(&truncated), truncated.len);
+    ASSERT(!mongocrypt_key_handle_decrypt(handle, truncated_bin, bin));
+    ASSERT(!mongocrypt_key_handle_status(handle, status));
+    ASSERT_STATUS_CONTAINS(status, "malformed ciphertext, too small");
+
+    /* An error does not invalidate the handle. */
+    ASSERT_OK(mongocrypt_key_handle_encrypt(handle, TEST_BSON("{'v': 'abc'}"), bin), handle);
+    ASSERT(mongocrypt_key_handle_status(handle, status));
+    mongocrypt_key_handle_destroy(handle);
+
+    mongocrypt_binary_destroy(truncated_bin);
+    bson_destroy(&truncated);
+    mongocrypt_status_destroy(status);
+    mongocrypt_binary_destroy(bin);
+    mongocrypt_destroy(crypt);
+}
+
+void _mongocrypt_tester_install_key_handle(_mongocrypt_tester_t *tester) {
+    INSTALL_TEST(_test_key_handle_roundtrip);
+    INSTALL_TEST(_test_key_handle_invalid);
+}
@@ -182,6 +182,37 @@ static void test_mongocrypt_key_parsing(_mongocrypt_tester_t *tester) {
     bson_destroy(&key_bson);
 }
 
+static void test_mongocrypt_key_parsing_projected(_mongocrypt_tester_t *tester) {
+    bson_t key_bson = BSON_INITIALIZER;
+    mongocrypt_status_t *status;
+    _mongocrypt_key_doc_t *key_doc;
+
+    status = mongocrypt_status_new();
+
+    /* Metadata fields are optional. */
+    _recreate_and_reset(tester, &key_bson, status, "status", "creationDate", "updateDate", NULL);
+    key_doc = _mongocrypt_key_new();
+    ASSERT_OK_STATUS(_mongocrypt_key_parse_projected_owned(&key_bson, key_doc, status), status);
+    _mongocrypt_key_destroy(key_doc);
+
+    /* Full key documents are accepted. */
+    _recreate_and_reset(tester, &key_bson, status, NULL);
+    key_doc = _mongocrypt_key_new();
+    ASSERT_OK_STATUS(_mongocrypt_key_parse_projected_owned(&key_bson, key_doc, status), status);
+    _mongocrypt_key_destroy(key_doc);
+
+    /* Used fields are still required. */
+    _recreate_and_reset(tester, &key_bson, status, "status", "creationDate", "updateDate", "keyMaterial", NULL);
+    key_doc = _mongocrypt_key_new();
+    ASSERT_FAILS_STATUS(_mongocrypt_key_parse_projected_owned(&key_bson, key_doc, status),
+                        status,
+                        "invalid key, no 'keyMaterial'");
+    _mongocrypt_key_destroy(key_doc);
+
+    mongocrypt_status_destroy(status);
+    bson_destroy(&key_bson);
+}
+
 static void test_mongocrypt_key_alt_name_from_iter(_mongocrypt_tester_t *tester) {
     mongocrypt_status_t *status;
     bson_iter_t iter;
@@ -230,5 +261,6 @@ static void test_mongocrypt_key_alt_name_from_iter(_mongocrypt_tester_t *tester)
 
 void _mongocrypt_tester_install_key(_mongocrypt_tester_t *tester) {
     INSTALL_TEST(test_mongocrypt_key_parsing);
+    INSTALL_TEST(test_mongocrypt_key_parsing_projected);
     INSTALL_TEST(test_mongocrypt_key_alt_name_from_iter);
 }
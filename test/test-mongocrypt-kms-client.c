@@ -0,0 +1,314 @@
+/*
+ * Copyright 2024-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <mongocrypt.h>
+
+#include "mongocrypt-private.h"
+#include "test-mongocrypt.h"
+
+#ifdef MONGOCRYPT_ENABLE_KMS_CLIENT
+#include <ctype.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <openssl/ssl.h>
+#endif
+
+static void _test_kms_client_setopt(_mongocrypt_tester_t *tester) {
+    mongocrypt_kms_client_t *client;
+    mongocrypt_status_t *status;
+
+    status = mongocrypt_status_new();
+    client = mongocrypt_kms_client_new();
+    ASSERT(mongocrypt_kms_client_status(client, status));
+
+    ASSERT(mongocrypt_kms_client_setopt_timeout_ms(client, 1000));
+    ASSERT(!mongocrypt_kms_client_setopt_timeout_ms(client, 0));
+    ASSERT(!mongocrypt_kms_client_status(client, status));
+    ASSERT_STATUS_CONTAINS(status, "timeout_ms must be positive");
+    mongocrypt_kms_client_destroy(client);
+
+    client = mongocrypt_kms_client_new();
+    ASSERT(mongocrypt_kms_client_setopt_tls_ca_file(client, "ca.pem"));
+    ASSERT(mongocrypt_kms_client_setopt_tls_cert_key_file(client, "kmip", "client.pem"));
+    ASSERT(!mongocrypt_kms_client_setopt_tls_cert_key_file(client, NULL, "client.pem"));
+    ASSERT(!mongocrypt_kms_client_status(client, status));
+    ASSERT_STATUS_CONTAINS(status, "must be non-NULL");
+    mongocrypt_kms_client_destroy(client);
+
+    mongocrypt_status_destroy(status);
+}
+
+static void _test_kms_client_not_needed(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_kms_client_t *client;
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    client = mongocrypt_kms_client_new();
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_key_encryption_key(ctx, TEST_BSON("{'provider': 'local'}")), ctx);
+    ASSERT_OK(mongocrypt_ctx_datakey_init(ctx), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+
+    if (mongocrypt_is_kms_client_available()) {
+        /* A context that needs no KMS requests is left as is. */
+        ASSERT_OK(mongocrypt_kms_client_run(client, ctx), ctx);
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    } else {
+        ASSERT_FAILS(mongocrypt_kms_client_run(client, ctx), ctx, "built without the KMS client");
+    }
+
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_kms_client_destroy(client);
+    mongocrypt_destroy(crypt);
+}
+
+#ifdef MONGOCRYPT_ENABLE_KMS_CLIENT
+/* _aws_datakey_ctx returns a context creating an AWS data key with the
+ * endpoint 127.0.0.1:@port. */
+static mongocrypt_ctx_t *_aws_datakey_ctx(mongocrypt_t *crypt, uint16_t port) {
+    mongocrypt_ctx_t *ctx;
+    char endpoint[32];
+
+    ASSERT(0 < bson_snprintf(endpoint, sizeof endpoint, "127.0.0.1:%d", (int)port));
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_masterkey_aws(ctx, "region", -1, "cmk", -1), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_masterkey_aws_endpoint(ctx, endpoint, -1), ctx);
+    ASSERT_OK(mongocrypt_ctx_datakey_init(ctx), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_KMS);
+    return ctx;
+}
+
+/* _listen_loopback returns a socket listening on 127.0.0.1, and sets @port. */
+static int _listen_loopback(uint16_t *port) {
+    struct sockaddr_in addr = {0};
+    socklen_t addr_len = sizeof addr;
+    int listener;
+
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT(listener >= 0);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT(0 == bind(listener, (struct sockaddr *)&addr, sizeof addr));
+    ASSERT(0 == listen(listener, 8));
+    ASSERT(0 == getsockname(listener, (struct sockaddr *)&addr, &addr_len));
+    *port = ntohs(addr.sin_port);
+    return listener;
+}
+
+static void _test_kms_client_network_errors(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_kms_client_t *client;
+    int listener;
+    uint16_t port;
+
+    /* The kernel accepts connections to the listener, which never answers. */
+    listener = _listen_loopback(&port);
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    client = mongocrypt_kms_client_new();
+    ASSERT(mongocrypt_kms_client_setopt_timeout_ms(client, 200));
+
+    /* The TLS handshake times out. */
+    ctx = _aws_datakey_ctx(crypt, port);
+    ASSERT_FAILS(mongocrypt_kms_client_run(client, ctx), ctx, "timed out");
+    mongocrypt_ctx_destroy(ctx);
+
+    /* Connecting fails once nothing listens on the port. */
+    close(listener);
+    ctx = _aws_datakey_ctx(crypt, port);
+    ASSERT_FAILS(mongocrypt_kms_client_run(client, ctx), ctx, "failed to connect");
+    mongocrypt_ctx_destroy(ctx);
+
+    mongocrypt_kms_client_destroy(client);
+    mongocrypt_destroy(crypt);
+}
+
+/* _tls_server_t is a TLS server on 127.0.0.1 that replies to each HTTP request
+ * with @reply. It serves one connection at a time until the client closes it. */
+typedef struct {
+    SSL_CTX *ssl_ctx;
+    int listener;
+    uint16_t port;
+    mongocrypt_binary_t *reply;
+    /* drop_request is the number of the request to close the connection on
+     * instead of replying, or 0. */
+    int drop_request;
+    bool stop;
+    pthread_t thread;
+    /* The counts are read after _tls_server_stop. */
+    int accepts;
+    int resumed;
+    int requests;
+} _tls_server_t;
+
+/* _tls_server_read_request reads an HTTP request from @ssl. Returns false if
+ * the client closed the connection. */
+static bool _tls_server_read_request(SSL *ssl) {
+    char buf[4096];
+    size_t len = 0;
+    char *end = NULL;
+    const char *content_length;
+    size_t body_len = 0;
+    size_t body_read;
+
+    while (!end) {
+        int ret;
+
+        ASSERT(len < sizeof buf - 1);
+        ret = SSL_read(ssl, buf + len, (int)(sizeof buf - 1 - len));
+        if (ret <= 0) {
+            return false;
+        }
+        len += (size_t)ret;
+        buf[len] = '\0';
+        end = strstr(buf, "\r\n\r\n");
+    }
+
+    for (char *c = buf; c < end; c++) {
+        *c = (char)tolower((unsigned char)*c);
+    }
+    content_length = strstr(buf, "content-length:");
+    if (content_length && content_length < end) {
+        body_len = strtoul(content_length + strlen("content-length:"), NULL, 10);
+    }
+    body_read = len - (size_t)(end + 4 - buf);
+    while (body_read < body_len) {
+        const int ret = SSL_read(ssl, buf, (int)BSON_MIN(sizeof buf, body_len - body_read));
+
+        if (ret <= 0) {
+            return false;
+        }
+        body_read += (size_t)ret;
+    }
+    return true;
+}
+
+static void *_tls_server_main(void *arg) {
+    _tls_server_t *server = arg;
+
+    for (;;) {
+        const int fd = accept(server->listener, NULL, NULL);
+        SSL *ssl;
+
+        ASSERT(fd >= 0);
+        if (server->stop) {
+            close(fd);
+            return NULL;
+        }
+        server->accepts++;
+        ssl = SSL_new(server->ssl_ctx);
+        ASSERT(ssl);
+        ASSERT(1 == SSL_set_fd(ssl, fd));
+        if (1 == SSL_accept(ssl)) {
+            if (SSL_session_reused(ssl)) {
+                server->resumed++;
+            }
+            while (_tls_server_read_request(ssl)) {
+                server->requests++;
+                if (server->requests == server->drop_request) {
+                    break;
+                }
+                ASSERT(SSL_write(ssl, server->reply->data, (int)server->reply->len) == (int)server->reply->len);
+            }
+        }
+        SSL_free(ssl);
+        close(fd);
+    }
+}
+
+static void _tls_server_start(_tls_server_t *server, mongocrypt_binary_t *reply, int drop_request) {
+    memset(server, 0, sizeof(*server));
+    server->ssl_ctx = SSL_CTX_new(TLS_server_method());
+    ASSERT(server->ssl_ctx);
+    ASSERT(1 == SSL_CTX_use_certificate_chain_file(server->ssl_ctx, "./test/data/kms-client/server.pem"));
+    ASSERT(1 == SSL_CTX_use_PrivateKey_file(server->ssl_ctx, "./test/data/kms-client/server.pem", SSL_FILETYPE_PEM));
+    server->listener = _listen_loopback(&server->port);
+    server->reply = reply;
+    server->drop_request = drop_request;
+    ASSERT(0 == pthread_create(&server->thread, NULL, _tls_server_main, server));
+}
+
+static void _tls_server_stop(_tls_server_t *server) {
+    struct sockaddr_in addr = {0};
+    int fd;
+
+    /* Connect to wake the server up from accept. */
+    server->stop = true;
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT(fd >= 0);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(server->port);
+    ASSERT(0 == connect(fd, (struct sockaddr *)&addr, sizeof addr));
+    ASSERT(0 == pthread_join(server->thread, NULL));
+    close(fd);
+    close(server->listener);
+    SSL_CTX_free(server->ssl_ctx);
+}
+
+static void _test_kms_client_tls(_mongocrypt_tester_t *tester) {
+    _tls_server_t server;
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_kms_client_t *client;
+
+    /* The server closes the first connection instead of replying to the third
+     * request. */
+    _tls_server_start(&server, TEST_FILE("./test/data/kms-aws/encrypt-response.txt"), 3);
+    /* KMS retries are disabled. A failed attempt fails the context. */
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    client = mongocrypt_kms_client_new();
+    /* The endpoint is an IP address, matched with the IP SAN of the server
+     * certificate. */
+    ASSERT(mongocrypt_kms_client_setopt_tls_ca_file(client, "./test/data/kms-client/ca.pem"));
+
+    /* The first data key opens a connection, and the second reuses it. The
+     * third finds the pooled connection closed by the server, and is sent again
+     * on a new connection resuming the TLS session. */
+    for (int i = 0; i < 3; i++) {
+        mongocrypt_binary_t *out = mongocrypt_binary_new();
+
+        ctx = _aws_datakey_ctx(crypt, server.port);
+        ASSERT_OK(mongocrypt_kms_client_run(client, ctx), ctx);
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+        ASSERT_OK(mongocrypt_ctx_finalize(ctx, out), ctx);
+        mongocrypt_binary_destroy(out);
+        mongocrypt_ctx_destroy(ctx);
+    }
+
+    /* Destroying the client closes the pooled connection. */
+    mongocrypt_kms_client_destroy(client);
+    _tls_server_stop(&server);
+    ASSERT_CMPINT(server.accepts, ==, 2);
+    ASSERT_CMPINT(server.resumed, ==, 1);
+    ASSERT_CMPINT(server.requests, ==, 4);
+    mongocrypt_destroy(crypt);
+}
+#endif /* MONGOCRYPT_ENABLE_KMS_CLIENT */
+
+void _mongocrypt_tester_install_kms_client(_mongocrypt_tester_t *tester) {
+    INSTALL_TEST(_test_kms_client_setopt);
+    INSTALL_TEST(_test_kms_client_not_needed);
+#ifdef MONGOCRYPT_ENABLE_KMS_CLIENT
+    INSTALL_TEST(_test_kms_client_network_errors);
+    INSTALL_TEST(_test_kms_client_tls);
+#endif
+}
@@ -86,6 +86,40 @@ static void _test_trace_log(_mongocrypt_tester_t *tester) {
     mongocrypt_destroy(crypt);
 }
 
+static void _test_count_log_fn(mongocrypt_log_level_t level, const char *message, uint32_t message_len, void *ctx) {
+    int *count = ctx;
+
+    (*count)++;
+}
+
+static void _test_log_level(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    int count = 0;
+
+    crypt = mongocrypt_new();
+    ASSERT_FAILS(mongocrypt_setopt_log_level(crypt, (mongocrypt_log_level_t)5), crypt, "invalid log level");
+    mongocrypt_destroy(crypt);
+
+    crypt = mongocrypt_new();
+    ASSERT_OK(mongocrypt_setopt_log_handler(crypt, _test_count_log_fn, &count), crypt);
+    ASSERT_OK(mongocrypt_setopt_log_level(crypt, MONGOCRYPT_LOG_LEVEL_WARNING), crypt);
+    ASSERT_OK(mongocrypt_setopt_kms_provider_aws(crypt, "example", -1, "example", -1), crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+
+    _mongocrypt_log(&crypt->log, MONGOCRYPT_LOG_LEVEL_INFO, "dropped");
+    ASSERT_CMPINT(count, ==, 0);
+    _mongocrypt_log(&crypt->log, MONGOCRYPT_LOG_LEVEL_WARNING, "logged");
+    _mongocrypt_log(&crypt->log, MONGOCRYPT_LOG_LEVEL_ERROR, "logged");
+    ASSERT_CMPINT(count, ==, 2);
+
+    /* Without a handler, nothing is dispatched. */
+    _mongocrypt_log_set_fn(&crypt->log, NULL, NULL);
+    _mongocrypt_log(&crypt->log, MONGOCRYPT_LOG_LEVEL_FATAL, "dropped");
+    ASSERT_CMPINT(count, ==, 2);
+
+    mongocrypt_destroy(crypt);
+}
+
 #if defined(__GLIBC__) || defined(__APPLE__)
 static void _test_no_log(_mongocrypt_tester_t *tester) {
     const int buffer_size = BUFSIZ;
@@ -116,6 +150,7 @@ static void _test_no_log(_mongocrypt_tester_t *tester) {
 void _mongocrypt_tester_install_log(_mongocrypt_tester_t *tester) {
     INSTALL_TEST(_test_log);
     INSTALL_TEST(_test_trace_log);
+    INSTALL_TEST(_test_log_level);
 #if defined(__GLIBC__) || defined(__APPLE__)
     INSTALL_TEST(_test_no_log);
 #endif
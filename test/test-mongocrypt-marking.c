@@ -104,6 +104,16 @@ static void test_mongocrypt_marking_parse(_mongocrypt_tester_t *tester) {
     _mongocrypt_buffer_cleanup(&marking_buf);
     _mongocrypt_marking_cleanup(&marking);
 
+    /* malformed nested BSON in an FLE2 placeholder. */
+    marking_bson = TMP_BSON("{'v': {'x': 1}}");
+    /* Corrupt the type of 'x'. */
+    ((uint8_t *)bson_get_data(marking_bson))[11] = 0x7F;
+    _make_marking(marking_bson, &marking_buf);
+    marking_buf.data[0] = MC_SUBTYPE_FLE2EncryptionPlaceholder;
+    _parse_fails(&marking_buf, "invalid BSON", &marking);
+    _mongocrypt_buffer_cleanup(&marking_buf);
+    _mongocrypt_marking_cleanup(&marking);
+
     /* a: missing */
     marking_bson = TMP_BSON("{'v': 'abc', 'ka': 'alt'}");
     _make_marking(marking_bson, &marking_buf);
@@ -1112,8 +1122,229 @@ static void test_mc_marking_to_ciphertext(_mongocrypt_tester_t *tester) {
     }
 }
 
+// Asserts that the estimated ciphertext length of the marking is at least the length of the ciphertext it produces.
+static void assert_ciphertext_len_estimate_covers(_mongocrypt_tester_t *tester,
+                                                  mongocrypt_t *crypt,
+                                                  const char *markingJSON) {
+    _mongocrypt_buffer_t marking_buf;
+    _mongocrypt_marking_t marking;
+    bson_t *marking_bson = TMP_BSON(markingJSON);
+    BSON_APPEND_BINARY(marking_bson, "ki", BSON_SUBTYPE_UUID, (TEST_BIN(16))->data, 16);
+    BSON_APPEND_BINARY(marking_bson, "ku", BSON_SUBTYPE_UUID, (TEST_BIN(16))->data, 16);
+    _make_marking(marking_bson, &marking_buf);
+    marking_buf.data[0] = MC_SUBTYPE_FLE2EncryptionPlaceholder;
+    _parse_ok(&marking_buf, &marking);
+    uint64_t estimate = _mongocrypt_marking_ciphertext_len_estimate(&marking, &marking_buf);
+
+    _mongocrypt_ciphertext_t ciphertext;
+    _mongocrypt_ciphertext_init(&ciphertext);
+    get_ciphertext_from_marking_json(tester, crypt, markingJSON, &ciphertext);
+    ASSERT_CMPUINT64(estimate, >=, (uint64_t)ciphertext.data.len + 1u);
+
+    _mongocrypt_ciphertext_cleanup(&ciphertext);
+    _mongocrypt_marking_cleanup(&marking);
+    _mongocrypt_buffer_cleanup(&marking_buf);
+}
+
+static void test_mc_marking_ciphertext_len_estimate(_mongocrypt_tester_t *tester) {
+    if (!_aes_ctr_is_supported_by_os) {
+        printf("Common Crypto with no CTR support detected. Skipping.");
+        return;
+    }
+
+    mongocrypt_t *crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_WITH_RANGE_V2);
+    // Unindexed.
+    assert_ciphertext_len_estimate_covers(tester,
+                                          crypt,
+                                          RAW_STRING({'t' : 1, 'a' : 1, 'v' : 'foobar', 'cm' : {'$numberLong' : '0'}}));
+    // Equality insert.
+    assert_ciphertext_len_estimate_covers(tester,
+                                          crypt,
+                                          RAW_STRING({'t' : 1, 'a' : 2, 'v' : 'foobar', 'cm' : {'$numberLong' : '1'}}));
+    // Range insert.
+    assert_ciphertext_len_estimate_covers(tester, crypt, RAW_STRING({
+                                              't' : 1,
+                                              'a' : 3,
+                                              'v' : {'min' : 0, 'max' : 7, 'v' : 5, 'trimFactor' : 0},
+                                              's' : {'$numberLong' : '1'},
+                                              'cm' : {'$numberLong' : '1'}
+                                          }));
+    mongocrypt_destroy(crypt);
+}
+
+#define FIND_EQUALITY_BATCH_LEN 20
+
+// Asserts that converting equality find markings for two index keys in one batch produces the same payloads as
+// converting each with _mongocrypt_marking_to_ciphertext.
+static void assert_find_equality_batch_matches(_mongocrypt_tester_t *tester, mongocrypt_t *crypt) {
+    mongocrypt_status_t *status = mongocrypt_status_new();
+    mongocrypt_ctx_t *ctx = mongocrypt_ctx_new(crypt);
+    _mongocrypt_buffer_t keyIds[2];
+    _mongocrypt_buffer_t marking_bufs[FIND_EQUALITY_BATCH_LEN];
+    _mongocrypt_marking_t markings[FIND_EQUALITY_BATCH_LEN];
+    _mongocrypt_ciphertext_t expected[FIND_EQUALITY_BATCH_LEN];
+    _mongocrypt_ciphertext_t batch[FIND_EQUALITY_BATCH_LEN];
+
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "test", -1, TEST_FILE("./test/example/cmd.json")), ctx);
+    // Add two index keys with different key material.
+    for (int k = 0; k < 2; k++) {
+        _mongocrypt_buffer_copy_from_binary(&keyIds[k], TEST_BIN(16));
+        keyIds[k].subtype = BSON_SUBTYPE_UUID;
+        keyIds[k].data[0] = (uint8_t)k;
+        _mongocrypt_key_broker_add_test_key(&ctx->kb, &keyIds[k]);
+        ctx->kb.keys_returned->decrypted_key_material.data[0] = (uint8_t)k;
+    }
+
+    for (int i = 0; i < FIND_EQUALITY_BATCH_LEN; i++) {
+        bson_t *marking_bson = TMP_BSON(RAW_STRING({'t' : 2, 'a' : 2, 'cm' : {'$numberLong' : '2'}}));
+        const _mongocrypt_buffer_t *keyId = &keyIds[i % 2];
+
+        BSON_APPEND_INT32(marking_bson, "v", i / 2);
+        BSON_APPEND_BINARY(marking_bson, "ki", BSON_SUBTYPE_UUID, keyId->data, keyId->len);
+        BSON_APPEND_BINARY(marking_bson, "ku", BSON_SUBTYPE_UUID, keyId->data, keyId->len);
+        _make_marking(marking_bson, &marking_bufs[i]);
+        marking_bufs[i].data[0] = MC_SUBTYPE_FLE2EncryptionPlaceholder;
+        _parse_ok(&marking_bufs[i], &markings[i]);
+        ASSERT(_mongocrypt_marking_is_find_equality(&markings[i]));
+
+        _mongocrypt_ciphertext_init(&expected[i]);
+        _mongocrypt_ciphertext_init(&batch[i]);
+        ASSERT_OK_STATUS(_mongocrypt_marking_to_ciphertext(&ctx->kb, &markings[i], &expected[i], status), status);
+    }
+
+    ASSERT_OK_STATUS(
+        _mongocrypt_find_equality_markings_to_ciphertexts(&ctx->kb, markings, batch, FIND_EQUALITY_BATCH_LEN, status),
+        status);
+
+    for (int i = 0; i < FIND_EQUALITY_BATCH_LEN; i++) {
+        ASSERT_CMPINT(batch[i].blob_subtype, ==, MC_SUBTYPE_FLE2FindEqualityPayloadV2);
+        ASSERT_CMPBUF(expected[i].data, batch[i].data);
+        // Adjacent markings differ in index key or value.
+        if (i > 0) {
+            ASSERT(0 != _mongocrypt_buffer_cmp(&batch[i - 1].data, &batch[i].data));
+        }
+        _mongocrypt_ciphertext_cleanup(&expected[i]);
+        _mongocrypt_ciphertext_cleanup(&batch[i]);
+        _mongocrypt_marking_cleanup(&markings[i]);
+        _mongocrypt_buffer_cleanup(&marking_bufs[i]);
+    }
+
+    _mongocrypt_buffer_cleanup(&keyIds[0]);
+    _mongocrypt_buffer_cleanup(&keyIds[1]);
+    mongocrypt_ctx_destroy(ctx);
+    mongocrypt_status_destroy(status);
+}
+
+static void test_mc_find_equality_markings_to_ciphertexts(_mongocrypt_tester_t *tester) {
+    // Tokens derived with one batched HMAC pass per index key.
+    {
+        mongocrypt_t *crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+        assert_find_equality_batch_matches(tester, crypt);
+        mongocrypt_destroy(crypt);
+    }
+
+    // Tokens derived with one task per value.
+    {
+        _reverse_parallel_for_ctx pctx = {0};
+        mongocrypt_t *crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+        crypt->crypto->parallel_for = _reverse_parallel_for;
+        crypt->crypto->parallel_for_ctx = &pctx;
+        assert_find_equality_batch_matches(tester, crypt);
+        // One call per index key.
+        ASSERT_CMPINT(pctx.calls, ==, 2);
+        mongocrypt_destroy(crypt);
+    }
+
+    // Payloads found in the find payload cache are reused.
+    {
+        mongocrypt_t *crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_WITH_FIND_PAYLOAD_CACHE);
+        assert_find_equality_batch_matches(tester, crypt);
+        ASSERT_CMPUINT32(_mongocrypt_cache_num_entries(&crypt->cache_find_payload), ==, FIND_EQUALITY_BATCH_LEN);
+        mongocrypt_destroy(crypt);
+    }
+}
+
+#undef FIND_EQUALITY_BATCH_LEN
+
+static bson_iter_t _range_estimate_find(const bson_t *estimate, const char *path) {
+    bson_iter_t iter, found;
+
+    ASSERT(bson_iter_init(&iter, estimate));
+    ASSERT(bson_iter_find_descendant(&iter, path, &found));
+    return found;
+}
+
+static void test_mongocrypt_range_estimate(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_WITH_RANGE_V2);
+    mongocrypt_binary_t *out = mongocrypt_binary_new();
+    bson_t estimate;
+    bson_iter_t iter;
+
+    // The edges of 5 in [0, 7] are the root, 1, 10, and 101. The mincover of
+    // [2, 5] is 01 and 10, and the mincover of [6, 7] is 11.
+    ASSERT_OK(mongocrypt_range_estimate(crypt,
+                                        TEST_BSON(RAW_STRING({
+                                            'rangeOpts' : {
+                                                'min' : 0,
+                                                'max' : 7,
+                                                'sparsity' : {'$numberLong' : '1'},
+                                                'trimFactor' : 0
+                                            },
+                                            'values' : [ 5, 5 ],
+                                            'queries' : [
+                                                {'lowerBound' : 2, 'upperBound' : 5},
+                                                {'lowerBound' : 5, 'lbIncluded' : false}
+                                            ]
+                                        })),
+                                        out),
+              crypt);
+    ASSERT(_mongocrypt_binary_to_bson(out, &estimate));
+    iter = _range_estimate_find(&estimate, "insert.count");
+    ASSERT_CMPINT64(bson_iter_int64(&iter), ==, 2);
+    iter = _range_estimate_find(&estimate, "insert.edges");
+    ASSERT(bson_iter_double(&iter) == 4.0);
+    iter = _range_estimate_find(&estimate, "insert.maxEdges");
+    ASSERT_CMPINT64(bson_iter_int64(&iter), ==, 4);
+    iter = _range_estimate_find(&estimate, "insert.maxPayloadBytes");
+    ASSERT_CMPINT64(bson_iter_int64(&iter), >, 4 * 32);
+    iter = _range_estimate_find(&estimate, "insert.cpuMicros");
+    ASSERT(bson_iter_double(&iter) >= 0.0);
+    iter = _range_estimate_find(&estimate, "find.count");
+    ASSERT_CMPINT64(bson_iter_int64(&iter), ==, 2);
+    iter = _range_estimate_find(&estimate, "find.edges");
+    ASSERT(bson_iter_double(&iter) == 1.5);
+    iter = _range_estimate_find(&estimate, "find.maxEdges");
+    ASSERT_CMPINT64(bson_iter_int64(&iter), ==, 2);
+
+    ASSERT_FAILS(mongocrypt_range_estimate(crypt, TEST_BSON("{'values': [1]}"), out),
+                 crypt,
+                 "expected 'rangeOpts' document");
+    ASSERT_FAILS(mongocrypt_range_estimate(crypt,
+                                           TEST_BSON(RAW_STRING({
+                                               'rangeOpts' : {'min' : 0, 'max' : 7, 'sparsity' : {'$numberLong' : '1'}},
+                                               'values' : [ {'$numberLong' : '5'} ]
+                                           })),
+                                           out),
+                 crypt,
+                 "expected matching 'min' and value type");
+    ASSERT_FAILS(mongocrypt_range_estimate(crypt,
+                                           TEST_BSON(RAW_STRING({
+                                               'rangeOpts' : {'min' : 0, 'max' : 7, 'sparsity' : {'$numberLong' : '1'}},
+                                               'queries' : [ {'lbIncluded' : true} ]
+                                           })),
+                                           out),
+                 crypt,
+                 "expected query to have 'lowerBound' or 'upperBound'");
+
+    mongocrypt_binary_destroy(out);
+    mongocrypt_destroy(crypt);
+}
+
 void _mongocrypt_tester_install_marking(_mongocrypt_tester_t *tester) {
     INSTALL_TEST(test_mongocrypt_marking_parse);
     INSTALL_TEST(test_mc_get_mincover_from_FLE2RangeFindSpec);
     INSTALL_TEST(test_mc_marking_to_ciphertext);
+    INSTALL_TEST(test_mc_marking_ciphertext_len_estimate);
+    INSTALL_TEST(test_mc_find_equality_markings_to_ciphertexts);
+    INSTALL_TEST(test_mongocrypt_range_estimate);
 }
@@ -354,6 +354,28 @@ static bool test_transform_cb(void *ctx, _mongocrypt_buffer_t *in, bson_value_t
     return true;
 }
 
+/* Like test_transform_cb, returning the value bytes. */
+static bool test_transform_raw_cb(void *ctx,
+                                  _mongocrypt_buffer_t *in,
+                                  bson_type_t *type_out,
+                                  _mongocrypt_buffer_t *out,
+                                  mongocrypt_status_t *status) {
+    int *matches = (int *)ctx;
+    const uint32_t len_le = BSON_UINT32_TO_LE(14);
+
+    *matches += 1;
+
+    /* int32 length, subtype, then the data. */
+    *type_out = BSON_TYPE_BINARY;
+    _mongocrypt_buffer_resize(out, 4 + 1 + 14);
+    memcpy(out->data, &len_le, 4);
+    out->data[4] = 6;
+    out->data[5] = in->data[0];
+    memcpy(out->data + 6, "secretmessage", 13);
+
+    return true;
+}
+
 static void test_transform(int num_markings,
                            int num_deterministic,
                            int num_random,
@@ -391,6 +413,43 @@ static void test_transform(int num_markings,
 
     BSON_ASSERT(matches == num_matches);
 
+    /* Replacing the values at the offsets found by a traversal gives the same
+     * document. */
+    {
+        mc_array_t binary_offsets, container_offsets;
+        _mongocrypt_buffer_t in, at_offsets;
+
+        _mc_array_init(&binary_offsets, sizeof(uint32_t));
+        _mc_array_init(&container_offsets, sizeof(uint32_t));
+        matches = 0;
+        BSON_ASSERT(_mongocrypt_traverse_binary_offsets_in_bson(test_traverse_cb,
+                                                                &matches,
+                                                                match,
+                                                                bson,
+                                                                &binary_offsets,
+                                                                &container_offsets,
+                                                                NULL,
+                                                                status));
+        BSON_ASSERT(matches == num_matches);
+        BSON_ASSERT(binary_offsets.len == (size_t)num_matches);
+
+        _mongocrypt_buffer_from_bson(&in, bson);
+        matches = 0;
+        BSON_ASSERT(_mongocrypt_transform_binary_at_offsets(test_transform_raw_cb,
+                                                            &matches,
+                                                            &in,
+                                                            &binary_offsets,
+                                                            &container_offsets,
+                                                            &at_offsets,
+                                                            status));
+        BSON_ASSERT(matches == num_matches);
+        ASSERT_CMPBYTES(bson_get_data(&out), out.len, at_offsets.data, at_offsets.len);
+
+        _mongocrypt_buffer_cleanup(&at_offsets);
+        _mc_array_destroy(&container_offsets);
+        _mc_array_destroy(&binary_offsets);
+    }
+
     bson_destroy(bson);
     bson_destroy(&out);
     mongocrypt_status_destroy(status);
@@ -472,7 +531,259 @@ static void test_mongocrypt_traverse_util(_mongocrypt_tester_t *tester) {
     test_mongocrypt_traverse_util_nesting(&ctx);
 }
 
+static bool _fail_at_cb(void *ctx, _mongocrypt_buffer_t *in, bson_value_t *out, mongocrypt_status_t *status) {
+    int *remaining = (int *)ctx;
+
+    if (--*remaining == 0) {
+        CLIENT_ERR("test failure");
+        return false;
+    }
+    return test_transform_cb(&(int){0}, in, out, status);
+}
+
+/* Nested documents and arrays deeper than the frames kept on the stack. */
+static void test_mongocrypt_traverse_util_deep(_mongocrypt_tester_t *tester) {
+    const int depth = 100;
+    mongocrypt_status_t *status = mongocrypt_status_new();
+    bson_t *bson = bson_new();
+    bson_t out = BSON_INITIALIZER;
+    bson_iter_t iter;
+    int matches = 0;
+
+    _append_marking(bson, "m", 1);
+    for (int i = 0; i < depth; i++) {
+        bson_t *parent = bson_new();
+
+        _append_marking(parent, "m", 1);
+        if (i % 2) {
+            bson_t array = BSON_INITIALIZER;
+            BSON_ASSERT(BSON_APPEND_DOCUMENT(&array, "0", bson));
+            BSON_ASSERT(BSON_APPEND_ARRAY(parent, "a", &array));
+            bson_destroy(&array);
+        } else {
+            BSON_ASSERT(BSON_APPEND_DOCUMENT(parent, "d", bson));
+        }
+        bson_destroy(bson);
+        bson = parent;
+    }
+
+    BSON_ASSERT(bson_iter_init(&iter, bson));
+    ASSERT_OK_STATUS(
+        _mongocrypt_traverse_binary_in_bson(test_traverse_cb, &matches, TRAVERSE_MATCH_MARKING, &iter, status),
+        status);
+    ASSERT_CMPINT(matches, ==, depth + 1);
+
+    matches = 0;
+    BSON_ASSERT(bson_iter_init(&iter, bson));
+    ASSERT_OK_STATUS(
+        _mongocrypt_transform_binary_in_bson(test_transform_cb, &matches, TRAVERSE_MATCH_MARKING, &iter, &out, status),
+        status);
+    ASSERT_CMPINT(matches, ==, depth + 1);
+
+    matches = 0;
+    BSON_ASSERT(bson_iter_init(&iter, &out));
+    ASSERT_OK_STATUS(_mongocrypt_traverse_binary_in_bson(post_transform_traverse_check,
+                                                         &matches,
+                                                         TRAVERSE_MATCH_MARKING,
+                                                         &iter,
+                                                         status),
+                     status);
+    ASSERT_CMPINT(matches, ==, depth + 1);
+    bson_destroy(&out);
+
+    /* A failure deep in the document closes the partial copy. */
+    matches = depth / 2;
+    bson_init(&out);
+    BSON_ASSERT(bson_iter_init(&iter, bson));
+    ASSERT_FAILS_STATUS(
+        _mongocrypt_transform_binary_in_bson(_fail_at_cb, &matches, TRAVERSE_MATCH_MARKING, &iter, &out, status),
+        status,
+        "test failure");
+    BSON_ASSERT(BSON_APPEND_INT32(&out, "after", 1));
+    bson_destroy(&out);
+
+    bson_destroy(bson);
+    mongocrypt_status_destroy(status);
+}
+
+static void test_mongocrypt_may_contain_subtype6(_mongocrypt_tester_t *tester) {
+    _mongocrypt_buffer_t buf;
+    bson_t *bson;
+
+    /* Bytes of 0x06 in other values are not subtype 6 binaries. */
+    bson = BCON_NEW("a", BCON_INT32(6), "b", BCON_UTF8("\x06\x06"), "c", "{", "d", BCON_INT64(0x0606060606), "}");
+    _mongocrypt_buffer_from_bson(&buf, bson);
+    ASSERT(!_mongocrypt_may_contain_subtype6(&buf));
+    bson_destroy(bson);
+
+    bson = bson_new();
+    BSON_ASSERT(bson_append_binary(bson, "a", 1, BSON_SUBTYPE_BINARY, (const uint8_t *)"\x06", 1));
+    _mongocrypt_buffer_from_bson(&buf, bson);
+    ASSERT(!_mongocrypt_may_contain_subtype6(&buf));
+    bson_destroy(bson);
+
+    bson = BCON_NEW("a", "[", "{", "}", "]");
+    _append_ciphertext_with_subtype(bson, "b", 1, BSON_SUBTYPE_ENCRYPTED, 1, tester);
+    _mongocrypt_buffer_from_bson(&buf, bson);
+    ASSERT(_mongocrypt_may_contain_subtype6(&buf));
+    bson_destroy(bson);
+
+    bson = bson_new();
+    _append_marking(bson, "", 0);
+    _mongocrypt_buffer_from_bson(&buf, bson);
+    ASSERT(_mongocrypt_may_contain_subtype6(&buf));
+    bson_destroy(bson);
+}
+
+/* Appends a cursor reply whose nextBatch has @n documents, each with a
+ * ciphertext at "x.y". */
+static bson_t *_cursor_reply(int n, _mongocrypt_tester_t *tester) {
+    bson_t *reply = bson_new();
+    bson_t cursor, batch;
+
+    BSON_ASSERT(BSON_APPEND_DOCUMENT_BEGIN(reply, "cursor", &cursor));
+    BSON_ASSERT(BSON_APPEND_ARRAY_BEGIN(&cursor, "nextBatch", &batch));
+    for (int i = 0; i < n; i++) {
+        char idx_str[16];
+        const char *idx;
+        bson_t doc, x, plain;
+
+        bson_uint32_to_string((uint32_t)i, &idx, idx_str, sizeof(idx_str));
+        BSON_ASSERT(bson_append_document_begin(&batch, idx, -1, &doc));
+        BSON_ASSERT(BSON_APPEND_INT32(&doc, "_id", i));
+        BSON_ASSERT(BSON_APPEND_DOCUMENT_BEGIN(&doc, "plain", &plain));
+        BSON_ASSERT(BSON_APPEND_UTF8(&plain, "name", "Mary"));
+        BSON_ASSERT(bson_append_document_end(&doc, &plain));
+        BSON_ASSERT(BSON_APPEND_DOCUMENT_BEGIN(&doc, "x", &x));
+        _append_ciphertext_with_subtype(&x, "y", 1, BSON_SUBTYPE_ENCRYPTED, 1, tester);
+        BSON_ASSERT(bson_append_document_end(&doc, &x));
+        BSON_ASSERT(bson_append_document_end(&batch, &doc));
+    }
+    BSON_ASSERT(bson_append_array_end(&cursor, &batch));
+    BSON_ASSERT(BSON_APPEND_INT64(&cursor, "id", 123));
+    BSON_ASSERT(bson_append_document_end(reply, &cursor));
+    BSON_ASSERT(BSON_APPEND_DOUBLE(reply, "ok", 1.0));
+    return reply;
+}
+
+/* Checks that a traversal at @paths finds the offsets of a full traversal if
+ * it reports to be @complete. */
+static void _check_offsets_at_paths(const bson_t *bson, const _mongocrypt_path_trie_t *paths, bool complete) {
+    mongocrypt_status_t *status = mongocrypt_status_new();
+    mc_array_t binary_offsets, container_offsets, guided_binary_offsets, guided_container_offsets;
+    bool guided_complete;
+
+    _mc_array_init(&binary_offsets, sizeof(uint32_t));
+    _mc_array_init(&container_offsets, sizeof(uint32_t));
+    _mc_array_init(&guided_binary_offsets, sizeof(uint32_t));
+    _mc_array_init(&guided_container_offsets, sizeof(uint32_t));
+
+    ASSERT_OK_STATUS(_mongocrypt_traverse_binary_offsets_in_bson(NULL,
+                                                                 NULL,
+                                                                 TRAVERSE_MATCH_CIPHERTEXT,
+                                                                 bson,
+                                                                 &binary_offsets,
+                                                                 &container_offsets,
+                                                                 NULL,
+                                                                 status),
+                     status);
+    ASSERT_OK_STATUS(_mongocrypt_traverse_binary_offsets_at_paths(TRAVERSE_MATCH_CIPHERTEXT,
+                                                                  bson,
+                                                                  paths,
+                                                                  &guided_binary_offsets,
+                                                                  &guided_container_offsets,
+                                                                  &guided_complete,
+                                                                  status),
+                     status);
+    ASSERT(guided_complete == complete);
+    if (complete) {
+        ASSERT_CMPBYTES((uint8_t *)binary_offsets.data,
+                        binary_offsets.len * sizeof(uint32_t),
+                        (uint8_t *)guided_binary_offsets.data,
+                        guided_binary_offsets.len * sizeof(uint32_t));
+        ASSERT_CMPBYTES((uint8_t *)container_offsets.data,
+                        container_offsets.len * sizeof(uint32_t),
+                        (uint8_t *)guided_container_offsets.data,
+                        guided_container_offsets.len * sizeof(uint32_t));
+    }
+
+    _mc_array_destroy(&guided_container_offsets);
+    _mc_array_destroy(&guided_binary_offsets);
+    _mc_array_destroy(&container_offsets);
+    _mc_array_destroy(&binary_offsets);
+    mongocrypt_status_destroy(status);
+}
+
+static void test_mongocrypt_traverse_offsets_at_paths(_mongocrypt_tester_t *tester) {
+    mongocrypt_status_t *status = mongocrypt_status_new();
+    _mongocrypt_path_trie_t *paths = _mongocrypt_path_trie_new();
+    mc_array_t binary_offsets, container_offsets;
+    bson_t *bson;
+
+    /* Capture the paths of the first batch. */
+    _mc_array_init(&binary_offsets, sizeof(uint32_t));
+    _mc_array_init(&container_offsets, sizeof(uint32_t));
+    ASSERT(_mongocrypt_path_trie_empty(paths));
+    bson = _cursor_reply(2, tester);
+    ASSERT_OK_STATUS(_mongocrypt_traverse_binary_offsets_in_bson(NULL,
+                                                                 NULL,
+                                                                 TRAVERSE_MATCH_CIPHERTEXT,
+                                                                 bson,
+                                                                 &binary_offsets,
+                                                                 &container_offsets,
+                                                                 paths,
+                                                                 status),
+                     status);
+    ASSERT_CMPSIZE_T(binary_offsets.len, ==, 2u);
+    ASSERT(!_mongocrypt_path_trie_empty(paths));
+    _check_offsets_at_paths(bson, paths, true);
+    bson_destroy(bson);
+
+    /* A batch of another length has the same paths. */
+    bson = _cursor_reply(5, tester);
+    _check_offsets_at_paths(bson, paths, true);
+    bson_destroy(bson);
+
+    /* The elements of the documents on the paths are all visited. */
+    bson = _cursor_reply(3, tester);
+    _append_ciphertext_with_subtype(bson, "other", 5, BSON_SUBTYPE_ENCRYPTED, 1, tester);
+    _check_offsets_at_paths(bson, paths, true);
+    bson_destroy(bson);
+
+    /* A ciphertext in a document off the paths is detected. */
+    bson = _cursor_reply(3, tester);
+    {
+        bson_t doc;
+
+        BSON_ASSERT(BSON_APPEND_DOCUMENT_BEGIN(bson, "other", &doc));
+        _append_ciphertext_with_subtype(&doc, "z", 1, BSON_SUBTYPE_ENCRYPTED, 1, tester);
+        BSON_ASSERT(bson_append_document_end(bson, &doc));
+    }
+    _check_offsets_at_paths(bson, paths, false);
+    bson_destroy(bson);
+
+    /* So is a marking, which is not a ciphertext, in a skipped document. */
+    bson = _cursor_reply(1, tester);
+    {
+        bson_t doc;
+
+        BSON_ASSERT(BSON_APPEND_DOCUMENT_BEGIN(bson, "skipped", &doc));
+        _append_ciphertext_with_subtype(&doc, "m", 1, BSON_SUBTYPE_ENCRYPTED, 0, tester);
+        BSON_ASSERT(bson_append_document_end(bson, &doc));
+    }
+    _check_offsets_at_paths(bson, paths, false);
+    bson_destroy(bson);
+
+    _mc_array_destroy(&container_offsets);
+    _mc_array_destroy(&binary_offsets);
+    _mongocrypt_path_trie_destroy(paths);
+    mongocrypt_status_destroy(status);
+}
+
 void _mongocrypt_tester_install_traverse_util(_mongocrypt_tester_t *tester) {
     INSTALL_TEST(test_mongocrypt_traverse_util);
     INSTALL_TEST(test_mongocrypt_transform_util);
+    INSTALL_TEST(test_mongocrypt_traverse_util_deep);
+    INSTALL_TEST(test_mongocrypt_may_contain_subtype6);
+    INSTALL_TEST(test_mongocrypt_traverse_offsets_at_paths);
 }
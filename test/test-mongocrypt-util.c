@@ -32,6 +32,7 @@ const char *mongocrypt_ctx_state_to_string(mongocrypt_ctx_state_t state) {
     case MONGOCRYPT_CTX_NEED_KMS: return "MONGOCRYPT_CTX_NEED_KMS";
     case MONGOCRYPT_CTX_READY: return "MONGOCRYPT_CTX_READY";
     case MONGOCRYPT_CTX_DONE: return "MONGOCRYPT_CTX_DONE";
+    case MONGOCRYPT_CTX_NEED_MONGO_OPS: return "MONGOCRYPT_CTX_NEED_MONGO_OPS";
     default: return "UNKNOWN";
     }
 }
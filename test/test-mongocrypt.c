@@ -30,6 +30,12 @@
 #include <sys/sysctl.h>
 #endif
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
 /* Return a repeated character with no null terminator. */
 char *_mongocrypt_repeat_char(char c, uint32_t times) {
     char *result;
@@ -420,6 +426,65 @@ void _mongocrypt_tester_fill_buffer(_mongocrypt_buffer_t *buf, int n) {
     buf->owned = true;
 }
 
+struct __mongocrypt_tester_thread_t {
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+    void (*fn)(void *arg);
+    void *arg;
+};
+
+#ifdef _WIN32
+static DWORD WINAPI _tester_thread_main(LPVOID p) {
+    _mongocrypt_tester_thread_t *thread = p;
+
+    thread->fn(thread->arg);
+    return 0;
+}
+#else
+static void *_tester_thread_main(void *p) {
+    _mongocrypt_tester_thread_t *thread = p;
+
+    thread->fn(thread->arg);
+    return NULL;
+}
+#endif
+
+_mongocrypt_tester_thread_t *_mongocrypt_tester_thread_start(void (*fn)(void *arg), void *arg) {
+    _mongocrypt_tester_thread_t *thread = bson_malloc0(sizeof(*thread));
+
+    thread->fn = fn;
+    thread->arg = arg;
+#ifdef _WIN32
+    thread->handle = CreateThread(NULL, 0, _tester_thread_main, thread, 0, NULL);
+    ASSERT(thread->handle);
+#else
+    ASSERT(0 == pthread_create(&thread->handle, NULL, _tester_thread_main, thread));
+#endif
+    return thread;
+}
+
+void _mongocrypt_tester_thread_join(_mongocrypt_tester_thread_t *thread) {
+#ifdef _WIN32
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+#else
+    ASSERT(0 == pthread_join(thread->handle, NULL));
+#endif
+    bson_free(thread);
+}
+
+void _reverse_parallel_for(void *ctx, mongocrypt_task_fn task, void *task_ctx, uint32_t count) {
+    _reverse_parallel_for_ctx *pctx = ctx;
+    pctx->calls++;
+    pctx->last_count = count;
+    for (uint32_t i = count; i > 0; i--) {
+        task(task_ctx, i - 1u);
+    }
+}
+
 #define PRIVATE_KEY_FOR_TESTING                                                                                        \
     "MIIEvgIBADANBgkqhkiG9w0BAQEFAASCBKgwggSkAgEAAoIBAQC4JOyv5z05cL18ztpknRC7C"                                        \
     "FY2gYol4DAKerdVUoDJxCTmFMf39dVUEqD0WDiw/qcRtSO1/"                                                                 \
@@ -500,6 +565,27 @@ mongocrypt_t *_mongocrypt_tester_mongocrypt(tester_mongocrypt_flags flags) {
     } else {
         crypt->opts.use_range_v2 = false;
     }
+    if (flags & TESTER_MONGOCRYPT_WITH_MINCOVER_CACHE) {
+        ASSERT_OK(mongocrypt_setopt_mincover_cache_max_entries(crypt, 16), crypt);
+    }
+    if (flags & TESTER_MONGOCRYPT_WITH_MARKING_CACHE) {
+        ASSERT_OK(mongocrypt_setopt_marking_cache_max_entries(crypt, 16), crypt);
+    }
+    if (flags & TESTER_MONGOCRYPT_WITH_TOKEN_CACHE) {
+        ASSERT_OK(mongocrypt_setopt_token_cache_max_entries(crypt, 16), crypt);
+    }
+    if (flags & TESTER_MONGOCRYPT_WITH_DETERMINISTIC_CACHE) {
+        ASSERT_OK(mongocrypt_setopt_deterministic_cache_max_entries(crypt, 1), crypt);
+    }
+    if (flags & TESTER_MONGOCRYPT_WITH_FIND_PAYLOAD_CACHE) {
+        ASSERT_OK(mongocrypt_setopt_find_payload_cache_max_entries(crypt, 16), crypt);
+    }
+    if (flags & TESTER_MONGOCRYPT_WITH_RANGE_OPTS_CACHE) {
+        ASSERT_OK(mongocrypt_setopt_range_opts_cache_max_entries(crypt, 16), crypt);
+    }
+    if (flags & TESTER_MONGOCRYPT_WITH_KEY_CACHE_THREAD_LOCAL) {
+        ASSERT_OK(mongocrypt_setopt_key_cache_thread_local(crypt), crypt);
+    }
     ASSERT_OK(mongocrypt_init(crypt), crypt);
     if (flags & TESTER_MONGOCRYPT_WITH_CRYPT_SHARED_LIB) {
         if (mongocrypt_crypt_shared_lib_version(crypt) == 0) {
@@ -672,6 +758,385 @@ static void _test_setopt_encrypted_field_config_map(_mongocrypt_tester_t *tester
                  crypt,
                  "db.coll1 is present in both schema_map and encrypted_field_config_map");
     mongocrypt_destroy(crypt);
+
+    /* Test that an invalid entry only fails contexts targeting it. */
+    {
+        mongocrypt_ctx_t *ctx;
+
+        crypt = mongocrypt_new();
+        ASSERT_OK(mongocrypt_setopt_encrypted_field_config_map(
+                      crypt,
+                      TEST_BSON("{'db.coll1': {}, 'db.coll2': {'fields': []}, 'db.coll3': 1}")),
+                  crypt);
+        ASSERT_OK(mongocrypt_setopt_kms_providers(
+                      crypt,
+                      TEST_BSON("{'aws': {'accessKeyId': 'foo', 'secretAccessKey': 'bar'}}")),
+                  crypt);
+        ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+
+        ctx = mongocrypt_ctx_new(crypt);
+        ASSERT_FAILS(mongocrypt_ctx_encrypt_init(ctx, "db", -1, TEST_BSON("{'find': 'coll1'}")),
+                     ctx,
+                     "unable to find 'fields' in encrypted_field_config");
+        mongocrypt_ctx_destroy(ctx);
+
+        ctx = mongocrypt_ctx_new(crypt);
+        ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "db", -1, TEST_BSON("{'find': 'coll2'}")), ctx);
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_MARKINGS);
+        mongocrypt_ctx_destroy(ctx);
+
+        ctx = mongocrypt_ctx_new(crypt);
+        ASSERT_FAILS(mongocrypt_ctx_encrypt_init(ctx, "db", -1, TEST_BSON("{'find': 'coll3'}")),
+                     ctx,
+                     "unable to copy encrypted_field_config");
+        mongocrypt_ctx_destroy(ctx);
+
+        mongocrypt_destroy(crypt);
+    }
+}
+
+typedef struct {
+    int allocations;
+    size_t allocated;
+    size_t freed;
+} _test_allocator_t;
+
+static void *_test_malloc(size_t size, void *ctx) {
+    _test_allocator_t *allocator = ctx;
+
+    allocator->allocations++;
+    allocator->allocated += size;
+    return bson_malloc(size);
+}
+
+static void _test_free(void *ptr, size_t size, void *ctx) {
+    _test_allocator_t *allocator = ctx;
+
+    allocator->freed += size;
+    bson_free(ptr);
+}
+
+static void _test_setopt_allocator(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    _test_allocator_t allocator = {0};
+
+    crypt = mongocrypt_new();
+    ASSERT_FAILS(mongocrypt_setopt_allocator(crypt, _test_malloc, NULL, &allocator),
+                 crypt,
+                 "malloc_fn and free_fn are required");
+    mongocrypt_destroy(crypt);
+
+    crypt = mongocrypt_new();
+    ASSERT_OK(mongocrypt_setopt_allocator(crypt, _test_malloc, _test_free, &allocator), crypt);
+    ASSERT_OK(
+        mongocrypt_setopt_kms_providers(crypt, TEST_BSON("{'aws': {'accessKeyId': 'foo', 'secretAccessKey': 'bar'}}")),
+        crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+
+    /* The context and its key request are allocated with the allocator. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_key_id(ctx, TEST_BIN(16)), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx, MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR, -1), ctx);
+    ASSERT_OK(mongocrypt_ctx_explicit_encrypt_init(ctx, TEST_BSON("{'v': 'foo'}")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+    ASSERT_CMPINT(allocator.allocations, ==, 2);
+    mongocrypt_ctx_destroy(ctx);
+    ASSERT_CMPSIZE_T(allocator.freed, ==, allocator.allocated);
+
+    mongocrypt_destroy(crypt);
+}
+
+typedef struct {
+    /* spans has "+<span>" for each begin and "-<span>" for each end. */
+    char spans[256];
+    char collinfo_ns[32];
+    bool all_ok;
+} _test_trace_t;
+
+static void _test_trace_fn(mongocrypt_ctx_t *ctx,
+                           mongocrypt_trace_event_t event,
+                           const char *span,
+                           mongocrypt_binary_t *attributes,
+                           void *trace_ctx) {
+    _test_trace_t *trace = trace_ctx;
+    size_t len = strlen(trace->spans);
+    bson_t bson;
+    bson_iter_t iter;
+
+    ASSERT(ctx);
+    ASSERT(_mongocrypt_binary_to_bson(attributes, &bson));
+    ASSERT(len + strlen(span) + 2 < sizeof(trace->spans));
+    bson_snprintf(trace->spans + len,
+                  sizeof(trace->spans) - len,
+                  "%s%s",
+                  event == MONGOCRYPT_TRACE_BEGIN ? "+" : "-",
+                  span);
+
+    if (event == MONGOCRYPT_TRACE_BEGIN && 0 == strcmp(span, "collinfo")) {
+        ASSERT(bson_iter_init_find(&iter, &bson, "ns"));
+        bson_snprintf(trace->collinfo_ns, sizeof(trace->collinfo_ns), "%s", bson_iter_utf8(&iter, NULL));
+    }
+    if (event == MONGOCRYPT_TRACE_END) {
+        ASSERT(bson_iter_init_find(&iter, &bson, "ok"));
+        trace->all_ok = trace->all_ok && bson_iter_bool(&iter);
+    }
+}
+
+static void _test_setopt_trace_handler(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    _test_trace_t trace = {.all_ok = true};
+
+    crypt = mongocrypt_new();
+    ASSERT_OK(mongocrypt_setopt_trace_handler(crypt, _test_trace_fn, &trace), crypt);
+    ASSERT_OK(
+        mongocrypt_setopt_kms_providers(crypt, TEST_BSON("{'aws': {'accessKeyId': 'foo', 'secretAccessKey': 'bar'}}")),
+        crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "test", -1, TEST_FILE("./test/example/cmd.json")), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_DONE);
+    ASSERT_STREQUAL(trace.spans, "+collinfo-collinfo+markings-markings+keys-keys+kms-kms+encrypt-encrypt");
+    ASSERT_STREQUAL(trace.collinfo_ns, "test.test");
+    ASSERT(trace.all_ok);
+    mongocrypt_ctx_destroy(ctx);
+
+    /* A span still open on destroy ends with an error. */
+    memset(&trace, 0, sizeof(trace));
+    trace.all_ok = true;
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "test", -1, TEST_FILE("./test/example/cmd.json")), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_COLLINFO);
+    mongocrypt_ctx_destroy(ctx);
+    ASSERT_STREQUAL(trace.spans, "+collinfo-collinfo");
+    ASSERT(!trace.all_ok);
+
+    mongocrypt_destroy(crypt);
+}
+
+typedef struct {
+    /* calls has the recorded call names of the last session, separated by
+     * spaces. */
+    char calls[512];
+    int sessions;
+    bool ok;
+} _test_record_t;
+
+static void _test_record_fn(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *session, void *record_ctx) {
+    _test_record_t *record = record_ctx;
+    bson_t bson;
+    bson_iter_t iter, events, call;
+
+    ASSERT(ctx);
+    ASSERT(_mongocrypt_binary_to_bson(session, &bson));
+    record->sessions++;
+    record->calls[0] = '\0';
+
+    ASSERT(bson_iter_init_find(&iter, &bson, "ok"));
+    record->ok = bson_iter_bool(&iter);
+    ASSERT(bson_iter_init_find(&iter, &bson, "events"));
+    ASSERT(bson_iter_recurse(&iter, &events));
+    while (bson_iter_next(&events)) {
+        size_t len = strlen(record->calls);
+
+        ASSERT(bson_iter_recurse(&events, &call));
+        ASSERT(bson_iter_find(&call, "call"));
+        ASSERT(len + strlen(bson_iter_utf8(&call, NULL)) + 2 < sizeof(record->calls));
+        bson_snprintf(record->calls + len,
+                      sizeof(record->calls) - len,
+                      "%s%s",
+                      len ? " " : "",
+                      bson_iter_utf8(&call, NULL));
+    }
+}
+
+static void _test_setopt_record_handler(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    _test_record_t record = {0};
+
+    crypt = mongocrypt_new();
+    ASSERT_OK(mongocrypt_setopt_record_handler(crypt, _test_record_fn, &record), crypt);
+    ASSERT_OK(
+        mongocrypt_setopt_kms_providers(crypt, TEST_BSON("{'aws': {'accessKeyId': 'foo', 'secretAccessKey': 'bar'}}")),
+        crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_encrypt_init(ctx, "test", -1, TEST_FILE("./test/example/cmd.json")), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_DONE);
+    ASSERT_CMPINT(record.sessions, ==, 0);
+    mongocrypt_ctx_destroy(ctx);
+    ASSERT_CMPINT(record.sessions, ==, 1);
+    ASSERT(record.ok);
+    ASSERT_STREQUAL(record.calls,
+                    "ctx_encrypt_init ctx_mongo_feed ctx_mongo_done ctx_mongo_feed ctx_mongo_done ctx_mongo_feed "
+                    "ctx_mongo_done ctx_next_kms_ctx kms_ctx_feed ctx_next_kms_ctx ctx_kms_done ctx_finalize");
+
+    /* A context that fails is reported when reset. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_FAILS(mongocrypt_ctx_explicit_decrypt_init(ctx, TEST_BSON("{'v': 1}")), ctx, "must contain a binary");
+    ASSERT_OK(mongocrypt_ctx_reset(ctx), ctx);
+    ASSERT_CMPINT(record.sessions, ==, 2);
+    ASSERT(!record.ok);
+    ASSERT_STREQUAL(record.calls, "ctx_explicit_decrypt_init");
+
+    /* Contexts that cannot be replayed are not reported. */
+    ASSERT_OK(mongocrypt_ctx_setopt_key_encryption_key(ctx, TEST_BSON("{'provider': 'local'}")), ctx);
+    ASSERT_OK(mongocrypt_ctx_datakey_init(ctx), ctx);
+    mongocrypt_ctx_destroy(ctx);
+    ASSERT_CMPINT(record.sessions, ==, 2);
+
+    mongocrypt_destroy(crypt);
+}
+
+static int64_t _get_counter(mongocrypt_t *crypt, const char *path) {
+    mongocrypt_binary_t *bin = mongocrypt_binary_new();
+    bson_t counters;
+    bson_iter_t iter, found;
+    int64_t value;
+
+    ASSERT_OK(mongocrypt_get_counters(crypt, bin), crypt);
+    ASSERT(_mongocrypt_binary_to_bson(bin, &counters));
+    ASSERT(bson_iter_init(&iter, &counters));
+    ASSERT(bson_iter_find_descendant(&iter, path, &found));
+    ASSERT(BSON_ITER_HOLDS_INT64(&found));
+    value = bson_iter_int64(&found);
+    mongocrypt_binary_destroy(bin);
+    return value;
+}
+
+static void _test_get_counters(_mongocrypt_tester_t *tester) {
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *bin;
+    _mongocrypt_buffer_t encrypted;
+
+    crypt = mongocrypt_new();
+    ASSERT_FAILS(mongocrypt_get_counters(crypt, NULL), crypt, "mongocrypt_init not called");
+    mongocrypt_destroy(crypt);
+
+    crypt = _mongocrypt_tester_mongocrypt(TESTER_MONGOCRYPT_DEFAULT);
+    ASSERT_FAILS(mongocrypt_get_counters(crypt, NULL), crypt, "invalid NULL counters");
+    ASSERT_CMPINT64(_get_counter(crypt, "contexts.encrypt"), ==, 0);
+
+    bin = mongocrypt_binary_new();
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_key_alt_name(ctx, TEST_BSON("{'keyAltName': 'keyDocumentName'}")), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx, MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR, -1), ctx);
+    ASSERT_OK(mongocrypt_ctx_explicit_encrypt_init(ctx, TEST_BSON("{'v': 'foo'}")), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, bin), ctx);
+    _mongocrypt_buffer_copy_from_binary(&encrypted, bin);
+    mongocrypt_ctx_destroy(ctx);
+
+    ASSERT_CMPINT64(_get_counter(crypt, "contexts.encrypt"), ==, 1);
+    ASSERT_CMPINT64(_get_counter(crypt, "encryptedValues.fle1"), ==, 1);
+    ASSERT_CMPINT64(_get_counter(crypt, "bytes.encrypt"), ==, (int64_t)TEST_BSON("{'v': 'foo'}")->len);
+    ASSERT_CMPINT64(_get_counter(crypt, "kmsRequests.aws"), ==, 1);
+
+    /* The key is cached. No KMS request is needed to decrypt. */
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_explicit_decrypt_init(ctx, _mongocrypt_buffer_as_binary(&encrypted)), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_READY);
+    ASSERT_OK(mongocrypt_ctx_finalize(ctx, bin), ctx);
+    mongocrypt_ctx_destroy(ctx);
+
+    ASSERT_CMPINT64(_get_counter(crypt, "contexts.decrypt"), ==, 1);
+    ASSERT_CMPINT64(_get_counter(crypt, "decryptedValues.fle1"), ==, 1);
+    ASSERT_CMPINT64(_get_counter(crypt, "decryptedValues.fle2Equality"), ==, 0);
+    ASSERT_CMPINT64(_get_counter(crypt, "kmsRequests.aws"), ==, 1);
+
+    _mongocrypt_buffer_cleanup(&encrypted);
+    mongocrypt_binary_destroy(bin);
+    mongocrypt_destroy(crypt);
+}
+
+static int64_t _get_kms_stat(mongocrypt_t *crypt, const char *path) {
+    mongocrypt_binary_t *bin = mongocrypt_binary_new();
+    bson_t stats;
+    bson_iter_t iter, found;
+    int64_t value;
+
+    ASSERT_OK(mongocrypt_get_kms_stats(crypt, bin), crypt);
+    ASSERT(_mongocrypt_binary_to_bson(bin, &stats));
+    ASSERT(bson_iter_init(&iter, &stats));
+    ASSERT(bson_iter_find_descendant(&iter, path, &found));
+    ASSERT(BSON_ITER_HOLDS_INT64(&found));
+    value = bson_iter_int64(&found);
+    mongocrypt_binary_destroy(bin);
+    return value;
+}
+
+static void _test_get_kms_stats(_mongocrypt_tester_t *tester) {
+    const char *throttled = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n";
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_kms_ctx_t *kms;
+    mongocrypt_binary_t *bin;
+    mongocrypt_binary_t *msg;
+    bson_t stats;
+    bson_iter_t iter, found;
+    int64_t latency_count = 0;
+
+    crypt = mongocrypt_new();
+    ASSERT_FAILS(mongocrypt_get_kms_stats(crypt, NULL), crypt, "mongocrypt_init not called");
+    mongocrypt_destroy(crypt);
+
+    bin = mongocrypt_binary_new_from_data((uint8_t *)throttled, (uint32_t)strlen(throttled));
+    msg = mongocrypt_binary_new();
+    crypt = mongocrypt_new();
+    ASSERT_OK(mongocrypt_setopt_kms_provider_aws(crypt, "example", -1, "example", -1), crypt);
+    ASSERT_OK(mongocrypt_setopt_retry_kms(crypt, true), crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+    ASSERT_FAILS(mongocrypt_get_kms_stats(crypt, NULL), crypt, "invalid NULL stats");
+
+    ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_decrypt_init(ctx, TEST_FILE("./test/data/encrypted-cmd.json")), ctx);
+    _mongocrypt_tester_run_ctx_to(tester, ctx, MONGOCRYPT_CTX_NEED_KMS);
+
+    /* A throttled response, a network error, and a success. */
+    kms = mongocrypt_ctx_next_kms_ctx(ctx);
+    ASSERT(kms);
+    ASSERT_OK(mongocrypt_kms_ctx_message(kms, msg), kms);
+    ASSERT_OK(mongocrypt_kms_ctx_feed(kms, bin), kms);
+    ASSERT(mongocrypt_ctx_next_kms_ctx(ctx) == kms);
+    ASSERT_OK(mongocrypt_kms_ctx_message(kms, msg), kms);
+    ASSERT_OK(mongocrypt_kms_ctx_fail(kms), kms);
+    ASSERT_OK(mongocrypt_ctx_kms_done(ctx), ctx);
+    ASSERT(mongocrypt_ctx_next_kms_ctx(ctx) == kms);
+    ASSERT_OK(mongocrypt_kms_ctx_message(kms, msg), kms);
+    _mongocrypt_tester_satisfy_kms(tester, kms);
+    ASSERT(!mongocrypt_ctx_next_kms_ctx(ctx));
+    ASSERT_OK(mongocrypt_ctx_kms_done(ctx), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    mongocrypt_ctx_destroy(ctx);
+
+    ASSERT_CMPINT64(_get_kms_stat(crypt, "kms.0.requests"), ==, 3);
+    ASSERT_CMPINT64(_get_kms_stat(crypt, "kms.0.httpErrors.503"), ==, 1);
+    ASSERT_CMPINT64(_get_kms_stat(crypt, "kms.0.otherErrors"), ==, 1);
+
+    /* Every timed request is in one latency bucket. */
+    ASSERT_OK(mongocrypt_get_kms_stats(crypt, bin), crypt);
+    ASSERT(_mongocrypt_binary_to_bson(bin, &stats));
+    ASSERT(bson_iter_init(&iter, &stats));
+    ASSERT(bson_iter_find_descendant(&iter, "kms.0.kmsProvider", &found));
+    ASSERT_STREQUAL(bson_iter_utf8(&found, NULL), "aws");
+    ASSERT(bson_iter_init(&iter, &stats));
+    ASSERT(bson_iter_find_descendant(&iter, "kms.0.latencyMillis", &found));
+    ASSERT(bson_iter_recurse(&found, &iter));
+    while (bson_iter_next(&iter)) {
+        latency_count += bson_iter_int64(&iter);
+    }
+    ASSERT_CMPINT64(latency_count, ==, 3);
+    ASSERT(bson_iter_init(&iter, &stats));
+    ASSERT(!bson_iter_find_descendant(&iter, "kms.1", &found));
+
+    mongocrypt_binary_destroy(msg);
+    mongocrypt_binary_destroy(bin);
+    mongocrypt_destroy(crypt);
 }
 
 static void _test_setopt_invalid_kms_providers(_mongocrypt_tester_t *tester) {
@@ -850,6 +1315,9 @@ int main(int argc, char **argv) {
     _mongocrypt_tester_install_ctx_encrypt(&tester);
     _mongocrypt_tester_install_ctx_decrypt(&tester);
     _mongocrypt_tester_install_ctx_rewrap_many_datakey(&tester);
+    _mongocrypt_tester_install_ctx_prefetch_keys(&tester);
+    _mongocrypt_tester_install_ctx_group(&tester);
+    _mongocrypt_tester_install_key_handle(&tester);
     _mongocrypt_tester_install_ciphertext(&tester);
     _mongocrypt_tester_install_key_broker(&tester);
     _mongocrypt_tester_install(&tester, "_test_mongocrypt_bad_init", _test_mongocrypt_bad_init, CRYPTO_REQUIRED);
@@ -865,6 +1333,11 @@ int main(int argc, char **argv) {
                                "_test_setopt_encrypted_field_config_map",
                                _test_setopt_encrypted_field_config_map,
                                CRYPTO_REQUIRED);
+    _mongocrypt_tester_install(&tester, "_test_setopt_allocator", _test_setopt_allocator, CRYPTO_REQUIRED);
+    _mongocrypt_tester_install(&tester, "_test_setopt_trace_handler", _test_setopt_trace_handler, CRYPTO_REQUIRED);
+    _mongocrypt_tester_install(&tester, "_test_setopt_record_handler", _test_setopt_record_handler, CRYPTO_REQUIRED);
+    _mongocrypt_tester_install(&tester, "_test_get_counters", _test_get_counters, CRYPTO_REQUIRED);
+    _mongocrypt_tester_install(&tester, "_test_get_kms_stats", _test_get_kms_stats, CRYPTO_REQUIRED);
     _mongocrypt_tester_install(&tester,
                                "_test_setopt_invalid_kms_providers",
                                _test_setopt_invalid_kms_providers,
@@ -878,6 +1351,7 @@ int main(int argc, char **argv) {
     _mongocrypt_tester_install_kek(&tester);
     _mongocrypt_tester_install_cache_oauth(&tester);
     _mongocrypt_tester_install_kms_ctx(&tester);
+    _mongocrypt_tester_install_kms_client(&tester);
     _mongocrypt_tester_install_csfle_lib(&tester);
     _mongocrypt_tester_install_dll(&tester);
     _mongocrypt_tester_install_mc_tokens(&tester);
@@ -899,6 +1373,7 @@ int main(int argc, char **argv) {
     _mongocrypt_tester_install_mc_FLE2RangeFindDriverSpec(&tester);
     _mongocrypt_tester_install_gcp_auth(&tester);
     _mongocrypt_tester_install_mc_reader(&tester);
+    _mongocrypt_tester_install_mc_arena(&tester);
     _mongocrypt_tester_install_mc_writer(&tester);
     _mongocrypt_tester_install_opts(&tester);
     _mongocrypt_tester_install_named_kms_providers(&tester);
@@ -930,6 +1405,14 @@ int main(int argc, char **argv) {
 get_os_version_failed:
 #endif
 
+    /* Native crypto is initialized on first use, but some test crypto hooks
+     * call _native_crypto_ functions directly. */
+    {
+        mongocrypt_status_t *status = mongocrypt_status_new();
+        ASSERT_OR_PRINT(_native_crypto_ensure_init(status), status);
+        mongocrypt_status_destroy(status);
+    }
+
     printf("Running tests...\n");
     for (i = 0; tester.test_names[i]; i++) {
         int j;
@@ -44,6 +44,20 @@ typedef enum tester_mongocrypt_flags {
     TESTER_MONGOCRYPT_WITH_CRYPT_V1 = 1 << 1,
     /// Enable range V2
     TESTER_MONGOCRYPT_WITH_RANGE_V2 = 1 << 2,
+    /// Cache range query covers
+    TESTER_MONGOCRYPT_WITH_MINCOVER_CACHE = 1 << 3,
+    /// Cache query analysis results
+    TESTER_MONGOCRYPT_WITH_MARKING_CACHE = 1 << 4,
+    /// Cache deleteTokens and compactionTokens
+    TESTER_MONGOCRYPT_WITH_TOKEN_CACHE = 1 << 5,
+    /// Cache Deterministic ciphertexts
+    TESTER_MONGOCRYPT_WITH_DETERMINISTIC_CACHE = 1 << 6,
+    /// Cache equality find payloads
+    TESTER_MONGOCRYPT_WITH_FIND_PAYLOAD_CACHE = 1 << 7,
+    /// Cache parsed range options
+    TESTER_MONGOCRYPT_WITH_RANGE_OPTS_CACHE = 1 << 8,
+    /// Keep recently used keys in a thread-local cache
+    TESTER_MONGOCRYPT_WITH_KEY_CACHE_THREAD_LOCAL = 1 << 9,
 } tester_mongocrypt_flags;
 
 /* Arbitrary max of 2048 instances of temporary test data. Increase as needed.
@@ -95,6 +109,24 @@ char *_mongocrypt_repeat_char(char c, uint32_t times);
 
 void _mongocrypt_tester_fill_buffer(_mongocrypt_buffer_t *buf, int n);
 
+/* A thread running a test function, started with
+ * _mongocrypt_tester_thread_start and freed by _mongocrypt_tester_thread_join. */
+typedef struct __mongocrypt_tester_thread_t _mongocrypt_tester_thread_t;
+
+_mongocrypt_tester_thread_t *_mongocrypt_tester_thread_start(void (*fn)(void *arg), void *arg);
+
+void _mongocrypt_tester_thread_join(_mongocrypt_tester_thread_t *thread);
+
+typedef struct {
+    int calls;
+    uint32_t last_count; /* The task count of the last call. */
+} _reverse_parallel_for_ctx;
+
+/* A parallel_for executor running the tasks in reverse order, to check that
+ * results do not depend on the order of tasks. @ctx is a
+ * _reverse_parallel_for_ctx counting the calls. */
+void _reverse_parallel_for(void *ctx, mongocrypt_task_fn task, void *task_ctx, uint32_t count);
+
 /* Return a new initialized mongocrypt_t for testing. */
 mongocrypt_t *_mongocrypt_tester_mongocrypt(tester_mongocrypt_flags options);
 
@@ -124,6 +156,12 @@ void _mongocrypt_tester_install_ctx_decrypt(_mongocrypt_tester_t *tester);
 
 void _mongocrypt_tester_install_ctx_rewrap_many_datakey(_mongocrypt_tester_t *tester);
 
+void _mongocrypt_tester_install_ctx_prefetch_keys(_mongocrypt_tester_t *tester);
+
+void _mongocrypt_tester_install_ctx_group(_mongocrypt_tester_t *tester);
+
+void _mongocrypt_tester_install_key_handle(_mongocrypt_tester_t *tester);
+
 void _mongocrypt_tester_install_ciphertext(_mongocrypt_tester_t *tester);
 
 void _mongocrypt_tester_install_key_broker(_mongocrypt_tester_t *tester);
@@ -162,6 +200,8 @@ void _mongocrypt_tester_install_cache_oauth(_mongocrypt_tester_t *tester);
 
 void _mongocrypt_tester_install_kms_ctx(_mongocrypt_tester_t *tester);
 
+void _mongocrypt_tester_install_kms_client(_mongocrypt_tester_t *tester);
+
 void _mongocrypt_tester_install_mc_tokens(_mongocrypt_tester_t *tester);
 
 void _mongocrypt_tester_install_fle2_payloads(_mongocrypt_tester_t *tester);
@@ -200,6 +240,8 @@ void _mongocrypt_tester_install_mc_FLE2RangeFindDriverSpec(_mongocrypt_tester_t
 
 void _mongocrypt_tester_install_mc_reader(_mongocrypt_tester_t *tester);
 
+void _mongocrypt_tester_install_mc_arena(_mongocrypt_tester_t *tester);
+
 void _mongocrypt_tester_install_mc_writer(_mongocrypt_tester_t *tester);
 
 void _mongocrypt_tester_install_opts(_mongocrypt_tester_t *tester);
@@ -228,6 +270,17 @@ mongocrypt_binary_t *_mongocrypt_tester_file(_mongocrypt_tester_t *tester, const
 #define INSTALL_TEST(fn) _mongocrypt_tester_install(tester, #fn, fn, CRYPTO_REQUIRED)
 #define INSTALL_TEST_CRYPTO(fn, crypto) _mongocrypt_tester_install(tester, #fn, fn, crypto)
 
+/* Returns from a test that sets crypto hooks if they are disabled. */
+#ifdef MONGOCRYPT_ENABLE_CRYPTO_HOOKS
+#define SKIP_WITHOUT_CRYPTO_HOOKS() ((void)0)
+#else
+#define SKIP_WITHOUT_CRYPTO_HOOKS()                                                                                    \
+    do {                                                                                                               \
+        printf("Crypto hooks are disabled. Skipping.\n");                                                              \
+        return;                                                                                                        \
+    } while (0)
+#endif
+
 void _load_json_as_bson(const char *path, bson_t *out);
 
 extern bool _aes_ctr_is_supported_by_os;
@@ -2367,6 +2367,116 @@ static void test_mongocrypt_kms_ctx_get_kms_provider(_mongocrypt_tester_t *teste
     mongocrypt_destroy(crypt);
 }
 
+// `assert_kms_message_contains` asserts that the request of `kctx` contains `expect`.
+static void assert_kms_message_contains(mongocrypt_kms_ctx_t *kctx, const char *expect) {
+    mongocrypt_binary_t *request = mongocrypt_binary_new();
+    ASSERT_OK(mongocrypt_kms_ctx_message(kctx, request), kctx);
+    char *str = bson_strndup((const char *)mongocrypt_binary_data(request), mongocrypt_binary_len(request));
+    ASSERT_STRCONTAINS(str, expect);
+    bson_free(str);
+    mongocrypt_binary_destroy(request);
+}
+
+static void test_oauth_refresh_margin_with_named_azure(_mongocrypt_tester_t *tester) {
+    mongocrypt_binary_t *kms_providers = TEST_BSON(BSON_STR({
+        "azure:name1" : {
+            "tenantId" : "placeholder1-tenantId",
+            "clientId" : "placeholder1-clientId",
+            "clientSecret" : "placeholder1-clientSecret",
+            "identityPlatformEndpoint" : "placeholder1-identityPlatformEndpoint.com"
+        }
+    }));
+
+    _mongocrypt_buffer_t dek1;
+    create_dek(tester,
+               (create_dek_args){.kms_providers = kms_providers,
+                                 .key_alt_name = "azure1",
+                                 .kek = TEST_BSON(BSON_STR({
+                                     "provider" : "azure:name1",
+                                     "keyName" : "placeholder1-keyName",
+                                     "keyVaultEndpoint" : "placeholder1-keyVaultEndpoint.com"
+                                 })),
+                                 .kms_response_1 = TEST_FILE("./test/data/kms-azure/oauth-response.txt"),
+                                 .kms_response_2 = TEST_FILE("./test/data/kms-azure/encrypt-response.txt")},
+               &dek1);
+
+    mongocrypt_t *crypt = mongocrypt_new();
+    ASSERT_OK(mongocrypt_setopt_kms_providers(crypt, kms_providers), crypt);
+    ASSERT_OK(mongocrypt_setopt_oauth_refresh_margin_ms(crypt, 10 * 60 * 1000), crypt);
+    ASSERT_OK(_mongocrypt_init_for_test(crypt), crypt);
+
+    // Cache a token that expires within the margin.
+    ASSERT_OK_STATUS(mc_mapof_kmsid_to_token_add_response(crypt->cache_oauth,
+                                                          "azure:name1",
+                                                          TMP_BSON("{'expires_in': 120, 'access_token': 'old-token'}"),
+                                                          crypt->status),
+                     crypt->status);
+
+    // The first context decrypts the DEK with the old token, and refreshes it.
+    mongocrypt_ctx_t *ctx = mongocrypt_ctx_new(crypt);
+    ASSERT_OK(mongocrypt_ctx_setopt_key_alt_name(ctx, TEST_BSON(BSON_STR({"keyAltName" : "azure1"}))), ctx);
+    ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx, MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR, -1), ctx);
+    ASSERT_OK(mongocrypt_ctx_explicit_encrypt_init(ctx, TEST_BSON(BSON_STR({"v" : "foo"}))), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+    ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx, _mongocrypt_buffer_as_binary(&dek1)), ctx);
+    ASSERT_OK(mongocrypt_ctx_mongo_done(ctx), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_NEED_KMS);
+
+    mongocrypt_kms_ctx_t *decrypt_kctx = NULL;
+    mongocrypt_kms_ctx_t *oauth_kctx = NULL;
+    mongocrypt_kms_ctx_t *kctx;
+    while ((kctx = mongocrypt_ctx_next_kms_ctx(ctx))) {
+        const char *endpoint;
+        ASSERT_OK(mongocrypt_kms_ctx_endpoint(kctx, &endpoint), kctx);
+        if (0 == strcmp(endpoint, "placeholder1-keyVaultEndpoint.com:443")) {
+            ASSERT(!decrypt_kctx);
+            decrypt_kctx = kctx;
+        } else {
+            ASSERT_STREQUAL(endpoint, "placeholder1-identityPlatformEndpoint.com:443");
+            ASSERT(!oauth_kctx);
+            oauth_kctx = kctx;
+        }
+    }
+    ASSERT(decrypt_kctx);
+    ASSERT(oauth_kctx);
+    assert_kms_message_contains(decrypt_kctx, "old-token");
+
+    // Another context still uses the old token, and does not refresh it again.
+    {
+        mongocrypt_ctx_t *ctx2 = mongocrypt_ctx_new(crypt);
+        ASSERT_OK(mongocrypt_ctx_setopt_key_alt_name(ctx2, TEST_BSON(BSON_STR({"keyAltName" : "azure1"}))), ctx2);
+        ASSERT_OK(mongocrypt_ctx_setopt_algorithm(ctx2, MONGOCRYPT_ALGORITHM_DETERMINISTIC_STR, -1), ctx2);
+        ASSERT_OK(mongocrypt_ctx_explicit_encrypt_init(ctx2, TEST_BSON(BSON_STR({"v" : "foo"}))), ctx2);
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx2), MONGOCRYPT_CTX_NEED_MONGO_KEYS);
+        ASSERT_OK(mongocrypt_ctx_mongo_feed(ctx2, _mongocrypt_buffer_as_binary(&dek1)), ctx2);
+        ASSERT_OK(mongocrypt_ctx_mongo_done(ctx2), ctx2);
+        ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx2), MONGOCRYPT_CTX_NEED_KMS);
+        kctx = mongocrypt_ctx_next_kms_ctx(ctx2);
+        ASSERT(kctx);
+        const char *endpoint;
+        ASSERT_OK(mongocrypt_kms_ctx_endpoint(kctx, &endpoint), kctx);
+        ASSERT_STREQUAL(endpoint, "placeholder1-keyVaultEndpoint.com:443");
+        assert_kms_message_contains(kctx, "old-token");
+        ASSERT(!mongocrypt_ctx_next_kms_ctx(ctx2));
+        mongocrypt_ctx_destroy(ctx2);
+    }
+
+    ASSERT_OK(mongocrypt_kms_ctx_feed(decrypt_kctx, TEST_FILE("./test/data/kms-azure/decrypt-response.txt")),
+              decrypt_kctx);
+    ASSERT_OK(mongocrypt_kms_ctx_feed(oauth_kctx, TEST_FILE("./test/data/kms-azure/oauth-response.txt")), oauth_kctx);
+    ASSERT_OK(mongocrypt_ctx_kms_done(ctx), ctx);
+    ASSERT_STATE_EQUAL(mongocrypt_ctx_state(ctx), MONGOCRYPT_CTX_READY);
+    mongocrypt_ctx_destroy(ctx);
+
+    // The response replaced the cached token.
+    char *token = mc_mapof_kmsid_to_token_get_token(crypt->cache_oauth, "azure:name1");
+    ASSERT_STREQUAL(token, "test-access-token");
+    bson_free(token);
+
+    mongocrypt_destroy(crypt);
+    _mongocrypt_buffer_cleanup(&dek1);
+}
+
 void _mongocrypt_tester_install_named_kms_providers(_mongocrypt_tester_t *tester) {
     INSTALL_TEST(test_configuring_named_kms_providers);
     INSTALL_TEST(test_create_datakey_with_named_kms_provider);
@@ -2378,4 +2488,5 @@ void _mongocrypt_tester_install_named_kms_providers(_mongocrypt_tester_t *tester
     INSTALL_TEST(test_rewrap_with_named_kms_provider_azure2azure);
     INSTALL_TEST(test_rewrap_with_named_kms_provider_azure2local);
     INSTALL_TEST(test_mongocrypt_kms_ctx_get_kms_provider);
+    INSTALL_TEST(test_oauth_refresh_margin_with_named_azure);
 }
@@ -18,6 +18,7 @@
 
 #include <fcntl.h>
 #include <kms_message/kms_b64.h>
+#include <pthread.h>
 #include <mongoc/mongoc.h>
 #include <mongocrypt.h>
 
@@ -51,6 +52,22 @@ static void set_kms_providers(mongocrypt_t *crypt, bson_t *args) {
     bson_destroy(kms_providers);
 }
 
+/* Sessions recorded for --record_file. The handler may be called from any
+ * thread running a context. */
+static FILE *record_file;
+static pthread_mutex_t record_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void _record_to_file(mongocrypt_ctx_t *ctx, mongocrypt_binary_t *session, void *record_ctx) {
+    (void)ctx;
+    (void)record_ctx;
+
+    pthread_mutex_lock(&record_mutex);
+    if (1 != fwrite(mongocrypt_binary_data(session), mongocrypt_binary_len(session), 1, record_file)) {
+        ERREXIT("failed to write recorded session");
+    }
+    pthread_mutex_unlock(&record_mutex);
+}
+
 static mongocrypt_t *crypt_new(bson_t *args) {
     mongocrypt_t *crypt;
     bson_t *schema_map;
@@ -63,6 +80,20 @@ static mongocrypt_t *crypt_new(bson_t *args) {
 
     set_kms_providers(crypt, args);
 
+    if (bson_has_field(args, "record_file")) {
+        if (!record_file) {
+            const char *path = bson_req_utf8(args, "record_file");
+
+            record_file = fopen(path, "ab");
+            if (!record_file) {
+                ERREXIT("failed to open record file: %s", path);
+            }
+        }
+        if (!mongocrypt_setopt_record_handler(crypt, _record_to_file, NULL)) {
+            ERREXIT_MONGOCRYPT(crypt);
+        }
+    }
+
     schema_map = bson_get_json(args, "schema_map_file");
     if (schema_map) {
         bin = util_bson_to_bin(schema_map);
@@ -116,6 +147,7 @@ static void state_init(state_t *state, bson_t *args, mongocrypt_ctx_t *ctx) {
     state->machine.trace = bson_get_bool(args, "trace", false);
     state->machine.tls_ca_file = bson_get_utf8(args, "tls_ca_file", NULL);
     state->machine.tls_certificate_key_file = bson_get_utf8(args, "tls_certificate_key_file", NULL);
+    memset(&state->machine.times, 0, sizeof(state->machine.times));
 }
 
 static void state_cleanup(state_t *state) {
@@ -284,35 +316,113 @@ static void fn_createdatakey(bson_t *args) {
     state_cleanup(&state);
 }
 
-static void fn_autoencrypt(bson_t *args) {
-    state_t state;
+/* Creates and initializes a context for one operation on @input. */
+typedef mongocrypt_ctx_t *(*ctx_new_fn)(mongocrypt_t *crypt, bson_t *args, bson_t *input);
+
+typedef struct {
+    bson_t *args;
     mongocrypt_t *crypt;
-    mongocrypt_ctx_t *ctx;
-    const char *db;
-    mongocrypt_binary_t *bin;
-    bson_t *cmd;
+    ctx_new_fn ctx_new;
+    bson_t *input;
+    int64_t repeat;
+    _phase_times_t times;
+} bench_worker_t;
+
+static void *bench_worker_run(void *arg) {
+    bench_worker_t *worker = arg;
+    state_t state;
     bson_t result;
     bson_error_t error;
-    char *result_utf8;
 
-    crypt = crypt_new(args);
-    ctx = mongocrypt_ctx_new(crypt);
+    state_init(&state, worker->args, NULL);
+    for (int64_t i = 0; i < worker->repeat; i++) {
+        const int64_t start = bson_get_monotonic_time();
+        mongocrypt_ctx_t *ctx = worker->ctx_new(worker->crypt, worker->args, worker->input);
 
-    cmd = bson_get_json(args, "command_file");
-    if (!cmd) {
-        const char *cmd_utf8 = bson_req_utf8(args, "command");
-        cmd = bson_new_from_json((const uint8_t *)cmd_utf8, strlen(cmd_utf8), &error);
-        if (!cmd) {
+        worker->times.analysis_usec += bson_get_monotonic_time() - start;
+        state.machine.ctx = ctx;
+        if (!_csfle_state_machine_run(&state.machine, &result, &error)) {
             ERREXIT_BSON(&error);
         }
+        bson_destroy(&result);
+        mongocrypt_ctx_destroy(ctx);
     }
+    worker->times.analysis_usec += state.machine.times.analysis_usec;
+    worker->times.keys_usec += state.machine.times.keys_usec;
+    worker->times.finalize_usec += state.machine.times.finalize_usec;
+    state_cleanup(&state);
+    return NULL;
+}
 
-    db = bson_req_utf8(args, "db");
-    bin = util_bson_to_bin(cmd);
-    if (!mongocrypt_ctx_encrypt_init(ctx, db, -1, bin)) {
-        ERREXIT_CTX(ctx);
+/* Runs --repeat operations on each of --threads threads sharing one
+ * mongocrypt_t, and prints throughput and the mean time of each phase. */
+static void run_bench(bson_t *args, mongocrypt_t *crypt, ctx_new_fn ctx_new, bson_t *input) {
+    const int64_t repeat = strtoll(bson_req_utf8(args, "repeat"), NULL, 10);
+    const int nthreads = atoi(bson_get_utf8(args, "threads", "1"));
+    bench_worker_t *workers;
+    pthread_t *threads;
+    _phase_times_t times = {0};
+
+    if (repeat < 1 || nthreads < 1) {
+        ERREXIT("--repeat and --threads must be positive");
+    }
+
+    workers = bson_malloc0(sizeof(bench_worker_t) * (size_t)nthreads);
+    threads = bson_malloc0(sizeof(pthread_t) * (size_t)nthreads);
+
+    const int64_t start = bson_get_monotonic_time();
+    for (int i = 0; i < nthreads; i++) {
+        workers[i].args = args;
+        workers[i].crypt = crypt;
+        workers[i].ctx_new = ctx_new;
+        workers[i].input = input;
+        workers[i].repeat = repeat;
+        if (0 != pthread_create(&threads[i], NULL, bench_worker_run, &workers[i])) {
+            ERREXIT("Failed to create thread");
+        }
+    }
+    for (int i = 0; i < nthreads; i++) {
+        pthread_join(threads[i], NULL);
+        times.analysis_usec += workers[i].times.analysis_usec;
+        times.keys_usec += workers[i].times.keys_usec;
+        times.finalize_usec += workers[i].times.finalize_usec;
+    }
+    const int64_t elapsed = bson_get_monotonic_time() - start;
+    const double ops = (double)repeat * nthreads;
+
+    printf("%.0f operations on %d threads in %.3f s: %.1f ops/s\n",
+           ops,
+           nthreads,
+           (double)elapsed / 1e6,
+           ops * 1e6 / (double)elapsed);
+    printf("mean time per operation:\n");
+    printf("  query analysis  %12.1f us\n", (double)times.analysis_usec / ops);
+    printf("  key resolution  %12.1f us\n", (double)times.keys_usec / ops);
+    printf("  finalize        %12.1f us\n", (double)times.finalize_usec / ops);
+
+    bson_free(threads);
+    bson_free(workers);
+}
+
+/* Runs one operation and prints the result, or benchmarks it if --repeat is
+ * given. */
+static void run(bson_t *args, ctx_new_fn ctx_new, bson_t *input) {
+    state_t state;
+    mongocrypt_t *crypt;
+    mongocrypt_ctx_t *ctx;
+    bson_t result;
+    bson_error_t error;
+    char *result_utf8;
+
+    crypt = crypt_new(args);
+
+    if (bson_has_field(args, "repeat")) {
+        run_bench(args, crypt, ctx_new, input);
+        mongocrypt_destroy(crypt);
+        return;
     }
 
+    ctx = ctx_new(crypt, args, input);
     state_init(&state, args, ctx);
 
     if (state.machine.trace) {
@@ -331,89 +441,77 @@ static void fn_autoencrypt(bson_t *args) {
     printf("%s\n", result_utf8);
     bson_free(result_utf8);
 
-    bson_destroy(cmd);
-    mongocrypt_binary_destroy(bin);
     bson_destroy(&result);
     mongocrypt_ctx_destroy(ctx);
     mongocrypt_destroy(crypt);
     state_cleanup(&state);
 }
 
-static void fn_autodecrypt(bson_t *args) {
-    state_t state;
-    mongocrypt_t *crypt;
-    mongocrypt_ctx_t *ctx;
-    mongocrypt_binary_t *bin;
+/* Returns the JSON document in the option @file_key, or else @key. */
+static bson_t *get_json_input(bson_t *args, const char *file_key, const char *key) {
     bson_t *doc;
-    bson_t result;
     bson_error_t error;
-    char *result_utf8;
-
-    crypt = crypt_new(args);
-    ctx = mongocrypt_ctx_new(crypt);
 
-    doc = bson_get_json(args, "document_file");
+    doc = file_key ? bson_get_json(args, file_key) : NULL;
     if (!doc) {
-        const char *doc_utf8 = bson_req_utf8(args, "document");
+        const char *doc_utf8 = bson_req_utf8(args, key);
         doc = bson_new_from_json((const uint8_t *)doc_utf8, strlen(doc_utf8), &error);
         if (!doc) {
             ERREXIT_BSON(&error);
         }
     }
+    return doc;
+}
 
-    bin = util_bson_to_bin(doc);
-    if (!mongocrypt_ctx_decrypt_init(ctx, bin)) {
+static mongocrypt_ctx_t *ctx_new_autoencrypt(mongocrypt_t *crypt, bson_t *args, bson_t *cmd) {
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *bin;
+
+    ctx = mongocrypt_ctx_new(crypt);
+    bin = util_bson_to_bin(cmd);
+    if (!mongocrypt_ctx_encrypt_init(ctx, bson_req_utf8(args, "db"), -1, bin)) {
         ERREXIT_CTX(ctx);
     }
+    mongocrypt_binary_destroy(bin);
+    return ctx;
+}
 
-    state_init(&state, args, ctx);
+static void fn_autoencrypt(bson_t *args) {
+    bson_t *cmd = get_json_input(args, "command_file", "command");
 
-    if (state.machine.trace) {
-        MONGOC_INFO("Running state machine");
-    }
+    run(args, ctx_new_autoencrypt, cmd);
+    bson_destroy(cmd);
+}
 
-    if (!_csfle_state_machine_run(&state.machine, &result, &error)) {
-        ERREXIT_BSON(&error);
-    }
+static mongocrypt_ctx_t *ctx_new_autodecrypt(mongocrypt_t *crypt, bson_t *args, bson_t *doc) {
+    mongocrypt_ctx_t *ctx;
+    mongocrypt_binary_t *bin;
 
-    if (state.machine.trace) {
-        MONGOC_INFO("Finished running state machine");
+    ctx = mongocrypt_ctx_new(crypt);
+    bin = util_bson_to_bin(doc);
+    if (!mongocrypt_ctx_decrypt_init(ctx, bin)) {
+        ERREXIT_CTX(ctx);
     }
+    mongocrypt_binary_destroy(bin);
+    return ctx;
+}
 
-    result_utf8 = bson_as_canonical_extended_json(&result, NULL);
-    printf("%s\n", result_utf8);
-    bson_free(result_utf8);
+static void fn_autodecrypt(bson_t *args) {
+    bson_t *doc = get_json_input(args, "document_file", "document");
 
+    run(args, ctx_new_autodecrypt, doc);
     bson_destroy(doc);
-    mongocrypt_binary_destroy(bin);
-    bson_destroy(&result);
-    mongocrypt_ctx_destroy(ctx);
-    mongocrypt_destroy(crypt);
-    state_cleanup(&state);
 }
 
-static void fn_explicitencrypt(bson_t *args) {
-    state_t state;
-    mongocrypt_t *crypt;
+static mongocrypt_ctx_t *ctx_new_explicitencrypt(mongocrypt_t *crypt, bson_t *args, bson_t *value_doc) {
     mongocrypt_ctx_t *ctx;
-    const char *value;
-    bson_t *value_doc;
     const char *key_id_base64;
     const char *key_alt_name;
     const char *algorithm;
     mongocrypt_binary_t *bin;
-    bson_t result;
-    bson_error_t error;
-    char *result_utf8;
     uint8_t key_id[97];
 
-    crypt = crypt_new(args);
     ctx = mongocrypt_ctx_new(crypt);
-    value = bson_req_utf8(args, "value");
-    value_doc = bson_new_from_json((const uint8_t *)value, strlen(value), &error);
-    if (!value_doc) {
-        ERREXIT_BSON(&error);
-    }
     key_id_base64 = bson_get_utf8(args, "key_id", NULL);
     if (key_id_base64) {
         int len = kms_message_b64_pton(key_id_base64, key_id, sizeof(key_id));
@@ -437,6 +535,7 @@ static void fn_explicitencrypt(bson_t *args) {
             ERREXIT_CTX(ctx);
         }
         mongocrypt_binary_destroy(bin);
+        bson_destroy(wrapper);
     }
 
     algorithm = bson_req_utf8(args, "algorithm");
@@ -448,81 +547,35 @@ static void fn_explicitencrypt(bson_t *args) {
     if (!mongocrypt_ctx_explicit_encrypt_init(ctx, bin)) {
         ERREXIT_CTX(ctx);
     }
+    mongocrypt_binary_destroy(bin);
+    return ctx;
+}
 
-    state_init(&state, args, ctx);
-
-    if (state.machine.trace) {
-        MONGOC_INFO("Running state machine");
-    }
-
-    if (!_csfle_state_machine_run(&state.machine, &result, &error)) {
-        ERREXIT_BSON(&error);
-    }
-
-    if (state.machine.trace) {
-        MONGOC_INFO("Finished running state machine");
-    }
-
-    result_utf8 = bson_as_canonical_extended_json(&result, NULL);
-    printf("%s\n", result_utf8);
-    bson_free(result_utf8);
+static void fn_explicitencrypt(bson_t *args) {
+    bson_t *value_doc = get_json_input(args, NULL, "value");
 
+    run(args, ctx_new_explicitencrypt, value_doc);
     bson_destroy(value_doc);
-    mongocrypt_binary_destroy(bin);
-    bson_destroy(&result);
-    mongocrypt_ctx_destroy(ctx);
-    mongocrypt_destroy(crypt);
-    state_cleanup(&state);
 }
 
-static void fn_explicitdecrypt(bson_t *args) {
-    state_t state;
-    mongocrypt_t *crypt;
+static mongocrypt_ctx_t *ctx_new_explicitdecrypt(mongocrypt_t *crypt, bson_t *args, bson_t *value_doc) {
     mongocrypt_ctx_t *ctx;
-    const char *value;
-    bson_t *value_doc;
     mongocrypt_binary_t *bin;
-    bson_t result;
-    bson_error_t error;
-    char *result_utf8;
 
-    crypt = crypt_new(args);
     ctx = mongocrypt_ctx_new(crypt);
-    value = bson_req_utf8(args, "value");
-    value_doc = bson_new_from_json((const uint8_t *)value, strlen(value), &error);
-    if (!value_doc) {
-        ERREXIT_BSON(&error);
-    }
-
     bin = util_bson_to_bin(value_doc);
     if (!mongocrypt_ctx_explicit_decrypt_init(ctx, bin)) {
         ERREXIT_CTX(ctx);
     }
+    mongocrypt_binary_destroy(bin);
+    return ctx;
+}
 
-    state_init(&state, args, ctx);
-
-    if (state.machine.trace) {
-        MONGOC_INFO("Running state machine");
-    }
-
-    if (!_csfle_state_machine_run(&state.machine, &result, &error)) {
-        ERREXIT_BSON(&error);
-    }
-
-    if (state.machine.trace) {
-        MONGOC_INFO("Finished running state machine");
-    }
-
-    result_utf8 = bson_as_canonical_extended_json(&result, NULL);
-    printf("%s\n", result_utf8);
-    bson_free(result_utf8);
+static void fn_explicitdecrypt(bson_t *args) {
+    bson_t *value_doc = get_json_input(args, NULL, "value");
 
+    run(args, ctx_new_explicitdecrypt, value_doc);
     bson_destroy(value_doc);
-    mongocrypt_binary_destroy(bin);
-    bson_destroy(&result);
-    mongocrypt_ctx_destroy(ctx);
-    mongocrypt_destroy(crypt);
-    state_cleanup(&state);
 }
 
 int main(int argc, char **argv) {
@@ -560,6 +613,9 @@ int main(int argc, char **argv) {
 
     bson_destroy(&args);
     bson_destroy(options_file_bson);
+    if (record_file) {
+        fclose(record_file);
+    }
 
     mongoc_cleanup();
 }
@@ -670,6 +670,7 @@ const char *_state_string(mongocrypt_ctx_state_t state) {
     case MONGOCRYPT_CTX_NEED_KMS: return "MONGOCRYPT_CTX_NEED_KMS";
     case MONGOCRYPT_CTX_READY: return "MONGOCRYPT_CTX_READY";
     case MONGOCRYPT_CTX_DONE: return "MONGOCRYPT_CTX_DONE";
+    case MONGOCRYPT_CTX_NEED_MONGO_OPS: return "MONGOCRYPT_CTX_NEED_MONGO_OPS";
     default: return "UNKNOWN";
     }
 }
@@ -692,10 +693,20 @@ bool _csfle_state_machine_run(_state_machine_t *state_machine, bson_t *result, b
 
     bson_init(result);
     while (true) {
+        const mongocrypt_ctx_state_t state = mongocrypt_ctx_state(state_machine->ctx);
+        const int64_t start = bson_get_monotonic_time();
+        int64_t *phase_usec;
+
         if (state_machine->trace) {
-            MONGOC_DEBUG("Current state = %s", _state_string(mongocrypt_ctx_state(state_machine->ctx)));
+            MONGOC_DEBUG("Current state = %s", _state_string(state));
+        }
+        switch (state) {
+        case MONGOCRYPT_CTX_NEED_MONGO_COLLINFO:
+        case MONGOCRYPT_CTX_NEED_MONGO_MARKINGS: phase_usec = &state_machine->times.analysis_usec; break;
+        case MONGOCRYPT_CTX_READY: phase_usec = &state_machine->times.finalize_usec; break;
+        default: phase_usec = &state_machine->times.keys_usec; break;
         }
-        switch (mongocrypt_ctx_state(state_machine->ctx)) {
+        switch (state) {
         default:
         case MONGOCRYPT_CTX_ERROR: _test_ctx_check_error(state_machine->ctx, error, true); goto fail;
         case MONGOCRYPT_CTX_NEED_MONGO_COLLINFO_WITH_DB:
@@ -734,6 +745,7 @@ bool _csfle_state_machine_run(_state_machine_t *state_machine, bson_t *result, b
             break;
         case MONGOCRYPT_CTX_DONE: goto success; break;
         }
+        *phase_usec += bson_get_monotonic_time() - start;
     }
 
 success:
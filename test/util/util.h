@@ -40,6 +40,16 @@ char *util_getenv(const char *key);
 
 mongocrypt_binary_t *util_bson_to_bin(bson_t *bson);
 
+/* Time spent in each phase of running contexts, in microseconds. */
+typedef struct {
+    /* Context init, collection info, and markings. crypt_shared marks commands
+     * while initializing the context or feeding collection info. */
+    int64_t analysis_usec;
+    /* Key documents, KMS credentials, and KMS requests. */
+    int64_t keys_usec;
+    int64_t finalize_usec;
+} _phase_times_t;
+
 typedef struct {
     mongocrypt_ctx_t *ctx;
     mongoc_collection_t *keyvault_coll;
@@ -49,6 +59,8 @@ typedef struct {
     bool trace;
     const char *tls_ca_file;
     const char *tls_certificate_key_file;
+    /* Accumulates the time spent in each state, except context init. */
+    _phase_times_t times;
 } _state_machine_t;
 
 bool _csfle_state_machine_run(_state_machine_t *state_machine, bson_t *result, bson_error_t *error);